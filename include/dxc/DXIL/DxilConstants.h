@@ -1526,6 +1526,10 @@ namespace DXIL {
   extern const char *kDxBreakMDName;
   extern const char *kDxIsHelperGlobalName;
 
+  // Placeholder for a specialization constant, substituted by
+  // hlsl-dxil-specialize-constants: <ty> dx.specconst.<ty>(i32 id, <ty> default)
+  extern const char *kDxSpecConstantFuncPrefix;
+
   extern const char *kHostLayoutTypePrefix;
 
 } // namespace DXIL
@@ -252,6 +252,10 @@ public:
   // Indication of temporary storage metadata.
   static const char kDxilTempAllocaMDName[];
 
+  // Array alloca to keep in memory rather than split, removed before the
+  // final module.
+  static const char kDxilIndexableAllocaMDName[];
+
   // Validator version.
   static const char kDxilValidatorVersionMDName[];
   // Validator version uses the same constants for fields as kDxilVersion*
@@ -371,7 +375,7 @@ public:
   const llvm::NamedMDNode *GetDxilEntryPoints();
   llvm::MDTuple *EmitDxilEntryPointTuple(llvm::Function *pFunc, const std::string &Name, llvm::MDTuple *pSignatures,
                                          llvm::MDTuple *pResources, llvm::MDTuple *pProperties);
-  void GetDxilEntryPoint(const llvm::MDNode *MDO, llvm::Function *&pFunc, std::string &Name,
+  void GetDxilEntryPoint(const llvm::MDNode *MDO, llvm::Function *&pFunc, llvm::StringRef &Name,
                          const llvm::MDOperand *&pSignatures, const llvm::MDOperand *&pResources,
                          const llvm::MDOperand *&pProperties);
 
@@ -564,6 +568,10 @@ private:
   // Non-fatal if extra metadata is found, but will fail validation.
   // This is how metadata can be exteneded.
   bool m_bExtraMetadata;
+
+  // Emission and load caches for frequently repeated metadata.
+  struct Caches;
+  std::unique_ptr<Caches> m_pCaches;
 };
 
 
@@ -20,6 +20,9 @@
 #include "dxc/DXIL/DxilSignature.h"
 #include "dxc/DXIL/DxilSubobject.h"
 #include "dxc/DXIL/DxilTypeSystem.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/ValueMap.h"
 
 #include <memory>
 #include <string>
@@ -45,8 +48,11 @@ struct DxilFunctionProps;
 
 class DxilEntryProps;
 
+// Looked up for most functions by lowering, validation and container
+// writing, so kept in a DenseMap rather than a node-based map; entries are
+// heap allocated, so references to them stay valid as the map grows.
 using DxilEntryPropsMap =
-    std::unordered_map<const llvm::Function *, std::unique_ptr<DxilEntryProps>>;
+    llvm::DenseMap<const llvm::Function *, std::unique_ptr<DxilEntryProps>>;
 
 /// Use this class to manipulate DXIL of a shader.
 class DxilModule {
@@ -239,6 +245,10 @@ public:
 public:
   ShaderFlags m_ShaderFlags;
   void CollectShaderFlagsForModule(ShaderFlags &Flags);
+  // Flags of F as CollectShaderFlagsForModule() last recorded them, so that
+  // serialization and validation don't scan the instructions again; computed
+  // when F wasn't recorded or the validator version changed since.
+  ShaderFlags GetShaderFlagsForFunction(const llvm::Function *F) const;
 
   // Check if DxilModule contains multi component UAV Loads.
   // This funciton must be called after unused resources are removed from DxilModule
@@ -352,6 +362,12 @@ private:
   unsigned m_ValMinor;
   bool m_ForceZeroStoreLifetimes;
 
+  // Flags of each function recorded by CollectShaderFlagsForModule(), and
+  // the validator version they were computed for.
+  llvm::ValueMap<const llvm::Function *, ShaderFlags> m_FunctionShaderFlags;
+  unsigned m_FunctionShaderFlagsValMajor = 0;
+  unsigned m_FunctionShaderFlagsValMinor = 0;
+
   std::unique_ptr<OP> m_pOP;
   size_t m_pUnused;
 
@@ -365,7 +381,7 @@ private:
   DxilEntryPropsMap  m_DxilEntryPropsMap;
 
   // Keeps track of patch constant functions used by hull shaders
-  std::unordered_set<const llvm::Function *>  m_PatchConstantFunctions;
+  llvm::SmallPtrSet<const llvm::Function *, 4>  m_PatchConstantFunctions;
 
   // Serialized ViewId state.
   std::vector<unsigned> m_SerializedState;
@@ -146,6 +146,10 @@ private:
 
   struct OpCodeCacheItem {
     llvm::SmallMapVector<llvm::Type *, llvm::Function *, 8> pOverloads;
+    // The overloads of the slots holding a single type (void through i64),
+    // indexed by slot. The user-defined and object slots, which hold many
+    // types, are only found in pOverloads.
+    llvm::Function *pSlotOverloads[kUserDefineTypeSlot];
   };
   OpCodeCacheItem m_OpCodeClassCache[(unsigned)OpCodeClass::NumOpClasses];
   std::unordered_map<const llvm::Function *, OpCodeClass> m_FunctionToOpClass;
@@ -14,6 +14,7 @@
 #include <string>
 
 #include "DxilConstants.h"
+#include "llvm/ADT/StringRef.h"
 
 namespace llvm {
 class Value;
@@ -53,7 +54,7 @@ public:
   void SetLowerBound(unsigned LB);
   void SetRangeSize(unsigned RangeSize);
   void SetGlobalSymbol(llvm::Constant *pGV);
-  void SetGlobalName(const std::string &Name);
+  void SetGlobalName(llvm::StringRef Name);
   void SetHandle(llvm::Value *pHandle);
   void SetHLSLType(llvm::Type *Ty);
 
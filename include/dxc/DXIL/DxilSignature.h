@@ -35,6 +35,9 @@ public:
   virtual std::unique_ptr<DxilSignatureElement> CreateElement();
 
   unsigned AppendElement(std::unique_ptr<DxilSignatureElement> pSE, bool bSetID = true);
+  // Makes room for NumElements more elements, so a bulk load appends without
+  // reallocating.
+  void ReserveElements(unsigned NumElements);
 
   DxilSignatureElement &GetElement(unsigned idx);
   const DxilSignatureElement &GetElement(unsigned idx) const;
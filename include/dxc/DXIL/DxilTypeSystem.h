@@ -10,12 +10,14 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #pragma once
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/MapVector.h"
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/DXIL/DxilCompType.h"
 #include "dxc/DXIL/DxilInterpolationMode.h"
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -53,6 +55,10 @@ public:
   bool HasMatrixAnnotation() const;
   const DxilMatrixAnnotation &GetMatrixAnnotation() const;
   void SetMatrixAnnotation(const DxilMatrixAnnotation &MA);
+  // True when the matrix orientation came from the -Zpr/-Zpc default rather
+  // than a row_major/column_major qualifier. Only kept in memory.
+  bool HasDefaultMatrixOrientation() const;
+  void SetDefaultMatrixOrientation(bool b = true);
 
   bool HasResourceAttribute() const;
   llvm::MDNode *GetResourceAttribute() const;
@@ -86,6 +92,7 @@ private:
   bool m_bPrecise;
   CompType m_CompType;
   DxilMatrixAnnotation m_Matrix;
+  bool m_bDefaultMatrixOrientation;
   llvm::MDNode *m_ResourceAttribute;
   unsigned m_CBufferOffset;
   std::string m_Semantic;
@@ -263,6 +270,13 @@ public:
   StructAnnotationMap &GetStructAnnotationMap();
   const StructAnnotationMap &GetStructAnnotationMap() const;
 
+  // Returns the annotation of the innermost annotated struct field reached
+  // from Ty by Indices, the indices of a GEP or extractvalue after the
+  // pointer index, or nullptr when there is none. Paths are resolved once and
+  // cached until struct annotations are added or erased.
+  DxilFieldAnnotation *GetFieldAnnotation(const llvm::Type *Ty,
+                                          llvm::ArrayRef<unsigned> Indices);
+
   DxilPayloadAnnotation *AddPayloadAnnotation(const llvm::StructType *pStructType);
   DxilPayloadAnnotation *GetPayloadAnnotation(const llvm::StructType *pStructType);
   const DxilPayloadAnnotation *GetPayloadAnnotation(const llvm::StructType *pStructType) const;
@@ -302,6 +316,10 @@ private:
   PayloadAnnotationMap m_PayloadAnnotations;
   FunctionAnnotationMap m_FunctionAnnotations;
 
+  // Field annotations found by GetFieldAnnotation, by type and indices.
+  using FieldPathKey = std::pair<const llvm::Type *, std::vector<unsigned> >;
+  std::map<FieldPathKey, DxilFieldAnnotation *> m_FieldPathCache;
+
   DXIL::LowPrecisionMode m_LowPrecisionMode;
 
   llvm::StructType *GetNormFloatType(CompType CT, unsigned NumComps);
@@ -22,6 +22,9 @@ using namespace hlsl;
 namespace hlsl {
   class AbstractMemoryStream;
 }
+namespace llvm {
+  class raw_ostream;
+}
 
 class DxcContainerBuilder : public IDxcContainerBuilder {
 public:
@@ -58,6 +61,8 @@ private:
   const char *m_warning;
   bool m_RequireValidation;
 
+  const DxilPart *FindPart(UINT32 fourCC) const;
+  HRESULT ValidateRootSignature(llvm::raw_ostream &DiagStream);
   UINT32 ComputeContainerSize();
   HRESULT UpdateContainerHeader(AbstractMemoryStream *pStream, uint32_t containerSize);
   HRESULT UpdateOffsetTable(AbstractMemoryStream *pStream);
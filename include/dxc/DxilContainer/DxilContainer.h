@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 #include <iterator>
+#include <vector>
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/Support/WinAdapter.h"
 
@@ -121,6 +122,21 @@ struct DxilProgramHeader {
   // Followed by uint8_t[BitcodeHeader.BitcodeOffset]
 };
 
+// A program part of an intermediate library may hold its bitcode compressed.
+// Its bitcode header then has DxilCompressedMagicValue as its magic, and is
+// followed by a DxilCompressedBitcodeHeader; BitcodeOffset and BitcodeSize
+// give the compressed bytes. Readers that don't expand it reject the part.
+static const uint32_t DxilCompressedMagicValue = 0x5A4C5844; // 'DXLZ'
+
+enum class DxilBitcodeCompressType : uint32_t {
+  Zlib = 1,
+};
+
+struct DxilCompressedBitcodeHeader {
+  DxilBitcodeCompressType CompressType; // How the bitcode is compressed.
+  uint32_t UncompressedSize;            // Size of the bitcode once expanded.
+};
+
 struct DxilProgramSignature {
   uint32_t ParamCount;
   uint32_t ParamOffset;
@@ -284,6 +300,11 @@ struct DxilCompilerVersion {
 //        char Content[ ContentSizeInBytes ]
 //        (0-3 zero bytes to align to a 4-byte boundary)
 //
+// A file whose content is identical to an earlier file's is written as an
+// alias entry instead: its Flags have DxilSourceInfo_SourceContentsEntryFlag_Alias
+// set, ContentSizeInBytes is zero, and the header is followed by the uint32_t
+// index of the earlier entry.
+//
 // ================ 3. Args ==================================
 //
 //   DxilSourceInfo_Args
@@ -378,6 +399,9 @@ struct DxilSourceInfo_SourceContentsEntry {
   // Followed by [0-3] zero bytes to align to a 4-byte boundary.
 };
 
+// The entry holds the uint32_t index of an earlier entry with the same content.
+static const uint32_t DxilSourceInfo_SourceContentsEntryFlag_Alias = 0x1;
+
 #pragma pack(pop)
 
 /// Gets a part header by index.
@@ -531,6 +555,32 @@ inline uint32_t GetDxilBitcodeSize(const DxilProgramHeader *pHeader) {
   return pHeader->BitcodeHeader.BitcodeSize;
 }
 
+inline bool IsValidCompressedDxilProgramHeader(const DxilProgramHeader *pHeader,
+                                               uint32_t length) {
+  const DxilBitcodeHeader *pBCHdr = &pHeader->BitcodeHeader;
+  uint32_t bitcodeLength = length - offsetof(DxilProgramHeader, BitcodeHeader);
+  return length >= sizeof(DxilProgramHeader) +
+                       sizeof(DxilCompressedBitcodeHeader) &&
+         length >= (pHeader->SizeInUint32 * sizeof(uint32_t)) &&
+         pBCHdr->DxilMagic == DxilCompressedMagicValue &&
+         pBCHdr->BitcodeOffset >=
+             sizeof(DxilBitcodeHeader) + sizeof(DxilCompressedBitcodeHeader) &&
+         pBCHdr->BitcodeOffset + pBCHdr->BitcodeSize > pBCHdr->BitcodeOffset &&
+         bitcodeLength >= pBCHdr->BitcodeOffset + pBCHdr->BitcodeSize;
+}
+
+/// Returns pHeader if it is a valid program part. If its bitcode is
+/// compressed instead, the part is expanded into Storage, and the header
+/// returned is there. Returns nullptr if the part is neither.
+const DxilProgramHeader *
+GetValidDxilProgramHeader(const DxilProgramHeader *pHeader, uint32_t length,
+                          std::vector<uint32_t> &Storage);
+
+/// Writes a program part holding the bitcode of pUncompressed, a valid program
+/// part, compressed, to Program. Returns false if compression fails.
+bool CompressDxilProgramPart(const DxilProgramHeader *pUncompressed,
+                             std::vector<uint32_t> &Program);
+
 /// Extract the shader type from the program version value.
 inline DXIL::ShaderKind GetVersionShaderType(uint32_t programVersion) {
   return (DXIL::ShaderKind)((programVersion & 0xffff0000) >> 16);
@@ -581,6 +631,7 @@ enum class SerializeDxilFlags : uint32_t {
   StripReflectionFromDxilPart = 1 << 3, // Strip Reflection info from DXIL part.
   IncludeReflectionPart       = 1 << 4, // Include reflection in STAT part.
   StripRootSignature          = 1 << 5, // Strip Root Signature from main shader container.
+  CompressLibraryBitcode      = 1 << 6, // Compress the program and debug parts of a library.
 };
 inline SerializeDxilFlags& operator |=(SerializeDxilFlags& l, const SerializeDxilFlags& r) {
   l = static_cast<SerializeDxilFlags>(static_cast<int>(l) | static_cast<int>(r));
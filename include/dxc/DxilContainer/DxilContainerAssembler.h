@@ -70,7 +70,8 @@ void SerializeDxilContainerForModule(hlsl::DxilModule *pModule,
                                      SerializeDxilFlags Flags,
                                      DxilShaderHash *pShaderHashOut = nullptr,
                                      AbstractMemoryStream *pReflectionStreamOut = nullptr,
-                                     AbstractMemoryStream *pRootSigStreamOut = nullptr);
+                                     AbstractMemoryStream *pRootSigStreamOut = nullptr,
+                                     unsigned BitcodeThreads = 1);
 void SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
                                      AbstractMemoryStream *pStream);
 
@@ -12,9 +12,11 @@
 #pragma once
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/dxcapi.h"
 
 namespace hlsl {
 
@@ -22,6 +24,27 @@ namespace hlsl {
 
   struct DxilContainerHeader;
 
+  //=================================================================================================================================
+  // DxilPartKindIndex
+  //
+  // Maps each part kind of a container to the index of its first part, so
+  // repeated lookups by FourCC do not walk the part offset table.
+  //
+  class DxilPartKindIndex
+  {
+  public:
+    void Build(_In_ const DxilContainerHeader *pHeader);
+    void Clear() { m_Entries.clear(); }
+
+    // Returns the index of the first part of the kind, or
+    // DXIL_CONTAINER_BLOB_NOT_FOUND.
+    uint32_t Find(uint32_t kind) const;
+
+  private:
+    // FourCC and first part index, sorted by FourCC.
+    llvm::SmallVector<std::pair<uint32_t, uint32_t>, 16> m_Entries;
+  };
+
   //=================================================================================================================================
   // DxilContainerReader
   //
@@ -49,17 +72,29 @@ namespace hlsl {
     // 
     // Returns S_OK or E_FAIL
     HRESULT Load(_In_ const void* pContainer, _In_ uint32_t containerSizeInBytes);
+    // Like Load, but keeps the blob alive so parts can be handed out as
+    // blobs that reference it, such as a mapped file or a range of one.
+    HRESULT Load(_In_ IDxcBlob *pContainer);
 
     HRESULT GetVersion(_Out_ DxilContainerVersion *pResult);
     HRESULT GetPartCount(_Out_ uint32_t *pResult);
     HRESULT GetPartContent(uint32_t idx, _Outptr_ const void **ppResult, _Out_ uint32_t *pResultSize = nullptr);
     HRESULT GetPartFourCC(uint32_t idx, _Out_ uint32_t *pResult);
     HRESULT FindFirstPartKind(uint32_t kind, _Out_ uint32_t *pResult);
+    // Returns a blob over the part's bytes that keeps the container alive;
+    // nothing is copied. Requires the container to have been loaded as a blob.
+    HRESULT GetPartBlob(uint32_t idx, _COM_Outptr_ IDxcBlob **ppResult);
+    // Returns a blob holding the program part at idx, which starts with a
+    // DxilProgramHeader. A part whose bitcode is compressed is returned
+    // expanded, in a copy; any other is returned as by GetPartBlob.
+    HRESULT GetProgramPartBlob(uint32_t idx, _COM_Outptr_ IDxcBlob **ppResult);
 
   private:
     const void* m_pContainer = nullptr;
     uint32_t m_uContainerSize = 0;
     const DxilContainerHeader *m_pHeader = nullptr;
+    CComPtr<IDxcBlob> m_pContainerBlob;
+    DxilPartKindIndex m_Index;
 
     bool IsLoaded() const { return m_pHeader != nullptr; }
   };
@@ -11,6 +11,7 @@
 
 #pragma once
 #include "dxc/DXIL/DxilConstants.h"
+#include <cstring>
 
 namespace hlsl {
 namespace RDAT {
@@ -29,6 +30,11 @@ namespace RDAT {
 //      byte UTF8Data[part.Size];
 //    - else if part.Type is Index:
 //      uint32_t IndexData[part.Size / 4];
+//    - else if part.Type is NameIndex:
+//      uint32_t IndexCount;
+//      - for each index:
+//        RuntimeDataNameIndexHeader index;
+//        uint32_t Slots[index.SlotCount];
 
 enum class RuntimeDataPartType : uint32_t {
   Invalid         = 0,
@@ -38,6 +44,7 @@ enum class RuntimeDataPartType : uint32_t {
   FunctionTable   = 4,
   RawBytes        = 5,
   SubobjectTable  = 6,
+  NameIndex       = 7,  // Optional; readers fall back to scanning rows.
 };
 
 enum RuntimeDataVersion {
@@ -69,6 +76,62 @@ struct RuntimeDataTableHeader {
   // byte TableData[RecordCount * RecordStride];
 };
 
+// Open-addressed hash table over the rows of one table, keyed by row name.
+// SlotCount is a power of two; each slot holds a row index or
+// RDAT_NAME_INDEX_EMPTY, and a name's probe starts at NameIndexHash & mask.
+struct RuntimeDataNameIndexHeader {
+  RuntimeDataPartType TableType;
+  uint32_t SlotCount;
+  // Followed by uint32_t Slots[SlotCount];
+};
+
+#define RDAT_NAME_INDEX_EMPTY ((uint32_t)-1)
+
+// FNV-1a; simple enough for any runtime to reproduce.
+inline uint32_t NameIndexHash(const char *name) {
+  uint32_t hash = 2166136261u;
+  for (; *name; ++name)
+    hash = (hash ^ (uint8_t)*name) * 16777619u;
+  return hash;
+}
+
+// Finds a row by name through a name index when the RDAT has one, and by
+// scanning the rows otherwise. Returns RDAT_NAME_INDEX_EMPTY if not found.
+class NameIndexReader {
+  const uint32_t *m_slots;
+  uint32_t m_count;
+
+public:
+  NameIndexReader() : m_slots(nullptr), m_count(0) {}
+  void Init(const uint32_t *slots, uint32_t count) {
+    // A count that is not a power of two cannot have come from the writer.
+    bool valid = count && (count & (count - 1)) == 0;
+    m_slots = valid ? slots : nullptr;
+    m_count = valid ? count : 0;
+  }
+  bool IsPresent() const { return m_count != 0; }
+
+  template <typename GetNameFn>
+  uint32_t Find(const char *name, uint32_t rowCount, GetNameFn getName) const {
+    if (!IsPresent()) {
+      for (uint32_t row = 0; row < rowCount; ++row)
+        if (strcmp(getName(row), name) == 0)
+          return row;
+      return RDAT_NAME_INDEX_EMPTY;
+    }
+    uint32_t mask = m_count - 1;
+    uint32_t slot = NameIndexHash(name) & mask;
+    for (uint32_t probe = 0; probe < m_count; ++probe, slot = (slot + 1) & mask) {
+      uint32_t row = m_slots[slot];
+      if (row == RDAT_NAME_INDEX_EMPTY)
+        break;
+      if (row < rowCount && strcmp(getName(row), name) == 0)
+        return row;
+    }
+    return RDAT_NAME_INDEX_EMPTY;
+  }
+};
+
 // General purpose strided table reader with casting Row() operation that
 // returns nullptr if stride is smaller than type, for record expansion.
 class TableReader {
@@ -282,29 +345,26 @@ public:
 class ResourceTableReader {
 private:
   TableReader m_Table;
+  NameIndexReader m_NameIndex;
   RuntimeDataContext *m_Context;
-  uint32_t m_CBufferCount;
-  uint32_t m_SamplerCount;
-  uint32_t m_SRVCount;
-  uint32_t m_UAVCount;
-
-public:
-  ResourceTableReader()
-      : m_Context(nullptr), m_CBufferCount(0),
-        m_SamplerCount(0), m_SRVCount(0), m_UAVCount(0){};
-
-  void SetResourceInfo(const char *ptr, uint32_t count, uint32_t recordStride) {
-    m_Table.Init(ptr, count, recordStride);
+  // Counted from the rows on first use, so setting the table costs nothing.
+  mutable bool m_Counted;
+  mutable uint32_t m_CBufferCount;
+  mutable uint32_t m_SamplerCount;
+  mutable uint32_t m_SRVCount;
+  mutable uint32_t m_UAVCount;
+
+  void CountClasses() const {
+    if (m_Counted)
+      return;
+    m_Counted = true;
     // Assuming that resources are in order of CBuffer, Sampler, SRV, and UAV,
     // count the number for each resource class
-    m_CBufferCount = 0;
-    m_SamplerCount = 0;
-    m_SRVCount = 0;
-    m_UAVCount = 0;
-
-    for (uint32_t i = 0; i < count; ++i) {
+    for (uint32_t i = 0; i < m_Table.Count(); ++i) {
       const RuntimeDataResourceInfo *curPtr =
         m_Table.Row<RuntimeDataResourceInfo>(i);
+      if (!curPtr)
+        break;
       if (curPtr->Class == (uint32_t)hlsl::DXIL::ResourceClass::CBuffer)
         m_CBufferCount++;
       else if (curPtr->Class == (uint32_t)hlsl::DXIL::ResourceClass::Sampler)
@@ -316,38 +376,66 @@ public:
     }
   }
 
+public:
+  ResourceTableReader()
+      : m_Context(nullptr), m_Counted(false), m_CBufferCount(0),
+        m_SamplerCount(0), m_SRVCount(0), m_UAVCount(0){};
+
+  void SetResourceInfo(const char *ptr, uint32_t count, uint32_t recordStride) {
+    m_Table.Init(ptr, count, recordStride);
+    m_Counted = false;
+    m_CBufferCount = 0;
+    m_SamplerCount = 0;
+    m_SRVCount = 0;
+    m_UAVCount = 0;
+  }
+
   void SetContext(RuntimeDataContext *context) { m_Context = context; }
+  void SetNameIndex(const uint32_t *slots, uint32_t count) {
+    m_NameIndex.Init(slots, count);
+  }
 
   uint32_t GetNumResources() const {
+    CountClasses();
     return m_CBufferCount + m_SamplerCount + m_SRVCount + m_UAVCount;
   }
+  // Returns the index of the first resource with the name, for GetItem.
+  uint32_t FindResource(const char *name) const {
+    return m_NameIndex.Find(name, GetNumResources(), [this](uint32_t i) {
+      return GetItem(i).GetName();
+    });
+  }
   ResourceReader GetItem(uint32_t i) const {
     _Analysis_assume_(i < GetNumResources());
     return ResourceReader(m_Table.Row<RuntimeDataResourceInfo>(i), m_Context);
   }
 
-  uint32_t GetNumCBuffers() const { return m_CBufferCount; }
+  uint32_t GetNumCBuffers() const { CountClasses(); return m_CBufferCount; }
   ResourceReader GetCBuffer(uint32_t i) {
+    CountClasses();
     _Analysis_assume_(i < m_CBufferCount);
     return ResourceReader(m_Table.Row<RuntimeDataResourceInfo>(i), m_Context);
   }
 
-  uint32_t GetNumSamplers() const { return m_SamplerCount; }
+  uint32_t GetNumSamplers() const { CountClasses(); return m_SamplerCount; }
   ResourceReader GetSampler(uint32_t i) {
+    CountClasses();
     _Analysis_assume_(i < m_SamplerCount);
     uint32_t offset = (m_CBufferCount + i);
     return ResourceReader(m_Table.Row<RuntimeDataResourceInfo>(offset), m_Context);
   }
 
-  uint32_t GetNumSRVs() const { return m_SRVCount; }
+  uint32_t GetNumSRVs() const { CountClasses(); return m_SRVCount; }
   ResourceReader GetSRV(uint32_t i) {
+    CountClasses();
     _Analysis_assume_(i < m_SRVCount);
     uint32_t offset = (m_CBufferCount + m_SamplerCount + i);
     return ResourceReader(m_Table.Row<RuntimeDataResourceInfo>(offset), m_Context);
   }
 
-  uint32_t GetNumUAVs() const { return m_UAVCount; }
+  uint32_t GetNumUAVs() const { CountClasses(); return m_UAVCount; }
   ResourceReader GetUAV(uint32_t i) {
+    CountClasses();
     _Analysis_assume_(i < m_UAVCount);
     uint32_t offset = (m_CBufferCount + m_SamplerCount + m_SRVCount + i);
     return ResourceReader(m_Table.Row<RuntimeDataResourceInfo>(offset), m_Context);
@@ -402,6 +490,13 @@ public:
     return m_Context->pIndexTableReader->getRow(
       m_RuntimeDataFunctionInfo->Resources).Count();
   }
+  // Returns the resource table index of the function's ith resource.
+  uint32_t GetResourceIndex(uint32_t i) const {
+    if (!m_RuntimeDataFunctionInfo)
+      return UINT_MAX;
+    return m_Context->pIndexTableReader->getRow(
+      m_RuntimeDataFunctionInfo->Resources).At(i);
+  }
   ResourceReader GetResource(uint32_t i) const {
     if (!m_RuntimeDataFunctionInfo)
       return ResourceReader(nullptr, m_Context);
@@ -446,6 +541,7 @@ public:
 class FunctionTableReader {
 private:
   TableReader m_Table;
+  NameIndexReader m_NameIndex;
   RuntimeDataContext *m_Context;
 
 public:
@@ -455,11 +551,20 @@ public:
     return FunctionReader(m_Table.Row<RuntimeDataFunctionInfo>(i), m_Context);
   }
   uint32_t GetNumFunctions() const { return m_Table.Count(); }
+  // Returns the index of the function with the mangled name, for GetItem.
+  uint32_t FindFunction(const char *name) const {
+    return m_NameIndex.Find(name, GetNumFunctions(), [this](uint32_t i) {
+      return GetItem(i).GetName();
+    });
+  }
 
   void SetFunctionInfo(const char *ptr, uint32_t count, uint32_t recordStride) {
     m_Table.Init(ptr, count, recordStride);
   }
   void SetContext(RuntimeDataContext *context) { m_Context = context; }
+  void SetNameIndex(const uint32_t *slots, uint32_t count) {
+    m_NameIndex.Init(slots, count);
+  }
 };
 
 class SubobjectReader {
@@ -573,6 +678,7 @@ public:
 class SubobjectTableReader {
 private:
   TableReader m_Table;
+  NameIndexReader m_NameIndex;
   RuntimeDataContext *m_Context;
 
 public:
@@ -583,10 +689,20 @@ public:
     m_Table.Init(ptr, count, recordStride);
   }
 
+  void SetNameIndex(const uint32_t *slots, uint32_t count) {
+    m_NameIndex.Init(slots, count);
+  }
+
   uint32_t GetCount() const { return m_Table.Count(); }
   SubobjectReader GetItem(uint32_t i) const {
     return SubobjectReader(m_Table.Row<RuntimeDataSubobjectInfo>(i), m_Context);
   }
+  // Returns the index of the subobject with the name, for GetItem.
+  uint32_t FindSubobject(const char *name) const {
+    return m_NameIndex.Find(name, GetCount(), [this](uint32_t i) {
+      return GetItem(i).GetName();
+    });
+  }
 };
 
 class DxilRuntimeData {
@@ -698,10 +814,19 @@ struct DxilLibraryDesc {
 class DxilRuntimeReflection {
 public:
   virtual ~DxilRuntimeReflection() {}
-  // This call will allocate memory for GetLibraryReflection call
+  // Reads the part headers only; nothing is copied or allocated. pRDAT must
+  // stay valid until GetLibraryReflection has been called, and for as long
+  // as GetRuntimeData is used.
   virtual bool InitFromRDAT(const void *pRDAT, size_t size) = 0;
+  // Builds the descriptions on the first call.
   // DxilRuntimeReflection owns the memory pointed to by DxilLibraryDesc
   virtual const DxilLibraryDesc GetLibraryReflection() = 0;
+  // The tables read by InitFromRDAT, with names as UTF-8 pointers into the
+  // string table. Reading them allocates nothing.
+  virtual DxilRuntimeData *GetRuntimeData() = 0;
+  // Returns a name from the tables as UTF-16, converted on the first
+  // request for it and owned by DxilRuntimeReflection.
+  virtual LPCWSTR GetWideString(const char *name) = 0;
 };
 
 DxilRuntimeReflection *CreateDxilRuntimeReflection();
@@ -18,14 +18,6 @@
 namespace hlsl {
 namespace RDAT {
 
-struct ResourceKey {
-  uint32_t Class, ID;
-  ResourceKey(uint32_t Class, uint32_t ID) : Class(Class), ID(ID) {}
-  bool operator==(const ResourceKey& other) const {
-    return other.Class == Class && other.ID == ID;
-  }
-};
-
 // Size-checked reader
 //  on overrun: throw buffer_overrun{};
 //  on overlap: throw buffer_overlap{};
@@ -157,6 +149,28 @@ bool DxilRuntimeData::InitFromRDAT(const void *pRDAT, size_t size) {
             table.RecordCount, table.RecordStride);
           break;
         }
+        case RuntimeDataPartType::NameIndex: {
+          uint32_t indexCount = PR.Read<uint32_t>();
+          for (uint32_t j = 0; j < indexCount; ++j) {
+            RuntimeDataNameIndexHeader index =
+              PR.Read<RuntimeDataNameIndexHeader>();
+            const uint32_t *slots = PR.ReadArray<uint32_t>(index.SlotCount);
+            switch (index.TableType) {
+            case RuntimeDataPartType::ResourceTable:
+              m_ResourceTableReader.SetNameIndex(slots, index.SlotCount);
+              break;
+            case RuntimeDataPartType::FunctionTable:
+              m_FunctionTableReader.SetNameIndex(slots, index.SlotCount);
+              break;
+            case RuntimeDataPartType::SubobjectTable:
+              m_SubobjectTableReader.SetNameIndex(slots, index.SlotCount);
+              break;
+            default:
+              break; // Skip indices of unrecognized tables
+            }
+          }
+          break;
+        }
         default:
           continue; // Skip unrecognized parts
         }
@@ -188,15 +202,6 @@ SubobjectTableReader *DxilRuntimeData::GetSubobjectTableReader() {
 using namespace hlsl;
 using namespace RDAT;
 
-namespace std {
-template <> struct hash<ResourceKey> {
-  size_t operator()(const ResourceKey &key) const throw() {
-    return (hash<uint32_t>()(key.Class) * (size_t)16777619U) ^
-           hash<uint32_t>()(key.ID);
-  }
-};
-} // namespace std
-
 namespace {
 
 class DxilRuntimeReflection_impl : public DxilRuntimeReflection {
@@ -215,22 +220,19 @@ private:
   ResourceList m_Resources;
   FunctionList m_Functions;
   SubobjectList m_Subobjects;
-  std::unordered_map<ResourceKey, DxilResourceDesc *> m_ResourceMap;
-  std::unordered_map<DxilFunctionDesc *, ResourceRefList> m_FuncToResMap;
-  std::unordered_map<DxilFunctionDesc *, WStringList> m_FuncToDependenciesMap;
-  std::unordered_map<DxilSubobjectDesc *, WStringList> m_SubobjectToExportsMap;
+  // The resource and name arrays of every function and association, one
+  // after another. Both are reserved to their full size before the first
+  // array is added, so the pointers handed out stay valid.
+  ResourceRefList m_ResourceRefs;
+  WStringList m_WStringRefs;
   bool m_initialized;
+  bool m_reflectionBuilt;
 
-  const wchar_t *GetWideString(const char *ptr);
-  void AddString(const char *ptr);
-  const void *GetBytes(const void *ptr, size_t size);
   void InitializeReflection();
-  const DxilResourceDesc * const*GetResourcesForFunction(DxilFunctionDesc &function,
-                             const FunctionReader &functionReader);
-  const wchar_t **GetDependenciesForFunction(DxilFunctionDesc &function,
-                             const FunctionReader &functionReader);
-  const wchar_t **GetExportsForAssociation(DxilSubobjectDesc &subobject,
-                             const SubobjectReader &subobjectReader);
+  const DxilResourceDesc * const*GetResourcesForFunction(const FunctionReader &functionReader);
+  const wchar_t **GetDependenciesForFunction(const FunctionReader &functionReader);
+  const wchar_t **GetExportsForAssociation(const SubobjectReader &subobjectReader);
+  const void *GetBytes(const void *ptr, size_t size);
   DxilResourceDesc *AddResource(const ResourceReader &resourceReader);
   DxilFunctionDesc *AddFunction(const FunctionReader &functionReader);
   DxilSubobjectDesc *AddSubobject(const SubobjectReader &subobjectReader);
@@ -240,32 +242,31 @@ public:
   // TODO: Update BlobContainer.h to recognize 'RDAT' blob
   DxilRuntimeReflection_impl()
       : m_RuntimeData(), m_StringMap(), m_BytesMap(), m_Resources(), m_Functions(),
-        m_FuncToResMap(), m_FuncToDependenciesMap(), m_SubobjectToExportsMap(),
-        m_initialized(false) {}
+        m_Subobjects(), m_ResourceRefs(), m_WStringRefs(),
+        m_initialized(false), m_reflectionBuilt(false) {}
   virtual ~DxilRuntimeReflection_impl() {}
-  // This call will allocate memory for GetLibraryReflection call
   bool InitFromRDAT(const void *pRDAT, size_t size) override;
   const DxilLibraryDesc GetLibraryReflection() override;
+  DxilRuntimeData *GetRuntimeData() override { return &m_RuntimeData; }
+  LPCWSTR GetWideString(const char *ptr) override;
 };
 
-void DxilRuntimeReflection_impl::AddString(const char *ptr) {
-  if (m_StringMap.find(ptr) == m_StringMap.end()) {
+LPCWSTR DxilRuntimeReflection_impl::GetWideString(const char *ptr) {
+  std::unique_ptr<wchar_t[]> &wide = m_StringMap[ptr];
+  if (!wide) {
     auto state = std::mbstate_t();
-    size_t size = std::mbsrtowcs(nullptr, &ptr, 0, &state);
-    if (size != static_cast<size_t>(-1)) {
-      std::unique_ptr<wchar_t[]> pNew(new wchar_t[size + 1]);
-      auto pOldPtr = ptr;
-      std::mbsrtowcs(pNew.get(), &ptr, size + 1, &state);
-      m_StringMap[pOldPtr] = std::move(pNew);
-    }
-  }
-}
-
-const wchar_t *DxilRuntimeReflection_impl::GetWideString(const char *ptr) {
-  if (m_StringMap.find(ptr) == m_StringMap.end()) {
-    AddString(ptr);
+    const char *src = ptr;
+    size_t size = std::mbsrtowcs(nullptr, &src, 0, &state);
+    if (size == static_cast<size_t>(-1))
+      size = 0;
+    wide.reset(new wchar_t[size + 1]);
+    src = ptr;
+    state = std::mbstate_t();
+    if (size)
+      std::mbsrtowcs(wide.get(), &src, size + 1, &state);
+    wide[size] = L'\0';
   }
-  return m_StringMap.at(ptr).get();
+  return wide.get();
 }
 
 const void *DxilRuntimeReflection_impl::GetBytes(const void *ptr, size_t size) {
@@ -282,14 +283,16 @@ const void *DxilRuntimeReflection_impl::GetBytes(const void *ptr, size_t size) {
 bool DxilRuntimeReflection_impl::InitFromRDAT(const void *pRDAT, size_t size) {
   assert(!m_initialized && "may only initialize once");
   m_initialized = m_RuntimeData.InitFromRDAT(pRDAT, size);
-  if (m_initialized)
-    InitializeReflection();
   return m_initialized;
 }
 
 const DxilLibraryDesc DxilRuntimeReflection_impl::GetLibraryReflection() {
   DxilLibraryDesc reflection = {};
   if (m_initialized) {
+    if (!m_reflectionBuilt) {
+      InitializeReflection();
+      m_reflectionBuilt = true;
+    }
     reflection.NumResources =
         m_RuntimeData.GetResourceTableReader()->GetNumResources();
     reflection.pResource = m_Resources.data();
@@ -308,29 +311,29 @@ void DxilRuntimeReflection_impl::InitializeReflection() {
   // reference them via pointers.
   const ResourceTableReader *resourceTableReader = m_RuntimeData.GetResourceTableReader();
   m_Resources.reserve(resourceTableReader->GetNumResources());
-  for (uint32_t i = 0; i < resourceTableReader->GetNumResources(); ++i) {
-    ResourceReader resourceReader = resourceTableReader->GetItem(i);
-    AddString(resourceReader.GetName());
-    DxilResourceDesc *pResource = AddResource(resourceReader);
-    if (pResource) {
-      ResourceKey key(pResource->Class, pResource->ID);
-      m_ResourceMap[key] = pResource;
-    }
-  }
+  for (uint32_t i = 0; i < resourceTableReader->GetNumResources(); ++i)
+    AddResource(resourceTableReader->GetItem(i));
+
   const FunctionTableReader *functionTableReader = m_RuntimeData.GetFunctionTableReader();
-  m_Functions.reserve(functionTableReader->GetNumFunctions());
+  const SubobjectTableReader *subobjectTableReader = m_RuntimeData.GetSubobjectTableReader();
+  size_t numResourceRefs = 0, numWStringRefs = 0;
   for (uint32_t i = 0; i < functionTableReader->GetNumFunctions(); ++i) {
     FunctionReader functionReader = functionTableReader->GetItem(i);
-    AddString(functionReader.GetName());
-    AddFunction(functionReader);
+    numResourceRefs += functionReader.GetNumResources();
+    numWStringRefs += functionReader.GetNumDependencies();
   }
-  const SubobjectTableReader *subobjectTableReader = m_RuntimeData.GetSubobjectTableReader();
+  for (uint32_t i = 0; i < subobjectTableReader->GetCount(); ++i)
+    numWStringRefs += subobjectTableReader->GetItem(i)
+                          .GetSubobjectToExportsAssociation_NumExports();
+  m_ResourceRefs.reserve(numResourceRefs);
+  m_WStringRefs.reserve(numWStringRefs);
+
+  m_Functions.reserve(functionTableReader->GetNumFunctions());
+  for (uint32_t i = 0; i < functionTableReader->GetNumFunctions(); ++i)
+    AddFunction(functionTableReader->GetItem(i));
   m_Subobjects.reserve(subobjectTableReader->GetCount());
-  for (uint32_t i = 0; i < subobjectTableReader->GetCount(); ++i) {
-    SubobjectReader subobjectReader = subobjectTableReader->GetItem(i);
-    AddString(subobjectReader.GetName());
-    AddSubobject(subobjectReader);
-  }
+  for (uint32_t i = 0; i < subobjectTableReader->GetCount(); ++i)
+    AddSubobject(subobjectTableReader->GetItem(i));
 }
 
 DxilResourceDesc *
@@ -351,34 +354,37 @@ DxilRuntimeReflection_impl::AddResource(const ResourceReader &resourceReader) {
   return &resource;
 }
 
+// m_Resources holds the rows of the resource table in order, so a
+// function's resource is found by its table index.
 const DxilResourceDesc * const*DxilRuntimeReflection_impl::GetResourcesForFunction(
-    DxilFunctionDesc &function, const FunctionReader &functionReader) {
+    const FunctionReader &functionReader) {
   if (!functionReader.GetNumResources())
     return nullptr;
-  auto it = m_FuncToResMap.insert(std::make_pair(&function, ResourceRefList()));
-  assert(it.second && "otherwise, collision");
-  ResourceRefList &resourceList = it.first->second;
-  resourceList.reserve(functionReader.GetNumResources());
+  assert(m_ResourceRefs.size() + functionReader.GetNumResources() <=
+             m_ResourceRefs.capacity() &&
+         "Otherwise, number of function resources was incorrect");
+  size_t first = m_ResourceRefs.size();
   for (uint32_t i = 0; i < functionReader.GetNumResources(); ++i) {
-    const ResourceReader resourceReader = functionReader.GetResource(i);
-    ResourceKey key((uint32_t)resourceReader.GetResourceClass(),
-                    resourceReader.GetID());
-    auto it = m_ResourceMap.find(key);
-    assert(it != m_ResourceMap.end() && it->second && "Otherwise, resource was not in map, or was null");
-    resourceList.emplace_back(it->second);
+    uint32_t index = functionReader.GetResourceIndex(i);
+    assert(index < m_Resources.size() && "Otherwise, resource was not in table");
+    m_ResourceRefs.emplace_back(index < m_Resources.size() ? &m_Resources[index]
+                                                           : nullptr);
   }
-  return resourceList.data();
+  return m_ResourceRefs.data() + first;
 }
 
 const wchar_t **DxilRuntimeReflection_impl::GetDependenciesForFunction(
-    DxilFunctionDesc &function, const FunctionReader &functionReader) {
-  auto it = m_FuncToDependenciesMap.insert(std::make_pair(&function, WStringList()));
-  assert(it.second && "otherwise, collision");
-  WStringList &wStringList = it.first->second;
+    const FunctionReader &functionReader) {
+  if (!functionReader.GetNumDependencies())
+    return nullptr;
+  assert(m_WStringRefs.size() + functionReader.GetNumDependencies() <=
+             m_WStringRefs.capacity() &&
+         "Otherwise, number of function dependencies was incorrect");
+  size_t first = m_WStringRefs.size();
   for (uint32_t i = 0; i < functionReader.GetNumDependencies(); ++i) {
-    wStringList.emplace_back(GetWideString(functionReader.GetDependency(i)));
+    m_WStringRefs.emplace_back(GetWideString(functionReader.GetDependency(i)));
   }
-  return wStringList.empty() ? nullptr : wStringList.data();
+  return m_WStringRefs.data() + first;
 }
 
 DxilFunctionDesc *
@@ -391,10 +397,10 @@ DxilRuntimeReflection_impl::AddFunction(const FunctionReader &functionReader) {
   function.Name = GetWideString(functionReader.GetName());
   function.UnmangledName = GetWideString(functionReader.GetUnmangledName());
   function.NumResources = functionReader.GetNumResources();
-  function.Resources = GetResourcesForFunction(function, functionReader);
+  function.Resources = GetResourcesForFunction(functionReader);
   function.NumFunctionDependencies = functionReader.GetNumDependencies();
   function.FunctionDependencies =
-      GetDependenciesForFunction(function, functionReader);
+      GetDependenciesForFunction(functionReader);
   function.ShaderKind = (uint32_t)functionReader.GetShaderKind();
   function.PayloadSizeInBytes = functionReader.GetPayloadSizeInBytes();
   function.AttributeSizeInBytes = functionReader.GetAttributeSizeInBytes();
@@ -406,14 +412,17 @@ DxilRuntimeReflection_impl::AddFunction(const FunctionReader &functionReader) {
 }
 
 const wchar_t **DxilRuntimeReflection_impl::GetExportsForAssociation(
-  DxilSubobjectDesc &subobject, const SubobjectReader &subobjectReader) {
-  auto it = m_SubobjectToExportsMap.insert(std::make_pair(&subobject, WStringList()));
-  assert(it.second && "otherwise, collision");
-  WStringList &wStringList = it.first->second;
-  for (uint32_t i = 0; i < subobjectReader.GetSubobjectToExportsAssociation_NumExports(); ++i) {
-    wStringList.emplace_back(GetWideString(subobjectReader.GetSubobjectToExportsAssociation_Export(i)));
+    const SubobjectReader &subobjectReader) {
+  uint32_t numExports = subobjectReader.GetSubobjectToExportsAssociation_NumExports();
+  if (!numExports)
+    return nullptr;
+  assert(m_WStringRefs.size() + numExports <= m_WStringRefs.capacity() &&
+         "Otherwise, number of association exports was incorrect");
+  size_t first = m_WStringRefs.size();
+  for (uint32_t i = 0; i < numExports; ++i) {
+    m_WStringRefs.emplace_back(GetWideString(subobjectReader.GetSubobjectToExportsAssociation_Export(i)));
   }
-  return wStringList.empty() ? nullptr : wStringList.data();
+  return m_WStringRefs.data() + first;
 }
 
 DxilSubobjectDesc *DxilRuntimeReflection_impl::AddSubobject(const SubobjectReader &subobjectReader) {
@@ -438,7 +447,7 @@ DxilSubobjectDesc *DxilRuntimeReflection_impl::AddSubobject(const SubobjectReade
     subobject.SubobjectToExportsAssociation.Subobject =
       GetWideString(subobjectReader.GetSubobjectToExportsAssociation_Subobject());
     subobject.SubobjectToExportsAssociation.NumExports = subobjectReader.GetSubobjectToExportsAssociation_NumExports();
-    subobject.SubobjectToExportsAssociation.Exports = GetExportsForAssociation(subobject, subobjectReader);
+    subobject.SubobjectToExportsAssociation.Exports = GetExportsForAssociation(subobjectReader);
     break;
   case DXIL::SubobjectKind::RaytracingShaderConfig:
     subobject.RaytracingShaderConfig.MaxPayloadSizeInBytes = subobjectReader.GetRaytracingShaderConfig_MaxPayloadSizeInBytes();
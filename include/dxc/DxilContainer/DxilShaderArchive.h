@@ -0,0 +1,147 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderArchive.h                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Packs many DXIL containers into one file that stores each distinct        //
+// part once, and reads containers back out of it.                           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/dxcapi.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace hlsl {
+
+class AbstractMemoryStream;
+
+#pragma pack(push, 1)
+
+static const uint32_t DxilShaderArchiveMagic = 0x52415844; // 'DXAR'
+static const uint32_t DxilShaderArchiveVersion = 1;
+
+#define DXIL_SHADER_ARCHIVE_NOT_FOUND ((uint32_t)-1)
+
+// An archive is laid out as, in order:
+//   DxilShaderArchiveHeader
+//   DxilShaderArchiveContainer[ContainerCount], sorted by NameHash
+//   uint32_t PartRef[PartRefCount], indices into the part table
+//   DxilShaderArchivePart[PartCount]
+//   char Names[NamesSize]
+//   part data, each part starting on a 4-byte boundary
+// All offsets are from the start of the archive.
+struct DxilShaderArchiveHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t ArchiveSizeInBytes;
+  uint32_t ContainerCount;
+  uint32_t PartRefCount;
+  uint32_t PartCount;
+  uint32_t NamesSize;
+};
+
+struct DxilShaderArchiveContainer {
+  uint64_t             NameHash; // xxHash64 of the name.
+  uint32_t             NameOffset;
+  uint32_t             NameLength;
+  uint32_t             FirstPartRef;
+  uint32_t             PartCount;
+  DxilContainerHash    Hash;    // Copied from the original container header.
+  DxilContainerVersion Version; // Copied from the original container header.
+};
+
+struct DxilShaderArchivePart {
+  uint32_t PartFourCC;
+  uint32_t PartSize;
+  uint32_t DataOffset;
+};
+
+#pragma pack(pop)
+
+/// Collects containers and writes them as one archive. Parts that have the
+/// same kind and bytes are stored once, whichever containers they come from.
+class DxilShaderArchiveWriter {
+public:
+  /// Adds a container under a name, which must be unique in the archive. The
+  /// container's bytes must stay alive until Write is called.
+  HRESULT AddContainer(llvm::StringRef Name, _In_ const void *pContainer,
+                       uint32_t ContainerSize);
+  HRESULT Write(_In_ AbstractMemoryStream *pStream) const;
+
+  uint32_t GetContainerCount() const { return (uint32_t)m_Containers.size(); }
+  uint32_t GetUniquePartCount() const { return (uint32_t)m_Parts.size(); }
+  /// Total size of the parts added, and of the distinct parts kept.
+  uint64_t GetPartBytesAdded() const { return m_PartBytesAdded; }
+  uint64_t GetPartBytesStored() const { return m_PartBytesStored; }
+
+private:
+  struct Container {
+    std::string Name;
+    uint64_t NameHash;
+    DxilContainerHash Hash;
+    DxilContainerVersion Version;
+    std::vector<uint32_t> PartRefs;
+  };
+  struct Part {
+    uint32_t FourCC;
+    uint32_t Size;
+    const void *pData;
+  };
+
+  uint32_t AddPart(_In_ const DxilPartHeader *pPart);
+
+  std::vector<Container> m_Containers;
+  std::unordered_set<std::string> m_Names;
+  std::vector<Part> m_Parts;
+  // Content hash to the indices of the parts that have it.
+  std::unordered_multimap<uint64_t, uint32_t> m_PartsByHash;
+  uint64_t m_PartBytesAdded = 0;
+  uint64_t m_PartBytesStored = 0;
+};
+
+/// Reads containers out of an archive. Parts are handed out as blobs that
+/// refer to the archive's bytes; only WriteContainer copies.
+class DxilShaderArchiveReader {
+public:
+  HRESULT Load(_In_ IDxcBlob *pArchive);
+  bool IsLoaded() const { return m_pHeader != nullptr; }
+
+  uint32_t GetContainerCount() const;
+  llvm::StringRef GetContainerName(uint32_t container) const;
+  /// Returns the index of the named container, or
+  /// DXIL_SHADER_ARCHIVE_NOT_FOUND.
+  uint32_t FindContainer(llvm::StringRef Name) const;
+
+  uint32_t GetPartCount(uint32_t container) const;
+  uint32_t GetPartFourCC(uint32_t container, uint32_t part) const;
+  HRESULT GetPartBlob(uint32_t container, uint32_t part,
+                      _COM_Outptr_ IDxcBlob **ppResult) const;
+  /// Rebuilds the container with its original header fields, in the layout
+  /// the container writer produces.
+  HRESULT WriteContainer(uint32_t container,
+                         _In_ AbstractMemoryStream *pStream) const;
+
+private:
+  const DxilShaderArchivePart &GetPart(uint32_t container, uint32_t part) const;
+
+  CComPtr<IDxcBlob> m_pArchive;
+  const DxilShaderArchiveHeader *m_pHeader = nullptr;
+  const DxilShaderArchiveContainer *m_pContainers = nullptr;
+  const uint32_t *m_pPartRefs = nullptr;
+  const DxilShaderArchivePart *m_pParts = nullptr;
+  const char *m_pNames = nullptr;
+};
+
+} // namespace hlsl
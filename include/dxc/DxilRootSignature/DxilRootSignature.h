@@ -382,6 +382,19 @@ bool VerifyRootSignature(_In_ const DxilVersionedRootSignatureDesc *pDesc,
                          _In_ llvm::raw_ostream &DiagStream,
                          _In_ bool bAllowReservedRegisterSpace);
 
+// Like VerifyRootSignatureWithShaderPSV and VerifyRootSignature, but take the
+// serialized root signature. Deserialization and verification of the root
+// signature itself are memoized by its bytes for the life of the process.
+// Throw if the root signature cannot be deserialized.
+bool VerifySerializedRootSignatureWithShaderPSV(
+    _In_reads_bytes_(RootSignatureSize) const void *pRootSignatureData,
+    _In_ uint32_t RootSignatureSize, _In_ DXIL::ShaderKind ShaderKind,
+    _In_reads_bytes_(PSVSize) const void *pPSVData, _In_ uint32_t PSVSize,
+    _In_ llvm::raw_ostream &DiagStream);
+bool VerifySerializedRootSignature(
+    _In_reads_bytes_(RootSignatureSize) const void *pRootSignatureData,
+    _In_ uint32_t RootSignatureSize, _In_ llvm::raw_ostream &DiagStream);
+
 } // namespace hlsl
 
 #endif // __DXC_ROOTSIGNATURE__
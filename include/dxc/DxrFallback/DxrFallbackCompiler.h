@@ -58,6 +58,11 @@ public:
   // 3 - dump intermediate stages of SFT to file
   void setDebugOutputLevel(int val);
 
+  // If true, the scheduler loop only runs the lowest pending state ID in the
+  // wave on each iteration so that lanes waiting on the same state run it
+  // together. Lanes waiting on other states idle until their state is picked.
+  void setBinnedDispatch(bool val);
+
   // Returns the entry state id for each of shaderNames. The transformations 
   // are performed in place on the module.
   void compile(std::vector<int>& shaderEntryStateIds, std::vector<unsigned int> &shaderStackSizes, IntToFuncNameMap *pCachedMap);
@@ -75,6 +80,7 @@ private:
   unsigned m_maxAttributeSize = 0;
   bool m_findCalledShaders = false;
   int m_debugOutputLevel = 0;
+  bool m_binnedDispatch = false;
 
   StringToFuncMap m_shaderMap;
 
@@ -91,6 +97,7 @@ private:
 
   llvm::Type* getRuntimeDataArgType();
   llvm::Function* createDispatchFunction(const IntToFuncMap &stateFunctionMap, llvm::Type* runtimeDataArgTy);
+  llvm::Function* createBinnedDispatchFunction(llvm::Function* dispatchFunc, llvm::Type* runtimeDataArgTy);
 
   // These functions return calls only in shaders in m_shaderMap.
   std::vector<llvm::CallInst*> getCallsInShadersToFunction(const std::string& funcName);
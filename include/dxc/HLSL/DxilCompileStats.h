@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompileStats.h                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Counts the size of the module at the stages of a compile.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Module;
+class ModulePass;
+class raw_ostream;
+}
+
+namespace hlsl {
+
+/// Sizes of the module taken at the stages of a compile, to track where the
+/// IR grows, for instance from unrolling or inlining.
+class DxilCompileStats {
+public:
+  struct Stage {
+    std::string Name;
+    unsigned Functions = 0;   // with a body
+    unsigned BasicBlocks = 0;
+    unsigned Instructions = 0;
+    unsigned MetadataNodes = 0; // distinct nodes reachable from the module
+    /// Calls to DXIL operations, by operation class.
+    std::map<std::string, unsigned> DxilOpClasses;
+  };
+
+  /// Allocations made while a phase or pass ran, not counting those nested
+  /// in it.
+  struct Allocations {
+    std::string Name;
+    bool IsPass = false;
+    uint64_t Count = 0;
+    uint64_t Bytes = 0;
+    uint64_t LivePeakBytes = 0;
+  };
+
+  /// Counts the contents of M as they are now.
+  void Record(llvm::StringRef Name, llvm::Module &M);
+  const std::vector<Stage> &GetStages() const { return m_Stages; }
+
+  void AddAllocations(const Allocations &A) { m_Allocations.push_back(A); }
+  const std::vector<Allocations> &GetAllocations() const {
+    return m_Allocations;
+  }
+
+  /// Writes the stages and allocations as a JSON object, followed by
+  /// PeakMemoryBytes, the most memory the compile had in use, when nonzero.
+  void WriteJson(llvm::raw_ostream &OS, uint64_t PeakMemoryBytes) const;
+
+private:
+  std::vector<Stage> m_Stages;
+  std::vector<Allocations> m_Allocations;
+};
+
+/// Creates a pass that records the module in pStats as stage Name.
+llvm::ModulePass *createDxilRecordCompileStatsPass(DxilCompileStats *pStats,
+                                                   const char *Name);
+
+}
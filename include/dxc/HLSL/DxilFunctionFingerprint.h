@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilFunctionFingerprint.h                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Per-function fingerprints for incremental library compiles.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Module;
+class raw_ostream;
+}
+
+namespace hlsl {
+class DxilModule;
+class HLModule;
+
+/// Fingerprints of the externally visible functions of a library, taken from
+/// the high-level module before it is optimized.
+///
+/// A fingerprint covers the function's signature, body, shader properties
+/// and parameter annotations, the same for every function it calls directly
+/// or indirectly, the globals and resources any of those use, and a context
+/// string that names the compiler and the options it ran with. Functions
+/// with equal fingerprints compile to the same code.
+class DxilFunctionFingerprints {
+public:
+  typedef std::array<uint8_t, 16> Digest;
+  typedef std::map<std::string, Digest> DigestMap;
+
+  void Compute(HLModule &HLM, llvm::StringRef Context);
+  /// Digests every function defined in a DXIL module, internal ones
+  /// included, on the same terms.
+  void Compute(DxilModule &DM, llvm::StringRef Context);
+  const DigestMap &GetDigests() const { return m_Digests; }
+
+  /// Writes the fingerprints in the format Load reads.
+  void Save(llvm::raw_ostream &OS) const;
+  /// Returns false if Data does not hold saved fingerprints.
+  bool Load(llvm::StringRef Data);
+
+private:
+  DigestMap m_Digests;
+};
+
+/// State the compiler shares with the backend for an incremental library
+/// compile.
+class DxilIncrementalLib {
+public:
+  /// Hashed into every fingerprint.
+  std::string Context;
+  /// Fingerprints of the previous library, or null to only fingerprint.
+  std::unique_ptr<DxilFunctionFingerprints> Previous;
+  /// Filled in by Run.
+  DxilFunctionFingerprints Current;
+  /// Names of the functions Run dropped because the previous library has
+  /// them compiled already.
+  std::vector<std::string> Reused;
+
+  /// Fingerprints the functions of HLM and, with previous fingerprints,
+  /// removes the functions whose fingerprints did not change. Reused
+  /// functions still called by recompiled ones are kept for inlining, but
+  /// are no longer exported.
+  void Run(HLModule &HLM);
+};
+
+/// Links the functions reused from Previous, an earlier build of the same
+/// library, with Recompiled, the library compiled from the rest. Errors are
+/// reported through the LLVMContext; returns null on failure.
+std::unique_ptr<llvm::Module>
+LinkReusedFunctions(std::unique_ptr<llvm::Module> Recompiled,
+                    std::unique_ptr<llvm::Module> Previous,
+                    const std::vector<std::string> &Reused,
+                    const std::string &Profile);
+}
@@ -17,9 +17,11 @@ class ModulePass;
 class Function;
 class FunctionPass;
 class Instruction;
+class Value;
 class PassRegistry;
 class StringRef;
 struct PostDominatorTree;
+class DominatorTree;
 }
 
 namespace hlsl {
@@ -32,6 +34,17 @@ public:
   virtual bool IsWaveSensitive(llvm::Instruction *op) = 0;
 };
 
+// Finds the values that are dynamically uniform across the active lanes of a
+// wave.
+class DxilUniformityAnalysis {
+public:
+  static DxilUniformityAnalysis* create(llvm::DominatorTree &DT,
+                                        llvm::PostDominatorTree &PDT);
+  virtual ~DxilUniformityAnalysis() { }
+  virtual void Analyze(llvm::Function *F) = 0;
+  virtual bool IsUniform(llvm::Value *V) = 0;
+};
+
 class HLSLExtensionsCodegenHelper;
 
 // Pause/resume support.
@@ -53,7 +66,7 @@ ModulePass *createHLEmitMetadataPass();
 ModulePass *createHLEnsureMetadataPass();
 ModulePass *createDxilFinalizeModulePass();
 ModulePass *createDxilEmitMetadataPass();
-FunctionPass *createDxilExpandTrigIntrinsicsPass();
+FunctionPass *createDxilExpandTrigIntrinsicsPass(bool Fast = false);
 ModulePass *createDxilConvergentMarkPass();
 ModulePass *createDxilConvergentClearPass();
 ModulePass *createDxilDeadFunctionEliminationPass();
@@ -67,9 +80,18 @@ ModulePass *createDxilLegalizeResources();
 ModulePass *createDxilLegalizeEvalOperationsPass();
 FunctionPass *createDxilLegalizeSampleOffsetPass();
 FunctionPass *createDxilSimpleGVNHoistPass();
+FunctionPass *createDxilCBufferLoadCSEPass();
 ModulePass *createInvalidateUndefResourcesPass();
 FunctionPass *createSimplifyInstPass();
 ModulePass *createDxilTranslateRawBuffer();
+FunctionPass *createDxilCoalesceRawBufferPass();
+FunctionPass *createDxilPair16BitOpsPass();
+ModulePass *createDxilGroupSharedLayoutPass();
+FunctionPass *createDxilHoistHandlesPass();
+FunctionPass *createDxilClusterSamplesPass();
+ModulePass *createDxilMatrixLayoutPass();
+ModulePass *createDxilSpecializeConstantsPass();
+FunctionPass *createDxilRemoveRedundantNonUniformPass();
 ModulePass *createNoPausePassesPass();
 ModulePass *createPausePassesPass();
 ModulePass *createResumePassesPass();
@@ -101,15 +123,25 @@ void initializeDxilLegalizeResourcesPass(llvm::PassRegistry&);
 void initializeDxilLegalizeEvalOperationsPass(llvm::PassRegistry&);
 void initializeDxilLegalizeSampleOffsetPassPass(llvm::PassRegistry&);
 void initializeDxilSimpleGVNHoistPass(llvm::PassRegistry&);
+void initializeDxilCBufferLoadCSEPass(llvm::PassRegistry&);
 void initializeInvalidateUndefResourcesPass(llvm::PassRegistry&);
 void initializeSimplifyInstPass(llvm::PassRegistry&);
 void initializeDxilTranslateRawBufferPass(llvm::PassRegistry&);
+void initializeDxilCoalesceRawBufferPass(llvm::PassRegistry&);
+void initializeDxilPair16BitOpsPass(llvm::PassRegistry&);
+void initializeDxilGroupSharedLayoutPass(llvm::PassRegistry&);
+void initializeDxilHoistHandlesPass(llvm::PassRegistry&);
+void initializeDxilClusterSamplesPass(llvm::PassRegistry&);
+void initializeDxilMatrixLayoutPass(llvm::PassRegistry&);
+void initializeDxilSpecializeConstantsPass(llvm::PassRegistry&);
+void initializeDxilRemoveRedundantNonUniformPass(llvm::PassRegistry&);
 void initializeNoPausePassesPass(llvm::PassRegistry&);
 void initializePausePassesPass(llvm::PassRegistry&);
 void initializeResumePassesPass(llvm::PassRegistry&);
 void initializeMatrixBitcastLowerPassPass(llvm::PassRegistry&);
 void initializeDxilCleanupAddrSpaceCastPass(llvm::PassRegistry&);
 void initializeDxilRenameResourcesPass(llvm::PassRegistry&);
+void initializeResourceUseAnalysisPass(llvm::PassRegistry&);
 
 ModulePass *createDxilValidateWaveSensitivityPass();
 void initializeDxilValidateWaveSensitivityPass(llvm::PassRegistry&);
@@ -11,8 +11,10 @@
 
 #pragma once
 
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringMap.h"
 #include <memory>
@@ -31,6 +33,27 @@ namespace hlsl {
 class DxilModule;
 class DxilResourceBase;
 
+// What each function of a library calls and which globals it uses, found
+// once from the whole library. A linker given the usage when a library is
+// registered skips scanning the bodies of the functions it loads. Names are
+// the ones in the library's bitcode, before a linker prefixes internal
+// symbols, so the usage does not depend on an LLVMContext.
+struct DxilLibraryUsage {
+  struct FunctionUsage {
+    std::vector<std::string> usedFunctions;
+    std::vector<std::string> usedGlobals;
+  };
+  // Keyed by the name of each function the library defines.
+  llvm::StringMap<FunctionUsage> functions;
+  // Initializers of static globals, in llvm.global_ctors order.
+  std::vector<std::string> initFunctions;
+
+  // Fills the usage from a module with every function materialized. Returns
+  // false if an unnamed function or global is used, as names cannot refer to
+  // it.
+  bool Build(llvm::Module &M);
+};
+
 // Linker for DxilModule.
 class DxilLinker {
 public:
@@ -38,10 +61,17 @@ public:
   static DxilLinker *CreateLinker(llvm::LLVMContext &Ctx, unsigned valMajor, unsigned valMinor);
 
   void SetValidatorVersion(unsigned valMajor, unsigned valMinor) { m_valMajor = valMajor, m_valMinor = valMinor; }
+  // Optimizes across libraries at this level after linking; 0 only runs the
+  // cleanup every link needs.
+  void SetLinkTimeOptLevel(unsigned optLevel) { m_ltoOptLevel = optLevel; }
   virtual bool HasLibNameRegistered(llvm::StringRef name) = 0;
   virtual bool RegisterLib(llvm::StringRef name,
                            std::unique_ptr<llvm::Module> pModule,
                            std::unique_ptr<llvm::Module> pDebugModule) = 0;
+  // Registers a library whose usage was found ahead of time.
+  virtual bool RegisterLib(llvm::StringRef name,
+                           std::unique_ptr<llvm::Module> pModule,
+                           const DxilLibraryUsage &usage) = 0;
   virtual bool AttachLib(llvm::StringRef name) = 0;
   virtual bool DetachLib(llvm::StringRef name) = 0;
   virtual void DetachAll() = 0;
@@ -53,6 +83,7 @@ protected:
   DxilLinker(llvm::LLVMContext &Ctx, unsigned valMajor, unsigned valMinor) : m_ctx(Ctx), m_valMajor(valMajor), m_valMinor(valMinor) {}
   llvm::LLVMContext &m_ctx;
   unsigned m_valMajor, m_valMinor;
+  unsigned m_ltoOptLevel = 0;
 };
 
 } // namespace hlsl
@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilParallelFunctionPasses.h                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Runs a function pass pipeline over the functions of a module on several   //
+// threads.                                                                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+
+namespace llvm {
+class ModulePass;
+namespace legacy {
+class PassManagerBase;
+}
+
+/// Adds the function passes to run to a pass manager. It is called once per
+/// worker thread, so it must create new passes on every call.
+typedef std::function<void(legacy::PassManagerBase &)> FunctionPipelineBuilder;
+
+/// \brief Create a pass that runs the function passes added by AddPasses
+/// over every function definition of the module, spread over up to
+/// ThreadCount threads.
+///
+/// Each thread optimizes a partition of the functions in a copy of the module
+/// in its own LLVMContext; the optimized bodies are then moved back into the
+/// module. Modules with debug info, and modules with too few functions to
+/// split, run the pipeline on the calling thread instead.
+ModulePass *createDxilParallelFunctionPassesPass(FunctionPipelineBuilder AddPasses,
+                                                 unsigned ThreadCount);
+}
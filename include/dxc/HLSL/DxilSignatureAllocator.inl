@@ -83,6 +83,29 @@ DxilSignatureAllocator::PackedRegister::PackedRegister()
     Flags[i] = 0;
 }
 
+uint8_t DxilSignatureAllocator::PackedRegister::GetBlockedMask(uint8_t flags) const {
+  flags |= kEFOccupied;
+  uint8_t blocked = 0;
+  for (unsigned i = 0; i < 4; ++i) {
+    if (Flags[i] & flags)
+      blocked |= 1 << i;
+  }
+  return blocked;
+}
+
+// Returns true if the components of freeMask include width adjacent
+// components starting at or after startCol, and sets col to the first one.
+static bool FindFreeComponents(uint8_t freeMask, unsigned width, unsigned startCol, unsigned &col) {
+  uint8_t run = (uint8_t)((1 << width) - 1);
+  for (unsigned i = startCol; i + width <= 4; ++i) {
+    if (((freeMask >> i) & run) == run) {
+      col = i;
+      return true;
+    }
+  }
+  return false;
+}
+
 DxilSignatureAllocator::ConflictType DxilSignatureAllocator::PackedRegister::DetectRowConflict(uint8_t flags, uint8_t indexFlags, DXIL::InterpolationMode interp, unsigned width, DXIL::SignatureDataWidth dataWidth) {
   // indexing already present, and element incompatible with indexing
   if (IndexFlags && (flags & kEFConflictsWithIndexed))
@@ -96,16 +119,8 @@ DxilSignatureAllocator::ConflictType DxilSignatureAllocator::PackedRegister::Det
     return kConflictsWithInterpolationMode;
   if (DataWidth != DXIL::SignatureDataWidth::Undefined && DataWidth != dataWidth)
     return kConflictDataWidth;
-  unsigned freeWidth = 0;
-  for (unsigned i = 0; i < 4; ++i) {
-    if ((Flags[i] & kEFOccupied) || (Flags[i] & flags))
-      freeWidth = 0;
-    else
-      ++freeWidth;
-    if (width <= freeWidth)
-      break;
-  }
-  if (width > freeWidth)
+  unsigned col;
+  if (!FindFreeComponents(~GetBlockedMask(flags) & 0xF, width, 0, col))
     return kInsufficientFreeComponents;
   return kNoConflict;
 }
@@ -238,12 +253,31 @@ unsigned DxilSignatureAllocator::FindNext(
   unsigned cols = SE->GetCols();
   DXASSERT_NOMSG(startCol + cols <= 4);
 
+  // Query the element once instead of for every candidate register, and test
+  // columns on the component masks of all the rows of the element at once.
+  // This finds the same location as DetectRowConflict/DetectColConflict.
+  uint8_t flags = GetElementFlags(SE);
+  DXIL::InterpolationMode interp = SE->GetInterpolationMode();
+  DXIL::SignatureDataWidth dataWidth = SE->GetDataBitWidth();
+
   for (unsigned row = startRow; row <= (startRow + numRows - rows); ++row) {
-    if (DetectRowConflict(SE, row))
+    if (rows + row > m_Registers.size())
+      break;
+    uint8_t freeMask = 0xF;
+    bool bConflict = false;
+    for (unsigned i = 0; i < rows; ++i) {
+      PackedRegister &Reg = m_Registers[row + i];
+      uint8_t indexFlags = m_bIgnoreIndexing ? 0 : GetIndexFlags(i, rows);
+      if (Reg.DetectRowConflict(flags, indexFlags, interp, cols, dataWidth)) {
+        bConflict = true;
+        break;
+      }
+      freeMask &= ~Reg.GetBlockedMask(flags);
+    }
+    if (bConflict)
       continue;
-    for (unsigned col = startCol; col <= 4 - cols; ++col) {
-      if (DetectColConflict(SE, row, col))
-        continue;
+    unsigned col;
+    if (FindFreeComponents(freeMask, cols, startCol, col)) {
       foundRow = row;
       foundCol = col;
       return row + rows;
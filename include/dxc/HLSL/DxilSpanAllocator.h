@@ -14,6 +14,7 @@
 #include "dxc/Support/Global.h"
 #include <set>
 #include <map>
+#include <utility>
 
 namespace hlsl {
 
@@ -52,13 +53,7 @@ public:
       return false;
     if (pos < m_FirstFree)
       pos = m_FirstFree;
-    if (!UpdatePos(pos, size, align))
-      return false;
-    T_index end = pos + (size - 1);
-    auto next = m_Spans.lower_bound(Span(nullptr, pos, end));
-    if (next == m_Spans.end() || end < next->start)
-      return true;  // it fits here
-    return Find(size, next, pos, align);
+    return FindFit(size, pos, align);
   }
 
   // Finds the farthest position at which an element could be allocated.
@@ -80,17 +75,12 @@ public:
     if (m_AllocationFull)
       return false;
     pos = m_FirstFree;
-    if (!UpdatePos(pos, size, align))
+    if (!FindFit(size, pos, align))
       return false;
     auto result = m_Spans.emplace(element, pos, pos + (size - 1));
-    if (result.second) {
+    DXASSERT_NOMSG(result.second);
+    if (result.second)
       AdvanceFirstFree(result.first);
-      return true;
-    }
-    // Collision, find a gap from iterator
-    if (!Find(size, result.first, pos, align))
-      return false;
-    result = m_Spans.emplace(element, pos, pos + (size - 1));
     return result.second;
   }
 
@@ -142,6 +132,55 @@ public:
   }
 
 private:
+  // Spans are only ever added (ForceInsertAndClobber merges, it never frees
+  // space), so once a search has established that no gap of a given size and
+  // alignment starts below some position, that stays true. FitCursor caches
+  // that position per (size, align) so repeated searches for the same kind of
+  // range resume where the last one stopped instead of rescanning all spans.
+  struct FitCursor {
+    FitCursor(T_index pos) : pos(pos), exhausted(false) {}
+    T_index pos;     // no fit starts below pos
+    bool exhausted;  // no fit anywhere
+  };
+  typedef std::map<std::pair<T_index, T_index>, FitCursor> FitCursorMap;
+
+  // Find first gap of size at or after pos, updating pos, and returning true
+  // if successful.
+  bool FindFit(T_index size, T_index &pos, T_index align) {
+    auto key = std::make_pair(size, align);
+    auto it = m_FitCursors.find(key);
+    if (it == m_FitCursors.end())
+      it = m_FitCursors.emplace(key, FitCursor(m_Min)).first;
+    FitCursor &cursor = it->second;
+    if (cursor.exhausted)
+      return false;
+    // Only a search that starts at the cursor proves anything about the
+    // positions below the one it finds.
+    const bool fromCursor = !(cursor.pos < pos);
+    if (fromCursor)
+      pos = cursor.pos;
+    bool found = FindFrom(size, pos, align);
+    if (fromCursor) {
+      if (found)
+        cursor.pos = pos;
+      else
+        cursor.exhausted = true;
+    }
+    return found;
+  }
+
+  // Find size gap starting at pos by walking spans, updating pos, and
+  // returning true if successful
+  bool FindFrom(T_index size, T_index &pos, T_index align) {
+    if (!UpdatePos(pos, size, align))
+      return false;
+    T_index end = pos + (size - 1);
+    auto next = m_Spans.lower_bound(Span(nullptr, pos, end));
+    if (next == m_Spans.end() || end < next->start)
+      return true;  // it fits here
+    return Find(size, next, pos, align);
+  }
+
   // Find size gap starting at iterator, updating pos, and returning true if successful
   bool Find(T_index size, typename SpanSet::const_iterator it, T_index &pos, T_index align = 1) {
     pos = it->end;
@@ -195,6 +234,7 @@ private:
 
 private:
   SpanSet m_Spans;
+  FitCursorMap m_FitCursors;
   T_index m_Min, m_Max, m_FirstFree;
   const T_element *m_Unbounded;
   bool m_AllocationFull;
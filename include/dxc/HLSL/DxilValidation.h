@@ -11,7 +11,12 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
 #include "dxc/Support/Global.h"
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/Support/WinAdapter.h"
@@ -284,8 +289,63 @@ enum class ValidationRule : unsigned {
 
 const char *GetValidationRuleText(ValidationRule value);
 void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor);
+
+// Library functions seen to pass validation, by digests of everything their
+// checks read. Validation given a cache skips the function checks of the
+// library functions in it, and adds those of modules that pass. It lives in
+// memory with whoever validates the same functions many times, such as a
+// linker; a digest read from a container would let the container skip
+// validation.
+class DxilValidationCache {
+public:
+  typedef std::array<uint8_t, 16> Digest;
+
+  bool Contains(const Digest &D) const;
+  void Add(const std::vector<Digest> &Digests);
+
+private:
+  mutable std::mutex m_Mutex;
+  std::set<Digest> m_Passed;
+};
+
+// What a validation found and where it spent its time, for callers that want
+// more than the diagnostic text. Validation given a report appends every rule
+// it sees broken, with where, and the time of each of its phases.
+class DxilValidationReport {
+public:
+  struct Finding {
+    ValidationRule Rule;
+    std::string Object; // Function, global or resource, if any.
+    std::string File;   // Source location, if the module has debug info.
+    unsigned Line = 0;
+    unsigned Column = 0;
+  };
+  struct Phase {
+    const char *Name;
+    double WallSeconds;
+  };
+
+  std::vector<Finding> Findings;
+  std::vector<Phase> Phases;
+
+  // Phases in the order they ran, then rules in the order they first fired,
+  // each with how often and where.
+  void WriteJson(std::string &Json) const;
+};
+
+// ThreadCount > 1 lets library functions be validated on that many threads;
+// the diagnostics come out as they would serially.
 HRESULT ValidateDxilModule(_In_ llvm::Module *pModule,
-                           _In_opt_ llvm::Module *pDebugModule);
+                           _In_opt_ llvm::Module *pDebugModule,
+                           unsigned ThreadCount = 1,
+                           _In_opt_ DxilValidationCache *pCache = nullptr,
+                           _In_opt_ DxilValidationReport *pReport = nullptr);
+
+// The checks of ValidateDxilModule that read only metadata: versions, entry
+// properties, resources and signatures. Function bodies are not looked at,
+// so a lazily loaded module stays unmaterialized.
+HRESULT ValidateDxilModuleMetadata(_In_ llvm::Module *pModule,
+                                   _In_opt_ DxilValidationReport *pReport = nullptr);
 
 // DXIL Container Verification Functions (return false on failure)
 
@@ -313,7 +373,8 @@ struct DxilContainerHeader;
 HRESULT ValidateDxilContainerParts(_In_ llvm::Module *pModule,
                                    _In_opt_ llvm::Module *pDebugModule,
                                    _In_reads_bytes_(ContainerSize) const DxilContainerHeader *pContainer,
-                                   _In_ uint32_t ContainerSize);
+                                   _In_ uint32_t ContainerSize,
+                                   _In_opt_ DxilValidationReport *pReport = nullptr);
 
 // Loads module, validating load, but not module.
 HRESULT ValidateLoadModule(_In_reads_bytes_(ILLength) const char *pIL,
@@ -346,14 +407,24 @@ HRESULT ValidateDxilBitcode(_In_reads_bytes_(ILLength) const char *pIL,
 // Full container validation, including ValidateDxilModule
 HRESULT ValidateDxilContainer(_In_reads_bytes_(ContainerSize) const void *pContainer,
                               _In_ uint32_t ContainerSize,
-                              _In_ llvm::raw_ostream &DiagStream);
+                              _In_ llvm::raw_ostream &DiagStream,
+                              _In_opt_ DxilValidationReport *pReport = nullptr);
+
+// Container validation with ValidateDxilModuleMetadata in place of
+// ValidateDxilModule. The module is loaded lazily; function bodies are read
+// only for the runtime data of a library, which describes them.
+HRESULT ValidateDxilContainerMetadata(_In_reads_bytes_(ContainerSize) const void *pContainer,
+                                      _In_ uint32_t ContainerSize,
+                                      _In_ llvm::raw_ostream &DiagStream,
+                                      _In_opt_ DxilValidationReport *pReport = nullptr);
 
 // Full container validation, including ValidateDxilModule, with debug module
 HRESULT ValidateDxilContainer(_In_reads_bytes_(ContainerSize) const void *pContainer,
                               _In_ uint32_t ContainerSize,
                               const void *pOptDebugBitcode,
                               uint32_t OptDebugBitcodeSize,
-                              _In_ llvm::raw_ostream &DiagStream);
+                              _In_ llvm::raw_ostream &DiagStream,
+                              _In_opt_ DxilValidationReport *pReport = nullptr);
 
 class PrintDiagnosticContext {
 private:
@@ -17,7 +17,9 @@ class PassRegistry;
 
 /// \brief Create and return a pass that lower high level matrix.
 /// Note that this pass is designed for use with the legacy pass manager.
-ModulePass *createHLMatrixLowerPass();
+/// With UseDotProducts, float matrix multiplies with 2 to 4 terms per result
+/// element are lowered to dot products instead of mul and mad chains.
+ModulePass *createHLMatrixLowerPass(bool UseDotProducts = false);
 void initializeHLMatrixLowerPassPass(llvm::PassRegistry&);
 
 }
@@ -22,6 +22,8 @@
 #include "dxc/DXIL/DxilFunctionProps.h"
 #include "dxc/DXIL/DxilSubobject.h"
 #include "dxc/DXIL/DxilResourceProperties.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -72,7 +74,7 @@ struct HLOptions {
   unsigned unused                  : 20;
 };
 
-typedef std::unordered_map<const llvm::Function *, std::unique_ptr<DxilFunctionProps>> DxilFunctionPropsMap;
+typedef llvm::DenseMap<const llvm::Function *, std::unique_ptr<DxilFunctionProps>> DxilFunctionPropsMap;
 
 /// Use this class to manipulate HLDXIR of a shader.
 class HLModule {
@@ -100,6 +102,13 @@ public:
   void SetAutoBindingSpace(uint32_t Space);
   uint32_t GetAutoBindingSpace() const;
 
+  // Semantics read by the next pipeline stage, as name with index, when
+  // known. Outputs the next stage doesn't read may be removed.
+  void SetDownstreamInputs(const std::vector<std::string> &Inputs);
+  bool HasDownstreamInputs() const;
+  bool IsReadDownstream(llvm::StringRef SemanticName,
+                        unsigned SemanticIndex) const;
+
   // Entry function.
   llvm::Function *GetEntryFunction() const;
   void SetEntryFunction(llvm::Function *pEntryFunc);
@@ -271,8 +280,8 @@ private:
   std::vector<llvm::GlobalVariable*>  m_TGSMVariables;
 
   // High level function info.
-  std::unordered_map<const llvm::Function *, std::unique_ptr<DxilFunctionProps>>  m_DxilFunctionPropsMap;
-  std::unordered_set<llvm::Function *>  m_PatchConstantFunctions;
+  DxilFunctionPropsMap  m_DxilFunctionPropsMap;
+  llvm::SmallPtrSet<llvm::Function *, 4>  m_PatchConstantFunctions;
 
   // Resource bindings for res in cb.
   // Key = CbID << 32 | ConstantIdx. Val is reg binding.
@@ -297,6 +306,8 @@ private:
   std::unique_ptr<OP> m_pOP;
   size_t m_pUnused;
   uint32_t m_AutoBindingSpace;
+  bool m_bHasDownstreamInputs;
+  std::unordered_set<std::string> m_DownstreamInputs;
   DXIL::DefaultLinkage m_DefaultLinkage;
   std::unique_ptr<DxilSubobjects> m_pSubobjects;
 
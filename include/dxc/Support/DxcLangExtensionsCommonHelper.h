@@ -14,6 +14,8 @@
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/dxcapi.internal.h"
+#include "llvm/ADT/StringRef.h"
+#include <map>
 #include <vector>
 
 namespace llvm {
@@ -24,17 +26,101 @@ class Value;
 
 namespace hlsl {
 
+// Matches names against a set of star patterns, as IsStarMatchUTF8 does: a
+// pattern ending in '*' matches the names that start with the rest of it, and
+// any other pattern matches only its own name. The patterns are kept in a
+// trie, so a lookup walks the name once however many patterns there are.
+class StarPatternTrie {
+public:
+  // The patterns that matched a name, and the first of them in insertion
+  // order.
+  struct MatchResult {
+    unsigned Count = 0;
+    unsigned FirstIndex = 0;
+    size_t FirstPatternLength = 0;
+  };
+
+  void Insert(llvm::StringRef pattern) {
+    if (m_nodes.empty())
+      m_nodes.emplace_back();
+    bool isPrefix = !pattern.empty() && pattern.back() == '*';
+    if (isPrefix)
+      pattern = pattern.drop_back();
+    unsigned node = 0;
+    for (char c : pattern) {
+      auto it = m_nodes[node].Children.find(c);
+      if (it == m_nodes[node].Children.end()) {
+        unsigned child = m_nodes.size();
+        m_nodes[node].Children[c] = child;
+        m_nodes.emplace_back();
+        node = child;
+      } else {
+        node = it->second;
+      }
+    }
+    Node &N = m_nodes[node];
+    (isPrefix ? N.PrefixPatterns : N.ExactPatterns)
+        .push_back({m_patternCount++, pattern.size() + (isPrefix ? 1 : 0)});
+  }
+
+  MatchResult Match(llvm::StringRef name) const {
+    MatchResult result;
+    if (m_nodes.empty())
+      return result;
+    auto Add = [&result](const llvm::SmallVectorImpl<Pattern> &patterns) {
+      for (const Pattern &P : patterns) {
+        if (result.Count++ == 0 || P.Index < result.FirstIndex) {
+          result.FirstIndex = P.Index;
+          result.FirstPatternLength = P.Length;
+        }
+      }
+    };
+    unsigned node = 0;
+    for (size_t i = 0;; ++i) {
+      const Node &N = m_nodes[node];
+      // An empty name matches only an empty pattern, not a bare '*'.
+      if (!name.empty())
+        Add(N.PrefixPatterns);
+      if (i == name.size()) {
+        Add(N.ExactPatterns);
+        break;
+      }
+      auto it = N.Children.find(name[i]);
+      if (it == N.Children.end())
+        break;
+      node = it->second;
+    }
+    return result;
+  }
+
+private:
+  struct Pattern {
+    unsigned Index;
+    size_t Length;
+  };
+  struct Node {
+    std::map<char, unsigned> Children;
+    llvm::SmallVector<Pattern, 1> PrefixPatterns;
+    llvm::SmallVector<Pattern, 1> ExactPatterns;
+  };
+  std::vector<Node> m_nodes;
+  unsigned m_patternCount = 0;
+};
+
 class DxcLangExtensionsCommonHelper {
 private:
   llvm::SmallVector<std::string, 2> m_semanticDefines;
   llvm::SmallVector<std::string, 2> m_semanticDefineExclusions;
+  StarPatternTrie m_semanticDefineTrie;
+  StarPatternTrie m_semanticDefineExclusionTrie;
   llvm::SetVector<std::string> m_nonOptSemanticDefines;
   llvm::SmallVector<std::string, 2> m_defines;
   llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2> m_intrinsicTables;
   CComPtr<IDxcSemanticDefineValidator> m_semanticDefineValidator;
   std::string m_semanticDefineMetaDataName;
   std::string m_targetTriple;
-  HRESULT STDMETHODCALLTYPE RegisterIntoVector(LPCWSTR name, llvm::SmallVector<std::string, 2>& here)
+  HRESULT STDMETHODCALLTYPE RegisterIntoVector(LPCWSTR name, llvm::SmallVector<std::string, 2>& here,
+                                               StarPatternTrie *pTrie = nullptr)
   {
     try {
       IFTPTR(name);
@@ -43,6 +129,8 @@ private:
         throw ::hlsl::Exception(E_INVALIDARG);
       }
       here.push_back(s);
+      if (pTrie)
+        pTrie->Insert(s);
       return S_OK;
     }
     CATCH_CPP_RETURN_HRESULT();
@@ -66,6 +154,13 @@ public:
   const llvm::SmallVector<std::string, 2>& GetSemanticDefines() const { return m_semanticDefines; }
   const llvm::SmallVector<std::string, 2>& GetSemanticDefineExclusions() const { return m_semanticDefineExclusions; }
   const llvm::SetVector<std::string>& GetNonOptSemanticDefines() const { return m_nonOptSemanticDefines; }
+  const StarPatternTrie &GetSemanticDefinePatterns() const { return m_semanticDefineTrie; }
+  // The semantic define patterns that match name, unless an exclusion does.
+  StarPatternTrie::MatchResult MatchSemanticDefine(llvm::StringRef name) const {
+    if (m_semanticDefineExclusionTrie.Match(name).Count)
+      return StarPatternTrie::MatchResult();
+    return m_semanticDefineTrie.Match(name);
+  }
   const llvm::SmallVector<std::string, 2>& GetDefines() const { return m_defines; }
   llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2>& GetIntrinsicTables(){ return m_intrinsicTables; }
   const std::string &GetSemanticDefineMetadataName() { return m_semanticDefineMetaDataName; }
@@ -73,12 +168,12 @@ public:
 
   HRESULT STDMETHODCALLTYPE RegisterSemanticDefine(LPCWSTR name)
   {
-    return RegisterIntoVector(name, m_semanticDefines);
+    return RegisterIntoVector(name, m_semanticDefines, &m_semanticDefineTrie);
   }
 
   HRESULT STDMETHODCALLTYPE RegisterSemanticDefineExclusion(LPCWSTR name)
   {
-    return RegisterIntoVector(name, m_semanticDefineExclusions);
+    return RegisterIntoVector(name, m_semanticDefineExclusions, &m_semanticDefineExclusionTrie);
   }
 
   HRESULT STDMETHODCALLTYPE RegisterNonOptSemanticDefine(LPCWSTR name)
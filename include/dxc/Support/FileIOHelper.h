@@ -161,6 +161,15 @@ DxcCreateBlobFromFile(_In_opt_ IMalloc *pMalloc, LPCWSTR pFileName,
 HRESULT DxcCreateBlobFromFile(LPCWSTR pFileName, _In_opt_ UINT32 *pCodePage,
                               _COM_Outptr_ IDxcBlobEncoding **ppBlobEncoding) throw();
 
+// Like DxcCreateBlobFromFile, but large files are memory-mapped rather than
+// read. UTF-8 and ASCII text is returned as a null-terminated IDxcBlobUtf8 over
+// the mapped pages where possible. The file should not be modified while the
+// blob is alive.
+HRESULT
+DxcCreateBlobFromFileMapping(_In_opt_ IMalloc *pMalloc, LPCWSTR pFileName,
+                             _In_opt_ UINT32 *pCodePage,
+                             _COM_Outptr_ IDxcBlobEncoding **ppBlobEncoding) throw();
+
 // Given a blob, creates a subrange view.
 HRESULT DxcCreateBlobFromBlob(_In_ IDxcBlob *pBlob, UINT32 offset,
                               UINT32 length,
@@ -238,6 +247,18 @@ public:
 HRESULT CreateMemoryStream(_In_ IMalloc *pMalloc, _COM_Outptr_ AbstractMemoryStream** ppResult) throw();
 HRESULT CreateReadOnlyBlobStream(_In_ IDxcBlob *pSource, _COM_Outptr_ IStream** ppResult) throw();
 HRESULT CreateFixedSizeMemoryStream(_In_ LPBYTE pBuffer, size_t size, _COM_Outptr_ AbstractMemoryStream** ppResult) throw();
+// Writes all of pSource to pDest, leaving the position of pSource as it was.
+// A memory stream that holds a large output in chunks writes them one at a
+// time rather than joining them first.
+HRESULT CopyMemoryStreamTo(_In_ AbstractMemoryStream *pSource, _In_ IStream *pDest) throw();
+// Hands the contents of pSource over to a new blob without copying them,
+// leaving the stream empty. UTF-8 and UTF-16 text is null-terminated first,
+// so an IDxcBlobUtf8 or IDxcBlobUtf16 is created. pSource must come from
+// CreateMemoryStream on pMalloc, which frees the contents with the blob.
+HRESULT DxcCreateBlobFromMemoryStream(
+    _In_ AbstractMemoryStream *pSource, _In_ IMalloc *pMalloc,
+    bool encodingKnown, UINT32 codePage,
+    _COM_Outptr_ IDxcBlobEncoding **ppBlobEncoding) throw();
 
 template <typename T>
 HRESULT WriteStreamValue(IStream *pStream, const T& value) {
@@ -74,6 +74,124 @@ private:
   IMalloc *pPrior;
 };
 
+// Frees memory obtained through the thread allocator, eg by operator new.
+// Unlike DxcGetThreadMallocNoRef()->Free, this also accepts blocks carved out
+// by a DxcThreadArena that is no longer installed.
+void DxcThreadFree(void *p) throw();
+
+// Installs a per-invocation arena over the current thread allocator when
+// enabled. Allocations are bump-allocated from large chunks and frees are
+// nearly free; chunks go back to the prior allocator in one step when the
+// arena is released. A chunk that still holds live blocks at that point is
+// kept until they are freed, so memory that escapes the invocation stays
+// valid.
+class DxcThreadArena {
+public:
+  explicit DxcThreadArena(bool enable) throw();
+  ~DxcThreadArena();
+
+  // The arena allocator, or nullptr when not enabled.
+  IMalloc *GetArena() const { return pArena; }
+
+  // True if p points into memory carved out by this arena.
+  bool Owns(const void *p) const throw();
+
+  // Restores the prior allocator and releases unused chunks.
+  void Release() throw();
+
+private:
+  DxcThreadArena(const DxcThreadArena &) = delete;
+  DxcThreadArena &operator =(const DxcThreadArena &) = delete;
+
+  IMalloc *pArena;
+  IMalloc *pPrior;
+  IMalloc *pPriorArena;
+};
+
+// Limits the memory live at once through the current thread allocator.
+// Once installed, an allocation that would take the live bytes over the
+// limit fails, which operator new turns into std::bad_alloc. Blocks are
+// measured with IMalloc::GetSize, so where that is not available (non-Windows
+// builds using a custom allocator) usage is not tracked.
+class DxcThreadMemoryBudget {
+public:
+  DxcThreadMemoryBudget() throw();
+  ~DxcThreadMemoryBudget();
+
+  // Installs the budget over the current thread allocator; a limit of 0 only
+  // tracks usage. Must be released before the prior allocator is restored.
+  void Install(uint64_t limitBytes) throw();
+
+  // The budget allocator, or nullptr when not installed.
+  IMalloc *GetBudget() const { return pBudget; }
+
+  // True once an allocation failed because of the limit.
+  bool Exceeded() const throw();
+
+  // Highest number of bytes live at once since the budget was installed.
+  uint64_t GetPeakBytes() const throw();
+
+  // The limit the budget was installed with, or 0.
+  uint64_t GetLimitBytes() const { return limitBytes; }
+
+  // Restores the prior allocator. Blocks allocated under the budget may be
+  // freed at any later time.
+  void Release() throw();
+
+private:
+  DxcThreadMemoryBudget(const DxcThreadMemoryBudget &) = delete;
+  DxcThreadMemoryBudget &operator =(const DxcThreadMemoryBudget &) = delete;
+
+  IMalloc *pBudget;
+  IMalloc *pPrior;
+  bool exceeded;
+  uint64_t peakBytes;
+  uint64_t limitBytes;
+};
+
+// Counts the allocations made through the current thread allocator by tag,
+// such as the compile phase running when each was made. Bytes live at once
+// are tracked where block sizes are known, as for DxcThreadMemoryBudget; the
+// live peak of a tag is the most bytes live at an allocation made under it.
+class DxcThreadAllocProfile {
+public:
+  static const unsigned kMaxTags = 256;
+
+  struct Counters {
+    uint64_t Allocations = 0; // including reallocations
+    uint64_t Bytes = 0;       // requested
+    uint64_t LivePeakBytes = 0;
+  };
+
+  DxcThreadAllocProfile() throw();
+  ~DxcThreadAllocProfile();
+
+  // Installs the profile over the current thread allocator, counting under
+  // tag 0. Must be released before the prior allocator is restored.
+  void Install() throw();
+
+  // The profile allocator, or nullptr when not installed.
+  IMalloc *GetProfile() const { return pProfile; }
+
+  // Counts the allocations made from now on under tag, and returns the tag
+  // they were counted under before. Tags past kMaxTags are ignored.
+  unsigned SetTag(unsigned tag) throw();
+
+  // The counts of tag so far, while installed.
+  Counters GetCounters(unsigned tag) const throw();
+
+  // Restores the prior allocator. Blocks allocated under the profile may be
+  // freed at any later time.
+  void Release() throw();
+
+private:
+  DxcThreadAllocProfile(const DxcThreadAllocProfile &) = delete;
+  DxcThreadAllocProfile &operator =(const DxcThreadAllocProfile &) = delete;
+
+  IMalloc *pProfile;
+  IMalloc *pPrior;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // Error handling support.
 void CheckLLVMErrorCode(const std::error_code &ec);
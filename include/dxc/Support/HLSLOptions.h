@@ -120,7 +120,17 @@ public:
   llvm::StringRef OutputReflectionFile; // OPT_Fre
   llvm::StringRef OutputRootSigFile; // OPT_Frs
   llvm::StringRef OutputShaderHashFile; // OPT_Fsh
+  llvm::StringRef OutputTimeReportFile; // OPT_Ftr
+  llvm::StringRef OutputCompileStatsFile; // OPT_Fst
+  llvm::StringRef OutputLineStatsFile; // OPT_Fls
+  llvm::StringRef OutputFingerprintsFile; // OPT_Ffp
+  llvm::StringRef OutputDependenciesFile; // OPT_MF
+  llvm::StringRef JobsFile; // OPT_jobs
+  llvm::StringRef ManifestFile; // OPT_manifest
+  llvm::StringRef ReuseLibFile; // OPT_reuse_lib
+  llvm::StringRef ReuseLibFingerprintsFile; // OPT_reuse_lib_fingerprints
   llvm::StringRef Preprocess; // OPT_P
+  llvm::StringRef IncludePTH; // OPT_include_pth
   llvm::StringRef TargetProfile; // OPT_target_profile
   llvm::StringRef VariableName; // OPT_Vn
   llvm::StringRef PrivateSource; // OPT_setprivate
@@ -130,7 +140,17 @@ public:
   llvm::StringRef FloatDenormalMode; // OPT_denorm
   std::vector<std::string> Exports; // OPT_exports
   std::vector<std::string> PreciseOutputs; // OPT_precise_output
+  std::vector<std::string> DownstreamInputs; // OPT_downstream_input
+  llvm::StringRef DownstreamShader; // OPT_downstream_shader
   llvm::StringRef DefaultLinkage; // OPT_default_linkage
+  llvm::StringRef CompileCacheDir; // OPT_compile_cache
+  bool CompileArena = false; // OPT_compile_arena
+  bool ReuseContext = false; // OPT_reuse_context
+  bool MemoryStatistics = false; // OPT_memory_limit
+  unsigned MemoryLimitMB = 0; // OPT_memory_limit
+  bool TimeReport = false; // OPT_ftime_report
+  bool CompileStats = false; // OPT_fcompile_stats
+  bool LineStats = false; // OPT_fline_stats
   unsigned DefaultTextCodePage = DXC_CP_UTF8; // OPT_encoding
 
   bool AllResourcesBound = false; // OPT_all_resources_bound
@@ -138,11 +158,17 @@ public:
   bool AstDump = false; // OPT_ast_dump
   bool ColorCodeAssembly = false; // OPT_Cc
   bool CodeGenHighLevel = false; // OPT_fcgl
+  bool SyntaxOnly = false; // OPT_fsyntax_only
   bool AllowPreserveValues = false; // OPT_preserve_intermediate_values
   bool DebugInfo = false; // OPT__SLASH_Zi
   bool DebugNameForBinary = false; // OPT_Zsb
   bool DebugNameForSource = false; // OPT_Zss
   bool DumpBin = false;        // OPT_dumpbin
+  bool EmitPTH = false;        // OPT_emit_pth
+  bool EmitHLModule = false;   // OPT_emit_hl_module
+  bool FromHLModule = false;   // OPT_from_hl_module
+  bool EmitDependencies = false; // OPT_M
+  bool Serve = false; // OPT_serve
   bool Link = false;        // OPT_link
   bool WarningAsError = false; // OPT__SLASH_WX
   bool IEEEStrict = false;     // OPT_Gis
@@ -164,6 +190,7 @@ public:
   bool ShowHelp = false;  // OPT_help
   bool ShowHelpHidden = false; // OPT__help_hidden
   bool ShowOptionNames = false; // OPT_fdiagnostics_show_option
+  unsigned ErrorLimit = 0; // OPT_ferror_limit_EQ
   bool UseColor = false; // OPT_Cc
   bool UseHexLiterals = false; // OPT_Lx
   bool UseInstructionByteOffsets = false; // OPT_No
@@ -175,10 +202,12 @@ public:
   bool RecompileFromBinary = false; // OPT _Recompile (Recompiling the DXBC binary file not .hlsl file)
   bool StripDebug = false; // OPT Qstrip_debug
   bool EmbedDebug = false; // OPT Qembed_debug
+  bool DebugLinesOnly = false; // OPT Qdebug_lines
   bool SourceInDebugModule = false; // OPT Zs
   bool SourceOnlyDebug = false; // OPT Qsource_only_debug
   bool PdbInPrivate = false; // OPT Qpdb_in_private
   bool StripRootSignature = false; // OPT_Qstrip_rootsignature
+  bool CompressLibraryBitcode = false; // OPT_Qcompress_bitcode
   bool StripPrivate = false; // OPT_Qstrip_priv
   bool StripReflection = false; // OPT_Qstrip_reflect
   bool KeepReflectionInDxil = false; // OPT_Qkeep_reflect_in_dxil
@@ -192,9 +221,15 @@ public:
   bool LegacyResourceReservation = false; // OPT_flegacy_resource_reservation
   unsigned long AutoBindingSpace = UINT_MAX; // OPT_auto_binding_space
   bool ExportShadersOnly = false; // OPT_export_shaders_only
+  unsigned LibInlineThreshold = 0; // OPT_lib_inline_threshold
+  bool LinkTimeOptimization = false; // OPT_flto
   bool ResMayAlias = false; // OPT_res_may_alias
   unsigned long ValVerMajor = UINT_MAX, ValVerMinor = UINT_MAX; // OPT_validator_version
   unsigned ScanLimit = 0; // OPT_memdep_block_scan_limit
+  unsigned ParallelFunctionThreads = 1; // OPT_opt_parallel_functions
+  unsigned UnrollBudget = 0; // OPT_unroll_budget
+  unsigned JobsThreads = 0; // OPT_jobs_threads
+  unsigned VerifyDeterminism = 0; // OPT_verify_determinism
   bool ForceZeroStoreLifetimes = false; // OPT_force_zero_store_lifetimes
   bool EnableLifetimeMarkers = false; // OPT_enable_lifetime_markers
 
@@ -208,6 +243,7 @@ public:
   bool PrintAfterAll; // OPT_print_after_all
   bool EnablePayloadQualifiers = false; // OPT_enable_payload_qualifiers
   bool HandleExceptions = false; // OPT_disable_exception_handling
+  bool SpecConstants = false; // OPT_spec_constants
 
   // Rewriter Options
   RewriterOpts RWOpt;
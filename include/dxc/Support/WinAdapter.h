@@ -207,6 +207,10 @@
 #define DxcEtw_DXCompilerPreprocess_Stop(hr)
 #define DxcEtw_DxcValidation_Start()
 #define DxcEtw_DxcValidation_Stop(hr)
+#define DxcEtw_DXCompilerPhase_Start(name, entryPoint, shaderHash)
+#define DxcEtw_DXCompilerPhase_Stop(name, entryPoint, shaderHash)
+#define DxcEtw_DXCompilerPass_Start(name, entryPoint, shaderHash)
+#define DxcEtw_DXCompilerPass_Stop(name, entryPoint, shaderHash)
 
 #define UInt32Add UIntAdd
 #define Int32ToUInt32 IntToUInt
@@ -268,6 +272,7 @@
 #define _Outptr_opt_result_z_
 #define _Out_opt_
 #define _Out_writes_(size)
+#define _Out_writes_opt_(size)
 #define _Out_write_bytes_(size)
 #define _Out_writes_z_(size)
 #define _Out_writes_all_(size)
@@ -13,6 +13,7 @@
 #define __DXCAPI_IMPL__
 
 #include "dxc/dxcapi.h"
+#include "dxc/Support/Global.h"
 #include "dxc/Support/microcom.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -33,6 +34,33 @@ public:
   }
 };
 
+// Adaptor for a caller's IStream, which need not be seekable. Writes are
+// buffered, and a failed write throws.
+class raw_istream_ostream : public llvm::raw_ostream {
+private:
+  CComPtr<IStream> m_pStream;
+  uint64_t m_Pos = 0;
+  void write_impl(const char *Ptr, size_t Size) override {
+    ULONG cbWritten;
+    IFT(m_pStream->Write(Ptr, (ULONG)Size, &cbWritten));
+    IFTBOOL(cbWritten == Size, E_FAIL);
+    m_Pos += Size;
+  }
+  uint64_t current_pos() const override { return m_Pos; }
+public:
+  raw_istream_ostream(IStream *pStream) : m_pStream(pStream) {
+    SetBufferSize(64 * 1024);
+  }
+  // Callers should flush before this runs; a stream that already failed may
+  // be destroyed while an exception unwinds, so a failure here is dropped.
+  ~raw_istream_ostream() override {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+};
+
 namespace {
 HRESULT TranslateUtf8StringForOutput(
     _In_opt_count_(size) LPCSTR pStr, SIZE_T size, UINT32 codePage, IDxcBlobEncoding **ppBlobEncoding) {
@@ -74,6 +102,28 @@ HRESULT TranslateStringBlobForOutput(IDxcBlob *pBlob, UINT32 codePage, IDxcBlobE
   }
   return E_INVALIDARG;
 }
+
+// If pUnknown is a blob whose object or contents live in the arena, creates
+// a copy of it on pTo. Otherwise leaves *ppCopy null.
+HRESULT CopyBlobOffArena(IUnknown *pUnknown, const DxcThreadArena &arena,
+                         IMalloc *pTo, IDxcBlob **ppCopy) {
+  *ppCopy = nullptr;
+  CComPtr<IDxcBlob> pBlob;
+  if (FAILED(pUnknown->QueryInterface(&pBlob)))
+    return S_OK;
+  if (!arena.Owns(pBlob.p) && !arena.Owns(pBlob->GetBufferPointer()))
+    return S_OK;
+  BOOL known = FALSE;
+  UINT32 codePage = DXC_CP_ACP;
+  CComPtr<IDxcBlobEncoding> pEncoding;
+  if (SUCCEEDED(pBlob.QueryInterface(&pEncoding)))
+    IFR(pEncoding->GetEncoding(&known, &codePage));
+  CComPtr<IDxcBlobEncoding> pCopy;
+  IFR(hlsl::DxcCreateBlob(pBlob->GetBufferPointer(), pBlob->GetBufferSize(),
+                          false, true, known != FALSE, codePage, pTo, &pCopy));
+  *ppCopy = pCopy.Detach();
+  return S_OK;
+}
 }
 
 typedef enum DxcOutputType {
@@ -91,18 +141,25 @@ inline DxcOutputType DxcGetOutputType(DXC_OUT_KIND kind) {
   case DXC_OUT_SHADER_HASH:
   case DXC_OUT_REFLECTION:
   case DXC_OUT_ROOT_SIGNATURE:
+  case DXC_OUT_FUNCTION_FINGERPRINTS:
+  case DXC_OUT_MEMORY_STATISTICS:
     return DxcOutputType_Blob;
   case DXC_OUT_ERRORS:
   case DXC_OUT_DISASSEMBLY:
   case DXC_OUT_HLSL:
   case DXC_OUT_TEXT:
+  case DXC_OUT_TIME_REPORT:
+  case DXC_OUT_DEPENDENCIES:
+  case DXC_OUT_VALIDATION_REPORT:
+  case DXC_OUT_STATS:
+  case DXC_OUT_LINE_STATS:
     return DxcOutputType_Text;
   }
   return DxcOutputType_None;
 }
 
 // Update when new results are allowed
-static const unsigned kNumDxcOutputTypes = DXC_OUT_EXTRA_OUTPUTS;
+static const unsigned kNumDxcOutputTypes = DXC_OUT_LINE_STATS;
 static const SIZE_T kAutoSize = (SIZE_T)-1;
 static const LPCWSTR DxcOutNoName = nullptr;
 
@@ -122,6 +179,15 @@ struct DxcOutputObject {
     if (codePage && DxcGetOutputType(kind) == DxcOutputType_Text) {
       CComPtr<IDxcBlob> pBlob;
       IFR(pUnknown->QueryInterface(&pBlob));
+      // Text already null-terminated in the requested encoding, such as a
+      // blob handed over from a memory stream, is kept rather than copied.
+      CComPtr<IDxcBlobUtf8> pUtf8;
+      CComPtr<IDxcBlobUtf16> pUtf16;
+      if ((codePage == DXC_CP_UTF8 && SUCCEEDED(pBlob.QueryInterface(&pUtf8))) ||
+          (codePage == DXC_CP_UTF16 && SUCCEEDED(pBlob.QueryInterface(&pUtf16)))) {
+        object = pUnknown;
+        return S_OK;
+      }
       CComPtr<IDxcBlobEncoding> pEncoding;
       // If not blob encoding, assume utf-8 text
       if (FAILED(TranslateStringBlobForOutput(pBlob, codePage, &pEncoding)))
@@ -585,6 +651,30 @@ public:
     return S_OK;
   }
 
+  // Replaces outputs and names that live in the arena with copies on pTo, so
+  // the result does not keep arena chunks alive.
+  HRESULT CopyOutputsOffArena(const DxcThreadArena &arena, IMalloc *pTo) {
+    for (unsigned i = 0; i < kNumDxcOutputTypes; i++) {
+      DxcOutputObject &output = m_outputs[i];
+      CComPtr<IDxcBlob> pCopy;
+      if (output.object) {
+        IFR(CopyBlobOffArena(output.object, arena, pTo, &pCopy));
+        if (pCopy)
+          output.object = pCopy;
+        pCopy.Release();
+      }
+      if (output.name) {
+        IFR(CopyBlobOffArena(output.name, arena, pTo, &pCopy));
+        if (pCopy) {
+          CComPtr<IDxcBlobUtf16> pName;
+          IFR(pCopy.QueryInterface(&pName));
+          output.name = pName;
+        }
+      }
+    }
+    return S_OK;
+  }
+
   // All-in-one initialization
   HRESULT Init(_In_ HRESULT status, _In_ DXC_OUT_KIND resultType,
                const llvm::ArrayRef<DxcOutputObject> outputs) {
@@ -13,6 +13,8 @@
 #define __DXCAPI_USE_H__
 
 #include "dxc/dxcapi.h"
+#include <string>
+#include <vector>
 
 namespace dxc {
 
@@ -177,6 +179,32 @@ void WriteOperationErrorsToConsole(_In_ IDxcOperationResult *pResult,
 void WriteOperationResultToConsole(_In_ IDxcOperationResult *pRewriteResult,
                                    bool outputWarnings);
 
+// While alive, holds back what the console helpers above write from the
+// current thread, so that work running on several threads at once can print
+// each unit's output together. Captures nest.
+class DxcConsoleCapture {
+public:
+  DxcConsoleCapture();
+  ~DxcConsoleCapture();
+
+  // Writes what was captured to the console in order, without interleaving
+  // with other captures being flushed, and clears the capture.
+  void Flush();
+
+  void Write(const std::string &text, DWORD streamType);
+
+private:
+  DxcConsoleCapture(const DxcConsoleCapture &) = delete;
+  DxcConsoleCapture &operator=(const DxcConsoleCapture &) = delete;
+
+  struct Chunk {
+    DWORD StreamType;
+    std::string Text;
+  };
+  std::vector<Chunk> m_chunks;
+  DxcConsoleCapture *m_pPrevious;
+};
+
 } // namespace dxc
 
 #endif
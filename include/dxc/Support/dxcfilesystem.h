@@ -41,6 +41,10 @@ public:
   virtual void EnableDisplayIncludeProcess() = 0;
   virtual HRESULT CreateStdStreams(_In_ IMalloc *pMalloc) = 0;
   virtual HRESULT RegisterOutputStream(LPCWSTR pName, IStream *pStream) = 0;
+  // Files loaded through the include handler, not counting the main source.
+  virtual unsigned GetIncludedFileCount() = 0;
+  virtual void GetIncludedFile(unsigned index, LPCWSTR *ppName,
+                               IDxcBlobUtf8 **ppBlob) = 0;
 };
 
 DxcArgsFileSystem *
@@ -113,6 +113,7 @@ public:
   std::string Arguments;    // Arguments to command
   LPCWSTR CommandFileName;  // File name replacement for %s
   FileMap *pVFS = nullptr;  // Files in virtual file system
+  IDxcCompiler *pCachedCompiler = nullptr; // Compiler to reuse, if any
 
 private:
   FileRunCommandResult RunFileChecker(const FileRunCommandResult *Prior, LPCWSTR dumpName = nullptr);
@@ -128,6 +129,7 @@ private:
   FileRunCommandResult RunDxcHashTest(dxc::DxcDllSupport &DllSupport);
   FileRunCommandResult RunFromPath(const std::string &path, const FileRunCommandResult *Prior);
   FileRunCommandResult RunFileCompareText(const FileRunCommandResult *Prior);
+  void GetCompiler(dxc::DxcDllSupport &DllSupport, IDxcCompiler **ppCompiler);
 #ifdef _WIN32
   FileRunCommandResult RunFxc(dxc::DxcDllSupport &DllSupport, const FileRunCommandResult* Prior);
 #endif
@@ -149,10 +151,13 @@ public:
   static FileRunTestResult RunFromFileCommands(LPCWSTR fileName,
                                                PluginToolsPaths *pPluginToolsPaths = nullptr,
                                                LPCWSTR dumpName = nullptr);
+  // pCompiler, when given, runs every %dxc and %dxl command of the file, so
+  // a caller running many files on one thread creates a single compiler.
   static FileRunTestResult RunFromFileCommands(LPCWSTR fileName,
                                                dxc::DxcDllSupport &dllSupport,
                                                PluginToolsPaths *pPluginToolsPaths = nullptr,
-                                               LPCWSTR dumpName = nullptr);
+                                               LPCWSTR dumpName = nullptr,
+                                               IDxcCompiler *pCompiler = nullptr);
 };
 
 void AssembleToContainer(dxc::DxcDllSupport &dllSupport, IDxcBlob *pModule, IDxcBlob **pContainer);
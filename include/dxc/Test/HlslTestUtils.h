@@ -293,6 +293,16 @@ inline bool GetTestParamBool(LPCWSTR name) {
                                    NameValue, NameValue.GetLength());
 }
 
+inline unsigned GetTestParamUnsigned(LPCWSTR name, unsigned defaultVal) {
+  WEX::Common::String ParamValue;
+  if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(name,
+                                                                ParamValue)) ||
+      ParamValue.IsEmpty()) {
+    return defaultVal;
+  }
+  return (unsigned)wcstoul(ParamValue, nullptr, 10);
+}
+
 inline bool GetTestParamUseWARP(bool defaultVal) {
   WEX::Common::String AdapterValue;
   if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
@@ -259,6 +259,7 @@ struct IDxcOperationResult : public IUnknown {
   // DXC_OUT_OBJECT - Compile() with shader or library target
   // DXC_OUT_DISASSEMBLY - Disassemble()
   // DXC_OUT_HLSL - Compile() with -P
+  // DXC_OUT_DEPENDENCIES - Compile() with -M
   // DXC_OUT_ROOT_SIGNATURE - Compile() with rootsig_* target
   virtual HRESULT STDMETHODCALLTYPE GetResult(_COM_Outptr_result_maybenull_ IDxcBlob **ppResult) = 0;
 
@@ -349,6 +350,91 @@ public:
   ) = 0;
 };
 
+// One entry point linked by IDxcLinker2::LinkMany.
+struct DxcLinkRequest {
+  LPCWSTR pEntryName;                   // Entry point name
+  LPCWSTR pTargetProfile;               // shader profile to link
+};
+
+// A library container prepared for linking by IDxcLinker2::PrepareLibrary:
+// validated, and with the calls and global uses of its functions found up
+// front. It is immutable, so any number of linkers, on any threads, can
+// register it.
+CROSS_PLATFORM_UUIDOF(IDxcLinkerLibrary, "D61F0A93-27B4-4C8E-9E3A-4B5D8F1C27E6")
+struct IDxcLinkerLibrary : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetContainer(
+    _COM_Outptr_ IDxcBlob **ppResult    // The library container
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcLinker2, "8C4E2B6A-93D1-4F57-A0E8-5B7C16D3F942")
+struct IDxcLinker2 : public IDxcLinker {
+  // Links every request against the same libraries and arguments on up to
+  // threadCount worker threads (0 picks the hardware concurrency), returning
+  // once all of them have completed. Each thread links on an LLVM context of
+  // its own, loading the registered libraries it needs into it once.
+  // ppResults receives one result per request, in request order.
+  virtual HRESULT STDMETHODCALLTYPE LinkMany(
+    _In_count_(requestCount)
+        const DxcLinkRequest *pRequests, // Entry points to link
+    _In_ UINT32 requestCount,            // Number of entry points
+    _In_count_(libCount)
+        const LPCWSTR *pLibNames,        // Array of library names to link
+    _In_ UINT32 libCount,                // Number of libraries to link
+    _In_opt_count_(argCount) const LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                // Number of arguments
+    _In_ UINT32 threadCount,             // Worker threads, or 0
+    _Out_writes_(requestCount)
+        IDxcOperationResult **ppResults  // Linker output status, buffer, and errors
+  ) = 0;
+
+  // Prepares a library once, to be registered with many linkers. Registering
+  // a prepared library still loads its module into the linker's context, but
+  // skips validating the container and scanning the functions it links.
+  virtual HRESULT STDMETHODCALLTYPE PrepareLibrary(
+    _In_ IDxcBlob *pLib,                 // Library blob.
+    _COM_Outptr_ IDxcLinkerLibrary **ppResult
+  ) = 0;
+
+  // Registers a library returned by PrepareLibrary, from this or any other
+  // linker, with name to ref it later.
+  virtual HRESULT STDMETHODCALLTYPE RegisterPreparedLibrary(
+    _In_ LPCWSTR pLibName,               // Name of the library.
+    _In_ IDxcLinkerLibrary *pLib         // Prepared library.
+  ) = 0;
+};
+
+// Size in bytes of the keys passed to IDxcLinkCacheStorage.
+static const UINT32 DxcLinkCacheKeySize = 16;
+
+// Application-provided storage for linked containers. Keys digest the linker
+// version, the contents of each library linked, the entry point, the target
+// profile and the arguments (including any -exports map). Calls may come
+// from several threads at once.
+CROSS_PLATFORM_UUIDOF(IDxcLinkCacheStorage, "6E1F4A27-B938-4D05-8C6A-E3927D0B51F4")
+struct IDxcLinkCacheStorage : public IUnknown {
+  // Returns S_OK with the container stored under pKey, or S_FALSE with null
+  // when there is none.
+  virtual HRESULT STDMETHODCALLTYPE Lookup(
+    _In_reads_bytes_(DxcLinkCacheKeySize) const BYTE *pKey,
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppContainer
+  ) = 0;
+  // Called after each successful link that missed; failures are ignored.
+  virtual HRESULT STDMETHODCALLTYPE Store(
+    _In_reads_bytes_(DxcLinkCacheKeySize) const BYTE *pKey,
+    _In_ IDxcBlob *pContainer
+  ) = 0;
+};
+
+// Optional cache of link results, queried from the linker. A hit returns the
+// stored container without loading or linking any library.
+CROSS_PLATFORM_UUIDOF(IDxcLinkerCache, "A83C5D19-0F72-4B6E-9D41-7C28E5B6F03A")
+struct IDxcLinkerCache : public IUnknown {
+  // Storage for linked containers; null disables the cache.
+  virtual HRESULT STDMETHODCALLTYPE SetCacheStorage(_In_opt_ IDxcLinkCacheStorage *pStorage) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ UINT32 *pHits, _Out_ UINT32 *pMisses) = 0;
+};
+
 /////////////////////////
 // Latest interfaces. Please use these
 ////////////////////////
@@ -430,6 +516,12 @@ struct IDxcUtils : public IUnknown {
     _In_ IDxcBlob *pPDBBlob, _COM_Outptr_ IDxcBlob **ppHash, _COM_Outptr_ IDxcBlob **ppContainer) = 0;
 };
 
+// Contents of DXC_OUT_MEMORY_STATISTICS.
+typedef struct DxcMemoryStatistics {
+  UINT64 PeakBytes;  // Most memory the compile held at once
+  UINT64 LimitBytes; // -memory-limit in bytes, or 0 for no limit
+} DxcMemoryStatistics;
+
 // For use with IDxcResult::[Has|Get]Output dxcOutKind argument
 // Note: text outputs returned from version 2 APIs are UTF-8 or UTF-16 based on -encoding option
 typedef enum DXC_OUT_KIND {
@@ -444,6 +536,13 @@ typedef enum DXC_OUT_KIND {
   DXC_OUT_REFLECTION = 8,     // IDxcBlob - RDAT part with reflection data
   DXC_OUT_ROOT_SIGNATURE = 9, // IDxcBlob - Serialized root signature output
   DXC_OUT_EXTRA_OUTPUTS  = 10,// IDxcExtraResults - Extra outputs
+  DXC_OUT_TIME_REPORT = 11,   // IDxcBlobUtf8 or IDxcBlobUtf16 - JSON time and memory spent per phase and pass (-ftime-report)
+  DXC_OUT_FUNCTION_FINGERPRINTS = 12, // IDxcBlob - Library function fingerprints (-Ffp)
+  DXC_OUT_DEPENDENCIES = 13,  // IDxcBlobUtf8 or IDxcBlobUtf16 - make rule listing the included files (-M/-MF)
+  DXC_OUT_MEMORY_STATISTICS = 14, // IDxcBlob - DxcMemoryStatistics of the compile (-memory-limit)
+  DXC_OUT_VALIDATION_REPORT = 15, // IDxcBlobUtf8 - JSON rules broken and time per phase of validation (DxcValidatorFlags_Report)
+  DXC_OUT_STATS = 16,         // IDxcBlobUtf8 or IDxcBlobUtf16 - JSON IR sizes at each compile stage (-fcompile-stats)
+  DXC_OUT_LINE_STATS = 17,    // IDxcBlobUtf8 or IDxcBlobUtf16 - JSON generated code per source line, function and inlined call (-fline-stats)
 
   DXC_OUT_FORCE_DWORD = 0xFFFFFFFF
 } DXC_OUT_KIND;
@@ -495,11 +594,197 @@ struct IDxcCompiler3 : public IUnknown {
     ) = 0;
 };
 
+// Optional persistent cache of compile results, queried from the compiler.
+// Entries are keyed on the compiler version, arguments and source text, and
+// are only reused when every included file still has the same contents.
+CROSS_PLATFORM_UUIDOF(IDxcCompilerCache, "5C2B6E8A-3F4D-4B71-9E0A-7D1C64A2B9F3")
+struct IDxcCompilerCache : public IUnknown {
+  // Directory where entries are stored; null or empty disables the cache.
+  // The -compile-cache argument overrides this for a single compile.
+  virtual HRESULT STDMETHODCALLTYPE SetCacheDirectory(_In_opt_z_ LPCWSTR pDirectory) = 0;
+  // Limits enforced after each store by removing the oldest entries; 0 means unlimited.
+  virtual HRESULT STDMETHODCALLTYPE SetEvictionPolicy(_In_ UINT32 MaxEntries, _In_ UINT64 MaxSizeInBytes) = 0;
+  // Removes every entry from the cache directory.
+  virtual HRESULT STDMETHODCALLTYPE Clear() = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ UINT32 *pHits, _Out_ UINT32 *pMisses) = 0;
+};
+
+// One entry of a batch submitted to IDxcCompilerBatch::CompileBatch; the
+// fields match the arguments of IDxcCompiler3::Compile.
+struct DxcCompileRequest {
+  const DxcBuffer *pSource;                     // Source text to compile
+  LPCWSTR *pArguments;                          // Array of pointers to arguments
+  UINT32 argCount;                              // Number of arguments
+  IDxcIncludeHandler *pIncludeHandler;          // Optional include handler
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompileBatchCallback, "E2A4C1B7-6D3F-4F8A-9B25-0C7E19D4A6F1")
+struct IDxcCompileBatchCallback : public IUnknown {
+  // Called once per request as soon as it finishes, in completion order.
+  // Calls are serialized, but may come from any of the batch's threads.
+  // Returning a failure stops any requests that have not started yet.
+  virtual HRESULT STDMETHODCALLTYPE OnCompileComplete(
+    _In_ UINT32 requestIndex,                     // Index into the submitted requests
+    _In_ IDxcResult *pResult                      // Status, outputs and errors
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompilerBatch, "7B9F3D2E-1C64-4A0B-8E57-A3D6F2C9B814")
+struct IDxcCompilerBatch : public IUnknown {
+  // Compiles every request on up to threadCount worker threads (0 picks the
+  // hardware concurrency) and returns once all of them have completed.
+  // Files loaded through an include handler are read once per batch, and
+  // calls into each handler are serialized.
+  virtual HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_count_(requestCount) const DxcCompileRequest *pRequests,
+    _In_ UINT32 requestCount,
+    _In_ UINT32 threadCount,
+    _In_ IDxcCompileBatchCallback *pCallback
+  ) = 0;
+};
+
+// One permutation submitted to IDxcCompilerPermutations::CompilePermutations.
+struct DxcDefineSet {
+  const DxcDefine *pDefines;                    // Defines of this permutation
+  UINT32 defineCount;                           // Number of defines
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompilerPermutations, "4C8E27A9-B3F1-4D65-A0E2-7F19C6D2B358")
+struct IDxcCompilerPermutations : public IUnknown {
+  // Compiles pSource once per define set, each added to pArguments as -D
+  // options, and reports each result through pCallback with the index of
+  // its define set. Define sets are first run through the preprocessor
+  // only; those that preprocess to the same tokens share one compile and
+  // the same result object. A define set that agrees with an earlier one
+  // on every macro that one's preprocessing looked at is not preprocessed
+  // again. Compiles run as in IDxcCompilerBatch::CompileBatch.
+  virtual HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Arguments shared by all permutations
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineSetCount) const DxcDefineSet *pDefineSets,
+    _In_ UINT32 defineSetCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // Optional include handler
+    _In_ UINT32 threadCount,                      // Worker threads; 0 picks the hardware concurrency
+    _In_ IDxcCompileBatchCallback *pCallback,
+    _Out_opt_ UINT32 *pCompileCount               // Number of distinct compiles run
+  ) = 0;
+};
+
+static const UINT32 DxcDiagnosticSeverity_Note = 0;
+static const UINT32 DxcDiagnosticSeverity_Remark = 1;
+static const UINT32 DxcDiagnosticSeverity_Warning = 2;
+static const UINT32 DxcDiagnosticSeverity_Error = 3;
+static const UINT32 DxcDiagnosticSeverity_Fatal = 4;
+
+// A diagnostic reported to IDxcDiagnosticSink. Strings are UTF-8 and only
+// valid for the duration of the callback.
+struct DxcDiagnosticInfo {
+  UINT32 severity;                              // DxcDiagnosticSeverity_*
+  LPCSTR pMessage;                              // Message text, without location or severity
+  LPCSTR pFileName;                             // Presumed file name, or null without a location
+  UINT32 line;                                  // 1-based presumed line, or 0 without a location
+  UINT32 column;                                // 1-based column, or 0 without a location
+  LPCSTR pOption;                               // Warning option that controls it, or null
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcDiagnosticSink, "9A3D5E71-28C4-4B0F-A6E3-5D17C82F04B9")
+struct IDxcDiagnosticSink : public IUnknown {
+  // Called on the compiling thread for each diagnostic, in the order they are
+  // produced. Returning a failure, such as E_ABORT, stops the compile; its
+  // result then has that status and the errors reported up to that point.
+  virtual HRESULT STDMETHODCALLTYPE OnDiagnostic(_In_ const DxcDiagnosticInfo *pDiagnostic) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompilerDiagnostics, "E4B81C2F-7D06-4A93-8F5B-31C6A09D2E74")
+struct IDxcCompilerDiagnostics : public IUnknown {
+  // Compiles as IDxcCompiler3::Compile, and also reports each diagnostic to
+  // pSink as it is produced. DXC_OUT_ERRORS still holds all of them.
+  // Together with -ferror-limit=<count>, which stops the compile at the
+  // limit, this lets a caller give up on a failing compile early.
+  virtual HRESULT STDMETHODCALLTYPE CompileWithDiagnostics(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ IDxcDiagnosticSink *pSink,               // Receives each diagnostic
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCancellationToken, "B7E2946D-0C5A-4F18-93D1-6A4E0F8C25B3")
+struct IDxcCancellationToken : public IUnknown {
+  // Polled between passes, top-level declarations and long loops such as
+  // unrolling. It may be called from any thread working on the compile, so
+  // it should only read state set by the caller.
+  virtual BOOL STDMETHODCALLTYPE IsCancellationRequested() = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompilerCancellation, "2D9F51C8-E473-4A06-B5E8-07C3D1A96F42")
+struct IDxcCompilerCancellation : public IUnknown {
+  // Compiles as IDxcCompiler3::Compile, stopping at the next check once
+  // pToken requests cancellation or timeoutMs milliseconds have passed. A
+  // stopped compile still returns S_OK with a result whose status is
+  // E_ABORT. A timeoutMs of 0 means no deadline.
+  virtual HRESULT STDMETHODCALLTYPE CompileWithCancellation(
+    _In_ const DxcBuffer *pSource,                // Source text to compile
+    _In_opt_count_(argCount) LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_opt_ IDxcCancellationToken *pToken,       // Polled for cancellation (optional)
+    _In_ UINT32 timeoutMs,                        // Deadline from the start of the compile, or 0
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
+  ) = 0;
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcCompilerStreamingDisassembly, "8E3C6F1A-47B2-4D95-A0C8-5B91E2D74F36")
+struct IDxcCompilerStreamingDisassembly : public IUnknown {
+  // Disassembles as IDxcCompiler3::Disassemble, but writes the UTF-8 text to
+  // pOutput as it is produced instead of returning it, so it is never held
+  // in memory all at once. With pFunctionName, only that function's
+  // definition is written, with the metadata and attribute group numbers it
+  // has in the full disassembly. Function bodies are printed on up to
+  // threadCount threads (0 picks the hardware concurrency) and written in
+  // module order, so the text is the same for any thread count.
+  virtual HRESULT STDMETHODCALLTYPE DisassembleToStream(
+    _In_ const DxcBuffer *pObject,                // Program to disassemble: dxil container or bitcode.
+    _In_opt_z_ LPCWSTR pFunctionName,             // Function to disassemble, or null for the whole program
+    _In_ UINT32 threadCount,                      // Threads to print function bodies on
+    _In_ IStream *pOutput,                        // Receives the disassembly text
+    _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status and errors
+  ) = 0;
+};
+
+static const UINT32 DxcIncludeCacheMode_Disabled = 0; // Default; every compile decodes its own includes.
+static const UINT32 DxcIncludeCacheMode_Validate = 1; // Handler is always called; decoding is skipped for unchanged bytes.
+static const UINT32 DxcIncludeCacheMode_Trust = 2;    // Handler is only called for files not cached or invalidated.
+
+// Process-wide cache of decoded include files, shared by all compilers and
+// threads; every CLSID_DxcIncludeCache instance controls the same cache.
+// Files are keyed by the path passed to IDxcIncludeHandler, so in trust mode
+// every handler in the process must agree on their contents.
+CROSS_PLATFORM_UUIDOF(IDxcIncludeCache, "0F6B1A3C-95D2-4E7A-B8C4-2D1E7F90A563")
+struct IDxcIncludeCache : public IUnknown {
+  // Disabling the cache also drops every entry.
+  virtual HRESULT STDMETHODCALLTYPE SetMode(_In_ UINT32 mode) = 0;
+  // Drops the entry for a file, e.g. after an editor saves it.
+  virtual HRESULT STDMETHODCALLTYPE Invalidate(_In_z_ LPCWSTR pFileName) = 0;
+  virtual HRESULT STDMETHODCALLTYPE InvalidateAll() = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ UINT32 *pHits, _Out_ UINT32 *pMisses) = 0;
+};
+
 static const UINT32 DxcValidatorFlags_Default = 0;
 static const UINT32 DxcValidatorFlags_InPlaceEdit = 1;  // Validator is allowed to update shader blob in-place.
 static const UINT32 DxcValidatorFlags_RootSignatureOnly = 2;
 static const UINT32 DxcValidatorFlags_ModuleOnly = 4;
-static const UINT32 DxcValidatorFlags_ValidMask = 0x7;
+// Only check a container's parts and the module metadata they are built
+// from, such as signatures, PSV and root signature, without loading function
+// bodies; libraries still load them for their runtime data.
+static const UINT32 DxcValidatorFlags_MetadataOnly = 8;
+// Also return DXC_OUT_VALIDATION_REPORT: the rules broken, where, and the
+// time spent in each phase of validation.
+static const UINT32 DxcValidatorFlags_Report = 16;
+static const UINT32 DxcValidatorFlags_ValidMask = 0x1F;
 
 CROSS_PLATFORM_UUIDOF(IDxcValidator, "A6E82BD2-1FD7-4826-9811-2857E797F49A")
 struct IDxcValidator : public IUnknown {
@@ -549,6 +834,17 @@ struct IDxcContainerReflection : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE GetPartReflection(UINT32 idx, REFIID iid, void **ppvObject) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcContainerReflectionCache, "3A7D91C4-5E2B-4F08-B6A3-92C0E8D15F7B")
+struct IDxcContainerReflectionCache : public IUnknown {
+  // Directory where GetPartReflection stores reflection data, keyed by the
+  // container's shader hash; null or empty disables the cache. Containers
+  // without a hash part are never cached.
+  virtual HRESULT STDMETHODCALLTYPE SetCacheDirectory(_In_opt_z_ LPCWSTR pDirectory) = 0;
+  // Removes every entry from the cache directory.
+  virtual HRESULT STDMETHODCALLTYPE Clear() = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ UINT32 *pHits, _Out_ UINT32 *pMisses) = 0;
+};
+
 CROSS_PLATFORM_UUIDOF(IDxcOptimizerPass, "AE2CD79F-CC22-453F-9B6B-B124E7A5204C")
 struct IDxcOptimizerPass : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE GetOptionName(_COM_Outptr_ LPWSTR *ppResult) = 0;
@@ -568,6 +864,47 @@ struct IDxcOptimizer : public IUnknown {
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcOptimizer2, "6b5c7a1e-3f0d-4c8b-9e2a-71d4c0a5b83f")
+struct IDxcOptimizer2 : public IDxcOptimizer {
+  // Runs the passes given by ppOptions on each of moduleCount modules, on up to
+  // threadCount threads (0 for one per hardware thread). The options are parsed
+  // once for the whole batch. Each module gets its results at the same index
+  // of ppOutputModules and, if given, ppOutputTexts; a module that fails gets
+  // null outputs, and the first failure in module order is returned.
+  virtual HRESULT STDMETHODCALLTYPE RunOptimizerBatch(
+    _In_count_(moduleCount) IDxcBlob **ppBlobs, UINT32 moduleCount,
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    UINT32 threadCount,
+    _Out_writes_(moduleCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(moduleCount) IDxcBlobEncoding **ppOutputTexts) = 0;
+};
+
+// Results of running one pipeline with IDxcOptimizer3::RunOptimizerPipelines.
+struct DxcOptimizerPipelineStats {
+  UINT32 InstructionCount; // Instructions in the output module.
+  UINT64 RunMicroseconds;  // Time spent running the passes.
+  BYTE OutputHash[16];     // MD5 of the output bitcode.
+};
+
+CROSS_PLATFORM_UUIDOF(IDxcOptimizer3, "d2e8f4a1-5b7c-4c9e-8a3d-6f1b0e2c9d57")
+struct IDxcOptimizer3 : public IDxcOptimizer2 {
+  // Loads pBlob once and runs each of pipelineCount pipelines on its own copy
+  // of the module. Pipeline i takes the next pPipelineOptionCounts[i] entries
+  // of ppOptions, which are interpreted as in RunOptimizer. Pipelines run one
+  // at a time so their times can be compared. pStats and, if given,
+  // ppOutputModules and ppOutputTexts get the results of pipeline i at index
+  // i; a pipeline that fails gets zeroed stats and null outputs, and the
+  // first failure is returned.
+  virtual HRESULT STDMETHODCALLTYPE RunOptimizerPipelines(
+    IDxcBlob *pBlob,
+    _In_ LPCWSTR *ppOptions,
+    _In_count_(pipelineCount) const UINT32 *pPipelineOptionCounts,
+    UINT32 pipelineCount,
+    _Out_writes_(pipelineCount) DxcOptimizerPipelineStats *pStats,
+    _Out_writes_opt_(pipelineCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(pipelineCount) IDxcBlobEncoding **ppOutputTexts) = 0;
+};
+
 static const UINT32 DxcVersionInfoFlags_None = 0;
 static const UINT32 DxcVersionInfoFlags_Debug = 1; // Matches VS_FF_DEBUG
 static const UINT32 DxcVersionInfoFlags_Internal = 2; // Internal Validator (non-signing)
@@ -722,4 +1059,11 @@ CLSID_SCOPE const GUID CLSID_DxcPdbUtils = {
     0x457e,
     {0xae, 0x8c, 0xec, 0x35, 0x5f, 0xae, 0xec, 0x7c}};
 
+// {3c1b6f2a-8e47-4d95-a0b3-6f2e9d41c7b8}
+CLSID_SCOPE const GUID CLSID_DxcIncludeCache = {
+    0x3c1b6f2a,
+    0x8e47,
+    0x4d95,
+    {0xa0, 0xb3, 0x6f, 0x2e, 0x9d, 0x41, 0xc7, 0xb8}};
+
 #endif
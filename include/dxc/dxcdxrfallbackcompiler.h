@@ -96,6 +96,16 @@ struct __declspec(uuid("76bb3c85-006d-4b72-9e10-63cd97df57f0"))
   ) = 0;
 };
 
+struct __declspec(uuid("3f7de3a1-59c4-4b2e-8a60-0d9c1e2b7a45"))
+  IDxcDxrFallbackCompiler2 : public IDxcDxrFallbackCompiler {
+
+  // If set to true then Link() emits a binned state dispatch: on each trip
+  // through the scheduler loop the wave picks the lowest pending state ID and
+  // only the lanes waiting on that state run it. Lanes in a wave then execute
+  // state functions together instead of diverging across the dispatch switch.
+  virtual HRESULT STDMETHODCALLTYPE SetBinnedDispatch(bool val) = 0;
+};
+
 // Note: __declspec(selectany) requires 'extern'
 // On Linux __declspec(selectany) is removed and using 'extern' results in link error.
 #ifdef _MSC_VER
@@ -175,7 +175,12 @@ typedef enum DxcTranslationUnitFlags
   DxcTranslationUnitFlags_IncludeBriefCommentsInCodeCompletion = 0x80,
 
   // Used to indicate that compilation should occur on the caller's thread.
-  DxcTranslationUnitFlags_UseCallerThread = 0x800
+  DxcTranslationUnitFlags_UseCallerThread = 0x800,
+
+  // Used to indicate that the bodies of functions outside the main file, in
+  // included headers, should be skipped while parsing. Diagnostics in those
+  // bodies are not reported.
+  DxcTranslationUnitFlags_SkipIncludedFunctionBodies = 0x1000
 } DxcTranslationUnitFlags;
 
 typedef enum DxcCursorFormatting
@@ -597,6 +602,27 @@ enum DxcCompletionChunkKind
   DxcCompletionChunk_VerticalSpace = 20,
 };
 
+enum DxcSymbolRole
+{
+  DxcSymbolRole_None = 0,
+  DxcSymbolRole_Declaration = 0x1,
+  DxcSymbolRole_Definition = 0x2,
+  DxcSymbolRole_Reference = 0x4,
+  DxcSymbolRole_All = 0x7
+};
+
+// An occurrence of a symbol recorded in an IDxcSymbolIndex. Lines and columns
+// start at 1.
+struct DxcSymbolOccurrence
+{
+  LPCSTR USR;
+  LPCSTR Name;
+  LPCSTR FileName;
+  unsigned Line;
+  unsigned Column;
+  DxcSymbolRole Role;
+};
+
 struct IDxcCursor;
 struct IDxcDiagnostic;
 struct IDxcFile;
@@ -717,6 +743,70 @@ struct IDxcIndex : public IUnknown
       _Out_ IDxcTranslationUnit** pTranslationUnit) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcParseCallback, "5b6b8b2e-3f0d-4c8e-a6c1-0e7f4d2a9b13")
+struct IDxcParseCallback : public IUnknown
+{
+  // Called on a worker thread when a parse queued with
+  // IDxcIndexAsync::ParseTranslationUnitAsync finishes. status is E_ABORT if
+  // the parse was cancelled or superseded, and pTranslationUnit is null unless
+  // status succeeded.
+  virtual HRESULT STDMETHODCALLTYPE OnParsed(
+      UINT64 cookie, HRESULT status,
+      _In_opt_ IDxcTranslationUnit* pTranslationUnit) = 0;
+};
+
+// Parses translation units on a pool of worker threads owned by the index.
+// Queued parses run highest priority first. Queuing a file cancels the parses
+// of the same file that haven't completed yet.
+CROSS_PLATFORM_UUIDOF(IDxcIndexAsync, "c1d3a7f4-8e2b-4b9a-9f6d-7a5e0c3b2d81")
+struct IDxcIndexAsync : public IUnknown
+{
+  virtual HRESULT STDMETHODCALLTYPE ParseTranslationUnitAsync(
+      _In_z_ const char *source_filename,
+      _In_count_(num_command_line_args) const char * const *command_line_args,
+      int num_command_line_args,
+      _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+      unsigned num_unsaved_files,
+      DxcTranslationUnitFlags options,
+      int priority,
+      _In_ IDxcParseCallback* pCallback,
+      _Out_opt_ UINT64* pCookie) = 0;
+  // Returns S_FALSE if the parse already completed.
+  virtual HRESULT STDMETHODCALLTYPE CancelParse(UINT64 cookie) = 0;
+  // Returns S_FALSE if the parse is no longer queued.
+  virtual HRESULT STDMETHODCALLTYPE SetParsePriority(UINT64 cookie, int priority) = 0;
+  // Blocks until every queued parse has completed. Must not be called from a
+  // callback.
+  virtual HRESULT STDMETHODCALLTYPE WaitForParses() = 0;
+};
+
+// Symbol occurrences across translation units, keyed by Unified Symbol
+// Resolution (USR) strings and kept on disk between sessions. Obtained from
+// IDxcIndex::QueryInterface.
+CROSS_PLATFORM_UUIDOF(IDxcSymbolIndex, "e4a9c2d6-1b7f-4e35-8c0a-93d6f5b2e7c4")
+struct IDxcSymbolIndex : public IUnknown
+{
+  /// <summary>Loads the index stored at path, which Save then writes to.</summary>
+  /// <returns>S_FALSE if there is no index at path yet.</returns>
+  virtual HRESULT STDMETHODCALLTYPE Open(_In_z_ LPCSTR path) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Save() = 0;
+  /// <summary>Replaces the occurrences recorded for the main file of the translation unit.</summary>
+  virtual HRESULT STDMETHODCALLTYPE UpdateFile(_In_ IDxcTranslationUnit* pTranslationUnit) = 0;
+  virtual HRESULT STDMETHODCALLTYPE RemoveFile(_In_z_ LPCSTR fileName) = 0;
+  /// <summary>Gets the USR of the entity a cursor declares or refers to.</summary>
+  virtual HRESULT STDMETHODCALLTYPE GetCursorUSR(_In_ IDxcCursor* cursor, _Outptr_result_maybenull_ LPSTR* pResult) = 0;
+  /// <summary>Finds the occurrences of a symbol in the given roles.</summary>
+  /// <remarks>The result is a single allocation to free with CoTaskMemFree.</remarks>
+  virtual HRESULT STDMETHODCALLTYPE FindOccurrences(
+    _In_z_ LPCSTR usr, DxcSymbolRole roles,
+    _Out_ unsigned* pResultLength, _Outptr_result_buffer_maybenull_(*pResultLength) DxcSymbolOccurrence** pResult) = 0;
+  /// <summary>Finds the occurrences of the symbols with the given name in the given roles.</summary>
+  /// <remarks>The result is a single allocation to free with CoTaskMemFree.</remarks>
+  virtual HRESULT STDMETHODCALLTYPE FindOccurrencesByName(
+    _In_z_ LPCSTR name, DxcSymbolRole roles,
+    _Out_ unsigned* pResultLength, _Outptr_result_buffer_maybenull_(*pResultLength) DxcSymbolOccurrence** pResult) = 0;
+};
+
 CROSS_PLATFORM_UUIDOF(IDxcSourceLocation, "8e7ddf1c-d7d3-4d69-b286-85fccba1e0cf")
 struct IDxcSourceLocation : public IUnknown
 {
@@ -76,4 +76,20 @@ struct IDxcRewriter2 : public IDxcRewriter {
                                                      _COM_Outptr_ IDxcOperationResult **ppResult) = 0;
 };
 
+CROSS_PLATFORM_UUIDOF(IDxcRewriter3, "7a3f1c52-9d4e-4b8a-b6e1-2c5d8f0a3e97")
+struct IDxcRewriter3 : public IDxcRewriter2 {
+
+  // Parses pSource once and returns in ppResults[i] what RemoveUnusedGlobals
+  // returns for pEntryPoints[i].
+  virtual HRESULT STDMETHODCALLTYPE RemoveUnusedGlobalsForEntryPoints(_In_ IDxcBlobEncoding *pSource,
+                                                     // Optional file name for pSource. Used in errors and include handlers.
+                                                     _In_opt_ LPCWSTR pSourceName,
+                                                     _In_count_(entryPointCount) LPCWSTR *pEntryPoints, _In_ UINT32 entryPointCount,
+                                                     // Defines
+                                                     _In_count_(defineCount) DxcDefine *pDefines, _In_ UINT32 defineCount,
+                                                     // user-provided interface to handle #include directives (optional)
+                                                     _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                                                     _Out_writes_(entryPointCount) IDxcOperationResult **ppResults) = 0;
+};
+
 #endif
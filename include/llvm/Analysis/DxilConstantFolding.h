@@ -29,6 +29,17 @@ namespace llvm {
 }
 
 namespace hlsl {
+  namespace DXIL {
+  enum class OpCode : unsigned;
+  }
+
+  /// ConstantFoldDxilOp - Try to constant fold the scalar dxil operation
+  /// opcode with result type Ty, given its operands past the opcode.
+  /// Shared with the front end, which folds HL intrinsics that lower to a
+  /// single dxil operation through it.
+  /// If successful, the constant result is returned, if not, null is returned.
+  llvm::Constant *ConstantFoldDxilOp(DXIL::OpCode opcode, llvm::Type *Ty, llvm::ArrayRef<llvm::Constant *> Operands);
+
   /// ConstantFoldScalarCall - Try to constant fold the call instruction.
   /// If successful, the constant result is returned, if not, null is returned.
   llvm::Constant *ConstantFoldScalarCall(llvm::StringRef Name, llvm::Type *Ty, llvm::ArrayRef<llvm::Constant *> Operands);
@@ -16,6 +16,7 @@
 namespace llvm {
 
 class Module;
+class Function;
 class DominatorTree;
 class Constant;
 class ConstantInt;
@@ -42,6 +43,7 @@ struct DxilValueCache : public ImmutablePass {
     bool Seen(Value *v);
     void SetSentinel(Value *V);
     void ResetUnknowns();
+    void ResetUnknown(const Value *V);
     void dump() const;
   private:
     Value *GetSentinel(LLVMContext &Ctx);
@@ -76,6 +78,10 @@ public:
   Constant *GetConstValue(Value *V, DominatorTree *DT = nullptr);
   ConstantInt *GetConstInt(Value *V, DominatorTree *DT = nullptr);
   void ResetUnknowns() { ValueMap.ResetUnknowns(); }
+  // Like ResetUnknowns, for the values of F only. The cache is kept for the
+  // whole pipeline, so a pass that changed one function shouldn't make the
+  // next queries redo every other function.
+  void ResetUnknowns(Function &F);
   bool IsAlwaysReachable(BasicBlock *BB, DominatorTree *DT=nullptr);
   bool IsUnreachable(BasicBlock *BB, DominatorTree *DT=nullptr);
 };
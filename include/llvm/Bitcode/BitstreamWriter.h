@@ -15,6 +15,7 @@
 #ifndef LLVM_BITCODE_BITSTREAMWRITER_H
 #define LLVM_BITCODE_BITSTREAMWRITER_H
 
+#include "llvm/ADT/ArrayRef.h" // HLSL Change
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Bitcode/BitCodes.h"
@@ -101,6 +102,16 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  // HLSL Change Begin
+  /// \brief Append whole words written by another writer. Both the stream and
+  /// the bytes must be 32-bit aligned.
+  void EmitWordAlignedBytes(ArrayRef<char> Bytes) {
+    assert(CurBit == 0 && "Not 32-bit aligned");
+    assert((Bytes.size() & 3) == 0 && "Bytes are not whole words");
+    Out.append(Bytes.begin(), Bytes.end());
+  }
+  // HLSL Change End
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -33,12 +33,18 @@ namespace llvm {
   /// deserialization of function bodies. If ShouldLazyLoadMetadata is true,
   /// lazily load metadata as well. If successful, this moves Buffer. On
   /// error, this *does not* move Buffer.
+  ///
+  /// If ShouldLoadMetadataOnDemand is also true, materializing a function
+  /// loads only the module-level metadata the function refers to, and
+  /// Module::materializeSelectNamedMetadata only what the named nodes refer
+  /// to, rather than all of it. Module::materializeMetadata loads the rest.
   ErrorOr<std::unique_ptr<Module>>
   getLazyBitcodeModule(std::unique_ptr<MemoryBuffer> &&Buffer,
                        LLVMContext &Context,
                        DiagnosticHandlerFunction DiagnosticHandler = nullptr,
                        bool ShouldLazyLoadMetadata = false,
-                       bool ShouldTrackBitstreamUsage = false);
+                       bool ShouldTrackBitstreamUsage = false,
+                       bool ShouldLoadMetadataOnDemand = false); // HLSL Change
 
   /// Read the header of the specified stream and prepare for lazy
   /// deserialization and streaming of function bodies.
@@ -68,8 +74,12 @@ namespace llvm {
   /// If \c ShouldPreserveUseListOrder, encode the use-list order for each \a
   /// Value in \c M.  These will be reconstructed exactly when \a M is
   /// deserialized.
+  ///
+  /// Function bodies are written on up to \c Threads threads; the output does
+  /// not depend on how many are used. // HLSL Change
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                          bool ShouldPreserveUseListOrder = false);
+                          bool ShouldPreserveUseListOrder = false,
+                          unsigned Threads = 1); // HLSL Change
 
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
   /// for an LLVM IR bitcode wrapper.
@@ -517,6 +517,13 @@ public:
   /// AssemblyAnnotationWriter.
   void print(raw_ostream &OS, AssemblyAnnotationWriter *AAW = nullptr) const;
 
+  // HLSL Change Begin
+  /// Print the function numbering metadata and attribute groups as a print of
+  /// the whole module does, so that its references can be looked up there.
+  void printAsInModule(raw_ostream &OS,
+                       AssemblyAnnotationWriter *AAW = nullptr) const;
+  // HLSL Change End
+
   /// viewCFG - This function is meant for use from the debugger.  You can just
   /// say 'call F->viewCFG()' and a ghostview window should pop up from the
   /// program, displaying the CFG of the current function with the code for each
@@ -165,6 +165,14 @@ public:
   /// any global mutex or cannot block the execution in another LLVM context.
   void yield();
 
+  // HLSL Change Begin
+  /// Prepares the context to be used for another compile once all of its
+  /// modules are gone: releases the names of their struct types and removes
+  /// the handlers that were installed. Returns false, doing nothing, if a
+  /// module is still alive.
+  bool resetForReuse();
+  // HLSL Change End
+
   /// emitError - Emit an error message to the currently installed error handler
   /// with optional location information.  This function returns, so code should
   /// be prepared to drop the erroneous construct on the floor and "not crash".
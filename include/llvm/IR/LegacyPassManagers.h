@@ -476,6 +476,10 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+/// getPassPhaseName - HLSL Change - Name P reports to the thread's
+/// PhaseTimingListener, or null for pass managers.
+const char *getPassPhaseName(Pass *P);
+
 }
 
 #endif
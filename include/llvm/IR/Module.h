@@ -658,8 +658,13 @@ public:
   /// AssemblyAnnotationWriter.  If \c ShouldPreserveUseListOrder, then include
   /// uselistorder directives so that use-lists can be recreated when reading
   /// the assembly.
+  /// HLSL Change: with \c Threads above one, function bodies are printed on
+  /// that many threads and written out in module order, giving the same
+  /// text. The AssemblyAnnotationWriter must then be safe to call from
+  /// several threads at once.
   void print(raw_ostream &OS, AssemblyAnnotationWriter *AAW,
-             bool ShouldPreserveUseListOrder = false) const;
+             bool ShouldPreserveUseListOrder = false,
+             unsigned Threads = 1) const; // HLSL Change
 
   /// Dump the module to stderr (for debugging).
   void dump() const;
@@ -33,10 +33,16 @@ namespace llvm {
 
 class TargetMachine;
 
+// HLSL Change: once initialized, only read the flag. Pass constructors run
+// this for every pass of every compile, and a compare-and-swap on the shared
+// flag each time contends between threads.
 #define CALL_ONCE_INITIALIZATION(function) \
   static volatile sys::cas_flag initialized = 0; \
-  sys::cas_flag old_val = sys::CompareAndSwap(&initialized, 1, 0); \
-  if (old_val == 0) { \
+  sys::cas_flag old_val = initialized == 2 ? 2 : \
+                          sys::CompareAndSwap(&initialized, 1, 0); \
+  if (old_val == 2) { \
+    sys::MemoryFence(); \
+  } else if (old_val == 0) { \
     function(Registry); \
     sys::MemoryFence(); \
     TsanIgnoreWritesBegin(); \
@@ -87,6 +87,28 @@ namespace llvm {
 
   // HLSL Change - throw special exception for cast mismatch
   void llvm_cast_assert_internal(const char *func);
+
+  // HLSL Change Starts
+  /// CancellationCheck - Decides whether the compile running on the thread it
+  /// is installed on should stop.  Long-running work polls it through
+  /// checkCancellation, at points where it is safe to unwind.
+  class CancellationCheck {
+  public:
+    virtual ~CancellationCheck();
+    /// isCancelled - May be called from any thread working on the compile.
+    virtual bool isCancelled() = 0;
+
+    /// getCurrent - Return the check installed on this thread, if any.
+    static CancellationCheck *getCurrent();
+
+    /// setCurrent - Install C on this thread and return the prior check.
+    static CancellationCheck *setCurrent(CancellationCheck *C);
+  };
+
+  /// checkCancellation - Stop the compile by throwing an hlsl::Exception with
+  /// E_ABORT if the check of this thread says it was cancelled.
+  void checkCancellation();
+  // HLSL Change Ends
 }
 
 /// Marks that the current location is not supposed to be reachable.
@@ -152,6 +152,41 @@ struct NamedRegionTimer : public TimeRegion {
 };
 
 
+// HLSL Change Starts - per-thread phase timing
+/// PhaseTimingListener - Receives the start and end of each named phase and
+/// pass that runs on the thread it is installed on.  This lets an in-process
+/// compile collect its own timings without the process-wide -time-passes
+/// state.  Phases are properly nested; stopPhase ends the innermost one.
+class PhaseTimingListener {
+public:
+  virtual ~PhaseTimingListener();
+  virtual void startPhase(StringRef Name, bool IsPass) = 0;
+  virtual void stopPhase() = 0;
+
+  /// getCurrent - Return the listener installed on this thread, if any.
+  static PhaseTimingListener *getCurrent();
+
+  /// setCurrent - Install L on this thread and return the prior listener.
+  static PhaseTimingListener *setCurrent(PhaseTimingListener *L);
+};
+
+/// PhaseTimingRegion - Reports the region it spans to the current thread's
+/// PhaseTimingListener.  A null Name makes the region a no-op.
+class PhaseTimingRegion {
+  PhaseTimingListener *L;
+  PhaseTimingRegion(const PhaseTimingRegion &) = delete;
+  void operator=(const PhaseTimingRegion &) = delete;
+public:
+  explicit PhaseTimingRegion(const char *Name, bool IsPass = false)
+      : L(Name ? PhaseTimingListener::getCurrent() : nullptr) {
+    if (L) L->startPhase(Name, IsPass);
+  }
+  ~PhaseTimingRegion() {
+    if (L) L->stopPhase();
+  }
+};
+// HLSL Change Ends
+
 /// The TimerGroup class is used to group together related timers into a single
 /// report that is printed when the TimerGroup is destroyed.  It is illegal to
 /// destroy a TimerGroup object before all of the Timers in it are gone.  A
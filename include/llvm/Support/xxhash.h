@@ -0,0 +1,55 @@
+//===- llvm/Support/xxhash.h - 64-bit xxHash --------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements XXH64, the 64-bit variant of Yann Collet's xxHash
+// (https://github.com/Cyan4973/xxHash). It is a fast, non-cryptographic hash
+// for in-process content keys; use MD5 where a digest is persisted or must
+// resist deliberate collisions.
+//
+//===----------------------------------------------------------------------===//
+
+// HLSL Change - new file.
+
+#ifndef LLVM_SUPPORT_XXHASH_H
+#define LLVM_SUPPORT_XXHASH_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+
+/// Incremental XXH64. Feeding the same bytes in any number of update calls
+/// produces the same hash as one call over all of them.
+class xxHash64Builder {
+  uint64_t V1, V2, V3, V4;
+  uint64_t Seed;
+  uint64_t TotalLen;
+  uint8_t Buffer[32];
+  unsigned BufferSize;
+
+public:
+  explicit xxHash64Builder(uint64_t Seed = 0);
+
+  void update(ArrayRef<uint8_t> Data);
+  void update(StringRef Str) {
+    update(ArrayRef<uint8_t>((const uint8_t *)Str.data(), Str.size()));
+  }
+
+  /// Returns the hash of everything passed to update so far. The builder
+  /// may keep being updated afterwards.
+  uint64_t final() const;
+};
+
+/// Returns the XXH64 hash of Data with a seed of zero.
+uint64_t xxHash64(StringRef Data);
+
+} // end namespace llvm
+
+#endif
@@ -19,6 +19,7 @@
 
 namespace hlsl {
   class HLSLExtensionsCodegenHelper;
+  class DxilCompileStats; // HLSL Change
 }
 
 namespace llvm {
@@ -130,12 +131,24 @@ public:
   bool HLSLAllowPreserveValues = false; // HLSL Change
   bool HLSLOnlyWarnOnUnrollFail = false; // HLSL Change
   hlsl::HLSLExtensionsCodegenHelper *HLSLExtensionsCodeGen = nullptr; // HLSL Change
+  hlsl::DxilCompileStats *HLSLCompileStats = nullptr; // HLSL Change - records the module before DXIL generation
   bool HLSLResMayAlias = false; // HLSL Change
   unsigned ScanLimit = 0; // HLSL Change
   bool EnableGVN = true; // HLSL Change
   bool StructurizeLoopExitsForUnroll = false; // HLSL Change
   bool HLSLEnableLifetimeMarkers = false; // HLSL Change
   bool HLSLEnableDebugNops = false; // HLSL Change
+  bool HLSLPair16BitOps = false; // HLSL Change
+  bool HLSLGroupSharedLayout = false; // HLSL Change
+  bool HLSLClusterSamples = false; // HLSL Change
+  bool HLSLMatrixDotProducts = false; // HLSL Change
+  bool HLSLMatrixLayout = false; // HLSL Change
+  bool HLSLFastTrig = false; // HLSL Change
+  bool HLSLIndexableArrays = false; // HLSL Change
+  unsigned HLSLParallelFunctionThreads = 0; // HLSL Change
+  unsigned HLSLUnrollBudget = 0; // HLSL Change
+  bool HLSLStopBeforeDxilGen = false; // HLSL Change - first stage of a staged compile
+  bool HLSLStartAtDxilGen = false; // HLSL Change - second stage of a staged compile
 
 private:
   /// ExtensionList - This is list of all of the extensions that are registered.
@@ -154,6 +167,8 @@ private:
   void addExtensionsToPM(ExtensionPointTy ETy,
                          legacy::PassManagerBase &PM) const;
   void addInitialAliasAnalysisPasses(legacy::PassManagerBase &PM) const;
+  void addFunctionSimplificationPasses(legacy::PassManagerBase &MPM) const; // HLSL Change
+  void addHLSLFastOptimizationPasses(legacy::PassManagerBase &MPM) const; // HLSL Change
   void addLTOOptimizationPasses(legacy::PassManagerBase &PM);
   void addLateLTOOptimizationPasses(legacy::PassManagerBase &PM);
 
@@ -166,6 +181,9 @@ public:
   /// populateModulePassManager - This sets up the primary pass manager.
   void populateModulePassManager(legacy::PassManagerBase &MPM);
   void populateLTOPassManager(legacy::PassManagerBase &PM);
+  /// HLSL Change - optimizes a module linked from DXIL libraries; the module
+  /// must still be lowered for DXIL afterwards.
+  void populateHLSLLinkTimePassManager(legacy::PassManagerBase &PM) const;
 };
 
 /// Registers a function for adding a standard set of passes.  This should be
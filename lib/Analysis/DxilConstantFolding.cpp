@@ -103,13 +103,13 @@ static Constant *HLSLConstantFoldRound(APFloat::roundingMode roundingMode, Const
 }
 
 namespace {
-// Wrapper for call operands that "shifts past" the hlsl intrinsic opcode.
+// Wrapper for the operands of a dxil intrinsic, past its opcode.
 // Also provides accessors that dyn_cast the operand to a constant type.
 class DxilIntrinsicOperands {
 public:
-  DxilIntrinsicOperands(ArrayRef<Constant *> RawCallOperands) : m_RawCallOperands(RawCallOperands) {}
+  DxilIntrinsicOperands(ArrayRef<Constant *> Operands) : m_Operands(Operands) {}
   Constant * const &operator[](size_t index) const {
-    return m_RawCallOperands[index + 1];
+    return m_Operands[index];
   }
 
   ConstantInt *GetConstantInt(size_t index) const {
@@ -121,10 +121,10 @@ public:
   }
 
   size_t Size() const {
-    return m_RawCallOperands.size() - 1;
+    return m_Operands.size();
   }
 private:
-  ArrayRef<Constant *> m_RawCallOperands;
+  ArrayRef<Constant *> m_Operands;
 };
 }
 
@@ -448,6 +448,34 @@ static Constant *ConstantFoldQuaternaryIntInstrinsic(OP::OpCode opcode, Type *Ty
   return ConstantInt::get(Ty, result);
 }
 
+// Constant fold LegacyF16ToF32 when the half in the low bits is a normal
+// number or zero, which converts to float exactly.
+static Constant *ConstantFoldF16ToF32(Type *Ty, ConstantInt *Op) {
+  if (!Op || !Ty->isFloatTy())
+    return nullptr;
+  APFloat Half(APFloat::IEEEhalf,
+               APInt(16, static_cast<uint16_t>(Op->getZExtValue())));
+  if (!Half.isFinite() || Half.isDenormal())
+    return nullptr;
+  bool LosesInfo;
+  Half.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &LosesInfo);
+  return ConstantFP::get(Ty->getContext(), Half);
+}
+
+// Constant fold LegacyF32ToF16 when the float is exactly a normal half or
+// zero, so the result doesn't depend on rounding or denorm handling.
+static Constant *ConstantFoldF32ToF16(Type *Ty, ConstantFP *Op) {
+  if (!IsValidOp(Op) || !Op->getType()->isFloatTy())
+    return nullptr;
+  APFloat Half(Op->getValueAPF());
+  bool LosesInfo;
+  if (Half.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven,
+                   &LosesInfo) != APFloat::opOK ||
+      LosesInfo || Half.isDenormal())
+    return nullptr;
+  return ConstantInt::get(Ty, Half.bitcastToAPInt().getZExtValue());
+}
+
 // Top level function to constant fold floating point intrinsics.
 static Constant *ConstantFoldFPIntrinsic(OP::OpCode opcode, Type *Ty, const DxilIntrinsicOperands &IntrinsicOperands) {
   if (!Ty->isHalfTy() && !Ty->isFloatTy() && !Ty->isDoubleTy())
@@ -493,6 +521,8 @@ static Constant *ConstantFoldFPIntrinsic(OP::OpCode opcode, Type *Ty, const Dxil
     return ConstantFoldDot(opcode, Ty, IntrinsicOperands);
   case OP::OpCodeClass::MakeDouble:
     return ConstantFoldMakeDouble(Ty, IntrinsicOperands);
+  case OP::OpCodeClass::LegacyF16ToF32:
+    return ConstantFoldF16ToF32(Ty, IntrinsicOperands.GetConstantInt(0));
   }
 
   return nullptr;
@@ -548,24 +578,33 @@ static Constant *ConstantFoldIntIntrinsic(OP::OpCode opcode, Type *Ty, const Dxi
   }
   case OP::OpCodeClass::IsHelperLane:
     return ConstantInt::get(Ty, (uint64_t)0);
+  case OP::OpCodeClass::LegacyF32ToF16:
+    return ConstantFoldF32ToF16(Ty, IntrinsicOperands.GetConstantFloat(0));
   }
 
   return nullptr;
 }
 
+Constant *hlsl::ConstantFoldDxilOp(DXIL::OpCode opcode, Type *Ty,
+                                   ArrayRef<Constant *> Operands) {
+  DxilIntrinsicOperands IntrinsicOperands(Operands);
+
+  if (Ty->isFloatingPointTy()) {
+    return ConstantFoldFPIntrinsic(opcode, Ty, IntrinsicOperands);
+  }
+  else if (Ty->isIntegerTy()) {
+    return ConstantFoldIntIntrinsic(opcode, Ty, IntrinsicOperands);
+  }
+  return nullptr;
+}
+
 // External entry point to constant fold dxil intrinsics.
 // Called from the llvm constant folding routine.
 Constant *hlsl::ConstantFoldScalarCall(StringRef Name, Type *Ty, ArrayRef<Constant *> RawOperands) {
   OP::OpCode opcode;
   if (GetDxilOpcode(Name, RawOperands, opcode)) {
-    DxilIntrinsicOperands IntrinsicOperands(RawOperands);
-
-    if (Ty->isFloatingPointTy()) {
-      return ConstantFoldFPIntrinsic(opcode, Ty, IntrinsicOperands);
-    }
-    else if (Ty->isIntegerTy()) {
-      return ConstantFoldIntIntrinsic(opcode, Ty, IntrinsicOperands);
-    }
+    if (Ty->isFloatingPointTy() || Ty->isIntegerTy())
+      return ConstantFoldDxilOp(opcode, Ty, RawOperands.slice(1));
   } else if (IsConvergentMarker(Name.data())) {
     assert(RawOperands.size() == 1);
     if (ConstantInt *C = dyn_cast<ConstantInt>(RawOperands[0]))
@@ -606,6 +645,8 @@ bool hlsl::CanConstantFoldCallTo(const Function *F) {
     case OP::OpCodeClass::Dot3:
     case OP::OpCodeClass::Dot4:
     case OP::OpCodeClass::MakeDouble:
+    case OP::OpCodeClass::LegacyF16ToF32:
+    case OP::OpCodeClass::LegacyF32ToF16:
       return true;
     case OP::OpCodeClass::IsHelperLane: {
       const hlsl::ShaderModel *pSM =
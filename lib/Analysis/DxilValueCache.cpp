@@ -351,6 +351,14 @@ void DxilValueCache::WeakValueMap::ResetUnknowns() {
   }
 }
 
+void DxilValueCache::WeakValueMap::ResetUnknown(const Value *V) {
+  if (!Sentinel)
+    return;
+  auto FindIt = Map.find(V);
+  if (FindIt != Map.end() && FindIt->second.Value == Sentinel.get())
+    FindIt->second.Value = nullptr;
+}
+
 LLVM_DUMP_METHOD
 void DxilValueCache::WeakValueMap::dump() const {
   for (auto It = Map.begin(), E = Map.end(); It != E; It++) {
@@ -431,6 +439,14 @@ bool DxilValueCache::IsUnreachable(BasicBlock *BB, DominatorTree *DT) {
   return IsUnreachable_(BB);
 }
 
+void DxilValueCache::ResetUnknowns(Function &F) {
+  for (BasicBlock &BB : F) {
+    ValueMap.ResetUnknown(&BB);
+    for (Instruction &I : BB)
+      ValueMap.ResetUnknown(&I);
+  }
+}
+
 LLVM_DUMP_METHOD
 void DxilValueCache::dump() const {
   ValueMap.dump();
@@ -25,6 +25,7 @@
 #include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h" // HLSL Change
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -125,8 +126,10 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
       CallGraphUpToDate = true;
     }
 
+    checkCancellation(); // HLSL Change
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      PhaseTimingRegion PassPhase(getPassPhaseName(CGSP), true); // HLSL Change
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
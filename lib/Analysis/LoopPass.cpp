@@ -17,6 +17,7 @@
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h" // HLSL Change
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -242,11 +243,13 @@ bool LPPassManager::runOnFunction(Function &F) {
                    CurrentLoop->getHeader()->getName());
       dumpRequiredSet(P);
 
+      checkCancellation(); // HLSL Change
       initializeAnalysisImpl(P);
 
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        PhaseTimingRegion PassPhase(getPassPhaseName(P), true); // HLSL Change
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
@@ -9,6 +9,7 @@
 
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h" // HLSL Change
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Triple.h"
@@ -129,6 +130,13 @@ public:
   Metadata *getValueFwdRef(unsigned Idx);
   void assignValue(Metadata *MD, unsigned Idx);
   void tryToResolveCycles();
+
+  // HLSL Change Begin - on-demand metadata loading.
+  /// If enabled, the index of each forward reference created is appended to
+  /// NewFwdRefs, so the reader can load the records they refer to.
+  bool LogNewFwdRefs = false;
+  std::vector<unsigned> NewFwdRefs;
+  // HLSL Change End
 };
 
 class BitcodeReader : public GVMaterializer {
@@ -216,6 +224,28 @@ class BitcodeReader : public GVMaterializer {
   /// True if any Metadata block has been materialized.
   bool IsMetadataMaterialized = false;
 
+  // HLSL Change Begin - on-demand metadata loading.
+  /// Where a module-level metadata record is: the block it is in, as an index
+  /// into MetadataCursors, the bit just past its abbreviation ID, and the ID.
+  struct MetadataRecordPos {
+    unsigned Block;
+    unsigned AbbrevID;
+    uint64_t BitPos;
+  };
+  /// Set once the deferred metadata blocks have been scanned.
+  bool IsMetadataIndexed = false;
+  /// The record of each module-level metadata value, by value number. Values
+  /// whose BitPos is zero have no record to load.
+  std::vector<MetadataRecordPos> MetadataIndex;
+  /// The METADATA_NAME record of each named metadata node not loaded yet.
+  StringMap<MetadataRecordPos> NamedMetadataIndex;
+  /// The names of the named metadata nodes, in the order the blocks have them.
+  std::vector<std::string> NamedMetadataOrder;
+  /// A cursor inside each deferred metadata block, with all of the block's
+  /// abbreviations defined, for reading its records in any order.
+  std::vector<BitstreamCursor> MetadataCursors;
+  // HLSL Change End
+
   bool StripDebugInfo = false;
 
 public:
@@ -237,6 +267,9 @@ public:
 
   bool ShouldTrackBitstreamUsage = false; // HLSL Change
   BitstreamUseTracker Tracker; // HLSL Change
+  /// If set, with lazily loaded metadata, materializing a function loads only
+  /// the module-level metadata it refers to. // HLSL Change
+  bool ShouldLoadMetadataOnDemand = false; // HLSL Change
 
   bool isDematerializable(const GlobalValue *GV) const override;
   std::error_code materialize(GlobalValue *GV) override;
@@ -371,6 +404,17 @@ private:
   std::error_code globalCleanup();
   std::error_code resolveGlobalAndAliasInits();
   std::error_code parseMetadata();
+  // HLSL Change Begin - on-demand metadata loading.
+  std::error_code parseMetadataRecord(BitstreamCursor &Cursor,
+                                      unsigned AbbrevID,
+                                      unsigned &NextMDValueNo);
+  std::error_code indexMetadata();
+  std::error_code loadMetadataRecord(const MetadataRecordPos &Pos,
+                                     unsigned MDValueNo);
+  std::error_code loadNamedMetadata(StringRef Name);
+  std::error_code loadReferencedMetadata();
+  std::error_code loadRemainingMetadata();
+  // HLSL Change End
   std::error_code parseSelectNamedMetadata(ArrayRef<StringRef> NamedMetadata); // HLSL Change
   std::error_code materializeSelectNamedMetadata(ArrayRef<StringRef> NamedMetadata) override; // HLSL Change
   std::error_code parseMetadataAttachment(Function &F);
@@ -496,6 +540,12 @@ void BitcodeReader::freeState() {
   std::vector<Function*>().swap(FunctionsWithBodies);
   DeferredFunctionInfo.clear();
   DeferredMetadataInfo.clear();
+  // HLSL Change Begin
+  MetadataIndex.clear();
+  NamedMetadataIndex.clear();
+  NamedMetadataOrder.clear();
+  MetadataCursors.clear();
+  // HLSL Change End
   MDKindMap.clear();
 
   assert(BasicBlockFwdRefs.empty() && "Unresolved blockaddress fwd references");
@@ -961,6 +1011,8 @@ Metadata *BitcodeReaderMDValueList::getValueFwdRef(unsigned Idx) {
   // Create and return a placeholder, which will later be RAUW'd.
   Metadata *MD = MDNode::getTemporary(Context, None).release();
   MDValuePtrs[Idx].reset(MD);
+  if (LogNewFwdRefs)
+    NewFwdRefs.push_back(Idx); // HLSL Change
   return MD;
 }
 
@@ -1894,6 +1946,15 @@ std::error_code BitcodeReader::parseSelectNamedMetadata(ArrayRef<StringRef> Name
 }
 
 std::error_code BitcodeReader::materializeSelectNamedMetadata(ArrayRef<StringRef> NamedMetadata) {
+  if (ShouldLoadMetadataOnDemand) {
+    if (std::error_code EC = indexMetadata())
+      return EC;
+    for (StringRef Name : NamedMetadata)
+      if (std::error_code EC = loadNamedMetadata(Name))
+        return EC;
+    return loadReferencedMetadata();
+  }
+
   for (uint64_t BitPos : DeferredMetadataInfo) {
     // Move the bit stream to the saved position.
     Stream.JumpToBit(BitPos);
@@ -1904,6 +1965,218 @@ std::error_code BitcodeReader::materializeSelectNamedMetadata(ArrayRef<StringRef
   return std::error_code();
 }
 
+
+/// Returns true if a metadata record with this code defines a value, and so
+/// takes the next metadata value number.
+static bool isMetadataValueRecord(unsigned Code) {
+  switch (Code) {
+  case bitc::METADATA_OLD_FN_NODE:
+  case bitc::METADATA_OLD_NODE:
+  case bitc::METADATA_VALUE:
+  case bitc::METADATA_DISTINCT_NODE:
+  case bitc::METADATA_NODE:
+  case bitc::METADATA_LOCATION:
+  case bitc::METADATA_GENERIC_DEBUG:
+  case bitc::METADATA_SUBRANGE:
+  case bitc::METADATA_ENUMERATOR:
+  case bitc::METADATA_BASIC_TYPE:
+  case bitc::METADATA_DERIVED_TYPE:
+  case bitc::METADATA_COMPOSITE_TYPE:
+  case bitc::METADATA_SUBROUTINE_TYPE:
+  case bitc::METADATA_MODULE:
+  case bitc::METADATA_FILE:
+  case bitc::METADATA_COMPILE_UNIT:
+  case bitc::METADATA_SUBPROGRAM:
+  case bitc::METADATA_LEXICAL_BLOCK:
+  case bitc::METADATA_LEXICAL_BLOCK_FILE:
+  case bitc::METADATA_NAMESPACE:
+  case bitc::METADATA_TEMPLATE_TYPE:
+  case bitc::METADATA_TEMPLATE_VALUE:
+  case bitc::METADATA_GLOBAL_VAR:
+  case bitc::METADATA_LOCAL_VAR:
+  case bitc::METADATA_EXPRESSION:
+  case bitc::METADATA_OBJC_PROPERTY:
+  case bitc::METADATA_IMPORTED_ENTITY:
+  case bitc::METADATA_STRING:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// On-demand metadata loading
+//
+// With lazily loaded metadata, the deferred module-level metadata blocks are
+// scanned once, without building any metadata, to record where the record of
+// each metadata value and of each named node is; the metadata kinds are the
+// only records parsed, as function bodies need them. Value numbers are
+// reserved for every module-level value, so function-local metadata is
+// numbered as it would be if everything had been loaded.
+//
+// After that, a reference to a value that has not been loaded yet makes a
+// forward reference, as it would when reading the block in order. Loading
+// replaces each forward reference by parsing the value's record, which may
+// make more, until none are left. Only the metadata reachable from what was
+// asked for is built.
+std::error_code BitcodeReader::indexMetadata() {
+  if (IsMetadataIndexed || DeferredMetadataInfo.empty())
+    return std::error_code();
+  IsMetadataIndexed = true;
+  IsMetadataMaterialized = true;
+
+  unsigned NextMDValueNo = MDValueList.size();
+  for (uint64_t BlockBitPos : DeferredMetadataInfo) {
+    BitstreamCursor Cursor(*StreamFile);
+    Cursor.JumpToBit(BlockBitPos);
+    if (Cursor.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+      return error("Invalid record");
+
+    unsigned Block = MetadataCursors.size();
+    SmallVector<uint64_t, 1> AbbrevDefines;
+    SmallVector<uint64_t, 64> Record;
+    while (1) {
+      // Remember where abbreviations are defined, to define them again in
+      // the cursor used for loading.
+      if (Cursor.PeekCode() == bitc::DEFINE_ABBREV)
+        AbbrevDefines.push_back(Cursor.GetCurrentBitNo());
+
+      unsigned skipCount = 0;
+      BitstreamEntry Entry = Cursor.advanceSkippingSubblocks(0, &skipCount);
+      if (skipCount) ReportWarning(DiagnosticHandler, "Unrecognized subblock");
+
+      bool Done = false;
+      switch (Entry.Kind) {
+      case BitstreamEntry::SubBlock: // Handled for us already.
+      case BitstreamEntry::Error:
+        return error("Malformed block");
+      case BitstreamEntry::EndBlock:
+        Done = true;
+        break;
+      case BitstreamEntry::Record:
+        break;
+      }
+      if (Done)
+        break;
+
+      MetadataRecordPos Pos = { Block, Entry.ID, Cursor.GetCurrentBitNo() };
+      unsigned Code = Cursor.peekRecord(Entry.ID);
+      if (Code == bitc::METADATA_KIND) {
+        if (std::error_code EC =
+                parseMetadataRecord(Cursor, Entry.ID, NextMDValueNo))
+          return EC;
+      } else if (Code == bitc::METADATA_NAME) {
+        Record.clear();
+        Cursor.readRecord(Entry.ID, Record);
+        SmallString<8> Name(Record.begin(), Record.end());
+        NamedMetadataIndex[Name] = Pos;
+        NamedMetadataOrder.push_back(Name.str());
+        // Skip the METADATA_NAMED_NODE record that follows.
+        Cursor.skipRecord(Cursor.ReadCode());
+      } else {
+        if (isMetadataValueRecord(Code)) {
+          if (MetadataIndex.size() <= NextMDValueNo)
+            MetadataIndex.resize(NextMDValueNo + 1, MetadataRecordPos());
+          MetadataIndex[NextMDValueNo++] = Pos;
+        }
+        Cursor.skipRecord(Entry.ID);
+      }
+    }
+
+    // Re-enter the block, which exiting it has left with no abbreviations,
+    // and define them all again.
+    Cursor.JumpToBit(BlockBitPos);
+    if (Cursor.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+      return error("Invalid record");
+    for (uint64_t AbbrevBitPos : AbbrevDefines) {
+      Cursor.JumpToBit(AbbrevBitPos);
+      while (Cursor.ReadCode() == bitc::DEFINE_ABBREV)
+        Cursor.ReadAbbrevRecord();
+    }
+    MetadataCursors.push_back(std::move(Cursor));
+  }
+
+  if (MDValueList.size() < NextMDValueNo)
+    MDValueList.resize(NextMDValueNo);
+  MDValueList.LogNewFwdRefs = true;
+  return std::error_code();
+}
+
+/// Parse the record that defines metadata value MDValueNo.
+std::error_code
+BitcodeReader::loadMetadataRecord(const MetadataRecordPos &Pos,
+                                  unsigned MDValueNo) {
+  BitstreamCursor &Cursor = MetadataCursors[Pos.Block];
+  Cursor.JumpToBit(Pos.BitPos);
+  return parseMetadataRecord(Cursor, Pos.AbbrevID, MDValueNo);
+}
+
+/// Add the named metadata node, if it exists and has not been loaded yet,
+/// leaving its operands as forward references.
+std::error_code BitcodeReader::loadNamedMetadata(StringRef Name) {
+  auto It = NamedMetadataIndex.find(Name);
+  if (It == NamedMetadataIndex.end())
+    return std::error_code();
+  MetadataRecordPos Pos = It->getValue();
+  NamedMetadataIndex.erase(It);
+  return loadMetadataRecord(Pos, 0);
+}
+
+/// Load the records of all forward references to module-level metadata,
+/// and of the forward references they make in turn.
+std::error_code BitcodeReader::loadReferencedMetadata() {
+  std::vector<unsigned> &Pending = MDValueList.NewFwdRefs;
+  while (!Pending.empty()) {
+    unsigned ID = Pending.back();
+    Pending.pop_back();
+    // Function-local metadata is not in the index.
+    if (ID >= MetadataIndex.size() || MetadataIndex[ID].BitPos == 0)
+      continue;
+    MDNode *N = dyn_cast_or_null<MDNode>(MDValueList[ID]);
+    if (!N || !N->isTemporary())
+      continue;
+    if (std::error_code EC = loadMetadataRecord(MetadataIndex[ID], ID))
+      return EC;
+  }
+  MDValueList.tryToResolveCycles();
+  return std::error_code();
+}
+
+/// Load every module-level metadata value and named node not loaded yet.
+std::error_code BitcodeReader::loadRemainingMetadata() {
+  if (!IsMetadataIndexed)
+    return std::error_code();
+  for (unsigned ID = 0, E = MetadataIndex.size(); ID != E; ++ID) {
+    if (MetadataIndex[ID].BitPos == 0)
+      continue;
+    Metadata *MD = MDValueList[ID];
+    MDNode *N = dyn_cast_or_null<MDNode>(MD);
+    if (MD && (!N || !N->isTemporary()))
+      continue;
+    if (std::error_code EC = loadMetadataRecord(MetadataIndex[ID], ID))
+      return EC;
+  }
+  for (const std::string &Name : NamedMetadataOrder)
+    if (std::error_code EC = loadNamedMetadata(Name))
+      return EC;
+  if (std::error_code EC = loadReferencedMetadata())
+    return EC;
+
+  // Put the named nodes in the order the blocks have them, which is the
+  // order loading everything at once would have added them in.
+  Module::NamedMDListType &NamedMDList = TheModule->getNamedMDList();
+  for (const std::string &Name : NamedMetadataOrder)
+    if (NamedMDNode *NMD = TheModule->getNamedMetadata(Name))
+      NamedMDList.splice(NamedMDList.end(), NamedMDList, NMD);
+
+  MDValueList.LogNewFwdRefs = false;
+  MDValueList.NewFwdRefs.clear();
+  MetadataIndex.clear();
+  NamedMetadataOrder.clear();
+  MetadataCursors.clear();
+  DeferredMetadataInfo.clear();
+  return std::error_code();
+}
+
 // HLSL Change - end
 
 std::error_code BitcodeReader::parseMetadata() {
@@ -1913,25 +2186,6 @@ std::error_code BitcodeReader::parseMetadata() {
   if (Stream.EnterSubBlock(bitc::METADATA_BLOCK_ID))
     return error("Invalid record");
 
-  SmallVector<uint64_t, 64> Record;
-  SmallVector<uint8_t, 64> Uint8Record; // HLSL Change
-
-  auto getMD =
-      [&](unsigned ID) -> Metadata *{ return MDValueList.getValueFwdRef(ID); };
-  auto getMDOrNull = [&](unsigned ID) -> Metadata *{
-    if (ID)
-      return getMD(ID - 1);
-    return nullptr;
-  };
-  auto getMDString = [&](unsigned ID) -> MDString *{
-    // This requires that the ID is not really a forward reference.  In
-    // particular, the MDString must already have been resolved.
-    return cast_or_null<MDString>(getMDOrNull(ID));
-  };
-
-#define GET_OR_DISTINCT(CLASS, DISTINCT, ARGS)                                 \
-  (DISTINCT ? CLASS::getDistinct ARGS : CLASS::get ARGS)
-
   // Read all the records.
   while (1) {
     // HLSL Change Starts - count skipped blocks
@@ -1952,439 +2206,473 @@ std::error_code BitcodeReader::parseMetadata() {
       break;
     }
 
-#if 1 // HLSL Change
-    // If it's a string metadata, use our special Uint8Record to speed
-    // up reading.
-    unsigned PeekCode = Stream.peekRecord(Entry.ID);
-    unsigned Code = 0;
-    Record.clear();
-    if (PeekCode == bitc::METADATA_STRING) {
-      Uint8Record.clear();
-      Code = Stream.readRecord(Entry.ID, Record, nullptr, &Uint8Record);
-      assert(!Uint8Record.empty() || (Record.empty() && Uint8Record.empty()));
-    }
-    else {
-      Code = Stream.readRecord(Entry.ID, Record);
-    }
-#else // HLSL Change
-    // Read a record.
-    Record.clear();
-    unsigned Code = Stream.readRecord(Entry.ID, Record);
-#endif // HLSL Change
-
-    std::string String; // HLSL Change - Reuse buffer for loading string.
-    bool IsDistinct = false;
-    switch (Code) {
-    default:  // Default behavior: ignore.
-      break;
-    case bitc::METADATA_NAME: {
-      // Read name of the named metadata.
-      SmallString<8> Name(Record.begin(), Record.end());
-      Record.clear();
-      Code = Stream.ReadCode();
-
-      unsigned NextBitCode = Stream.readRecord(Code, Record);
-      if (NextBitCode != bitc::METADATA_NAMED_NODE)
-        return error("METADATA_NAME not followed by METADATA_NAMED_NODE");
-
-      // Read named metadata elements.
-      unsigned Size = Record.size();
-      NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
-      for (unsigned i = 0; i != Size; ++i) {
-        MDNode *MD = dyn_cast_or_null<MDNode>(MDValueList.getValueFwdRef(Record[i]));
-        if (!MD)
-          return error("Invalid record");
-        NMD->addOperand(MD);
-      }
-      break;
-    }
-    case bitc::METADATA_OLD_FN_NODE: {
-      // FIXME: Remove in 4.0.
-      // This is a LocalAsMetadata record, the only type of function-local
-      // metadata.
-      if (Record.size() % 2 == 1)
-        return error("Invalid record");
-
-      // If this isn't a LocalAsMetadata record, we're dropping it.  This used
-      // to be legal, but there's no upgrade path.
-      auto dropRecord = [&] {
-        MDValueList.assignValue(MDNode::get(Context, None), NextMDValueNo++);
-      };
-      if (Record.size() != 2) {
-        dropRecord();
-        break;
-      }
-
-      Type *Ty = getTypeByID(Record[0]);
-      if (Ty->isMetadataTy() || Ty->isVoidTy()) {
-        dropRecord();
-        break;
-      }
-
-      MDValueList.assignValue(
-          LocalAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_OLD_NODE: {
-      // FIXME: Remove in 4.0.
-      if (Record.size() % 2 == 1)
-        return error("Invalid record");
-
-      unsigned Size = Record.size();
-      SmallVector<Metadata *, 8> Elts;
-      for (unsigned i = 0; i != Size; i += 2) {
-        Type *Ty = getTypeByID(Record[i]);
-        if (!Ty)
-          return error("Invalid record");
-        if (Ty->isMetadataTy())
-          Elts.push_back(MDValueList.getValueFwdRef(Record[i+1]));
-        else if (!Ty->isVoidTy()) {
-          auto *MD =
-              ValueAsMetadata::get(ValueList.getValueFwdRef(Record[i + 1], Ty));
-          assert(isa<ConstantAsMetadata>(MD) &&
-                 "Expected non-function-local metadata");
-          Elts.push_back(MD);
-        } else
-          Elts.push_back(nullptr);
-      }
-      MDValueList.assignValue(MDNode::get(Context, Elts), NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_VALUE: {
-      if (Record.size() != 2)
-        return error("Invalid record");
-
-      Type *Ty = getTypeByID(Record[0]);
-      if (Ty->isMetadataTy() || Ty->isVoidTy())
-        return error("Invalid record");
-
-      MDValueList.assignValue(
-          ValueAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_DISTINCT_NODE:
-      IsDistinct = true;
-      // fallthrough...
-    case bitc::METADATA_NODE: {
-      SmallVector<Metadata *, 8> Elts;
-      Elts.reserve(Record.size());
-      for (unsigned ID : Record)
-        Elts.push_back(ID ? MDValueList.getValueFwdRef(ID - 1) : nullptr);
-      MDValueList.assignValue(IsDistinct ? MDNode::getDistinct(Context, Elts)
-                                         : MDNode::get(Context, Elts),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LOCATION: {
-      if (Record.size() != 5)
-        return error("Invalid record");
-
-      unsigned Line = Record[1];
-      unsigned Column = Record[2];
-      MDNode *Scope = cast<MDNode>(MDValueList.getValueFwdRef(Record[3]));
-      Metadata *InlinedAt =
-          Record[4] ? MDValueList.getValueFwdRef(Record[4] - 1) : nullptr;
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DILocation, Record[0],
-                          (Context, Line, Column, Scope, InlinedAt)),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_GENERIC_DEBUG: {
-      if (Record.size() < 4)
-        return error("Invalid record");
-
-      unsigned Tag = Record[1];
-      unsigned Version = Record[2];
-
-      if (Tag >= 1u << 16 || Version != 0)
-        return error("Invalid record");
-
-      auto *Header = getMDString(Record[3]);
-      SmallVector<Metadata *, 8> DwarfOps;
-      for (unsigned I = 4, E = Record.size(); I != E; ++I)
-        DwarfOps.push_back(Record[I] ? MDValueList.getValueFwdRef(Record[I] - 1)
-                                     : nullptr);
-      MDValueList.assignValue(GET_OR_DISTINCT(GenericDINode, Record[0],
-                                              (Context, Tag, Header, DwarfOps)),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_SUBRANGE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
-
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DISubrange, Record[0],
-                          (Context, Record[1], unrotateSign(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_ENUMERATOR: {
-      if (Record.size() != 3)
-        return error("Invalid record");
-
-      MDValueList.assignValue(GET_OR_DISTINCT(DIEnumerator, Record[0],
-                                              (Context, unrotateSign(Record[1]),
-                                               getMDString(Record[2]))),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_BASIC_TYPE: {
-      if (Record.size() != 6)
-        return error("Invalid record");
-
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIBasicType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           Record[3], Record[4], Record[5])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_DERIVED_TYPE: {
-      if (Record.size() != 12)
-        return error("Invalid record");
-
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIDerivedType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDOrNull(Record[5]), getMDOrNull(Record[6]),
-                           Record[7], Record[8], Record[9], Record[10],
-                           getMDOrNull(Record[11]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_COMPOSITE_TYPE: {
-      if (Record.size() != 16)
-        return error("Invalid record");
-
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DICompositeType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDOrNull(Record[5]), getMDOrNull(Record[6]),
-                           Record[7], Record[8], Record[9], Record[10],
-                           getMDOrNull(Record[11]), Record[12],
-                           getMDOrNull(Record[13]), getMDOrNull(Record[14]),
-                           getMDString(Record[15]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_SUBROUTINE_TYPE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
-
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DISubroutineType, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
-
-    case bitc::METADATA_MODULE: {
-      if (Record.size() != 6)
-        return error("Invalid record");
+    // HLSL Change - records are parsed on their own so that they can also be
+    // loaded on demand.
+    if (std::error_code EC =
+            parseMetadataRecord(Stream, Entry.ID, NextMDValueNo))
+      return EC;
+  }
+}
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIModule, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                          getMDString(Record[2]), getMDString(Record[3]),
-                          getMDString(Record[4]), getMDString(Record[5]))),
-          NextMDValueNo++);
-      break;
-    }
+// HLSL Change - split out of parseMetadata.
+/// Parse the metadata record at the cursor, whose abbreviation ID has just
+/// been read. A record that defines a metadata value assigns it number
+/// NextMDValueNo and increments it.
+std::error_code BitcodeReader::parseMetadataRecord(BitstreamCursor &Cursor,
+                                                   unsigned AbbrevID,
+                                                   unsigned &NextMDValueNo) {
+  SmallVector<uint64_t, 64> Record;
+  SmallVector<uint8_t, 64> Uint8Record; // HLSL Change
 
-    case bitc::METADATA_FILE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+  auto getMD =
+      [&](unsigned ID) -> Metadata *{ return MDValueList.getValueFwdRef(ID); };
+  auto getMDOrNull = [&](unsigned ID) -> Metadata *{
+    if (ID)
+      return getMD(ID - 1);
+    return nullptr;
+  };
+  auto getMDString = [&](unsigned ID) -> MDString *{
+    // This requires that the ID is not really a forward reference.  In
+    // particular, the MDString must already have been resolved.
+    return cast_or_null<MDString>(getMDOrNull(ID));
+  };
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIFile, Record[0], (Context, getMDString(Record[1]),
-                                              getMDString(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_COMPILE_UNIT: {
-      if (Record.size() < 14 || Record.size() > 15)
-        return error("Invalid record");
+#define GET_OR_DISTINCT(CLASS, DISTINCT, ARGS)                                 \
+  (DISTINCT ? CLASS::getDistinct ARGS : CLASS::get ARGS)
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(
-              DICompileUnit, Record[0],
-              (Context, Record[1], getMDOrNull(Record[2]),
-               getMDString(Record[3]), Record[4], getMDString(Record[5]),
-               Record[6], getMDString(Record[7]), Record[8],
-               getMDOrNull(Record[9]), getMDOrNull(Record[10]),
-               getMDOrNull(Record[11]), getMDOrNull(Record[12]),
-               getMDOrNull(Record[13]), Record.size() == 14 ? 0 : Record[14])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_SUBPROGRAM: {
-      if (Record.size() != 19)
-        return error("Invalid record");
+#if 1 // HLSL Change
+  // If it's a string metadata, use our special Uint8Record to speed
+  // up reading.
+  unsigned PeekCode = Cursor.peekRecord(AbbrevID);
+  unsigned Code = 0;
+  Record.clear();
+  if (PeekCode == bitc::METADATA_STRING) {
+    Uint8Record.clear();
+    Code = Cursor.readRecord(AbbrevID, Record, nullptr, &Uint8Record);
+    assert(!Uint8Record.empty() || (Record.empty() && Uint8Record.empty()));
+  }
+  else {
+    Code = Cursor.readRecord(AbbrevID, Record);
+  }
+#else // HLSL Change
+  // Read a record.
+  Record.clear();
+  unsigned Code = Cursor.readRecord(AbbrevID, Record);
+#endif // HLSL Change
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(
-              DISubprogram, Record[0],
-              (Context, getMDOrNull(Record[1]), getMDString(Record[2]),
-               getMDString(Record[3]), getMDOrNull(Record[4]), Record[5],
-               getMDOrNull(Record[6]), Record[7], Record[8], Record[9],
-               getMDOrNull(Record[10]), Record[11], Record[12], Record[13],
-               Record[14], getMDOrNull(Record[15]), getMDOrNull(Record[16]),
-               getMDOrNull(Record[17]), getMDOrNull(Record[18]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LEXICAL_BLOCK: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+  std::string String; // HLSL Change - Reuse buffer for loading string.
+  bool IsDistinct = false;
+  switch (Code) {
+  default:  // Default behavior: ignore.
+    break;
+  case bitc::METADATA_NAME: {
+    // Read name of the named metadata.
+    SmallString<8> Name(Record.begin(), Record.end());
+    Record.clear();
+    Code = Cursor.ReadCode();
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DILexicalBlock, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), Record[3], Record[4])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LEXICAL_BLOCK_FILE: {
-      if (Record.size() != 4)
-        return error("Invalid record");
+    unsigned NextBitCode = Cursor.readRecord(Code, Record);
+    if (NextBitCode != bitc::METADATA_NAMED_NODE)
+      return error("METADATA_NAME not followed by METADATA_NAMED_NODE");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DILexicalBlockFile, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), Record[3])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_NAMESPACE: {
-      if (Record.size() != 5)
+    // Read named metadata elements.
+    unsigned Size = Record.size();
+    NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
+    for (unsigned i = 0; i != Size; ++i) {
+      MDNode *MD = dyn_cast_or_null<MDNode>(MDValueList.getValueFwdRef(Record[i]));
+      if (!MD)
         return error("Invalid record");
-
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DINamespace, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), getMDString(Record[3]),
-                           Record[4])),
-          NextMDValueNo++);
-      break;
+      NMD->addOperand(MD);
     }
-    case bitc::METADATA_TEMPLATE_TYPE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+    break;
+  }
+  case bitc::METADATA_OLD_FN_NODE: {
+    // FIXME: Remove in 4.0.
+    // This is a LocalAsMetadata record, the only type of function-local
+    // metadata.
+    if (Record.size() % 2 == 1)
+      return error("Invalid record");
 
-      MDValueList.assignValue(GET_OR_DISTINCT(DITemplateTypeParameter,
-                                              Record[0],
-                                              (Context, getMDString(Record[1]),
-                                               getMDOrNull(Record[2]))),
-                              NextMDValueNo++);
+    // If this isn't a LocalAsMetadata record, we're dropping it.  This used
+    // to be legal, but there's no upgrade path.
+    auto dropRecord = [&] {
+      MDValueList.assignValue(MDNode::get(Context, None), NextMDValueNo++);
+    };
+    if (Record.size() != 2) {
+      dropRecord();
       break;
     }
-    case bitc::METADATA_TEMPLATE_VALUE: {
-      if (Record.size() != 5)
-        return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DITemplateValueParameter, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), getMDOrNull(Record[4]))),
-          NextMDValueNo++);
+    Type *Ty = getTypeByID(Record[0]);
+    if (Ty->isMetadataTy() || Ty->isVoidTy()) {
+      dropRecord();
       break;
     }
-    case bitc::METADATA_GLOBAL_VAR: {
-      if (Record.size() != 11)
-        return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIGlobalVariable, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDString(Record[2]), getMDString(Record[3]),
-                           getMDOrNull(Record[4]), Record[5],
-                           getMDOrNull(Record[6]), Record[7], Record[8],
-                           getMDOrNull(Record[9]), getMDOrNull(Record[10]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LOCAL_VAR: {
-      // 10th field is for the obseleted 'inlinedAt:' field.
-      if (Record.size() != 9 && Record.size() != 10)
+    MDValueList.assignValue(
+        LocalAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_OLD_NODE: {
+    // FIXME: Remove in 4.0.
+    if (Record.size() % 2 == 1)
+      return error("Invalid record");
+
+    unsigned Size = Record.size();
+    SmallVector<Metadata *, 8> Elts;
+    for (unsigned i = 0; i != Size; i += 2) {
+      Type *Ty = getTypeByID(Record[i]);
+      if (!Ty)
         return error("Invalid record");
-
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DILocalVariable, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]),
-                           getMDString(Record[3]), getMDOrNull(Record[4]),
-                           Record[5], getMDOrNull(Record[6]), Record[7],
-                           Record[8])),
-          NextMDValueNo++);
-      break;
+      if (Ty->isMetadataTy())
+        Elts.push_back(MDValueList.getValueFwdRef(Record[i+1]));
+      else if (!Ty->isVoidTy()) {
+        auto *MD =
+            ValueAsMetadata::get(ValueList.getValueFwdRef(Record[i + 1], Ty));
+        assert(isa<ConstantAsMetadata>(MD) &&
+               "Expected non-function-local metadata");
+        Elts.push_back(MD);
+      } else
+        Elts.push_back(nullptr);
     }
-    case bitc::METADATA_EXPRESSION: {
-      if (Record.size() < 1)
-        return error("Invalid record");
+    MDValueList.assignValue(MDNode::get(Context, Elts), NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_VALUE: {
+    if (Record.size() != 2)
+      return error("Invalid record");
+
+    Type *Ty = getTypeByID(Record[0]);
+    if (Ty->isMetadataTy() || Ty->isVoidTy())
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        ValueAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_DISTINCT_NODE:
+    IsDistinct = true;
+    // fallthrough...
+  case bitc::METADATA_NODE: {
+    SmallVector<Metadata *, 8> Elts;
+    Elts.reserve(Record.size());
+    for (unsigned ID : Record)
+      Elts.push_back(ID ? MDValueList.getValueFwdRef(ID - 1) : nullptr);
+    MDValueList.assignValue(IsDistinct ? MDNode::getDistinct(Context, Elts)
+                                       : MDNode::get(Context, Elts),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LOCATION: {
+    if (Record.size() != 5)
+      return error("Invalid record");
+
+    unsigned Line = Record[1];
+    unsigned Column = Record[2];
+    MDNode *Scope = cast<MDNode>(MDValueList.getValueFwdRef(Record[3]));
+    Metadata *InlinedAt =
+        Record[4] ? MDValueList.getValueFwdRef(Record[4] - 1) : nullptr;
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DILocation, Record[0],
+                        (Context, Line, Column, Scope, InlinedAt)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_GENERIC_DEBUG: {
+    if (Record.size() < 4)
+      return error("Invalid record");
+
+    unsigned Tag = Record[1];
+    unsigned Version = Record[2];
+
+    if (Tag >= 1u << 16 || Version != 0)
+      return error("Invalid record");
+
+    auto *Header = getMDString(Record[3]);
+    SmallVector<Metadata *, 8> DwarfOps;
+    for (unsigned I = 4, E = Record.size(); I != E; ++I)
+      DwarfOps.push_back(Record[I] ? MDValueList.getValueFwdRef(Record[I] - 1)
+                                   : nullptr);
+    MDValueList.assignValue(GET_OR_DISTINCT(GenericDINode, Record[0],
+                                            (Context, Tag, Header, DwarfOps)),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBRANGE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DISubrange, Record[0],
+                        (Context, Record[1], unrotateSign(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_ENUMERATOR: {
+    if (Record.size() != 3)
+      return error("Invalid record");
+
+    MDValueList.assignValue(GET_OR_DISTINCT(DIEnumerator, Record[0],
+                                            (Context, unrotateSign(Record[1]),
+                                             getMDString(Record[2]))),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_BASIC_TYPE: {
+    if (Record.size() != 6)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIBasicType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         Record[3], Record[4], Record[5])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_DERIVED_TYPE: {
+    if (Record.size() != 12)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIDerivedType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDOrNull(Record[5]), getMDOrNull(Record[6]),
+                         Record[7], Record[8], Record[9], Record[10],
+                         getMDOrNull(Record[11]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_COMPOSITE_TYPE: {
+    if (Record.size() != 16)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DICompositeType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDOrNull(Record[5]), getMDOrNull(Record[6]),
+                         Record[7], Record[8], Record[9], Record[10],
+                         getMDOrNull(Record[11]), Record[12],
+                         getMDOrNull(Record[13]), getMDOrNull(Record[14]),
+                         getMDString(Record[15]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBROUTINE_TYPE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DISubroutineType, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIExpression, Record[0],
-                          (Context, makeArrayRef(Record).slice(1))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_OBJC_PROPERTY: {
-      if (Record.size() != 8)
-        return error("Invalid record");
+  case bitc::METADATA_MODULE: {
+    if (Record.size() != 6)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIModule, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                        getMDString(Record[2]), getMDString(Record[3]),
+                        getMDString(Record[4]), getMDString(Record[5]))),
+        NextMDValueNo++);
+    break;
+  }
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIObjCProperty, Record[0],
-                          (Context, getMDString(Record[1]),
-                           getMDOrNull(Record[2]), Record[3],
-                           getMDString(Record[4]), getMDString(Record[5]),
-                           Record[6], getMDOrNull(Record[7]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_IMPORTED_ENTITY: {
-      if (Record.size() != 6)
-        return error("Invalid record");
+  case bitc::METADATA_FILE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIImportedEntity, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDString(Record[5]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_STRING: {
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIFile, Record[0], (Context, getMDString(Record[1]),
+                                            getMDString(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_COMPILE_UNIT: {
+    if (Record.size() < 14 || Record.size() > 15)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(
+            DICompileUnit, Record[0],
+            (Context, Record[1], getMDOrNull(Record[2]),
+             getMDString(Record[3]), Record[4], getMDString(Record[5]),
+             Record[6], getMDString(Record[7]), Record[8],
+             getMDOrNull(Record[9]), getMDOrNull(Record[10]),
+             getMDOrNull(Record[11]), getMDOrNull(Record[12]),
+             getMDOrNull(Record[13]), Record.size() == 14 ? 0 : Record[14])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBPROGRAM: {
+    if (Record.size() != 19)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(
+            DISubprogram, Record[0],
+            (Context, getMDOrNull(Record[1]), getMDString(Record[2]),
+             getMDString(Record[3]), getMDOrNull(Record[4]), Record[5],
+             getMDOrNull(Record[6]), Record[7], Record[8], Record[9],
+             getMDOrNull(Record[10]), Record[11], Record[12], Record[13],
+             Record[14], getMDOrNull(Record[15]), getMDOrNull(Record[16]),
+             getMDOrNull(Record[17]), getMDOrNull(Record[18]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LEXICAL_BLOCK: {
+    if (Record.size() != 5)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DILexicalBlock, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), Record[3], Record[4])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LEXICAL_BLOCK_FILE: {
+    if (Record.size() != 4)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DILexicalBlockFile, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), Record[3])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_NAMESPACE: {
+    if (Record.size() != 5)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DINamespace, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), getMDString(Record[3]),
+                         Record[4])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_TEMPLATE_TYPE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
+
+    MDValueList.assignValue(GET_OR_DISTINCT(DITemplateTypeParameter,
+                                            Record[0],
+                                            (Context, getMDString(Record[1]),
+                                             getMDOrNull(Record[2]))),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_TEMPLATE_VALUE: {
+    if (Record.size() != 5)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DITemplateValueParameter, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), getMDOrNull(Record[4]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_GLOBAL_VAR: {
+    if (Record.size() != 11)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIGlobalVariable, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDString(Record[2]), getMDString(Record[3]),
+                         getMDOrNull(Record[4]), Record[5],
+                         getMDOrNull(Record[6]), Record[7], Record[8],
+                         getMDOrNull(Record[9]), getMDOrNull(Record[10]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LOCAL_VAR: {
+    // 10th field is for the obseleted 'inlinedAt:' field.
+    if (Record.size() != 9 && Record.size() != 10)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DILocalVariable, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]),
+                         getMDString(Record[3]), getMDOrNull(Record[4]),
+                         Record[5], getMDOrNull(Record[6]), Record[7],
+                         Record[8])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_EXPRESSION: {
+    if (Record.size() < 1)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIExpression, Record[0],
+                        (Context, makeArrayRef(Record).slice(1))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_OBJC_PROPERTY: {
+    if (Record.size() != 8)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIObjCProperty, Record[0],
+                        (Context, getMDString(Record[1]),
+                         getMDOrNull(Record[2]), Record[3],
+                         getMDString(Record[4]), getMDString(Record[5]),
+                         Record[6], getMDOrNull(Record[7]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_IMPORTED_ENTITY: {
+    if (Record.size() != 6)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIImportedEntity, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDString(Record[5]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_STRING: {
 #if 0
-      std::string String(Record.begin(), Record.end());
+    std::string String(Record.begin(), Record.end());
 #else
-      String.resize(Uint8Record.size());
-      memcpy(&String[0], Uint8Record.data(), Uint8Record.size());
+    String.resize(Uint8Record.size());
+    memcpy(&String[0], Uint8Record.data(), Uint8Record.size());
 #endif
-      llvm::UpgradeMDStringConstant(String);
-      Metadata *MD = MDString::get(Context, String);
-      MDValueList.assignValue(MD, NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_KIND: {
-      if (Record.size() < 2)
-        return error("Invalid record");
+    llvm::UpgradeMDStringConstant(String);
+    Metadata *MD = MDString::get(Context, String);
+    MDValueList.assignValue(MD, NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_KIND: {
+    if (Record.size() < 2)
+      return error("Invalid record");
 
-      unsigned Kind = Record[0];
-      SmallString<8> Name(Record.begin()+1, Record.end());
+    unsigned Kind = Record[0];
+    SmallString<8> Name(Record.begin()+1, Record.end());
 
-      unsigned NewKind = TheModule->getMDKindID(Name.str());
-      if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
-        return error("Conflicting METADATA_KIND records");
-      break;
-    }
-    }
+    unsigned NewKind = TheModule->getMDKindID(Name.str());
+    if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
+      return error("Conflicting METADATA_KIND records");
+    break;
+  }
   }
 #undef GET_OR_DISTINCT
+  return std::error_code();
 }
 
 /// Decode a signed value stored with the sign bit in the LSB for dense VBR
@@ -3037,6 +3325,10 @@ std::error_code BitcodeReader::rememberAndSkipMetadata() {
 }
 
 std::error_code BitcodeReader::materializeMetadata() {
+  // HLSL Change Begin - on-demand metadata loading.
+  if (IsMetadataIndexed)
+    return loadRemainingMetadata();
+  // HLSL Change End
   for (uint64_t BitPos : DeferredMetadataInfo) {
     // Move the bit stream to the saved position.
     Stream.JumpToBit(BitPos);
@@ -4821,8 +5113,11 @@ std::error_code BitcodeReader::findFunctionInStream(
 void BitcodeReader::releaseBuffer() { Buffer.release(); }
 
 std::error_code BitcodeReader::materialize(GlobalValue *GV) {
-  if (std::error_code EC = materializeMetadata())
+  // HLSL Change Begin - on-demand metadata loading.
+  if (std::error_code EC = ShouldLoadMetadataOnDemand ? indexMetadata()
+                                                      : materializeMetadata())
     return EC;
+  // HLSL Change End
 
   Function *F = dyn_cast<Function>(GV);
   // If it's not a function or is already material, ignore the request.
@@ -4842,6 +5137,11 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
 
   if (std::error_code EC = parseFunctionBody(F))
     return EC;
+  // HLSL Change Begin - on-demand metadata loading.
+  if (IsMetadataIndexed)
+    if (std::error_code EC = loadReferencedMetadata())
+      return EC;
+  // HLSL Change End
   F->setIsMaterializable(false);
 
   if (StripDebugInfo)
@@ -5071,7 +5371,8 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
                          LLVMContext &Context, bool MaterializeAll,
                          DiagnosticHandlerFunction DiagnosticHandler,
                          bool ShouldLazyLoadMetadata = false,
-                         bool ShouldTrackBitstreamUsage = false) // HLSL Change
+                         bool ShouldTrackBitstreamUsage = false, // HLSL Change
+                         bool ShouldLoadMetadataOnDemand = false) // HLSL Change
 {
   // HLSL Change Begin: Proper memory management with unique_ptr
   // Get the buffer identifier before we transfer the ownership to the bitcode reader,
@@ -5081,6 +5382,7 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
     std::move(Buffer), Context, DiagnosticHandler);
 
   if (R) R->ShouldTrackBitstreamUsage = ShouldTrackBitstreamUsage; // HLSL Change
+  if (R) R->ShouldLoadMetadataOnDemand = ShouldLoadMetadataOnDemand; // HLSL Change
   ErrorOr<std::unique_ptr<Module>> Ret =
       getBitcodeModuleImpl(nullptr, BufferIdentifier, std::move(R), Context,
                            MaterializeAll, ShouldLazyLoadMetadata);
@@ -5094,10 +5396,11 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
 ErrorOr<std::unique_ptr<Module>> llvm::getLazyBitcodeModule(
     std::unique_ptr<MemoryBuffer> &&Buffer, LLVMContext &Context,
     DiagnosticHandlerFunction DiagnosticHandler, bool ShouldLazyLoadMetadata,
-    bool ShouldTrackBitstreamUsage) {
+    bool ShouldTrackBitstreamUsage, bool ShouldLoadMetadataOnDemand) {
   return getLazyBitcodeModuleImpl(std::move(Buffer), Context, false,
                                   DiagnosticHandler, ShouldLazyLoadMetadata,
-                                  ShouldTrackBitstreamUsage); // HLSL Change
+                                  ShouldTrackBitstreamUsage,
+                                  ShouldLoadMetadataOnDemand); // HLSL Change
 }
 
 ErrorOr<std::unique_ptr<Module>> llvm::getStreamedBitcodeModule(
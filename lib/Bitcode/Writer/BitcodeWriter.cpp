@@ -32,6 +32,13 @@
 #include "llvm/Support/raw_ostream.h"
 #include <cctype>
 #include <map>
+// HLSL Change Begin
+#include "dxc/Support/Global.h"
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+// HLSL Change End
 using namespace llvm;
 
 /// These are manifest constants used by the bitcode writer. They do not need to
@@ -2366,9 +2373,105 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
+// HLSL Change Begin - write function blocks in parallel.
+/// WriteFunctionsInParallel - Emit the function bodies of M on up to Threads
+/// threads and append them to Stream in module order. Returns false, having
+/// written nothing, if the stream is not at a point where that gives the same
+/// bits as writing them one after another.
+///
+/// A function block encodes the same way wherever it starts, as long as it
+/// starts on a word boundary inside the module block and the block info
+/// abbreviations are the same. Each worker therefore writes its own module
+/// block header and block info, then writes each function it takes and cuts
+/// the function's bytes out of its buffer.
+static bool WriteFunctionsInParallel(const Module *M, ValueEnumerator &VE,
+                                     BitstreamWriter &Stream,
+                                     unsigned Threads) {
+  if (Stream.GetCurrentBitNo() % 32 != 0)
+    return false;
+
+  std::vector<const Function *> Functions;
+  for (const Function &F : *M)
+    if (!F.isDeclaration())
+      Functions.push_back(&F);
+  Threads = std::min<size_t>(Threads, Functions.size());
+  if (Threads < 2)
+    return false;
+
+  // Hand each function the use-list orders WriteUseListBlock would pop for
+  // it, still in popping order, so workers need not share the stack.
+  std::vector<UseListOrderStack> UseListOrders(Functions.size());
+  if (VE.shouldPreserveUseListOrder()) {
+    DenseMap<const Function *, unsigned> FunctionIndex;
+    for (unsigned i = 0; i < Functions.size(); ++i)
+      FunctionIndex[Functions[i]] = i;
+    for (UseListOrder &Order : VE.UseListOrders)
+      UseListOrders[FunctionIndex.lookup(Order.F)].push_back(std::move(Order));
+    VE.UseListOrders.clear();
+  }
+
+  // Copy the enumerator before any thread starts; only the copies are used
+  // from here on.
+  std::vector<std::unique_ptr<ValueEnumerator>> Enumerators;
+  for (unsigned i = 0; i < Threads; ++i)
+    Enumerators.emplace_back(new ValueEnumerator(VE));
+
+  std::vector<SmallVector<char, 0>> Blocks(Functions.size());
+  std::vector<std::exception_ptr> Exceptions(Threads);
+  std::atomic<unsigned> NextFunction(0);
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  auto Worker = [&](unsigned Thread) {
+    DxcThreadMalloc TM(pMalloc);
+    try {
+      ValueEnumerator &WorkerVE = *Enumerators[Thread];
+      SmallVector<char, 0> Buffer;
+      BitstreamWriter WorkerStream(Buffer);
+      WorkerStream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+      WriteBlockInfo(WorkerVE, WorkerStream);
+      assert(WorkerStream.GetCurrentBitNo() % 32 == 0 &&
+             "Expected block info to end on a word boundary");
+      size_t Start = Buffer.size();
+      for (unsigned i = NextFunction++; i < Functions.size();
+           i = NextFunction++) {
+        std::swap(WorkerVE.UseListOrders, UseListOrders[i]);
+        WriteFunction(*Functions[i], WorkerVE, WorkerStream);
+        Blocks[i].append(Buffer.begin() + Start, Buffer.end());
+        // The block ended on a word boundary, so nothing is left pending in
+        // the writer and the bytes can simply be dropped.
+        Buffer.resize(Start);
+      }
+      WorkerStream.ExitBlock();
+    } catch (...) {
+      Exceptions[Thread] = std::current_exception();
+    }
+  };
+
+  // The calling thread takes the first share.
+  std::vector<std::thread> Workers;
+  for (unsigned i = 1; i < Threads; ++i) {
+    try {
+      Workers.emplace_back(Worker, i);
+    } catch (const std::system_error &) {
+      Worker(i);
+    }
+  }
+  Worker(0);
+  for (std::thread &T : Workers)
+    T.join();
+  for (std::exception_ptr &E : Exceptions)
+    if (E)
+      std::rethrow_exception(E);
+
+  for (SmallVector<char, 0> &Block : Blocks)
+    Stream.EmitWordAlignedBytes(Block);
+  return true;
+}
+// HLSL Change End
+
 /// WriteModule - Emit the specified module to the bitstream.
 static void WriteModule(const Module *M, BitstreamWriter &Stream,
-                        bool ShouldPreserveUseListOrder) {
+                        bool ShouldPreserveUseListOrder,
+                        unsigned Threads) { // HLSL Change
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   SmallVector<unsigned, 1> Vals;
@@ -2414,6 +2517,12 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
     WriteUseListBlock(nullptr, VE, Stream);
 
   // Emit function bodies.
+  // HLSL Change Begin - write function blocks in parallel.
+  if (Threads > 1 && WriteFunctionsInParallel(M, VE, Stream, Threads)) {
+    Stream.ExitBlock();
+    return;
+  }
+  // HLSL Change End
   for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
     if (!F->isDeclaration())
       WriteFunction(*F, VE, Stream);
@@ -2494,7 +2603,8 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                              bool ShouldPreserveUseListOrder) {
+                              bool ShouldPreserveUseListOrder,
+                              unsigned Threads) { // HLSL Change
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -2517,7 +2627,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
     Stream.Emit(0xD, 4);
 
     // Emit the module.
-    WriteModule(M, Stream, ShouldPreserveUseListOrder);
+    WriteModule(M, Stream, ShouldPreserveUseListOrder, Threads); // HLSL Change
   }
 
   if (TT.isOSDarwin())
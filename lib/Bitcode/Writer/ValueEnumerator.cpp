@@ -723,6 +723,26 @@ void ValueEnumerator::EnumerateAttributes(AttributeSet PAL) {
   }
 }
 
+// HLSL Change Begin - let function blocks be written in parallel.
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &Other)
+    : TypeMap(Other.TypeMap), Types(Other.Types), ValueMap(Other.ValueMap),
+      Values(Other.Values), Comdats(Other.Comdats), MDs(Other.MDs),
+      FunctionLocalMDs(Other.FunctionLocalMDs), MDValueMap(Other.MDValueMap),
+      HasMDString(Other.HasMDString), HasDILocation(Other.HasDILocation),
+      HasGenericDINode(Other.HasGenericDINode),
+      ShouldPreserveUseListOrder(Other.ShouldPreserveUseListOrder),
+      AttributeGroupMap(Other.AttributeGroupMap),
+      AttributeGroups(Other.AttributeGroups),
+      AttributeMap(Other.AttributeMap), Attribute(Other.Attribute),
+      GlobalBasicBlockIDs(Other.GlobalBasicBlockIDs),
+      InstructionMap(Other.InstructionMap),
+      InstructionCount(Other.InstructionCount),
+      BasicBlocks(Other.BasicBlocks), NumModuleValues(Other.NumModuleValues),
+      NumModuleMDs(Other.NumModuleMDs),
+      FirstFuncConstantID(Other.FirstFuncConstantID),
+      FirstInstID(Other.FirstInstID) {}
+// HLSL Change End
+
 void ValueEnumerator::incorporateFunction(const Function &F) {
   InstructionCount = 0;
   NumModuleValues = Values.size();
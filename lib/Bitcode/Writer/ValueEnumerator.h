@@ -100,10 +100,15 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
 
-  ValueEnumerator(const ValueEnumerator &) = delete;
   void operator=(const ValueEnumerator &) = delete;
 public:
   ValueEnumerator(const Module &M, bool ShouldPreserveUseListOrder);
+  // HLSL Change Begin - let function blocks be written in parallel.
+  /// Copies the module-level numbering so another thread can write function
+  /// bodies with it. Use-list orders are not copied; the copy starts with an
+  /// empty UseListOrders stack.
+  ValueEnumerator(const ValueEnumerator &Other);
+  // HLSL Change End
 
   void dump() const;
   void print(raw_ostream &OS, const ValueMapType &Map, const char *Name) const;
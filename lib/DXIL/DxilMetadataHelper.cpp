@@ -29,6 +29,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include <array>
 #include <algorithm>
@@ -85,6 +86,7 @@ const char DxilMDHelper::kDxilControlFlowHintMDName[]                 = "dx.cont
 const char DxilMDHelper::kDxilPreciseAttributeMDName[]                = "dx.precise";
 const char DxilMDHelper::kDxilVariableDebugLayoutMDName[]             = "dx.dbg.varlayout";
 const char DxilMDHelper::kDxilTempAllocaMDName[]                      = "dx.temp";
+const char DxilMDHelper::kDxilIndexableAllocaMDName[]                 = "dx.indexable";
 const char DxilMDHelper::kDxilNonUniformAttributeMDName[]             = "dx.nonuniform";
 const char DxilMDHelper::kHLDxilResourceAttributeMDName[]             = "dx.hl.resource.attribute";
 const char DxilMDHelper::kDxilValidatorVersionMDName[]                = "dx.valver";
@@ -120,6 +122,17 @@ static std::array<const char *, 8> DxilMDNames = { {
   DxilMDHelper::kDxilDxrPayloadAnnotationsMDName,
 }};
 
+struct DxilMDHelper::Caches {
+  // Small integers (tags, counts, offsets) make up most of the constants in
+  // DXIL metadata; skip the constant and metadata uniquing lookups for them.
+  static const unsigned kNumSmallUint32 = 256;
+  ConstantAsMetadata *SmallUint32MD[kNumSmallUint32] = {};
+
+  // Field annotation nodes are uniqued, so structs with the same field layout
+  // share them. Decoded once per type system node in LoadDxilTypeSystemNode.
+  DenseMap<const MDNode *, DxilFieldAnnotation> FieldAnnotations;
+};
+
 DxilMDHelper::DxilMDHelper(Module *pModule, std::unique_ptr<ExtraPropertyHelper> EPH)
 : m_Ctx(pModule->getContext())
 , m_pModule(pModule)
@@ -130,6 +143,7 @@ DxilMDHelper::DxilMDHelper(Module *pModule, std::unique_ptr<ExtraPropertyHelper>
 , m_MinValMajor(1)
 , m_MinValMinor(0)
 , m_bExtraMetadata(false)
+, m_pCaches(new Caches())
 {
 }
 
@@ -358,7 +372,7 @@ MDTuple *DxilMDHelper::EmitDxilEntryPointTuple(Function *pFunc, const string &Na
   return MDNode::get(m_Ctx, MDVals);
 }
 
-void DxilMDHelper::GetDxilEntryPoint(const MDNode *MDO, Function *&pFunc, string &Name,
+void DxilMDHelper::GetDxilEntryPoint(const MDNode *MDO, Function *&pFunc, StringRef &Name,
                                      const MDOperand *&pSignatures, const MDOperand *&pResources,
                                      const MDOperand *&pProperties) {
   IFTBOOL(MDO != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
@@ -461,6 +475,7 @@ void DxilMDHelper::LoadSignatureMetadata(const MDOperand &MDO, DxilSignature &Si
   const MDTuple *pTupleMD = dyn_cast<MDTuple>(MDO.get());
   IFTBOOL(pTupleMD != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
 
+  Sig.ReserveElements(pTupleMD->getNumOperands());
   for (unsigned i = 0; i < pTupleMD->getNumOperands(); i++) {
     unique_ptr<DxilSignatureElement> pSE(Sig.CreateElement());
     LoadSignatureElement(pTupleMD->getOperand(i), *pSE.get());
@@ -648,7 +663,7 @@ void DxilMDHelper::LoadDxilResourceBase(const MDOperand &MDO, DxilResourceBase &
   }
   R.SetGlobalSymbol(GlobalSymbol);
 
-  R.SetGlobalName(StringMDToString(pTupleMD->getOperand(kDxilResourceBaseName)));
+  R.SetGlobalName(StringMDToStringRef(pTupleMD->getOperand(kDxilResourceBaseName)));
   R.SetSpaceID(ConstMDToUint32(pTupleMD->getOperand(kDxilResourceBaseSpaceID)));
   R.SetLowerBound(ConstMDToUint32(pTupleMD->getOperand(kDxilResourceBaseLowerBound)));
   R.SetRangeSize(ConstMDToUint32(pTupleMD->getOperand(kDxilResourceBaseRangeSize)));
@@ -832,6 +847,9 @@ void DxilMDHelper::LoadDxilTypeSystemNode(const llvm::MDTuple &MDT,
   if (Tag == kDxilTypeSystemStructTag) {
     IFTBOOL((MDT.getNumOperands() & 0x1) == 1, DXC_E_INCORRECT_DXIL_METADATA);
 
+    // Decoded field annotations are only valid while no metadata changes.
+    auto &FieldCache = m_pCaches->FieldAnnotations;
+    FieldCache.clear();
     for (unsigned i = 1; i < MDT.getNumOperands(); i += 2) {
       Constant *pGV =
           dyn_cast<Constant>(ValueMDToValue(MDT.getOperand(i)));
@@ -844,6 +862,7 @@ void DxilMDHelper::LoadDxilTypeSystemNode(const llvm::MDTuple &MDT,
       LoadDxilStructAnnotation(MDT.getOperand(i + 1), *pSA);
       TypeSystem.FinishStructAnnotation(*pSA);
     }
+    FieldCache.clear();
   } else {
     IFTBOOL((MDT.getNumOperands() & 0x1) == 1, DXC_E_INCORRECT_DXIL_METADATA);
     for (unsigned i = 1; i < MDT.getNumOperands(); i += 2) {
@@ -1094,10 +1113,22 @@ void DxilMDHelper::LoadDxilStructAnnotation(const MDOperand &MDO, DxilStructAnno
   }
 
   SA.SetCBufferSize(ConstMDToUint32(pTupleMD->getOperand(0)));
+  auto &FieldCache = m_pCaches->FieldAnnotations;
   for (unsigned i = 0; i < SA.GetNumFields(); i++) {
     const MDOperand &MDO = pTupleMD->getOperand(i+1);
     DxilFieldAnnotation &FA = SA.GetFieldAnnotation(i);
+    const MDNode *pFieldMD = dyn_cast_or_null<MDNode>(MDO.get());
+    if (!pFieldMD || !pFieldMD->isUniqued()) {
+      LoadDxilFieldAnnotation(MDO, FA);
+      continue;
+    }
+    auto it = FieldCache.find(pFieldMD);
+    if (it != FieldCache.end()) {
+      FA = it->second;
+      continue;
+    }
     LoadDxilFieldAnnotation(MDO, FA);
+    FieldCache.insert(std::make_pair(pFieldMD, FA));
   }
 }
 
@@ -2615,6 +2646,12 @@ ConstantAsMetadata *DxilMDHelper::Uint32ToConstMD(unsigned v, LLVMContext &Ctx)
 }
 
 ConstantAsMetadata *DxilMDHelper::Uint32ToConstMD(unsigned v) {
+  if (v < Caches::kNumSmallUint32) {
+    ConstantAsMetadata *&pMD = m_pCaches->SmallUint32MD[v];
+    if (!pMD)
+      pMD = DxilMDHelper::Uint32ToConstMD(v, m_Ctx);
+    return pMD;
+  }
   return DxilMDHelper::Uint32ToConstMD(v, m_Ctx);
 }
 
@@ -81,6 +81,7 @@ const char *kDxBreakFuncName = "dx.break";
 const char *kDxBreakCondName = "dx.break.cond";
 const char *kDxBreakMDName = "dx.break.br";
 const char *kDxIsHelperGlobalName = "dx.ishelper";
+const char *kDxSpecConstantFuncPrefix = "dx.specconst.";
 
 const char *kHostLayoutTypePrefix = "hostlayout.";
 }
@@ -310,9 +311,19 @@ unsigned DxilModule::GetGlobalFlags() const {
   return Flags;
 }
 
+ShaderFlags DxilModule::GetShaderFlagsForFunction(const Function *F) const {
+  if (m_FunctionShaderFlagsValMajor == m_ValMajor &&
+      m_FunctionShaderFlagsValMinor == m_ValMinor) {
+    auto it = m_FunctionShaderFlags.find(F);
+    if (it != m_FunctionShaderFlags.end())
+      return it->second;
+  }
+  return ShaderFlags::CollectShaderFlags(F, this);
+}
+
 void DxilModule::CollectShaderFlagsForModule(ShaderFlags &Flags) {
   for (Function &F : GetModule()->functions()) {
-    ShaderFlags funcFlags = ShaderFlags::CollectShaderFlags(&F, this);
+    ShaderFlags funcFlags = GetShaderFlagsForFunction(&F);
     Flags.CombineShaderFlags(funcFlags);
   };
 
@@ -368,6 +379,13 @@ void DxilModule::CollectShaderFlagsForModule(ShaderFlags &Flags) {
 }
 
 void DxilModule::CollectShaderFlagsForModule() {
+  // Recompute the flags of every function, since the code may have changed
+  // since they were last recorded.
+  m_FunctionShaderFlags.clear();
+  m_FunctionShaderFlagsValMajor = m_ValMajor;
+  m_FunctionShaderFlagsValMinor = m_ValMinor;
+  for (Function &F : GetModule()->functions())
+    m_FunctionShaderFlags[&F] = ShaderFlags::CollectShaderFlags(&F, this);
   CollectShaderFlagsForModule(m_ShaderFlags);
 
   // This is also where we record the size of the mesh payload for amplification shader output
@@ -1189,19 +1207,20 @@ bool DxilModule::HasDxilEntrySignature(const llvm::Function *F) const {
 }
 DxilEntrySignature &DxilModule::GetDxilEntrySignature(const llvm::Function *F) {
   DXASSERT(m_DxilEntryPropsMap.count(F) != 0, "cannot find F in map");
-  return m_DxilEntryPropsMap[F].get()->sig;
+  return m_DxilEntryPropsMap.find(F)->second->sig;
 }
 void DxilModule::ReplaceDxilEntryProps(llvm::Function *F,
                                        llvm::Function *NewF) {
   DXASSERT(m_DxilEntryPropsMap.count(F) != 0, "cannot find F in map");
-  std::unique_ptr<DxilEntryProps> Props = std::move(m_DxilEntryPropsMap[F]);
-  m_DxilEntryPropsMap.erase(F);
+  auto It = m_DxilEntryPropsMap.find(F);
+  std::unique_ptr<DxilEntryProps> Props = std::move(It->second);
+  m_DxilEntryPropsMap.erase(It);
   m_DxilEntryPropsMap[NewF] = std::move(Props);
 }
 void DxilModule::CloneDxilEntryProps(llvm::Function *F, llvm::Function *NewF) {
   DXASSERT(m_DxilEntryPropsMap.count(F) != 0, "cannot find F in map");
   std::unique_ptr<DxilEntryProps> Props =
-      llvm::make_unique<DxilEntryProps>(*m_DxilEntryPropsMap[F]);
+      llvm::make_unique<DxilEntryProps>(*m_DxilEntryPropsMap.find(F)->second);
   m_DxilEntryPropsMap[NewF] = std::move(Props);
 }
 
@@ -1336,9 +1355,7 @@ void DxilModule::ResetTypeSystem(DxilTypeSystem *pValue) {
 void DxilModule::ResetOP(hlsl::OP *hlslOP) { m_pOP.reset(hlslOP); }
 
 void DxilModule::ResetEntryPropsMap(DxilEntryPropsMap &&PropMap) {
-  m_DxilEntryPropsMap.clear();
-  std::move(PropMap.begin(), PropMap.end(),
-            inserter(m_DxilEntryPropsMap, m_DxilEntryPropsMap.begin()));
+  m_DxilEntryPropsMap = std::move(PropMap);
 }
 
 static const StringRef llvmUsedName = "llvm.used";
@@ -1478,13 +1495,13 @@ void DxilModule::EmitDxilMetadata() {
     std::transform( m_DxilEntryPropsMap.begin(),
                     m_DxilEntryPropsMap.end(),
                     std::back_inserter(funcOrder),
-                    [](const std::pair<const llvm::Function * const, std::unique_ptr<DxilEntryProps>> &p) -> const Function* { return p.first; } );
+                    [](const DxilEntryPropsMap::value_type &p) -> const Function* { return p.first; } );
     std::sort(funcOrder.begin(), funcOrder.end(), [](const Function *F1, const Function *F2) {
       return F1->getName() < F2->getName();
     });
 
     for (auto F : funcOrder) {
-      auto &entryProps = m_DxilEntryPropsMap[F];
+      auto &entryProps = m_DxilEntryPropsMap.find(F)->second;
       MDTuple *pProps = m_pMDHelper->EmitDxilEntryProperties(0, entryProps->props, 0);
       MDTuple *pSig = m_pMDHelper->EmitDxilSignatures(entryProps->sig);
 
@@ -1535,7 +1552,7 @@ void DxilModule::LoadDxilMetadata() {
     IFTBOOL(pEntries->getNumOperands() == 1, DXC_E_INCORRECT_DXIL_METADATA);
   }
   Function *pEntryFunc;
-  string EntryName;
+  StringRef EntryName;
   const llvm::MDOperand *pEntrySignatures, *pEntryResources, *pEntryProperties;
   m_pMDHelper->GetDxilEntryPoint(pEntries->getOperand(0),
                                  pEntryFunc, EntryName,
@@ -1565,7 +1582,7 @@ void DxilModule::LoadDxilMetadata() {
   if (loadedSM->IsLib()) {
     for (unsigned i = 1; i < pEntries->getNumOperands(); i++) {
       Function *pFunc;
-      string Name;
+      StringRef Name;
       const llvm::MDOperand *pSignatures, *pResources, *pProperties;
       m_pMDHelper->GetDxilEntryPoint(pEntries->getOperand(i), pFunc, Name,
                                      pSignatures, pResources, pProperties);
@@ -1843,6 +1860,7 @@ void DxilModule::LoadDxilResources(const llvm::MDOperand &MDO) {
 
   // Load SRV records.
   if (pSRVs != nullptr) {
+    m_SRVs.reserve(m_SRVs.size() + pSRVs->getNumOperands());
     for (unsigned i = 0; i < pSRVs->getNumOperands(); i++) {
       unique_ptr<DxilResource> pSRV(new DxilResource);
       m_pMDHelper->LoadDxilSRV(pSRVs->getOperand(i), *pSRV);
@@ -1852,6 +1870,7 @@ void DxilModule::LoadDxilResources(const llvm::MDOperand &MDO) {
 
   // Load UAV records.
   if (pUAVs != nullptr) {
+    m_UAVs.reserve(m_UAVs.size() + pUAVs->getNumOperands());
     for (unsigned i = 0; i < pUAVs->getNumOperands(); i++) {
       unique_ptr<DxilResource> pUAV(new DxilResource);
       m_pMDHelper->LoadDxilUAV(pUAVs->getOperand(i), *pUAV);
@@ -1861,6 +1880,7 @@ void DxilModule::LoadDxilResources(const llvm::MDOperand &MDO) {
 
   // Load CBuffer records.
   if (pCBuffers != nullptr) {
+    m_CBuffers.reserve(m_CBuffers.size() + pCBuffers->getNumOperands());
     for (unsigned i = 0; i < pCBuffers->getNumOperands(); i++) {
       unique_ptr<DxilCBuffer> pCB(new DxilCBuffer);
       m_pMDHelper->LoadDxilCBuffer(pCBuffers->getOperand(i), *pCB);
@@ -1870,6 +1890,7 @@ void DxilModule::LoadDxilResources(const llvm::MDOperand &MDO) {
 
   // Load Sampler records.
   if (pSamplers != nullptr) {
+    m_Samplers.reserve(m_Samplers.size() + pSamplers->getNumOperands());
     for (unsigned i = 0; i < pSamplers->getNumOperands(); i++) {
       unique_ptr<DxilSampler> pSampler(new DxilSampler);
       m_pMDHelper->LoadDxilSampler(pSamplers->getOperand(i), *pSampler);
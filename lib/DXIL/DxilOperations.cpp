@@ -1013,7 +1013,11 @@ void OP::FixOverloadNames() {
 }
 
 void OP::UpdateCache(OpCodeClass opClass, Type * Ty, llvm::Function *F) {
-  m_OpCodeClassCache[(unsigned)opClass].pOverloads[Ty] = F;
+  OpCodeCacheItem &Item = m_OpCodeClassCache[(unsigned)opClass];
+  Item.pOverloads[Ty] = F;
+  unsigned TypeSlot = GetTypeSlot(Ty);
+  if (TypeSlot < kUserDefineTypeSlot)
+    Item.pSlotOverloads[TypeSlot] = F;
   m_FunctionToOpClass[F] = opClass;
 }
 
@@ -1022,11 +1026,16 @@ Function *OP::GetOpFunc(OpCode opCode, Type *pOverloadType) {
   _Analysis_assume_(0 <= (unsigned)opCode && opCode < OpCode::NumOpCodes);
   DXASSERT(IsOverloadLegal(opCode, pOverloadType), "otherwise the caller requested illegal operation overload (eg HLSL function with unsupported types for mapped intrinsic function)");
   OpCodeClass opClass = m_OpCodeProps[(unsigned)opCode].opCodeClass;
-  Function *&F = m_OpCodeClassCache[(unsigned)opClass].pOverloads[pOverloadType];
-  if (F != nullptr) {
-    UpdateCache(opClass, pOverloadType, F);
+  OpCodeCacheItem &Item = m_OpCodeClassCache[(unsigned)opClass];
+  // Most overloads are scalar types, found directly by slot.
+  unsigned TypeSlot = GetTypeSlot(pOverloadType);
+  if (TypeSlot < kUserDefineTypeSlot && Item.pSlotOverloads[TypeSlot])
+    return Item.pSlotOverloads[TypeSlot];
+
+  Function *&F = Item.pOverloads[pOverloadType];
+  // Both caches are always updated together, so a hit needs no update.
+  if (F != nullptr)
     return F;
-  }
 
   vector<Type*> ArgTypes;      // RetType is ArgTypes[0]
   Type *pETy = pOverloadType;
@@ -1483,6 +1492,9 @@ void OP::RemoveFunction(Function *F) {
     OpCodeClass opClass = m_FunctionToOpClass[F];
     for (auto it : m_OpCodeClassCache[(unsigned)opClass].pOverloads) {
       if (it.second == F) {
+        unsigned TypeSlot = GetTypeSlot(it.first);
+        if (TypeSlot < kUserDefineTypeSlot)
+          m_OpCodeClassCache[(unsigned)opClass].pSlotOverloads[TypeSlot] = nullptr;
         m_OpCodeClassCache[(unsigned)opClass].pOverloads.erase(it.first);
         m_FunctionToOpClass.erase(F);
         break;
@@ -61,7 +61,7 @@ void DxilResourceBase::SetSpaceID(unsigned SpaceID)               { m_SpaceID =
 void DxilResourceBase::SetLowerBound(unsigned LB)                 { m_LowerBound = LB; }
 void DxilResourceBase::SetRangeSize(unsigned RangeSize)           { m_RangeSize = RangeSize; }
 void DxilResourceBase::SetGlobalSymbol(llvm::Constant *pGV)       { m_pSymbol = pGV; }
-void DxilResourceBase::SetGlobalName(const std::string &Name)     { m_Name = Name; }
+void DxilResourceBase::SetGlobalName(llvm::StringRef Name)        { m_Name.assign(Name.data(), Name.size()); }
 void DxilResourceBase::SetHandle(llvm::Value *pHandle)            { m_pHandle = pHandle; }
 void DxilResourceBase::SetHLSLType(llvm::Type *pTy)               { m_pHLSLTy = pTy; }
 
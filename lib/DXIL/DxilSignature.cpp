@@ -74,6 +74,10 @@ unsigned DxilSignature::AppendElement(std::unique_ptr<DxilSignatureElement> pSE,
   return Id;
 }
 
+void DxilSignature::ReserveElements(unsigned NumElements) {
+  m_Elements.reserve(m_Elements.size() + NumElements);
+}
+
 DxilSignatureElement &DxilSignature::GetElement(unsigned idx) {
   return *m_Elements[idx];
 }
@@ -43,6 +43,7 @@ DxilMatrixAnnotation::DxilMatrixAnnotation()
 //
 DxilFieldAnnotation::DxilFieldAnnotation()
 : m_bPrecise(false)
+, m_bDefaultMatrixOrientation(false)
 , m_ResourceAttribute(nullptr)
 , m_CBufferOffset(UINT_MAX)
 , m_bCBufferVarUsed(false)
@@ -53,6 +54,8 @@ void DxilFieldAnnotation::SetPrecise(bool b) { m_bPrecise = b; }
 bool DxilFieldAnnotation::HasMatrixAnnotation() const { return m_Matrix.Cols != 0; }
 const DxilMatrixAnnotation &DxilFieldAnnotation::GetMatrixAnnotation() const { return m_Matrix; }
 void DxilFieldAnnotation::SetMatrixAnnotation(const DxilMatrixAnnotation &MA) { m_Matrix = MA; }
+bool DxilFieldAnnotation::HasDefaultMatrixOrientation() const { return m_bDefaultMatrixOrientation; }
+void DxilFieldAnnotation::SetDefaultMatrixOrientation(bool b) { m_bDefaultMatrixOrientation = b; }
 bool DxilFieldAnnotation::HasResourceAttribute() const {
   return m_ResourceAttribute;
 }
@@ -307,6 +310,7 @@ DxilTypeSystem::DxilTypeSystem(Module *pModule)
 
 DxilStructAnnotation *DxilTypeSystem::AddStructAnnotation(const StructType *pStructType, unsigned numTemplateArgs) {
   DXASSERT_NOMSG(m_StructAnnotations.find(pStructType) == m_StructAnnotations.end());
+  m_FieldPathCache.clear();
   DxilStructAnnotation *pA = new DxilStructAnnotation();
   m_StructAnnotations[pStructType] = unique_ptr<DxilStructAnnotation>(pA);
   pA->m_pStructType = pStructType;
@@ -351,6 +355,7 @@ DxilTypeSystem::GetStructAnnotation(const StructType *pStructType) const {
 
 void DxilTypeSystem::EraseStructAnnotation(const StructType *pStructType) {
   DXASSERT_NOMSG(m_StructAnnotations.count(pStructType));
+  m_FieldPathCache.clear();
   m_StructAnnotations.remove_if([pStructType](
       const std::pair<const StructType *, std::unique_ptr<DxilStructAnnotation>>
           &I) { return pStructType == I.first; });
@@ -401,13 +406,18 @@ void DxilTypeSystem::EraseUnusedStructAnnotations() {
       RemoveUsedStructsFromSet(argTy, unused_structs);
     }
   }
-  // erase remaining structures in set
-  for (auto *ST : unused_structs) {
-    EraseStructAnnotation(ST);
-  }
+  // erase remaining structures in set, in a single pass over the map
+  if (unused_structs.empty())
+    return;
+  m_FieldPathCache.clear();
+  m_StructAnnotations.remove_if([&unused_structs](
+      const std::pair<const StructType *, std::unique_ptr<DxilStructAnnotation>>
+          &I) { return unused_structs.count(I.first) != 0; });
 }
 
 DxilTypeSystem::StructAnnotationMap &DxilTypeSystem::GetStructAnnotationMap() {
+  // The caller may add or erase annotations through the map.
+  m_FieldPathCache.clear();
   return m_StructAnnotations;
 }
 
@@ -415,6 +425,33 @@ const DxilTypeSystem::StructAnnotationMap &DxilTypeSystem::GetStructAnnotationMa
   return m_StructAnnotations;
 }
 
+DxilFieldAnnotation *
+DxilTypeSystem::GetFieldAnnotation(const Type *Ty, ArrayRef<unsigned> Indices) {
+  FieldPathKey Key(Ty, std::vector<unsigned>(Indices.begin(), Indices.end()));
+  auto It = m_FieldPathCache.find(Key);
+  if (It != m_FieldPathCache.end())
+    return It->second;
+
+  DxilFieldAnnotation *pField = nullptr;
+  for (unsigned Idx : Indices) {
+    if (const StructType *ST = dyn_cast<StructType>(Ty)) {
+      // Structs without annotations, like matrices and resources, are
+      // reached as a whole through the field holding them.
+      DxilStructAnnotation *pSA = GetStructAnnotation(ST);
+      if (!pSA || Idx >= pSA->GetNumFields())
+        break;
+      pField = &pSA->GetFieldAnnotation(Idx);
+      Ty = ST->getElementType(Idx);
+    } else if (const SequentialType *SeqTy = dyn_cast<SequentialType>(Ty)) {
+      Ty = SeqTy->getElementType();
+    } else {
+      break;
+    }
+  }
+  m_FieldPathCache[std::move(Key)] = pField;
+  return pField;
+}
+
 DxilPayloadAnnotation *DxilTypeSystem::AddPayloadAnnotation(const StructType *pStructType) {
   DXASSERT_NOMSG(m_PayloadAnnotations.find(pStructType) == m_PayloadAnnotations.end());
   DxilPayloadAnnotation *pA = new DxilPayloadAnnotation();
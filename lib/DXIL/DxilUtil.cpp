@@ -208,7 +208,12 @@ std::unique_ptr<llvm::Module> LoadModuleFromBitcodeLazy(std::unique_ptr<llvm::Me
   llvm::LLVMContext &Ctx, std::string &DiagStr)
 {
   // Note: the DiagStr is not used.
-  auto pModule = llvm::getLazyBitcodeModule(std::move(MB), Ctx, nullptr, true);
+  // Metadata is loaded on demand, so named metadata and each function bring
+  // in only the metadata they refer to.
+  auto pModule = llvm::getLazyBitcodeModule(
+      std::move(MB), Ctx, nullptr, /*ShouldLazyLoadMetadata*/ true,
+      /*ShouldTrackBitstreamUsage*/ false,
+      /*ShouldLoadMetadataOnDemand*/ true);
   if (!pModule) {
     return nullptr;
   }
@@ -22,6 +22,9 @@
 
 #ifdef _WIN32
 #include <intsafe.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 #define CP_UTF16 1200
@@ -190,6 +193,17 @@ bool IsUtfBufferEmptyString(LPCVOID pBuffer, SIZE_T size) {
   return (size == 0 || (size == sizeof(_char) &&
     reinterpret_cast<const _char*>(pBuffer)[0] == 0));
 }
+// 7-bit ASCII is encoded identically in UTF-8 and every ANSI code page, so an
+// ASCII buffer can be used as UTF-8 without conversion.
+static bool IsBufferAscii(LPCVOID pBuffer, SIZE_T size) {
+  const uint8_t *pBytes = (const uint8_t *)pBuffer;
+  for (SIZE_T i = 0; i < size; ++i) {
+    if (pBytes[i] & 0x80)
+      return false;
+  }
+  return true;
+}
+
 static bool IsBufferEmptyString(LPCVOID pBuffer, SIZE_T size, UINT32 codePage) {
   switch (codePage) {
   case DXC_CP_UTF8: return IsUtfBufferEmptyString<char>(pBuffer, size);
@@ -348,6 +362,110 @@ typedef InternalDxcBlobEncoding_Impl<DxcBlobNoEncoding_Impl> InternalDxcBlobEnco
 typedef InternalDxcBlobEncoding_Impl<DxcBlobUtf16_Impl> InternalDxcBlobUtf16;
 typedef InternalDxcBlobEncoding_Impl<DxcBlobUtf8_Impl> InternalDxcBlobUtf8;
 
+// Owns a read-only view of a file. The view stays valid for the lifetime of
+// the blob, so encoding blobs may layer over it without copying.
+class MappedFileBlob : public IDxcBlob {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  LPVOID m_pView = nullptr;
+  SIZE_T m_ViewSize = 0;
+  SIZE_T m_BufferSize = 0;
+  bool m_HasTrailingNull = false;
+public:
+  // Smaller files are cheaper to read than to map, and mapping them
+  // fragments the address space.
+  static const DWORD MinMappedFileSize = 4 * 4096;
+
+  DXC_MICROCOM_ADDREF_IMPL(m_dwRef)
+  ULONG STDMETHODCALLTYPE Release() override {
+    // Because blobs are also used by tests and utilities, we avoid using TLS.
+    ULONG result = (ULONG)--m_dwRef;
+    if (result == 0) {
+      CComPtr<IMalloc> pTmp(m_pMalloc);
+      this->~MappedFileBlob();
+      pTmp->Free(this);
+    }
+    return result;
+  }
+  DXC_MICROCOM_TM_CTOR(MappedFileBlob)
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcBlob>(this, iid, ppvObject);
+  }
+
+  ~MappedFileBlob() {
+    if (m_pView == nullptr)
+      return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_pView);
+#else
+    munmap(m_pView, m_ViewSize);
+#endif
+  }
+
+  // Returns S_FALSE without mapping anything if the file is too small to be
+  // worth mapping.
+  HRESULT Map(_In_z_ LPCWSTR pFileName) {
+    HANDLE hFile = CreateFileW(pFileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+      return HRESULT_FROM_WIN32(GetLastError());
+    CHandle h(hFile);
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(hFile, &FileSize))
+      return HRESULT_FROM_WIN32(GetLastError());
+    if (FileSize.u.HighPart != 0)
+      return DXC_E_INPUT_FILE_TOO_LARGE;
+    if (FileSize.u.LowPart < MinMappedFileSize)
+      return S_FALSE;
+
+#ifdef _WIN32
+    HANDLE hMapping =
+        CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping == NULL)
+      return HRESULT_FROM_WIN32(GetLastError());
+    CHandle hm(hMapping);
+    LPVOID pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (pView == nullptr)
+      return HRESULT_FROM_WIN32(GetLastError());
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    DWORD PageSize = SystemInfo.dwPageSize;
+#else
+    LPVOID pView = mmap(nullptr, FileSize.u.LowPart, PROT_READ, MAP_PRIVATE,
+                        (int)(size_t)hFile, 0);
+    if (pView == MAP_FAILED)
+      return HRESULT_FROM_WIN32(GetLastError());
+    DWORD PageSize = (DWORD)sysconf(_SC_PAGESIZE);
+#endif
+
+    m_pView = pView;
+    m_ViewSize = m_BufferSize = FileSize.u.LowPart;
+    // The unused tail of the last page is zero-filled, so unless the file
+    // ends on a page boundary the view is already null-terminated.
+    m_HasTrailingNull = (m_ViewSize & (PageSize - 1)) != 0;
+    return S_OK;
+  }
+
+  // Makes the buffer include the byte past the end of the file, if it is part
+  // of the view. Returns true if the buffer is now null-terminated.
+  bool IncludeTrailingNull() {
+    if (!m_HasTrailingNull)
+      return false;
+    DXASSERT(((const char *)m_pView)[m_ViewSize] == '\0',
+             "otherwise, page tail is not zero-filled");
+    m_BufferSize = m_ViewSize + 1;
+    return true;
+  }
+
+  LPVOID STDMETHODCALLTYPE GetBufferPointer(void) override {
+    return m_pView;
+  }
+  SIZE_T STDMETHODCALLTYPE GetBufferSize(void) override {
+    return m_BufferSize;
+  }
+};
+
 static HRESULT CodePageBufferToUtf16(UINT32 codePage, LPCVOID bufferPointer,
                                      SIZE_T bufferSize,
                                      CDxcMallocHeapPtr<WCHAR> &utf16NewCopy,
@@ -531,6 +649,7 @@ HRESULT DxcCreateBlob(
     InternalDxcBlobEncoding *pInternalEncoding;
     IFR(InternalDxcBlobEncoding::CreateFromMalloc(nullptr, pMalloc, 0, encodingKnown, codePage, &pInternalEncoding));
     *ppBlobEncoding = pInternalEncoding;
+    return S_OK;
   }
 
   if (bPinned) {
@@ -757,6 +876,55 @@ HRESULT DxcCreateBlobFromFile(LPCWSTR pFileName, UINT32 *pCodePage,
   return DxcCreateBlobFromFile(DxcGetThreadMallocNoRef(), pFileName, pCodePage, ppBlobEncoding);
 }
 
+_Use_decl_annotations_
+HRESULT
+DxcCreateBlobFromFileMapping(IMalloc *pMalloc, LPCWSTR pFileName,
+                             UINT32 *pCodePage,
+                             IDxcBlobEncoding **ppBlobEncoding) throw() {
+  if (pFileName == nullptr || ppBlobEncoding == nullptr) {
+    return E_POINTER;
+  }
+  *ppBlobEncoding = nullptr;
+
+  if (!pMalloc)
+    pMalloc = DxcGetThreadMallocNoRef();
+
+  CComPtr<MappedFileBlob> pMapped = MappedFileBlob::Alloc(pMalloc);
+  IFROOM(pMapped.p);
+  HRESULT hr = pMapped->Map(pFileName);
+  IFR(hr);
+  if (hr == S_FALSE)
+    return DxcCreateBlobFromFile(pMalloc, pFileName, pCodePage, ppBlobEncoding);
+
+  LPCVOID pData = pMapped->GetBufferPointer();
+  SIZE_T dataSize = pMapped->GetBufferSize();
+  bool known = (pCodePage != nullptr);
+  UINT32 codePage = known ? *pCodePage : CP_ACP;
+  if (!known) {
+    codePage = DxcCodePageFromBytes((const char *)pData, dataSize);
+    if (codePage == CP_ACP && IsBufferAscii(pData, dataSize)) {
+      codePage = CP_UTF8;
+      known = true;
+    }
+  }
+
+  // UTF-8 text can be handed out in place, so later conversions to UTF-8 and
+  // the compiler reference the mapped pages instead of copying them.
+  if (known && codePage == CP_UTF8 && pMapped->IncludeTrailingNull()) {
+    InternalDxcBlobUtf8 *internalUtf8;
+    IFR(InternalDxcBlobUtf8::CreateFromBlob(pMapped, pMalloc, true, codePage,
+                                            &internalUtf8));
+    *ppBlobEncoding = internalUtf8;
+    return S_OK;
+  }
+
+  InternalDxcBlobEncoding *internalEncoding;
+  IFR(InternalDxcBlobEncoding::CreateFromBlob(pMapped, pMalloc, known, codePage,
+                                              &internalEncoding));
+  *ppBlobEncoding = internalEncoding;
+  return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT
 DxcCreateBlobWithEncodingSet(IMalloc *pMalloc, IDxcBlob *pBlob, UINT32 codePage,
@@ -860,6 +1028,10 @@ HRESULT DxcGetBlobAsUtf8(IDxcBlob *pBlob, IMalloc *pMalloc, IDxcBlobUtf8 **pBlob
   if (!known) {
     codePage = DxcCodePageFromBytes((char *)pBlob->GetBufferPointer(), blobLen);
   }
+  if (codePage == CP_ACP && IsBufferAscii(pBlob->GetBufferPointer(), blobLen)) {
+    // Skip the round trip through UTF-16.
+    codePage = CP_UTF8;
+  }
 
   if (!pMalloc)
     pMalloc = DxcGetThreadMallocNoRef();
@@ -1006,11 +1178,30 @@ bool IsBlobNullOrEmpty(_In_opt_ IDxcBlob *pBlob) throw() {
 
 class MemoryStream : public AbstractMemoryStream, public IDxcBlob {
 private:
+  // Once the buffer holds kMinChunkedSize bytes, growing it further would
+  // copy ever larger contents, so appends past its end go to a list of
+  // chunks instead. The chunks are joined into the buffer, with a single
+  // copy, when the contents are first needed in one piece: by GetPtr,
+  // GetBufferPointer, Detach, or any access other than appending. CopyTo
+  // writes the chunks out as they are.
+  static const ULONG kMinChunkedSize = 1024 * 1024;
+  static const ULONG kMaxChunkSize = 16 * 1024 * 1024;
+
+  struct Chunk {
+    Chunk *pNext;
+    ULONG size;
+    ULONG capacity;
+    LPBYTE Data() { return reinterpret_cast<LPBYTE>(this + 1); }
+  };
+
   DXC_MICROCOM_TM_REF_FIELDS()
   LPBYTE m_pMemory = nullptr;
   ULONG m_offset = 0;
-  ULONG m_size = 0;
+  ULONG m_size = 0;       // Including the bytes in chunks.
   ULONG m_allocSize = 0;
+  Chunk *m_pFirstChunk = nullptr;
+  Chunk *m_pLastChunk = nullptr;
+  ULONG m_chunkedSize = 0;
 public:
   DXC_MICROCOM_ADDREF_IMPL(m_dwRef)
   ULONG STDMETHODCALLTYPE Release() override {
@@ -1040,10 +1231,21 @@ public:
       targetSize = m_allocSize * 2;
     }
 
-    return Reserve(targetSize);
+    return ReserveBuffer(targetSize);
+  }
+
+  void FreeChunks() {
+    for (Chunk *pChunk = m_pFirstChunk; pChunk != nullptr;) {
+      Chunk *pNext = pChunk->pNext;
+      m_pMalloc->Free(pChunk);
+      pChunk = pNext;
+    }
+    m_pFirstChunk = m_pLastChunk = nullptr;
+    m_chunkedSize = 0;
   }
 
   void Reset() {
+    FreeChunks();
     if (m_pMemory != nullptr) {
       m_pMalloc->Free(m_pMemory);
     }
@@ -1053,8 +1255,85 @@ public:
     m_allocSize = 0;
   }
 
+  HRESULT ReserveBuffer(ULONG targetSize) throw() {
+    if (m_pMemory == nullptr) {
+      m_pMemory = (LPBYTE)m_pMalloc->Alloc(targetSize);
+      if (m_pMemory == nullptr) {
+        return E_OUTOFMEMORY;
+      }
+    }
+    else {
+      void* newPtr = m_pMalloc->Realloc(m_pMemory, targetSize);
+      if (newPtr == nullptr) {
+        return E_OUTOFMEMORY;
+      }
+      m_pMemory = (LPBYTE)newPtr;
+    }
+
+    m_allocSize = targetSize;
+
+    return S_OK;
+  }
+
+  // Appends cb bytes at the end, in chunks.
+  HRESULT AppendToChunks(const BYTE *pv, ULONG cb) throw() {
+    ULONG cbLeft = m_pLastChunk ? m_pLastChunk->capacity - m_pLastChunk->size : 0;
+    ULONG cbHere = std::min(cb, cbLeft);
+    Chunk *pNewChunk = nullptr;
+    if (cb > cbHere) {
+      // Allocate first, so a failure leaves the contents as they were.
+      ULONG capacity = std::min(std::max(m_size / 4, kMinChunkedSize),
+                                kMaxChunkSize);
+      capacity = std::max(capacity, cb - cbHere);
+      pNewChunk = (Chunk *)m_pMalloc->Alloc(sizeof(Chunk) + (SIZE_T)capacity);
+      if (pNewChunk == nullptr) {
+        return E_OUTOFMEMORY;
+      }
+      pNewChunk->pNext = nullptr;
+      pNewChunk->size = 0;
+      pNewChunk->capacity = capacity;
+    }
+    if (cbHere) {
+      memcpy(m_pLastChunk->Data() + m_pLastChunk->size, pv, cbHere);
+      m_pLastChunk->size += cbHere;
+    }
+    if (pNewChunk) {
+      memcpy(pNewChunk->Data(), pv + cbHere, cb - cbHere);
+      pNewChunk->size = cb - cbHere;
+      if (m_pLastChunk)
+        m_pLastChunk->pNext = pNewChunk;
+      else
+        m_pFirstChunk = pNewChunk;
+      m_pLastChunk = pNewChunk;
+    }
+    m_chunkedSize += cb;
+    return S_OK;
+  }
+
+  // Joins the chunks into the buffer, making it at least minAllocSize.
+  HRESULT Flatten(ULONG minAllocSize = 0) throw() {
+    if (m_pFirstChunk == nullptr) {
+      return S_OK;
+    }
+    ULONG bufferSize = m_size - m_chunkedSize;
+    ULONG targetSize = std::max(m_size, minAllocSize);
+    if (targetSize > m_allocSize) {
+      HRESULT hr = ReserveBuffer(targetSize);
+      if (FAILED(hr)) return hr;
+    }
+    LPBYTE pDest = m_pMemory + bufferSize;
+    for (Chunk *pChunk = m_pFirstChunk; pChunk != nullptr;
+         pChunk = pChunk->pNext) {
+      memcpy(pDest, pChunk->Data(), pChunk->size);
+      pDest += pChunk->size;
+    }
+    FreeChunks();
+    return S_OK;
+  }
+
   // AbstractMemoryStream implementation.
   LPBYTE GetPtr() throw() override {
+    if (FAILED(Flatten())) return nullptr;
     return m_pMemory;
   }
 
@@ -1063,6 +1342,7 @@ public:
   }
 
   LPBYTE Detach() throw() override {
+    if (FAILED(Flatten())) return nullptr;
     LPBYTE result = m_pMemory;
     m_pMemory = nullptr;
     Reset();
@@ -1074,28 +1354,15 @@ public:
   }
 
   HRESULT Reserve(ULONG targetSize) throw() override {
-    if (m_pMemory == nullptr) {
-      m_pMemory = (LPBYTE)m_pMalloc->Alloc(targetSize);
-      if (m_pMemory == nullptr) {
-        return E_OUTOFMEMORY;
-      }
-    }
-    else {
-      void* newPtr = m_pMalloc->Realloc(m_pMemory, targetSize);
-      if (newPtr == nullptr) {
-        return E_OUTOFMEMORY;
-      }
-      m_pMemory = (LPBYTE)newPtr;
+    if (m_pFirstChunk != nullptr) {
+      return Flatten(targetSize);
     }
-
-    m_allocSize = targetSize;
-
-    return S_OK;
+    return ReserveBuffer(targetSize);
   }
 
   // IDxcBlob implementation. Requires no further writes.
   LPVOID STDMETHODCALLTYPE GetBufferPointer(void) override {
-    return m_pMemory;
+    return GetPtr();
   }
   SIZE_T STDMETHODCALLTYPE GetBufferSize(void) override {
     return m_size;
@@ -1109,6 +1376,8 @@ public:
       *pcbRead = 0;
       return S_FALSE;
     }
+    HRESULT hr = Flatten();
+    if (FAILED(hr)) return hr;
     ULONG cbLeft = m_size - m_offset;
     *pcbRead = std::min(cb, cbLeft);
     memcpy(pv, m_pMemory + m_offset, *pcbRead);
@@ -1118,8 +1387,20 @@ public:
 
   HRESULT STDMETHODCALLTYPE Write(void const* pv, ULONG cb, ULONG* pcbWritten) override {
     if (!pv || !pcbWritten) return E_POINTER;
+    if (m_offset == m_size &&
+        (m_pLastChunk != nullptr ||
+         (cb + m_offset > m_allocSize && m_size >= kMinChunkedSize))) {
+      HRESULT hr = AppendToChunks((const BYTE *)pv, cb);
+      if (FAILED(hr)) return hr;
+      *pcbWritten = cb;
+      m_offset += cb;
+      m_size = m_offset;
+      return S_OK;
+    }
+    HRESULT hr = Flatten();
+    if (FAILED(hr)) return hr;
     if (cb + m_offset > m_allocSize) {
-      HRESULT hr = Grow(cb + m_offset);
+      hr = Grow(cb + m_offset);
       if (FAILED(hr)) return hr;
       // Implicitly extend as needed with zeroes.
       if (m_offset > m_size) {
@@ -1138,8 +1419,11 @@ public:
     if (val.u.HighPart != 0) {
       return E_OUTOFMEMORY;
     }
+    HRESULT hr = Flatten();
+    if (FAILED(hr)) return hr;
     if (val.u.LowPart > m_allocSize) {
-      return Grow(m_allocSize);
+      hr = Grow(val.u.LowPart);
+      if (FAILED(hr)) return hr;
     }
     if (val.u.LowPart < m_size) {
       m_size = val.u.LowPart;
@@ -1152,10 +1436,41 @@ public:
     return S_OK;
   }
 
-  HRESULT STDMETHODCALLTYPE CopyTo(IStream *, ULARGE_INTEGER,
-    ULARGE_INTEGER *,
-    ULARGE_INTEGER *) override {
-    return E_NOTIMPL;
+  // Writes up to cb bytes from the current position to pDest, a piece of
+  // the buffer or a chunk at a time, without joining the chunks.
+  HRESULT STDMETHODCALLTYPE CopyTo(IStream *pDest, ULARGE_INTEGER cb,
+    ULARGE_INTEGER *pcbRead,
+    ULARGE_INTEGER *pcbWritten) override {
+    if (pDest == nullptr) return E_POINTER;
+    UINT64 cbLeft = m_offset < m_size ? m_size - m_offset : 0;
+    cbLeft = std::min<UINT64>(cbLeft, cb.QuadPart);
+    UINT64 cbRead = 0, cbWritten = 0;
+    HRESULT hr = S_OK;
+    // Walk the buffer, then the chunks, as pieces starting at pieceStart.
+    ULONG pieceStart = 0;
+    LPBYTE pPiece = m_pMemory;
+    ULONG pieceSize = m_size - m_chunkedSize;
+    Chunk *pNextChunk = m_pFirstChunk;
+    while (cbLeft != 0 && SUCCEEDED(hr)) {
+      if (m_offset < pieceStart + pieceSize) {
+        ULONG offsetInPiece = m_offset - pieceStart;
+        ULONG cbPiece = (ULONG)std::min<UINT64>(pieceSize - offsetInPiece, cbLeft);
+        ULONG cbPieceWritten = 0;
+        hr = pDest->Write(pPiece + offsetInPiece, cbPiece, &cbPieceWritten);
+        cbRead += cbPiece;
+        cbWritten += cbPieceWritten;
+        cbLeft -= cbPiece;
+        m_offset += cbPiece;
+      }
+      pieceStart += pieceSize;
+      if (pNextChunk == nullptr) break;
+      pPiece = pNextChunk->Data();
+      pieceSize = pNextChunk->size;
+      pNextChunk = pNextChunk->pNext;
+    }
+    if (pcbRead != nullptr) pcbRead->QuadPart = cbRead;
+    if (pcbWritten != nullptr) pcbWritten->QuadPart = cbWritten;
+    return hr;
   }
 
   HRESULT STDMETHODCALLTYPE Commit(DWORD) override { return E_NOTIMPL; }
@@ -1458,6 +1773,36 @@ HRESULT CreateMemoryStream(_In_ IMalloc *pMalloc, _COM_Outptr_ AbstractMemoryStr
   return (*ppResult == nullptr) ? E_OUTOFMEMORY : S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT DxcCreateBlobFromMemoryStream(AbstractMemoryStream *pSource,
+                                      IMalloc *pMalloc, bool encodingKnown,
+                                      UINT32 codePage,
+                                      IDxcBlobEncoding **ppBlobEncoding) throw() {
+  IFRBOOL(pSource && pMalloc && ppBlobEncoding, E_POINTER);
+  *ppBlobEncoding = nullptr;
+
+  if (encodingKnown && (codePage == CP_UTF8 || codePage == CP_UTF16) &&
+      !IsBufferNullTerminated(pSource->GetPtr(), pSource->GetPtrSize(),
+                              codePage)) {
+    static const wchar_t terminator = 0;
+    ULONG cbTerminator = codePage == CP_UTF8 ? sizeof(char) : sizeof(wchar_t);
+    LARGE_INTEGER zero = {};
+    ULONG cbWritten;
+    IFR(pSource->Seek(zero, STREAM_SEEK_END, nullptr));
+    IFR(pSource->Write(&terminator, cbTerminator, &cbWritten));
+  }
+
+  ULONG size = pSource->GetPtrSize();
+  LPBYTE pData = pSource->Detach();
+  if (size && !pData)
+    return E_OUTOFMEMORY;
+  HRESULT hr = DxcCreateBlob(pData, size, false, false, encodingKnown,
+                             codePage, pMalloc, ppBlobEncoding);
+  if (FAILED(hr) && pData)
+    pMalloc->Free(pData);
+  return hr;
+}
+
 HRESULT CreateReadOnlyBlobStream(_In_ IDxcBlob *pSource, _COM_Outptr_ IStream** ppResult) throw() {
   if (pSource == nullptr || ppResult == nullptr) {
     return E_POINTER;
@@ -1484,4 +1829,26 @@ HRESULT CreateFixedSizeMemoryStream(_In_ LPBYTE pBuffer, size_t size, _COM_Outpt
   return (*ppResult == nullptr) ? E_OUTOFMEMORY : S_OK;
 }
 
+HRESULT CopyMemoryStreamTo(_In_ AbstractMemoryStream *pSource, _In_ IStream *pDest) throw() {
+  if (pSource == nullptr || pDest == nullptr) {
+    return E_POINTER;
+  }
+
+  LARGE_INTEGER position, start;
+  position.QuadPart = pSource->GetPosition();
+  start.QuadPart = 0;
+  ULARGE_INTEGER size;
+  size.QuadPart = pSource->GetPtrSize();
+  HRESULT hr = pSource->Seek(start, STREAM_SEEK_SET, nullptr);
+  if (SUCCEEDED(hr)) {
+    hr = pSource->CopyTo(pDest, size, nullptr, nullptr);
+    if (hr == E_NOTIMPL) {
+      ULONG cbWritten;
+      hr = pDest->Write(pSource->GetPtr(), pSource->GetPtrSize(), &cbWritten);
+    }
+  }
+  pSource->Seek(position, STREAM_SEEK_SET, nullptr);
+  return hr;
+}
+
 }  // namespace hlsl
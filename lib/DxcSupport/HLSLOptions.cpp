@@ -20,6 +20,7 @@
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/DXIL/DxilShaderModel.h"
+#include <thread>
 
 using namespace llvm::opt;
 using namespace dxc;
@@ -402,6 +403,9 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
            "else flow above is incorrect");
 
   opts.PreciseOutputs = Args.getAllArgValues(OPT_precise_output);
+  opts.DownstreamInputs = Args.getAllArgValues(OPT_downstream_input);
+  opts.DownstreamShader = Args.getLastArgValue(OPT_downstream_shader);
+  opts.SpecConstants = Args.hasFlag(OPT_spec_constants, OPT_INVALID, false);
 
   // when no-warnings option is present, do not output warnings.
   opts.OutputWarnings = Args.hasFlag(OPT_INVALID, OPT_no_warnings, true);
@@ -428,6 +432,9 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     } else if (Args.getLastArg(OPT_default_linkage)) {
       errors << "library profile required when using -default-linkage option";
       return 1;
+    } else if (Args.getLastArg(OPT_lib_inline_threshold)) {
+      errors << "library profile required when using -lib-inline-threshold option";
+      return 1;
     }
   }
 
@@ -482,14 +489,48 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.OutputReflectionFile = Args.getLastArgValue(OPT_Fre);
   opts.OutputRootSigFile = Args.getLastArgValue(OPT_Frs);
   opts.OutputShaderHashFile = Args.getLastArgValue(OPT_Fsh);
+  opts.OutputTimeReportFile = Args.getLastArgValue(OPT_Ftr);
+  opts.OutputCompileStatsFile = Args.getLastArgValue(OPT_Fst);
+  opts.OutputLineStatsFile = Args.getLastArgValue(OPT_Fls);
+  opts.OutputFingerprintsFile = Args.getLastArgValue(OPT_Ffp);
+  opts.ReuseLibFile = Args.getLastArgValue(OPT_reuse_lib);
+  opts.ReuseLibFingerprintsFile = Args.getLastArgValue(OPT_reuse_lib_fingerprints);
   opts.ShowOptionNames = Args.hasFlag(OPT_fdiagnostics_show_option, OPT_fno_diagnostics_show_option, true);
+  llvm::StringRef errorLimit = Args.getLastArgValue(OPT_ferror_limit_EQ);
+  if (!errorLimit.empty() && errorLimit.getAsInteger(10, opts.ErrorLimit)) {
+    errors << "Invalid count for -ferror-limit=: " << errorLimit;
+    return 1;
+  }
   opts.UseColor = Args.hasFlag(OPT_Cc, OPT_INVALID, false);
   opts.UseInstructionNumbers = Args.hasFlag(OPT_Ni, OPT_INVALID, false);
   opts.UseInstructionByteOffsets = Args.hasFlag(OPT_No, OPT_INVALID, false);
   opts.UseHexLiterals = Args.hasFlag(OPT_Lx, OPT_INVALID, false);
   opts.Preprocess = Args.getLastArgValue(OPT_P);
+  opts.EmitPTH = Args.hasFlag(OPT_emit_pth, OPT_INVALID, false);
+  opts.IncludePTH = Args.getLastArgValue(OPT_include_pth);
+  opts.EmitHLModule = Args.hasFlag(OPT_emit_hl_module, OPT_INVALID, false);
+  opts.FromHLModule = Args.hasFlag(OPT_from_hl_module, OPT_INVALID, false);
+  opts.EmitDependencies = Args.hasFlag(OPT_M, OPT_INVALID, false);
+  opts.OutputDependenciesFile = Args.getLastArgValue(OPT_MF);
+  opts.JobsFile = Args.getLastArgValue(OPT_jobs);
+  opts.ManifestFile = Args.getLastArgValue(OPT_manifest);
+  opts.Serve = Args.hasFlag(OPT_serve, OPT_INVALID, false);
+  llvm::StringRef jobsThreads = Args.getLastArgValue(OPT_jobs_threads);
+  if (!jobsThreads.empty() && jobsThreads.getAsInteger(10, opts.JobsThreads)) {
+    errors << "Invalid thread count for -jobs-threads: " << jobsThreads;
+    return 1;
+  }
+  llvm::StringRef verifyDeterminism =
+      Args.getLastArgValue(OPT_verify_determinism);
+  if (!verifyDeterminism.empty() &&
+      verifyDeterminism.getAsInteger(10, opts.VerifyDeterminism)) {
+    errors << "Invalid compile count for -verify-determinism: "
+           << verifyDeterminism;
+    return 1;
+  }
   opts.AstDump = Args.hasFlag(OPT_ast_dump, OPT_INVALID, false);
   opts.CodeGenHighLevel = Args.hasFlag(OPT_fcgl, OPT_INVALID, false);
+  opts.SyntaxOnly = Args.hasFlag(OPT_fsyntax_only, OPT_INVALID, false);
   opts.AllowPreserveValues = Args.hasFlag(OPT_preserve_intermediate_values, OPT_INVALID, false);
   opts.DebugInfo = Args.hasFlag(OPT__SLASH_Zi, OPT_INVALID, false);
   opts.DebugNameForBinary = Args.hasFlag(OPT_Zsb, OPT_INVALID, false);
@@ -508,6 +549,38 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   if (!limit.empty())
     opts.ScanLimit = std::stoul(std::string(limit));
 
+  opts.UnrollBudget = 0;
+  llvm::StringRef unrollBudget = Args.getLastArgValue(OPT_unroll_budget);
+  if (!unrollBudget.empty() &&
+      unrollBudget.getAsInteger(10, opts.UnrollBudget)) {
+    errors << "Invalid instruction count for -unroll-budget: " << unrollBudget;
+    return 1;
+  }
+
+  opts.LibInlineThreshold = 0;
+  llvm::StringRef libInlineThreshold =
+      Args.getLastArgValue(OPT_lib_inline_threshold);
+  if (!libInlineThreshold.empty() &&
+      libInlineThreshold.getAsInteger(10, opts.LibInlineThreshold)) {
+    errors << "Invalid instruction count for -lib-inline-threshold: "
+           << libInlineThreshold;
+    return 1;
+  }
+
+  opts.ParallelFunctionThreads = 1;
+  llvm::StringRef parallelFunctions =
+      Args.getLastArgValue(OPT_opt_parallel_functions);
+  if (!parallelFunctions.empty()) {
+    if (parallelFunctions.getAsInteger(10, opts.ParallelFunctionThreads)) {
+      errors << "Invalid thread count for -opt-parallel-functions: "
+             << parallelFunctions;
+      return 1;
+    }
+    if (opts.ParallelFunctionThreads == 0)
+      opts.ParallelFunctionThreads =
+          std::max(1u, std::thread::hardware_concurrency());
+  }
+
   for (std::string opt : Args.getAllArgValues(OPT_opt_disable))
     opts.DxcOptimizationToggles[llvm::StringRef(opt).lower()] = false;
 
@@ -582,6 +655,23 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
 
   opts.Exports = Args.getAllArgValues(OPT_exports);
 
+  opts.CompileCacheDir = Args.getLastArgValue(OPT_compile_cache);
+  opts.CompileArena = Args.hasFlag(OPT_compile_arena, OPT_INVALID, false);
+  opts.ReuseContext = Args.hasFlag(OPT_reuse_context, OPT_INVALID, false);
+  if (Arg *A = Args.getLastArg(OPT_memory_limit)) {
+    opts.MemoryStatistics = true;
+    if (llvm::StringRef(A->getValue()).getAsInteger(10, opts.MemoryLimitMB)) {
+      errors << "Invalid size for -memory-limit: " << A->getValue();
+      return 1;
+    }
+  }
+  opts.TimeReport = Args.hasFlag(OPT_ftime_report, OPT_INVALID, false) ||
+                    !opts.OutputTimeReportFile.empty();
+  opts.CompileStats = Args.hasFlag(OPT_fcompile_stats, OPT_INVALID, false) ||
+                      !opts.OutputCompileStatsFile.empty();
+  opts.LineStats = Args.hasFlag(OPT_fline_stats, OPT_INVALID, false) ||
+                   !opts.OutputLineStatsFile.empty();
+
   opts.DefaultLinkage = Args.getLastArgValue(OPT_default_linkage);
   if (!opts.DefaultLinkage.empty()) {
     if (!(opts.DefaultLinkage.equals_lower("internal") ||
@@ -660,10 +750,12 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.RecompileFromBinary = Args.hasFlag(OPT_recompile, OPT_INVALID, false);
   opts.StripDebug = Args.hasFlag(OPT_Qstrip_debug, OPT_INVALID, false);
   opts.EmbedDebug = Args.hasFlag(OPT_Qembed_debug, OPT_INVALID, false);
+  opts.DebugLinesOnly = Args.hasFlag(OPT_Qdebug_lines, OPT_INVALID, false);
   opts.SourceInDebugModule = Args.hasFlag(OPT_Qsource_in_debug_module, OPT_INVALID, false);
   opts.SourceOnlyDebug = Args.hasFlag(OPT_Zs, OPT_INVALID, false);
   opts.PdbInPrivate = Args.hasFlag(OPT_Qpdb_in_private, OPT_INVALID, false);
   opts.StripRootSignature = Args.hasFlag(OPT_Qstrip_rootsignature, OPT_INVALID, false);
+  opts.CompressLibraryBitcode = Args.hasFlag(OPT_Qcompress_bitcode, OPT_INVALID, false);
   opts.StripPrivate = Args.hasFlag(OPT_Qstrip_priv, OPT_INVALID, false);
   opts.StripReflection = Args.hasFlag(OPT_Qstrip_reflect, OPT_INVALID, false);
   opts.KeepReflectionInDxil = Args.hasFlag(OPT_Qkeep_reflect_in_dxil, OPT_INVALID, false);
@@ -676,6 +768,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.LegacyMacroExpansion = Args.hasFlag(OPT_flegacy_macro_expansion, OPT_INVALID, false);
   opts.LegacyResourceReservation = Args.hasFlag(OPT_flegacy_resource_reservation, OPT_INVALID, false);
   opts.ExportShadersOnly = Args.hasFlag(OPT_export_shaders_only, OPT_INVALID, false);
+  opts.LinkTimeOptimization = Args.hasFlag(OPT_flto, OPT_INVALID, false);
   opts.PrintAfterAll = Args.hasFlag(OPT_print_after_all, OPT_INVALID, false);
   opts.ResMayAlias = Args.hasFlag(OPT_res_may_alias, OPT_INVALID, false);
   opts.ResMayAlias = Args.hasFlag(OPT_res_may_alias_, OPT_INVALID, opts.ResMayAlias);
@@ -718,7 +811,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   // ERR_TEMPLATE_VAR_CONFLICT
   // ERR_ATTRIBUTE_PARAM_SIDE_EFFECT
 
-  if ((flagsToInclude & hlsl::options::DriverOption) && opts.InputFile.empty()) {
+  if ((flagsToInclude & hlsl::options::DriverOption) && opts.InputFile.empty() &&
+      opts.JobsFile.empty() && opts.ManifestFile.empty() && !opts.Serve) {
     // Input file is required in arguments only for drivers; APIs take this through an argument.
     errors << "Required input file argument is missing. use -help to get more information.";
     return 1;
@@ -750,8 +844,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
       return 1;
     }
     if (opts.AllResourcesBound || opts.AvoidFlowControl ||
-        opts.CodeGenHighLevel || opts.DebugInfo || opts.DefaultColMajor ||
-        opts.DefaultRowMajor || opts.Defines.size() != 0 ||
+        opts.CodeGenHighLevel || opts.SyntaxOnly || opts.DebugInfo ||
+        opts.DefaultColMajor || opts.DefaultRowMajor || opts.Defines.size() != 0 ||
         opts.DisableOptimizations ||
         !opts.EntryPoint.empty() || !opts.ForceRootSigVer.empty() ||
         opts.PreferFlowControl || !opts.TargetProfile.empty()) {
@@ -763,7 +857,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   // XXX TODO: Sort this out, since it's required for new API, but a separate argument for old APIs.
   if ((flagsToInclude & hlsl::options::DriverOption) &&
       !(flagsToInclude & hlsl::options::RewriteOption) &&
-      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary
+      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.EmitPTH && !opts.EmitDependencies && !opts.RecompileFromBinary &&
+      opts.JobsFile.empty() && opts.ManifestFile.empty() && !opts.Serve
       ) {
     // Target profile is required in arguments only for drivers when compiling;
     // APIs take this through an argument.
@@ -808,6 +903,38 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     opts.ValVerMinor = 0;
   }
 
+  if (opts.EmitDependencies && (!opts.Preprocess.empty() || opts.EmitPTH)) {
+    errors << "-M cannot be used with -P or -emit-pth.";
+    return 1;
+  }
+
+  if (opts.EmitHLModule && opts.FromHLModule) {
+    errors << "-emit-hl-module and -from-hl-module cannot be used together.";
+    return 1;
+  }
+  if ((opts.EmitHLModule || opts.FromHLModule) &&
+      (opts.CodeGenHighLevel || !opts.OutputFingerprintsFile.empty() ||
+       !opts.ReuseLibFile.empty())) {
+    errors << "-emit-hl-module and -from-hl-module cannot be used with -fcgl, -Ffp or -reuse-lib.";
+    return 1;
+  }
+
+  if (opts.SyntaxOnly && (opts.CodeGenHighLevel || opts.EmitHLModule ||
+                          opts.FromHLModule)) {
+    errors << "-fsyntax-only cannot be used with -fcgl, -emit-hl-module or -from-hl-module.";
+    return 1;
+  }
+
+  if (opts.ReuseLibFile.empty() != opts.ReuseLibFingerprintsFile.empty()) {
+    errors << "-reuse-lib and -reuse-lib-fingerprints must be used together.";
+    return 1;
+  }
+  if ((!opts.OutputFingerprintsFile.empty() || !opts.ReuseLibFile.empty()) &&
+      !opts.IsLibraryProfile()) {
+    errors << "-Ffp, -reuse-lib and -reuse-lib-fingerprints require a library profile.";
+    return 1;
+  }
+
   // These targets are only useful as an intermediate step towards linking to matching
   // shader targets without going through target downgrading at link time.
   // Disable lib_6_1 and lib_6_2 if /Vd is not present
@@ -851,6 +978,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.SpirvOptions.flattenResourceArrays =
       Args.hasFlag(OPT_fspv_flatten_resource_arrays, OPT_INVALID, false);
   opts.SpirvOptions.autoShiftBindings = Args.hasFlag(OPT_fvk_auto_shift_bindings, OPT_INVALID, false);
+  opts.SpirvOptions.reuseLegalization =
+      Args.hasFlag(OPT_fspv_reuse_legalization, OPT_INVALID, false);
 
   if (!handleVkShiftArgs(Args, OPT_fvk_b_shift, "b", &opts.SpirvOptions.bShift, errors) ||
       !handleVkShiftArgs(Args, OPT_fvk_t_shift, "t", &opts.SpirvOptions.tShift, errors) ||
@@ -942,6 +1071,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
       Args.hasFlag(OPT_Wno_vk_ignored_features, OPT_INVALID, false) ||
       Args.hasFlag(OPT_Wno_vk_emulated_features, OPT_INVALID, false) ||
       Args.hasFlag(OPT_fvk_auto_shift_bindings, OPT_INVALID, false) ||
+      Args.hasFlag(OPT_fspv_reuse_legalization, OPT_INVALID, false) ||
       !Args.getLastArgValue(OPT_fvk_stage_io_order_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_debug_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_extension_EQ).empty() ||
@@ -968,6 +1098,18 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     return 1;
   }
 
+  if (opts.DebugLinesOnly && !opts.DebugInfo) {
+    errors << "Must enable debug info with /Zi for /Qdebug_lines";
+    return 1;
+  }
+
+#ifdef ENABLE_SPIRV_CODEGEN
+  if (opts.DebugLinesOnly && opts.GenSPIRV) {
+    errors << "/Qdebug_lines is not supported with -spirv";
+    return 1;
+  }
+#endif // ENABLE_SPIRV_CODEGEN
+
   if (opts.DebugInfo && opts.SourceOnlyDebug) {
     errors << "Cannot specify both /Zi and /Zs";
     return 1;
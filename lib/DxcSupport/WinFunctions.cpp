@@ -154,9 +154,19 @@ unsigned char _BitScanForward(unsigned long * Index, unsigned long Mask) {
   return 1;
 }
 
+namespace {
+// As with COM, the task allocator is a single object for the process that
+// is never freed. It keeps no count, so compiles on many threads each
+// holding references to it don't all write to one counter.
+struct CoTaskMalloc : public IMalloc {
+  ULONG AddRef() override { return 1; }
+  ULONG Release() override { return 1; }
+};
+} // namespace
+
 HRESULT CoGetMalloc(DWORD dwMemContext, IMalloc **ppMalloc) {
-  *ppMalloc = new IMalloc;
-  (*ppMalloc)->AddRef();
+  static IMalloc *s_pMalloc = new CoTaskMalloc();
+  *ppMalloc = s_pMalloc;
   return S_OK;
 }
 
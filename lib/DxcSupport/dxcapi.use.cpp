@@ -15,6 +15,9 @@
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/WinFunctions.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <algorithm>
+#include <mutex>
 
 namespace dxc {
 
@@ -100,6 +103,53 @@ void WriteOperationResultToConsole(_In_ IDxcOperationResult *pRewriteResult,
   WriteBlobToConsole(pBlob, STD_OUTPUT_HANDLE);
 }
 
+static llvm::sys::ThreadLocal<DxcConsoleCapture> &GetConsoleCaptureTls() {
+  static llvm::sys::ThreadLocal<DxcConsoleCapture> captureTls;
+  return captureTls;
+}
+
+DxcConsoleCapture::DxcConsoleCapture()
+    : m_pPrevious(GetConsoleCaptureTls().get()) {
+  GetConsoleCaptureTls().set(this);
+}
+
+DxcConsoleCapture::~DxcConsoleCapture() {
+  Flush();
+  GetConsoleCaptureTls().set(m_pPrevious);
+}
+
+void DxcConsoleCapture::Write(const std::string &text, DWORD streamType) {
+  if (streamType != STD_OUTPUT_HANDLE && streamType != STD_ERROR_HANDLE) {
+    throw hlsl::Exception(E_INVALIDARG);
+  }
+  if (m_chunks.empty() || m_chunks.back().StreamType != streamType) {
+    m_chunks.push_back(Chunk{streamType, std::string()});
+  }
+  m_chunks.back().Text += text;
+}
+
+void DxcConsoleCapture::Flush() {
+  if (m_chunks.empty()) {
+    return;
+  }
+  if (m_pPrevious) {
+    for (const Chunk &chunk : m_chunks) {
+      m_pPrevious->Write(chunk.Text, chunk.StreamType);
+    }
+  }
+  else {
+    static std::mutex flushMutex;
+    std::lock_guard<std::mutex> lock(flushMutex);
+    for (const Chunk &chunk : m_chunks) {
+      fputs(chunk.Text.c_str(),
+            chunk.StreamType == STD_OUTPUT_HANDLE ? stdout : stderr);
+    }
+    fflush(stdout);
+    fflush(stderr);
+  }
+  m_chunks.clear();
+}
+
 static void WriteUtf16NullTermToConsole(_In_opt_count_(charCount) const wchar_t *pText,
                                  DWORD streamType) {
   if (pText == nullptr) {
@@ -109,7 +159,11 @@ static void WriteUtf16NullTermToConsole(_In_opt_count_(charCount) const wchar_t
   bool lossy; // Note: even if there was loss,  print anyway
   std::string consoleMessage;
   Unicode::UTF16ToConsoleString(pText, &consoleMessage, &lossy);
-  if (streamType == STD_OUTPUT_HANDLE) {
+  if (DxcConsoleCapture *pCapture = GetConsoleCaptureTls().get()) {
+    consoleMessage += '\n';
+    pCapture->Write(consoleMessage, streamType);
+  }
+  else if (streamType == STD_OUTPUT_HANDLE) {
     fprintf(stdout, "%s\n", consoleMessage.c_str());
   }
   else if (streamType == STD_ERROR_HANDLE) {
@@ -232,6 +286,29 @@ void WriteUtf8ToConsole(_In_opt_count_(charCount) const char *pText,
     return;
   }
 
+  // ASCII reads the same in every console code page, so write it as it is
+  // instead of converting it through UTF-16. Like the converted path, stop at
+  // the first null character.
+  size_t length = strnlen(pText, charCount);
+  if (std::all_of(pText, pText + length,
+                  [](char c) { return (unsigned char)c < 0x80; })) {
+    if (DxcConsoleCapture *pCapture = GetConsoleCaptureTls().get()) {
+      std::string message(pText, length);
+      message += '\n';
+      pCapture->Write(message, streamType);
+      return;
+    }
+    FILE *pStream = streamType == STD_OUTPUT_HANDLE   ? stdout
+                    : streamType == STD_ERROR_HANDLE ? stderr
+                                                     : nullptr;
+    if (pStream == nullptr) {
+      throw hlsl::Exception(E_INVALIDARG);
+    }
+    fwrite(pText, 1, length, pStream);
+    fputc('\n', pStream);
+    return;
+  }
+
   std::string resultToPrint;
   wchar_t *utf16Message = nullptr;
   size_t utf16MessageLen;
@@ -16,10 +16,21 @@
 
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/WinFunctions.h"
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#elif !defined(_WIN32)
+#include <malloc.h>
+#endif
+#include "dxc/Support/microcom.h"
 #include "llvm/Support/ThreadLocal.h"
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 static llvm::sys::ThreadLocal<IMalloc> *g_ThreadMallocTls;
+static llvm::sys::ThreadLocal<IMalloc> *g_ThreadArenaTls;
 static IMalloc *g_pDefaultMalloc;
 
 HRESULT DxcInitThreadMalloc() throw() {
@@ -37,6 +48,17 @@ HRESULT DxcInitThreadMalloc() throw() {
   }
   g_ThreadMallocTls = new(g_ThreadMallocTls) llvm::sys::ThreadLocal<IMalloc>;
 
+  g_ThreadArenaTls = (llvm::sys::ThreadLocal<IMalloc>*)g_pDefaultMalloc->Alloc(sizeof(llvm::sys::ThreadLocal<IMalloc>));
+  if (g_ThreadArenaTls == nullptr) {
+    g_ThreadMallocTls->~ThreadLocal();
+    g_pDefaultMalloc->Free(g_ThreadMallocTls);
+    g_ThreadMallocTls = nullptr;
+    g_pDefaultMalloc->Release();
+    g_pDefaultMalloc = nullptr;
+    return E_OUTOFMEMORY;
+  }
+  g_ThreadArenaTls = new(g_ThreadArenaTls) llvm::sys::ThreadLocal<IMalloc>;
+
   return S_OK;
 }
 
@@ -46,6 +68,9 @@ void DxcCleanupThreadMalloc() throw() {
     g_ThreadMallocTls->~ThreadLocal();
     g_pDefaultMalloc->Free(g_ThreadMallocTls);
     g_ThreadMallocTls = nullptr;
+    g_ThreadArenaTls->~ThreadLocal();
+    g_pDefaultMalloc->Free(g_ThreadArenaTls);
+    g_ThreadArenaTls = nullptr;
   }
 }
 
@@ -91,3 +116,631 @@ DxcThreadMalloc::DxcThreadMalloc(IMalloc *pMallocOrNull) throw() {
 DxcThreadMalloc::~DxcThreadMalloc() {
     DxcSwapThreadMalloc(pPrior, nullptr);
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// Per-invocation arena.
+//
+// Blocks are bump-allocated out of chunks obtained from the prior allocator.
+// Each chunk counts its live blocks, plus one reference held by the arena
+// until it is released; whoever drops the count to zero frees the chunk. This
+// keeps frees cheap while the arena is installed, and lets blocks that escape
+// the invocation (results, lazily-created globals) be freed at any later time
+// and from any thread.
+//
+// Every chunk is also linked into a process-wide list, so that blocks freed
+// after their arena has been uninstalled can be routed back to their chunk.
+
+namespace {
+
+struct ArenaChunk {
+  ArenaChunk *pPrevGlobal;
+  ArenaChunk *pNextGlobal;
+  ArenaChunk *pNextInArena;
+  const void *pOwner;         // arena that carved this chunk; never dereferenced
+  IMalloc *pBacking;          // allocator for this chunk; referenced
+  char *pBegin;
+  char *pEnd;
+  std::atomic<long> Refs;
+};
+
+// Precedes every block handed out by the arena; keeps blocks 16-byte aligned.
+struct ArenaBlockHeader {
+  ArenaChunk *pChunk;
+  size_t Size;
+};
+static const size_t kArenaBlockHeaderSize = 16;
+static_assert(sizeof(ArenaBlockHeader) <= kArenaBlockHeaderSize,
+              "otherwise blocks are misaligned");
+
+static const size_t kArenaMinChunkSize = 64 * 1024;
+static const size_t kArenaMaxChunkSize = 4 * 1024 * 1024;
+// Larger requests go straight to the prior allocator.
+static const size_t kArenaMaxBlockSize = 256 * 1024;
+
+static std::mutex g_ArenaChunksMutex;
+static ArenaChunk *g_pArenaChunks;
+static std::atomic<unsigned> g_ArenaChunkCount;
+
+static size_t ArenaAlignUp(size_t n) { return (n + 15) & ~(size_t)15; }
+
+static ArenaChunk *FindArenaChunkGlobal(const void *p) {
+  // Caller holds g_ArenaChunksMutex.
+  for (ArenaChunk *pChunk = g_pArenaChunks; pChunk; pChunk = pChunk->pNextGlobal) {
+    if (pChunk->pBegin <= p && p < pChunk->pEnd)
+      return pChunk;
+  }
+  return nullptr;
+}
+
+static void ReleaseArenaChunk(ArenaChunk *pChunk) {
+  if (--pChunk->Refs != 0)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(g_ArenaChunksMutex);
+    if (pChunk->pPrevGlobal)
+      pChunk->pPrevGlobal->pNextGlobal = pChunk->pNextGlobal;
+    else
+      g_pArenaChunks = pChunk->pNextGlobal;
+    if (pChunk->pNextGlobal)
+      pChunk->pNextGlobal->pPrevGlobal = pChunk->pPrevGlobal;
+    --g_ArenaChunkCount;
+  }
+  IMalloc *pBacking = pChunk->pBacking;
+  pChunk->~ArenaChunk();
+  pBacking->Free(pChunk);
+  pBacking->Release();
+}
+
+static ArenaChunk *FindAnyArenaChunk(const void *p) {
+  if (g_ArenaChunkCount == 0)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(g_ArenaChunksMutex);
+  return FindArenaChunkGlobal(p);
+}
+
+// Frees p if it is a block in any arena chunk.
+static bool FreeArenaBlockGlobal(void *p) {
+  ArenaChunk *pChunk = FindAnyArenaChunk(p);
+  if (pChunk == nullptr)
+    return false;
+  ReleaseArenaChunk(pChunk);
+  return true;
+}
+
+class DxcArenaMalloc : public IMalloc {
+private:
+  std::atomic<ULONG> m_dwRef;
+  CComPtr<IMalloc> m_pBacking;
+  std::thread::id m_OwnerThread;
+  ArenaChunk *m_pChunks = nullptr; // newest first; owner thread only
+  char *m_pNext = nullptr;         // bump pointer in m_pChunks
+  ArenaBlockHeader *m_pLastBlock = nullptr;
+  size_t m_NextChunkSize = kArenaMinChunkSize;
+  bool m_Released = false;
+
+  bool IsActive() const {
+    return !m_Released && std::this_thread::get_id() == m_OwnerThread;
+  }
+
+  // Finds the chunk of one of this arena's blocks; only valid while active.
+  ArenaChunk *FindChunk(const void *p) const {
+    for (ArenaChunk *pChunk = m_pChunks; pChunk; pChunk = pChunk->pNextInArena) {
+      if (pChunk->pBegin <= p && p < pChunk->pEnd)
+        return pChunk;
+    }
+    return nullptr;
+  }
+
+  // Finds the chunk of a block from this or any other arena.
+  ArenaChunk *FindAnyChunk(const void *p) const {
+    if (IsActive()) {
+      if (ArenaChunk *pChunk = FindChunk(p))
+        return pChunk;
+    }
+    return FindAnyArenaChunk(p);
+  }
+
+  static ArenaBlockHeader *HeaderOf(void *p) {
+    return (ArenaBlockHeader *)((char *)p - kArenaBlockHeaderSize);
+  }
+
+  bool AddChunk(size_t minSize) {
+    size_t size = m_NextChunkSize;
+    while (size < minSize)
+      size *= 2;
+    if (m_NextChunkSize < kArenaMaxChunkSize)
+      m_NextChunkSize *= 2;
+    size_t headerSize = ArenaAlignUp(sizeof(ArenaChunk));
+    void *pMem = m_pBacking->Alloc(headerSize + size + 15);
+    if (pMem == nullptr)
+      return false;
+    ArenaChunk *pChunk = new (pMem) ArenaChunk();
+    pChunk->pOwner = this;
+    pChunk->pBacking = m_pBacking;
+    pChunk->pBacking->AddRef();
+    pChunk->pBegin = (char *)ArenaAlignUp((size_t)pMem + headerSize);
+    pChunk->pEnd = pChunk->pBegin + size;
+    pChunk->Refs = 1;
+    pChunk->pNextInArena = m_pChunks;
+    pChunk->pPrevGlobal = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(g_ArenaChunksMutex);
+      pChunk->pNextGlobal = g_pArenaChunks;
+      if (g_pArenaChunks)
+        g_pArenaChunks->pPrevGlobal = pChunk;
+      g_pArenaChunks = pChunk;
+      ++g_ArenaChunkCount;
+    }
+    m_pChunks = pChunk;
+    m_pNext = pChunk->pBegin;
+    m_pLastBlock = nullptr;
+    return true;
+  }
+
+public:
+  DxcArenaMalloc(IMalloc *pBacking)
+      : m_dwRef(0), m_pBacking(pBacking),
+        m_OwnerThread(std::this_thread::get_id()) {}
+
+  ~DxcArenaMalloc() { ReleaseChunks(); }
+
+  // Drops the arena's reference on each chunk; unused chunks are freed now,
+  // the rest when their last block is freed.
+  void ReleaseChunks() {
+    if (m_Released)
+      return;
+    m_Released = true;
+    ArenaChunk *pChunk = m_pChunks;
+    m_pChunks = nullptr;
+    while (pChunk) {
+      ArenaChunk *pNext = pChunk->pNextInArena;
+      ReleaseArenaChunk(pChunk);
+      pChunk = pNext;
+    }
+  }
+
+  ULONG STDMETHODCALLTYPE AddRef() override { return ++m_dwRef; }
+  ULONG STDMETHODCALLTYPE Release() override {
+    ULONG result = --m_dwRef;
+    if (result == 0) {
+      CComPtr<IMalloc> pTmp(m_pBacking);
+      this->~DxcArenaMalloc();
+      pTmp->Free(this);
+    }
+    return result;
+  }
+  STDMETHODIMP QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(_In_ SIZE_T cb) override {
+    if (!IsActive() || cb > kArenaMaxBlockSize)
+      return m_pBacking->Alloc(cb);
+    size_t needed = kArenaBlockHeaderSize + ArenaAlignUp(cb ? cb : 1);
+    if (m_pChunks == nullptr || (size_t)(m_pChunks->pEnd - m_pNext) < needed) {
+      if (!AddChunk(needed))
+        return nullptr;
+    }
+    ArenaBlockHeader *pHeader = (ArenaBlockHeader *)m_pNext;
+    pHeader->pChunk = m_pChunks;
+    pHeader->Size = cb;
+    m_pNext += needed;
+    m_pLastBlock = pHeader;
+    ++m_pChunks->Refs;
+    return (char *)pHeader + kArenaBlockHeaderSize;
+  }
+
+  void *STDMETHODCALLTYPE Realloc(_In_opt_ void *pv, _In_ SIZE_T cb) override {
+    if (pv == nullptr)
+      return Alloc(cb);
+    if (cb == 0) {
+      Free(pv);
+      return nullptr;
+    }
+    ArenaChunk *pChunk = FindAnyChunk(pv);
+    if (pChunk == nullptr)
+      return m_pBacking->Realloc(pv, cb);
+    ArenaBlockHeader *pHeader = HeaderOf(pv);
+    // Grow or shrink the most recent block in place when it fits.
+    if (IsActive() && pHeader == m_pLastBlock && cb <= kArenaMaxBlockSize) {
+      char *pNewEnd = (char *)pv + ArenaAlignUp(cb);
+      if (pNewEnd <= m_pChunks->pEnd) {
+        pHeader->Size = cb;
+        m_pNext = pNewEnd;
+        return pv;
+      }
+    }
+    void *pNew = Alloc(cb);
+    if (pNew == nullptr)
+      return nullptr;
+    memcpy(pNew, pv, std::min(cb, pHeader->Size));
+    ReleaseArenaChunk(pChunk);
+    return pNew;
+  }
+
+  void STDMETHODCALLTYPE Free(_In_opt_ void *pv) override {
+    if (pv == nullptr)
+      return;
+    if (IsActive()) {
+      ArenaChunk *pChunk = FindChunk(pv);
+      if (pChunk != nullptr) {
+        if (HeaderOf(pv) == m_pLastBlock) {
+          // Reclaim the space of the most recent block.
+          m_pNext = (char *)m_pLastBlock;
+          m_pLastBlock = nullptr;
+        }
+        ReleaseArenaChunk(pChunk);
+        return;
+      }
+    }
+    if (!FreeArenaBlockGlobal(pv))
+      m_pBacking->Free(pv);
+  }
+
+  // True if p points into a chunk carved by this arena.
+  bool Owns(const void *p) const {
+    ArenaChunk *pChunk = FindAnyChunk(p);
+    return pChunk != nullptr && pChunk->pOwner == this;
+  }
+
+#ifdef _WIN32
+  SIZE_T STDMETHODCALLTYPE GetSize(_In_opt_ _Post_writable_byte_size_(return) void *pv) override {
+    if (pv != nullptr && FindAnyChunk(pv) != nullptr)
+      return HeaderOf(pv)->Size;
+    return m_pBacking->GetSize(pv);
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(_In_opt_ void *pv) override {
+    if (pv == nullptr)
+      return -1;
+    return Owns(pv) ? 1 : 0;
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize(void) override {}
+#endif
+};
+
+} // namespace
+
+void DxcThreadFree(void *p) throw() {
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  // The installed arena handles blocks from anywhere; other allocators only
+  // know their own.
+  if (g_ThreadArenaTls == nullptr || pMalloc == g_ThreadArenaTls->get() ||
+      !FreeArenaBlockGlobal(p))
+    pMalloc->Free(p);
+}
+
+DxcThreadArena::DxcThreadArena(bool enable) throw() : pArena(nullptr), pPrior(nullptr), pPriorArena(nullptr) {
+  if (!enable || g_ThreadMallocTls == nullptr)
+    return;
+  IMalloc *pBacking = DxcGetThreadMallocNoRef();
+  void *pMem = pBacking->Alloc(sizeof(DxcArenaMalloc));
+  if (pMem == nullptr)
+    return; // Fall back to the current allocator.
+  pArena = new (pMem) DxcArenaMalloc(pBacking);
+  pArena->AddRef();
+  pPriorArena = g_ThreadArenaTls->get();
+  g_ThreadArenaTls->set(pArena);
+  DxcSwapThreadMalloc(pArena, &pPrior);
+}
+
+bool DxcThreadArena::Owns(const void *p) const throw() {
+  return pArena != nullptr && p != nullptr &&
+         static_cast<DxcArenaMalloc *>(pArena)->Owns(p);
+}
+
+void DxcThreadArena::Release() throw() {
+  if (pArena == nullptr)
+    return;
+  DxcSwapThreadMalloc(pPrior, nullptr);
+  g_ThreadArenaTls->set(pPriorArena);
+  static_cast<DxcArenaMalloc *>(pArena)->ReleaseChunks();
+  pArena->Release();
+  pArena = nullptr;
+}
+
+DxcThreadArena::~DxcThreadArena() {
+  Release();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Per-invocation memory budget.
+//
+// Blocks come straight from the prior allocator, which is asked for their
+// size, so a block may be freed through either allocator. Threads the
+// invocation hands the budget to share its count.
+
+namespace {
+
+// The size of a block from pBacking, or 0 where it can't be found.
+int64_t GetBlockSize(IMalloc *pBacking, void *pv) {
+#ifdef _WIN32
+  SIZE_T size = pBacking->GetSize(pv);
+  return size == (SIZE_T)-1 ? 0 : (int64_t)size;
+#elif defined(__APPLE__)
+  return pBacking == g_pDefaultMalloc ? (int64_t)malloc_size(pv) : 0;
+#else
+  return pBacking == g_pDefaultMalloc ? (int64_t)malloc_usable_size(pv) : 0;
+#endif
+}
+
+void UpdatePeak(std::atomic<int64_t> &peak, int64_t value) {
+  int64_t current = peak;
+  while (value > current && !peak.compare_exchange_weak(current, value)) {
+  }
+}
+
+class DxcBudgetMalloc : public IMalloc {
+private:
+  std::atomic<ULONG> m_dwRef;
+  CComPtr<IMalloc> m_pBacking;
+  uint64_t m_Limit;
+  std::atomic<int64_t> m_Live;
+  std::atomic<int64_t> m_Peak;
+  std::atomic<bool> m_Exceeded;
+
+  int64_t BlockSize(void *pv) { return GetBlockSize(m_pBacking, pv); }
+
+  bool OverLimit(SIZE_T cb) {
+    if (m_Limit != 0 && (uint64_t)std::max<int64_t>(m_Live, 0) + cb > m_Limit) {
+      m_Exceeded = true;
+      return true;
+    }
+    return false;
+  }
+
+  void Add(int64_t size) { UpdatePeak(m_Peak, m_Live += size); }
+
+public:
+  DxcBudgetMalloc(IMalloc *pBacking, uint64_t limit)
+      : m_dwRef(0), m_pBacking(pBacking), m_Limit(limit), m_Live(0),
+        m_Peak(0), m_Exceeded(false) {}
+
+  bool Exceeded() const { return m_Exceeded; }
+  uint64_t GetPeakBytes() const { return (uint64_t)(int64_t)m_Peak; }
+
+  ULONG STDMETHODCALLTYPE AddRef() override { return ++m_dwRef; }
+  ULONG STDMETHODCALLTYPE Release() override {
+    ULONG result = --m_dwRef;
+    if (result == 0) {
+      CComPtr<IMalloc> pTmp(m_pBacking);
+      this->~DxcBudgetMalloc();
+      pTmp->Free(this);
+    }
+    return result;
+  }
+  STDMETHODIMP QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(_In_ SIZE_T cb) override {
+    if (OverLimit(cb))
+      return nullptr;
+    void *pv = m_pBacking->Alloc(cb);
+    if (pv != nullptr)
+      Add(BlockSize(pv));
+    return pv;
+  }
+
+  void *STDMETHODCALLTYPE Realloc(_In_opt_ void *pv, _In_ SIZE_T cb) override {
+    if (pv == nullptr)
+      return Alloc(cb);
+    int64_t oldSize = BlockSize(pv);
+    if ((int64_t)cb > oldSize && OverLimit(cb - oldSize))
+      return nullptr;
+    void *pNew = m_pBacking->Realloc(pv, cb);
+    if (pNew != nullptr || cb == 0)
+      Add((pNew ? BlockSize(pNew) : 0) - oldSize);
+    return pNew;
+  }
+
+  void STDMETHODCALLTYPE Free(_In_opt_ void *pv) override {
+    if (pv == nullptr)
+      return;
+    m_Live -= BlockSize(pv);
+    m_pBacking->Free(pv);
+  }
+
+#ifdef _WIN32
+  SIZE_T STDMETHODCALLTYPE GetSize(_In_opt_ _Post_writable_byte_size_(return) void *pv) override {
+    return m_pBacking->GetSize(pv);
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(_In_opt_ void *pv) override {
+    return m_pBacking->DidAlloc(pv);
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize(void) override {
+    m_pBacking->HeapMinimize();
+  }
+#endif
+};
+
+} // namespace
+
+DxcThreadMemoryBudget::DxcThreadMemoryBudget() throw()
+    : pBudget(nullptr), pPrior(nullptr), exceeded(false), peakBytes(0),
+      limitBytes(0) {}
+
+void DxcThreadMemoryBudget::Install(uint64_t limitBytes) throw() {
+  if (pBudget != nullptr || g_ThreadMallocTls == nullptr)
+    return;
+  IMalloc *pBacking = DxcGetThreadMallocNoRef();
+  void *pMem = pBacking->Alloc(sizeof(DxcBudgetMalloc));
+  if (pMem == nullptr)
+    return; // Run without a budget.
+  pBudget = new (pMem) DxcBudgetMalloc(pBacking, limitBytes);
+  this->limitBytes = limitBytes;
+  pBudget->AddRef();
+  DxcSwapThreadMalloc(pBudget, &pPrior);
+}
+
+bool DxcThreadMemoryBudget::Exceeded() const throw() {
+  if (pBudget != nullptr)
+    return static_cast<DxcBudgetMalloc *>(pBudget)->Exceeded();
+  return exceeded;
+}
+
+uint64_t DxcThreadMemoryBudget::GetPeakBytes() const throw() {
+  if (pBudget != nullptr)
+    return static_cast<DxcBudgetMalloc *>(pBudget)->GetPeakBytes();
+  return peakBytes;
+}
+
+void DxcThreadMemoryBudget::Release() throw() {
+  if (pBudget == nullptr)
+    return;
+  exceeded = static_cast<DxcBudgetMalloc *>(pBudget)->Exceeded();
+  peakBytes = static_cast<DxcBudgetMalloc *>(pBudget)->GetPeakBytes();
+  DxcSwapThreadMalloc(pPrior, nullptr);
+  pBudget->Release();
+  pBudget = nullptr;
+}
+
+DxcThreadMemoryBudget::~DxcThreadMemoryBudget() {
+  Release();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Per-invocation allocation profile.
+//
+// Like the budget, blocks come straight from the prior allocator, so a block
+// may be freed through either allocator. Allocations on threads the
+// invocation hands the profile to count against the tag of the invocation.
+
+namespace {
+
+class DxcProfileMalloc : public IMalloc {
+private:
+  std::atomic<ULONG> m_dwRef;
+  CComPtr<IMalloc> m_pBacking;
+  std::atomic<unsigned> m_Tag;
+  std::atomic<int64_t> m_Live;
+  std::atomic<uint64_t> m_Allocations[DxcThreadAllocProfile::kMaxTags];
+  std::atomic<uint64_t> m_Bytes[DxcThreadAllocProfile::kMaxTags];
+  std::atomic<int64_t> m_LivePeak[DxcThreadAllocProfile::kMaxTags];
+
+  void Count(SIZE_T cb, int64_t sizeDelta) {
+    unsigned tag = m_Tag;
+    ++m_Allocations[tag];
+    m_Bytes[tag] += cb;
+    UpdatePeak(m_LivePeak[tag], m_Live += sizeDelta);
+  }
+
+public:
+  DxcProfileMalloc(IMalloc *pBacking)
+      : m_dwRef(0), m_pBacking(pBacking), m_Tag(0), m_Live(0) {
+    for (unsigned i = 0; i < DxcThreadAllocProfile::kMaxTags; ++i) {
+      m_Allocations[i] = 0;
+      m_Bytes[i] = 0;
+      m_LivePeak[i] = 0;
+    }
+  }
+
+  unsigned SetTag(unsigned tag) { return m_Tag.exchange(tag); }
+
+  DxcThreadAllocProfile::Counters GetCounters(unsigned tag) const {
+    DxcThreadAllocProfile::Counters counters;
+    counters.Allocations = m_Allocations[tag];
+    counters.Bytes = m_Bytes[tag];
+    counters.LivePeakBytes = (uint64_t)std::max<int64_t>(m_LivePeak[tag], 0);
+    return counters;
+  }
+
+  ULONG STDMETHODCALLTYPE AddRef() override { return ++m_dwRef; }
+  ULONG STDMETHODCALLTYPE Release() override {
+    ULONG result = --m_dwRef;
+    if (result == 0) {
+      CComPtr<IMalloc> pTmp(m_pBacking);
+      this->~DxcProfileMalloc();
+      pTmp->Free(this);
+    }
+    return result;
+  }
+  STDMETHODIMP QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(_In_ SIZE_T cb) override {
+    void *pv = m_pBacking->Alloc(cb);
+    if (pv != nullptr)
+      Count(cb, GetBlockSize(m_pBacking, pv));
+    return pv;
+  }
+
+  void *STDMETHODCALLTYPE Realloc(_In_opt_ void *pv, _In_ SIZE_T cb) override {
+    if (pv == nullptr)
+      return Alloc(cb);
+    int64_t oldSize = GetBlockSize(m_pBacking, pv);
+    void *pNew = m_pBacking->Realloc(pv, cb);
+    if (pNew != nullptr)
+      Count(cb, GetBlockSize(m_pBacking, pNew) - oldSize);
+    else if (cb == 0)
+      m_Live -= oldSize;
+    return pNew;
+  }
+
+  void STDMETHODCALLTYPE Free(_In_opt_ void *pv) override {
+    if (pv == nullptr)
+      return;
+    m_Live -= GetBlockSize(m_pBacking, pv);
+    m_pBacking->Free(pv);
+  }
+
+#ifdef _WIN32
+  SIZE_T STDMETHODCALLTYPE GetSize(_In_opt_ _Post_writable_byte_size_(return) void *pv) override {
+    return m_pBacking->GetSize(pv);
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(_In_opt_ void *pv) override {
+    return m_pBacking->DidAlloc(pv);
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize(void) override {
+    m_pBacking->HeapMinimize();
+  }
+#endif
+};
+
+} // namespace
+
+DxcThreadAllocProfile::DxcThreadAllocProfile() throw()
+    : pProfile(nullptr), pPrior(nullptr) {}
+
+void DxcThreadAllocProfile::Install() throw() {
+  if (pProfile != nullptr || g_ThreadMallocTls == nullptr)
+    return;
+  IMalloc *pBacking = DxcGetThreadMallocNoRef();
+  void *pMem = pBacking->Alloc(sizeof(DxcProfileMalloc));
+  if (pMem == nullptr)
+    return; // Run without a profile.
+  pProfile = new (pMem) DxcProfileMalloc(pBacking);
+  pProfile->AddRef();
+  DxcSwapThreadMalloc(pProfile, &pPrior);
+}
+
+unsigned DxcThreadAllocProfile::SetTag(unsigned tag) throw() {
+  if (pProfile == nullptr || tag >= kMaxTags)
+    return 0;
+  return static_cast<DxcProfileMalloc *>(pProfile)->SetTag(tag);
+}
+
+DxcThreadAllocProfile::Counters
+DxcThreadAllocProfile::GetCounters(unsigned tag) const throw() {
+  if (pProfile == nullptr || tag >= kMaxTags)
+    return Counters();
+  return static_cast<DxcProfileMalloc *>(pProfile)->GetCounters(tag);
+}
+
+void DxcThreadAllocProfile::Release() throw() {
+  if (pProfile == nullptr)
+    return;
+  DxcSwapThreadMalloc(pPrior, nullptr);
+  pProfile->Release();
+  pProfile = nullptr;
+}
+
+DxcThreadAllocProfile::~DxcThreadAllocProfile() {
+  Release();
+}
@@ -13,6 +13,7 @@
 #include "dxc/dxcapi.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DxilContainer/DxcContainerBuilder.h"
+#include "dxc/DxilRootSignature/DxilRootSignature.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/ErrorCodes.h"
 #include "dxc/Support/FileIOHelper.h"
@@ -21,9 +22,8 @@
 
 #include <algorithm>
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
 
-// This declaration is used for the locally-linked validator.
-HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
 template <class TInterface>
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ TInterface **ppInterface);
 
@@ -94,6 +94,9 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::RemovePart(_In_ UINT32 fourCC) {
         [&](DxilPart part) { return part.m_fourCC == fourCC; });
     IFTBOOL(it != m_parts.end(), DXC_E_MISSING_PART);
     m_parts.erase(it);
+    if (fourCC == DxilFourCC::DFCC_RootSignature) {
+      m_RequireValidation = false;
+    }
     return S_OK;
   }
   CATCH_CPP_RETURN_HRESULT();
@@ -119,26 +122,24 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
     // Update Parts
     IFT(UpdateParts(pMemoryStream));
 
-    CComPtr<IDxcBlobUtf8> pValErrorUtf8;
+    // Only the root signature can have changed, so it is the only part that
+    // needs checking; once it passes, later serializations skip it.
+    std::string valError;
     HRESULT valHR = S_OK;
     if (m_RequireValidation) {
-      CComPtr<IDxcValidator> pValidator;
-      IFT(CreateDxcValidator(IID_PPV_ARGS(&pValidator)));
-      CComPtr<IDxcOperationResult> pValidationResult;
-      IFT(pValidator->Validate(pResult, DxcValidatorFlags_RootSignatureOnly, &pValidationResult));
-      IFT(pValidationResult->GetStatus(&valHR));
-      if (FAILED(valHR)) {
-        CComPtr<IDxcBlobEncoding> pValError;
-        IFT(pValidationResult->GetErrorBuffer(&pValError));
-        if (pValError->GetBufferPointer() && pValError->GetBufferSize())
-          IFT(hlsl::DxcGetBlobAsUtf8(pValError, m_pMalloc, &pValErrorUtf8));
-      }
+      llvm::raw_string_ostream DiagStream(valError);
+      valHR = ValidateRootSignature(DiagStream);
+      if (FAILED(valHR))
+        DiagStream << "Validation failed.\n";
+      else
+        m_RequireValidation = false;
+      DiagStream.flush();
     }
     // Combine existing warnings and errors from validation
     CComPtr<IDxcBlobEncoding> pErrorBlob;
     CDxcMallocHeapPtr<char> errorHeap(m_pMalloc);
     SIZE_T warningLength = m_warning ? strlen(m_warning) : 0;
-    SIZE_T valErrorLength = pValErrorUtf8 ? pValErrorUtf8->GetStringLength() : 0;
+    SIZE_T valErrorLength = valError.size();
     SIZE_T totalErrorLength = warningLength + valErrorLength;
     if (totalErrorLength) {
       SIZE_T errorSizeInBytes = totalErrorLength + 1;
@@ -146,8 +147,7 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
       if (warningLength)
         memcpy(errorHeap.m_pData, m_warning, warningLength);
       if (valErrorLength)
-        memcpy(errorHeap.m_pData + warningLength,
-               pValErrorUtf8->GetStringPointer(),
+        memcpy(errorHeap.m_pData + warningLength, valError.data(),
                valErrorLength);
       errorHeap.m_pData[totalErrorLength] = L'\0';
       IFT(hlsl::DxcCreateBlobWithEncodingOnMalloc(
@@ -165,6 +165,52 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
   CATCH_CPP_RETURN_HRESULT();
 }
 
+const DxcContainerBuilder::DxilPart *
+DxcContainerBuilder::FindPart(UINT32 fourCC) const {
+  for (const DxilPart &part : m_parts) {
+    if (part.m_fourCC == fourCC)
+      return &part;
+  }
+  return nullptr;
+}
+
+// Checks the root signature against the shader's PSV, or on its own when the
+// container has no shader, as DxcValidatorFlags_RootSignatureOnly does.
+HRESULT DxcContainerBuilder::ValidateRootSignature(llvm::raw_ostream &DiagStream) {
+  const DxilPart *pRSPart = FindPart(DFCC_RootSignature);
+  const DxilPart *pProgramPart = FindPart(DFCC_DXIL);
+  const DxilPart *pPSVPart = FindPart(DFCC_PipelineStateValidation);
+  IFRBOOL(pRSPart, DXC_E_MISSING_PART);
+  if (pProgramPart) {
+    // Container has shader part, make sure we have PSV.
+    IFRBOOL(pProgramPart->m_Blob->GetBufferSize() >= sizeof(DxilProgramHeader),
+            DXC_E_IR_VERIFICATION_FAILED);
+    IFRBOOL(pPSVPart, DXC_E_MISSING_PART);
+  }
+  IDxcBlob *pRS = pRSPart->m_Blob;
+  try {
+    if (pProgramPart) {
+      const DxilProgramHeader *pProgramHeader =
+          (const DxilProgramHeader *)pProgramPart->m_Blob->GetBufferPointer();
+      IDxcBlob *pPSV = pPSVPart->m_Blob;
+      IFRBOOL(VerifySerializedRootSignatureWithShaderPSV(
+                  pRS->GetBufferPointer(), (uint32_t)pRS->GetBufferSize(),
+                  GetVersionShaderType(pProgramHeader->ProgramVersion),
+                  pPSV->GetBufferPointer(), (uint32_t)pPSV->GetBufferSize(),
+                  DiagStream),
+              DXC_E_INCORRECT_ROOT_SIGNATURE);
+    } else {
+      IFRBOOL(VerifySerializedRootSignature(pRS->GetBufferPointer(),
+                                            (uint32_t)pRS->GetBufferSize(),
+                                            DiagStream),
+              DXC_E_INCORRECT_ROOT_SIGNATURE);
+    }
+  } catch (...) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+  return S_OK;
+}
+
 UINT32 DxcContainerBuilder::ComputeContainerSize() {
   UINT32 partsSize = 0;
   for (DxilPart part : m_parts) {
@@ -10,7 +10,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "miniz/miniz.h"
 #include <algorithm>
+#include <new>
 
 namespace hlsl {
 
@@ -127,4 +129,94 @@ DxilProgramHeader *GetDxilProgramHeader(DxilContainerHeader *pHeader, DxilFourCC
       GetDxilProgramHeader(static_cast<const DxilContainerHeader *>(pHeader), fourCC));
 }
 
+// Miniz is built without a default allocator.
+static void *ZlibMalloc(void *opaque, size_t items, size_t size) {
+  return new (std::nothrow) uint8_t[items * size];
+}
+
+static void ZlibFree(void *opaque, void *address) {
+  delete[] (uint8_t *)address;
+}
+
+const DxilProgramHeader *
+GetValidDxilProgramHeader(const DxilProgramHeader *pHeader, uint32_t length,
+                          std::vector<uint32_t> &Storage) {
+  if (IsValidDxilProgramHeader(pHeader, length))
+    return pHeader;
+  if (!IsValidCompressedDxilProgramHeader(pHeader, length))
+    return nullptr;
+  const DxilCompressedBitcodeHeader *pCompressed =
+      reinterpret_cast<const DxilCompressedBitcodeHeader *>(
+          &pHeader->BitcodeHeader + 1);
+  if (pCompressed->CompressType != DxilBitcodeCompressType::Zlib)
+    return nullptr;
+
+  uint32_t bitcodeSize = pCompressed->UncompressedSize;
+  Storage.assign(sizeof(DxilProgramHeader) / sizeof(uint32_t) +
+                     (bitcodeSize + 3) / sizeof(uint32_t),
+                 0);
+  DxilProgramHeader *pExpanded =
+      reinterpret_cast<DxilProgramHeader *>(Storage.data());
+  InitProgramHeader(*pExpanded, pHeader->ProgramVersion,
+                    pHeader->BitcodeHeader.DxilVersion, bitcodeSize);
+
+  z_stream stream = {};
+  stream.zalloc = ZlibMalloc;
+  stream.zfree = ZlibFree;
+  if (inflateInit(&stream) != Z_OK)
+    return nullptr;
+  stream.next_in = (const unsigned char *)GetDxilBitcodeData(pHeader);
+  stream.avail_in = pHeader->BitcodeHeader.BitcodeSize;
+  stream.next_out = (unsigned char *)(pExpanded + 1);
+  stream.avail_out = bitcodeSize;
+  int status = inflate(&stream, Z_FINISH);
+  uLong expandedSize = stream.total_out;
+  inflateEnd(&stream);
+  if (status != Z_STREAM_END || expandedSize != bitcodeSize)
+    return nullptr;
+  return pExpanded;
+}
+
+bool CompressDxilProgramPart(const DxilProgramHeader *pUncompressed,
+                             std::vector<uint32_t> &Program) {
+  const char *pBitcode = GetDxilBitcodeData(pUncompressed);
+  uint32_t bitcodeSize = GetDxilBitcodeSize(pUncompressed);
+  const uint32_t headerSize =
+      sizeof(DxilProgramHeader) + sizeof(DxilCompressedBitcodeHeader);
+  uLong bound = compressBound(bitcodeSize);
+  Program.assign((headerSize + bound + 3) / sizeof(uint32_t), 0);
+
+  z_stream stream = {};
+  stream.zalloc = ZlibMalloc;
+  stream.zfree = ZlibFree;
+  if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+    return false;
+  stream.next_in = (const unsigned char *)pBitcode;
+  stream.avail_in = bitcodeSize;
+  stream.next_out = (unsigned char *)Program.data() + headerSize;
+  stream.avail_out = bound;
+  int status = deflate(&stream, Z_FINISH);
+  uint32_t compressedSize = (uint32_t)stream.total_out;
+  deflateEnd(&stream);
+  if (status != Z_STREAM_END)
+    return false;
+
+  Program.resize((headerSize + compressedSize + 3) / sizeof(uint32_t));
+  DxilProgramHeader *pHeader =
+      reinterpret_cast<DxilProgramHeader *>(Program.data());
+  pHeader->ProgramVersion = pUncompressed->ProgramVersion;
+  pHeader->SizeInUint32 = (uint32_t)Program.size();
+  pHeader->BitcodeHeader.DxilMagic = DxilCompressedMagicValue;
+  pHeader->BitcodeHeader.DxilVersion = pUncompressed->BitcodeHeader.DxilVersion;
+  pHeader->BitcodeHeader.BitcodeOffset =
+      sizeof(DxilBitcodeHeader) + sizeof(DxilCompressedBitcodeHeader);
+  pHeader->BitcodeHeader.BitcodeSize = compressedSize;
+  DxilCompressedBitcodeHeader *pCompressed =
+      reinterpret_cast<DxilCompressedBitcodeHeader *>(
+          &pHeader->BitcodeHeader + 1);
+  pCompressed->CompressType = DxilBitcodeCompressType::Zlib;
+  pCompressed->UncompressedSize = bitcodeSize;
+  return true;
+}
+
 } // namespace hlsl
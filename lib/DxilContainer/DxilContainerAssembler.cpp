@@ -9,6 +9,7 @@
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/IR/Module.h"
@@ -38,6 +39,7 @@
 #include "dxc/DXIL/DxilCounters.h"
 #include <algorithm>
 #include <functional>
+#include <unordered_map>
 
 using namespace llvm;
 using namespace hlsl;
@@ -928,6 +930,7 @@ public:
   void Insert(const T &data) {
     m_rows.push_back(data);
   }
+  const std::vector<T> &GetRows() const { return m_rows; }
 
   void Write(void *ptr) {
     char *pCur = (char*)ptr;
@@ -983,6 +986,7 @@ public:
     m_StringBuffer.push_back('\0');
     return prevIndex;
   }
+  const char *Get(uint32_t offset) const { return m_StringBuffer.data() + offset; }
   RuntimeDataPartType GetType() const { return RuntimeDataPartType::StringBuffer; }
   uint32_t GetPartSize() const { return m_StringBuffer.size(); }
   void Write(void *ptr) { memcpy(ptr, m_StringBuffer.data(), m_StringBuffer.size()); }
@@ -992,28 +996,18 @@ struct IndexArraysPart : public RDATPart {
 private:
   std::vector<uint32_t> m_IndexBuffer;
 
-  // Use m_IndexSet with CmpIndices to avoid duplicate index arrays
-  struct CmpIndices {
-    const IndexArraysPart &Table;
-    CmpIndices(const IndexArraysPart &table) : Table(table) {}
-    bool operator()(uint32_t left, uint32_t right) const {
-      const uint32_t *pLeft = Table.m_IndexBuffer.data() + left;
-      const uint32_t *pRight = Table.m_IndexBuffer.data() + right;
-      if (*pLeft != *pRight)
-        return (*pLeft < *pRight);
-      uint32_t count = *pLeft;
-      for (unsigned i = 0; i < count; i++) {
-        ++pLeft; ++pRight;
-        if (*pLeft != *pRight)
-          return (*pLeft < *pRight);
-      }
-      return false;
-    }
-  };
-  std::set<uint32_t, CmpIndices> m_IndexSet;
+  // Hash of each array's contents to the offsets of the arrays that have it,
+  // so that duplicate arrays are found without comparing against every one.
+  std::unordered_multimap<size_t, uint32_t> m_IndexMap;
+
+  bool IsSameIndexArray(uint32_t left, uint32_t right) const {
+    const uint32_t *pLeft = m_IndexBuffer.data() + left;
+    const uint32_t *pRight = m_IndexBuffer.data() + right;
+    return std::equal(pLeft, pLeft + *pLeft + 1, pRight);
+  }
 
 public:
-  IndexArraysPart() : m_IndexBuffer(), m_IndexSet(*this) {}
+  IndexArraysPart() : m_IndexBuffer(), m_IndexMap() {}
   template <class iterator>
   uint32_t AddIndex(iterator begin, iterator end) {
     uint32_t newOffset = m_IndexBuffer.size();
@@ -1021,12 +1015,18 @@ public:
     m_IndexBuffer.insert(m_IndexBuffer.end(), begin, end);
     m_IndexBuffer[newOffset] = (m_IndexBuffer.size() - newOffset) - 1;
     // Check for duplicate, return new offset if not duplicate
-    auto insertResult = m_IndexSet.insert(newOffset);
-    if (insertResult.second)
-      return newOffset;
-    // Otherwise it was a duplicate, so chop off the size and return the original
-    m_IndexBuffer.resize(newOffset);
-    return *insertResult.first;
+    size_t hash = llvm::hash_combine_range(m_IndexBuffer.begin() + newOffset,
+                                           m_IndexBuffer.end());
+    auto range = m_IndexMap.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (IsSameIndexArray(it->second, newOffset)) {
+        // It was a duplicate, so chop off the size and return the original
+        m_IndexBuffer.resize(newOffset);
+        return it->second;
+      }
+    }
+    m_IndexMap.emplace(hash, newOffset);
+    return newOffset;
   }
 
   RuntimeDataPartType GetType() const { return RuntimeDataPartType::IndexArrays; }
@@ -1068,6 +1068,74 @@ public:
   RuntimeDataPartType GetType() const { return RuntimeDataPartType::SubobjectTable; }
 };
 
+// Maps row names to row indices for tables whose rows have a Name, so
+// readers can find an export without comparing every name in the table.
+class NameIndexPart : public RDATPart {
+private:
+  struct Index {
+    RuntimeDataPartType TableType;
+    std::vector<uint32_t> Slots;
+  };
+  std::vector<Index> m_Indices;
+
+public:
+  template <class T>
+  void AddIndex(const RDATTable<T> &table, const StringBufferPart &strings) {
+    const std::vector<T> &rows = table.GetRows();
+    if (rows.empty())
+      return;
+    // Keep the load factor at or below one half so probes stay short.
+    uint32_t slotCount = 1;
+    while (slotCount < rows.size() * 2)
+      slotCount <<= 1;
+    uint32_t mask = slotCount - 1;
+    Index index = { table.GetType(),
+                    std::vector<uint32_t>(slotCount, RDAT_NAME_INDEX_EMPTY) };
+    for (uint32_t row = 0; row < rows.size(); ++row) {
+      const char *name = strings.Get(rows[row].Name);
+      if (!*name)
+        continue;
+      uint32_t slot = NameIndexHash(name) & mask;
+      bool bDuplicate = false;
+      for (; index.Slots[slot] != RDAT_NAME_INDEX_EMPTY; slot = (slot + 1) & mask) {
+        // Lookups return the first row with a name, as a scan would.
+        if (strcmp(strings.Get(rows[index.Slots[slot]].Name), name) == 0) {
+          bDuplicate = true;
+          break;
+        }
+      }
+      if (!bDuplicate)
+        index.Slots[slot] = row;
+    }
+    m_Indices.emplace_back(std::move(index));
+  }
+
+  RuntimeDataPartType GetType() const { return RuntimeDataPartType::NameIndex; }
+  uint32_t GetPartSize() const {
+    if (m_Indices.empty())
+      return 0;
+    uint32_t size = sizeof(uint32_t);
+    for (const Index &index : m_Indices)
+      size += sizeof(RuntimeDataNameIndexHeader) +
+              sizeof(uint32_t) * index.Slots.size();
+    return size;
+  }
+  void Write(void *ptr) {
+    char *pCur = (char *)ptr;
+    *reinterpret_cast<uint32_t *>(pCur) = m_Indices.size();
+    pCur += sizeof(uint32_t);
+    for (const Index &index : m_Indices) {
+      RuntimeDataNameIndexHeader &header =
+          *reinterpret_cast<RuntimeDataNameIndexHeader *>(pCur);
+      header.TableType = index.TableType;
+      header.SlotCount = index.Slots.size();
+      pCur += sizeof(RuntimeDataNameIndexHeader);
+      memcpy(pCur, index.Slots.data(), sizeof(uint32_t) * index.Slots.size());
+      pCur += sizeof(uint32_t) * index.Slots.size();
+    }
+  }
+};
+
 using namespace DXIL;
 
 class DxilRDATWriter : public DxilPartWriter {
@@ -1271,7 +1339,7 @@ private:
           }
           shaderKind = (uint32_t)props.shaderKind;
         }
-        ShaderFlags flags = ShaderFlags::CollectShaderFlags(&function, &DM);
+        ShaderFlags flags = DM.GetShaderFlagsForFunction(&function);
         RuntimeDataFunctionInfo info = {};
         info.Name = mangledIndex;
         info.UnmangledName = unmangledIndex;
@@ -1418,6 +1486,17 @@ public:
     UpdateFunctionInfo(mod);
     UpdateSubobjectInfo(mod);
 
+    // Validators up to 1.7 regenerate RDAT without a name index and would
+    // reject one, so only unvalidated modules carry it for now.
+    if (m_ValMajor == 0 && m_ValMinor == 0) {
+      m_Parts.emplace_back(llvm::make_unique<NameIndexPart>());
+      NameIndexPart *pNameIndex =
+          reinterpret_cast<NameIndexPart *>(m_Parts.back().get());
+      pNameIndex->AddIndex(*m_pResourceTable, *m_pStringBufferPart);
+      pNameIndex->AddIndex(*m_pFunctionTable, *m_pStringBufferPart);
+      pNameIndex->AddIndex(*m_pSubobjectTable, *m_pStringBufferPart);
+    }
+
     // Delete any empty parts:
     std::vector<std::unique_ptr<RDATPart>>::iterator it = m_Parts.begin();
     while (it != m_Parts.end()) {
@@ -1492,38 +1571,75 @@ private:
 
   llvm::SmallVector<DxilPart, 8> m_Parts;
 
+  // Part written after all others, whose size is only known once written.
+  uint32_t m_TrailingFourCC = 0;
+  uint32_t m_TrailingSizeHint = 0;
+  WriteFn m_TrailingWrite;
+
+  uint32_t GetPartCount() const {
+    return (uint32_t)m_Parts.size() + (m_TrailingWrite ? 1 : 0);
+  }
+
 public:
   void AddPart(uint32_t FourCC, uint32_t Size, WriteFn Write) override {
     m_Parts.emplace_back(FourCC, Size, Write);
   }
 
+  // Adds a last part whose size is not known up front, so that it can be
+  // produced directly into the container instead of being copied in.
+  // SizeHint is reserved along with the other parts; the part header and
+  // container size are patched once Write returns.
+  void SetTrailingPart(uint32_t FourCC, uint32_t SizeHint, WriteFn Write) {
+    m_TrailingFourCC = FourCC;
+    m_TrailingSizeHint = SizeHint;
+    m_TrailingWrite = Write;
+  }
+
+  // Excludes the contents of a trailing part.
   uint32_t size() const override {
     uint32_t partSize = 0;
     for (auto &part : m_Parts) {
       partSize += part.Header.PartSize;
     }
-    return (uint32_t)GetDxilContainerSizeFromParts((uint32_t)m_Parts.size(), partSize);
+    return (uint32_t)GetDxilContainerSizeFromParts(GetPartCount(), partSize);
   }
 
   void write(AbstractMemoryStream *pStream) override {
     DxilContainerHeader header;
-    const uint32_t PartCount = (uint32_t)m_Parts.size();
+    const uint32_t PartCount = GetPartCount();
     uint32_t containerSizeInBytes = size();
     InitDxilContainer(&header, PartCount, containerSizeInBytes);
-    IFT(pStream->Reserve(header.ContainerSizeInBytes));
+    IFT(pStream->Reserve(header.ContainerSizeInBytes + m_TrailingSizeHint));
+    UINT64 containerStart = pStream->GetPosition();
     IFT(WriteStreamValue(pStream, header));
     uint32_t offset = sizeof(header) + (uint32_t)GetOffsetTableSize(PartCount);
     for (auto &&part : m_Parts) {
       IFT(WriteStreamValue(pStream, offset));
       offset += sizeof(DxilPartHeader) + part.Header.PartSize;
     }
+    if (m_TrailingWrite)
+      IFT(WriteStreamValue(pStream, offset));
     for (auto &&part : m_Parts) {
       IFT(WriteStreamValue(pStream, part.Header));
       size_t start = pStream->GetPosition();
       part.Write(pStream);
       DXASSERT_LOCALVAR(start, pStream->GetPosition() - start == (size_t)part.Header.PartSize, "out of bound");
     }
-    DXASSERT(containerSizeInBytes == (uint32_t)pStream->GetPosition(), "else stream size is incorrect");
+    if (m_TrailingWrite) {
+      DxilPartHeader partHeader;
+      partHeader.PartFourCC = m_TrailingFourCC;
+      partHeader.PartSize = 0;
+      UINT64 partStart = pStream->GetPosition();
+      IFT(WriteStreamValue(pStream, partHeader));
+      m_TrailingWrite(pStream);
+      partHeader.PartSize = (uint32_t)(pStream->GetPosition() - partStart -
+                                       sizeof(DxilPartHeader));
+      header.ContainerSizeInBytes += partHeader.PartSize;
+      // The stream only grows, so the bytes written earlier are still in place.
+      memcpy(pStream->GetPtr() + partStart, &partHeader, sizeof(partHeader));
+      memcpy(pStream->GetPtr() + containerStart, &header, sizeof(header));
+    }
+    DXASSERT(header.ContainerSizeInBytes == (uint32_t)pStream->GetPosition(), "else stream size is incorrect");
   }
 };
 
@@ -1545,32 +1661,114 @@ static void GetPaddedProgramPartSize(AbstractMemoryStream *pStream,
   bitcodeInUInt32 = (bitcodeInUInt32 / 4) + (bitcodePaddingBytes ? 1 : 0);
 }
 
-void hlsl::WriteProgramPart(const ShaderModel *pModel,
-                             AbstractMemoryStream *pModuleBitcode,
-                             IStream *pStream) {
+static void InitProgramHeaderForModel(DxilProgramHeader &programHeader,
+                                      const ShaderModel *pModel,
+                                      uint32_t bitcodeSize) {
   DXASSERT(pModel != nullptr, "else generation should have failed");
-  DxilProgramHeader programHeader;
   uint32_t shaderVersion =
       EncodeVersion(pModel->GetKind(), pModel->GetMajor(), pModel->GetMinor());
   unsigned dxilMajor, dxilMinor;
   pModel->GetDxilVersion(dxilMajor, dxilMinor);
   uint32_t dxilVersion = DXIL::MakeDxilVersion(dxilMajor, dxilMinor);
-  InitProgramHeader(programHeader, shaderVersion, dxilVersion, pModuleBitcode->GetPtrSize());
+  InitProgramHeader(programHeader, shaderVersion, dxilVersion, bitcodeSize);
+}
+
+void hlsl::WriteProgramPart(const ShaderModel *pModel,
+                             AbstractMemoryStream *pModuleBitcode,
+                             IStream *pStream) {
+  DxilProgramHeader programHeader;
+  InitProgramHeaderForModel(programHeader, pModel, pModuleBitcode->GetPtrSize());
 
   uint32_t programInUInt32, programPaddingBytes;
   GetPaddedProgramPartSize(pModuleBitcode, programInUInt32,
                            programPaddingBytes);
 
-  ULONG cbWritten;
   IFT(WriteStreamValue(pStream, programHeader));
-  IFT(pStream->Write(pModuleBitcode->GetPtr(), pModuleBitcode->GetPtrSize(),
-                     &cbWritten));
+  IFT(CopyMemoryStreamTo(pModuleBitcode, pStream));
   if (programPaddingBytes) {
+    ULONG cbWritten;
+    uint32_t paddingValue = 0;
+    IFT(pStream->Write(&paddingValue, programPaddingBytes, &cbWritten));
+  }
+}
+
+namespace {
+// Writes to a memory stream and hashes the bytes on their way through.
+class raw_hashing_stream_ostream : public llvm::raw_ostream {
+private:
+  CComPtr<AbstractMemoryStream> m_pStream;
+  llvm::MD5 *m_pHash;
+  void write_impl(const char *Ptr, size_t Size) override {
+    ULONG cbWritten;
+    IFT(m_pStream->Write(Ptr, Size, &cbWritten));
+    if (m_pHash)
+      m_pHash->update(ArrayRef<uint8_t>((const uint8_t *)Ptr, Size));
+  }
+  uint64_t current_pos() const override { return m_pStream->GetPosition(); }
+public:
+  raw_hashing_stream_ostream(AbstractMemoryStream *pStream, llvm::MD5 *pHash)
+      : m_pStream(pStream), m_pHash(pHash) {}
+  ~raw_hashing_stream_ostream() override {
+    flush();
+  }
+};
+} // namespace
+
+// Like WriteProgramPart, but serializes the module straight into the stream
+// rather than copying bitcode that was written elsewhere. If pHash is given,
+// the bitcode is added to it as it is written. Function bodies are written on
+// up to BitcodeThreads threads.
+static void WriteProgramPartForModule(const ShaderModel *pModel, Module *pM,
+                                      bool bPreserveUseListOrder,
+                                      AbstractMemoryStream *pStream,
+                                      llvm::MD5 *pHash,
+                                      unsigned BitcodeThreads) {
+  DxilProgramHeader programHeader;
+  InitProgramHeaderForModel(programHeader, pModel, 0);
+  UINT64 headerStart = pStream->GetPosition();
+  IFT(WriteStreamValue(pStream, programHeader));
+  UINT64 bitcodeStart = pStream->GetPosition();
+  {
+    raw_hashing_stream_ostream outStream(pStream, pHash);
+    WriteBitcodeToFile(pM, outStream, bPreserveUseListOrder, BitcodeThreads);
+  }
+  uint32_t bitcodeSize = (uint32_t)(pStream->GetPosition() - bitcodeStart);
+
+  InitProgramHeaderForModel(programHeader, pModel, bitcodeSize);
+  memcpy(pStream->GetPtr() + headerStart, &programHeader,
+         sizeof(programHeader));
+  if (uint32_t programPaddingBytes = bitcodeSize % 4) {
+    ULONG cbWritten;
     uint32_t paddingValue = 0;
     IFT(pStream->Write(&paddingValue, programPaddingBytes, &cbWritten));
   }
 }
 
+// Compresses the program part written to pPartStream into Program.
+static void CompressProgramPart(AbstractMemoryStream *pPartStream,
+                                std::vector<uint32_t> &Program) {
+  IFTBOOL(CompressDxilProgramPart(
+              reinterpret_cast<const DxilProgramHeader *>(pPartStream->GetPtr()),
+              Program),
+          DXC_E_GENERAL_INTERNAL_ERROR);
+}
+
+static void CompressProgramPart(const ShaderModel *pModel,
+                                AbstractMemoryStream *pModuleBitcode,
+                                std::vector<uint32_t> &Program) {
+  CComPtr<AbstractMemoryStream> pPartStream;
+  IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pPartStream));
+  WriteProgramPart(pModel, pModuleBitcode, pPartStream);
+  CompressProgramPart(pPartStream, Program);
+}
+
+static void WriteCompressedProgramPart(const std::vector<uint32_t> &Program,
+                                       AbstractMemoryStream *pStream) {
+  ULONG cbWritten;
+  IFT(pStream->Write(Program.data(), Program.size() * sizeof(uint32_t),
+                     &cbWritten));
+}
+
 namespace {
 
 class RootSignatureWriter : public DxilPartWriter {
@@ -1649,7 +1847,8 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
                                            SerializeDxilFlags Flags,
                                            DxilShaderHash *pShaderHashOut,
                                            AbstractMemoryStream *pReflectionStreamOut,
-                                           AbstractMemoryStream *pRootSigStreamOut) {
+                                           AbstractMemoryStream *pRootSigStreamOut,
+                                           unsigned BitcodeThreads) {
   // TODO: add a flag to update the module and remove information that is not part
   // of DXIL proper and is used only to assemble the container.
 
@@ -1665,6 +1864,11 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
   bool bCompat_1_4 = DXIL::CompareVersions(ValMajor, ValMinor, 1, 5) < 0;
   bool bEmitReflection = Flags & SerializeDxilFlags::IncludeReflectionPart ||
                          pReflectionStreamOut;
+  // Only an intermediate library may have its bitcode compressed; the
+  // program part of anything the runtime loads is always written as is.
+  bool bCompressBitcode =
+      (Flags & SerializeDxilFlags::CompressLibraryBitcode) &&
+      pModule->GetShaderModel()->IsLib();
 
   DxilContainerWriter_impl writer;
 
@@ -1759,22 +1963,36 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     }
   }
 
-  // If metadata was stripped, re-serialize the input module.
+  bool bHasDebugInfo = HasDebugInfoOrLineNumbers(*pModule->GetModule());
+
+  // If metadata was stripped, re-serialize the input module. Only the debug
+  // part needs it as a separate stream; the program part is serialized
+  // straight into the container below.
   CComPtr<AbstractMemoryStream> pInputProgramStream = pModuleBitcode;
-  if (bMetadataStripped) {
+  if (bMetadataStripped && bHasDebugInfo &&
+      (Flags & SerializeDxilFlags::IncludeDebugInfoPart)) {
     pInputProgramStream.Release();
     IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pInputProgramStream));
     raw_stream_ostream outStream(pInputProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, true);
+    WriteBitcodeToFile(pModule->GetModule(), outStream, true, BitcodeThreads);
   }
 
   // If we have debug information present, serialize it to a debug part, then use the stripped version as the canonical program version.
-  CComPtr<AbstractMemoryStream> pProgramStream = pInputProgramStream;
   bool bModuleStripped = false;
-  if (HasDebugInfoOrLineNumbers(*pModule->GetModule())) {
+  std::vector<uint32_t> CompressedDebugProgram, CompressedProgram;
+  if (bHasDebugInfo) {
     uint32_t debugInUInt32, debugPaddingBytes;
     GetPaddedProgramPartSize(pInputProgramStream, debugInUInt32, debugPaddingBytes);
-    if (Flags & SerializeDxilFlags::IncludeDebugInfoPart) {
+    if ((Flags & SerializeDxilFlags::IncludeDebugInfoPart) && bCompressBitcode) {
+      CompressProgramPart(pModule->GetShaderModel(), pInputProgramStream,
+                          CompressedDebugProgram);
+      writer.AddPart(DFCC_ShaderDebugInfoDXIL,
+                     CompressedDebugProgram.size() * sizeof(uint32_t),
+                     [&](AbstractMemoryStream *pStream) {
+                       WriteCompressedProgramPart(CompressedDebugProgram,
+                                                  pStream);
+                     });
+    } else if (Flags & SerializeDxilFlags::IncludeDebugInfoPart) {
       writer.AddPart(DFCC_ShaderDebugInfoDXIL, debugInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
         hlsl::WriteProgramPart(pModule->GetShaderModel(), pInputProgramStream, pStream);
       });
@@ -1826,20 +2044,25 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     bModuleStripped |= pModule->StripReflection();
   }
 
-  // If debug info or reflection was stripped, re-serialize the module.
-  if (bModuleStripped) {
-    pProgramStream.Release();
-    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pProgramStream));
-    raw_stream_ostream outStream(pProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, false);
-  }
+  // If debug info, reflection or metadata was stripped, the module has to be
+  // re-serialized; it is written straight into the container's program part.
+  // Otherwise the caller's bitcode is the program.
+  bool bSerializeProgram = bModuleStripped || bMetadataStripped;
+  CComPtr<AbstractMemoryStream> pProgramStream;
+  if (!bSerializeProgram)
+    pProgramStream = pModuleBitcode;
 
   // Compute hash if needed.
-  DxilShaderHash HashContent;
+  DxilShaderHash HashContent = {};
   SmallString<32> HashStr;
-  if (bSupportsShaderHash || pShaderHashOut ||
-      (Flags & SerializeDxilFlags::IncludeDebugNamePart &&
-        DebugName.empty()))
+  bool bComputeHash = bSupportsShaderHash || pShaderHashOut ||
+                      (Flags & SerializeDxilFlags::IncludeDebugNamePart &&
+                       DebugName.empty());
+  // A hash of the program bitcode is accumulated while it is written into
+  // the container; the parts that hold it are patched afterwards.
+  bool bDeferHash = bComputeHash && bSerializeProgram &&
+                    !(Flags & SerializeDxilFlags::DebugNameDependOnSource);
+  if (bComputeHash && !bDeferHash)
   {
     // If the debug name should be specific to the sources, base the name on the debug
     // bitcode, which will include the source references, line numbers, etc. Otherwise,
@@ -1854,15 +2077,21 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     }
     md5.final(HashContent.Digest);
     md5.stringifyResult(HashContent.Digest, HashStr);
+  } else if (bDeferHash) {
+    // Placeholder of the same length as the stringified digest.
+    HashStr.assign(sizeof(HashContent.Digest) * 2, '0');
   }
 
   // Serialize debug name if requested.
   std::string DebugNameStr; // Used if constructing name based on hash
+  bool bDebugNameFromHash = false;
+  UINT64 DebugNamePos = 0;
   if (Flags & SerializeDxilFlags::IncludeDebugNamePart) {
     if (DebugName.empty()) {
       DebugNameStr += HashStr;
       DebugNameStr += ".pdb";
       DebugName = DebugNameStr;
+      bDebugNameFromHash = true;
     }
 
     // Calculate the size of the blob part.
@@ -1870,9 +2099,10 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
         sizeof(DxilShaderDebugName) + DebugName.size() + 1); // 1 for null
 
     writer.AddPart(DFCC_ShaderDebugName, DebugInfoContentLen,
-      [DebugName]
+      [DebugName, &DebugNamePos]
       (AbstractMemoryStream *pStream)
     {
+      DebugNamePos = pStream->GetPosition() + sizeof(DxilShaderDebugName);
       DxilShaderDebugName NameContent;
       NameContent.Flags = 0;
       NameContent.NameLength = DebugName.size();
@@ -1888,30 +2118,77 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
   }
 
   // Add hash to container if supported by validator version.
+  UINT64 HashPos = 0;
   if (bSupportsShaderHash) {
     writer.AddPart(DFCC_ShaderHash, sizeof(HashContent),
-      [HashContent]
+      [&HashContent, &HashPos]
       (AbstractMemoryStream *pStream)
     {
+      HashPos = pStream->GetPosition();
       IFT(WriteStreamValue(pStream, HashContent));
     });
   }
 
-  // Write hash to separate output if requested.
-  if (pShaderHashOut) {
-    memcpy(pShaderHashOut, &HashContent, sizeof(DxilShaderHash));
+  // Write the program part.
+  llvm::MD5 ProgramHash;
+  if (bSerializeProgram) {
+    // The input bitcode is an upper bound for the stripped module.
+    writer.SetTrailingPart(DFCC_DXIL,
+      pModuleBitcode->GetPtrSize() + sizeof(DxilProgramHeader),
+      [&](AbstractMemoryStream *pStream) {
+        if (!bCompressBitcode) {
+          WriteProgramPartForModule(pModule->GetShaderModel(),
+                                    pModule->GetModule(), !bModuleStripped,
+                                    pStream,
+                                    bDeferHash ? &ProgramHash : nullptr,
+                                    BitcodeThreads);
+          return;
+        }
+        CComPtr<AbstractMemoryStream> pPartStream;
+        IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pPartStream));
+        WriteProgramPartForModule(pModule->GetShaderModel(),
+                                  pModule->GetModule(), !bModuleStripped,
+                                  pPartStream,
+                                  bDeferHash ? &ProgramHash : nullptr,
+                                  BitcodeThreads);
+        CompressProgramPart(pPartStream, CompressedProgram);
+        WriteCompressedProgramPart(CompressedProgram, pStream);
+      });
+  } else if (bCompressBitcode) {
+    CompressProgramPart(pModule->GetShaderModel(), pProgramStream,
+                        CompressedProgram);
+    writer.AddPart(DFCC_DXIL, CompressedProgram.size() * sizeof(uint32_t),
+                   [&](AbstractMemoryStream *pStream) {
+                     WriteCompressedProgramPart(CompressedProgram, pStream);
+                   });
+  } else {
+    // Compute padded bitcode size.
+    uint32_t programInUInt32, programPaddingBytes;
+    GetPaddedProgramPartSize(pProgramStream, programInUInt32, programPaddingBytes);
+
+    writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
+      WriteProgramPart(pModule->GetShaderModel(), pProgramStream, pStream);
+    });
   }
 
-  // Compute padded bitcode size.
-  uint32_t programInUInt32, programPaddingBytes;
-  GetPaddedProgramPartSize(pProgramStream, programInUInt32, programPaddingBytes);
+  writer.write(pFinalStream);
 
-  // Write the program part.
-  writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
-    WriteProgramPart(pModule->GetShaderModel(), pProgramStream, pStream);
-  });
+  if (bDeferHash) {
+    HashContent.Flags = (uint32_t)DxilShaderHashFlags::None;
+    ProgramHash.final(HashContent.Digest);
+    ProgramHash.stringifyResult(HashContent.Digest, HashStr);
+    if (bSupportsShaderHash)
+      memcpy(pFinalStream->GetPtr() + HashPos, &HashContent,
+             sizeof(HashContent));
+    if (bDebugNameFromHash)
+      memcpy(pFinalStream->GetPtr() + DebugNamePos, HashStr.data(),
+             HashStr.size());
+  }
 
-  writer.write(pFinalStream);
+  // Write hash to separate output if requested.
+  if (pShaderHashOut) {
+    memcpy(pShaderHashOut, &HashContent, sizeof(DxilShaderHash));
+  }
 }
 
 void hlsl::SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
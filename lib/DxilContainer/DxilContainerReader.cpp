@@ -13,10 +13,41 @@
 #include "dxc/Support/WinAdapter.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DxilContainer/DxilContainerReader.h"
+#include "dxc/Support/FileIOHelper.h"
+
+#include <algorithm>
 
 namespace hlsl {
 
+void DxilPartKindIndex::Build(_In_ const DxilContainerHeader *pHeader) {
+  m_Entries.clear();
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i)
+    m_Entries.emplace_back(GetDxilContainerPart(pHeader, i)->PartFourCC, i);
+  // Stable, so the first part of each kind stays ahead of later ones.
+  std::stable_sort(m_Entries.begin(), m_Entries.end(),
+                   [](const std::pair<uint32_t, uint32_t> &a,
+                      const std::pair<uint32_t, uint32_t> &b) {
+                     return a.first < b.first;
+                   });
+  m_Entries.erase(std::unique(m_Entries.begin(), m_Entries.end(),
+                              [](const std::pair<uint32_t, uint32_t> &a,
+                                 const std::pair<uint32_t, uint32_t> &b) {
+                                return a.first == b.first;
+                              }),
+                  m_Entries.end());
+}
+
+uint32_t DxilPartKindIndex::Find(uint32_t kind) const {
+  auto it = std::lower_bound(m_Entries.begin(), m_Entries.end(), kind,
+                             [](const std::pair<uint32_t, uint32_t> &entry,
+                                uint32_t kind) { return entry.first < kind; });
+  if (it == m_Entries.end() || it->first != kind)
+    return (uint32_t)DXIL_CONTAINER_BLOB_NOT_FOUND;
+  return it->second;
+}
+
 HRESULT DxilContainerReader::Load(_In_ const void* pContainer, _In_ uint32_t containerSizeInBytes) {
+  m_pContainerBlob.Release();
   if (pContainer == nullptr) {
     return E_FAIL;
   }
@@ -32,10 +63,21 @@ HRESULT DxilContainerReader::Load(_In_ const void* pContainer, _In_ uint32_t con
   m_pContainer = pContainer;
   m_uContainerSize = containerSizeInBytes;
   m_pHeader = pHeader;
+  m_Index.Build(pHeader);
   
   return S_OK;
 }
 
+HRESULT DxilContainerReader::Load(_In_ IDxcBlob *pContainer) {
+  if (pContainer == nullptr) {
+    return E_FAIL;
+  }
+  IFR(Load(pContainer->GetBufferPointer(),
+           (uint32_t)pContainer->GetBufferSize()));
+  m_pContainerBlob = pContainer;
+  return S_OK;
+}
+
 HRESULT DxilContainerReader::GetVersion(_Out_ DxilContainerVersion *pResult) {
   if (pResult == nullptr) return E_POINTER;
   if (!IsLoaded()) return E_NOT_VALID_STATE;
@@ -76,9 +118,40 @@ HRESULT DxilContainerReader::FindFirstPartKind(uint32_t kind, _Out_ uint32_t *pR
   if (pResult == nullptr) return E_POINTER;
   *pResult = 0;
   if (!IsLoaded()) return E_NOT_VALID_STATE;
-  DxilPartIterator it = std::find_if(begin(m_pHeader), end(m_pHeader), DxilPartIsType(kind));
-  *pResult = (it == end(m_pHeader)) ? DXIL_CONTAINER_BLOB_NOT_FOUND : it.index;
+  *pResult = m_Index.Find(kind);
   return S_OK;
 }
+
+HRESULT DxilContainerReader::GetPartBlob(uint32_t idx, _COM_Outptr_ IDxcBlob **ppResult) {
+  if (ppResult == nullptr) return E_POINTER;
+  *ppResult = nullptr;
+  if (!IsLoaded() || !m_pContainerBlob) return E_NOT_VALID_STATE;
+  if (idx >= m_pHeader->PartCount) return E_BOUNDS;
+  const DxilPartHeader *pPart = GetDxilContainerPart(m_pHeader, idx);
+  const char *pData = GetDxilPartData(pPart);
+  uint32_t offset = (uint32_t)(pData - (const char *)m_pContainerBlob->GetBufferPointer());
+  return DxcCreateBlobFromBlob(m_pContainerBlob, offset, pPart->PartSize, ppResult);
+}
+
+HRESULT DxilContainerReader::GetProgramPartBlob(uint32_t idx, _COM_Outptr_ IDxcBlob **ppResult) {
+  if (ppResult == nullptr) return E_POINTER;
+  *ppResult = nullptr;
+  if (!IsLoaded()) return E_NOT_VALID_STATE;
+  if (idx >= m_pHeader->PartCount) return E_BOUNDS;
+  const DxilPartHeader *pPart = GetDxilContainerPart(m_pHeader, idx);
+  const DxilProgramHeader *pProgramHeader =
+      reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart));
+  if (IsValidDxilProgramHeader(pProgramHeader, pPart->PartSize))
+    return GetPartBlob(idx, ppResult);
+  try {
+    std::vector<uint32_t> program;
+    pProgramHeader =
+        GetValidDxilProgramHeader(pProgramHeader, pPart->PartSize, program);
+    if (pProgramHeader == nullptr) return DXC_E_CONTAINER_INVALID;
+    return DxcCreateBlobOnHeapCopy(program.data(),
+                                   program.size() * sizeof(uint32_t), ppResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
   
 } // namespace hlsl
@@ -0,0 +1,333 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderArchive.cpp                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Writes and reads archives of DXIL containers with shared parts.           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DxilContainer/DxilShaderArchive.h"
+#include "dxc/Support/ErrorCodes.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "llvm/Support/xxhash.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+namespace hlsl {
+
+static uint32_t AlignToDword(uint32_t size) { return (size + 3) & ~3u; }
+
+static HRESULT WriteBytes(AbstractMemoryStream *pStream, const void *pData,
+                          uint32_t size) {
+  ULONG cbWritten;
+  IFR(pStream->Write(pData, size, &cbWritten));
+  return cbWritten == size ? S_OK : E_FAIL;
+}
+
+static HRESULT WritePadding(AbstractMemoryStream *pStream, uint32_t size) {
+  static const uint8_t Zeros[4] = {0, 0, 0, 0};
+  return WriteBytes(pStream, Zeros, AlignToDword(size) - size);
+}
+
+//------------------------------------------------------------------------------
+// DxilShaderArchiveWriter
+
+uint32_t DxilShaderArchiveWriter::AddPart(_In_ const DxilPartHeader *pPart) {
+  const char *pData = GetDxilPartData(pPart);
+  StringRef Bytes(pData, pPart->PartSize);
+  uint64_t Hash = xxHash64(Bytes) ^ pPart->PartFourCC;
+  m_PartBytesAdded += pPart->PartSize;
+
+  auto Range = m_PartsByHash.equal_range(Hash);
+  for (auto it = Range.first; it != Range.second; ++it) {
+    const Part &Existing = m_Parts[it->second];
+    if (Existing.FourCC == pPart->PartFourCC &&
+        Existing.Size == pPart->PartSize &&
+        memcmp(Existing.pData, pData, pPart->PartSize) == 0)
+      return it->second;
+  }
+
+  uint32_t Index = (uint32_t)m_Parts.size();
+  m_Parts.push_back(Part{pPart->PartFourCC, pPart->PartSize, pData});
+  m_PartsByHash.emplace(Hash, Index);
+  m_PartBytesStored += pPart->PartSize;
+  return Index;
+}
+
+HRESULT DxilShaderArchiveWriter::AddContainer(StringRef Name,
+                                              _In_ const void *pContainer,
+                                              uint32_t ContainerSize) {
+  try {
+    const DxilContainerHeader *pHeader =
+        IsDxilContainerLike(pContainer, ContainerSize);
+    IFTBOOL(pHeader && IsValidDxilContainer(pHeader, ContainerSize),
+            DXC_E_CONTAINER_INVALID);
+
+    IFTBOOL(m_Names.insert(Name).second, E_INVALIDARG);
+
+    Container C;
+    C.Name = Name;
+    C.NameHash = xxHash64(Name);
+    C.Hash = pHeader->Hash;
+    C.Version = pHeader->Version;
+    C.PartRefs.reserve(pHeader->PartCount);
+    for (DxilPartIterator it = begin(pHeader), itEnd = end(pHeader);
+         it != itEnd; ++it)
+      C.PartRefs.push_back(AddPart(*it));
+    m_Containers.push_back(std::move(C));
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT DxilShaderArchiveWriter::Write(_In_ AbstractMemoryStream *pStream) const {
+  try {
+    // Order the container table by name hash so readers can search it.
+    std::vector<const Container *> Sorted;
+    Sorted.reserve(m_Containers.size());
+    for (const Container &C : m_Containers)
+      Sorted.push_back(&C);
+    std::sort(Sorted.begin(), Sorted.end(),
+              [](const Container *a, const Container *b) {
+                return a->NameHash < b->NameHash ||
+                       (a->NameHash == b->NameHash && a->Name < b->Name);
+              });
+
+    uint64_t PartRefCount = 0;
+    uint64_t NamesSize = 0;
+    for (const Container *C : Sorted) {
+      PartRefCount += C->PartRefs.size();
+      NamesSize += C->Name.size();
+    }
+
+    uint64_t DataOffset = sizeof(DxilShaderArchiveHeader) +
+                          sizeof(DxilShaderArchiveContainer) * Sorted.size() +
+                          sizeof(uint32_t) * PartRefCount +
+                          sizeof(DxilShaderArchivePart) * m_Parts.size() +
+                          AlignToDword((uint32_t)NamesSize);
+    uint64_t ArchiveSize = DataOffset;
+    for (const Part &P : m_Parts)
+      ArchiveSize += AlignToDword(P.Size);
+    IFTBOOL(ArchiveSize <= DxilContainerMaxSize, DXC_E_DATA_TOO_LARGE);
+    IFT(pStream->Reserve((ULONG)ArchiveSize));
+
+    DxilShaderArchiveHeader Header = {};
+    Header.Magic = DxilShaderArchiveMagic;
+    Header.Version = DxilShaderArchiveVersion;
+    Header.ArchiveSizeInBytes = (uint32_t)ArchiveSize;
+    Header.ContainerCount = (uint32_t)Sorted.size();
+    Header.PartRefCount = (uint32_t)PartRefCount;
+    Header.PartCount = (uint32_t)m_Parts.size();
+    Header.NamesSize = (uint32_t)NamesSize;
+    IFT(WriteBytes(pStream, &Header, sizeof(Header)));
+
+    uint32_t FirstPartRef = 0;
+    uint32_t NameOffset = 0;
+    for (const Container *C : Sorted) {
+      DxilShaderArchiveContainer Entry = {};
+      Entry.NameHash = C->NameHash;
+      Entry.NameOffset = NameOffset;
+      Entry.NameLength = (uint32_t)C->Name.size();
+      Entry.FirstPartRef = FirstPartRef;
+      Entry.PartCount = (uint32_t)C->PartRefs.size();
+      Entry.Hash = C->Hash;
+      Entry.Version = C->Version;
+      IFT(WriteBytes(pStream, &Entry, sizeof(Entry)));
+      FirstPartRef += Entry.PartCount;
+      NameOffset += Entry.NameLength;
+    }
+
+    for (const Container *C : Sorted)
+      IFT(WriteBytes(pStream, C->PartRefs.data(),
+                     sizeof(uint32_t) * (uint32_t)C->PartRefs.size()));
+
+    uint32_t PartOffset = (uint32_t)DataOffset;
+    for (const Part &P : m_Parts) {
+      DxilShaderArchivePart Entry = {P.FourCC, P.Size, PartOffset};
+      IFT(WriteBytes(pStream, &Entry, sizeof(Entry)));
+      PartOffset += AlignToDword(P.Size);
+    }
+
+    for (const Container *C : Sorted)
+      IFT(WriteBytes(pStream, C->Name.data(), (uint32_t)C->Name.size()));
+    IFT(WritePadding(pStream, (uint32_t)NamesSize));
+
+    for (const Part &P : m_Parts) {
+      IFT(WriteBytes(pStream, P.pData, P.Size));
+      IFT(WritePadding(pStream, P.Size));
+    }
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+//------------------------------------------------------------------------------
+// DxilShaderArchiveReader
+
+HRESULT DxilShaderArchiveReader::Load(_In_ IDxcBlob *pArchive) {
+  m_pArchive.Release();
+  m_pHeader = nullptr;
+  if (pArchive == nullptr)
+    return E_INVALIDARG;
+
+  const char *pBase = (const char *)pArchive->GetBufferPointer();
+  uint64_t BlobSize = pArchive->GetBufferSize();
+  if (BlobSize < sizeof(DxilShaderArchiveHeader))
+    return DXC_E_MALFORMED_CONTAINER;
+  const DxilShaderArchiveHeader *pHeader =
+      (const DxilShaderArchiveHeader *)pBase;
+  if (pHeader->Magic != DxilShaderArchiveMagic ||
+      pHeader->Version != DxilShaderArchiveVersion ||
+      pHeader->ArchiveSizeInBytes > BlobSize)
+    return DXC_E_MALFORMED_CONTAINER;
+
+  uint64_t ContainersOffset = sizeof(DxilShaderArchiveHeader);
+  uint64_t PartRefsOffset =
+      ContainersOffset +
+      sizeof(DxilShaderArchiveContainer) * (uint64_t)pHeader->ContainerCount;
+  uint64_t PartsOffset =
+      PartRefsOffset + sizeof(uint32_t) * (uint64_t)pHeader->PartRefCount;
+  uint64_t NamesOffset =
+      PartsOffset + sizeof(DxilShaderArchivePart) * (uint64_t)pHeader->PartCount;
+  if (NamesOffset + pHeader->NamesSize > pHeader->ArchiveSizeInBytes)
+    return DXC_E_MALFORMED_CONTAINER;
+
+  const DxilShaderArchiveContainer *pContainers =
+      (const DxilShaderArchiveContainer *)(pBase + ContainersOffset);
+  const uint32_t *pPartRefs = (const uint32_t *)(pBase + PartRefsOffset);
+  const DxilShaderArchivePart *pParts =
+      (const DxilShaderArchivePart *)(pBase + PartsOffset);
+
+  // Check every table entry once here so lookups can trust them.
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    if ((uint64_t)pParts[i].DataOffset + pParts[i].PartSize >
+        pHeader->ArchiveSizeInBytes)
+      return DXC_E_MALFORMED_CONTAINER;
+  }
+  for (uint32_t i = 0; i < pHeader->PartRefCount; ++i) {
+    if (pPartRefs[i] >= pHeader->PartCount)
+      return DXC_E_MALFORMED_CONTAINER;
+  }
+  for (uint32_t i = 0; i < pHeader->ContainerCount; ++i) {
+    const DxilShaderArchiveContainer &C = pContainers[i];
+    if ((uint64_t)C.FirstPartRef + C.PartCount > pHeader->PartRefCount ||
+        (uint64_t)C.NameOffset + C.NameLength > pHeader->NamesSize ||
+        (i > 0 && pContainers[i - 1].NameHash > C.NameHash))
+      return DXC_E_MALFORMED_CONTAINER;
+  }
+
+  m_pArchive = pArchive;
+  m_pHeader = pHeader;
+  m_pContainers = pContainers;
+  m_pPartRefs = pPartRefs;
+  m_pParts = pParts;
+  m_pNames = pBase + NamesOffset;
+  return S_OK;
+}
+
+uint32_t DxilShaderArchiveReader::GetContainerCount() const {
+  return IsLoaded() ? m_pHeader->ContainerCount : 0;
+}
+
+StringRef DxilShaderArchiveReader::GetContainerName(uint32_t container) const {
+  DXASSERT_NOMSG(container < GetContainerCount());
+  const DxilShaderArchiveContainer &C = m_pContainers[container];
+  return StringRef(m_pNames + C.NameOffset, C.NameLength);
+}
+
+uint32_t DxilShaderArchiveReader::FindContainer(StringRef Name) const {
+  if (!IsLoaded())
+    return DXIL_SHADER_ARCHIVE_NOT_FOUND;
+  uint64_t NameHash = xxHash64(Name);
+  const DxilShaderArchiveContainer *pEnd =
+      m_pContainers + m_pHeader->ContainerCount;
+  const DxilShaderArchiveContainer *it = std::lower_bound(
+      m_pContainers, pEnd, NameHash,
+      [](const DxilShaderArchiveContainer &C, uint64_t NameHash) {
+        return C.NameHash < NameHash;
+      });
+  for (; it != pEnd && it->NameHash == NameHash; ++it) {
+    uint32_t Index = (uint32_t)(it - m_pContainers);
+    if (GetContainerName(Index) == Name)
+      return Index;
+  }
+  return DXIL_SHADER_ARCHIVE_NOT_FOUND;
+}
+
+uint32_t DxilShaderArchiveReader::GetPartCount(uint32_t container) const {
+  DXASSERT_NOMSG(container < GetContainerCount());
+  return m_pContainers[container].PartCount;
+}
+
+const DxilShaderArchivePart &
+DxilShaderArchiveReader::GetPart(uint32_t container, uint32_t part) const {
+  DXASSERT_NOMSG(part < GetPartCount(container));
+  return m_pParts[m_pPartRefs[m_pContainers[container].FirstPartRef + part]];
+}
+
+uint32_t DxilShaderArchiveReader::GetPartFourCC(uint32_t container,
+                                                uint32_t part) const {
+  return GetPart(container, part).PartFourCC;
+}
+
+HRESULT DxilShaderArchiveReader::GetPartBlob(uint32_t container, uint32_t part,
+                                             _COM_Outptr_ IDxcBlob **ppResult) const {
+  if (ppResult == nullptr) return E_POINTER;
+  *ppResult = nullptr;
+  if (!IsLoaded()) return E_NOT_VALID_STATE;
+  if (container >= GetContainerCount() || part >= GetPartCount(container))
+    return E_BOUNDS;
+  const DxilShaderArchivePart &P = GetPart(container, part);
+  return DxcCreateBlobFromBlob(m_pArchive, P.DataOffset, P.PartSize, ppResult);
+}
+
+HRESULT DxilShaderArchiveReader::WriteContainer(uint32_t container,
+                                                _In_ AbstractMemoryStream *pStream) const {
+  if (!IsLoaded()) return E_NOT_VALID_STATE;
+  if (container >= GetContainerCount()) return E_BOUNDS;
+
+  try {
+    const DxilShaderArchiveContainer &C = m_pContainers[container];
+    uint64_t PartsSize = 0;
+    for (uint32_t i = 0; i < C.PartCount; ++i)
+      PartsSize += GetPart(container, i).PartSize;
+    IFTBOOL(PartsSize <= DxilContainerMaxSize, DXC_E_DATA_TOO_LARGE);
+    uint32_t ContainerSize = (uint32_t)GetDxilContainerSizeFromParts(
+        C.PartCount, (uint32_t)PartsSize);
+
+    IFT(pStream->Reserve((ULONG)pStream->GetPosition() + ContainerSize));
+
+    DxilContainerHeader Header;
+    Header.HeaderFourCC = DFCC_Container;
+    Header.Hash = C.Hash;
+    Header.Version = C.Version;
+    Header.ContainerSizeInBytes = ContainerSize;
+    Header.PartCount = C.PartCount;
+    IFT(WriteBytes(pStream, &Header, sizeof(Header)));
+
+    uint32_t PartOffset =
+        sizeof(DxilContainerHeader) + (uint32_t)GetOffsetTableSize(C.PartCount);
+    for (uint32_t i = 0; i < C.PartCount; ++i) {
+      IFT(WriteBytes(pStream, &PartOffset, sizeof(PartOffset)));
+      PartOffset += sizeof(DxilPartHeader) + GetPart(container, i).PartSize;
+    }
+
+    const char *pBase = (const char *)m_pArchive->GetBufferPointer();
+    for (uint32_t i = 0; i < C.PartCount; ++i) {
+      const DxilShaderArchivePart &P = GetPart(container, i);
+      DxilPartHeader PartHeader = {P.PartFourCC, P.PartSize};
+      IFT(WriteBytes(pStream, &PartHeader, sizeof(PartHeader)));
+      IFT(WriteBytes(pStream, pBase + P.DataOffset, P.PartSize));
+    }
+
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+} // namespace hlsl
@@ -18,6 +18,7 @@
 #include "DxilDiaSession.h"
 
 #include "dxc/Support/Global.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DebugInfoMetadata.h"
@@ -27,6 +28,7 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 
+#include <set>
 #include <unordered_map>
 
 // ValidateDbgDeclare ensures that all of the bits in
@@ -63,10 +65,18 @@ struct dxil_debug_info::LiveVariables::Impl
   using LiveVarsMap =
       std::unordered_map<llvm::DIScope*, VariableInfoMap>;
 
+  // The live variables at an instruction depend only on the scope and the
+  // line of its debug location. The debugger steps through instructions
+  // that share both, so each (scope, line) pair is resolved once.
+  using ScopeAndLine = std::pair<llvm::DIScope *, unsigned>;
+  using LiveVarsAtLocationMap =
+      llvm::DenseMap<ScopeAndLine, std::vector<const VariableInfo *>>;
+
   IMalloc *m_pMalloc;
   DxcPixDxilDebugInfo *m_pDxilDebugInfo;
   llvm::Module *m_pModule;
   LiveVarsMap m_LiveVarsDbgDeclare;
+  LiveVarsAtLocationMap m_LiveVarsAtLocation;
 
   void Init(
       IMalloc *pMalloc,
@@ -219,9 +229,6 @@ HRESULT dxil_debug_info::LiveVariables::GetLiveVariablesAtInstruction(
   DXASSERT(IP != nullptr, "else IP should not be nullptr");
   DXASSERT(ppResult != nullptr, "else Result should not be nullptr");
 
-  std::vector<const VariableInfo *> LiveVars;
-  std::set<std::string> LiveVarsName;
-
   const llvm::DebugLoc &DL = IP->getDebugLoc();
 
   if (!DL)
@@ -235,6 +242,21 @@ HRESULT dxil_debug_info::LiveVariables::GetLiveVariablesAtInstruction(
     return E_FAIL;
   }
 
+  auto Cached = m_pImpl->m_LiveVarsAtLocation.find(
+      std::make_pair(S, DL.getLine()));
+  if (Cached != m_pImpl->m_LiveVarsAtLocation.end())
+  {
+    std::vector<const VariableInfo *> LiveVars = Cached->second;
+    return CreateDxilLiveVariables(
+        m_pImpl->m_pDxilDebugInfo,
+        std::move(LiveVars),
+        ppResult);
+  }
+
+  std::vector<const VariableInfo *> &LiveVars =
+      m_pImpl->m_LiveVarsAtLocation[std::make_pair(S, DL.getLine())];
+  std::set<llvm::StringRef> LiveVarsName;
+
   const llvm::DITypeIdentifierMap EmptyMap;
   while (S != nullptr)
   {
@@ -268,8 +290,9 @@ HRESULT dxil_debug_info::LiveVariables::GetLiveVariablesAtInstruction(
     S = S->getScope().resolve(EmptyMap);
   }
 
+  std::vector<const VariableInfo *> Result = LiveVars;
   return CreateDxilLiveVariables(
       m_pImpl->m_pDxilDebugInfo,
-      std::move(LiveVars),
+      std::move(Result),
       ppResult);
 }
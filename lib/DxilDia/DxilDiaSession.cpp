@@ -11,6 +11,8 @@
 
 #include "DxilDiaSession.h"
 
+#include <algorithm>
+
 #include "dxc/DxilPIXPasses/DxilPIXPasses.h"
 #include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
 #include "llvm/ADT/STLExtras.h"
@@ -94,33 +96,40 @@ void dxil_dia::Session::Init(
     }
   }
 
+  // Flatten the RVA map into a sorted array so that range queries are a
+  // binary search followed by a linear walk over the requested RVAs.
+  m_instructionIndex.assign(m_instructions.begin(), m_instructions.end());
+
+  // Index the source file names once; line number tables look these up for
+  // every line they return.
+  if (m_contents != nullptr) {
+    for (unsigned i = 0; i < m_contents->getNumOperands(); ++i) {
+      llvm::MDString *fn =
+        llvm::dyn_cast<llvm::MDString>(m_contents->getOperand(i)->getOperand(0));
+      if (fn != nullptr) {
+        // Keep the first entry if a file name appears more than once.
+        m_fileNameToId.insert({ fn->getString(), i });
+      }
+    }
+  }
+
   // Sanity check to make sure rva map is same as instruction index.
   for (auto It = m_instructions.begin(); It != m_instructions.end(); ++It) {
     DXASSERT(m_rvaMap.find(It->second) != m_rvaMap.end(), "instruction not mapped to rva");
     DXASSERT(m_rvaMap[It->second] == It->first, "instruction mapped to wrong rva");
   }
 
-  // Initialize symbols
-  try {
-      m_symsMgr.Init(this);
-  } catch (const hlsl::Exception &) {
-      m_symsMgr = std::move(dxil_dia::SymbolManager());
-  }
+  // Initialize symbols. They are built on first use.
+  m_symsMgr.Init(this);
 }
 
 HRESULT dxil_dia::Session::getSourceFileIdByName(
     llvm::StringRef fileName,
     DWORD *pRetVal) {
-  if (Contents() != nullptr) {
-    for (unsigned i = 0; i < Contents()->getNumOperands(); ++i) {
-      llvm::StringRef fn =
-        llvm::dyn_cast<llvm::MDString>(Contents()->getOperand(i)->getOperand(0))
-        ->getString();
-      if (fn.equals(fileName)) {
-        *pRetVal = i;
-        return S_OK;
-      }
-    }
+  auto It = m_fileNameToId.find(fileName);
+  if (It != m_fileNameToId.end()) {
+    *pRetVal = It->second;
+    return S_OK;
   }
   *pRetVal = 0;
   return S_FALSE;
@@ -236,14 +245,24 @@ static HRESULT DxcDiaFindLineNumbersByRVA(
     return E_POINTER;
 
   std::vector<const llvm::Instruction*> instructions;
-  auto &allInstructions = pSession->InstructionsRef();
-
-  // Gather the list of insructions that map to the given rva range.
-  for (DWORD i = rva; i < rva + length; ++i) {
-    auto It = allInstructions.find(i);
-    if (It == allInstructions.end())
+  auto &allInstructions = pSession->InstructionIndexRef();
+
+  // Find the first instruction in the given rva range. The index is sorted
+  // and holds each rva at most once, so the range is fully mapped exactly
+  // when the next length entries hold consecutive rvas.
+  auto It = std::lower_bound(
+      allInstructions.begin(), allInstructions.end(), rva,
+      [](const Session::RVAIndex::value_type &entry, DWORD value) {
+        return entry.first < value;
+      });
+  if (length > 0) {
+    if (static_cast<size_t>(allInstructions.end() - It) < length ||
+        It->first != rva || (It + (length - 1))->first != rva + length - 1)
       return E_INVALIDARG;
+  }
 
+  // Gather the list of insructions that map to the given rva range.
+  for (auto End = It + length; It != End; ++It) {
     // Only include the instruction if it has debug info for line mappings.
     const llvm::Instruction *inst = It->second;
     if (inst->getDebugLoc())
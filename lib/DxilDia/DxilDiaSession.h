@@ -26,6 +26,8 @@
 #include "dxc/Support/Global.h"
 #include "dxc/Support/microcom.h"
 
+#include "llvm/ADT/StringMap.h"
+
 #include "DxilDia.h"
 #include "DxilDiaSymbolManager.h"
 
@@ -34,6 +36,7 @@ class Session : public IDiaSession, public IDxcPixDxilDebugInfoFactory {
 public:
   using RVA = unsigned;
   using RVAMap = std::map<RVA, const llvm::Instruction *>;
+  using RVAIndex = std::vector<std::pair<RVA, const llvm::Instruction *>>;
 
   struct LineInfo {
     LineInfo(std::uint32_t start_col, RVA first, RVA last)
@@ -65,6 +68,7 @@ public:
   llvm::DebugInfoFinder &InfoRef() { return *m_finder.get(); }
   const SymbolManager &SymMgr() const { return m_symsMgr; }
   const RVAMap &InstructionsRef() const { return m_instructions; }
+  const RVAIndex &InstructionIndexRef() const { return m_instructionIndex; }
   const std::vector<const llvm::Instruction *> &InstructionLinesRef() const { return m_instructionLines; }
   const std::unordered_map<const llvm::Instruction *, RVA> &RvaMapRef() const { return m_rvaMap; }
   const LineToInfoMap &LineToColumnStartMapRef() const { return m_lineToInfoMap; }
@@ -393,6 +397,8 @@ private:
   llvm::NamedMDNode *m_mainFileName;
   llvm::NamedMDNode *m_arguments;
   RVAMap m_instructions;
+  RVAIndex m_instructionIndex; // Instructions sorted by RVA, for range lookups.
+  llvm::StringMap<DWORD> m_fileNameToId; // Source file name to its index in Contents.
   std::vector<const llvm::Instruction *> m_instructionLines; // Instructions with line info.
   std::unordered_map<const llvm::Instruction *, RVA> m_rvaMap; // Map instruction to its RVA.
   LineToInfoMap m_lineToInfoMap;
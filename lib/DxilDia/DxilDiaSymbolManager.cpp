@@ -2065,9 +2065,45 @@ dxil_dia::SymbolManager::~SymbolManager() {
 void dxil_dia::SymbolManager::Init(Session *pSes) {
   DXASSERT(m_pSession == nullptr, "SymbolManager already initialized");
   m_pSession = pSes;
+  m_buildState = BuildState::NotBuilt;
   m_symbolCtors.clear();
+  m_scopeToID.clear();
+  m_symbolToLiveRange.clear();
   m_parentToChildren.clear();
+}
+
+HRESULT dxil_dia::SymbolManager::EnsureSymbols() const {
+  if (m_pSession == nullptr) {
+    return E_FAIL;
+  }
+
+  if (m_buildState == BuildState::NotBuilt) {
+    // Queries made while building (e.g., by the debug checks on each new
+    // symbol) see the tables built so far rather than starting over.
+    m_buildState = BuildState::Building;
+    try {
+      BuildSymbols();
+      m_buildState = BuildState::Built;
+    } catch (const hlsl::Exception &) {
+      m_buildState = BuildState::Failed;
+    } catch (const std::bad_alloc &) {
+      m_buildState = BuildState::Failed;
+    }
+
+    if (m_buildState == BuildState::Failed) {
+      // Behave like a session without symbols.
+      m_symbolCtors.clear();
+      m_scopeToID.clear();
+      m_symbolToLiveRange.clear();
+      m_parentToChildren.clear();
+    }
+  }
+
+  return m_buildState == BuildState::Failed ? E_FAIL : S_OK;
+}
 
+void dxil_dia::SymbolManager::BuildSymbols() const {
+  Session *pSes = m_pSession;
   llvm::DebugInfoFinder &DIFinder = pSes->InfoRef();
   if (DIFinder.compile_unit_count() != 1) {
     throw hlsl::Exception(E_FAIL);
@@ -2148,15 +2184,20 @@ void dxil_dia::SymbolManager::Init(Session *pSes) {
   IFT(SMI.PopulateParentToChildrenIDMap(&m_parentToChildren));
 }
 
+size_t dxil_dia::SymbolManager::NumSymbols() const {
+  if (FAILED(EnsureSymbols())) {
+    return 0;
+  }
+  return m_symbolCtors.size();
+}
+
 HRESULT dxil_dia::SymbolManager::GetSymbolByID(size_t id, Symbol **ppSym) const {
   if (ppSym == nullptr) {
     return E_INVALIDARG;
   }
   *ppSym = nullptr;
 
-  if (m_pSession == nullptr) {
-    return E_FAIL;
-  }
+  IFR(EnsureSymbols());
 
   if (id <= 0) {
     return E_INVALIDARG;
@@ -2171,6 +2212,10 @@ HRESULT dxil_dia::SymbolManager::GetSymbolByID(size_t id, Symbol **ppSym) const
 }
 
 HRESULT dxil_dia::SymbolManager::GetLiveRangeOf(Symbol *pSym, LiveRange *LR) const {
+  if (FAILED(EnsureSymbols())) {
+    return E_INVALIDARG;
+  }
+
   const DWORD dwSymID = pSym->GetID();
   if (dwSymID <= 0 || dwSymID > m_symbolCtors.size()) {
     return E_INVALIDARG;
@@ -2190,6 +2235,9 @@ HRESULT dxil_dia::SymbolManager::GetGlobalScope(Symbol **ppSym) const {
 
 HRESULT dxil_dia::SymbolManager::ChildrenOf(DWORD ID, std::vector<CComPtr<Symbol>> *pChildren) const {
   pChildren->clear();
+  if (FAILED(EnsureSymbols())) {
+    return S_OK;
+  }
   auto childrenList = m_parentToChildren.equal_range(ID);
   for (auto it = childrenList.first; it != childrenList.second; ++it) {
     CComPtr<Symbol> Child;
@@ -2226,6 +2274,7 @@ HRESULT dxil_dia::SymbolManager::DbgScopeOf(const llvm::Instruction *instr, Symb
     return E_FAIL;
   }
 
+  IFR(EnsureSymbols());
   auto scopeIt = m_scopeToID.find(LS);
   if (scopeIt == m_scopeToID.end()) {
     // This is a failure because all scopes should already exist in the symbol manager.
@@ -64,9 +64,11 @@ public:
   SymbolManager &operator =(SymbolManager &&) = default;
   ~SymbolManager();
 
+  // Records the session. The symbol tables are built on the first query, so
+  // sessions that only look up line numbers never pay for them.
   void Init(Session *pSes);
 
-  size_t NumSymbols() const { return m_symbolCtors.size(); }
+  size_t NumSymbols() const;
   HRESULT GetSymbolByID(size_t id, Symbol **ppSym) const;
   HRESULT GetLiveRangeOf(Symbol *pSym, LiveRange *LR) const;
   HRESULT GetGlobalScope(Symbol **ppSym) const;
@@ -74,24 +76,32 @@ public:
   HRESULT DbgScopeOf(const llvm::Instruction *instr, SymbolChildrenEnumerator **ppRet) const;
 
 private:
+  enum class BuildState { NotBuilt, Building, Built, Failed };
+
   HRESULT ChildrenOf(DWORD ID, std::vector<CComPtr<Symbol>> *pChildren) const;
+  HRESULT EnsureSymbols() const;
+  void BuildSymbols() const;
 
   // Not a CComPtr, and not AddRef'd - m_pSession is the owner of this.
   Session *m_pSession = nullptr;
 
+  // The tables below are filled in by BuildSymbols the first time a const
+  // query needs them.
+  mutable BuildState m_buildState = BuildState::NotBuilt;
+
   // Vector of factories for all symbols in the DXIL module.
-  std::vector<std::unique_ptr<SymbolFactory>> m_symbolCtors;
+  mutable std::vector<std::unique_ptr<SymbolFactory>> m_symbolCtors;
 
   // Mapping from scope to its ID.
-  ScopeToIDMap m_scopeToID;
+  mutable ScopeToIDMap m_scopeToID;
 
   // Mapping from symbol ID to live range. Globals are live [0, end),
   // locals, [first dbg.declare, end of scope)
   // TODO: the live range information assumes structured dxil - which should hold
   // for non-optimized code - so we need something more robust. For now, this is
   // good enough.
-  IDToLiveRangeMap m_symbolToLiveRange;
+  mutable IDToLiveRangeMap m_symbolToLiveRange;
 
-  ParentToChildrenMap m_parentToChildren;
+  mutable ParentToChildrenMap m_parentToChildren;
 };
 }  // namespace dxil_dia
@@ -19,6 +19,7 @@
 #include "dxc/HLSL/DxilGenerationPass.h"
 
 #include "llvm/IR/PassManager.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 
 #include "PixPassHelpers.h"
@@ -33,6 +34,7 @@ class DxilAddPixelHitInstrumentation : public ModulePass {
   int RTWidth = 1024;
   int NumPixels = 128;
   int SVPositionIndex = -1;
+  bool WaveCoalesce = false;
 
 public:
   static char ID; // Pass identification, replacement for typeid
@@ -48,6 +50,7 @@ void DxilAddPixelHitInstrumentation::applyOptions(PassOptions O) {
   GetPassOptionInt(O, "rt-width", &RTWidth, 0);
   GetPassOptionInt(O, "num-pixels", &NumPixels, 0);
   GetPassOptionInt(O, "sv-position-index", &SVPositionIndex, 0);
+  GetPassOptionBool(O, "wave-coalesce", &WaveCoalesce, false);
 }
 
 bool DxilAddPixelHitInstrumentation::runOnModule(Module &M) {
@@ -174,6 +177,33 @@ bool DxilAddPixelHitInstrumentation::runOnModule(Module &M) {
                                     "ByteIndex");
         }
 
+        // With wave-coalesce, the first active lane makes the increments for
+        // all lanes of the wave that share its pixel, and those lanes skip
+        // their atomics. Lanes on other pixels still make their own.
+        Value *LanesSharingIndex = nullptr;
+        Value *IsFirstLane = nullptr;
+        if (WaveCoalesce) {
+          auto SharesFirstLaneIndex =
+              PIXPassHelpers::EmitWaveSharesFirstLaneValue(HlslOP, Builder,
+                                                           Index);
+          IsFirstLane = PIXPassHelpers::EmitWaveIsFirstLane(HlslOP, Builder);
+          Function *AllBitCountFunc = HlslOP->GetOpFunc(
+              OP::OpCode::WaveAllBitCount, Type::getVoidTy(Ctx));
+          Constant *AllBitCountOpcode =
+              HlslOP->GetU32Const((unsigned)OP::OpCode::WaveAllBitCount);
+          LanesSharingIndex = Builder.CreateCall(
+              AllBitCountFunc, {AllBitCountOpcode, SharesFirstLaneIndex},
+              "LanesSharingIndex");
+          auto IsRepresentative = Builder.CreateOr(
+              IsFirstLane, Builder.CreateNot(SharesFirstLaneIndex),
+              "IsRepresentative");
+
+          TerminatorInst *ThenTerminator = SplitBlockAndInsertIfThen(
+              IsRepresentative, ThisInstruction, false);
+          Builder.SetInsertPoint(ThenTerminator);
+          DM.m_ShaderFlags.SetWaveOps(true);
+        }
+
         // Insert the UAV increment instruction:
         Function *AtomicOpFunc =
             HlslOP->GetOpFunc(OP::OpCode::AtomicBinOp, Type::getInt32Ty(Ctx));
@@ -182,6 +212,11 @@ bool DxilAddPixelHitInstrumentation::runOnModule(Module &M) {
         Constant *AtomicAdd =
             HlslOP->GetU32Const((unsigned)DXIL::AtomicBinOpCode::Add);
         {
+          Value *Increment = One32Arg;
+          if (WaveCoalesce) {
+            Increment = Builder.CreateSelect(IsFirstLane, LanesSharingIndex,
+                                             One32Arg, "Increment");
+          }
           (void)Builder.CreateCall(
               AtomicOpFunc,
               {
@@ -192,7 +227,7 @@ bool DxilAddPixelHitInstrumentation::runOnModule(Module &M) {
                   Index,     // i32, ; coordinate c0: byte offset
                   UndefArg,  // i32, ; coordinate c1 (unused)
                   UndefArg,  // i32, ; coordinate c2 (unused)
-                  One32Arg   // i32); increment value
+                  Increment  // i32); increment value
               },
               "UAVIncResult");
         }
@@ -225,6 +260,13 @@ bool DxilAddPixelHitInstrumentation::runOnModule(Module &M) {
                 "WeightStruct");
             Weight = Builder.CreateExtractValue(
                 WeightStruct, static_cast<uint64_t>(0LL), "Weight");
+            if (WaveCoalesce) {
+              // The weight is the same for every lane of the draw
+              auto WaveWeight =
+                  Builder.CreateMul(Weight, LanesSharingIndex, "WaveWeight");
+              Weight = Builder.CreateSelect(IsFirstLane, WaveWeight, Weight,
+                                            "CoalescedWeight");
+            }
           }
 
           // Step 2: Update write position ("Index") to second half of the UAV
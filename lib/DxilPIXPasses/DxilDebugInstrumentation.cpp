@@ -17,6 +17,7 @@
 #include "dxc/HLSL/DxilGenerationPass.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
@@ -85,6 +86,21 @@ using namespace hlsl;
 // overwritten, the debug session is deemed to have overflowed the UAV. The
 // caller will than allocate a UAV that is twice the size and try again, up to a
 // predefined maximum.
+//
+// Instrumenting every instruction makes the instrumented shader run much
+// slower than the original. The "BlockGranularity" option trades detail for
+// speed:
+// -  Each basic block writes one void step record, for its terminator, that
+// marks the
+//    block as executed, followed by records for only those values that are
+//    used outside the block and for the last write to each alloca register.
+// -  The records of a block are allocated with a single atomic per wave: the
+// first lane
+//    reserves the space for all lanes of interest, and each lane finds its
+//    own part from its count of preceding lanes of interest.
+// The "parameterNRange" options widen the selection from the single instance
+// given by "parameterN" to the instances [parameterN, parameterN + range), so
+// that e.g. a screen rectangle can be traced in one replay.
 
 // Keep these in sync with the same-named value in the debugger application's
 // WinPixShaderUtils.h
@@ -169,6 +185,27 @@ DebugShaderModifierRecordPayloadSizeDwords(size_t recordTotalSizeBytes) {
           sizeof(uint32_t));
 }
 
+// Returns the size of the step record written for a value of type Ty, or zero
+// if no record is written for such values.
+uint32_t DebugShaderModifierRecordDXILStepSizeBytes(Type *Ty) {
+  switch (Ty->getTypeID()) {
+  case Type::TypeID::StructTyID:
+  case Type::TypeID::VoidTyID:
+    return sizeof(DebugShaderModifierRecordDXILStep<void>);
+  case Type::TypeID::FloatTyID:
+  case Type::TypeID::HalfTyID:
+    return sizeof(DebugShaderModifierRecordDXILStep<float>);
+  case Type::TypeID::IntegerTyID:
+    return Ty->getIntegerBitWidth() == 64
+               ? sizeof(DebugShaderModifierRecordDXILStep<uint64_t>)
+               : sizeof(DebugShaderModifierRecordDXILStep<uint32_t>);
+  case Type::TypeID::DoubleTyID:
+    return sizeof(DebugShaderModifierRecordDXILStep<double>);
+  default:
+    return 0;
+  }
+}
+
 class DxilDebugInstrumentation : public ModulePass {
 
 private:
@@ -207,6 +244,11 @@ private:
     } GeometryShader;
   };
 
+  // Number of consecutive values, starting at the corresponding parameter,
+  // that select an invocation of interest.
+  unsigned m_ParameterRanges[3] = {1, 1, 1};
+  bool m_BlockGranularity = false;
+
   uint64_t m_UAVSize = 1024 * 1024;
   Value *m_SelectionCriterion = nullptr;
   CallInst *m_HandleForUAV = nullptr;
@@ -240,6 +282,18 @@ private:
 
   uint32_t m_RemainingReservedSpaceInBytes = 0;
   Value *m_CurrentIndex = nullptr;
+  // Set while writing records into space reserved for a whole block.
+  bool m_SpaceIsPreReserved = false;
+
+  // A step record for the block granularity mode, to be written before
+  // InsertBefore, or at the reservation point if that is null.
+  struct BlockStep {
+    Instruction *InsertBefore;
+    std::uint32_t InstNum;
+    Value *V;
+    std::uint32_t ValueOrdinal;
+    Value *ValueOrdinalIndex;
+  };
 
 public:
   static char ID; // Pass identification, replacement for typeid
@@ -263,6 +317,14 @@ private:
   void addDebugEntryValue(BuilderContext &BC, Value *TheValue);
   void addInvocationStartMarker(BuilderContext &BC);
   void reserveDebugEntrySpace(BuilderContext &BC, uint32_t SpaceInDwords);
+  void reserveWaveCompactedDebugEntrySpace(BuilderContext &BC,
+                                           uint32_t SpaceInBytes);
+  void setCurrentIndex(BuilderContext &BC, Value *Offset);
+  Value *addParameterComparison(BuilderContext &BC, Value *V,
+                                unsigned ParameterIndex, const Twine &Name);
+  void addBlockStepDebugEntries(BuilderContext &BC,
+                                ArrayRef<BlockStep> Steps);
+  void collectBlockSteps(BasicBlock &BB, std::vector<BlockStep> &Steps);
   void addStoreStepDebugEntry(BuilderContext &BC, StoreInst *Inst);
   void addStepDebugEntry(BuilderContext& BC, Instruction* Inst);
   void addStepDebugEntryValue(BuilderContext &BC, std::uint32_t InstNum,
@@ -280,6 +342,10 @@ void DxilDebugInstrumentation::applyOptions(PassOptions O) {
   GetPassOptionUnsigned(O, "parameter0", &m_Parameters.Parameters[0], 0);
   GetPassOptionUnsigned(O, "parameter1", &m_Parameters.Parameters[1], 0);
   GetPassOptionUnsigned(O, "parameter2", &m_Parameters.Parameters[2], 0);
+  GetPassOptionUnsigned(O, "parameter0Range", &m_ParameterRanges[0], 1);
+  GetPassOptionUnsigned(O, "parameter1Range", &m_ParameterRanges[1], 1);
+  GetPassOptionUnsigned(O, "parameter2Range", &m_ParameterRanges[2], 1);
+  GetPassOptionBool(O, "BlockGranularity", &m_BlockGranularity, false);
   GetPassOptionUInt64(O, "UAVSize", &m_UAVSize, 1024 * 1024);
 }
 
@@ -407,15 +473,12 @@ Value *DxilDebugInstrumentation::addDispatchedShaderProlog(BuilderContext &BC) {
       BC.Builder.CreateCall(ThreadIdFunc, {Opcode, Two32Arg}, "ThreadIdZ");
 
   // Compare to expected thread ID
-  auto CompareToX = BC.Builder.CreateICmpEQ(
-      ThreadIdX, BC.HlslOP->GetU32Const(m_Parameters.ComputeShader.ThreadIdX),
-      "CompareToThreadIdX");
-  auto CompareToY = BC.Builder.CreateICmpEQ(
-      ThreadIdY, BC.HlslOP->GetU32Const(m_Parameters.ComputeShader.ThreadIdY),
-      "CompareToThreadIdY");
-  auto CompareToZ = BC.Builder.CreateICmpEQ(
-      ThreadIdZ, BC.HlslOP->GetU32Const(m_Parameters.ComputeShader.ThreadIdZ),
-      "CompareToThreadIdZ");
+  auto CompareToX =
+      addParameterComparison(BC, ThreadIdX, 0, "CompareToThreadIdX");
+  auto CompareToY =
+      addParameterComparison(BC, ThreadIdY, 1, "CompareToThreadIdY");
+  auto CompareToZ =
+      addParameterComparison(BC, ThreadIdZ, 2, "CompareToThreadIdZ");
 
   auto CompareXAndY =
       BC.Builder.CreateAnd(CompareToX, CompareToY, "CompareXAndY");
@@ -454,12 +517,9 @@ DxilDebugInstrumentation::addVertexShaderProlog(BuilderContext &BC,
                             "InstanceId");
 
   // Compare to expected vertex ID and instance ID
-  auto CompareToVert = BC.Builder.CreateICmpEQ(
-      VertId, BC.HlslOP->GetU32Const(m_Parameters.VertexShader.VertexId),
-      "CompareToVertId");
-  auto CompareToInstance = BC.Builder.CreateICmpEQ(
-      InstanceId, BC.HlslOP->GetU32Const(m_Parameters.VertexShader.InstanceId),
-      "CompareToInstanceId");
+  auto CompareToVert = addParameterComparison(BC, VertId, 0, "CompareToVertId");
+  auto CompareToInstance =
+      addParameterComparison(BC, InstanceId, 1, "CompareToInstanceId");
   auto CompareBoth =
       BC.Builder.CreateAnd(CompareToVert, CompareToInstance, "CompareBoth");
 
@@ -476,9 +536,7 @@ Value *DxilDebugInstrumentation::addGeometryShaderProlog(
   auto PrimId =
       BC.Builder.CreateCall(PrimitiveIdOpFunc, {PrimitiveIdOpcode}, "PrimId");
 
-  auto CompareToPrim = BC.Builder.CreateICmpEQ(
-      PrimId, BC.HlslOP->GetU32Const(m_Parameters.GeometryShader.PrimitiveId),
-      "CompareToPrimId");
+  auto CompareToPrim = addParameterComparison(BC, PrimId, 0, "CompareToPrimId");
 
   if (BC.DM.GetGSInstanceCount() <= 1) {
     return CompareToPrim;
@@ -492,10 +550,8 @@ Value *DxilDebugInstrumentation::addGeometryShaderProlog(
       GSInstanceIdOpFunc, {GSInstanceIdOpcode}, "GSInstanceId");
 
   // Compare to expected vertex ID and instance ID
-  auto CompareToInstance = BC.Builder.CreateICmpEQ(
-      GSInstanceId,
-      BC.HlslOP->GetU32Const(m_Parameters.GeometryShader.InstanceId),
-      "CompareToInstanceId");
+  auto CompareToInstance =
+      addParameterComparison(BC, GSInstanceId, 1, "CompareToInstanceId");
   auto CompareBoth =
       BC.Builder.CreateAnd(CompareToPrim, CompareToInstance, "CompareBoth");
 
@@ -538,15 +594,30 @@ DxilDebugInstrumentation::addPixelShaderProlog(BuilderContext &BC,
   }
 
   // Compare to expected pixel position and primitive ID
-  auto CompareToX = BC.Builder.CreateICmpEQ(
-      XAsInt, BC.HlslOP->GetU32Const(m_Parameters.PixelShader.X), "CompareToX");
-  auto CompareToY = BC.Builder.CreateICmpEQ(
-      YAsInt, BC.HlslOP->GetU32Const(m_Parameters.PixelShader.Y), "CompareToY");
+  auto CompareToX = addParameterComparison(BC, XAsInt, 0, "CompareToX");
+  auto CompareToY = addParameterComparison(BC, YAsInt, 1, "CompareToY");
   auto ComparePos = BC.Builder.CreateAnd(CompareToX, CompareToY, "ComparePos");
 
   return ComparePos;
 }
 
+Value *DxilDebugInstrumentation::addParameterComparison(BuilderContext &BC,
+                                                       Value *V,
+                                                       unsigned ParameterIndex,
+                                                       const Twine &Name) {
+  Constant *Parameter =
+      BC.HlslOP->GetU32Const(m_Parameters.Parameters[ParameterIndex]);
+  unsigned Range = m_ParameterRanges[ParameterIndex];
+  if (Range <= 1) {
+    return BC.Builder.CreateICmpEQ(V, Parameter, Name);
+  }
+
+  // Values below the parameter wrap around to large unsigned offsets, so one
+  // unsigned comparison checks both ends of the range.
+  auto Offset = BC.Builder.CreateSub(V, Parameter, Name + "Offset");
+  return BC.Builder.CreateICmpULT(Offset, BC.HlslOP->GetU32Const(Range), Name);
+}
+
 void DxilDebugInstrumentation::addInvocationSelectionProlog(
     BuilderContext &BC, SystemValueIndices SVIndices) {
   auto ShaderModel = BC.DM.GetShaderModel();
@@ -628,8 +699,91 @@ void DxilDebugInstrumentation::reserveDebugEntrySpace(BuilderContext &BC,
     m_InvocationId = PreviousValue;
   }
 
+  setCurrentIndex(BC, PreviousValue);
+}
+
+void DxilDebugInstrumentation::reserveWaveCompactedDebugEntrySpace(
+    BuilderContext &BC, uint32_t SpaceInBytes) {
+  assert(m_CurrentIndex == nullptr);
+  assert(m_RemainingReservedSpaceInBytes == 0);
+
+  m_RemainingReservedSpaceInBytes = SpaceInBytes;
+
+  // Count the lanes of interest in the wave, and those before this lane:
+  Type *VoidTy = Type::getVoidTy(BC.Ctx);
+  Function *AllBitCountFunc =
+      BC.HlslOP->GetOpFunc(OP::OpCode::WaveAllBitCount, VoidTy);
+  Constant *AllBitCountOpcode =
+      BC.HlslOP->GetU32Const((unsigned)OP::OpCode::WaveAllBitCount);
+  auto LanesOfInterest = BC.Builder.CreateCall(
+      AllBitCountFunc, {AllBitCountOpcode, m_SelectionCriterion},
+      "LanesOfInterest");
+  Function *PrefixBitCountFunc =
+      BC.HlslOP->GetOpFunc(OP::OpCode::WavePrefixBitCount, VoidTy);
+  Constant *PrefixBitCountOpcode =
+      BC.HlslOP->GetU32Const((unsigned)OP::OpCode::WavePrefixBitCount);
+  auto PrecedingLanesOfInterest = BC.Builder.CreateCall(
+      PrefixBitCountFunc, {PrefixBitCountOpcode, m_SelectionCriterion},
+      "PrecedingLanesOfInterest");
+
+  // Only the first lane reserves space, for all lanes of interest at once:
+  Function *IsFirstLaneFunc =
+      BC.HlslOP->GetOpFunc(OP::OpCode::WaveIsFirstLane, VoidTy);
+  Constant *IsFirstLaneOpcode =
+      BC.HlslOP->GetU32Const((unsigned)OP::OpCode::WaveIsFirstLane);
+  auto IsFirstLane =
+      BC.Builder.CreateCall(IsFirstLaneFunc, {IsFirstLaneOpcode}, "IsFirstLane");
+  auto FirstLaneMultiplicand =
+      BC.Builder.CreateZExt(IsFirstLane, Type::getInt32Ty(BC.Ctx),
+                            "FirstLaneMultiplicand");
+  auto SpaceForWave = BC.Builder.CreateMul(
+      BC.HlslOP->GetU32Const(SpaceInBytes), LanesOfInterest, "SpaceForWave");
+  Value *IncrementForThisLane = BC.Builder.CreateMul(
+      SpaceForWave, FirstLaneMultiplicand, "IncrementForThisLane");
+
+  Function *AtomicOpFunc =
+      BC.HlslOP->GetOpFunc(OP::OpCode::AtomicBinOp, Type::getInt32Ty(BC.Ctx));
+  Constant *AtomicBinOpcode =
+      BC.HlslOP->GetU32Const((unsigned)OP::OpCode::AtomicBinOp);
+  Constant *AtomicAdd =
+      BC.HlslOP->GetU32Const((unsigned)DXIL::AtomicBinOpCode::Add);
+  UndefValue *UndefArg = UndefValue::get(Type::getInt32Ty(BC.Ctx));
+  auto PreviousValue = BC.Builder.CreateCall(
+      AtomicOpFunc,
+      {
+          AtomicBinOpcode,      // i32, ; opcode
+          m_HandleForUAV,       // %dx.types.Handle, ; resource handle
+          AtomicAdd,            // i32, ; binary operation code
+          m_CounterOffset,      // i32, ; coordinate c0: index in bytes
+          UndefArg,             // i32, ; coordinate c1 (unused)
+          UndefArg,             // i32, ; coordinate c2 (unused)
+          IncrementForThisLane, // i32); increment value
+      },
+      "UAVIncResult");
+
+  // Every lane takes the first lane's result as the base of the wave's space:
+  Function *ReadLaneFirstFunc = BC.HlslOP->GetOpFunc(
+      OP::OpCode::WaveReadLaneFirst, Type::getInt32Ty(BC.Ctx));
+  Constant *ReadLaneFirstOpcode =
+      BC.HlslOP->GetU32Const((unsigned)OP::OpCode::WaveReadLaneFirst);
+  auto WaveBase = BC.Builder.CreateCall(
+      ReadLaneFirstFunc, {ReadLaneFirstOpcode, PreviousValue}, "WaveBase");
+  auto OffsetInWave = BC.Builder.CreateMul(PrecedingLanesOfInterest,
+                                           BC.HlslOP->GetU32Const(SpaceInBytes),
+                                           "OffsetInWave");
+  auto LaneOffset = BC.Builder.CreateAdd(WaveBase, OffsetInWave, "LaneOffset");
+
+  if (m_InvocationId == nullptr) {
+    m_InvocationId = LaneOffset;
+  }
+
+  setCurrentIndex(BC, LaneOffset);
+}
+
+void DxilDebugInstrumentation::setCurrentIndex(BuilderContext &BC,
+                                               Value *Offset) {
   auto MaskedForLimit =
-      BC.Builder.CreateAnd(PreviousValue, m_OffsetMask, "MaskedForUAVLimit");
+      BC.Builder.CreateAnd(Offset, m_OffsetMask, "MaskedForUAVLimit");
   // The return value will either end up being itself (multiplied by one and
   // added with zero) or the "dump uninteresting things here" value of (UAVSize
   // - a bit).
@@ -721,7 +875,11 @@ void DxilDebugInstrumentation::addDebugEntryValue(BuilderContext &BC,
 
 void DxilDebugInstrumentation::addInvocationStartMarker(BuilderContext &BC) {
   DebugShaderModifierRecordHeader marker{{{0, 0, 0, 0}}, 0};
-  reserveDebugEntrySpace(BC, sizeof(marker));
+  if (m_BlockGranularity) {
+    reserveWaveCompactedDebugEntrySpace(BC, sizeof(marker));
+  } else {
+    reserveDebugEntrySpace(BC, sizeof(marker));
+  }
 
   marker.Header.Details.SizeDwords =
       DebugShaderModifierRecordPayloadSizeDwords(sizeof(marker));
@@ -739,7 +897,9 @@ void DxilDebugInstrumentation::addStepEntryForType(
     std::uint32_t InstNum, Value *V, std::uint32_t ValueOrdinal,
     Value *ValueOrdinalIndex) {
   DebugShaderModifierRecordDXILStep<ReturnType> step = {};
-  reserveDebugEntrySpace(BC, sizeof(step));
+  if (!m_SpaceIsPreReserved) {
+    reserveDebugEntrySpace(BC, sizeof(step));
+  }
 
   step.Header.Details.SizeDwords =
       DebugShaderModifierRecordPayloadSizeDwords(sizeof(step));
@@ -867,6 +1027,94 @@ void DxilDebugInstrumentation::addStepDebugEntryValue(
   }
 }
 
+void DxilDebugInstrumentation::collectBlockSteps(
+    BasicBlock &BB, std::vector<BlockStep> &Steps) {
+  Value *Zero32Arg = ConstantInt::get(Type::getInt32Ty(BB.getContext()), 0);
+
+  // The step for the terminator marks the block as executed:
+  TerminatorInst *Terminator = BB.getTerminator();
+  std::uint32_t TerminatorInstNum;
+  if (pix_dxil::PixDxilInstNum::FromInst(Terminator, &TerminatorInstNum)) {
+    Steps.push_back({nullptr, TerminatorInstNum, Terminator, 0, Zero32Arg});
+  }
+
+  // Values are recorded where they are computed. Walk the block backwards so
+  // that only the last store to each alloca register element is recorded.
+  std::vector<BlockStep> ValueSteps;
+  SmallPtrSet<Value *, 8> StoredPointers;
+  for (auto It = BB.rbegin(), E = BB.rend(); It != E; ++It) {
+    Instruction *Inst = &*It;
+    if (Inst->isTerminator() || isa<PHINode>(Inst)) {
+      // Terminators are handled above, and phis on the incoming edges
+      continue;
+    }
+
+    std::uint32_t InstNum;
+    if (!pix_dxil::PixDxilInstNum::FromInst(Inst, &InstNum)) {
+      continue;
+    }
+
+    if (auto *St = dyn_cast<StoreInst>(Inst)) {
+      std::uint32_t ValueOrdinalBase;
+      std::uint32_t UnusedValueOrdinalSize;
+      Value *ValueOrdinalIndex;
+      if (!pix_dxil::PixAllocaRegWrite::FromInst(St, &ValueOrdinalBase,
+                                                  &UnusedValueOrdinalSize,
+                                                  &ValueOrdinalIndex) ||
+          PIXPassHelpers::IsAllocateRayQueryInstruction(St->getValueOperand()) ||
+          DebugShaderModifierRecordDXILStepSizeBytes(
+              St->getValueOperand()->getType()) == 0 ||
+          !StoredPointers.insert(St->getPointerOperand()).second) {
+        continue;
+      }
+      ValueSteps.push_back({St->getNextNode(), InstNum, St->getValueOperand(),
+                            ValueOrdinalBase, ValueOrdinalIndex});
+      continue;
+    }
+
+    std::uint32_t RegNum;
+    if (!Inst->isUsedOutsideOfBlock(&BB) ||
+        PIXPassHelpers::IsAllocateRayQueryInstruction(Inst) ||
+        DebugShaderModifierRecordDXILStepSizeBytes(Inst->getType()) == 0 ||
+        !pix_dxil::PixDxilReg::FromInst(Inst, &RegNum)) {
+      continue;
+    }
+    ValueSteps.push_back(
+        {Inst->getNextNode(), InstNum, Inst, RegNum, Zero32Arg});
+  }
+
+  Steps.insert(Steps.end(), ValueSteps.rbegin(), ValueSteps.rend());
+}
+
+void DxilDebugInstrumentation::addBlockStepDebugEntries(
+    BuilderContext &BC, ArrayRef<BlockStep> Steps) {
+  uint32_t SpaceInBytes = 0;
+  for (const BlockStep &Step : Steps) {
+    SpaceInBytes += DebugShaderModifierRecordDXILStepSizeBytes(Step.V->getType());
+  }
+  if (SpaceInBytes == 0) {
+    return;
+  }
+
+  // The space is reserved where BC inserts, which must dominate all of
+  // the steps' insertion points.
+  reserveWaveCompactedDebugEntrySpace(BC, SpaceInBytes);
+  m_SpaceIsPreReserved = true;
+  for (const BlockStep &Step : Steps) {
+    if (Step.InsertBefore == nullptr) {
+      addStepDebugEntryValue(BC, Step.InstNum, Step.V, Step.ValueOrdinal,
+                             Step.ValueOrdinalIndex);
+    } else {
+      IRBuilder<> Builder(Step.InsertBefore);
+      BuilderContext BC2{BC.M, BC.DM, BC.Ctx, BC.HlslOP, Builder};
+      addStepDebugEntryValue(BC2, Step.InstNum, Step.V, Step.ValueOrdinal,
+                             Step.ValueOrdinalIndex);
+    }
+  }
+  m_SpaceIsPreReserved = false;
+  assert(m_CurrentIndex == nullptr);
+}
+
 bool DxilDebugInstrumentation::runOnModule(Module &M) {
   DxilModule &DM = M.GetOrCreateDxilModule();
   LLVMContext &Ctx = M.getContext();
@@ -923,6 +1171,10 @@ bool DxilDebugInstrumentation::runOnModule(Module &M) {
 
   auto Fn = PIXPassHelpers::GetEntryFunction(DM);
   auto &Blocks = Fn->getBasicBlockList();
+  std::vector<BasicBlock *> OriginalBlocks;
+  for (auto &Block : Blocks) {
+    OriginalBlocks.push_back(&Block);
+  }
   for (auto &CurrentBlock : Blocks) {
     struct ValueAndPhi {
       Value *Val;
@@ -964,6 +1216,7 @@ bool DxilDebugInstrumentation::runOnModule(Module &M) {
       }
 
       // Modify the Phis and add debug instrumentation
+      std::vector<BlockStep> EdgeSteps;
       for (auto &ValueNPhi : InsertableEdge.second) {
         // Modify the phi to refer to the new block:
         ValueNPhi.Phi->setIncomingBlock(ValueNPhi.Index, NewBlock);
@@ -979,16 +1232,47 @@ bool DxilDebugInstrumentation::runOnModule(Module &M) {
           continue;
         }
 
+        if (m_BlockGranularity) {
+          EdgeSteps.push_back(
+              {nullptr, InstNum, ValueNPhi.Val, RegNum, Builder.getInt32(0)});
+          continue;
+        }
+
         BuilderContext BC{M, DM, Ctx, HlslOP, Builder};
         addStepDebugEntryValue(BC, InstNum, ValueNPhi.Val, RegNum,
                                BC.Builder.getInt32(0));
       }
+      if (!EdgeSteps.empty()) {
+        BuilderContext BC{M, DM, Ctx, HlslOP, Builder};
+        addBlockStepDebugEntries(BC, EdgeSteps);
+      }
 
       // Add a branch to the new block to point to the current block
       Builder.CreateBr(&CurrentBlock);
     }
   }
 
+  if (m_BlockGranularity) {
+    // Instrument each original block from its start. The entry block's
+    // records go after the invocation prolog.
+    for (BasicBlock *Block : OriginalBlocks) {
+      std::vector<BlockStep> Steps;
+      collectBlockSteps(*Block, Steps);
+      if (Block == &Fn->getEntryBlock()) {
+        addBlockStepDebugEntries(BC, Steps);
+      } else {
+        IRBuilder<> Builder(Block->getFirstInsertionPt());
+        BuilderContext BC2{BC.M, BC.DM, BC.Ctx, BC.HlslOP, Builder};
+        addBlockStepDebugEntries(BC2, Steps);
+      }
+    }
+
+    DM.m_ShaderFlags.SetWaveOps(true);
+    DM.ReEmitDxilResources();
+
+    return true;
+  }
+
   // Instrument original instructions:
   for (auto &Inst : AllInstructions) {
     // Instrumentation goes after the instruction if it is not a terminator.
@@ -21,6 +21,7 @@
 
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include <deque>
 
@@ -65,6 +66,10 @@ private:
   Constant *m_OffsetMask = nullptr;
 
   uint64_t m_UAVSize = 1024 * 1024;
+  // With waveCoalesce, the first active lane reserves the space for the
+  // records of the whole wave, and each record is written four dwords at a
+  // time. The records themselves are unchanged.
+  bool m_WaveCoalesce = false;
 
   struct BuilderContext {
     Module &M;
@@ -78,14 +83,15 @@ private:
   Value *insertInstructionsToCalculateGroupIdZ(BuilderContext &BC);
   Value *reserveDebugEntrySpace(BuilderContext &BC, uint32_t SpaceInBytes);
   uint32_t UAVDumpingGroundOffset();
-  Value *writeDwordAndReturnNewOffset(BuilderContext &BC, Value *TheOffset,
-                                      Value *TheValue);
+  Value *writeDwordsAndReturnNewOffset(BuilderContext &BC, Value *TheOffset,
+                                       ArrayRef<Value *> TheValues);
   template <typename... T> void Instrument(BuilderContext &BC, T... values);
 };
 
 void DxilPIXMeshShaderOutputInstrumentation::applyOptions(PassOptions O) 
 {
   GetPassOptionUInt64(O, "UAVSize", &m_UAVSize, 1024 * 1024);
+  GetPassOptionBool(O, "waveCoalesce", &m_WaveCoalesce, false);
 }
 
 uint32_t DxilPIXMeshShaderOutputInstrumentation::UAVDumpingGroundOffset() 
@@ -149,9 +155,42 @@ Value *DxilPIXMeshShaderOutputInstrumentation::reserveDebugEntrySpace(
       BC.HlslOP->GetU32Const(UAVDumpingGroundOffset() + CounterOffsetBeyondUsefulData);
   UndefValue *UndefArg = UndefValue::get(Type::getInt32Ty(BC.Ctx));
 
-  Constant *Increment = BC.HlslOP->GetU32Const(SpaceInBytes);
+  Constant *RecordSize = BC.HlslOP->GetU32Const(SpaceInBytes);
+  Value *Increment = RecordSize;
+
+  // Lanes of the wave get consecutive records of the space reserved by the
+  // first active lane.
+  Instruction *SplitPoint = nullptr;
+  BasicBlock *HeadBlock = nullptr;
+  Value *LanesBefore = nullptr;
+  if (m_WaveCoalesce) {
+    Constant *True = ConstantInt::getTrue(BC.Ctx);
+    Value *IsFirstLane =
+        PIXPassHelpers::EmitWaveIsFirstLane(BC.HlslOP, BC.Builder);
+    Function *AllBitCountFunc = BC.HlslOP->GetOpFunc(
+        OP::OpCode::WaveAllBitCount, Type::getVoidTy(BC.Ctx));
+    Constant *AllBitCountOpcode =
+        BC.HlslOP->GetU32Const((unsigned)OP::OpCode::WaveAllBitCount);
+    auto *ActiveLanes = BC.Builder.CreateCall(
+        AllBitCountFunc, {AllBitCountOpcode, True}, "ActiveLanes");
+    Function *PrefixBitCountFunc = BC.HlslOP->GetOpFunc(
+        OP::OpCode::WavePrefixBitCount, Type::getVoidTy(BC.Ctx));
+    Constant *PrefixBitCountOpcode =
+        BC.HlslOP->GetU32Const((unsigned)OP::OpCode::WavePrefixBitCount);
+    LanesBefore = BC.Builder.CreateCall(
+        PrefixBitCountFunc, {PrefixBitCountOpcode, True}, "LanesBefore");
+    Increment =
+        BC.Builder.CreateMul(ActiveLanes, RecordSize, "WaveSpaceInBytes");
+
+    SplitPoint = &*BC.Builder.GetInsertPoint();
+    HeadBlock = BC.Builder.GetInsertBlock();
+    TerminatorInst *ThenTerminator =
+        SplitBlockAndInsertIfThen(IsFirstLane, SplitPoint, false);
+    BC.Builder.SetInsertPoint(ThenTerminator);
+    BC.DM.m_ShaderFlags.SetWaveOps(true);
+  }
 
-  auto *PreviousValue = BC.Builder.CreateCall(
+  Value *PreviousValue = BC.Builder.CreateCall(
       AtomicOpFunc,
       {
           AtomicBinOpcode, // i32, ; opcode
@@ -165,19 +204,41 @@ Value *DxilPIXMeshShaderOutputInstrumentation::reserveDebugEntrySpace(
       },
       "UAVIncResult");
 
+  if (m_WaveCoalesce) {
+    BC.Builder.SetInsertPoint(SplitPoint);
+    PHINode *Reserved =
+        BC.Builder.CreatePHI(Type::getInt32Ty(BC.Ctx), 2, "WaveUAVIncResult");
+    Reserved->addIncoming(PreviousValue,
+                          cast<Instruction>(PreviousValue)->getParent());
+    Reserved->addIncoming(UndefArg, HeadBlock);
+    Function *ReadLaneFirstFunc = BC.HlslOP->GetOpFunc(
+        DXIL::OpCode::WaveReadLaneFirst, Type::getInt32Ty(BC.Ctx));
+    Constant *ReadLaneFirstOpcode =
+        BC.HlslOP->GetU32Const((unsigned)DXIL::OpCode::WaveReadLaneFirst);
+    auto *WaveBase = BC.Builder.CreateCall(
+        ReadLaneFirstFunc, {ReadLaneFirstOpcode, Reserved}, "WaveBase");
+    PreviousValue = BC.Builder.CreateAdd(
+        WaveBase, BC.Builder.CreateMul(LanesBefore, RecordSize),
+        "LaneUAVIncResult");
+  }
+
   return BC.Builder.CreateAnd(PreviousValue, m_OffsetMask, "MaskedForUAVLimit");
 }
 
-Value *DxilPIXMeshShaderOutputInstrumentation::writeDwordAndReturnNewOffset(
-    BuilderContext &BC, Value *TheOffset, Value *TheValue) 
+Value *DxilPIXMeshShaderOutputInstrumentation::writeDwordsAndReturnNewOffset(
+    BuilderContext &BC, Value *TheOffset, ArrayRef<Value *> TheValues) 
 {
+  assert(!TheValues.empty() && TheValues.size() <= 4);
 
   Function *StoreValue =
       BC.HlslOP->GetOpFunc(OP::OpCode::BufferStore, Type::getInt32Ty(BC.Ctx));
   Constant *StoreValueOpcode =
       BC.HlslOP->GetU32Const((unsigned)DXIL::OpCode::BufferStore);
   UndefValue *Undef32Arg = UndefValue::get(Type::getInt32Ty(BC.Ctx));
-  Constant *WriteMask_X = BC.HlslOP->GetI8Const(1);
+  const unsigned DwordCount = TheValues.size();
+  Constant *WriteMask = BC.HlslOP->GetI8Const((1 << DwordCount) - 1);
+  Value *V[4] = {Undef32Arg, Undef32Arg, Undef32Arg, Undef32Arg};
+  std::copy(TheValues.begin(), TheValues.end(), V);
 
   (void)BC.Builder.CreateCall(
       StoreValue,
@@ -185,19 +246,19 @@ Value *DxilPIXMeshShaderOutputInstrumentation::writeDwordAndReturnNewOffset(
        m_OutputUAV,      // %dx.types.Handle, ; resource handle
        TheOffset,        // i32 c0: index in bytes into UAV
        Undef32Arg,       // i32 c1: unused
-       TheValue,
-       Undef32Arg, // unused values
-       Undef32Arg, // unused values
-       Undef32Arg, // unused values
-       WriteMask_X});
+       V[0],
+       V[1], // unused values past DwordCount
+       V[2],
+       V[3],
+       WriteMask});
 
-  m_RemainingReservedSpaceInBytes -= sizeof(uint32_t);
+  m_RemainingReservedSpaceInBytes -= DwordCount * sizeof(uint32_t);
   assert(m_RemainingReservedSpaceInBytes >=
          0); // or else the caller didn't reserve enough space
 
   return BC.Builder.CreateAdd(
-      TheOffset,
-      BC.HlslOP->GetU32Const(static_cast<unsigned int>(sizeof(uint32_t))));
+      TheOffset, BC.HlslOP->GetU32Const(static_cast<unsigned int>(
+                     DwordCount * sizeof(uint32_t))));
 }
 
 template <typename... T>
@@ -209,9 +270,12 @@ void DxilPIXMeshShaderOutputInstrumentation::Instrument(BuilderContext &BC,
   const uint32_t DwordCount = Values.size();
   llvm::Value *byteOffset =
       reserveDebugEntrySpace(BC, DwordCount * sizeof(uint32_t));
-  for (llvm::Value *V : Values)
+  const uint32_t DwordsPerStore = m_WaveCoalesce ? 4 : 1;
+  for (uint32_t i = 0; i < DwordCount; i += DwordsPerStore)
   {
-    byteOffset = writeDwordAndReturnNewOffset(BC, byteOffset, V);
+    byteOffset = writeDwordsAndReturnNewOffset(
+        BC, byteOffset,
+        makeArrayRef(Values).slice(i, std::min(DwordsPerStore, DwordCount - i)));
   }
 }
 
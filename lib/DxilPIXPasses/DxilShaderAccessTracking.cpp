@@ -21,10 +21,15 @@
 #include "dxc/HLSL/DxilGenerationPass.h"
 #include "dxc/HLSL/DxilSpanAllocator.h"
 
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include <deque>
+#include <memory>
+#include <mutex>
 
 #include "PixPassHelpers.h"
 
@@ -149,6 +154,15 @@ struct SlotRange {
   unsigned numInvariableSlots;
 };
 
+// The parsed "config" option: where PIX expects each register range's access
+// records, and where the records for heap-indexed descriptors go.
+struct TrackingConfiguration {
+  std::map<RegisterTypeAndSpace, SlotRange> SlotAssignments;
+  int DynamicResourceDataOffset = -1;
+  int DynamicSamplerDataOffset = -1;
+  int OutputBufferSize = -1;
+};
+
 enum class AccessStyle { None, FromRootSig, ResourceFromDescriptorHeap, SamplerFromDescriptorHeap };
 struct DxilResourceAndClass {
   AccessStyle accessStyle;
@@ -184,6 +198,8 @@ public:
 private:
   void EmitAccess(LLVMContext &Ctx, OP *HlslOP, IRBuilder<> &, Value *slot,
                   ShaderAccessFlags access);
+  void EmitAccessStore(LLVMContext &Ctx, OP *HlslOP, IRBuilder<> &Builder,
+                       Value *ByteOffset, Value *StoredValue);
   bool EmitResourceAccess(DxilResourceAndClass &res, Instruction *instruction,
                           OP *HlslOP, LLVMContext &Ctx,
                           ShaderAccessFlags readWrite);
@@ -198,13 +214,20 @@ private:
 
   std::vector<DynamicResourceBinding> m_dynamicResourceBindings;
   bool m_CheckForDynamicIndexing = false;
-  int m_DynamicResourceDataOffset = -1;
-  int m_DynamicSamplerDataOffset = -1;
-  int m_OutputBufferSize = -1;
-  std::map<RegisterTypeAndSpace, SlotRange> m_slotAssignments;
+  bool m_WaveCoalesce = false;
+  std::shared_ptr<const TrackingConfiguration> m_Config =
+      std::make_shared<TrackingConfiguration>();
   std::map<llvm::Function *, CallInst *> m_FunctionToUAVHandle;
   std::map<llvm::Function *, std::map<ResourceAccessStyle, Constant *>> m_FunctionToEncodedAccess;
   std::set<RSRegisterIdentifier> m_DynamicallyIndexedBindPoints;
+
+  // For waveCoalesce: the points at which each constant (offset, value) store
+  // was made, per function, and the dominator trees used to find repeats.
+  std::map<llvm::Function *,
+           std::map<std::pair<Value *, Value *>, std::vector<Instruction *>>>
+      m_FunctionToConstantStorePoints;
+  std::map<llvm::Function *, std::unique_ptr<DominatorTree>>
+      m_FunctionToDomTree;
 };
 
 static unsigned DeserializeInt(std::deque<char> &q) {
@@ -263,46 +286,128 @@ static void ValidateDelimiter(std::deque<char> &q, char d) {
   q.pop_front();
 }
 
-void DxilShaderAccessTracking::applyOptions(PassOptions O) {
-  int checkForDynamic;
-  GetPassOptionInt(O, "checkForDynamicIndexing", &checkForDynamic, 0);
-  m_CheckForDynamicIndexing = checkForDynamic != 0;
+static std::shared_ptr<TrackingConfiguration>
+ParseTextConfiguration(StringRef configOption) {
+  auto result = std::make_shared<TrackingConfiguration>();
 
-  StringRef configOption;
-  if (GetPassOption(O, "config", &configOption)) {
-    std::deque<char> config;
-    config.assign(configOption.begin(), configOption.end());
+  std::deque<char> config;
+  config.assign(configOption.begin(), configOption.end());
 
-    // Parse slot assignments. Compare with PIX's ShaderAccessHelpers.cpp
-    // (TrackingConfiguration::SerializedRepresentation)
-    RegisterType rt = ParseRegisterType(config);
-    while (rt != RegisterType::Terminator) {
+  // Parse slot assignments. Compare with PIX's ShaderAccessHelpers.cpp
+  // (TrackingConfiguration::SerializedRepresentation)
+  RegisterType rt = ParseRegisterType(config);
+  while (rt != RegisterType::Terminator) {
 
-      RegisterTypeAndSpace rst;
-      rst.Type = rt;
+    RegisterTypeAndSpace rst;
+    rst.Type = rt;
 
-      rst.Space = DeserializeInt(config);
-      ValidateDelimiter(config, ':');
+    rst.Space = DeserializeInt(config);
+    ValidateDelimiter(config, ':');
 
-      SlotRange sr;
-      sr.startSlot = DeserializeInt(config);
-      ValidateDelimiter(config, ':');
+    SlotRange sr;
+    sr.startSlot = DeserializeInt(config);
+    ValidateDelimiter(config, ':');
 
-      sr.numSlots = DeserializeInt(config);
-      ValidateDelimiter(config, 'i');
+    sr.numSlots = DeserializeInt(config);
+    ValidateDelimiter(config, 'i');
 
-      sr.numInvariableSlots = DeserializeInt(config);
-      ValidateDelimiter(config, ';');
+    sr.numInvariableSlots = DeserializeInt(config);
+    ValidateDelimiter(config, ';');
 
-      m_slotAssignments[rst] = sr;
+    result->SlotAssignments[rst] = sr;
 
-      rt = ParseRegisterType(config);
-    }
-    m_DynamicResourceDataOffset = DeserializeInt(config);
-    ValidateDelimiter(config, ';');
-    m_DynamicSamplerDataOffset = DeserializeInt(config);
-    ValidateDelimiter(config, ';');
-    m_OutputBufferSize = DeserializeInt(config);
+    rt = ParseRegisterType(config);
+  }
+  result->DynamicResourceDataOffset = DeserializeInt(config);
+  ValidateDelimiter(config, ';');
+  result->DynamicSamplerDataOffset = DeserializeInt(config);
+  ValidateDelimiter(config, ';');
+  result->OutputBufferSize = DeserializeInt(config);
+  return result;
+}
+
+// The binary form of the configuration is a '#' followed by a sequence of
+// 32-bit words, each written as eight hex digits, most significant first:
+//   version (1), number of slot assignments N,
+//   N x (register type, space, start slot, slot count, invariable slots),
+//   dynamic resource data offset, dynamic sampler data offset, buffer size.
+// Register types use the values of the RegisterType enum.
+constexpr char BinaryConfigurationPrefix = '#';
+constexpr uint32_t BinaryConfigurationVersion = 1;
+
+static std::shared_ptr<TrackingConfiguration>
+ParseBinaryConfiguration(StringRef configOption) {
+  StringRef hex = configOption.drop_front();
+  ThrowIf(hex.size() % 8 != 0);
+  size_t wordCount = hex.size() / 8;
+  size_t nextWord = 0;
+  auto ReadWord = [&]() {
+    ThrowIf(nextWord >= wordCount);
+    uint32_t word;
+    ThrowIf(hex.substr(nextWord++ * 8, 8).getAsInteger(16, word));
+    return word;
+  };
+
+  ThrowIf(ReadWord() != BinaryConfigurationVersion);
+  uint32_t slotAssignmentCount = ReadWord();
+  ThrowIf(wordCount != 2 + slotAssignmentCount * 5 + 3);
+
+  auto result = std::make_shared<TrackingConfiguration>();
+  for (uint32_t i = 0; i < slotAssignmentCount; ++i) {
+    uint32_t type = ReadWord();
+    ThrowIf(type >= static_cast<uint32_t>(RegisterType::Terminator));
+    RegisterTypeAndSpace rst;
+    rst.Type = static_cast<RegisterType>(type);
+    rst.Space = ReadWord();
+
+    SlotRange sr;
+    sr.startSlot = ReadWord();
+    sr.numSlots = ReadWord();
+    sr.numInvariableSlots = ReadWord();
+    result->SlotAssignments[rst] = sr;
+  }
+  result->DynamicResourceDataOffset = static_cast<int>(ReadWord());
+  result->DynamicSamplerDataOffset = static_cast<int>(ReadWord());
+  result->OutputBufferSize = static_cast<int>(ReadWord());
+  return result;
+}
+
+// PIX instruments every shader of a capture with the same configuration, so
+// parsed configurations are shared by all instances of the pass.
+static std::shared_ptr<const TrackingConfiguration>
+GetTrackingConfiguration(StringRef configOption) {
+  static std::mutex cacheMutex;
+  static StringMap<std::shared_ptr<const TrackingConfiguration>> cache;
+  constexpr size_t maxCachedConfigurations = 16;
+
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(configOption);
+    if (it != cache.end())
+      return it->second;
+  }
+
+  std::shared_ptr<const TrackingConfiguration> config =
+      !configOption.empty() && configOption.front() == BinaryConfigurationPrefix
+          ? ParseBinaryConfiguration(configOption)
+          : ParseTextConfiguration(configOption);
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if (cache.size() >= maxCachedConfigurations)
+    cache.clear();
+  cache[configOption] = config;
+  return config;
+}
+
+void DxilShaderAccessTracking::applyOptions(PassOptions O) {
+  int checkForDynamic;
+  GetPassOptionInt(O, "checkForDynamicIndexing", &checkForDynamic, 0);
+  m_CheckForDynamicIndexing = checkForDynamic != 0;
+  GetPassOptionBool(O, "waveCoalesce", &m_WaveCoalesce, false);
+
+  StringRef configOption;
+  if (GetPassOption(O, "config", &configOption)) {
+    m_Config = GetTrackingConfiguration(configOption);
   }
 }
 
@@ -316,8 +421,54 @@ void DxilShaderAccessTracking::EmitAccess(LLVMContext &Ctx, OP *HlslOP,
   auto OffsetByteIndex = Builder.CreateAdd(
       ByteIndex, HlslOP->GetU32Const(OffsetForAccessType), "OffsetByteIndex");
 
+  EmitAccessStore(Ctx, HlslOP, Builder, OffsetByteIndex,
+                  HlslOP->GetU32Const(1));
+}
+
+void DxilShaderAccessTracking::EmitAccessStore(LLVMContext &Ctx, OP *HlslOP,
+                                               IRBuilder<> &Builder,
+                                               Value *ByteOffset,
+                                               Value *StoredValue) {
+  Instruction *AccessPoint = &*Builder.GetInsertPoint();
+  if (m_WaveCoalesce) {
+    Function *F = Builder.GetInsertBlock()->getParent();
+    auto &DT = m_FunctionToDomTree[F];
+    if (!DT) {
+      DT.reset(new DominatorTree());
+      DT->recalculate(*F);
+    }
+
+    // The same constant store made at a point that dominates this one has
+    // already been made by the time any lane gets here.
+    if (isa<Constant>(ByteOffset)) {
+      auto &Points =
+          m_FunctionToConstantStorePoints[F][std::make_pair(ByteOffset,
+                                                            StoredValue)];
+      for (Instruction *Point : Points) {
+        if (DT->dominates(Point, AccessPoint)) {
+          return;
+        }
+      }
+      Points.push_back(AccessPoint);
+    }
+
+    // Of the lanes that store to the first active lane's offset, only the
+    // first lane does. This is the whole wave for constant offsets.
+    Value *ShouldStore = PIXPassHelpers::EmitWaveIsFirstLane(HlslOP, Builder);
+    if (!isa<Constant>(ByteOffset)) {
+      auto SharesFirstLaneOffset =
+          PIXPassHelpers::EmitWaveSharesFirstLaneValue(HlslOP, Builder,
+                                                       ByteOffset);
+      ShouldStore =
+          Builder.CreateOr(ShouldStore, Builder.CreateNot(SharesFirstLaneOffset),
+                           "IsAccessRepresentative");
+    }
+    TerminatorInst *ThenTerminator = SplitBlockAndInsertIfThen(
+        ShouldStore, AccessPoint, false, nullptr, DT.get());
+    Builder.SetInsertPoint(ThenTerminator);
+  }
+
   UndefValue *UndefIntArg = UndefValue::get(Type::getInt32Ty(Ctx));
-  Constant *LiteralOne = HlslOP->GetU32Const(1);
   Constant *ElementMask = HlslOP->GetI8Const(1);
 
   Function *StoreFunc =
@@ -331,14 +482,18 @@ void DxilShaderAccessTracking::EmitAccess(LLVMContext &Ctx, OP *HlslOP,
           m_FunctionToUAVHandle.at(
               Builder.GetInsertBlock()
                   ->getParent()), // %dx.types.Handle, ; resource handle
-          OffsetByteIndex,        // i32, ; coordinate c0: byte offset
+          ByteOffset,             // i32, ; coordinate c0: byte offset
           UndefIntArg,            // i32, ; coordinate c1 (unused)
-          LiteralOne,             // i32, ; value v0
+          StoredValue,            // i32, ; value v0
           UndefIntArg,            // i32, ; value v1
           UndefIntArg,            // i32, ; value v2
           UndefIntArg,            // i32, ; value v3
           ElementMask             // i8 ; just the first value is used
       });
+
+  if (m_WaveCoalesce) {
+    Builder.SetInsertPoint(AccessPoint);
+  }
 }
 
 static ResourceAccessStyle AccessStyleFromAccessAndType(
@@ -381,9 +536,9 @@ bool DxilShaderAccessTracking::EmitResourceAccess(DxilResourceAndClass &res,
         static_cast<unsigned>(res.RegisterSpace) // reserved spaces are -ve, but user spaces can only be +ve
     };
 
-    auto slot = m_slotAssignments.find(typeAndSpace);
+    auto slot = m_Config->SlotAssignments.find(typeAndSpace);
     // If the assignment isn't found, we assume it's not accessed
-    if (slot != m_slotAssignments.end()) {
+    if (slot != m_Config->SlotAssignments.end()) {
 
         Value *slotIndex;
     
@@ -432,20 +587,22 @@ bool DxilShaderAccessTracking::EmitResourceAccess(DxilResourceAndClass &res,
       return true; // did modify
     }
   }
-  else if (m_DynamicResourceDataOffset != -1) {
+  else if (m_Config->DynamicResourceDataOffset != -1) {
       if (res.accessStyle == AccessStyle::ResourceFromDescriptorHeap ||
           res.accessStyle == AccessStyle::SamplerFromDescriptorHeap)
       {
           Constant* BaseOfRecordsForType;
           int LimitForType;
           if (res.accessStyle == AccessStyle::ResourceFromDescriptorHeap) {
-              LimitForType = m_DynamicSamplerDataOffset - m_DynamicResourceDataOffset;
+              LimitForType = m_Config->DynamicSamplerDataOffset -
+                             m_Config->DynamicResourceDataOffset;
               BaseOfRecordsForType =
-                  HlslOP->GetU32Const(m_DynamicResourceDataOffset);
+                  HlslOP->GetU32Const(m_Config->DynamicResourceDataOffset);
           } else {
-              LimitForType = m_OutputBufferSize - m_DynamicSamplerDataOffset;
+              LimitForType = m_Config->OutputBufferSize -
+                             m_Config->DynamicSamplerDataOffset;
               BaseOfRecordsForType =
-                HlslOP->GetU32Const(m_DynamicSamplerDataOffset);
+                HlslOP->GetU32Const(m_Config->DynamicSamplerDataOffset);
           }
 
           // Branchless limit: compare offset to size of data reserved for that type,
@@ -498,27 +655,7 @@ bool DxilShaderAccessTracking::EmitResourceAccess(DxilResourceAndClass &res,
                                 .at(Builder.GetInsertBlock()->getParent())
                                 .at(accessStyle);
 
-          Constant *ElementMask = HlslOP->GetI8Const(1);
-          Function *StoreFunc =
-              HlslOP->GetOpFunc(OP::OpCode::BufferStore, Type::getInt32Ty(Ctx));
-          Constant *StoreOpcode =
-              HlslOP->GetU32Const((unsigned)OP::OpCode::BufferStore);
-          UndefValue *UndefArg = UndefValue::get(Type::getInt32Ty(Ctx));
-          (void)Builder.CreateCall(
-              StoreFunc,
-              {
-                  StoreOpcode,                  // i32, ; opcode
-                  m_FunctionToUAVHandle.at(
-                      Builder.GetInsertBlock()
-                          ->getParent()),       // %dx.types.Handle, ; resource handle
-                  Offset,                // i32, ; coordinate c0: byte offset
-                  UndefArg,                     // i32, ; coordinate c1 (unused)
-                  EncodedFlags,                 // i32, ; value v0
-                  UndefArg,                     // i32, ; value v1
-                  UndefArg,                     // i32, ; value v2
-                  UndefArg,                     // i32, ; value v3
-                  ElementMask                   // i8 ; just the first value is used
-              });
+          EmitAccessStore(Ctx, HlslOP, Builder, Offset, EncodedFlags);
           return true; // did modify
       }
   }
@@ -803,6 +940,10 @@ bool DxilShaderAccessTracking::runOnModule(Module &M) {
       }
     }
 
+    if (m_WaveCoalesce && Modified) {
+      DM.m_ShaderFlags.SetWaveOps(true);
+    }
+
     if (OSOverride != nullptr) {
       formatted_raw_ostream FOS(*OSOverride);
       FOS << "DynamicallyIndexedBindPoints=";
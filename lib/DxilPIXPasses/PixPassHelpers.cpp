@@ -173,6 +173,27 @@ llvm::Function* GetEntryFunction(hlsl::DxilModule& DM) {
     return DM.GetPatchConstantFunction();
 }
 
+llvm::Value *EmitWaveIsFirstLane(hlsl::OP *HlslOP, llvm::IRBuilder<> &Builder) {
+  Function *IsFirstLaneFunc = HlslOP->GetOpFunc(
+      DXIL::OpCode::WaveIsFirstLane, Type::getVoidTy(Builder.getContext()));
+  Constant *IsFirstLaneOpcode =
+      HlslOP->GetU32Const((unsigned)DXIL::OpCode::WaveIsFirstLane);
+  return Builder.CreateCall(IsFirstLaneFunc, {IsFirstLaneOpcode},
+                            "IsFirstLane");
+}
+
+llvm::Value *EmitWaveSharesFirstLaneValue(hlsl::OP *HlslOP,
+                                          llvm::IRBuilder<> &Builder,
+                                          llvm::Value *Val) {
+  Function *ReadLaneFirstFunc =
+      HlslOP->GetOpFunc(DXIL::OpCode::WaveReadLaneFirst, Val->getType());
+  Constant *ReadLaneFirstOpcode =
+      HlslOP->GetU32Const((unsigned)DXIL::OpCode::WaveReadLaneFirst);
+  auto FirstLaneValue = Builder.CreateCall(
+      ReadLaneFirstFunc, {ReadLaneFirstOpcode, Val}, "FirstLaneValue");
+  return Builder.CreateICmpEQ(Val, FirstLaneValue, "SharesFirstLaneValue");
+}
+
 #ifdef PIX_DEBUG_DUMP_HELPER
 
 static int g_logIndent = 0;
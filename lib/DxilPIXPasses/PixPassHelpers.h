@@ -24,6 +24,12 @@ namespace PIXPassHelpers
         hlsl::DxilResourceBase * resource,
         const char* name);
     llvm::Function* GetEntryFunction(hlsl::DxilModule& DM);
+    // Wave helpers for coalescing instrumentation writes: the first returns
+    // true on the first active lane; the second returns true on the lanes
+    // whose Val equals the first active lane's.
+    llvm::Value* EmitWaveIsFirstLane(hlsl::OP* HlslOP, llvm::IRBuilder<>& Builder);
+    llvm::Value* EmitWaveSharesFirstLaneValue(hlsl::OP* HlslOP, llvm::IRBuilder<>& Builder,
+                                              llvm::Value* Val);
 #ifdef PIX_DEBUG_DUMP_HELPER
     void Log(const char* format, ...);
     void LogPartialLine(const char* format, ...);
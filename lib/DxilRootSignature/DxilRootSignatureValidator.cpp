@@ -18,6 +18,7 @@
 #include "dxc/dxcapi.h"
 
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 
 #include <string>
@@ -26,6 +27,9 @@
 #include <vector>
 #include <set>
 #include <ios>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
@@ -47,7 +51,7 @@ class CIntervalCollection {
 private:
   std::set<T> m_set;
 public:
-  const T* FindIntersectingInterval(const T &I) {
+  const T* FindIntersectingInterval(const T &I) const {
     auto it = m_set.find(I);
     if (it != m_set.end())
       return &*it;
@@ -87,10 +91,12 @@ public:
   void VerifyRootSignature(const DxilVersionedRootSignatureDesc *pRootSignature,
                            DiagnosticPrinter &DiagPrinter);
 
+  // Does not modify the verifier, so one verified root signature can check
+  // shaders on several threads at once.
   void VerifyShader(DxilShaderVisibility VisType,
                     const void *pPSVData,
                     uint32_t PSVSize,
-                    DiagnosticPrinter &DiagPrinter);
+                    DiagnosticPrinter &DiagPrinter) const;
 
   typedef enum NODE_TYPE {
     DESCRIPTOR_TABLE_ENTRY,
@@ -142,12 +148,17 @@ private:
                                             DxilShaderVisibility VisType,
                                             unsigned Num,
                                             unsigned LB,
-                                            unsigned Space);
+                                            unsigned Space) const;
 
   RegisterRanges &
   GetRanges(DxilShaderVisibility VisType, DxilDescriptorRangeType DescType) {
     return RangeKinds[(unsigned)VisType][(unsigned)DescType];
   }
+  const RegisterRanges &
+  GetRanges(DxilShaderVisibility VisType,
+            DxilDescriptorRangeType DescType) const {
+    return RangeKinds[(unsigned)VisType][(unsigned)DescType];
+  }
 
   RegisterRanges RangeKinds[kMaxVisType + 1][kMaxDescType + 1];
   bool m_bAllowReservedRegisterSpace;
@@ -379,7 +390,7 @@ RootSignatureVerifier::FindCoveringInterval(DxilDescriptorRangeType RangeType,
                                             DxilShaderVisibility VisType,
                                             unsigned Num,
                                             unsigned LB,
-                                            unsigned Space) {
+                                            unsigned Space) const {
   RegisterRange RR;
   RR.space = Space;
   RR.lb = LB;
@@ -574,7 +585,7 @@ void RootSignatureVerifier::VerifyRootSignature(
 void RootSignatureVerifier::VerifyShader(DxilShaderVisibility VisType,
                                          const void *pPSVData,
                                          uint32_t PSVSize,
-                                         DiagnosticPrinter &DiagPrinter) {
+                                         DiagnosticPrinter &DiagPrinter) const {
   DxilPipelineStateValidation PSV;
   IFTBOOL(PSV.InitFromPSV0(pPSVData, PSVSize), E_INVALIDARG);
 
@@ -868,4 +879,110 @@ bool VerifyRootSignature(_In_ const DxilVersionedRootSignatureDesc *pDesc,
   return true;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Memoized verification of serialized root signatures.
+//
+// Applications embed a handful of root signatures in thousands of shaders.
+// The verifier state depends only on the serialized bytes, so it is built
+// once per process and shared by every shader that embeds the same bytes;
+// each shader then only pays for the lookups in VerifyShader.
+
+namespace {
+struct VerifiedRootSignature {
+  RootSignatureVerifier Verifier;
+  std::string Diagnostics;
+  bool Valid = false;
+};
+
+class VerifiedRootSignatureCache {
+private:
+  // Distinct root signatures are few; if a process churns through more than
+  // this, start over rather than tracking use.
+  static const size_t kMaxEntries = 256;
+
+  std::mutex m_mutex;
+  std::unordered_map<std::string, std::shared_ptr<const VerifiedRootSignature>>
+      m_entries;
+
+public:
+  // Throws if the root signature cannot be deserialized; such blobs are not
+  // cached.
+  std::shared_ptr<const VerifiedRootSignature> Get(const void *pData,
+                                                   uint32_t Size);
+};
+} // namespace
+
+static llvm::ManagedStatic<VerifiedRootSignatureCache> g_VerifiedRootSignatures;
+
+std::shared_ptr<const VerifiedRootSignature>
+VerifiedRootSignatureCache::Get(const void *pData, uint32_t Size) {
+  std::string Key((const char *)pData, Size);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(Key);
+    if (it != m_entries.end())
+      return it->second;
+  }
+
+  // Verify outside the lock; if two threads race on the same root signature
+  // both build it and the first insert wins.
+  std::shared_ptr<VerifiedRootSignature> pEntry =
+      std::make_shared<VerifiedRootSignature>();
+  const DxilVersionedRootSignatureDesc *pDesc = nullptr;
+  DeserializeRootSignature(pData, Size, &pDesc);
+  IFTBOOL(pDesc, E_FAIL);
+  {
+    raw_string_ostream DiagStream(pEntry->Diagnostics);
+    DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+    try {
+      pEntry->Verifier.VerifyRootSignature(pDesc, DiagPrinter);
+      pEntry->Valid = true;
+    } catch (...) {
+    }
+  }
+  DeleteRootSignature(pDesc);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_entries.size() >= kMaxEntries)
+    m_entries.clear();
+  return m_entries.emplace(std::move(Key), std::move(pEntry)).first->second;
+}
+
+_Use_decl_annotations_
+bool VerifySerializedRootSignatureWithShaderPSV(const void *pRootSignatureData,
+                                                uint32_t RootSignatureSize,
+                                                DXIL::ShaderKind ShaderKind,
+                                                const void *pPSVData,
+                                                uint32_t PSVSize,
+                                                llvm::raw_ostream &DiagStream) {
+  // Entries outlive the validation that created them and may be released
+  // here, so keep them off any caller-provided allocator.
+  DxcThreadMalloc TM(nullptr);
+  std::shared_ptr<const VerifiedRootSignature> pEntry =
+      g_VerifiedRootSignatures->Get(pRootSignatureData, RootSignatureSize);
+  DiagStream << pEntry->Diagnostics;
+  if (!pEntry->Valid)
+    return false;
+  try {
+    DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+    pEntry->Verifier.VerifyShader(GetVisibilityType(ShaderKind), pPSVData,
+                                  PSVSize, DiagPrinter);
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+_Use_decl_annotations_
+bool VerifySerializedRootSignature(const void *pRootSignatureData,
+                                   uint32_t RootSignatureSize,
+                                   llvm::raw_ostream &DiagStream) {
+  DxcThreadMalloc TM(nullptr);
+  std::shared_ptr<const VerifiedRootSignature> pEntry =
+      g_VerifiedRootSignatures->Get(pRootSignatureData, RootSignatureSize);
+  DiagStream << pEntry->Diagnostics;
+  return pEntry->Valid;
+}
+
 } // namespace hlsl
@@ -203,6 +203,11 @@ void DxrFallbackCompiler::setDebugOutputLevel(int val)
   m_debugOutputLevel = val;
 }
 
+void DxrFallbackCompiler::setBinnedDispatch(bool val)
+{
+  m_binnedDispatch = val;
+}
+
 static bool isShader(Function* F)
 {
   if (F->hasFnAttribute("exp-shader"))
@@ -582,6 +587,8 @@ void DxrFallbackCompiler::createStateDispatch(Function* func, const IntToFuncMap
 {
   Module* mod = func->getParent();
   Function* dispatchFunc = createDispatchFunction(stateFunctionMap, runtimeDataArgTy);
+  if (m_binnedDispatch)
+    dispatchFunc = createBinnedDispatchFunction(dispatchFunc, runtimeDataArgTy);
   Function* rewrite_dispatchFunc = mod->getFunction("rewrite_dispatch");
   rewrite_dispatchFunc->replaceAllUsesWith(dispatchFunc);
   rewrite_dispatchFunc->eraseFromParent();
@@ -785,6 +792,46 @@ Function* DxrFallbackCompiler::createDispatchFunction(const IntToFuncMap &stateF
   return dispatchFunc;
 }
 
+// Wraps dispatchFunc so that each call runs only the lanes of the wave whose
+// state ID is the lowest one pending in the wave. The other lanes return their
+// state ID unchanged and come back around the scheduler loop, so over
+// successive iterations every pending state is run once per wave with all of
+// its lanes together. Lanes that have finished (state ID < 0) have left the
+// scheduler loop and do not take part in the wave operation.
+Function* DxrFallbackCompiler::createBinnedDispatchFunction(Function* dispatchFunc, Type* runtimeDataArgTy)
+{
+  LLVMContext& context = m_module->getContext();
+  hlsl::OP* hlslOP = m_module->GetOrCreateDxilModule().GetOP();
+  Function* waveActiveOpFunc = hlslOP->GetOpFunc(OP::OpCode::WaveActiveOp, Type::getInt32Ty(context));
+
+  Function* binnedFunc = FunctionBuilder(m_module, "dispatch.binned").i32().type(runtimeDataArgTy, "runtimeData").i32("stateID").build();
+  Value* runtimeDataArg = binnedFunc->arg_begin();
+  Value* stateIdArg = ++binnedFunc->arg_begin();
+  BasicBlock* entryBlock = BasicBlock::Create(context, "entry", binnedFunc);
+  BasicBlock* runBlock = BasicBlock::Create(context, "run", binnedFunc);
+  BasicBlock* waitBlock = BasicBlock::Create(context, "wait", binnedFunc);
+  IRBuilder<> builder(entryBlock);
+
+  Value* args[] = {
+    hlslOP->GetU32Const((unsigned)OP::OpCode::WaveActiveOp),
+    stateIdArg,
+    hlslOP->GetI8Const((char)DXIL::WaveOpKind::Min),
+    hlslOP->GetI8Const((char)DXIL::SignedOpKind::Signed),
+  };
+  Value* binStateId = builder.CreateCall(waveActiveOpFunc, args, "binStateID");
+  Value* inBin = builder.CreateICmpEQ(stateIdArg, binStateId, "inBin");
+  builder.CreateCondBr(inBin, runBlock, waitBlock);
+
+  builder.SetInsertPoint(runBlock);
+  Value* nextStateId = builder.CreateCall(dispatchFunc, { runtimeDataArg, stateIdArg }, "nextStateId");
+  builder.CreateRet(nextStateId);
+
+  builder.SetInsertPoint(waitBlock);
+  builder.CreateRet(stateIdArg);
+
+  return binnedFunc;
+}
+
 std::vector<CallInst*> DxrFallbackCompiler::getCallsInShadersToFunction(const std::string& funcName)
 {
   std::vector<CallInst*> calls;
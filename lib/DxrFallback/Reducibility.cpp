@@ -3,6 +3,7 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -13,8 +14,10 @@
 #include "LLVMUtils.h"
 
 #include <fstream>
-#include <vector>
 #include <map>
+#include <memory>
+#include <set>
+#include <vector>
 
 #define DBGS errs
 //#define DBGS dbgs
@@ -246,8 +249,183 @@ static Node* split(Node* N, std::map<BasicBlock*, Node*>& bbToNode, bool firstSp
   return Np;
 }
 
+typedef SetVector<Node*> NodeSet;
+
+// Tarjan's strongly connected components over the nodes in subset, ignoring
+// edges that leave the subset.
+class SCCFinder
+{
+public:
+  SCCFinder(const NodeSet& subset) : m_subset(subset) {}
+
+  std::vector<NodeSet> run()
+  {
+    for (Node* N : m_subset)
+    {
+      if (!m_index.count(N))
+        visit(N);
+    }
+    return std::move(m_sccs);
+  }
+
+private:
+  const NodeSet& m_subset;
+  std::map<Node*, unsigned> m_index;
+  std::map<Node*, unsigned> m_lowLink;
+  std::vector<Node*> m_stack;
+  std::set<Node*> m_onStack;
+  std::vector<NodeSet> m_sccs;
+  unsigned m_nextIndex = 0;
+
+  void visit(Node* N)
+  {
+    m_index[N] = m_lowLink[N] = m_nextIndex++;
+    m_stack.push_back(N);
+    m_onStack.insert(N);
+
+    for (Node* S : N->out)
+    {
+      if (!m_subset.count(S))
+        continue;
+      if (!m_index.count(S))
+      {
+        visit(S);
+        m_lowLink[N] = std::min(m_lowLink[N], m_lowLink[S]);
+      }
+      else if (m_onStack.count(S))
+      {
+        m_lowLink[N] = std::min(m_lowLink[N], m_index[S]);
+      }
+    }
+
+    if (m_lowLink[N] != m_index[N])
+      return;
+
+    NodeSet scc;
+    Node* M = nullptr;
+    do
+    {
+      M = m_stack.back();
+      m_stack.pop_back();
+      m_onStack.erase(M);
+      scc.insert(M);
+    } while (M != N);
+    m_sccs.push_back(std::move(scc));
+  }
+};
+
+
+// Finds a cycle in region that can be entered at more than one node and
+// returns those entry nodes. Cycles entered through a single header are
+// searched for nested multiple-entry cycles with the header removed. Returns
+// false if region has no irreducible cycle.
+static bool findMultipleEntryCycle(const NodeSet& region, NodeSet& entries)
+{
+  for (const NodeSet& scc : SCCFinder(region).run())
+  {
+    if (scc.size() < 2)
+      continue;
+
+    entries.clear();
+    for (Node* N : scc)
+    {
+      for (Node* P : N->in)
+      {
+        if (!scc.count(P))
+        {
+          entries.insert(N);
+          break;
+        }
+      }
+    }
+    if (entries.size() > 1)
+      return true;
+
+    // A single-entry (or unreachable) cycle. Look inside it without its header.
+    Node* header = entries.empty() ? scc[0] : entries[0];
+    NodeSet inner(scc);
+    inner.remove(header);
+    if (findMultipleEntryCycle(inner, entries))
+      return true;
+  }
+
+  entries.clear();
+  return false;
+}
+
+
+// Routes every edge into the given entries through a new dispatch block that
+// switches on the entry that was targeted. Afterwards the dispatch block is the
+// only entry of the cycle and each entry has a single predecessor. Unlike node
+// splitting this does not duplicate code, but it adds a load, a switch and a
+// store on each edge into the cycle.
+static Node* insertDispatcher(const NodeSet& entries, AllocaInst*& targetAlloca)
+{
+  BasicBlock* firstEntryBlock = entries[0]->blocks[0];
+  Function* F = firstEntryBlock->getParent();
+  LLVMContext& C = F->getContext();
+  Type* int32Ty = Type::getInt32Ty(C);
+
+  if (!targetAlloca)
+    targetAlloca = new AllocaInst(int32Ty, "irr.target", F->getEntryBlock().begin());
+
+  Node* D = new Node(BasicBlock::Create(C, "irr.dispatch", F));
+  BasicBlock* dispatchBlock = D->blocks[0];
+  Value* target = new LoadInst(targetAlloca, "irr.target.val", dispatchBlock);
+  SwitchInst* switchInst = SwitchInst::Create(target, firstEntryBlock, entries.size(), dispatchBlock);
+  D->numInstructions = dispatchBlock->size();
+
+  for (unsigned k = 0; k < entries.size(); ++k)
+  {
+    Node* E = entries[k];
+    BasicBlock* entryBlock = E->blocks[0];
+    ConstantInt* targetVal = ConstantInt::get(C, APInt(32, k));
+    switchInst->addCase(targetVal, entryBlock);
+
+    for (Node* P : E->in)
+    {
+      // Edge blocks created below join P, so iterate over a copy.
+      std::vector<BasicBlock*> predBlocks(P->blocks.begin(), P->blocks.end());
+      for (BasicBlock* B : predBlocks)
+      {
+        TerminatorInst* term = B->getTerminator();
+        for (unsigned i = 0, e = term->getNumSuccessors(); i < e; ++i)
+        {
+          if (term->getSuccessor(i) != entryBlock)
+            continue;
+
+          if (e == 1)
+          {
+            new StoreInst(targetVal, targetAlloca, term);
+            term->setSuccessor(i, dispatchBlock);
+          }
+          else
+          {
+            BasicBlock* edgeBlock = BasicBlock::Create(C, "irr.edge", F, dispatchBlock);
+            new StoreInst(targetVal, targetAlloca, edgeBlock);
+            BranchInst::Create(dispatchBlock, edgeBlock);
+            term->setSuccessor(i, edgeBlock);
+            P->insert(edgeBlock);
+          }
+        }
+      }
+
+      P->out.remove(E);
+      P->out.insert(D);
+      D->in.insert(P);
+    }
+
+    E->in.clear();
+    E->in.insert(D);
+    D->out.insert(E);
+  }
+
+  return D;
+}
+
+
 // Returns the number of splits
-int makeReducible(Function* F)
+int makeReducible(Function* F, unsigned maxGrowthPercent)
 {
   // Break critical edges now in case we need to do mem2reg in split(). mem2reg
   // will break critical edges and the CFG needs to remain unchanged.
@@ -257,11 +435,15 @@ int makeReducible(Function* F)
 
   // initialize nodes
   std::vector<Node*> nodes;
+  std::vector<std::unique_ptr<Node>> allNodes;
   std::map<BasicBlock*, Node*> bbToNode;
+  size_t numInstructions = 0;
   for (BasicBlock& B : *F)
   {
     nodes.push_back(new Node(&B));
+    allNodes.emplace_back(nodes.back());
     bbToNode[&B] = nodes.back();
+    numInstructions += B.size();
   }
 
   // initialize edges
@@ -279,6 +461,13 @@ int makeReducible(Function* F)
   bool print = false;
   if (print) printDotGraph(nodes, F, step++);
 
+  // Node splitting can grow the code exponentially, so stop splitting once the
+  // copies reach the budget and use dispatch blocks for what is left.
+  const size_t splitBudget = numInstructions * maxGrowthPercent / 100;
+  size_t numClonedInstructions = 0;
+  bool demoted = false;
+  AllocaInst* targetAlloca = nullptr;
+
   int numSplits = 0;
   while (!nodes.empty())
   {
@@ -335,20 +524,50 @@ int makeReducible(Function* F)
 
     if (!nodes.empty())
     {
-      // Duplicate the smallest node with more than one incoming edge. Better 
-      // methods exist for picking the node to split, e.g. "Making Graphs Reducible
-      // with Controlled Node Splitting" by Janssen and Corporaal.
-      size_t idxMin = ~0;
-      for (size_t i = 0; i < nodes.size(); ++i)
+      // Only the entries of a cycle with more than one entry need splitting;
+      // splitting the other nodes left in the graph does not help ("Making
+      // Graphs Reducible with Controlled Node Splitting", Janssen and
+      // Corporaal). Split the smallest entry.
+      NodeSet region(nodes.begin(), nodes.end());
+      NodeSet entries;
+      bool inCycle = findMultipleEntryCycle(region, entries);
+      if (!inCycle)
       {
-        if (nodes[i]->in.size() <= 1)
-          continue;
+        // Nodes can be left without a cycle when unreachable blocks branch
+        // into reachable ones. Splitting them always makes progress.
+        for (Node* N : nodes)
+        {
+          if (N->in.size() > 1)
+            entries.insert(N);
+        }
+      }
+
+      Node* N = entries[0];
+      for (Node* E : entries)
+      {
+        if (E->numInstructions < N->numInstructions)
+          N = E;
+      }
 
-        if (idxMin == ~0u || nodes[i]->numInstructions < nodes[idxMin]->numInstructions)
-          idxMin = i;
+      if (!inCycle || numClonedInstructions + N->numInstructions <= splitBudget)
+      {
+        nodes.push_back(split(N, bbToNode, !demoted));
+        numClonedInstructions += N->numInstructions;
+        numSplits++;
+      }
+      else
+      {
+        // Run reg2mem on the whole function so we don't have to deal with phis
+        if (!demoted)
+        {
+          runPasses(F, {
+            createDemoteRegisterToMemoryPass()
+          });
+        }
+        nodes.push_back(insertDispatcher(entries, targetAlloca));
       }
-      nodes.push_back(split(nodes[idxMin], bbToNode, numSplits == 0));
-      numSplits++;
+      allNodes.emplace_back(nodes.back());
+      demoted = true;
       if (print) printDotGraph(nodes, F, step++);
     }
   }
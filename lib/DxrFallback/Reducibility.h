@@ -7,4 +7,9 @@ namespace llvm
 
 // Analyzes the reducibility of the control flow graph of F and uses node splitting
 // to make an irredicible CFG reducible. Returns the number of node splits.
-int makeReducible(llvm::Function* F);
\ No newline at end of file
+//
+// Splitting stops once the duplicated instructions would exceed
+// maxGrowthPercent of the original function size. Any cycles that are still
+// irreducible then get a dispatch block (a loop with a switch over the cycle
+// entries) so that the function size stays bounded.
+int makeReducible(llvm::Function* F, unsigned maxGrowthPercent = 100);
\ No newline at end of file
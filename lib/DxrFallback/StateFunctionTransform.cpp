@@ -26,6 +26,7 @@ using namespace llvm;
 
 static const char* CALL_INDIRECT_NAME = "\x1?Fallback_CallIndirect@@YAXH@Z";
 static const char* SET_PENDING_ATTR_PREFIX = "\x1?Fallback_SetPendingAttr@@";
+static const uint64_t SPILL_SLOT_ALIGNMENT = 16;
 
 
 // Create a string with printf-like arguments
@@ -531,6 +532,10 @@ public:
         return true;
       if (funcName.startswith("dx.op.createHandle"))
         return true;
+      // Dispatch coordinates do not change for the lifetime of the thread, so
+      // reading them again after the continuation is cheaper than a spill.
+      if (funcName.startswith("dx.op.dispatchRaysIndex") || funcName.startswith("dx.op.dispatchRaysDimensions"))
+        return true;
     }
     else if (LoadInst* load = dyn_cast<LoadInst>(inst))
     {
@@ -553,7 +558,7 @@ public:
   // Rematerialize the given instruction and its dependency graph, adding 
   // any nonrematerializable values that are live in the function, but not 
   // at this callsite to the work list to insure that their values are restored.
-  Instruction* rematerialize(Instruction* inst, std::vector<Instruction *> workList, Instruction* insertBefore, int depth = 0)
+  Instruction* rematerialize(Instruction* inst, std::vector<Instruction *>& workList, Instruction* insertBefore, int depth = 0)
   {
     // Signal if we hit a complex case. Deep rematerialization needs more analysis.
     // To make this robust we would need to make it possible to run the current
@@ -961,7 +966,10 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
     reg2Mem(valToAlloca, allocaToVal, inst);
   //printFunction("AfterReg2Mem");
 
-  uint64_t baseOffsetInBytes = offsetInBytes;
+  // Spills for each call site share the same region of the frame, starting on
+  // a 16-byte boundary. Within a call site the spilled values are packed in
+  // order of decreasing alignment so no padding is needed between them.
+  uint64_t baseOffsetInBytes = RoundUpToAlignment(offsetInBytes, SPILL_SLOT_ALIGNMENT);
   uint64_t maxOffsetInBytes = offsetInBytes;
   for (size_t i = 0; i < m_callSites.size(); ++i)
   {
@@ -970,6 +978,8 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
     const InstructionSetVector& liveHere = lv.getLiveValues(i);
     std::vector<Instruction*> workList(liveHere.begin(), liveHere.end());
     std::set<Instruction*> visited;
+    std::vector<Instruction*> spills;
+    unsigned rematCount = 0;
     Rematerializer R(allocaToVal, liveHere, *m_resources);
     Instruction* saveInsertBefore = m_callSites[i];
     Instruction* restoreInsertBefore = getInstructionAfter(m_callSites[i]);
@@ -995,17 +1005,7 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
       if (!R.canRematerialize(inst))
       {
         assert(!inst->getType()->isPointerTy() && "Can not save pointers");
-
-        offsetInBytes = align(offsetInBytes, inst, DL);
-        AllocaInst* alloca = valToAlloca[inst];
-
-        Value* saveVal = new LoadInst(alloca, addSuffix(inst->getName(), ".save"), saveInsertBefore);
-        createStackStore(saveStackFrameOffset, saveVal, offsetInBytes, saveInsertBefore);
-
-        Value* restoreVal = createStackLoad(restoreStackFrameOffset, inst, offsetInBytes, restoreInsertBefore);
-        new StoreInst(restoreVal, alloca, restoreInsertBefore);
-
-        offsetInBytes += DL.getTypeAllocSize(inst->getType());
+        spills.push_back(inst);
       }
       else if (R.getRematerializedValueFor(inst) == nullptr)
       {
@@ -1019,9 +1019,30 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
         }
         Instruction* remat = R.rematerialize(inst, workList, rematInsertBefore);
         new StoreInst(remat, valToAlloca[inst], rematInsertBefore);
+        ++rematCount;
       }
     }
 
+    // Pack the spills. The sort is stable so the layout is deterministic.
+    std::stable_sort(spills.begin(), spills.end(), [&DL](Instruction* a, Instruction* b) {
+      return DL.getPrefTypeAlignment(a->getType()) > DL.getPrefTypeAlignment(b->getType());
+    });
+    for (Instruction* inst : spills)
+    {
+      offsetInBytes = align(offsetInBytes, inst, DL);
+      AllocaInst* alloca = valToAlloca[inst];
+
+      Value* saveVal = new LoadInst(alloca, addSuffix(inst->getName(), ".save"), saveInsertBefore);
+      createStackStore(saveStackFrameOffset, saveVal, offsetInBytes, saveInsertBefore);
+
+      Value* restoreVal = createStackLoad(restoreStackFrameOffset, inst, offsetInBytes, restoreInsertBefore);
+      new StoreInst(restoreVal, alloca, restoreInsertBefore);
+
+      offsetInBytes += DL.getTypeAllocSize(inst->getType());
+    }
+
+    printStackTraffic(i, spills, offsetInBytes - baseOffsetInBytes, rematCount);
+
     // Take the max offset over all call sites
     maxOffsetInBytes = std::max(maxOffsetInBytes, offsetInBytes);
   }
@@ -1752,6 +1773,20 @@ void StateFunctionTransform::printModule(const Module* mod, const std::string& s
   out << *mod << "\n";
 }
 
+void StateFunctionTransform::printStackTraffic(size_t callSiteIdx, const std::vector<Instruction*>& spills, uint64_t spillBytes, unsigned rematCount)
+{
+  if (!m_verbose)
+    return;
+
+  raw_ostream& out = DBGS();
+  out << "stack traffic " << m_functionName << " callsite " << callSiteIdx << " --------------------\n";
+  out << "  " << *m_callSites[callSiteIdx] << "\n";
+  for (const Instruction* inst : spills)
+    out << "  spill: " << *inst << "\n";
+  out << "Spills:" << spills.size() << "  SpillBytes:" << spillBytes
+      << "  StackAccesses:" << 2 * spills.size() << "  Remats:" << rematCount << "\n\n";
+}
+
 void StateFunctionTransform::printSet(const InstructionSetVector& vals, const char* msg)
 {
   if (!m_verbose)
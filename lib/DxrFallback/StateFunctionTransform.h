@@ -292,4 +292,5 @@ private:
   void printFunctions(const std::vector<llvm::Function*>& funcs, const char* suffix);
   void printModule(const llvm::Module* module, const std::string& suffix);
   void printSet(const InstructionSetVector& vals, const char* msg = nullptr);
+  void printStackTraffic(size_t callSiteIdx, const std::vector<llvm::Instruction*>& spills, uint64_t spillBytes, unsigned rematCount);
 };
@@ -15,6 +15,8 @@
 #include "dxc/DXIL/DxilOperations.h"
 #include "dxc/DXIL/DxilInstructions.h"
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
@@ -103,9 +105,13 @@ private:
     FunctionSetType Functions;
     // Outputs to analyze.
     InstructionSetType Outputs;
-    // Contributing instructions per output.
+    // Contributing sources (ViewID and input loads) per output.
     std::unordered_map<unsigned, InstructionSetType>
         ContributingInstructions[kNumStreams];
+    // Memoized dependencies: the strongly connected component of each visited
+    // instruction, and the sources contributing to each component.
+    std::unordered_map<llvm::Instruction *, unsigned> SCCOfInstruction;
+    std::vector<llvm::BitVector> SCCSources;
 
     void Clear();
   };
@@ -130,6 +136,11 @@ private:
   // Cache of stores for each decl.
   std::unordered_map<llvm::Value *, ValueSetType> m_StoresPerDeclCache;
 
+  // Instructions that CreateViewIdSets() reads dependencies from (ViewID and
+  // input loads), numbered for the dependency bitsets.
+  std::vector<llvm::Instruction *> m_Sources;
+  std::unordered_map<llvm::Instruction *, unsigned> m_SourceIndex;
+
 
   void Clear();
   void DetermineMaxPackedLocation(DxilSignature &DxilSig, unsigned *pMaxSigLoc,
@@ -139,12 +150,17 @@ private:
                                     FunctionSetType &FuncSet);
   void AnalyzeFunctions(EntryInfo &Entry);
   void CollectValuesContributingToOutputs(EntryInfo &Entry);
-  void CollectValuesContributingToOutputRec(
-      EntryInfo &Entry, llvm::Value *pContributingValue,
-      InstructionSetType &ContributingInstructions);
-  void CollectPhiCFValuesContributingToOutputRec(
+  void AddContributingSources(EntryInfo &Entry, llvm::Value *pContributingValue,
+                              llvm::BitVector &Sources);
+  const llvm::BitVector &
+  GetContributingSources(EntryInfo &Entry, llvm::Instruction *pInst);
+  llvm::Instruction *GetDependencyNode(EntryInfo &Entry, llvm::Value *pValue);
+  void CollectDirectDependencies(
+      EntryInfo &Entry, llvm::Instruction *pInst,
+      llvm::SmallVectorImpl<llvm::Instruction *> &Deps);
+  void CollectPhiCFValuesContributingToOutput(
       llvm::PHINode *pPhi, EntryInfo &Entry,
-      InstructionSetType &ContributingInstructions);
+      llvm::SmallVectorImpl<llvm::Instruction *> &Deps);
   const ValueSetType &CollectReachingDecls(llvm::Value *pValue);
   void CollectReachingDeclsRec(llvm::Value *pValue, ValueSetType &ReachingDecls,
                                ValueSetType &Visited);
@@ -246,6 +262,9 @@ void DxilViewIdStateBuilder::Clear() {
   m_PCEntry.Clear();
   m_FuncInfo.clear();
   m_ReachingDeclsCache.clear();
+  m_StoresPerDeclCache.clear();
+  m_Sources.clear();
+  m_SourceIndex.clear();
 }
 
 void DxilViewIdStateBuilder::EntryInfo::Clear() {
@@ -254,6 +273,8 @@ void DxilViewIdStateBuilder::EntryInfo::Clear() {
   Outputs.clear();
   for (unsigned i = 0; i < kNumStreams; i++)
     ContributingInstructions[i].clear();
+  SCCOfInstruction.clear();
+  SCCSources.clear();
 }
 
 void DxilViewIdStateBuilder::FuncInfo::Clear() {
@@ -328,6 +349,13 @@ void DxilViewIdStateBuilder::AnalyzeFunctions(EntryInfo &Entry) {
         CallInst *CI = dyn_cast<CallInst>(itInst);
         if (!CI) continue;
 
+        if (DxilInst_ViewID(CI) || DxilInst_LoadInput(CI) ||
+            DxilInst_LoadOutputControlPoint(CI) ||
+            DxilInst_LoadPatchConstant(CI)) {
+          if (m_SourceIndex.emplace(CI, m_Sources.size()).second)
+            m_Sources.emplace_back(CI);
+        }
+
         DynamicallyIndexedElemsType *pDynIdxElems = nullptr;
         int row = Semantic::kUndefinedRow;
         unsigned id, col;
@@ -463,15 +491,8 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputs(EntryInfo &Entry
       endRow = SigElem.GetRows() - 1;
     }
 
-    InstructionSetType ContributingInstructionsAllRows;
-    InstructionSetType *pContributingInstructions = &ContributingInstructionsAllRows;
-    if (startRow == endRow) {
-      // Scalar or indexable with known index.
-      unsigned index = GetLinearIndex(SigElem, startRow, col);
-      pContributingInstructions = &Entry.ContributingInstructions[StreamId][index];
-    }
-
-    CollectValuesContributingToOutputRec(Entry, pContributingValue, *pContributingInstructions);
+    BitVector Sources(m_Sources.size());
+    AddContributingSources(Entry, pContributingValue, Sources);
 
     // Handle control dependence of this instruction BB.
     BasicBlock *pBB = CI->getParent();
@@ -479,65 +500,168 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputs(EntryInfo &Entry
     FuncInfo *pFuncInfo = m_FuncInfo[F].get();
     const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
     for (BasicBlock *B : CtrlDepSet) {
-      CollectValuesContributingToOutputRec(Entry, B->getTerminator(), *pContributingInstructions);
+      AddContributingSources(Entry, B->getTerminator(), Sources);
     }
 
-    if (pContributingInstructions == &ContributingInstructionsAllRows) {
-      // Write dynamically indexed output contributions to all rows.
-      for (int row = startRow; row <= endRow; row++) {
-        unsigned index = GetLinearIndex(SigElem, row, col);
-        Entry.ContributingInstructions[StreamId][index].insert(ContributingInstructionsAllRows.begin(), ContributingInstructionsAllRows.end());
+    // Write contributions to the output row, or to all rows of a dynamically
+    // indexed output.
+    for (int row = startRow; row <= endRow; row++) {
+      unsigned index = GetLinearIndex(SigElem, row, col);
+      InstructionSetType &ContributingInstructions = Entry.ContributingInstructions[StreamId][index];
+      for (int i = Sources.find_first(); i != -1; i = Sources.find_next(i)) {
+        ContributingInstructions.emplace(m_Sources[i]);
       }
     }
   }
 }
 
-void DxilViewIdStateBuilder::CollectValuesContributingToOutputRec(EntryInfo &Entry,
-                                                           Value *pContributingValue,
-                                                           InstructionSetType &ContributingInstructions) {
-  if (dyn_cast<Argument>(pContributingValue)) {
+void DxilViewIdStateBuilder::AddContributingSources(EntryInfo &Entry,
+                                                    Value *pContributingValue,
+                                                    BitVector &Sources) {
+  if (Instruction *pInst = GetDependencyNode(Entry, pContributingValue)) {
+    Sources |= GetContributingSources(Entry, pInst);
+  }
+}
+
+// Returns the instruction to follow for a value an output depends on, or null
+// if the value contributes nothing.
+Instruction *DxilViewIdStateBuilder::GetDependencyNode(EntryInfo &Entry,
+                                                       Value *pValue) {
+  if (dyn_cast<Argument>(pValue)) {
     // This must be a leftover signature argument of an entry function.
     DXASSERT_NOMSG(Entry.pEntryFunc == m_pModule->GetEntryFunction() ||
                    Entry.pEntryFunc == m_pModule->GetPatchConstantFunction());
-    return;
+    return nullptr;
   }
 
-  Instruction *pContributingInst = dyn_cast<Instruction>(pContributingValue);
-  if (pContributingInst == nullptr) {
+  Instruction *pInst = dyn_cast<Instruction>(pValue);
+  if (pInst == nullptr) {
     // Can be literal constant, global decl, branch target.
-    DXASSERT_NOMSG(isa<Constant>(pContributingValue) || isa<BasicBlock>(pContributingValue));
-    return;
+    DXASSERT_NOMSG(isa<Constant>(pValue) || isa<BasicBlock>(pValue));
+    return nullptr;
   }
 
-  BasicBlock *pBB = pContributingInst->getParent();
-  Function *F = pBB->getParent();
-  auto FuncInfoIt = m_FuncInfo.find(F);
-  DXASSERT_NOMSG(FuncInfoIt != m_FuncInfo.end());
-  if (FuncInfoIt == m_FuncInfo.end()) {
-    return;
+  Function *F = pInst->getParent()->getParent();
+  DXASSERT_NOMSG(m_FuncInfo.count(F));
+  if (m_FuncInfo.find(F) == m_FuncInfo.end()) {
+    return nullptr;
+  }
+  return pInst;
+}
+
+// Returns the sources (ViewID and input loads) that pInst transitively depends
+// on. The dependency graph is walked once per entry with Tarjan's algorithm;
+// each strongly connected component gets the union of the sources of its
+// members and of the components it depends on, which are always complete by
+// the time the component itself is. Later queries reuse the results, so the
+// whole analysis is linear in the size of the IR times the number of sources.
+const BitVector &
+DxilViewIdStateBuilder::GetContributingSources(EntryInfo &Entry,
+                                               Instruction *pRoot) {
+  auto itRoot = Entry.SCCOfInstruction.find(pRoot);
+  if (itRoot != Entry.SCCOfInstruction.end())
+    return Entry.SCCSources[itRoot->second];
+
+  struct NodeState {
+    Instruction *pInst;
+    unsigned LowLink;
+    SmallVector<Instruction *, 4> Deps;
+  };
+  std::vector<NodeState> Nodes;        // visited in this walk, by DFS index
+  std::unordered_map<Instruction *, unsigned> NodeIndex;
+  std::vector<std::pair<unsigned, unsigned>> CallStack; // node, next dep
+  std::vector<unsigned> SCCStack;
+
+  auto Visit = [&](Instruction *pInst) {
+    unsigned Idx = Nodes.size();
+    NodeIndex[pInst] = Idx;
+    Nodes.push_back(NodeState{pInst, Idx, {}});
+    CollectDirectDependencies(Entry, pInst, Nodes.back().Deps);
+    CallStack.emplace_back(Idx, 0);
+    SCCStack.push_back(Idx);
+  };
+
+  Visit(pRoot);
+  while (!CallStack.empty()) {
+    unsigned Idx = CallStack.back().first;
+    unsigned &NextDep = CallStack.back().second;
+    if (NextDep < Nodes[Idx].Deps.size()) {
+      Instruction *pDep = Nodes[Idx].Deps[NextDep++];
+      if (Entry.SCCOfInstruction.count(pDep))
+        continue; // Component already complete.
+      auto itDep = NodeIndex.find(pDep);
+      if (itDep == NodeIndex.end()) {
+        Visit(pDep);
+      } else {
+        // Still on the SCC stack.
+        Nodes[Idx].LowLink = std::min(Nodes[Idx].LowLink, itDep->second);
+      }
+      continue;
+    }
+
+    CallStack.pop_back();
+    if (!CallStack.empty()) {
+      unsigned ParentIdx = CallStack.back().first;
+      Nodes[ParentIdx].LowLink =
+          std::min(Nodes[ParentIdx].LowLink, Nodes[Idx].LowLink);
+    }
+    if (Nodes[Idx].LowLink != Idx)
+      continue;
+
+    // Idx is the root of a component; pop its members.
+    unsigned SCCId = Entry.SCCSources.size();
+    SmallVector<unsigned, 4> Members;
+    do {
+      Members.push_back(SCCStack.back());
+      SCCStack.pop_back();
+      Entry.SCCOfInstruction[Nodes[Members.back()].pInst] = SCCId;
+    } while (Members.back() != Idx);
+
+    BitVector Sources(m_Sources.size());
+    for (unsigned M : Members) {
+      auto itSource = m_SourceIndex.find(Nodes[M].pInst);
+      if (itSource != m_SourceIndex.end())
+        Sources.set(itSource->second);
+      for (Instruction *pDep : Nodes[M].Deps) {
+        unsigned DepSCCId = Entry.SCCOfInstruction[pDep];
+        if (DepSCCId != SCCId)
+          Sources |= Entry.SCCSources[DepSCCId];
+      }
+    }
+    Entry.SCCSources.emplace_back(std::move(Sources));
   }
 
-  auto itInst = ContributingInstructions.emplace(pContributingInst);
-  // Already visited instruction.
-  if (!itInst.second) return;
+  return Entry.SCCSources[Entry.SCCOfInstruction[pRoot]];
+}
+
+// Collects the instructions whose values pInst directly depends on: its
+// operands, the stores reaching its loads, the returns of the function it
+// calls, and the terminators it is control dependent on.
+void DxilViewIdStateBuilder::CollectDirectDependencies(
+    EntryInfo &Entry, Instruction *pInst,
+    SmallVectorImpl<Instruction *> &Deps) {
+  auto AddDep = [&](Value *V) {
+    if (Instruction *pDep = GetDependencyNode(Entry, V))
+      Deps.push_back(pDep);
+  };
 
   // Handle special cases.
-  if (PHINode *phi = dyn_cast<PHINode>(pContributingInst)) {
-    CollectPhiCFValuesContributingToOutputRec(phi, Entry, ContributingInstructions);
-  } else if (isa<LoadInst>(pContributingInst) || 
-             isa<AtomicCmpXchgInst>(pContributingInst) ||
-             isa<AtomicRMWInst>(pContributingInst)) {
-    Value *pPtrValue = pContributingInst->getOperand(0);
+  if (PHINode *phi = dyn_cast<PHINode>(pInst)) {
+    CollectPhiCFValuesContributingToOutput(phi, Entry, Deps);
+  } else if (isa<LoadInst>(pInst) ||
+             isa<AtomicCmpXchgInst>(pInst) ||
+             isa<AtomicRMWInst>(pInst)) {
+    Value *pPtrValue = pInst->getOperand(0);
     DXASSERT_NOMSG(pPtrValue->getType()->isPointerTy());
     const ValueSetType &ReachingDecls = CollectReachingDecls(pPtrValue);
     DXASSERT_NOMSG(ReachingDecls.size() > 0);
     for (Value *pDeclValue : ReachingDecls) {
       const ValueSetType &Stores = CollectStores(pDeclValue);
       for (Value *V : Stores) {
-        CollectValuesContributingToOutputRec(Entry, V, ContributingInstructions);
+        AddDep(V);
       }
     }
-  } else if (CallInst *CI = dyn_cast<CallInst>(pContributingInst)) {
+  } else if (CallInst *CI = dyn_cast<CallInst>(pInst)) {
     if (!hlsl::OP::IsDxilOpFuncCallInst(CI)) {
       Function *F = CI->getCalledFunction();
       if (!F->empty()) {
@@ -545,7 +669,7 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputRec(EntryInfo &Ent
         if (Entry.Functions.find(F) != Entry.Functions.end()) {
           const FuncInfo &FI = *m_FuncInfo[F];
           for (ReturnInst *pRetInst : FI.Returns) {
-            CollectValuesContributingToOutputRec(Entry, pRetInst, ContributingInstructions);
+            AddDep(pRetInst);
           }
         }
       }
@@ -553,17 +677,17 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputRec(EntryInfo &Ent
   }
 
   // Handle instruction inputs.
-  unsigned NumOps = pContributingInst->getNumOperands();
+  unsigned NumOps = pInst->getNumOperands();
   for (unsigned i = 0; i < NumOps; i++) {
-    Value *O = pContributingInst->getOperand(i);
-    CollectValuesContributingToOutputRec(Entry, O, ContributingInstructions);
+    AddDep(pInst->getOperand(i));
   }
 
   // Handle control dependence of this instruction BB.
-  FuncInfo *pFuncInfo = FuncInfoIt->second.get();
+  BasicBlock *pBB = pInst->getParent();
+  FuncInfo *pFuncInfo = m_FuncInfo[pBB->getParent()].get();
   const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
   for (BasicBlock *B : CtrlDepSet) {
-    CollectValuesContributingToOutputRec(Entry, B->getTerminator(), ContributingInstructions);
+    AddDep(B->getTerminator());
   }
 }
 
@@ -572,9 +696,9 @@ void DxilViewIdStateBuilder::CollectValuesContributingToOutputRec(EntryInfo &Ent
 // However, this may be too conservative and, as such, pick up extra control dependent BBs.
 // A better "definition" point is the highest dominator where it is still legal to "insert" constant assignment.
 // In this context, "legal" means that only one value "leaves" the dominator and reaches Phi.
-void DxilViewIdStateBuilder::CollectPhiCFValuesContributingToOutputRec(PHINode *pPhi,
-                                                                EntryInfo &Entry,
-                                                                InstructionSetType &ContributingInstructions) {
+void DxilViewIdStateBuilder::CollectPhiCFValuesContributingToOutput(PHINode *pPhi,
+                                                             EntryInfo &Entry,
+                                                             SmallVectorImpl<Instruction *> &Deps) {
   Function *F = pPhi->getParent()->getParent();
   FuncInfo *pFuncInfo = m_FuncInfo[F].get();
   unordered_map<DomTreeNodeBase<BasicBlock> *, Value *> DomTreeMarkers;
@@ -649,7 +773,8 @@ void DxilViewIdStateBuilder::CollectPhiCFValuesContributingToOutputRec(PHINode *
     pBB = pDefDomNode->getBlock();
     const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
     for (BasicBlock *B : CtrlDepSet) {
-      CollectValuesContributingToOutputRec(Entry, B->getTerminator(), ContributingInstructions);
+      if (Instruction *pDep = GetDependencyNode(Entry, B->getTerminator()))
+        Deps.push_back(pDep);
     }
   }
 }
@@ -108,17 +108,27 @@ void ControlDependence::ComputeRevTopOrderRec(PostDomRelationType &PostDomRel,
                                               BasicBlock *pBB,
                                               BasicBlockVector &RevTopOrder,
                                               BasicBlockSet &VisitedBBs) {
-  if (VisitedBBs.find(pBB) != VisitedBBs.end()) {
+  // Post-order walk of the post-dominator tree below pBB. Walking immediate
+  // children (rather than re-walking every descendant at each level) keeps
+  // this linear in the size of the tree, and an explicit stack avoids deep
+  // recursion on long chains of blocks.
+  if (!VisitedBBs.insert(pBB).second)
     return;
-  }
-  VisitedBBs.insert(pBB);
 
-  SmallVector<BasicBlock *, 8> Descendants;
-  PostDomRel.getDescendants(pBB, Descendants);
-  for (BasicBlock *pDescBB : Descendants) {
-    if (pDescBB != pBB)
-      ComputeRevTopOrderRec(PostDomRel, pDescBB, RevTopOrder, VisitedBBs);
+  using ChildIt = DomTreeNode::iterator;
+  SmallVector<std::pair<DomTreeNode *, ChildIt>, 16> Stack;
+  DomTreeNode *pRoot = PostDomRel.getNode(pBB);
+  Stack.emplace_back(pRoot, pRoot->begin());
+  while (!Stack.empty()) {
+    DomTreeNode *pNode = Stack.back().first;
+    ChildIt &itChild = Stack.back().second;
+    if (itChild != pNode->end()) {
+      DomTreeNode *pChild = *itChild++;
+      if (VisitedBBs.insert(pChild->getBlock()).second)
+        Stack.emplace_back(pChild, pChild->begin());
+      continue;
+    }
+    RevTopOrder.emplace_back(pNode->getBlock());
+    Stack.pop_back();
   }
-
-  RevTopOrder.emplace_back(pBB);
 }
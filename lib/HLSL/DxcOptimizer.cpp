@@ -37,9 +37,13 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/Analysis/CFGPrinter.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Support/MD5.h"
 
 #include <algorithm>
-#include <list>   // should change this for string_table
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <vector>
 
 #include "llvm/PassPrinters/PassPrinters.h"
@@ -86,7 +90,10 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDSEPass(Registry);
     initializeDeadInstEliminationPass(Registry);
     initializeDxilAllocateResourcesForLibPass(Registry);
+    initializeDxilCBufferLoadCSEPass(Registry);
     initializeDxilCleanupAddrSpaceCastPass(Registry);
+    initializeDxilClusterSamplesPass(Registry);
+    initializeDxilCoalesceRawBufferPass(Registry);
     initializeDxilConditionalMem2RegPass(Registry);
     initializeDxilConvergentClearPass(Registry);
     initializeDxilConvergentMarkPass(Registry);
@@ -100,6 +107,8 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDxilFinalizePreservesPass(Registry);
     initializeDxilFixConstArrayInitializerPass(Registry);
     initializeDxilGenerationPassPass(Registry);
+    initializeDxilGroupSharedLayoutPass(Registry);
+    initializeDxilHoistHandlesPass(Registry);
     initializeDxilInsertPreservesPass(Registry);
     initializeDxilLegalizeEvalOperationsPass(Registry);
     initializeDxilLegalizeResourcesPass(Registry);
@@ -108,19 +117,23 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDxilLoopDeletionPass(Registry);
     initializeDxilLoopUnrollPass(Registry);
     initializeDxilLowerCreateHandleForLibPass(Registry);
+    initializeDxilMatrixLayoutPass(Registry);
     initializeDxilCleanupAnnotateHandlePass(Registry);
     initializeDxilMutateResourceToHandlePass(Registry);
     initializeDxilNoOptLegalizePass(Registry);
     initializeDxilNoOptSimplifyInstructionsPass(Registry);
+    initializeDxilPair16BitOpsPass(Registry);
     initializeDxilPrecisePropagatePassPass(Registry);
     initializeDxilPreserveAllOutputsPass(Registry);
     initializeDxilPreserveToSelectPass(Registry);
     initializeDxilPromoteLocalResourcesPass(Registry);
     initializeDxilPromoteStaticResourcesPass(Registry);
     initializeDxilRemoveDeadBlocksPass(Registry);
+    initializeDxilRemoveRedundantNonUniformPass(Registry);
     initializeDxilRenameResourcesPass(Registry);
     initializeDxilRewriteOutputArgDebugInfoPass(Registry);
     initializeDxilSimpleGVNHoistPass(Registry);
+    initializeDxilSpecializeConstantsPass(Registry);
     initializeDxilTranslateRawBufferPass(Registry);
     initializeDxilValidateWaveSensitivityPass(Registry);
     initializeDxilValueCachePass(Registry);
@@ -170,6 +183,7 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeReducibilityAnalysisPass(Registry);
     initializeRegToMemHlslPass(Registry);
     initializeResourceToHandlePass(Registry);
+    initializeResourceUseAnalysisPass(Registry);
     initializeResumePassesPass(Registry);
     initializeRewriteSymbolsPass(Registry);
     initializeSCCPPass(Registry);
@@ -204,19 +218,22 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   static const LPCSTR AlwaysInlinerArgs[] = { "InsertLifetime", "InlineThreshold" };
   static const LPCSTR ArgPromotionArgs[] = { "maxElements" };
   static const LPCSTR CFGSimplifyPassArgs[] = { "Threshold", "Ftor", "bonus-inst-threshold" };
-  static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "force-early-z", "add-pixel-cost", "rt-width", "sv-position-index", "num-pixels" };
-  static const LPCSTR DxilConditionalMem2RegArgs[] = { "NoOpt" };
-  static const LPCSTR DxilDebugInstrumentationArgs[] = { "UAVSize", "parameter0", "parameter1", "parameter2" };
+  static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "force-early-z", "add-pixel-cost", "rt-width", "sv-position-index", "num-pixels", "wave-coalesce" };
+  static const LPCSTR DxilConditionalMem2RegArgs[] = { "NoOpt", "IndexableArrayLimit" };
+  static const LPCSTR DxilDebugInstrumentationArgs[] = { "UAVSize", "parameter0", "parameter1", "parameter2", "parameter0Range", "parameter1Range", "parameter2Range", "BlockGranularity" };
+  static const LPCSTR DxilExpandTrigIntrinsicsArgs[] = { "fast" };
   static const LPCSTR DxilGenerationPassArgs[] = { "NotOptimized" };
   static const LPCSTR DxilInsertPreservesArgs[] = { "AllowPreserves" };
-  static const LPCSTR DxilLoopUnrollArgs[] = { "MaxIterationAttempt", "OnlyWarnOnFail" };
+  static const LPCSTR DxilLoopUnrollArgs[] = { "MaxIterationAttempt", "OnlyWarnOnFail", "GrowthBudget" };
   static const LPCSTR DxilOutputColorBecomesConstantArgs[] = { "mod-mode", "constant-red", "constant-green", "constant-blue", "constant-alpha" };
-  static const LPCSTR DxilPIXMeshShaderOutputInstrumentationArgs[] = { "UAVSize" };
+  static const LPCSTR DxilPIXMeshShaderOutputInstrumentationArgs[] = { "UAVSize", "waveCoalesce" };
   static const LPCSTR DxilRenameResourcesArgs[] = { "prefix", "from-binding", "keep-name" };
-  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "config", "checkForDynamicIndexing" };
+  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "config", "checkForDynamicIndexing", "waveCoalesce" };
+  static const LPCSTR DxilSpecializeConstantsArgs[] = { "values", "validate" };
   static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "ReplaceAllVectors" };
   static const LPCSTR Float2IntArgs[] = { "float2int-max-integer-bw" };
   static const LPCSTR GVNArgs[] = { "noloads", "enable-pre", "enable-load-pre", "max-recurse-depth" };
+  static const LPCSTR HLMatrixLowerPassArgs[] = { "dot-products" };
   static const LPCSTR JumpThreadingArgs[] = { "Threshold", "jump-threading-threshold" };
   static const LPCSTR LICMArgs[] = { "disable-licm-promotion" };
   static const LPCSTR LoopDistributeArgs[] = { "loop-distribute-verify", "loop-distribute-non-if-convertible" };
@@ -245,6 +262,7 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   if (strcmp(passName, "hlsl-dxil-add-pixel-hit-instrmentation") == 0) return ArrayRef<LPCSTR>(DxilAddPixelHitInstrumentationArgs, _countof(DxilAddPixelHitInstrumentationArgs));
   if (strcmp(passName, "dxil-cond-mem2reg") == 0) return ArrayRef<LPCSTR>(DxilConditionalMem2RegArgs, _countof(DxilConditionalMem2RegArgs));
   if (strcmp(passName, "hlsl-dxil-debug-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilDebugInstrumentationArgs, _countof(DxilDebugInstrumentationArgs));
+  if (strcmp(passName, "hlsl-dxil-expand-trig-intrinsics") == 0) return ArrayRef<LPCSTR>(DxilExpandTrigIntrinsicsArgs, _countof(DxilExpandTrigIntrinsicsArgs));
   if (strcmp(passName, "dxilgen") == 0) return ArrayRef<LPCSTR>(DxilGenerationPassArgs, _countof(DxilGenerationPassArgs));
   if (strcmp(passName, "dxil-insert-preserves") == 0) return ArrayRef<LPCSTR>(DxilInsertPreservesArgs, _countof(DxilInsertPreservesArgs));
   if (strcmp(passName, "dxil-loop-unroll") == 0) return ArrayRef<LPCSTR>(DxilLoopUnrollArgs, _countof(DxilLoopUnrollArgs));
@@ -252,9 +270,11 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   if (strcmp(passName, "hlsl-dxil-pix-meshshader-output-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilPIXMeshShaderOutputInstrumentationArgs, _countof(DxilPIXMeshShaderOutputInstrumentationArgs));
   if (strcmp(passName, "dxil-rename-resources") == 0) return ArrayRef<LPCSTR>(DxilRenameResourcesArgs, _countof(DxilRenameResourcesArgs));
   if (strcmp(passName, "hlsl-dxil-pix-shader-access-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilShaderAccessTrackingArgs, _countof(DxilShaderAccessTrackingArgs));
+  if (strcmp(passName, "hlsl-dxil-specialize-constants") == 0) return ArrayRef<LPCSTR>(DxilSpecializeConstantsArgs, _countof(DxilSpecializeConstantsArgs));
   if (strcmp(passName, "dynamic-vector-to-array") == 0) return ArrayRef<LPCSTR>(DynamicIndexingVectorToArrayArgs, _countof(DynamicIndexingVectorToArrayArgs));
   if (strcmp(passName, "float2int") == 0) return ArrayRef<LPCSTR>(Float2IntArgs, _countof(Float2IntArgs));
   if (strcmp(passName, "gvn") == 0) return ArrayRef<LPCSTR>(GVNArgs, _countof(GVNArgs));
+  if (strcmp(passName, "hlmatrixlower") == 0) return ArrayRef<LPCSTR>(HLMatrixLowerPassArgs, _countof(HLMatrixLowerPassArgs));
   if (strcmp(passName, "jump-threading") == 0) return ArrayRef<LPCSTR>(JumpThreadingArgs, _countof(JumpThreadingArgs));
   if (strcmp(passName, "licm") == 0) return ArrayRef<LPCSTR>(LICMArgs, _countof(LICMArgs));
   if (strcmp(passName, "loop-distribute") == 0) return ArrayRef<LPCSTR>(LoopDistributeArgs, _countof(LoopDistributeArgs));
@@ -287,19 +307,22 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   static const LPCSTR AlwaysInlinerArgs[] = { "Insert @llvm.lifetime intrinsics", "Insert @llvm.lifetime intrinsics" };
   static const LPCSTR ArgPromotionArgs[] = { "None" };
   static const LPCSTR CFGSimplifyPassArgs[] = { "None", "None", "Control the number of bonus instructions (default = 1)" };
-  static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "None", "None", "None", "None", "None" };
-  static const LPCSTR DxilConditionalMem2RegArgs[] = { "None" };
-  static const LPCSTR DxilDebugInstrumentationArgs[] = { "None", "None", "None", "None" };
+  static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "None", "None", "None", "None", "None", "None" };
+  static const LPCSTR DxilConditionalMem2RegArgs[] = { "None", "Keep dynamically indexed arrays of at least this many scalars in memory (0 = off)" };
+  static const LPCSTR DxilDebugInstrumentationArgs[] = { "None", "None", "None", "None", "None", "None", "None", "None" };
+  static const LPCSTR DxilExpandTrigIntrinsicsArgs[] = { "Use cheaper approximations and leave precise calls and tan alone" };
   static const LPCSTR DxilGenerationPassArgs[] = { "None" };
   static const LPCSTR DxilInsertPreservesArgs[] = { "None" };
-  static const LPCSTR DxilLoopUnrollArgs[] = { "Maximum number of iterations to attempt when iteratively unrolling.", "Whether to just warn when unrolling fails." };
+  static const LPCSTR DxilLoopUnrollArgs[] = { "Maximum number of iterations to attempt when iteratively unrolling.", "Whether to just warn when unrolling fails.", "Instructions full unrolling may add before a loop that does not need it is only unrolled partially (0 means no limit)." };
   static const LPCSTR DxilOutputColorBecomesConstantArgs[] = { "None", "None", "None", "None", "None" };
-  static const LPCSTR DxilPIXMeshShaderOutputInstrumentationArgs[] = { "None" };
+  static const LPCSTR DxilPIXMeshShaderOutputInstrumentationArgs[] = { "None", "None" };
   static const LPCSTR DxilRenameResourcesArgs[] = { "Prefix to add to resource names", "Append binding to name when bound", "Keep name when appending binding" };
-  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "None", "None" };
+  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "None", "None", "None" };
+  static const LPCSTR DxilSpecializeConstantsArgs[] = { "Specialization constant values as id=value;id=value", "Validate the specialized module" };
   static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "None" };
   static const LPCSTR Float2IntArgs[] = { "Max integer bitwidth to consider in float2int" };
   static const LPCSTR GVNArgs[] = { "None", "None", "None", "Max recurse depth" };
+  static const LPCSTR HLMatrixLowerPassArgs[] = { "Lower float matrix multiplies to dot products" };
   static const LPCSTR JumpThreadingArgs[] = { "None", "Max block size to duplicate for jump threading" };
   static const LPCSTR LICMArgs[] = { "Disable memory promotion in LICM pass" };
   static const LPCSTR LoopDistributeArgs[] = { "Turn on DominatorTree and LoopInfo verification after Loop Distribution", "Whether to distribute into a loop that may not be if-convertible by the loop vectorizer" };
@@ -328,6 +351,7 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   if (strcmp(passName, "hlsl-dxil-add-pixel-hit-instrmentation") == 0) return ArrayRef<LPCSTR>(DxilAddPixelHitInstrumentationArgs, _countof(DxilAddPixelHitInstrumentationArgs));
   if (strcmp(passName, "dxil-cond-mem2reg") == 0) return ArrayRef<LPCSTR>(DxilConditionalMem2RegArgs, _countof(DxilConditionalMem2RegArgs));
   if (strcmp(passName, "hlsl-dxil-debug-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilDebugInstrumentationArgs, _countof(DxilDebugInstrumentationArgs));
+  if (strcmp(passName, "hlsl-dxil-expand-trig-intrinsics") == 0) return ArrayRef<LPCSTR>(DxilExpandTrigIntrinsicsArgs, _countof(DxilExpandTrigIntrinsicsArgs));
   if (strcmp(passName, "dxilgen") == 0) return ArrayRef<LPCSTR>(DxilGenerationPassArgs, _countof(DxilGenerationPassArgs));
   if (strcmp(passName, "dxil-insert-preserves") == 0) return ArrayRef<LPCSTR>(DxilInsertPreservesArgs, _countof(DxilInsertPreservesArgs));
   if (strcmp(passName, "dxil-loop-unroll") == 0) return ArrayRef<LPCSTR>(DxilLoopUnrollArgs, _countof(DxilLoopUnrollArgs));
@@ -335,9 +359,11 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   if (strcmp(passName, "hlsl-dxil-pix-meshshader-output-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilPIXMeshShaderOutputInstrumentationArgs, _countof(DxilPIXMeshShaderOutputInstrumentationArgs));
   if (strcmp(passName, "dxil-rename-resources") == 0) return ArrayRef<LPCSTR>(DxilRenameResourcesArgs, _countof(DxilRenameResourcesArgs));
   if (strcmp(passName, "hlsl-dxil-pix-shader-access-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilShaderAccessTrackingArgs, _countof(DxilShaderAccessTrackingArgs));
+  if (strcmp(passName, "hlsl-dxil-specialize-constants") == 0) return ArrayRef<LPCSTR>(DxilSpecializeConstantsArgs, _countof(DxilSpecializeConstantsArgs));
   if (strcmp(passName, "dynamic-vector-to-array") == 0) return ArrayRef<LPCSTR>(DynamicIndexingVectorToArrayArgs, _countof(DynamicIndexingVectorToArrayArgs));
   if (strcmp(passName, "float2int") == 0) return ArrayRef<LPCSTR>(Float2IntArgs, _countof(Float2IntArgs));
   if (strcmp(passName, "gvn") == 0) return ArrayRef<LPCSTR>(GVNArgs, _countof(GVNArgs));
+  if (strcmp(passName, "hlmatrixlower") == 0) return ArrayRef<LPCSTR>(HLMatrixLowerPassArgs, _countof(HLMatrixLowerPassArgs));
   if (strcmp(passName, "jump-threading") == 0) return ArrayRef<LPCSTR>(JumpThreadingArgs, _countof(JumpThreadingArgs));
   if (strcmp(passName, "licm") == 0) return ArrayRef<LPCSTR>(LICMArgs, _countof(LICMArgs));
   if (strcmp(passName, "loop-distribute") == 0) return ArrayRef<LPCSTR>(LoopDistributeArgs, _countof(LoopDistributeArgs));
@@ -369,6 +395,7 @@ static bool IsPassOptionName(StringRef S) {
   return S.equals("AllowPartial")
     ||  S.equals("AllowPreserves")
     ||  S.equals("ArrayElementThreshold")
+    ||  S.equals("BlockGranularity")
     ||  S.equals("Count")
     ||  S.equals("DL")
     ||  S.equals("FatalErrors")
@@ -425,7 +452,10 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("num-pixels")
     ||  S.equals("parameter0")
     ||  S.equals("parameter1")
+    ||  S.equals("parameter0Range")
+    ||  S.equals("parameter1Range")
     ||  S.equals("parameter2")
+    ||  S.equals("parameter2Range")
     ||  S.equals("pragma-unroll-threshold")
     ||  S.equals("prefix")
     ||  S.equals("reroll-num-tolerated-failed-matches")
@@ -446,7 +476,9 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("unroll-runtime")
     ||  S.equals("unroll-threshold")
     ||  S.equals("vector-library")
-    ||  S.equals("verify-debug-info");
+    ||  S.equals("verify-debug-info")
+    ||  S.equals("wave-coalesce")
+    ||  S.equals("waveCoalesce");
   // ISPASSOPTIONNAME:END
 }
 
@@ -525,17 +557,43 @@ public:
   }
 };
 
-class DxcOptimizer : public IDxcOptimizer {
+// The passes, with their options, that a list of optimizer options asks for.
+// Pass instances are created from it for each module that is run.
+struct OptimizerPipeline {
+  enum class StepKind { ModulePass, FunctionPass, PrintModule };
+  struct Step {
+    StepKind Kind;
+    const PassInfo *PassInf = nullptr;
+    // Sorted by name, as applyOptions expects.
+    std::vector<std::pair<std::string, std::string>> Options;
+    std::string Banner; // For PrintModule
+  };
+  std::vector<Step> Steps;
+  bool OutputAssembly = false;
+  bool AnalyzeOnly = false;
+};
+
+class DxcOptimizer : public IDxcOptimizer3 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   PassRegistry *m_registry;
   std::vector<const PassInfo *> m_passes;
+
+  HRESULT ParsePipeline(_In_count_(optionCount) LPCWSTR *ppOptions,
+                        UINT32 optionCount, OptimizerPipeline &Pipeline);
+  HRESULT RunPipeline(const OptimizerPipeline &Pipeline, IDxcBlob *pBlob,
+                      _COM_Outptr_ IDxcBlob **ppOutputModule,
+                      _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText);
+  HRESULT RunPipelineOnModule(const OptimizerPipeline &Pipeline, Module &M,
+                              _COM_Outptr_ IDxcBlob **ppOutputModule,
+                              _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText);
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcOptimizer)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcOptimizer>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcOptimizer, IDxcOptimizer2,
+                                 IDxcOptimizer3>(this, iid, ppvObject);
   }
 
   HRESULT Initialize();
@@ -549,6 +607,18 @@ public:
     _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
     _COM_Outptr_ IDxcBlob **ppOutputModule,
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) override;
+  HRESULT STDMETHODCALLTYPE RunOptimizerBatch(
+    _In_count_(moduleCount) IDxcBlob **ppBlobs, UINT32 moduleCount,
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    UINT32 threadCount, _Out_writes_(moduleCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(moduleCount) IDxcBlobEncoding **ppOutputTexts) override;
+  HRESULT STDMETHODCALLTYPE RunOptimizerPipelines(
+    IDxcBlob *pBlob, _In_ LPCWSTR *ppOptions,
+    _In_count_(pipelineCount) const UINT32 *pPipelineOptionCounts,
+    UINT32 pipelineCount,
+    _Out_writes_(pipelineCount) DxcOptimizerPipelineStats *pStats,
+    _Out_writes_opt_(pipelineCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(pipelineCount) IDxcBlobEncoding **ppOutputTexts) override;
 };
 
 class CapturePassManager : public llvm::legacy::PassManagerBase {
@@ -611,19 +681,134 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::GetAvailablePass(
       GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
 }
 
-HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
-    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
-    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
-    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
-  AssignToOutOpt(nullptr, ppOutputModule);
-  AssignToOutOpt(nullptr, ppOutputText);
-  if (pBlob == nullptr)
-    return E_POINTER;
-  if (optionCount > 0 && ppOptions == nullptr)
-    return E_POINTER;
+HRESULT DxcOptimizer::ParsePipeline(_In_count_(optionCount) LPCWSTR *ppOptions,
+                                    UINT32 optionCount,
+                                    OptimizerPipeline &Pipeline) {
+  Pipeline = OptimizerPipeline();
 
-  DxcThreadMalloc TM(m_pMalloc);
+  // First gather flags, wherever they may be.
+  SmallVector<UINT32, 2> handled;
+  for (UINT32 i = 0; i < optionCount; ++i) {
+    if (wcseq(L"-S", ppOptions[i])) {
+      Pipeline.OutputAssembly = true;
+      handled.push_back(i);
+      continue;
+    }
+    if (wcseq(L"-analyze", ppOptions[i])) {
+      Pipeline.AnalyzeOnly = true;
+      handled.push_back(i);
+      continue;
+    }
+  }
 
+  bool ToFunctionPasses = false;
+  SmallVector<std::pair<std::string, std::string>, 2> options;
+  for (UINT32 i = 0; i < optionCount; ++i) {
+    if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
+      continue;
+    }
+
+    // Handle some special cases where we can inject a redirected output stream.
+    if (wcsstartswith(ppOptions[i], L"-print-module")) {
+      LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
+      OptimizerPipeline::Step step;
+      step.Kind = OptimizerPipeline::StepKind::PrintModule;
+      if (*pName) {
+        IFTARG(*pName != L':' || *pName != L'=');
+        ++pName;
+        CW2A name8(pName);
+        step.Banner = "MODULE-PRINT ";
+        step.Banner += name8.m_psz;
+        step.Banner += "\n";
+      }
+      if (!ToFunctionPasses)
+        Pipeline.Steps.push_back(std::move(step));
+      continue;
+    }
+
+    // Handle special switches to toggle per-function prepasses vs. module passes.
+    if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
+      ToFunctionPasses = true;
+      continue;
+    }
+    if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
+      ToFunctionPasses = false;
+      continue;
+    }
+
+    CW2A optName(ppOptions[i], CP_UTF8);
+    // The option syntax is
+    const char ArgDelim = ',';
+    // '-' OPTION_NAME (',' ARG_NAME ('=' ARG_VALUE)?)*
+    char *pCursor = optName.m_psz;
+    const char *pEnd = optName.m_psz + strlen(optName.m_psz);
+    if (*pCursor != '-' && *pCursor != '/') {
+      return E_INVALIDARG;
+    }
+    ++pCursor;
+    const char *pOptionNameStart = pCursor;
+    while (*pCursor && *pCursor != ArgDelim) {
+      ++pCursor;
+    }
+    *pCursor = '\0';
+    const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
+    if (!PassInf) {
+      return E_INVALIDARG;
+    }
+    while (pCursor < pEnd) {
+      // *pCursor is '\0' when we overwrite ',' to get a null-terminated string
+      if (*pCursor && *pCursor != ArgDelim) {
+        return E_INVALIDARG;
+      }
+      ++pCursor;
+      const char *pArgStart = pCursor;
+      while (*pCursor && *pCursor != ArgDelim) {
+        ++pCursor;
+      }
+      StringRef argString = StringRef(pArgStart, pCursor - pArgStart);
+      std::pair<StringRef, StringRef> nameValue = argString.split('=');
+      if (!IsPassOptionName(nameValue.first)) {
+        return E_INVALIDARG;
+      }
+
+      auto OptionPos = std::lower_bound(
+          options.begin(), options.end(), nameValue.first,
+          [](const std::pair<std::string, std::string> &option, StringRef name) {
+            return StringRef(option.first) < name;
+          });
+      bool Found = OptionPos != options.end() && OptionPos->first == nameValue.first;
+      // If empty, remove if available; otherwise upsert.
+      if (nameValue.second.empty()) {
+        if (Found) {
+          options.erase(OptionPos);
+        }
+      }
+      else {
+        if (Found) {
+          OptionPos->second = nameValue.second;
+        }
+        else {
+          options.insert(OptionPos, std::make_pair(nameValue.first.str(),
+                                                   nameValue.second.str()));
+        }
+      }
+    }
+
+    DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
+    OptimizerPipeline::Step step;
+    step.Kind = ToFunctionPasses ? OptimizerPipeline::StepKind::FunctionPass
+                                 : OptimizerPipeline::StepKind::ModulePass;
+    step.PassInf = PassInf;
+    step.Options.assign(options.begin(), options.end());
+    options.clear();
+    Pipeline.Steps.push_back(std::move(step));
+  }
+
+  return S_OK;
+}
+
+static std::unique_ptr<Module> LoadModule(IDxcBlob *pBlob,
+                                          LLVMContext &Context) {
   // Setup input buffer.
   //
   // The ir parsing requires the buffer to be null terminated. We deal with
@@ -632,7 +817,6 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
   //
   // If we have the beginning of a DXIL program header, skip to the bitcode.
   //
-  LLVMContext Context;
   SMDiagnostic Err;
   std::unique_ptr<MemoryBuffer> memBuf;
   std::unique_ptr<Module> M;
@@ -651,14 +835,27 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
     memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
     M = parseIR(memBuf->getMemBufferRef(), Err, Context);
   }
+  return M;
+}
 
+HRESULT DxcOptimizer::RunPipeline(const OptimizerPipeline &Pipeline,
+                                  IDxcBlob *pBlob,
+                                  _COM_Outptr_ IDxcBlob **ppOutputModule,
+                                  _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = LoadModule(pBlob, Context);
   if (M == nullptr) {
     return DXC_E_IR_VERIFICATION_FAILED;
   }
+  return RunPipelineOnModule(Pipeline, *M, ppOutputModule, ppOutputText);
+}
 
+HRESULT DxcOptimizer::RunPipelineOnModule(
+    const OptimizerPipeline &Pipeline, Module &M,
+    _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
   legacy::PassManager ModulePasses;
-  legacy::FunctionPassManager FunctionPasses(M.get());
-  legacy::PassManagerBase *pPassManager = &ModulePasses;
+  legacy::FunctionPassManager FunctionPasses(&M);
 
   try {
     CComPtr<AbstractMemoryStream> pOutputStream;
@@ -683,118 +880,28 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
     // No TargetInfo.
     // No DataLayout.
     //
-    bool OutputAssembly = false;
-    bool AnalyzeOnly = false;
-
-    // First gather flags, wherever they may be.
-    SmallVector<UINT32, 2> handled;
-    for (UINT32 i = 0; i < optionCount; ++i) {
-      if (wcseq(L"-S", ppOptions[i])) {
-        OutputAssembly = true;
-        handled.push_back(i);
-        continue;
-      }
-      if (wcseq(L"-analyze", ppOptions[i])) {
-        AnalyzeOnly = true;
-        handled.push_back(i);
-        continue;
-      }
-    }
-
-    // TODO: should really use string_table for this once that's available
-    std::list<std::string> optionsAnsi;
     SmallVector<PassOption, 2> options;
-    for (UINT32 i = 0; i < optionCount; ++i) {
-      if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
-        continue;
-      }
-
-      // Handle some special cases where we can inject a redirected output stream.
-      if (wcsstartswith(ppOptions[i], L"-print-module")) {
-        LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
-        std::string Banner;
-        if (*pName) {
-          IFTARG(*pName != L':' || *pName != L'=');
-          ++pName;
-          CW2A name8(pName);
-          Banner = "MODULE-PRINT ";
-          Banner += name8.m_psz;
-          Banner += "\n";
-        }
-        if (pPassManager == &ModulePasses)
-          pPassManager->add(llvm::createPrintModulePass(outStream, Banner));
-        continue;
-      }
-
-      // Handle special switches to toggle per-function prepasses vs. module passes.
-      if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
-        pPassManager = &FunctionPasses;
-        continue;
-      }
-      if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
-        pPassManager = &ModulePasses;
+    for (const OptimizerPipeline::Step &step : Pipeline.Steps) {
+      if (step.Kind == OptimizerPipeline::StepKind::PrintModule) {
+        ModulePasses.add(llvm::createPrintModulePass(outStream, step.Banner));
         continue;
       }
 
-      CW2A optName(ppOptions[i], CP_UTF8);
-      // The option syntax is
-      const char ArgDelim = ',';
-      // '-' OPTION_NAME (',' ARG_NAME ('=' ARG_VALUE)?)*
-      char *pCursor = optName.m_psz;
-      const char *pEnd = optName.m_psz + strlen(optName.m_psz);
-      if (*pCursor != '-' && *pCursor != '/') {
-        return E_INVALIDARG;
-      }
-      ++pCursor;
-      const char *pOptionNameStart = pCursor;
-      while (*pCursor && *pCursor != ArgDelim) {
-        ++pCursor;
-      }
-      *pCursor = '\0';
-      const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
-      if (!PassInf) {
-        return E_INVALIDARG;
-      }
-      while (pCursor < pEnd) {
-        // *pCursor is '\0' when we overwrite ',' to get a null-terminated string
-        if (*pCursor && *pCursor != ArgDelim) {
-          return E_INVALIDARG;
-        }
-        ++pCursor;
-        const char *pArgStart = pCursor;
-        while (*pCursor && *pCursor != ArgDelim) {
-          ++pCursor;
-        }
-        StringRef argString = StringRef(pArgStart, pCursor - pArgStart);
-        std::pair<StringRef, StringRef> nameValue = argString.split('=');
-        if (!IsPassOptionName(nameValue.first)) {
-          return E_INVALIDARG;
-        }
-
-        PassOption *OptionPos = std::lower_bound(options.begin(), options.end(), nameValue, PassOptionsCompare());
-        // If empty, remove if available; otherwise upsert.
-        if (nameValue.second.empty()) {
-          if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
-            options.erase(OptionPos);
-          }
-        }
-        else {
-          if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
-            OptionPos->second = nameValue.second;
-          }
-          else {
-            options.insert(OptionPos, nameValue);
-          }
-        }
-      }
+      legacy::PassManagerBase *pPassManager =
+          step.Kind == OptimizerPipeline::StepKind::FunctionPass
+              ? static_cast<legacy::PassManagerBase *>(&FunctionPasses)
+              : &ModulePasses;
+      const llvm::PassInfo *PassInf = step.PassInf;
+      // Passes apply their options as sorted StringRef pairs.
+      options.clear();
+      for (const auto &option : step.Options)
+        options.push_back(PassOption(option.first, option.second));
 
-      DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
       Pass *pass = PassInf->getNormalCtor()();
       pass->setOSOverride(&outStream);
       pass->applyOptions(options);
-      options.clear();
       pPassManager->add(pass);
-      if (AnalyzeOnly) {
+      if (Pipeline.AnalyzeOnly) {
         const bool Quiet = false;
         PassKind Kind = pass->getPassKind();
         switch (Kind) {
@@ -822,7 +929,7 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
 
     ModulePasses.add(createVerifierPass());
 
-    if (OutputAssembly) {
+    if (Pipeline.OutputAssembly) {
       ModulePasses.add(llvm::createPrintModulePass(outStream));
     }
 
@@ -832,11 +939,11 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
       ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
 
       FunctionPasses.doInitialization();
-      for (Function &F : *M.get())
+      for (Function &F : M)
         if (!F.isDeclaration())
           FunctionPasses.run(F);
       FunctionPasses.doFinalization();
-      ModulePasses.run(*M.get());
+      ModulePasses.run(M);
     }
 
     outStream.flush();
@@ -848,7 +955,7 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
       IFT(CreateMemoryStream(m_pMalloc, &pProgramStream));
       {
         raw_stream_ostream outStream(pProgramStream.p);
-        WriteBitcodeToFile(M.get(), outStream, true);
+        WriteBitcodeToFile(&M, outStream, true);
       }
       IFT(pProgramStream.QueryInterface(ppOutputModule));
     }
@@ -858,6 +965,177 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
   return S_OK;
 }
 
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
+    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
+    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  OptimizerPipeline Pipeline;
+  try {
+    IFR(ParsePipeline(ppOptions, optionCount, Pipeline));
+  }
+  CATCH_CPP_RETURN_HRESULT();
+
+  return RunPipeline(Pipeline, pBlob, ppOutputModule, ppOutputText);
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizerBatch(
+    _In_count_(moduleCount) IDxcBlob **ppBlobs, UINT32 moduleCount,
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    UINT32 threadCount, _Out_writes_(moduleCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(moduleCount) IDxcBlobEncoding **ppOutputTexts) {
+  if (moduleCount > 0 && (ppBlobs == nullptr || ppOutputModules == nullptr))
+    return E_POINTER;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+  for (UINT32 i = 0; i < moduleCount; ++i) {
+    ppOutputModules[i] = nullptr;
+    if (ppOutputTexts != nullptr)
+      ppOutputTexts[i] = nullptr;
+  }
+  for (UINT32 i = 0; i < moduleCount; ++i) {
+    if (ppBlobs[i] == nullptr)
+      return E_POINTER;
+  }
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  // The options are parsed once; each module gets its own pass instances,
+  // since passes keep per-module state.
+  OptimizerPipeline Pipeline;
+  try {
+    IFR(ParsePipeline(ppOptions, optionCount, Pipeline));
+  }
+  CATCH_CPP_RETURN_HRESULT();
+
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min(threadCount, moduleCount);
+
+  // Every module is loaded into its own LLVMContext, so workers share
+  // nothing but the pipeline description and the next module to take.
+  std::vector<HRESULT> Results(moduleCount, S_OK);
+  std::atomic<UINT32> NextModule(0);
+  auto Worker = [&]() {
+    DxcThreadMalloc TM(m_pMalloc);
+    for (UINT32 i = NextModule++; i < moduleCount; i = NextModule++) {
+      Results[i] = RunPipeline(Pipeline, ppBlobs[i], &ppOutputModules[i],
+                               ppOutputTexts ? &ppOutputTexts[i] : nullptr);
+    }
+  };
+
+  // The calling thread works too.
+  std::vector<std::thread> Threads;
+  for (UINT32 i = 1; i < threadCount; ++i) {
+    try {
+      Threads.emplace_back(Worker);
+    } catch (const std::system_error &) {
+      break;
+    }
+  }
+  Worker();
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  // Report the first failure; the outputs of the other modules are kept.
+  for (HRESULT hr : Results) {
+    if (FAILED(hr))
+      return hr;
+  }
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizerPipelines(
+    IDxcBlob *pBlob, _In_ LPCWSTR *ppOptions,
+    _In_count_(pipelineCount) const UINT32 *pPipelineOptionCounts,
+    UINT32 pipelineCount,
+    _Out_writes_(pipelineCount) DxcOptimizerPipelineStats *pStats,
+    _Out_writes_opt_(pipelineCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(pipelineCount) IDxcBlobEncoding **ppOutputTexts) {
+  if (pBlob == nullptr)
+    return E_POINTER;
+  if (pipelineCount > 0 && (pPipelineOptionCounts == nullptr || pStats == nullptr))
+    return E_POINTER;
+  UINT32 totalOptionCount = 0;
+  for (UINT32 i = 0; i < pipelineCount; ++i) {
+    pStats[i] = DxcOptimizerPipelineStats();
+    if (ppOutputModules != nullptr)
+      ppOutputModules[i] = nullptr;
+    if (ppOutputTexts != nullptr)
+      ppOutputTexts[i] = nullptr;
+    totalOptionCount += pPipelineOptionCounts[i];
+  }
+  if (totalOptionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  std::vector<OptimizerPipeline> Pipelines(pipelineCount);
+  try {
+    LPCWSTR *ppPipelineOptions = ppOptions;
+    for (UINT32 i = 0; i < pipelineCount; ++i) {
+      IFR(ParsePipeline(ppPipelineOptions, pPipelineOptionCounts[i],
+                        Pipelines[i]));
+      ppPipelineOptions += pPipelineOptionCounts[i];
+    }
+  }
+  CATCH_CPP_RETURN_HRESULT();
+
+  // Only the cloning is repeated for each pipeline, not the parsing.
+  LLVMContext Context;
+  std::unique_ptr<Module> M;
+  try {
+    M = LoadModule(pBlob, Context);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  if (M == nullptr) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+
+  HRESULT Result = S_OK;
+  for (UINT32 i = 0; i < pipelineCount; ++i) {
+    HRESULT hr = S_OK;
+    try {
+      std::unique_ptr<Module> Trial(CloneModule(M.get()));
+      CComPtr<IDxcBlob> pOutputModule;
+      auto Start = std::chrono::steady_clock::now();
+      hr = RunPipelineOnModule(Pipelines[i], *Trial, &pOutputModule,
+                               ppOutputTexts ? &ppOutputTexts[i] : nullptr);
+      auto End = std::chrono::steady_clock::now();
+      if (SUCCEEDED(hr)) {
+        DxcOptimizerPipelineStats &Stats = pStats[i];
+        Stats.RunMicroseconds =
+            std::chrono::duration_cast<std::chrono::microseconds>(End - Start)
+                .count();
+        for (Function &F : *Trial)
+          for (BasicBlock &BB : F)
+            Stats.InstructionCount += BB.size();
+        MD5 Hash;
+        Hash.update(ArrayRef<uint8_t>(
+            (const uint8_t *)pOutputModule->GetBufferPointer(),
+            pOutputModule->GetBufferSize()));
+        MD5::MD5Result HashResult;
+        Hash.final(HashResult);
+        memcpy(Stats.OutputHash, HashResult, sizeof(Stats.OutputHash));
+        if (ppOutputModules != nullptr)
+          ppOutputModules[i] = pOutputModule.Detach();
+      }
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+    if (FAILED(hr) && SUCCEEDED(Result))
+      Result = hr;
+  }
+  return Result;
+}
+
 HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv) {
   CComPtr<DxcOptimizer> result = DxcOptimizer::Alloc(DxcGetThreadMallocNoRef());
   if (result == nullptr) {
@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCBufferLoadCSE.cpp                                                    //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Remove redundant CBufferLoadLegacy operations and hoist them out of       //
+// loops.                                                                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Constant buffers can't change while a shader runs, so two cbufferLoadLegacy
+// calls with the same handle and row always return the same value and a
+// cbufferLoadLegacy can be executed anywhere its operands are available.
+// Generic GVN and LICM only see a readonly call which may be clobbered by any
+// UAV write or barrier in between.
+//
+// This pass:
+//  - hoists loads with loop invariant operands into the loop preheader;
+//  - replaces a load with an identical load dominating it;
+//  - merges identical loads on sibling paths into their nearest common
+//    dominator, when that doesn't put them inside a loop.
+
+namespace {
+
+// Overloaded function, handle and row of a cbufferLoadLegacy.
+typedef std::pair<Function *, std::pair<Value *, Value *>> LoadKey;
+
+class DxilCBufferLoadCSE : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCBufferLoadCSE() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL cbuffer load CSE";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool HoistOutOfLoops(ArrayRef<CallInst *> Loads);
+  bool RemoveDominated(MapVector<LoadKey, SmallVector<CallInst *, 2>> &Reps);
+  bool HoistToCommonDominator(SmallVectorImpl<CallInst *> &Reps);
+
+  DominatorTree *DT;
+  LoopInfo *LI;
+};
+
+char DxilCBufferLoadCSE::ID = 0;
+
+LoadKey GetLoadKey(CallInst *CI) {
+  DxilInst_CBufferLoadLegacy Load(CI);
+  return std::make_pair(CI->getCalledFunction(),
+                        std::make_pair(Load.get_handle(), Load.get_regIndex()));
+}
+
+bool IsCBufferLoad(Instruction &I) {
+  CallInst *CI = dyn_cast<CallInst>(&I);
+  return CI && OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CBufferLoadLegacy);
+}
+
+bool DxilCBufferLoadCSE::HoistOutOfLoops(ArrayRef<CallInst *> Loads) {
+  bool bChanged = false;
+  for (CallInst *CI : Loads) {
+    DxilInst_CBufferLoadLegacy Load(CI);
+    Loop *L = LI->getLoopFor(CI->getParent());
+    while (L && L->isLoopInvariant(Load.get_handle()) &&
+           L->isLoopInvariant(Load.get_regIndex())) {
+      BasicBlock *Preheader = L->getLoopPreheader();
+      if (!Preheader)
+        break;
+      CI->moveBefore(Preheader->getTerminator());
+      bChanged = true;
+      L = L->getParentLoop();
+    }
+  }
+  return bChanged;
+}
+
+bool DxilCBufferLoadCSE::RemoveDominated(
+    MapVector<LoadKey, SmallVector<CallInst *, 2>> &Reps) {
+  bool bChanged = false;
+  // Visit blocks in dominator tree preorder, so a dominating load is always
+  // seen before the loads it dominates.
+  for (DomTreeNode *Node : depth_first(DT->getRootNode())) {
+    BasicBlock *BB = Node->getBlock();
+    for (auto It = BB->begin(), E = BB->end(); It != E;) {
+      Instruction &I = *(It++);
+      if (!IsCBufferLoad(I))
+        continue;
+      CallInst *CI = cast<CallInst>(&I);
+      SmallVector<CallInst *, 2> &KeyReps = Reps[GetLoadKey(CI)];
+      CallInst *Dom = nullptr;
+      for (CallInst *Rep : KeyReps) {
+        if (DT->dominates(Rep, CI)) {
+          Dom = Rep;
+          break;
+        }
+      }
+      if (!Dom) {
+        KeyReps.emplace_back(CI);
+        continue;
+      }
+      CI->replaceAllUsesWith(Dom);
+      CI->eraseFromParent();
+      bChanged = true;
+    }
+  }
+  return bChanged;
+}
+
+bool DxilCBufferLoadCSE::HoistToCommonDominator(
+    SmallVectorImpl<CallInst *> &Reps) {
+  if (Reps.size() < 2)
+    return false;
+  BasicBlock *NCD = Reps.front()->getParent();
+  for (CallInst *CI : Reps)
+    NCD = DT->findNearestCommonDominator(NCD, CI->getParent());
+
+  // Don't execute the load more often than before.
+  if (Loop *L = LI->getLoopFor(NCD)) {
+    for (CallInst *CI : Reps)
+      if (!L->contains(CI->getParent()))
+        return false;
+  }
+
+  Instruction *InsertPt = NCD->getTerminator();
+  CallInst *Hoisted = Reps.front();
+  for (Value *V : Hoisted->arg_operands()) {
+    Instruction *Op = dyn_cast<Instruction>(V);
+    if (Op && !DT->dominates(Op, InsertPt))
+      return false;
+  }
+
+  Hoisted->moveBefore(InsertPt);
+  for (CallInst *CI : Reps) {
+    if (CI == Hoisted)
+      continue;
+    CI->replaceAllUsesWith(Hoisted);
+    CI->eraseFromParent();
+  }
+  Reps.clear();
+  Reps.emplace_back(Hoisted);
+  return true;
+}
+
+bool DxilCBufferLoadCSE::runOnFunction(Function &F) {
+  SmallVector<CallInst *, 16> Loads;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (IsCBufferLoad(I))
+        Loads.emplace_back(cast<CallInst>(&I));
+  if (Loads.empty())
+    return false;
+
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+
+  bool bChanged = HoistOutOfLoops(Loads);
+
+  MapVector<LoadKey, SmallVector<CallInst *, 2>> Reps;
+  bChanged |= RemoveDominated(Reps);
+
+  for (auto &KeyReps : Reps)
+    bChanged |= HoistToCommonDominator(KeyReps.second);
+  return bChanged;
+}
+
+} // namespace
+
+FunctionPass *llvm::createDxilCBufferLoadCSEPass() {
+  return new DxilCBufferLoadCSE();
+}
+
+INITIALIZE_PASS_BEGIN(DxilCBufferLoadCSE, "dxil-cbuffer-load-cse",
+                      "DXIL cbuffer load CSE", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(DxilCBufferLoadCSE, "dxil-cbuffer-load-cse",
+                    "DXIL cbuffer load CSE", false, false)
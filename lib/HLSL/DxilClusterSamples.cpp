@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilClusterSamples.cpp                                                    //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Schedule independent texture samples and loads early in their block.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+// Samples and resource loads are emitted in source order, each right before
+// the math using its result. Some drivers only hide their latency when
+// independent fetches are issued together.
+//
+// Within each block, this pass moves every sample and load up past the
+// instructions it doesn't depend on, stopping at:
+//  - the definition of one of its operands;
+//  - any instruction that may write memory or has other side effects;
+//  - the previous sample or load, so fetches keep their relative order;
+//  - the point where the values live across it would exceed a budget.
+// Live values are estimated once per block by counting in-block definitions
+// still used later, with each component extracted from a fetch counting as
+// one value.
+
+namespace {
+
+// Most live values estimated at any point before fetches stop moving up.
+const unsigned kMaxLiveValues = 48;
+
+class DxilClusterSamples : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilClusterSamples() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL cluster samples";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override {
+    bool bChanged = false;
+    for (BasicBlock &BB : F)
+      bChanged |= ClusterInBlock(BB);
+    return bChanged;
+  }
+
+private:
+  bool ClusterInBlock(BasicBlock &BB);
+};
+
+char DxilClusterSamples::ID = 0;
+
+bool IsFetch(Instruction *I) {
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+    return false;
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case DXIL::OpCode::Sample:
+  case DXIL::OpCode::SampleBias:
+  case DXIL::OpCode::SampleLevel:
+  case DXIL::OpCode::SampleGrad:
+  case DXIL::OpCode::SampleCmp:
+  case DXIL::OpCode::SampleCmpLevelZero:
+  case DXIL::OpCode::TextureGather:
+  case DXIL::OpCode::TextureGatherCmp:
+  case DXIL::OpCode::TextureLoad:
+  case DXIL::OpCode::BufferLoad:
+  case DXIL::OpCode::RawBufferLoad:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Number of registers the value of I is estimated to take.
+unsigned GetWeight(Instruction *I) {
+  if (!I->getType()->isStructTy())
+    return 1;
+  // Only count the components actually extracted from a fetch result.
+  SmallSet<unsigned, 4> Comps;
+  for (User *U : I->users())
+    if (ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(U))
+      Comps.insert(EVI->getIndices()[0]);
+  return std::max(1u, (unsigned)Comps.size());
+}
+
+bool DxilClusterSamples::ClusterInBlock(BasicBlock &BB) {
+  SmallVector<Instruction *, 64> Insts;
+  DenseMap<Instruction *, unsigned> Index;
+  for (Instruction &I : BB) {
+    Index[&I] = Insts.size();
+    Insts.emplace_back(&I);
+  }
+  unsigned NumInsts = Insts.size();
+
+  // Live[p] estimates the values live right before instruction p.
+  std::vector<int> Delta(NumInsts + 1, 0);
+  for (unsigned k = 0; k < NumInsts; ++k) {
+    Instruction *I = Insts[k];
+    if (I->getType()->isVoidTy() || I->use_empty())
+      continue;
+    unsigned LastUse = k;
+    for (User *U : I->users()) {
+      Instruction *UI = cast<Instruction>(U);
+      if (UI->getParent() != &BB || isa<PHINode>(UI)) {
+        LastUse = NumInsts;
+        break;
+      }
+      LastUse = std::max(LastUse, Index[UI]);
+    }
+    if (LastUse == k)
+      continue;
+    unsigned Weight = GetWeight(I);
+    Delta[k + 1] += Weight;
+    if (LastUse < NumInsts)
+      Delta[LastUse + 1] -= Weight;
+  }
+  std::vector<unsigned> Live(NumInsts, 0);
+  int Running = 0;
+  for (unsigned p = 0; p < NumInsts; ++p) {
+    Running += Delta[p];
+    Live[p] = Running;
+  }
+
+  bool bChanged = false;
+  for (unsigned j = 0; j < NumInsts; ++j) {
+    Instruction *Fetch = Insts[j];
+    if (!IsFetch(Fetch))
+      continue;
+    unsigned Weight = GetWeight(Fetch);
+
+    unsigned i = j;
+    while (i > 0) {
+      Instruction *Above = Insts[i - 1];
+      if (isa<PHINode>(Above) || IsFetch(Above))
+        break;
+      if (Above->mayWriteToMemory() || Above->mayHaveSideEffects())
+        break;
+      if (std::find(Fetch->op_begin(), Fetch->op_end(), Above) !=
+          Fetch->op_end())
+        break;
+      if (Live[i - 1] + Weight > kMaxLiveValues)
+        break;
+      --i;
+    }
+    if (i == j)
+      continue;
+
+    Fetch->moveBefore(Insts[i]);
+    bChanged = true;
+    // The fetch result is now live across the instructions it passed.
+    unsigned FetchLive = Live[i];
+    for (unsigned q = j; q > i; --q) {
+      Insts[q] = Insts[q - 1];
+      Live[q] = Live[q - 1] + Weight;
+    }
+    Insts[i] = Fetch;
+    Live[i] = FetchLive;
+  }
+  return bChanged;
+}
+
+} // namespace
+
+FunctionPass *llvm::createDxilClusterSamplesPass() {
+  return new DxilClusterSamples();
+}
+
+INITIALIZE_PASS(DxilClusterSamples, "hlsl-dxil-cluster-samples",
+                "DXIL cluster samples", false, false)
@@ -0,0 +1,339 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCoalesceRawBuffer.cpp                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Merge adjacent RawBufferLoad/RawBufferStore operations on contiguous      //
+// addresses into one multi-component operation.                             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/SmallVector.h"
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+// Scalar ByteAddressBuffer/StructuredBuffer accesses are lowered one
+// rawBufferLoad/rawBufferStore per call, so code like
+//   a = buf.Load(addr); b = buf.Load(addr + 4);
+// reaches the driver as two single-component loads even though the same data
+// could be fetched with one two-component load, like Load2 would do.
+//
+// Within a basic block this pass merges 32-bit accesses on the same handle
+// whose masks are contiguous from component 0 and whose byte ranges touch:
+//  - loads are merged into the earlier load, as long as nothing in between
+//    may write memory;
+//  - stores are merged into the later store, as long as nothing in between
+//    may read or write memory.
+
+namespace {
+
+// Address of a raw buffer access, as a base value plus constant byte offset.
+struct RawBufferAddress {
+  Value *Handle;
+  Value *Element;  // Structured buffer element index, null for raw buffers.
+  Value *Base;     // Null when the byte offset is constant.
+  uint32_t Offset;
+};
+
+struct RawBufferAccess {
+  CallInst *CI;
+  RawBufferAddress Addr;
+  unsigned NumComps;
+};
+
+// Split V into Base + Offset, looking through adds, subs and disjoint ors
+// with constants.
+void SplitConstantOffset(Value *V, const DataLayout &DL, Value *&Base,
+                         uint32_t &Offset) {
+  Base = V;
+  Offset = 0;
+  while (BinaryOperator *BO = dyn_cast<BinaryOperator>(Base)) {
+    ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(1));
+    if (!C || C->getBitWidth() != 32)
+      break;
+    uint32_t CVal = (uint32_t)C->getZExtValue();
+    if (BO->getOpcode() == Instruction::Add) {
+      Offset += CVal;
+    } else if (BO->getOpcode() == Instruction::Sub) {
+      Offset -= CVal;
+    } else if (BO->getOpcode() == Instruction::Or &&
+               MaskedValueIsZero(BO->getOperand(0), C->getValue(), DL)) {
+      Offset += CVal;
+    } else {
+      break;
+    }
+    Base = BO->getOperand(0);
+  }
+  if (ConstantInt *C = dyn_cast<ConstantInt>(Base)) {
+    Offset += (uint32_t)C->getZExtValue();
+    Base = nullptr;
+  }
+}
+
+bool GetAddress(Value *Handle, Value *Index, Value *ElementOffset,
+                const DataLayout &DL, RawBufferAddress &Addr) {
+  Addr.Handle = Handle;
+  if (isa<UndefValue>(ElementOffset)) {
+    // ByteAddressBuffer: index is the byte address.
+    Addr.Element = nullptr;
+    SplitConstantOffset(Index, DL, Addr.Base, Addr.Offset);
+  } else {
+    // StructuredBuffer: index is the element, element offset is in bytes.
+    if (isa<UndefValue>(Index))
+      return false;
+    Addr.Element = Index;
+    SplitConstantOffset(ElementOffset, DL, Addr.Base, Addr.Offset);
+  }
+  return true;
+}
+
+// True if an access of NumComps dwords at A is immediately followed by B.
+bool IsContiguous(const RawBufferAddress &A, unsigned NumComps,
+                  const RawBufferAddress &B) {
+  return A.Handle == B.Handle && A.Element == B.Element && A.Base == B.Base &&
+         B.Offset - A.Offset == NumComps * 4;
+}
+
+// Number of components for masks that are contiguous from component 0.
+unsigned GetNumContiguousComps(Value *Mask) {
+  ConstantInt *C = dyn_cast<ConstantInt>(Mask);
+  if (!C)
+    return 0;
+  switch (C->getZExtValue()) {
+  case DXIL::kCompMask_X: return 1;
+  case DXIL::kCompMask_X | DXIL::kCompMask_Y: return 2;
+  case DXIL::kCompMask_X | DXIL::kCompMask_Y | DXIL::kCompMask_Z: return 3;
+  case DXIL::kCompMask_All: return 4;
+  default: return 0;
+  }
+}
+
+bool IsCoalescableType(Type *Ty) {
+  return Ty->isFloatTy() || Ty->isIntegerTy(32);
+}
+
+class DxilCoalesceRawBuffer : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCoalesceRawBuffer() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL coalesce raw buffer access";
+  }
+
+  bool runOnFunction(Function &F) override {
+    const DataLayout &DL = F.getParent()->getDataLayout();
+    bool bChanged = false;
+    for (BasicBlock &BB : F) {
+      bChanged |= CoalesceLoads(BB, DL);
+      bChanged |= CoalesceStores(BB, DL);
+    }
+    return bChanged;
+  }
+
+private:
+  bool CoalesceLoads(BasicBlock &BB, const DataLayout &DL);
+  bool CoalesceStores(BasicBlock &BB, const DataLayout &DL);
+};
+
+bool GetLoadAccess(CallInst *CI, const DataLayout &DL, RawBufferAccess &Access) {
+  DxilInst_RawBufferLoad Load(CI);
+  if (!IsCoalescableType(CI->getType()->getStructElementType(0)))
+    return false;
+  if (!isa<ConstantInt>(Load.get_alignment()))
+    return false;
+  unsigned NumComps = GetNumContiguousComps(Load.get_mask());
+  if (!NumComps)
+    return false;
+  // Only data components may be used; the status can't be split back.
+  for (User *U : CI->users()) {
+    ExtractValueInst *EV = dyn_cast<ExtractValueInst>(U);
+    if (!EV || EV->getNumIndices() != 1 || EV->getIndices()[0] >= NumComps)
+      return false;
+  }
+  Access.CI = CI;
+  Access.NumComps = NumComps;
+  return GetAddress(Load.get_srv(), Load.get_index(), Load.get_elementOffset(),
+                    DL, Access.Addr);
+}
+
+// Redirect the component extracts of Src to Dst, Shift components higher.
+void RedirectExtracts(CallInst *Src, CallInst *Dst, unsigned Shift) {
+  SmallVector<ExtractValueInst *, 4> Extracts;
+  for (User *U : Src->users())
+    Extracts.emplace_back(cast<ExtractValueInst>(U));
+  for (ExtractValueInst *EV : Extracts) {
+    IRBuilder<> Builder(EV);
+    Value *NewEV = Builder.CreateExtractValue(Dst, EV->getIndices()[0] + Shift);
+    EV->replaceAllUsesWith(NewEV);
+    EV->eraseFromParent();
+  }
+}
+
+bool DxilCoalesceRawBuffer::CoalesceLoads(BasicBlock &BB,
+                                          const DataLayout &DL) {
+  bool bChanged = false;
+  // The address operands of Load are defined before Pt; Load comes after Pt.
+  auto IsAvailableAt = [&](CallInst *Load, Instruction *Pt) {
+    DxilInst_RawBufferLoad L(Load);
+    for (Value *V : {L.get_index(), L.get_elementOffset()}) {
+      Instruction *I = dyn_cast<Instruction>(V);
+      if (!I || I->getParent() != &BB)
+        continue;
+      BasicBlock::iterator Scan = I;
+      while (&*Scan != Pt && &*Scan != Load)
+        ++Scan;
+      if (&*Scan == Load)
+        return false;
+    }
+    return true;
+  };
+
+  std::vector<RawBufferAccess> Loads;
+  for (auto It = BB.begin(), E = BB.end(); It != E;) {
+    Instruction *I = &*(It++);
+    CallInst *CI = dyn_cast<CallInst>(I);
+    if (!CI || !OP::IsDxilOpFuncCallInst(CI, OP::OpCode::RawBufferLoad)) {
+      if (I->mayWriteToMemory())
+        Loads.clear();
+      continue;
+    }
+    RawBufferAccess B;
+    if (!GetLoadAccess(CI, DL, B))
+      continue;
+
+    bool bMerged = false;
+    for (RawBufferAccess &A : Loads) {
+      if (A.CI->getCalledFunction() != B.CI->getCalledFunction() ||
+          A.NumComps + B.NumComps > 4)
+        continue;
+      if (IsContiguous(A.Addr, A.NumComps, B.Addr)) {
+        // B reads right after A: widen A, take B's components after A's.
+        RedirectExtracts(B.CI, A.CI, A.NumComps);
+        A.NumComps += B.NumComps;
+      } else if (IsContiguous(B.Addr, B.NumComps, A.Addr) &&
+                 IsAvailableAt(B.CI, A.CI)) {
+        // B reads right before A: move A down to B's address.
+        DxilInst_RawBufferLoad LA(A.CI), LB(B.CI);
+        RedirectExtracts(A.CI, A.CI, B.NumComps);
+        RedirectExtracts(B.CI, A.CI, 0);
+        LA.set_index(LB.get_index());
+        LA.set_elementOffset(LB.get_elementOffset());
+        LA.set_alignment(LB.get_alignment());
+        A.Addr = B.Addr;
+        A.NumComps += B.NumComps;
+      } else {
+        continue;
+      }
+      DxilInst_RawBufferLoad(A.CI).set_mask_val((1 << A.NumComps) - 1);
+      B.CI->eraseFromParent();
+      bMerged = bChanged = true;
+      break;
+    }
+    if (!bMerged)
+      Loads.emplace_back(B);
+  }
+  return bChanged;
+}
+
+bool GetStoreAccess(CallInst *CI, const DataLayout &DL,
+                    RawBufferAccess &Access) {
+  DxilInst_RawBufferStore Store(CI);
+  if (!IsCoalescableType(Store.get_value0()->getType()))
+    return false;
+  if (!isa<ConstantInt>(Store.get_alignment()))
+    return false;
+  unsigned NumComps = GetNumContiguousComps(Store.get_mask());
+  if (!NumComps)
+    return false;
+  Access.CI = CI;
+  Access.NumComps = NumComps;
+  return GetAddress(Store.get_uav(), Store.get_index(),
+                    Store.get_elementOffset(), DL, Access.Addr);
+}
+
+bool DxilCoalesceRawBuffer::CoalesceStores(BasicBlock &BB,
+                                           const DataLayout &DL) {
+  const unsigned ValueIdx = DxilInst_RawBufferStore::arg_value0;
+  bool bChanged = false;
+  // Only the last store can be merged: moving a store past another memory
+  // access might reorder accesses to the same address.
+  RawBufferAccess Prev;
+  bool bHasPrev = false;
+  for (auto It = BB.begin(), E = BB.end(); It != E;) {
+    Instruction *I = &*(It++);
+    CallInst *CI = dyn_cast<CallInst>(I);
+    if (!CI || !OP::IsDxilOpFuncCallInst(CI, OP::OpCode::RawBufferStore)) {
+      if (I->mayReadOrWriteMemory())
+        bHasPrev = false;
+      continue;
+    }
+    RawBufferAccess B;
+    if (!GetStoreAccess(CI, DL, B)) {
+      bHasPrev = false;
+      continue;
+    }
+
+    if (bHasPrev &&
+        Prev.CI->getCalledFunction() == B.CI->getCalledFunction() &&
+        Prev.NumComps + B.NumComps <= 4) {
+      DxilInst_RawBufferStore SA(Prev.CI), SB(B.CI);
+      if (IsContiguous(Prev.Addr, Prev.NumComps, B.Addr)) {
+        // Prev writes right before B: B takes Prev's address, values first.
+        for (unsigned i = B.NumComps; i-- > 0;)
+          B.CI->setArgOperand(ValueIdx + Prev.NumComps + i,
+                              B.CI->getArgOperand(ValueIdx + i));
+        for (unsigned i = 0; i < Prev.NumComps; i++)
+          B.CI->setArgOperand(ValueIdx + i,
+                              Prev.CI->getArgOperand(ValueIdx + i));
+        SB.set_index(SA.get_index());
+        SB.set_elementOffset(SA.get_elementOffset());
+        SB.set_alignment(SA.get_alignment());
+        B.Addr = Prev.Addr;
+      } else if (IsContiguous(B.Addr, B.NumComps, Prev.Addr)) {
+        // Prev writes right after B: append Prev's values.
+        for (unsigned i = 0; i < Prev.NumComps; i++)
+          B.CI->setArgOperand(ValueIdx + B.NumComps + i,
+                              Prev.CI->getArgOperand(ValueIdx + i));
+      } else {
+        Prev = B;
+        continue;
+      }
+      B.NumComps += Prev.NumComps;
+      SB.set_mask_val((1 << B.NumComps) - 1);
+      Prev.CI->eraseFromParent();
+      bChanged = true;
+    }
+    Prev = B;
+    bHasPrev = true;
+  }
+  return bChanged;
+}
+
+} // namespace
+
+char DxilCoalesceRawBuffer::ID = 0;
+
+FunctionPass *llvm::createDxilCoalesceRawBufferPass() {
+  return new DxilCoalesceRawBuffer();
+}
+
+INITIALIZE_PASS(DxilCoalesceRawBuffer, "hlsl-dxil-coalesce-raw-buffer",
+                "DXIL coalesce raw buffer access", false, false)
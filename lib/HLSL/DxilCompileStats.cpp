@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompileStats.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Counts the size of the module at the stages of a compile.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilCompileStats.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+class MetadataCounter {
+  SmallPtrSet<const MDNode *, 256> Visited;
+  SmallVector<const MDNode *, 32> Worklist;
+
+public:
+  void Add(const Metadata *MD) {
+    const MDNode *N = dyn_cast_or_null<MDNode>(MD);
+    if (N && Visited.insert(N).second)
+      Worklist.emplace_back(N);
+  }
+  void AddAttachments(
+      const SmallVectorImpl<std::pair<unsigned, MDNode *>> &MDs) {
+    for (const auto &MD : MDs)
+      Add(MD.second);
+  }
+  unsigned Count() {
+    while (!Worklist.empty()) {
+      const MDNode *N = Worklist.pop_back_val();
+      for (const MDOperand &Op : N->operands())
+        Add(Op.get());
+    }
+    return Visited.size();
+  }
+};
+
+class DxilRecordCompileStats : public ModulePass {
+  DxilCompileStats *m_pStats;
+  const char *m_Name;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  DxilRecordCompileStats(DxilCompileStats *pStats, const char *Name)
+      : ModulePass(ID), m_pStats(pStats), m_Name(Name) {}
+
+  const char *getPassName() const override {
+    return "DXIL record compile stats";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+
+  bool runOnModule(Module &M) override {
+    m_pStats->Record(m_Name, M);
+    return false;
+  }
+};
+
+char DxilRecordCompileStats::ID = 0;
+
+} // namespace
+
+void DxilCompileStats::Record(StringRef Name, Module &M) {
+  m_Stages.emplace_back();
+  Stage &S = m_Stages.back();
+  S.Name = Name;
+
+  MetadataCounter Metadata;
+  SmallVector<std::pair<unsigned, MDNode *>, 8> MDs;
+  for (const NamedMDNode &NMD : M.named_metadata())
+    for (const MDNode *N : NMD.operands())
+      Metadata.Add(N);
+
+  for (Function &F : M.functions()) {
+    if (F.isDeclaration())
+      continue;
+    ++S.Functions;
+    MDs.clear();
+    F.getAllMetadata(MDs);
+    Metadata.AddAttachments(MDs);
+    for (BasicBlock &BB : F) {
+      ++S.BasicBlocks;
+      for (Instruction &I : BB) {
+        ++S.Instructions;
+        MDs.clear();
+        I.getAllMetadata(MDs);
+        Metadata.AddAttachments(MDs);
+        CallInst *CI = dyn_cast<CallInst>(&I);
+        if (!CI)
+          continue;
+        for (Value *Arg : CI->arg_operands())
+          if (MetadataAsValue *MV = dyn_cast<MetadataAsValue>(Arg))
+            Metadata.Add(MV->getMetadata());
+        if (OP::IsDxilOpFuncCallInst(CI))
+          ++S.DxilOpClasses[OP::GetOpCodeClassName(
+              OP::GetDxilOpFuncCallInst(CI))];
+      }
+    }
+  }
+  S.MetadataNodes = Metadata.Count();
+}
+
+void DxilCompileStats::WriteJson(raw_ostream &OS,
+                                 uint64_t PeakMemoryBytes) const {
+  OS << "{\n  \"stages\": [";
+  bool FirstStage = true;
+  for (const Stage &S : m_Stages) {
+    OS << (FirstStage ? "\n" : ",\n") << "    { \"name\": \"" << S.Name
+       << "\", \"functions\": " << S.Functions
+       << ", \"basic_blocks\": " << S.BasicBlocks
+       << ", \"instructions\": " << S.Instructions
+       << ", \"metadata_nodes\": " << S.MetadataNodes
+       << ", \"dxil_op_classes\": {";
+    FirstStage = false;
+    bool FirstClass = true;
+    for (const auto &Class : S.DxilOpClasses) {
+      OS << (FirstClass ? " \"" : ", \"") << Class.first
+         << "\": " << Class.second;
+      FirstClass = false;
+    }
+    OS << (FirstClass ? "} }" : " } }");
+  }
+  OS << (FirstStage ? "]" : "\n  ]");
+  if (!m_Allocations.empty()) {
+    OS << ",\n  \"allocations\": [";
+    bool First = true;
+    for (const Allocations &A : m_Allocations) {
+      OS << (First ? "\n" : ",\n") << "    { \"name\": \"" << A.Name
+         << "\", \"kind\": \"" << (A.IsPass ? "pass" : "phase")
+         << "\", \"count\": " << A.Count << ", \"bytes\": " << A.Bytes
+         << ", \"live_peak_bytes\": " << A.LivePeakBytes << " }";
+      First = false;
+    }
+    OS << "\n  ]";
+  }
+  if (PeakMemoryBytes)
+    OS << ",\n  \"peak_memory_bytes\": " << PeakMemoryBytes;
+  OS << "\n}\n";
+}
+
+ModulePass *hlsl::createDxilRecordCompileStatsPass(DxilCompileStats *pStats,
+                                                   const char *Name) {
+  return new DxilRecordCompileStats(pStats, Name);
+}
@@ -30,6 +30,7 @@
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/ValueMap.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/ADT/BitVector.h"
@@ -468,6 +469,87 @@ static bool LegalizeResources(Module &M, DxilValueCache *DVC) {
   return Changed;
 }
 
+// Resource use analysis.
+namespace {
+// Records which resource globals are only used directly: loaded, possibly
+// through a GEP on the global, straight into createHandleForLib. Handles on
+// such resources already name their global, so legalizing resource use only
+// has to walk the use graphs of the others. Results are computed on demand
+// and kept until invalidated, so passes that leave resource uses alone can
+// preserve them for the passes that follow.
+class ResourceUseAnalysis : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit ResourceUseAnalysis() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Resource Use Analysis";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+
+  bool runOnModule(Module &M) override {
+    invalidate();
+    return false;
+  }
+
+  void releaseMemory() override { invalidate(); }
+
+  // Drop all results; must be called after changing how resources are used.
+  void invalidate() { m_DirectUses.clear(); }
+
+  bool HasOnlyDirectUses(GlobalVariable *GV) {
+    auto it = m_DirectUses.find(GV);
+    if (it != m_DirectUses.end())
+      return it->second;
+    bool bDirect = ComputeHasOnlyDirectUses(GV);
+    m_DirectUses[GV] = bDirect;
+    return bDirect;
+  }
+
+private:
+  static bool IsHandleOnlyLoad(LoadInst *LI) {
+    for (User *U : LI->users()) {
+      CallInst *CI = dyn_cast<CallInst>(U);
+      if (!CI || !OP::IsDxilOpFuncCallInst(
+                     CI, DXIL::OpCode::CreateHandleForLib))
+        return false;
+    }
+    return true;
+  }
+
+  static bool ComputeHasOnlyDirectUses(GlobalVariable *GV) {
+    for (User *U : GV->users()) {
+      if (GEPOperator *GEP = dyn_cast<GEPOperator>(U)) {
+        for (User *GEPU : GEP->users()) {
+          LoadInst *LI = dyn_cast<LoadInst>(GEPU);
+          if (!LI || !IsHandleOnlyLoad(LI))
+            return false;
+        }
+      } else if (LoadInst *LI = dyn_cast<LoadInst>(U)) {
+        if (!IsHandleOnlyLoad(LI))
+          return false;
+      } else if (!isa<Constant>(U) && !isa<BitCastInst>(U)) {
+        // Constants are @llvm.used entries, bitcasts feed lifetime markers.
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Entries go away with their globals.
+  ValueMap<const GlobalVariable *, bool> m_DirectUses;
+};
+
+} // namespace
+
+char ResourceUseAnalysis::ID = 0;
+
+INITIALIZE_PASS(ResourceUseAnalysis, "hlsl-dxil-resource-use-analysis",
+                "DXIL resource use analysis", false, true)
+
 namespace {
 class DxilLowerCreateHandleForLib : public ModulePass {
 private:
@@ -482,6 +564,7 @@ public:
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<DxilValueCache>();
+    AU.addRequired<ResourceUseAnalysis>();
   }
 
   const char *getPassName() const override {
@@ -538,6 +621,7 @@ public:
       if (bLocalChanged) {
         // Remove unused resources.
         DM.RemoveResourcesWithUnusedSymbols();
+        getAnalysis<ResourceUseAnalysis>().invalidate();
       }
       bChanged |= bLocalChanged;
     }
@@ -819,6 +903,10 @@ class LegalizeResourceUseHelper {
   //   with direct GV GEP + load, with select/phi on GEP indices instead.
 
 public:
+  explicit LegalizeResourceUseHelper(ResourceUseAnalysis &ResourceUses)
+    : m_ResourceUses(ResourceUses) {}
+
+  ResourceUseAnalysis &m_ResourceUses;
   ResourceUseErrors m_Errors;
 
   ValueToValueMap ValueToResourceGV;
@@ -1515,30 +1603,36 @@ public:
     return false;
   }
 
+  // Resources only used directly need no legalization; skip their walks.
+  void CollectResource(GlobalVariable *GV) {
+    if (!m_ResourceUses.HasOnlyDirectUses(GV))
+      CollectResourceGVUsers(GV, GV);
+  }
+
   bool CollectResources(DxilModule &DM) {
     bool bChanged = false;
     for (const auto &res : DM.GetCBuffers()) {
       if (GlobalVariable *GV = dyn_cast<GlobalVariable>(res->GetGlobalSymbol())) {
         bChanged |= SetExternalConstant(GV);
-        CollectResourceGVUsers(GV, GV);
+        CollectResource(GV);
       }
     }
     for (const auto &res : DM.GetSRVs()) {
       if (GlobalVariable *GV = dyn_cast<GlobalVariable>(res->GetGlobalSymbol())) {
         bChanged |= SetExternalConstant(GV);
-        CollectResourceGVUsers(GV, GV);
+        CollectResource(GV);
       }
     }
     for (const auto &res : DM.GetUAVs()) {
       if (GlobalVariable *GV = dyn_cast<GlobalVariable>(res->GetGlobalSymbol())) {
         bChanged |= SetExternalConstant(GV);
-        CollectResourceGVUsers(GV, GV);
+        CollectResource(GV);
       }
     }
     for (const auto &res : DM.GetSamplers()) {
       if (GlobalVariable *GV = dyn_cast<GlobalVariable>(res->GetGlobalSymbol())) {
         bChanged |= SetExternalConstant(GV);
-        CollectResourceGVUsers(GV, GV);
+        CollectResource(GV);
       }
     }
     return bChanged;
@@ -1574,6 +1668,7 @@ public:
 
     DoTransform();
     VerifyComplete(DM);
+    m_ResourceUses.invalidate();
 
     return true;
   }
@@ -1589,8 +1684,13 @@ public:
     return "DXIL Legalize Resource Use";
   }
 
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<ResourceUseAnalysis>();
+    AU.addPreserved<ResourceUseAnalysis>();
+  }
+
   bool runOnModule(Module &M) override {
-    LegalizeResourceUseHelper helper;
+    LegalizeResourceUseHelper helper(getAnalysis<ResourceUseAnalysis>());
     return helper.runOnModule(M);
   }
 
@@ -1605,13 +1705,17 @@ ModulePass *llvm::createDxilLegalizeResources() {
   return new DxilLegalizeResources();
 }
 
-INITIALIZE_PASS(DxilLegalizeResources,
+INITIALIZE_PASS_BEGIN(DxilLegalizeResources,
+  "hlsl-dxil-legalize-resources",
+  "DXIL legalize resource use", false, false)
+INITIALIZE_PASS_DEPENDENCY(ResourceUseAnalysis)
+INITIALIZE_PASS_END(DxilLegalizeResources,
   "hlsl-dxil-legalize-resources",
   "DXIL legalize resource use", false, false)
 
 
 bool DxilLowerCreateHandleForLib::RemovePhiOnResource() {
-  LegalizeResourceUseHelper helper;
+  LegalizeResourceUseHelper helper(getAnalysis<ResourceUseAnalysis>());
   bool bChanged = helper.runOnModule(*m_DM->GetModule());
   if (helper.ErrorsReported())
     m_bLegalizationFailed = true;
@@ -2696,6 +2800,7 @@ ModulePass *llvm::createDxilLowerCreateHandleForLibPass() {
 
 INITIALIZE_PASS_BEGIN(DxilLowerCreateHandleForLib, "hlsl-dxil-lower-handle-for-lib", "DXIL Lower createHandleForLib", false, false)
 INITIALIZE_PASS_DEPENDENCY(DxilValueCache)
+INITIALIZE_PASS_DEPENDENCY(ResourceUseAnalysis)
 INITIALIZE_PASS_END(DxilLowerCreateHandleForLib, "hlsl-dxil-lower-handle-for-lib", "DXIL Lower createHandleForLib", false, false)
 
 
@@ -2709,6 +2814,11 @@ public:
   }
   const char *getPassName() const override { return "DXIL Allocate Resources For Library"; }
 
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    // Binding registers does not change how resources are used.
+    AU.addPreserved<ResourceUseAnalysis>();
+  }
+
   bool runOnModule(Module &M) override {
     DxilModule &DM = M.GetOrCreateDxilModule();
     // Must specify a default space, and must apply to library.
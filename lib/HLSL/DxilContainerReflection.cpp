@@ -14,7 +14,13 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilContainerReader.h"
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/DXIL/DxilShaderModel.h"
 #include "dxc/DXIL/DxilOperations.h"
@@ -62,18 +68,27 @@ using namespace llvm;
 using namespace hlsl;
 using namespace hlsl::DXIL;
 
-class DxilContainerReflection : public IDxcContainerReflection {
+class DxilContainerReflection : public IDxcContainerReflection,
+                                public IDxcContainerReflectionCache {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   CComPtr<IDxcBlob> m_container;
   const DxilContainerHeader *m_pHeader = nullptr;
   uint32_t m_headerLen = 0;
+  DxilPartKindIndex m_partIndex;
+  std::string m_CacheDirectory; // UTF-8; empty when disabled
+  UINT32 m_CacheHits = 0;
+  UINT32 m_CacheMisses = 0;
   bool IsLoaded() const { return m_pHeader != nullptr; }
+  bool GetCacheKey(const DxilPartHeader *pPart,
+                   const DxilPartHeader *pRDATPart, MD5::MD5Result &Key);
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxilContainerReflection)
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcContainerReflection>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcContainerReflection,
+                                 IDxcContainerReflectionCache>(this, iid,
+                                                               ppvObject);
   }
 
   HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pContainer) override;
@@ -82,6 +97,11 @@ public:
   HRESULT STDMETHODCALLTYPE GetPartContent(UINT32 idx, _COM_Outptr_ IDxcBlob **ppResult) override;
   HRESULT STDMETHODCALLTYPE FindFirstPartKind(UINT32 kind, _Out_ UINT32 *pResult) override;
   HRESULT STDMETHODCALLTYPE GetPartReflection(UINT32 idx, REFIID iid, _COM_Outptr_ void **ppvObject) override;
+
+  // IDxcContainerReflectionCache
+  HRESULT STDMETHODCALLTYPE SetCacheDirectory(_In_opt_z_ LPCWSTR pDirectory) override;
+  HRESULT STDMETHODCALLTYPE Clear() override;
+  HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ UINT32 *pHits, _Out_ UINT32 *pMisses) override;
 };
 
 class CShaderReflectionConstantBuffer;
@@ -89,6 +109,92 @@ class CShaderReflectionType;
 
 enum class PublicAPI { D3D12 = 0, D3D11_47 = 1, D3D11_43 = 2 };
 
+// Reflection cache entries are a flat sequence of fields:
+//   magic, version, kind (shader or library)
+//   types, constant buffers with their variables, buffer name indices,
+//   resources, usage-in-metadata flag
+//   shader: signatures, shader desc and the query results kept with it
+//   library: functions with their version and used resources and buffers
+// Integers are little-endian uint32. Descriptor structs are stored as-is,
+// with pointer fields cleared, and each string a descriptor points to
+// follows it with its terminator; objects refer to types by index. Strings
+// in a restored reflection object point into the entry it was read from.
+static const uint32_t kReflectionCacheMagic = DXC_FOURCC('D', 'X', 'R', 'C');
+static const uint32_t kReflectionCacheVersion = 1;
+static const char kReflectionCacheExtension[] = ".dxrc";
+enum class ReflectionCacheKind : uint32_t { Shader = 0, Library = 1 };
+
+class ReflectionCacheWriter {
+  std::string m_Data;
+public:
+  void WriteU32(uint32_t Value) {
+    m_Data.append((const char *)&Value, sizeof(Value));
+  }
+  // Null is written as size 0, other strings with their terminator.
+  void WriteString(LPCSTR pValue) {
+    if (!pValue) {
+      WriteU32(0);
+      return;
+    }
+    size_t Size = strlen(pValue) + 1;
+    WriteU32((uint32_t)Size);
+    m_Data.append(pValue, Size);
+  }
+  template <typename T> void WriteStruct(const T &Value) {
+    m_Data.append((const char *)&Value, sizeof(Value));
+  }
+  void WriteHeader(ReflectionCacheKind Kind) {
+    WriteU32(kReflectionCacheMagic);
+    WriteU32(kReflectionCacheVersion);
+    WriteU32((uint32_t)Kind);
+  }
+  StringRef GetData() const { return m_Data; }
+};
+
+class ReflectionCacheReader {
+  const char *m_pCur;
+  const char *m_pEnd;
+public:
+  ReflectionCacheReader(StringRef Data)
+      : m_pCur(Data.begin()), m_pEnd(Data.end()) {}
+  bool ReadU32(uint32_t &Value) { return ReadStruct(Value); }
+  bool ReadString(LPCSTR &pValue) {
+    uint32_t Size;
+    if (!ReadU32(Size))
+      return false;
+    if (Size == 0) {
+      pValue = nullptr;
+      return true;
+    }
+    if ((size_t)(m_pEnd - m_pCur) < Size || m_pCur[Size - 1] != '\0')
+      return false;
+    pValue = m_pCur;
+    m_pCur += Size;
+    return true;
+  }
+  template <typename T> bool ReadStruct(T &Value) {
+    if ((size_t)(m_pEnd - m_pCur) < sizeof(Value))
+      return false;
+    memcpy(&Value, m_pCur, sizeof(Value));
+    m_pCur += sizeof(Value);
+    return true;
+  }
+  // Reads an element count, rejecting counts that could not fit in the rest
+  // of the entry so a damaged entry cannot cause a huge allocation.
+  bool ReadCount(uint32_t &Count) {
+    return ReadU32(Count) && Count <= (size_t)(m_pEnd - m_pCur);
+  }
+  bool ReadHeader(ReflectionCacheKind Kind) {
+    uint32_t Magic, Version, EntryKind;
+    return ReadU32(Magic) && Magic == kReflectionCacheMagic &&
+           ReadU32(Version) && Version == kReflectionCacheVersion &&
+           ReadU32(EntryKind) && EntryKind == (uint32_t)Kind;
+  }
+  bool AtEnd() const { return m_pCur == m_pEnd; }
+};
+
+typedef DenseMap<const CShaderReflectionType *, uint32_t> ReflectionTypeIndexMap;
+
 #ifdef ADD_16_64_BIT_TYPES
 #define D3D_SVT_INT16   ((D3D_SHADER_VARIABLE_TYPE)58)
 #define D3D_SVT_UINT16  ((D3D_SHADER_VARIABLE_TYPE)59)
@@ -114,6 +220,9 @@ public:
   // m_StructuredBufferCBsByName is the index into m_CBs corresponding to
   // StructuredBuffer resources, separately from CB resources.
   std::map<StringRef, UINT> m_StructuredBufferCBsByName;
+  // Entry the reflection was restored from, instead of the module; the
+  // descriptors' strings point into it.
+  std::unique_ptr<MemoryBuffer> m_pCacheEntry;
 
   void CreateReflectionObjects();
   void CreateReflectionObjectForResource(DxilResourceBase *R);
@@ -121,6 +230,9 @@ public:
   HRESULT LoadRDAT(const DxilPartHeader *pPart);
   HRESULT LoadModule(const DxilPartHeader *pPart);
 
+  void SaveToCache(ReflectionCacheWriter &W) const;
+  bool LoadFromCache(ReflectionCacheReader &R);
+
   // Common code
   ID3D12ShaderReflectionConstantBuffer* _GetConstantBufferByIndex(UINT Index);
   ID3D12ShaderReflectionConstantBuffer* _GetConstantBufferByName(LPCSTR Name);
@@ -144,6 +256,11 @@ private:
   std::vector<D3D12_SIGNATURE_PARAMETER_DESC>     m_PatchConstantSignature;
   std::vector<std::unique_ptr<char[]>>            m_UpperCaseNames;
   D3D12_SHADER_DESC m_Desc = {};
+  // Answers to the queries that are not part of the desc, kept so they do
+  // not need the module.
+  D3D_PRIMITIVE m_GSInputPrimitive = D3D_PRIMITIVE::D3D10_PRIMITIVE_UNDEFINED;
+  UINT m_ThreadGroupSize[3] = {};
+  UINT64 m_RequiresFlags = 0;
 
   void SetCBufferUsage();
   void CreateReflectionObjectsForSignature(
@@ -181,6 +298,8 @@ public:
   }
 
   HRESULT Load(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart);
+  void SaveToCache(ReflectionCacheWriter &W) const;
+  HRESULT LoadFromCache(std::unique_ptr<MemoryBuffer> pEntry);
 
   // ID3D12ShaderReflection
   STDMETHODIMP GetDesc(THIS_ _Out_ D3D12_SHADER_DESC *pDesc);
@@ -246,6 +365,8 @@ public:
   }
 
   HRESULT Load(const DxilPartHeader *pModulePart, const DxilPartHeader *pDXILPart);
+  void SaveToCache(ReflectionCacheWriter &W) const;
+  HRESULT LoadFromCache(std::unique_ptr<MemoryBuffer> pEntry);
 
   // ID3D12LibraryReflection
   STDMETHOD(GetDesc)(THIS_ _Out_ D3D12_LIBRARY_DESC * pDesc);
@@ -253,8 +374,8 @@ public:
   STDMETHOD_(ID3D12FunctionReflection *, GetFunctionByIndex)(THIS_ _In_ INT FunctionIndex);
 };
 
-namespace hlsl {
-HRESULT CreateDxilShaderReflection(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, REFIID iid, void **ppvObject) {
+// When pCacheWriter is set, the loaded reflection is also serialized into it.
+static HRESULT CreateShaderReflection(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, ReflectionCacheWriter *pCacheWriter, REFIID iid, void **ppvObject) {
   if (!ppvObject)
     return E_INVALIDARG;
   CComPtr<DxilShaderReflection> pReflection = DxilShaderReflection::Alloc(DxcGetThreadMallocNoRef());
@@ -263,19 +384,120 @@ HRESULT CreateDxilShaderReflection(const DxilPartHeader *pModulePart, const Dxil
   pReflection->SetPublicAPI(api);
   // pRDATPart to be used for transition.
   IFR(pReflection->Load(pModulePart, pRDATPart));
+  if (pCacheWriter) {
+    try {
+      pReflection->SaveToCache(*pCacheWriter);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
   IFR(pReflection.p->QueryInterface(iid, ppvObject));
   return S_OK;
 }
-HRESULT CreateDxilLibraryReflection(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, REFIID iid, void **ppvObject) {
+static HRESULT CreateLibraryReflection(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, ReflectionCacheWriter *pCacheWriter, REFIID iid, void **ppvObject) {
   if (!ppvObject)
     return E_INVALIDARG;
   CComPtr<DxilLibraryReflection> pReflection = DxilLibraryReflection::Alloc(DxcGetThreadMallocNoRef());
   IFROOM(pReflection.p);
   // pRDATPart used for resource usage per-function.
   IFR(pReflection->Load(pModulePart, pRDATPart));
+  if (pCacheWriter) {
+    try {
+      pReflection->SaveToCache(*pCacheWriter);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
   IFR(pReflection.p->QueryInterface(iid, ppvObject));
   return S_OK;
 }
+
+static HRESULT CreateShaderReflectionFromCache(std::unique_ptr<MemoryBuffer> pEntry, REFIID iid, void **ppvObject) {
+  CComPtr<DxilShaderReflection> pReflection = DxilShaderReflection::Alloc(DxcGetThreadMallocNoRef());
+  IFROOM(pReflection.p);
+  pReflection->SetPublicAPI(DxilShaderReflection::IIDToAPI(iid));
+  IFR(pReflection->LoadFromCache(std::move(pEntry)));
+  IFR(pReflection.p->QueryInterface(iid, ppvObject));
+  return S_OK;
+}
+static HRESULT CreateLibraryReflectionFromCache(std::unique_ptr<MemoryBuffer> pEntry, REFIID iid, void **ppvObject) {
+  CComPtr<DxilLibraryReflection> pReflection = DxilLibraryReflection::Alloc(DxcGetThreadMallocNoRef());
+  IFROOM(pReflection.p);
+  IFR(pReflection->LoadFromCache(std::move(pEntry)));
+  IFR(pReflection.p->QueryInterface(iid, ppvObject));
+  return S_OK;
+}
+
+namespace hlsl {
+HRESULT CreateDxilShaderReflection(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, REFIID iid, void **ppvObject) {
+  return CreateShaderReflection(pModulePart, pRDATPart, nullptr, iid, ppvObject);
+}
+HRESULT CreateDxilLibraryReflection(const DxilPartHeader *pModulePart, const DxilPartHeader *pRDATPart, REFIID iid, void **ppvObject) {
+  return CreateLibraryReflection(pModulePart, pRDATPart, nullptr, iid, ppvObject);
+}
+}
+
+// Cache I/O goes to disk, whatever file system the caller has installed.
+class ReflectionCacheFileSystemScope {
+  std::unique_ptr<sys::fs::MSFileSystem> m_pFileSystem;
+  std::unique_ptr<sys::fs::AutoPerThreadSystem> m_pScope;
+public:
+  bool Init() {
+    sys::fs::MSFileSystem *pFileSystem;
+    if (FAILED(CreateMSFileSystemForDisk(&pFileSystem)))
+      return false;
+    m_pFileSystem.reset(pFileSystem);
+    m_pScope.reset(new sys::fs::AutoPerThreadSystem(pFileSystem));
+    return !m_pScope->error_code();
+  }
+};
+
+static std::string GetReflectionCacheEntryPath(StringRef Directory,
+                                               MD5::MD5Result &Key) {
+  SmallString<32> Hex;
+  MD5::stringifyResult(Key, Hex);
+  SmallString<256> Path(Directory);
+  sys::path::append(Path, Twine(Hex) + kReflectionCacheExtension);
+  return Path.str();
+}
+
+static std::unique_ptr<MemoryBuffer>
+ReadReflectionCacheEntry(StringRef Directory, MD5::MD5Result &Key) {
+  ReflectionCacheFileSystemScope DiskScope;
+  if (!DiskScope.Init())
+    return nullptr;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> EntryOrErr = MemoryBuffer::getFile(
+      GetReflectionCacheEntryPath(Directory, Key), -1, false);
+  if (!EntryOrErr)
+    return nullptr;
+  return std::move(EntryOrErr.get());
+}
+
+// Failures are ignored; the next load reflects from the module again.
+static void WriteReflectionCacheEntry(StringRef Directory, MD5::MD5Result &Key,
+                                      StringRef Entry) {
+  ReflectionCacheFileSystemScope DiskScope;
+  if (!DiskScope.Init() || sys::fs::create_directories(Directory))
+    return;
+
+  // Write under a unique name and rename into place, so concurrent loads
+  // never observe a partially written entry.
+  int FD;
+  SmallString<256> TempPath;
+  SmallString<256> Model(Directory);
+  sys::path::append(Model, "%%%%%%%%%%%%.tmp");
+  if (sys::fs::createUniqueFile(Model, FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose*/ true);
+    OS << Entry;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, GetReflectionCacheEntryPath(Directory, Key)))
+    sys::fs::remove(TempPath);
 }
 
 _Use_decl_annotations_
@@ -285,19 +507,26 @@ HRESULT DxilContainerReflection::Load(IDxcBlob *pContainer) {
     m_container.Release();
     m_pHeader = nullptr;
     m_headerLen = 0;
+    m_partIndex.Clear();
     return S_OK;
   }
 
+  // Only look for a container inside a PDB when the blob is not one itself;
+  // loading many containers should not pay for a stream and a failed parse
+  // each time.
   CComPtr<IDxcBlob> pPDBContainer;
-  try {
-    DxcThreadMalloc DxcMalloc(m_pMalloc);
-    CComPtr<IStream> pStream;
-    IFR(hlsl::CreateReadOnlyBlobStream(pContainer, &pStream));
-    if (SUCCEEDED(hlsl::pdb::LoadDataFromStream(m_pMalloc, pStream, &pPDBContainer))) {
-      pContainer = pPDBContainer;
+  if (!IsDxilContainerLike(pContainer->GetBufferPointer(),
+                           pContainer->GetBufferSize())) {
+    try {
+      DxcThreadMalloc DxcMalloc(m_pMalloc);
+      CComPtr<IStream> pStream;
+      IFR(hlsl::CreateReadOnlyBlobStream(pContainer, &pStream));
+      if (SUCCEEDED(hlsl::pdb::LoadDataFromStream(m_pMalloc, pStream, &pPDBContainer))) {
+        pContainer = pPDBContainer;
+      }
     }
+    CATCH_CPP_RETURN_HRESULT();
   }
-  CATCH_CPP_RETURN_HRESULT();
 
   uint32_t bufLen = pContainer->GetBufferSize();
   const DxilContainerHeader *pHeader =
@@ -312,6 +541,7 @@ HRESULT DxilContainerReflection::Load(IDxcBlob *pContainer) {
   m_container = pContainer;
   m_headerLen = bufLen;
   m_pHeader = pHeader;
+  m_partIndex.Build(pHeader);
 
   return S_OK;
 }
@@ -353,9 +583,9 @@ HRESULT DxilContainerReflection::FindFirstPartKind(UINT32 kind, _Out_ UINT32 *pR
   if (pResult == nullptr) return E_POINTER;
   *pResult = 0;
   if (!IsLoaded()) return E_NOT_VALID_STATE;
-  DxilPartIterator it = std::find_if(begin(m_pHeader), end(m_pHeader), DxilPartIsType(kind));
-  if (it == end(m_pHeader)) return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
-  *pResult = it.index;
+  uint32_t index = m_partIndex.Find(kind);
+  if (index == (uint32_t)DXIL_CONTAINER_BLOB_NOT_FOUND) return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+  *pResult = index;
   return S_OK;
 }
 
@@ -401,16 +631,130 @@ HRESULT DxilContainerReflection::GetPartReflection(UINT32 idx, REFIID iid, void
   HRESULT hr = S_OK;
 
   DXIL::ShaderKind SK = GetVersionShaderType(pProgramHeader->ProgramVersion);
-  if (SK == DXIL::ShaderKind::Library) {
-    IFC(hlsl::CreateDxilLibraryReflection(pPart, pRDATPart, iid, ppvObject));
+  bool bLibrary = SK == DXIL::ShaderKind::Library;
+
+  MD5::MD5Result CacheKey;
+  ReflectionCacheWriter CacheWriter;
+  bool bUseCache = !m_CacheDirectory.empty() &&
+                   GetCacheKey(pPart, pRDATPart, CacheKey);
+  if (bUseCache) {
+    std::unique_ptr<MemoryBuffer> pEntry;
+    try {
+      pEntry = ReadReflectionCacheEntry(m_CacheDirectory, CacheKey);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+    // An entry that does not load is replaced by reflecting the module.
+    if (pEntry &&
+        SUCCEEDED(bLibrary ? CreateLibraryReflectionFromCache(
+                                 std::move(pEntry), iid, ppvObject)
+                           : CreateShaderReflectionFromCache(
+                                 std::move(pEntry), iid, ppvObject))) {
+      ++m_CacheHits;
+      return S_OK;
+    }
+    ++m_CacheMisses;
+  }
+
+  ReflectionCacheWriter *pCacheWriter = bUseCache ? &CacheWriter : nullptr;
+  if (bLibrary) {
+    IFC(CreateLibraryReflection(pPart, pRDATPart, pCacheWriter, iid, ppvObject));
   } else {
-    IFC(hlsl::CreateDxilShaderReflection(pPart, pRDATPart, iid, ppvObject));
+    IFC(CreateShaderReflection(pPart, pRDATPart, pCacheWriter, iid, ppvObject));
+  }
+  if (bUseCache) {
+    // Storing is best effort; the reflection object is complete without it.
+    try {
+      WriteReflectionCacheEntry(m_CacheDirectory, CacheKey,
+                                CacheWriter.GetData());
+    } catch (...) {
+    }
   }
 
 Cleanup:
   return hr;
 }
 
+// The shader hash covers the program part only, so the other parts
+// reflection reads from are keyed by their contents.
+bool DxilContainerReflection::GetCacheKey(const DxilPartHeader *pPart,
+                                          const DxilPartHeader *pRDATPart,
+                                          MD5::MD5Result &Key) {
+  uint32_t hashIndex = m_partIndex.Find(DFCC_ShaderHash);
+  if (hashIndex == (uint32_t)DXIL_CONTAINER_BLOB_NOT_FOUND)
+    return false;
+  const DxilPartHeader *pHashPart = GetDxilContainerPart(m_pHeader, hashIndex);
+  if (pHashPart->PartSize < sizeof(DxilShaderHash))
+    return false;
+
+  MD5 Hash;
+  auto UpdateU32 = [&Hash](uint32_t Value) {
+    Hash.update(ArrayRef<uint8_t>((const uint8_t *)&Value, sizeof(Value)));
+  };
+  auto UpdatePart = [&Hash, &UpdateU32](const DxilPartHeader *pPartToHash) {
+    UpdateU32(pPartToHash->PartFourCC);
+    UpdateU32(pPartToHash->PartSize);
+    Hash.update(ArrayRef<uint8_t>(
+        (const uint8_t *)GetDxilPartData(pPartToHash), pPartToHash->PartSize));
+  };
+  UpdateU32(kReflectionCacheVersion);
+  Hash.update(ArrayRef<uint8_t>((const uint8_t *)GetDxilPartData(pHashPart),
+                                sizeof(DxilShaderHash)));
+  if (pPart->PartFourCC == DFCC_DXIL)
+    UpdateU32(pPart->PartFourCC);
+  else
+    UpdatePart(pPart);
+  if (pRDATPart)
+    UpdatePart(pRDATPart);
+  Hash.final(Key);
+  return true;
+}
+
+_Use_decl_annotations_
+HRESULT DxilContainerReflection::SetCacheDirectory(LPCWSTR pDirectory) {
+  std::string Directory;
+  try {
+    if (pDirectory && *pDirectory &&
+        !Unicode::UTF16ToUTF8String(pDirectory, &Directory))
+      return E_INVALIDARG;
+    m_CacheDirectory = std::move(Directory);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+HRESULT DxilContainerReflection::Clear() {
+  m_CacheHits = 0;
+  m_CacheMisses = 0;
+  if (m_CacheDirectory.empty())
+    return S_OK;
+  try {
+    ReflectionCacheFileSystemScope DiskScope;
+    if (!DiskScope.Init())
+      return E_FAIL;
+    std::vector<std::string> Entries;
+    std::error_code EC;
+    for (sys::fs::directory_iterator It(m_CacheDirectory, EC), End;
+         !EC && It != End; It.increment(EC)) {
+      if (sys::path::extension(It->path()) == kReflectionCacheExtension)
+        Entries.push_back(It->path());
+    }
+    if (EC && EC != std::errc::no_such_file_or_directory)
+      return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    for (const std::string &Entry : Entries)
+      sys::fs::remove(Entry);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxilContainerReflection::GetStatistics(UINT32 *pHits, UINT32 *pMisses) {
+  if (pHits == nullptr || pMisses == nullptr) return E_POINTER;
+  *pHits = m_CacheHits;
+  *pMisses = m_CacheMisses;
+  return S_OK;
+}
+
 void hlsl::CreateDxcContainerReflection(IDxcContainerReflection **ppResult) {
   CComPtr<DxilContainerReflection> pReflection = DxilContainerReflection::Alloc(DxcGetThreadMallocNoRef());
   *ppResult = pReflection.Detach();
@@ -449,6 +793,10 @@ public:
     unsigned int            baseOffset,
     std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
     bool                    isCBuffer);
+  void SaveToCache(ReflectionCacheWriter &W,
+                   const ReflectionTypeIndexMap &typeIndices) const;
+  bool LoadFromCache(ReflectionCacheReader &R,
+                     std::vector<std::unique_ptr<CShaderReflectionType>> &allTypes);
 
   // ID3D12ShaderReflectionType
   STDMETHOD(GetDesc)(D3D12_SHADER_TYPE_DESC *pDesc);
@@ -484,6 +832,11 @@ public:
   void Initialize(CShaderReflectionConstantBuffer *pBuffer,
                   D3D12_SHADER_VARIABLE_DESC *pDesc,
                   CShaderReflectionType *pType, BYTE *pDefaultValue);
+  void SaveToCache(ReflectionCacheWriter &W,
+                   const ReflectionTypeIndexMap &typeIndices) const;
+  bool LoadFromCache(ReflectionCacheReader &R,
+                     CShaderReflectionConstantBuffer *pBuffer,
+                     std::vector<std::unique_ptr<CShaderReflectionType>> &allTypes);
 
   LPCSTR GetName() { return m_Desc.Name; }
 
@@ -522,6 +875,10 @@ public:
                          DxilResource &R,
                          std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
                          bool bUsageInMetadata);
+  void SaveToCache(ReflectionCacheWriter &W,
+                   const ReflectionTypeIndexMap &typeIndices) const;
+  bool LoadFromCache(ReflectionCacheReader &R,
+                     std::vector<std::unique_ptr<CShaderReflectionType>> &allTypes);
   LPCSTR GetName() { return m_Desc.Name; }
 
   // ID3D12ShaderReflectionConstantBuffer
@@ -1480,6 +1837,110 @@ CShaderReflectionConstantBuffer::GetVariableByName(LPCSTR Name) {
   return &g_InvalidSRVariable;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Reflection cache serialization - helper objects.                          //
+
+static bool ReadTypeIndex(ReflectionCacheReader &R,
+                          std::vector<std::unique_ptr<CShaderReflectionType>> &allTypes,
+                          CShaderReflectionType *&pType) {
+  uint32_t index;
+  if (!R.ReadU32(index) || index >= allTypes.size())
+    return false;
+  pType = allTypes[index].get();
+  return true;
+}
+
+void CShaderReflectionType::SaveToCache(
+    ReflectionCacheWriter &W, const ReflectionTypeIndexMap &typeIndices) const {
+  D3D12_SHADER_TYPE_DESC Desc = m_Desc;
+  Desc.Name = nullptr;
+  W.WriteStruct(Desc);
+  W.WriteString(m_Desc.Name);
+  W.WriteU32(m_SizeInCBuffer);
+  W.WriteU32(m_MemberTypes.size());
+  for (size_t i = 0; i < m_MemberTypes.size(); ++i) {
+    W.WriteString(m_MemberNames[i].data());
+    W.WriteU32(typeIndices.lookup(m_MemberTypes[i]));
+  }
+}
+
+bool CShaderReflectionType::LoadFromCache(
+    ReflectionCacheReader &R,
+    std::vector<std::unique_ptr<CShaderReflectionType>> &allTypes) {
+  LPCSTR pName;
+  uint32_t memberCount;
+  if (!R.ReadStruct(m_Desc) || !R.ReadString(pName) ||
+      !R.ReadU32(m_SizeInCBuffer) || !R.ReadCount(memberCount))
+    return false;
+  if (pName) {
+    m_Name = pName;
+    m_Desc.Name = m_Name.c_str();
+  }
+  m_MemberNames.resize(memberCount);
+  m_MemberTypes.resize(memberCount);
+  for (uint32_t i = 0; i < memberCount; ++i) {
+    LPCSTR pMemberName;
+    if (!R.ReadString(pMemberName) || !pMemberName ||
+        !ReadTypeIndex(R, allTypes, m_MemberTypes[i]))
+      return false;
+    m_MemberNames[i] = pMemberName;
+  }
+  m_pSubType = nullptr;
+  m_pBaseClass = nullptr;
+  m_Identity = 0;
+  return true;
+}
+
+void CShaderReflectionVariable::SaveToCache(
+    ReflectionCacheWriter &W, const ReflectionTypeIndexMap &typeIndices) const {
+  D3D12_SHADER_VARIABLE_DESC Desc = m_Desc;
+  Desc.Name = nullptr;
+  Desc.DefaultValue = nullptr;
+  W.WriteStruct(Desc);
+  W.WriteString(m_Desc.Name);
+  W.WriteU32(typeIndices.lookup(m_pType));
+}
+
+bool CShaderReflectionVariable::LoadFromCache(
+    ReflectionCacheReader &R, CShaderReflectionConstantBuffer *pBuffer,
+    std::vector<std::unique_ptr<CShaderReflectionType>> &allTypes) {
+  if (!R.ReadStruct(m_Desc) || !R.ReadString(m_Desc.Name) ||
+      !ReadTypeIndex(R, allTypes, m_pType))
+    return false;
+  m_pBuffer = pBuffer;
+  m_pDefaultValue = nullptr;
+  return true;
+}
+
+void CShaderReflectionConstantBuffer::SaveToCache(
+    ReflectionCacheWriter &W, const ReflectionTypeIndexMap &typeIndices) const {
+  D3D12_SHADER_BUFFER_DESC Desc = m_Desc;
+  Desc.Name = nullptr;
+  W.WriteStruct(Desc);
+  W.WriteString(m_Desc.Name);
+  W.WriteU32(m_Variables.size());
+  for (const CShaderReflectionVariable &Var : m_Variables)
+    Var.SaveToCache(W, typeIndices);
+}
+
+bool CShaderReflectionConstantBuffer::LoadFromCache(
+    ReflectionCacheReader &R,
+    std::vector<std::unique_ptr<CShaderReflectionType>> &allTypes) {
+  LPCSTR pName;
+  uint32_t varCount;
+  if (!R.ReadStruct(m_Desc) || !R.ReadString(pName) || !pName ||
+      !R.ReadCount(varCount))
+    return false;
+  m_ReflectionName = pName;
+  m_Desc.Name = m_ReflectionName.c_str();
+  m_Variables.resize(varCount);
+  for (CShaderReflectionVariable &Var : m_Variables) {
+    if (!Var.LoadFromCache(R, this, allTypes))
+      return false;
+  }
+  return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // DxilShaderReflection implementation.                                      //
 
@@ -1876,6 +2337,86 @@ void DxilModuleReflection::CreateReflectionObjects() {
   }
 }
 
+void DxilModuleReflection::SaveToCache(ReflectionCacheWriter &W) const {
+  ReflectionTypeIndexMap typeIndices;
+  for (size_t i = 0; i < m_Types.size(); ++i)
+    typeIndices[m_Types[i].get()] = (uint32_t)i;
+  W.WriteU32(m_Types.size());
+  for (auto &&type : m_Types)
+    type->SaveToCache(W, typeIndices);
+
+  W.WriteU32(m_CBs.size());
+  for (auto &&cb : m_CBs)
+    cb->SaveToCache(W, typeIndices);
+  // The name maps are keyed by the buffers' own names.
+  W.WriteU32(m_CBsByName.size());
+  for (auto &&it : m_CBsByName)
+    W.WriteU32(it.second);
+  W.WriteU32(m_StructuredBufferCBsByName.size());
+  for (auto &&it : m_StructuredBufferCBsByName)
+    W.WriteU32(it.second);
+
+  W.WriteU32(m_Resources.size());
+  for (const D3D12_SHADER_INPUT_BIND_DESC &resource : m_Resources) {
+    D3D12_SHADER_INPUT_BIND_DESC Desc = resource;
+    Desc.Name = nullptr;
+    W.WriteStruct(Desc);
+    W.WriteString(resource.Name);
+  }
+  W.WriteU32(m_bUsageInMetadata);
+}
+
+bool DxilModuleReflection::LoadFromCache(ReflectionCacheReader &R) {
+  uint32_t typeCount;
+  if (!R.ReadCount(typeCount) || typeCount == 0)
+    return false;
+  // Types refer to each other by index, so all of them must exist first.
+  m_Types.resize(typeCount);
+  for (auto &&type : m_Types)
+    type.reset(new CShaderReflectionType());
+  for (auto &&type : m_Types) {
+    if (!type->LoadFromCache(R, m_Types))
+      return false;
+  }
+
+  uint32_t cbCount;
+  if (!R.ReadCount(cbCount))
+    return false;
+  m_CBs.resize(cbCount);
+  for (auto &&cb : m_CBs) {
+    cb.reset(new CShaderReflectionConstantBuffer());
+    if (!cb->LoadFromCache(R, m_Types))
+      return false;
+  }
+  for (std::map<StringRef, UINT> *pMap :
+       {&m_CBsByName, &m_StructuredBufferCBsByName}) {
+    uint32_t count;
+    if (!R.ReadCount(count))
+      return false;
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t index;
+      if (!R.ReadU32(index) || index >= m_CBs.size())
+        return false;
+      (*pMap)[m_CBs[index]->GetName()] = index;
+    }
+  }
+
+  uint32_t resourceCount;
+  if (!R.ReadCount(resourceCount))
+    return false;
+  m_Resources.resize(resourceCount);
+  for (D3D12_SHADER_INPUT_BIND_DESC &resource : m_Resources) {
+    if (!R.ReadStruct(resource) || !R.ReadString(resource.Name) ||
+        !resource.Name)
+      return false;
+  }
+  uint32_t usageInMetadata;
+  if (!R.ReadU32(usageInMetadata))
+    return false;
+  m_bUsageInMetadata = usageInMetadata != 0;
+  return true;
+}
+
 static D3D_REGISTER_COMPONENT_TYPE CompTypeToRegisterComponentType(CompType CT) {
   switch (CT.GetKind()) {
   case DXIL::ComponentType::F16:
@@ -2072,13 +2613,11 @@ HRESULT DxilModuleReflection::LoadModule(const DxilPartHeader *pShaderPart) {
     auto errorHandler = [&bBitcodeLoadError](const DiagnosticInfo &diagInfo) {
         bBitcodeLoadError |= diagInfo.getSeverity() == DS_Error;
       };
-#if 0 // We materialize eagerly, because we'll need to walk instructions to look for usage information.
+    // Function bodies stay in the bitcode until something needs them.
+    // Reflection data, counters and, from validator 1.5 on, usage all live
+    // in metadata, so most modules are never materialized.
     ErrorOr<std::unique_ptr<Module>> mod =
         getLazyBitcodeModule(std::move(pMemBuffer), Context, errorHandler);
-#else
-    ErrorOr<std::unique_ptr<Module>> mod =
-      parseBitcodeFile(pMemBuffer->getMemBufferRef(), Context, errorHandler);
-#endif
     if (!mod || bBitcodeLoadError) {
       return E_INVALIDARG;
     }
@@ -2088,6 +2627,13 @@ HRESULT DxilModuleReflection::LoadModule(const DxilPartHeader *pShaderPart) {
     unsigned ValMajor, ValMinor;
     m_pDxilModule->GetValidatorVersion(ValMajor, ValMinor);
     m_bUsageInMetadata = hlsl::DXIL::CompareVersions(ValMajor, ValMinor, 1, 5) >= 0;
+    // Older modules need instructions walked to find usage.
+    if (!m_bUsageInMetadata) {
+      if (m_pModule->materializeAllPermanently() || bBitcodeLoadError)
+        return E_INVALIDARG;
+      // The op cache was built before any dx.op call existed.
+      m_pDxilModule->GetOP()->RefreshCache();
+    }
 
     CreateReflectionObjects();
     return S_OK;
@@ -2119,6 +2665,66 @@ HRESULT DxilShaderReflection::Load(const DxilPartHeader *pModulePart,
   CATCH_CPP_RETURN_HRESULT();
 }
 
+static void SaveSignatureToCache(
+    ReflectionCacheWriter &W,
+    const std::vector<D3D12_SIGNATURE_PARAMETER_DESC> &Descs) {
+  W.WriteU32(Descs.size());
+  for (const D3D12_SIGNATURE_PARAMETER_DESC &Param : Descs) {
+    D3D12_SIGNATURE_PARAMETER_DESC Desc = Param;
+    Desc.SemanticName = nullptr;
+    W.WriteStruct(Desc);
+    W.WriteString(Param.SemanticName);
+  }
+}
+
+static bool LoadSignatureFromCache(
+    ReflectionCacheReader &R,
+    std::vector<D3D12_SIGNATURE_PARAMETER_DESC> &Descs) {
+  uint32_t count;
+  if (!R.ReadCount(count))
+    return false;
+  Descs.resize(count);
+  for (D3D12_SIGNATURE_PARAMETER_DESC &Desc : Descs) {
+    if (!R.ReadStruct(Desc) || !R.ReadString(Desc.SemanticName) ||
+        !Desc.SemanticName)
+      return false;
+  }
+  return true;
+}
+
+void DxilShaderReflection::SaveToCache(ReflectionCacheWriter &W) const {
+  W.WriteHeader(ReflectionCacheKind::Shader);
+  DxilModuleReflection::SaveToCache(W);
+  SaveSignatureToCache(W, m_InputSignature);
+  SaveSignatureToCache(W, m_OutputSignature);
+  SaveSignatureToCache(W, m_PatchConstantSignature);
+  D3D12_SHADER_DESC Desc = m_Desc;
+  Desc.Creator = nullptr;
+  W.WriteStruct(Desc);
+  W.WriteString(m_Desc.Creator);
+  W.WriteStruct(m_GSInputPrimitive);
+  W.WriteStruct(m_ThreadGroupSize);
+  W.WriteStruct(m_RequiresFlags);
+}
+
+HRESULT DxilShaderReflection::LoadFromCache(std::unique_ptr<MemoryBuffer> pEntry) {
+  try {
+    m_pCacheEntry = std::move(pEntry);
+    ReflectionCacheReader R(m_pCacheEntry->getBuffer());
+    bool bLoaded = R.ReadHeader(ReflectionCacheKind::Shader) &&
+                   DxilModuleReflection::LoadFromCache(R) &&
+                   LoadSignatureFromCache(R, m_InputSignature) &&
+                   LoadSignatureFromCache(R, m_OutputSignature) &&
+                   LoadSignatureFromCache(R, m_PatchConstantSignature) &&
+                   R.ReadStruct(m_Desc) && R.ReadString(m_Desc.Creator) &&
+                   R.ReadStruct(m_GSInputPrimitive) &&
+                   R.ReadStruct(m_ThreadGroupSize) &&
+                   R.ReadStruct(m_RequiresFlags) && R.AtEnd();
+    return bLoaded ? S_OK : DXC_E_CONTAINER_INVALID;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetDesc(D3D12_SHADER_DESC *pDesc) {
   if (nullptr == pDesc) return E_POINTER;
@@ -2306,6 +2912,21 @@ void DxilShaderReflection::InitDesc() {
   pDesc->cInterlockedInstructions = counters.atomic;
   pDesc->cTextureStoreInstructions = counters.tex_store;
 
+  if (pSM->IsGS())
+    m_GSInputPrimitive = (D3D_PRIMITIVE)M.GetInputPrimitive();
+  if (pSM->IsCS()) {
+    for (unsigned i = 0; i < 3; ++i)
+      m_ThreadGroupSize[i] = M.GetNumThreads(i);
+  }
+  m_RequiresFlags = M.m_ShaderFlags.GetFeatureInfo();
+  // FeatureInfo flags are identical, with the exception of a collision between:
+  // SHADER_FEATURE_COMPUTE_SHADERS_PLUS_RAW_AND_STRUCTURED_BUFFERS_VIA_SHADER_4_X
+  // and D3D_SHADER_REQUIRES_EARLY_DEPTH_STENCIL
+  // We keep track of the flag elsewhere, so use that instead.
+  m_RequiresFlags &= ~(UINT64)D3D_SHADER_REQUIRES_EARLY_DEPTH_STENCIL;
+  if (M.m_ShaderFlags.GetForceEarlyDepthStencil())
+    m_RequiresFlags |= D3D_SHADER_REQUIRES_EARLY_DEPTH_STENCIL;
+
   // Unset:  UINT TempRegisterCount;      // Don't know how to map this for SSA (not going to do reg allocation here)
   // Unset:  UINT DefCount;               // Not sure what to map this to
   // Unset:  UINT DclCount;               // Number of declarations (input + output)
@@ -2464,9 +3085,7 @@ UINT DxilShaderReflection::GetConversionInstructionCount() { return 0; }
 UINT DxilShaderReflection::GetBitwiseInstructionCount() { return 0; }
 
 D3D_PRIMITIVE DxilShaderReflection::GetGSInputPrimitive() {
-  if (!m_pDxilModule->GetShaderModel()->IsGS())
-    return D3D_PRIMITIVE::D3D10_PRIMITIVE_UNDEFINED;
-  return (D3D_PRIMITIVE)m_pDxilModule->GetInputPrimitive();
+  return m_GSInputPrimitive;
 }
 
 BOOL DxilShaderReflection::IsSampleFrequencyShader() {
@@ -2484,15 +3103,10 @@ HRESULT DxilShaderReflection::GetMinFeatureLevel(enum D3D_FEATURE_LEVEL* pLevel)
 
 _Use_decl_annotations_
 UINT DxilShaderReflection::GetThreadGroupSize(UINT *pSizeX, UINT *pSizeY, UINT *pSizeZ) {
-  if (!m_pDxilModule->GetShaderModel()->IsCS()) {
-    AssignToOutOpt((UINT)0, pSizeX);
-    AssignToOutOpt((UINT)0, pSizeY);
-    AssignToOutOpt((UINT)0, pSizeZ);
-    return 0;
-  }
-  unsigned x = m_pDxilModule->GetNumThreads(0);
-  unsigned y = m_pDxilModule->GetNumThreads(1);
-  unsigned z = m_pDxilModule->GetNumThreads(2);
+  // Zero unless this is a compute shader.
+  unsigned x = m_ThreadGroupSize[0];
+  unsigned y = m_ThreadGroupSize[1];
+  unsigned z = m_ThreadGroupSize[2];
   AssignToOutOpt(x, pSizeX);
   AssignToOutOpt(y, pSizeY);
   AssignToOutOpt(z, pSizeZ);
@@ -2500,15 +3114,7 @@ UINT DxilShaderReflection::GetThreadGroupSize(UINT *pSizeX, UINT *pSizeY, UINT *
 }
 
 UINT64 DxilShaderReflection::GetRequiresFlags() {
-  UINT64 result = m_pDxilModule->m_ShaderFlags.GetFeatureInfo();
-  // FeatureInfo flags are identical, with the exception of a collision between:
-  // SHADER_FEATURE_COMPUTE_SHADERS_PLUS_RAW_AND_STRUCTURED_BUFFERS_VIA_SHADER_4_X
-  // and D3D_SHADER_REQUIRES_EARLY_DEPTH_STENCIL
-  // We keep track of the flag elsewhere, so use that instead.
-  result &= ~(UINT64)D3D_SHADER_REQUIRES_EARLY_DEPTH_STENCIL;
-  if (m_pDxilModule->m_ShaderFlags.GetForceEarlyDepthStencil())
-    result |= D3D_SHADER_REQUIRES_EARLY_DEPTH_STENCIL;
-  return result;
+  return m_RequiresFlags;
 }
 
 
@@ -2520,6 +3126,7 @@ protected:
   const Function *m_pFunction;
   const DxilFunctionProps *m_pProps;  // nullptr if non-shader library function or patch constant function
   std::string m_Name;
+  UINT m_Version = 0;
   typedef SmallSetVector<UINT32, 8> ResourceUseSet;
   ResourceUseSet m_UsedResources;
   ResourceUseSet m_UsedCBs;
@@ -2537,7 +3144,49 @@ public:
     if (M.HasDxilFunctionProps(m_pFunction)) {
       m_pProps = &M.GetDxilFunctionProps(m_pFunction);
     }
+
+    const ShaderModel* pSM = M.GetShaderModel();
+    DXIL::ShaderKind kind = DXIL::ShaderKind::Library;
+    if (m_pProps) {
+      kind = m_pProps->shaderKind;
+    }
+    m_Version = EncodeVersion(kind, pSM->GetMajor(), pSM->GetMinor());
+  }
+  void SaveToCache(ReflectionCacheWriter &W) const {
+    W.WriteString(m_Name.c_str());
+    W.WriteU32(m_Version);
+    for (const ResourceUseSet *pSet : {&m_UsedResources, &m_UsedCBs}) {
+      W.WriteU32(pSet->size());
+      for (UINT32 index : *pSet)
+        W.WriteU32(index);
+    }
   }
+  // Restores a function saved by SaveToCache. It has no Function or props;
+  // only the desc and the usage sets are available.
+  bool LoadFromCache(DxilLibraryReflection *pLibraryReflection,
+                     ReflectionCacheReader &R) {
+    DXASSERT_NOMSG(pLibraryReflection);
+    m_pLibraryReflection = pLibraryReflection;
+    m_pFunction = nullptr;
+    m_pProps = nullptr;
+    LPCSTR pName;
+    if (!R.ReadString(pName) || !pName || !R.ReadU32(m_Version))
+      return false;
+    m_Name = pName;
+    for (ResourceUseSet *pSet : {&m_UsedResources, &m_UsedCBs}) {
+      uint32_t count;
+      if (!R.ReadCount(count))
+        return false;
+      for (uint32_t i = 0; i < count; ++i) {
+        uint32_t index;
+        if (!R.ReadU32(index))
+          return false;
+        pSet->insert(index);
+      }
+    }
+    return true;
+  }
+  StringRef GetName() const { return m_Name; }
   void AddResourceReference(UINT resIndex) {
     m_UsedResources.insert(resIndex);
   }
@@ -2571,12 +3220,7 @@ HRESULT CFunctionReflection::GetDesc(D3D12_FUNCTION_DESC *pDesc) {
   DXASSERT_NOMSG(m_pLibraryReflection);
   IFR(ZeroMemoryToOut(pDesc));
 
-  const ShaderModel* pSM = m_pLibraryReflection->m_pDxilModule->GetShaderModel();
-  DXIL::ShaderKind kind = DXIL::ShaderKind::Library;
-  if (m_pProps) {
-    kind = m_pProps->shaderKind;
-  }
-  pDesc->Version = EncodeVersion(kind, pSM->GetMajor(), pSM->GetMinor());
+  pDesc->Version = m_Version;
 
   //Unset:  LPCSTR                  Creator;                     // Creator string
   //Unset:  UINT                    Flags;                       // Shader compilation/parse flags
@@ -2758,6 +3402,39 @@ HRESULT DxilLibraryReflection::Load(const DxilPartHeader *pModulePart,
   CATCH_CPP_RETURN_HRESULT();
 }
 
+void DxilLibraryReflection::SaveToCache(ReflectionCacheWriter &W) const {
+  W.WriteHeader(ReflectionCacheKind::Library);
+  DxilModuleReflection::SaveToCache(W);
+  W.WriteU32(m_FunctionVector.size());
+  for (const CFunctionReflection *pFunction : m_FunctionVector)
+    pFunction->SaveToCache(W);
+}
+
+HRESULT DxilLibraryReflection::LoadFromCache(std::unique_ptr<MemoryBuffer> pEntry) {
+  try {
+    m_pCacheEntry = std::move(pEntry);
+    ReflectionCacheReader R(m_pCacheEntry->getBuffer());
+    uint32_t functionCount;
+    if (!R.ReadHeader(ReflectionCacheKind::Library) ||
+        !DxilModuleReflection::LoadFromCache(R) ||
+        !R.ReadCount(functionCount))
+      return DXC_E_CONTAINER_INVALID;
+    m_FunctionVector.reserve(functionCount);
+    for (uint32_t i = 0; i < functionCount; ++i) {
+      std::unique_ptr<CFunctionReflection> pFunction(new CFunctionReflection());
+      if (!pFunction->LoadFromCache(this, R))
+        return DXC_E_CONTAINER_INVALID;
+      auto &func = m_FunctionMap[pFunction->GetName()];
+      if (func.get())
+        return DXC_E_CONTAINER_INVALID;
+      func = std::move(pFunction);
+      m_FunctionVector.push_back(func.get());
+    }
+    return R.AtEnd() ? S_OK : DXC_E_CONTAINER_INVALID;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 _Use_decl_annotations_
 HRESULT DxilLibraryReflection::GetDesc(D3D12_LIBRARY_DESC * pDesc) {
   IFR(ZeroMemoryToOut(pDesc));
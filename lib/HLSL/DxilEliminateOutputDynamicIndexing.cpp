@@ -102,7 +102,14 @@ bool DxilEliminateOutputDynamicIndexing::EliminateDynamicOutput(
   auto &storeOutputs =
       hlslOP->GetOpFuncList(opcode);
 
-  MapVector<Value *, Type *> dynamicSigSet;
+  // Columns are independent output components, so only the columns that see a
+  // dynamically indexed store need to go through a local copy; the others keep
+  // storing to the output directly and are not copied out at every return.
+  struct DynamicSig {
+    Type *EltTy = nullptr;
+    unsigned dynamicColMask = 0;
+  };
+  MapVector<Value *, DynamicSig> dynamicSigSet;
   for (auto it : storeOutputs) {
     Function *F = it.second;
     // Skip overload not used.
@@ -114,7 +121,9 @@ bool DxilEliminateOutputDynamicIndexing::EliminateDynamicOutput(
       // Save dynamic indeed sigID.
       if (!isa<ConstantInt>(store.get_rowIndex())) {
         Value *sigID = store.get_outputSigId();
-        dynamicSigSet[sigID] = store.get_value()->getType();
+        DynamicSig &dynSig = dynamicSigSet[sigID];
+        dynSig.EltTy = store.get_value()->getType();
+        dynSig.dynamicColMask |= 1u << store.get_colIndex();
       }
     }
   }
@@ -129,15 +138,18 @@ bool DxilEliminateOutputDynamicIndexing::EliminateDynamicOutput(
 
   for (auto sig : dynamicSigSet) {
     Value *sigID = sig.first;
-    Type *EltTy = sig.second;
+    Type *EltTy = sig.second.EltTy;
+    unsigned dynamicColMask = sig.second.dynamicColMask;
     unsigned ID = cast<ConstantInt>(sigID)->getLimitedValue();
     DxilSignatureElement &sigElt = outputSig.GetElement(ID);
     unsigned row = sigElt.GetRows();
     unsigned col = sigElt.GetCols();
     Type *AT = ArrayType::get(EltTy, row);
 
-    std::vector<Value *> tmpSigElts(col);
+    std::vector<Value *> tmpSigElts(col, nullptr);
     for (unsigned c = 0; c < col; c++) {
+      if (!(dynamicColMask & (1u << c)))
+        continue;
       Value *newCol = AllocaBuilder.CreateAlloca(AT);
       tmpSigElts[c] = newCol;
     }
@@ -159,6 +171,9 @@ void DxilEliminateOutputDynamicIndexing::ReplaceDynamicOutput(
     if (sigID == store.get_outputSigId()) {
       uint64_t col = store.get_colIndex();
       Value *tmpSigElt = tmpSigElts[col];
+      // Column without dynamic indexing, keep storing directly.
+      if (!tmpSigElt)
+        continue;
       IRBuilder<> Builder(CI);
       Value *r = store.get_rowIndex();
       // Store to tmpSigElt.
@@ -182,6 +197,8 @@ void DxilEliminateOutputDynamicIndexing::StoreTmpSigToOutput(
       Value *zero = Builder.getInt32(0);
       for (unsigned c = 0; c<tmpSigElts.size(); c++) {
         Value *col = tmpSigElts[c];
+        if (!col)
+          continue;
         args[DXIL::OperandIndex::kStoreOutputColOpIdx] = Builder.getInt8(c);
         for (unsigned r = 0; r < row; r++) {
           Value *GEP =
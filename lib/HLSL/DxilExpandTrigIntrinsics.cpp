@@ -37,7 +37,30 @@
 // 
 // The approximation functions mostly come from [ADC]. The approximations
 // are also referenced in [HMF], but they give original credit to [ADC].
-// 
+//
+// Fast mode
+// ---------------------------------------------------------------------------
+// With the "fast" option, acos, asin and atan use lower degree polynomials,
+// and the hyperbolic functions compute a single exponential. Precise calls
+// and tan are left alone for the driver to implement. This is enabled in the
+// compiler with -opt-enable fast-trig.
+//
+// Maximum absolute error, emulating each operation in single precision, on
+// [-1, 1] for asin and acos, [-64, 64] for atan and [-9, 9] for the hyperbolic
+// functions, with maximum ULP error where the result scales with the input:
+//
+//     function   default            fast
+//     asin       6.8e-5             3.3e-4
+//     acos       6.8e-5             3.3e-4
+//     atan       1.2e-5             6.1e-4
+//     cosh       1.9e-3 (8 ulp)     2.1e-3 (9 ulp)
+//     sinh       1.8e-3 (610 ulp)   2.0e-3 (1630 ulp)
+//     tanh       1.4e-7 (609 ulp)   1.8e-7 (3680 ulp)
+//
+// The sinh and tanh ULP errors are from the cancellation near 0. The default
+// tanh is NaN once the exponentials overflow, from about |x| > 44, where the
+// fast one saturates to -1 or 1.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/DxilGenerationPass.h"
@@ -65,7 +88,12 @@ private:
 
 public:
   static char ID; // Pass identification, replacement for typeid
-  explicit DxilExpandTrigIntrinsics() : FunctionPass(ID) {}
+  explicit DxilExpandTrigIntrinsics(bool Fast = false)
+      : FunctionPass(ID), m_bFast(Fast) {}
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionBool(O, "fast", &m_bFast, false);
+  }
 
   const char *getPassName() const override {
     return "DXIL expand trig intrinsics";
@@ -90,6 +118,9 @@ private:
   Value *expandHSin(IRBuilder<> &builder, DxilInst_Hsin hsin, DxilModule &DM);
   Value *expandHTan(IRBuilder<> &builder, DxilInst_Htan htan, DxilModule &DM);
   Value *expandTan(IRBuilder<> &builder, DxilInst_Tan tan, DxilModule &DM);
+
+  // Use the cheaper approximations of fast mode.
+  bool m_bFast;
 };
 
 // Math constants.
@@ -130,9 +161,15 @@ CallInst *DxilExpandTrigIntrinsics::isExpandableTrigIntrinsicCall(Instruction *I
 
 DxilExpandTrigIntrinsics::IntrinsicList DxilExpandTrigIntrinsics::findTrigFunctionsToExpand(Function &F) {
   IntrinsicList worklist;
+  DxilModule &DM = F.getParent()->GetOrCreateDxilModule();
   for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
-    if (CallInst *call = isExpandableTrigIntrinsicCall(&*I))
+    if (CallInst *call = isExpandableTrigIntrinsicCall(&*I)) {
+      // Fast mode only replaces what it can make cheaper and imprecise.
+      if (m_bFast && (DM.IsPrecise(call) ||
+                      OP::GetDxilOpFuncCallInst(call) == OP::OpCode::Tan))
+        continue;
       worklist.push_back(call);
+    }
 
   return worklist;
 }
@@ -220,8 +257,28 @@ static Value *emitSqrt(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name)
 //         = a0 + x(a1 + a2x + a3x^2)
 //         = a0 + x(a1 + x(a2 + a3x))
 //
-static Value *emitSqrt1mXtimesPsiX(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name) {
+// In fast mode psi*(X) has degree 2 instead
+//
+// psi*(x) = b0 + x(b1 + b2x)
+//
+static Value *emitSqrt1mXtimesPsiX(IRBuilder<> &builder, Value *X, OP *dxOp, bool fast, StringRef name) {
   Value *One = ConstantFP::get(X->getType(), 1.0);
+  if (fast) {
+    Value *b0 = ConstantFP::get(X->getType(),  1.5704703);
+    Value *b1 = ConstantFP::get(X->getType(), -0.2054976);
+    Value *b2 = ConstantFP::get(X->getType(),  0.0513896);
+
+    Value *r1 = builder.CreateFSub(One, X, name);
+    Value *r2 = emitSqrt(builder, r1, dxOp, name);
+
+    Value *r3 = builder.CreateFMul(X,  b2, name);
+           r3 = builder.CreateFAdd(r3, b1, name);
+           r3 = builder.CreateFMul(X,  r3, name);
+           r3 = builder.CreateFAdd(r3, b0, name);
+
+    return builder.CreateFMul(r2, r3, name);
+  }
+
   Value *a0 = ConstantFP::get(X->getType(),  1.5707288);
   Value *a1 = ConstantFP::get(X->getType(), -0.2121144);
   Value *a2 = ConstantFP::get(X->getType(),  0.0742610);
@@ -266,6 +323,18 @@ static std::pair<Value *, Value *> emitExEmx(IRBuilder<> &builder, Value *X, OP
   return std::make_pair(r1, r3);
 }
 
+// Helper
+// return e^(scale * X)
+//
+// Fast mode computes this single exponential where emitExEmx computes two.
+//
+static Value *emitEScaledX(IRBuilder<> &builder, Value *X, double scale, OP *dxOp, StringRef name) {
+  Value *Log2e = ConstantFP::get(X->getType(), scale * math::LOG2E);
+
+  Value *r0 = builder.CreateFMul(X, Log2e, name);
+  return emitUnaryFloat(builder, r0, dxOp, OP::OpCode::Exp, name);
+}
+
 // Asin
 // ----------------------------------------------------------------------------
 // Function
@@ -294,6 +363,11 @@ static std::pair<Value *, Value *> emitExEmx(IRBuilder<> &builder, Value *X, OP
 //
 // In [HMF] the authors claim an error, e, of |e| <= 5e-5, but the error graph
 // in [ADC] looks like the error can be larger that that for some inputs.
+//
+// Fast mode uses a minimax fit of degree 2 instead
+//      b0 =  1.5704703
+//      b1 = -0.2054976
+//      b2 =  0.0513896
 // 
 Value *DxilExpandTrigIntrinsics::expandASin(IRBuilder<> &builder, DxilInst_Asin asin, DxilModule &DM) {
   assert(asin);
@@ -306,7 +380,7 @@ Value *DxilExpandTrigIntrinsics::expandASin(IRBuilder<> &builder, DxilInst_Asin
   Value *absX = emitFAbs(builder, X, DM.GetOP(), name);
 
   // Approximation
-  Value *psiX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), name);
+  Value *psiX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), m_bFast, name);
   Value *asinX = builder.CreateFSub(PI_2, psiX, name);
   Value *asinmX = builder.CreateFSub(Zero, asinX, name);
 
@@ -350,7 +424,7 @@ Value *DxilExpandTrigIntrinsics::expandACos(IRBuilder<> &builder, DxilInst_Acos
   Value *absX = emitFAbs(builder, X, DM.GetOP(), name);
 
   // Approximation
-  Value *acosX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), name);
+  Value *acosX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), m_bFast, name);
   Value *acosmX = builder.CreateFSub(PI, acosX, name);
 
   // Range expansion to [-1, 1]
@@ -400,6 +474,12 @@ Value *DxilExpandTrigIntrinsics::expandACos(IRBuilder<> &builder, DxilInst_Acos
 // To expand the range we check if x > 1 then subtracted the computed value from
 // pi/2 and if x is negative then negate the final value.
 //
+// Fast mode uses a minimax fit with three terms instead
+//    arctan*(x) = x(d1 + x^2(d3 + d5x^2))
+//      d1 =  0.9953579
+//      d3 = -0.2886900
+//      d5 =  0.0793388
+//
 Value *DxilExpandTrigIntrinsics::expandATan(IRBuilder<> &builder, DxilInst_Atan atan, DxilModule &DM) {
   assert(atan);
   StringRef name  = "atan.x";
@@ -423,15 +503,26 @@ Value *DxilExpandTrigIntrinsics::expandATan(IRBuilder<> &builder, DxilInst_Atan
 
   // Approximate
   Value *r3 = builder.CreateFMul(r2, r2, name);
-  Value *r4 = builder.CreateFMul(r3, c9, name);
-         r4 = builder.CreateFAdd(r4, c7, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c5, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c3, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c1, name);
-         r4 = builder.CreateFMul(r2, r4, name);
+  Value *r4;
+  if (m_bFast) {
+    Value *d1 = ConstantFP::get(X->getType(),  0.9953579);
+    Value *d3 = ConstantFP::get(X->getType(), -0.2886900);
+    Value *d5 = ConstantFP::get(X->getType(),  0.0793388);
+    r4 = builder.CreateFMul(r3, d5, name);
+    r4 = builder.CreateFAdd(r4, d3, name);
+    r4 = builder.CreateFMul(r4, r3, name);
+    r4 = builder.CreateFAdd(r4, d1, name);
+  } else {
+    r4 = builder.CreateFMul(r3, c9, name);
+    r4 = builder.CreateFAdd(r4, c7, name);
+    r4 = builder.CreateFMul(r4, r3, name);
+    r4 = builder.CreateFAdd(r4, c5, name);
+    r4 = builder.CreateFMul(r4, r3, name);
+    r4 = builder.CreateFAdd(r4, c3, name);
+    r4 = builder.CreateFMul(r4, r3, name);
+    r4 = builder.CreateFAdd(r4, c1, name);
+  }
+  r4 = builder.CreateFMul(r2, r4, name);
 
   // Range Expansion to [0, inf]
   Value *r5 = builder.CreateFSub(PI_2, r4, name);
@@ -453,6 +544,8 @@ Value *DxilExpandTrigIntrinsics::expandATan(IRBuilder<> &builder, DxilInst_Atan
 // 
 // No range reduction is needed.
 //
+// Fast mode computes e^-x as 1 / e^x.
+//
 Value *DxilExpandTrigIntrinsics::expandHCos(IRBuilder<> &builder, DxilInst_Hcos hcos, DxilModule &DM) {
   assert(hcos);
   StringRef name = "hcos.x";
@@ -460,6 +553,15 @@ Value *DxilExpandTrigIntrinsics::expandHCos(IRBuilder<> &builder, DxilInst_Hcos
   Value *X = hcos.get_value();
   Value *Two = ConstantFP::get(X->getType(), 2.0);
 
+  if (m_bFast) {
+    Value *One  = ConstantFP::get(X->getType(), 1.0);
+    Value *Half = ConstantFP::get(X->getType(), 0.5);
+    eX = emitEScaledX(builder, X, 1.0, DM.GetOP(), name);
+    emX = builder.CreateFDiv(One, eX, name);
+    Value *r4 = builder.CreateFAdd(eX, emX, name);
+    return builder.CreateFMul(r4, Half, name);
+  }
+
   std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
   Value *r4 = builder.CreateFAdd(eX, emX, name);
   Value *r  = builder.CreateFDiv(r4, Two, name);
@@ -475,6 +577,8 @@ Value *DxilExpandTrigIntrinsics::expandHCos(IRBuilder<> &builder, DxilInst_Hcos
 //
 // No range reduction is needed.
 //
+// Fast mode computes e^-x as 1 / e^x.
+//
 Value *DxilExpandTrigIntrinsics::expandHSin(IRBuilder<> &builder, DxilInst_Hsin hsin, DxilModule &DM) {
   assert(hsin);
   StringRef name = "hsin.x";
@@ -482,6 +586,15 @@ Value *DxilExpandTrigIntrinsics::expandHSin(IRBuilder<> &builder, DxilInst_Hsin
   Value *X = hsin.get_value();
   Value *Two = ConstantFP::get(X->getType(), 2.0);
 
+  if (m_bFast) {
+    Value *One  = ConstantFP::get(X->getType(), 1.0);
+    Value *Half = ConstantFP::get(X->getType(), 0.5);
+    eX = emitEScaledX(builder, X, 1.0, DM.GetOP(), name);
+    emX = builder.CreateFDiv(One, eX, name);
+    Value *r4 = builder.CreateFSub(eX, emX, name);
+    return builder.CreateFMul(r4, Half, name);
+  }
+
   std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
   Value *r4 = builder.CreateFSub(eX, emX, name);
   Value *r  = builder.CreateFDiv(r4, Two, name);
@@ -497,12 +610,27 @@ Value *DxilExpandTrigIntrinsics::expandHSin(IRBuilder<> &builder, DxilInst_Hsin
 //
 // No range reduction is needed.
 //
+// Fast mode uses the identity
+//
+//    tanh(x) = 1 - 2 / (e^2x + 1)
+//
+// which only needs one exponential.
+//
 Value *DxilExpandTrigIntrinsics::expandHTan(IRBuilder<> &builder, DxilInst_Htan htan, DxilModule &DM) {
   assert(htan);
   StringRef name = "htan.x";
   Value *eX, *emX;
   Value *X = htan.get_value();
 
+  if (m_bFast) {
+    Value *One = ConstantFP::get(X->getType(), 1.0);
+    Value *Two = ConstantFP::get(X->getType(), 2.0);
+    Value *e2X = emitEScaledX(builder, X, 2.0, DM.GetOP(), name);
+    Value *r1 = builder.CreateFAdd(e2X, One, name);
+    Value *r2 = builder.CreateFDiv(Two, r1, name);
+    return builder.CreateFSub(One, r2, name);
+  }
+
   std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
   Value *r4 = builder.CreateFSub(eX, emX, name);
   Value *r5 = builder.CreateFAdd(eX, emX, name);
@@ -534,8 +662,8 @@ Value *DxilExpandTrigIntrinsics::expandTan(IRBuilder<> &builder,
 
 char DxilExpandTrigIntrinsics::ID = 0;
 
-FunctionPass *llvm::createDxilExpandTrigIntrinsicsPass() {
-  return new DxilExpandTrigIntrinsics();
+FunctionPass *llvm::createDxilExpandTrigIntrinsicsPass(bool Fast) {
+  return new DxilExpandTrigIntrinsics(Fast);
 }
 
 INITIALIZE_PASS(DxilExpandTrigIntrinsics,
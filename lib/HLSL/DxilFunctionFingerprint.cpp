@@ -0,0 +1,692 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilFunctionFingerprint.cpp                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Per-function fingerprints for incremental library compiles.               //
+//                                                                           //
+// Each global value is described once as text and hashed. A function's      //
+// fingerprint then combines the hashes of everything reachable from it, so  //
+// an edit to a callee or to a resource binding changes the fingerprints of  //
+// all the functions that depend on it, and nothing else.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilFunctionFingerprint.h"
+#include "dxc/DXIL/DxilCBuffer.h"
+#include "dxc/DXIL/DxilFunctionProps.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilResource.h"
+#include "dxc/DXIL/DxilSampler.h"
+#include "dxc/DXIL/DxilSubobject.h"
+#include "dxc/DXIL/DxilTypeSystem.h"
+#include "dxc/HLSL/DxilExportMap.h"
+#include "dxc/HLSL/DxilLinker.h"
+#include "dxc/HLSL/HLModule.h"
+#include "dxc/HLSL/HLResource.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Saved fingerprints start with 'DXFP' and a format version.
+const uint32_t kFingerprintMagic = 0x50465844;
+const uint32_t kFingerprintVersion = 1;
+
+// State shared by the descriptions of the global values of a module.
+struct DescriptionContext {
+  DescriptionContext(HLModule &HLM)
+      : M(*HLM.GetModule()), HLM(&HLM), DM(nullptr),
+        TypeSys(HLM.GetTypeSystem()),
+        MDH(HLM.GetModule(),
+            llvm::make_unique<HLExtraPropertyHelper>(HLM.GetModule())) {
+    MDH.SetShaderModel(HLM.GetShaderModel());
+    AddResources(HLM.GetCBuffers());
+    AddResources(HLM.GetSamplers());
+    AddResources(HLM.GetSRVs());
+    AddResources(HLM.GetUAVs());
+  }
+
+  DescriptionContext(DxilModule &DM)
+      : M(*DM.GetModule()), HLM(nullptr), DM(&DM),
+        TypeSys(DM.GetTypeSystem()),
+        MDH(DM.GetModule(),
+            llvm::make_unique<DxilExtraPropertyHelper>(DM.GetModule())) {
+    MDH.SetShaderModel(DM.GetShaderModel());
+    AddResources(DM.GetCBuffers());
+    AddResources(DM.GetSamplers());
+    AddResources(DM.GetSRVs());
+    AddResources(DM.GetUAVs());
+  }
+
+  template <typename T>
+  void AddResources(const std::vector<std::unique_ptr<T>> &List) {
+    for (const std::unique_ptr<T> &Res : List)
+      if (GlobalVariable *GV = dyn_cast<GlobalVariable>(Res->GetGlobalSymbol()))
+        Resources[GV] = Res.get();
+  }
+
+  DxilFunctionProps *GetFunctionProps(Function *F) {
+    if (HLM)
+      return HLM->HasDxilFunctionProps(F) ? &HLM->GetDxilFunctionProps(F)
+                                          : nullptr;
+    return DM->HasDxilFunctionProps(F) ? &DM->GetDxilFunctionProps(F)
+                                       : nullptr;
+  }
+
+  StringRef GetMDKindName(unsigned Kind) {
+    if (Kind >= MDKindNames.size())
+      M.getContext().getMDKindNames(MDKindNames);
+    return Kind < MDKindNames.size() ? MDKindNames[Kind] : StringRef();
+  }
+
+  Module &M;
+  // Exactly one of these is set.
+  HLModule *HLM;
+  DxilModule *DM;
+  DxilTypeSystem &TypeSys;
+  DxilMDHelper MDH;
+  SmallVector<StringRef, 32> MDKindNames;
+  DenseMap<const GlobalVariable *, const DxilResourceBase *> Resources;
+};
+
+// Writes a description of the parts of a global value that determine the code
+// generated from it, collecting the global values it refers to. Those are
+// referred to by name and local values are numbered in order of appearance,
+// so edits elsewhere in the module leave the description unchanged.
+class GlobalDescriber {
+public:
+  GlobalDescriber(DescriptionContext &Ctx, raw_ostream &OS,
+                  SetVector<GlobalValue *> &Refs)
+      : Ctx(Ctx), OS(OS), Refs(Refs) {}
+
+  void DescribeFunction(Function &F);
+  void DescribeGlobal(GlobalVariable &GV);
+
+private:
+  void DescribeType(Type *Ty);
+  void DescribeStructs();
+  void DescribeAttributes(AttributeSet Attrs);
+  void DescribeValue(const Value *V);
+  void DescribeConstant(const Constant *C);
+  void DescribeMetadata(const Metadata *MD);
+  void DescribeInstruction(const Instruction &I);
+  void DescribeResource(const DxilResourceBase &Res);
+
+  DescriptionContext &Ctx;
+  raw_ostream &OS;
+  SetVector<GlobalValue *> &Refs;
+  DenseMap<const Value *, unsigned> Slots;
+  DenseMap<const MDNode *, unsigned> Nodes;
+  SetVector<StructType *> Structs;
+};
+
+void GlobalDescriber::DescribeFunction(Function &F) {
+  OS << "function " << F.getName() << ' ' << F.getLinkage() << ' '
+     << F.getCallingConv() << ' ';
+  DescribeType(F.getFunctionType());
+  DescribeAttributes(F.getAttributes());
+  if (DxilFunctionProps *Props = Ctx.GetFunctionProps(&F)) {
+    OS << " props ";
+    DescribeMetadata(Ctx.MDH.EmitDxilFunctionProps(Props, &F));
+  }
+  if (DxilFunctionAnnotation *FA = Ctx.TypeSys.GetFunctionAnnotation(&F)) {
+    OS << " annotation ";
+    DescribeMetadata(Ctx.MDH.EmitDxilFunctionAnnotation(*FA));
+  }
+  OS << '\n';
+
+  // Number everything first; phis may refer to values defined later.
+  unsigned Slot = 0;
+  for (Argument &A : F.args())
+    Slots[&A] = Slot++;
+  for (BasicBlock &BB : F) {
+    Slots[&BB] = Slot++;
+    for (Instruction &I : BB)
+      Slots[&I] = Slot++;
+  }
+
+  for (BasicBlock &BB : F) {
+    OS << "block\n";
+    for (Instruction &I : BB) {
+      // Debug info does not change the code.
+      if (!isa<DbgInfoIntrinsic>(&I))
+        DescribeInstruction(I);
+    }
+  }
+  DescribeStructs();
+}
+
+void GlobalDescriber::DescribeGlobal(GlobalVariable &GV) {
+  OS << "global " << GV.getName() << ' ' << GV.getLinkage() << ' '
+     << GV.isConstant() << ' ' << GV.getThreadLocalMode() << ' '
+     << GV.getType()->getAddressSpace() << ' ' << GV.isExternallyInitialized()
+     << ' ' << GV.getAlignment() << ' ';
+  DescribeType(GV.getType()->getElementType());
+  if (GV.hasInitializer()) {
+    OS << " = ";
+    DescribeConstant(GV.getInitializer());
+  }
+  auto It = Ctx.Resources.find(&GV);
+  if (It != Ctx.Resources.end())
+    DescribeResource(*It->second);
+  OS << '\n';
+  DescribeStructs();
+}
+
+void GlobalDescriber::DescribeType(Type *Ty) {
+  Ty->print(OS);
+  // Named structs print as their name; their bodies are described once at
+  // the end.
+  SmallVector<Type *, 8> Worklist(1, Ty);
+  while (!Worklist.empty()) {
+    Type *T = Worklist.pop_back_val();
+    if (StructType *ST = dyn_cast<StructType>(T))
+      if (!ST->isLiteral() && !Structs.insert(ST))
+        continue;
+    Worklist.append(T->subtype_begin(), T->subtype_end());
+  }
+}
+
+void GlobalDescriber::DescribeStructs() {
+  DxilTypeSystem &TypeSys = Ctx.TypeSys;
+  // Annotations may refer to further structs, which are appended as we go.
+  for (unsigned i = 0; i < Structs.size(); ++i) {
+    StructType *ST = Structs[i];
+    OS << "struct " << ST->getName();
+    if (ST->isOpaque()) {
+      OS << " opaque\n";
+      continue;
+    }
+    OS << (ST->isPacked() ? " packed {" : " {");
+    for (Type *ElTy : ST->elements()) {
+      ElTy->print(OS);
+      OS << ',';
+    }
+    OS << '}';
+    if (const DxilStructAnnotation *SA = TypeSys.GetStructAnnotation(ST)) {
+      OS << " annotation ";
+      DescribeMetadata(Ctx.MDH.EmitDxilStructAnnotation(*SA));
+    }
+    if (const DxilPayloadAnnotation *PA = TypeSys.GetPayloadAnnotation(ST)) {
+      OS << " payload ";
+      DescribeMetadata(Ctx.MDH.EmitDxrPayloadStructAnnotation(*PA));
+    }
+    OS << '\n';
+  }
+}
+
+void GlobalDescriber::DescribeAttributes(AttributeSet Attrs) {
+  for (unsigned i = 0, e = Attrs.getNumSlots(); i != e; ++i) {
+    unsigned Index = Attrs.getSlotIndex(i);
+    OS << " attrs " << Index << '{' << Attrs.getAsString(Index) << '}';
+  }
+}
+
+void GlobalDescriber::DescribeValue(const Value *V) {
+  auto It = Slots.find(V);
+  if (It != Slots.end())
+    OS << '%' << It->second;
+  else if (const Constant *C = dyn_cast<Constant>(V))
+    DescribeConstant(C);
+  else if (const MetadataAsValue *MAV = dyn_cast<MetadataAsValue>(V))
+    DescribeMetadata(MAV->getMetadata());
+  else if (isa<InlineAsm>(V))
+    V->print(OS);
+  else
+    OS << '?';
+}
+
+void GlobalDescriber::DescribeConstant(const Constant *C) {
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+    OS << '@' << GV->getName();
+    Refs.insert(const_cast<GlobalValue *>(GV));
+    return;
+  }
+  OS << '(' << C->getValueID() << ' ';
+  DescribeType(C->getType());
+  if (const ConstantInt *CI = dyn_cast<ConstantInt>(C)) {
+    OS << ' ' << CI->getValue();
+  } else if (const ConstantFP *CFP = dyn_cast<ConstantFP>(C)) {
+    OS << ' ' << CFP->getValueAPF().bitcastToAPInt();
+  } else if (const ConstantDataSequential *CDS =
+                 dyn_cast<ConstantDataSequential>(C)) {
+    StringRef Data = CDS->getRawDataValues();
+    OS << ' ' << Data.size() << ':';
+    OS.write(Data.data(), Data.size());
+  } else if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(C)) {
+    OS << ' ' << CE->getOpcodeName() << ' '
+       << (unsigned)CE->getRawSubclassOptionalData();
+    if (CE->isCompare())
+      OS << " pred " << CE->getPredicate();
+    if (CE->hasIndices())
+      for (unsigned Idx : CE->getIndices())
+        OS << ' ' << Idx;
+  }
+  for (const Use &Op : C->operands()) {
+    OS << ' ';
+    DescribeValue(Op.get());
+  }
+  OS << ')';
+}
+
+void GlobalDescriber::DescribeMetadata(const Metadata *MD) {
+  if (!MD) {
+    OS << "null";
+    return;
+  }
+  if (const MDString *S = dyn_cast<MDString>(MD)) {
+    OS << '"' << S->getString().size() << ':' << S->getString();
+    return;
+  }
+  if (const ValueAsMetadata *VAM = dyn_cast<ValueAsMetadata>(MD)) {
+    DescribeValue(VAM->getValue());
+    return;
+  }
+  const MDNode *N = cast<MDNode>(MD);
+  auto Inserted = Nodes.insert(std::make_pair(N, Nodes.size()));
+  OS << '!' << Inserted.first->second;
+  if (!Inserted.second)
+    return;
+  OS << (N->isDistinct() ? "distinct{" : "{");
+  for (const MDOperand &Op : N->operands()) {
+    DescribeMetadata(Op.get());
+    OS << ',';
+  }
+  OS << '}';
+}
+
+void GlobalDescriber::DescribeInstruction(const Instruction &I) {
+  OS << I.getOpcodeName() << ' ' << (unsigned)I.getRawSubclassOptionalData()
+     << ' ';
+  DescribeType(I.getType());
+  for (const Use &Op : I.operands()) {
+    OS << ' ';
+    DescribeValue(Op.get());
+  }
+
+  // Instruction state that is not held in operands.
+  if (const CmpInst *Cmp = dyn_cast<CmpInst>(&I)) {
+    OS << " pred " << Cmp->getPredicate();
+  } else if (const AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+    OS << " align " << AI->getAlignment();
+  } else if (const LoadInst *LI = dyn_cast<LoadInst>(&I)) {
+    OS << " align " << LI->getAlignment() << ' ' << LI->isVolatile() << ' '
+       << (unsigned)LI->getOrdering() << ' ' << (unsigned)LI->getSynchScope();
+  } else if (const StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+    OS << " align " << SI->getAlignment() << ' ' << SI->isVolatile() << ' '
+       << (unsigned)SI->getOrdering() << ' ' << (unsigned)SI->getSynchScope();
+  } else if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+    OS << " cc " << CI->getCallingConv() << ' ' << CI->isTailCall();
+    DescribeAttributes(CI->getAttributes());
+  } else if (const PHINode *PN = dyn_cast<PHINode>(&I)) {
+    for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i) {
+      OS << " from ";
+      DescribeValue(PN->getIncomingBlock(i));
+    }
+  } else if (const ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(&I)) {
+    for (unsigned Idx : EVI->indices())
+      OS << ' ' << Idx;
+  } else if (const InsertValueInst *IVI = dyn_cast<InsertValueInst>(&I)) {
+    for (unsigned Idx : IVI->indices())
+      OS << ' ' << Idx;
+  } else if (const AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(&I)) {
+    OS << " op " << (unsigned)RMW->getOperation() << ' ' << RMW->isVolatile()
+       << ' ' << (unsigned)RMW->getOrdering();
+  } else if (const AtomicCmpXchgInst *CX = dyn_cast<AtomicCmpXchgInst>(&I)) {
+    OS << ' ' << CX->isVolatile() << ' ' << CX->isWeak() << ' '
+       << (unsigned)CX->getSuccessOrdering() << ' '
+       << (unsigned)CX->getFailureOrdering();
+  }
+
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  I.getAllMetadataOtherThanDebugLoc(MDs);
+  for (auto &MD : MDs) {
+    OS << " !" << Ctx.GetMDKindName(MD.first) << ' ';
+    DescribeMetadata(MD.second);
+  }
+  OS << '\n';
+}
+
+void GlobalDescriber::DescribeResource(const DxilResourceBase &Res) {
+  // Everything but the ID, which depends on the other resources.
+  OS << " resource " << (unsigned)Res.GetClass() << ' '
+     << (unsigned)Res.GetKind() << ' ' << Res.GetSpaceID() << ' '
+     << Res.GetLowerBound() << ' ' << Res.GetRangeSize();
+  switch (Res.GetClass()) {
+  case DXIL::ResourceClass::SRV:
+  case DXIL::ResourceClass::UAV: {
+    const DxilResource &R = static_cast<const DxilResource &>(Res);
+    OS << ' ' << (unsigned)R.GetCompType().GetKind() << ' '
+       << R.GetSampleCount() << ' ' << R.GetElementStride() << ' '
+       << R.IsGloballyCoherent() << R.HasCounter() << R.IsROV() << ' '
+       << (unsigned)R.GetSamplerFeedbackType();
+    break;
+  }
+  case DXIL::ResourceClass::CBuffer:
+    OS << ' ' << static_cast<const DxilCBuffer &>(Res).GetSize();
+    break;
+  case DXIL::ResourceClass::Sampler:
+    OS << ' ' << (unsigned)static_cast<const DxilSampler &>(Res).GetSamplerKind();
+    break;
+  default:
+    break;
+  }
+}
+
+// The description hash of a global value and the global values it refers to.
+struct GlobalDigest {
+  DxilFunctionFingerprints::Digest Digest;
+  std::vector<GlobalValue *> Refs;
+};
+
+void FinalDigest(MD5 &Hash, DxilFunctionFingerprints::Digest &Digest) {
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  std::copy(std::begin(Result), std::end(Result), Digest.begin());
+}
+
+// Adds to Hash the descriptions of everything reachable from Root, in an
+// order that does not depend on the order of the module.
+void HashReachable(GlobalValue *Root,
+                   DenseMap<const GlobalValue *, GlobalDigest> &Digests,
+                   MD5 &Hash) {
+  std::vector<GlobalValue *> Reachable(1, Root);
+  SmallPtrSet<GlobalValue *, 32> Visited;
+  Visited.insert(Root);
+  for (size_t i = 0; i < Reachable.size(); ++i)
+    for (GlobalValue *Ref : Digests[Reachable[i]].Refs)
+      if (Visited.insert(Ref).second)
+        Reachable.push_back(Ref);
+  std::stable_sort(Reachable.begin(), Reachable.end(),
+                   [](const GlobalValue *A, const GlobalValue *B) {
+                     return A->getName() < B->getName();
+                   });
+  for (GlobalValue *GV : Reachable) {
+    const DxilFunctionFingerprints::Digest &Digest = Digests[GV].Digest;
+    Hash.update(utostr(GV->getName().size()));
+    Hash.update(GV->getName());
+    Hash.update(ArrayRef<uint8_t>(Digest.data(), Digest.size()));
+  }
+}
+
+template <typename T> void WriteValue(raw_ostream &OS, const T &Value) {
+  OS.write(reinterpret_cast<const char *>(&Value), sizeof(Value));
+}
+
+template <typename T> bool ReadValue(StringRef &Data, T &Value) {
+  if (Data.size() < sizeof(Value))
+    return false;
+  memcpy(&Value, Data.data(), sizeof(Value));
+  Data = Data.drop_front(sizeof(Value));
+  return true;
+}
+
+} // namespace
+
+// Describes and hashes every global value of the module.
+static void DescribeGlobals(DescriptionContext &Ctx,
+                            DenseMap<const GlobalValue *, GlobalDigest> &Digests) {
+  auto DescribeAndHash = [&](GlobalValue &GV) {
+    std::string Text;
+    raw_string_ostream OS(Text);
+    SetVector<GlobalValue *> Refs;
+    GlobalDescriber Describer(Ctx, OS, Refs);
+    if (Function *F = dyn_cast<Function>(&GV))
+      Describer.DescribeFunction(*F);
+    else if (GlobalVariable *G = dyn_cast<GlobalVariable>(&GV))
+      Describer.DescribeGlobal(*G);
+    else
+      OS << "alias " << GV.getName();
+    OS.flush();
+    GlobalDigest &Digest = Digests[&GV];
+    MD5 Hash;
+    Hash.update(Text);
+    FinalDigest(Hash, Digest.Digest);
+    Digest.Refs.assign(Refs.begin(), Refs.end());
+  };
+  for (Function &F : Ctx.M.functions())
+    DescribeAndHash(F);
+  for (GlobalVariable &GV : Ctx.M.globals())
+    DescribeAndHash(GV);
+  for (GlobalAlias &GA : Ctx.M.aliases())
+    DescribeAndHash(GA);
+}
+
+// Combines the module state in ModuleText with what each function defined in
+// M reaches into its digest.
+static void DigestFunctions(Module &M, StringRef ModuleText,
+                            DenseMap<const GlobalValue *, GlobalDigest> &Digests,
+                            bool IncludeLocal,
+                            DxilFunctionFingerprints::DigestMap &Result) {
+  MD5 ModuleHash;
+  ModuleHash.update(ModuleText);
+  // Static initializers run before every entry.
+  if (GlobalVariable *Ctors = M.getGlobalVariable("llvm.global_ctors"))
+    HashReachable(Ctors, Digests, ModuleHash);
+  DxilFunctionFingerprints::Digest ModuleDigest;
+  FinalDigest(ModuleHash, ModuleDigest);
+
+  Result.clear();
+  for (Function &F : M.functions()) {
+    if (F.isDeclaration() || (F.hasLocalLinkage() && !IncludeLocal))
+      continue;
+    MD5 Hash;
+    Hash.update(ArrayRef<uint8_t>(ModuleDigest.data(), ModuleDigest.size()));
+    HashReachable(&F, Digests, Hash);
+    FinalDigest(Hash, Result[F.getName()]);
+  }
+}
+
+void DxilFunctionFingerprints::Compute(HLModule &HLM, StringRef Context) {
+  DescriptionContext Ctx(HLM);
+  DenseMap<const GlobalValue *, GlobalDigest> Digests;
+  DescribeGlobals(Ctx, Digests);
+
+  // State that applies to every function of the module.
+  std::string Text;
+  raw_string_ostream OS(Text);
+  unsigned ValMajor, ValMinor;
+  HLM.GetValidatorVersion(ValMajor, ValMinor);
+  OS << Context << '\n'
+     << HLM.GetShaderModel()->GetName() << ' ' << ValMajor << '.' << ValMinor
+     << ' ' << HLM.GetHLOptions().GetHLOptionsRaw() << ' '
+     << HLM.GetAutoBindingSpace() << ' '
+     << (unsigned)HLM.GetFloat32DenormMode() << ' '
+     << (unsigned)HLM.GetDefaultLinkage() << '\n';
+  OS.flush();
+  DigestFunctions(*HLM.GetModule(), Text, Digests, /*IncludeLocal*/ false,
+                  m_Digests);
+}
+
+void DxilFunctionFingerprints::Compute(DxilModule &DM, StringRef Context) {
+  DescriptionContext Ctx(DM);
+  DenseMap<const GlobalValue *, GlobalDigest> Digests;
+  DescribeGlobals(Ctx, Digests);
+
+  std::string Text;
+  raw_string_ostream OS(Text);
+  unsigned DxilMajor, DxilMinor, ValMajor, ValMinor;
+  DM.GetDxilVersion(DxilMajor, DxilMinor);
+  DM.GetValidatorVersion(ValMajor, ValMinor);
+  OS << Context << '\n'
+     << DM.GetShaderModel()->GetName() << ' ' << DxilMajor << '.' << DxilMinor
+     << ' ' << ValMajor << '.' << ValMinor << ' ' << DM.GetGlobalFlags() << ' '
+     << DM.GetUseMinPrecision() << '\n';
+  OS.flush();
+  DigestFunctions(*DM.GetModule(), Text, Digests, /*IncludeLocal*/ true,
+                  m_Digests);
+}
+
+void DxilFunctionFingerprints::Save(raw_ostream &OS) const {
+  WriteValue(OS, kFingerprintMagic);
+  WriteValue(OS, kFingerprintVersion);
+  WriteValue(OS, (uint32_t)m_Digests.size());
+  for (auto &Entry : m_Digests) {
+    WriteValue(OS, (uint32_t)Entry.first.size());
+    OS << Entry.first;
+    OS.write(reinterpret_cast<const char *>(Entry.second.data()),
+             Entry.second.size());
+  }
+}
+
+bool DxilFunctionFingerprints::Load(StringRef Data) {
+  m_Digests.clear();
+  uint32_t Magic, Version, Count;
+  if (!ReadValue(Data, Magic) || Magic != kFingerprintMagic ||
+      !ReadValue(Data, Version) || Version != kFingerprintVersion ||
+      !ReadValue(Data, Count))
+    return false;
+  for (uint32_t i = 0; i < Count; ++i) {
+    uint32_t NameSize;
+    Digest Digest;
+    if (!ReadValue(Data, NameSize) || Data.size() < NameSize + Digest.size())
+      return false;
+    std::string Name = Data.substr(0, NameSize);
+    Data = Data.drop_front(NameSize);
+    memcpy(Digest.data(), Data.data(), Digest.size());
+    Data = Data.drop_front(Digest.size());
+    m_Digests[Name] = Digest;
+  }
+  return Data.empty();
+}
+
+void DxilIncrementalLib::Run(HLModule &HLM) {
+  Current.Compute(HLM, Context);
+  Reused.clear();
+  if (!Previous)
+    return;
+
+  const DxilFunctionFingerprints::DigestMap &Old = Previous->GetDigests();
+  const DxilFunctionFingerprints::DigestMap &New = Current.GetDigests();
+  std::vector<Function *> Reusable;
+  for (Function &F : HLM.GetModule()->functions()) {
+    if (F.isDeclaration() || F.hasLocalLinkage() ||
+        HLM.IsPatchConstantShader(&F))
+      continue;
+    auto OldIt = Old.find(F.getName());
+    auto NewIt = New.find(F.getName());
+    if (OldIt != Old.end() && NewIt != New.end() &&
+        OldIt->second == NewIt->second)
+      Reusable.push_back(&F);
+  }
+
+  // Remove the reusable functions nothing calls. Removing one can leave the
+  // functions it called unused, so repeat until nothing changes.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (Function *&F : Reusable) {
+      if (!F)
+        continue;
+      F->removeDeadConstantUsers();
+      if (!F->use_empty())
+        continue;
+      Reused.push_back(F->getName());
+      HLM.RemoveFunction(F);
+      F->eraseFromParent();
+      F = nullptr;
+      Changed = true;
+    }
+  }
+
+  // The rest are inlined into the functions being recompiled, and the
+  // previous library supplies the exported copy.
+  for (Function *F : Reusable) {
+    if (!F || HLM.HasDxilFunctionProps(F))
+      continue;
+    Reused.push_back(F->getName());
+    F->setLinkage(GlobalValue::InternalLinkage);
+  }
+}
+
+std::unique_ptr<Module>
+hlsl::LinkReusedFunctions(std::unique_ptr<Module> Recompiled,
+                          std::unique_ptr<Module> Previous,
+                          const std::vector<std::string> &Reused,
+                          const std::string &Profile) {
+  LLVMContext &Ctx = Recompiled->getContext();
+  if (std::error_code EC = Previous->materializeAll()) {
+    Ctx.emitError(Twine("Cannot load the previous library: ") + EC.message());
+    return nullptr;
+  }
+
+  // Keep only the reused functions of the previous library; the recompiled
+  // one defines the rest.
+  std::set<StringRef> Keep(Reused.begin(), Reused.end());
+  DxilModule &PrevDM = Previous->GetOrCreateDxilModule();
+  std::vector<Function *> Dropped;
+  for (Function &F : Previous->functions()) {
+    if (F.isDeclaration() || F.hasLocalLinkage() || Keep.count(F.getName()))
+      continue;
+    PrevDM.RemoveFunction(&F);
+    F.deleteBody();
+    Dropped.push_back(&F);
+  }
+  // Then erase what is left unused, including internal helpers only the
+  // dropped functions called.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (auto It = Previous->begin(), End = Previous->end(); It != End;) {
+      Function *F = It++;
+      bool IsDropped =
+          F->isDeclaration() &&
+          std::find(Dropped.begin(), Dropped.end(), F) != Dropped.end();
+      if (!IsDropped && !(F->hasLocalLinkage() && !F->isDeclaration()))
+        continue;
+      F->removeDeadConstantUsers();
+      if (!F->use_empty())
+        continue;
+      if (IsDropped)
+        Dropped.erase(std::find(Dropped.begin(), Dropped.end(), F));
+      PrevDM.RemoveFunction(F);
+      F->eraseFromParent();
+      Changed = true;
+    }
+  }
+
+  // The linker does not carry subobjects over; they are all declared in the
+  // recompiled source anyway.
+  DxilModule &DM = Recompiled->GetOrCreateDxilModule();
+  std::unique_ptr<DxilSubobjects> Subobjects(DM.ReleaseSubobjects());
+  unsigned ValMajor, ValMinor;
+  DM.GetValidatorVersion(ValMajor, ValMinor);
+
+  // Internal names are prefixed with the module identifier to keep them apart.
+  Recompiled->setModuleIdentifier("recompiled");
+  Previous->setModuleIdentifier("reused");
+  std::unique_ptr<DxilLinker> Linker(
+      DxilLinker::CreateLinker(Ctx, ValMajor, ValMinor));
+  if (!Linker->RegisterLib("recompiled", std::move(Recompiled), nullptr) ||
+      !Linker->RegisterLib("reused", std::move(Previous), nullptr) ||
+      !Linker->AttachLib("recompiled") || !Linker->AttachLib("reused"))
+    return nullptr;
+
+  dxilutil::ExportMap Exports;
+  std::unique_ptr<Module> Linked = Linker->Link("", Profile, Exports);
+  if (Linked)
+    Linked->GetOrCreateDxilModule().ResetSubobjects(Subobjects.release());
+  return Linked;
+}
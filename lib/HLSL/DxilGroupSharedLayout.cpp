@@ -0,0 +1,393 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilGroupSharedLayout.cpp                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Change the layout of groupshared arrays to avoid bank conflicts.          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilConstants.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Groupshared memory is split in banks of 32-bit words, and threads of a wave
+// accessing different words of one bank are serialized. Groupshared arrays
+// arrive here flattened to one dimension with their declared layout, so
+//   groupshared float4 a[64];       ... a[tid].x ...
+//   groupshared float  t[32][32];   ... t[tid][i] ...
+// access words 4 and 32 apart from one thread to the next.
+//
+// For arrays of 32-bit or smaller scalars where every index is analyzable,
+// this pass:
+//  - splits arrays only ever indexed as Base * K + c, with constant c < K,
+//    into K arrays indexed by Base (array of structs to struct of arrays);
+//  - pads arrays indexed with a row stride S that is a multiple of the number
+//    of banks with one element every S elements, so rows start on different
+//    banks.
+// Each change is reported with a note, so the effect is visible whether or not
+// the output is validated.
+
+namespace {
+
+// Number of 32-bit banks the padding heuristic assumes.
+const unsigned kNumBanks = 32;
+// Maximum number of arrays one groupshared array is split into.
+const unsigned kMaxSplitWays = 16;
+
+// Element index of a groupshared access, as Base * Stride + Offset.
+struct StridedIndex {
+  Value *Base;     // Null when the index is constant.
+  uint64_t Stride;
+  uint64_t Offset;
+  bool bConstOffset;
+};
+
+// Pointer to one element of a groupshared array.
+struct GroupSharedAccess {
+  GEPOperator *GEP;
+  StridedIndex Idx;
+};
+
+class DxilGroupSharedLayout : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilGroupSharedLayout() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL groupshared layout";
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool Split(GlobalVariable *GV, ArrayRef<GroupSharedAccess> Accesses,
+             SmallVectorImpl<GlobalVariable *> &Parts);
+  bool Pad(GlobalVariable *GV, ArrayRef<GroupSharedAccess> Accesses);
+
+  uint64_t m_TotalSize;
+};
+
+char DxilGroupSharedLayout::ID = 0;
+
+bool MatchScaled(Value *V, Value *&Base, uint64_t &Stride) {
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  if (!BO)
+    return false;
+  ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(1));
+  Base = BO->getOperand(0);
+  if (BO->getOpcode() == Instruction::Mul) {
+    if (!C) {
+      C = dyn_cast<ConstantInt>(BO->getOperand(0));
+      Base = BO->getOperand(1);
+    }
+    if (!C || C->isZero())
+      return false;
+    Stride = C->getZExtValue();
+    return true;
+  }
+  if (BO->getOpcode() == Instruction::Shl) {
+    if (!C || C->getZExtValue() >= 32)
+      return false;
+    Stride = 1ULL << C->getZExtValue();
+    return true;
+  }
+  return false;
+}
+
+StridedIndex MatchStrided(Value *V) {
+  StridedIndex SI = {nullptr, 1, 0, true};
+  if (ConstantInt *C = dyn_cast<ConstantInt>(V)) {
+    SI.Offset = C->getZExtValue();
+    return SI;
+  }
+
+  StridedIndex Whole = {V, 1, 0, true};
+  Value *Term = V;
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  if (BO && (BO->getOpcode() == Instruction::Add ||
+             BO->getOpcode() == Instruction::Or)) {
+    Term = BO->getOperand(0);
+    Value *Other = BO->getOperand(1);
+    Value *Base;
+    uint64_t Stride;
+    if (!MatchScaled(Term, Base, Stride))
+      std::swap(Term, Other);
+    if (ConstantInt *C = dyn_cast<ConstantInt>(Other))
+      SI.Offset = C->getZExtValue();
+    else
+      SI.bConstOffset = false;
+  }
+  if (!MatchScaled(Term, SI.Base, SI.Stride))
+    return Whole;
+  // An or only adds when the offset fits below the scaled bits.
+  if (BO && BO->getOpcode() == Instruction::Or &&
+      (!SI.bConstOffset || !isPowerOf2_64(SI.Stride) ||
+       SI.Offset >= SI.Stride))
+    return Whole;
+  return SI;
+}
+
+bool IsMemoryAccessTo(User *U, Value *Ptr) {
+  if (LoadInst *LI = dyn_cast<LoadInst>(U))
+    return LI->getPointerOperand() == Ptr;
+  if (StoreInst *SI = dyn_cast<StoreInst>(U))
+    return SI->getPointerOperand() == Ptr;
+  if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(U))
+    return RMW->getPointerOperand() == Ptr;
+  if (AtomicCmpXchgInst *CX = dyn_cast<AtomicCmpXchgInst>(U))
+    return CX->getPointerOperand() == Ptr;
+  return false;
+}
+
+// Returns false when some use of GV isn't a load, store or atomic on one
+// element.
+bool CollectAccesses(GlobalVariable *GV,
+                     SmallVectorImpl<GroupSharedAccess> &Accesses) {
+  for (User *U : GV->users()) {
+    GEPOperator *GEP = dyn_cast<GEPOperator>(U);
+    if (!GEP || GEP->getPointerOperand() != GV || GEP->getNumIndices() != 2)
+      return false;
+    ConstantInt *Zero = dyn_cast<ConstantInt>(GEP->getOperand(1));
+    if (!Zero || !Zero->isZero())
+      return false;
+    for (User *GEPUser : GEP->users())
+      if (!IsMemoryAccessTo(GEPUser, GEP))
+        return false;
+    GroupSharedAccess Access = {GEP, MatchStrided(GEP->getOperand(2))};
+    Accesses.emplace_back(Access);
+  }
+  return !Accesses.empty();
+}
+
+std::string GetDisplayName(GlobalVariable *GV) {
+  StringRef Name = GV->getName();
+  if (Name.startswith("\01"))
+    Name = Name.drop_front();
+  return Name.str();
+}
+
+// Point the access to element Idx of NewGV instead.
+void Rewrite(GroupSharedAccess &Access, GlobalVariable *NewGV, Value *Idx) {
+  GEPOperator *GEP = Access.GEP;
+  Type *ArrayTy = NewGV->getType()->getPointerElementType();
+  Value *NewGEP;
+  if (Instruction *I = dyn_cast<Instruction>(GEP)) {
+    IRBuilder<> Builder(I);
+    NewGEP = Builder.CreateInBoundsGEP(ArrayTy, NewGV,
+                                       {GEP->getOperand(1), Idx});
+    if (isa<Instruction>(NewGEP))
+      NewGEP->takeName(I);
+  } else {
+    NewGEP = ConstantExpr::getInBoundsGetElementPtr(
+        ArrayTy, NewGV, ArrayRef<Constant *>(
+                            {cast<Constant>(GEP->getOperand(1)),
+                             cast<Constant>(Idx)}));
+  }
+  GEP->replaceAllUsesWith(NewGEP);
+  if (Instruction *I = dyn_cast<Instruction>(GEP))
+    I->eraseFromParent();
+}
+
+GlobalVariable *CreateLike(GlobalVariable *GV, Type *Ty, const Twine &Name) {
+  GlobalVariable *NewGV = new GlobalVariable(
+      *GV->getParent(), Ty, /*IsConstant*/ false, GV->getLinkage(),
+      UndefValue::get(Ty), Name, /*InsertBefore*/ GV,
+      GV->getThreadLocalMode(), DXIL::kTGSMAddrSpace);
+  NewGV->setAlignment(GV->getAlignment());
+  return NewGV;
+}
+
+void EraseGlobal(GlobalVariable *GV) {
+  GV->removeDeadConstantUsers();
+  DXASSERT(GV->use_empty(), "otherwise, access left to old groupshared");
+  GV->eraseFromParent();
+}
+
+bool DxilGroupSharedLayout::Split(GlobalVariable *GV,
+                                  ArrayRef<GroupSharedAccess> Accesses,
+                                  SmallVectorImpl<GlobalVariable *> &Parts) {
+  ArrayType *AT = cast<ArrayType>(GV->getType()->getPointerElementType());
+  uint64_t NumElts = AT->getNumElements();
+
+  uint64_t K = 0;
+  for (const GroupSharedAccess &Access : Accesses) {
+    const StridedIndex &Idx = Access.Idx;
+    if (!Idx.Base) {
+      if (Idx.Offset >= NumElts)
+        return false;
+      continue;
+    }
+    if (!Idx.bConstOffset || Idx.Offset >= Idx.Stride)
+      return false;
+    if (K && K != Idx.Stride)
+      return false;
+    K = Idx.Stride;
+  }
+  if (K < 2 || K > kMaxSplitWays || NumElts % K)
+    return false;
+
+  ArrayType *PartTy = ArrayType::get(AT->getElementType(), NumElts / K);
+  std::string Name = GV->getName();
+  for (unsigned i = 0; i < K; ++i)
+    Parts.emplace_back(CreateLike(GV, PartTy, Name + ".s" + Twine(i)));
+
+  for (GroupSharedAccess Access : Accesses) {
+    const StridedIndex &Idx = Access.Idx;
+    Value *Index = Access.GEP->getOperand(2);
+    if (Idx.Base) {
+      Rewrite(Access, Parts[Idx.Offset], Idx.Base);
+    } else {
+      Constant *NewIdx = ConstantInt::get(Index->getType(), Idx.Offset / K);
+      Rewrite(Access, Parts[Idx.Offset % K], NewIdx);
+    }
+  }
+
+  dxilutil::EmitNoteOnContext(GV->getContext(),
+                              Twine("groupshared ") + GetDisplayName(GV) +
+                                  " split into " + Twine(K) +
+                                  " arrays to avoid bank conflicts");
+  EraseGlobal(GV);
+  return true;
+}
+
+bool DxilGroupSharedLayout::Pad(GlobalVariable *GV,
+                                ArrayRef<GroupSharedAccess> Accesses) {
+  ArrayType *AT = cast<ArrayType>(GV->getType()->getPointerElementType());
+  if (AT->getElementType()->getPrimitiveSizeInBits() != 32)
+    return false;
+  uint64_t NumElts = AT->getNumElements();
+
+  uint64_t S = 0;
+  for (const GroupSharedAccess &Access : Accesses) {
+    const StridedIndex &Idx = Access.Idx;
+    if (!Idx.Base || Idx.Stride < kNumBanks || Idx.Stride % kNumBanks)
+      continue;
+    if (S && S != Idx.Stride)
+      return false;
+    S = Idx.Stride;
+  }
+  if (!S || NumElts <= S)
+    return false;
+
+  // One extra element before each row but the first.
+  uint64_t NewNumElts = NumElts + (NumElts - 1) / S;
+  const DataLayout &DL = GV->getParent()->getDataLayout();
+  uint64_t Growth = (NewNumElts - NumElts) *
+                    DL.getTypeAllocSize(AT->getElementType());
+  if (m_TotalSize + Growth > DXIL::kMaxTGSMSize)
+    return false;
+  m_TotalSize += Growth;
+
+  ArrayType *NewTy = ArrayType::get(AT->getElementType(), NewNumElts);
+  GlobalVariable *NewGV = CreateLike(GV, NewTy, GV->getName() + ".pad");
+  NewGV->takeName(GV);
+
+  for (GroupSharedAccess Access : Accesses) {
+    const StridedIndex &Idx = Access.Idx;
+    Value *Index = Access.GEP->getOperand(2);
+    Type *IdxTy = Index->getType();
+    if (!Idx.Base) {
+      Rewrite(Access, NewGV,
+              ConstantInt::get(IdxTy, Idx.Offset + Idx.Offset / S));
+      continue;
+    }
+    // Index + Index / S
+    IRBuilder<> Builder(cast<Instruction>(Access.GEP));
+    Value *Row;
+    if (Idx.Stride == S && Idx.bConstOffset && Idx.Offset < S)
+      Row = Idx.Base;
+    else if (isPowerOf2_64(S))
+      Row = Builder.CreateLShr(Index, Log2_64(S));
+    else
+      Row = Builder.CreateUDiv(Index, ConstantInt::get(IdxTy, S));
+    Rewrite(Access, NewGV, Builder.CreateAdd(Index, Row));
+  }
+
+  dxilutil::EmitNoteOnContext(GV->getContext(),
+                              Twine("groupshared ") + GetDisplayName(NewGV) +
+                                  " padded every " + Twine(S) +
+                                  " elements to avoid bank conflicts");
+  EraseGlobal(GV);
+  return true;
+}
+
+bool DxilGroupSharedLayout::runOnModule(Module &M) {
+  if (!M.HasDxilModule())
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+  // Library groupshared may be shared with other modules at link time, and
+  // debug info would describe the declared layout.
+  if (DM.GetShaderModel()->IsLib() || hasDebugInfo(M))
+    return false;
+
+  const DataLayout &DL = M.getDataLayout();
+  SmallVector<GlobalVariable *, 8> Candidates;
+  m_TotalSize = 0;
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.getType()->getAddressSpace() != DXIL::kTGSMAddrSpace)
+      continue;
+    Type *Ty = GV.getType()->getPointerElementType();
+    m_TotalSize += DL.getTypeAllocSize(Ty);
+    ArrayType *AT = dyn_cast<ArrayType>(Ty);
+    if (!AT || AT->getNumElements() < 2)
+      continue;
+    Type *EltTy = AT->getElementType();
+    if (!EltTy->isIntegerTy() && !EltTy->isFloatingPointTy())
+      continue;
+    if (GV.hasInitializer() && !isa<UndefValue>(GV.getInitializer()))
+      continue;
+    Candidates.emplace_back(&GV);
+  }
+
+  bool bChanged = false;
+  for (GlobalVariable *GV : Candidates) {
+    SmallVector<GroupSharedAccess, 16> Accesses;
+    if (!CollectAccesses(GV, Accesses))
+      continue;
+    SmallVector<GlobalVariable *, 4> Parts;
+    if (!Split(GV, Accesses, Parts)) {
+      bChanged |= Pad(GV, Accesses);
+      continue;
+    }
+    bChanged = true;
+    // Each part may still be accessed in rows.
+    for (GlobalVariable *Part : Parts) {
+      SmallVector<GroupSharedAccess, 16> PartAccesses;
+      if (CollectAccesses(Part, PartAccesses))
+        Pad(Part, PartAccesses);
+      else if (Part->use_empty())
+        Part->eraseFromParent();
+    }
+  }
+  return bChanged;
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilGroupSharedLayoutPass() {
+  return new DxilGroupSharedLayout();
+}
+
+INITIALIZE_PASS(DxilGroupSharedLayout, "hlsl-dxil-groupshared-layout",
+                "DXIL groupshared layout", false, false)
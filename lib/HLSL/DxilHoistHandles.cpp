@@ -0,0 +1,160 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilHoistHandles.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Hoist loop invariant resource handle creation out of loops.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// Handles are created where resources are used, so a loop over resources
+// keeps creating the same handle each iteration. No LICM runs once handles
+// are lowered to DXIL operations, and createHandle being readonly keeps LICM
+// from moving it past UAV writes anyway, although it only reads the resource
+// table which can't change while the shader runs.
+//
+// This pass moves handle creation inside loops as high up the dominator tree
+// as its operands allow, without moving it into another loop, then reuses an
+// identical handle already created at the new location.
+
+namespace {
+
+class DxilHoistHandles : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilHoistHandles() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL hoist handles";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool Hoist(CallInst *CI);
+
+  DominatorTree *DT;
+  LoopInfo *LI;
+};
+
+char DxilHoistHandles::ID = 0;
+
+bool IsHandleCreation(Instruction &I) {
+  CallInst *CI = dyn_cast<CallInst>(&I);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+    return false;
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case DXIL::OpCode::CreateHandle:
+  case DXIL::OpCode::CreateHandleFromBinding:
+  case DXIL::OpCode::CreateHandleFromHeap:
+  case DXIL::OpCode::AnnotateHandle:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool OperandsAvailableAt(CallInst *CI, Instruction *InsertPt,
+                         DominatorTree *DT) {
+  for (Value *V : CI->arg_operands()) {
+    Instruction *Op = dyn_cast<Instruction>(V);
+    if (Op && !DT->dominates(Op, InsertPt))
+      return false;
+  }
+  return true;
+}
+
+bool IsSameCall(CallInst *A, CallInst *B) {
+  if (A->getCalledValue() != B->getCalledValue())
+    return false;
+  for (unsigned i = 0, e = A->getNumArgOperands(); i < e; ++i)
+    if (A->getArgOperand(i) != B->getArgOperand(i))
+      return false;
+  return true;
+}
+
+bool DxilHoistHandles::Hoist(CallInst *CI) {
+  BasicBlock *BB = CI->getParent();
+  if (!LI->getLoopFor(BB))
+    return false;
+
+  BasicBlock *Best = BB;
+  for (DomTreeNode *N = DT->getNode(BB)->getIDom(); N; N = N->getIDom()) {
+    BasicBlock *B = N->getBlock();
+    if (!OperandsAvailableAt(CI, B->getTerminator(), DT))
+      break;
+    // Don't run it more often than before.
+    Loop *L = LI->getLoopFor(B);
+    if (L && !L->contains(BB))
+      continue;
+    Best = B;
+  }
+  if (Best == BB)
+    return false;
+
+  Instruction *InsertPt = Best->getTerminator();
+  for (Instruction &I : *Best) {
+    CallInst *Other = dyn_cast<CallInst>(&I);
+    if (Other && IsHandleCreation(I) && IsSameCall(Other, CI)) {
+      CI->replaceAllUsesWith(Other);
+      CI->eraseFromParent();
+      return true;
+    }
+  }
+  CI->moveBefore(InsertPt);
+  return true;
+}
+
+bool DxilHoistHandles::runOnFunction(Function &F) {
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  if (LI->empty())
+    return false;
+
+  // Dominator tree preorder hoists an annotateHandle's operand before it.
+  SmallVector<CallInst *, 16> Handles;
+  for (DomTreeNode *Node : depth_first(DT->getRootNode()))
+    for (Instruction &I : *Node->getBlock())
+      if (IsHandleCreation(I))
+        Handles.emplace_back(cast<CallInst>(&I));
+
+  bool bChanged = false;
+  for (CallInst *CI : Handles)
+    bChanged |= Hoist(CI);
+  return bChanged;
+}
+
+} // namespace
+
+FunctionPass *llvm::createDxilHoistHandlesPass() {
+  return new DxilHoistHandles();
+}
+
+INITIALIZE_PASS_BEGIN(DxilHoistHandles, "hlsl-dxil-hoist-handles",
+                      "DXIL hoist handles", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(DxilHoistHandles, "hlsl-dxil-hoist-handles",
+                    "DXIL hoist handles", false, false)
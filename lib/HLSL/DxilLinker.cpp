@@ -18,6 +18,7 @@
 #include "dxc/DXIL/DxilUtil.h"
 #include "dxc/Support/Global.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringSet.h"
@@ -30,7 +31,9 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "dxc/DxilContainer/DxilContainer.h"
@@ -41,6 +44,7 @@
 #include "dxc/HLSL/DxilGenerationPass.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Scalar.h"
 
 #include "dxc/HLSL/DxilExportMap.h"
@@ -51,16 +55,55 @@ using namespace hlsl;
 
 namespace {
 
-void CollectUsedFunctions(Constant *C,
-                          llvm::SetVector<Function *> &funcSet) {
-  for (User *U : C->users()) {
-    if (Instruction *I = dyn_cast<Instruction>(U)) {
-      funcSet.insert(I->getParent()->getParent());
-    } else {
-      Constant *CU = cast<Constant>(U);
-      CollectUsedFunctions(CU, funcSet);
+// Maps each global of a module to its position, to keep sets of globals in
+// module order.
+typedef llvm::DenseMap<const GlobalVariable *, unsigned> GlobalIndexMap;
+
+void BuildGlobalIndex(Module &M, GlobalIndexMap &globalIndex) {
+  unsigned index = 0;
+  for (GlobalVariable &GV : M.globals())
+    globalIndex[&GV] = index++;
+}
+
+// Collects the globals C refers to, and those their initializers refer to.
+void CollectUsedGlobals(Constant *C, SmallPtrSetImpl<Constant *> &visited,
+                        SmallVectorImpl<GlobalVariable *> &GVs) {
+  if (!visited.insert(C).second)
+    return;
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(C)) {
+    GVs.emplace_back(GV);
+    if (GV->hasInitializer())
+      CollectUsedGlobals(GV->getInitializer(), visited, GVs);
+    return;
+  }
+  if (isa<GlobalValue>(C))
+    return;
+  for (Value *Op : C->operands())
+    CollectUsedGlobals(cast<Constant>(Op), visited, GVs);
+}
+
+// Collects the functions a materialized F calls and the globals it uses, from
+// its body alone, so the cost follows the size of F rather than that of the
+// module. Globals are added in module order.
+void CollectFunctionUsage(Function &F, const GlobalIndexMap &globalIndex,
+                          llvm::SetVector<Function *> &usedFunctions,
+                          llvm::SetVector<GlobalVariable *> &usedGVs) {
+  SmallPtrSet<Constant *, 16> visited;
+  SmallVector<GlobalVariable *, 8> GVs;
+  for (auto &BB : F.getBasicBlockList()) {
+    for (auto &I : BB.getInstList()) {
+      if (CallInst *CI = dyn_cast<CallInst>(&I))
+        usedFunctions.insert(CI->getCalledFunction());
+      for (Use &U : I.operands())
+        if (Constant *C = dyn_cast<Constant>(U))
+          CollectUsedGlobals(C, visited, GVs);
     }
   }
+  std::sort(GVs.begin(), GVs.end(),
+            [&](const GlobalVariable *A, const GlobalVariable *B) {
+              return globalIndex.lookup(A) < globalIndex.lookup(B);
+            });
+  usedGVs.insert(GVs.begin(), GVs.end());
 }
 
 template <class T>
@@ -106,13 +149,16 @@ struct DxilFunctionLinkInfo {
   // SetVectors for deterministic iteration
   llvm::SetVector<llvm::Function *> usedFunctions;
   llvm::SetVector<llvm::GlobalVariable *> usedGVs;
+  // The body is materialized and the sets above are complete.
+  bool bLoaded = false;
 };
 
 // Library to link.
 class DxilLib {
 
 public:
-  DxilLib(std::unique_ptr<llvm::Module> pModule);
+  DxilLib(std::unique_ptr<llvm::Module> pModule,
+          const DxilLibraryUsage *pUsage = nullptr);
   virtual ~DxilLib() {}
   bool HasFunction(std::string &name);
   llvm::StringMap<std::unique_ptr<DxilFunctionLinkInfo>> &GetFunctionTable() {
@@ -141,6 +187,13 @@ private:
   llvm::MapVector<const llvm::Constant *, DxilResourceBase *> m_resourceMap;
   // Set of initialize functions for global variable. SetVector for deterministic iteration.
   llvm::SetVector<llvm::Function *> m_initFuncSet;
+  // Position of each global, for CollectFunctionUsage.
+  GlobalIndexMap m_globalIndex;
+  // Usage was given at registration, so function bodies need no scan.
+  bool m_bUsageGiven = false;
+  // Init functions are loaded and the resource map is built; neither changes
+  // between links.
+  bool m_bGlobalUsageBuilt = false;
 };
 
 struct DxilLinkJob;
@@ -152,6 +205,8 @@ public:
   bool HasLibNameRegistered(StringRef name) override;
   bool RegisterLib(StringRef name, std::unique_ptr<llvm::Module> pModule,
                    std::unique_ptr<llvm::Module> pDebugModule) override;
+  bool RegisterLib(StringRef name, std::unique_ptr<llvm::Module> pModule,
+                   const DxilLibraryUsage &usage) override;
   bool AttachLib(StringRef name) override;
   bool DetachLib(StringRef name) override;
   void DetachAll() override;
@@ -166,8 +221,13 @@ private:
                     SetVector<DxilLib *> &libSet, SetVector<StringRef> &addedFunctionSet,
                     DxilLinkJob &linkJob, bool bLazyLoadDone,
                     bool bAllowFuncionDecls);
-  // Attached libs to link.
-  std::unordered_set<DxilLib *> m_attachedLibs;
+  // Names of the attached functions, lib by lib in attach order and in module
+  // order within each lib. Links walk these instead of m_functionNameMap, whose
+  // order depends on what was attached before, so that the same link gives
+  // the same module on any linker.
+  void CollectAttachedFunctions(SmallVectorImpl<StringRef> &names);
+  // Attached libs to link. SetVector for deterministic iteration.
+  llvm::SetVector<DxilLib *> m_attachedLibs;
   // Owner of all DxilLib.
   StringMap<std::unique_ptr<DxilLib>> m_LibMap;
   llvm::StringMap<std::pair<DxilFunctionLinkInfo *, DxilLib *>>
@@ -189,11 +249,42 @@ DxilFunctionLinkInfo::DxilFunctionLinkInfo(Function *F) : func(F) {
 // DxilLib methods.
 //
 
-DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
+DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule,
+                 const DxilLibraryUsage *pUsage)
     : m_pModule(std::move(pModule)), m_DM(m_pModule->GetOrCreateDxilModule()) {
   Module &M = *m_pModule;
   const std::string MID = (Twine(M.getModuleIdentifier()) + ".").str();
 
+  // Resolve given usage by name before internal symbols are renamed.
+  std::vector<std::pair<Function *, const DxilLibraryUsage::FunctionUsage *>>
+      givenUsage;
+  if (pUsage) {
+    m_bUsageGiven = true;
+    for (auto &it : pUsage->functions) {
+      if (Function *F = M.getFunction(it.getKey()))
+        givenUsage.emplace_back(F, &it.getValue());
+    }
+    for (const std::string &name : pUsage->initFunctions) {
+      if (Function *F = M.getFunction(name))
+        m_initFuncSet.insert(F);
+    }
+  }
+  std::vector<std::pair<Function *, std::vector<Function *>>> usedFunctions;
+  std::vector<std::pair<Function *, std::vector<GlobalVariable *>>> usedGVs;
+  for (auto &it : givenUsage) {
+    std::vector<Function *> funcs;
+    for (const std::string &name : it.second->usedFunctions)
+      if (Function *F = M.getFunction(name))
+        funcs.emplace_back(F);
+    std::vector<GlobalVariable *> GVs;
+    for (const std::string &name : it.second->usedGlobals)
+      if (GlobalVariable *GV =
+              M.getGlobalVariable(name, /*AllowInternal*/ true))
+        GVs.emplace_back(GV);
+    usedFunctions.emplace_back(it.first, std::move(funcs));
+    usedGVs.emplace_back(it.first, std::move(GVs));
+  }
+
   // Collect function defines.
   for (Function &F : M.functions()) {
     if (F.isDeclaration())
@@ -216,6 +307,14 @@ DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
     }
   }
 
+  for (auto &it : usedFunctions) {
+    DxilFunctionLinkInfo *linkInfo = m_functionNameMap[it.first->getName()].get();
+    linkInfo->usedFunctions.insert(it.second.begin(), it.second.end());
+  }
+  for (auto &it : usedGVs) {
+    DxilFunctionLinkInfo *linkInfo = m_functionNameMap[it.first->getName()].get();
+    linkInfo->usedGVs.insert(it.second.begin(), it.second.end());
+  }
 }
 
 void DxilLib::FixIntrinsicOverloads() {
@@ -229,16 +328,17 @@ void DxilLib::FixIntrinsicOverloads() {
 void DxilLib::LazyLoadFunction(Function *F) {
   DXASSERT(m_functionNameMap.count(F->getName()), "else invalid Function");
   DxilFunctionLinkInfo *linkInfo = m_functionNameMap[F->getName()].get();
+  if (linkInfo->bLoaded)
+    return;
   std::error_code EC = F->materialize();
   DXASSERT_LOCALVAR(EC, !EC, "else fail to materialize");
 
-  // Build used functions for F.
-  for (auto &BB : F->getBasicBlockList()) {
-    for (auto &I : BB.getInstList()) {
-      if (CallInst *CI = dyn_cast<CallInst>(&I)) {
-        linkInfo->usedFunctions.insert(CI->getCalledFunction());
-      }
-    }
+  // Build used functions and globals for F, unless they were given.
+  if (!m_bUsageGiven) {
+    if (m_globalIndex.empty())
+      BuildGlobalIndex(*m_pModule, m_globalIndex);
+    CollectFunctionUsage(*F, m_globalIndex, linkInfo->usedFunctions,
+                         linkInfo->usedGVs);
   }
 
   if (m_DM.HasDxilFunctionProps(F)) {
@@ -249,14 +349,21 @@ void DxilLib::LazyLoadFunction(Function *F) {
       linkInfo->usedFunctions.insert(patchConstantFunc);
     }
   }
-  // Used globals will be build before link.
+  linkInfo->bLoaded = true;
 }
 
 void DxilLib::BuildGlobalUsage() {
   Module &M = *m_pModule;
 
-  // Collect init functions for static globals.
-  if (GlobalVariable *Ctors = M.getGlobalVariable("llvm.global_ctors")) {
+  // Usage of each function is built as it is loaded, so what is left here
+  // only needs doing once.
+  if (m_bGlobalUsageBuilt)
+    return;
+
+  // Collect init functions for static globals, unless they were given.
+  GlobalVariable *Ctors =
+      m_bUsageGiven ? nullptr : M.getGlobalVariable("llvm.global_ctors");
+  if (Ctors) {
     if (ConstantArray *CA = dyn_cast<ConstantArray>(Ctors->getInitializer())) {
       for (User::op_iterator i = CA->op_begin(), e = CA->op_end(); i != e;
            ++i) {
@@ -274,21 +381,11 @@ void DxilLib::BuildGlobalUsage() {
                "function type must be void (void)");
         // Add Ctor.
         m_initFuncSet.insert(Ctor);
-        LazyLoadFunction(Ctor);
       }
     }
   }
-
-  // Build used globals.
-  for (GlobalVariable &GV : M.globals()) {
-    llvm::SetVector<Function *> funcSet;
-    CollectUsedFunctions(&GV, funcSet);
-    for (Function *F : funcSet) {
-      DXASSERT(m_functionNameMap.count(F->getName()), "must exist in table");
-      DxilFunctionLinkInfo *linkInfo = m_functionNameMap[F->getName()].get();
-      linkInfo->usedGVs.insert(&GV);
-    }
-  }
+  for (Function *Ctor : m_initFuncSet)
+    LazyLoadFunction(Ctor);
 
   // Build resource map.
   AddResourceMap(m_DM.GetUAVs(), DXIL::ResourceClass::UAV, m_resourceMap, m_DM);
@@ -297,6 +394,7 @@ void DxilLib::BuildGlobalUsage() {
                  m_resourceMap, m_DM);
   AddResourceMap(m_DM.GetSamplers(), DXIL::ResourceClass::Sampler,
                  m_resourceMap, m_DM);
+  m_bGlobalUsageBuilt = true;
 }
 
 void DxilLib::CollectUsedInitFunctions(SetVector<StringRef> &addedFunctionSet,
@@ -306,28 +404,73 @@ void DxilLib::CollectUsedInitFunctions(SetVector<StringRef> &addedFunctionSet,
     DXASSERT(m_functionNameMap.count(Ctor->getName()),
              "must exist in internal table");
     DxilFunctionLinkInfo *linkInfo = m_functionNameMap[Ctor->getName()].get();
-    // If function other than Ctor used GV of Ctor.
-    // Add Ctor to usedFunctions for it.
-    for (GlobalVariable *GV : linkInfo->usedGVs) {
-      llvm::SetVector<Function *> funcSet;
-      CollectUsedFunctions(GV, funcSet);
-      bool bAdded = false;
-      for (Function *F : funcSet) {
-        if (F == Ctor)
-          continue;
-        // If F is added for link, add init func to workList.
-        if (addedFunctionSet.count(F->getName())) {
-          workList.emplace_back(Ctor->getName());
-          bAdded = true;
+    // If a function other than Ctor that is added for link uses a GV of
+    // Ctor, add Ctor to workList. Added functions are loaded, so their used
+    // globals are known.
+    bool bUsed = false;
+    for (StringRef name : addedFunctionSet) {
+      auto it = m_functionNameMap.find(name);
+      if (it == m_functionNameMap.end() || it->second->func == Ctor)
+        continue;
+      for (GlobalVariable *GV : linkInfo->usedGVs) {
+        if (it->second->usedGVs.count(GV)) {
+          bUsed = true;
           break;
         }
       }
-      if (bAdded)
+      if (bUsed)
         break;
     }
+    if (bUsed)
+      workList.emplace_back(Ctor->getName());
   }
 }
 
+//------------------------------------------------------------------------------
+//
+// DxilLibraryUsage methods.
+//
+
+bool DxilLibraryUsage::Build(Module &M) {
+  functions.clear();
+  initFunctions.clear();
+
+  GlobalIndexMap globalIndex;
+  BuildGlobalIndex(M, globalIndex);
+  for (Function &F : M.functions()) {
+    if (F.isDeclaration())
+      continue;
+    llvm::SetVector<Function *> usedFunctions;
+    llvm::SetVector<GlobalVariable *> usedGVs;
+    CollectFunctionUsage(F, globalIndex, usedFunctions, usedGVs);
+    FunctionUsage &usage = functions[F.getName()];
+    for (Function *Callee : usedFunctions) {
+      if (!Callee || !Callee->hasName())
+        return false;
+      usage.usedFunctions.emplace_back(Callee->getName());
+    }
+    for (GlobalVariable *GV : usedGVs) {
+      if (!GV->hasName())
+        return false;
+      usage.usedGlobals.emplace_back(GV->getName());
+    }
+  }
+
+  // Same init functions as DxilLib::BuildGlobalUsage collects.
+  if (GlobalVariable *Ctors = M.getGlobalVariable("llvm.global_ctors")) {
+    if (ConstantArray *CA = dyn_cast<ConstantArray>(Ctors->getInitializer())) {
+      for (Use &U : CA->operands()) {
+        if (isa<ConstantAggregateZero>(U))
+          continue;
+        ConstantStruct *CS = cast<ConstantStruct>(U);
+        if (Function *Ctor = dyn_cast<Function>(CS->getOperand(1)))
+          initFunctions.emplace_back(Ctor->getName());
+      }
+    }
+  }
+  return true;
+}
+
 bool DxilLib::HasFunction(std::string &name) {
   return m_functionNameMap.count(name);
 }
@@ -346,12 +489,31 @@ DxilResourceBase *DxilLib::GetResource(const llvm::Constant *GV) {
 
 
 namespace {
+// Matches types from different libraries that only differ in the numeric
+// suffixes LLVM gives to struct names. Every type gets a structural hash,
+// computed once per link job, so most mismatches are rejected by comparing
+// hashes; only types whose hashes agree are compared, and the result of
+// each comparison is remembered too.
+class DxilTypeMatcher {
+public:
+  bool IsMatchedType(Type *Ty0, Type *Ty);
+
+private:
+  size_t GetTypeHash(Type *Ty);
+  bool IsMatchedStructType(StructType *ST0, StructType *ST);
+  bool IsMatchedArrayType(ArrayType *AT0, ArrayType *AT);
+  bool CompareTypes(Type *Ty0, Type *Ty);
+
+  DenseMap<Type *, size_t> m_typeHashes;
+  DenseMap<std::pair<Type *, Type *>, bool> m_matches;
+};
+
 // Create module from link defines.
 struct DxilLinkJob {
   DxilLinkJob(LLVMContext &Ctx, dxilutil::ExportMap &exportMap,
-              unsigned valMajor, unsigned valMinor)
+              unsigned valMajor, unsigned valMinor, unsigned ltoOptLevel)
       : m_ctx(Ctx), m_exportMap(exportMap), m_valMajor(valMajor),
-        m_valMinor(valMinor) {}
+        m_valMinor(valMinor), m_ltoOptLevel(ltoOptLevel) {}
   std::unique_ptr<llvm::Module>
   Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
        const ShaderModel *pSM);
@@ -370,6 +532,10 @@ private:
   void EmitCtorListForLib(Module *pM);
   void CloneFunctions(ValueToValueMapTy &vmap);
   void AddFunctions(DxilModule &DM, ValueToValueMapTy &vmap);
+  void MergeIdenticalFunctions(DxilModule &DM,
+                               const SmallPtrSetImpl<Function *> &keepSet);
+  void RemoveUnusedFunctionsAndGlobals(
+      DxilModule &DM, const SmallPtrSetImpl<Function *> &keepSet);
   bool AddResource(DxilResourceBase *res, llvm::GlobalVariable *GV);
   void AddResourceToDM(DxilModule &DM);
   llvm::MapVector<DxilFunctionLinkInfo *, DxilLib *> m_functionDefs;
@@ -391,9 +557,13 @@ private:
            std::pair<DxilResourceBase *, llvm::GlobalVariable *>>
     m_resourceMap;
 
+  // Matches the types of resources with the same name from different libs.
+  DxilTypeMatcher m_typeMatcher;
+
   LLVMContext &m_ctx;
   dxilutil::ExportMap &m_exportMap;
   unsigned m_valMajor, m_valMinor;
+  unsigned m_ltoOptLevel;
 };
 } // namespace
 
@@ -420,9 +590,6 @@ const char kNoFunctionsToExport[] = "Library has no functions to export";
 //
 
 namespace {
-// Helper function to check type match.
-bool IsMatchedType(Type *Ty0, Type *Ty);
-
 StringRef RemoveNameSuffix(StringRef Name) {
   size_t DotPos = Name.rfind('.');
   if (DotPos != StringRef::npos && Name.back() != '.' &&
@@ -431,7 +598,57 @@ StringRef RemoveNameSuffix(StringRef Name) {
   return Name;
 }
 
-bool IsMatchedStructType(StructType *ST0, StructType *ST) {
+size_t DxilTypeMatcher::GetTypeHash(Type *Ty) {
+  auto it = m_typeHashes.find(Ty);
+  if (it != m_typeHashes.end())
+    return it->second;
+
+  hash_code H;
+  if (StructType *ST = dyn_cast<StructType>(Ty)) {
+    H = hash_combine(Ty->getTypeID(), RemoveNameSuffix(ST->getName()),
+                     ST->getNumElements());
+    for (Type *EltTy : ST->elements())
+      H = hash_combine(H, GetTypeHash(EltTy));
+  } else if (ArrayType *AT = dyn_cast<ArrayType>(Ty)) {
+    H = hash_combine(Ty->getTypeID(), AT->getNumElements(),
+                     GetTypeHash(AT->getElementType()));
+  } else if (PointerType *PT = dyn_cast<PointerType>(Ty)) {
+    // A struct pointee only contributes its name and size, so structs that
+    // point back to themselves still hash in finite time.
+    Type *EltTy = PT->getElementType();
+    if (StructType *ST = dyn_cast<StructType>(EltTy))
+      H = hash_combine(Ty->getTypeID(), PT->getAddressSpace(),
+                       RemoveNameSuffix(ST->getName()), ST->getNumElements());
+    else
+      H = hash_combine(Ty->getTypeID(), PT->getAddressSpace(),
+                       GetTypeHash(EltTy));
+  } else {
+    // Any other types only match themselves.
+    H = hash_value(Ty);
+  }
+  m_typeHashes[Ty] = H;
+  return H;
+}
+
+bool DxilTypeMatcher::IsMatchedType(Type *Ty0, Type *Ty) {
+  if (Ty0 == Ty)
+    return true;
+  if (GetTypeHash(Ty0) != GetTypeHash(Ty))
+    return false;
+
+  auto key = std::make_pair(Ty0, Ty);
+  auto it = m_matches.find(key);
+  if (it != m_matches.end())
+    return it->second;
+  // Assume a match while comparing, so types that refer back to themselves
+  // terminate.
+  m_matches[key] = true;
+  bool bMatch = CompareTypes(Ty0, Ty);
+  m_matches[key] = bMatch;
+  return bMatch;
+}
+
+bool DxilTypeMatcher::IsMatchedStructType(StructType *ST0, StructType *ST) {
   StringRef Name0 = RemoveNameSuffix(ST0->getName());
   StringRef Name = RemoveNameSuffix(ST->getName());
 
@@ -453,13 +670,13 @@ bool IsMatchedStructType(StructType *ST0, StructType *ST) {
   return true;
 }
 
-bool IsMatchedArrayType(ArrayType *AT0, ArrayType *AT) {
+bool DxilTypeMatcher::IsMatchedArrayType(ArrayType *AT0, ArrayType *AT) {
   if (AT0->getNumElements() != AT->getNumElements())
     return false;
   return IsMatchedType(AT0->getElementType(), AT->getElementType());
 }
 
-bool IsMatchedType(Type *Ty0, Type *Ty) {
+bool DxilTypeMatcher::CompareTypes(Type *Ty0, Type *Ty) {
   if (Ty0->isStructTy() && Ty->isStructTy()) {
     StructType *ST0 = cast<StructType>(Ty0);
     StructType *ST = cast<StructType>(Ty);
@@ -484,13 +701,134 @@ bool IsMatchedType(Type *Ty0, Type *Ty) {
 }
 } // namespace
 
+namespace {
+// Helpers to find functions with identical bodies.
+
+// Hash of the shape of a function body. Functions that are identical always
+// have the same hash; functions with the same hash still need comparing.
+size_t HashFunctionBody(Function &F) {
+  hash_code H = hash_value(F.getFunctionType());
+  for (BasicBlock &BB : F) {
+    H = hash_combine(H, BB.size());
+    for (Instruction &I : BB)
+      H = hash_combine(H, I.getOpcode(), I.getType(), I.getNumOperands());
+  }
+  return H;
+}
+
+bool IsSameFieldAnnotation(const DxilFieldAnnotation &A,
+                           const DxilFieldAnnotation &B) {
+  if (A.IsPrecise() != B.IsPrecise() || A.IsCBVarUsed() != B.IsCBVarUsed() ||
+      !(A.GetCompType() == B.GetCompType()) ||
+      A.GetSemanticString() != B.GetSemanticString() ||
+      A.GetFieldName() != B.GetFieldName() ||
+      A.GetResourceAttribute() != B.GetResourceAttribute() ||
+      A.HasCBufferOffset() != B.HasCBufferOffset() ||
+      A.HasInterpolationMode() != B.HasInterpolationMode() ||
+      A.HasMatrixAnnotation() != B.HasMatrixAnnotation())
+    return false;
+  if (A.HasCBufferOffset() && A.GetCBufferOffset() != B.GetCBufferOffset())
+    return false;
+  if (A.HasInterpolationMode() &&
+      !(A.GetInterpolationMode() == B.GetInterpolationMode()))
+    return false;
+  if (A.HasMatrixAnnotation()) {
+    const DxilMatrixAnnotation &MA = A.GetMatrixAnnotation();
+    const DxilMatrixAnnotation &MB = B.GetMatrixAnnotation();
+    if (MA.Rows != MB.Rows || MA.Cols != MB.Cols ||
+        MA.Orientation != MB.Orientation)
+      return false;
+  }
+  return true;
+}
+
+bool IsSameParamAnnotation(const DxilParameterAnnotation &A,
+                           const DxilParameterAnnotation &B) {
+  return A.GetParamInputQual() == B.GetParamInputQual() &&
+         A.GetSemanticIndexVec() == B.GetSemanticIndexVec() &&
+         IsSameFieldAnnotation(A, B);
+}
+
+bool IsSameFunctionAnnotation(const DxilFunctionAnnotation *A,
+                              const DxilFunctionAnnotation *B) {
+  if (!A || !B)
+    return A == B;
+  if (A->GetNumParameters() != B->GetNumParameters())
+    return false;
+  for (unsigned i = 0; i < A->GetNumParameters(); i++) {
+    if (!IsSameParamAnnotation(A->GetParameterAnnotation(i),
+                               B->GetParameterAnnotation(i)))
+      return false;
+  }
+  return IsSameParamAnnotation(A->GetRetTypeAnnotation(),
+                               B->GetRetTypeAnnotation());
+}
+
+// Returns true when L and R compute the same thing. Arguments, blocks and
+// instructions are matched by position; everything else an instruction uses
+// (constants, globals, callees, metadata) must be the very same value in both.
+// Debug locations are not compared.
+bool IsSameFunctionBody(Function &L, Function &R) {
+  if (L.getFunctionType() != R.getFunctionType() ||
+      L.getAttributes() != R.getAttributes() ||
+      L.getCallingConv() != R.getCallingConv() || L.size() != R.size())
+    return false;
+
+  DenseMap<const Value *, const Value *> localMap;
+  for (auto itL = L.arg_begin(), itR = R.arg_begin(); itL != L.arg_end();
+       ++itL, ++itR)
+    localMap[itL] = itR;
+  for (auto itL = L.begin(), itR = R.begin(); itL != L.end(); ++itL, ++itR) {
+    if (itL->size() != itR->size())
+      return false;
+    localMap[itL] = itR;
+    for (auto iL = itL->begin(), iR = itR->begin(); iL != itL->end();
+         ++iL, ++iR)
+      localMap[iL] = iR;
+  }
+
+  auto IsSameValue = [&localMap](const Value *VL, const Value *VR) {
+    auto it = localMap.find(VL);
+    if (it != localMap.end())
+      return it->second == VR;
+    return VL == VR;
+  };
+
+  SmallVector<std::pair<unsigned, MDNode *>, 4> mdL, mdR;
+  for (auto itL = L.begin(), itR = R.begin(); itL != L.end(); ++itL, ++itR) {
+    for (auto iL = itL->begin(), iR = itR->begin(); iL != itL->end();
+         ++iL, ++iR) {
+      if (!iL->isSameOperationAs(iR) ||
+          iL->getRawSubclassOptionalData() != iR->getRawSubclassOptionalData())
+        return false;
+      for (unsigned i = 0; i < iL->getNumOperands(); i++) {
+        if (!IsSameValue(iL->getOperand(i), iR->getOperand(i)))
+          return false;
+      }
+      if (PHINode *PhiL = dyn_cast<PHINode>(iL)) {
+        PHINode *PhiR = cast<PHINode>(iR);
+        for (unsigned i = 0; i < PhiL->getNumIncomingValues(); i++) {
+          if (!IsSameValue(PhiL->getIncomingBlock(i), PhiR->getIncomingBlock(i)))
+            return false;
+        }
+      }
+      iL->getAllMetadataOtherThanDebugLoc(mdL);
+      iR->getAllMetadataOtherThanDebugLoc(mdR);
+      if (mdL != mdR)
+        return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
 bool DxilLinkJob::AddResource(DxilResourceBase *res, llvm::GlobalVariable *GV) {
   if (m_resourceMap.count(res->GetGlobalName())) {
     DxilResourceBase *res0 = m_resourceMap[res->GetGlobalName()].first;
     Type *Ty0 = res0->GetHLSLType()->getPointerElementType();
     Type *Ty = res->GetHLSLType()->getPointerElementType();
     // Make sure res0 match res.
-    bool bMatch = IsMatchedType(Ty0, Ty);
+    bool bMatch = m_typeMatcher.IsMatchedType(Ty0, Ty);
     if (!bMatch) {
       // Report error.
       dxilutil::EmitErrorOnGlobalVariable(m_ctx, dyn_cast<GlobalVariable>(res->GetGlobalSymbol()),
@@ -707,6 +1045,11 @@ void DxilLinkJob::AddFunctions(DxilModule &DM, ValueToValueMapTy &vmap) {
                                       F->getName(), pM);
     NewF->setAttributes(F->getAttributes());
 
+    // A shader target cannot call functions, so helpers a library kept out
+    // of line are inlined into it at last.
+    if (!DM.GetShaderModel()->IsLib() &&
+        NewF->hasFnAttribute(llvm::Attribute::NoInline))
+      NewF->removeFnAttr(llvm::Attribute::NoInline);
     if (!NewF->hasFnAttribute(llvm::Attribute::NoInline))
       NewF->addFnAttr(llvm::Attribute::AlwaysInline);
 
@@ -723,6 +1066,114 @@ void DxilLinkJob::AddFunctions(DxilModule &DM, ValueToValueMapTy &vmap) {
   }
 }
 
+// Redirects callers of a function to an earlier function with an identical
+// body and annotations, then removes the duplicate. Functions in keepSet are
+// left alone; in a library, functions visible outside are only merge targets.
+void DxilLinkJob::MergeIdenticalFunctions(
+    DxilModule &DM, const SmallPtrSetImpl<Function *> &keepSet) {
+  Module &M = *DM.GetModule();
+  DxilTypeSystem &typeSys = DM.GetTypeSystem();
+  const bool bIsLib = DM.GetShaderModel()->IsLib();
+
+  // Merging two functions can make their callers identical, so repeat until
+  // nothing changes.
+  bool bChanged = true;
+  while (bChanged) {
+    bChanged = false;
+    std::vector<Function *> targets, removable;
+    for (Function &F : M) {
+      if (F.isDeclaration() || keepSet.count(&F))
+        continue;
+      if (bIsLib && !F.hasLocalLinkage())
+        targets.emplace_back(&F);
+      else
+        removable.emplace_back(&F);
+    }
+
+    std::unordered_map<size_t, SmallVector<Function *, 2>> functionsByHash;
+    for (Function *F : targets)
+      functionsByHash[HashFunctionBody(*F)].emplace_back(F);
+
+    for (Function *F : removable) {
+      SmallVector<Function *, 2> &sameHash =
+          functionsByHash[HashFunctionBody(*F)];
+      Function *Same = nullptr;
+      for (Function *Other : sameHash) {
+        if (IsSameFunctionBody(*Other, *F) &&
+            IsSameFunctionAnnotation(typeSys.GetFunctionAnnotation(Other),
+                                     typeSys.GetFunctionAnnotation(F))) {
+          Same = Other;
+          break;
+        }
+      }
+      if (!Same) {
+        sameHash.emplace_back(F);
+        continue;
+      }
+
+      // Keep the subprogram of the duplicate from claiming the merged
+      // function.
+      if (DISubprogram *SP = getDISubprogram(F))
+        SP->replaceFunction(nullptr);
+      F->replaceAllUsesWith(Same);
+      DM.RemoveFunction(F);
+      F->eraseFromParent();
+      bChanged = true;
+    }
+  }
+}
+
+// Removes functions nothing calls anymore, then the resources and internal
+// globals that only those functions used, so neither reaches the optimizer
+// or the resource tables. Functions in keepSet are left alone; in a library,
+// functions visible outside always stay.
+void DxilLinkJob::RemoveUnusedFunctionsAndGlobals(
+    DxilModule &DM, const SmallPtrSetImpl<Function *> &keepSet) {
+  Module &M = *DM.GetModule();
+  const bool bIsLib = DM.GetShaderModel()->IsLib();
+
+  // Removing a function can leave its callees unused.
+  bool bChanged = true;
+  while (bChanged) {
+    bChanged = false;
+    for (auto it = M.begin(); it != M.end();) {
+      Function *F = it++;
+      if (F->isDeclaration() || keepSet.count(F) ||
+          (bIsLib && !F->hasLocalLinkage()))
+        continue;
+      F->removeDeadConstantUsers();
+      if (!F->use_empty())
+        continue;
+      DM.RemoveFunction(F);
+      F->eraseFromParent();
+      bChanged = true;
+    }
+  }
+
+  for (auto it = m_resourceMap.begin(); it != m_resourceMap.end();) {
+    GlobalVariable *GV = it->second.second;
+    GV->removeDeadConstantUsers();
+    if (!GV->use_empty()) {
+      ++it;
+      continue;
+    }
+    m_newGlobals.erase(GV->getName());
+    GV->eraseFromParent();
+    it = m_resourceMap.erase(it);
+  }
+
+  for (auto it = M.global_begin(); it != M.global_end();) {
+    GlobalVariable *GV = it++;
+    if (!GV->hasLocalLinkage() || GV->getName().startswith("llvm."))
+      continue;
+    GV->removeDeadConstantUsers();
+    if (!GV->use_empty())
+      continue;
+    m_newGlobals.erase(GV->getName());
+    GV->eraseFromParent();
+  }
+}
+
 std::unique_ptr<Module>
 DxilLinkJob::Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
                   const ShaderModel *pSM) {
@@ -821,6 +1272,14 @@ DxilLinkJob::Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
     }
   }
 
+  // Drop duplicated and unreachable code before it is optimized.
+  SmallPtrSet<Function *, 2> keepSet;
+  keepSet.insert(NewEntryFunc);
+  if (props.IsHS())
+    keepSet.insert(props.ShaderProps.HS.patchConstantFunc);
+  MergeIdenticalFunctions(DM, keepSet);
+  RemoveUnusedFunctionsAndGlobals(DM, keepSet);
+
   // Refresh intrinsic cache.
   DM.GetOP()->RefreshCache();
 
@@ -934,6 +1393,28 @@ DxilLinkJob::LinkToLib(const ShaderModel *pSM) {
   // Clone functions.
   CloneFunctions(vmap);
 
+  // Drop duplicated and unreachable code before it is optimized. Entries,
+  // their patch constant functions and init functions must stay.
+  SmallPtrSet<Function *, 16> keepSet;
+  for (auto &it : m_functionDefs) {
+    DxilLib *pLib = it.second;
+    DxilModule &tmpDM = pLib->GetDxilModule();
+    Function *F = it.first->func;
+    if (tmpDM.HasDxilEntryProps(F)) {
+      DxilFunctionProps &props = tmpDM.GetDxilFunctionProps(F);
+      if (props.IsHS() && props.ShaderProps.HS.patchConstantFunc &&
+          m_newFunctions.count(
+              props.ShaderProps.HS.patchConstantFunc->getName()))
+        keepSet.insert(m_newFunctions[
+            props.ShaderProps.HS.patchConstantFunc->getName()]);
+    } else if (!pLib->IsInitFunc(F)) {
+      continue;
+    }
+    keepSet.insert(m_newFunctions[F->getName()]);
+  }
+  MergeIdenticalFunctions(DM, keepSet);
+  RemoveUnusedFunctionsAndGlobals(DM, keepSet);
+
   // Refresh intrinsic cache.
   DM.GetOP()->RefreshCache();
 
@@ -1259,6 +1740,14 @@ void DxilLinkJob::RunPreparePass(Module &M) {
   PM.add(createScalarizerPass());
   PM.add(createPromoteMemoryToRegisterPass());
 
+  // Optimize across library boundaries before resource handles are lowered,
+  // so handles the libraries loaded separately can fold together.
+  if (m_ltoOptLevel) {
+    PassManagerBuilder PMB;
+    PMB.OptLevel = m_ltoOptLevel;
+    PMB.populateHLSLLinkTimePassManager(PM);
+  }
+
   PM.add(createSimplifyInstPass());
   PM.add(createCFGSimplificationPass());
 
@@ -1307,6 +1796,17 @@ bool DxilLinkerImpl::RegisterLib(StringRef name,
   return true;
 }
 
+bool DxilLinkerImpl::RegisterLib(StringRef name,
+                                 std::unique_ptr<llvm::Module> pModule,
+                                 const DxilLibraryUsage &usage) {
+  if (m_LibMap.count(name) || !pModule)
+    return false;
+
+  pModule->setModuleIdentifier(name);
+  m_LibMap[name] = llvm::make_unique<DxilLib>(std::move(pModule), &usage);
+  return true;
+}
+
 bool DxilLinkerImpl::AttachLib(StringRef name) {
   auto iter = m_LibMap.find(name);
   if (iter == m_LibMap.end()) {
@@ -1380,7 +1880,7 @@ bool DxilLinkerImpl::DetachLib(DxilLib *lib) {
   if (!m_attachedLibs.count(lib))
     return false;
 
-  m_attachedLibs.erase(lib);
+  m_attachedLibs.remove(lib);
 
   // Remove functions from lib.
   StringMap<std::unique_ptr<DxilFunctionLinkInfo>> &funcTable =
@@ -1392,6 +1892,17 @@ bool DxilLinkerImpl::DetachLib(DxilLib *lib) {
   return true;
 }
 
+void DxilLinkerImpl::CollectAttachedFunctions(
+    SmallVectorImpl<StringRef> &names) {
+  for (DxilLib *pLib : m_attachedLibs) {
+    for (Function &F : pLib->GetDxilModule().GetModule()->functions()) {
+      auto it = m_functionNameMap.find(F.getName());
+      if (it != m_functionNameMap.end() && it->second.second == pLib)
+        names.emplace_back(it->getKey());
+    }
+  }
+}
+
 bool DxilLinkerImpl::AddFunctions(SmallVector<StringRef, 4> &workList,
                                   SetVector<DxilLib *> &libSet,
                                   SetVector<StringRef> &addedFunctionSet,
@@ -1464,7 +1975,8 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
     return nullptr;
   }
 
-  DxilLinkJob linkJob(m_ctx, exportMap, m_valMajor, m_valMinor);
+  DxilLinkJob linkJob(m_ctx, exportMap, m_valMajor, m_valMinor,
+                      m_ltoOptLevel);
 
   SetVector<DxilLib *> libSet;
   SetVector<StringRef> addedFunctionSet;
@@ -1482,9 +1994,11 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
   } else {
     if (exportMap.empty() && !exportMap.isExportShadersOnly()) {
       // Add every function for lib profile.
-      for (auto &it : m_functionNameMap) {
-        StringRef name = it.getKey();
-        std::pair<DxilFunctionLinkInfo *, DxilLib *> &linkPair = it.second;
+      SmallVector<StringRef, 16> names;
+      CollectAttachedFunctions(names);
+      for (StringRef name : names) {
+        std::pair<DxilFunctionLinkInfo *, DxilLib *> &linkPair =
+            m_functionNameMap[name];
         DxilFunctionLinkInfo *linkInfo = linkPair.first;
         DxilLib *pLib = linkPair.second;
 
@@ -1536,8 +2050,9 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
       SmallVector<StringRef, 4> workList;
 
       // Only add exported functions.
-      for (auto &it : m_functionNameMap) {
-        StringRef name = it.getKey();
+      SmallVector<StringRef, 16> names;
+      CollectAttachedFunctions(names);
+      for (StringRef name : names) {
         // Only add names exist in exportMap.
         if (exportMap.IsExported(name))
           workList.emplace_back(name);
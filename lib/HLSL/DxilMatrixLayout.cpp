@@ -0,0 +1,277 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilMatrixLayout.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Choose the orientation of cbuffer matrices from how they are read.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/HLMatrixType.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilTypeSystem.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// A square matrix in a constant buffer takes the same registers whichever its
+// orientation, so when the shader doesn't say which one it wants, it can be
+// stored the way it is read: a shader using only the translation of a
+// column_major float4x4 loads all four registers to read one component of
+// each, where the row_major layout has it in one register.
+//
+// Constant buffer matrices are read with cbufferLoadLegacy once lowered, so
+// for each candidate this pass counts the distinct registers each handle
+// loads from it under both orientations, and flips the matrix when the other
+// one needs fewer. Element (r, c) moves from register k, component j to
+// register j, component k, so the reads are rewritten in place and the type
+// annotation, which the reflection reports, is updated to match.
+//
+// Only matrices declared in a cbuffer or at global scope without a
+// row_major/column_major qualifier are candidates, since the application
+// reads their orientation from the reflection. The pass gives up on a cbuffer
+// read with a dynamic register index, and on libraries, whose cbuffers may
+// be read by code linked later.
+
+namespace {
+
+// A matrix, or array of matrices, whose orientation may be changed.
+struct MatrixField {
+  DxilFieldAnnotation *Annotation;
+  unsigned FirstReg;
+  unsigned NumRegs;
+  unsigned Dim;    // rows and columns
+};
+
+// Handle, overload and register of a cbufferLoadLegacy.
+typedef std::pair<Value *, std::pair<Function *, unsigned>> RegKey;
+
+class DxilMatrixLayout : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilMatrixLayout() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL matrix layout";
+  }
+
+  bool runOnModule(Module &M) override {
+    DxilModule &DM = M.GetOrCreateDxilModule();
+    if (DM.GetShaderModel()->IsLib())
+      return false;
+    bool bChanged = false;
+    for (const std::unique_ptr<DxilCBuffer> &CB : DM.GetCBuffers())
+      bChanged |= ProcessCBuffer(DM, *CB);
+    return bChanged;
+  }
+
+private:
+  bool ProcessCBuffer(DxilModule &DM, DxilCBuffer &CB);
+  bool CollectLoads(Value *V, SmallVectorImpl<CallInst *> &Loads);
+  void FlipField(const MatrixField &Field, ArrayRef<CallInst *> Loads,
+                 SetVector<CallInst *> &MaybeDead);
+};
+
+char DxilMatrixLayout::ID = 0;
+
+unsigned GetRegIndex(CallInst *Load) {
+  DxilInst_CBufferLoadLegacy CBLoad(Load);
+  return cast<ConstantInt>(CBLoad.get_regIndex())->getLimitedValue();
+}
+
+// Register and component element (Reg, Comp) of Field moves to when flipped.
+std::pair<unsigned, unsigned> GetFlipped(const MatrixField &Field,
+                                         unsigned Reg, unsigned Comp) {
+  unsigned Matrix = (Reg - Field.FirstReg) / Field.Dim;
+  unsigned Vec = (Reg - Field.FirstReg) % Field.Dim;
+  return std::make_pair(Field.FirstReg + Matrix * Field.Dim + Comp, Vec);
+}
+
+bool IsInField(const MatrixField &Field, unsigned Reg) {
+  return Reg >= Field.FirstReg && Reg < Field.FirstReg + Field.NumRegs;
+}
+
+// Collects the cbufferLoadLegacy calls reading the cbuffer V, loaded,
+// turned into a handle or annotated. Returns false when the cbuffer is used
+// in any other way or read with a dynamic register index.
+bool DxilMatrixLayout::CollectLoads(Value *V,
+                                    SmallVectorImpl<CallInst *> &Loads) {
+  for (User *U : V->users()) {
+    if (isa<LoadInst>(U)) {
+      if (!CollectLoads(U, Loads))
+        return false;
+      continue;
+    }
+    // Like the reference from llvm.used; the cbuffer is only read through
+    // handles once lowered to DXIL.
+    if (isa<Constant>(U))
+      continue;
+    CallInst *CI = dyn_cast<CallInst>(U);
+    if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+      return false;
+    switch (OP::GetDxilOpFuncCallInst(CI)) {
+    case DXIL::OpCode::CreateHandleForLib:
+    case DXIL::OpCode::AnnotateHandle:
+      if (!CollectLoads(CI, Loads))
+        return false;
+      break;
+    case DXIL::OpCode::CBufferLoadLegacy: {
+      DxilInst_CBufferLoadLegacy CBLoad(CI);
+      if (CBLoad.get_handle() != V ||
+          !isa<ConstantInt>(CBLoad.get_regIndex()))
+        return false;
+      for (User *LoadU : CI->users())
+        if (!isa<ExtractValueInst>(LoadU))
+          return false;
+      Loads.emplace_back(CI);
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+// Moves the reads of Field to the other orientation.
+void DxilMatrixLayout::FlipField(const MatrixField &Field,
+                                 ArrayRef<CallInst *> Loads,
+                                 SetVector<CallInst *> &MaybeDead) {
+  DenseMap<RegKey, CallInst *> NewLoads;
+  for (CallInst *Load : Loads) {
+    unsigned Reg = GetRegIndex(Load);
+    if (!IsInField(Field, Reg))
+      continue;
+    Instruction *Handle = cast<Instruction>(DxilInst_CBufferLoadLegacy(Load)
+                                                .get_handle());
+    for (auto U = Load->user_begin(), E = Load->user_end(); U != E;) {
+      ExtractValueInst *EVI = cast<ExtractValueInst>(*(U++));
+      unsigned Comp = EVI->getIndices()[0];
+      if (Comp >= Field.Dim)
+        continue;
+      std::pair<unsigned, unsigned> To = GetFlipped(Field, Reg, Comp);
+      RegKey Key(Handle, std::make_pair(Load->getCalledFunction(), To.first));
+      CallInst *&NewLoad = NewLoads[Key];
+      if (!NewLoad) {
+        // The handle dominates every read through it.
+        IRBuilder<> Builder(Handle->getNextNode());
+        NewLoad = Builder.CreateCall(
+            Load->getCalledFunction(),
+            {Load->getArgOperand(DXIL::OperandIndex::kOpcodeIdx), Handle,
+             Builder.getInt32(To.first)});
+      }
+      IRBuilder<> Builder(EVI);
+      Value *NewEVI = Builder.CreateExtractValue(NewLoad, To.second);
+      NewEVI->takeName(EVI);
+      EVI->replaceAllUsesWith(NewEVI);
+      EVI->eraseFromParent();
+    }
+    MaybeDead.insert(Load);
+  }
+
+  DxilMatrixAnnotation Matrix = Field.Annotation->GetMatrixAnnotation();
+  Matrix.Orientation = Matrix.Orientation == MatrixOrientation::RowMajor
+                           ? MatrixOrientation::ColumnMajor
+                           : MatrixOrientation::RowMajor;
+  Field.Annotation->SetMatrixAnnotation(Matrix);
+}
+
+bool DxilMatrixLayout::ProcessCBuffer(DxilModule &DM, DxilCBuffer &CB) {
+  GlobalVariable *GV = dyn_cast_or_null<GlobalVariable>(CB.GetGlobalSymbol());
+  if (!GV)
+    return false;
+  StructType *ST = dyn_cast<StructType>(GV->getType()->getElementType());
+  if (!ST)
+    return false;
+  DxilStructAnnotation *SA = DM.GetTypeSystem().GetStructAnnotation(ST);
+  if (!SA)
+    return false;
+
+  SmallVector<MatrixField, 4> Fields;
+  for (unsigned i = 0; i < SA->GetNumFields() && i < ST->getNumElements();
+       ++i) {
+    DxilFieldAnnotation &FA = SA->GetFieldAnnotation(i);
+    if (!FA.HasMatrixAnnotation() || !FA.HasDefaultMatrixOrientation() ||
+        !FA.HasCBufferOffset() || FA.GetCBufferOffset() % 16)
+      continue;
+    const DxilMatrixAnnotation &Matrix = FA.GetMatrixAnnotation();
+    if (Matrix.Rows != Matrix.Cols || Matrix.Rows < 2)
+      continue;
+    Type *Ty = ST->getElementType(i);
+    unsigned NumMatrices = 1;
+    while (ArrayType *AT = dyn_cast<ArrayType>(Ty)) {
+      NumMatrices *= AT->getNumElements();
+      Ty = AT->getElementType();
+    }
+    if (!HLMatrixType::isa(Ty))
+      continue;
+    Fields.push_back({&FA, FA.GetCBufferOffset() / 16,
+                      NumMatrices * Matrix.Rows, Matrix.Rows});
+  }
+  if (Fields.empty())
+    return false;
+
+  SmallVector<CallInst *, 16> Loads;
+  if (!CollectLoads(GV, Loads))
+    return false;
+
+  SetVector<CallInst *> MaybeDead;
+  for (const MatrixField &Field : Fields) {
+    // Registers of the field read through each handle, as it is and flipped.
+    DenseSet<RegKey> Current, Flipped;
+    bool bCanFlip = true;
+    for (CallInst *Load : Loads) {
+      unsigned Reg = GetRegIndex(Load);
+      if (!IsInField(Field, Reg))
+        continue;
+      // Only registers of four 32-bit components, like the flip assumes.
+      StructType *RetTy = cast<StructType>(Load->getType());
+      if (RetTy->getNumElements() != 4 ||
+          RetTy->getElementType(0)->getScalarSizeInBits() != 32) {
+        bCanFlip = false;
+        break;
+      }
+      Value *Handle = DxilInst_CBufferLoadLegacy(Load).get_handle();
+      Function *F = Load->getCalledFunction();
+      for (User *U : Load->users()) {
+        unsigned Comp = cast<ExtractValueInst>(U)->getIndices()[0];
+        if (Comp >= Field.Dim)
+          continue;
+        Current.insert(RegKey(Handle, std::make_pair(F, Reg)));
+        Flipped.insert(RegKey(
+            Handle, std::make_pair(F, GetFlipped(Field, Reg, Comp).first)));
+      }
+    }
+    if (bCanFlip && Flipped.size() < Current.size())
+      FlipField(Field, Loads, MaybeDead);
+  }
+
+  for (CallInst *Load : MaybeDead)
+    if (Load->use_empty())
+      Load->eraseFromParent();
+  return !MaybeDead.empty();
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilMatrixLayoutPass() {
+  return new DxilMatrixLayout();
+}
+
+INITIALIZE_PASS(DxilMatrixLayout, "hlsl-dxil-matrix-layout",
+                "DXIL matrix layout", false, false)
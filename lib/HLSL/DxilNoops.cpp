@@ -265,35 +265,50 @@ static Function *GetOrCreatePreserveF(Module *M, Type *Ty) {
   return PreserveF;
 }
 
-static Instruction *CreatePreserve(Value *V, Value *LastV, Instruction *InsertPt) {
+// The preserve function of each type, looked up once per pass since naming
+// one prints its type.
+typedef SmallDenseMap<Type *, Function *> PreserveFunctionMap;
+
+static Instruction *CreatePreserve(Value *V, Value *LastV, Instruction *InsertPt,
+                                   PreserveFunctionMap &PreserveFunctions) {
   assert(V->getType() == LastV->getType());
   Type *Ty = V->getType();
-  Function *PreserveF = GetOrCreatePreserveF(InsertPt->getModule(), Ty);
+  Function *&PreserveF = PreserveFunctions[Ty];
+  if (!PreserveF)
+    PreserveF = GetOrCreatePreserveF(InsertPt->getModule(), Ty);
   return CallInst::Create(PreserveF, ArrayRef<Value *> { V, LastV }, "", InsertPt);
 }
 
-static void LowerPreserveToSelect(CallInst *CI) {
+// Lowers the preserve CI, using the condition of its function from Conds,
+// which spares searching the loads of the condition for each preserve.
+static void LowerPreserveToSelect(CallInst *CI,
+                                  DenseMap<Function *, Value *> &Conds) {
   Value *V = CI->getArgOperand(0);
   Value *LastV = CI->getArgOperand(1);
 
   if (LastV == V)
     LastV = UndefValue::get(V->getType());
 
-  Value *Cond = GetOrCreatePreserveCond(CI->getParent()->getParent());
+  Value *&Cond = Conds[CI->getParent()->getParent()];
+  if (!Cond)
+    Cond = GetOrCreatePreserveCond(CI->getParent()->getParent());
   SelectInst *Select = SelectInst::Create(Cond, LastV, V, "", CI);
   Select->setDebugLoc(CI->getDebugLoc());
   CI->replaceAllUsesWith(Select);
   CI->eraseFromParent();
 }
 
-static void InsertNoopAt(Instruction *I) {
-  Module &M = *I->getModule();
-  Function *NoopF = GetOrCreateNoopF(M);
+// Inserts a noop before I. NoopF caches the noop function, which is
+// created the first time it is needed.
+static void InsertNoopAt(Instruction *I, Function *&NoopF) {
+  if (!NoopF)
+    NoopF = GetOrCreateNoopF(*I->getModule());
   CallInst *Noop = CallInst::Create(NoopF, {}, I);
   Noop->setDebugLoc(I->getDebugLoc());
 }
 
-static void InsertPreserve(bool AllowLoads, StoreInst *Store) {
+static void InsertPreserve(bool AllowLoads, StoreInst *Store,
+                           PreserveFunctionMap &PreserveFunctions) {
   Value *V = Store->getValueOperand();
 
   IRBuilder<> B(Store);
@@ -307,7 +322,8 @@ static void InsertPreserve(bool AllowLoads, StoreInst *Store) {
     Last_Value = UndefValue::get(V->getType());
   }
 
-  Instruction *Preserve = CreatePreserve(V, Last_Value, Store);
+  Instruction *Preserve =
+      CreatePreserve(V, Last_Value, Store, PreserveFunctions);
   Preserve->setDebugLoc(Store->getDebugLoc());
   Store->replaceUsesOfWith(V, Preserve);
 }
@@ -340,6 +356,8 @@ struct DxilInsertPreserves : public ModulePass {
     std::vector<Store_Info> Stores;
     std::vector<Value *> WorklistStorage;
     std::unordered_set<Value *> SeenStorage;
+    Function *NoopF = nullptr;
+    PreserveFunctionMap PreserveFunctions;
 
     for (GlobalVariable &GV : M.globals()) {
       if (GV.getLinkage() != GlobalValue::LinkageTypes::InternalLinkage ||
@@ -350,7 +368,7 @@ struct DxilInsertPreserves : public ModulePass {
 
       for (User *U : GV.users()) {
         if (LoadInst *LI = dyn_cast<LoadInst>(U)) {
-          InsertNoopAt(LI);
+          InsertNoopAt(LI, NoopF);
         }
       }
 
@@ -383,7 +401,7 @@ struct DxilInsertPreserves : public ModulePass {
       // so we can put a breakpoint there.
       for (User *U : F.users()) {
         if (CallInst *CI = dyn_cast<CallInst>(U)) {
-          InsertNoopAt(CI);
+          InsertNoopAt(CI, NoopF);
         }
       }
 
@@ -391,7 +409,7 @@ struct DxilInsertPreserves : public ModulePass {
       for (BasicBlock &BB : F) {
         ReturnInst *Ret = dyn_cast<ReturnInst>(BB.getTerminator());
         if (Ret)
-          InsertNoopAt(Ret);
+          InsertNoopAt(Ret, NoopF);
       }
     }
 
@@ -404,17 +422,17 @@ struct DxilInsertPreserves : public ModulePass {
           !V->getType()->isAggregateType() &&
           !V->getType()->isPointerTy())
         {
-          InsertPreserve(Info.AllowLoads, Store);
+          InsertPreserve(Info.AllowLoads, Store, PreserveFunctions);
           Changed = true;
         }
         else {
-          InsertNoopAt(Store);
+          InsertNoopAt(Store, NoopF);
           Changed = true;
         }
       }
       else if (MemCpyInst *MC = cast<MemCpyInst>(Info.StoreOrMC)) {
         // TODO: Do something to preserve pointer's previous value.
-        InsertNoopAt(MC);
+        InsertNoopAt(MC, NoopF);
         Changed = true;
       }
     }
@@ -446,14 +464,13 @@ class DxilPreserveToSelect : public ModulePass {
 public:
   static char ID;
 
-  SmallDenseMap<Type *, Function *> PreserveFunctions;
-
   DxilPreserveToSelect() : ModulePass(ID) {
     initializeDxilPreserveToSelectPass(*PassRegistry::getPassRegistry());
   }
 
   bool runOnModule(Module &M) override {
     bool Changed = false;
+    DenseMap<Function *, Value *> Conds;
     for (auto fit = M.getFunctionList().begin(), end = M.getFunctionList().end();
       fit != end;)
     {
@@ -465,7 +482,7 @@ public:
         for (auto uit = F->user_begin(), end = F->user_end(); uit != end;) {
           User *U = *(uit++);
           CallInst *CI = cast<CallInst>(U);
-          LowerPreserveToSelect(CI);
+          LowerPreserveToSelect(CI, Conds);
         }
 
         F->eraseFromParent();
@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPair16BitOps.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Schedule independent 16-bit scalar operations in pairs.                   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+// DXIL has no vector arithmetic, so 16-bit math on <2 x half> is scalarized
+// and drivers have to find pairs of scalar operations to pack into registers
+// with two 16-bit lanes themselves. They look for such pairs in a short
+// window, which independent operations spread far apart in the block miss.
+//
+// This pass moves a 16-bit operation right after an earlier isomorphic one
+// (same opcode and type) when it doesn't depend on anything in between, so
+// the pair is adjacent in the output. Only side-effect free operations are
+// moved, and never across more than a few instructions to keep register
+// pressure in check.
+
+namespace {
+
+// How far back a partner for an operation is searched.
+const unsigned kMaxPairDistance = 32;
+
+class DxilPair16BitOps : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilPair16BitOps() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL pair 16-bit operations";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override {
+    bool bChanged = false;
+    for (BasicBlock &BB : F)
+      bChanged |= PairInBlock(BB);
+    return bChanged;
+  }
+
+private:
+  bool PairInBlock(BasicBlock &BB);
+};
+
+char DxilPair16BitOps::ID = 0;
+
+bool Is16BitScalar(Type *Ty) {
+  return Ty->isHalfTy() || Ty->isIntegerTy(16);
+}
+
+// Returns a key identifying the kind of operation of I when it can be paired,
+// 0 otherwise. DXIL operations are numbered after the LLVM opcodes.
+unsigned GetPairKey(Instruction *I) {
+  if (!Is16BitScalar(I->getType()))
+    return 0;
+  if (isa<BinaryOperator>(I))
+    return I->getOpcode();
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+    return 0;
+  // Only pure math.
+  if (!CI->getCalledFunction()->doesNotAccessMemory())
+    return 0;
+  return Instruction::OtherOpsEnd + (unsigned)OP::GetDxilOpFuncCallInst(CI);
+}
+
+bool DxilPair16BitOps::PairInBlock(BasicBlock &BB) {
+  bool bChanged = false;
+  DenseMap<Instruction *, unsigned> Order;
+  // Last unpaired operation of each kind and type.
+  DenseMap<std::pair<unsigned, Type *>, Instruction *> Unpaired;
+
+  unsigned Idx = 0;
+  for (auto It = BB.begin(), E = BB.end(); It != E;) {
+    Instruction *I = &*(It++);
+    Order[I] = ++Idx;
+    unsigned Key = GetPairKey(I);
+    if (!Key)
+      continue;
+
+    Instruction *&Prev = Unpaired[std::make_pair(Key, I->getType())];
+    if (!Prev || Idx - Order[Prev] > kMaxPairDistance) {
+      Prev = I;
+      continue;
+    }
+
+    // I may move right after Prev if its operands are all available there.
+    bool bAvailable = true;
+    for (Value *Op : I->operands()) {
+      Instruction *OpI = dyn_cast<Instruction>(Op);
+      if (OpI && OpI->getParent() == &BB && Order[OpI] > Order[Prev]) {
+        bAvailable = false;
+        break;
+      }
+    }
+    if (!bAvailable) {
+      Prev = I;
+      continue;
+    }
+
+    if (I != Prev->getNextNode()) {
+      I->moveBefore(Prev->getNextNode());
+      bChanged = true;
+    }
+    // Now before everything after Prev.
+    Order[I] = Order[Prev];
+    Prev = nullptr;
+  }
+  return bChanged;
+}
+
+} // namespace
+
+FunctionPass *llvm::createDxilPair16BitOpsPass() {
+  return new DxilPair16BitOps();
+}
+
+INITIALIZE_PASS(DxilPair16BitOps, "hlsl-dxil-pair-16bit-ops",
+                "DXIL pair 16-bit operations", false, false)
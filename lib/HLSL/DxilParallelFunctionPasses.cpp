@@ -0,0 +1,497 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilParallelFunctionPasses.cpp                                            //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Runs a function pass pipeline over the functions of a module on several   //
+// threads.                                                                  //
+//                                                                           //
+// An LLVMContext may only be used by one thread, so the module is written   //
+// to bitcode and each worker reads it into a context of its own, keeping    //
+// only the bodies of its partition of the functions. The optimized          //
+// partitions are written back out, read into the module's context on the    //
+// calling thread and their bodies spliced into the original functions.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilParallelFunctionPasses.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include <algorithm>
+#include <exception>
+#include <system_error>
+#include <thread>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Writes the configuration of each pass added to it instead of running it,
+// so -Odump lists the pipeline the workers run.
+class PassConfigWriter : public legacy::PassManagerBase {
+  raw_ostream &OS;
+  bool First = true;
+
+public:
+  PassConfigWriter(raw_ostream &OS) : OS(OS) {}
+  void add(Pass *P) override {
+    std::unique_ptr<Pass> PPtr(P);
+    if (!First)
+      OS << '\n';
+    First = false;
+    P->dumpConfig(OS);
+  }
+};
+
+struct PartitionResult {
+  SmallVector<char, 0> Bitcode;
+  std::vector<std::pair<DiagnosticSeverity, std::string>> Diagnostics;
+  std::string Error;
+  std::exception_ptr Exception;
+};
+
+// The global values of the module, in the order bitcode preserves.
+struct GlobalSnapshot {
+  std::vector<GlobalVariable *> Globals;
+  std::vector<Function *> Functions;
+  std::vector<GlobalAlias *> Aliases;
+
+  explicit GlobalSnapshot(Module &M) {
+    for (GlobalVariable &GV : M.globals())
+      Globals.push_back(&GV);
+    for (Function &F : M)
+      Functions.push_back(&F);
+    for (GlobalAlias &GA : M.aliases())
+      Aliases.push_back(&GA);
+  }
+};
+
+template <typename ListT, typename T>
+static bool PrefixMatches(ListT &&List, const std::vector<T *> &Expected,
+                          std::vector<T *> &Found) {
+  for (auto &GV : List)
+    Found.push_back(&GV);
+  if (Found.size() < Expected.size())
+    return false;
+  for (size_t i = 0, e = Expected.size(); i != e; ++i) {
+    if (Found[i]->getName() != Expected[i]->getName())
+      return false;
+  }
+  return true;
+}
+
+// Reading a partition back into the module's context gives it its own copy
+// of every named struct, renamed with a numeric suffix. This maps those
+// copies, and the types built from them, onto the module's types.
+class PartitionTypeMapper : public ValueMapTypeRemapper {
+  Module &M;
+  DenseMap<Type *, Type *> MappedTypes;
+
+  StructType *findModuleStruct(StructType *SrcTy) {
+    StringRef Name = SrcTy->getName();
+    size_t Dot = Name.rfind('.');
+    if (Dot == StringRef::npos || Dot + 1 == Name.size() ||
+        Name.find_first_not_of("0123456789", Dot + 1) != StringRef::npos)
+      return SrcTy;
+    StructType *DstTy = M.getTypeByName(Name.substr(0, Dot));
+    if (DstTy == nullptr || DstTy->isPacked() != SrcTy->isPacked() ||
+        DstTy->getNumElements() != SrcTy->getNumElements())
+      return SrcTy;
+    return DstTy;
+  }
+
+public:
+  PartitionTypeMapper(Module &M) : M(M) {}
+
+  // Records that SrcTy stands for DstTy, along with all of their member types.
+  void addTypeMapping(Type *DstTy, Type *SrcTy) {
+    if (DstTy == SrcTy || DstTy->getTypeID() != SrcTy->getTypeID() ||
+        DstTy->getNumContainedTypes() != SrcTy->getNumContainedTypes())
+      return;
+    if (!MappedTypes.insert(std::make_pair(SrcTy, DstTy)).second)
+      return;
+    for (unsigned i = 0, e = SrcTy->getNumContainedTypes(); i != e; ++i)
+      addTypeMapping(DstTy->getContainedType(i), SrcTy->getContainedType(i));
+  }
+
+  Type *remapType(Type *SrcTy) override {
+    auto It = MappedTypes.find(SrcTy);
+    if (It != MappedTypes.end())
+      return It->second;
+
+    Type *DstTy = SrcTy;
+    StructType *ST = dyn_cast<StructType>(SrcTy);
+    if (ST && !ST->isLiteral()) {
+      if (ST->hasName())
+        DstTy = findModuleStruct(ST);
+    } else if (SrcTy->getNumContainedTypes() != 0) {
+      SmallVector<Type *, 8> Elts;
+      bool Changed = false;
+      for (Type *Elt : SrcTy->subtypes()) {
+        Elts.push_back(remapType(Elt));
+        Changed |= Elts.back() != Elt;
+      }
+      if (Changed) {
+        switch (SrcTy->getTypeID()) {
+        case Type::ArrayTyID:
+          DstTy = ArrayType::get(Elts[0], SrcTy->getArrayNumElements());
+          break;
+        case Type::VectorTyID:
+          DstTy = VectorType::get(Elts[0], SrcTy->getVectorNumElements());
+          break;
+        case Type::PointerTyID:
+          DstTy = PointerType::get(Elts[0], SrcTy->getPointerAddressSpace());
+          break;
+        case Type::FunctionTyID:
+          DstTy = FunctionType::get(Elts[0], makeArrayRef(Elts).slice(1),
+                                    cast<FunctionType>(SrcTy)->isVarArg());
+          break;
+        case Type::StructTyID:
+          DstTy = StructType::get(SrcTy->getContext(), Elts, ST->isPacked());
+          break;
+        default:
+          llvm_unreachable("unexpected type with contained types");
+        }
+      }
+    }
+    MappedTypes[SrcTy] = DstTy;
+    return DstTy;
+  }
+};
+
+// Moves the function bodies of one optimized partition into the module.
+class PartitionMerger : public ValueMaterializer {
+  Module &M;
+  std::unique_ptr<Module> Partition;
+  std::vector<GlobalVariable *> SrcGlobals;
+  std::vector<Function *> SrcFunctions;
+  std::vector<GlobalAlias *> SrcAliases;
+  ValueToValueMapTy VMap;
+  PartitionTypeMapper Types;
+  SmallVector<std::pair<GlobalVariable *, GlobalVariable *>, 4> PendingInitializers;
+
+public:
+  PartitionMerger(Module &M, std::unique_ptr<Module> P)
+      : M(M), Partition(std::move(P)), Types(M) {}
+
+  // Maps the partition's global values onto the module's by position; fails
+  // if they don't line up.
+  bool init(const GlobalSnapshot &Snapshot) {
+    if (!PrefixMatches(Partition->globals(), Snapshot.Globals, SrcGlobals) ||
+        !PrefixMatches(*Partition, Snapshot.Functions, SrcFunctions) ||
+        !PrefixMatches(Partition->aliases(), Snapshot.Aliases, SrcAliases))
+      return false;
+    auto Seed = [&](GlobalValue *Dst, GlobalValue *Src) {
+      VMap[Src] = Dst;
+      Types.addTypeMapping(Dst->getType(), Src->getType());
+    };
+    for (size_t i = 0, e = Snapshot.Globals.size(); i != e; ++i)
+      Seed(Snapshot.Globals[i], SrcGlobals[i]);
+    for (size_t i = 0, e = Snapshot.Functions.size(); i != e; ++i)
+      Seed(Snapshot.Functions[i], SrcFunctions[i]);
+    for (size_t i = 0, e = Snapshot.Aliases.size(); i != e; ++i)
+      Seed(Snapshot.Aliases[i], SrcAliases[i]);
+    return true;
+  }
+
+  // Replaces the body of Dst with the optimized body of the function at the
+  // same position in the partition.
+  void moveBody(Function &Dst, size_t Index) {
+    Function &Src = *SrcFunctions[Index];
+    for (BasicBlock &BB : Dst)
+      BB.dropAllReferences();
+    while (!Dst.empty())
+      Dst.begin()->eraseFromParent();
+
+    Function::arg_iterator DI = Dst.arg_begin();
+    for (Argument &Arg : Src.args())
+      VMap[&Arg] = DI++;
+    Dst.setAttributes(Src.getAttributes());
+    Dst.getBasicBlockList().splice(Dst.end(), Src.getBasicBlockList());
+    for (BasicBlock &BB : Dst)
+      for (Instruction &I : BB)
+        RemapInstruction(&I, VMap, RF_IgnoreMissingEntries, &Types, this);
+    for (Argument &Arg : Src.args())
+      VMap.erase(&Arg);
+
+    while (!PendingInitializers.empty()) {
+      auto Pending = PendingInitializers.pop_back_val();
+      Pending.first->setInitializer(cast<Constant>(
+          MapValue(Pending.second->getInitializer(), VMap, RF_None, &Types,
+                   this)));
+    }
+  }
+
+  // Creates the globals the passes added to the partition, such as intrinsic
+  // declarations and switch tables, in the module.
+  Value *materializeValueFor(Value *V) override {
+    if (Function *SrcF = dyn_cast<Function>(V)) {
+      FunctionType *FTy =
+          cast<FunctionType>(Types.remapType(SrcF->getFunctionType()));
+      Function *F = M.getFunction(SrcF->getName());
+      if (F && F->getFunctionType() == FTy)
+        return F;
+      F = Function::Create(FTy, SrcF->getLinkage(), SrcF->getName(), &M);
+      F->copyAttributesFrom(SrcF);
+      return F;
+    }
+    if (GlobalVariable *SrcGV = dyn_cast<GlobalVariable>(V)) {
+      GlobalVariable *GV = new GlobalVariable(
+          M, Types.remapType(SrcGV->getType()->getElementType()),
+          SrcGV->isConstant(), SrcGV->getLinkage(), nullptr, SrcGV->getName(),
+          nullptr, SrcGV->getThreadLocalMode(),
+          SrcGV->getType()->getAddressSpace());
+      GV->copyAttributesFrom(SrcGV);
+      if (SrcGV->hasInitializer())
+        PendingInitializers.push_back(std::make_pair(GV, SrcGV));
+      return GV;
+    }
+    DXASSERT(!isa<GlobalValue>(V), "function passes should not add aliases");
+    return nullptr;
+  }
+};
+
+static void CollectDiagnostic(const DiagnosticInfo &DI, void *Context) {
+  std::string Message;
+  raw_string_ostream OS(Message);
+  DiagnosticPrinterRawOStream DP(OS);
+  DI.print(DP);
+  OS.flush();
+  auto *Diagnostics =
+      static_cast<std::vector<std::pair<DiagnosticSeverity, std::string>> *>(
+          Context);
+  Diagnostics->emplace_back(DI.getSeverity(), std::move(Message));
+}
+
+class DxilParallelFunctionPasses : public ModulePass {
+  FunctionPipelineBuilder AddPasses;
+  unsigned ThreadCount;
+
+  bool runSerially(Module &M);
+  void optimizePartition(StringRef Input, const std::vector<int> &PartitionOf,
+                         int Partition, const ShaderModel *pSM,
+                         bool UseMinPrecision, PartitionResult &Result);
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  DxilParallelFunctionPasses(FunctionPipelineBuilder AddPasses,
+                             unsigned ThreadCount)
+      : ModulePass(ID), AddPasses(std::move(AddPasses)),
+        ThreadCount(ThreadCount) {}
+
+  const char *getPassName() const override {
+    return "DXIL Parallel Function Passes";
+  }
+
+  void dumpConfig(raw_ostream &OS) override {
+    PassConfigWriter Writer(OS);
+    AddPasses(Writer);
+  }
+
+  bool runOnModule(Module &M) override;
+};
+
+char DxilParallelFunctionPasses::ID = 0;
+
+bool DxilParallelFunctionPasses::runSerially(Module &M) {
+  legacy::FunctionPassManager FPM(&M);
+  AddPasses(FPM);
+  bool Changed = FPM.doInitialization();
+  for (Function &F : M) {
+    if (!F.isDeclaration())
+      Changed |= FPM.run(F);
+  }
+  Changed |= FPM.doFinalization();
+  return Changed;
+}
+
+void DxilParallelFunctionPasses::optimizePartition(
+    StringRef Input, const std::vector<int> &PartitionOf, int Partition,
+    const ShaderModel *pSM, bool UseMinPrecision, PartitionResult &Result) {
+  LLVMContext Context;
+  Context.setDiagnosticHandler(CollectDiagnostic, &Result.Diagnostics,
+                               /*RespectFilters*/ true);
+  ErrorOr<std::unique_ptr<Module>> ModuleOrErr = getLazyBitcodeModule(
+      MemoryBuffer::getMemBuffer(Input, "", false), Context);
+  if (std::error_code EC = ModuleOrErr.getError()) {
+    Result.Error = EC.message();
+    return;
+  }
+  Module &M = *ModuleOrErr.get();
+
+  // Functions outside this partition are only called, so keep them as
+  // declarations and never read their bodies.
+  std::vector<Function *> Work;
+  size_t Index = 0;
+  for (Function &F : M) {
+    if (PartitionOf[Index++] == Partition)
+      Work.push_back(&F);
+    else if (!F.isDeclaration())
+      F.deleteBody();
+  }
+  if (std::error_code EC = M.materializeAll()) {
+    Result.Error = EC.message();
+    return;
+  }
+
+  // Constant folding of DXIL operations needs the shader model and the
+  // operation tables.
+  if (pSM)
+    M.GetOrCreateDxilModule(/*skipInit*/ true).SetShaderModel(pSM, UseMinPrecision);
+
+  legacy::FunctionPassManager FPM(&M);
+  AddPasses(FPM);
+  FPM.doInitialization();
+  for (Function *F : Work)
+    FPM.run(*F);
+  FPM.doFinalization();
+
+  raw_svector_ostream OS(Result.Bitcode);
+  WriteBitcodeToFile(&M, OS, /*ShouldPreserveUseListOrder*/ true);
+  OS.flush();
+}
+
+bool DxilParallelFunctionPasses::runOnModule(Module &M) {
+  GlobalSnapshot Snapshot(M);
+  std::vector<size_t> Defined;
+  for (size_t i = 0, e = Snapshot.Functions.size(); i != e; ++i) {
+    if (!Snapshot.Functions[i]->isDeclaration())
+      Defined.push_back(i);
+  }
+
+  // Moving bodies between modules would give every function a second copy
+  // of its debug info, so modules with debug info stay on this thread.
+  unsigned PartitionCount =
+      (unsigned)std::min<size_t>(ThreadCount, Defined.size());
+  if (PartitionCount < 2 || M.getNamedMetadata("llvm.dbg.cu"))
+    return runSerially(M);
+
+  // Hand out functions largest first, each to the partition with the fewest
+  // instructions so far.
+  std::vector<size_t> Sizes(Snapshot.Functions.size());
+  for (size_t i : Defined) {
+    for (BasicBlock &BB : *Snapshot.Functions[i])
+      Sizes[i] += BB.size();
+  }
+  std::vector<size_t> Order(Defined);
+  std::stable_sort(Order.begin(), Order.end(),
+                   [&](size_t a, size_t b) { return Sizes[a] > Sizes[b]; });
+  std::vector<int> PartitionOf(Snapshot.Functions.size(), -1);
+  std::vector<size_t> Load(PartitionCount);
+  for (size_t i : Order) {
+    size_t Smallest = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    PartitionOf[i] = (int)Smallest;
+    Load[Smallest] += Sizes[i];
+  }
+
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS, /*ShouldPreserveUseListOrder*/ true);
+  }
+  StringRef Input(Bitcode.data(), Bitcode.size());
+
+  const ShaderModel *pSM = nullptr;
+  bool UseMinPrecision = true;
+  if (M.HasDxilModule()) {
+    pSM = M.GetDxilModule().GetShaderModel();
+    UseMinPrecision = M.GetDxilModule().GetUseMinPrecision();
+  }
+
+  std::vector<PartitionResult> Results(PartitionCount);
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  CancellationCheck *pCancellation = CancellationCheck::getCurrent();
+  auto Worker = [&](unsigned Partition) {
+    DxcThreadMalloc TM(pMalloc);
+    // Pass timings are per thread; keep the workers' out of the report.
+    PhaseTimingListener *pPriorListener = PhaseTimingListener::setCurrent(nullptr);
+    // Cancelling the compile stops every partition.
+    CancellationCheck *pPriorCancellation =
+        CancellationCheck::setCurrent(pCancellation);
+    PartitionResult &Result = Results[Partition];
+    try {
+      optimizePartition(Input, PartitionOf, Partition, pSM, UseMinPrecision,
+                        Result);
+    } catch (...) {
+      Result.Exception = std::current_exception();
+    }
+    CancellationCheck::setCurrent(pPriorCancellation);
+    PhaseTimingListener::setCurrent(pPriorListener);
+  };
+
+  // The calling thread takes the first partition.
+  std::vector<std::thread> Threads;
+  for (unsigned i = 1; i < PartitionCount; ++i) {
+    try {
+      Threads.emplace_back(Worker, i);
+    } catch (const std::system_error &) {
+      Worker(i);
+    }
+  }
+  Worker(0);
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  for (PartitionResult &Result : Results) {
+    if (Result.Exception)
+      std::rethrow_exception(Result.Exception);
+  }
+  for (PartitionResult &Result : Results) {
+    if (!Result.Error.empty())
+      return runSerially(M);
+  }
+
+  // Read every partition back before changing anything, so a partition that
+  // doesn't line up with the module can still fall back to the serial path.
+  LLVMContext &Context = M.getContext();
+  std::vector<std::unique_ptr<PartitionMerger>> Mergers;
+  for (PartitionResult &Result : Results) {
+    ErrorOr<std::unique_ptr<Module>> PartitionOrErr = parseBitcodeFile(
+        MemoryBufferRef(StringRef(Result.Bitcode.data(), Result.Bitcode.size()),
+                        M.getModuleIdentifier()),
+        Context);
+    if (!PartitionOrErr)
+      return runSerially(M);
+    Mergers.emplace_back(
+        llvm::make_unique<PartitionMerger>(M, std::move(PartitionOrErr.get())));
+    if (!Mergers.back()->init(Snapshot))
+      return runSerially(M);
+    Result.Bitcode.clear();
+  }
+
+  for (PartitionResult &Result : Results) {
+    for (auto &Diag : Result.Diagnostics)
+      Context.diagnose(
+          DiagnosticInfoDxil(nullptr, nullptr, Diag.second, Diag.first));
+  }
+
+  // Merge in module order so the result doesn't depend on the partitioning.
+  for (size_t i : Defined)
+    Mergers[PartitionOf[i]]->moveBody(*Snapshot.Functions[i], i);
+  return true;
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilParallelFunctionPassesPass(
+    FunctionPipelineBuilder AddPasses, unsigned ThreadCount) {
+  return new DxilParallelFunctionPasses(std::move(AddPasses), ThreadCount);
+}
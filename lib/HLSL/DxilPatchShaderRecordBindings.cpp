@@ -34,6 +34,8 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Scalar.h"
@@ -95,6 +97,20 @@ struct ShaderRecordEntry {
   bool IsInvalid() { return (unsigned int)ParameterType == (unsigned int)-1; }
 };
 
+// Registers [BaseShaderRegister, BaseShaderRegister + NumDescriptors) bound
+// by one root parameter or descriptor range.
+struct ShaderRecordBinding {
+  unsigned int BaseShaderRegister;
+  unsigned int NumDescriptors;
+  ShaderRecordEntry Entry; // for BaseShaderRegister
+};
+
+// The bindings of a local root signature by resource class and register
+// space, each list in root signature order.
+typedef llvm::DenseMap<std::pair<unsigned int, unsigned int>,
+                       llvm::SmallVector<ShaderRecordBinding, 4>>
+    ShaderRecordBindingMap;
+
 struct D3D12_VERSIONED_ROOT_SIGNATURE_DESC;
 class DxilPatchShaderRecordBindings : public ModulePass {
 public:
@@ -152,7 +168,9 @@ private:
   // Unlike the LLVM version of this function, this does not requires the InstructionToReplace and the ValueToReplaceWith to be the same instruction type
   static void ReplaceUsesOfWith(llvm::Instruction *InstructionToReplace, llvm::Value *ValueToReplaceWith);
 
-  static ShaderRecordEntry FindRootSignatureDescriptor(const DxilVersionedRootSignatureDesc &rootSignatureDescriptor, unsigned int ShaderRecordIdentifierSizeInBytes, DXIL::ResourceClass resourceClass, unsigned int baseRegisterIndex, unsigned int registerSpace);
+  void InitializeRootSignatureBindings();
+  ShaderRecordEntry FindRootSignatureDescriptor(DXIL::ResourceClass resourceClass, unsigned int baseRegisterIndex, unsigned int registerSpace);
+  DxilResourceBase *FindResource(DxilModule &DM, llvm::Value *ResourceSymbol);
 
   // TODO: I would like to see these prefixed with m_
   llvm::Value *ShaderTableHandle = nullptr;
@@ -178,6 +196,12 @@ private:
   ShaderInfo *pInputShaderInfo;
   const DxilVersionedRootSignatureDesc *pRootSignatureDesc;
   DXIL::ShaderKind ShaderKind;
+
+  // Built once per run, rather than walking the root signature and the
+  // resource lists for each handle.
+  ShaderRecordBindingMap RootSignatureBindings;
+  llvm::DenseMap<llvm::Value *, DxilResourceBase *> ResourceBySymbol;
+  size_t NumResourcesBySymbol = 0;
 };
 
 char DxilPatchShaderRecordBindings::ID = 0;
@@ -393,6 +417,9 @@ bool DxilPatchShaderRecordBindings::runOnModule(Module &M) {
 
   ValidateParameters();
   InitializeViewTable();
+  InitializeRootSignatureBindings();
+  ResourceBySymbol.clear();
+  NumResourcesBySymbol = 0;
 
   PatchShaderBindings(M);
   DM.ReEmitDxilResources();
@@ -702,7 +729,41 @@ unsigned int GetResolvedRangeID(DXIL::ResourceClass resClass, Value *rangeIdVal)
   }
 }
 
-// TODO: This code is quite inefficient
+template <typename T>
+void AddResourcesBySymbol(
+    const std::vector<std::unique_ptr<T>> &resources,
+    llvm::DenseMap<llvm::Value *, DxilResourceBase *> &resourceBySymbol) {
+  for (auto &resource : resources)
+    resourceBySymbol.insert(
+        std::make_pair(resource->GetGlobalSymbol(), resource.get()));
+}
+
+// Finds the resource declared by ResourceSymbol. The pass declares
+// resources of its own as it goes, so the map is rebuilt when a symbol is
+// missing and the resource lists have grown.
+DxilResourceBase *DxilPatchShaderRecordBindings::FindResource(
+  DxilModule &DM, llvm::Value *ResourceSymbol)
+{
+  auto it = ResourceBySymbol.find(ResourceSymbol);
+  if (it != ResourceBySymbol.end())
+    return it->second;
+
+  size_t numResources = DM.GetCBuffers().size() + DM.GetSRVs().size() +
+                        DM.GetUAVs().size() + DM.GetSamplers().size();
+  if (numResources == NumResourcesBySymbol)
+    return nullptr;
+  NumResourcesBySymbol = numResources;
+
+  // Keep the first resource of a symbol, like the search in class order did.
+  AddResourcesBySymbol(DM.GetCBuffers(), ResourceBySymbol);
+  AddResourcesBySymbol(DM.GetSRVs(), ResourceBySymbol);
+  AddResourcesBySymbol(DM.GetUAVs(), ResourceBySymbol);
+  AddResourcesBySymbol(DM.GetSamplers(), ResourceBySymbol);
+
+  it = ResourceBySymbol.find(ResourceSymbol);
+  return it != ResourceBySymbol.end() ? it->second : nullptr;
+}
+
 bool DxilPatchShaderRecordBindings::GetHandleInfo(
   Module &M,
   DxilInst_CreateHandleForLib &createHandleStructForLib,
@@ -716,61 +777,7 @@ bool DxilPatchShaderRecordBindings::GetHandleInfo(
   LoadInst *loadRangeId = cast<LoadInst>(createHandleStructForLib.get_Resource());
   Value *ResourceSymbol = loadRangeId->getPointerOperand();
 
-  DXIL::ResourceClass resourceClasses[] = {
-    DXIL::ResourceClass::CBuffer,
-    DXIL::ResourceClass::SRV,
-    DXIL::ResourceClass::UAV,
-    DXIL::ResourceClass::Sampler
-  };
-
-  hlsl::DxilResourceBase *Resource = nullptr;
-  for (auto &resourceClass : resourceClasses) {
-    
-    switch (resourceClass)
-    {
-    case DXIL::ResourceClass::CBuffer:
-    {
-      auto &cbuffers = DM.GetCBuffers();
-      for (auto &cbuffer : cbuffers)
-      {
-        if (cbuffer->GetGlobalSymbol() == ResourceSymbol)
-        {
-          Resource = cbuffer.get();
-          break;
-        }
-      }
-      break;
-    }
-    case DXIL::ResourceClass::SRV:
-    case DXIL::ResourceClass::UAV:
-    {
-      auto &viewList = resourceClass == DXIL::ResourceClass::SRV ? DM.GetSRVs() : DM.GetUAVs();
-      for (auto &view : viewList)
-      {
-        if (view->GetGlobalSymbol() == ResourceSymbol)
-        {
-          Resource = view.get();
-          break;
-        }
-      }
-      break;
-    }
-    case DXIL::ResourceClass::Sampler:
-    {
-      auto &samplers = DM.GetSamplers();
-      for (auto &sampler : samplers)
-      {
-        if (sampler->GetGlobalSymbol() == ResourceSymbol)
-        {
-          Resource = sampler.get();
-          break;
-        }
-      }
-      break;
-    }
-    }
-  }
-
+  hlsl::DxilResourceBase *Resource = FindResource(DM, ResourceSymbol);
   if (Resource)
   {
     registerSpace = Resource->GetSpaceID();
@@ -863,8 +870,6 @@ void DxilPatchShaderRecordBindings::PatchShaderBindings(Module &M) {
         if (!resourceIsResolved) continue; // TODO: This shouldn't actually be happening?
 
         ShaderRecordEntry shaderRecord = FindRootSignatureDescriptor(
-          *pRootSignatureDesc,
-          pInputShaderInfo->ShaderRecordIdentifierSizeInBytes,
           resourceClass,
           registerIndex,
           registerSpace);
@@ -982,25 +987,6 @@ void DxilPatchShaderRecordBindings::PatchShaderBindings(Module &M) {
 
 }
 
-bool IsParameterTypeCompatibleWithResourceClass(
-  DXIL::ResourceClass resourceClass,
-  DxilRootParameterType parameterType) {
-  switch (parameterType) {
-  case DxilRootParameterType::DescriptorTable:
-    return true;
-  case DxilRootParameterType::Constants32Bit:
-  case DxilRootParameterType::CBV:
-    return resourceClass == DXIL::ResourceClass::CBuffer;
-  case DxilRootParameterType::SRV:
-    return resourceClass == DXIL::ResourceClass::SRV;
-  case DxilRootParameterType::UAV:
-    return resourceClass == DXIL::ResourceClass::UAV;
-  default:
-    ThrowFailure();
-    return false;
-  }
-}
-
 DxilRootParameterType ConvertD3D12ParameterTypeToDxil(DxilRootParameterType parameter) {
   switch (parameter) {
   case DxilRootParameterType::Constants32Bit:
@@ -1049,100 +1035,122 @@ unsigned int GetParameterTypeAlignment(DxilRootParameterType parameterType) {
   }
 }
 
+void AddShaderRecordBinding(ShaderRecordBindingMap &bindings,
+                            DXIL::ResourceClass resourceClass,
+                            unsigned int registerSpace,
+                            unsigned int baseShaderRegister,
+                            unsigned int numDescriptors,
+                            ShaderRecordEntry entry) {
+  bindings[std::make_pair((unsigned int)resourceClass, registerSpace)]
+      .push_back({baseShaderRegister, numDescriptors, entry});
+}
+
 template <typename TD3D12_ROOT_SIGNATURE_DESC>
-ShaderRecordEntry FindRootSignatureDescriptorHelper(
+void CollectRootSignatureBindings(
     const TD3D12_ROOT_SIGNATURE_DESC &rootSignatureDescriptor,
     unsigned int ShaderRecordIdentifierSizeInBytes,
-    DXIL::ResourceClass resourceClass, unsigned int baseRegisterIndex,
-    unsigned int registerSpace) {
-  // Automatically fail if it's looking for a fallback binding as these never
-  // need to be patched
-  if (registerSpace != FallbackLayerRegisterSpace) {
-    unsigned int recordOffset = ShaderRecordIdentifierSizeInBytes;
-    for (unsigned int rootParamIndex = 0;
-         rootParamIndex < rootSignatureDescriptor.NumParameters;
-         rootParamIndex++) {
-      auto &rootParam = rootSignatureDescriptor.pParameters[rootParamIndex];
-      auto dxilParamType =
-          ConvertD3D12ParameterTypeToDxil(rootParam.ParameterType);
+    ShaderRecordBindingMap &bindings) {
+  unsigned int recordOffset = ShaderRecordIdentifierSizeInBytes;
+  for (unsigned int rootParamIndex = 0;
+       rootParamIndex < rootSignatureDescriptor.NumParameters;
+       rootParamIndex++) {
+    auto &rootParam = rootSignatureDescriptor.pParameters[rootParamIndex];
+    auto dxilParamType =
+        ConvertD3D12ParameterTypeToDxil(rootParam.ParameterType);
 
 #define ALIGN(alignment, num) (((num + alignment - 1) / alignment) * alignment)
-      recordOffset = ALIGN(GetParameterTypeAlignment(rootParam.ParameterType),
-                           recordOffset);
-
-      switch (rootParam.ParameterType) {
-      case DxilRootParameterType::Constants32Bit:
-        if (IsParameterTypeCompatibleWithResourceClass(resourceClass,
-                                                       dxilParamType) &&
-            baseRegisterIndex == rootParam.Constants.ShaderRegister &&
-            registerSpace == rootParam.Constants.RegisterSpace) {
-          return {dxilParamType, recordOffset, 0};
+    recordOffset = ALIGN(GetParameterTypeAlignment(rootParam.ParameterType),
+                         recordOffset);
+
+    switch (rootParam.ParameterType) {
+    case DxilRootParameterType::Constants32Bit:
+      AddShaderRecordBinding(bindings, DXIL::ResourceClass::CBuffer,
+                             rootParam.Constants.RegisterSpace,
+                             rootParam.Constants.ShaderRegister, 1,
+                             {dxilParamType, recordOffset, 0});
+      recordOffset += rootParam.Constants.Num32BitValues * sizeof(uint32_t);
+      break;
+    case DxilRootParameterType::DescriptorTable: {
+      auto &descriptorTable = rootParam.DescriptorTable;
+
+      unsigned int rangeOffsetInDescriptors = 0;
+      for (unsigned int rangeIndex = 0;
+           rangeIndex < descriptorTable.NumDescriptorRanges; rangeIndex++) {
+        auto &range = descriptorTable.pDescriptorRanges[rangeIndex];
+        if (range.OffsetInDescriptorsFromTableStart != (unsigned)-1) {
+          rangeOffsetInDescriptors = range.OffsetInDescriptorsFromTableStart;
         }
-        recordOffset += rootParam.Constants.Num32BitValues * sizeof(uint32_t);
-        break;
-      case DxilRootParameterType::DescriptorTable: {
-        auto &descriptorTable = rootParam.DescriptorTable;
-
-        unsigned int rangeOffsetInDescriptors = 0;
-        for (unsigned int rangeIndex = 0;
-             rangeIndex < descriptorTable.NumDescriptorRanges; rangeIndex++) {
-          auto &range = descriptorTable.pDescriptorRanges[rangeIndex];
-          if (range.OffsetInDescriptorsFromTableStart != (unsigned)-1) {
-            rangeOffsetInDescriptors = range.OffsetInDescriptorsFromTableStart;
-          }
-
-          if (ConvertD3D12RangeTypeToDxil(range.RangeType) == resourceClass &&
-              range.RegisterSpace == registerSpace &&
-              range.BaseShaderRegister <= baseRegisterIndex &&
-              range.BaseShaderRegister + range.NumDescriptors >
-                  baseRegisterIndex) {
-            rangeOffsetInDescriptors +=
-                baseRegisterIndex - range.BaseShaderRegister;
-            return {dxilParamType, recordOffset, rangeOffsetInDescriptors};
-          }
 
-          rangeOffsetInDescriptors += range.NumDescriptors;
-        }
+        AddShaderRecordBinding(bindings,
+                               ConvertD3D12RangeTypeToDxil(range.RangeType),
+                               range.RegisterSpace, range.BaseShaderRegister,
+                               range.NumDescriptors,
+                               {dxilParamType, recordOffset,
+                                rangeOffsetInDescriptors});
 
-        recordOffset += SizeofD3D12GpuDescriptorHandle;
-        break;
+        rangeOffsetInDescriptors += range.NumDescriptors;
       }
-      case DxilRootParameterType::CBV:
-      case DxilRootParameterType::SRV:
-      case DxilRootParameterType::UAV:
-        if (IsParameterTypeCompatibleWithResourceClass(resourceClass,
-                                                       dxilParamType) &&
-            baseRegisterIndex == rootParam.Descriptor.ShaderRegister &&
-            registerSpace == rootParam.Descriptor.RegisterSpace) {
-          return {dxilParamType, recordOffset, 0};
-        }
 
-        recordOffset += SizeofD3D12GpuVA;
-        break;
-      }
+      recordOffset += SizeofD3D12GpuDescriptorHandle;
+      break;
+    }
+    case DxilRootParameterType::CBV:
+    case DxilRootParameterType::SRV:
+    case DxilRootParameterType::UAV:
+      AddShaderRecordBinding(
+          bindings,
+          dxilParamType == DxilRootParameterType::CBV
+              ? DXIL::ResourceClass::CBuffer
+              : dxilParamType == DxilRootParameterType::SRV
+                    ? DXIL::ResourceClass::SRV
+                    : DXIL::ResourceClass::UAV,
+          rootParam.Descriptor.RegisterSpace,
+          rootParam.Descriptor.ShaderRegister, 1,
+          {dxilParamType, recordOffset, 0});
+
+      recordOffset += SizeofD3D12GpuVA;
+      break;
     }
   }
-  return ShaderRecordEntry::InvalidEntry();
 }
 
-// TODO: Consider pre-calculating this into a map
-ShaderRecordEntry DxilPatchShaderRecordBindings::FindRootSignatureDescriptor(
-  const DxilVersionedRootSignatureDesc &rootSignatureDescriptor,
-  unsigned int ShaderRecordIdentifierSizeInBytes,
-  DXIL::ResourceClass resourceClass,
-  unsigned int baseRegisterIndex,
-  unsigned int registerSpace) {
-  switch (rootSignatureDescriptor.Version) {
+void DxilPatchShaderRecordBindings::InitializeRootSignatureBindings() {
+  RootSignatureBindings.clear();
+  switch (pRootSignatureDesc->Version) {
   case DxilRootSignatureVersion::Version_1_0:
-    return FindRootSignatureDescriptorHelper(rootSignatureDescriptor.Desc_1_0, ShaderRecordIdentifierSizeInBytes, resourceClass, baseRegisterIndex, registerSpace);
+    CollectRootSignatureBindings(pRootSignatureDesc->Desc_1_0, pInputShaderInfo->ShaderRecordIdentifierSizeInBytes, RootSignatureBindings);
+    break;
   case DxilRootSignatureVersion::Version_1_1:
-    return FindRootSignatureDescriptorHelper(rootSignatureDescriptor.Desc_1_1, ShaderRecordIdentifierSizeInBytes, resourceClass, baseRegisterIndex, registerSpace);
+    CollectRootSignatureBindings(pRootSignatureDesc->Desc_1_1, pInputShaderInfo->ShaderRecordIdentifierSizeInBytes, RootSignatureBindings);
+    break;
   default:
     ThrowFailure();
-    return ShaderRecordEntry::InvalidEntry();
   }
 }
 
+ShaderRecordEntry DxilPatchShaderRecordBindings::FindRootSignatureDescriptor(
+  DXIL::ResourceClass resourceClass,
+  unsigned int baseRegisterIndex,
+  unsigned int registerSpace) {
+  // Automatically fail if it's looking for a fallback binding as these never
+  // need to be patched
+  if (registerSpace == FallbackLayerRegisterSpace)
+    return ShaderRecordEntry::InvalidEntry();
 
+  auto it = RootSignatureBindings.find(
+      std::make_pair((unsigned int)resourceClass, registerSpace));
+  if (it == RootSignatureBindings.end())
+    return ShaderRecordEntry::InvalidEntry();
 
-
+  // The first parameter binding the register wins.
+  for (const ShaderRecordBinding &binding : it->second) {
+    if (binding.BaseShaderRegister <= baseRegisterIndex &&
+        binding.BaseShaderRegister + binding.NumDescriptors >
+            baseRegisterIndex) {
+      ShaderRecordEntry entry = binding.Entry;
+      entry.OffsetInDescriptors += baseRegisterIndex - binding.BaseShaderRegister;
+      return entry;
+    }
+  }
+  return ShaderRecordEntry::InvalidEntry();
+}
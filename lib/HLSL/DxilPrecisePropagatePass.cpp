@@ -44,17 +44,26 @@ public:
 
   const char *getPassName() const override { return "DXIL Precise Propagate"; }
 
+  // Propagation starts from the dx.attribute.precise calls and only visits
+  // what they reach, so a module without precise values is only scanned for
+  // the marker functions.
   bool runOnModule(Module &M) override {
-    m_pDM = &(M.GetOrCreateDxilModule());
     std::vector<Function*> deadList;
     for (Function &F : M.functions()) {
-      if (HLModule::HasPreciseAttribute(&F)) {
-        PropagatePreciseOnFunctionUser(F);
+      if (HLModule::HasPreciseAttribute(&F))
         deadList.emplace_back(&F);
-      }
     }
-    for (Function *F : deadList)
+    if (deadList.empty())
+      return false;
+
+    m_pDM = &(M.GetOrCreateDxilModule());
+    for (Function *F : deadList) {
+      PropagatePreciseOnFunctionUser(*F);
       F->eraseFromParent();
+    }
+    // Release the post dominator trees built for control dependence.
+    m_FuncInfo.clear();
+    m_ProcessedSet.clear();
     return true;
   }
 
@@ -103,6 +112,11 @@ void DxilPrecisePropagatePass::PropagatePreciseOnFunctionUser(Function &F) {
 }
 
 void DxilPrecisePropagatePass::AddToWorkList(Value *V) {
+  // Constants other than pointers, blocks and metadata carry no precision.
+  if ((isa<Constant>(V) && !V->getType()->isPointerTy()) ||
+      isa<BasicBlock>(V) || isa<MetadataAsValue>(V))
+    return;
+
   // Skip values already marked.
   if (Processed(V))
     return;
@@ -19,6 +19,7 @@
 #include "dxc/DXIL/DxilEntryProps.h"
 #include "dxc/DXIL/DxilFunctionProps.h"
 #include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/HlslIntrinsicOp.h"
 #include "llvm/IR/GetElementPtrTypeIterator.h"
@@ -768,6 +769,9 @@ public:
       // Remove unused AllocateRayQuery calls
       RemoveUnusedRayQuery(M);
 
+      // Drop the markers of arrays kept in memory, which validation rejects.
+      RemoveIndexableAllocaMarkers(M);
+
       if (IsLib && DXIL::CompareVersions(ValMajor, ValMinor, 1, 4) <= 0) {
         // 1.4 validator requires function annotations for all functions
         AddFunctionAnnotationForInitializers(M, DM);
@@ -1026,6 +1030,18 @@ private:
     }
   }
 
+  void RemoveIndexableAllocaMarkers(Module &M) {
+    unsigned Kind =
+        M.getContext().getMDKindID(DxilMDHelper::kDxilIndexableAllocaMDName);
+    for (Function &F : M) {
+      if (F.isDeclaration())
+        continue;
+      for (Instruction &I : F.getEntryBlock())
+        if (isa<AllocaInst>(I))
+          I.setMetadata(Kind, nullptr);
+    }
+  }
+
   // Convert all uses of dx.break() into per-function load/cmp of dx.break.cond global constant
   void LowerDxBreak(Module &M) {
     if (Function *BreakFunc = M.getFunction(DXIL::kDxBreakFuncName)) {
@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSpecializeConstants.cpp                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Substitute values for specialization constant placeholders.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilValidation.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include <cstdlib>
+#include <map>
+
+using namespace llvm;
+using namespace hlsl;
+
+// With -spec-constants, reads of [[vk::constant_id(N)]] globals compile to
+//   <ty> @dx.specconst.<ty>(i32 N, <ty> default)
+// so one compile can be specialized many times without going through the
+// front end again.
+//
+// This pass replaces each placeholder with the value given for its id in the
+// "values" option ("id=value;id=value..."), or its default, then folds what
+// became constant with SCCP, InstCombine, SimplifyCFG and DCE, updates the
+// shader flags and validates the result.
+
+namespace {
+
+class DxilSpecializeConstants : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilSpecializeConstants() : ModulePass(ID) {}
+
+  void applyOptions(PassOptions O) override {
+    StringRef values;
+    GetPassOption(O, "values", &values);
+    m_Values = values.str();
+    GetPassOptionBool(O, "validate", &m_bValidate, true);
+  }
+
+  const char *getPassName() const override {
+    return "DXIL specialize constants";
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool ParseValues(LLVMContext &Ctx);
+  Constant *GetValue(CallInst *CI);
+
+  std::string m_Values;
+  bool m_bValidate = true;
+  std::map<unsigned, std::string> m_ValueMap;
+};
+
+char DxilSpecializeConstants::ID = 0;
+
+bool DxilSpecializeConstants::ParseValues(LLVMContext &Ctx) {
+  SmallVector<StringRef, 8> Entries;
+  StringRef(m_Values).split(Entries, ";", -1, /*KeepEmpty*/ false);
+  for (StringRef Entry : Entries) {
+    std::pair<StringRef, StringRef> IdValue = Entry.split('=');
+    unsigned Id;
+    if (IdValue.first.trim().getAsInteger(0, Id) ||
+        IdValue.second.trim().empty()) {
+      dxilutil::EmitErrorOnContext(
+          Ctx, "invalid specialization constant value '" + Entry +
+                   "', expected id=value");
+      return false;
+    }
+    m_ValueMap[Id] = IdValue.second.trim().str();
+  }
+  return true;
+}
+
+// Returns the constant to substitute for the placeholder call CI.
+Constant *DxilSpecializeConstants::GetValue(CallInst *CI) {
+  unsigned Id = cast<ConstantInt>(CI->getArgOperand(0))->getLimitedValue();
+  Constant *Default = cast<Constant>(CI->getArgOperand(1));
+  auto It = m_ValueMap.find(Id);
+  if (It == m_ValueMap.end())
+    return Default;
+
+  StringRef Str = It->second;
+  Type *Ty = CI->getType();
+  if (Ty->isIntegerTy()) {
+    if (Str == "true")
+      return ConstantInt::get(Ty, 1);
+    if (Str == "false")
+      return ConstantInt::get(Ty, 0);
+    int64_t SVal;
+    uint64_t UVal;
+    if (!Str.getAsInteger(0, SVal))
+      return ConstantInt::get(Ty, SVal, /*isSigned*/ true);
+    if (!Str.getAsInteger(0, UVal))
+      return ConstantInt::get(Ty, UVal);
+  } else {
+    std::string Buf = Str.str();
+    char *End = nullptr;
+    double Val = std::strtod(Buf.c_str(), &End);
+    if (End && *End == '\0')
+      return ConstantFP::get(Ty, Val);
+  }
+
+  dxilutil::EmitErrorOnContext(CI->getContext(),
+                               "invalid value '" + Str +
+                                   "' for specialization constant " +
+                                   Twine(Id));
+  return Default;
+}
+
+bool DxilSpecializeConstants::runOnModule(Module &M) {
+  LLVMContext &Ctx = M.getContext();
+  if (!ParseValues(Ctx))
+    return false;
+
+  SmallVector<Function *, 4> Placeholders;
+  for (Function &F : M.functions())
+    if (F.isDeclaration() &&
+        F.getName().startswith(DXIL::kDxSpecConstantFuncPrefix))
+      Placeholders.emplace_back(&F);
+  if (Placeholders.empty())
+    return false;
+
+  for (Function *F : Placeholders) {
+    for (auto U = F->user_begin(), E = F->user_end(); U != E;) {
+      CallInst *CI = cast<CallInst>(*(U++));
+      CI->replaceAllUsesWith(GetValue(CI));
+      CI->eraseFromParent();
+    }
+    F->eraseFromParent();
+  }
+
+  legacy::FunctionPassManager CleanupPM(&M);
+  CleanupPM.add(createSCCPPass());
+  CleanupPM.add(createInstructionCombiningPass());
+  CleanupPM.add(createCFGSimplificationPass());
+  CleanupPM.add(createDeadCodeEliminationPass());
+  CleanupPM.doInitialization();
+  for (Function &F : M.functions())
+    if (!F.isDeclaration())
+      CleanupPM.run(F);
+  CleanupPM.doFinalization();
+
+  DxilModule &DM = M.GetOrCreateDxilModule();
+  // Specialized code may not need some features anymore.
+  DM.CollectShaderFlagsForModule();
+  DM.ReEmitDxilResources();
+
+  if (m_bValidate && FAILED(ValidateDxilModule(&M, nullptr)))
+    dxilutil::EmitErrorOnContext(Ctx, "specialized module failed validation");
+  return true;
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilSpecializeConstantsPass() {
+  return new DxilSpecializeConstants();
+}
+
+INITIALIZE_PASS(DxilSpecializeConstants, "hlsl-dxil-specialize-constants",
+                "DXIL specialize constants", false, false)
@@ -0,0 +1,317 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilUniformityAnalysis.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Analysis of values that are dynamically uniform across a wave, and a pass //
+// clearing the nonUniformIndex flag of handles with uniform indices.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseSet.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace hlsl {
+
+// Values start out uniform and become divergent when they depend on a
+// source of divergence, either through an operand or through a branch on a
+// divergent condition (sync dependence). The propagation follows
+// llvm::DivergenceAnalysis; sources of divergence and uniformity are taken
+// from the DXIL operation classes:
+//  - thread ids, inputs, memory reads that may see per-lane data, atomics and
+//    calls to non-DXIL functions are divergent;
+//  - wave reductions and WaveReadLaneFirst are uniform whatever their
+//    operands;
+//  - arithmetic, handle creation and cbuffer loads are uniform when all their
+//    operands are.
+
+class DxilUniformityAnalyzer : public DxilUniformityAnalysis {
+public:
+  DxilUniformityAnalyzer(DominatorTree &DT, PostDominatorTree &PDT)
+      : DT(DT), PDT(PDT) {}
+  void Analyze(Function *F) override;
+  bool IsUniform(Value *V) override;
+
+private:
+  enum class Source { Divergent, Uniform, Operands };
+  static Source GetSource(Instruction *I);
+  void MarkDivergent(Value *V);
+  void ExploreSyncDependency(TerminatorInst *TI);
+
+  DominatorTree &DT;
+  PostDominatorTree &PDT;
+  DenseSet<Value *> Divergent;
+  std::vector<Value *> WorkList;
+};
+
+DxilUniformityAnalyzer::Source
+DxilUniformityAnalyzer::GetSource(Instruction *I) {
+  if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I) || isa<AllocaInst>(I))
+    return Source::Divergent;
+
+  if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    // Only constant memory can't hold per-lane data.
+    Value *Ptr = LI->getPointerOperand()->stripInBoundsOffsets();
+    GlobalVariable *GV = dyn_cast<GlobalVariable>(Ptr);
+    return GV && GV->isConstant() ? Source::Operands : Source::Divergent;
+  }
+
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI)
+    return Source::Operands;
+  if (!OP::IsDxilOpFuncCallInst(CI))
+    return Source::Divergent;
+
+  switch (OP::GetOpCodeClass(OP::GetDxilOpFuncCallInst(CI))) {
+  case DXIL::OpCodeClass::WaveActiveAllEqual:
+  case DXIL::OpCodeClass::WaveActiveBallot:
+  case DXIL::OpCodeClass::WaveActiveBit:
+  case DXIL::OpCodeClass::WaveActiveOp:
+  case DXIL::OpCodeClass::WaveAllOp:
+  case DXIL::OpCodeClass::WaveAllTrue:
+  case DXIL::OpCodeClass::WaveAnyTrue:
+  case DXIL::OpCodeClass::WaveGetLaneCount:
+  case DXIL::OpCodeClass::WaveReadLaneFirst:
+    return Source::Uniform;
+  case DXIL::OpCodeClass::Unary:
+  case DXIL::OpCodeClass::UnaryBits:
+  case DXIL::OpCodeClass::IsSpecialFloat:
+  case DXIL::OpCodeClass::Binary:
+  case DXIL::OpCodeClass::BinaryWithCarryOrBorrow:
+  case DXIL::OpCodeClass::BinaryWithTwoOuts:
+  case DXIL::OpCodeClass::Tertiary:
+  case DXIL::OpCodeClass::Quaternary:
+  case DXIL::OpCodeClass::Dot2:
+  case DXIL::OpCodeClass::Dot3:
+  case DXIL::OpCodeClass::Dot4:
+  case DXIL::OpCodeClass::Dot2AddHalf:
+  case DXIL::OpCodeClass::Dot4AddPacked:
+  case DXIL::OpCodeClass::BitcastF16toI16:
+  case DXIL::OpCodeClass::BitcastF32toI32:
+  case DXIL::OpCodeClass::BitcastF64toI64:
+  case DXIL::OpCodeClass::BitcastI16toF16:
+  case DXIL::OpCodeClass::BitcastI32toF32:
+  case DXIL::OpCodeClass::BitcastI64toF64:
+  case DXIL::OpCodeClass::LegacyDoubleToFloat:
+  case DXIL::OpCodeClass::LegacyDoubleToSInt32:
+  case DXIL::OpCodeClass::LegacyDoubleToUInt32:
+  case DXIL::OpCodeClass::LegacyF16ToF32:
+  case DXIL::OpCodeClass::LegacyF32ToF16:
+  case DXIL::OpCodeClass::MakeDouble:
+  case DXIL::OpCodeClass::SplitDouble:
+  case DXIL::OpCodeClass::Pack4x8:
+  case DXIL::OpCodeClass::Unpack4x8:
+  case DXIL::OpCodeClass::CreateHandle:
+  case DXIL::OpCodeClass::CreateHandleForLib:
+  case DXIL::OpCodeClass::CreateHandleFromBinding:
+  case DXIL::OpCodeClass::CreateHandleFromHeap:
+  case DXIL::OpCodeClass::AnnotateHandle:
+  case DXIL::OpCodeClass::CBufferLoad:
+  case DXIL::OpCodeClass::CBufferLoadLegacy:
+  case DXIL::OpCodeClass::GetDimensions:
+  case DXIL::OpCodeClass::GroupId:
+  case DXIL::OpCodeClass::DispatchRaysDimensions:
+  case DXIL::OpCodeClass::WaveReadLaneAt:
+    return Source::Operands;
+  default:
+    return Source::Divergent;
+  }
+}
+
+void DxilUniformityAnalyzer::MarkDivergent(Value *V) {
+  if (Divergent.insert(V).second)
+    WorkList.emplace_back(V);
+}
+
+void DxilUniformityAnalyzer::ExploreSyncDependency(TerminatorInst *TI) {
+  BasicBlock *BB = TI->getParent();
+  DomTreeNode *Node = PDT.getNode(BB);
+  if (!Node || !Node->getIDom())
+    return;
+  BasicBlock *IPostDom = Node->getIDom()->getBlock();
+  if (!IPostDom)
+    return;
+
+  // Lanes taking different paths meet again in IPostDom, where phis may
+  // merge different values.
+  for (auto I = IPostDom->begin(); isa<PHINode>(I); ++I) {
+    if (!cast<PHINode>(I)->hasConstantValue())
+      MarkDivergent(&*I);
+  }
+
+  // Values defined on the divergent paths and used after them may have been
+  // computed by different iterations in different lanes. Such values must
+  // dominate TI, so only TI's dominators inside the region are searched.
+  DenseSet<BasicBlock *> Region;
+  std::vector<BasicBlock *> Stack;
+  Stack.emplace_back(BB);
+  while (!Stack.empty()) {
+    BasicBlock *Cur = Stack.back();
+    Stack.pop_back();
+    for (BasicBlock *Succ : successors(Cur)) {
+      if (Succ != IPostDom && Region.insert(Succ).second)
+        Stack.emplace_back(Succ);
+    }
+  }
+  for (DomTreeNode *Dom = DT.getNode(BB); Dom && Region.count(Dom->getBlock());
+       Dom = Dom->getIDom()) {
+    for (Instruction &I : *Dom->getBlock()) {
+      for (User *U : I.users()) {
+        Instruction *UI = cast<Instruction>(U);
+        if (!Region.count(UI->getParent()) &&
+            GetSource(UI) != Source::Uniform)
+          MarkDivergent(UI);
+      }
+    }
+  }
+}
+
+void DxilUniformityAnalyzer::Analyze(Function *F) {
+  Divergent.clear();
+  WorkList.clear();
+  for (Argument &Arg : F->args())
+    MarkDivergent(&Arg);
+  for (Instruction &I : inst_range(F)) {
+    if (GetSource(&I) == Source::Divergent)
+      MarkDivergent(&I);
+  }
+
+  while (!WorkList.empty()) {
+    Value *V = WorkList.back();
+    WorkList.pop_back();
+    if (TerminatorInst *TI = dyn_cast<TerminatorInst>(V)) {
+      if (TI->getNumSuccessors() > 1)
+        ExploreSyncDependency(TI);
+    }
+    for (User *U : V->users()) {
+      Instruction *UI = dyn_cast<Instruction>(U);
+      if (UI && GetSource(UI) == Source::Operands)
+        MarkDivergent(UI);
+    }
+  }
+}
+
+bool DxilUniformityAnalyzer::IsUniform(Value *V) {
+  return !Divergent.count(V);
+}
+
+DxilUniformityAnalysis *
+DxilUniformityAnalysis::create(DominatorTree &DT, PostDominatorTree &PDT) {
+  return new DxilUniformityAnalyzer(DT, PDT);
+}
+
+} // namespace hlsl
+
+using namespace hlsl;
+
+namespace {
+
+// NonUniformResourceIndex is needed when lanes may index different
+// resources; drop it when the index is uniform anyway, so drivers don't need
+// to emit a loop over the distinct indices.
+class DxilRemoveRedundantNonUniform : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilRemoveRedundantNonUniform() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL remove redundant NonUniformResourceIndex";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<PostDominatorTree>();
+    AU.setPreservesAll();
+  }
+
+  bool runOnFunction(Function &F) override {
+    // Collect handles marked non-uniform, with the operands of their index
+    // and non-uniform flag.
+    struct NonUniformHandle {
+      CallInst *CI;
+      unsigned IndexIdx;
+      unsigned NonUniformIdx;
+    };
+    SmallVector<NonUniformHandle, 8> NonUniformHandles;
+    for (Instruction &I : inst_range(F)) {
+      CallInst *CI = dyn_cast<CallInst>(&I);
+      if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+        continue;
+      unsigned IndexIdx = 0, NonUniformIdx = 0;
+      switch (OP::GetDxilOpFuncCallInst(CI)) {
+      case DXIL::OpCode::CreateHandle:
+        IndexIdx = DxilInst_CreateHandle::arg_index;
+        NonUniformIdx = DxilInst_CreateHandle::arg_nonUniformIndex;
+        break;
+      case DXIL::OpCode::CreateHandleFromBinding:
+        IndexIdx = DxilInst_CreateHandleFromBinding::arg_index;
+        NonUniformIdx = DxilInst_CreateHandleFromBinding::arg_nonUniformIndex;
+        break;
+      case DXIL::OpCode::CreateHandleFromHeap:
+        IndexIdx = DxilInst_CreateHandleFromHeap::arg_index;
+        NonUniformIdx = DxilInst_CreateHandleFromHeap::arg_nonUniformIndex;
+        break;
+      default:
+        continue;
+      }
+      ConstantInt *NonUniform =
+          dyn_cast<ConstantInt>(CI->getArgOperand(NonUniformIdx));
+      if (NonUniform && NonUniform->isOne())
+        NonUniformHandles.push_back({CI, IndexIdx, NonUniformIdx});
+    }
+    if (NonUniformHandles.empty())
+      return false;
+
+    std::unique_ptr<DxilUniformityAnalysis> Uniformity(
+        DxilUniformityAnalysis::create(
+            getAnalysis<DominatorTreeWrapperPass>().getDomTree(),
+            getAnalysis<PostDominatorTree>()));
+    Uniformity->Analyze(&F);
+
+    bool bChanged = false;
+    for (NonUniformHandle &H : NonUniformHandles) {
+      if (!Uniformity->IsUniform(H.CI->getArgOperand(H.IndexIdx)))
+        continue;
+      H.CI->setArgOperand(H.NonUniformIdx,
+                          ConstantInt::getFalse(H.CI->getContext()));
+      bChanged = true;
+    }
+    return bChanged;
+  }
+};
+
+} // namespace
+
+char DxilRemoveRedundantNonUniform::ID = 0;
+
+FunctionPass *llvm::createDxilRemoveRedundantNonUniformPass() {
+  return new DxilRemoveRedundantNonUniform();
+}
+
+INITIALIZE_PASS_BEGIN(DxilRemoveRedundantNonUniform,
+                      "hlsl-dxil-remove-redundant-nonuniform",
+                      "DXIL remove redundant NonUniformResourceIndex", false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PostDominatorTree)
+INITIALIZE_PASS_END(DxilRemoveRedundantNonUniform,
+                    "hlsl-dxil-remove-redundant-nonuniform",
+                    "DXIL remove redundant NonUniformResourceIndex", false,
+                    false)
@@ -28,8 +28,11 @@
 #include "llvm/Analysis/ReducibilityAnalysis.h"
 #include "dxc/DXIL/DxilEntryProps.h"
 #include "dxc/DXIL/DxilResourceProperties.h"
+#include "dxc/HLSL/DxilFunctionFingerprint.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -40,11 +43,15 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/ModuleSlotTracker.h"
 #include "llvm/ADT/BitVector.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include <unordered_set>
 #include "llvm/Analysis/LoopInfo.h"
@@ -57,6 +64,9 @@
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
 #include <algorithm>
 #include <deque>
+#include <exception>
+#include <system_error>
+#include <thread>
 
 using namespace llvm;
 using namespace std;
@@ -331,6 +341,27 @@ static void emitDxilDiag(LLVMContext &Ctx, const char *str) {
   hlsl::dxilutil::EmitErrorOnContext(Ctx, str);
 }
 
+// Times a step of validation for -ftime-report and, if given, a report.
+class ValidationPhase {
+  PhaseTimingRegion Region;
+  const char *Name;
+  hlsl::DxilValidationReport *pReport;
+  TimeRecord Start;
+
+public:
+  ValidationPhase(const char *Name, hlsl::DxilValidationReport *pReport)
+      : Region(Name), Name(Name), pReport(pReport) {
+    if (pReport)
+      Start = TimeRecord::getCurrentTime(true);
+  }
+  ~ValidationPhase() {
+    if (!pReport)
+      return;
+    TimeRecord End = TimeRecord::getCurrentTime(false);
+    pReport->Phases.push_back({Name, End.getWallTime() - Start.getWallTime()});
+  }
+};
+
 } // anon namespace
 
 namespace hlsl {
@@ -385,6 +416,20 @@ struct EntryStatus {
     patchConstOrPrimCols.resize(
         entryProps.sig.PatchConstOrPrimSignature.GetElements().size(), 0);
   }
+
+  // Adds what validating function bodies recorded in Other, a status of the
+  // same entry.
+  void MergeFunctionStatus(const EntryStatus &Other) {
+    for (unsigned i = 0; i < DXIL::kNumOutputStreams; i++)
+      OutputPositionMask[i] |= Other.OutputPositionMask[i];
+    for (size_t i = 0, e = outputCols.size(); i != e; ++i)
+      outputCols[i] |= Other.outputCols[i];
+    for (size_t i = 0, e = patchConstOrPrimCols.size(); i != e; ++i)
+      patchConstOrPrimCols[i] |= Other.patchConstOrPrimCols[i];
+    m_bCoverageIn |= Other.m_bCoverageIn;
+    m_bInnerCoverageIn |= Other.m_bInnerCoverageIn;
+    hasViewID |= Other.hasViewID;
+  }
 };
 
 struct ValidationContext {
@@ -398,6 +443,10 @@ struct ValidationContext {
   ValidationRule LastRuleEmit;
   std::unordered_set<Function *> entryFuncCallSet;
   std::unordered_set<Function *> patchConstFuncCallSet;
+  // Functions DxilValidationCache has seen pass; their calls are not checked.
+  std::unordered_set<Function *> cachedFuncSet;
+  // Where broken rules are recorded for a DxilValidationReport, if anywhere.
+  std::vector<DxilValidationReport::Finding> *pFindings = nullptr;
   std::unordered_map<unsigned, bool> UavCounterIncMap;
   std::unordered_map<Value *, unsigned> HandleResIndexMap;
   // TODO: save resource map for each createHandle/createHandleForLib.
@@ -410,7 +459,12 @@ struct ValidationContext {
   const unsigned kDxilNonUniformMDKind;
   const unsigned kLLVMLoopMDKind;
   unsigned m_DxilMajor, m_DxilMinor;
-  ModuleSlotTracker slotTracker;
+  // Numbers values for diagnostics; built on the first one.
+  std::unique_ptr<ModuleSlotTracker> pSlotTracker;
+  // Scratch lists reused from instruction to instruction, so validating a
+  // clean module does not allocate per instruction.
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDNodesScratch;
+  SmallVector<Value *, 8> IndicesScratch;
 
   ValidationContext(Module &llvmModule, Module *DebugModule,
                     DxilModule &dxilModule)
@@ -423,8 +477,7 @@ struct ValidationContext {
             DxilMDHelper::kDxilPreciseAttributeMDName)),
         kDxilNonUniformMDKind(llvmModule.getContext().getMDKindID(
             DxilMDHelper::kDxilNonUniformAttributeMDName)),
-        kLLVMLoopMDKind(llvmModule.getContext().getMDKindID("llvm.loop")),
-        slotTracker(&llvmModule, true) {
+        kLLVMLoopMDKind(llvmModule.getContext().getMDKindID("llvm.loop")) {
     DxilMod.GetDxilVersion(m_DxilMajor, m_DxilMinor);
     HandleTy = DxilMod.GetOP()->GetHandleType();
 
@@ -632,10 +685,26 @@ struct ValidationContext {
 
   DxilResourceProperties GetResourceFromVal(Value *resVal);
 
+  void RecordFinding(ValidationRule rule, StringRef Object = StringRef(),
+                     const DebugLoc &L = DebugLoc()) {
+    if (!pFindings)
+      return;
+    pFindings->emplace_back();
+    DxilValidationReport::Finding &F = pFindings->back();
+    F.Rule = rule;
+    F.Object = Object;
+    if (L) {
+      F.File = L.get()->getFilename();
+      F.Line = L.getLine();
+      F.Column = L.getCol();
+    }
+  }
+
   void EmitGlobalVariableFormatError(GlobalVariable *GV, ValidationRule rule,
                                      ArrayRef<StringRef> args) {
     std::string ruleText = GetValidationRuleText(rule);
     FormatRuleText(ruleText, args);
+    RecordFinding(rule, GV->getName());
     if (pDebugModule)
       GV = pDebugModule->getGlobalVariable(GV->getName());
     dxilutil::EmitErrorOnGlobalVariable(M.getContext(), GV, ruleText);
@@ -644,6 +713,7 @@ struct ValidationContext {
 
   // This is the least desirable mechanism, as it has no context.
   void EmitError(ValidationRule rule) {
+    RecordFinding(rule);
     dxilutil::EmitErrorOnContext(M.getContext(), GetValidationRuleText(rule));
     Failed = true;
   }
@@ -676,6 +746,7 @@ struct ValidationContext {
   void EmitFormatError(ValidationRule rule, ArrayRef<StringRef> args) {
     std::string ruleText = GetValidationRuleText(rule);
     FormatRuleText(ruleText, args);
+    RecordFinding(rule);
     dxilutil::EmitErrorOnContext(M.getContext(), ruleText);
     Failed = true;
   }
@@ -684,6 +755,7 @@ struct ValidationContext {
     std::string O;
     raw_string_ostream OSS(O);
     Meta->print(OSS, &M);
+    RecordFinding(rule);
     dxilutil::EmitErrorOnContext(M.getContext(), GetValidationRuleText(rule) + O);
     Failed = true;
   }
@@ -730,7 +802,9 @@ struct ValidationContext {
   }
 
   void EmitResourceError(const hlsl::DxilResourceBase *Res, ValidationRule rule) {
-    std::string QuotedRes = " '" + GetResourceName(Res) + "'";
+    std::string ResName = GetResourceName(Res);
+    RecordFinding(rule, ResName);
+    std::string QuotedRes = " '" + ResName + "'";
     dxilutil::EmitErrorOnContext(M.getContext(), GetValidationRuleText(rule) + QuotedRes);
     Failed = true;
   }
@@ -738,7 +812,9 @@ struct ValidationContext {
   void EmitResourceFormatError(const hlsl::DxilResourceBase *Res,
                                ValidationRule rule,
                                ArrayRef<StringRef> args) {
-    std::string QuotedRes = " '" + GetResourceName(Res) + "'";
+    std::string ResName = GetResourceName(Res);
+    RecordFinding(rule, ResName);
+    std::string QuotedRes = " '" + ResName + "'";
     std::string ruleText = GetValidationRuleText(rule);
     FormatRuleText(ruleText, args);
     dxilutil::EmitErrorOnContext(M.getContext(), ruleText + QuotedRes);
@@ -788,12 +864,15 @@ struct ValidationContext {
     BasicBlock *BB = I->getParent();
     Function *F = BB->getParent();
 
+    RecordFinding(Rule, F->getName(), L);
     dxilutil::EmitErrorOnInstruction(DbgI, Msg);
 
     // Add llvm information as a note to instruction string
     std::string InstrStr;
     raw_string_ostream InstrStream(InstrStr);
-    I->print(InstrStream, slotTracker);
+    if (!pSlotTracker)
+      pSlotTracker = llvm::make_unique<ModuleSlotTracker>(&M, true);
+    I->print(InstrStream, *pSlotTracker);
     InstrStream.flush();
     StringRef InstrStrRef = InstrStr;
     InstrStrRef = InstrStrRef.ltrim(); // Ignore indentation
@@ -847,6 +926,7 @@ struct ValidationContext {
   }
 
   void EmitFnError(Function *F, ValidationRule rule) {
+    RecordFinding(rule, F->getName());
     if (pDebugModule)
       if (Function *dbgF = pDebugModule->getFunction(F->getName()))
         F = dbgF;
@@ -857,6 +937,7 @@ struct ValidationContext {
   void EmitFnFormatError(Function *F, ValidationRule rule, ArrayRef<StringRef> args) {
     std::string ruleText = GetValidationRuleText(rule);
     FormatRuleText(ruleText, args);
+    RecordFinding(rule, F->getName());
     if (pDebugModule)
       if (Function *dbgF = pDebugModule->getFunction(F->getName()))
         F = dbgF;
@@ -1152,30 +1233,11 @@ static DXIL::ResourceKind GetResourceKindAndCompTy(Value *handle, DXIL::Componen
 DxilFieldAnnotation *GetFieldAnnotation(Type *Ty,
                                         DxilTypeSystem &typeSys,
                                         std::deque<unsigned> &offsets) {
-  unsigned CurIdx = 1;
-  unsigned LastIdx = offsets.size() - 1;
-  DxilStructAnnotation *StructAnnot = nullptr;
-
-  for (; CurIdx < offsets.size(); ++CurIdx) {
-    if (const StructType *EltST = dyn_cast<StructType>(Ty)) {
-      if (DxilStructAnnotation *EltAnnot = typeSys.GetStructAnnotation(EltST)) {
-        StructAnnot = EltAnnot;
-        Ty = EltST->getElementType(offsets[CurIdx]);
-        if (CurIdx == LastIdx) {
-          return &StructAnnot->GetFieldAnnotation(offsets[CurIdx]);
-        }
-      } else {
-        return nullptr;
-      }
-    } else if (const ArrayType *AT = dyn_cast<ArrayType>(Ty)) {
-      Ty = AT->getElementType();
-      StructAnnot = nullptr;
-    } else {
-      if (StructAnnot)
-        return &StructAnnot->GetFieldAnnotation(offsets[CurIdx]);
-    }
-  }
-  return nullptr;
+  if (offsets.size() < 2)
+    return nullptr;
+  // offsets[0] indexes the pointer.
+  SmallVector<unsigned, 4> Indices(std::next(offsets.begin()), offsets.end());
+  return typeSys.GetFieldAnnotation(Ty, Indices);
 }
 
 
@@ -1200,7 +1262,8 @@ struct ResRetUsage {
 };
 
 static void CollectGetDimResRetUsage(ResRetUsage &usage, Instruction *ResRet,
-                                     ValidationContext &ValCtx) {
+                                     ValidationContext &ValCtx,
+                                     SmallPtrSetImpl<PHINode *> &VisitedPhis) {
   for (User *U : ResRet->users()) {
     if (ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(U)) {
       for (unsigned idx : EVI->getIndices()) {
@@ -1228,7 +1291,9 @@ static void CollectGetDimResRetUsage(ResRetUsage &usage, Instruction *ResRet,
         }
       }
     } else if (PHINode *PHI = dyn_cast<PHINode>(U)) {
-      CollectGetDimResRetUsage(usage, PHI, ValCtx);
+      // Phis in loops may lead back to themselves.
+      if (VisitedPhis.insert(PHI).second)
+        CollectGetDimResRetUsage(usage, PHI, ValCtx, VisitedPhis);
     } else {
       Instruction *User = cast<Instruction>(U);
       ValCtx.EmitInstrError(User, ValidationRule::InstrDxilStructUser);
@@ -1237,6 +1302,12 @@ static void CollectGetDimResRetUsage(ResRetUsage &usage, Instruction *ResRet,
 }
 
 
+static void CollectGetDimResRetUsage(ResRetUsage &usage, Instruction *ResRet,
+                                     ValidationContext &ValCtx) {
+  SmallPtrSet<PHINode *, 4> VisitedPhis;
+  CollectGetDimResRetUsage(usage, ResRet, ValCtx, VisitedPhis);
+}
+
 static void ValidateResourceCoord(CallInst *CI, DXIL::ResourceKind resKind,
                                   ArrayRef<Value *> coords,
                                   ValidationContext &ValCtx) {
@@ -2623,6 +2694,9 @@ static void ValidateExternalFunction(Function *F, ValidationContext &ValCtx) {
     if (!isDxilOp)
       continue;
 
+    if (ValCtx.cachedFuncSet.count(CI->getParent()->getParent()))
+      continue;
+
     Value *argOpcode = CI->getArgOperand(0);
     ConstantInt *constOpcode = dyn_cast<ConstantInt>(argOpcode);
     if (!constOpcode) {
@@ -3184,7 +3258,8 @@ static void ValidateNonUniformMetadata(Instruction &I, MDNode *pMD,
 
 static void ValidateInstructionMetadata(Instruction *I,
                                         ValidationContext &ValCtx) {
-  SmallVector<std::pair<unsigned, MDNode *>, 2> MDNodes;
+  SmallVectorImpl<std::pair<unsigned, MDNode *>> &MDNodes =
+      ValCtx.MDNodesScratch;
   I->getAllMetadataOtherThanDebugLoc(MDNodes);
   for (auto &MD : MDNodes) {
     if (MD.first == ValCtx.kDxilControlFlowHintMDKind) {
@@ -3244,7 +3319,8 @@ static void ValidateFunctionAttribute(Function *F, ValidationContext &ValCtx) {
 }
 
 static void ValidateFunctionMetadata(Function *F, ValidationContext &ValCtx) {
-  SmallVector<std::pair<unsigned, MDNode *>, 2> MDNodes;
+  SmallVectorImpl<std::pair<unsigned, MDNode *>> &MDNodes =
+      ValCtx.MDNodesScratch;
   F->getAllMetadata(MDNodes);
   for (auto &MD : MDNodes) {
     ValCtx.EmitMetaError(MD.second, ValidationRule::MetaUsed);
@@ -3282,8 +3358,6 @@ static void ValidateFunctionBody(Function *F, ValidationContext &ValCtx) {
       ValCtx.DxilMod.GetGlobalFlags() & DXIL::kEnableMinPrecision;
   bool SupportsLifetimeIntrinsics =
       ValCtx.DxilMod.GetShaderModel()->IsSM66Plus();
-  SmallVector<CallInst *, 16> gradientOps;
-  SmallVector<CallInst *, 16> barriers;
   CallInst *setMeshOutputCounts = nullptr;
   CallInst *getMeshPayload = nullptr;
   CallInst *dispatchMesh = nullptr;
@@ -3338,13 +3412,6 @@ static void ValidateFunctionBody(Function *F, ValidationContext &ValCtx) {
           unsigned opcode = OpcodeConst->getLimitedValue();
           DXIL::OpCode dxilOpcode = (DXIL::OpCode)opcode;
 
-          if (OP::IsDxilOpGradient(dxilOpcode)) {
-            gradientOps.push_back(CI);
-          }
-
-          if (dxilOpcode == DXIL::OpCode::Barrier) {
-            barriers.push_back(CI);
-          }
           // External function validation will check the parameter
           // list. This function will check that the call does not
           // violate any rules.
@@ -3479,7 +3546,9 @@ static void ValidateFunctionBody(Function *F, ValidationContext &ValCtx) {
               DL.getTypeAllocSize(Ptr->getType()->getPointerElementType());
           unsigned valSize = DL.getTypeAllocSize(GEP->getType()->getPointerElementType());
 
-          SmallVector<Value *, 8> Indices(GEP->idx_begin(), GEP->idx_end());
+          SmallVectorImpl<Value *> &Indices = ValCtx.IndicesScratch;
+          Indices.clear();
+          Indices.append(GEP->idx_begin(), GEP->idx_end());
           unsigned offset =
               DL.getIndexedOffset(GEP->getPointerOperandType(), Indices);
           if ((offset + valSize) > size) {
@@ -3795,29 +3864,24 @@ static bool IsDivergent(Value *V) {
 
 static void ValidateTGSMRaceCondition(std::vector<StoreInst *> &fixAddrTGSMList,
                                       ValidationContext &ValCtx) {
-  std::unordered_set<Function *> fixAddrTGSMFuncSet;
-  for (StoreInst *I : fixAddrTGSMList) {
-    BasicBlock *BB = I->getParent();
-    fixAddrTGSMFuncSet.insert(BB->getParent());
+  // Only stores of divergent values can race, and only functions with those
+  // need a post dominator tree.
+  MapVector<Function *, SmallVector<StoreInst *, 4>> divergentStores;
+  for (StoreInst *SI : fixAddrTGSMList) {
+    if (IsDivergent(SI->getValueOperand()))
+      divergentStores[SI->getParent()->getParent()].push_back(SI);
   }
 
-  for (auto &F : ValCtx.DxilMod.GetModule()->functions()) {
-    if (F.isDeclaration() || !fixAddrTGSMFuncSet.count(&F))
-      continue;
-
+  for (auto &It : divergentStores) {
+    Function &F = *It.first;
     PostDominatorTree PDT;
     PDT.runOnFunction(F);
 
     BasicBlock *Entry = &F.getEntryBlock();
 
-    for (StoreInst *SI : fixAddrTGSMList) {
-      BasicBlock *BB = SI->getParent();
-      if (BB->getParent() == &F) {
-        if (PDT.dominates(BB, Entry)) {
-          if (IsDivergent(SI->getValueOperand()))
-            ValCtx.EmitInstrError(SI, ValidationRule::InstrTGSMRaceCond);
-        }
-      }
+    for (StoreInst *SI : It.second) {
+      if (PDT.dominates(SI->getParent(), Entry))
+        ValCtx.EmitInstrError(SI, ValidationRule::InstrTGSMRaceCond);
     }
   }
 }
@@ -4335,6 +4399,8 @@ static void ValidateShaderFlags(ValidationContext &ValCtx) {
   if (ValCtx.isLibProfile)
     return;
 
+  // Function flags recorded when the flags were declared, in the same
+  // compile, are reused; a module loaded for validation is scanned.
   ShaderFlags calcFlags;
   ValCtx.DxilMod.CollectShaderFlagsForModule(calcFlags);
   const uint64_t mask = ShaderFlags::GetShaderFlagsRawForCollection();
@@ -5575,28 +5641,34 @@ static void ValidateShaderState(ValidationContext &ValCtx) {
   }
 }
 
+// Collects into funcSet the functions reachable from node, returning a
+// function that is reached again while it is being visited, if any. Each
+// function is visited in full once, however many paths lead to it.
 static CallGraphNode *
-CalculateCallDepth(CallGraphNode *node,
-                   std::unordered_map<CallGraphNode *, unsigned> &depthMap,
-                   std::unordered_set<CallGraphNode *> &callStack,
-                   std::unordered_set<Function *> &funcSet) {
-  unsigned depth = callStack.size();
+FindRecursiveCall(CallGraphNode *node,
+                  std::unordered_set<CallGraphNode *> &callStack,
+                  std::unordered_set<CallGraphNode *> &visited,
+                  std::unordered_set<Function *> &funcSet) {
   funcSet.insert(node->getFunction());
   for (auto it = node->begin(), ei = node->end(); it != ei; it++) {
     CallGraphNode *toNode = it->second;
-    if (callStack.insert(toNode).second == false) {
+    if (callStack.count(toNode)) {
       // Recursive.
       return toNode;
     }
-    if (depthMap[toNode] < depth)
-      depthMap[toNode] = depth;
-    if (CallGraphNode *N = CalculateCallDepth(toNode, depthMap, callStack, funcSet)) {
+    // Nothing reachable from a fully visited function recurses, or we would
+    // have stopped.
+    if (visited.count(toNode))
+      continue;
+    callStack.insert(toNode);
+    if (CallGraphNode *N = FindRecursiveCall(toNode, callStack, visited, funcSet)) {
       // Recursive
       return N;
     }
     callStack.erase(toNode);
   }
 
+  visited.insert(node);
   return nullptr;
 }
 
@@ -5604,17 +5676,16 @@ static void ValidateCallGraph(ValidationContext &ValCtx) {
   // Build CallGraph.
   CallGraph CG(*ValCtx.DxilMod.GetModule());
 
-  std::unordered_map<CallGraphNode*, unsigned> depthMap;
   std::unordered_set<CallGraphNode*> callStack;
+  std::unordered_set<CallGraphNode*> visited;
   CallGraphNode *entryNode = CG[ValCtx.DxilMod.GetEntryFunction()];
-  depthMap[entryNode] = 0;
-  if (CallGraphNode *N = CalculateCallDepth(entryNode, depthMap, callStack, ValCtx.entryFuncCallSet))
+  if (CallGraphNode *N = FindRecursiveCall(entryNode, callStack, visited, ValCtx.entryFuncCallSet))
     ValCtx.EmitFnError(N->getFunction(), ValidationRule::FlowNoRecusion);
   if (ValCtx.DxilMod.GetShaderModel()->IsHS()) {
     CallGraphNode *patchConstantNode = CG[ValCtx.DxilMod.GetPatchConstantFunction()];
-    depthMap[patchConstantNode] = 0;
     callStack.clear();
-    if (CallGraphNode *N = CalculateCallDepth(patchConstantNode, depthMap, callStack, ValCtx.patchConstFuncCallSet))
+    visited.clear();
+    if (CallGraphNode *N = FindRecursiveCall(patchConstantNode, callStack, visited, ValCtx.patchConstFuncCallSet))
       ValCtx.EmitFnError(N->getFunction(), ValidationRule::FlowNoRecusion);
   }
 }
@@ -5753,9 +5824,332 @@ void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor) {
   // VALRULE-TEXT:END
 }
 
+namespace {
+
+typedef std::vector<std::pair<DiagnosticSeverity, std::string>> DiagnosticList;
+typedef std::vector<DxilValidationReport::Finding> FindingList;
+
+// A diagnostic printed on a worker's context, replayed word for word.
+class DiagnosticInfoPrinted : public DiagnosticInfo {
+  const std::string &Text;
+
+public:
+  DiagnosticInfoPrinted(DiagnosticSeverity Severity, const std::string &Text)
+      : DiagnosticInfo(getKind(), Severity), Text(Text) {}
+  void print(DiagnosticPrinter &DP) const override { DP << Text; }
+
+  static int getKind() {
+    static const int Kind = getNextAvailablePluginDiagnosticKind();
+    return Kind;
+  }
+};
+
+// Collects into the list of the function being validated, if any.
+void CollectFunctionDiagnostic(const DiagnosticInfo &DI, void *Context) {
+  DiagnosticList *Diagnostics = *static_cast<DiagnosticList **>(Context);
+  if (!Diagnostics)
+    return;
+  std::string Message;
+  raw_string_ostream OS(Message);
+  DiagnosticPrinterRawOStream DP(OS);
+  DI.print(DP);
+  OS.flush();
+  Diagnostics->emplace_back(DI.getSeverity(), std::move(Message));
+}
+
+struct FunctionPartitionResult {
+  // Entry statuses by function index, as the partition's bodies left them.
+  std::vector<std::pair<size_t, std::unique_ptr<EntryStatus>>> EntryStatuses;
+  bool LoadFailed = false;
+  std::exception_ptr Exception;
+};
+
+// Validates the functions of one partition in a context of its own. The
+// module-level steps that set up state the function checks read are run
+// again here, with their diagnostics dropped; the calling thread reports
+// those.
+void ValidateFunctionPartition(StringRef Bitcode,
+                               const std::vector<unsigned> &PartitionOf,
+                               unsigned Partition,
+                               std::vector<DiagnosticList> &FunctionDiagnostics,
+                               std::vector<FindingList> *pFunctionFindings,
+                               FunctionPartitionResult &Result) {
+  LLVMContext Context;
+  DiagnosticList *Current = nullptr;
+  Context.setDiagnosticHandler(CollectFunctionDiagnostic, &Current);
+  ErrorOr<std::unique_ptr<Module>> ModuleOrErr =
+      parseBitcodeFile(MemoryBufferRef(Bitcode, ""), Context);
+  if (!ModuleOrErr) {
+    Result.LoadFailed = true;
+    return;
+  }
+  Module &M = *ModuleOrErr.get();
+  DxilModule &DM = M.GetOrCreateDxilModule();
+
+  ValidationContext ValCtx(M, nullptr, DM);
+  ValidateShaderState(ValCtx);
+  ValidateFlowControl(ValCtx);
+
+  size_t Index = 0;
+  for (Function &F : M.functions()) {
+    if (PartitionOf[Index++] == UINT_MAX)
+      ValCtx.cachedFuncSet.insert(&F);
+  }
+
+  Index = 0;
+  for (Function &F : M.functions()) {
+    if (PartitionOf[Index] == Partition) {
+      Current = &FunctionDiagnostics[Index];
+      if (pFunctionFindings)
+        ValCtx.pFindings = &(*pFunctionFindings)[Index];
+      ValidateFunction(F, ValCtx);
+      Current = nullptr;
+      ValCtx.pFindings = nullptr;
+    }
+    if (ValCtx.HasEntryStatus(&F))
+      Result.EntryStatuses.emplace_back(
+          Index, std::move(ValCtx.entryStatusMap[&F]));
+    ++Index;
+  }
+}
+
+// Validates the functions of a library on up to ThreadCount threads, as
+// ValidateFunction over each of them in order would. An LLVMContext may only
+// be used by one thread, so every worker reads the module from bitcode into
+// a context of its own. Cached functions are left out. Returns false, having
+// reported nothing, if that failed.
+bool ValidateFunctionsInParallel(ValidationContext &ValCtx,
+                                 unsigned ThreadCount) {
+  Module &M = ValCtx.M;
+  std::vector<Function *> Functions;
+  for (Function &F : M.functions()) {
+    if (F.isMaterializable())
+      return false;
+    Functions.push_back(&F);
+  }
+
+  // Hand out functions most expensive first, each to the partition with the
+  // least work so far. Declarations cost a check per call site.
+  unsigned PartitionCount =
+      (unsigned)std::min<size_t>(ThreadCount, Functions.size());
+  std::vector<size_t> Sizes(Functions.size());
+  for (size_t i = 0, e = Functions.size(); i != e; ++i) {
+    Function *F = Functions[i];
+    if (F->isDeclaration()) {
+      Sizes[i] = F->getNumUses();
+      continue;
+    }
+    for (BasicBlock &BB : *F)
+      Sizes[i] += BB.size();
+  }
+  std::vector<size_t> Order(Functions.size());
+  for (size_t i = 0, e = Order.size(); i != e; ++i)
+    Order[i] = i;
+  std::stable_sort(Order.begin(), Order.end(),
+                   [&](size_t a, size_t b) { return Sizes[a] > Sizes[b]; });
+  std::vector<unsigned> PartitionOf(Functions.size());
+  std::vector<size_t> Load(PartitionCount);
+  for (size_t i : Order) {
+    if (ValCtx.cachedFuncSet.count(Functions[i])) {
+      PartitionOf[i] = UINT_MAX;
+      continue;
+    }
+    size_t Smallest = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    PartitionOf[i] = (unsigned)Smallest;
+    Load[Smallest] += Sizes[i];
+  }
+
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS, /*ShouldPreserveUseListOrder*/ true);
+  }
+  StringRef Input(Bitcode.data(), Bitcode.size());
+
+  std::vector<DiagnosticList> FunctionDiagnostics(Functions.size());
+  std::vector<FindingList> FunctionFindings(ValCtx.pFindings ? Functions.size()
+                                                             : 0);
+  std::vector<FindingList> *pFunctionFindings =
+      ValCtx.pFindings ? &FunctionFindings : nullptr;
+  std::vector<FunctionPartitionResult> Results(PartitionCount);
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  auto Worker = [&](unsigned Partition) {
+    DxcThreadMalloc TM(pMalloc);
+    FunctionPartitionResult &Result = Results[Partition];
+    try {
+      ValidateFunctionPartition(Input, PartitionOf, Partition,
+                                FunctionDiagnostics, pFunctionFindings, Result);
+    } catch (...) {
+      Result.Exception = std::current_exception();
+    }
+  };
+
+  // The calling thread takes the first partition.
+  std::vector<std::thread> Threads;
+  for (unsigned i = 1; i < PartitionCount; ++i) {
+    try {
+      Threads.emplace_back(Worker, i);
+    } catch (const std::system_error &) {
+      Worker(i);
+    }
+  }
+  Worker(0);
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  for (FunctionPartitionResult &Result : Results) {
+    if (Result.Exception)
+      std::rethrow_exception(Result.Exception);
+  }
+  for (FunctionPartitionResult &Result : Results) {
+    if (Result.LoadFailed)
+      return false;
+  }
+
+  LLVMContext &Context = M.getContext();
+  for (DiagnosticList &Diagnostics : FunctionDiagnostics) {
+    for (auto &Diag : Diagnostics)
+      Context.diagnose(DiagnosticInfoPrinted(Diag.first, Diag.second));
+    // Every validation diagnostic is, or follows, an error.
+    if (!Diagnostics.empty())
+      ValCtx.Failed = true;
+  }
+  for (FindingList &Findings : FunctionFindings)
+    ValCtx.pFindings->insert(ValCtx.pFindings->end(), Findings.begin(),
+                             Findings.end());
+  for (FunctionPartitionResult &Result : Results) {
+    for (auto &It : Result.EntryStatuses)
+      ValCtx.GetEntryStatus(Functions[It.first])
+          .MergeFunctionStatus(*It.second);
+  }
+  return true;
+}
+
+// Digests of the functions of a library whose checks DxilValidationCache may
+// skip. Entries qualify only if they have no signatures, which leaves them
+// no entry status for the module-level checks to read. Modules with debug
+// info do not qualify: their checks report locations the digests ignore.
+void GetValidationCacheDigests(
+    ValidationContext &ValCtx,
+    std::vector<std::pair<Function *, DxilValidationCache::Digest>> &Result) {
+  DxilModule &DM = ValCtx.DxilMod;
+  Module &M = ValCtx.M;
+  if (!ValCtx.isLibProfile || M.getNamedMetadata("llvm.dbg.cu"))
+    return;
+
+  unsigned ValMajor, ValMinor;
+  GetValidationVersion(&ValMajor, &ValMinor);
+  std::string Context = "validator " + std::to_string(ValMajor) + "." +
+                        std::to_string(ValMinor);
+  DxilFunctionFingerprints Fingerprints;
+  Fingerprints.Compute(DM, Context);
+  const DxilFunctionFingerprints::DigestMap &Digests =
+      Fingerprints.GetDigests();
+
+  for (Function &F : M.functions()) {
+    if (F.isDeclaration() || F.isMaterializable() ||
+        DM.IsPatchConstantShader(&F))
+      continue;
+    if (DM.HasDxilFunctionProps(&F) && !DM.GetDxilFunctionProps(&F).IsRay())
+      continue;
+    auto It = Digests.find(F.getName());
+    if (It == Digests.end())
+      continue;
+    // Whether the function is reached from an entry or a patch constant
+    // function changes which operations it may use.
+    uint8_t Reached[2] = {(uint8_t)ValCtx.entryFuncCallSet.count(&F),
+                          (uint8_t)ValCtx.patchConstFuncCallSet.count(&F)};
+    MD5 Hash;
+    Hash.update(ArrayRef<uint8_t>(It->second.data(), It->second.size()));
+    Hash.update(ArrayRef<uint8_t>(Reached));
+    MD5::MD5Result Digest;
+    Hash.final(Digest);
+    Result.emplace_back(&F, DxilValidationCache::Digest());
+    std::copy(std::begin(Digest), std::end(Digest),
+              Result.back().second.begin());
+  }
+}
+
+} // namespace
+
+bool DxilValidationCache::Contains(const Digest &D) const {
+  std::lock_guard<std::mutex> Lock(m_Mutex);
+  return m_Passed.count(D) != 0;
+}
+
+void DxilValidationCache::Add(const std::vector<Digest> &Digests) {
+  std::lock_guard<std::mutex> Lock(m_Mutex);
+  m_Passed.insert(Digests.begin(), Digests.end());
+}
+
+static void WriteReportString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (char C : Str) {
+    switch (C) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if ((unsigned char)C < 0x20)
+        OS << llvm::format("\\u%04x", (unsigned)C);
+      else
+        OS << C;
+    }
+  }
+  OS << '"';
+}
+
+void DxilValidationReport::WriteJson(std::string &Json) const {
+  raw_string_ostream OS(Json);
+  OS << "{\n  \"phases\": [";
+  bool First = true;
+  for (const Phase &P : Phases) {
+    OS << (First ? "\n" : ",\n") << "    { \"name\": ";
+    First = false;
+    WriteReportString(OS, P.Name);
+    OS << ", \"wall_ms\": " << llvm::format("%.3f", P.WallSeconds * 1000.0) << " }";
+  }
+  OS << (First ? "]" : "\n  ]");
+
+  // Group the findings by rule, keeping the order rules first fired in.
+  MapVector<unsigned, std::vector<const Finding *>> ByRule;
+  for (const Finding &F : Findings)
+    ByRule[(unsigned)F.Rule].push_back(&F);
+
+  OS << ",\n  \"rules\": [";
+  First = true;
+  for (auto &It : ByRule) {
+    OS << (First ? "\n" : ",\n") << "    { \"id\": " << It.first
+       << ", \"text\": ";
+    First = false;
+    WriteReportString(OS, GetValidationRuleText((ValidationRule)It.first));
+    OS << ", \"count\": " << It.second.size() << ", \"locations\": [";
+    bool FirstLoc = true;
+    for (const Finding *F : It.second) {
+      OS << (FirstLoc ? " " : ", ") << "{ \"object\": ";
+      FirstLoc = false;
+      WriteReportString(OS, F->Object);
+      if (!F->File.empty()) {
+        OS << ", \"file\": ";
+        WriteReportString(OS, F->File);
+        OS << ", \"line\": " << F->Line << ", \"column\": " << F->Column;
+      }
+      OS << " }";
+    }
+    OS << (FirstLoc ? "] }" : " ] }");
+  }
+  OS << (First ? "]" : "\n  ]");
+  OS << "\n}\n";
+  OS.flush();
+}
+
 _Use_decl_annotations_ HRESULT ValidateDxilModule(
     llvm::Module *pModule,
-    llvm::Module *pDebugModule) {
+    llvm::Module *pDebugModule,
+    unsigned ThreadCount,
+    DxilValidationCache *pCache,
+    DxilValidationReport *pReport) {
   DxilModule *pDxilModule = DxilModule::TryGetDxilModule(pModule);
   if (!pDxilModule) {
     return DXC_E_IR_VERIFICATION_FAILED;
@@ -5766,32 +6160,110 @@ _Use_decl_annotations_ HRESULT ValidateDxilModule(
   }
 
   ValidationContext ValCtx(*pModule, pDebugModule, *pDxilModule);
+  if (pReport)
+    ValCtx.pFindings = &pReport->Findings;
 
-  ValidateBitcode(ValCtx);
-
-  ValidateMetadata(ValCtx);
-
-  ValidateShaderState(ValCtx);
+  {
+    ValidationPhase Phase("Validate Bitcode", pReport);
+    ValidateBitcode(ValCtx);
+  }
 
-  ValidateGlobalVariables(ValCtx);
+  {
+    ValidationPhase Phase("Validate Metadata", pReport);
+    ValidateMetadata(ValCtx);
+    ValidateShaderState(ValCtx);
+    ValidateGlobalVariables(ValCtx);
+  }
 
-  ValidateResources(ValCtx);
+  {
+    ValidationPhase Phase("Validate Resources", pReport);
+    ValidateResources(ValCtx);
+  }
 
   // Validate control flow and collect function call info.
   // If has recursive call, call info collection will not finish.
-  ValidateFlowControl(ValCtx);
+  {
+    ValidationPhase Phase("Validate Control Flow", pReport);
+    ValidateFlowControl(ValCtx);
+  }
 
-  // Validate functions.
-  for (Function &F : pModule->functions()) {
-    ValidateFunction(F, ValCtx);
+  // Library functions the cache has seen pass need no checks of their own.
+  std::vector<std::pair<Function *, DxilValidationCache::Digest>> CacheDigests;
+  if (pCache && !pDebugModule) {
+    GetValidationCacheDigests(ValCtx, CacheDigests);
+    for (auto &It : CacheDigests)
+      if (pCache->Contains(It.second))
+        ValCtx.cachedFuncSet.insert(It.first);
   }
 
-  ValidateShaderFlags(ValCtx);
+  // Validate functions. Libraries may spread this over threads; a shader
+  // has one or two functions, which also share the UAV counter direction
+  // checks, so it, and anything with a debug module, stays on this thread.
+  {
+    ValidationPhase Phase("Validate Functions", pReport);
+    if (ThreadCount < 2 || !ValCtx.isLibProfile || pDebugModule ||
+        !ValidateFunctionsInParallel(ValCtx, ThreadCount)) {
+      for (Function &F : pModule->functions()) {
+        if (!ValCtx.cachedFuncSet.count(&F))
+          ValidateFunction(F, ValCtx);
+      }
+    }
+    ValidateShaderFlags(ValCtx);
+  }
 
-  ValidateEntrySignatures(ValCtx);
+  {
+    ValidationPhase Phase("Validate Signatures", pReport);
+    ValidateEntrySignatures(ValCtx);
+  }
 
-  ValidateUninitializedOutput(ValCtx);
+  {
+    ValidationPhase Phase("Validate Uninitialized Outputs", pReport);
+    ValidateUninitializedOutput(ValCtx);
+  }
   // Ensure error messages are flushed out on error.
+  if (ValCtx.Failed) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+  if (!CacheDigests.empty()) {
+    std::vector<DxilValidationCache::Digest> Passed;
+    for (auto &It : CacheDigests)
+      Passed.push_back(It.second);
+    pCache->Add(Passed);
+  }
+  return S_OK;
+}
+
+_Use_decl_annotations_ HRESULT ValidateDxilModuleMetadata(llvm::Module *pModule,
+                                                          DxilValidationReport *pReport) {
+  DxilModule *pDxilModule = DxilModule::TryGetDxilModule(pModule);
+  if (!pDxilModule) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+  if (pDxilModule->HasMetadataErrors()) {
+    dxilutil::EmitErrorOnContext(pModule->getContext(), "Metadata error encountered in non-critical metadata (such as Type Annotations).");
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+
+  ValidationContext ValCtx(*pModule, nullptr, *pDxilModule);
+  if (pReport)
+    ValCtx.pFindings = &pReport->Findings;
+
+  {
+    ValidationPhase Phase("Validate Metadata", pReport);
+    ValidateMetadata(ValCtx);
+    ValidateShaderState(ValCtx);
+  }
+
+  {
+    ValidationPhase Phase("Validate Resources", pReport);
+    ValidateResources(ValCtx);
+  }
+
+  {
+    ValidationPhase Phase("Validate Signatures", pReport);
+    ValidateEntrySignatures(ValCtx);
+  }
+
   if (ValCtx.Failed) {
     return DXC_E_IR_VERIFICATION_FAILED;
   }
@@ -5929,8 +6401,8 @@ static void VerifyRDATMatches(_In_ ValidationContext &ValCtx,
   VerifyBlobPartMatches(ValCtx, PartName, pWriter.get(), pRDATData, RDATSize);
 
   // Verify no errors when runtime reflection from RDAT:
-  RDAT::DxilRuntimeReflection *pReflection = RDAT::CreateDxilRuntimeReflection();
-  if (!pReflection->InitFromRDAT(pRDATData, RDATSize)) {
+  RDAT::DxilRuntimeData runtimeData;
+  if (!runtimeData.InitFromRDAT(pRDATData, RDATSize)) {
     ValCtx.EmitFormatError(ValidationRule::ContainerPartMatches, { PartName });
     return;
   }
@@ -5958,7 +6430,8 @@ _Use_decl_annotations_
 HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
                                    llvm::Module *pDebugModule,
                                    const DxilContainerHeader *pContainer,
-                                   uint32_t ContainerSize) {
+                                   uint32_t ContainerSize,
+                                   DxilValidationReport *pReport) {
 
   DXASSERT_NOMSG(pModule);
   if (!pContainer || !IsValidDxilContainer(pContainer, ContainerSize)) {
@@ -5970,7 +6443,10 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
     return DXC_E_IR_VERIFICATION_FAILED;
   }
 
+  ValidationPhase Phase("Validate Container Parts", pReport);
   ValidationContext ValCtx(*pModule, pDebugModule, *pDxilModule);
+  if (pReport)
+    ValCtx.pFindings = &pReport->Findings;
 
   DXIL::ShaderKind ShaderKind = pDxilModule->GetShaderModel()->GetKind();
   bool bTessOrMesh = ShaderKind == DXIL::ShaderKind::Hull ||
@@ -6097,13 +6573,12 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
         std::string diagStr;
         raw_string_ostream DiagStream(diagStr);
         try {
-          RootSignatureHandle RS;
-          RS.LoadSerialized((const uint8_t*)GetDxilPartData(pRootSignaturePart), pRootSignaturePart->PartSize);
-          RS.Deserialize();
-          IFTBOOL(VerifyRootSignatureWithShaderPSV(RS.GetDesc(),
-                                                   pDxilModule->GetShaderModel()->GetKind(),
-                                                   GetDxilPartData(pPSVPart), pPSVPart->PartSize,
-                                                   DiagStream),
+          IFTBOOL(VerifySerializedRootSignatureWithShaderPSV(
+                      GetDxilPartData(pRootSignaturePart),
+                      pRootSignaturePart->PartSize,
+                      pDxilModule->GetShaderModel()->GetKind(),
+                      GetDxilPartData(pPSVPart), pPSVPart->PartSize,
+                      DiagStream),
                   DXC_E_INCORRECT_ROOT_SIGNATURE);
         } catch (...) {
           ValCtx.EmitError(ValidationRule::ContainerRootSignatureIncompatible);
@@ -6144,7 +6619,8 @@ static HRESULT FindDxilPart(_In_reads_bytes_(ContainerSize) const void *pContain
 
   const DxilProgramHeader *pProgramHeader =
     reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(*it));
-  if (!IsValidDxilProgramHeader(pProgramHeader, (*it)->PartSize)) {
+  if (!IsValidDxilProgramHeader(pProgramHeader, (*it)->PartSize) &&
+      !IsValidCompressedDxilProgramHeader(pProgramHeader, (*it)->PartSize)) {
     IFR(DXC_E_CONTAINER_INVALID);
   }
 
@@ -6152,22 +6628,16 @@ static HRESULT FindDxilPart(_In_reads_bytes_(ContainerSize) const void *pContain
   return S_OK;
 }
 
-_Use_decl_annotations_
-HRESULT ValidateLoadModule(const char *pIL,
-                           uint32_t ILLength,
-                           unique_ptr<llvm::Module> &pModule,
-                           LLVMContext &Ctx,
-                           llvm::raw_ostream &DiagStream,
-                           unsigned bLazyLoad) {
+static HRESULT ValidateLoadModule(std::unique_ptr<llvm::MemoryBuffer> pBitcodeBuf,
+                                  unique_ptr<llvm::Module> &pModule,
+                                  LLVMContext &Ctx,
+                                  llvm::raw_ostream &DiagStream,
+                                  unsigned bLazyLoad) {
 
   llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
   PrintDiagnosticContext DiagContext(DiagPrinter);
   DiagRestore DR(Ctx, &DiagContext);
 
-  std::unique_ptr<llvm::MemoryBuffer> pBitcodeBuf;
-  pBitcodeBuf.reset(llvm::MemoryBuffer::getMemBuffer(
-      llvm::StringRef(pIL, ILLength), "", false).release());
-
   ErrorOr<std::unique_ptr<Module>> loadedModuleResult =
       bLazyLoad == 0?
       llvm::parseBitcodeFile(pBitcodeBuf->getMemBufferRef(), Ctx, nullptr, true /*Track Bitstream*/) :
@@ -6182,6 +6652,48 @@ HRESULT ValidateLoadModule(const char *pIL,
   return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT ValidateLoadModule(const char *pIL,
+                           uint32_t ILLength,
+                           unique_ptr<llvm::Module> &pModule,
+                           LLVMContext &Ctx,
+                           llvm::raw_ostream &DiagStream,
+                           unsigned bLazyLoad) {
+  return ValidateLoadModule(
+      llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(pIL, ILLength), "",
+                                       false),
+      pModule, Ctx, DiagStream, bLazyLoad);
+}
+
+// Loads the module of a part found by FindDxilPart. Bitcode that was
+// compressed is expanded into a buffer the module owns, which a lazily loaded
+// module reads from after this returns.
+static HRESULT ValidateLoadModuleFromPart(const DxilPartHeader *pPart,
+                                          unique_ptr<llvm::Module> &pModule,
+                                          LLVMContext &Ctx,
+                                          llvm::raw_ostream &DiagStream,
+                                          unsigned bLazyLoad) {
+  const DxilProgramHeader *pProgramHeader =
+      reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart));
+  const char *pIL = nullptr;
+  uint32_t ILLength = 0;
+  if (IsValidDxilProgramHeader(pProgramHeader, pPart->PartSize)) {
+    GetDxilProgramBitcode(pProgramHeader, &pIL, &ILLength);
+    return ValidateLoadModule(pIL, ILLength, pModule, Ctx, DiagStream,
+                              bLazyLoad);
+  }
+
+  std::vector<uint32_t> ExpandedProgram;
+  pProgramHeader = GetValidDxilProgramHeader(pProgramHeader, pPart->PartSize,
+                                             ExpandedProgram);
+  if (!pProgramHeader)
+    return DXC_E_CONTAINER_INVALID;
+  GetDxilProgramBitcode(pProgramHeader, &pIL, &ILLength);
+  return ValidateLoadModule(
+      llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(pIL, ILLength)),
+      pModule, Ctx, DiagStream, bLazyLoad);
+}
+
 HRESULT ValidateDxilBitcode(
   _In_reads_bytes_(ILLength) const char *pIL,
   _In_ uint32_t ILLength,
@@ -6213,15 +6725,11 @@ HRESULT ValidateDxilBitcode(
     pOutputStream->Reserve(pWriter->size());
     pWriter->write(pOutputStream);
     try {
-      const DxilVersionedRootSignatureDesc* pDesc = nullptr;
-      DeserializeRootSignature(SerializedRootSig.data(), SerializedRootSig.size(), &pDesc);
-      if (!pDesc) {
-        return DXC_E_INCORRECT_ROOT_SIGNATURE;
-      }
-      IFTBOOL(VerifyRootSignatureWithShaderPSV(pDesc,
-                                               dxilModule.GetShaderModel()->GetKind(),
-                                               pOutputStream->GetPtr(), pWriter->size(),
-                                               DiagStream), DXC_E_INCORRECT_ROOT_SIGNATURE);
+      IFTBOOL(VerifySerializedRootSignatureWithShaderPSV(
+                  SerializedRootSig.data(), SerializedRootSig.size(),
+                  dxilModule.GetShaderModel()->GetKind(),
+                  pOutputStream->GetPtr(), pWriter->size(), DiagStream),
+              DXC_E_INCORRECT_ROOT_SIGNATURE);
     } catch (...) {
       return DXC_E_INCORRECT_ROOT_SIGNATURE;
     }
@@ -6248,13 +6756,7 @@ static HRESULT ValidateLoadModuleFromContainer(
   const DxilPartHeader *pPart = nullptr;
   IFR(FindDxilPart(pContainer, ContainerSize, DFCC_DXIL, &pPart));
 
-  const char *pIL = nullptr;
-  uint32_t ILLength = 0;
-  GetDxilProgramBitcode(
-      reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart)), &pIL,
-      &ILLength);
-
-  IFR(ValidateLoadModule(pIL, ILLength, pModule, Ctx, DiagStream, bLazyLoad));
+  IFR(ValidateLoadModuleFromPart(pPart, pModule, Ctx, DiagStream, bLazyLoad));
 
   HRESULT hr;
   const DxilPartHeader *pDbgPart = nullptr;
@@ -6265,11 +6767,8 @@ static HRESULT ValidateLoadModuleFromContainer(
   }
 
   if (pDbgPart) {
-    GetDxilProgramBitcode(
-        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pDbgPart)),
-        &pIL, &ILLength);
-    if (FAILED(hr = ValidateLoadModule(pIL, ILLength, pDebugModule, DbgCtx,
-                                       DiagStream, bLazyLoad))) {
+    if (FAILED(hr = ValidateLoadModuleFromPart(pDbgPart, pDebugModule, DbgCtx,
+                                               DiagStream, bLazyLoad))) {
       return hr;
     }
   }
@@ -6304,7 +6803,8 @@ HRESULT ValidateDxilContainer(const void *pContainer,
                               uint32_t ContainerSize,
                               const void *pOptDebugBitcode,
                               uint32_t OptDebugBitcodeSize,
-                              llvm::raw_ostream &DiagStream) {
+                              llvm::raw_ostream &DiagStream,
+                              DxilValidationReport *pReport) {
   LLVMContext Ctx, DbgCtx;
   std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
@@ -6325,20 +6825,61 @@ HRESULT ValidateDxilContainer(const void *pContainer,
   }
 
   // Validate DXIL Module
-  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get()));
+  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get(), 1, nullptr,
+                         pReport));
 
   if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
     return DXC_E_IR_VERIFICATION_FAILED;
   }
 
   return ValidateDxilContainerParts(pModule.get(), pDebugModule.get(),
-    IsDxilContainerLike(pContainer, ContainerSize), ContainerSize);
+    IsDxilContainerLike(pContainer, ContainerSize), ContainerSize, pReport);
+}
+
+_Use_decl_annotations_
+HRESULT ValidateDxilContainerMetadata(const void *pContainer,
+                                      uint32_t ContainerSize,
+                                      llvm::raw_ostream &DiagStream,
+                                      DxilValidationReport *pReport) {
+  LLVMContext Ctx, DbgCtx;
+  std::unique_ptr<llvm::Module> pModule, pDebugModule;
+
+  llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+  PrintDiagnosticContext DiagContext(DiagPrinter);
+  Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                           &DiagContext, true);
+  DbgCtx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                              &DiagContext, true);
+
+  IFR(ValidateLoadModuleFromContainerLazy(pContainer, ContainerSize, pModule,
+                                          pDebugModule, Ctx, DbgCtx,
+                                          DiagStream));
+
+  IFR(ValidateDxilModuleMetadata(pModule.get(), pReport));
+
+  if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+
+  // The runtime data of a library describes its functions.
+  if (pModule->GetDxilModule().GetShaderModel()->IsLib()) {
+    if (std::error_code EC = pModule->materializeAll()) {
+      dxilutil::EmitErrorOnContext(Ctx, "Failed to load the module: " +
+                                            EC.message());
+      return DXC_E_IR_VERIFICATION_FAILED;
+    }
+  }
+
+  return ValidateDxilContainerParts(pModule.get(), pDebugModule.get(),
+    IsDxilContainerLike(pContainer, ContainerSize), ContainerSize, pReport);
 }
 
 _Use_decl_annotations_
 HRESULT ValidateDxilContainer(const void *pContainer,
                               uint32_t ContainerSize,
-                              llvm::raw_ostream &DiagStream) {
-  return ValidateDxilContainer(pContainer, ContainerSize, nullptr, 0, DiagStream);
+                              llvm::raw_ostream &DiagStream,
+                              DxilValidationReport *pReport) {
+  return ValidateDxilContainer(pContainer, ContainerSize, nullptr, 0,
+                               DiagStream, pReport);
 }
 } // namespace hlsl
@@ -124,7 +124,12 @@ void TempOverloadPool::clear() {
 class HLMatrixLowerPass : public ModulePass {
 public:
   static char ID; // Pass identification, replacement for typeid
-  explicit HLMatrixLowerPass() : ModulePass(ID) {}
+  explicit HLMatrixLowerPass(bool UseDotProducts = false)
+      : ModulePass(ID), m_UseDotProducts(UseDotProducts) {}
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionBool(O, "dot-products", &m_UseDotProducts, false);
+  }
 
   const char *getPassName() const override { return "HL matrix lower"; }
   bool runOnModule(Module &M) override;
@@ -170,22 +175,44 @@ private:
   Value *lowerHLInit(CallInst *Call);
   Value *lowerHLSelect(CallInst *Call);
 
+  Type *getLoweredType(Type *Ty, bool MemRepr = false);
+  Function *getHLFunction(FunctionType *FuncTy, HLOpcodeGroup OpcodeGroup,
+                          unsigned Opcode, const AttributeSet &Attribs);
+  Value *callHLFunction(HLOpcodeGroup OpcodeGroup, unsigned Opcode,
+                        Type *RetTy, ArrayRef<Value*> Args,
+                        const AttributeSet &Attribs, IRBuilder<> &Builder);
+  void getLoweredElements(Value *LoweredVal, SmallVectorImpl<Value*> &Elems,
+                          IRBuilder<> &Builder);
+
 private:
   Module *m_pModule;
   HLModule *m_pHLModule;
   bool m_HasDbgInfo;
+  // Lower float multiplies with 2 to 4 terms per element to dot products.
+  bool m_UseDotProducts;
 
   // Pools for the translation stubs
   TempOverloadPool *m_matToVecStubs = nullptr;
   TempOverloadPool *m_vecToMatStubs = nullptr;
 
+  // Lowered types for register and memory representations, by original type.
+  DenseMap<Type*, Type*> m_loweredTypes[2];
+  // HL function declarations, by type, packed opcode and group, and
+  // attributes, saving the name mangling and symbol lookup.
+  DenseMap<std::pair<std::pair<FunctionType*, unsigned>, AttributeSet>, Function*> m_hlFunctions;
+  // Scalar elements of vectors built while lowering mul, so chained
+  // multiplies use them instead of extracting them back.
+  DenseMap<Value*, SmallVector<Value*, 16>> m_loweredElements;
+
   std::vector<Instruction *> m_deadInsts;
 };
 }
 
 char HLMatrixLowerPass::ID = 0;
 
-ModulePass *llvm::createHLMatrixLowerPass() { return new HLMatrixLowerPass(); }
+ModulePass *llvm::createHLMatrixLowerPass(bool UseDotProducts) {
+  return new HLMatrixLowerPass(UseDotProducts);
+}
 
 INITIALIZE_PASS(HLMatrixLowerPass, "hlmatrixlower", "HLSL High-Level Matrix Lower", false, false)
 
@@ -223,6 +250,9 @@ bool HLMatrixLowerPass::runOnModule(Module &M) {
   m_pHLModule = nullptr;
   m_matToVecStubs = nullptr;
   m_vecToMatStubs = nullptr;
+  m_loweredTypes[0].clear();
+  m_loweredTypes[1].clear();
+  m_hlFunctions.clear();
 
   // If you hit an assert during TempOverloadPool destruction,
   // it means that either a matrix producer was lowered,
@@ -255,9 +285,54 @@ void HLMatrixLowerPass::runOnFunction(Function &Func) {
   for (Instruction *MatInst : MatInsts)
     lowerInstruction(MatInst);
 
+  m_loweredElements.clear();
   deleteDeadInsts();
 }
 
+Type *HLMatrixLowerPass::getLoweredType(Type *Ty, bool MemRepr) {
+  Type *&LoweredTy = m_loweredTypes[MemRepr][Ty];
+  if (LoweredTy == nullptr)
+    LoweredTy = HLMatrixType::getLoweredType(Ty, MemRepr);
+  return LoweredTy;
+}
+
+Function *HLMatrixLowerPass::getHLFunction(FunctionType *FuncTy, HLOpcodeGroup OpcodeGroup,
+                                           unsigned Opcode, const AttributeSet &Attribs) {
+  // Attribute sets are uniqued, so they can be compared by identity.
+  unsigned Opcodes = (Opcode << 4) | (unsigned)OpcodeGroup;
+  Function *&Func = m_hlFunctions[std::make_pair(std::make_pair(FuncTy, Opcodes), Attribs)];
+  if (Func == nullptr)
+    Func = GetOrCreateHLFunction(*m_pModule, FuncTy, OpcodeGroup, Opcode, Attribs);
+  return Func;
+}
+
+Value *HLMatrixLowerPass::callHLFunction(HLOpcodeGroup OpcodeGroup, unsigned Opcode,
+                                         Type *RetTy, ArrayRef<Value*> Args,
+                                         const AttributeSet &Attribs, IRBuilder<> &Builder) {
+  SmallVector<Type*, 4> ArgTys;
+  ArgTys.reserve(Args.size());
+  for (Value *Arg : Args)
+    ArgTys.emplace_back(Arg->getType());
+
+  FunctionType *FuncTy = FunctionType::get(RetTy, ArgTys, /* isVarArg */ false);
+  return Builder.CreateCall(getHLFunction(FuncTy, OpcodeGroup, Opcode, Attribs), Args);
+}
+
+// Gets the scalar elements of a lowered matrix vector, reusing the ones
+// it was built from if it is the result of a lowered mul.
+void HLMatrixLowerPass::getLoweredElements(Value *LoweredVal, SmallVectorImpl<Value*> &Elems,
+                                           IRBuilder<> &Builder) {
+  auto It = m_loweredElements.find(LoweredVal);
+  if (It != m_loweredElements.end()) {
+    Elems.append(It->second.begin(), It->second.end());
+    return;
+  }
+
+  unsigned NumElems = LoweredVal->getType()->getVectorNumElements();
+  for (unsigned ElemIdx = 0; ElemIdx < NumElems; ++ElemIdx)
+    Elems.emplace_back(Builder.CreateExtractElement(LoweredVal, static_cast<uint64_t>(ElemIdx)));
+}
+
 void HLMatrixLowerPass::deleteDeadInsts() {
   while (!m_deadInsts.empty()) {
     Instruction *Inst = m_deadInsts.back();
@@ -419,7 +494,7 @@ Value *HLMatrixLowerPass::tryGetLoweredPtrOperand(Value *Ptr, IRBuilder<> &Build
   if (IsNonShaderArg || isa<AllocaInst>(RootPtr)) {
     // Bitcast the matrix pointer to its lowered equivalent.
     // The HLMatrixBitcast pass will take care of this later.
-    return Builder.CreateBitCast(Ptr, HLMatrixType::getLoweredType(Ptr->getType()));
+    return Builder.CreateBitCast(Ptr, getLoweredType(Ptr->getType()));
   }
 
   // The pointer must be derived from a resource, we don't handle it in this pass.
@@ -579,7 +654,7 @@ void HLMatrixLowerPass::replaceAllVariableUses(
 void HLMatrixLowerPass::lowerGlobal(GlobalVariable *Global) {
   if (Global->user_empty()) return;
 
-  PointerType *LoweredPtrTy = cast<PointerType>(HLMatrixType::getLoweredType(Global->getType()));
+  PointerType *LoweredPtrTy = cast<PointerType>(getLoweredType(Global->getType()));
   DXASSERT_NOMSG(LoweredPtrTy != Global->getType());
 
   Constant *LoweredInitVal = Global->hasInitializer()
@@ -613,7 +688,7 @@ Constant *HLMatrixLowerPass::lowerConstInitVal(Constant *Val) {
       LoweredElems.emplace_back(lowerConstInitVal(ArrayElem));
     }
 
-    Type *LoweredElemTy = HLMatrixType::getLoweredType(ArrayTy->getElementType(), /*MemRepr*/true);
+    Type *LoweredElemTy = getLoweredType(ArrayTy->getElementType(), /*MemRepr*/true);
     ArrayType *LoweredArrayTy = ArrayType::get(LoweredElemTy, NumElems);
     return ConstantArray::get(LoweredArrayTy, LoweredElems);
   }
@@ -645,7 +720,7 @@ Constant *HLMatrixLowerPass::lowerConstInitVal(Constant *Val) {
 }
 
 AllocaInst *HLMatrixLowerPass::lowerAlloca(AllocaInst *MatAlloca) {
-  PointerType *LoweredAllocaTy = cast<PointerType>(HLMatrixType::getLoweredType(MatAlloca->getType()));
+  PointerType *LoweredAllocaTy = cast<PointerType>(getLoweredType(MatAlloca->getType()));
 
   IRBuilder<> Builder(MatAlloca);
   AllocaInst *LoweredAlloca = Builder.CreateAlloca(
@@ -860,8 +935,8 @@ Value *HLMatrixLowerPass::lowerHLIntrinsic(CallInst *Call, IntrinsicOp Opcode) {
     }
   }
 
-  Type *LoweredRetTy = HLMatrixType::getLoweredType(Call->getType());
-  return callHLFunction(*m_pModule, HLOpcodeGroup::HLIntrinsic, static_cast<unsigned>(Opcode),
+  Type *LoweredRetTy = getLoweredType(Call->getType());
+  return callHLFunction(HLOpcodeGroup::HLIntrinsic, static_cast<unsigned>(Opcode),
                         LoweredRetTy, LoweredArgs,
                         Call->getCalledFunction()->getAttributes().getFnAttributes(), Builder);
 }
@@ -947,21 +1022,53 @@ Value *HLMatrixLowerPass::lowerHLMulIntrinsic(Value* Lhs, Value *Rhs,
   // Get the multiply-and-add intrinsic function, we'll need it
   IntrinsicOp MadOpcode = Unsigned ? IntrinsicOp::IOP_umad : IntrinsicOp::IOP_mad;
   FunctionType *MadFuncTy = FunctionType::get(ElemTy, { Builder.getInt32Ty(), ElemTy, ElemTy, ElemTy }, false);
-  Function *MadFunc = GetOrCreateHLFunction(*m_pModule, MadFuncTy, HLOpcodeGroup::HLIntrinsic, (unsigned)MadOpcode);
+  Function *MadFunc = getHLFunction(MadFuncTy, HLOpcodeGroup::HLIntrinsic, (unsigned)MadOpcode, AttributeSet());
   Constant *MadOpcodeVal = Builder.getInt32((unsigned)MadOpcode);
 
+  // Dot products exist for half and float, with 2 to 4 terms.
+  bool UseDot = m_UseDotProducts && (ElemTy->isHalfTy() || ElemTy->isFloatTy()) &&
+                AccCount >= 2 && AccCount <= 4;
+  Function *DotFunc = nullptr;
+  Constant *DotOpcodeVal = nullptr;
+  VectorType *DotVecTy = nullptr;
+  if (UseDot) {
+    DotVecTy = VectorType::get(ElemTy, AccCount);
+    FunctionType *DotFuncTy = FunctionType::get(ElemTy, { Builder.getInt32Ty(), DotVecTy, DotVecTy }, false);
+    DotFunc = getHLFunction(DotFuncTy, HLOpcodeGroup::HLIntrinsic, (unsigned)IntrinsicOp::IOP_dot, AttributeSet());
+    DotOpcodeVal = Builder.getInt32((unsigned)IntrinsicOp::IOP_dot);
+  }
+
+  // Extract each operand element once, or pick them up from a previous mul.
+  SmallVector<Value*, 16> LhsElems;
+  SmallVector<Value*, 16> RhsElems;
+  getLoweredElements(LoweredLhs, LhsElems, Builder);
+  getLoweredElements(LoweredRhs, RhsElems, Builder);
+
   // Perform the multiplication!
+  SmallVector<Value*, 16> ResultElems(LhsNumRows * RhsNumCols);
   Value *Result = UndefValue::get(VectorType::get(ElemTy, LhsNumRows * RhsNumCols));
   for (unsigned ResultRowIdx = 0; ResultRowIdx < ResultMatTy.getNumRows(); ++ResultRowIdx) {
     for (unsigned ResultColIdx = 0; ResultColIdx < ResultMatTy.getNumColumns(); ++ResultColIdx) {
       unsigned ResultElemIdx = ResultMatTy.getRowMajorIndex(ResultRowIdx, ResultColIdx);
       Value *ResultElem = nullptr;
 
-      for (unsigned AccIdx = 0; AccIdx < AccCount; ++AccIdx) {
+      if (UseDot) {
+        Value *LhsVec = UndefValue::get(DotVecTy);
+        Value *RhsVec = UndefValue::get(DotVecTy);
+        for (unsigned AccIdx = 0; AccIdx < AccCount; ++AccIdx) {
+          unsigned LhsElemIdx = HLMatrixType::getRowMajorIndex(ResultRowIdx, AccIdx, LhsNumRows, LhsNumCols);
+          unsigned RhsElemIdx = HLMatrixType::getRowMajorIndex(AccIdx, ResultColIdx, RhsNumRows, RhsNumCols);
+          LhsVec = Builder.CreateInsertElement(LhsVec, LhsElems[LhsElemIdx], static_cast<uint64_t>(AccIdx));
+          RhsVec = Builder.CreateInsertElement(RhsVec, RhsElems[RhsElemIdx], static_cast<uint64_t>(AccIdx));
+        }
+        ResultElem = Builder.CreateCall(DotFunc, { DotOpcodeVal, LhsVec, RhsVec });
+      }
+
+      for (unsigned AccIdx = 0; !UseDot && AccIdx < AccCount; ++AccIdx) {
         unsigned LhsElemIdx = HLMatrixType::getRowMajorIndex(ResultRowIdx, AccIdx, LhsNumRows, LhsNumCols);
         unsigned RhsElemIdx = HLMatrixType::getRowMajorIndex(AccIdx, ResultColIdx, RhsNumRows, RhsNumCols);
-        Value* LhsElem = Builder.CreateExtractElement(LoweredLhs, static_cast<uint64_t>(LhsElemIdx));
-        Value* RhsElem = Builder.CreateExtractElement(LoweredRhs, static_cast<uint64_t>(RhsElemIdx));
+        Value* LhsElem = LhsElems[LhsElemIdx];
+        Value* RhsElem = RhsElems[RhsElemIdx];
         if (ResultElem == nullptr) {
           ResultElem = ElemTy->isFloatingPointTy()
             ? Builder.CreateFMul(LhsElem, RhsElem)
@@ -972,10 +1079,12 @@ Value *HLMatrixLowerPass::lowerHLMulIntrinsic(Value* Lhs, Value *Rhs,
         }
       }
 
+      ResultElems[ResultElemIdx] = ResultElem;
       Result = Builder.CreateInsertElement(Result, ResultElem, static_cast<uint64_t>(ResultElemIdx));
     }
   }
 
+  m_loweredElements[Result].append(ResultElems.begin(), ResultElems.end());
   return Result;
 }
 
@@ -1265,7 +1374,7 @@ Value *HLMatrixLowerPass::lowerHLLoad(CallInst *Call, Value *MatPtr, bool RowMaj
     // Can't lower this here, defer to HL signature lower
     HLMatLoadStoreOpcode Opcode = RowMajor ? HLMatLoadStoreOpcode::RowMatLoad : HLMatLoadStoreOpcode::ColMatLoad;
     return callHLFunction(
-      *m_pModule, HLOpcodeGroup::HLMatLoadStore, static_cast<unsigned>(Opcode),
+      HLOpcodeGroup::HLMatLoadStore, static_cast<unsigned>(Opcode),
       MatTy.getLoweredVectorTypeForReg(), { Builder.getInt32((uint32_t)Opcode), MatPtr },
       Call->getCalledFunction()->getAttributes().getFnAttributes(), Builder);
   }
@@ -1284,7 +1393,7 @@ Value *HLMatrixLowerPass::lowerHLStore(CallInst *Call, Value *MatVal, Value *Mat
     // Can't lower the pointer here, defer to HL signature lower
     HLMatLoadStoreOpcode Opcode = RowMajor ? HLMatLoadStoreOpcode::RowMatStore : HLMatLoadStoreOpcode::ColMatStore;
     return callHLFunction(
-      *m_pModule, HLOpcodeGroup::HLMatLoadStore, static_cast<unsigned>(Opcode),
+      HLOpcodeGroup::HLMatLoadStore, static_cast<unsigned>(Opcode),
       Return ? LoweredVal->getType() : Builder.getVoidTy(),
       { Builder.getInt32((uint32_t)Opcode), MatPtr, LoweredVal },
       Call->getCalledFunction()->getAttributes().getFnAttributes(), Builder);
@@ -1373,7 +1482,7 @@ Value *HLMatrixLowerPass::lowerHLCast(CallInst *Call, Value *Src, Type *DstTy,
     // Preserve them, but change the return type to vector.
     DXASSERT(Opcode == HLCastOpcode::ColMatrixToVecCast || Opcode == HLCastOpcode::RowMatrixToVecCast,
       "Unexpected cast of matrix argument.");
-    LoweredSrc = callHLFunction(*m_pModule, HLOpcodeGroup::HLCast, static_cast<unsigned>(Opcode),
+    LoweredSrc = callHLFunction(HLOpcodeGroup::HLCast, static_cast<unsigned>(Opcode),
       LoweredSrcTy, { Builder.getInt32((uint32_t)Opcode), Src },
       Call->getCalledFunction()->getAttributes().getFnAttributes(), Builder);
   }
@@ -1514,7 +1623,7 @@ void HLMatrixLowerPass::lowerHLMatSubscript(CallInst *Call, Value *MatPtr, Small
                                    HLMatLoadStoreOpcode::RowMatLoad : HLMatLoadStoreOpcode::ColMatLoad;
     HLMatrixType MatTy = HLMatrixType::cast(MatPtr->getType()->getPointerElementType());
     LoweredMatrix = callHLFunction(
-      *m_pModule, HLOpcodeGroup::HLMatLoadStore, static_cast<unsigned>(Opcode),
+      HLOpcodeGroup::HLMatLoadStore, static_cast<unsigned>(Opcode),
       MatTy.getLoweredVectorTypeForReg(), { CallBuilder.getInt32((uint32_t)Opcode), MatPtr },
       Call->getCalledFunction()->getAttributes().getFnAttributes(), CallBuilder);
   }
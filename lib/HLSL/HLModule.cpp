@@ -72,6 +72,7 @@ HLModule::HLModule(Module *pModule)
     , m_Float32DenormMode(DXIL::Float32DenormMode::Any)
     , m_pOP(llvm::make_unique<OP>(pModule->getContext(), pModule))
     , m_AutoBindingSpace(UINT_MAX)
+    , m_bHasDownstreamInputs(false)
     , m_DefaultLinkage(DXIL::DefaultLinkage::Default)
     , m_pTypeSystem(llvm::make_unique<DxilTypeSystem>(pModule)) {
   DXASSERT_NOMSG(m_pModule != nullptr);
@@ -157,6 +158,35 @@ uint32_t HLModule::GetAutoBindingSpace() const {
   return m_AutoBindingSpace;
 }
 
+static std::string GetDownstreamInputKey(StringRef SemanticName,
+                                         unsigned SemanticIndex) {
+  return SemanticName.lower() + std::to_string(SemanticIndex);
+}
+
+void HLModule::SetDownstreamInputs(const std::vector<std::string> &Inputs) {
+  m_bHasDownstreamInputs = true;
+  m_DownstreamInputs.clear();
+  for (StringRef Input : Inputs) {
+    // An empty entry only states that nothing is read.
+    if (Input.empty())
+      continue;
+    size_t NameEnd = Input.find_last_not_of("0123456789") + 1;
+    unsigned SemanticIndex = 0;
+    Input.substr(NameEnd).getAsInteger(10, SemanticIndex);
+    m_DownstreamInputs.insert(
+        GetDownstreamInputKey(Input.substr(0, NameEnd), SemanticIndex));
+  }
+}
+bool HLModule::HasDownstreamInputs() const {
+  return m_bHasDownstreamInputs;
+}
+bool HLModule::IsReadDownstream(StringRef SemanticName,
+                                unsigned SemanticIndex) const {
+  return !m_bHasDownstreamInputs ||
+         m_DownstreamInputs.count(
+             GetDownstreamInputKey(SemanticName, SemanticIndex));
+}
+
 Function *HLModule::GetEntryFunction() const {
   return m_pEntryFunc;
 }
@@ -370,7 +400,7 @@ bool HLModule::HasDxilFunctionProps(llvm::Function *F) {
 }
 DxilFunctionProps &HLModule::GetDxilFunctionProps(llvm::Function *F)  {
   DXASSERT(m_DxilFunctionPropsMap.count(F) != 0, "cannot find F in map");
-  return *m_DxilFunctionPropsMap[F];
+  return *m_DxilFunctionPropsMap.find(F)->second;
 }
 void HLModule::AddDxilFunctionProps(llvm::Function *F, std::unique_ptr<DxilFunctionProps> &info) {
   DXASSERT(m_DxilFunctionPropsMap.count(F) == 0, "F already in map, info will be overwritten");
@@ -494,7 +524,7 @@ void HLModule::LoadHLMetadata() {
   const llvm::NamedMDNode *pEntries = m_pMDHelper->GetDxilEntryPoints();
 
   Function *pEntryFunc;
-  string EntryName;
+  StringRef EntryName;
   const llvm::MDOperand *pSignatures, *pResources, *pProperties;
   m_pMDHelper->GetDxilEntryPoint(pEntries->getOperand(0), pEntryFunc, EntryName, pSignatures, pResources, pProperties);
 
@@ -49,7 +49,15 @@ struct HLOperationLowerHelper {
   DxilFunctionProps *functionProps;
   bool bLegacyCBufferLoad;
   DataLayout dataLayout;
+  // Opcode arguments of the DXIL operations, created on first use.
+  Constant *opcodeConsts[(unsigned)OP::OpCode::NumOpCodes] = {};
   HLOperationLowerHelper(HLModule &HLM);
+  Constant *GetOpcodeConst(OP::OpCode opcode) {
+    Constant *&C = opcodeConsts[(unsigned)opcode];
+    if (C == nullptr)
+      C = hlslOP.GetU32Const((unsigned)opcode);
+    return C;
+  }
 };
 
 HLOperationLowerHelper::HLOperationLowerHelper(HLModule &HLM)
@@ -182,8 +190,9 @@ public:
 
 private:
   ResAttribute &FindCreateHandleResourceBase(Value *Handle) {
-    if (HandleMetaMap.count(Handle))
-      return HandleMetaMap[Handle];
+    auto It = HandleMetaMap.find(Handle);
+    if (It != HandleMetaMap.end())
+      return It->second;
 
     // Add invalid first to avoid dead loop.
     HandleMetaMap[Handle] = {DXIL::ResourceClass::Invalid,
@@ -2862,8 +2871,7 @@ Value *TranslateCalculateLOD(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
 
   bool bClamped = IOP == IntrinsicOp::MOP_CalculateLevelOfDetail;
   IRBuilder<> Builder(CI);
-  Value *opArg =
-      hlslOP->GetU32Const(static_cast<unsigned>(OP::OpCode::CalculateLOD));
+  Value *opArg = helper.GetOpcodeConst(OP::OpCode::CalculateLOD);
   Value *clamped = hlslOP->GetI1Const(bClamped);
 
   Value *args[] = {opArg,
@@ -2923,7 +2931,7 @@ Value *TranslateSample(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
 
   Function *F = hlslOP->GetOpFunc(opcode, Ty->getScalarType());
 
-  Constant *opArg = hlslOP->GetU32Const((unsigned)opcode);
+  Constant *opArg = helper.GetOpcodeConst(opcode);
 
   switch (opcode) {
   case OP::OpCode::Sample: {
@@ -3284,7 +3292,7 @@ Value *TranslateGather(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
 
   Function *F = hlslOP->GetOpFunc(gatherHelper.opcode, Ty->getScalarType());
 
-  Constant *opArg = hlslOP->GetU32Const((unsigned)gatherHelper.opcode);
+  Constant *opArg = helper.GetOpcodeConst(gatherHelper.opcode);
   Value *channelArg = hlslOP->GetU32Const(gatherHelper.channel);
 
   switch (opcode) {
@@ -3337,7 +3345,7 @@ static Value* TranslateWriteSamplerFeedback(CallInst* CI, IntrinsicOp IOP, OP::O
 
   Function *F = hlslOP->GetOpFunc(opcode, Ty->getScalarType());
 
-  Constant *opArg = hlslOP->GetU32Const((unsigned)opcode);
+  Constant *opArg = helper.GetOpcodeConst(opcode);
 
   IRBuilder<> Builder(CI);
 
@@ -5708,10 +5716,10 @@ IntrinsicLower gLowerTable[] = {
 static_assert(sizeof(gLowerTable) / sizeof(gLowerTable[0]) == static_cast<size_t>(IntrinsicOp::Num_Intrinsics),
   "Intrinsic lowering table must be updated to account for new intrinsics.");
 
-static void TranslateBuiltinIntrinsic(CallInst *CI,
+static void TranslateBuiltinIntrinsic(CallInst *CI, const IntrinsicLower &lower,
                                       HLOperationLowerHelper &helper,  HLObjectOperationLowerHelper *pObjHelper, bool &Translated) {
-  unsigned opcode = hlsl::GetHLOpcode(CI);
-  const IntrinsicLower &lower = gLowerTable[opcode];
+  DXASSERT(&lower == &gLowerTable[hlsl::GetHLOpcode(CI)],
+           "else calls to one HL function have different opcodes");
   Value *Result =
       lower.LowerFunc(CI, lower.IntriOpcode, lower.DxilOpcode, helper, pObjHelper, Translated);
   if (Result)
@@ -7901,6 +7909,9 @@ static Instruction *CreateTransposeShuffle(IRBuilder<> &Builder, Value *vecVal,
 void TranslateHLBuiltinOperation(Function *F, HLOperationLowerHelper &helper,
                                hlsl::HLOpcodeGroup group, HLObjectOperationLowerHelper *pObjHelper) {
   if (group == HLOpcodeGroup::HLIntrinsic) {
+    // All calls to an HL function share its opcode, so look up the
+    // lowering once and apply it to each call in turn.
+    const IntrinsicLower *lower = nullptr;
     // map to dxil operations
     for (auto U = F->user_begin(); U != F->user_end();) {
       Value *User = *(U++);
@@ -7909,10 +7920,13 @@ void TranslateHLBuiltinOperation(Function *F, HLOperationLowerHelper &helper,
       // must be call inst
       CallInst *CI = cast<CallInst>(User);
 
+      if (lower == nullptr)
+        lower = &gLowerTable[hlsl::GetHLOpcode(CI)];
+
       // Keep the instruction to lower by other function.
       bool Translated = true;
 
-      TranslateBuiltinIntrinsic(CI, helper, pObjHelper, Translated);
+      TranslateBuiltinIntrinsic(CI, *lower, helper, pObjHelper, Translated);
 
       if (Translated) {
         // delete the call
@@ -23,6 +23,7 @@
 #include "dxc/DXIL/DxilUtil.h"
 #include "dxc/HLSL/DxilPackSignatureElement.h"
 
+#include "llvm/Analysis/VectorUtils.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -366,6 +367,24 @@ void HLSignatureLower::ProcessArgument(Function *func,
     }
   }
 
+  // Drop vertex outputs the next stage doesn't read before they are packed.
+  if (HLM.HasDownstreamInputs() &&
+      interpretation == DXIL::SemanticInterpretationKind::Arb &&
+      (sigPoint->GetKind() == DXIL::SigPointKind::VSOut ||
+       sigPoint->GetKind() == DXIL::SigPointKind::DSOut) &&
+      !m_inoutArgSet.count(&arg) && Ty->isPointerTy()) {
+    bool bRead = false;
+    for (unsigned idx : paramAnnotation.GetSemanticIndexVec())
+      bRead |= HLM.IsReadDownstream(semanticStr, idx);
+    if (!bRead) {
+      // Writes now go to a local, which is optimized away.
+      IRBuilder<> AllocaBuilder(dxilutil::FindAllocaInsertionPt(func));
+      arg.replaceAllUsesWith(
+          AllocaBuilder.CreateAlloca(Ty->getPointerElementType()));
+      return;
+    }
+  }
+
   // Determine signature this argument belongs in, if any
   DxilSignature *pSig = nullptr;
   DXIL::SignatureKind sigKind = sigPoint->GetSignatureKindWithFallback();
@@ -533,6 +552,16 @@ void GenerateStOutput(Function *stOutput, MutableArrayRef<Value *> args,
   Builder.CreateCall(stOutput, args);
 }
 
+// Get element idx of a vector being stored to an output. Stored vectors are
+// usually built right before the store by insertelement/shufflevector chains,
+// so look through those for the scalar instead of emitting an extractelement
+// per component for later passes to clean up.
+Value *GetStoredElement(Value *Vec, unsigned idx, IRBuilder<> &Builder) {
+  if (Value *Elt = findScalarElement(Vec, idx))
+    return Elt;
+  return Builder.CreateExtractElement(Vec, idx);
+}
+
 void replaceStWithStOutput(Function *stOutput, StoreInst *stInst,
                            Constant *OpArg, Constant *outputID, Value *idx,
                            unsigned cols, Value *vertexOrPrimID, bool bI1Cast) {
@@ -542,7 +571,7 @@ void replaceStWithStOutput(Function *stOutput, StoreInst *stInst,
   if (VectorType *VT = dyn_cast<VectorType>(val->getType())) {
     DXASSERT_LOCALVAR(VT, cols == VT->getNumElements(), "vec size must match");
     for (unsigned col = 0; col < cols; col++) {
-      Value *subVal = Builder.CreateExtractElement(val, col);
+      Value *subVal = GetStoredElement(val, col, Builder);
       Value *colIdx = Builder.getInt8(col);
       SmallVector<Value *, 4> args = {OpArg, outputID, idx, colIdx, subVal};
       if (vertexOrPrimID)
@@ -675,7 +704,7 @@ void replaceMatStWithStOutputs(CallInst *CI, HLMatLoadStoreOpcode matOp,
 
       for (unsigned r = 0; r < MatTy.getNumRows(); r++) {
         unsigned matIdx = MatTy.getColumnMajorIndex(r, c);
-        Value *Elt = LocalBuilder.CreateExtractElement(Val, matIdx);
+        Value *Elt = GetStoredElement(Val, matIdx, LocalBuilder);
 
         SmallVector<Value*, 6> argList = {OpArg, ID, colIdx, columnConsts[r], Elt};
         if (vertexOrPrimID)
@@ -689,7 +718,7 @@ void replaceMatStWithStOutputs(CallInst *CI, HLMatLoadStoreOpcode matOp,
       Value *rowIdx = LocalBuilder.CreateAdd(idxVal, constRowIdx);
       for (unsigned c = 0; c < MatTy.getNumColumns(); c++) {
         unsigned matIdx = MatTy.getRowMajorIndex(r, c);
-        Value *Elt = LocalBuilder.CreateExtractElement(Val, matIdx);
+        Value *Elt = GetStoredElement(Val, matIdx, LocalBuilder);
 
         SmallVector<Value*, 6> argList = {OpArg, ID, rowIdx, columnConsts[c], Elt};
         if (vertexOrPrimID)
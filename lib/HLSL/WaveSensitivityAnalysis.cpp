@@ -31,6 +31,8 @@
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/PostDominators.h"
 
 #ifdef _WIN32
@@ -51,6 +53,11 @@ namespace hlsl {
 // active lanes are modified.
 // To avoid unexpected result, validation will fail if gradient operations
 // are dependent on wave-sensitive data or control flow.
+//
+// The analysis is a sparse propagation over the lattice
+// Unknown < KnownNotSensitive < KnownSensitive. States only ever move up, so
+// an instruction or block is only re-queued when its state changes, and
+// instructions that already reached KnownSensitive are never revisited.
 
 class WaveSensitivityAnalyzer : public WaveSensitivityAnalysis {
 private:
@@ -60,10 +67,11 @@ private:
     Unknown
   };
   PostDominatorTree *pPDT;
-  map<Instruction *, WaveSensitivity> InstState;
-  map<BasicBlock *, WaveSensitivity> BBState;
+  DenseMap<Instruction *, WaveSensitivity> InstState;
+  DenseMap<BasicBlock *, WaveSensitivity> BBState;
   std::vector<Instruction *> InstWorkList;
   std::vector<PHINode *> UnknownPhis; // currently unknown phis. Indicate cycles after Analyze
+  SmallPtrSet<PHINode *, 16> UnknownPhiSet; // dedups UnknownPhis
   std::vector<BasicBlock *> BBWorkList;
   bool CheckBBState(BasicBlock *BB, WaveSensitivity WS);
   WaveSensitivity GetInstState(Instruction *I);
@@ -100,6 +108,7 @@ void WaveSensitivityAnalyzer::Analyze(Function *F) {
     while (!UnknownPhis.empty()) {
       PHINode *Phi = UnknownPhis.back();
       UnknownPhis.pop_back();
+      UnknownPhiSet.erase(Phi);
       // UnknownPhis might have actually known phis that were changed. skip them
       if (Unknown == GetInstState(Phi)) {
         // If any of the preds have not been visited, we can't assume a cycle yet
@@ -212,6 +221,10 @@ void WaveSensitivityAnalyzer::UpdateInst(Instruction *I, WaveSensitivity WS) {
 }
 
 void WaveSensitivityAnalyzer::VisitInst(Instruction *I) {
+  // KnownSensitive is the top of the lattice; nothing can change it.
+  if (GetInstState(I) == KnownSensitive)
+    return;
+
   unsigned firstArg = 0;
   if (CallInst *CI = dyn_cast<CallInst>(I)) {
     if (OP::IsDxilOpFuncCallInst(CI)) {
@@ -238,10 +251,10 @@ void WaveSensitivityAnalyzer::VisitInst(Instruction *I) {
       if (WS == KnownSensitive) {
         UpdateInst(I, KnownSensitive);
         return;
-      } else if (Unknown == GetInstState(I)) {
-        UnknownPhis.emplace_back(Phi);
       }
     }
+    if (Unknown == GetInstState(I) && UnknownPhiSet.insert(Phi).second)
+      UnknownPhis.emplace_back(Phi);
   }
 
   bool allKnownNotSensitive = true;
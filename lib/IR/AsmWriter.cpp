@@ -44,6 +44,15 @@
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
+// HLSL Change Begin
+#include "dxc/Support/Global.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+// HLSL Change End
 using namespace llvm;
 
 // Make virtual table appear in this compilation unit.
@@ -661,7 +670,11 @@ private:
   /// Add all of the metadata from an instruction.
   void processInstructionMetadata(const Instruction &I);
 
-  SlotTracker(const SlotTracker &) = delete;
+  // HLSL Change Begin - copied for each thread printing functions.
+public:
+  SlotTracker(const SlotTracker &) = default;
+private:
+  // HLSL Change End
   void operator=(const SlotTracker &) = delete;
 };
 } // namespace llvm
@@ -2016,7 +2029,7 @@ public:
   void printMDNodeBody(const MDNode *MD);
   void printNamedMDNode(const NamedMDNode *NMD);
 
-  void printModule(const Module *M);
+  void printModule(const Module *M, unsigned Threads = 1); // HLSL Change
 
   void writeOperand(const Value *Op, bool PrintType);
   void writeParamOperand(const Value *Operand, AttributeSet Attrs,unsigned Idx);
@@ -2034,6 +2047,7 @@ public:
   void printAlias(const GlobalAlias *GV);
   void printComdat(const Comdat *C);
   void printFunction(const Function *F);
+  bool printFunctionsInParallel(const Module *M, unsigned Threads); // HLSL Change
   void printArgument(const Argument *FA, AttributeSet Attrs, unsigned Idx);
   void printBasicBlock(const BasicBlock *BB);
   void printInstructionLine(const Instruction &I);
@@ -2172,7 +2186,8 @@ void AssemblyWriter::writeParamOperand(const Value *Operand,
   WriteAsOperandInternal(Out, Operand, &TypePrinter, &Machine, TheModule);
 }
 
-void AssemblyWriter::printModule(const Module *M) {
+void AssemblyWriter::printModule(const Module *M,
+                                 unsigned Threads) { // HLSL Change
   Machine.initialize();
 
   if (ShouldPreserveUseListOrder)
@@ -2233,8 +2248,11 @@ void AssemblyWriter::printModule(const Module *M) {
   printUseLists(nullptr);
 
   // Output all of the functions.
+  if (Threads < 2 || ShouldPreserveUseListOrder ||           // HLSL Change
+      !printFunctionsInParallel(M, Threads)) {                 // HLSL Change
   for (const Function &F : *M)
     printFunction(&F);
+  } // HLSL Change
   assert(UseListOrders.empty() && "All use-lists should have been consumed");
 
   // Output all attribute groups.
@@ -2617,6 +2635,119 @@ void AssemblyWriter::printFunction(const Function *F) {
   Machine.purgeFunction();
 }
 
+// HLSL Change Begin - print functions in parallel.
+/// numberFunctions - Give Machine the slots that printing the functions of M
+/// up to and including Last, one after another, would create. Metadata and
+/// attribute groups first referenced inside a function are numbered when the
+/// function is incorporated, so this is what makes a function print with the
+/// same numbers however many functions before it were actually printed.
+static void numberFunctions(SlotTracker &Machine, const Module *M,
+                            const Function *Last = nullptr) {
+  Machine.initialize();
+  for (const Function &F : *M) {
+    Machine.incorporateFunction(&F);
+    Machine.initialize();
+    Machine.purgeFunction();
+    if (&F == Last)
+      break;
+  }
+}
+
+/// printFunctionsInParallel - Print the functions of M on up to Threads
+/// threads, writing each to Out in module order once it and all functions
+/// before it are done. Returns false, having printed nothing, if there are
+/// too few functions to share out.
+///
+/// Each thread has its own copy of the slot tracker, numbered up front for
+/// every function, and its own writer and type printer, so the text is the
+/// same as printing the functions one after another. At most a window of
+/// functions past the next one to be written is held in memory.
+bool AssemblyWriter::printFunctionsInParallel(const Module *M,
+                                              unsigned Threads) {
+  std::vector<const Function *> Functions;
+  for (const Function &F : *M)
+    Functions.push_back(&F);
+  Threads = std::min<size_t>(Threads, Functions.size());
+  if (Threads < 2)
+    return false;
+
+  numberFunctions(Machine, M);
+
+  const size_t Window = Threads * 8;
+  std::vector<std::string> Texts(Functions.size());
+  std::vector<bool> Printed(Functions.size());
+  size_t NextToWrite = 0;
+  std::atomic<size_t> NextToPrint(0);
+  std::exception_ptr Exception;
+  std::mutex Mutex;
+  std::condition_variable Changed;
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  auto Worker = [&]() {
+    DxcThreadMalloc TM(pMalloc);
+    try {
+      SlotTracker WorkerMachine(Machine);
+      std::string Text;
+      raw_string_ostream TextOS(Text);
+      formatted_raw_ostream FormattedOS(TextOS);
+      AssemblyWriter W(FormattedOS, WorkerMachine, M, AnnotationWriter);
+      for (size_t i = NextToPrint++; i < Functions.size(); i = NextToPrint++) {
+        {
+          std::unique_lock<std::mutex> Lock(Mutex);
+          Changed.wait(Lock, [&] {
+            return Exception || i < NextToWrite + Window;
+          });
+          if (Exception)
+            return;
+        }
+        W.printFunction(Functions[i]);
+        FormattedOS.flush();
+        {
+          std::lock_guard<std::mutex> Lock(Mutex);
+          Texts[i].swap(Text);
+          Printed[i] = true;
+        }
+        Changed.notify_all();
+        Text.clear();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      if (!Exception)
+        Exception = std::current_exception();
+      Changed.notify_all();
+    }
+  };
+
+  // The calling thread writes the text out as it becomes ready.
+  std::vector<std::thread> Workers;
+  try {
+    for (unsigned i = 0; i < Threads; ++i)
+      Workers.emplace_back(Worker);
+  } catch (const std::system_error &) {
+    // Nothing has been printed yet, and the slots numbered so far are the
+    // ones printing serially gives anyway.
+    if (Workers.empty())
+      return false;
+  }
+  for (; NextToWrite < Functions.size(); ++NextToWrite) {
+    std::string Text;
+    {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      Changed.wait(Lock, [&] { return Exception || Printed[NextToWrite]; });
+      if (Exception)
+        break;
+      Text.swap(Texts[NextToWrite]);
+    }
+    Changed.notify_all();
+    Out << Text;
+  }
+  for (std::thread &T : Workers)
+    T.join();
+  if (Exception)
+    std::rethrow_exception(Exception);
+  return true;
+}
+// HLSL Change End
+
 /// printArgument - This member is called for every argument that is passed into
 /// the function.  Simply print it out
 ///
@@ -3147,12 +3278,24 @@ void Function::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW) const {
   W.printFunction(this);
 }
 
+// HLSL Change Begin - print with module numbering.
+void Function::printAsInModule(raw_ostream &ROS,
+                               AssemblyAnnotationWriter *AAW) const {
+  SlotTracker SlotTable(this->getParent());
+  numberFunctions(SlotTable, this->getParent(), this);
+  formatted_raw_ostream OS(ROS);
+  AssemblyWriter W(OS, SlotTable, this->getParent(), AAW);
+  W.printFunction(this);
+}
+// HLSL Change End
+
 void Module::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW,
-                   bool ShouldPreserveUseListOrder) const {
+                   bool ShouldPreserveUseListOrder,
+                   unsigned Threads) const { // HLSL Change
   SlotTracker SlotTable(this);
   formatted_raw_ostream OS(ROS);
   AssemblyWriter W(OS, SlotTable, this, AAW, ShouldPreserveUseListOrder);
-  W.printModule(this);
+  W.printModule(this, Threads); // HLSL Change
 }
 
 void NamedMDNode::print(raw_ostream &ROS) const {
@@ -169,6 +169,26 @@ void LLVMContext::yield() {
     pImpl->YieldCallback(this, pImpl->YieldOpaqueHandle);
 }
 
+// HLSL Change Start
+bool LLVMContext::resetForReuse() {
+  if (!pImpl->OwnedModules.empty())
+    return false;
+  // Types keep their names after their module is destroyed, which would
+  // give new types of the same names a numbered suffix. The types are owned
+  // by the context and stay allocated.
+  SmallVector<StructType *, 64> NamedTypes;
+  for (auto &Entry : pImpl->NamedStructTypes)
+    NamedTypes.push_back(Entry.getValue());
+  for (StructType *ST : NamedTypes)
+    ST->setName("");
+  pImpl->NamedStructTypesUniqueID = 0;
+  setDiagnosticHandler(nullptr);
+  setInlineAsmDiagnosticHandler(nullptr);
+  setYieldCallback(nullptr, nullptr);
+  return true;
+}
+// HLSL Change End
+
 void LLVMContext::emitError(const Twine &ErrorStr) {
   diagnose(DiagnosticInfoInlineAsm(ErrorStr));
 }
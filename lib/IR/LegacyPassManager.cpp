@@ -1329,12 +1329,14 @@ bool BBPassManager::runOnFunction(Function &F) {
       dumpPassInfo(BP, EXECUTION_MSG, ON_BASICBLOCK_MSG, I->getName());
       dumpRequiredSet(BP);
 
+      checkCancellation(); // HLSL Change
       initializeAnalysisImpl(BP);
 
       {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PhaseTimingRegion PassPhase(getPassPhaseName(BP), true); // HLSL Change
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1558,11 +1560,13 @@ bool FPPassManager::runOnFunction(Function &F) {
     dumpPassInfo(FP, EXECUTION_MSG, ON_FUNCTION_MSG, F.getName());
     dumpRequiredSet(FP);
 
+    checkCancellation(); // HLSL Change
     initializeAnalysisImpl(FP);
 
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PhaseTimingRegion PassPhase(getPassPhaseName(FP), true); // HLSL Change
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1634,11 +1638,13 @@ MPPassManager::runOnModule(Module &M) {
     dumpPassInfo(MP, EXECUTION_MSG, ON_MODULE_MSG, M.getModuleIdentifier());
     dumpRequiredSet(MP);
 
+    checkCancellation(); // HLSL Change
     initializeAnalysisImpl(MP);
 
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PhaseTimingRegion PassPhase(getPassPhaseName(MP), true); // HLSL Change
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1815,6 +1821,12 @@ Timer *llvm::getPassTimer(Pass *P) {
   return nullptr;
 }
 
+// HLSL Change Starts - per-thread phase timing
+const char *llvm::getPassPhaseName(Pass *P) {
+  return P->getAsPMDataManager() ? nullptr : P->getPassName();
+}
+// HLSL Change Ends
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
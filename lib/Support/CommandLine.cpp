@@ -108,7 +108,33 @@ public:
   void ParseCommandLineOptions(int argc, const char *const *argv,
                                const char *Overview);
 
+  // HLSL Change Starts - register options on first use
+  // Options add themselves from static constructors, which run whenever the
+  // library loads; most processes never parse or list options, so the tables
+  // below are only filled in once something reads them.
+  SmallVector<std::pair<Option *, const char *>, 0> PendingOpts;
+
   void addLiteralOption(Option &Opt, const char *Name) {
+    PendingOpts.push_back(std::make_pair(&Opt, Name));
+  }
+
+  void addOption(Option *O) { PendingOpts.push_back(std::make_pair(O, nullptr)); }
+
+  void addPendingOptions() {
+    if (PendingOpts.empty())
+      return;
+    SmallVector<std::pair<Option *, const char *>, 0> Pending;
+    Pending.swap(PendingOpts);
+    for (const auto &P : Pending) {
+      if (P.second)
+        registerLiteralOption(*P.first, P.second);
+      else
+        registerOption(P.first);
+    }
+  }
+  // HLSL Change Ends
+
+  void registerLiteralOption(Option &Opt, const char *Name) { // HLSL Change - renamed
     if (!Opt.hasArgStr()) {
       if (!OptionsMap.insert(std::make_pair(Name, &Opt)).second) {
         errs() << ProgramName << ": CommandLine Error: Option '" << Name
@@ -118,7 +144,7 @@ public:
     }
   }
 
-  void addOption(Option *O) {
+  void registerOption(Option *O) { // HLSL Change - renamed
     bool HadErrors = false;
     if (O->ArgStr[0]) {
       // Add argument to the argument map!
@@ -151,6 +177,7 @@ public:
   }
 
   void removeOption(Option *O) {
+    addPendingOptions(); // HLSL Change
     SmallVector<const char *, 16> OptionNames;
     O->getExtraOptionNames(OptionNames);
     if (O->ArgStr[0])
@@ -178,11 +205,13 @@ public:
   }
 
   bool hasOptions() {
+    addPendingOptions(); // HLSL Change
     return (!OptionsMap.empty() || !PositionalOpts.empty() ||
             nullptr != ConsumeAfterOpt);
   }
 
   void updateArgStr(Option *O, const char *NewName) {
+    addPendingOptions(); // HLSL Change
     if (!OptionsMap.insert(std::make_pair(NewName, O)).second) {
       errs() << ProgramName << ": CommandLine Error: Option '" << O->ArgStr
              << "' registered more than once!\n";
@@ -818,6 +847,7 @@ void CommandLineParser::ParseCommandLineOptions(int argc,
                                                 const char *const *argv,
                                                 const char *Overview) {
   // assert(hasOptions() && "No options specified!"); // HLSL Change - it's valid to have no options for the DLL build
+  addPendingOptions(); // HLSL Change
 
   // Expand response files.
   SmallVector<const char *, 20> newArgv(argv, argv + argc);
@@ -1501,6 +1531,7 @@ public:
       return;
 
     StrOptionPairVector Opts;
+    GlobalParser->addPendingOptions(); // HLSL Change
     sortOpts(GlobalParser->OptionsMap, Opts, ShowHidden);
 
     if (GlobalParser->ProgramOverview)
@@ -1734,6 +1765,7 @@ void CommandLineParser::printOptionValues() {
     return;
 
   SmallVector<std::pair<const char *, Option *>, 128> Opts;
+  addPendingOptions(); // HLSL Change
   sortOpts(OptionsMap, Opts, /*ShowHidden*/ true);
 
   // Compute the maximum argument length...
@@ -1848,10 +1880,12 @@ void cl::AddExtraVersionPrinter(void (*func)()) {
 }
 
 StringMap<Option *> &cl::getRegisteredOptions() {
+  GlobalParser->addPendingOptions(); // HLSL Change
   return GlobalParser->OptionsMap;
 }
 
 void cl::HideUnrelatedOptions(cl::OptionCategory &Category) {
+  GlobalParser->addPendingOptions(); // HLSL Change
   for (auto &I : GlobalParser->OptionsMap) {
     if (I.second->Category != &Category &&
         I.second->Category != GenericCategory) // HLSL Change - use pointer
@@ -1860,6 +1894,7 @@ void cl::HideUnrelatedOptions(cl::OptionCategory &Category) {
 }
 
 void cl::HideUnrelatedOptions(ArrayRef<const cl::OptionCategory *> Categories) {
+  GlobalParser->addPendingOptions(); // HLSL Change
   auto CategoriesBegin = Categories.begin();
   auto CategoriesEnd = Categories.end();
   for (auto &I : GlobalParser->OptionsMap) {
@@ -24,6 +24,7 @@
 #include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/Threading.h"
+#include "llvm/Support/ThreadLocal.h" // HLSL Change
 #include "llvm/Support/WindowsError.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
@@ -144,6 +145,28 @@ void llvm::llvm_cast_assert_internal(const char *func) {
   throw hlsl::Exception(DXC_E_LLVM_CAST_ERROR, std::string(func) + "<X>() argument of incompatible type!\n");
 }
 
+// HLSL Change Starts
+static ManagedStatic<sys::ThreadLocal<CancellationCheck> > CurrentCancellationCheck;
+
+CancellationCheck::~CancellationCheck() {}
+
+CancellationCheck *CancellationCheck::getCurrent() {
+  return CurrentCancellationCheck->get();
+}
+
+CancellationCheck *CancellationCheck::setCurrent(CancellationCheck *C) {
+  CancellationCheck *Prior = CurrentCancellationCheck->get();
+  CurrentCancellationCheck->set(C);
+  return Prior;
+}
+
+void llvm::checkCancellation() {
+  CancellationCheck *C = CancellationCheck::getCurrent();
+  if (C && C->isCancelled())
+    throw hlsl::Exception(E_ABORT, "compilation cancelled\n");
+}
+// HLSL Change Ends
+
 static void bindingsErrorHandler(void *user_data, const std::string& reason,
                                  bool gen_crash_diag) {
   LLVMFatalErrorHandler handler =
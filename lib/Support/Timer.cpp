@@ -19,6 +19,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadLocal.h" // HLSL Change
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
@@ -249,6 +250,26 @@ NamedRegionTimer::NamedRegionTimer(StringRef Name, StringRef GroupName,
                                    bool Enabled)
   : TimeRegion(!Enabled ? nullptr : &NamedGroupedTimers->get(Name, GroupName)){}
 
+// HLSL Change Starts - per-thread phase timing
+//===----------------------------------------------------------------------===//
+//   PhaseTimingListener Implementation
+//===----------------------------------------------------------------------===//
+
+static ManagedStatic<sys::ThreadLocal<PhaseTimingListener> > CurrentPhaseListener;
+
+PhaseTimingListener::~PhaseTimingListener() {}
+
+PhaseTimingListener *PhaseTimingListener::getCurrent() {
+  return CurrentPhaseListener->get();
+}
+
+PhaseTimingListener *PhaseTimingListener::setCurrent(PhaseTimingListener *L) {
+  PhaseTimingListener *Prior = CurrentPhaseListener->get();
+  CurrentPhaseListener->set(L);
+  return Prior;
+}
+// HLSL Change Ends
+
 //===----------------------------------------------------------------------===//
 //   TimerGroup Implementation
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,140 @@
+//===- xxhash.cpp - 64-bit xxHash -----------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements XXH64 as specified by xxHash
+// (https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md).
+//
+//===----------------------------------------------------------------------===//
+
+// HLSL Change - new file.
+
+#include "llvm/Support/xxhash.h"
+#include "llvm/Support/Endian.h"
+
+#include <string.h>
+
+using namespace llvm;
+using namespace support;
+
+static const uint64_t PRIME64_1 = 11400714785074694791ULL;
+static const uint64_t PRIME64_2 = 14029467366897019727ULL;
+static const uint64_t PRIME64_3 = 1609587929392839161ULL;
+static const uint64_t PRIME64_4 = 9650029242287828579ULL;
+static const uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl64(uint64_t X, unsigned R) {
+  return (X << R) | (X >> (64 - R));
+}
+
+static inline uint64_t round64(uint64_t Acc, uint64_t Input) {
+  Acc += Input * PRIME64_2;
+  Acc = rotl64(Acc, 31);
+  Acc *= PRIME64_1;
+  return Acc;
+}
+
+static inline uint64_t mergeRound(uint64_t Acc, uint64_t Val) {
+  Val = round64(0, Val);
+  Acc ^= Val;
+  Acc = Acc * PRIME64_1 + PRIME64_4;
+  return Acc;
+}
+
+static inline uint64_t read64(const uint8_t *P) {
+  return endian::read<uint64_t, little, unaligned>(P);
+}
+
+static inline uint32_t read32(const uint8_t *P) {
+  return endian::read<uint32_t, little, unaligned>(P);
+}
+
+xxHash64Builder::xxHash64Builder(uint64_t Seed)
+    : V1(Seed + PRIME64_1 + PRIME64_2), V2(Seed + PRIME64_2), V3(Seed),
+      V4(Seed - PRIME64_1), Seed(Seed), TotalLen(0), BufferSize(0) {}
+
+void xxHash64Builder::update(ArrayRef<uint8_t> Data) {
+  const uint8_t *P = Data.data();
+  size_t Len = Data.size();
+  TotalLen += Len;
+
+  if (BufferSize + Len < sizeof(Buffer)) {
+    if (Len)
+      memcpy(Buffer + BufferSize, P, Len);
+    BufferSize += Len;
+    return;
+  }
+
+  if (BufferSize) {
+    unsigned Fill = sizeof(Buffer) - BufferSize;
+    memcpy(Buffer + BufferSize, P, Fill);
+    V1 = round64(V1, read64(Buffer));
+    V2 = round64(V2, read64(Buffer + 8));
+    V3 = round64(V3, read64(Buffer + 16));
+    V4 = round64(V4, read64(Buffer + 24));
+    P += Fill;
+    Len -= Fill;
+    BufferSize = 0;
+  }
+
+  const uint8_t *const Limit = P + Len - (Len % 32);
+  for (; P != Limit; P += 32) {
+    V1 = round64(V1, read64(P));
+    V2 = round64(V2, read64(P + 8));
+    V3 = round64(V3, read64(P + 16));
+    V4 = round64(V4, read64(P + 24));
+  }
+
+  BufferSize = Len % 32;
+  if (BufferSize)
+    memcpy(Buffer, P, BufferSize);
+}
+
+uint64_t xxHash64Builder::final() const {
+  uint64_t H64;
+  if (TotalLen >= 32) {
+    H64 = rotl64(V1, 1) + rotl64(V2, 7) + rotl64(V3, 12) + rotl64(V4, 18);
+    H64 = mergeRound(H64, V1);
+    H64 = mergeRound(H64, V2);
+    H64 = mergeRound(H64, V3);
+    H64 = mergeRound(H64, V4);
+  } else {
+    H64 = Seed + PRIME64_5;
+  }
+
+  H64 += TotalLen;
+
+  const uint8_t *P = Buffer;
+  const uint8_t *const BEnd = Buffer + BufferSize;
+  for (; P + 8 <= BEnd; P += 8) {
+    H64 ^= round64(0, read64(P));
+    H64 = rotl64(H64, 27) * PRIME64_1 + PRIME64_4;
+  }
+  if (P + 4 <= BEnd) {
+    H64 ^= (uint64_t)read32(P) * PRIME64_1;
+    H64 = rotl64(H64, 23) * PRIME64_2 + PRIME64_3;
+    P += 4;
+  }
+  for (; P < BEnd; ++P) {
+    H64 ^= (*P) * PRIME64_5;
+    H64 = rotl64(H64, 11) * PRIME64_1;
+  }
+
+  H64 ^= H64 >> 33;
+  H64 *= PRIME64_2;
+  H64 ^= H64 >> 29;
+  H64 *= PRIME64_3;
+  H64 ^= H64 >> 32;
+  return H64;
+}
+
+uint64_t llvm::xxHash64(StringRef Data) {
+  xxHash64Builder Builder;
+  Builder.update(Data);
+  return Builder.final();
+}
@@ -29,6 +29,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h" // HLSL Change
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -525,6 +526,7 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
     // calls to become direct calls.
     // CallSites may be modified inside so ranged for loop can not be used.
     for (unsigned CSi = 0; CSi != CallSites.size(); ++CSi) {
+      checkCancellation(); // HLSL Change - inlining can blow up
       CallSite CS = CallSites[CSi].first;
       
       Function *Caller = CS.getCaller();
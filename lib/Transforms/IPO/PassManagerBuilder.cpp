@@ -26,10 +26,13 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Vectorize.h"
+#include "dxc/HLSL/DxilCompileStats.h" // HLSL Change
 #include "dxc/HLSL/DxilGenerationPass.h" // HLSL Change
 #include "dxc/HLSL/HLMatrixLowerPass.h" // HLSL Change
 #include "dxc/HLSL/ComputeViewIdState.h" // HLSL Change
 #include "llvm/Analysis/DxilValueCache.h" // HLSL Change
+#include "dxc/HLSL/DxilParallelFunctionPasses.h" // HLSL Change
+#include <memory> // HLSL Change
 
 using namespace llvm;
 
@@ -190,6 +193,7 @@ void PassManagerBuilder::populateFunctionPassManager(
     FPM.add(new TargetLibraryInfoWrapperPass(*LibraryInfo));
 
   if (OptLevel == 0) return;
+  if (HLSLStartAtDxilGen) return; // HLSL Change - the first stage ran these.
 
   addInitialAliasAnalysisPasses(FPM);
 
@@ -207,18 +211,12 @@ void PassManagerBuilder::populateFunctionPassManager(
 }
 
 // HLSL Change Starts
-static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOnUnrollFail, bool StructurizeLoopExitsForUnroll, bool EnableLifetimeMarkers, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, legacy::PassManagerBase &MPM) {
-
-  // Don't do any lowering if we're targeting high-level.
-  if (HLSLHighLevel) {
-    MPM.add(createHLEmitMetadataPass());
-    return;
-  }
-
+// The high-level passes that run before DXIL generation. A staged compile
+// stops after these, and its second stage starts at DXIL generation.
+static void addHLSLPassesBeforeDxilGen(bool NoOpt, bool EnableLifetimeMarkers, bool MatrixDotProducts, bool IndexableArrays, legacy::PassManagerBase &MPM) {
   MPM.add(createDxilCleanupAddrSpaceCastPass());
 
   MPM.add(createHLPreprocessPass());
-  bool NoOpt = OptLevel == 0;
   if (!NoOpt) {
     MPM.add(createHLDeadFunctionEliminationPass());
   }
@@ -233,7 +231,7 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOn
   // Split struct and array of parameter.
   MPM.add(createSROA_Parameter_HLSL());
 
-  MPM.add(createHLMatrixLowerPass());
+  MPM.add(createHLMatrixLowerPass(MatrixDotProducts));
   // DCE should after SROA to remove unused element.
   MPM.add(createDeadCodeEliminationPass());
   MPM.add(createGlobalDCEPass());
@@ -257,7 +255,9 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOn
 
   // mem2reg
   // Special Mem2Reg pass that skips precise marker.
-  MPM.add(createDxilConditionalMem2RegPass(NoOpt));
+  // When asked to, it also marks dynamically indexed arrays of at least 64
+  // scalars to stay in memory after unrolling makes their indices constant.
+  MPM.add(createDxilConditionalMem2RegPass(NoOpt, IndexableArrays ? 64 : 0));
 
   // Clean up inefficiencies that can cause unnecessary live values related to
   // lifetime marker cleanup blocks. This is the earliest possible location
@@ -285,7 +285,31 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOn
 
   // Verify no undef resource again after promotion
   MPM.add(createInvalidateUndefResourcesPass());
+}
 
+static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOnUnrollFail, bool StructurizeLoopExitsForUnroll, unsigned UnrollBudget, bool EnableLifetimeMarkers, bool MatrixDotProducts, bool IndexableArrays, bool StopBeforeDxilGen, bool StartAtDxilGen, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, hlsl::DxilCompileStats *CompileStats, legacy::PassManagerBase &MPM) {
+
+  // Don't do any lowering if we're targeting high-level.
+  if (HLSLHighLevel) {
+    MPM.add(createHLEmitMetadataPass());
+    return;
+  }
+
+  bool NoOpt = OptLevel == 0;
+  if (!StartAtDxilGen)
+    addHLSLPassesBeforeDxilGen(NoOpt, EnableLifetimeMarkers, MatrixDotProducts, IndexableArrays, MPM);
+
+  // Leave the optimized high-level module paused for the second stage, or
+  // resume one paused by the first.
+  if (StopBeforeDxilGen) {
+    MPM.add(createPausePassesPass());
+    return;
+  }
+  if (StartAtDxilGen)
+    MPM.add(createResumePassesPass());
+
+  if (CompileStats)
+    MPM.add(hlsl::createDxilRecordCompileStatsPass(CompileStats, "before_dxil_gen"));
   MPM.add(createDxilGenerationPass(NoOpt, ExtHelper));
 
   // Propagate precise attribute.
@@ -305,7 +329,7 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOn
   // struct members.
   // Needs to happen before resources are lowered and before HL
   // module is gone.
-  MPM.add(createDxilLoopUnrollPass(1024, OnlyWarnOnUnrollFail, StructurizeLoopExitsForUnroll));
+  MPM.add(createDxilLoopUnrollPass(1024, OnlyWarnOnUnrollFail, StructurizeLoopExitsForUnroll, UnrollBudget));
 
   // Default unroll pass. This is purely for optimizing loops without
   // attributes.
@@ -327,11 +351,195 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, bool OnlyWarnOn
 }
 // HLSL Change Ends
 
+// HLSL Change Begins - lowering to DXIL shared by every optimization level
+// above 0.
+static void addDxilLoweringPasses(unsigned OptLevel, bool Pair16BitOps,
+                                  bool GroupSharedLayout, bool ClusterSamples,
+                                  bool MatrixLayout, bool FastTrig,
+                                  legacy::PassManagerBase &MPM) {
+  MPM.add(createDxilEraseDeadRegionPass());
+
+  MPM.add(createDxilConvergentClearPass());
+  MPM.add(createDeadCodeEliminationPass()); // DCE needed after clearing convergence
+                                            // annotations before CreateHandleForLib
+                                            // so no unused resources get re-added to
+                                            // DxilModule.
+  MPM.add(createMultiDimArrayToOneDimArrayPass());
+  MPM.add(createDxilRemoveDeadBlocksPass());
+  MPM.add(createDeadCodeEliminationPass());
+  MPM.add(createGlobalDCEPass());
+  // Store cbuffer matrices the way they are read, while reads still go
+  // through the cbuffer symbols.
+  if (MatrixLayout)
+    MPM.add(createDxilMatrixLayoutPass());
+  // Groupshared arrays are one dimensional from here on.
+  if (GroupSharedLayout)
+    MPM.add(createDxilGroupSharedLayoutPass());
+  MPM.add(createDxilMutateResourceToHandlePass());
+  MPM.add(createDxilLowerCreateHandleForLibPass());
+  MPM.add(createDxilCleanupAnnotateHandlePass());
+  // Hoist and merge handles and raw buffer accesses once handles are final.
+  if (OptLevel > 1) {
+    MPM.add(createDxilHoistHandlesPass());
+    MPM.add(createDxilCoalesceRawBufferPass());
+    MPM.add(createDxilRemoveRedundantNonUniformPass());
+  }
+  MPM.add(createDxilTranslateRawBuffer());
+  // Always try to legalize sample offsets as loop unrolling
+  // is not guaranteed for higher opt levels.
+  MPM.add(createDxilLegalizeSampleOffsetPass());
+  // Replace imprecise inverse trig and hyperbolic functions with cheaper
+  // approximations.
+  if (FastTrig)
+    MPM.add(createDxilExpandTrigIntrinsicsPass(/*Fast*/ true));
+  // Issue independent fetches together to hide their latency.
+  if (ClusterSamples)
+    MPM.add(createDxilClusterSamplesPass());
+  // Schedule 16-bit operations in pairs that drivers can pack.
+  if (Pair16BitOps)
+    MPM.add(createDxilPair16BitOpsPass());
+  MPM.add(createDxilFinalizeModulePass());
+  MPM.add(createComputeViewIdStatePass());
+  MPM.add(createDxilDeadFunctionEliminationPass());
+  MPM.add(createNoPausePassesPass());
+  MPM.add(createDxilValidateWaveSensitivityPass());
+  MPM.add(createDxilEmitMetadataPass());
+}
+
+// The fast optimize tier used for -O1. Module and loop passes are left out
+// and each scalar cleanup runs once: compiles are much faster than at -O3,
+// while the code still gets the redundancy elimination and folding that
+// matter most for runtime performance. [unroll] loops have already been
+// unrolled by addHLSLPasses.
+void PassManagerBuilder::addHLSLFastOptimizationPasses(
+    legacy::PassManagerBase &MPM) const {
+  MPM.add(createGlobalOptimizerPass());       // Optimize out global vars
+  MPM.add(createSROAPass(/*RequiresDomTree*/ false));
+  MPM.add(createGVNPass(/*NoLoads*/ true));   // Remove redundancies
+  MPM.add(createInstructionCombiningPass());  // Combine silly seq's
+  addExtensionsToPM(EP_Peephole, MPM);
+  MPM.add(createCFGSimplificationPass());     // Merge & remove BBs
+  MPM.add(createHoistConstantArrayPass());
+  MPM.add(createAggressiveDCEPass());         // Delete dead instructions
+  MPM.add(createCFGSimplificationPass());     // Merge & remove BBs
+}
+// HLSL Change Ends
+
+// HLSL Change Begins - split out so the passes can also run in parallel.
+void PassManagerBuilder::addFunctionSimplificationPasses(
+    legacy::PassManagerBase &MPM) const {
+  // Start of function pass.
+  // Break up aggregate allocas, using SSAUpdater.
+  if (UseNewSROA)
+    MPM.add(createSROAPass(/*RequiresDomTree*/ false));
+  else
+    MPM.add(createScalarReplAggregatesPass(-1, false));
+
+  // HLSL Change. MPM.add(createEarlyCSEPass());              // Catch trivial redundancies
+  // HLSL Change. MPM.add(createJumpThreadingPass());         // Thread jumps.
+  MPM.add(createCorrelatedValuePropagationPass()); // Propagate conditionals
+  MPM.add(createCFGSimplificationPass());     // Merge & remove BBs
+  MPM.add(createInstructionCombiningPass());  // Combine silly seq's
+  addExtensionsToPM(EP_Peephole, MPM);
+  // HLSL Change Begins.
+  // HLSL does not allow recursize functions.
+  //MPM.add(createTailCallEliminationPass()); // Eliminate tail calls
+  // HLSL Change Ends.
+  MPM.add(createCFGSimplificationPass());     // Merge & remove BBs
+  MPM.add(createReassociatePass());           // Reassociate expressions
+  // Rotate Loop - disable header duplication at -Oz
+  MPM.add(createLoopRotatePass(SizeLevel == 2 ? 0 : -1));
+  // HLSL Change - disable LICM in frontend for not consider register pressure.
+  //MPM.add(createLICMPass());                  // Hoist loop invariants
+  //MPM.add(createLoopUnswitchPass(SizeLevel || OptLevel < 3)); // HLSL Change - may move barrier inside divergent if.
+  MPM.add(createInstructionCombiningPass());
+  MPM.add(createIndVarSimplifyPass());        // Canonicalize indvars
+  // HLSL Change Begins
+  // Don't allow loop idiom pass which may insert memset/memcpy thereby breaking the dxil
+  //MPM.add(createLoopIdiomPass());             // Recognize idioms like memset.
+  // HLSL Change Ends
+  MPM.add(createLoopDeletionPass());          // Delete dead loops
+  if (EnableLoopInterchange) {
+    MPM.add(createLoopInterchangePass()); // Interchange loops
+    MPM.add(createCFGSimplificationPass());
+  }
+  if (!DisableUnrollLoops)
+    MPM.add(createSimpleLoopUnrollPass());    // Unroll small loops
+  addExtensionsToPM(EP_LoopOptimizerEnd, MPM);
+
+  if (OptLevel > 1) {
+    if (EnableMLSM)
+      MPM.add(createMergedLoadStoreMotionPass()); // Merge ld/st in diamonds
+    // HLSL Change Begins
+    if (EnableGVN) {
+      MPM.add(createGVNPass(DisableGVNLoadPRE));  // Remove redundancies
+      if (!HLSLResMayAlias)
+        MPM.add(createDxilSimpleGVNHoistPass());
+    }
+    MPM.add(createDxilCBufferLoadCSEPass());
+    // HLSL Change Ends
+  }
+  // HLSL Change Begins.
+  // HLSL don't allow memcpy and memset.
+  //MPM.add(createMemCpyOptPass());             // Remove memcpy / form memset
+  // HLSL Change Ends.
+  MPM.add(createSCCPPass());                  // Constant prop with SCCP
+
+  // Delete dead bit computations (instcombine runs after to fold away the dead
+  // computations, and then ADCE will run later to exploit any new DCE
+  // opportunities that creates).
+  MPM.add(createBitTrackingDCEPass());        // Delete dead bit computations
+
+  // Run instcombine after redundancy elimination to exploit opportunities
+  // opened up by them.
+  MPM.add(createInstructionCombiningPass());
+  addExtensionsToPM(EP_Peephole, MPM);
+  // HLSL Change. MPM.add(createJumpThreadingPass());         // Thread jumps
+  MPM.add(createCorrelatedValuePropagationPass());
+  MPM.add(createDeadStoreEliminationPass(ScanLimit));  // Delete dead stores
+  // HLSL Change - disable LICM in frontend for not consider register pressure.
+  // MPM.add(createLICMPass());
+
+  addExtensionsToPM(EP_ScalarOptimizerLate, MPM);
+
+  if (RerollLoops)
+    MPM.add(createLoopRerollPass());
+#if HLSL_VECTORIZATION_ENABLED // HLSL Change - don't build vectorization passes
+  if (!RunSLPAfterLoopVectorization) {
+    if (SLPVectorize)
+      MPM.add(createSLPVectorizerPass());   // Vectorize parallel scalar chains.
+
+    if (BBVectorize) {
+      MPM.add(createBBVectorizePass());
+      MPM.add(createInstructionCombiningPass());
+      addExtensionsToPM(EP_Peephole, MPM);
+      if (OptLevel > 1 && UseGVNAfterVectorization)
+        MPM.add(createGVNPass(DisableGVNLoadPRE)); // Remove redundancies
+      else
+        MPM.add(createEarlyCSEPass());      // Catch trivial redundancies
+
+      // BBVectorize may have significantly shortened a loop body; unroll again.
+      if (!DisableUnrollLoops)
+        MPM.add(createLoopUnrollPass());
+    }
+  }
+#endif
+
+  if (LoadCombine)
+    MPM.add(createLoadCombinePass());
+}
+// HLSL Change Ends
+
 void PassManagerBuilder::populateModulePassManager(
     legacy::PassManagerBase &MPM) {
   // If all optimizations are disabled, just run the always-inline pass and,
   // if enabled, the function merging pass.
   if (OptLevel == 0) {
+    // HLSL Change - the first stage of a staged compile ran these.
+    if (HLSLStartAtDxilGen) {
+      delete Inliner;
+      Inliner = nullptr;
+    } else {
     if (!HLSLHighLevel) {
       MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
     }
@@ -362,16 +570,23 @@ void PassManagerBuilder::populateModulePassManager(
       MPM.add(createDxilPreserveToSelectPass()); // HLSL Change - lower preserve instructions to selects
 
     addExtensionsToPM(EP_EnabledOnOptLevel0, MPM);
+    } // HLSL Change
 
     // HLSL Change Begins.
     addHLSLPasses(HLSLHighLevel, OptLevel,
       this->HLSLOnlyWarnOnUnrollFail,
       this->StructurizeLoopExitsForUnroll,
+      this->HLSLUnrollBudget,
       this->HLSLEnableLifetimeMarkers,
+      this->HLSLMatrixDotProducts,
+      this->HLSLIndexableArrays,
+      this->HLSLStopBeforeDxilGen,
+      this->HLSLStartAtDxilGen,
       this->HLSLExtensionsCodeGen,
+      this->HLSLCompileStats,
       MPM);
 
-    if (!HLSLHighLevel) {
+    if (!HLSLHighLevel && !HLSLStopBeforeDxilGen) {
       MPM.add(createDxilConvergentClearPass());
       MPM.add(createDxilRemoveDeadBlocksPass());
       MPM.add(createDxilNoOptSimplifyInstructionsPass());
@@ -396,6 +611,9 @@ void PassManagerBuilder::populateModulePassManager(
     return;
   }
 
+  // HLSL Change Begins - the first stage of a staged compile ran these.
+  if (!HLSLStartAtDxilGen) {
+  // HLSL Change Ends
   if (!HLSLHighLevel) {
     MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
   }
@@ -406,11 +624,14 @@ void PassManagerBuilder::populateModulePassManager(
 
   MPM.add(createHLLegalizeParameter()); // legalize parameters before inline.
   MPM.add(createAlwaysInlinerPass(/*InsertLifeTime*/this->HLSLEnableLifetimeMarkers));
+  } // HLSL Change
   if (Inliner) {
     delete Inliner;
     Inliner = nullptr;
   }
-  addHLSLPasses(HLSLHighLevel, OptLevel, this->HLSLOnlyWarnOnUnrollFail, this->StructurizeLoopExitsForUnroll, this->HLSLEnableLifetimeMarkers, HLSLExtensionsCodeGen, MPM); // HLSL Change
+  addHLSLPasses(HLSLHighLevel, OptLevel, this->HLSLOnlyWarnOnUnrollFail, this->StructurizeLoopExitsForUnroll, this->HLSLUnrollBudget, this->HLSLEnableLifetimeMarkers, this->HLSLMatrixDotProducts, this->HLSLIndexableArrays, this->HLSLStopBeforeDxilGen, this->HLSLStartAtDxilGen, HLSLExtensionsCodeGen, HLSLCompileStats, MPM); // HLSL Change
+  if (HLSLStopBeforeDxilGen)
+    return;
   // HLSL Change Ends
 
   // Add LibraryInfo if we have some.
@@ -419,6 +640,17 @@ void PassManagerBuilder::populateModulePassManager(
 
   addInitialAliasAnalysisPasses(MPM);
 
+  // HLSL Change Begins - -O1 is the fast optimize tier.
+  if (OptLevel == 1 && !HLSLHighLevel) {
+    addHLSLFastOptimizationPasses(MPM);
+    addDxilLoweringPasses(OptLevel, HLSLPair16BitOps, HLSLGroupSharedLayout,
+                          HLSLClusterSamples, HLSLMatrixLayout,
+                          HLSLFastTrig, MPM);
+    addExtensionsToPM(EP_OptimizerLast, MPM);
+    return;
+  }
+  // HLSL Change Ends
+
   if (!DisableUnitAtATime) {
     addExtensionsToPM(EP_ModuleOptimizerEarly, MPM);
 
@@ -444,104 +676,26 @@ void PassManagerBuilder::populateModulePassManager(
   if (OptLevel > 2)
     MPM.add(createArgumentPromotionPass());   // Scalarize uninlined fn args
 
-  // Start of function pass.
-  // Break up aggregate allocas, using SSAUpdater.
-  if (UseNewSROA)
-    MPM.add(createSROAPass(/*RequiresDomTree*/ false));
-  else
-    MPM.add(createScalarReplAggregatesPass(-1, false));
-
-  // HLSL Change. MPM.add(createEarlyCSEPass());              // Catch trivial redundancies
-  // HLSL Change. MPM.add(createJumpThreadingPass());         // Thread jumps.
-  MPM.add(createCorrelatedValuePropagationPass()); // Propagate conditionals
-  MPM.add(createCFGSimplificationPass());     // Merge & remove BBs
-  MPM.add(createInstructionCombiningPass());  // Combine silly seq's
-  addExtensionsToPM(EP_Peephole, MPM);
-  // HLSL Change Begins.
-  // HLSL does not allow recursize functions.
-  //MPM.add(createTailCallEliminationPass()); // Eliminate tail calls
-  // HLSL Change Ends.
-  MPM.add(createCFGSimplificationPass());     // Merge & remove BBs
-  MPM.add(createReassociatePass());           // Reassociate expressions
-  // Rotate Loop - disable header duplication at -Oz
-  MPM.add(createLoopRotatePass(SizeLevel == 2 ? 0 : -1));
-  // HLSL Change - disable LICM in frontend for not consider register pressure.
-  //MPM.add(createLICMPass());                  // Hoist loop invariants
-  //MPM.add(createLoopUnswitchPass(SizeLevel || OptLevel < 3)); // HLSL Change - may move barrier inside divergent if.
-  MPM.add(createInstructionCombiningPass());
-  MPM.add(createIndVarSimplifyPass());        // Canonicalize indvars
-  // HLSL Change Begins
-  // Don't allow loop idiom pass which may insert memset/memcpy thereby breaking the dxil
-  //MPM.add(createLoopIdiomPass());             // Recognize idioms like memset.
-  // HLSL Change Ends
-  MPM.add(createLoopDeletionPass());          // Delete dead loops
-  if (EnableLoopInterchange) {
-    MPM.add(createLoopInterchangePass()); // Interchange loops
-    MPM.add(createCFGSimplificationPass());
-  }
-  if (!DisableUnrollLoops)
-    MPM.add(createSimpleLoopUnrollPass());    // Unroll small loops
-  addExtensionsToPM(EP_LoopOptimizerEnd, MPM);
-
-  if (OptLevel > 1) {
-    if (EnableMLSM)
-      MPM.add(createMergedLoadStoreMotionPass()); // Merge ld/st in diamonds
-    // HLSL Change Begins
-    if (EnableGVN) {
-      MPM.add(createGVNPass(DisableGVNLoadPRE));  // Remove redundancies
-      if (!HLSLResMayAlias)
-        MPM.add(createDxilSimpleGVNHoistPass());
-    }
-    // HLSL Change Ends
-  }
-  // HLSL Change Begins.
-  // HLSL don't allow memcpy and memset.
-  //MPM.add(createMemCpyOptPass());             // Remove memcpy / form memset
-  // HLSL Change Ends.
-  MPM.add(createSCCPPass());                  // Constant prop with SCCP
-
-  // Delete dead bit computations (instcombine runs after to fold away the dead
-  // computations, and then ADCE will run later to exploit any new DCE
-  // opportunities that creates).
-  MPM.add(createBitTrackingDCEPass());        // Delete dead bit computations
-
-  // Run instcombine after redundancy elimination to exploit opportunities
-  // opened up by them.
-  MPM.add(createInstructionCombiningPass());
-  addExtensionsToPM(EP_Peephole, MPM);
-  // HLSL Change. MPM.add(createJumpThreadingPass());         // Thread jumps
-  MPM.add(createCorrelatedValuePropagationPass());
-  MPM.add(createDeadStoreEliminationPass(ScanLimit));  // Delete dead stores
-  // HLSL Change - disable LICM in frontend for not consider register pressure.
-  // MPM.add(createLICMPass());
-
-  addExtensionsToPM(EP_ScalarOptimizerLate, MPM);
-
-  if (RerollLoops)
-    MPM.add(createLoopRerollPass());
-#if HLSL_VECTORIZATION_ENABLED // HLSL Change - don't build vectorization passes
-  if (!RunSLPAfterLoopVectorization) {
-    if (SLPVectorize)
-      MPM.add(createSLPVectorizerPass());   // Vectorize parallel scalar chains.
-
-    if (BBVectorize) {
-      MPM.add(createBBVectorizePass());
-      MPM.add(createInstructionCombiningPass());
-      addExtensionsToPM(EP_Peephole, MPM);
-      if (OptLevel > 1 && UseGVNAfterVectorization)
-        MPM.add(createGVNPass(DisableGVNLoadPRE)); // Remove redundancies
-      else
-        MPM.add(createEarlyCSEPass());      // Catch trivial redundancies
-
-      // BBVectorize may have significantly shortened a loop body; unroll again.
-      if (!DisableUnrollLoops)
-        MPM.add(createLoopUnrollPass());
-    }
+  // HLSL Change Begins - optionally spread the function passes over threads.
+  if (HLSLParallelFunctionThreads > 1) {
+    // The pass outlives this builder, so it gets a copy of its settings.
+    std::shared_ptr<PassManagerBuilder> Builder =
+        std::make_shared<PassManagerBuilder>(*this);
+    Builder->Inliner = nullptr;
+    Builder->LibraryInfo =
+        LibraryInfo ? new TargetLibraryInfoImpl(*LibraryInfo) : nullptr;
+    MPM.add(createDxilParallelFunctionPassesPass(
+        [Builder](legacy::PassManagerBase &PM) {
+          if (Builder->LibraryInfo)
+            PM.add(new TargetLibraryInfoWrapperPass(*Builder->LibraryInfo));
+          Builder->addInitialAliasAnalysisPasses(PM);
+          Builder->addFunctionSimplificationPasses(PM);
+        },
+        HLSLParallelFunctionThreads));
+  } else {
+    addFunctionSimplificationPasses(MPM);
   }
-#endif
-
-  if (LoadCombine)
-    MPM.add(createLoadCombinePass());
+  // HLSL Change Ends
 
   MPM.add(createHoistConstantArrayPass()); // HLSL change
 
@@ -669,33 +823,10 @@ void PassManagerBuilder::populateModulePassManager(
     MPM.add(createMergeFunctionsPass());
 
   // HLSL Change Begins.
-  if (!HLSLHighLevel) {
-    if (OptLevel > 0)
-      MPM.add(createDxilEraseDeadRegionPass());
-
-    MPM.add(createDxilConvergentClearPass());
-    MPM.add(createDeadCodeEliminationPass()); // DCE needed after clearing convergence
-                                              // annotations before CreateHandleForLib
-                                              // so no unused resources get re-added to
-                                              // DxilModule.
-    MPM.add(createMultiDimArrayToOneDimArrayPass());
-    MPM.add(createDxilRemoveDeadBlocksPass());
-    MPM.add(createDeadCodeEliminationPass());
-    MPM.add(createGlobalDCEPass());
-    MPM.add(createDxilMutateResourceToHandlePass());
-    MPM.add(createDxilLowerCreateHandleForLibPass());
-    MPM.add(createDxilCleanupAnnotateHandlePass());
-    MPM.add(createDxilTranslateRawBuffer());
-    // Always try to legalize sample offsets as loop unrolling
-    // is not guaranteed for higher opt levels.
-    MPM.add(createDxilLegalizeSampleOffsetPass());
-    MPM.add(createDxilFinalizeModulePass());
-    MPM.add(createComputeViewIdStatePass());
-    MPM.add(createDxilDeadFunctionEliminationPass());
-    MPM.add(createNoPausePassesPass());
-    MPM.add(createDxilValidateWaveSensitivityPass());
-    MPM.add(createDxilEmitMetadataPass());
-  }
+  if (!HLSLHighLevel)
+    addDxilLoweringPasses(OptLevel, HLSLPair16BitOps, HLSLGroupSharedLayout,
+                          HLSLClusterSamples, HLSLMatrixLayout,
+                          HLSLFastTrig, MPM);
   // HLSL Change Ends.
   addExtensionsToPM(EP_OptimizerLast, MPM);
 }
@@ -835,6 +966,41 @@ void PassManagerBuilder::populateLTOPassManager(legacy::PassManagerBase &PM) {
     PM.add(createVerifierPass());
 }
 
+// HLSL Change Begins
+// The DXIL-safe part of populateLTOPassManager. Passes that rewrite function
+// signatures (dead argument elimination, argument promotion) would drop the
+// DXIL annotations of those functions, and memcpy formation is not legal in
+// DXIL, so they are left out.
+void PassManagerBuilder::populateHLSLLinkTimePassManager(
+    legacy::PassManagerBase &PM) const {
+  if (OptLevel == 0)
+    return;
+
+  // Propagate constants at call sites into the functions they call, now that
+  // callers and callees from different libraries are in one module.
+  PM.add(createIPSCCPPass());
+  PM.add(createGlobalOptimizerPass());
+  // Linking modules together can lead to duplicated global constants.
+  PM.add(createConstantMergePass());
+  PM.add(createInstructionCombiningPass());
+  addExtensionsToPM(EP_Peephole, PM);
+  PM.add(createGlobalDCEPass());
+
+  if (OptLevel == 1) {
+    addHLSLFastOptimizationPasses(PM);
+  } else {
+    addFunctionSimplificationPasses(PM);
+    PM.add(createHoistConstantArrayPass());
+    PM.add(createAggressiveDCEPass());
+    PM.add(createCFGSimplificationPass());
+    PM.add(createInstructionCombiningPass());
+  }
+
+  PM.add(createCFGSimplificationPass());
+  PM.add(createGlobalDCEPass());
+}
+// HLSL Change Ends
+
 inline PassManagerBuilder *unwrap(LLVMPassManagerBuilderRef P) {
     return reinterpret_cast<PassManagerBuilder*>(P);
 }
@@ -22,6 +22,7 @@
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DIBuilder.h"
 
+#include "dxc/DXIL/DxilMetadataHelper.h"
 #include "dxc/DXIL/DxilUtil.h"
 #include "dxc/HLSL/HLModule.h"
 #include "llvm/Analysis/DxilValueCache.h"
@@ -49,6 +50,55 @@ static bool ContainsFloatingPointType(Type *Ty) {
   return false;
 }
 
+// Number of scalars in Ty.
+static uint64_t CountScalars(Type *Ty) {
+  if (Ty->isArrayTy())
+    return Ty->getArrayNumElements() * CountScalars(Ty->getArrayElementType());
+  if (Ty->isVectorTy())
+    return Ty->getVectorNumElements();
+  if (Ty->isStructTy()) {
+    uint64_t Count = 0;
+    for (Type *EltTy : cast<StructType>(Ty)->elements())
+      Count += CountScalars(EltTy);
+    return Count;
+  }
+  return 1;
+}
+
+// Returns whether any GEP reached from P indexes it with a value that isn't
+// constant.
+static bool HasDynamicIndex(Value *P) {
+  for (User *U : P->users()) {
+    GEPOperator *GEP = dyn_cast<GEPOperator>(U);
+    if (!GEP)
+      continue;
+    if (!GEP->hasAllConstantIndices() || HasDynamicIndex(GEP))
+      return true;
+  }
+  return false;
+}
+
+// Marks arrays of at least Limit scalars that are indexed dynamically, so
+// that SROA keeps them in memory once unrolling has made the indices
+// constant, rather than splitting them into as many values and the phis to
+// carry them. The driver keeps such an array in an indexable temp, where
+// exploding it would take a register per element.
+static bool MarkIndexableArrays(Function &F, unsigned Limit) {
+  bool Changed = false;
+  for (Instruction &I : F.getEntryBlock()) {
+    AllocaInst *AI = dyn_cast<AllocaInst>(&I);
+    if (!AI || !AI->getAllocatedType()->isArrayTy() ||
+        AI->getMetadata(DxilMDHelper::kDxilIndexableAllocaMDName))
+      continue;
+    if (CountScalars(AI->getAllocatedType()) < Limit || !HasDynamicIndex(AI))
+      continue;
+    AI->setMetadata(DxilMDHelper::kDxilIndexableAllocaMDName,
+                    MDNode::get(F.getContext(), {}));
+    Changed = true;
+  }
+  return Changed;
+}
+
 static bool Mem2Reg(Function &F, DominatorTree &DT, AssumptionCache &AC) {
   BasicBlock &BB = F.getEntryBlock();  // Get the entry node for the function
   bool Changed  = false;
@@ -85,6 +135,9 @@ static bool Mem2Reg(Function &F, DominatorTree &DT, AssumptionCache &AC) {
 // produce vector phi's (disallowed by the validator), which need another
 // Scalarizer pass to clean up.
 //
+// With a nonzero IndexableArrayLimit, dynamically indexed arrays of at least
+// that many scalars are marked 'dx.indexable' to be kept in memory.
+//
 class DxilConditionalMem2Reg : public FunctionPass {
 public:
   static char ID;
@@ -92,14 +145,18 @@ public:
   // Function overrides that resolve options when used for DxOpt
   void applyOptions(PassOptions O) override {
     GetPassOptionBool(O, "NoOpt", &NoOpt, false);
+    GetPassOptionUnsigned(O, "IndexableArrayLimit", &IndexableArrayLimit, 0);
   }
   void dumpConfig(raw_ostream &OS) override {
     FunctionPass::dumpConfig(OS);
     OS << ",NoOpt=" << NoOpt;
+    OS << ",IndexableArrayLimit=" << IndexableArrayLimit;
   }
 
   bool NoOpt = false;
-  explicit DxilConditionalMem2Reg(bool NoOpt=false) : FunctionPass(ID), NoOpt(NoOpt)
+  unsigned IndexableArrayLimit = 0;
+  explicit DxilConditionalMem2Reg(bool NoOpt=false, unsigned IndexableArrayLimit=0)
+    : FunctionPass(ID), NoOpt(NoOpt), IndexableArrayLimit(IndexableArrayLimit)
   {
     initializeDxilConditionalMem2RegPass(*PassRegistry::getPassRegistry());
   }
@@ -417,6 +474,8 @@ public:
     Changed |= RewriteOutputArgsDebugInfo(F);
     Changed |= RemoveAllUnusedAllocas(F);
     Changed |= ScalarizePreciseVectorAlloca(F);
+    if (IndexableArrayLimit && !NoOpt)
+      Changed |= MarkIndexableArrays(F, IndexableArrayLimit);
     Changed |= Mem2Reg(F, *DT, *AC);
 
     return Changed;
@@ -424,8 +483,9 @@ public:
 };
 char DxilConditionalMem2Reg::ID;
 
-Pass *llvm::createDxilConditionalMem2RegPass(bool NoOpt) {
-  return new DxilConditionalMem2Reg(NoOpt);
+Pass *llvm::createDxilConditionalMem2RegPass(bool NoOpt,
+                                             unsigned IndexableArrayLimit) {
+  return new DxilConditionalMem2Reg(NoOpt, IndexableArrayLimit);
 }
 
 INITIALIZE_PASS_BEGIN(DxilConditionalMem2Reg, "dxil-cond-mem2reg", "Dxil Conditional Mem2Reg", false, false)
@@ -19,7 +19,9 @@
 
 #include "llvm/Pass.h"
 #include "llvm/Analysis/CFG.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/PostDominators.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -114,7 +116,7 @@ struct DxilEraseDeadRegion : public FunctionPass {
     return Region.size() != 0;
   }
 
-  bool TrySimplify(DominatorTree *DT, PostDominatorTree *PDT, BasicBlock *BB) {
+  bool TrySimplify(DominatorTree *DT, PostDominatorTree *PDT, LoopInfo *LI, BasicBlock *BB) {
     // Give up if BB has any Phis
     if (BB->begin() != BB->end() && isa<PHINode>(BB->begin()))
       return false;
@@ -149,6 +151,14 @@ struct DxilEraseDeadRegion : public FunctionPass {
 
           LoopPrevBB->getTerminator()->eraseFromParent();
           BranchInst::Create(NextBB, LoopPrevBB);
+
+          // Rare enough not to update the trees by hand.
+          DT->recalculate(*BB->getParent());
+          PDT->DT->recalculate(*BB->getParent());
+          if (LI) {
+            LI->releaseMemory();
+            LI->Analyze(*DT);
+          }
           return true;
         }
       }
@@ -183,6 +193,8 @@ struct DxilEraseDeadRegion : public FunctionPass {
     Common->getTerminator()->eraseFromParent();
     BranchInst::Create(BB, Common);
 
+    UpdateAnalyses(DT, PDT, LI, Common, BB, Region);
+
     // Delete the region
     for (BasicBlock *BB : Region) {
       for (Instruction &I : *BB)
@@ -198,14 +210,71 @@ struct DxilEraseDeadRegion : public FunctionPass {
     return true;
   }
 
+  // Erases the nodes of Region from a dominator tree, children first. The
+  // nodes of a dead region are only ever the parents of each other.
+  static void EraseRegionNodes(DominatorTreeBase<BasicBlock> &Tree,
+                               BasicBlock *Parent,
+                               const std::set<BasicBlock *> &Region) {
+    SmallVector<BasicBlock *, 16> Order;
+    SmallVector<DomTreeNode *, 4> Roots;
+    for (DomTreeNode *Child : *Tree.getNode(Parent))
+      if (Region.count(Child->getBlock()))
+        Roots.push_back(Child);
+    for (DomTreeNode *Root : Roots)
+      for (DomTreeNode *N : post_order(Root))
+        Order.push_back(N->getBlock());
+    assert(Order.size() == Region.size() && "region entered from outside");
+    for (BasicBlock *RegionBB : Order)
+      Tree.eraseNode(RegionBB);
+  }
+
+  // Common now branches straight to BB, and Region is about to be deleted.
+  // BB's immediate dominator already was Common, and only the blocks of the
+  // region and Common itself were post-dominated by region blocks, so
+  // neither tree needs rebuilding.
+  static void UpdateAnalyses(DominatorTree *DT, PostDominatorTree *PDT,
+                             LoopInfo *LI, BasicBlock *Common, BasicBlock *BB,
+                             const std::set<BasicBlock *> &Region) {
+    EraseRegionNodes(*DT, Common, Region);
+    PDT->DT->changeImmediateDominator(Common, BB);
+    EraseRegionNodes(*PDT->DT, BB, Region);
+
+    if (!LI)
+      return;
+    // A loop headed in the region lies wholly inside it, since the region
+    // is only entered from Common and BB does not branch back into it.
+    SmallVector<Loop *, 4> DeadLoops;
+    for (BasicBlock *RegionBB : Region) {
+      Loop *L = LI->getLoopFor(RegionBB);
+      if (L && L->getHeader() == RegionBB &&
+          (!L->getParentLoop() ||
+           !Region.count(L->getParentLoop()->getHeader())))
+        DeadLoops.push_back(L);
+    }
+    for (BasicBlock *RegionBB : Region)
+      LI->removeBlock(RegionBB);
+    for (Loop *L : DeadLoops) {
+      if (Loop *Parent = L->getParentLoop())
+        Parent->removeChildLoop(std::find(Parent->begin(), Parent->end(), L));
+      else
+        LI->removeLoop(std::find(LI->begin(), LI->end(), L));
+      delete L;
+    }
+  }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addRequired<PostDominatorTree>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<PostDominatorTree>();
+    AU.addPreserved<LoopInfoWrapperPass>();
   }
 
   bool runOnFunction(Function &F) override {
     auto *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
     auto *PDT = &getAnalysis<PostDominatorTree>();
+    auto *LIWP = getAnalysisIfAvailable<LoopInfoWrapperPass>();
+    LoopInfo *LI = LIWP ? &LIWP->getLoopInfo() : nullptr;
 
     std::unordered_set<BasicBlock *> FailedSet;
     bool Changed = false;
@@ -216,7 +285,7 @@ struct DxilEraseDeadRegion : public FunctionPass {
         if (FailedSet.count(&BB))
           continue;
 
-        if (this->TrySimplify(DT, PDT, &BB)) {
+        if (this->TrySimplify(DT, PDT, LI, &BB)) {
           LocalChanged = true;
           break;
         }
@@ -76,6 +76,7 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
@@ -111,12 +112,14 @@ public:
   unsigned MaxIterationAttempt = 0;
   bool OnlyWarnOnFail = false;
   bool StructurizeLoopExits = false;
+  unsigned GrowthBudget = 0; // Instructions full unrolling may add; 0 is unlimited.
 
-  DxilLoopUnroll(unsigned MaxIterationAttempt = 1024, bool OnlyWarnOnFail=false, bool StructurizeLoopExits=false) :
+  DxilLoopUnroll(unsigned MaxIterationAttempt = 1024, bool OnlyWarnOnFail=false, bool StructurizeLoopExits=false, unsigned GrowthBudget=0) :
     LoopPass(ID),
     MaxIterationAttempt(MaxIterationAttempt),
     OnlyWarnOnFail(OnlyWarnOnFail),
-    StructurizeLoopExits(StructurizeLoopExits)
+    StructurizeLoopExits(StructurizeLoopExits),
+    GrowthBudget(GrowthBudget)
   {
     initializeDxilLoopUnrollPass(*PassRegistry::getPassRegistry());
   }
@@ -139,12 +142,15 @@ public:
   void applyOptions(PassOptions O) override {
     GetPassOptionUnsigned(O, "MaxIterationAttempt", &MaxIterationAttempt, false);
     GetPassOptionBool(O, "OnlyWarnOnFail", &OnlyWarnOnFail, false);
+    GetPassOptionUnsigned(O, "GrowthBudget", &GrowthBudget, 0);
   }
   void dumpConfig(raw_ostream &OS) override {
     LoopPass::dumpConfig(OS);
     OS << ",MaxIterationAttempt=" << MaxIterationAttempt;
     OS << ",OnlyWarnOnFail=" << OnlyWarnOnFail;
+    OS << ",GrowthBudget=" << GrowthBudget;
   }
+  bool TryPartialUnroll(Loop *L, LPPassManager &LPM, unsigned TripCount, LoopInfo *LI, AssumptionCache *AC);
   void RecursivelyRemoveLoopOnSuccess(LPPassManager &LPM, Loop *L);
   void RecursivelyRecreateSubLoopForIteration(LPPassManager &LPM, LoopInfo *LI, Loop *OuterL, Loop *L, ClonedIteration &Iter, unsigned Depth=0);
 };
@@ -209,6 +215,37 @@ static bool IsMarkedUnrollCount(Loop *L, int *OutCount) {
   return false;
 }
 
+// Replace the unroll metadata of the loop with unroll(disable), so neither
+// this pass nor the default unroll pass touches it again.
+// Copied over from LoopUnrollPass.cpp - SetLoopAlreadyUnrolled()
+static void SetLoopAlreadyUnrolled(Loop *L) {
+  MDNode *LoopID = L->getLoopID();
+  if (!LoopID) return;
+
+  SmallVector<Metadata *, 4> MDs;
+  // Reserve first location for self reference to the LoopID metadata node.
+  MDs.push_back(nullptr);
+  for (unsigned i = 1, ie = LoopID->getNumOperands(); i < ie; ++i) {
+    bool IsUnrollMetadata = false;
+    MDNode *MD = dyn_cast<MDNode>(LoopID->getOperand(i));
+    if (MD) {
+      const MDString *S = dyn_cast<MDString>(MD->getOperand(0));
+      IsUnrollMetadata = S && S->getString().startswith("llvm.loop.unroll.");
+    }
+    if (!IsUnrollMetadata)
+      MDs.push_back(LoopID->getOperand(i));
+  }
+
+  LLVMContext &Context = L->getHeader()->getContext();
+  Metadata *DisableOperand = MDString::get(Context, "llvm.loop.unroll.disable");
+  MDs.push_back(MDNode::get(Context, DisableOperand));
+
+  MDNode *NewLoopID = MDNode::get(Context, MDs);
+  // Set operand 0 to refer to the loop id itself.
+  NewLoopID->replaceOperandWith(0, NewLoopID);
+  L->setLoopID(NewLoopID);
+}
+
 static bool HasSuccessorsInLoop(BasicBlock *BB, Loop *L) {
   for (BasicBlock *Succ : successors(BB)) {
     if (L->contains(Succ)) {
@@ -508,6 +545,66 @@ static void FindProblemBlocks(BasicBlock *Header, const SmallVectorImpl<BasicBlo
   }
 }
 
+// Returns the number of instructions one more iteration of the loop adds.
+static unsigned GetLoopBodySize(Loop *L) {
+  unsigned Size = 0;
+  for (BasicBlock *BB : L->getBlocks()) {
+    for (Instruction &I : *BB) {
+      if (!isa<PHINode>(&I) && !isa<DbgInfoIntrinsic>(&I))
+        Size++;
+    }
+  }
+  return Size;
+}
+
+// Returns true if the operation takes texel offsets, which must be
+// immediates.
+static bool HasImmediateOffsets(DXIL::OpCode Opcode) {
+  switch (Opcode) {
+  case DXIL::OpCode::Sample:
+  case DXIL::OpCode::SampleBias:
+  case DXIL::OpCode::SampleLevel:
+  case DXIL::OpCode::SampleGrad:
+  case DXIL::OpCode::SampleCmp:
+  case DXIL::OpCode::SampleCmpLevelZero:
+  case DXIL::OpCode::TextureLoad:
+  case DXIL::OpCode::TextureGather:
+  case DXIL::OpCode::TextureGatherCmp:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Returns true if a value derived from the induction variables reaches an
+// operation with texel offsets. Only full unrolling guarantees such a value
+// folds to the immediate the operation needs.
+static bool InductionFeedsImmediateOffset(Loop *L) {
+  SmallVector<Instruction *, 16> WorkList;
+  SmallPtrSet<Instruction *, 16> InstructionsSeen;
+
+  for (Instruction &I : *L->getHeader()) {
+    PHINode *PN = dyn_cast<PHINode>(&I);
+    if (!PN)
+      break;
+    WorkList.push_back(PN);
+    InstructionsSeen.insert(PN);
+  }
+
+  while (WorkList.size()) {
+    Instruction *I = WorkList.pop_back_val();
+    if (hlsl::OP::IsDxilOpFuncCallInst(I) &&
+        HasImmediateOffsets(hlsl::OP::GetDxilOpFuncCallInst(I)))
+      return true;
+    for (User *U : I->users()) {
+      Instruction *UserI = dyn_cast<Instruction>(U);
+      if (UserI && L->contains(UserI) && InstructionsSeen.insert(UserI).second)
+        WorkList.push_back(UserI);
+    }
+  }
+  return false;
+}
+
 // Helper function for getting GEP's const index value
 inline static int64_t GetGEPIndex(GEPOperator *GEP, unsigned idx) {
   return cast<ConstantInt>(GEP->getOperand(idx + 1))->getSExtValue();
@@ -724,6 +821,30 @@ void DxilLoopUnroll::RecursivelyRecreateSubLoopForIteration(LPPassManager &LPM,
   }
 }
 
+// Unrolls the loop by the largest factor that divides the trip count and
+// stays within the growth budget, so no remainder iterations need peeling.
+// Leaves the loop rolled when no such factor exists.
+bool DxilLoopUnroll::TryPartialUnroll(Loop *L, LPPassManager &LPM, unsigned TripCount, LoopInfo *LI, AssumptionCache *AC) {
+  uint64_t BodySize = std::max(GetLoopBodySize(L), 1u);
+  unsigned Count = 1;
+  for (unsigned C = 2; C < TripCount; C++) {
+    if ((uint64_t)BodySize * (C - 1) > GrowthBudget)
+      break;
+    if (TripCount % C == 0)
+      Count = C;
+  }
+
+  if (Count > 1) {
+    UnrollLoop(L, Count, TripCount, /*AllowRuntime*/false,
+               /*AllowExpensiveTripCount*/false,
+               /*TripMultiple*/TripCount, LI, this, &LPM, AC);
+  }
+
+  // Keep the default unroll pass from finishing the job later.
+  SetLoopAlreadyUnrolled(L);
+  return true;
+}
+
 bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
 
   DebugLoc LoopLoc = L->getStartLoc(); // Debug location for the start of the loop.
@@ -800,6 +921,15 @@ bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
   std::unordered_set<BasicBlock *> ProblemBlocks;
   FindProblemBlocks(L->getHeader(), BlocksInLoop, ProblemBlocks, ProblemAllocas);
 
+  // When fully unrolling would grow the function past the budget and the
+  // loop does not need it to be legal, only unroll it partially.
+  if (GrowthBudget && !HasExplicitLoopCount && TripCount > 1 &&
+      ProblemBlocks.empty() && ProblemAllocas.empty() &&
+      (uint64_t)GetLoopBodySize(L) * (TripCount - 1) > GrowthBudget &&
+      !InductionFeedsImmediateOffset(L)) {
+    return TryPartialUnroll(L, LPM, TripCount, LI, AC);
+  }
+
   if (StructurizeLoopExits && hlsl::RemoveUnstructuredLoopExits(L, LI, DT, /* exclude */&ProblemBlocks)) {
     // Recompute the loop if we managed to simplify the exit blocks
 
@@ -908,6 +1038,8 @@ bool DxilLoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
   }
 
   for (unsigned IterationI = 0; IterationI < MaxAttempt; IterationI++) {
+    // Huge trip counts can clone for a long time.
+    checkCancellation();
 
     ClonedIteration *PrevIteration = nullptr;
     if (Iterations.size())
@@ -1186,8 +1318,8 @@ bool DxilLoopUnroll::doFinalization() {
 
 }
 
-Pass *llvm::createDxilLoopUnrollPass(unsigned MaxIterationAttempt, bool OnlyWarnOnFail, bool StructurizeLoopExits) {
-  return new DxilLoopUnroll(MaxIterationAttempt, OnlyWarnOnFail, StructurizeLoopExits);
+Pass *llvm::createDxilLoopUnrollPass(unsigned MaxIterationAttempt, bool OnlyWarnOnFail, bool StructurizeLoopExits, unsigned GrowthBudget) {
+  return new DxilLoopUnroll(MaxIterationAttempt, OnlyWarnOnFail, StructurizeLoopExits, GrowthBudget);
 }
 
 INITIALIZE_PASS_BEGIN(DxilLoopUnroll, "dxil-loop-unroll", "Dxil Unroll loops", false, false)
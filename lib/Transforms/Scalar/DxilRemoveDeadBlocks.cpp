@@ -15,6 +15,8 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Analysis/DxilValueCache.h"
 
@@ -35,11 +37,26 @@ static void RemoveIncomingValueFrom(BasicBlock *SuccBB, BasicBlock *BB) {
   }
 }
 
-static bool EraseDeadBlocks(Function &F, DxilValueCache *DVC) {
+// Only branches folded on a constant condition change the dominance of
+// blocks that stay alive. Blocks that were unreachable to begin with are in
+// neither analysis, so erasing them needs no update.
+static void UpdateAnalyses(Function &F, DominatorTree *DT, LoopInfo *LI) {
+  if (!DT)
+    return;
+  DT->recalculate(F);
+  if (LI) {
+    LI->releaseMemory();
+    LI->Analyze(*DT);
+  }
+}
+
+static bool EraseDeadBlocks(Function &F, DxilValueCache *DVC,
+                            DominatorTree *DT, LoopInfo *LI) {
   std::unordered_set<BasicBlock *> Seen;
   std::vector<BasicBlock *> WorkList;
 
   bool Changed = false;
+  bool FoldedBranch = false;
 
   auto Add = [&WorkList, &Seen](BasicBlock *BB) {
     if (!Seen.count(BB)) {
@@ -63,6 +80,7 @@ static bool EraseDeadBlocks(Function &F, DxilValueCache *DVC) {
       else {
         if (ConstantInt *C = DVC->GetConstInt(Br->getCondition())) {
           bool IsTrue = C->getLimitedValue() != 0;
+          FoldedBranch = true;
           BasicBlock *Succ = Br->getSuccessor(IsTrue ? 0 : 1);
           BasicBlock *NotSucc = Br->getSuccessor(!IsTrue ? 0 : 1);
 
@@ -96,6 +114,7 @@ static bool EraseDeadBlocks(Function &F, DxilValueCache *DVC) {
 
       if (Succ) {
         Add(Succ);
+        FoldedBranch = true;
 
         BranchInst *NewBr = BranchInst::Create(Succ, BB);
         hlsl::DxilMDHelper::CopyMetadata(*NewBr, *Switch);
@@ -119,8 +138,14 @@ static bool EraseDeadBlocks(Function &F, DxilValueCache *DVC) {
     }
   }
 
-  if (Seen.size() == F.size())
+  if (Seen.size() == F.size()) {
+    // Blocks that lost a predecessor may have constant PHIs now.
+    if (Changed)
+      DVC->ResetUnknowns(F);
+    if (FoldedBranch)
+      UpdateAnalyses(F, DT, LI);
     return Changed;
+  }
 
   std::vector<BasicBlock *> DeadBlocks;
 
@@ -170,7 +195,9 @@ static bool EraseDeadBlocks(Function &F, DxilValueCache *DVC) {
     BB->eraseFromParent();
   }
 
-  DVC->ResetUnknowns();
+  DVC->ResetUnknowns(F);
+  if (FoldedBranch)
+    UpdateAnalyses(F, DT, LI);
 
   return true;
 }
@@ -184,10 +211,15 @@ struct DxilRemoveDeadBlocks : public FunctionPass {
   }
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<DxilValueCache>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
   }
   bool runOnFunction(Function &F) override {
     DxilValueCache *DVC = &getAnalysis<DxilValueCache>();
-    return EraseDeadBlocks(F, DVC);
+    auto *DTWP = getAnalysisIfAvailable<DominatorTreeWrapperPass>();
+    auto *LIWP = getAnalysisIfAvailable<LoopInfoWrapperPass>();
+    return EraseDeadBlocks(F, DVC, DTWP ? &DTWP->getDomTree() : nullptr,
+                           LIWP ? &LIWP->getLoopInfo() : nullptr);
   }
 };
 
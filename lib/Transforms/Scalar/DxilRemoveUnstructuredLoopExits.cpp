@@ -118,6 +118,7 @@
 #include "llvm/Analysis/LoopPass.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
 #include "llvm/IR/Instructions.h"
@@ -298,14 +299,15 @@ static BasicBlock *GetExitBlockForExitingBlock(Loop *L, BasicBlock *exiting_bloc
 // Branch over the block's content with the condition cond.
 // All values used outside the block is replaced by a phi.
 //
-static void SkipBlockWithBranch(BasicBlock *bb, Value *cond, Loop *L, LoopInfo *LI) {
-  BasicBlock *body = bb->splitBasicBlock(bb->getFirstNonPHI());
+static void SkipBlockWithBranch(BasicBlock *bb, Value *cond, LoopInfo *LI, DominatorTree *DT) {
+  BasicBlock *body = SplitBlock(bb, bb->getFirstNonPHI(), DT, LI);
   body->setName("dx.struct_exit.cond_body");
-  BasicBlock *end = body->splitBasicBlock(body->getTerminator());
+  BasicBlock *end = SplitBlock(body, body->getTerminator(), DT, LI);
   end->setName("dx.struct_exit.cond_end");
 
   bb->getTerminator()->eraseFromParent();
   BranchInst::Create(end, body, cond, bb);
+  DT->changeImmediateDominator(end, bb);
 
   for (Instruction &inst : *body) {
     PHINode *phi = nullptr;
@@ -326,9 +328,6 @@ static void SkipBlockWithBranch(BasicBlock *bb, Value *cond, Loop *L, LoopInfo *
       }
     } // For each user of inst of body
   } // For each inst in body
-
-  L->addBasicBlockToLoop(body, *LI);
-  L->addBasicBlockToLoop(end, *LI);
 }
 
 static unsigned GetNumPredecessors(BasicBlock *bb) {
@@ -340,6 +339,10 @@ static unsigned GetNumPredecessors(BasicBlock *bb) {
   return ret;
 }
 
+// DT stays exact for the blocks of L, which is all the following iterations
+// look at: the edges this changes all leave L, and the blocks split inside it
+// are added as they are made. Blocks outside L may be left stale, for the
+// caller to recalculate once.
 static bool RemoveUnstructuredLoopExitsIteration(BasicBlock *exiting_block, Loop *L, LoopInfo *LI, DominatorTree *DT) {
 
   LLVMContext &ctx = L->getHeader()->getContext();
@@ -411,7 +414,7 @@ static bool RemoveUnstructuredLoopExitsIteration(BasicBlock *exiting_block, Loop
   // If there are any blocks with side effects,
   for (BasicBlock *bb : blocks_with_side_effect) {
     Value *exit_cond_for_block = prop.Get(exit_cond, bb);
-    SkipBlockWithBranch(bb, exit_cond_for_block, L, LI);
+    SkipBlockWithBranch(bb, exit_cond_for_block, LI, DT);
   }
 
   // Make the exiting block not exit.
@@ -427,7 +430,7 @@ static bool RemoveUnstructuredLoopExitsIteration(BasicBlock *exiting_block, Loop
 
   // Split the block where we're now exiting from, and branch to latch exit
   std::string old_name = new_exiting_block->getName().str();
-  BasicBlock *new_not_exiting_block = new_exiting_block->splitBasicBlock(new_exiting_block->getFirstNonPHI());
+  BasicBlock *new_not_exiting_block = SplitBlock(new_exiting_block, new_exiting_block->getFirstNonPHI(), DT);
   new_exiting_block->setName("dx.struct_exit.new_exiting");
   new_not_exiting_block->setName(old_name);
   L->addBasicBlockToLoop(new_not_exiting_block, *LI);
@@ -524,9 +527,6 @@ static bool RemoveUnstructuredLoopExitsIteration(BasicBlock *exiting_block, Loop
     BranchInst::Create(exit_block, post_exit_location, exit_cond_lcssa, latch_exit);
   }
 
-  DT->recalculate(*L->getHeader()->getParent());
-  assert(L->isLCSSAForm(*DT));
-
   return true;
 }
 
@@ -576,6 +576,12 @@ bool hlsl::RemoveUnstructuredLoopExits(llvm::Loop *L, llvm::LoopInfo *LI, llvm::
     }
   }
 
+  // The iterations kept DT exact inside the loop only; fix the rest up once.
+  if (changed) {
+    DT->recalculate(*L->getHeader()->getParent());
+    assert(L->isLCSSAForm(*DT));
+  }
+
   return changed;
 }
 
@@ -629,6 +629,16 @@ namespace {
       initializeGVNPass(*PassRegistry::getPassRegistry());
     }
 
+    // HLSL Change Begins - round-trip the -O1 no-loads variant through -Odump.
+    void applyOptions(PassOptions O) override {
+      GetPassOptionBool(O, "noloads", &NoLoads, false);
+    }
+    void dumpConfig(raw_ostream &OS) override {
+      FunctionPass::dumpConfig(OS);
+      OS << ",noloads=" << NoLoads;
+    }
+    // HLSL Change Ends
+
     bool runOnFunction(Function &F) override;
 
     /// This removes the specified instruction from
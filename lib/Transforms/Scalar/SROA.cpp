@@ -4401,6 +4401,9 @@ bool SROA::runOnAlloca(AllocaInst &AI) {
   // If we let this run, it'll get turned into an i8, which is invalid dxil.
   if (AI.getAllocatedType()->isIntegerTy(1))
     return false;
+  // Large arrays indexed dynamically before unrolling stay in memory.
+  if (AI.getMetadata(hlsl::DxilMDHelper::kDxilIndexableAllocaMDName))
+    return false;
   // HLSL Change End
 
   // Skip alloca forms that this analysis can't handle.
@@ -14,8 +14,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
@@ -587,7 +589,7 @@ struct MemcpySplitter {
 public:
   MemcpySplitter(llvm::LLVMContext &context, DxilTypeSystem &typeSys)
       : m_context(context), m_typeSys(typeSys) {}
-  void Split(llvm::Function &F);
+  void Split(llvm::Module &M);
 
   static void PatchMemCpyWithZeroIdxGEP(Module &M);
   static void PatchMemCpyWithZeroIdxGEP(MemCpyInst *MI, const DataLayout &DL);
@@ -1130,19 +1132,25 @@ void MemcpySplitter::SplitMemCpy(MemCpyInst *MI, const DataLayout &DL,
   DeleteMemcpy(MI);
 }
 
-void MemcpySplitter::Split(llvm::Function &F) {
-  const DataLayout &DL = F.getParent()->getDataLayout();
-  SmallVector<Function *, 2> memcpys;
-  for (Function &Fn : F.getParent()->functions()) {
-    if (Fn.getIntrinsicID() == Intrinsic::memcpy) {
-      memcpys.emplace_back(&Fn);
+// Splits the memcpys left in every function, one function at a time.
+// Bucketing them up front walks the memcpy users once, rather than once per
+// function.
+void MemcpySplitter::Split(llvm::Module &M) {
+  const DataLayout &DL = M.getDataLayout();
+  DenseMap<Function *, SmallVector<MemCpyInst *, 8>> memcpysByFunction;
+  for (Function &Fn : M.functions()) {
+    if (Fn.getIntrinsicID() != Intrinsic::memcpy)
+      continue;
+    for (User *U : Fn.users()) {
+      MemCpyInst *MI = cast<MemCpyInst>(U);
+      memcpysByFunction[MI->getParent()->getParent()].push_back(MI);
     }
   }
-  for (Function *memcpy : memcpys) {
-    for (auto U = memcpy->user_begin(); U != memcpy->user_end();) {
-      MemCpyInst *MI = cast<MemCpyInst>(*(U++));
-      if (MI->getParent()->getParent() != &F)
-        continue;
+  for (Function &F : M) {
+    auto it = memcpysByFunction.find(&F);
+    if (it == memcpysByFunction.end())
+      continue;
+    for (MemCpyInst *MI : it->second) {
       // Matrix is treated as scalar type, will not use memcpy.
       // So use nullptr for fieldAnnotation should be safe here.
       SplitMemCpy(MI, DL, /*fieldAnnotation*/ nullptr, m_typeSys,
@@ -1193,11 +1201,15 @@ bool markPrecise(Function &F) {
   return Changed;
 }
 
-bool Cleanup(Function &F, DxilTypeSystem &typeSys) {
+void Cleanup(Module &M, DxilTypeSystem &typeSys) {
   // change rest memcpy into ld/st.
-  MemcpySplitter splitter(F.getContext(), typeSys);
-  splitter.Split(F);
-  return markPrecise(F);
+  MemcpySplitter splitter(M.getContext(), typeSys);
+  splitter.Split(M);
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    markPrecise(F);
+  }
 }
 } // namespace
 
@@ -1699,23 +1711,31 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
   // alloca. Big alloca will be split to smaller piece first, when process the
   // alloca, it will be alloca flattened from big alloca instead of a GEP of
   // big alloca.
-  auto size_cmp = [&DL](const Value *a0, const Value *a1) -> bool {
-    Type *a0ty = a0->getType()->getPointerElementType();
-    Type *a1ty = a1->getType()->getPointerElementType();
-    bool isUnitSzStruct0 =
-        a0ty->isStructTy() && a0ty->getStructNumElements() == 1;
-    bool isUnitSzStruct1 =
-        a1ty->isStructTy() && a1ty->getStructNumElements() == 1;
-    auto sz0 = DL.getTypeAllocSize(a0ty);
-    auto sz1 = DL.getTypeAllocSize(a1ty);
-    if (sz0 == sz1 && (isUnitSzStruct0 || isUnitSzStruct1))
-      return getNestedLevelInStruct(a0ty) < getNestedLevelInStruct(a1ty);
-    return sz0 < sz1;
+  // The ordering key is computed once when a value is queued, rather than on
+  // every comparison, which dominated the pass on deeply nested aggregates.
+  struct WorkItem {
+    uint64_t Size;
+    unsigned NestedLevel;
+    bool IsUnitSzStruct;
+    Value *V;
+  };
+  struct WorkItemLess {
+    bool operator()(const WorkItem &a0, const WorkItem &a1) const {
+      if (a0.Size == a1.Size && (a0.IsUnitSzStruct || a1.IsUnitSzStruct))
+        return a0.NestedLevel < a1.NestedLevel;
+      return a0.Size < a1.Size;
+    }
+  };
+  std::priority_queue<WorkItem, std::vector<WorkItem>, WorkItemLess> WorkList;
+  auto PushWork = [&WorkList, &DL](Value *V) {
+    Type *Ty = V->getType()->getPointerElementType();
+    WorkItem Item;
+    Item.Size = DL.getTypeAllocSize(Ty);
+    Item.NestedLevel = getNestedLevelInStruct(Ty);
+    Item.IsUnitSzStruct = Ty->isStructTy() && Ty->getStructNumElements() == 1;
+    Item.V = V;
+    WorkList.push(Item);
   };
-
-  std::priority_queue<Value *, std::vector<Value *>,
-                      std::function<bool(Value *, Value *)>>
-      WorkList(size_cmp);
 
   // Flatten internal global.
   llvm::SetVector<GlobalVariable *> staticGVs;
@@ -1734,7 +1754,7 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
   }
   // Add static GVs to work list.
   for (GlobalVariable *GV : staticGVs)
-    WorkList.push(GV);
+    PushWork(GV);
 
   DenseMap<Function *, DominatorTree> domTreeMap;
   for (Function &F : M) {
@@ -1748,7 +1768,7 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
     for (BasicBlock::iterator I = BB.begin(), E = BB.end(); I != E; ++I)
       if (AllocaInst *A = dyn_cast<AllocaInst>(I)) {
         if (!A->user_empty()) {
-          WorkList.push(A);
+          PushWork(A);
           // merge GEP use for the allocs
           HLModule::MergeGepUse(A);
         }
@@ -1771,7 +1791,7 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
 
   bool Changed = false;
   while (!WorkList.empty()) {
-    Value *V = WorkList.top();
+    Value *V = WorkList.top().V;
     WorkList.pop();
 
     if (AllocaInst *AI = dyn_cast<AllocaInst>(V)) {
@@ -1865,7 +1885,7 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
           // Push Elts into workList.
           for (unsigned EltIdx = 0; EltIdx < Elts.size(); ++EltIdx) {
             AllocaInst *EltAlloca = cast<AllocaInst>(Elts[EltIdx]);
-            WorkList.push(EltAlloca);
+            PushWork(EltAlloca);
           }
 
           // Now erase any instructions that were made dead while rewriting the
@@ -1942,7 +1962,7 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
         unsigned offset = 0;
         // Push Elts into workList.
         for (auto iter = Elts.begin(); iter != Elts.end(); iter++) {
-          WorkList.push(*iter);
+          PushWork(*iter);
           GlobalVariable *EltGV = cast<GlobalVariable>(*iter);
           if (bHasDbgInfo) {
             StringRef OriginEltName = EltGV->getName();
@@ -1985,11 +2005,7 @@ bool SROAGlobalAndAllocas(HLModule &HLM, bool bHasDbgInfo) {
   // Remove unused internal global.
   RemoveUnusedInternalGlobalVariable(M);
   // Cleanup memcpy for allocas and mark precise.
-  for (Function &F : M) {
-    if (F.isDeclaration())
-      continue;
-    Cleanup(F, typeSys);
-  }
+  Cleanup(M, typeSys);
 
   return true;
 }
@@ -5921,9 +5937,49 @@ ModulePass *llvm::createSROA_Parameter_HLSL() {
 // Lower static global into Alloca.
 //===----------------------------------------------------------------------===//
 
+namespace {
+// Instructions using a static global, with the value each one uses: the
+// global itself, or the constant GEP/bitcast of it that the instruction uses.
+typedef MapVector<Instruction *, Value *> GVInstUserMap;
+
+// The debug info that lowered globals are looked up in, indexed once per
+// module rather than searched for each global.
+struct StaticGlobalDebugInfo {
+  bool HasDebugInfo = false;
+  // First subprogram of each function.
+  DenseMap<const Function *, DISubprogram *> Subprograms;
+  // First debug variable of each global.
+  DenseMap<const Constant *, DIGlobalVariable *> Variables;
+  // Debug variables by name, in module order.
+  StringMap<SmallVector<DIGlobalVariable *, 1>> VariablesByName;
+
+  void Init(const DebugInfoFinder &DbgFinder) {
+    Subprograms.clear();
+    Variables.clear();
+    VariablesByName.clear();
+    HasDebugInfo = DbgFinder.compile_unit_count() != 0;
+    if (!HasDebugInfo)
+      return;
+    for (DISubprogram *SP : DbgFinder.subprograms())
+      if (const Function *F = SP->getFunction())
+        Subprograms.insert(std::make_pair(F, SP));
+    for (DIGlobalVariable *DGV : DbgFinder.global_variables()) {
+      if (const Constant *V = DGV->getVariable())
+        Variables.insert(std::make_pair(V, DGV));
+      VariablesByName[DGV->getName()].emplace_back(DGV);
+    }
+  }
+};
+} // namespace
+
+static bool collectGVInstUsers(Value *V,
+                               const SetVector<Function *> &Funcs,
+                               GVInstUserMap &InstUserMap);
+
 namespace {
 class LowerStaticGlobalIntoAlloca : public ModulePass {
   DebugInfoFinder m_DbgFinder;
+  StaticGlobalDebugInfo m_DbgInfo;
 
 public:
   static char ID; // Pass identification, replacement for typeid
@@ -5932,12 +5988,11 @@ public:
 
   bool runOnModule(Module &M) override {
     m_DbgFinder.processModule(M);
+    m_DbgInfo.Init(m_DbgFinder);
     Type *handleTy = nullptr;
-    DxilTypeSystem *pTypeSys = nullptr;
     SetVector<Function *> entryAndInitFunctionSet;
     if (M.HasHLModule()) {
       auto &HLM = M.GetHLModule();
-      pTypeSys = &HLM.GetTypeSystem();
       handleTy = HLM.GetOP()->GetHandleType();
       if (!HLM.GetShaderModel()->IsLib()) {
         entryAndInitFunctionSet.insert(HLM.GetEntryFunction());
@@ -5955,7 +6010,6 @@ public:
     } else {
       DXASSERT(M.HasDxilModule(), "must have dxilModle or HLModule");
       auto &DM = M.GetDxilModule();
-      pTypeSys = &DM.GetTypeSystem();
       handleTy = DM.GetOP()->GetHandleType();
       if (!DM.GetShaderModel()->IsLib()) {
         entryAndInitFunctionSet.insert(DM.GetEntryFunction());
@@ -5996,7 +6050,10 @@ public:
     }
 
     // Lower static global into allocas.
-    std::vector<GlobalVariable *> staticGVs;
+    // The users of each global are walked once, both to check that it is
+    // only used in entry and init functions and to collect the uses to
+    // replace.
+    std::vector<std::pair<GlobalVariable *, GVInstUserMap>> staticGVs;
     for (GlobalVariable &GV : M.globals()) {
       // only for non-constant static globals
       if (!dxilutil::IsStaticGlobal(&GV) || GV.isConstant())
@@ -6004,40 +6061,37 @@ public:
       // Skip dx.ishelper
       if (GV.getName().compare(DXIL::kDxIsHelperGlobalName) == 0)
         continue;
-      // Skip if GV used in functions other than entry.
-      if (!usedOnlyInEntry(&GV, entryAndInitFunctionSet))
-        continue;
       Type *EltTy = GV.getType()->getElementType();
-      if (!EltTy->isAggregateType()) {
-        staticGVs.emplace_back(&GV);
-      } else {
+      if (EltTy->isAggregateType()) {
         EltTy = dxilutil::GetArrayEltTy(EltTy);
         // Lower static [array of] resources
-        if (dxilutil::IsHLSLObjectType(EltTy) ||
-            EltTy == handleTy) {
-          staticGVs.emplace_back(&GV);
-        }
+        if (!dxilutil::IsHLSLObjectType(EltTy) && EltTy != handleTy)
+          continue;
       }
+      GV.removeDeadConstantUsers();
+      GVInstUserMap InstUserMap;
+      // Skip if GV used in functions other than entry.
+      if (!collectGVInstUsers(&GV, entryAndInitFunctionSet, InstUserMap))
+        continue;
+      staticGVs.emplace_back(&GV, std::move(InstUserMap));
     }
     bool bUpdated = false;
 
-    const DataLayout &DL = M.getDataLayout();
     // Create AI for each GV in each entry.
     // Replace all users of GV with AI.
-    // Collect all users of GV within each entry.
     // Remove unused AI in the end.
-    for (GlobalVariable *GV : staticGVs) {
-      bUpdated |= lowerStaticGlobalIntoAlloca(GV, DL, *pTypeSys, entryAndInitFunctionSet);
+    for (auto &GVUsers : staticGVs) {
+      bUpdated |= lowerStaticGlobalIntoAlloca(GVUsers.first, GVUsers.second,
+                                              entryAndInitFunctionSet);
     }
 
     return bUpdated;
   }
 
 private:
-  bool lowerStaticGlobalIntoAlloca(GlobalVariable *GV, const DataLayout &DL,
-                                   DxilTypeSystem &typeSys,
+  bool lowerStaticGlobalIntoAlloca(GlobalVariable *GV,
+                                   const GVInstUserMap &InstUserMap,
                                    SetVector<Function *> &entryAndInitFunctionSet);
-  bool usedOnlyInEntry(Value *V, SetVector<Function *> &entryAndInitFunctionSet);
 };
 }
 
@@ -6070,7 +6124,7 @@ static bool IsDerivedTypeOf(DIType *TyA, DIType *TyB) {
 //
 // If DGV is not a member, just return nullptr.
 //
-static DIGlobalVariable *FindGlobalVariableFragment(const DebugInfoFinder &DbgFinder, DIGlobalVariable *DGV, unsigned *Out_OffsetInBits, unsigned *Out_SizeInBits) {
+static DIGlobalVariable *FindGlobalVariableFragment(const StaticGlobalDebugInfo &DbgInfo, DIGlobalVariable *DGV, unsigned *Out_OffsetInBits, unsigned *Out_SizeInBits) {
   DITypeIdentifierMap EmptyMap;
 
   StringRef FullName = DGV->getName();
@@ -6086,12 +6140,13 @@ static DIGlobalVariable *FindGlobalVariableFragment(const DebugInfoFinder &DbgFi
 
   DIGlobalVariable *FinalResult = nullptr;
 
-  for (DIGlobalVariable *DGV_It : DbgFinder.global_variables()) {
-    if (DGV_It->getName() == BaseName &&
-      IsDerivedTypeOf(Ty, DGV_It->getType().resolve(EmptyMap)))
-    {
-      FinalResult = DGV_It;
-      break;
+  auto Candidates = DbgInfo.VariablesByName.find(BaseName);
+  if (Candidates != DbgInfo.VariablesByName.end()) {
+    for (DIGlobalVariable *DGV_It : Candidates->second) {
+      if (IsDerivedTypeOf(Ty, DGV_It->getType().resolve(EmptyMap))) {
+        FinalResult = DGV_It;
+        break;
+      }
     }
   }
 
@@ -6107,20 +6162,14 @@ static DIGlobalVariable *FindGlobalVariableFragment(const DebugInfoFinder &DbgFi
 // lowered to local Alloca.
 //
 static
-void PatchDebugInfo(DebugInfoFinder &DbgFinder, Function *F, GlobalVariable *GV, AllocaInst *AI) {
-  if (!DbgFinder.compile_unit_count())
+void PatchDebugInfo(const StaticGlobalDebugInfo &DbgInfo, Function *F, GlobalVariable *GV, AllocaInst *AI) {
+  if (!DbgInfo.HasDebugInfo)
     return;
 
   // Find the subprogram for function
-  DISubprogram *Subprogram = nullptr;
-  for (DISubprogram *SP : DbgFinder.subprograms()) {
-    if (SP->getFunction() == F) {
-      Subprogram = SP;
-      break;
-    }
-  }
+  DISubprogram *Subprogram = DbgInfo.Subprograms.lookup(F);
 
-  DIGlobalVariable *DGV = dxilutil::FindGlobalVariableDebugInfo(GV, DbgFinder);
+  DIGlobalVariable *DGV = DbgInfo.Variables.lookup(GV);
   if (!DGV)
     return;
 
@@ -6133,7 +6182,7 @@ void PatchDebugInfo(DebugInfoFinder &DbgFinder, Function *F, GlobalVariable *GV,
   bool IsFragment = false;
   unsigned OffsetInBits = 0,
            SizeInBits = 0;
-  if (DIGlobalVariable *UnsplitDGV = FindGlobalVariableFragment(DbgFinder, DGV, &OffsetInBits, &SizeInBits)) {
+  if (DIGlobalVariable *UnsplitDGV = FindGlobalVariableFragment(DbgInfo, DGV, &OffsetInBits, &SizeInBits)) {
     DGV = UnsplitDGV;
     IsFragment = true;
   }
@@ -6165,15 +6214,21 @@ void PatchDebugInfo(DebugInfoFinder &DbgFinder, Function *F, GlobalVariable *GV,
 //For direct use, the value == GV
 //For constant operator like GEP/Bitcast, the value is the operator used by the instruction.
 //This requires recursion to unwrap nested constant operators using the GV.
-static void collectGVInstUsers(Value *V,
-                               DenseMap<Instruction *, Value *> &InstUserMap) {
+//Returns false, leaving InstUserMap incomplete, if an instruction outside
+//Funcs uses V.
+static bool collectGVInstUsers(Value *V,
+                               const SetVector<Function *> &Funcs,
+                               GVInstUserMap &InstUserMap) {
   for (User *U : V->users()) {
     if (Instruction *I = dyn_cast<Instruction>(U)) {
+      if (Funcs.count(I->getParent()->getParent()) == 0)
+        return false;
       InstUserMap[I] = V;
-    } else {
-      collectGVInstUsers(U, InstUserMap);
+    } else if (!collectGVInstUsers(U, Funcs, InstUserMap)) {
+      return false;
     }
   }
+  return true;
 }
 
 static Instruction *replaceGVUseWithAI(GlobalVariable *GV, AllocaInst *AI,
@@ -6196,9 +6251,8 @@ static Instruction *replaceGVUseWithAI(GlobalVariable *GV, AllocaInst *AI,
 }
 
 bool LowerStaticGlobalIntoAlloca::lowerStaticGlobalIntoAlloca(
-    GlobalVariable *GV, const DataLayout &DL, DxilTypeSystem &typeSys,
+    GlobalVariable *GV, const GVInstUserMap &InstUserMap,
     SetVector<Function *> &entryAndInitFunctionSet) {
-  GV->removeDeadConstantUsers();
   bool bIsObjectTy = dxilutil::IsHLSLObjectType(
       dxilutil::StripArrayTypes(GV->getType()->getElementType()));
   // Create alloca for each entry.
@@ -6210,14 +6264,11 @@ bool LowerStaticGlobalIntoAlloca::lowerStaticGlobalIntoAlloca(
     // Store initializer is exist.
     if (GV->hasInitializer() && !isa<UndefValue>(GV->getInitializer()) &&
         !bIsObjectTy) { // Do not zerio-initialize object allocas
-      Builder.CreateStore(GV->getInitializer(), GV);
+      Builder.CreateStore(GV->getInitializer(), AI);
     }
   }
 
-  DenseMap<Instruction *, Value *> InstUserMap;
-  collectGVInstUsers(GV, InstUserMap);
-
-  for (auto it : InstUserMap) {
+  for (auto &it : InstUserMap) {
     Instruction *I = it.first;
     Value *U = it.second;
 
@@ -6235,7 +6286,7 @@ bool LowerStaticGlobalIntoAlloca::lowerStaticGlobalIntoAlloca(
     if (AI->user_empty())
       AI->eraseFromParent();
     else
-      PatchDebugInfo(m_DbgFinder, F, GV, AI);
+      PatchDebugInfo(m_DbgInfo, F, GV, AI);
   }
 
   GV->removeDeadConstantUsers();
@@ -6244,26 +6295,6 @@ bool LowerStaticGlobalIntoAlloca::lowerStaticGlobalIntoAlloca(
   return true;
 }
 
-bool LowerStaticGlobalIntoAlloca::usedOnlyInEntry(
-    Value *V, SetVector<Function *> &entryAndInitFunctionSet) {
-  bool bResult = true;
-  for (User *U : V->users()) {
-    if (Instruction *I = dyn_cast<Instruction>(U)) {
-      Function *F = I->getParent()->getParent();
-
-      if (entryAndInitFunctionSet.count(F) == 0) {
-        bResult = false;
-        break;
-      }
-    } else {
-      bResult = usedOnlyInEntry(U, entryAndInitFunctionSet);
-      if (!bResult)
-        break;
-    }
-  }
-  return bResult;
-}
-
 char LowerStaticGlobalIntoAlloca::ID = 0;
 
 INITIALIZE_PASS(LowerStaticGlobalIntoAlloca, "static-global-to-alloca",
@@ -194,6 +194,10 @@ private:
 
 public:
   hlsl::DxcLangExtensionsHelperApply *HlslLangExtensions; // HLSL Change
+  // HLSL Change - with SkipFunctionBodies, only skip the bodies of functions
+  // outside the main file, so reparses don't spend their time in the bodies
+  // of functions from included headers.
+  bool SkipIncludedFunctionBodies;
 
   class PreambleData {
     const FileEntry *File;
@@ -863,7 +867,8 @@ public:
       bool AllowPCHWithCompilerErrors = false, bool SkipFunctionBodies = false,
       bool UserFilesAreVolatile = false, bool ForSerialization = false,
       std::unique_ptr<ASTUnit> *ErrAST = nullptr,
-      hlsl::DxcLangExtensionsHelperApply *HlslLangExtensions = nullptr); // HLSL Change
+      hlsl::DxcLangExtensionsHelperApply *HlslLangExtensions = nullptr, // HLSL Change
+      bool SkipIncludedFunctionBodies = false); // HLSL Change
 
   /// \brief Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
@@ -24,6 +24,11 @@
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h" // HLSL change
 #include "dxc/Support/SPIRVOptions.h" // SPIR-V Change
 
+namespace hlsl {
+class DxilCompileStats; // HLSL Change
+class DxilIncrementalLib; // HLSL Change
+}
+
 namespace clang {
 
 /// \brief Bitfields of CodeGenOptions, split out from CodeGenOptions to ensure
@@ -179,6 +184,12 @@ public:
   std::string HLSLProfile;
   /// Whether to target high-level DXIL.
   bool HLSLHighLevel = false;
+  /// Whether to stop an optimized compile before DXIL generation, leaving
+  /// the high-level module for a second stage.
+  bool HLSLStopBeforeDxilGeneration = false;
+  /// Whether the input is a module from the first stage, to be resumed at
+  /// DXIL generation.
+  bool HLSLStartAtDxilGeneration = false;
   /// Whether we allow preserve intermediate values
   bool HLSLAllowPreserveValues = false;
   /// Whether we fail compilation if loop fails to unroll
@@ -209,6 +220,8 @@ public:
   std::vector<std::string> HLSLDefines;
   /// Precise output passed in from command line
   std::vector<std::string> HLSLPreciseOutputs;
+  /// Input semantics of the next pipeline stage passed in from command line
+  std::vector<std::string> HLSLDownstreamInputs;
   /// Arguments passed in from command line
   std::vector<std::string> HLSLArguments;
   /// Helper for generating llvm bitcode for hlsl extensions.
@@ -223,6 +236,9 @@ public:
   std::vector<std::string> HLSLLibraryExports;
   /// ExportShadersOnly limits library export functions to shaders
   bool ExportShadersOnly = false;
+  /// Library helpers with more instructions than this, called from more than
+  /// one place, are kept as functions rather than inlined. 0 == inline all.
+  unsigned HLSLLibInlineThreshold = 0;
   /// DefaultLinkage Internal, External, or Default.  If Default, default
   /// function linkage is determined by library target.
   hlsl::DXIL::DefaultLinkage DefaultLinkage = hlsl::DXIL::DefaultLinkage::Default;
@@ -230,6 +246,17 @@ public:
   bool HLSLResMayAlias = false;
   /// Lookback scan limit for memory dependencies
   unsigned ScanLimit = 0;
+  /// Number of threads the function optimization passes may use.
+  unsigned HLSLParallelFunctionThreads = 1;
+  /// Instructions full unrolling of an [unroll] loop may add before it is
+  /// only unrolled partially, where legal. 0 means no limit.
+  unsigned HLSLUnrollBudget = 0;
+  /// Fingerprints library functions and drops the ones that can be reused
+  /// from a previous build; null when not compiling incrementally.
+  std::shared_ptr<hlsl::DxilIncrementalLib> HLSLIncrementalLib;
+  /// Records the size of the module at each stage of the backend; null
+  /// unless compile statistics were requested.
+  std::shared_ptr<hlsl::DxilCompileStats> HLSLCompileStats;
   // Optimization pass enables, disables and selects
   std::map<std::string, bool> HLSLOptimizationToggles;
   std::map<std::string, std::string> HLSLOptimizationSelects;
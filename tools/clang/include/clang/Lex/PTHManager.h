@@ -131,6 +131,13 @@ public:
   ///  is the name of the PTH file.  This method returns NULL upon failure.
   static PTHManager *Create(StringRef file, DiagnosticsEngine &Diags);
 
+  // HLSL Change Starts - allow in-memory token caches
+  /// Create - As above, but reads the PTH data from an already loaded buffer.
+  ///  The 'file' argument is only used for diagnostics.
+  static PTHManager *Create(std::unique_ptr<llvm::MemoryBuffer> File,
+                            StringRef file, DiagnosticsEngine &Diags);
+  // HLSL Change Ends
+
   void setPreprocessor(Preprocessor *pp) { PP = pp; }
 
   /// CreateLexer - Return a PTHLexer that "lexes" the cached tokens for the
@@ -15,22 +15,12 @@
 #include "clang/SPIRV/SpirvInstruction.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
-#include "llvm/ADT/ilist.h"
-#include "llvm/ADT/ilist_node.h"
 
 namespace clang {
 namespace spirv {
 
 class SpirvVisitor;
 
-class SpirvInstructionNode : public llvm::ilist_node<SpirvInstructionNode> {
-public:
-  SpirvInstructionNode() : instruction(nullptr) {}
-  SpirvInstructionNode(SpirvInstruction *instr) : instruction(instr) {}
-
-  SpirvInstruction *instruction;
-};
-
 /// The class representing a SPIR-V basic block in memory.
 class SpirvBasicBlock {
 public:
@@ -93,7 +83,7 @@ public:
   /// Adds the given instruction as the first instruction of this SPIR-V basic
   /// block.
   void addFirstInstruction(SpirvInstruction *inst) {
-    instructions.push_front(inst);
+    instructions.insert(instructions.begin(), inst);
   }
 
   /// Return true if instructions is empty. Otherwise, return false.
@@ -119,8 +109,11 @@ private:
   uint32_t labelId;      ///< The label's <result-id>
   std::string labelName; ///< The label's debug name
 
-  /// Instructions belonging to this basic block.
-  llvm::ilist<SpirvInstructionNode> instructions;
+  /// Instructions belonging to this basic block. The instructions themselves
+  /// live in the SpirvContext's allocator; only the pointers are stored here so
+  /// that a block costs one growing allocation rather than one list node per
+  /// instruction.
+  std::vector<SpirvInstruction *> instructions;
 
   /// Successors to this basic block.
   llvm::SmallVector<SpirvBasicBlock *, 2> successors;
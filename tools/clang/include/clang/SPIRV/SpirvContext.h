@@ -10,6 +10,8 @@
 #define LLVM_CLANG_SPIRV_SPIRVCONTEXT_H
 
 #include <array>
+#include <map>
+#include <vector>
 
 #include "dxc/DXIL/DxilShaderModel.h"
 #include "clang/AST/DeclTemplate.h"
@@ -385,6 +387,46 @@ public:
            instructionsWithLoweredType.end();
   }
 
+  /// Unique constants. The lookup functions return the constant registered
+  /// earlier for the same AST type and value, or nullptr. Only
+  /// non-specialization constants of non-literal type may be registered:
+  /// literal constants get their AST type rewritten in place once it is
+  /// deduced.
+  SpirvConstantBoolean *lookupConstantBool(bool value) const {
+    return boolConstants[value];
+  }
+  SpirvConstantInteger *lookupConstantInt(QualType type,
+                                          const llvm::APInt &value) const;
+  SpirvConstantFloat *lookupConstantFloat(QualType type,
+                                          const llvm::APFloat &value) const;
+  SpirvConstantComposite *
+  lookupConstantComposite(QualType type,
+                          llvm::ArrayRef<SpirvConstant *> constituents) const;
+  SpirvConstantNull *lookupConstantNull(QualType type) const;
+  void registerUniqueConstant(SpirvConstant *constant);
+  /// Returns whether constant was registered as a unique constant.
+  bool isUniqueConstant(const SpirvConstant *constant) const {
+    return uniqueConstants.count(constant) != 0;
+  }
+
+  /// Layout of an aggregate type as computed by AlignmentSizeCalculator.
+  /// hasStride tells whether the computation wrote an array/matrix stride.
+  struct TypeLayout {
+    uint32_t alignment;
+    uint32_t size;
+    uint32_t stride;
+    bool hasStride;
+  };
+  /// Memoized type layouts, keyed by AST type, layout rule and the majorness
+  /// requested by the caller. Layouts only depend on these and the codegen
+  /// options, so they are shared across the whole compile. The returned
+  /// pointer is only valid until the next layout is registered.
+  const TypeLayout *lookupTypeLayout(QualType type, SpirvLayoutRule rule,
+                                     llvm::Optional<bool> isRowMajor) const;
+  void registerTypeLayout(QualType type, SpirvLayoutRule rule,
+                          llvm::Optional<bool> isRowMajor,
+                          const TypeLayout &layout);
+
 private:
   /// \brief The allocator used to create SPIR-V entity objects.
   ///
@@ -477,6 +519,22 @@ private:
 
   // Set of instructions that already have lowered SPIR-V types.
   llvm::DenseSet<const SpirvInstruction *> instructionsWithLoweredType;
+
+  // Unique constants, keyed by AST type and value. Scalar values are keyed
+  // by their bit width and bits.
+  using ScalarConstantKey = std::pair<void *, std::pair<unsigned, uint64_t>>;
+  std::array<SpirvConstantBoolean *, 2> boolConstants;
+  llvm::DenseMap<ScalarConstantKey, SpirvConstantInteger *> intConstants;
+  llvm::DenseMap<ScalarConstantKey, SpirvConstantFloat *> floatConstants;
+  std::map<std::pair<void *, std::vector<SpirvConstant *>>,
+           SpirvConstantComposite *>
+      compositeConstants;
+  llvm::DenseMap<void *, SpirvConstantNull *> nullConstants;
+  llvm::DenseSet<const SpirvConstant *> uniqueConstants;
+
+  // Memoized layouts of aggregate types. The key packs the layout rule and
+  // the requested majorness (none, column or row) next to the AST type.
+  llvm::DenseMap<std::pair<void *, unsigned>, TypeLayout> typeLayouts;
 };
 
 } // end namespace spirv
@@ -47,6 +47,11 @@ bool CheckTemplateArgumentListForHLSL(
   clang::TemplateDecl*, 
   clang::SourceLocation, 
   clang::TemplateArgumentListInfo&);
+
+clang::QualType LookupVectorOrMatrixCanonType(
+  clang::Sema& self,
+  clang::ClassTemplateDecl* Template,
+  llvm::ArrayRef<clang::TemplateArgument> Converted);
   
 clang::QualType CheckUnaryOpForHLSL(
   clang::Sema& self,
@@ -41,6 +41,8 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/SymbolRewriter.h"
 #include <memory>
+#include "dxc/HLSL/DxilCompileStats.h" // HLSL Change
+#include "dxc/HLSL/DxilFunctionFingerprint.h" // HLSL Change
 #include "dxc/HLSL/DxilGenerationPass.h" // HLSL Change
 #include "dxc/HLSL/HLMatrixLowerPass.h"  // HLSL Change
 
@@ -327,11 +329,19 @@ void EmitAssemblyHelper::CreatePasses() {
 
   // HLSL Change - begin
   PMBuilder.HLSLHighLevel = CodeGenOpts.HLSLHighLevel;
+  PMBuilder.HLSLStopBeforeDxilGen = CodeGenOpts.HLSLStopBeforeDxilGeneration;
+  PMBuilder.HLSLStartAtDxilGen = CodeGenOpts.HLSLStartAtDxilGeneration;
   PMBuilder.HLSLAllowPreserveValues = CodeGenOpts.HLSLAllowPreserveValues;
   PMBuilder.HLSLOnlyWarnOnUnrollFail = CodeGenOpts.HLSLOnlyWarnOnUnrollFail;
   PMBuilder.HLSLExtensionsCodeGen = CodeGenOpts.HLSLExtensionsCodegen.get();
+  PMBuilder.HLSLCompileStats = CodeGenOpts.HLSLCompileStats.get();
   PMBuilder.HLSLResMayAlias = CodeGenOpts.HLSLResMayAlias;
   PMBuilder.ScanLimit = CodeGenOpts.ScanLimit;
+  PMBuilder.HLSLUnrollBudget = CodeGenOpts.HLSLUnrollBudget;
+  // Printing after every pass needs the function passes on the module.
+  if (!CodeGenOpts.HLSLPrintAfterAll)
+    PMBuilder.HLSLParallelFunctionThreads =
+        CodeGenOpts.HLSLParallelFunctionThreads;
 
   PMBuilder.EnableGVN = !CodeGenOpts.HLSLOptimizationToggles.count("gvn") ||
                         CodeGenOpts.HLSLOptimizationToggles.find("gvn")->second;
@@ -344,6 +354,31 @@ void EmitAssemblyHelper::CreatePasses() {
                         !CodeGenOpts.HLSLOptimizationToggles.count("debug-nops") ||
                         CodeGenOpts.HLSLOptimizationToggles.find("debug-nops")->second;
 
+  // Opt-in: pairing 16-bit operations only helps drivers that pack them.
+  PMBuilder.HLSLPair16BitOps =
+                        CodeGenOpts.HLSLOptimizationToggles.count("pair-16bit-ops") &&
+                        CodeGenOpts.HLSLOptimizationToggles.find("pair-16bit-ops")->second;
+  PMBuilder.HLSLGroupSharedLayout =
+                        CodeGenOpts.HLSLOptimizationToggles.count("groupshared-layout") &&
+                        CodeGenOpts.HLSLOptimizationToggles.find("groupshared-layout")->second;
+  PMBuilder.HLSLClusterSamples =
+                        CodeGenOpts.HLSLOptimizationToggles.count("cluster-samples") &&
+                        CodeGenOpts.HLSLOptimizationToggles.find("cluster-samples")->second;
+  PMBuilder.HLSLMatrixLayout =
+                        CodeGenOpts.HLSLOptimizationToggles.count("matrix-layout") &&
+                        CodeGenOpts.HLSLOptimizationToggles.find("matrix-layout")->second;
+  PMBuilder.HLSLFastTrig =
+                        CodeGenOpts.HLSLOptimizationToggles.count("fast-trig") &&
+                        CodeGenOpts.HLSLOptimizationToggles.find("fast-trig")->second;
+  // Opt-in: keeping large arrays in memory trades register pressure for
+  // indexed loads and stores.
+  PMBuilder.HLSLIndexableArrays =
+                        CodeGenOpts.HLSLOptimizationToggles.count("indexable-arrays") &&
+                        CodeGenOpts.HLSLOptimizationToggles.find("indexable-arrays")->second;
+  PMBuilder.HLSLMatrixDotProducts =
+                        CodeGenOpts.HLSLOptimizationToggles.count("matrix-dot-products") &&
+                        CodeGenOpts.HLSLOptimizationToggles.find("matrix-dot-products")->second;
+
   PMBuilder.HLSLEnableLifetimeMarkers = CodeGenOpts.HLSLEnableLifetimeMarkers;
   // HLSL Change - end
 
@@ -667,6 +702,7 @@ bool EmitAssemblyHelper::AddEmitPasses(BackendAction Action,
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       raw_pwrite_stream *OS) {
   TimeRegion Region(llvm::TimePassesIsEnabled ? &CodeGenerationTime : nullptr);
+  PhaseTimingRegion OptimizePhase("Optimization"); // HLSL Change
 
   bool UsesCodeGen = (Action != Backend_EmitNothing &&
                       Action != Backend_EmitBC &&
@@ -725,6 +761,16 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
   }
   // HLSL Change Ends
 
+  // HLSL Change Starts
+  if (CodeGenOpts.HLSLCompileStats)
+    CodeGenOpts.HLSLCompileStats->Record("after_codegen", *TheModule);
+
+  // Fingerprint the unoptimized functions, and drop the reused ones before
+  // spending time optimizing them.
+  if (CodeGenOpts.HLSLIncrementalLib && TheModule->HasHLModule())
+    CodeGenOpts.HLSLIncrementalLib->Run(TheModule->GetHLModule());
+  // HLSL Change Ends
+
   // Run passes. For now we do all passes at once, but eventually we
   // would like to have the option of streaming code generation.
 
@@ -743,6 +789,11 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
     PerModulePasses->run(*TheModule);
   }
 
+  // HLSL Change Starts
+  if (CodeGenOpts.HLSLCompileStats)
+    CodeGenOpts.HLSLCompileStats->Record("after_optimization", *TheModule);
+  // HLSL Change Ends
+
   if (CodeGenPasses) {
     PrettyStackTraceString CrashInfo("Code generation");
     CodeGenPasses->run(*TheModule);
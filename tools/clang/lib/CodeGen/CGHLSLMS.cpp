@@ -136,6 +136,10 @@ private:
   std::unordered_map<GlobalVariable *, std::vector<Constant *>>
       staticConstGlobalInitListMap;
   std::unordered_map<GlobalVariable *, Function *> staticConstGlobalCtorMap;
+  // Map from constant InitListExpr to its emitted value, or null when it is
+  // not constant.
+  llvm::DenseMap<InitListExpr *, Constant *> constInitListMap;
+  Constant *EmitHLSLConstInitListExprImpl(CodeGenModule &CGM, InitListExpr *E);
   // List for functions with clip plane.
   std::vector<Function *> clipPlaneFuncList;
   std::unordered_map<Value *, DebugLoc> debugInfoMap;
@@ -218,6 +222,9 @@ private:
   std::unordered_map<Constant*, DxilFieldAnnotation> m_ConstVarAnnotationMap;
   StringSet<> m_PreciseOutputSet;
 
+  // [[vk::constant_id]] globals with their id and default value.
+  MapVector<GlobalVariable *, std::pair<unsigned, Constant *>> m_SpecConstants;
+
   DenseMap<Function*, ScopeInfo> m_ScopeMap;
   ScopeInfo *GetScopeInfo(Function *F);
 public:
@@ -393,6 +400,9 @@ CGMSHLSLRuntime::CGMSHLSLRuntime(CodeGenModule &CGM)
 
   m_pHLModule->SetAutoBindingSpace(CGM.getCodeGenOpts().HLSLDefaultSpace);
 
+  if (!CGM.getCodeGenOpts().HLSLDownstreamInputs.empty())
+    m_pHLModule->SetDownstreamInputs(CGM.getCodeGenOpts().HLSLDownstreamInputs);
+
   m_pHLModule->SetValidatorVersion(CGM.getCodeGenOpts().HLSLValidatorMajorVer, CGM.getCodeGenOpts().HLSLValidatorMinorVer);
 
   m_bDebugInfo = CGM.getCodeGenOpts().getDebugInfo() == CodeGenOptions::FullDebugInfo;
@@ -2649,6 +2659,20 @@ void CGMSHLSLRuntime::addResource(Decl *D) {
       return;
     }
 
+    // Specialization constants are placeholders rather than $Globals members.
+    if (const VKConstantIdAttr *A = D->getAttr<VKConstantIdAttr>()) {
+      GlobalVariable *GV = cast<GlobalVariable>(CGM.GetAddrOfGlobalVar(VD));
+      llvm::Type *Ty = GV->getType()->getElementType();
+      Constant *Default = VD->hasInit() ? CGM.EmitConstantInit(*VD) : nullptr;
+      if (Default && Default->getType() != Ty && Ty->isIntegerTy() &&
+          Default->getType()->isIntegerTy())
+        Default = ConstantExpr::getIntegerCast(Default, Ty, /*isSigned*/ false);
+      if (!Default || Default->getType() != Ty)
+        Default = Constant::getNullValue(Ty);
+      m_SpecConstants[GV] = std::make_pair((unsigned)A->getSpecConstId(), Default);
+      return;
+    }
+
     switch (resClass) {
     case hlsl::DxilResourceBase::Class::Sampler:
       AddSampler(VD);
@@ -3435,6 +3459,10 @@ void CGMSHLSLRuntime::AddConstant(VarDecl *constDecl, HLCBuffer &CB) {
   }
   bool bDefaultRowMajor = m_pHLModule->GetHLOptions().bDefaultRowMajor;
   ConstructFieldAttributedAnnotation(fieldAnnotation, Ty, bDefaultRowMajor);
+  // Lets -opt-enable matrix-layout pick the orientation of this constant.
+  if (fieldAnnotation.HasMatrixAnnotation() &&
+      !hlsl::HasHLSLMatOrientation(Ty))
+    fieldAnnotation.SetDefaultMatrixOrientation();
   m_ConstVarAnnotationMap[constVal] = fieldAnnotation;
 }
 
@@ -3545,6 +3573,9 @@ void CGMSHLSLRuntime::FinishCodeGen() {
   // Do this before CloneShaderEntry and TranslateRayQueryConstructor to avoid
   // update valToResPropertiesMap for cloned inst.
   FinishIntrinsics(HLM, m_IntrinsicMap, objectProperties);
+
+  if (!m_SpecConstants.empty())
+    LowerSpecConstants(M, CGM, m_SpecConstants);
   bool bWaveEnabledStage = m_pHLModule->GetShaderModel()->IsPS() ||
                            m_pHLModule->GetShaderModel()->IsCS() ||
                            m_pHLModule->GetShaderModel()->IsLib();
@@ -3627,6 +3658,9 @@ void CGMSHLSLRuntime::FinishCodeGen() {
   // Add dx.break function and make appropriate breaks conditional on it.
   AddDxBreak(M, m_DxBreaks);
 
+  // Fail fast on resource uses that are illegal whatever the optimizer does.
+  CheckResourceArrayIndices(HLM, CGM);
+
   // At this point, we have a high-level DXIL module - record this.
   SetPauseResumePasses(*m_pHLModule->GetModule(), "hlsl-hlemit",
                        "hlsl-hlensure");
@@ -4615,8 +4649,219 @@ static Constant *BuildConstInitializer(CodeGenTypes &Types, bool bDefaultRowMajo
   }
 }
 
+static const llvm::fltSemantics *GetIEEESemantics(llvm::Type *Ty) {
+  if (Ty->isHalfTy())
+    return &llvm::APFloat::IEEEhalf;
+  if (Ty->isFloatTy())
+    return &llvm::APFloat::IEEEsingle;
+  if (Ty->isDoubleTy())
+    return &llvm::APFloat::IEEEdouble;
+  return nullptr;
+}
+
+// Converts a constant scalar to the bits of DstTy, folding the cast
+// ConvertScalarOrVector would emit without creating a Constant for it.
+// Returns false where the folded cast is undefined.
+static bool ConvertConstScalarBits(const APValue &Val, bool SrcUnsigned,
+                                   llvm::Type *DstTy, bool DstUnsigned,
+                                   uint64_t &Bits) {
+  if (DstTy->isIntegerTy()) {
+    unsigned Width = DstTy->getIntegerBitWidth();
+    if (Val.isInt()) {
+      const llvm::APInt &Int = Val.getInt();
+      Bits = (SrcUnsigned ? Int.zextOrTrunc(Width) : Int.sextOrTrunc(Width))
+                 .getZExtValue();
+      return true;
+    }
+    llvm::APSInt Int(Width, DstUnsigned);
+    bool IsExact;
+    if (Val.getFloat().convertToInteger(Int, llvm::APFloat::rmTowardZero,
+                                        &IsExact) ==
+        llvm::APFloat::opInvalidOp)
+      return false;
+    Bits = Int.getZExtValue();
+    return true;
+  }
+
+  const llvm::fltSemantics &Sem = *GetIEEESemantics(DstTy);
+  llvm::APFloat Float(Sem);
+  if (Val.isInt()) {
+    Float.convertFromAPInt(Val.getInt(), !SrcUnsigned,
+                           llvm::APFloat::rmNearestTiesToEven);
+  } else {
+    bool LosesInfo;
+    Float = Val.getFloat();
+    Float.convert(Sem, llvm::APFloat::rmNearestTiesToEven, &LosesInfo);
+  }
+  Bits = Float.bitcastToAPInt().getZExtValue();
+  return true;
+}
+
+// Evaluates the scalar leaves of a numeric table initializer straight to the
+// bits of the table element type.
+static bool ScanConstTableInitList(CodeGenModule &CGM, InitListExpr *InitList,
+                                   llvm::Type *DstTy, bool DstUnsigned,
+                                   SmallVectorImpl<uint64_t> &Bits) {
+  ASTContext &Ctx = CGM.getContext();
+  unsigned NumInitElements = InitList->getNumInits();
+  for (unsigned i = 0; i != NumInitElements; ++i) {
+    Expr *InitExpr = InitList->getInit(i);
+    if (InitListExpr *SubInitList = dyn_cast<InitListExpr>(InitExpr)) {
+      if (!ScanConstTableInitList(CGM, SubInitList, DstTy, DstUnsigned, Bits))
+        return false;
+      continue;
+    }
+
+    // Variables and aggregates are flattened by ScanConstInitList.
+    QualType InitQualTy = InitExpr->getType();
+    if (isa<DeclRefExpr>(InitExpr) || !InitQualTy->isBuiltinType())
+      return false;
+
+    Expr::EvalResult Result;
+    if (!InitExpr->EvaluateAsRValue(Result, Ctx) || Result.HasSideEffects)
+      return false;
+
+    // Only take values EmitConstantExpr would emit as the type itself.
+    llvm::Type *SrcTy = CGM.getTypes().ConvertType(InitQualTy);
+    const APValue &Val = Result.Val;
+    if (Val.isInt()) {
+      if (!SrcTy->isIntegerTy(Val.getInt().getBitWidth()))
+        return false;
+    } else if (Val.isFloat()) {
+      const llvm::fltSemantics &Sem = Val.getFloat().getSemantics();
+      if (GetIEEESemantics(SrcTy) != &Sem)
+        return false;
+      if (&Sem == &llvm::APFloat::IEEEhalf &&
+          !Ctx.getLangOpts().NativeHalfType &&
+          !Ctx.getLangOpts().HalfArgsAndReturns)
+        return false;
+    } else {
+      return false;
+    }
+
+    uint64_t EltBits;
+    if (!ConvertConstScalarBits(Val, hlsl::IsHLSLUnsigned(InitQualTy), DstTy,
+                                DstUnsigned, EltBits))
+      return false;
+    Bits.emplace_back(EltBits);
+  }
+  return true;
+}
+
+template <typename T>
+static Constant *GetConstDataSequential(llvm::LLVMContext &Context,
+                                        bool IsVector, bool IsFP,
+                                        ArrayRef<uint64_t> Bits) {
+  SmallVector<T, 16> Elts(Bits.begin(), Bits.end());
+  if (IsVector)
+    return IsFP ? llvm::ConstantDataVector::getFP(Context, Elts)
+                : llvm::ConstantDataVector::get(Context, Elts);
+  return IsFP ? llvm::ConstantDataArray::getFP(Context, Elts)
+              : llvm::ConstantDataArray::get(Context, Elts);
+}
+
+static Constant *GetConstDataSequential(llvm::Type *EltTy, bool IsVector,
+                                        ArrayRef<uint64_t> Bits) {
+  llvm::LLVMContext &Context = EltTy->getContext();
+  bool IsFP = EltTy->isFloatingPointTy();
+  switch (EltTy->getPrimitiveSizeInBits()) {
+  case 16:
+    return GetConstDataSequential<uint16_t>(Context, IsVector, IsFP, Bits);
+  case 32:
+    return GetConstDataSequential<uint32_t>(Context, IsVector, IsFP, Bits);
+  default:
+    return GetConstDataSequential<uint64_t>(Context, IsVector, IsFP, Bits);
+  }
+}
+
+// Rebuilds the array levels of a numeric table over its flat element bits.
+static Constant *BuildConstTable(llvm::Type *Ty, llvm::Type *EltTy,
+                                 ArrayRef<uint64_t> Bits, unsigned &BitsIdx) {
+  llvm::SequentialType *SeqTy = dyn_cast<llvm::SequentialType>(Ty);
+  if (!SeqTy || SeqTy->isPointerTy())
+    return nullptr;
+  unsigned Size = isa<llvm::VectorType>(Ty) ? Ty->getVectorNumElements()
+                                            : Ty->getArrayNumElements();
+  if (SeqTy->getElementType() == EltTy) {
+    BitsIdx += Size;
+    return GetConstDataSequential(EltTy, isa<llvm::VectorType>(Ty),
+                                  Bits.slice(BitsIdx - Size, Size));
+  }
+  if (!Ty->isArrayTy())
+    return nullptr;
+  SmallVector<Constant *, 16> Elts;
+  Elts.reserve(Size);
+  for (unsigned i = 0; i < Size; i++) {
+    Constant *Elt =
+        BuildConstTable(SeqTy->getElementType(), EltTy, Bits, BitsIdx);
+    if (!Elt)
+      return nullptr;
+    Elts.emplace_back(Elt);
+  }
+  return llvm::ConstantArray::get(cast<llvm::ArrayType>(Ty), Elts);
+}
+
+// Emits arrays of numeric scalars or vectors, such as lookup tables, as
+// constant data directly from the values of their initializers. This skips
+// the per-element constants and casts of ScanConstInitList and
+// BuildConstInitializer, which dominate for large tables. Returns null for
+// any initializer it does not handle, to take the general path.
+static Constant *TryEmitConstTable(CodeGenModule &CGM, InitListExpr *E) {
+  CodeGenTypes &Types = CGM.getTypes();
+  QualType EltQualTy = E->getType();
+  uint64_t NumElts = 1;
+  bool IsArray = false;
+  while (const clang::ConstantArrayType *ArrayTy =
+             CGM.getContext().getAsConstantArrayType(EltQualTy)) {
+    NumElts *= ArrayTy->getSize().getLimitedValue();
+    EltQualTy = ArrayTy->getElementType();
+    IsArray = true;
+  }
+  if (!IsArray)
+    return nullptr;
+  if (hlsl::IsHLSLVecType(EltQualTy)) {
+    NumElts *= hlsl::GetHLSLVecSize(EltQualTy);
+    EltQualTy = hlsl::GetHLSLVecElementType(EltQualTy);
+  }
+  // Bools live in memory as i32 but convert through i1, leave them out.
+  if (!EltQualTy->isBuiltinType() || EltQualTy->isBooleanType())
+    return nullptr;
+  llvm::Type *EltTy = Types.ConvertType(EltQualTy);
+  if (!EltTy->isIntegerTy(16) && !EltTy->isIntegerTy(32) &&
+      !EltTy->isIntegerTy(64) && !GetIEEESemantics(EltTy))
+    return nullptr;
+  // Storage-only halves are integers in IR.
+  if (EltQualTy->isRealFloatingType() != EltTy->isFloatingPointTy())
+    return nullptr;
+
+  SmallVector<uint64_t, 64> Bits;
+  Bits.reserve(NumElts);
+  if (!ScanConstTableInitList(CGM, E, EltTy, hlsl::IsHLSLUnsigned(EltQualTy),
+                              Bits) ||
+      Bits.size() != NumElts)
+    return nullptr;
+
+  llvm::Type *Ty = Types.ConvertTypeForMem(E->getType());
+  unsigned BitsIdx = 0;
+  return BuildConstTable(Ty, EltTy, Bits, BitsIdx);
+}
+
 Constant *CGMSHLSLRuntime::EmitHLSLConstInitListExpr(CodeGenModule &CGM,
                                                      InitListExpr *E) {
+  // Initializers of constant variables are emitted both to check that they
+  // are constant and to emit them.
+  auto CacheIt = constInitListMap.find(E);
+  if (CacheIt != constInitListMap.end())
+    return CacheIt->second;
+  Constant *Result = TryEmitConstTable(CGM, E);
+  if (!Result)
+    Result = EmitHLSLConstInitListExprImpl(CGM, E);
+  constInitListMap[E] = Result;
+  return Result;
+}
+
+Constant *CGMSHLSLRuntime::EmitHLSLConstInitListExprImpl(CodeGenModule &CGM,
+                                                         InitListExpr *E) {
   bool bDefaultRowMajor = m_pHLModule->GetHLOptions().bDefaultRowMajor;
   SmallVector<Constant *, 4> EltVals;
   SmallVector<QualType, 4> EltQualTys;
@@ -9,8 +9,10 @@
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/DxilConstantFolding.h"
 #include "llvm/Analysis/DxilValueCache.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Function.h"
@@ -19,6 +21,7 @@
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -656,6 +659,10 @@ void AddOpcodeParamForIntrinsic(
   paramTyList.emplace_back(opcodeTy);
 
   bool bRetHandle = false;
+  // Indices in the new call of the arguments that are resource pointers.
+  // Calls pass exactly the parameter types, so these are found once here
+  // rather than by checking the type name of every argument of every call.
+  SmallVector<unsigned, 4> resArgIdxList;
   for (unsigned i = 0; i < oldFuncTy->getNumParams(); i++) {
     llvm::Type *Ty = oldFuncTy->getParamType(i);
     if (Ty->isPointerTy()) {
@@ -666,6 +673,7 @@ void AddOpcodeParamForIntrinsic(
           bRetHandle = true;
           continue;
         }
+        resArgIdxList.emplace_back(paramTyList.size());
         // Use handle type for resource type.
         // This will make sure temp object variable only used by createHandle.
         Ty = HandleTy;
@@ -673,6 +681,7 @@ void AddOpcodeParamForIntrinsic(
     }
     paramTyList.emplace_back(Ty);
   }
+  unsigned numFixedArgs = paramTyList.size();
 
   HLOpcodeGroup group = hlsl::GetHLOpcodeGroup(F);
 
@@ -744,6 +753,14 @@ void AddOpcodeParamForIntrinsic(
     paramTyList[HLOperandIndex::kSubscriptObjectOpIdx] = HandleTy;
     // Change RetTy into pointer of resource reture type.
     RetTy = cast<StructType>(resTy)->getElementType(0)->getPointerTo();
+    // The object and index arguments are replaced for each call below.
+    resArgIdxList.erase(
+        std::remove_if(resArgIdxList.begin(), resArgIdxList.end(),
+                       [](unsigned i) {
+                         return i == HLOperandIndex::kSubscriptObjectOpIdx ||
+                                i == HLOperandIndex::kSubscriptIndexOpIdx;
+                       }),
+        resArgIdxList.end());
   }
 
   llvm::FunctionType *funcTy =
@@ -756,12 +773,14 @@ void AddOpcodeParamForIntrinsic(
 
   DxilTypeSystem &typeSys = HLM.GetTypeSystem();
 
+  Value *opcodeConst = ConstantInt::get(opcodeTy, opcode);
+  SmallVector<Value *, 8> opcodeParamList;
+  IRBuilder<> Builder(M.getContext());
   for (auto user = F->user_begin(); user != F->user_end();) {
     // User must be a call.
     CallInst *oldCI = cast<CallInst>(*(user++));
 
-    SmallVector<Value *, 4> opcodeParamList;
-    Value *opcodeConst = Constant::getIntegerValue(opcodeTy, APInt(32, opcode));
+    opcodeParamList.clear();
     opcodeParamList.emplace_back(opcodeConst);
     Value *retHandleArg = nullptr;
     if (!bRetHandle) {
@@ -773,7 +792,7 @@ void AddOpcodeParamForIntrinsic(
       opcodeParamList.append(it,
                              oldCI->arg_operands().end());
     }
-    IRBuilder<> Builder(oldCI);
+    Builder.SetInsertPoint(oldCI);
 
     if (isDoubleSubscriptFunc) {
       // Change obj to the resource pointer.
@@ -822,32 +841,36 @@ void AddOpcodeParamForIntrinsic(
       Builder.SetInsertPoint(secSub);
     }
 
-    for (unsigned i = 1; i < opcodeParamList.size(); i++) {
+    auto lowerResArg = [&](unsigned i) {
       Value *arg = opcodeParamList[i];
-      llvm::Type *Ty = arg->getType();
-      if (Ty->isPointerTy()) {
-        Ty = Ty->getPointerElementType();
-        if (dxilutil::IsHLSLResourceType(Ty)) {
-          DxilResourceProperties RP = GetResourcePropsFromIntrinsicObjectArg(
-              arg, HLM, typeSys, objectProperties);
-          // Use object type directly, not by pointer.
-          // This will make sure temp object variable only used by ld/st.
-          if (GEPOperator *argGEP = dyn_cast<GEPOperator>(arg)) {
-            std::vector<Value *> idxList(argGEP->idx_begin(),
-                                         argGEP->idx_end());
-            // Create instruction to avoid GEPOperator.
-            GetElementPtrInst *GEP = GetElementPtrInst::CreateInBounds(
-                argGEP->getPointerOperand(), idxList);
-            Builder.Insert(GEP);
-            arg = GEP;
-          }
+      DxilResourceProperties RP = GetResourcePropsFromIntrinsicObjectArg(
+          arg, HLM, typeSys, objectProperties);
+      // Use object type directly, not by pointer.
+      // This will make sure temp object variable only used by ld/st.
+      if (GEPOperator *argGEP = dyn_cast<GEPOperator>(arg)) {
+        std::vector<Value *> idxList(argGEP->idx_begin(), argGEP->idx_end());
+        // Create instruction to avoid GEPOperator.
+        GetElementPtrInst *GEP = GetElementPtrInst::CreateInBounds(
+            argGEP->getPointerOperand(), idxList);
+        Builder.Insert(GEP);
+        arg = GEP;
+      }
 
-          llvm::Type *ResTy = arg->getType()->getPointerElementType();
+      llvm::Type *ResTy = arg->getType()->getPointerElementType();
 
-          Value *Handle = CreateHandleFromResPtr(arg, HLM, HandleTy, Builder);
-          Handle = CreateAnnotateHandle(HLM, Handle, RP, ResTy, Builder);
-          opcodeParamList[i] = Handle;
-        }
+      Value *Handle = CreateHandleFromResPtr(arg, HLM, HandleTy, Builder);
+      Handle = CreateAnnotateHandle(HLM, Handle, RP, ResTy, Builder);
+      opcodeParamList[i] = Handle;
+    };
+    for (unsigned i : resArgIdxList)
+      lowerResArg(i);
+    // Variadic arguments have no parameter type to go by.
+    if (oldFuncTy->isVarArg()) {
+      for (unsigned i = numFixedArgs; i < opcodeParamList.size(); i++) {
+        llvm::Type *Ty = opcodeParamList[i]->getType();
+        if (Ty->isPointerTy() &&
+            dxilutil::IsHLSLResourceType(Ty->getPointerElementType()))
+          lowerResArg(i);
       }
     }
 
@@ -902,10 +925,9 @@ void AddOpcodeParamForIntrinsics(
 namespace {
 
 // Returns true a global value is being updated
-bool GlobalHasStoreUserRec(Value *V, std::set<Value *> &visited) {
+bool GlobalHasStoreUserRec(Value *V, SmallPtrSetImpl<Value *> &visited) {
   bool isWriteEnabled = false;
-  if (V && visited.find(V) == visited.end()) {
-    visited.insert(V);
+  if (V && visited.insert(V).second) {
     for (User *U : V->users()) {
       if (isa<StoreInst>(U)) {
         return true;
@@ -945,7 +967,7 @@ bool GlobalHasStoreUserRec(Value *V, std::set<Value *> &visited) {
 // otherwise recurse through the remaining users and check if any GEP
 // exists and which in turn has a store inst as user.
 bool GlobalHasStoreUser(GlobalVariable *GV) {
-  std::set<Value *> visited;
+  SmallPtrSet<Value *, 16> visited;
   Value *V = cast<Value>(GV);
   return GlobalHasStoreUserRec(V, visited);
 }
@@ -1670,6 +1692,37 @@ Value *EvalTernaryIntrinsic(CallInst *CI, FloatTernaryEvalFuncType floatEvalFunc
   return Result;
 }
 
+// Evaluate an intrinsic that lowers to the unary dxil operation opcode on
+// each element, with the same folding the dxil operation gets after
+// lowering. firstbithigh counts from the msb in dxil; bFirstbitHi converts
+// the result to the position from the lsb, as its lowering does.
+// Returns null and leaves CI as it is when an element doesn't fold.
+Value *EvalUnaryDxilOpIntrinsic(CallInst *CI, DXIL::OpCode opcode,
+                                bool bFirstbitHi = false) {
+  Constant *CV = cast<Constant>(CI->getArgOperand(0));
+  llvm::Type *Ty = CI->getType();
+  llvm::Type *EltTy = Ty->getScalarType();
+  unsigned NumElts = Ty->isVectorTy() ? Ty->getVectorNumElements() : 1;
+  SmallVector<Constant *, 4> Elts;
+  for (unsigned i = 0; i < NumElts; i++) {
+    Constant *Src = Ty->isVectorTy() ? CV->getAggregateElement(i) : CV;
+    Constant *Elt = hlsl::ConstantFoldDxilOp(opcode, EltTy, Src);
+    if (!Elt)
+      return nullptr;
+    if (bFirstbitHi) {
+      ConstantInt *Pos = cast<ConstantInt>(Elt);
+      if (!Pos->isAllOnesValue())
+        Elt = ConstantInt::get(EltTy, Src->getType()->getScalarSizeInBits() -
+                                          1 - Pos->getZExtValue());
+    }
+    Elts.emplace_back(Elt);
+  }
+  Value *Result = Ty->isVectorTy() ? ConstantVector::get(Elts) : Elts[0];
+  CI->replaceAllUsesWith(Result);
+  CI->eraseFromParent();
+  return Result;
+}
+
 void SimpleTransformForHLDXIRInst(Instruction *I, SmallInstSet &deadInsts) {
 
   unsigned opcode = I->getOpcode();
@@ -1905,6 +1958,22 @@ Value *TryEvalIntrinsic(CallInst *CI, IntrinsicOp intriOp,
     };
     return EvalTernaryIntrinsic(CI, clampF, clampD, clampI);
   } break;
+  case IntrinsicOp::IOP_countbits:
+    return EvalUnaryDxilOpIntrinsic(CI, DXIL::OpCode::Countbits);
+  case IntrinsicOp::IOP_reversebits:
+    return EvalUnaryDxilOpIntrinsic(CI, DXIL::OpCode::Bfrev);
+  case IntrinsicOp::IOP_firstbitlow:
+    return EvalUnaryDxilOpIntrinsic(CI, DXIL::OpCode::FirstbitLo);
+  case IntrinsicOp::IOP_firstbithigh:
+    return EvalUnaryDxilOpIntrinsic(CI, DXIL::OpCode::FirstbitSHi,
+                                    /*bFirstbitHi*/ true);
+  case IntrinsicOp::IOP_ufirstbithigh:
+    return EvalUnaryDxilOpIntrinsic(CI, DXIL::OpCode::FirstbitHi,
+                                    /*bFirstbitHi*/ true);
+  case IntrinsicOp::IOP_f16tof32:
+    return EvalUnaryDxilOpIntrinsic(CI, DXIL::OpCode::LegacyF16ToF32);
+  case IntrinsicOp::IOP_f32tof16:
+    return EvalUnaryDxilOpIntrinsic(CI, DXIL::OpCode::LegacyF32ToF16);
   default:
     return nullptr;
   }
@@ -3053,6 +3122,59 @@ void CheckResourceParameters(HLModule &HLM,
   }
 }
 
+// Whether a library helper is worth keeping out of line: inlining it would
+// replicate more than Threshold instructions into each of several callers.
+// Helpers passing HLSL objects must still be inlined to be legal.
+bool KeepLibHelperOutOfLine(HLModule &HLM, Function &f, unsigned Threshold) {
+  if (Threshold == 0 || f.isDeclaration() || HLM.HasDxilFunctionProps(&f) ||
+      HLM.IsPatchConstantShader(&f) ||
+      GetHLOpcodeGroup(&f) != HLOpcodeGroup::NotHL)
+    return false;
+  unsigned NumCalls = 0;
+  for (User *U : f.users())
+    if (isa<CallInst>(U))
+      NumCalls++;
+  if (NumCalls < 2)
+    return false;
+  if (dxilutil::ContainsHLSLObjectType(f.getReturnType()))
+    return false;
+  for (Argument &Arg : f.args())
+    if (dxilutil::ContainsHLSLObjectType(Arg.getType()))
+      return false;
+  unsigned NumInsts = 0;
+  for (BasicBlock &BB : f) {
+    NumInsts += BB.size();
+    if (NumInsts > Threshold)
+      return true;
+  }
+  return false;
+}
+
+// With an export map, a library only keeps what the exports reach. Drop
+// unreferenced helpers that were not exported now, so the HL pipeline
+// doesn't spend time optimizing code that is thrown away at the end.
+void RemoveUnexportedFunctions(HLModule &HLM) {
+  Module &M = *HLM.GetModule();
+  bool bChanged = true;
+  while (bChanged) {
+    bChanged = false;
+    for (auto it = M.begin(); it != M.end();) {
+      Function *F = &*(it++);
+      if (F->isDeclaration() || F->isIntrinsic() ||
+          GetHLOpcodeGroup(F) != HLOpcodeGroup::NotHL ||
+          !F->hasLocalLinkage() || HLM.HasDxilFunctionProps(F) ||
+          HLM.IsPatchConstantShader(F))
+        continue;
+      F->removeDeadConstantUsers();
+      if (!F->user_empty())
+        continue;
+      HLM.RemoveFunction(F);
+      F->eraseFromParent();
+      bChanged = true;
+    }
+  }
+}
+
 } // namespace
 
 namespace CGHLSLMSHelper {
@@ -3090,6 +3212,12 @@ void UpdateLinkage(HLModule &HLM, clang::CodeGen::CodeGenModule &CGM,
     // Skip no inline functions.
     if (f.hasFnAttribute(llvm::Attribute::NoInline))
       continue;
+    // Keep large helpers shared by several callers as library functions.
+    if (bIsLib && KeepLibHelperOutOfLine(
+                      HLM, f, CGM.getCodeGenOpts().HLSLLibInlineThreshold)) {
+      f.addFnAttr(llvm::Attribute::NoInline);
+      continue;
+    }
     // Always inline for used functions.
     if (!f.user_empty() && !f.isDeclaration())
       f.addFnAttr(llvm::Attribute::AlwaysInline);
@@ -3125,6 +3253,9 @@ void UpdateLinkage(HLModule &HLM, clang::CodeGen::CodeGenModule &CGM,
       PCFunc->setLinkage(GlobalValue::LinkageTypes::ExternalLinkage);
   }
 
+  if (bIsLib && !exportMap.empty())
+    RemoveUnexportedFunctions(HLM);
+
   // Disallow resource arguments in (non-entry) function exports
   // unless offline linking target.
   if (bIsLib &&
@@ -3251,6 +3382,54 @@ void AddDxBreak(Module &M,
   }
 }
 
+// Replace loads of specialization constants with calls to placeholders taking
+// the constant id and default value, which hlsl-dxil-specialize-constants
+// substitutes later.
+void LowerSpecConstants(
+    llvm::Module &M, clang::CodeGen::CodeGenModule &CGM,
+    llvm::MapVector<llvm::GlobalVariable *,
+                    std::pair<unsigned, llvm::Constant *>> &SpecConstants) {
+  LLVMContext &Ctx = M.getContext();
+  Type *I32Ty = Type::getInt32Ty(Ctx);
+  for (auto &It : SpecConstants) {
+    GlobalVariable *GV = It.first;
+    unsigned ID = It.second.first;
+    Constant *Default = It.second.second;
+    Type *Ty = GV->getType()->getElementType();
+
+    std::string FuncName = DXIL::kDxSpecConstantFuncPrefix;
+    if (Ty->isIntegerTy())
+      FuncName += "i" + std::to_string(Ty->getIntegerBitWidth());
+    else
+      FuncName += "f" + std::to_string(Ty->getPrimitiveSizeInBits());
+    FunctionType *FT = FunctionType::get(Ty, {I32Ty, Ty}, false);
+    Function *F = cast<Function>(M.getOrInsertFunction(FuncName, FT));
+    F->addFnAttr(Attribute::AttrKind::ReadNone);
+    F->addFnAttr(Attribute::AttrKind::NoUnwind);
+
+    Value *Args[] = {ConstantInt::get(I32Ty, ID), Default};
+    for (auto U = GV->user_begin(), E = GV->user_end(); U != E;) {
+      LoadInst *LI = dyn_cast<LoadInst>(*(U++));
+      if (!LI)
+        continue;
+      CallInst *CI = CallInst::Create(F, Args, LI->getName(), LI);
+      CI->setDebugLoc(LI->getDebugLoc());
+      LI->replaceAllUsesWith(CI);
+      LI->eraseFromParent();
+    }
+
+    if (!GV->use_empty()) {
+      clang::DiagnosticsEngine &Diags = CGM.getDiags();
+      unsigned DiagID = Diags.getCustomDiagID(
+          clang::DiagnosticsEngine::Error,
+          "specialization constant %0 can only be read");
+      Diags.Report(DiagID) << GV->getName();
+      continue;
+    }
+    GV->eraseFromParent();
+  }
+}
+
 } // namespace CGHLSLMSHelper
 
 namespace CGHLSLMSHelper {
@@ -3636,3 +3815,111 @@ hlsl::DxilResourceProperties DxilObjectProperties::GetResource(llvm::Value *V) {
 }
 
 } // namespace CGHLSLMSHelper
+
+namespace {
+// V as a constant integer, looking through loads of constant globals like
+// static const variables.
+ConstantInt *GetConstantIndex(Value *V) {
+  if (LoadInst *LI = dyn_cast<LoadInst>(V)) {
+    GlobalVariable *GV = dyn_cast<GlobalVariable>(LI->getPointerOperand());
+    if (!GV || !GV->isConstant() || !GV->hasInitializer())
+      return nullptr;
+    V = GV->getInitializer();
+  }
+  return dyn_cast<ConstantInt>(V);
+}
+
+// Collects the blocks of F reachable from its entry, following only the
+// successor taken by branches and switches on a constant.
+void CollectReachableBlocks(Function &F,
+                            SmallPtrSetImpl<BasicBlock *> &Reachable) {
+  SmallVector<BasicBlock *, 16> Worklist;
+  Worklist.emplace_back(&F.getEntryBlock());
+  Reachable.insert(&F.getEntryBlock());
+  while (!Worklist.empty()) {
+    BasicBlock *BB = Worklist.pop_back_val();
+    TerminatorInst *TI = BB->getTerminator();
+    BasicBlock *Taken = nullptr;
+    if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
+      if (BI->isConditional())
+        if (ConstantInt *C = GetConstantIndex(BI->getCondition()))
+          Taken = BI->getSuccessor(C->isZero() ? 1 : 0);
+    } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
+      if (ConstantInt *C = GetConstantIndex(SI->getCondition()))
+        Taken = SI->findCaseValue(C).getCaseSuccessor();
+    }
+    if (Taken) {
+      if (Reachable.insert(Taken).second)
+        Worklist.emplace_back(Taken);
+      continue;
+    }
+    for (BasicBlock *Succ : successors(BB))
+      if (Reachable.insert(Succ).second)
+        Worklist.emplace_back(Succ);
+  }
+}
+
+// Returns the first constant index of GEP past the end of an array of
+// resources, or null when there is none. Unbounded arrays have no end.
+ConstantInt *GetOutOfBoundsResourceIndex(GEPOperator *GEP) {
+  for (gep_type_iterator GTI = gep_type_begin(GEP), E = gep_type_end(GEP);
+       GTI != E; ++GTI) {
+    ArrayType *AT = dyn_cast<ArrayType>(*GTI);
+    if (!AT || AT->getNumElements() == 0)
+      continue;
+    ConstantInt *C = GetConstantIndex(GTI.getOperand());
+    if (!C || C->getValue().ult(AT->getNumElements()))
+      continue;
+    if (dxilutil::IsHLSLResourceType(dxilutil::GetArrayEltTy(AT)))
+      return C;
+  }
+  return nullptr;
+}
+
+void ReportResourceArrayIndex(clang::CodeGen::CodeGenModule &CGM,
+                              Instruction *I, ConstantInt *Index) {
+  clang::DiagnosticsEngine &Diags = CGM.getDiags();
+  unsigned DiagID = Diags.getCustomDiagID(
+      clang::DiagnosticsEngine::Error,
+      "Accessing resource array with out-of-bounds index %0 in %1%2.");
+  std::string Loc;
+  if (const DebugLoc &DL = I->getDebugLoc()) {
+    raw_string_ostream OS(Loc);
+    OS << " at line " << DL.getLine();
+  }
+  std::string Name;
+  raw_string_ostream OS(Name);
+  dxilutil::PrintEscapedString(
+      dxilutil::DemangleFunctionName(I->getParent()->getParent()->getName()),
+      OS);
+  Diags.Report(DiagID) << (int)Index->getSExtValue() << OS.str() << Loc;
+}
+} // namespace
+
+namespace CGHLSLMSHelper {
+void CheckResourceArrayIndices(HLModule &HLM,
+                               clang::CodeGen::CodeGenModule &CGM) {
+  SmallPtrSet<BasicBlock *, 32> Reachable;
+  for (Function &F : *HLM.GetModule()) {
+    // Functions nothing calls are removed before resources are legalized.
+    if (F.isDeclaration() || (F.hasInternalLinkage() && F.use_empty()))
+      continue;
+    Reachable.clear();
+    CollectReachableBlocks(F, Reachable);
+    for (BasicBlock &BB : F) {
+      if (!Reachable.count(&BB))
+        continue;
+      for (Instruction &I : BB) {
+        ConstantInt *Index = nullptr;
+        if (GEPOperator *GEP = dyn_cast<GEPOperator>(&I))
+          Index = GetOutOfBoundsResourceIndex(GEP);
+        for (unsigned i = 0; !Index && i < I.getNumOperands(); ++i)
+          if (GEPOperator *GEP = dyn_cast<GEPOperator>(I.getOperand(i)))
+            Index = GetOutOfBoundsResourceIndex(GEP);
+        if (Index)
+          ReportResourceArrayIndex(CGM, &I, Index);
+      }
+    }
+  }
+}
+} // namespace CGHLSLMSHelper
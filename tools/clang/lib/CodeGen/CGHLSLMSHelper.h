@@ -176,6 +176,11 @@ void FinishIntrinsics(
 
 void AddDxBreak(llvm::Module &M, const llvm::SmallVector<llvm::BranchInst*, 16> &DxBreaks);
 
+void LowerSpecConstants(
+    llvm::Module &M, clang::CodeGen::CodeGenModule &CGM,
+    llvm::MapVector<llvm::GlobalVariable *,
+                    std::pair<unsigned, llvm::Constant *>> &SpecConstants);
+
 void ReplaceConstStaticGlobals(
     std::unordered_map<llvm::GlobalVariable *, std::vector<llvm::Constant *>>
         &staticConstGlobalInitListMap,
@@ -221,5 +226,11 @@ void StructurizeMultiRet(llvm::Module &M,
 
 llvm::Value *TryEvalIntrinsic(llvm::CallInst *CI, hlsl::IntrinsicOp intriOp, unsigned hlslVersion);
 void SimpleTransformForHLDXIR(llvm::Module *pM);
+
+// Reports uses of resource arrays with a constant index past their end in
+// code reachable from the start of its function. Those are errors whatever
+// the optimizer does later, so they are reported before it runs.
+void CheckResourceArrayIndices(hlsl::HLModule &HLM,
+                               clang::CodeGen::CodeGenModule &CGM);
 void ExtensionCodeGen(hlsl::HLModule &HLM, clang::CodeGen::CodeGenModule &CGM);
 } // namespace CGHLSLMSHelper
@@ -11,25 +11,96 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
+#include "dxc/Support/Global.h"
 #include "dxc/Support/WinIncludes.h"    // stream support
 #include "dxc/dxcapi.h"                 // stream support
 #include "clang/Parse/ParseHLSL.h" // root sig would be in Parser if part of lang
 #include "dxc/dxcapi.h"
 
+#include <mutex>
+
 using namespace llvm;
 
+namespace {
+// Root signatures serialized by earlier compiles in the process, since the
+// shaders of a project are usually compiled with the same one. Entries are
+// keyed by the version, the flags and the text, and hold either the
+// serialized root signature or the message it was rejected with; text that
+// doesn't parse isn't kept, as the parser reports through the diagnostics.
+// The entries are allocated from the default allocator since they outlive
+// the compile that added them.
+class RootSignatureCache {
+public:
+  struct Entry {
+    bool Valid;
+    std::string Data; // serialized root signature, or error message
+  };
+
+  // Result is copied with the allocator of the caller.
+  bool Lookup(StringRef Key, Entry &Result) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Entries.find(Key);
+    if (it == m_Entries.end())
+      return false;
+    Result = it->second;
+    return true;
+  }
+
+  void Insert(StringRef Key, bool Valid, StringRef Data) {
+    DxcThreadMalloc TM(nullptr);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // Start over rather than track use when too many signatures show up.
+    if (m_Entries.size() >= kMaxEntries)
+      m_Entries.clear();
+    Entry &E = m_Entries[Key];
+    E.Valid = Valid;
+    E.Data = Data;
+  }
+
+private:
+  static const unsigned kMaxEntries = 256;
+  std::mutex m_Mutex;
+  StringMap<Entry> m_Entries;
+};
+
+ManagedStatic<RootSignatureCache> g_RootSignatureCache;
+
+RootSignatureCache &GetRootSignatureCache() {
+  // The cache is created on first use, which may be during a compile.
+  DxcThreadMalloc TM(nullptr);
+  return *g_RootSignatureCache;
+}
+} // namespace
+
 void clang::CompileRootSignature(
     StringRef rootSigStr, DiagnosticsEngine &Diags, SourceLocation SLoc,
     hlsl::DxilRootSignatureVersion rootSigVer,
     hlsl::DxilRootSignatureCompilationFlags flags,
     hlsl::RootSignatureHandle *pRootSigHandle) {
-  std::string OSStr;
-  llvm::raw_string_ostream OS(OSStr);
+  std::string Key;
+  llvm::raw_string_ostream KeyOS(Key);
+  KeyOS << (unsigned)rootSigVer << ',' << (unsigned)flags << ',' << rootSigStr;
+  KeyOS.flush();
+
+  RootSignatureCache &Cache = GetRootSignatureCache();
+  RootSignatureCache::Entry Cached;
+  if (Cache.Lookup(Key, Cached)) {
+    if (Cached.Valid)
+      pRootSigHandle->LoadSerialized((const uint8_t *)Cached.Data.data(),
+                                     Cached.Data.size());
+    else
+      ReportHLSLRootSigError(Diags, SLoc, Cached.Data.data(),
+                             Cached.Data.size());
+    return;
+  }
+
   hlsl::DxilVersionedRootSignatureDesc *D = nullptr;
 
   if (ParseHLSLRootSignature(rootSigStr.data(), rootSigStr.size(), rootSigVer,
@@ -39,10 +110,15 @@ void clang::CompileRootSignature(
     hlsl::SerializeRootSignature(D, &pSignature, &pErrors, false);
     if (pSignature == nullptr) {
       assert(pErrors != nullptr && "else serialize failed with no msg");
-      ReportHLSLRootSigError(Diags, SLoc, (char *)pErrors->GetBufferPointer(),
-                             pErrors->GetBufferSize());
+      StringRef Error((char *)pErrors->GetBufferPointer(),
+                      pErrors->GetBufferSize());
+      ReportHLSLRootSigError(Diags, SLoc, Error.data(), Error.size());
+      Cache.Insert(Key, false, Error);
       hlsl::DeleteRootSignature(D);
     } else {
+      Cache.Insert(Key, true,
+                   StringRef((char *)pSignature->GetBufferPointer(),
+                             pSignature->GetBufferSize()));
       pRootSigHandle->Assign(D, pSignature);
     }
   }
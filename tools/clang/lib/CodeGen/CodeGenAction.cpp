@@ -56,6 +56,11 @@ namespace clang {
 
     std::unique_ptr<llvm::Module> TheModule, LinkModule;
 
+    // HLSL Change - llvm::TimePassesIsEnabled is shared by every compile in
+    // the process, so it is left alone and only this consumer's timer follows
+    // the option.
+    bool TimePasses;
+
   public:
     BackendConsumer(BackendAction Action, DiagnosticsEngine &Diags,
                     const HeaderSearchOptions &HeaderSearchOpts,
@@ -71,8 +76,8 @@ namespace clang {
           Context(nullptr), LLVMIRGeneration("LLVM IR Generation Time"),
           Gen(CreateLLVMCodeGen(Diags, InFile, HeaderSearchOpts, PPOpts,
                                 CodeGenOpts, C, CoverageInfo)),
-          LinkModule(LinkModule) {
-      llvm::TimePassesIsEnabled = TimePasses;
+          LinkModule(LinkModule),
+          TimePasses(TimePasses) { // HLSL Change - don't set the global flag
     }
 
     // HLSL Change Starts - avoid double free
@@ -98,14 +103,15 @@ namespace clang {
         
       Context = &Ctx;
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.startTimer();
+      llvm::PhaseTimingRegion CodeGenPhase("CodeGen"); // HLSL Change
 
       Gen->Initialize(Ctx);
 
       TheModule.reset(Gen->GetModule());
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.stopTimer();
     }
 
@@ -114,12 +120,13 @@ namespace clang {
                                      Context->getSourceManager(),
                                      "LLVM IR generation of declaration");
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.startTimer();
+      llvm::PhaseTimingRegion CodeGenPhase("CodeGen"); // HLSL Change
 
       Gen->HandleTopLevelDecl(D);
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.stopTimer();
 
       return true;
@@ -129,24 +136,26 @@ namespace clang {
       PrettyStackTraceDecl CrashInfo(D, SourceLocation(),
                                      Context->getSourceManager(),
                                      "LLVM IR generation of inline method");
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.startTimer();
+      llvm::PhaseTimingRegion CodeGenPhase("CodeGen"); // HLSL Change
 
       Gen->HandleInlineMethodDefinition(D);
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.stopTimer();
     }
 
     void HandleTranslationUnit(ASTContext &C) override {
       {
         PrettyStackTraceString CrashInfo("Per-file LLVM IR generation");
-        if (llvm::TimePassesIsEnabled)
+        if (TimePasses) // HLSL Change
           LLVMIRGeneration.startTimer();
+        llvm::PhaseTimingRegion CodeGenPhase("CodeGen"); // HLSL Change
 
         Gen->HandleTranslationUnit(C);
 
-        if (llvm::TimePassesIsEnabled)
+        if (TimePasses) // HLSL Change
           LLVMIRGeneration.stopTimer();
       }
 
@@ -53,6 +53,7 @@
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Timer.h" // HLSL Change
 #include "dxc/DXIL/DxilConstants.h"    // HLSL Change
 
 using namespace clang;
@@ -242,6 +243,7 @@ void CodeGenModule::createHLSLRuntime() {
 }
 
 void CodeGenModule::FinishCodeGen() {
+  llvm::PhaseTimingRegion FinishPhase("HLSL CodeGen Finalization");
   HLSLRuntime->FinishCodeGen();
 }
 // HLSL Change Ends
@@ -212,6 +212,7 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
     NumStoredDiagnosticsFromDriver(0),
     PreambleRebuildCounter(0),
     HlslLangExtensions(nullptr),    // HLSL Change
+    SkipIncludedFunctionBodies(false), // HLSL Change
     NumWarningsInPreamble(0),
     ShouldCacheCodeCompletionResults(false),
     IncludeBriefCommentsInCodeCompletion(false), UserFilesAreVolatile(false),
@@ -873,6 +874,15 @@ public:
     return true;
   }
 
+  // HLSL Change Starts
+  bool shouldSkipFunctionBody(Decl *D) override {
+    if (!Unit.SkipIncludedFunctionBodies)
+      return true;
+    SourceManager &SM = D->getASTContext().getSourceManager();
+    return !SM.isInMainFile(SM.getExpansionLoc(D->getLocation()));
+  }
+  // HLSL Change Ends
+
   // We're not interested in "interesting" decls.
   void HandleInterestingDecl(DeclGroupRef) override {}
 
@@ -1975,7 +1985,8 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
     bool AllowPCHWithCompilerErrors, bool SkipFunctionBodies,
     bool UserFilesAreVolatile, bool ForSerialization,
     std::unique_ptr<ASTUnit> *ErrAST,
-    hlsl::DxcLangExtensionsHelperApply *HlslLangExtensions) { // HLSL Change
+    hlsl::DxcLangExtensionsHelperApply *HlslLangExtensions, // HLSL Change
+    bool SkipIncludedFunctionBodies) { // HLSL Change
   assert(Diags.get() && "no DiagnosticsEngine was provided");
 
   SmallVector<StoredDiagnostic, 4> StoredDiagnostics;
@@ -2032,13 +2043,16 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
   // Override the resources path.
   CI->getHeaderSearchOpts().ResourceDir = ResourceFilesPath;
 
-  CI->getFrontendOpts().SkipFunctionBodies = SkipFunctionBodies;
+  CI->getFrontendOpts().SkipFunctionBodies =
+      SkipFunctionBodies || SkipIncludedFunctionBodies; // HLSL Change
 
   // Create the AST unit.
   std::unique_ptr<ASTUnit> AST;
   AST.reset(new ASTUnit(false));
   // HLSL Change Starts
   AST->HlslLangExtensions = HlslLangExtensions;
+  AST->SkipIncludedFunctionBodies =
+      SkipIncludedFunctionBodies && !SkipFunctionBodies;
   // Enable -verify and -verify-ignore-unexpected on the libclang initialization path.
   bool VerifyDiagnostics = CI->getDiagnosticOpts().VerifyDiagnostics;
   Diags->getDiagnosticOptions().setVerifyIgnoreUnexpected(
@@ -308,8 +308,22 @@ void CompilerInstance::createPreprocessor(TranslationUnitKind TUKind) {
 
   // Create a PTH manager if we are using some form of a token cache.
   PTHManager *PTHMgr = nullptr;
-  if (!PPOpts.TokenCache.empty())
+  if (!PPOpts.TokenCache.empty()) {
+    // HLSL Change Starts - use a remapped buffer for the token cache if one
+    // was provided, so hosts can keep the cache in memory.
+    for (const auto &RB : PPOpts.RemappedFileBuffers) {
+      if (RB.first == PPOpts.TokenCache) {
+        PTHMgr = PTHManager::Create(
+            llvm::MemoryBuffer::getMemBuffer(RB.second->getMemBufferRef(),
+                                             /*RequiresNullTerminator*/ false),
+            PPOpts.TokenCache, getDiagnostics());
+        break;
+      }
+    }
+    if (!PTHMgr)
+    // HLSL Change Ends
     PTHMgr = PTHManager::Create(PPOpts.TokenCache, getDiagnostics());
+  }
 
   // Create the Preprocessor.
   std::unique_ptr<HeaderSearch> HeaderInfo ( // HLSL Change - make unique_ptr and free
@@ -28,6 +28,73 @@
 #include <cstring>
 using namespace clang;
 
+// HLSL Change Begin - vector scans for the lexer's hot loops.
+// Generated sources run to megabytes of comments, indentation and literal
+// tables, so those are skipped sixteen bytes at a time. MSVC does not define
+// __SSE2__, though every x64 target has it.
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HLSL_LEXER_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define HLSL_LEXER_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(HLSL_LEXER_SSE2) || defined(HLSL_LEXER_NEON)
+#define HLSL_LEXER_SIMD 1
+namespace {
+#ifdef HLSL_LEXER_SSE2
+/// Returns how many of the 16 lanes of Match are set before the first one
+/// that is not.
+inline unsigned CountLeadingMatches(__m128i Match) {
+  unsigned Misses = ~(unsigned)_mm_movemask_epi8(Match) & 0xFFFF;
+  return Misses ? llvm::countTrailingZeros(Misses) : 16;
+}
+
+inline unsigned CountLeadingBlanks16(const char *Ptr) {
+  __m128i V = _mm_loadu_si128((const __m128i *)Ptr);
+  return CountLeadingMatches(_mm_or_si128(_mm_cmpeq_epi8(V, _mm_set1_epi8(' ')),
+                                          _mm_cmpeq_epi8(V, _mm_set1_epi8('\t'))));
+}
+
+inline unsigned CountLeadingDigits16(const char *Ptr) {
+  // SSE2 has no unsigned compare; bias the distance from '0' so that 0..9
+  // are the smallest signed values.
+  __m128i V = _mm_loadu_si128((const __m128i *)Ptr);
+  __m128i Biased = _mm_xor_si128(_mm_sub_epi8(V, _mm_set1_epi8('0')),
+                                 _mm_set1_epi8((char)0x80));
+  return CountLeadingMatches(
+      _mm_cmplt_epi8(Biased, _mm_set1_epi8((char)(0x80 + 10))));
+}
+#else
+/// Packs the 16 lanes of Match into four bits each, in memory order.
+inline uint64_t GetNeonByteMask(uint8x16_t Match) {
+  uint8x8_t Nibbles = vshrn_n_u16(vreinterpretq_u16_u8(Match), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(Nibbles), 0);
+}
+
+inline unsigned CountLeadingMatches(uint8x16_t Match) {
+  uint64_t Misses = ~GetNeonByteMask(Match);
+  return Misses ? llvm::countTrailingZeros(Misses) / 4 : 16;
+}
+
+inline unsigned CountLeadingBlanks16(const char *Ptr) {
+  uint8x16_t V = vld1q_u8((const uint8_t *)Ptr);
+  return CountLeadingMatches(vorrq_u8(vceqq_u8(V, vdupq_n_u8(' ')),
+                                      vceqq_u8(V, vdupq_n_u8('\t'))));
+}
+
+inline unsigned CountLeadingDigits16(const char *Ptr) {
+  uint8x16_t V = vld1q_u8((const uint8_t *)Ptr);
+  return CountLeadingMatches(
+      vcleq_u8(vsubq_u8(V, vdupq_n_u8('0')), vdupq_n_u8(9)));
+}
+#endif
+} // namespace
+#endif
+// HLSL Change End
+
 //===----------------------------------------------------------------------===//
 // Token Class Implementation
 //===----------------------------------------------------------------------===//
@@ -1577,6 +1644,20 @@ bool Lexer::LexNumericConstant(Token &Result, const char *CurPtr, unsigned Perio
         }
     }
     // HLSL Change End.
+    // HLSL Change Begin - take long runs of digits, as in literal tables, a
+    // vector at a time. Digits are never part of a trigraph or an escaped
+    // newline, so they need no decoding.
+#ifdef HLSL_LEXER_SIMD
+    while (isDigit(CurPtr[0]) && isDigit(CurPtr[1]) &&
+           CurPtr + 16 <= BufferEnd) {
+      unsigned Digits = CountLeadingDigits16(CurPtr);
+      CurPtr += Digits;
+      PrevCh = CurPtr[-1];
+      if (Digits < 16)
+        break;
+    }
+#endif
+    // HLSL Change End
     C = getCharAndSize(CurPtr, Size);
   }
 
@@ -1975,6 +2056,19 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr,
 
   // Skip consecutive spaces efficiently.
   while (1) {
+    // HLSL Change Begin - skip runs of indentation a vector at a time.
+#ifdef HLSL_LEXER_SIMD
+    while (isHorizontalWhitespace(Char) && isHorizontalWhitespace(CurPtr[1]) &&
+           CurPtr + 16 <= BufferEnd) {
+      unsigned Blanks = CountLeadingBlanks16(CurPtr);
+      CurPtr += Blanks;
+      Char = *CurPtr;
+      if (Blanks < 16)
+        break;
+    }
+#endif
+    // HLSL Change End
+
     // Skip horizontal whitespace very aggressively.
     while (isHorizontalWhitespace(Char))
       Char = *++CurPtr;
@@ -2255,8 +2349,7 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
+#if defined(HLSL_LEXER_SIMD) // HLSL Change - SSE2 and NEON included above.
 #elif __ALTIVEC__
 #include <altivec.h>
 #undef bool
@@ -2318,7 +2411,7 @@ bool Lexer::SkipBlockComment(Token &Result, const char *CurPtr,
 
       if (C == '/') goto FoundSlash;
 
-#ifdef __SSE2__
+#ifdef HLSL_LEXER_SSE2 // HLSL Change - also under MSVC.
       __m128i Slashes = _mm_set1_epi8('/');
       while (CurPtr+16 <= BufferEnd) {
         int cmp = _mm_movemask_epi8(_mm_cmpeq_epi8(*(const __m128i*)CurPtr,
@@ -2332,6 +2425,19 @@ bool Lexer::SkipBlockComment(Token &Result, const char *CurPtr,
         }
         CurPtr += 16;
       }
+      // HLSL Change Begin - the same scan with NEON.
+#elif defined(HLSL_LEXER_NEON)
+      uint8x16_t Slashes = vdupq_n_u8('/');
+      while (CurPtr+16 <= BufferEnd) {
+        uint64_t Mask = GetNeonByteMask(
+            vceqq_u8(vld1q_u8((const uint8_t *)CurPtr), Slashes));
+        if (Mask != 0) {
+          CurPtr += llvm::countTrailingZeros(Mask) / 4 + 1;
+          goto FoundSlash;
+        }
+        CurPtr += 16;
+      }
+      // HLSL Change End
 #elif __ALTIVEC__
       __vector unsigned char Slashes = {
         '/', '/', '/', '/',  '/', '/', '/', '/',
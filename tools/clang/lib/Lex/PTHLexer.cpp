@@ -441,8 +441,13 @@ PTHManager *PTHManager::Create(StringRef file, DiagnosticsEngine &Diags) {
     Diags.Report(diag::err_invalid_pth_file) << file;
     return nullptr;
   }
-  std::unique_ptr<llvm::MemoryBuffer> File = std::move(FileOrErr.get());
+  // HLSL Change Starts - allow in-memory token caches
+  return Create(std::move(FileOrErr.get()), file, Diags);
+}
 
+PTHManager *PTHManager::Create(std::unique_ptr<llvm::MemoryBuffer> File,
+                               StringRef file, DiagnosticsEngine &Diags) {
+  // HLSL Change Ends
   using namespace llvm::support;
 
   // Get the buffer ranges and check if there are at least three 32-bit
@@ -24,6 +24,7 @@
 #include "clang/Sema/SemaConsumer.h"
 #include "clang/Sema/SemaHLSL.h" // HLSL Change
 #include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/Timer.h" // HLSL Change
 #include <cstdio>
 #include <memory>
 
@@ -120,6 +121,9 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   llvm::CrashRecoveryContextCleanupRegistrar<Parser>
     CleanupParser(ParseOP.get());
 
+  { // HLSL Change - report parsing to the thread's phase timing listener
+  llvm::PhaseTimingRegion ParsePhase("Parse and Sema");
+
   S.getPreprocessor().EnterMainSourceFile();
   P.Initialize();
 
@@ -143,7 +147,9 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
         // skipping something.
         if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
           return;
-      } while (!P.ParseTopLevelDecl(ADecl));
+        llvm::checkCancellation(); // HLSL Change
+      } while (!S.getDiagnostics().hasFatalErrorOccurred() && // HLSL Change: stop once diagnostics are silenced by a fatal error
+               !P.ParseTopLevelDecl(ADecl));
     }
   } // HLSL Change: Skip if fatal error already occurred
 
@@ -156,7 +162,7 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   // errors in the front-end, without relying on code generation being
   // available.
   hlsl::DiagnoseTranslationUnit(&S);
-  // HLSL Change Ends
+  } // HLSL Change Ends - end of parsing phase
   Consumer->HandleTranslationUnit(S.getASTContext());
 
   std::swap(OldCollectStats, S.CollectStats);
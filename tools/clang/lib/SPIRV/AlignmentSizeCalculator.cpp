@@ -65,6 +65,38 @@ void AlignmentSizeCalculator::alignUsingHLSLRelaxedLayout(
 std::pair<uint32_t, uint32_t> AlignmentSizeCalculator::getAlignmentAndSize(
     QualType type, SpirvLayoutRule rule, llvm::Optional<bool> isRowMajor,
     uint32_t *stride) {
+  // Scalars, vectors and matrices are cheap to lay out; only memoize the
+  // aggregates whose layout requires walking all of their members.
+  if (!type->getAs<RecordType>() && !astContext.getAsConstantArrayType(type))
+    return computeAlignmentAndSize(type, rule, isRowMajor, stride);
+
+  if (const auto *layout =
+          spvContext.lookupTypeLayout(type, rule, isRowMajor)) {
+    if (layout->hasStride)
+      *stride = layout->stride;
+    return {layout->alignment, layout->size};
+  }
+
+  // The stride is only written for some types, so compute into a local one to
+  // find out whether the layout sets it.
+  const uint32_t kNoStride = ~0u;
+  uint32_t layoutStride = kNoStride;
+  uint32_t alignment = 0, size = 0;
+  std::tie(alignment, size) =
+      computeAlignmentAndSize(type, rule, isRowMajor, &layoutStride);
+
+  const bool hasStride = layoutStride != kNoStride;
+  if (hasStride)
+    *stride = layoutStride;
+  spvContext.registerTypeLayout(type, rule, isRowMajor,
+                                {alignment, size, layoutStride, hasStride});
+  return {alignment, size};
+}
+
+std::pair<uint32_t, uint32_t>
+AlignmentSizeCalculator::computeAlignmentAndSize(
+    QualType type, SpirvLayoutRule rule, llvm::Optional<bool> isRowMajor,
+    uint32_t *stride) {
   // std140 layout rules:
 
   // 1. If the member is a scalar consuming N basic machine units, the base
@@ -13,6 +13,7 @@
 #include "dxc/Support/SPIRVOptions.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/SPIRV/AstTypeProbe.h"
+#include "clang/SPIRV/SpirvContext.h"
 
 namespace clang {
 namespace spirv {
@@ -20,8 +21,9 @@ namespace spirv {
 /// The class responsible to translate Clang frontend types into SPIR-V types.
 class AlignmentSizeCalculator {
 public:
-  AlignmentSizeCalculator(ASTContext &astCtx, const SpirvCodeGenOptions &opts)
-      : astContext(astCtx), spvOptions(opts) {}
+  AlignmentSizeCalculator(ASTContext &astCtx, SpirvContext &spvCtx,
+                          const SpirvCodeGenOptions &opts)
+      : astContext(astCtx), spvContext(spvCtx), spvOptions(opts) {}
 
   /// \brief Returns the alignment and size in bytes for the given type
   /// according to the given LayoutRule. If the caller has information about
@@ -36,6 +38,8 @@ public:
   /// will occupy in memory; rather it is used in conjunction with alignment
   /// to get the next available location (alignment + size), which means
   /// size contains post-paddings required by the given type.
+  ///
+  /// Layouts of structs and arrays are memoized in the SpirvContext.
   std::pair<uint32_t, uint32_t>
   getAlignmentAndSize(QualType type, SpirvLayoutRule rule,
                       llvm::Optional<bool> isRowMajor, uint32_t *stride);
@@ -57,6 +61,11 @@ public:
   }
 
 private:
+  /// Computes what getAlignmentAndSize returns, without consulting the cache.
+  std::pair<uint32_t, uint32_t>
+  computeAlignmentAndSize(QualType type, SpirvLayoutRule rule,
+                          llvm::Optional<bool> isRowMajor, uint32_t *stride);
+
   /// Emits error to the diagnostic engine associated with this visitor.
   template <unsigned N>
   DiagnosticBuilder emitError(const char (&message)[N],
@@ -68,6 +77,7 @@ private:
 
 private:
   ASTContext &astContext;                /// AST context
+  SpirvContext &spvContext;              /// SPIR-V context
   const SpirvCodeGenOptions &spvOptions; /// SPIR-V options
 };
 
@@ -9,6 +9,7 @@
 
 #include "DeclResultIdMapper.h"
 
+#include <map>
 #include <sstream>
 
 #include "dxc/DXIL/DxilConstants.h"
@@ -1486,31 +1487,43 @@ DeclResultIdMapper::getCTBufferPushConstantType(const DeclContext *decl) {
   return found->second;
 }
 
-std::vector<SpirvVariable *>
-DeclResultIdMapper::collectStageVars(SpirvFunction *entryPoint) const {
-  std::vector<SpirvVariable *> vars;
+llvm::DenseMap<SpirvFunction *, std::vector<SpirvVariable *>>
+DeclResultIdMapper::collectStageVars(
+    llvm::ArrayRef<SpirvFunction *> entryPoints) const {
+  llvm::DenseMap<SpirvFunction *, std::vector<SpirvVariable *>> varsForEntry;
+  llvm::DenseMap<SpirvFunction *, llvm::DenseSet<SpirvInstruction *>>
+      seenVarsForEntry;
 
-  for (auto var : glPerVertex.getStageInVars())
-    vars.push_back(var);
-  for (auto var : glPerVertex.getStageOutVars())
-    vars.push_back(var);
+  for (auto *entryPoint : entryPoints) {
+    auto &vars = varsForEntry[entryPoint];
+    for (auto var : glPerVertex.getStageInVars())
+      vars.push_back(var);
+    for (auto var : glPerVertex.getStageOutVars())
+      vars.push_back(var);
+  }
+
+  const auto addVar = [&varsForEntry, &seenVarsForEntry](
+                          SpirvFunction *entryPoint, SpirvVariable *instr) {
+    if (seenVarsForEntry[entryPoint].insert(instr).second)
+      varsForEntry[entryPoint].push_back(instr);
+  };
 
-  llvm::DenseSet<SpirvInstruction *> seenVars;
   for (const auto &var : stageVars) {
     // We must collect stage variables that are included in entryPoint and stage
     // variables that are not included in any specific entryPoint i.e.,
     // var.getEntryPoint() is nullptr. Note that stage variables without any
     // specific entry point are common stage variables among all entry points.
-    if (var.getEntryPoint() && var.getEntryPoint() != entryPoint)
-      continue;
     auto *instr = var.getSpirvInstr();
-    if (seenVars.count(instr) == 0) {
-      vars.push_back(instr);
-      seenVars.insert(instr);
+    if (auto *entryPoint = var.getEntryPoint()) {
+      if (varsForEntry.count(entryPoint))
+        addVar(entryPoint, instr);
+    } else {
+      for (auto *entryPoint : entryPoints)
+        addVar(entryPoint, instr);
     }
   }
 
-  return vars;
+  return varsForEntry;
 }
 
 namespace {
@@ -1569,14 +1582,21 @@ private:
 
 /// A class for managing resource bindings to avoid duplicate uses of the same
 /// set and binding number.
+///
+/// The used binding numbers of each set are kept as disjoint, non-adjacent
+/// spans, so that finding a free chunk only needs to look at the gaps between
+/// spans instead of every binding number used so far.
 class BindingSet {
 public:
   /// Uses the given set and binding number. Returns false if the binding number
   /// was already occupied in the set, and returns true otherwise.
   bool useBinding(uint32_t binding, uint32_t set) {
-    bool inserted = false;
-    std::tie(std::ignore, inserted) = usedBindings[set].insert(binding);
-    return inserted;
+    auto &spans = usedBindings[set];
+    auto next = spans.upper_bound(binding);
+    if (next != spans.begin() && std::prev(next)->second > binding)
+      return false;
+    addSpan(spans, next, binding, binding + 1);
+    return true;
   }
 
   /// Uses the next available binding number in |set|. If more than one binding
@@ -1586,9 +1606,11 @@ public:
                           uint32_t bindingShift = 0) {
     uint32_t bindingNoStart =
         getNextBindingChunk(set, numBindingsToUse, bindingShift);
-    auto &binding = usedBindings[set];
-    for (uint32_t i = 0; i < numBindingsToUse; ++i)
-      binding.insert(bindingNoStart + i);
+    if (numBindingsToUse != 0) {
+      auto &spans = usedBindings[set];
+      addSpan(spans, spans.upper_bound(bindingNoStart), bindingNoStart,
+              bindingNoStart + numBindingsToUse);
+    }
     return bindingNoStart;
   }
 
@@ -1596,44 +1618,46 @@ public:
   /// consecutive binding numbers are unused starting at |bindingShift|.
   uint32_t getNextBindingChunk(uint32_t set, uint32_t n,
                                uint32_t bindingShift) {
-    auto &existingBindings = usedBindings[set];
+    const auto &spans = usedBindings[set];
 
-    // There were no bindings in this set. Can start at binding zero.
-    if (existingBindings.empty())
-      return bindingShift;
+    // Skip the span covering |bindingShift|, if any.
+    uint32_t start = bindingShift;
+    auto next = spans.upper_bound(start);
+    if (next != spans.begin() && std::prev(next)->second > start)
+      start = std::prev(next)->second;
 
-    // Check whether the chunk of |n| binding numbers can be fitted at the
-    // very beginning of the list (start at binding 0 in the current set).
-    uint32_t curBinding = *existingBindings.begin();
-    if (curBinding >= (n + bindingShift))
-      return bindingShift;
+    // Move past every span that starts before the chunk would end.
+    for (; next != spans.end() && next->first < start + n; ++next)
+      start = next->second;
 
-    auto iter = std::next(existingBindings.begin());
-    while (iter != existingBindings.end()) {
-      // There exists a next binding number that is used. Check to see if the
-      // gap between current binding number and next binding number is large
-      // enough to accommodate |n|.
-      uint32_t nextBinding = *iter;
-      if ((bindingShift > 0) && (curBinding < (bindingShift - 1)))
-        curBinding = bindingShift - 1;
-
-      if (curBinding < nextBinding && n <= nextBinding - curBinding - 1)
-        return curBinding + 1;
-
-      curBinding = nextBinding;
+    return start;
+  }
 
-      // Peek at the next binding that has already been used (if any).
-      ++iter;
+private:
+  /// Half-open spans [first, second) of used binding numbers, keyed by start.
+  using SpanMap = std::map<uint32_t, uint32_t>;
+
+  /// Marks the unused binding numbers [start, end) as used, merging them with
+  /// the neighbouring spans. |next| is the first span starting after |start|.
+  static void addSpan(SpanMap &spans, SpanMap::iterator next, uint32_t start,
+                      uint32_t end) {
+    assert(next == spans.end() || next->first >= end);
+    if (next != spans.end() && next->first == end) {
+      end = next->second;
+      next = spans.erase(next);
+    }
+    if (next != spans.begin()) {
+      auto prev = std::prev(next);
+      if (prev->second == start) {
+        prev->second = end;
+        return;
+      }
     }
-
-    // |curBinding| was the last binding that was used in this set. The next
-    // chunk of |n| bindings can start at |curBinding|+1.
-    return std::max(curBinding + 1, bindingShift);
+    spans.emplace_hint(next, start, end);
   }
 
-private:
-  ///< set number -> set of used binding number
-  llvm::DenseMap<uint32_t, std::set<uint32_t>> usedBindings;
+  ///< set number -> spans of used binding numbers
+  llvm::DenseMap<uint32_t, SpanMap> usedBindings;
 };
 } // namespace
 
@@ -2823,7 +2847,7 @@ bool DeclResultIdMapper::createPayloadStageVars(
   // and we need to load/store these individual member variables.
   const auto *structDecl = type->getAs<RecordType>()->getDecl();
   llvm::SmallVector<SpirvInstruction *, 4> subValues;
-  AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions);
+  AlignmentSizeCalculator alignmentCalc(astContext, spvContext, spirvOptions);
   uint32_t nextMemberOffset = 0;
 
   for (const auto *field : structDecl->fields()) {
@@ -512,10 +512,11 @@ public:
   /// won't attach Block/BufferBlock decoration.
   const SpirvType *getCTBufferPushConstantType(const DeclContext *decl);
 
-  /// \brief Returns all defined stage (builtin/input/ouput) variables for the
-  /// entry point function entryPoint in this mapper.
-  std::vector<SpirvVariable *>
-  collectStageVars(SpirvFunction *entryPoint) const;
+  /// \brief Returns all defined stage (builtin/input/ouput) variables for each
+  /// of the given entry point functions in this mapper, in one pass over the
+  /// stage variables.
+  llvm::DenseMap<SpirvFunction *, std::vector<SpirvVariable *>>
+  collectStageVars(llvm::ArrayRef<SpirvFunction *> entryPoints) const;
 
   /// \brief Writes out the contents in the function parameter for the GS
   /// stream output to the corresponding stage output variables in a recursive
@@ -355,21 +355,28 @@ void EmitVisitor::finalizeInstruction(std::vector<uint32_t> *section) {
 }
 
 std::vector<uint32_t> EmitVisitor::takeBinary() {
-  std::vector<uint32_t> result;
   Header header(takeNextId(), getHeaderVersion(spvOptions.targetEnv));
   auto headerBinary = header.takeBinary();
-  result.insert(result.end(), headerBinary.begin(), headerBinary.end());
-  result.insert(result.end(), preambleBinary.begin(), preambleBinary.end());
-  result.insert(result.end(), debugFileBinary.begin(), debugFileBinary.end());
-  result.insert(result.end(), debugVariableBinary.begin(),
-                debugVariableBinary.end());
-  result.insert(result.end(), annotationsBinary.begin(),
-                annotationsBinary.end());
-  result.insert(result.end(), typeConstantBinary.begin(),
-                typeConstantBinary.end());
-  result.insert(result.end(), globalVarsBinary.begin(), globalVarsBinary.end());
-  result.insert(result.end(), richDebugInfo.begin(), richDebugInfo.end());
-  result.insert(result.end(), mainBinary.begin(), mainBinary.end());
+
+  // Sections in the order they must appear in the module.
+  std::vector<uint32_t> *sections[] = {
+      &headerBinary,        &preambleBinary,    &debugFileBinary,
+      &debugVariableBinary, &annotationsBinary, &typeConstantBinary,
+      &globalVarsBinary,    &richDebugInfo,     &mainBinary};
+
+  // Size the result exactly once so that concatenating the sections does not
+  // reallocate, and release each section as soon as it has been copied so that
+  // peak memory stays close to the size of the final module.
+  size_t numWords = 0;
+  for (const auto *section : sections)
+    numWords += section->size();
+
+  std::vector<uint32_t> result;
+  result.reserve(numWords);
+  for (auto *section : sections) {
+    result.insert(result.end(), section->begin(), section->end());
+    std::vector<uint32_t>().swap(*section);
+  }
   return result;
 }
 
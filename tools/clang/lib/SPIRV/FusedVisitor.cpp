@@ -0,0 +1,45 @@
+//===--- FusedVisitor.cpp - Runs several visitors in one walk ----*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "FusedVisitor.h"
+
+namespace clang {
+namespace spirv {
+
+template <typename Fn> bool FusedVisitor::forEachVisitor(Fn fn) {
+  for (size_t i = 0; i < visitors.size();) {
+    if (fn(visitors[i]))
+      ++i;
+    else
+      visitors.erase(visitors.begin() + i);
+  }
+  return !visitors.empty();
+}
+
+bool FusedVisitor::visit(SpirvModule *mod, Phase phase) {
+  return forEachVisitor(
+      [mod, phase](Visitor *v) { return v->visit(mod, phase); });
+}
+
+bool FusedVisitor::visit(SpirvFunction *fn, Phase phase) {
+  return forEachVisitor(
+      [fn, phase](Visitor *v) { return v->visit(fn, phase); });
+}
+
+bool FusedVisitor::visit(SpirvBasicBlock *bb, Phase phase) {
+  return forEachVisitor(
+      [bb, phase](Visitor *v) { return v->visit(bb, phase); });
+}
+
+bool FusedVisitor::visitInstruction(SpirvInstruction *inst) {
+  return forEachVisitor([inst](Visitor *v) { return inst->invokeVisitor(v); });
+}
+
+} // end namespace spirv
+} // end namespace clang
@@ -0,0 +1,56 @@
+//===--- FusedVisitor.h - Runs several visitors in one walk ------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_SPIRV_FUSEDVISITOR_H
+#define LLVM_CLANG_LIB_SPIRV_FUSEDVISITOR_H
+
+#include "clang/SPIRV/SpirvContext.h"
+#include "clang/SPIRV/SpirvVisitor.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace clang {
+namespace spirv {
+
+/// Runs several visitors over the module in a single traversal. Every
+/// construct is handed to each visitor in the order the visitors were given,
+/// before the traversal moves on to the next construct.
+///
+/// Only visitors that walk the module in the same direction and do not depend
+/// on another visitor having seen the whole module first may be fused. A
+/// visitor that returns false stops receiving constructs, just as if it had
+/// been run on its own; the traversal ends once all visitors have stopped.
+class FusedVisitor : public Visitor {
+public:
+  FusedVisitor(SpirvContext &spvCtx, const SpirvCodeGenOptions &opts,
+               llvm::ArrayRef<Visitor *> visitors)
+      : Visitor(opts, spvCtx), visitors(visitors.begin(), visitors.end()) {}
+
+  bool visit(SpirvModule *, Phase) override;
+  bool visit(SpirvFunction *, Phase) override;
+  bool visit(SpirvBasicBlock *, Phase) override;
+
+  using Visitor::visit;
+
+  /// Every instruction visit ends up here; re-dispatch it to each visitor so
+  /// that they see the instruction through their own typed overloads.
+  bool visitInstruction(SpirvInstruction *) override;
+
+private:
+  /// Calls fn on every visitor that is still running, drops the ones for which
+  /// fn returns false, and returns false once no visitor is left.
+  template <typename Fn> bool forEachVisitor(Fn fn);
+
+  llvm::SmallVector<Visitor *, 4> visitors;
+};
+
+} // end namespace spirv
+} // end namespace clang
+
+#endif // LLVM_CLANG_LIB_SPIRV_FUSEDVISITOR_H
@@ -0,0 +1,111 @@
+//===--- LegalizationCache.cpp - Reuse of legalized SPIR-V -------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LegalizationCache.h"
+
+#include "spirv/unified1/spirv.hpp11"
+#include "llvm/Support/MD5.h"
+
+namespace clang {
+namespace spirv {
+
+namespace {
+/// Number of words in a SPIR-V module header.
+const size_t kHeaderWordCount = 5;
+/// Maximum number of modules kept by the cache.
+const size_t kMaxEntries = 64;
+
+/// Calls fn with the literal operand of every DescriptorSet and Binding
+/// decoration in module, in module order. Stops and returns false as soon as
+/// fn does.
+template <typename Fn>
+bool forEachBindingLiteral(std::vector<uint32_t> *module, Fn fn) {
+  size_t i = kHeaderWordCount;
+  while (i < module->size()) {
+    const uint32_t word = (*module)[i];
+    const uint32_t wordCount = word >> 16;
+    if (wordCount == 0 || i + wordCount > module->size())
+      return true;
+    // OpDecorate <target> <decoration> <literal>
+    if (static_cast<spv::Op>(word & 0xffff) == spv::Op::OpDecorate &&
+        wordCount == 4) {
+      const auto decoration = static_cast<spv::Decoration>((*module)[i + 2]);
+      if (decoration == spv::Decoration::DescriptorSet ||
+          decoration == spv::Decoration::Binding) {
+        if (!fn(&(*module)[i + 3]))
+          return false;
+      }
+    }
+    i += wordCount;
+  }
+  return true;
+}
+} // namespace
+
+void extractBindingDecorations(std::vector<uint32_t> *module,
+                               std::vector<uint32_t> *values) {
+  forEachBindingLiteral(module, [values](uint32_t *literal) {
+    const uint32_t ordinal = static_cast<uint32_t>(values->size());
+    values->push_back(*literal);
+    *literal = ordinal;
+    return true;
+  });
+}
+
+bool restoreBindingDecorations(std::vector<uint32_t> *module,
+                               llvm::ArrayRef<uint32_t> values) {
+  return forEachBindingLiteral(module, [values](uint32_t *literal) {
+    if (*literal >= values.size())
+      return false;
+    *literal = values[*literal];
+    return true;
+  });
+}
+
+LegalizationCache &LegalizationCache::get() {
+  static LegalizationCache cache;
+  return cache;
+}
+
+std::string LegalizationCache::computeKey(llvm::StringRef recipe,
+                                          llvm::ArrayRef<uint32_t> module) {
+  llvm::MD5 hash;
+  hash.update(recipe);
+  hash.update(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(module.data()), module.size() * 4));
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  return std::string(reinterpret_cast<const char *>(result), sizeof(result));
+}
+
+bool LegalizationCache::lookup(const std::string &key,
+                               std::vector<uint32_t> *module) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = modules.find(key);
+  if (found == modules.end())
+    return false;
+  *module = found->second;
+  return true;
+}
+
+void LegalizationCache::store(const std::string &key,
+                              llvm::ArrayRef<uint32_t> module) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (modules.count(key))
+    return;
+  if (insertionOrder.size() >= kMaxEntries) {
+    modules.erase(insertionOrder.front());
+    insertionOrder.pop_front();
+  }
+  modules[key] = std::vector<uint32_t>(module.begin(), module.end());
+  insertionOrder.push_back(key);
+}
+
+} // end namespace spirv
+} // end namespace clang
@@ -0,0 +1,79 @@
+//===--- LegalizationCache.h - Reuse of legalized SPIR-V ---------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Shader permutations that differ only in -fvk-*-shift, -fvk-bind-register or
+// vk::binding produce SPIR-V modules that differ only in the literal operands
+// of their DescriptorSet and Binding decorations. This file provides a
+// process-wide cache that lets such permutations share one run of the
+// SPIRV-Tools legalization and optimization passes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_SPIRV_LEGALIZATIONCACHE_H
+#define LLVM_CLANG_LIB_SPIRV_LEGALIZATIONCACHE_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace clang {
+namespace spirv {
+
+/// Replaces the literal of every DescriptorSet and Binding decoration in
+/// |module| by its ordinal among those decorations, and appends the original
+/// literals to |values| in the same order.
+void extractBindingDecorations(std::vector<uint32_t> *module,
+                               std::vector<uint32_t> *values);
+
+/// Undoes extractBindingDecorations on a module derived from the one it was
+/// applied to. Returns false if a decoration carries an ordinal with no
+/// matching value, in which case |module| is left partially rewritten.
+bool restoreBindingDecorations(std::vector<uint32_t> *module,
+                               llvm::ArrayRef<uint32_t> values);
+
+/// A bounded, thread-safe cache of legalized and optimized modules, keyed on
+/// the pass recipe and the module they were run on with its binding
+/// decorations replaced by ordinals.
+class LegalizationCache {
+public:
+  /// Returns the cache shared by all compiles in this process.
+  static LegalizationCache &get();
+
+  /// Returns the key for running the passes described by |recipe| on
+  /// |module|.
+  static std::string computeKey(llvm::StringRef recipe,
+                                llvm::ArrayRef<uint32_t> module);
+
+  /// Copies the module stored under |key| into |module| and returns true, or
+  /// returns false if there is none.
+  bool lookup(const std::string &key, std::vector<uint32_t> *module);
+
+  /// Stores |module| under |key|, evicting the oldest entry when full.
+  void store(const std::string &key, llvm::ArrayRef<uint32_t> module);
+
+private:
+  LegalizationCache() = default;
+  LegalizationCache(const LegalizationCache &) = delete;
+  LegalizationCache &operator=(const LegalizationCache &) = delete;
+
+  std::mutex mutex;
+  llvm::StringMap<std::vector<uint32_t>> modules;
+  std::deque<std::string> insertionOrder; ///< Keys of modules, oldest first
+};
+
+} // end namespace spirv
+} // end namespace clang
+
+#endif // LLVM_CLANG_LIB_SPIRV_LEGALIZATIONCACHE_H
@@ -84,8 +84,8 @@ void LiteralTypeVisitor::tryToUpdateInstLitType(SpirvInstruction *inst,
 
   // Since LiteralTypeVisitor is run before lowering the types, we can simply
   // update the AST result-type of the instruction to the new type. In the case
-  // of the instruction being a constant instruction, since we do not have
-  // unique constants at this point, chaing the QualType of the constant
+  // of the instruction being a constant instruction, since constants of
+  // literal type are never made unique, changing the QualType of the constant
   // instruction is safe.
   inst->setAstResultType(newType);
 }
@@ -323,12 +323,14 @@ SpirvInstruction *RawBufferHandler::processTemplatedLoadFromBuffer(
     uint32_t fieldOffsetInBytes = 0;
     uint32_t structAlignment = 0, structSize = 0, stride = 0;
     std::tie(structAlignment, structSize) =
-        AlignmentSizeCalculator(astContext, theEmitter.getSpirvOptions())
+        AlignmentSizeCalculator(astContext, theEmitter.getSpirvContext(),
+                                theEmitter.getSpirvOptions())
             .getAlignmentAndSize(targetType,
                                  theEmitter.getSpirvOptions().sBufferLayoutRule,
                                  llvm::None, &stride);
     for (const auto *field : decl->fields()) {
       AlignmentSizeCalculator alignmentCalc(astContext,
+                                            theEmitter.getSpirvContext(),
                                             theEmitter.getSpirvOptions());
       uint32_t fieldSize = 0, fieldAlignment = 0;
       std::tie(fieldAlignment, fieldSize) = alignmentCalc.getAlignmentAndSize(
@@ -702,13 +704,15 @@ void RawBufferHandler::processTemplatedStoreToBuffer(SpirvInstruction *value,
     uint32_t fieldOffsetInBytes = 0;
     uint32_t structAlignment = 0, structSize = 0, stride = 0;
     std::tie(structAlignment, structSize) =
-        AlignmentSizeCalculator(astContext, theEmitter.getSpirvOptions())
+        AlignmentSizeCalculator(astContext, theEmitter.getSpirvContext(),
+                                theEmitter.getSpirvOptions())
             .getAlignmentAndSize(valueType,
                                  theEmitter.getSpirvOptions().sBufferLayoutRule,
                                  llvm::None, &stride);
     uint32_t fieldIndex = 0;
     for (const auto *field : decl->fields()) {
       AlignmentSizeCalculator alignmentCalc(astContext,
+                                            theEmitter.getSpirvContext(),
                                             theEmitter.getSpirvOptions());
       uint32_t fieldSize = 0, fieldAlignment = 0;
       std::tie(fieldAlignment, fieldSize) = alignmentCalc.getAlignmentAndSize(
@@ -18,15 +18,15 @@ SpirvBasicBlock::SpirvBasicBlock(llvm::StringRef name)
       continueTarget(nullptr), debugScope(nullptr) {}
 
 SpirvBasicBlock::~SpirvBasicBlock() {
-  for (auto instructionNode : instructions)
-    instructionNode.instruction->releaseMemory();
+  for (auto *instruction : instructions)
+    instruction->releaseMemory();
   if (debugScope)
     debugScope->releaseMemory();
 }
 
 bool SpirvBasicBlock::hasTerminator() const {
   return !instructions.empty() &&
-         isa<SpirvTerminator>(instructions.back().instruction);
+         isa<SpirvTerminator>(instructions.back());
 }
 
 bool SpirvBasicBlock::invokeVisitor(Visitor *visitor,
@@ -41,7 +41,7 @@ bool SpirvBasicBlock::invokeVisitor(Visitor *visitor,
   if (reverseOrder) {
     for (auto iter = instructions.rbegin(); iter != instructions.rend();
          ++iter) {
-      if (!iter->instruction->invokeVisitor(visitor))
+      if (!(*iter)->invokeVisitor(visitor))
         return false;
     }
     // If a basic block is the first basic block of a function, it should
@@ -62,8 +62,8 @@ bool SpirvBasicBlock::invokeVisitor(Visitor *visitor,
       }
     }
 
-    for (auto iter = instructions.begin(); iter != instructions.end(); ++iter) {
-      if (!iter->instruction->invokeVisitor(visitor))
+    for (auto *instruction : instructions) {
+      if (!instruction->invokeVisitor(visitor))
         return false;
     }
   }
@@ -11,6 +11,7 @@
 #include "CapabilityVisitor.h"
 #include "DebugTypeVisitor.h"
 #include "EmitVisitor.h"
+#include "FusedVisitor.h"
 #include "LiteralTypeVisitor.h"
 #include "LowerTypeVisitor.h"
 #include "NonUniformVisitor.h"
@@ -19,6 +20,7 @@
 #include "RemoveBufferBlockVisitor.h"
 #include "SortDebugInfoVisitor.h"
 #include "clang/SPIRV/AstTypeProbe.h"
+#include "llvm/Support/Timer.h"
 
 namespace clang {
 namespace spirv {
@@ -1381,26 +1383,47 @@ void SpirvBuilder::decorateCoherent(SpirvInstruction *target,
 
 SpirvConstant *SpirvBuilder::getConstantInt(QualType type, llvm::APInt value,
                                             bool specConst) {
-  // We do not reuse existing constant integers. Just create a new one.
+  // Reuse an existing constant if possible.
+  const bool unique = !specConst && !isLitTypeOrVecOfLitType(type);
+  if (unique)
+    if (auto *existing = context.lookupConstantInt(type, value))
+      return existing;
+
   auto *intConst = new (context) SpirvConstantInteger(type, value, specConst);
   mod->addConstant(intConst);
+  if (unique)
+    context.registerUniqueConstant(intConst);
   return intConst;
 }
 
 SpirvConstant *SpirvBuilder::getConstantFloat(QualType type,
                                               llvm::APFloat value,
                                               bool specConst) {
-  // We do not reuse existing constant floats. Just create a new one.
+  // Reuse an existing constant if possible.
+  const bool unique = !specConst && !isLitTypeOrVecOfLitType(type);
+  if (unique)
+    if (auto *existing = context.lookupConstantFloat(type, value))
+      return existing;
+
   auto *floatConst = new (context) SpirvConstantFloat(type, value, specConst);
   mod->addConstant(floatConst);
+  if (unique)
+    context.registerUniqueConstant(floatConst);
   return floatConst;
 }
 
 SpirvConstant *SpirvBuilder::getConstantBool(bool value, bool specConst) {
-  // We do not care about making unique constants at this point.
+  // Reuse an existing constant if possible. Each specialization constant is
+  // its own instruction.
+  if (!specConst)
+    if (auto *existing = context.lookupConstantBool(value))
+      return existing;
+
   auto *boolConst =
       new (context) SpirvConstantBoolean(astContext.BoolTy, value, specConst);
   mod->addConstant(boolConst);
+  if (!specConst)
+    context.registerUniqueConstant(boolConst);
   return boolConst;
 }
 
@@ -1408,17 +1431,35 @@ SpirvConstant *
 SpirvBuilder::getConstantComposite(QualType compositeType,
                                    llvm::ArrayRef<SpirvConstant *> constituents,
                                    bool specConst) {
-  // We do not care about making unique constants at this point.
+  // Reuse an existing constant if possible. A composite can only be unique if
+  // all of its constituents are.
+  bool unique = !specConst && !isLitTypeOrVecOfLitType(compositeType);
+  for (auto *constituent : constituents)
+    unique = unique && context.isUniqueConstant(constituent);
+  if (unique)
+    if (auto *existing =
+            context.lookupConstantComposite(compositeType, constituents))
+      return existing;
+
   auto *compositeConst = new (context)
       SpirvConstantComposite(compositeType, constituents, specConst);
   mod->addConstant(compositeConst);
+  if (unique)
+    context.registerUniqueConstant(compositeConst);
   return compositeConst;
 }
 
 SpirvConstant *SpirvBuilder::getConstantNull(QualType type) {
-  // We do not care about making unique constants at this point.
+  // Reuse an existing constant if possible.
+  const bool unique = !isLitTypeOrVecOfLitType(type);
+  if (unique)
+    if (auto *existing = context.lookupConstantNull(type))
+      return existing;
+
   auto *nullConst = new (context) SpirvConstantNull(type);
   mod->addConstant(nullConst);
+  if (unique)
+    context.registerUniqueConstant(nullConst);
   return nullConst;
 }
 
@@ -1478,16 +1519,25 @@ std::vector<uint32_t> SpirvBuilder::takeModule() {
                                                     spirvOptions);
   EmitVisitor emitVisitor(astContext, context, spirvOptions);
 
-  mod->invokeVisitor(&literalTypeVisitor, true);
-
-  // Propagate NonUniform decorations
-  mod->invokeVisitor(&nonUniformVisitor);
+  {
+    llvm::PhaseTimingRegion phase("SPIR-V Literal Type Resolution",
+                                  /*IsPass*/ true);
+    mod->invokeVisitor(&literalTypeVisitor, true);
+  }
 
-  // Lower types
-  mod->invokeVisitor(&lowerTypeVisitor);
+  // Propagate NonUniform decorations and lower types. Neither looks at what
+  // the other one changes, so both run in the same walk over the module.
+  {
+    llvm::PhaseTimingRegion phase("SPIR-V NonUniform and Type Lowering",
+                                  /*IsPass*/ true);
+    FusedVisitor fusedVisitor(context, spirvOptions,
+                              {&nonUniformVisitor, &lowerTypeVisitor});
+    mod->invokeVisitor(&fusedVisitor);
+  }
 
   // Generate debug types (if needed)
   if (spirvOptions.debugInfoRich) {
+    llvm::PhaseTimingRegion phase("SPIR-V Debug Types", /*IsPass*/ true);
     DebugTypeVisitor debugTypeVisitor(astContext, context, spirvOptions, *this,
                                       lowerTypeVisitor);
     SortDebugInfoVisitor sortDebugInfoVisitor(context, spirvOptions);
@@ -1495,20 +1545,33 @@ std::vector<uint32_t> SpirvBuilder::takeModule() {
     mod->invokeVisitor(&sortDebugInfoVisitor);
   }
 
-  // Add necessary capabilities and extensions
-  mod->invokeVisitor(&capabilityVisitor);
-
-  // Propagate RelaxedPrecision decorations
-  mod->invokeVisitor(&relaxedPrecisionVisitor);
+  // Add necessary capabilities and extensions, and propagate RelaxedPrecision
+  // decorations. Capabilities only depend on lowered types and RelaxedPrecision
+  // only on AST types, so both run in the same walk over the module.
+  {
+    llvm::PhaseTimingRegion phase("SPIR-V Capabilities and RelaxedPrecision",
+                                  /*IsPass*/ true);
+    FusedVisitor fusedVisitor(context, spirvOptions,
+                              {&capabilityVisitor, &relaxedPrecisionVisitor});
+    mod->invokeVisitor(&fusedVisitor);
+  }
 
   // Propagate NoContraction decorations
-  mod->invokeVisitor(&preciseVisitor, true);
+  {
+    llvm::PhaseTimingRegion phase("SPIR-V NoContraction", /*IsPass*/ true);
+    mod->invokeVisitor(&preciseVisitor, true);
+  }
 
   // Remove BufferBlock decoration if necessary (this decoration is deprecated
   // after SPIR-V 1.3).
-  mod->invokeVisitor(&removeBufferBlockVisitor);
+  {
+    llvm::PhaseTimingRegion phase("SPIR-V BufferBlock Removal",
+                                  /*IsPass*/ true);
+    mod->invokeVisitor(&removeBufferBlockVisitor);
+  }
 
   // Emit SPIR-V
+  llvm::PhaseTimingRegion phase("SPIR-V Emission", /*IsPass*/ true);
   mod->invokeVisitor(&emitVisitor);
 
   return emitVisitor.takeBinary();
@@ -11,6 +11,7 @@
 #include <tuple>
 
 #include "clang/SPIRV/SpirvContext.h"
+#include "clang/SPIRV/AstTypeProbe.h"
 #include "clang/SPIRV/SpirvModule.h"
 
 namespace clang {
@@ -20,7 +21,7 @@ SpirvContext::SpirvContext()
     : allocator(), voidType(nullptr), boolType(nullptr), sintTypes({}),
       uintTypes({}), floatTypes({}), samplerType(nullptr),
       curShaderModelKind(ShaderModelKind::Invalid), majorVersion(0),
-      minorVersion(0), currentLexicalScope(nullptr) {
+      minorVersion(0), currentLexicalScope(nullptr), boolConstants({}) {
   voidType = new (this) VoidType;
   boolType = new (this) BoolType;
   samplerType = new (this) SamplerType;
@@ -527,5 +528,93 @@ void SpirvContext::moveDebugTypesToModule(SpirvModule *module) {
   typeTemplateParams.clear();
 }
 
+SpirvConstantInteger *
+SpirvContext::lookupConstantInt(QualType type, const llvm::APInt &value) const {
+  if (value.getBitWidth() > 64)
+    return nullptr;
+  auto it = intConstants.find(
+      {type.getAsOpaquePtr(), {value.getBitWidth(), value.getZExtValue()}});
+  return it == intConstants.end() ? nullptr : it->second;
+}
+
+SpirvConstantFloat *
+SpirvContext::lookupConstantFloat(QualType type,
+                                  const llvm::APFloat &value) const {
+  const llvm::APInt bits = value.bitcastToAPInt();
+  if (bits.getBitWidth() > 64)
+    return nullptr;
+  auto it = floatConstants.find(
+      {type.getAsOpaquePtr(), {bits.getBitWidth(), bits.getZExtValue()}});
+  return it == floatConstants.end() ? nullptr : it->second;
+}
+
+SpirvConstantComposite *SpirvContext::lookupConstantComposite(
+    QualType type, llvm::ArrayRef<SpirvConstant *> constituents) const {
+  auto it = compositeConstants.find(
+      {type.getAsOpaquePtr(),
+       std::vector<SpirvConstant *>(constituents.begin(), constituents.end())});
+  return it == compositeConstants.end() ? nullptr : it->second;
+}
+
+SpirvConstantNull *SpirvContext::lookupConstantNull(QualType type) const {
+  auto it = nullConstants.find(type.getAsOpaquePtr());
+  return it == nullConstants.end() ? nullptr : it->second;
+}
+
+void SpirvContext::registerUniqueConstant(SpirvConstant *constant) {
+  assert(!constant->isSpecConstant() &&
+         !isLitTypeOrVecOfLitType(constant->getAstResultType()) &&
+         "only non-specialization constants of non-literal type are unique");
+  void *type = constant->getAstResultType().getAsOpaquePtr();
+  if (auto *boolConst = dyn_cast<SpirvConstantBoolean>(constant)) {
+    boolConstants[boolConst->getValue()] = boolConst;
+  } else if (auto *intConst = dyn_cast<SpirvConstantInteger>(constant)) {
+    const llvm::APInt value = intConst->getValue();
+    if (value.getBitWidth() > 64)
+      return;
+    intConstants[{type, {value.getBitWidth(), value.getZExtValue()}}] =
+        intConst;
+  } else if (auto *floatConst = dyn_cast<SpirvConstantFloat>(constant)) {
+    const llvm::APInt bits = floatConst->getValue().bitcastToAPInt();
+    if (bits.getBitWidth() > 64)
+      return;
+    floatConstants[{type, {bits.getBitWidth(), bits.getZExtValue()}}] =
+        floatConst;
+  } else if (auto *compositeConst =
+                 dyn_cast<SpirvConstantComposite>(constant)) {
+    llvm::ArrayRef<SpirvConstant *> constituents =
+        compositeConst->getConstituents();
+    compositeConstants[{type, std::vector<SpirvConstant *>(
+                                  constituents.begin(), constituents.end())}] =
+        compositeConst;
+  } else if (auto *nullConst = dyn_cast<SpirvConstantNull>(constant)) {
+    nullConstants[type] = nullConst;
+  } else {
+    return;
+  }
+  uniqueConstants.insert(constant);
+}
+
+static std::pair<void *, unsigned>
+getTypeLayoutKey(QualType type, SpirvLayoutRule rule,
+                 llvm::Optional<bool> isRowMajor) {
+  const unsigned majorness =
+      isRowMajor.hasValue() ? (isRowMajor.getValue() ? 2 : 1) : 0;
+  return {type.getAsOpaquePtr(), static_cast<unsigned>(rule) * 3 + majorness};
+}
+
+const SpirvContext::TypeLayout *
+SpirvContext::lookupTypeLayout(QualType type, SpirvLayoutRule rule,
+                               llvm::Optional<bool> isRowMajor) const {
+  auto it = typeLayouts.find(getTypeLayoutKey(type, rule, isRowMajor));
+  return it == typeLayouts.end() ? nullptr : &it->second;
+}
+
+void SpirvContext::registerTypeLayout(QualType type, SpirvLayoutRule rule,
+                                      llvm::Optional<bool> isRowMajor,
+                                      const TypeLayout &layout) {
+  typeLayouts[getTypeLayoutKey(type, rule, isRowMajor)] = layout;
+}
+
 } // end namespace spirv
 } // end namespace clang
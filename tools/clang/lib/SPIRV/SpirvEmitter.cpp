@@ -19,9 +19,11 @@
 #include "spirv-tools/optimizer.hpp"
 #include "clang/SPIRV/AstTypeProbe.h"
 #include "clang/Sema/Sema.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringExtras.h"
 
 #include "InitListHandler.h"
+#include "LegalizationCache.h"
 #include "dxc/DXIL/DxilConstants.h"
 
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
@@ -554,11 +556,10 @@ SpirvEmitter::SpirvEmitter(CompilerInstance &ci)
   }
 }
 
-std::vector<SpirvVariable *>
-SpirvEmitter::getInterfacesForEntryPoint(SpirvFunction *entryPoint) {
-  auto stageVars = declIdMapper.collectStageVars(entryPoint);
+std::vector<SpirvVariable *> SpirvEmitter::getModuleInterfaceVariables() {
+  std::vector<SpirvVariable *> moduleInterfaces;
   if (!featureManager.isTargetEnvVulkan1p2OrAbove())
-    return stageVars;
+    return moduleInterfaces;
 
   // In SPIR-V 1.4 or above, we must include global variables in the 'Interface'
   // operands of OpEntryPoint. SpirvModule keeps all global variables, but some
@@ -566,20 +567,28 @@ SpirvEmitter::getInterfacesForEntryPoint(SpirvFunction *entryPoint) {
   // declIdMapper keeps the mapping between variables with Input or Output
   // storage class and their storage class, we have to rely on
   // declIdMapper.collectStageVars() to collect them.
-  llvm::DenseSet<SpirvVariable *> interfaces;
-  interfaces.insert(stageVars.begin(), stageVars.end());
   for (auto *moduleVar : spvBuilder.getModule()->getVariables()) {
     if (moduleVar->getStorageClass() != spv::StorageClass::Input &&
         moduleVar->getStorageClass() != spv::StorageClass::Output) {
-      interfaces.insert(moduleVar);
+      moduleInterfaces.push_back(moduleVar);
     }
   }
-  std::vector<SpirvVariable *> interfacesInVector;
-  interfacesInVector.reserve(interfaces.size());
-  for (auto *interface : interfaces) {
-    interfacesInVector.push_back(interface);
-  }
-  return interfacesInVector;
+  return moduleInterfaces;
+}
+
+std::vector<SpirvVariable *> SpirvEmitter::getInterfacesForEntryPoint(
+    const std::vector<SpirvVariable *> &stageVars,
+    llvm::ArrayRef<SpirvVariable *> moduleInterfaces) {
+  if (moduleInterfaces.empty())
+    return stageVars;
+
+  // Stage variables come first, followed by the module variables, each in the
+  // order they were created, so that the operands do not depend on pointer
+  // values.
+  llvm::SetVector<SpirvVariable *> interfaces;
+  interfaces.insert(stageVars.begin(), stageVars.end());
+  interfaces.insert(moduleInterfaces.begin(), moduleInterfaces.end());
+  return std::vector<SpirvVariable *>(interfaces.begin(), interfaces.end());
 }
 
 void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
@@ -639,14 +648,25 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
   // 'shader' attribute, and must therefore be entry functions.
   assert(numEntryPoints <= workQueue.size());
 
+  // Collect the interfaces of all entry points at once; libraries can have
+  // thousands of entry points, so avoid walking all stage and module variables
+  // for each of them.
+  llvm::SmallVector<SpirvFunction *, 4> entryFunctions;
+  for (uint32_t i = 0; i < numEntryPoints; ++i) {
+    assert(workQueue[i]->isEntryFunction);
+    entryFunctions.push_back(workQueue[i]->entryFunction);
+  }
+  auto stageVarsForEntry = declIdMapper.collectStageVars(entryFunctions);
+  const auto moduleInterfaces = getModuleInterfaceVariables();
+
   for (uint32_t i = 0; i < numEntryPoints; ++i) {
     // TODO: assign specific StageVars w.r.t. to entry point
     const FunctionInfo *entryInfo = workQueue[i];
-    assert(entryInfo->isEntryFunction);
     spvBuilder.addEntryPoint(
         getSpirvShaderStage(entryInfo->shaderModelKind),
         entryInfo->entryFunction, entryInfo->funcDecl->getName(),
-        getInterfacesForEntryPoint(entryInfo->entryFunction));
+        getInterfacesForEntryPoint(stageVarsForEntry[entryInfo->entryFunction],
+                                   moduleInterfaces));
   }
 
   // Add Location decorations to stage input/output variables.
@@ -671,36 +691,14 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
                       spirvOptions.flattenResourceArrays ||
                       declIdMapper.requiresFlatteningCompositeResources();
 
+  const bool needsOptimization =
+      theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0;
+
   if (spirvOptions.codeGenHighLevel) {
     beforeHlslLegalization = needsLegalization;
-  } else {
-    // Run legalization passes
-    if (needsLegalization) {
-      std::string messages;
-      if (!spirvToolsLegalize(&m, &messages)) {
-        emitFatalError("failed to legalize SPIR-V: %0", {}) << messages;
-        emitNote("please file a bug report on "
-                 "https://github.com/Microsoft/DirectXShaderCompiler/issues "
-                 "with source code if possible",
-                 {});
-        return;
-      } else if (!messages.empty()) {
-        emitWarning("SPIR-V legalization: %0", {}) << messages;
-      }
-    }
-
-    // Run optimization passes
-    if (theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0) {
-      std::string messages;
-      if (!spirvToolsOptimize(&m, &messages)) {
-        emitFatalError("failed to optimize SPIR-V: %0", {}) << messages;
-        emitNote("please file a bug report on "
-                 "https://github.com/Microsoft/DirectXShaderCompiler/issues "
-                 "with source code if possible",
-                 {});
-        return;
-      }
-    }
+  } else if (needsLegalization || needsOptimization) {
+    if (!runSpirvToolsPasses(&m, needsLegalization, needsOptimization))
+      return;
   }
 
   // Validate the generated SPIR-V code
@@ -3128,7 +3126,8 @@ SpirvEmitter::processByteAddressBufferStructuredBufferGetDimensions(
   if (isStructuredBuf) {
     // For (RW)StructuredBuffer, the stride of the runtime array (which is the
     // size of the struct) must also be written to the second argument.
-    AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions);
+    AlignmentSizeCalculator alignmentCalc(astContext, spvContext,
+                                          spirvOptions);
     uint32_t size = 0, stride = 0;
     std::tie(std::ignore, size) =
         alignmentCalc.getAlignmentAndSize(type, spirvOptions.sBufferLayoutRule,
@@ -12337,23 +12336,94 @@ bool SpirvEmitter::spirvToolsOptimize(std::vector<uint32_t> *mod,
   spvtools::OptimizerOptions options;
   options.set_run_validator(false);
 
-  if (spirvOptions.optConfig.empty()) {
-    // Add performance passes.
-    optimizer.RegisterPerformancePasses();
+  if (!registerOptimizationPasses(&optimizer))
+    return false;
 
-    // Add compact ID pass.
-    optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
+  return optimizer.Run(mod->data(), mod->size(), mod, options);
+}
+
+bool SpirvEmitter::runSpirvToolsPasses(std::vector<uint32_t> *mod,
+                                       bool needsLegalization,
+                                       bool needsOptimization) {
+  // Permutations that differ only in descriptor set and binding numbers can
+  // share the result of the passes: run them on the module with its binding
+  // decorations replaced by ordinals, and put the actual numbers back into
+  // the result. Resource flattening derives new binding numbers from the
+  // original ones, so it cannot take part.
+  const bool reuse = spirvOptions.reuseLegalization &&
+                     !spirvOptions.flattenResourceArrays &&
+                     !declIdMapper.requiresFlatteningCompositeResources();
+  std::vector<uint32_t> bindings;
+  std::string cacheKey;
+  if (reuse) {
+    extractBindingDecorations(mod, &bindings);
+
+    // The recipe covers everything that selects the passes to run.
+    std::string recipe =
+        std::to_string(static_cast<int>(featureManager.getTargetEnv()));
+    if (needsLegalization)
+      recipe += ",legalize";
+    if (needsOptimization)
+      recipe += ",O" + std::to_string(theCompilerInstance.getCodeGenOpts()
+                                          .OptimizationLevel);
+    for (const auto &flag : spirvOptions.optConfig)
+      recipe += "," + flag.str();
+    cacheKey = LegalizationCache::computeKey(recipe, *mod);
+
+    std::vector<uint32_t> cached;
+    if (LegalizationCache::get().lookup(cacheKey, &cached) &&
+        restoreBindingDecorations(&cached, bindings)) {
+      mod->swap(cached);
+      return true;
+    }
+  }
+
+  std::string messages;
+  if (needsLegalization && needsOptimization) {
+    // Run legalization and optimization passes in one optimizer, so the
+    // module is parsed into its IR and serialized back only once.
+    if (!spirvToolsLegalizeAndOptimize(mod, &messages)) {
+      emitFatalError("failed to legalize or optimize SPIR-V: %0", {})
+          << messages;
+      emitNote("please file a bug report on "
+               "https://github.com/Microsoft/DirectXShaderCompiler/issues "
+               "with source code if possible",
+               {});
+      return false;
+    }
+  } else if (needsLegalization) {
+    if (!spirvToolsLegalize(mod, &messages)) {
+      emitFatalError("failed to legalize SPIR-V: %0", {}) << messages;
+      emitNote("please file a bug report on "
+               "https://github.com/Microsoft/DirectXShaderCompiler/issues "
+               "with source code if possible",
+               {});
+      return false;
+    }
   } else {
-    // Command line options use llvm::SmallVector and llvm::StringRef, whereas
-    // SPIR-V optimizer uses std::vector and std::string.
-    std::vector<std::string> stdFlags;
-    for (const auto &f : spirvOptions.optConfig)
-      stdFlags.push_back(f.str());
-    if (!optimizer.RegisterPassesFromFlags(stdFlags))
+    if (!spirvToolsOptimize(mod, &messages)) {
+      emitFatalError("failed to optimize SPIR-V: %0", {}) << messages;
+      emitNote("please file a bug report on "
+               "https://github.com/Microsoft/DirectXShaderCompiler/issues "
+               "with source code if possible",
+               {});
       return false;
+    }
   }
+  if (!messages.empty() && needsLegalization)
+    emitWarning("SPIR-V legalization: %0", {}) << messages;
 
-  return optimizer.Run(mod->data(), mod->size(), mod, options);
+  if (reuse) {
+    // Modules whose passes warned are not stored, so that every compile that
+    // would report the warning still runs the passes.
+    if (messages.empty())
+      LegalizationCache::get().store(cacheKey, *mod);
+    if (!restoreBindingDecorations(mod, bindings)) {
+      emitFatalError("failed to restore SPIR-V binding decorations", {});
+      return false;
+    }
+  }
+  return true;
 }
 
 bool SpirvEmitter::spirvToolsLegalize(std::vector<uint32_t> *mod,
@@ -12366,19 +12436,82 @@ bool SpirvEmitter::spirvToolsLegalize(std::vector<uint32_t> *mod,
 
   spvtools::OptimizerOptions options;
   options.set_run_validator(false);
-  optimizer.RegisterLegalizationPasses();
+  registerLegalizationPasses(&optimizer);
+
+  return optimizer.Run(mod->data(), mod->size(), mod, options);
+}
+
+bool SpirvEmitter::spirvToolsLegalizeAndOptimize(std::vector<uint32_t> *mod,
+                                                 std::string *messages) {
+  spvtools::Optimizer optimizer(featureManager.getTargetEnv());
+  optimizer.SetMessageConsumer(
+      [messages](spv_message_level_t /*level*/, const char * /*source*/,
+                 const spv_position_t & /*position*/,
+                 const char *message) { *messages += message; });
+
+  spvtools::OptimizerOptions options;
+  options.set_run_validator(false);
+  // Same passes, in the same order, as legalizing and then optimizing.
+  registerLegalizationPasses(&optimizer);
+  if (!registerOptimizationPasses(&optimizer))
+    return false;
+
+  return optimizer.Run(mod->data(), mod->size(), mod, options);
+}
+
+void SpirvEmitter::registerLegalizationPasses(spvtools::Optimizer *optimizer) {
+  optimizer->RegisterLegalizationPasses();
   // Add flattening of resources if needed.
   if (spirvOptions.flattenResourceArrays ||
       declIdMapper.requiresFlatteningCompositeResources()) {
-    optimizer.RegisterPass(spvtools::CreateDescriptorScalarReplacementPass());
+    optimizer->RegisterPass(spvtools::CreateDescriptorScalarReplacementPass());
     // ADCE should be run after desc_sroa in order to remove potentially
     // illegal types such as structures containing opaque types.
-    optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass());
+    optimizer->RegisterPass(spvtools::CreateAggressiveDCEPass());
+  }
+  optimizer->RegisterPass(spvtools::CreateReplaceInvalidOpcodePass());
+  optimizer->RegisterPass(spvtools::CreateCompactIdsPass());
+}
+
+bool SpirvEmitter::registerOptimizationPasses(spvtools::Optimizer *optimizer) {
+  if (spirvOptions.optConfig.empty() &&
+      theCompilerInstance.getCodeGenOpts().OptimizationLevel == 1) {
+    // -O1 is the fast tier: a single round of the cheap cleanups, rather than
+    // the repeated inlining, SSA rewriting and ADCE of the performance passes.
+    static const std::vector<std::string> fastFlags = {
+        "--merge-return",
+        "--inline-entry-points-exhaustive",
+        "--eliminate-dead-functions",
+        "--private-to-local",
+        "--eliminate-local-single-block",
+        "--eliminate-local-single-store",
+        "--scalar-replacement=100",
+        "--ssa-rewrite",
+        "--ccp",
+        "--simplify-instructions",
+        "--eliminate-dead-branches",
+        "--merge-blocks",
+        "--eliminate-dead-code-aggressive",
+        "--compact-ids",
+    };
+    return optimizer->RegisterPassesFromFlags(fastFlags);
   }
-  optimizer.RegisterPass(spvtools::CreateReplaceInvalidOpcodePass());
-  optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
 
-  return optimizer.Run(mod->data(), mod->size(), mod, options);
+  if (spirvOptions.optConfig.empty()) {
+    // Add performance passes.
+    optimizer->RegisterPerformancePasses();
+
+    // Add compact ID pass.
+    optimizer->RegisterPass(spvtools::CreateCompactIdsPass());
+    return true;
+  }
+
+  // Command line options use llvm::SmallVector and llvm::StringRef, whereas
+  // SPIR-V optimizer uses std::vector and std::string.
+  std::vector<std::string> stdFlags;
+  for (const auto &f : spirvOptions.optConfig)
+    stdFlags.push_back(f.str());
+  return optimizer->RegisterPassesFromFlags(stdFlags);
 }
 
 SpirvInstruction *
@@ -12395,7 +12528,7 @@ SpirvEmitter::doUnaryExprOrTypeTraitExpr(const UnaryExprOrTypeTraitExpr *expr) {
     return constExpr;
   }
 
-  AlignmentSizeCalculator alignmentCalc(astContext, spirvOptions);
+  AlignmentSizeCalculator alignmentCalc(astContext, spvContext, spirvOptions);
   uint32_t size = 0, stride = 0;
   std::tie(std::ignore, size) = alignmentCalc.getAlignmentAndSize(
       expr->getArgumentType(), SpirvLayoutRule::Scalar,
@@ -35,6 +35,10 @@
 
 #include "DeclResultIdMapper.h"
 
+namespace spvtools {
+class Optimizer;
+} // namespace spvtools
+
 namespace clang {
 namespace spirv {
 
@@ -50,6 +54,7 @@ public:
 
   ASTContext &getASTContext() { return astContext; }
   SpirvBuilder &getSpirvBuilder() { return spvBuilder; }
+  SpirvContext &getSpirvContext() { return spvContext; }
   DiagnosticsEngine &getDiagnosticsEngine() { return diags; }
   CompilerInstance &getCompilerInstance() { return theCompilerInstance; }
   SpirvCodeGenOptions &getSpirvOptions() { return spirvOptions; }
@@ -1013,9 +1018,17 @@ private:
                     SourceLocation loc);
 
   /// \brief Returns OpVariable to be used as 'Interface' operands of
-  /// OpEntryPoint. entryPoint is the SpirvFunction for the OpEntryPoint.
-  std::vector<SpirvVariable *>
-  getInterfacesForEntryPoint(SpirvFunction *entryPoint);
+  /// OpEntryPoint, given the stage variables of the entry point and the
+  /// module variables that every entry point lists (see
+  /// getModuleInterfaceVariables).
+  std::vector<SpirvVariable *> getInterfacesForEntryPoint(
+      const std::vector<SpirvVariable *> &stageVars,
+      llvm::ArrayRef<SpirvVariable *> moduleInterfaces);
+
+  /// \brief Returns the module variables other than stage inputs and outputs
+  /// that must be 'Interface' operands of every OpEntryPoint. This is empty
+  /// before SPIR-V 1.4.
+  std::vector<SpirvVariable *> getModuleInterfaceVariables();
 
 private:
   /// \brief If the given FunctionDecl is not already in the workQueue, creates
@@ -1037,6 +1050,30 @@ private:
   /// Returns true on success and false otherwise.
   bool spirvToolsLegalize(std::vector<uint32_t> *mod, std::string *messages);
 
+  /// \brief Helper function to run SPIRV-Tools legalization and then
+  /// performance passes with a single optimizer, so that |mod| is parsed and
+  /// serialized once instead of once per step. Gets the info/warning/error
+  /// messages via |messages|.
+  /// Returns true on success and false otherwise.
+  bool spirvToolsLegalizeAndOptimize(std::vector<uint32_t> *mod,
+                                     std::string *messages);
+
+  /// \brief Runs the requested legalization and/or optimization passes on
+  /// |mod| and reports failures. With -fspv-reuse-legalization, reuses the
+  /// result of an earlier compile of a module that differs from |mod| only
+  /// in its descriptor set and binding numbers.
+  /// Returns true on success and false otherwise.
+  bool runSpirvToolsPasses(std::vector<uint32_t> *mod, bool needsLegalization,
+                           bool needsOptimization);
+
+  /// \brief Adds the legalization passes to |optimizer|.
+  void registerLegalizationPasses(spvtools::Optimizer *optimizer);
+
+  /// \brief Adds the performance passes, the fast recipe at -O1, or the
+  /// passes given by -Oconfig, to |optimizer|. Returns false if -Oconfig has
+  /// an invalid flag.
+  bool registerOptimizationPasses(spvtools::Optimizer *optimizer);
+
   /// \brief Helper function to run the SPIRV-Tools validator.
   /// Runs the SPIRV-Tools validator on the given SPIR-V module |mod|, and
   /// gets the info/warning/error messages via |messages|.
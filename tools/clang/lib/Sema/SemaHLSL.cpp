@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Attr.h"
 #include "clang/AST/DeclCXX.h"
@@ -40,6 +41,7 @@
 #include "dxc/HLSL/HLOperations.h"
 #include "dxc/DXIL/DxilShaderModel.h"
 #include <array>
+#include <map>
 #include <algorithm>
 #include <float.h>
 
@@ -2628,6 +2630,46 @@ public:
   }
 };
 
+/// <summary>Hashes an intrinsic name; matches hash_hlsl_intrinsic_name in hctdb_instrhelp.py.</summary>
+static UINT HashIntrinsicName(StringRef name) {
+  UINT hash = 0x811c9dc5;
+  for (char c : name)
+    hash = (hash ^ (unsigned char)c) * 0x01000193;
+  return hash;
+}
+
+/// <summary>
+/// Finds the entries of a built-in intrinsic table with the given name, which
+/// are adjacent, through the table's generated name index.
+/// </summary>
+/// <returns>false if the name is not in the table.</returns>
+static bool FindIntrinsicNameRange(
+  _In_count_(tableSize) const HLSL_INTRINSIC *table, size_t tableSize,
+  StringRef name, _Out_ size_t *first, _Out_ size_t *count)
+{
+  for (const HLSL_INTRINSIC_NAME_INDEX_TABLE &indexTable : g_IntrinsicNameIndexTables) {
+    if (indexTable.pIntrinsics != table)
+      continue;
+    const UINT hash = HashIntrinsicName(name);
+    const UINT mask = indexTable.uIndexSize - 1;
+    for (UINT slot = hash & mask;; slot = (slot + 1) & mask) {
+      const HLSL_INTRINSIC_NAME_INDEX &entry = indexTable.pIndex[slot];
+      if (entry.uCount == 0)
+        return false;
+      if (entry.uHash == hash && name.equals(table[entry.uFirst].pArgs[0].pName)) {
+        *first = entry.uFirst;
+        *count = entry.uCount;
+        return true;
+      }
+    }
+  }
+
+  // Not a generated table; its entries could be anywhere.
+  *first = 0;
+  *count = tableSize;
+  return true;
+}
+
 static void AddHLSLSubscriptAttr(Decl *D, ASTContext &context, HLSubscriptOpcode opcode) {
   StringRef group = GetHLOpcodeGroupName(HLOpcodeGroup::HLSubscript);
   D->addAttr(HLSLIntrinsicAttr::CreateImplicit(context, group, "", static_cast<unsigned>(opcode)));
@@ -3046,16 +3088,26 @@ private:
   QualType m_hlslStringType;
   TypedefDecl* m_hlslStringTypedef;
 
-  // Built-in object types declarations, indexed by basic kind constant.
+  // Built-in object types declarations, indexed by basic kind constant;
+  // null until the type is first looked up.
   CXXRecordDecl* m_objectTypeDecls[_countof(g_ArBasicKindsAsTypes)];
-  // Map from object decl to the object index.
-  using ObjectTypeDeclMapType = std::array<std::pair<CXXRecordDecl*,unsigned>, _countof(g_ArBasicKindsAsTypes)+_countof(g_DeprecatedEffectObjectNames)>;
-  ObjectTypeDeclMapType m_objectTypeDeclsMap;
+  // Deprecated effect object declarations, null until first looked up.
+  CXXRecordDecl* m_effectObjectDecls[_countof(g_DeprecatedEffectObjectNames)];
+  // 'sampler' alias for SamplerState, null until first looked up.
+  TypedefDecl* m_samplerTypedef;
+  // Map from declared object decl to the object index.
+  llvm::DenseMap<const CXXRecordDecl*, unsigned> m_objectTypeDeclsMap;
   // Mask for object which not has methods created.
   uint64_t m_objectTypeLazyInitMask;
 
   UsedIntrinsicStore m_usedIntrinsics;
 
+  // Signatures of successful intrinsic argument matches, keyed by the
+  // intrinsic followed by the object element, function template argument and
+  // call argument types.
+  typedef llvm::SmallVector<const void *, 8> IntrinsicMatchKey;
+  std::map<IntrinsicMatchKey, std::vector<QualType>> m_intrinsicMatches;
+
   /// <summary>Add all base QualTypes for each hlsl scalar types.</summary>
   void AddBaseTypes();
 
@@ -3420,22 +3472,11 @@ private:
     }
   }
 
-  static bool ObjectTypeDeclMapTypeCmp(const std::pair<CXXRecordDecl*,unsigned> &a,
-                           const std::pair<CXXRecordDecl*,unsigned> &b) {
-    return a.first < b.first;
-  };
-
   int FindObjectBasicKindIndex(const CXXRecordDecl* recordDecl) {
-    auto begin = m_objectTypeDeclsMap.begin();
-    auto end = m_objectTypeDeclsMap.end();
-    auto val = std::make_pair(const_cast<CXXRecordDecl*>(recordDecl), 0);
-    auto low = std::lower_bound(begin, end, val, ObjectTypeDeclMapTypeCmp);
-    if (low == end)
-      return -1;
-    if (recordDecl == low->first)
-      return low->second;
-    else
+    auto it = m_objectTypeDeclsMap.find(recordDecl);
+    if (it == m_objectTypeDeclsMap.end())
       return -1;
+    return it->second;
   }
 
 
@@ -3496,128 +3537,200 @@ private:
   }
 #endif // ENABLE_SPIRV_CODEGEN
 
-  // Adds all built-in HLSL object types.
-  void AddObjectTypes()
+  // Declares the built-in HLSL object type at index i of
+  // g_ArBasicKindsAsTypes the first time it is needed, along with the
+  // methods any registered intrinsic tables add to it.
+  CXXRecordDecl* GetOrDeclareObjectType(unsigned i)
   {
     DXASSERT(m_context != nullptr, "otherwise caller hasn't initialized context yet");
+    DXASSERT_NOMSG(i < _countof(g_ArBasicKindsAsTypes));
 
-    QualType float4Type = LookupVectorType(HLSLScalarType_float, 4);
-    TypeSourceInfo *float4TypeSourceInfo = m_context->getTrivialTypeSourceInfo(float4Type, NoLoc);
-    m_objectTypeLazyInitMask = 0;
-    unsigned effectKindIndex = 0;
-    for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++)
-    {
-      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
-      if (kind == AR_OBJECT_WAVE) { // wave objects are currently unused
-        continue;
-      }
-      if (kind == AR_OBJECT_LEGACY_EFFECT)
-        effectKindIndex = i;
-
-      DXASSERT(kind < _countof(g_ArBasicTypeNames), "g_ArBasicTypeNames has the wrong number of entries");
-      _Analysis_assume_(kind < _countof(g_ArBasicTypeNames));
-      const char* typeName = g_ArBasicTypeNames[kind];
-      uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
-      CXXRecordDecl* recordDecl = nullptr;
-      if (kind == AR_OBJECT_RAY_DESC) {
-        QualType float3Ty = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 3);
-        recordDecl = CreateRayDescStruct(*m_context, float3Ty);
-      } else if (kind == AR_OBJECT_TRIANGLE_INTERSECTION_ATTRIBUTES) {
-        QualType float2Type = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 2);
-        recordDecl = AddBuiltInTriangleIntersectionAttributes(*m_context, float2Type);
-      } else if (IsSubobjectBasicKind(kind)) {
-        switch (kind) {
-        case AR_OBJECT_STATE_OBJECT_CONFIG:
-          recordDecl = CreateSubobjectStateObjectConfig(*m_context);
-          break;
-        case AR_OBJECT_GLOBAL_ROOT_SIGNATURE:
-          recordDecl = CreateSubobjectRootSignature(*m_context, true);
-          break;
-        case AR_OBJECT_LOCAL_ROOT_SIGNATURE:
-          recordDecl = CreateSubobjectRootSignature(*m_context, false);
-          break;
-        case AR_OBJECT_SUBOBJECT_TO_EXPORTS_ASSOC:
-          recordDecl = CreateSubobjectSubobjectToExportsAssoc(*m_context);
-          break;
-        case AR_OBJECT_RAYTRACING_SHADER_CONFIG:
-          recordDecl = CreateSubobjectRaytracingShaderConfig(*m_context);
-          break;
-        case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG:
-          recordDecl = CreateSubobjectRaytracingPipelineConfig(*m_context);
-          break;
-        case AR_OBJECT_TRIANGLE_HIT_GROUP:
-          recordDecl = CreateSubobjectTriangleHitGroup(*m_context);
-          break;
-        case AR_OBJECT_PROCEDURAL_PRIMITIVE_HIT_GROUP:
-          recordDecl = CreateSubobjectProceduralPrimitiveHitGroup(*m_context);
-          break;
-        case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG1:
-          recordDecl = CreateSubobjectRaytracingPipelineConfig1(*m_context);
-          break;
-        }
-      } else if (kind == AR_OBJECT_CONSTANT_BUFFER) {
-        recordDecl = DeclareConstantBufferViewType(*m_context, /*bTBuf*/false);
-      } else if (kind == AR_OBJECT_TEXTURE_BUFFER) {
-        recordDecl = DeclareConstantBufferViewType(*m_context, /*bTBuf*/true);
-      } else if (kind == AR_OBJECT_RAY_QUERY) {
-        recordDecl = DeclareRayQueryType(*m_context);
-      } else if (kind == AR_OBJECT_HEAP_RESOURCE) {
-        recordDecl = DeclareResourceType(*m_context, /*bSampler*/false);
-        // create Resource ResourceDescriptorHeap;
-        DeclareBuiltinGlobal("ResourceDescriptorHeap",
-                             m_context->getRecordType(recordDecl), *m_context);
-      } else if (kind == AR_OBJECT_HEAP_SAMPLER) {
-        recordDecl = DeclareResourceType(*m_context, /*bSampler*/true);
-        // create Resource SamplerDescriptorHeap;
-        DeclareBuiltinGlobal("SamplerDescriptorHeap",
-                             m_context->getRecordType(recordDecl), *m_context);
-
-      }
-      else if (kind == AR_OBJECT_FEEDBACKTEXTURE2D) {
-        recordDecl = DeclareUIntTemplatedTypeWithHandle(*m_context, "FeedbackTexture2D", "kind");
-      }
-      else if (kind == AR_OBJECT_FEEDBACKTEXTURE2D_ARRAY) {
-        recordDecl = DeclareUIntTemplatedTypeWithHandle(*m_context, "FeedbackTexture2DArray", "kind");
-      }
-      else if (templateArgCount == 0) {
-        recordDecl = DeclareRecordTypeWithHandle(*m_context, typeName);
-      }
-      else
-      {
-        DXASSERT(templateArgCount == 1 || templateArgCount == 2, "otherwise a new case has been added");
+    if (m_objectTypeDecls[i] != nullptr)
+      return m_objectTypeDecls[i];
 
-        TypeSourceInfo* typeDefault = TemplateHasDefaultType(kind) ? float4TypeSourceInfo : nullptr;
-        recordDecl = DeclareTemplateTypeWithHandle(*m_context, typeName, templateArgCount, typeDefault);
-      }
-      m_objectTypeDecls[i] = recordDecl;
-      m_objectTypeDeclsMap[i] = std::make_pair(recordDecl, i);
-      m_objectTypeLazyInitMask |= ((uint64_t)1)<<i;
+    ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+    if (kind == AR_OBJECT_WAVE) { // wave objects are currently unused
+      return nullptr;
     }
 
-    // Create an alias for SamplerState. 'sampler' is very commonly used.
+    DXASSERT(kind < _countof(g_ArBasicTypeNames), "g_ArBasicTypeNames has the wrong number of entries");
+    _Analysis_assume_(kind < _countof(g_ArBasicTypeNames));
+    const char* typeName = g_ArBasicTypeNames[kind];
+    uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
+    CXXRecordDecl* recordDecl = nullptr;
+    if (kind == AR_OBJECT_RAY_DESC) {
+      QualType float3Ty = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 3);
+      recordDecl = CreateRayDescStruct(*m_context, float3Ty);
+    } else if (kind == AR_OBJECT_TRIANGLE_INTERSECTION_ATTRIBUTES) {
+      QualType float2Type = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 2);
+      recordDecl = AddBuiltInTriangleIntersectionAttributes(*m_context, float2Type);
+    } else if (IsSubobjectBasicKind(kind)) {
+      switch (kind) {
+      case AR_OBJECT_STATE_OBJECT_CONFIG:
+        recordDecl = CreateSubobjectStateObjectConfig(*m_context);
+        break;
+      case AR_OBJECT_GLOBAL_ROOT_SIGNATURE:
+        recordDecl = CreateSubobjectRootSignature(*m_context, true);
+        break;
+      case AR_OBJECT_LOCAL_ROOT_SIGNATURE:
+        recordDecl = CreateSubobjectRootSignature(*m_context, false);
+        break;
+      case AR_OBJECT_SUBOBJECT_TO_EXPORTS_ASSOC:
+        recordDecl = CreateSubobjectSubobjectToExportsAssoc(*m_context);
+        break;
+      case AR_OBJECT_RAYTRACING_SHADER_CONFIG:
+        recordDecl = CreateSubobjectRaytracingShaderConfig(*m_context);
+        break;
+      case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG:
+        recordDecl = CreateSubobjectRaytracingPipelineConfig(*m_context);
+        break;
+      case AR_OBJECT_TRIANGLE_HIT_GROUP:
+        recordDecl = CreateSubobjectTriangleHitGroup(*m_context);
+        break;
+      case AR_OBJECT_PROCEDURAL_PRIMITIVE_HIT_GROUP:
+        recordDecl = CreateSubobjectProceduralPrimitiveHitGroup(*m_context);
+        break;
+      case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG1:
+        recordDecl = CreateSubobjectRaytracingPipelineConfig1(*m_context);
+        break;
+      }
+    } else if (kind == AR_OBJECT_CONSTANT_BUFFER) {
+      recordDecl = DeclareConstantBufferViewType(*m_context, /*bTBuf*/false);
+    } else if (kind == AR_OBJECT_TEXTURE_BUFFER) {
+      recordDecl = DeclareConstantBufferViewType(*m_context, /*bTBuf*/true);
+    } else if (kind == AR_OBJECT_RAY_QUERY) {
+      recordDecl = DeclareRayQueryType(*m_context);
+    } else if (kind == AR_OBJECT_HEAP_RESOURCE) {
+      recordDecl = DeclareResourceType(*m_context, /*bSampler*/false);
+      // create Resource ResourceDescriptorHeap;
+      DeclareBuiltinGlobal("ResourceDescriptorHeap",
+                           m_context->getRecordType(recordDecl), *m_context);
+    } else if (kind == AR_OBJECT_HEAP_SAMPLER) {
+      recordDecl = DeclareResourceType(*m_context, /*bSampler*/true);
+      // create Resource SamplerDescriptorHeap;
+      DeclareBuiltinGlobal("SamplerDescriptorHeap",
+                           m_context->getRecordType(recordDecl), *m_context);
+
+    }
+    else if (kind == AR_OBJECT_FEEDBACKTEXTURE2D) {
+      recordDecl = DeclareUIntTemplatedTypeWithHandle(*m_context, "FeedbackTexture2D", "kind");
+    }
+    else if (kind == AR_OBJECT_FEEDBACKTEXTURE2D_ARRAY) {
+      recordDecl = DeclareUIntTemplatedTypeWithHandle(*m_context, "FeedbackTexture2DArray", "kind");
+    }
+    else if (templateArgCount == 0) {
+      recordDecl = DeclareRecordTypeWithHandle(*m_context, typeName);
+    }
+    else
     {
-      DeclContext* currentDeclContext = m_context->getTranslationUnitDecl();
-      IdentifierInfo& samplerId = m_context->Idents.get(StringRef("sampler"), tok::TokenKind::identifier);
-      TypeSourceInfo* samplerTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_SAMPLER));
-      TypedefDecl* samplerDecl = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &samplerId, samplerTypeSource);
-      currentDeclContext->addDecl(samplerDecl);
-      samplerDecl->setImplicit(true);
+      DXASSERT(templateArgCount == 1 || templateArgCount == 2, "otherwise a new case has been added");
 
-      // Create decls for each deprecated effect object type:
-      unsigned effectObjBase = _countof(g_ArBasicKindsAsTypes);
-      // TypeSourceInfo* effectObjTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_LEGACY_EFFECT));
-      for (unsigned i = 0; i < _countof(g_DeprecatedEffectObjectNames); i++) {
-        IdentifierInfo& idInfo = m_context->Idents.get(StringRef(g_DeprecatedEffectObjectNames[i]), tok::TokenKind::identifier);
-        //TypedefDecl* effectObjDecl = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &idInfo, effectObjTypeSource);
-        CXXRecordDecl *effectObjDecl = CXXRecordDecl::Create(*m_context, TagTypeKind::TTK_Struct, currentDeclContext, NoLoc, NoLoc, &idInfo);
-        currentDeclContext->addDecl(effectObjDecl);
-        effectObjDecl->setImplicit(true);
-        m_objectTypeDeclsMap[i+effectObjBase] = std::make_pair(effectObjDecl, effectKindIndex);
+      TypeSourceInfo* typeDefault = nullptr;
+      if (TemplateHasDefaultType(kind)) {
+        QualType float4Type = LookupVectorType(HLSLScalarType_float, 4);
+        typeDefault = m_context->getTrivialTypeSourceInfo(float4Type, NoLoc);
       }
+      recordDecl = DeclareTemplateTypeWithHandle(*m_context, typeName, templateArgCount, typeDefault);
+    }
+    m_objectTypeDecls[i] = recordDecl;
+    m_objectTypeDeclsMap[recordDecl] = i;
+    m_objectTypeLazyInitMask |= ((uint64_t)1)<<i;
+
+    for (auto && table : m_intrinsicTables) {
+      AddIntrinsicTableMethods(table, i);
     }
+    return recordDecl;
+  }
+
+  // Declares the 'sampler' alias for SamplerState, which is very commonly used.
+  TypedefDecl* GetOrDeclareSamplerTypedef()
+  {
+    if (m_samplerTypedef != nullptr)
+      return m_samplerTypedef;
+
+    DeclContext* currentDeclContext = m_context->getTranslationUnitDecl();
+    IdentifierInfo& samplerId = m_context->Idents.get(StringRef("sampler"), tok::TokenKind::identifier);
+    TypeSourceInfo* samplerTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_SAMPLER));
+    m_samplerTypedef = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &samplerId, samplerTypeSource);
+    currentDeclContext->addDecl(m_samplerTypedef);
+    m_samplerTypedef->setImplicit(true);
+    return m_samplerTypedef;
+  }
+
+  // Declares the deprecated effect object type at index i of
+  // g_DeprecatedEffectObjectNames.
+  CXXRecordDecl* GetOrDeclareEffectObject(unsigned i)
+  {
+    DXASSERT_NOMSG(i < _countof(g_DeprecatedEffectObjectNames));
+    if (m_effectObjectDecls[i] != nullptr)
+      return m_effectObjectDecls[i];
 
-    // Make sure it's in order.
-    std::sort(m_objectTypeDeclsMap.begin(), m_objectTypeDeclsMap.end(), ObjectTypeDeclMapTypeCmp);
+    const ArBasicKind* match = std::find(g_ArBasicKindsAsTypes, &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], AR_OBJECT_LEGACY_EFFECT);
+    DXASSERT(match != &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], "otherwise can't find constant in basic kinds");
+    unsigned effectKindIndex = match - g_ArBasicKindsAsTypes;
+
+    DeclContext* currentDeclContext = m_context->getTranslationUnitDecl();
+    IdentifierInfo& idInfo = m_context->Idents.get(StringRef(g_DeprecatedEffectObjectNames[i]), tok::TokenKind::identifier);
+    CXXRecordDecl *effectObjDecl = CXXRecordDecl::Create(*m_context, TagTypeKind::TTK_Struct, currentDeclContext, NoLoc, NoLoc, &idInfo);
+    currentDeclContext->addDecl(effectObjDecl);
+    effectObjDecl->setImplicit(true);
+    m_effectObjectDecls[i] = effectObjDecl;
+    m_objectTypeDeclsMap[effectObjDecl] = effectKindIndex;
+    return effectObjDecl;
+  }
+
+  enum class BuiltinNameKind { ObjectType, EffectObject, SamplerAlias, DescriptorHeap };
+  struct BuiltinName {
+    BuiltinNameKind Kind;
+    unsigned Index;
+  };
+
+  // Finds the built-in declaration a global name refers to, if any.
+  static bool LookupBuiltinName(StringRef name, BuiltinName *pResult)
+  {
+    static const llvm::StringMap<BuiltinName> names = []() {
+      llvm::StringMap<BuiltinName> result;
+      for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++) {
+        ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+        if (kind == AR_OBJECT_WAVE || kind == AR_OBJECT_LEGACY_EFFECT)
+          continue;
+        result[g_ArBasicTypeNames[kind]] = { BuiltinNameKind::ObjectType, i };
+        if (kind == AR_OBJECT_HEAP_RESOURCE)
+          result["ResourceDescriptorHeap"] = { BuiltinNameKind::DescriptorHeap, i };
+        else if (kind == AR_OBJECT_HEAP_SAMPLER)
+          result["SamplerDescriptorHeap"] = { BuiltinNameKind::DescriptorHeap, i };
+      }
+      for (unsigned i = 0; i < _countof(g_DeprecatedEffectObjectNames); i++)
+        result[g_DeprecatedEffectObjectNames[i]] = { BuiltinNameKind::EffectObject, i };
+      result["sampler"] = { BuiltinNameKind::SamplerAlias, 0 };
+      return result;
+    }();
+    auto it = names.find(name);
+    if (it == names.end())
+      return false;
+    *pResult = it->second;
+    return true;
+  }
+
+  // Declares the built-in object type, alias or global a name refers to, so
+  // a translation unit lookup of the name finds it. Returns false if the name
+  // is not built-in.
+  bool DeclareBuiltinName(StringRef name)
+  {
+    BuiltinName builtin;
+    if (!LookupBuiltinName(name, &builtin))
+      return false;
+    switch (builtin.Kind) {
+    case BuiltinNameKind::ObjectType:
+    case BuiltinNameKind::DescriptorHeap:
+      // The descriptor heap globals are declared with their record types.
+      return GetOrDeclareObjectType(builtin.Index) != nullptr;
+    case BuiltinNameKind::EffectObject:
+      return GetOrDeclareEffectObject(builtin.Index) != nullptr;
+    case BuiltinNameKind::SamplerAlias:
+      return GetOrDeclareSamplerTypedef() != nullptr;
+    }
+    return false;
   }
 
   FunctionDecl* AddSubscriptSpecialization(
@@ -3673,8 +3786,12 @@ public:
     m_vkNSDecl(nullptr),
     m_context(nullptr),
     m_sema(nullptr),
-    m_hlslStringTypedef(nullptr)
+    m_hlslStringTypedef(nullptr),
+    m_samplerTypedef(nullptr),
+    m_objectTypeLazyInitMask(0)
   {
+    memset(m_objectTypeDecls, 0, sizeof(m_objectTypeDecls));
+    memset(m_effectObjectDecls, 0, sizeof(m_effectObjectDecls));
     memset(m_matrixTypes, 0, sizeof(m_matrixTypes));
     memset(m_matrixShorthandTypes, 0, sizeof(m_matrixShorthandTypes));
     memset(m_vectorTypes, 0, sizeof(m_vectorTypes));
@@ -3703,11 +3820,9 @@ public:
     m_sema = &S;
     S.addExternalSource(this);
 
-    AddObjectTypes();
+    // Built-in object types are declared on first lookup, see
+    // LookupUnqualified and GetOrDeclareObjectType.
     AddStdIsEqualImplementation(context, S);
-    for (auto && intrinsic : m_intrinsicTables) {
-      AddIntrinsicTableMethods(intrinsic);
-    }
 
 #ifdef ENABLE_SPIRV_CODEGEN
     if (m_sema->getLangOpts().SPIRV) {
@@ -3773,6 +3888,52 @@ public:
     return qt;
   }
 
+  /// <summary>Gets the canonical type of the vector or matrix specialization for converted template arguments.</summary>
+  /// <remarks>
+  /// Template instantiation spells these specializations again for every
+  /// set of template arguments; this finds them in the tables above rather
+  /// than by hashing the arguments. Returns a null type for other templates
+  /// and for arguments the tables do not hold.
+  /// </remarks>
+  QualType LookupVectorOrMatrixCanonType(ClassTemplateDecl *templateDecl, ArrayRef<TemplateArgument> args)
+  {
+    if (m_matrixTemplateDecl == nullptr || m_vectorTemplateDecl == nullptr)
+      return QualType();
+    bool isMatrix = templateDecl->getCanonicalDecl() == m_matrixTemplateDecl->getCanonicalDecl();
+    bool isVector = templateDecl->getCanonicalDecl() == m_vectorTemplateDecl->getCanonicalDecl();
+    if ((!isMatrix && !isVector) || args.size() != (isMatrix ? 3u : 2u) ||
+        args[0].getKind() != TemplateArgument::Type) {
+      return QualType();
+    }
+
+    unsigned dims[2] = { 1, 1 };
+    for (unsigned i = 1; i < args.size(); i++) {
+      if (args[i].getKind() != TemplateArgument::Integral)
+        return QualType();
+      llvm::APSInt value = args[i].getAsIntegral();
+      if (!value.isStrictlyPositive() || value.getLimitedValue() > 4)
+        return QualType();
+      dims[i - 1] = (unsigned)value.getLimitedValue();
+    }
+
+    // Only take element types that are exactly a scalar type already in use;
+    // several basic kinds share a scalar type (long and int, enums and int).
+    CanQualType eltType = m_context->getCanonicalType(args[0].getAsType());
+    ArBasicKind kind = BasicTypeForScalarType(eltType);
+    if (kind >= AR_BASIC_COUNT)
+      return QualType();
+    HLSLScalarType scalarType = ScalarTypeForBasic(kind);
+    if (scalarType == HLSLScalarType_unknown ||
+        m_scalarTypes[scalarType].isNull() ||
+        m_context->getCanonicalType(m_scalarTypes[scalarType]) != eltType) {
+      return QualType();
+    }
+
+    QualType qt = isMatrix ? LookupMatrixType(scalarType, dims[0], dims[1])
+                           : LookupVectorType(scalarType, dims[0]);
+    return qt.getCanonicalType();
+  }
+
   TypedefDecl* GetStringTypedef() {
     if (m_hlslStringTypedef == nullptr) {
       m_hlslStringTypedef = CreateGlobalTypedef(m_context, "string", m_hlslStringType);
@@ -3905,6 +4066,13 @@ public:
       TypedefDecl *strDecl = GetStringTypedef();
       R.addDecl(strDecl);
     }
+    // built-in object types, their aliases and globals
+    else if (DeclareBuiltinName(nameIdentifier)) {
+      for (NamedDecl *decl : m_context->getTranslationUnitDecl()->lookup(declName.getName())) {
+        R.addDecl(decl);
+      }
+      return !R.empty();
+    }
     return false;
   }
 
@@ -4137,38 +4305,44 @@ public:
     return AR_BASIC_UNKNOWN;
   }
 
+  // Adds the methods table declares for the object type at index i of
+  // g_ArBasicKindsAsTypes, which must already be declared.
+  void AddIntrinsicTableMethods(_In_ IDxcIntrinsicTable *table, unsigned i) {
+    DXASSERT_NOMSG(table != nullptr);
+    ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+    const char *typeName = g_ArBasicTypeNames[kind];
+    uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
+    DXASSERT(templateArgCount <= 2, "otherwise a new case has been added");
+    int startDepth = (templateArgCount == 0) ? 0 : 1;
+    CXXRecordDecl *recordDecl = m_objectTypeDecls[i];
+    DXASSERT(recordDecl != nullptr, "otherwise object type is not declared yet");
+
+    // This is a variation of AddObjectMethods using the new table.
+    const HLSL_INTRINSIC *pIntrinsic = nullptr;
+    const HLSL_INTRINSIC *pPrior = nullptr;
+    UINT64 lookupCookie = 0;
+    CA2W wideTypeName(typeName, CP_UTF8);
+    HRESULT found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+    while (pIntrinsic != nullptr && SUCCEEDED(found)) {
+      if (!AreIntrinsicTemplatesEquivalent(pIntrinsic, pPrior)) {
+        AddObjectIntrinsicTemplate(recordDecl, startDepth, pIntrinsic);
+        // NOTE: this only works with the current implementation because
+        // intrinsics are alive as long as the table is alive.
+        pPrior = pIntrinsic;
+      }
+      found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+    }
+  }
+
   void AddIntrinsicTableMethods(_In_ IDxcIntrinsicTable *table) {
     DXASSERT_NOMSG(table != nullptr);
 
     // Function intrinsics are added on-demand, objects get template methods.
+    // Object types declared later pick up the table's methods as they are
+    // declared.
     for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++) {
-      // Grab information already processed by AddObjectTypes.
-      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
-      const char *typeName = g_ArBasicTypeNames[kind];
-      uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
-      DXASSERT(templateArgCount <= 2, "otherwise a new case has been added");
-      int startDepth = (templateArgCount == 0) ? 0 : 1;
-      CXXRecordDecl *recordDecl = m_objectTypeDecls[i];
-      if (recordDecl == nullptr) {
-        DXASSERT(kind == AR_OBJECT_WAVE, "else objects other than reserved not initialized");
-        continue;
-      }
-
-      // This is a variation of AddObjectMethods using the new table.
-      const HLSL_INTRINSIC *pIntrinsic = nullptr;
-      const HLSL_INTRINSIC *pPrior = nullptr;
-      UINT64 lookupCookie = 0;
-      CA2W wideTypeName(typeName, CP_UTF8);
-      HRESULT found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
-      while (pIntrinsic != nullptr && SUCCEEDED(found)) {
-        if (!AreIntrinsicTemplatesEquivalent(pIntrinsic, pPrior)) {
-          AddObjectIntrinsicTemplate(recordDecl, startDepth, pIntrinsic);
-          // NOTE: this only works with the current implementation because
-          // intrinsics are alive as long as the table is alive.
-          pPrior = pIntrinsic;
-        }
-        found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
-      }
+      if (m_objectTypeDecls[i] != nullptr)
+        AddIntrinsicTableMethods(table, i);
     }
   }
 
@@ -4300,7 +4474,7 @@ public:
         const ArBasicKind* match = std::find(g_ArBasicKindsAsTypes, &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], kind);
         DXASSERT(match != &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], "otherwise can't find constant in basic kinds");
         size_t index = match - g_ArBasicKindsAsTypes;
-        return m_context->getTagDeclType(this->m_objectTypeDecls[index]);
+        return m_context->getTagDeclType(GetOrDeclareObjectType(index));
     }
 
     case AR_OBJECT_SAMPLER1D:
@@ -4410,6 +4584,15 @@ public:
     _Out_ std::vector<QualType> *,
     _Out_ size_t &badArgIdx);
 
+  /// <summary>Matches arguments as MatchArguments does, without consulting previous matches.</summary>
+  bool MatchArgumentsUncached(
+    const _In_ HLSL_INTRINSIC *pIntrinsic,
+    _In_ QualType objectElement,
+    _In_ QualType functionTemplateTypeArg,
+    _In_ ArrayRef<Expr *> Args,
+    _Out_ std::vector<QualType> *,
+    _Out_ size_t &badArgIdx);
+
   /// <summary>Validate object element on intrinsic to catch case like integer on Sample.</summary>
   /// <param name="pIntrinsic">Intrinsic function to validate.</param>
   /// <param name="objectElement">Type element on the class intrinsic belongs to; possibly null (eg, 'float' in 'Texture2D<float>').</param>
@@ -4425,15 +4608,12 @@ public:
     StringRef nameIdentifier,
     size_t argumentCount)
   {
-    // This is implemented by a linear scan for now.
-    // We tested binary search on tables, and there was no performance gain on
-    // samples probably for the following reasons.
-    // 1. The tables are not big enough to make noticable difference
-    // 2. The user of this function assumes that it returns the first entry in
-    // the table that matches name and argument count. So even in the binary
-    // search, we have to scan backwards until the entry does not match the name
-    // or arg count. For linear search this is not a problem
-    for (unsigned int i = 0; i < tableSize; i++) {
+    // The generated name index narrows the search to the overloads with the
+    // given name; the user of this function assumes that it returns the first
+    // of those that also matches the argument count.
+    size_t nameFirst = 0, nameCount = 0;
+    FindIntrinsicNameRange(table, tableSize, nameIdentifier, &nameFirst, &nameCount);
+    for (size_t i = nameFirst; i < nameFirst + nameCount; i++) {
       const HLSL_INTRINSIC* pIntrinsic = &table[i];
 
       const bool isVariadicFn = IsVariadicIntrinsicFunction(pIntrinsic);
@@ -5662,6 +5842,49 @@ bool HLSLExternalSource::MatchArguments(
   ArrayRef<Expr *> Args,
   std::vector<QualType> *argTypesVector,
   size_t &badArgIdx)
+{
+  // A match depends only on the argument types, except for literals, whose
+  // concrete type can depend on their value. Failed matches are not kept,
+  // since they report diagnostics at the call site.
+  IntrinsicMatchKey key;
+  key.push_back(pIntrinsic);
+  key.push_back(objectElement.getAsOpaquePtr());
+  key.push_back(functionTemplateTypeArg.getAsOpaquePtr());
+  bool cacheable = true;
+  for (Expr *pCallArg : Args) {
+    QualType argType = pCallArg->getType();
+    ArBasicKind kind = GetTypeElementKind(argType);
+    if (kind == AR_BASIC_LITERAL_INT || kind == AR_BASIC_LITERAL_FLOAT) {
+      cacheable = false;
+      break;
+    }
+    key.push_back(argType.getAsOpaquePtr());
+  }
+
+  if (cacheable) {
+    auto found = m_intrinsicMatches.find(key);
+    if (found != m_intrinsicMatches.end()) {
+      *argTypesVector = found->second;
+      badArgIdx = g_MaxIntrinsicParamCount + 1;
+      return true;
+    }
+  }
+
+  bool matched = MatchArgumentsUncached(pIntrinsic, objectElement,
+    functionTemplateTypeArg, Args, argTypesVector, badArgIdx);
+  if (matched && cacheable)
+    m_intrinsicMatches.emplace(std::move(key), *argTypesVector);
+  return matched;
+}
+
+_Use_decl_annotations_
+bool HLSLExternalSource::MatchArgumentsUncached(
+  const HLSL_INTRINSIC* pIntrinsic,
+  QualType objectElement,
+  QualType functionTemplateTypeArg,
+  ArrayRef<Expr *> Args,
+  std::vector<QualType> *argTypesVector,
+  size_t &badArgIdx)
 {
   DXASSERT_NOMSG(pIntrinsic != nullptr);
   DXASSERT_NOMSG(argTypesVector != nullptr);
@@ -10009,6 +10232,20 @@ bool hlsl::CheckTemplateArgumentListForHLSL(Sema& self, TemplateDecl* Template,
   return hlsl->CheckTemplateArgumentListForHLSL(Template, TemplateLoc, TemplateArgList);
 }
 
+/// <summary>Gets the canonical type of a built-in vector or matrix specialization, or a null type.</summary>
+QualType hlsl::LookupVectorOrMatrixCanonType(Sema& self, ClassTemplateDecl* Template, ArrayRef<TemplateArgument> Converted)
+{
+  DXASSERT_NOMSG(Template != nullptr);
+
+  ExternalSemaSource* externalSource = self.getExternalSource();
+  if (externalSource == nullptr) {
+    return QualType();
+  }
+
+  HLSLExternalSource* hlsl = reinterpret_cast<HLSLExternalSource*>(externalSource);
+  return hlsl->LookupVectorOrMatrixCanonType(Template, Converted);
+}
+
 /// <summary>Deduces template arguments on a function call in an HLSL program.</summary>
 Sema::TemplateDeductionResult hlsl::DeduceTemplateArgumentsForHLSL(Sema* self,
   FunctionTemplateDecl *FunctionTemplate,
@@ -2157,6 +2157,17 @@ QualType Sema::CheckTemplateIdType(TemplateName Name,
     }
   } else if (ClassTemplateDecl *ClassTemplate
                = dyn_cast<ClassTemplateDecl>(Template)) {
+    // HLSL Change Begin - built-in vector and matrix specializations are
+    // found in tables, not by hashing the arguments.
+    if (getLangOpts().HLSL) {
+      CanonType = hlsl::LookupVectorOrMatrixCanonType(*this, ClassTemplate,
+                                                     Converted);
+      if (!CanonType.isNull())
+        return Context.getTemplateSpecializationType(Name, TemplateArgs,
+                                                     CanonType);
+    }
+    // HLSL Change End
+
     // Find the class template specialization declaration that
     // corresponds to these arguments.
     void *InsertPos = nullptr;
@@ -6720,3 +6720,1342 @@ static const int g_MaxIntrinsicName = 44; // Count of characters for longest int
 static const int g_MaxIntrinsicParamName = 48; // Count of characters for longest intrinsic parameter name - 'MultiplierForGeometryContributionToHitGroupIndex'
 static const int g_MaxIntrinsicParamCount = 29; // Count of parameters (without return) for longest intrinsic argument list - 'MIN_PARAM_COUNT'
 // HLSL-INTRINSIC-STATS:END
+
+/* <py::lines('HLSL-INTRINSIC-NAME-INDEX')>hctdb_instrhelp.get_hlsl_intrinsic_name_index()</py>*/
+// HLSL-INTRINSIC-NAME-INDEX:BEGIN
+struct HLSL_INTRINSIC_NAME_INDEX {
+  UINT uHash;   // Hash of the name, as computed by HashIntrinsicName
+  UINT uFirst;  // Index of the first entry with the name
+  UINT uCount;  // Number of entries with the name; 0 for an empty slot
+};
+
+struct HLSL_INTRINSIC_NAME_INDEX_TABLE {
+  const HLSL_INTRINSIC *pIntrinsics;
+  const HLSL_INTRINSIC_NAME_INDEX *pIndex;
+  UINT uIndexSize; // Power of two
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_IntrinsicsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x3cc70401, 81, 1}, // QuadReadLaneAt
+    {0, 0, 0},
+    {0xd86ab003, 245, 1}, // unpack_s8s16
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x62e4e208, 136, 1}, // ceil
+    {0, 0, 0},
+    {0x8c0e360a, 92, 1}, // WaveActiveBitAnd
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xfa165a0d, 10, 1}, // DeviceMemoryBarrierWithGroupSync
+    {0, 0, 0},
+    {0xc7441a0f, 216, 1}, // step
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x42920a12, 27, 4}, // InterlockedAdd
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x83d03615, 174, 1}, // length
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xe46d6219, 104, 1}, // WaveMultiPrefixBitAnd
+    {0xaa25ea1a, 67, 1}, // PrimitiveIndex
+    {0, 0, 0},
+    {0xf45c461c, 140, 1}, // cosh
+    {0xb8e70c1d, 164, 1}, // floor
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x74b58422, 15, 1}, // EvaluateAttributeCentroid
+    {0xd543c222, 160, 1}, // f32tof16
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa7301228, 93, 1}, // WaveActiveBitOr
+    {0xe0a20229, 130, 1}, // asint16
+    {0x419ff42a, 94, 1}, // WaveActiveBitXor
+    {0x87aad829, 167, 1}, // frac
+    {0x1022e42c, 5, 1}, // CallShader
+    {0x6c70162d, 246, 1}, // unpack_s8s32
+    {0x5594082e, 119, 1}, // WorldToObject4x3
+    {0x1a60402f, 20, 1}, // GetRenderTargetSamplePosition
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x3c6d7036, 127, 1}, // asfloat16
+    {0x31037236, 202, 1}, // rcp
+    {0x86419438, 74, 1}, // ProcessQuadTessFactorsMin
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x2a48023b, 121, 1}, // abs
+    {0x4f0be23b, 206, 1}, // round
+    {0xa830983c, 235, 1}, // tex3Dlod
+    {0xf015543e, 52, 4}, // InterlockedOr
+    {0x10d2583f, 212, 1}, // sinh
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa2bf6a42, 75, 1}, // ProcessTriTessFactorsAvg
+    {0, 0, 0},
+    {0x2b57ea44, 208, 1}, // saturate
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xc9cab44c, 78, 1}, // QuadReadAcrossDiagonal
+    {0x2c29f04d, 124, 1}, // any
+    {0xe0302a4d, 210, 1}, // sin
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x8e66c45a, 77, 1}, // ProcessTriTessFactorsMin
+    {0, 0, 0},
+    {0x066c705c, 204, 1}, // refract
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x6d9ce862, 87, 1}, // TraceRay
+    {0x2eb31462, 151, 1}, // distance
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xafbf0467, 116, 1}, // WorldRayOrigin
+    {0x1e691468, 175, 1}, // lerp
+    {0x0cc16269, 14, 1}, // EvaluateAttributeAtSample
+    {0xb1b3c06a, 172, 1}, // isnan
+    {0x5efd5668, 228, 1}, // tex2Dgrad
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa3375470, 63, 1}, // ObjectRayOrigin
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xee2b9673, 247, 1}, // unpack_u8u16
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x8fe6e677, 222, 1}, // tex1Dgrad
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x42b6fe7a, 133, 1}, // asuint16
+    {0, 0, 0},
+    {0xee13ae7c, 196, 1}, // pack_clamp_u8
+    {0x95964e7d, 213, 1}, // smoothstep
+    {0x24e7847e, 1, 1}, // AddUint64
+    {0xeb6ede7f, 183, 1}, // modf
+    {0x8693547e, 241, 1}, // texCUBElod
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa10de286, 13, 1}, // DispatchRaysIndex
+    {0, 0, 0},
+    {0x3e58b488, 102, 1}, // WaveIsFirstLane
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x61ac208c, 23, 1}, // HitKind
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x1161748f, 44, 4}, // InterlockedMax
+    {0x93947290, 198, 1}, // pack_u8
+    {0, 0, 0},
+    {0x9c553e92, 73, 1}, // ProcessQuadTessFactorsMax
+    {0, 0, 0},
+    {0x9bd4ba94, 6, 1}, // CheckAccessFullyMapped
+    {0x829a5a95, 89, 1}, // WaveActiveAllTrue
+    {0xbeb1a496, 129, 1}, // asint
+    {0, 0, 0},
+    {0x9cf73498, 217, 1}, // tan
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x29f5189b, 142, 1}, // cross
+    {0xfb8de29c, 139, 1}, // cos
+    {0xd3237a9c, 156, 1}, // dst
+    {0xe1c0ee9e, 18, 1}, // GetAttributeAtVertex
+    {0, 0, 0},
+    {0x3f638ea0, 145, 1}, // ddx_fine
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xf4c652a4, 61, 1}, // NonUniformResourceIndex
+    {0, 0, 0},
+    {0xd03814a6, 2, 1}, // AllMemoryBarrier
+    {0xebb3e8a6, 118, 1}, // WorldToObject3x4
+    {0xfeae7ea6, 128, 1}, // asin
+    {0, 0, 0},
+    {0xe76fb4aa, 200, 1}, // printf
+    {0x92c778aa, 203, 1}, // reflect
+    {0, 0, 0},
+    {0x14c8ecad, 98, 1}, // WaveActiveProduct
+    {0, 0, 0},
+    {0x1bbbd0af, 229, 1}, // tex2Dlod
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xf7524cb4, 71, 1}, // ProcessIsolineTessFactors
+    {0xbdcec4b5, 106, 1}, // WaveMultiPrefixBitXor
+    {0x9da2a0b4, 107, 1}, // WaveMultiPrefixCountBits
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x834a3ab9, 205, 1}, // reversebits
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa82efcbc, 137, 1}, // clamp
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x0678cabf, 134, 1}, // atan
+    {0x767e36c0, 150, 1}, // determinant
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x051b82c4, 91, 1}, // WaveActiveBallot
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x16174ccb, 84, 1}, // RayTMin
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xfc1964d2, 221, 1}, // tex1Dbias
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x58336ad5, 199, 1}, // pow
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x9a473ed8, 224, 1}, // tex1Dproj
+    {0x10031ed9, 179, 1}, // log2
+    {0, 0, 0},
+    {0x2a37bedb, 219, 2}, // tex1D
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x5e13b0de, 223, 1}, // tex1Dlod
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x1f4e02e1, 48, 4}, // InterlockedMin
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x28e2eae8, 96, 1}, // WaveActiveMax
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x9f7248ee, 11, 1}, // DispatchMesh
+    {0x7230caee, 40, 1}, // InterlockedCompareStoreFloatBitwise
+    {0xaf4c5eee, 41, 3}, // InterlockedExchange
+    {0x3f02b0f0, 147, 1}, // ddy_coarse
+    {0xaf5442ee, 149, 1}, // degrees
+    {0x1d0794f2, 239, 1}, // texCUBEbias
+    {0xa30cdef4, 168, 1}, // frexp
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa52bcaf9, 120, 1}, // abort
+    {0, 0, 0},
+    {0x53118efb, 138, 1}, // clip
+    {0xd2e362fb, 237, 2}, // texCUBE
+    {0xb4cf8afd, 117, 1}, // WorldToObject
+    {0, 0, 0},
+    {0x22f488ff, 25, 1}, // InstanceID
+    {0x0d6b1300, 90, 1}, // WaveActiveAnyTrue
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x6f23b505, 153, 1}, // dot2add
+    {0, 0, 0},
+    {0xd2bded07, 17, 1}, // GeometryIndex
+    {0x795cf307, 60, 1}, // IsHelperLane
+    {0xe736d509, 100, 1}, // WaveGetLaneCount
+    {0, 0, 0},
+    {0x03e26d0b, 12, 1}, // DispatchRaysDimensions
+    {0x193f150c, 85, 1}, // ReportHit
+    {0, 0, 0},
+    {0xd98ab90e, 21, 1}, // GroupMemoryBarrier
+    {0x3258170e, 37, 1}, // InterlockedCompareExchangeFloatBitwise
+    {0xf8c7a90e, 83, 1}, // RayTCurrent
+    {0, 0, 0},
+    {0x3f25c512, 236, 1}, // tex3Dproj
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xd3694b18, 109, 1}, // WaveMultiPrefixSum
+    {0xd7a2e319, 181, 1}, // max
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x526be71d, 154, 1}, // dot4add_i8packed
+    {0x0230331d, 248, 1}, // unpack_u8u32
+    {0x67629b1f, 86, 1}, // SetMeshOutputCounts
+    {0x3c01df1f, 122, 1}, // acos
+    {0x9cdf4f21, 148, 1}, // ddy_fine
+    {0xd3689f20, 152, 1}, // dot
+    {0xb977b31f, 207, 1}, // rsqrt
+    {0xdae78f24, 72, 1}, // ProcessQuadTessFactorsAvg
+    {0x38311920, 225, 2}, // tex2D
+    {0x0e9fcd26, 26, 1}, // InstanceIndex
+    {0xf69b0527, 7, 1}, // $hidden$CreateResourceFromHeap
+    {0x72a68728, 157, 1}, // exp
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xf3a30f2d, 180, 1}, // mad
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x8be20730, 178, 1}, // log10
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x67a75134, 24, 1}, // IgnoreHit
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xe15be937, 143, 1}, // ddx
+    {0, 0, 0},
+    {0xc723c939, 79, 1}, // QuadReadAcrossX
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x70cb513d, 64, 1}, // ObjectToWorld
+    {0x4ca7953d, 105, 1}, // WaveMultiPrefixBitOr
+    {0x318db73e, 163, 1}, // firstbitlow
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x850e5942, 4, 1}, // $hidden$AllocateRayQuery
+    {0x3ef69542, 97, 1}, // WaveActiveMin
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xe868a549, 131, 2}, // asuint
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xd2fb0f4e, 159, 1}, // f16tof32
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x3f515151, 177, 1}, // log
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x8a7bdf56, 82, 1}, // RayFlags
+    {0xc98f4557, 182, 1}, // min
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xc8c77d5f, 111, 1}, // WavePrefixProduct
+    {0x8c63f160, 173, 1}, // ldexp
+    {0x2afc9b60, 214, 1}, // source_mark
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa8e1cd64, 141, 1}, // countbits
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x760bd367, 38, 2}, // InterlockedCompareStore
+    {0xc3b72b68, 233, 1}, // tex3Dbias
+    {0xe719c169, 99, 1}, // WaveActiveSum
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xce79296c, 194, 1}, // normalize
+    {0, 0, 0},
+    {0x12b3116e, 66, 1}, // ObjectToWorld4x3
+    {0, 0, 0},
+    {0x787a2970, 76, 1}, // ProcessTriTessFactorsMax
+    {0, 0, 0},
+    {0xa3bff772, 22, 1}, // GroupMemoryBarrierWithGroupSync
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x4551dd76, 101, 1}, // WaveGetLaneIndex
+    {0x26129d76, 170, 1}, // isfinite
+    {0, 0, 0},
+    {0x7eebf579, 95, 1}, // WaveActiveCountBits
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xeb84ed81, 185, 9}, // mul
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x9948b187, 35, 2}, // InterlockedCompareExchange
+    {0, 0, 0},
+    {0x5e339389, 231, 2}, // tex3D
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x33a3c58d, 103, 1}, // WaveMatch
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbd456593, 19, 1}, // GetRenderTargetSampleCount
+    {0xeb726993, 230, 1}, // tex2Dproj
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x508f8797, 166, 1}, // fmod
+    {0x3fa0e598, 0, 1}, // AcceptHitAndEndSearch
+    {0xefcc7d99, 155, 1}, // dot4add_u8packed
+    {0xf20f379a, 195, 1}, // pack_clamp_s8
+    {0x9a045d97, 240, 1}, // texCUBEgrad
+    {0xf74b699c, 108, 1}, // WaveMultiPrefixProduct
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x79fa399f, 9, 1}, // DeviceMemoryBarrier
+    {0x652605a0, 114, 1}, // WaveReadLaneFirst
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xe05be7a4, 146, 1}, // ddy
+    {0x0cbc8ba4, 209, 1}, // sign
+    {0xc623c7a6, 80, 1}, // QuadReadAcrossY
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xf12aadad, 8, 1}, // D3DCOLORtoUBYTE4
+    {0, 0, 0},
+    {0xde7ac5af, 113, 1}, // WaveReadLaneAt
+    {0x5e9fadb0, 31, 4}, // InterlockedAnd
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x404cd5b6, 176, 1}, // lit
+    {0x991525b7, 16, 1}, // EvaluateAttributeSnapped
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xc03183c0, 243, 1}, // transpose
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x13254bc4, 123, 1}, // all
+    {0x32f3e9c4, 211, 1}, // sincos
+    {0x955687c5, 227, 1}, // tex2Dbias
+    {0xd3ef43c7, 165, 1}, // fma
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xc281f3ca, 3, 1}, // AllMemoryBarrierWithGroupSync
+    {0x28fd53ca, 68, 1}, // Process2DQuadTessFactorsAvg
+    {0xd9da6dcb, 110, 1}, // WavePrefixCountBits
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x7dee3bcf, 215, 1}, // sqrt
+    {0x092855d0, 218, 1}, // tanh
+    {0, 0, 0},
+    {0xd24923d2, 70, 1}, // Process2DQuadTessFactorsMin
+    {0x4b6e55d3, 169, 1}, // fwidth
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xdc35abd8, 69, 1}, // Process2DQuadTessFactorsMax
+    {0x26ac11d8, 171, 1}, // isinf
+    {0, 0, 0},
+    {0xb63519db, 62, 1}, // ObjectRayDirection
+    {0, 0, 0},
+    {0x04a1f7dd, 126, 1}, // asfloat
+    {0, 0, 0},
+    {0x00e8d1df, 88, 1}, // WaveActiveAllEqual
+    {0x2c6c2de0, 162, 1}, // firstbithigh
+    {0xb3c6b1e1, 144, 1}, // ddx_coarse
+    {0x5fd55fe1, 161, 1}, // faceforward
+    {0x856a57e1, 201, 1}, // radians
+    {0, 0, 0},
+    {0xd55e61e5, 244, 1}, // trunc
+    {0xa8d2f1e6, 65, 1}, // ObjectToWorld3x4
+    {0x17a2b9e6, 197, 1}, // pack_s8
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x9f41c7eb, 112, 1}, // WavePrefixSum
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x9626adee, 158, 1}, // exp2
+    {0, 0, 0},
+    {0x5d4427f0, 125, 1}, // asdouble
+    {0, 0, 0},
+    {0xeca3c5f2, 115, 1}, // WorldRayDirection
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbd26dbf7, 135, 1}, // atan2
+    {0xb7819bf8, 184, 1}, // msad4
+    {0xbdafd7f8, 242, 1}, // texCUBEproj
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xf791dbfc, 56, 4}, // InterlockedXor
+    {0x5820d1fd, 234, 1}, // tex3Dgrad
+    {0, 0, 0},
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_AppendStructuredBufferMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x4f276601, 0, 1}, // Append
+    {0xbbda32b6, 1, 1}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_BufferMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 1, 2}, // Load
+    {0xbbda32b6, 0, 1}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_ByteAddressBufferMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x077c62e1, 3, 2}, // Load2
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 0, 1}, // GetDimensions
+    {0x097c6607, 7, 2}, // Load4
+    {0, 0, 0},
+    {0x68afa209, 1, 2}, // Load
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x067c614e, 5, 2}, // Load3
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_ConsumeStructuredBufferMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0xdc87c561, 0, 1}, // Consume
+    {0xbbda32b6, 1, 1}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_FeedbackTexture2DArrayMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xdf39197a, 2, 2}, // WriteSamplerFeedbackBias
+    {0xf3c20f93, 0, 2}, // WriteSamplerFeedback
+    {0x4cfc3043, 6, 1}, // WriteSamplerFeedbackLevel
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xe0243a4f, 4, 2}, // WriteSamplerFeedbackGrad
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_FeedbackTexture2DMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xdf39197a, 2, 2}, // WriteSamplerFeedbackBias
+    {0xf3c20f93, 0, 2}, // WriteSamplerFeedback
+    {0x4cfc3043, 6, 1}, // WriteSamplerFeedbackLevel
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xe0243a4f, 4, 2}, // WriteSamplerFeedbackGrad
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RWBufferMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 1, 2}, // Load
+    {0xbbda32b6, 0, 1}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RWByteAddressBufferMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x342ca804, 17, 1}, // InterlockedExchangeFloat
+    {0x8edb66c4, 28, 2}, // InterlockedOr64
+    {0, 0, 0},
+    {0x9948b187, 9, 1}, // InterlockedCompareExchange
+    {0x3f033148, 3, 2}, // InterlockedAdd64
+    {0x68afa209, 34, 2}, // Load
+    {0x097c6607, 40, 2}, // Load4
+    {0x94e16547, 44, 1}, // Store3
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x3258170e, 11, 1}, // InterlockedCompareExchangeFloatBitwise
+    {0x1161748f, 18, 2}, // InterlockedMax
+    {0x067c614e, 38, 2}, // Load3
+    {0x6da32dce, 42, 1}, // Store
+    {0x42920a12, 1, 2}, // InterlockedAdd
+    {0xc0074e53, 24, 2}, // InterlockedMin64
+    {0x91e1608e, 45, 1}, // Store4
+    {0xee309815, 13, 1}, // InterlockedCompareStore64
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xc60ac49d, 20, 2}, // InterlockedMax64
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x1f4e02e1, 22, 2}, // InterlockedMin
+    {0x077c62e1, 36, 2}, // Load2
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x760bd367, 12, 1}, // InterlockedCompareStore
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x7230caee, 14, 1}, // InterlockedCompareStoreFloatBitwise
+    {0xaf4c5eee, 15, 1}, // InterlockedExchange
+    {0x5e9fadb0, 5, 2}, // InterlockedAnd
+    {0, 0, 0},
+    {0xfb3bc2b2, 7, 2}, // InterlockedAnd64
+    {0, 0, 0},
+    {0x4d362874, 16, 1}, // InterlockedExchange64
+    {0x20e128b5, 10, 1}, // InterlockedCompareExchange64
+    {0xbbda32b6, 0, 1}, // GetDimensions
+    {0x93e163b4, 43, 1}, // Store2
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xf791dbfc, 30, 2}, // InterlockedXor
+    {0, 0, 0},
+    {0xf015543e, 26, 2}, // InterlockedOr
+    {0x8d2517fe, 32, 2}, // InterlockedXor64
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RWStructuredBufferMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 3, 2}, // Load
+    {0xc5672b12, 0, 1}, // DecrementCounter
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 1, 1}, // GetDimensions
+    {0x3a4b50ae, 2, 1}, // IncrementCounter
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RWTexture1DArrayMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 2, 2}, // Load
+    {0xbbda32b6, 0, 2}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RWTexture1DMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 2, 2}, // Load
+    {0xbbda32b6, 0, 2}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RWTexture2DArrayMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 2, 2}, // Load
+    {0xbbda32b6, 0, 2}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RWTexture2DMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 2, 2}, // Load
+    {0xbbda32b6, 0, 2}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RWTexture3DMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 2, 2}, // Load
+    {0xbbda32b6, 0, 2}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_RayQueryMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x38010b82, 33, 1}, // CommittedWorldToObject4x3
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x2acde089, 7, 1}, // CandidateObjectToWorld3x4
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x7a476b0e, 10, 1}, // CandidateProceduralPrimitiveNonOpaque
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa11a8992, 26, 1}, // CommittedObjectToWorld4x3
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xf3360d96, 27, 1}, // CommittedPrimitiveIndex
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x4ae73c99, 0, 1}, // Abort
+    {0xefd0b09a, 14, 1}, // CandidateType
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xa5df461d, 31, 1}, // CommittedTriangleFrontFace
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x3e5f7d25, 18, 1}, // CommitProceduralPrimitiveHit
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x7ccb2f2c, 12, 1}, // CandidateTriangleFrontFace
+    {0x06fc4fad, 28, 1}, // CommittedRayT
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x1850583b, 21, 1}, // CommittedInstanceID
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x92cba6bf, 37, 1}, // TraceRayInline
+    {0, 0, 0},
+    {0x397e9fc1, 8, 1}, // CandidateObjectToWorld4x3
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x8e30dd45, 15, 1}, // CandidateWorldToObject3x4
+    {0xea92e445, 17, 1}, // CommitNonOpaqueTriangleHit
+    {0, 0, 0},
+    {0x2abc0848, 30, 1}, // CommittedTriangleBarycentrics
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xb6d968cb, 4, 1}, // CandidateInstanceIndex
+    {0x3bb5df4c, 5, 1}, // CandidateObjectRayDirection
+    {0xb65357cd, 6, 1}, // CandidateObjectRayOrigin
+    {0x85de6f4d, 9, 1}, // CandidatePrimitiveIndex
+    {0xe8316a4b, 19, 1}, // CommittedGeometryIndex
+    {0x9f0e3b4f, 23, 1}, // CommittedObjectRayDirection
+    {0x654c34cc, 24, 1}, // CommittedObjectRayOrigin
+    {0x16174ccb, 36, 1}, // RayTMin
+    {0x6505f1d3, 20, 1}, // CommittedInstanceContributionToHitGroupIndex
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x8a7bdf56, 35, 1}, // RayFlags
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x90d67a5b, 29, 1}, // CommittedStatus
+    {0, 0, 0},
+    {0x0bc841dd, 16, 1}, // CandidateWorldToObject4x3
+    {0xf907385d, 34, 1}, // Proceed
+    {0, 0, 0},
+    {0xa2af0ae0, 3, 1}, // CandidateInstanceID
+    {0, 0, 0},
+    {0xa7ec7ae2, 1, 1}, // CandidateGeometryIndex
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xafbf0467, 39, 1}, // WorldRayOrigin
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x33c8c46a, 22, 1}, // CommittedInstanceIndex
+    {0xff6251ea, 32, 1}, // CommittedWorldToObject3x4
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x8b6667ef, 11, 1}, // CandidateTriangleBarycentrics
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xeca3c5f2, 38, 1}, // WorldRayDirection
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x21b0baf6, 2, 1}, // CandidateInstanceContributionToHitGroupIndex
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x660166fa, 25, 1}, // CommittedObjectToWorld3x4
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xfaa436fe, 13, 1}, // CandidateTriangleRayT
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_StreamMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x4f276601, 0, 1}, // Append
+    {0x301a4f22, 1, 1}, // RestartStrip
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_StructuredBufferMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 1, 2}, // Load
+    {0xbbda32b6, 0, 1}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_Texture1DArrayMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x08bd3843, 0, 1}, // CalculateLevelOfDetail
+    {0x85a29e03, 24, 4}, // SampleGrad
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xdcf88fc7, 9, 4}, // Sample
+    {0, 0, 0},
+    {0x68afa209, 6, 3}, // Load
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 2, 4}, // GetDimensions
+    {0x83a677b7, 28, 3}, // SampleLevel
+    {0, 0, 0},
+    {0x9f5817b9, 17, 4}, // SampleCmp
+    {0x5aaaefba, 1, 1}, // CalculateLevelOfDetailUnclamped
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x37aca39e, 13, 4}, // SampleBias
+    {0x8830c3ff, 21, 3}, // SampleCmpLevelZero
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_Texture1DMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x08bd3843, 0, 1}, // CalculateLevelOfDetail
+    {0x85a29e03, 24, 4}, // SampleGrad
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xdcf88fc7, 9, 4}, // Sample
+    {0, 0, 0},
+    {0x68afa209, 6, 3}, // Load
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 2, 4}, // GetDimensions
+    {0x83a677b7, 28, 3}, // SampleLevel
+    {0, 0, 0},
+    {0x9f5817b9, 17, 4}, // SampleCmp
+    {0x5aaaefba, 1, 1}, // CalculateLevelOfDetailUnclamped
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x37aca39e, 13, 4}, // SampleBias
+    {0x8830c3ff, 21, 3}, // SampleCmpLevelZero
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_Texture2DArrayMSMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 3, 3}, // Load
+    {0xa99576aa, 2, 1}, // GetSamplePosition
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 0, 2}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_Texture2DArrayMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x08bd3843, 0, 1}, // CalculateLevelOfDetail
+    {0x85a29e03, 70, 4}, // SampleGrad
+    {0, 0, 0},
+    {0x4072d786, 15, 3}, // GatherCmp
+    {0xdcf88fc7, 55, 4}, // Sample
+    {0, 0, 0},
+    {0x68afa209, 52, 3}, // Load
+    {0x54c7278a, 10, 5}, // GatherBlue
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x3d9f821e, 23, 5}, // GatherCmpBlue
+    {0x37aca39e, 59, 4}, // SampleBias
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xb77134e9, 43, 5}, // GatherRed
+    {0x2614cfaa, 2, 3}, // Gather
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x214ef26d, 33, 5}, // GatherCmpRed
+    {0x10a1242d, 38, 5}, // GatherGreen
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x581ff3b1, 28, 5}, // GatherCmpGreen
+    {0x36b49632, 5, 5}, // GatherAlpha
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 48, 4}, // GetDimensions
+    {0x83a677b7, 74, 3}, // SampleLevel
+    {0, 0, 0},
+    {0x9f5817b9, 63, 4}, // SampleCmp
+    {0x5aaaefba, 1, 1}, // CalculateLevelOfDetailUnclamped
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x6d9da03e, 18, 5}, // GatherCmpAlpha
+    {0x8830c3ff, 67, 3}, // SampleCmpLevelZero
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_Texture2DMSMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0x68afa209, 3, 3}, // Load
+    {0xa99576aa, 2, 1}, // GetSamplePosition
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 0, 2}, // GetDimensions
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_Texture2DMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x08bd3843, 0, 1}, // CalculateLevelOfDetail
+    {0x85a29e03, 70, 4}, // SampleGrad
+    {0, 0, 0},
+    {0x4072d786, 15, 3}, // GatherCmp
+    {0xdcf88fc7, 55, 4}, // Sample
+    {0, 0, 0},
+    {0x68afa209, 52, 3}, // Load
+    {0x54c7278a, 10, 5}, // GatherBlue
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x3d9f821e, 23, 5}, // GatherCmpBlue
+    {0x37aca39e, 59, 4}, // SampleBias
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xb77134e9, 43, 5}, // GatherRed
+    {0x2614cfaa, 2, 3}, // Gather
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x214ef26d, 33, 5}, // GatherCmpRed
+    {0x10a1242d, 38, 5}, // GatherGreen
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x581ff3b1, 28, 5}, // GatherCmpGreen
+    {0x36b49632, 5, 5}, // GatherAlpha
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 48, 4}, // GetDimensions
+    {0x83a677b7, 74, 3}, // SampleLevel
+    {0, 0, 0},
+    {0x9f5817b9, 63, 4}, // SampleCmp
+    {0x5aaaefba, 1, 1}, // CalculateLevelOfDetailUnclamped
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x6d9da03e, 18, 5}, // GatherCmpAlpha
+    {0x8830c3ff, 67, 3}, // SampleCmpLevelZero
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_Texture3DMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x08bd3843, 0, 1}, // CalculateLevelOfDetail
+    {0x85a29e03, 17, 4}, // SampleGrad
+    {0, 0, 0},
+    {0xbbda32b6, 2, 4}, // GetDimensions
+    {0xdcf88fc7, 9, 4}, // Sample
+    {0x83a677b7, 21, 3}, // SampleLevel
+    {0x68afa209, 6, 3}, // Load
+    {0x5aaaefba, 1, 1}, // CalculateLevelOfDetailUnclamped
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x37aca39e, 13, 4}, // SampleBias
+    {0, 0, 0},
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_TextureCUBEArrayMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x08bd3843, 0, 1}, // CalculateLevelOfDetail
+    {0x85a29e03, 37, 3}, // SampleGrad
+    {0, 0, 0},
+    {0x4072d786, 8, 2}, // GatherCmp
+    {0xdcf88fc7, 26, 3}, // Sample
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x54c7278a, 6, 2}, // GatherBlue
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x3d9f821e, 12, 2}, // GatherCmpBlue
+    {0x37aca39e, 29, 3}, // SampleBias
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xb77134e9, 20, 2}, // GatherRed
+    {0x2614cfaa, 2, 2}, // Gather
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x214ef26d, 16, 2}, // GatherCmpRed
+    {0x10a1242d, 18, 2}, // GatherGreen
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x581ff3b1, 14, 2}, // GatherCmpGreen
+    {0x36b49632, 4, 2}, // GatherAlpha
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 22, 4}, // GetDimensions
+    {0x83a677b7, 40, 2}, // SampleLevel
+    {0, 0, 0},
+    {0x9f5817b9, 32, 3}, // SampleCmp
+    {0x5aaaefba, 1, 1}, // CalculateLevelOfDetailUnclamped
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x6d9da03e, 10, 2}, // GatherCmpAlpha
+    {0x8830c3ff, 35, 2}, // SampleCmpLevelZero
+};
+
+static const HLSL_INTRINSIC_NAME_INDEX g_TextureCUBEMethodsNameIndex[] =
+{
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x08bd3843, 0, 1}, // CalculateLevelOfDetail
+    {0x85a29e03, 37, 3}, // SampleGrad
+    {0, 0, 0},
+    {0x4072d786, 8, 2}, // GatherCmp
+    {0xdcf88fc7, 26, 3}, // Sample
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x54c7278a, 6, 2}, // GatherBlue
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x3d9f821e, 12, 2}, // GatherCmpBlue
+    {0x37aca39e, 29, 3}, // SampleBias
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xb77134e9, 20, 2}, // GatherRed
+    {0x2614cfaa, 2, 2}, // Gather
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x214ef26d, 16, 2}, // GatherCmpRed
+    {0x10a1242d, 18, 2}, // GatherGreen
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x581ff3b1, 14, 2}, // GatherCmpGreen
+    {0x36b49632, 4, 2}, // GatherAlpha
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0xbbda32b6, 22, 4}, // GetDimensions
+    {0x83a677b7, 40, 2}, // SampleLevel
+    {0, 0, 0},
+    {0x9f5817b9, 32, 3}, // SampleCmp
+    {0x5aaaefba, 1, 1}, // CalculateLevelOfDetailUnclamped
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+    {0x6d9da03e, 10, 2}, // GatherCmpAlpha
+    {0x8830c3ff, 35, 2}, // SampleCmpLevelZero
+};
+
+#ifdef ENABLE_SPIRV_CODEGEN
+
+static const HLSL_INTRINSIC_NAME_INDEX g_VkIntrinsicsNameIndex[] =
+{
+    {0xbc74dd90, 0, 1}, // VkReadClock
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+};
+
+#endif // ENABLE_SPIRV_CODEGEN
+
+#ifdef ENABLE_SPIRV_CODEGEN
+
+static const HLSL_INTRINSIC_NAME_INDEX g_VkSubpassInputMSMethodsNameIndex[] =
+{
+    {0x478c6a44, 0, 1}, // SubpassLoad
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+};
+
+#endif // ENABLE_SPIRV_CODEGEN
+
+#ifdef ENABLE_SPIRV_CODEGEN
+
+static const HLSL_INTRINSIC_NAME_INDEX g_VkSubpassInputMethodsNameIndex[] =
+{
+    {0x478c6a44, 0, 1}, // SubpassLoad
+    {0, 0, 0},
+    {0, 0, 0},
+    {0, 0, 0},
+};
+
+#endif // ENABLE_SPIRV_CODEGEN
+
+static const HLSL_INTRINSIC_NAME_INDEX_TABLE g_IntrinsicNameIndexTables[] =
+{
+    {g_Intrinsics, g_IntrinsicsNameIndex, _countof(g_IntrinsicsNameIndex)},
+    {g_AppendStructuredBufferMethods, g_AppendStructuredBufferMethodsNameIndex, _countof(g_AppendStructuredBufferMethodsNameIndex)},
+    {g_BufferMethods, g_BufferMethodsNameIndex, _countof(g_BufferMethodsNameIndex)},
+    {g_ByteAddressBufferMethods, g_ByteAddressBufferMethodsNameIndex, _countof(g_ByteAddressBufferMethodsNameIndex)},
+    {g_ConsumeStructuredBufferMethods, g_ConsumeStructuredBufferMethodsNameIndex, _countof(g_ConsumeStructuredBufferMethodsNameIndex)},
+    {g_FeedbackTexture2DArrayMethods, g_FeedbackTexture2DArrayMethodsNameIndex, _countof(g_FeedbackTexture2DArrayMethodsNameIndex)},
+    {g_FeedbackTexture2DMethods, g_FeedbackTexture2DMethodsNameIndex, _countof(g_FeedbackTexture2DMethodsNameIndex)},
+    {g_RWBufferMethods, g_RWBufferMethodsNameIndex, _countof(g_RWBufferMethodsNameIndex)},
+    {g_RWByteAddressBufferMethods, g_RWByteAddressBufferMethodsNameIndex, _countof(g_RWByteAddressBufferMethodsNameIndex)},
+    {g_RWStructuredBufferMethods, g_RWStructuredBufferMethodsNameIndex, _countof(g_RWStructuredBufferMethodsNameIndex)},
+    {g_RWTexture1DArrayMethods, g_RWTexture1DArrayMethodsNameIndex, _countof(g_RWTexture1DArrayMethodsNameIndex)},
+    {g_RWTexture1DMethods, g_RWTexture1DMethodsNameIndex, _countof(g_RWTexture1DMethodsNameIndex)},
+    {g_RWTexture2DArrayMethods, g_RWTexture2DArrayMethodsNameIndex, _countof(g_RWTexture2DArrayMethodsNameIndex)},
+    {g_RWTexture2DMethods, g_RWTexture2DMethodsNameIndex, _countof(g_RWTexture2DMethodsNameIndex)},
+    {g_RWTexture3DMethods, g_RWTexture3DMethodsNameIndex, _countof(g_RWTexture3DMethodsNameIndex)},
+    {g_RayQueryMethods, g_RayQueryMethodsNameIndex, _countof(g_RayQueryMethodsNameIndex)},
+    {g_StreamMethods, g_StreamMethodsNameIndex, _countof(g_StreamMethodsNameIndex)},
+    {g_StructuredBufferMethods, g_StructuredBufferMethodsNameIndex, _countof(g_StructuredBufferMethodsNameIndex)},
+    {g_Texture1DArrayMethods, g_Texture1DArrayMethodsNameIndex, _countof(g_Texture1DArrayMethodsNameIndex)},
+    {g_Texture1DMethods, g_Texture1DMethodsNameIndex, _countof(g_Texture1DMethodsNameIndex)},
+    {g_Texture2DArrayMSMethods, g_Texture2DArrayMSMethodsNameIndex, _countof(g_Texture2DArrayMSMethodsNameIndex)},
+    {g_Texture2DArrayMethods, g_Texture2DArrayMethodsNameIndex, _countof(g_Texture2DArrayMethodsNameIndex)},
+    {g_Texture2DMSMethods, g_Texture2DMSMethodsNameIndex, _countof(g_Texture2DMSMethodsNameIndex)},
+    {g_Texture2DMethods, g_Texture2DMethodsNameIndex, _countof(g_Texture2DMethodsNameIndex)},
+    {g_Texture3DMethods, g_Texture3DMethodsNameIndex, _countof(g_Texture3DMethodsNameIndex)},
+    {g_TextureCUBEArrayMethods, g_TextureCUBEArrayMethodsNameIndex, _countof(g_TextureCUBEArrayMethodsNameIndex)},
+    {g_TextureCUBEMethods, g_TextureCUBEMethodsNameIndex, _countof(g_TextureCUBEMethodsNameIndex)},
+#ifdef ENABLE_SPIRV_CODEGEN
+    {g_VkIntrinsics, g_VkIntrinsicsNameIndex, _countof(g_VkIntrinsicsNameIndex)},
+#endif // ENABLE_SPIRV_CODEGEN
+#ifdef ENABLE_SPIRV_CODEGEN
+    {g_VkSubpassInputMSMethods, g_VkSubpassInputMSMethodsNameIndex, _countof(g_VkSubpassInputMSMethodsNameIndex)},
+#endif // ENABLE_SPIRV_CODEGEN
+#ifdef ENABLE_SPIRV_CODEGEN
+    {g_VkSubpassInputMethods, g_VkSubpassInputMethodsNameIndex, _countof(g_VkSubpassInputMethodsNameIndex)},
+#endif // ENABLE_SPIRV_CODEGEN
+};
+// HLSL-INTRINSIC-NAME-INDEX:END
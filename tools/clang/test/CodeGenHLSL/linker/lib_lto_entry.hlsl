@@ -0,0 +1,11 @@
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s
+
+// CHECK: declare float @"\01?sum_scaled@@YAMMH@Z"(float, i32)
+
+float sum_scaled(float x, int n);
+
+[shader("pixel")]
+float main(float a : A) : SV_Target {
+  // The trip count is only known once the helper is linked in.
+  return sum_scaled(a, 4);
+}
@@ -0,0 +1,10 @@
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s
+
+// CHECK: phi float
+
+export float sum_scaled(float x, int n) {
+  float r = 0;
+  for (int i = 0; i < n; i++)
+    r += x * i;
+  return r;
+}
@@ -0,0 +1,24 @@
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s
+
+// Two helpers with the same body, kept out of line. Linking this library
+// keeps only one of them.
+// CHECK-DAG: define internal float @"\01?scale_a@@YAMM@Z"(float
+// CHECK-DAG: define internal float @"\01?scale_b@@YAMM@Z"(float
+
+[noinline]
+static float scale_a(float x) {
+  return x * 3.0 + 1.0;
+}
+
+[noinline]
+static float scale_b(float x) {
+  return x * 3.0 + 1.0;
+}
+
+export float use_a(float x) {
+  return scale_a(x);
+}
+
+export float use_b(float x) {
+  return scale_b(x);
+}
@@ -0,0 +1,18 @@
+// Run: %dxc -T ps_6_0 -E main -O1
+
+// The -O1 recipe is a single round of cleanups, but it still inlines into the
+// entry point and removes the functions nothing calls any more.
+
+// CHECK:     OpFunction
+// CHECK-NOT: OpFunctionCall
+// CHECK-NOT: OpFunction %
+
+float4 shade(float4 color, float scale) {
+  if (scale > 1.0)
+    return color * scale;
+  return color;
+}
+
+float4 main(float4 color : COLOR, float scale : SCALE) : SV_Target {
+  return shade(color, scale);
+}
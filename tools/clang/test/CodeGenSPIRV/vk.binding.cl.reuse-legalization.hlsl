@@ -0,0 +1,20 @@
+// Run: %dxc -T ps_6_0 -E main -fvk-t-shift 10 0 -fvk-s-shift 20 0 -fspv-reuse-legalization
+
+// Tests that the binding numbers survive reusing the legalized module of a
+// permutation that differs only in its bindings.
+
+// CHECK: OpDecorate %gTex DescriptorSet 0
+// CHECK: OpDecorate %gTex Binding 11
+Texture2D<float4> gTex : register(t1);
+// CHECK: OpDecorate %gSampler DescriptorSet 0
+// CHECK: OpDecorate %gSampler Binding 22
+SamplerState gSampler : register(s2);
+
+static Texture2D<float4> sTex = gTex;
+
+float4 main(float2 uv : TEXCOORD) : SV_Target {
+// CHECK: [[tex:%\d+]] = OpLoad %type_2d_image %gTex
+// CHECK: [[smp:%\d+]] = OpLoad %type_sampler %gSampler
+// CHECK:                OpSampledImage %type_sampled_image [[tex]] [[smp]]
+  return sTex.Sample(gSampler, uv);
+}
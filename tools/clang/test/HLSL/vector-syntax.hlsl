@@ -13,6 +13,16 @@ vector<float, i+i> vfi;
 /*verify-ast
   VarDecl <col:1, col:20> col:20 vfi 'vector<float, i + i>':'vector<float, 2>'
 */
+void same_vector_specializations() {
+    // Each spelling of a vector type names the same specialization.
+    _Static_assert(std::is_same<float3, vector<float, 3> >::value, "float3 == vector<float, 3> failed");
+    _Static_assert(std::is_same<vector<int, 1+3>, int4>::value, "vector<int, 1+3> == int4 failed");
+    _Static_assert(std::is_same<min16float2, vector<min16float, 2> >::value, "min16float2 == vector<min16float, 2> failed");
+    _Static_assert(!std::is_same<vector<int, 2>, vector<uint, 2> >::value, "vector<int, 2> != vector<uint, 2> failed");
+    _Static_assert(std::is_same<float2x3, matrix<float, 2, 3> >::value, "float2x3 == matrix<float, 2, 3> failed");
+    _Static_assert(!std::is_same<matrix<float, 2, 3>, matrix<float, 3, 2> >::value, "matrix<float, 2, 3> != matrix<float, 3, 2> failed");
+}
+
 static const int2 g_i2 = {1,2};
 /*verify-ast
   VarDecl <col:1, col:30> col:19 used g_i2 'const int2':'const vector<int, 2>' static cinit
@@ -0,0 +1,15 @@
+// RUN: %dxc -E main -T ps_6_0 %s -Zi -Qdebug_lines -Od | FileCheck %s
+
+// Make sure /Qdebug_lines keeps instruction locations but drops variables.
+
+// CHECK: call float @dx.op.unary.f32(i32 13,
+// CHECK-SAME: line:14
+// CHECK-NOT: @llvm.dbg.value
+// CHECK-NOT: @llvm.dbg.declare
+// CHECK: !DICompileUnit(
+// CHECK-NOT: !DILocalVariable
+
+float main(float a : A) : SV_Target {
+  float b = a * 2;
+  return sin(b);
+}
@@ -0,0 +1,35 @@
+// RUN: %dxc -E main -T ps_6_0 -O1 %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -O1 -Odump %s | FileCheck %s -check-prefix=O1PASSES
+// RUN: %dxc -E main -T ps_6_0 -O3 -Odump %s | FileCheck %s -check-prefix=O3PASSES
+
+// -O1 is the fast optimize tier: a single round of scalar cleanups, without
+// loop optimizations or repeated instcombine, still removing redundancies.
+
+// CHECK: @main
+// CHECK: call float @dx.op.dot3.f32
+// CHECK-NOT: call float @dx.op.dot3.f32
+// CHECK: call void @dx.op.storeOutput.f32
+
+// O1PASSES: -dxil-cond-mem2reg
+// O1PASSES: -gvn,noloads=1
+// O1PASSES-NOT: -indvars
+// O1PASSES-NOT: -loop-unroll
+// O1PASSES-NOT: -dse
+// O1PASSES: -hlsl-dxil-lower-handle-for-lib
+
+// O3PASSES: -indvars
+// O3PASSES: -gvn,noloads=0
+// O3PASSES: -dse
+// O3PASSES: -loop-unroll
+// O3PASSES: -hlsl-dxil-lower-handle-for-lib
+
+cbuffer Params : register(b0) {
+  float3 LightDir;
+  float Scale;
+};
+
+float4 main(float3 n : NORMAL, float4 c : COLOR) : SV_Target {
+  float a = dot(n, LightDir) * Scale;
+  float b = dot(n, LightDir) * Scale;
+  return c * (a + b);
+}
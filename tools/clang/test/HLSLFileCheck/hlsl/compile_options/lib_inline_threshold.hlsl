@@ -0,0 +1,44 @@
+// RUN: %dxc -T lib_6_3 -lib-inline-threshold 20 %s | FileCheck %s
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s -check-prefix=INLINE
+
+// With -lib-inline-threshold, a helper larger than the threshold that is
+// called from more than one place stays a library function. Helpers called
+// once, or small ones, are still inlined.
+
+// CHECK: define {{.*}} @"\01?Shade@@YA{{.*}}"({{.*}}) #[[ATTR:[0-9]+]]
+// CHECK-NOT: define {{.*}}Small
+// CHECK-NOT: define {{.*}}Once
+// CHECK: define void @PS0()
+// CHECK: call {{.*}} @"\01?Shade@@YA
+// CHECK: define void @PS1()
+// CHECK: call {{.*}} @"\01?Shade@@YA
+// CHECK: attributes #[[ATTR]] = { noinline
+
+// INLINE-NOT: @"\01?Shade@@YA
+
+
+StructuredBuffer<float4> Lights : register(t0);
+
+float Small(float x) { return x * 2; }
+
+float Once(float4 v) { return dot(v, v) + Small(v.x); }
+
+float Shade(float3 n, uint count) {
+  float sum = 0;
+  for (uint i = 0; i < count; ++i) {
+    float4 l = Lights[i];
+    float d = saturate(dot(n, l.xyz));
+    sum += pow(d, l.w) * (1 + sin(l.w) * cos(d));
+  }
+  return sum;
+}
+
+[shader("pixel")]
+float4 PS0(float3 n : NORMAL, uint c : COUNT) : SV_Target {
+  return Shade(n, c) + Small(n.x);
+}
+
+[shader("pixel")]
+float4 PS1(float3 n : NORMAL, float4 v : COLOR) : SV_Target {
+  return Shade(n.zyx, 4) + Once(v) + Small(v.y);
+}
@@ -0,0 +1,29 @@
+// RUN: %dxc -E main -T ps_6_0 -emit-hl-module %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -emit-hl-module %s | %opt -S -hlsl-passes-resume -dxilgen | FileCheck %s -check-prefix=DXIL
+// RUN: %dxc -E main -T ps_6_0 -emit-hl-module -Odump %s | FileCheck %s -check-prefix=PASSES
+
+// -emit-hl-module stops an optimized compile before DXIL generation. The
+// module it leaves is paused with the high-level metadata emitted, so that
+// -from-hl-module, or resuming it by hand, can pick it up there.
+
+// CHECK: define {{.*}}@main(
+// CHECK: call float @"dx.hl.op.rn.float (i32, <3 x float>, <3 x float>)"
+// CHECK-NOT: @dx.op.
+// CHECK: !pauseresume = !{![[PR:[0-9]+]]}
+// CHECK: ![[PR]] = !{!"hlsl-hlemit", !"hlsl-hlensure"}
+
+// DXIL: call float @dx.op.dot3.f32
+// DXIL: call void @dx.op.storeOutput.f32
+
+// PASSES: -dxil-cond-mem2reg
+// PASSES: -hlsl-passes-pause
+// PASSES-NOT: -dxilgen
+
+cbuffer Params : register(b0) {
+  float3 LightDir;
+  float Scale;
+};
+
+float4 main(float3 n : NORMAL, float4 c : COLOR) : SV_Target {
+  return c * dot(n, LightDir) * Scale;
+}
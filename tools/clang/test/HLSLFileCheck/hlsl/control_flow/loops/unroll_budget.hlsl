@@ -0,0 +1,35 @@
+// RUN: %dxc -T ps_6_0 -E main -unroll-budget 1000 %s | FileCheck %s
+// RUN: %dxc -T ps_6_0 -E main %s | FileCheck %s -check-prefix=FULL
+
+// Full unrolling of the light loop would add far more than 1000
+// instructions, and it needs none of it to be legal, so under the budget
+// it is only unrolled by a factor that divides 256 and stays a loop.
+
+// CHECK: phi i32
+// CHECK: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32
+// CHECK: br i1
+
+// FULL-NOT: phi i32
+// FULL-NOT: br i1
+
+struct Light {
+  float3 position;
+  float radius;
+  float3 color;
+  float intensity;
+};
+
+StructuredBuffer<Light> Lights : register(t0);
+
+float4 main(float3 worldPos : POSITION, float3 normal : NORMAL) : SV_Target {
+  float3 result = 0;
+  [unroll] for (uint i = 0; i < 256; ++i) {
+    Light light = Lights[i];
+    float3 toLight = light.position - worldPos;
+    float dist = length(toLight);
+    float atten = saturate(1 - dist / light.radius);
+    result += light.color * light.intensity * atten *
+              saturate(dot(normal, toLight / dist));
+  }
+  return float4(result, 1);
+}
@@ -0,0 +1,21 @@
+// RUN: %dxc -T ps_6_0 %s -E main | %FileCheck %s
+
+// Repeated calls with the same argument types resolve to the same overload,
+// and each new argument type still resolves to its own.
+
+// CHECK-DAG: call float @dx.op.unary.f32(i32 6, float
+// CHECK-DAG: call i32 @dx.op.binary.i32(i32 37, i32
+// CHECK-DAG: call float @dx.op.binary.f32(i32 35, float
+// CHECK-DAG: call i32 @dx.op.binary.i32(i32 40, i32
+
+float f;
+int i;
+uint u;
+
+float main() : SV_Target {
+  float a = abs(f) + abs(f * 2);
+  int b = abs(i) + abs(i + 1);
+  float c = max(f, a) + max(a, f);
+  uint d = min(u, (uint)b) + min((uint)b, u);
+  return a + b + c + d + abs(-3.5);
+}
@@ -0,0 +1,13 @@
+// RUN: %dxc -T ps_6_0 -E main -fcgl %s | FileCheck %s
+
+// Verify that bit intrinsics and half conversions of literals are folded
+// when they are emitted, before they are lowered.
+// 4 + 0x80000000 + 3 + 4 + 0x3C00 + 1
+// CHECK-NOT: call {{.*}}@"dx.hl.op.
+// CHECK: i32 -2147468276
+// CHECK-NOT: call {{.*}}@"dx.hl.op.
+
+uint main() : SV_Target {
+  return countbits(0xF0u) + reversebits(1u) + firstbitlow(8u) +
+         firstbithigh(16u) + f32tof16(1.0) + (uint)f16tof32(0x3C00u);
+}
@@ -0,0 +1,28 @@
+// RUN: %dxc -T ps_6_0 -E main %s | FileCheck %s
+
+// Verify that half conversions of constants are folded after lowering,
+// except where rounding or denorm handling would decide the result.
+// CHECK-DAG: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float 1.000000e+00)
+// CHECK-DAG: call void @dx.op.storeOutput.i32(i32 5, i32 1, i32 0, i8 0, i32 15360)
+// CHECK-DAG: call i32 @dx.op.legacyF32ToF16(i32 130, float 0x3EB0C6F7A0000000)
+// CHECK-DAG: call float @dx.op.legacyF16ToF32(i32 131, i32 1)
+
+struct PSOut {
+  float f : SV_Target0;
+  uint u : SV_Target1;
+  uint denorm : SV_Target2;
+  float halfDenorm : SV_Target3;
+};
+
+PSOut main() {
+  uint h = 0x3C00;
+  float f = 1.0;
+  float tiny = 1e-6;
+  uint halfDenorm = 1;
+  PSOut o;
+  o.f = f16tof32(h);
+  o.u = f32tof16(f);
+  o.denorm = f32tof16(tiny);
+  o.halfDenorm = f16tof32(halfDenorm);
+  return o;
+}
@@ -0,0 +1,32 @@
+// RUN: %dxc -T vs_6_0 -E main -opt-enable matrix-dot-products %s | FileCheck %s
+// RUN: %dxc -T vs_6_0 -E main %s | FileCheck %s -check-prefix=DEFAULT
+// RUN: %dxc -T vs_6_0 -E main -DDOUBLE -opt-enable matrix-dot-products %s | FileCheck %s -check-prefix=DBL
+
+// Make sure float matrix-vector multiplies become one dot4 per result element
+// when enabled, and stay mul and mad chains otherwise and for doubles.
+
+// CHECK: call float @dx.op.dot4.f32
+// CHECK: call float @dx.op.dot4.f32
+// CHECK: call float @dx.op.dot4.f32
+// CHECK: call float @dx.op.dot4.f32
+// CHECK-NOT: @dx.op.tertiary.f32(i32 46
+
+// DEFAULT-NOT: @dx.op.dot4
+// DEFAULT: call float @dx.op.tertiary.f32(i32 46
+
+// DBL-NOT: @dx.op.dot
+// DBL: call double @dx.op.tertiary.f64(i32 46
+
+#ifdef DOUBLE
+typedef double4 vec;
+typedef double4x4 mat;
+#else
+typedef float4 vec;
+typedef float4x4 mat;
+#endif
+
+mat m;
+
+float4 main(float4 pos : POSITION) : SV_Position {
+  return (float4)mul(m, (vec)pos);
+}
@@ -0,0 +1,27 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -hlsl-dxil-expand-trig-intrinsics,fast=1 | %FileCheck %s
+// RUN: %dxc -Emain -Tps_6_0 -opt-enable fast-trig %s | %FileCheck %s
+
+// Make sure fast mode uses the short atan and acos polynomials and a single
+// exponential for tanh, and leaves tan and precise calls alone.
+
+// CHECK: fmul fast float {{.*}}, 0x3FB44F8C20000000
+// CHECK: fadd fast float {{.*}}, 0xBFD279E5A0000000
+// CHECK: fadd fast float {{.*}}, 0x3FEFD9F8C0000000
+
+// CHECK: fmul fast float {{.*}}, 0x3FAA4FBCE0000000
+// CHECK: fadd fast float {{.*}}, 0xBFCA4DBEC0000000
+// CHECK: fadd fast float {{.*}}, 0x3FF920A580000000
+
+// CHECK: fmul fast float {{.*}}, 0x4007154760000000
+// CHECK: call float @dx.op.unary.f32(i32 21,
+// CHECK-NOT: call float @dx.op.unary.f32(i32 21,
+// CHECK: fdiv fast float 2.000000e+00
+
+// CHECK: call float @dx.op.unary.f32(i32 14,
+// CHECK: call float @dx.op.unary.f32(i32 17,
+
+float main(float4 x : A) : SV_Target {
+  float r = atan(x.x) + acos(x.y) + tanh(x.z) + tan(x.x);
+  precise float p = atan(x.w);
+  return r + p;
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T ps_6_6 %s | FileCheck %s
+
+// Built-in object types, the 'sampler' alias and the descriptor heaps are
+// declared when first named; make sure each still resolves, including the
+// default float4 element type of Texture2D.
+
+// CHECK-DAG: call %dx.types.Handle @dx.op.createHandleFromHeap(i32 218, i32 3, i1 false, i1 false)
+// CHECK-DAG: call %dx.types.Handle @dx.op.createHandleFromHeap(i32 218, i32 1, i1 true, i1 false)
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60,
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60,
+
+Texture2D tex : register(t0);
+sampler samp : register(s0);
+
+float4 main(float2 uv : TEXCOORD) : SV_Target {
+  Texture2D<float4> heapTex = ResourceDescriptorHeap[3];
+  SamplerState heapSamp = SamplerDescriptorHeap[1];
+  return tex.Sample(samp, uv) + heapTex.Sample(heapSamp, uv);
+}
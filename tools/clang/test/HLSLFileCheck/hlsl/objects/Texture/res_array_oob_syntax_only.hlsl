@@ -0,0 +1,18 @@
+// RUN: %dxc -E main -T ps_6_0 -fsyntax-only %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Constant out-of-bounds indices into resource arrays are reported as soon
+// as the module is generated, and unreachable ones are not.
+
+// CHECK: error: Accessing resource array with out-of-bounds index 5 in main.
+// CHECK-NOT: out-of-bounds index 6
+
+Texture2D t[4] : register(t0);
+static const uint k = 5;
+
+float4 main(uint3 off : OFF) : SV_Target {
+  float4 r = t[k].Load(off);
+  if (false)
+    r += t[6].Load(off);
+  return r;
+}
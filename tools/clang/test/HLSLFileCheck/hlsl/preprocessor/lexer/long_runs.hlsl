@@ -0,0 +1,24 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Long runs of digits, indentation and comment text are skipped a vector at
+// a time; make sure the literals still end where they should, including an
+// exponent, a swizzle or a comment right after a run.
+
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float 1.000000e+01)
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 1, float 2.500000e+00)
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 2, float 3.000000e+00)
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 3, float 4.000000e+00)
+
+/****************************************************************************
+ * A banner long enough to be scanned a vector at a time, with a / and a *
+ * that do not end it: * / / * /
+ ****************************************************************************/
+float4 main() : SV_Target {
+                                        return float4(
+		 		 		 		 		 		 		 		 		 		 1.000000000000000000000000000000000e+1,
+                                              2500000000000000000000000000000e-30,
+                                              3.00000000000000000000000000000000.x,
+                                              4.000000000000000000000000000000/* a
+                                              comment */);
+}
+
@@ -0,0 +1,30 @@
+// RUN: %dxc -E main -T vs_6_0 -downstream-input TEXCOORD1 -downstream-input COLOR %s | FileCheck %s
+// RUN: %dxc -E main -T vs_6_0 %s | FileCheck -check-prefix=ALL %s
+
+// Make sure outputs the next stage doesn't read are removed and the rest is
+// packed without them, while system values are kept.
+
+// CHECK: ; Output signature:
+// CHECK: ; SV_Position              0   xyzw        0      POS   float   xyzw
+// CHECK-NEXT: ; TEXCOORD                 1   xy          1     NONE   float   xy
+// CHECK-NEXT: ; COLOR                    0   xyzw        2     NONE   float   xyzw
+// CHECK-NOT: TEXCOORD                 0
+
+// ALL: ; Output signature:
+// ALL: ; TEXCOORD                 0
+
+struct VSOut {
+  float4 pos : SV_Position;
+  float4 unused : TEXCOORD0;
+  float2 uv : TEXCOORD1;
+  float4 color : COLOR;
+};
+
+VSOut main(float4 pos : POSITION, float4 color : COLOR) {
+  VSOut o;
+  o.pos = pos;
+  o.unused = pos * 2;
+  o.uv = pos.xy;
+  o.color = color;
+  return o;
+}
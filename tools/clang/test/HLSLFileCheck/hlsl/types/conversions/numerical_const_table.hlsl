@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Tests numerical tables initialized from constant lists, which are
+// emitted directly as constant data, with the same conversions as
+// other constant initialization lists.
+
+// CHECK-DAG: = internal unnamed_addr constant [4 x float] [float 5.000000e-01, float 1.000000e+00, float -2.000000e+00, float 3.250000e+00]
+// CHECK-DAG: = internal unnamed_addr constant [4 x i32] [i32 1, i32 -1, i32 2, i32 7]
+// CHECK-DAG: = internal unnamed_addr constant [6 x i32] [i32 1, i32 2, i32 3, i32 4, i32 5, i32 6]
+
+static const float f[] = { 0.5, 1, -2.0f, 3.25h };
+static const uint u[4] = { true, -1, 2.75, (uint)7 };
+static const int i[2][3] = { { 1, 2, 3 }, { 4, 5, 6 } };
+
+uint3 idx;
+
+float main() : SV_Target {
+  return f[idx.x] + u[idx.y] + i[idx.x][idx.z];
+}
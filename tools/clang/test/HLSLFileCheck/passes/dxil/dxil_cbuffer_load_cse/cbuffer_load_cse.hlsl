@@ -0,0 +1,30 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// Make sure cbuffer loads are hoisted out of loops with UAV writes, and loads
+// of the same row in both branches are merged into the dominating block.
+
+// CHECK: cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{[^,]+}}, i32 0)
+// CHECK: phi
+// CHECK-NOT: cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{[^,]+}}, i32 0)
+// CHECK: cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{[^,]+}}, i32 1)
+// CHECK: br i1
+// CHECK-NOT: cbufferLoadLegacy
+
+cbuffer C {
+  float4 a;
+  float4 b;
+};
+
+RWBuffer<float> U;
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  [loop]
+  for (uint i = 0; i < id; i++) {
+    U[i] = a.x * i;
+  }
+  if (id & 1)
+    U[id] = b.y * U[id + 1];
+  else
+    U[id + 2] = sqrt(b.y) + U[id + 3];
+}
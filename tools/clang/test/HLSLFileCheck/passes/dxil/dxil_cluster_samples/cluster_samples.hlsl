@@ -0,0 +1,25 @@
+// RUN: %dxc -E main -T ps_6_0 -opt-enable cluster-samples %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck -check-prefix=DEFAULT %s
+
+// Make sure the independent second sample is moved above the math using the
+// first one, but only when enabled.
+
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60
+// CHECK-NOT: fmul
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60
+// CHECK: fmul
+
+// DEFAULT: call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60
+// DEFAULT: fmul
+// DEFAULT: call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60
+
+Texture2D t0;
+Texture2D t1;
+SamplerState s;
+
+float4 main(float2 uv : UV, float2 uv2 : UV2) : SV_Target {
+  float4 a = t0.Sample(s, uv);
+  float x = a.x * a.y;
+  float4 b = t1.Sample(s, uv2);
+  return b * x;
+}
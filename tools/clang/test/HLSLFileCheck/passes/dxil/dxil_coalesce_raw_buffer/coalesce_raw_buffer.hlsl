@@ -0,0 +1,22 @@
+// RUN: %dxc -E main -T cs_6_2 %s | FileCheck %s
+
+// Make sure contiguous scalar raw buffer accesses are merged.
+
+// CHECK: call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32 139, %dx.types.Handle %{{[a-zA-Z0-9_]+}}, i32 %[[Addr:[0-9]+]], i32 undef, i8 7, i32 4)
+// CHECK-NOT: rawBufferLoad
+// CHECK: call void @dx.op.rawBufferStore.i32(i32 140, %dx.types.Handle %{{[a-zA-Z0-9_]+}}, i32 %{{[0-9]+}}, i32 undef, i32 %{{[0-9]+}}, i32 %{{[0-9]+}}, i32 %{{[0-9]+}}, i32 %{{[0-9]+}}, i8 15, i32 4)
+// CHECK-NOT: rawBufferStore
+
+ByteAddressBuffer In;
+RWByteAddressBuffer Out;
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  uint addr = id * 16;
+  uint a = In.Load(addr);
+  uint b = In.Load(addr + 4);
+  uint c = In.Load(addr + 8);
+  Out.Store(addr, a + b);
+  Out.Store(addr + 4, b + c);
+  Out.Store2(addr + 8, uint2(a, c));
+}
@@ -0,0 +1,26 @@
+// RUN: %dxc -Emain -Tvs_6_0 %s | %opt -S -hlsl-dxil-eliminate-output-dynamic | %FileCheck %s
+
+// Only the dynamically indexed column is copied out; column 1 keeps its
+// direct store and columns 2 and 3 are never written.
+
+// CHECK-NOT: storeOutput.f32(i32 5, i32 1, i32 %
+// CHECK-NOT: storeOutput.f32(i32 5, i32 1, i32 {{[0-9]+}}, i8 1
+// CHECK: storeOutput.f32(i32 5, i32 1, i32 1, i8 1, float 2.000000e+00)
+// CHECK-NOT: storeOutput.f32(i32 5, i32 1, i32 {{[0-9]+}}, i8 1
+// CHECK: storeOutput.f32(i32 5, i32 1, i32 0, i8 0
+// CHECK: storeOutput.f32(i32 5, i32 1, i32 1, i8 0
+// CHECK: storeOutput.f32(i32 5, i32 1, i32 2, i8 0
+// CHECK: storeOutput.f32(i32 5, i32 1, i32 3, i8 0
+// CHECK-NOT: storeOutput.f32(i32 5, i32 1, i32 {{[0-9]+}}, i8 {{[123]}}
+
+int  count;
+float4 c[16];
+
+float4 main(out float4 o[4] : I, float4 pos: POS) : SV_POSITION {
+
+    for (uint i=0;i<count;i++)
+        o[i].x = c[i].x;
+    o[1].y = 2;
+
+    return pos;
+}
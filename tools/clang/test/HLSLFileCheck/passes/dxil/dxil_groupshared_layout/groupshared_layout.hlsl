@@ -0,0 +1,30 @@
+// RUN: %dxc -E main -T cs_6_0 -opt-enable groupshared-layout %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_0 -opt-enable groupshared-layout %s | FileCheck -input=stderr -check-prefix=NOTE %s
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck -check-prefix=DEFAULT %s
+
+// Make sure groupshared vector arrays are split into one array per component,
+// and arrays accessed in rows of 32 elements are padded.
+
+// CHECK-DAG: @"\01?cache@@{{.*}}.s0" = addrspace(3) global [64 x float] undef
+// CHECK-DAG: @"\01?cache@@{{.*}}.s3" = addrspace(3) global [64 x float] undef
+// CHECK-DAG: @"\01?tile@@{{.*}}" = addrspace(3) global [1055 x float] undef
+
+// NOTE-DAG: note: groupshared ?cache@@{{.*}} split into 4 arrays to avoid bank conflicts
+// NOTE-DAG: note: groupshared ?tile@@{{.*}} padded every 32 elements to avoid bank conflicts
+
+// DEFAULT-DAG: addrspace(3) global [256 x float] undef
+// DEFAULT-DAG: addrspace(3) global [1024 x float] undef
+
+StructuredBuffer<uint> Indices;
+RWStructuredBuffer<float4> Data;
+
+groupshared float4 cache[64];
+groupshared float tile[32][32];
+
+[numthreads(32, 1, 1)]
+void main(uint tid : SV_GroupIndex) {
+  cache[Indices[tid]] = Data[tid];
+  tile[tid][Indices[tid + 32]] = Data[tid + 32].x;
+  GroupMemoryBarrierWithGroupSync();
+  Data[tid] = cache[Indices[tid + 64]] + tile[Indices[tid + 96]][tid];
+}
@@ -0,0 +1,26 @@
+// RUN: %dxc -E main -T ps_6_6 %s | FileCheck %s
+
+// Make sure a handle from a loop invariant heap index is created once before
+// the loop, even though the loop writes to a UAV.
+
+// CHECK: call %dx.types.Handle @dx.op.createHandleFromHeap(i32 218
+// CHECK: call %dx.types.Handle @dx.op.annotateHandle(
+// CHECK-NOT: @dx.op.createHandleFromHeap(
+// CHECK: phi
+// CHECK-NOT: @dx.op.createHandleFromHeap(
+// CHECK: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(
+
+uint count;
+uint index;
+RWByteAddressBuffer Out : register(u0);
+
+float main() : SV_Target {
+  float r = 0;
+  [loop]
+  for (uint i = 0; i < count; ++i) {
+    Buffer<float> b = ResourceDescriptorHeap[index];
+    r += b[i];
+    Out.Store(i * 4, asuint(r));
+  }
+  return r;
+}
@@ -0,0 +1,24 @@
+// RUN: %dxc -E main -T vs_6_0 -opt-enable matrix-layout %s | FileCheck %s
+// RUN: %dxc -E main -T vs_6_0 %s | FileCheck -check-prefix=DEFAULT %s
+
+// Make sure a matrix without a qualifier is stored row_major when only one of
+// its rows is read, so the row takes one register instead of four, and that
+// the layout reported follows. Qualified matrices keep their orientation.
+
+// CHECK: ; row_major float4x4 World;
+// CHECK: ; column_major float4x4 Fixed;
+// CHECK-NOT: cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{[^,]+}}, i32 {{[012]}})
+// CHECK: cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{[^,]+}}, i32 3)
+// CHECK-NOT: cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{[^,]+}}, i32 {{[0123]}})
+
+// DEFAULT: ; column_major float4x4 World;
+// DEFAULT: cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{[^,]+}}, i32 0)
+
+cbuffer C {
+  float4x4 World;
+  column_major float4x4 Fixed;
+};
+
+float4 main(float4 p : P) : SV_Position {
+  return p + World[3] + Fixed[3];
+}
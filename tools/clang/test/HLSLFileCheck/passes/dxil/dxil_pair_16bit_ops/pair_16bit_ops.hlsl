@@ -0,0 +1,12 @@
+// RUN: %dxc -E main -T ps_6_2 -enable-16bit-types -opt-enable pair-16bit-ops %s | FileCheck %s
+
+// Make sure independent 16-bit multiplies are scheduled next to each other.
+
+// CHECK: fmul fast half
+// CHECK-NEXT: fmul fast half
+// CHECK: fadd fast half
+// CHECK-NEXT: fadd fast half
+
+half2 main(half2 a : A, half2 b : B, half2 c : C) : SV_Target {
+  return a * b + c;
+}
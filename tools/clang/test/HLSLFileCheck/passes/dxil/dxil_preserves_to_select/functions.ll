@@ -0,0 +1,44 @@
+; RUN: %opt %s -dxil-preserves-to-select -S | FileCheck %s
+
+; Make sure each function reads the preserve condition once, however many
+; preserves it has, and never uses the condition of another function.
+
+; CHECK-LABEL: define i32 @foo(
+; CHECK: %[[load0:[0-9]+]] = load i32, i32* getelementptr {{.*}}@dx.preserve.value.a
+; CHECK: %[[cond0:[0-9]+]] = trunc i32 %[[load0]] to i1
+; CHECK-NOT: @dx.preserve.value.a
+; CHECK: select i1 %[[cond0]], i32 undef, i32 %a
+; CHECK-NOT: @dx.preserve.value.a
+; CHECK: select i1 %[[cond0]], i32 %{{.+}}, i32 %b
+; CHECK: ret
+
+; CHECK-LABEL: define float @bar(
+; CHECK: %[[load1:[0-9]+]] = load i32, i32* getelementptr {{.*}}@dx.preserve.value.a
+; CHECK: %[[cond1:[0-9]+]] = trunc i32 %[[load1]] to i1
+; CHECK-NOT: @dx.preserve.value.a
+; CHECK: select i1 %[[cond1]], float undef, float %x
+; CHECK: ret
+
+; CHECK-NOT: @dx.preserve.i32
+; CHECK-NOT: @dx.preserve.f32
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+define i32 @foo(i32 %a, i32 %b) {
+entry:
+  %p0 = call i32 @dx.preserve.i32(i32 %a, i32 %a)
+  %p1 = call i32 @dx.preserve.i32(i32 %b, i32 %p0)
+  ret i32 %p1
+}
+
+define float @bar(float %x) {
+entry:
+  %p = call float @dx.preserve.f32(float %x, float %x)
+  ret float %p
+}
+
+declare i32 @dx.preserve.i32(i32, i32) #0
+declare float @dx.preserve.f32(float, float) #0
+
+attributes #0 = { nounwind readnone }
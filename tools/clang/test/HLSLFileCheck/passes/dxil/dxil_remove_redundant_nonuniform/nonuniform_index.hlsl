@@ -0,0 +1,24 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Make sure NonUniformResourceIndex is dropped for indices that are uniform
+// across the wave, and the disassembly shows the uniformity of dynamic indices.
+
+// CHECK: call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %{{[0-9]+}}, i1 false)
+// CHECK-SAME: ; uniform index
+// CHECK: call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %{{[0-9]+}}, i1 false)
+// CHECK-SAME: ; uniform index
+// CHECK: call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %{{[0-9]+}}, i1 true)
+// CHECK-SAME: ; divergent index
+
+Texture2D<float4> T[] : register(t0);
+
+cbuffer C {
+  uint idx;
+};
+
+float4 main(uint i : I) : SV_Target {
+  float4 r = T[NonUniformResourceIndex(idx)].Load(int3(0, 0, 0));
+  r += T[NonUniformResourceIndex(WaveReadLaneFirst(i))].Load(int3(1, 0, 0));
+  r += T[NonUniformResourceIndex(i)].Load(int3(2, 0, 0));
+  return r;
+}
@@ -0,0 +1,31 @@
+// RUN: %dxc -E main -T ps_6_0 -spec-constants %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -spec-constants %s | %opt -S "-hlsl-dxil-specialize-constants,values=1=true;3=2.0" | FileCheck -check-prefix=SPEC %s
+// RUN: %dxc -E main -T ps_6_0 -spec-constants %s | %opt -S -hlsl-dxil-specialize-constants | FileCheck -check-prefix=DEFAULT %s
+
+// Make sure [[vk::constant_id]] globals compile to placeholders, and that the
+// specializer substitutes the given values or the defaults and folds the
+// result.
+
+// CHECK-DAG: call i32 @dx.specconst.i32(i32 1, i32 0)
+// CHECK-DAG: call float @dx.specconst.f32(i32 3, float 1.000000e+00)
+
+// SPEC-NOT: dx.specconst
+// SPEC: fmul fast float %{{.*}}, 2.000000e+00
+// SPEC: fadd fast float %{{.*}}, 1.000000e+00
+// SPEC-NOT: dx.specconst
+
+// DEFAULT-NOT: dx.specconst
+// DEFAULT-NOT: fmul
+// DEFAULT-NOT: fadd
+// DEFAULT: call void @dx.op.storeOutput.f32
+// DEFAULT-NOT: dx.specconst
+
+[[vk::constant_id(1)]] const bool UseFog = false;
+[[vk::constant_id(3)]] const float Scale = 1.0;
+
+float4 main(float4 c : COLOR) : SV_Target {
+  float4 r = c * Scale;
+  if (UseFog)
+    r += 1;
+  return r;
+}
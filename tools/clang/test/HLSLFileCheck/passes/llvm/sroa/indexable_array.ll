@@ -0,0 +1,31 @@
+; RUN: %opt %s -dxil-cond-mem2reg,IndexableArrayLimit=8 -instcombine -sroa -S | FileCheck %s
+
+; Make sure a dynamically indexed array of at least IndexableArrayLimit
+; scalars is marked and stays in memory after its index folds to a constant,
+; while a smaller one is still split.
+
+; CHECK: %big = alloca [8 x float], !dx.indexable
+; CHECK-NOT: alloca [2 x float]
+; CHECK: getelementptr inbounds [8 x float], [8 x float]* %big, i32 0, i32 1
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+define float @main(i32 %x, float %v) {
+entry:
+  %big = alloca [8 x float]
+  %small = alloca [2 x float]
+  %zero = sub i32 %x, %x
+  %idx = add i32 %zero, 1
+  %big.p = getelementptr inbounds [8 x float], [8 x float]* %big, i32 0, i32 %idx
+  store float %v, float* %big.p
+  %small.p = getelementptr inbounds [2 x float], [2 x float]* %small, i32 0, i32 %idx
+  store float %v, float* %small.p
+  br label %exit
+
+exit:
+  %big.l = load float, float* %big.p
+  %small.l = load float, float* %small.p
+  %r = fadd float %big.l, %small.l
+  ret float %r
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -EMain -Tps_6_0 %s | %opt -S -hlsl-dxil-pix-shader-access-instrumentation,config=S0:1:1i1;.0;0;0.,waveCoalesce=1 | %FileCheck %s
+
+// Check that the first sample's access is recorded by one lane of the wave:
+// CHECK: %IsFirstLane = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: br i1 %IsFirstLane
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_CountUAV_Handle
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sample.f32
+
+// Check that the repeated access, which the first one dominates, is not
+// recorded again:
+// CHECK-NOT: @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_CountUAV_Handle
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sample.f32
+
+Texture2D tex : register(t0);
+SamplerState samp : register(s0);
+
+float4 Main(float2 uv : TEXCOORD0) : SV_Target {
+  return tex.Sample(samp, uv) + tex.Sample(samp, uv * 2);
+}
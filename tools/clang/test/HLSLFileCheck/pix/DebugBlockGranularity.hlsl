@@ -0,0 +1,32 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -dxil-annotate-with-virtual-regs -hlsl-dxil-debug-instrumentation,parameter0=8,parameter1=16,parameter0Range=4,parameter1Range=2,BlockGranularity=1 | %FileCheck %s
+
+// Check that a range of pixels is selected:
+
+// CHECK: %CompareToXOffset = sub i32 %XIndex, 8
+// CHECK: %CompareToX = icmp ult i32 %CompareToXOffset, 4
+// CHECK: %CompareToYOffset = sub i32 %YIndex, 16
+// CHECK: %CompareToY = icmp ult i32 %CompareToYOffset, 2
+
+// Check that space is allocated once per wave, by its first lane:
+
+// CHECK: %LanesOfInterest = call i32 @dx.op.waveAllOp(i32 135, i1 %ComparePos)
+// CHECK: %PrecedingLanesOfInterest = call i32 @dx.op.wavePrefixOp(i32 136, i1 %ComparePos)
+// CHECK: %IsFirstLane = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: %IncrementForThisLane = mul i32 %SpaceForWave, %FirstLaneMultiplicand
+// CHECK: %UAVIncResult = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_DebugUAV_Handle, i32 0, i32 {{[0-9]+}}, i32 undef, i32 undef, i32 %IncrementForThisLane)
+// CHECK: %WaveBase = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %UAVIncResult)
+// CHECK: %LaneOffset = add i32 %WaveBase, %OffsetInWave
+
+// Check that the records of the entry block are reserved with one more atomic:
+
+// CHECK: %UAVIncResult{{[0-9]+}} = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_DebugUAV_Handle, i32 0, i32 {{[0-9]+}}, i32 undef, i32 undef, i32 %IncrementForThisLane
+
+[RootSignature("")]
+float4 main(float4 pos : SV_Position, float f : TEXCOORD0) : SV_Target {
+  float r = f;
+  if (f < 1024)
+    r = sin(f);
+  else
+    r = cos(f) + 100;
+  return float4(r, r * 2, r * 3, 1);
+}
@@ -0,0 +1,48 @@
+// RUN: %dxc -Emain -Tms_6_5 %s | %opt -S -hlsl-dxil-pix-meshshader-output-instrumentation,waveCoalesce=1 | %FileCheck %s
+
+// Check that the first lane reserves the records of the whole wave with one
+// atomic, and each lane offsets its record by the lanes before it:
+// CHECK: %IsFirstLane = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: %ActiveLanes = call i32 @dx.op.waveAllOp(i32 135, i1 true)
+// CHECK: %LanesBefore = call i32 @dx.op.wavePrefixOp(i32 136, i1 true)
+// CHECK: %WaveSpaceInBytes = mul i32 %ActiveLanes, 36
+// CHECK: br i1 %IsFirstLane
+// CHECK: %UAVIncResult = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_DebugUAV_Handle, i32 0, i32 {{[0-9]+}}, i32 undef, i32 undef, i32 %WaveSpaceInBytes)
+// CHECK: %WaveUAVIncResult = phi i32
+// CHECK: %WaveBase = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %WaveUAVIncResult)
+// CHECK: %LaneUAVIncResult = add i32 %WaveBase,
+
+// Check that the nine dwords of a vertex output record are written with
+// three stores:
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, {{.*}}, i8 15)
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, {{.*}}, i8 15)
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, {{.*}}, i8 1)
+// CHECK: call void @dx.op.storeVertexOutput
+
+// Check that the seven dwords of a triangle record are written with two:
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, {{.*}}, i8 15)
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, {{.*}}, i8 7)
+// CHECK: call void @dx.op.emitIndices
+
+struct smallPayload {
+  uint dummy;
+};
+
+struct PSInput {
+  float4 position : SV_POSITION;
+  float4 color : COLOR;
+};
+
+[outputtopology("triangle")]
+[numthreads(3, 1, 1)]
+void main(
+    in payload smallPayload small,
+    in uint tid : SV_DispatchThreadID,
+    out vertices PSInput verts[3],
+    out indices uint3 triangles[1]) {
+
+  SetMeshOutputCounts(3 /*verts*/, 1 /*prims*/);
+  verts[tid].position = float4(0, 0, 0, 0);
+  verts[tid].color = float4(0, 0, 0, 0);
+  triangles[0] = uint3(0, 1, 2);
+}
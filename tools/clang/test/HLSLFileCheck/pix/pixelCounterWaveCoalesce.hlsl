@@ -0,0 +1,18 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -hlsl-dxil-add-pixel-hit-instrmentation,rt-width=16,num-pixels=64,wave-coalesce=1 | %FileCheck %s
+
+// Check that lanes on the first lane's pixel are counted together:
+// CHECK: %FirstLaneValue = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %ByteIndex)
+// CHECK: %SharesFirstLaneValue = icmp eq i32 %ByteIndex, %FirstLaneValue
+// CHECK: %IsFirstLane = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: %LanesSharingIndex = call i32 @dx.op.waveAllOp(i32 135, i1 %SharesFirstLaneValue)
+// CHECK: %IsRepresentative = or i1 %IsFirstLane,
+// CHECK: br i1 %IsRepresentative
+
+// Check the write to the UAV is made by the representative lanes only:
+// CHECK: %Increment = select i1 %IsFirstLane, i32 %LanesSharingIndex, i32 1
+// CHECK: %UAVIncResult = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_CountUAV_Handle, i32 0, i32 %ByteIndex, i32 undef, i32 undef, i32 %Increment)
+// CHECK: ret void
+
+float4 main(float4 pos : SV_Position) : SV_Target {
+  return pos;
+}
@@ -0,0 +1,22 @@
+// RUN: %dxc -T lib_6_3 -Qcompress_bitcode %s | FileCheck %s
+// RUN: %dxc -T lib_6_3 -Qcompress_bitcode -Zi -Qembed_debug %s | FileCheck %s -check-prefix=DBG
+
+// Make sure a library whose bitcode is compressed still validates, and
+// disassembles from its expanded program or debug part.
+
+// CHECK: @entry(
+// CHECK: !dx.entryPoints
+
+// DBG: @entry(
+// DBG: !DICompileUnit
+
+RWBuffer<float> buf;
+
+float scale(float f) {
+  return f * 2;
+}
+
+[numthreads(8,8,1)]
+void entry(uint idx : SV_GroupIndex) {
+  buf[idx] = scale(buf[idx]);
+}
@@ -0,0 +1,28 @@
+// RUN: %dxc -T lib_6_3 -exports keep -fcgl %s | FileCheck %s
+
+// Verify helpers that no export reaches are gone from the high-level module.
+// CHECK-NOT: unreached_helper
+// CHECK-NOT: unreached_leaf
+// CHECK: define {{.*}}keep
+// CHECK-NOT: unreached_helper
+// CHECK-NOT: unreached_leaf
+
+float unreached_leaf(float f) {
+  return f * 3.0;
+}
+
+float unreached_helper(float f) {
+  return unreached_leaf(f) + 1.0;
+}
+
+float shared_helper(float f) {
+  return f * 2.0;
+}
+
+export float keep(float f) {
+  return shared_helper(f);
+}
+
+export float drop(float f) {
+  return unreached_helper(f) + shared_helper(f);
+}
@@ -23,24 +23,39 @@ HRESULT CreateLibrary(IDxcLibrary **pLibrary) {
                            (void **)pLibrary);
 }
 
-HRESULT CreateCompiler(IDxcCompiler **ppCompiler) {
-  return DxcCreateInstance(CLSID_DxcCompiler, __uuidof(IDxcCompiler),
-                           (void **)ppCompiler);
-}
-
 HRESULT CreateContainerReflection(IDxcContainerReflection **ppReflection) {
   return DxcCreateInstance(CLSID_DxcContainerReflection,
                            __uuidof(IDxcContainerReflection),
                            (void **)ppReflection);
 }
 
-HRESULT CompileFromBlob(IDxcBlobEncoding *pSource, LPCWSTR pSourceName,
-                        const D3D_SHADER_MACRO *pDefines, IDxcIncludeHandler *pInclude,
-                        LPCSTR pEntrypoint, LPCSTR pTarget, UINT Flags1,
-                        UINT Flags2, ID3DBlob **ppCode,
-                        ID3DBlob **ppErrorMsgs) {
-  CComPtr<IDxcCompiler> compiler;
-  CComPtr<IDxcOperationResult> operationResult;
+// Callers may compile thousands of shaders through the bridge, so each
+// thread keeps the compiler and utilities it created for its later calls.
+// Neither is shared between threads.
+thread_local CComPtr<IDxcCompiler3> g_pThreadCompiler;
+thread_local CComPtr<IDxcUtils> g_pThreadUtils;
+
+HRESULT GetThreadCompiler(IDxcCompiler3 **ppCompiler) {
+  if (g_pThreadCompiler == nullptr)
+    IFR(DxcCreateInstance(CLSID_DxcCompiler, __uuidof(IDxcCompiler3),
+                          (void **)&g_pThreadCompiler));
+  return g_pThreadCompiler.CopyTo(ppCompiler);
+}
+
+HRESULT GetThreadUtils(IDxcUtils **ppUtils) {
+  if (g_pThreadUtils == nullptr)
+    IFR(DxcCreateInstance(CLSID_DxcUtils, __uuidof(IDxcUtils),
+                          (void **)&g_pThreadUtils));
+  return g_pThreadUtils.CopyTo(ppUtils);
+}
+
+HRESULT CompileFromBuffer(const DxcBuffer &source, LPCWSTR pSourceName,
+                          const D3D_SHADER_MACRO *pDefines, IDxcIncludeHandler *pInclude,
+                          LPCSTR pEntrypoint, LPCSTR pTarget, UINT Flags1,
+                          UINT Flags2, ID3DBlob **ppCode,
+                          ID3DBlob **ppErrorMsgs) {
+  CComPtr<IDxcCompiler3> compiler;
+  CComPtr<IDxcResult> result;
   HRESULT hr;
 
   // Upconvert legacy targets
@@ -52,34 +67,29 @@ HRESULT CompileFromBlob(IDxcBlobEncoding *pSource, LPCWSTR pSourceName,
   }
 
   try {
-    CA2W pEntrypointW(pEntrypoint, CP_UTF8);
-    CA2W pTargetProfileW(pTarget, CP_UTF8);
-    std::vector<std::wstring> defineValues;
-    std::vector<DxcDefine> defines;
+    // The entry point, target and defines go in the arguments, which the
+    // compiler reads without further conversion.
+    std::vector<std::wstring> argValues;
+    if (pSourceName)
+      argValues.push_back(pSourceName);
+    argValues.push_back(L"-E");
+    argValues.push_back(std::wstring(CA2W(pEntrypoint, CP_UTF8)));
+    argValues.push_back(L"-T");
+    argValues.push_back(std::wstring(CA2W(pTarget, CP_UTF8)));
     if (pDefines) {
-      CONST D3D_SHADER_MACRO *pCursor = pDefines;
-
-      // Convert to UTF-16.
-      while (pCursor->Name) {
-        defineValues.push_back(std::wstring(CA2W(pCursor->Name, CP_UTF8)));
+      for (CONST D3D_SHADER_MACRO *pCursor = pDefines; pCursor->Name; ++pCursor) {
+        std::wstring define(CA2W(pCursor->Name, CP_UTF8));
+        define += L'=';
         if (pCursor->Definition)
-          defineValues.push_back(std::wstring(CA2W(pCursor->Definition, CP_UTF8)));
-        else
-          defineValues.push_back(std::wstring());
-        ++pCursor;
-      }
-
-      // Build up array.
-      pCursor = pDefines;
-      size_t i = 0;
-      while (pCursor->Name) {
-        defines.push_back(
-            DxcDefine{defineValues[i++].c_str(), defineValues[i++].c_str()});
-        ++pCursor;
+          define += CA2W(pCursor->Definition, CP_UTF8);
+        argValues.push_back(L"-D");
+        argValues.push_back(std::move(define));
       }
     }
 
     std::vector<LPCWSTR> arguments;
+    for (const std::wstring &value : argValues)
+      arguments.push_back(value.c_str());
     if(Flags1 & D3DCOMPILE_ENABLE_BACKWARDS_COMPATIBILITY) arguments.push_back(L"/Gec");
     // /Ges Not implemented:
     //if(Flags1 & D3DCOMPILE_ENABLE_STRICTNESS) arguments.push_back(L"/Ges");
@@ -107,23 +117,21 @@ HRESULT CompileFromBlob(IDxcBlobEncoding *pSource, LPCWSTR pSourceName,
     arguments.push_back(L"-HV");
     arguments.push_back(L"2016");
 
-    IFR(CreateCompiler(&compiler));
-    IFR(compiler->Compile(pSource, pSourceName, pEntrypointW, pTargetProfileW,
-                          arguments.data(), (UINT)arguments.size(),
-                          defines.data(), (UINT)defines.size(), pInclude,
-                          &operationResult));
+    IFR(GetThreadCompiler(&compiler));
+    IFR(compiler->Compile(&source, arguments.data(), (UINT32)arguments.size(),
+                          pInclude, IID_PPV_ARGS(&result)));
   } catch (const std::bad_alloc &) {
     return E_OUTOFMEMORY;
   } catch (const CAtlException &err) {
     return err.m_hr;
   }
 
-  operationResult->GetStatus(&hr);
+  result->GetStatus(&hr);
   if (SUCCEEDED(hr)) {
-    return operationResult->GetResult((IDxcBlob **)ppCode);
+    return result->GetResult((IDxcBlob **)ppCode);
   } else {
     if (ppErrorMsgs)
-      operationResult->GetErrorBuffer((IDxcBlobEncoding **)ppErrorMsgs);
+      result->GetErrorBuffer((IDxcBlobEncoding **)ppErrorMsgs);
     return hr;
   }
 }
@@ -134,29 +142,28 @@ HRESULT WINAPI BridgeD3DCompile(LPCVOID pSrcData, SIZE_T SrcDataSize,
                                 ID3DInclude *pInclude, LPCSTR pEntrypoint,
                                 LPCSTR pTarget, UINT Flags1, UINT Flags2,
                                 ID3DBlob **ppCode, ID3DBlob **ppErrorMsgs) {
-  CComPtr<IDxcLibrary> library;
-  CComPtr<IDxcBlobEncoding> source;
+  CComPtr<IDxcUtils> utils;
   CComPtr<IDxcIncludeHandler> includeHandler;
 
   *ppCode = nullptr;
   if (ppErrorMsgs != nullptr)
     *ppErrorMsgs = nullptr;
 
-  IFR(CreateLibrary(&library));
-  IFR(library->CreateBlobWithEncodingFromPinned((LPBYTE)pSrcData, SrcDataSize,
-                                                CP_ACP, &source));
-
   // Until we actually wrap the include handler, fail if there's a user-supplied handler.
   if (D3D_COMPILE_STANDARD_FILE_INCLUDE == pInclude) {
-    IFR(library->CreateIncludeHandler(&includeHandler));
+    IFR(GetThreadUtils(&utils));
+    IFR(utils->CreateDefaultIncludeHandler(&includeHandler));
   } else if (pInclude) {
     return E_INVALIDARG;
   }
 
+  // The source is read in place.
+  DxcBuffer source = { pSrcData, SrcDataSize, CP_ACP };
   try {
     CA2W pFileName(pSourceName, CP_UTF8);
-    return CompileFromBlob(source, pFileName, pDefines, includeHandler, pEntrypoint,
-                           pTarget, Flags1, Flags2, ppCode, ppErrorMsgs);
+    return CompileFromBuffer(source, pSourceName ? (LPCWSTR)pFileName : nullptr,
+                             pDefines, includeHandler, pEntrypoint, pTarget,
+                             Flags1, Flags2, ppCode, ppErrorMsgs);
   } catch (const std::bad_alloc &) {
     return E_OUTOFMEMORY;
   } catch (const CAtlException &err) {
@@ -182,7 +189,7 @@ HRESULT WINAPI BridgeD3DCompileFromFile(
     LPCWSTR pFileName, const D3D_SHADER_MACRO *pDefines, ID3DInclude *pInclude,
     LPCSTR pEntrypoint, LPCSTR pTarget, UINT Flags1, UINT Flags2,
     ID3DBlob **ppCode, ID3DBlob **ppErrorMsgs) {
-  CComPtr<IDxcLibrary> library;
+  CComPtr<IDxcUtils> utils;
   CComPtr<IDxcBlobEncoding> source;
   CComPtr<IDxcIncludeHandler> includeHandler;
   HRESULT hr;
@@ -191,23 +198,28 @@ HRESULT WINAPI BridgeD3DCompileFromFile(
   if (ppErrorMsgs != nullptr)
     *ppErrorMsgs = nullptr;
 
-  hr = CreateLibrary(&library);
+  hr = GetThreadUtils(&utils);
   if (FAILED(hr))
     return hr;
-  hr = library->CreateBlobFromFile(pFileName, nullptr, &source);
+  hr = utils->LoadFile(pFileName, nullptr, &source);
   if (FAILED(hr))
     return hr;
 
   // Until we actually wrap the include handler, fail if there's a user-supplied handler.
   if (D3D_COMPILE_STANDARD_FILE_INCLUDE == pInclude) {
-    IFT(library->CreateIncludeHandler(&includeHandler));
+    IFR(utils->CreateDefaultIncludeHandler(&includeHandler));
   }
   else if (pInclude) {
     return E_INVALIDARG;
   }
 
-  return CompileFromBlob(source, pFileName, pDefines, includeHandler, pEntrypoint,
-                         pTarget, Flags1, Flags2, ppCode, ppErrorMsgs);
+  BOOL known;
+  UINT32 codePage;
+  IFR(source->GetEncoding(&known, &codePage));
+  DxcBuffer buffer = { source->GetBufferPointer(), source->GetBufferSize(),
+                       known ? codePage : CP_ACP };
+  return CompileFromBuffer(buffer, pFileName, pDefines, includeHandler, pEntrypoint,
+                           pTarget, Flags1, Flags2, ppCode, ppErrorMsgs);
 }
 
 HRESULT WINAPI BridgeD3DDisassemble(
@@ -216,22 +228,22 @@ HRESULT WINAPI BridgeD3DDisassemble(
   _In_ UINT Flags,
   _In_opt_ LPCSTR szComments,
   _Out_ ID3DBlob** ppDisassembly) {
-  CComPtr<IDxcLibrary> library;
-  CComPtr<IDxcCompiler> compiler;
-  CComPtr<IDxcBlobEncoding> source;
-  CComPtr<IDxcBlobEncoding> disassemblyText;
+  CComPtr<IDxcCompiler3> compiler;
+  CComPtr<IDxcResult> result;
+  HRESULT hr;
 
   *ppDisassembly = nullptr;
 
   UNREFERENCED_PARAMETER(szComments);
   UNREFERENCED_PARAMETER(Flags);
 
-  IFR(CreateLibrary(&library));
-  IFR(library->CreateBlobWithEncodingFromPinned((LPBYTE)pSrcData, SrcDataSize,
-                                                CP_ACP, &source));
-  IFR(CreateCompiler(&compiler));
-  IFR(compiler->Disassemble(source, &disassemblyText));
-  IFR(disassemblyText.QueryInterface(ppDisassembly));
+  DxcBuffer source = { pSrcData, SrcDataSize, CP_ACP };
+  IFR(GetThreadCompiler(&compiler));
+  IFR(compiler->Disassemble(&source, IID_PPV_ARGS(&result)));
+  IFR(result->GetStatus(&hr));
+  IFR(hr);
+  IFR(result->GetOutput(DXC_OUT_DISASSEMBLY, __uuidof(IDxcBlobEncoding),
+                        (void **)ppDisassembly, nullptr));
 
   return S_OK;
 }
@@ -309,7 +321,9 @@ HRESULT PreprocessFromBlob(IDxcBlobEncoding *pSource, LPCWSTR pSourceName,
 
     std::vector<LPCWSTR> arguments;
 
-    IFR(CreateCompiler(&compiler));
+    CComPtr<IDxcCompiler3> compiler3;
+    IFR(GetThreadCompiler(&compiler3));
+    IFR(compiler3.QueryInterface(&compiler));
     IFR(compiler->Preprocess(pSource, pSourceName, arguments.data(),
                              (UINT)arguments.size(), defines.data(),
                              (UINT)defines.size(), pInclude, &operationResult));
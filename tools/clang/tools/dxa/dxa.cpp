@@ -17,14 +17,23 @@
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilContainerReader.h"
+#include "dxc/DxilContainer/DxilShaderArchive.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
+#include "dxc/Support/FileIOHelper.h"
 
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support//MSFileSystem.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <dia2.h>
 #include <intsafe.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
 
 using namespace llvm;
 using namespace llvm::opt;
@@ -59,6 +68,192 @@ static cl::opt<bool> DumpRootSig("dumprs",
                                cl::desc("Dump root signature"),
                                cl::init(false));
 
+static cl::list<std::string>
+    PackFiles("pack", cl::desc("Add a container to the shader archive written "
+                               "to -o (repeat, or use a response file)"),
+              cl::ZeroOrMore);
+
+static cl::opt<bool> ListArchive("listarchive",
+                                 cl::desc("List containers in input archive"),
+                                 cl::init(false));
+
+static cl::opt<std::string>
+    Unpack("unpack", cl::desc("Extract the named container from input archive"));
+
+static cl::list<std::string>
+    BatchInputs("batch", cl::desc("Process every file in a directory, or "
+                                  "matching a file name pattern with * and ?, "
+                                  "instead of the input (repeat)"),
+                cl::ZeroOrMore);
+
+static cl::opt<unsigned>
+    BatchThreads("batch-threads",
+                 cl::desc("Threads processing -batch files (default: one per "
+                          "core)"),
+                 cl::init(0));
+
+// A file given through -batch, and its path relative to the directory or
+// pattern it came from, which names its outputs under -o.
+struct BatchFile {
+  std::string Path;
+  std::string RelativePath;
+  bool operator<(const BatchFile &other) const { return Path < other.Path; }
+  bool operator==(const BatchFile &other) const { return Path == other.Path; }
+};
+
+// Matches * to any run of characters and ? to any one character.
+static bool MatchesPattern(StringRef pattern, StringRef name) {
+  size_t p = 0, n = 0;
+  size_t starP = StringRef::npos, starN = 0;
+  while (n < name.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+      ++p;
+      ++n;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      starP = p++;
+      starN = n;
+    } else if (starP != StringRef::npos) {
+      p = starP + 1;
+      n = ++starN;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*')
+    ++p;
+  return p == pattern.size();
+}
+
+// Appends the -batch files to files, sorted by path.
+static void ExpandBatchInputs(std::vector<BatchFile> &files) {
+  size_t first = files.size();
+  for (const std::string &input : BatchInputs) {
+    std::error_code ec;
+    if (sys::fs::is_directory(input)) {
+      for (sys::fs::recursive_directory_iterator it(input, ec), end;
+           it != end && !ec; it.increment(ec)) {
+        if (sys::fs::is_regular_file(it->path())) {
+          StringRef path = it->path();
+          StringRef relative = path.substr(input.size());
+          files.push_back({path.str(), relative.ltrim("/\\").str()});
+        }
+      }
+      if (ec)
+        throw hlsl::Exception(E_FAIL, "cannot list directory '" + input + "'");
+      continue;
+    }
+
+    StringRef pattern = sys::path::filename(input);
+    if (pattern.find_first_of("*?") == StringRef::npos) {
+      files.push_back({input, pattern.str()});
+      continue;
+    }
+    std::string dir = sys::path::parent_path(input).str();
+    if (dir.empty())
+      dir = ".";
+    for (sys::fs::directory_iterator it(dir, ec), end; it != end && !ec;
+         it.increment(ec)) {
+      StringRef name = sys::path::filename(it->path());
+      if (MatchesPattern(pattern, name) &&
+          sys::fs::is_regular_file(it->path()))
+        files.push_back({it->path(), name.str()});
+    }
+    if (ec)
+      throw hlsl::Exception(E_FAIL, "cannot list directory '" + dir + "'");
+  }
+  std::sort(files.begin() + first, files.end());
+  files.erase(std::unique(files.begin() + first, files.end()), files.end());
+}
+
+// Maps pFileName rather than reading it where it is large enough.
+static void MapFileIntoBlob(StringRef fileName, IDxcBlobEncoding **ppBlob) {
+  UINT32 codePage = CP_ACP; // Binary, so don't detect an encoding.
+  IFTMSG(hlsl::DxcCreateBlobFromFileMapping(DxcGetThreadMallocNoRef(),
+                                            StringRefUtf16(fileName), &codePage,
+                                            ppBlob),
+         "cannot read '" + fileName.str() + "'");
+}
+
+// Calls fn(index) for every file on BatchThreads threads, including this one.
+// Failures are collected as "file: message" instead of stopping the batch.
+template <typename TFn>
+static void RunBatch(const std::vector<BatchFile> &files,
+                     sys::fs::MSFileSystem *pFileSystem, TFn fn,
+                     std::vector<std::string> &errors) {
+  std::atomic<size_t> next(0);
+  std::mutex errorsLock;
+  auto work = [&]() {
+    while (true) {
+      size_t i = next++;
+      if (i >= files.size())
+        return;
+      std::string message;
+      try {
+        fn(i);
+        continue;
+      } catch (const hlsl::Exception &e) {
+        message = e.msg;
+        if (message.empty()) {
+          char code[32];
+          sprintf_s(code, _countof(code), "error code 0x%08x", e.hr);
+          message = code;
+        }
+      } catch (std::bad_alloc &) {
+        message = "out of memory";
+      } catch (...) {
+        message = "unknown error";
+      }
+      std::lock_guard<std::mutex> lock(errorsLock);
+      errors.push_back(files[i].Path + ": " + message);
+    }
+  };
+
+  unsigned threadCount = BatchThreads;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = (unsigned)std::min<size_t>(threadCount, files.size());
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < threadCount; ++i) {
+    threads.emplace_back([&]() {
+      sys::fs::AutoPerThreadSystem pts(pFileSystem);
+      DxcSetThreadMallocToDefault();
+      work();
+      DxcClearThreadMalloc();
+    });
+  }
+  work();
+  for (std::thread &thread : threads)
+    thread.join();
+  std::sort(errors.begin(), errors.end());
+}
+
+static void PrintBatchErrors(const std::vector<std::string> &errors) {
+  const size_t MaxErrorsShown = 10;
+  for (size_t i = 0; i < errors.size() && i < MaxErrorsShown; ++i)
+    printf("  %s\n", errors[i].c_str());
+  if (errors.size() > MaxErrorsShown)
+    printf("  ... and %u more\n", (unsigned)(errors.size() - MaxErrorsShown));
+}
+
+// Part names as given to -extractpart; 'module' and 'dbgmodule' name the
+// bitcode in the DXIL and ILDB parts.
+static UINT32 GetPartFourCC(const char *pName, bool *pExtractModule) {
+  *pExtractModule = false;
+  if (strcmp("module", pName) == 0) {
+    pName = "DXIL";
+    *pExtractModule = true;
+  }
+  if (strcmp("dbgmodule", pName) == 0) {
+    pName = "ILDB";
+    *pExtractModule = true;
+  }
+
+  IFTARG(strlen(pName) == 4);
+
+  return ((UINT32)pName[0] | ((UINT32)pName[1] << 8) |
+          ((UINT32)pName[2] << 16) | ((UINT32)pName[3] << 24));
+}
+
 class DxaContext {
 
 private:
@@ -74,6 +269,11 @@ public:
   void ListFiles();
   void ListParts();
   void DumpRS();
+  void Pack(sys::fs::MSFileSystem *pFileSystem);
+  void ListArchive();
+  bool Unpack(const char *pName);
+  void BatchListParts(sys::fs::MSFileSystem *pFileSystem);
+  bool BatchExtractPart(const char *pName, sys::fs::MSFileSystem *pFileSystem);
 };
 
 void DxaContext::Assemble() {
@@ -221,20 +421,8 @@ bool DxaContext::ExtractPart(uint32_t PartKind, IDxcBlob **ppTargetBlob) {
 bool DxaContext::ExtractPart(const char *pName) {
   // If the part name is 'module', don't just extract the part,
   // but also skip the appropriate header.
-  bool extractModule = strcmp("module", pName) == 0;
-  if (extractModule) {
-    pName = "DXIL";
-  }
-  if (strcmp("dbgmodule", pName) == 0) {
-    pName = "ILDB";
-    extractModule = true;
-  }
-
-  IFTARG(strlen(pName) == 4);
-
-  const UINT32 matchName =
-      ((UINT32)pName[0] | ((UINT32)pName[1] << 8) | ((UINT32)pName[2] << 16) |
-       ((UINT32)pName[3] << 24));
+  bool extractModule;
+  const UINT32 matchName = GetPartFourCC(pName, &extractModule);
   CComPtr<IDxcBlob> pContent;
   if (!ExtractPart(matchName, &pContent))
     return false;
@@ -333,6 +521,198 @@ void DxaContext::DumpRS() {
   }
 }
 
+void DxaContext::Pack(sys::fs::MSFileSystem *pFileSystem) {
+  IFTARG(!OutputFilename.empty());
+
+  std::vector<BatchFile> files;
+  for (const std::string &fileName : PackFiles)
+    files.push_back({fileName, fileName});
+  // Batch containers are named by their path relative to the batch input.
+  ExpandBatchInputs(files);
+
+  // Map the inputs in parallel, then add them in order. The writer refers to
+  // the containers until the archive is written.
+  std::vector<CComPtr<IDxcBlobEncoding>> sources(files.size());
+  std::vector<std::string> errors;
+  RunBatch(files, pFileSystem, [&](size_t i) {
+    MapFileIntoBlob(files[i].Path, &sources[i]);
+  }, errors);
+  if (!errors.empty())
+    throw hlsl::Exception(E_FAIL, errors[0]);
+
+  hlsl::DxilShaderArchiveWriter writer;
+  for (size_t i = 0; i < files.size(); ++i) {
+    const std::string &name = files[i].RelativePath;
+    HRESULT hr = writer.AddContainer(name, sources[i]->GetBufferPointer(),
+                                     (uint32_t)sources[i]->GetBufferSize());
+    IFTMSG(hr, "cannot add '" + files[i].Path +
+                   "': not a valid container, or already added");
+  }
+
+  CComPtr<hlsl::AbstractMemoryStream> pStream;
+  IFT(hlsl::CreateMemoryStream(DxcGetThreadMallocNoRef(), &pStream));
+  IFT(writer.Write(pStream));
+  CComPtr<IDxcBlob> pArchive;
+  IFT(pStream.QueryInterface(&pArchive));
+  WriteBlobToFile(pArchive, StringRefUtf16(OutputFilename), DXC_CP_UTF8);
+
+  printf("%u containers, %u distinct parts, %llu of %llu part bytes kept\n",
+         writer.GetContainerCount(), writer.GetUniquePartCount(),
+         (unsigned long long)writer.GetPartBytesStored(),
+         (unsigned long long)writer.GetPartBytesAdded());
+  printf("Output written to \"%s\"\n", OutputFilename.c_str());
+}
+
+void DxaContext::ListArchive() {
+  CComPtr<IDxcBlobEncoding> pSource;
+  ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(InputFilename), &pSource);
+
+  hlsl::DxilShaderArchiveReader reader;
+  IFTMSG(reader.Load(pSource), "input is not a shader archive");
+  printf("Container count: %u\n", reader.GetContainerCount());
+  for (uint32_t i = 0; i < reader.GetContainerCount(); ++i) {
+    StringRef name = reader.GetContainerName(i);
+    printf("%.*s:", (int)name.size(), name.data());
+    for (uint32_t j = 0; j < reader.GetPartCount(i); ++j) {
+      char kindText[5];
+      hlsl::PartKindToCharArray(reader.GetPartFourCC(i, j), kindText);
+      printf(" %s", kindText);
+    }
+    printf("\n");
+  }
+}
+
+bool DxaContext::Unpack(const char *pName) {
+  CComPtr<IDxcBlobEncoding> pSource;
+  ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(InputFilename), &pSource);
+
+  hlsl::DxilShaderArchiveReader reader;
+  IFTMSG(reader.Load(pSource), "input is not a shader archive");
+  uint32_t index = reader.FindContainer(pName);
+  if (index == DXIL_SHADER_ARCHIVE_NOT_FOUND) {
+    printf("cannot find container '%s' in archive\n", pName);
+    return false;
+  }
+
+  CComPtr<hlsl::AbstractMemoryStream> pStream;
+  IFT(hlsl::CreateMemoryStream(DxcGetThreadMallocNoRef(), &pStream));
+  IFT(reader.WriteContainer(index, pStream));
+  CComPtr<IDxcBlob> pContainer;
+  IFT(pStream.QueryInterface(&pContainer));
+  if (OutputFilename.empty())
+    OutputFilename = sys::path::filename(pName).str();
+  WriteBlobToFile(pContainer, StringRefUtf16(OutputFilename), DXC_CP_UTF8);
+  printf("%Iu bytes written to %s\n", pContainer->GetBufferSize(),
+         OutputFilename.c_str());
+  return true;
+}
+
+void DxaContext::BatchListParts(sys::fs::MSFileSystem *pFileSystem) {
+  std::vector<BatchFile> files;
+  ExpandBatchInputs(files);
+
+  // Part count and bytes by kind.
+  std::map<UINT32, std::pair<uint64_t, uint64_t>> kinds;
+  std::mutex kindsLock;
+  std::vector<std::string> errors;
+  RunBatch(files, pFileSystem, [&](size_t i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    MapFileIntoBlob(files[i].Path, &pSource);
+    hlsl::DxilContainerReader reader;
+    IFTMSG(reader.Load(pSource), "not a valid container");
+    uint32_t partCount;
+    IFT(reader.GetPartCount(&partCount));
+    std::vector<std::pair<UINT32, uint32_t>> parts(partCount);
+    for (uint32_t j = 0; j < partCount; ++j) {
+      const void *pContent;
+      IFT(reader.GetPartFourCC(j, &parts[j].first));
+      IFT(reader.GetPartContent(j, &pContent, &parts[j].second));
+    }
+    std::lock_guard<std::mutex> lock(kindsLock);
+    for (const auto &part : parts) {
+      kinds[part.first].first += 1;
+      kinds[part.first].second += part.second;
+    }
+  }, errors);
+
+  printf("Containers: %u, failed: %u\n",
+         (unsigned)(files.size() - errors.size()), (unsigned)errors.size());
+  for (const auto &kind : kinds) {
+    char kindText[5];
+    hlsl::PartKindToCharArray(kind.first, kindText);
+    printf("%s - %llu parts (%llu bytes)\n", kindText,
+           (unsigned long long)kind.second.first,
+           (unsigned long long)kind.second.second);
+  }
+  PrintBatchErrors(errors);
+}
+
+bool DxaContext::BatchExtractPart(const char *pName,
+                                  sys::fs::MSFileSystem *pFileSystem) {
+  bool extractModule;
+  const UINT32 matchName = GetPartFourCC(pName, &extractModule);
+  std::string suffix = ".";
+  suffix += extractModule ? "ll" : pName;
+
+  std::vector<BatchFile> files;
+  ExpandBatchInputs(files);
+
+  // With -o, outputs go under that directory as laid out in the inputs.
+  std::vector<std::string> outputs;
+  for (const BatchFile &file : files) {
+    if (OutputFilename.empty()) {
+      outputs.push_back(file.Path + suffix);
+      continue;
+    }
+    SmallString<256> output(OutputFilename);
+    sys::path::append(output, file.RelativePath + suffix);
+    IFTLLVM(sys::fs::create_directories(sys::path::parent_path(output)));
+    outputs.push_back(output.str().str());
+  }
+
+  std::atomic<unsigned> written(0), missing(0);
+  std::atomic<uint64_t> bytesWritten(0);
+  std::vector<std::string> errors;
+  RunBatch(files, pFileSystem, [&](size_t i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    MapFileIntoBlob(files[i].Path, &pSource);
+    hlsl::DxilContainerReader reader;
+    IFTMSG(reader.Load(pSource), "not a valid container");
+    uint32_t partIndex;
+    if (FAILED(reader.FindFirstPartKind(matchName, &partIndex)) ||
+        partIndex == (uint32_t)DXIL_CONTAINER_BLOB_NOT_FOUND) {
+      ++missing;
+      return;
+    }
+    // Parts are views of the mapped file, so they are written without a copy.
+    CComPtr<IDxcBlob> pContent;
+    IFT(reader.GetPartBlob(partIndex, &pContent));
+    if (extractModule) {
+      const char *pDxilPart = (const char *)pContent->GetBufferPointer();
+      const char *pBitcode;
+      uint32_t bitcodeLength;
+      hlsl::GetDxilProgramBitcode((const hlsl::DxilProgramHeader *)pDxilPart,
+                                  &pBitcode, &bitcodeLength);
+      CComPtr<IDxcBlob> pModuleBlob;
+      IFT(hlsl::DxcCreateBlobFromBlob(pContent,
+                                      (UINT32)(pBitcode - pDxilPart),
+                                      bitcodeLength, &pModuleBlob));
+      std::swap(pModuleBlob, pContent);
+    }
+    WriteBlobToFile(pContent, StringRefUtf16(outputs[i]), DXC_CP_UTF8);
+    ++written;
+    bytesWritten += pContent->GetBufferSize();
+  }, errors);
+
+  printf("Containers: %u, %s parts written: %u (%llu bytes), without part: %u, "
+         "failed: %u\n",
+         (unsigned)files.size(), pName, written.load(),
+         (unsigned long long)bytesWritten.load(), missing.load(),
+         (unsigned)errors.size());
+  PrintBatchErrors(errors);
+  return errors.empty();
+}
+
 using namespace hlsl::options;
 
 int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
@@ -356,23 +736,55 @@ int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
     // Parse command line options.
     cl::ParseCommandLineOptions(argc, argv, "dxil assembly\n");
 
-    if (InputFilename == "" || Help) {
+    if ((InputFilename == "" && PackFiles.empty() && BatchInputs.empty()) ||
+        Help) {
       cl::PrintHelpMessage();
       return 2;
     }
 
+    // A batch lists parts, extracts a part or packs an archive.
+    bool batch = !BatchInputs.empty();
+    if (batch && !ListParts && ExtractPart.empty() && OutputFilename.empty()) {
+      printf("-batch requires -listparts, -extractpart or an archive to "
+             "write with -o\n");
+      return 2;
+    }
+
 
     DxcDllSupport dxcSupport;
     dxc::EnsureEnabled(dxcSupport);
     DxaContext context(dxcSupport);
     if (ListParts) {
       pStage = "Listing parts";
-      context.ListParts();
+      if (batch)
+        context.BatchListParts(msf.get());
+      else
+        context.ListParts();
+    }
+    else if (batch && !ExtractPart.empty()) {
+      pStage = "Extracting parts";
+      if (!context.BatchExtractPart(ExtractPart.c_str(), msf.get())) {
+        return 1;
+      }
     }
     else if (ListFiles) {
       pStage = "Listing files";
       context.ListFiles();
     }
+    else if (!PackFiles.empty() || batch) {
+      pStage = "Packing archive";
+      context.Pack(msf.get());
+    }
+    else if (ListArchive) {
+      pStage = "Listing archive";
+      context.ListArchive();
+    }
+    else if (!Unpack.empty()) {
+      pStage = "Unpacking container";
+      if (!context.Unpack(Unpack.c_str())) {
+        return 1;
+      }
+    }
     else if (!ExtractPart.empty()) {
       pStage = "Extracting part";
       if (!context.ExtractPart(ExtractPart.c_str())) {
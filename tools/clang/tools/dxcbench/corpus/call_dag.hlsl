@@ -0,0 +1,52 @@
+// Library whose helpers stay out of line and call each other in layers,
+// each calling the layer below twice. The call graph has few functions but
+// a number of paths that doubles with every layer, so anything that walks
+// it per path rather than per function shows up here. LAYERS sets the
+// depth.
+
+#ifndef LAYERS
+#define LAYERS 16
+#endif
+
+RWStructuredBuffer<float4> Output : register(u0);
+
+float4 Layer0(float4 v) {
+  [unroll] for (uint i = 0; i < 4; ++i)
+    v = v * v.yzwx + sin(v);
+  return v;
+}
+
+#define LAYER(n, m)                                                            \
+  float4 Layer##n(float4 v) {                                                  \
+    float4 a = Layer##m(v);                                                    \
+    float4 b = Layer##m(a.wzyx * 0.5);                                         \
+    [unroll] for (uint i = 0; i < 4; ++i)                                      \
+      a = a * b.yzwx + cos(a);                                                 \
+    return a + b;                                                              \
+  }
+
+LAYER(1, 0)
+LAYER(2, 1)
+LAYER(3, 2)
+LAYER(4, 3)
+LAYER(5, 4)
+LAYER(6, 5)
+LAYER(7, 6)
+LAYER(8, 7)
+LAYER(9, 8)
+LAYER(10, 9)
+LAYER(11, 10)
+LAYER(12, 11)
+LAYER(13, 12)
+LAYER(14, 13)
+LAYER(15, 14)
+LAYER(16, 15)
+
+#define TOP2(n) Layer##n
+#define TOP(n) TOP2(n)
+
+[shader("compute")]
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID) {
+  Output[id.x] = TOP(LAYERS)(Output[id.x]) + TOP(LAYERS)(id.xyzx);
+}
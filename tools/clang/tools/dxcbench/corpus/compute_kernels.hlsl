@@ -0,0 +1,200 @@
+// Large compute kernels: a tiled light culling pass, a separable blur with
+// groupshared caching and a radix-4 FFT. KERNEL selects the entry point body
+// so each kernel can be benchmarked on its own.
+
+#ifndef KERNEL
+#define KERNEL 0
+#endif
+
+#define TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 256
+#define BLUR_RADIUS 12
+#define FFT_SIZE 256
+
+struct PointLight {
+  float3 position;
+  float radius;
+  float3 color;
+  uint flags;
+};
+
+cbuffer Params : register(b0) {
+  float4x4 View;
+  float4x4 Proj;
+  float4x4 InvProj;
+  uint2 ScreenSize;
+  uint LightCount;
+  float BlurSigma;
+};
+
+StructuredBuffer<PointLight> Lights : register(t0);
+Texture2D<float> Depth : register(t1);
+Texture2D<float4> Source : register(t2);
+RWStructuredBuffer<uint> TileLightIndices : register(u0);
+RWTexture2D<float4> Target : register(u1);
+RWStructuredBuffer<float2> Signal : register(u2);
+
+groupshared uint TileMinDepth;
+groupshared uint TileMaxDepth;
+groupshared uint TileLightCount;
+groupshared uint TileLights[MAX_LIGHTS_PER_TILE];
+groupshared float4 BlurCache[TILE_SIZE + 2 * BLUR_RADIUS][TILE_SIZE];
+groupshared float2 FftData[FFT_SIZE];
+
+float3 ScreenToView(float2 uv, float depth) {
+  float4 clip = float4(uv * 2.0f - 1.0f, depth, 1.0f);
+  clip.y = -clip.y;
+  float4 view = mul(InvProj, clip);
+  return view.xyz / view.w;
+}
+
+bool SphereInsideFrustum(float3 center, float radius, float4 planes[6]) {
+  bool inside = true;
+  [unroll]
+  for (uint i = 0; i < 6; ++i)
+    inside = inside && (dot(planes[i].xyz, center) + planes[i].w > -radius);
+  return inside;
+}
+
+void CullLights(uint3 groupId, uint3 threadId, uint groupIndex) {
+  if (groupIndex == 0) {
+    TileMinDepth = 0x7f7fffff;
+    TileMaxDepth = 0;
+    TileLightCount = 0;
+  }
+  GroupMemoryBarrierWithGroupSync();
+
+  uint2 pixel = min(threadId.xy, ScreenSize - 1);
+  float depth = Depth[pixel];
+  InterlockedMin(TileMinDepth, asuint(depth));
+  InterlockedMax(TileMaxDepth, asuint(depth));
+  GroupMemoryBarrierWithGroupSync();
+
+  float2 tileMin = float2(groupId.xy * TILE_SIZE) / float2(ScreenSize);
+  float2 tileMax = float2((groupId.xy + 1) * TILE_SIZE) / float2(ScreenSize);
+  float3 corners[4];
+  corners[0] = ScreenToView(float2(tileMin.x, tileMin.y), 1.0f);
+  corners[1] = ScreenToView(float2(tileMax.x, tileMin.y), 1.0f);
+  corners[2] = ScreenToView(float2(tileMax.x, tileMax.y), 1.0f);
+  corners[3] = ScreenToView(float2(tileMin.x, tileMax.y), 1.0f);
+
+  float4 planes[6];
+  [unroll]
+  for (uint p = 0; p < 4; ++p) {
+    float3 n = normalize(cross(corners[p], corners[(p + 1) & 3]));
+    planes[p] = float4(n, 0);
+  }
+  float minZ = ScreenToView(tileMin, asfloat(TileMinDepth)).z;
+  float maxZ = ScreenToView(tileMin, asfloat(TileMaxDepth)).z;
+  planes[4] = float4(0, 0, -1, minZ);
+  planes[5] = float4(0, 0, 1, -maxZ);
+
+  for (uint i = groupIndex; i < LightCount; i += TILE_SIZE * TILE_SIZE) {
+    PointLight light = Lights[i];
+    float3 center = mul(View, float4(light.position, 1)).xyz;
+    if (SphereInsideFrustum(center, light.radius, planes)) {
+      uint slot;
+      InterlockedAdd(TileLightCount, 1, slot);
+      if (slot < MAX_LIGHTS_PER_TILE)
+        TileLights[slot] = i;
+    }
+  }
+  GroupMemoryBarrierWithGroupSync();
+
+  uint tileIndex = groupId.y * ((ScreenSize.x + TILE_SIZE - 1) / TILE_SIZE) + groupId.x;
+  uint count = min(TileLightCount, MAX_LIGHTS_PER_TILE);
+  for (uint j = groupIndex; j < count; j += TILE_SIZE * TILE_SIZE)
+    TileLightIndices[tileIndex * (MAX_LIGHTS_PER_TILE + 1) + 1 + j] = TileLights[j];
+  if (groupIndex == 0)
+    TileLightIndices[tileIndex * (MAX_LIGHTS_PER_TILE + 1)] = count;
+}
+
+float GaussianWeight(int offset) {
+  return exp(-(offset * offset) / (2.0f * BlurSigma * BlurSigma));
+}
+
+void Blur(uint3 groupId, uint3 threadId, uint3 localId) {
+  int2 base = int2(groupId.xy * TILE_SIZE);
+  for (int row = localId.y; row < TILE_SIZE + 2 * BLUR_RADIUS; row += TILE_SIZE) {
+    int2 coord = clamp(base + int2(localId.x, row - BLUR_RADIUS), int2(0, 0), int2(ScreenSize) - 1);
+    BlurCache[row][localId.x] = Source[coord];
+  }
+  GroupMemoryBarrierWithGroupSync();
+
+  float4 sum = 0;
+  float weights = 0;
+  [unroll]
+  for (int i = -BLUR_RADIUS; i <= BLUR_RADIUS; ++i) {
+    float w = GaussianWeight(i);
+    sum += BlurCache[localId.y + BLUR_RADIUS + i][localId.x] * w;
+    weights += w;
+  }
+  if (all(threadId.xy < ScreenSize))
+    Target[threadId.xy] = sum / weights;
+}
+
+float2 ComplexMul(float2 a, float2 b) {
+  return float2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+void Butterfly4(inout float2 a, inout float2 b, inout float2 c, inout float2 d) {
+  float2 t0 = a + c;
+  float2 t1 = a - c;
+  float2 t2 = b + d;
+  float2 t3 = float2(b.y - d.y, d.x - b.x);
+  a = t0 + t2;
+  b = t1 + t3;
+  c = t0 - t2;
+  d = t1 - t3;
+}
+
+void Fft(uint groupIndex) {
+  FftData[groupIndex] = Signal[groupIndex];
+  FftData[groupIndex + FFT_SIZE / 4] = Signal[groupIndex + FFT_SIZE / 4];
+  FftData[groupIndex + FFT_SIZE / 2] = Signal[groupIndex + FFT_SIZE / 2];
+  FftData[groupIndex + 3 * FFT_SIZE / 4] = Signal[groupIndex + 3 * FFT_SIZE / 4];
+  GroupMemoryBarrierWithGroupSync();
+
+  [unroll]
+  for (uint span = FFT_SIZE / 4; span >= 1; span /= 4) {
+    uint group = groupIndex / span;
+    uint k = groupIndex % span;
+    uint i0 = group * span * 4 + k;
+    float angle = -2.0f * 3.14159265f * k / (span * 4);
+    float2 w1 = float2(cos(angle), sin(angle));
+    float2 w2 = ComplexMul(w1, w1);
+    float2 w3 = ComplexMul(w2, w1);
+    float2 a = FftData[i0];
+    float2 b = FftData[i0 + span];
+    float2 c = FftData[i0 + 2 * span];
+    float2 d = FftData[i0 + 3 * span];
+    Butterfly4(a, b, c, d);
+    GroupMemoryBarrierWithGroupSync();
+    FftData[i0] = a;
+    FftData[i0 + span] = ComplexMul(b, w1);
+    FftData[i0 + 2 * span] = ComplexMul(c, w2);
+    FftData[i0 + 3 * span] = ComplexMul(d, w3);
+    GroupMemoryBarrierWithGroupSync();
+  }
+
+  Signal[groupIndex] = FftData[reversebits(groupIndex) >> 24];
+  Signal[groupIndex + FFT_SIZE / 4] = FftData[reversebits(groupIndex + FFT_SIZE / 4) >> 24];
+  Signal[groupIndex + FFT_SIZE / 2] = FftData[reversebits(groupIndex + FFT_SIZE / 2) >> 24];
+  Signal[groupIndex + 3 * FFT_SIZE / 4] = FftData[reversebits(groupIndex + 3 * FFT_SIZE / 4) >> 24];
+}
+
+#if KERNEL == 2
+[numthreads(FFT_SIZE / 4, 1, 1)]
+#else
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+#endif
+void main(uint3 groupId : SV_GroupID, uint3 threadId : SV_DispatchThreadID,
+          uint3 localId : SV_GroupThreadID, uint groupIndex : SV_GroupIndex) {
+#if KERNEL == 0
+  CullLights(groupId, threadId, groupIndex);
+#elif KERNEL == 1
+  Blur(groupId, threadId, localId);
+#else
+  Fft(groupIndex);
+#endif
+}
@@ -0,0 +1,60 @@
+// Ray tracing library declaring ten thousand hit groups, each associated with
+// a local root signature, as a scene with a hit group per material would.
+// Writing the subobject table interns every hit group's shader names and
+// each association's export list, so its cost should grow with the number of
+// subobjects and not with their square. DIGITS sets the hit groups to
+// 10^DIGITS.
+
+#ifndef DIGITS
+#define DIGITS 4
+#endif
+
+struct Payload {
+  float4 color;
+};
+
+struct Attributes {
+  float2 barycentrics;
+};
+
+RaytracingShaderConfig ShaderConfig = { 16, 8 };
+RaytracingPipelineConfig PipelineConfig = { 1 };
+LocalRootSignature MaterialRS = { "RootConstants(num32BitConstants = 4, b1)" };
+
+cbuffer MaterialConstants : register(b1) {
+  float4 Tint;
+};
+
+[shader("closesthit")]
+void ClosestHit(inout Payload payload, in Attributes attr) {
+  payload.color = Tint * float4(attr.barycentrics, 1, 1);
+}
+
+[shader("anyhit")]
+void AnyHit(inout Payload payload, in Attributes attr) {
+  if (attr.barycentrics.x > Tint.w)
+    IgnoreHit();
+}
+
+#define D1(M, p) M(p##0) M(p##1) M(p##2) M(p##3) M(p##4)                      \
+                 M(p##5) M(p##6) M(p##7) M(p##8) M(p##9)
+#define D2(M, p) D1(M, p##0) D1(M, p##1) D1(M, p##2) D1(M, p##3) D1(M, p##4)  \
+                 D1(M, p##5) D1(M, p##6) D1(M, p##7) D1(M, p##8) D1(M, p##9)
+#define D3(M, p) D2(M, p##0) D2(M, p##1) D2(M, p##2) D2(M, p##3) D2(M, p##4)  \
+                 D2(M, p##5) D2(M, p##6) D2(M, p##7) D2(M, p##8) D2(M, p##9)
+#define D4(M, p) D3(M, p##0) D3(M, p##1) D3(M, p##2) D3(M, p##3) D3(M, p##4)  \
+                 D3(M, p##5) D3(M, p##6) D3(M, p##7) D3(M, p##8) D3(M, p##9)
+
+#if DIGITS == 4
+#define TABLE(M) D4(M, HG)
+#elif DIGITS == 3
+#define TABLE(M) D3(M, HG)
+#else
+#define TABLE(M) D2(M, HG)
+#endif
+
+#define DECLARE(n)                                                            \
+  TriangleHitGroup n = { "AnyHit", "ClosestHit" };                            \
+  SubobjectToExportsAssociation n##_RS = { "MaterialRS", #n };
+
+TABLE(DECLARE)
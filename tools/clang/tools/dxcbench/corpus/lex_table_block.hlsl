@@ -0,0 +1,53 @@
+// One block of a generated lookup-table source: a banner comment, then a
+// table of float literals, indented as codegen tools write them. Included
+// many times by lex_tables.hlsl; each copy declares a table of its own.
+
+/*
+ * Baked response curve, 128 samples over [0, 1].
+ *
+ * Generated offline from the reference curve; do not edit by hand.
+ * Samples are stored as they were measured, including the ones that the
+ * shader never reads, so that the table can be diffed against the source
+ * data. The layout is:
+ *
+ *     index    input       output
+ *     -----    ---------   ---------
+ *     0        0.0000000   0.0000000
+ *     127      1.0000000   1.0000000
+ *
+ ****************************************************************************/
+static const float LUT_NAME(__COUNTER__)[128] = {
+        0.000000000, 0.000023531, 0.000108118, 0.000263814,
+        0.000496780, 0.000811644, 0.001212173, 0.001701561,
+        0.002282600, 0.002957776, 0.003729339, 0.004599342,
+        0.005569684, 0.006642127, 0.007818321, 0.009099815,
+        0.010488075, 0.011984487, 0.013590371, 0.015306988,
+        0.017135540, 0.019077184, 0.021133027, 0.023304139,
+        0.025591547, 0.027996248, 0.030519202, 0.033161342,
+        0.035923569, 0.038806762, 0.041811772, 0.044939428,
+        0.048190537, 0.051565886, 0.055066241, 0.058692352,
+        0.062444949, 0.066324748, 0.070332447, 0.074468730,
+        0.078734268, 0.083129716, 0.087655718, 0.092312905,
+        0.097101894, 0.102023295, 0.107077702, 0.112265703,
+        0.117587873, 0.123044779, 0.128636976, 0.134365014,
+        0.140229430, 0.146230757, 0.152369515, 0.158646221,
+        0.165061381, 0.171615495, 0.178309056, 0.185142549,
+        0.192116455, 0.199231246, 0.206487388, 0.213885342,
+        0.221425563, 0.229108498, 0.236934592, 0.244904283,
+        0.253018002, 0.261276177, 0.269679232, 0.278227582,
+        0.286921641, 0.295761817, 0.304748514, 0.313882132,
+        0.323163064, 0.332591702, 0.342168432, 0.351893638,
+        0.361767697, 0.371790985, 0.381963874, 0.392286730,
+        0.402759918, 0.413383797, 0.424158727, 0.435085059,
+        0.446163145, 0.457393331, 0.468775963, 0.480311381,
+        0.491999922, 0.503841923, 0.515837715, 0.527987627,
+        0.540291987, 0.552751118, 0.565365340, 0.578134973,
+        0.591060333, 0.604141732, 0.617379482, 0.630773890,
+        0.644325264, 0.658033906, 0.671900118, 0.685924199,
+        0.700106445, 0.714447152, 0.728946611, 0.743605113,
+        0.758422945, 0.773400395, 0.788537745, 0.803835279,
+        0.819293275, 0.834912013, 0.850691767, 0.866632814,
+        0.882735424, 0.898999869, 0.915426418, 0.932015337,
+        0.948766892, 0.965681347, 0.982758962, 1.000000000,
+};
+
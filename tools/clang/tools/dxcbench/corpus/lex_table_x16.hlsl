@@ -0,0 +1,18 @@
+// Sixteen copies of lex_table_block.hlsl.
+
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
+#include "lex_table_block.hlsl"
@@ -0,0 +1,31 @@
+// Pixel shader over a generated source of the size baked lookup tables and
+// codegen'd material graphs reach: 256 copies of a block with a long banner
+// comment and a table of 128 float literals, about 700 KB in all. Lexing it
+// is a large share of the compile; the _pp entry only preprocesses it, so
+// it times lexing on its own.
+
+#define LUT_NAME_(n) Lut##n
+#define LUT_NAME(n) LUT_NAME_(n)
+
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+#include "lex_table_x16.hlsl"
+
+float4 main(float2 uv : TEXCOORD0) : SV_Target {
+  uint i = (uint)(saturate(uv.x) * 127.0f);
+  uint j = (uint)(saturate(uv.y) * 127.0f);
+  return float4(Lut0[i], Lut0[j], Lut255[i], Lut255[j]);
+}
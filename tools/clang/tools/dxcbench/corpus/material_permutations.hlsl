@@ -0,0 +1,213 @@
+// Uber material pixel shader. Engines compile this kind of shader once per
+// feature combination, so the corpus lists it several times with different
+// defines to measure the cost of a permutation-heavy workload.
+
+#ifndef USE_NORMAL_MAP
+#define USE_NORMAL_MAP 0
+#endif
+#ifndef USE_PARALLAX
+#define USE_PARALLAX 0
+#endif
+#ifndef USE_CLEARCOAT
+#define USE_CLEARCOAT 0
+#endif
+#ifndef USE_SHADOW_CASCADES
+#define USE_SHADOW_CASCADES 1
+#endif
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 4
+#endif
+
+#define PI 3.14159265f
+
+struct PSInput {
+  float4 position : SV_Position;
+  float3 worldPos : WORLDPOS;
+  float3 normal : NORMAL;
+  float4 tangent : TANGENT;
+  float2 uv : TEXCOORD0;
+  float3 viewDir : TEXCOORD1;
+};
+
+struct PointLight {
+  float3 position;
+  float range;
+  float3 color;
+  float intensity;
+};
+
+cbuffer Material : register(b0) {
+  float4 BaseColorFactor;
+  float MetallicFactor;
+  float RoughnessFactor;
+  float NormalScale;
+  float ParallaxScale;
+  float ClearcoatFactor;
+  float ClearcoatRoughness;
+  float2 Padding;
+};
+
+cbuffer Lighting : register(b1) {
+  float3 SunDirection;
+  float SunIntensity;
+  float3 SunColor;
+  uint CascadeCount;
+  float4x4 CascadeViewProj[4];
+  float4 CascadeSplits;
+  PointLight PointLights[NUM_POINT_LIGHTS];
+};
+
+Texture2D<float4> BaseColorMap : register(t0);
+Texture2D<float4> MetallicRoughnessMap : register(t1);
+Texture2D<float4> NormalMap : register(t2);
+Texture2D<float> HeightMap : register(t3);
+Texture2DArray<float> ShadowMap : register(t4);
+TextureCube<float4> IrradianceMap : register(t5);
+TextureCube<float4> PrefilteredMap : register(t6);
+Texture2D<float2> BrdfLut : register(t7);
+SamplerState AnisoSampler : register(s0);
+SamplerComparisonState ShadowSampler : register(s1);
+
+float2 ParallaxOcclusion(float2 uv, float3 viewTS) {
+  const int steps = 32;
+  float layerDepth = 1.0f / steps;
+  float2 delta = viewTS.xy / max(viewTS.z, 1e-3f) * ParallaxScale / steps;
+  float currentDepth = 0;
+  float2 currentUV = uv;
+  float height = HeightMap.SampleLevel(AnisoSampler, currentUV, 0);
+  [loop]
+  for (int i = 0; i < steps && currentDepth < height; ++i) {
+    currentUV -= delta;
+    height = HeightMap.SampleLevel(AnisoSampler, currentUV, 0);
+    currentDepth += layerDepth;
+  }
+  float2 prevUV = currentUV + delta;
+  float after = height - currentDepth;
+  float before = HeightMap.SampleLevel(AnisoSampler, prevUV, 0) - currentDepth + layerDepth;
+  float weight = after / (after - before);
+  return lerp(currentUV, prevUV, weight);
+}
+
+float3 FresnelSchlick(float cosTheta, float3 f0) {
+  return f0 + (1.0f - f0) * pow(saturate(1.0f - cosTheta), 5.0f);
+}
+
+float3 FresnelSchlickRoughness(float cosTheta, float3 f0, float roughness) {
+  float3 r = max(float3(1.0f - roughness, 1.0f - roughness, 1.0f - roughness), f0);
+  return f0 + (r - f0) * pow(saturate(1.0f - cosTheta), 5.0f);
+}
+
+float DistributionGGX(float NdotH, float roughness) {
+  float a2 = roughness * roughness * roughness * roughness;
+  float d = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+  return a2 / (PI * d * d);
+}
+
+float VisibilitySmithGGX(float NdotV, float NdotL, float roughness) {
+  float a2 = roughness * roughness * roughness * roughness;
+  float gv = NdotL * sqrt(NdotV * NdotV * (1.0f - a2) + a2);
+  float gl = NdotV * sqrt(NdotL * NdotL * (1.0f - a2) + a2);
+  return 0.5f / max(gv + gl, 1e-4f);
+}
+
+float3 SpecularLobe(float3 n, float3 v, float3 l, float3 f0, float roughness) {
+  float3 h = normalize(v + l);
+  float NdotL = saturate(dot(n, l));
+  float NdotV = saturate(dot(n, v)) + 1e-4f;
+  float NdotH = saturate(dot(n, h));
+  return DistributionGGX(NdotH, roughness) *
+         VisibilitySmithGGX(NdotV, NdotL, roughness) *
+         FresnelSchlick(saturate(dot(h, v)), f0) * NdotL;
+}
+
+float SampleShadow(float3 worldPos, float viewDepth) {
+#if USE_SHADOW_CASCADES
+  uint cascade = 0;
+  [unroll]
+  for (uint c = 0; c < 3; ++c)
+    cascade += viewDepth > CascadeSplits[c] ? 1 : 0;
+  cascade = min(cascade, CascadeCount - 1);
+  float4 shadowPos = mul(CascadeViewProj[cascade], float4(worldPos, 1));
+  shadowPos.xyz /= shadowPos.w;
+  float2 uv = shadowPos.xy * float2(0.5f, -0.5f) + 0.5f;
+  float result = 0;
+  [unroll]
+  for (int y = -2; y <= 2; ++y) {
+    [unroll]
+    for (int x = -2; x <= 2; ++x) {
+      result += ShadowMap.SampleCmpLevelZero(ShadowSampler, float3(uv, cascade),
+                                             shadowPos.z, int2(x, y));
+    }
+  }
+  return result / 25.0f;
+#else
+  return 1.0f;
+#endif
+}
+
+float4 main(PSInput input) : SV_Target {
+  float3 n = normalize(input.normal);
+  float3 v = normalize(input.viewDir);
+  float2 uv = input.uv;
+
+#if USE_NORMAL_MAP || USE_PARALLAX
+  float3 t = normalize(input.tangent.xyz);
+  float3 b = cross(n, t) * input.tangent.w;
+  float3x3 tbn = float3x3(t, b, n);
+#endif
+#if USE_PARALLAX
+  uv = ParallaxOcclusion(uv, mul(tbn, v));
+#endif
+
+  float4 baseColor = BaseColorMap.Sample(AnisoSampler, uv) * BaseColorFactor;
+  float4 mr = MetallicRoughnessMap.Sample(AnisoSampler, uv);
+  float metallic = mr.b * MetallicFactor;
+  float roughness = clamp(mr.g * RoughnessFactor, 0.04f, 1.0f);
+
+#if USE_NORMAL_MAP
+  float3 tn = NormalMap.Sample(AnisoSampler, uv).xyz * 2.0f - 1.0f;
+  tn.xy *= NormalScale;
+  n = normalize(mul(normalize(tn), tbn));
+#endif
+
+  float3 f0 = lerp(float3(0.04f, 0.04f, 0.04f), baseColor.rgb, metallic);
+  float3 diffuseColor = baseColor.rgb * (1.0f - metallic);
+  float3 color = 0;
+
+  float3 sunL = normalize(-SunDirection);
+  float shadow = SampleShadow(input.worldPos, input.position.w);
+  float sunNdotL = saturate(dot(n, sunL));
+  color += (diffuseColor / PI * sunNdotL + SpecularLobe(n, v, sunL, f0, roughness)) *
+           SunColor * SunIntensity * shadow;
+
+  [unroll]
+  for (uint i = 0; i < NUM_POINT_LIGHTS; ++i) {
+    float3 toLight = PointLights[i].position - input.worldPos;
+    float dist = length(toLight);
+    float3 l = toLight / dist;
+    float falloff = saturate(1.0f - pow(dist / PointLights[i].range, 4.0f));
+    falloff = falloff * falloff / (dist * dist + 1.0f);
+    float NdotL = saturate(dot(n, l));
+    color += (diffuseColor / PI * NdotL + SpecularLobe(n, v, l, f0, roughness)) *
+             PointLights[i].color * PointLights[i].intensity * falloff;
+  }
+
+  float NdotV = saturate(dot(n, v));
+  float3 f = FresnelSchlickRoughness(NdotV, f0, roughness);
+  float3 irradiance = IrradianceMap.Sample(AnisoSampler, n).rgb;
+  float3 r = reflect(-v, n);
+  float3 prefiltered = PrefilteredMap.SampleLevel(AnisoSampler, r, roughness * 6.0f).rgb;
+  float2 brdf = BrdfLut.Sample(AnisoSampler, float2(NdotV, roughness));
+  color += (1.0f - f) * irradiance * diffuseColor + prefiltered * (f * brdf.x + brdf.y);
+
+#if USE_CLEARCOAT
+  float3 cf0 = float3(0.04f, 0.04f, 0.04f);
+  float3 cf = FresnelSchlick(NdotV, cf0) * ClearcoatFactor;
+  float3 coat = SpecularLobe(normalize(input.normal), v, sunL, cf0, ClearcoatRoughness) *
+                SunColor * SunIntensity * shadow;
+  coat += PrefilteredMap.SampleLevel(AnisoSampler, r, ClearcoatRoughness * 6.0f).rgb * cf;
+  color = color * (1.0f - cf) + coat * ClearcoatFactor;
+#endif
+
+  return float4(color, baseColor.a);
+}
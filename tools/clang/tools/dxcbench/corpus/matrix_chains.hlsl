@@ -0,0 +1,56 @@
+// Skinning and transform chains built from long sequences of 4x4 matrix
+// multiplies, transposes and inverses through helpers. This stresses the
+// lowering of matrix values and their intrinsics to vectors. BONES scales the
+// number of blended joints, and with it the length of the mul chains.
+
+#ifndef BONES
+#define BONES 8
+#endif
+
+cbuffer Transforms : register(b0) {
+  float4x4 World;
+  float4x4 View;
+  float4x4 Projection;
+  float4x4 Joints[BONES];
+  float4x4 BindPose[BONES];
+};
+
+struct VSIn {
+  float3 position : POSITION;
+  float3 normal : NORMAL;
+  float4 weights[BONES / 4] : WEIGHTS;
+};
+
+struct VSOut {
+  float4 position : SV_Position;
+  float3 normal : NORMAL;
+  float3x3 tangentFrame : TANGENT;
+};
+
+float4x4 Compose(float4x4 a, float4x4 b, float4x4 c) {
+  return mul(mul(a, b), c);
+}
+
+float3x3 NormalMatrix(float4x4 m) {
+  float3x3 upper = (float3x3)m;
+  float det = determinant(upper);
+  return transpose(upper) * (1.0 / det);
+}
+
+VSOut main(VSIn input) {
+  float4x4 skin = 0;
+  [unroll] for (uint i = 0; i < BONES; ++i) {
+    float w = input.weights[i / 4][i % 4];
+    skin += Compose(BindPose[i], Joints[i], World) * w;
+  }
+
+  float4x4 viewProj = Compose(View, Projection, transpose(transpose(skin)));
+  float4x4 mvp = mul(skin, viewProj);
+
+  VSOut output;
+  output.position = mul(float4(input.position, 1), mvp);
+  float3x3 normalMat = NormalMatrix(mul(skin, World));
+  output.normal = normalize(mul(input.normal, normalMat));
+  output.tangentFrame = mul(normalMat, transpose(normalMat));
+  return output;
+}
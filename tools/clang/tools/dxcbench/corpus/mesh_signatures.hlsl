@@ -0,0 +1,65 @@
+// Mesh shader with large vertex and primitive signatures. Every attribute is
+// a separate element of mixed width and interpolation mode, so signature
+// packing has to place about a hundred elements, split between the
+// interpolation modes, up to the 32-row vertex signature limit. Run it with
+// -pack_optimized to time the optimized packer as well as the prefix-stable
+// default.
+
+struct Vertex {
+  float4 pos : SV_Position;
+#define V3(n) float3 v3_##n : VTHREE##n;
+#define V2(n) float2 v2_##n : VTWO##n;
+#define V1(n) float v1_##n : VONE##n;
+#define VU(n) nointerpolation uint vu_##n : VUINT##n;
+#define VN(n) noperspective float2 vn_##n : VNOPERSP##n;
+#define FIELDS_8(M) M(0) M(1) M(2) M(3) M(4) M(5) M(6) M(7)
+#define FIELDS_16(M) FIELDS_8(M) M(8) M(9) M(10) M(11) M(12) M(13) M(14) M(15)
+  FIELDS_8(V3)
+  FIELDS_16(V2)
+  FIELDS_16(V1)
+  FIELDS_16(VU)
+  FIELDS_8(VN)
+};
+
+struct Primitive {
+#define P1(n) nointerpolation float p1_##n : PONE##n;
+#define P2(n) nointerpolation float2 p2_##n : PTWO##n;
+#define PU(n) nointerpolation uint pu_##n : PUINT##n;
+  FIELDS_8(P1)
+  FIELDS_8(P2)
+  FIELDS_16(PU)
+  uint layer : SV_RenderTargetArrayIndex;
+  bool culled : SV_CullPrimitive;
+};
+
+[outputtopology("triangle")]
+[numthreads(32, 1, 1)]
+void main(uint tid : SV_GroupIndex,
+          out vertices Vertex verts[32],
+          out indices uint3 tris[32],
+          out primitives Primitive prims[32]) {
+  SetMeshOutputCounts(32, 32);
+
+  float f = tid;
+  verts[tid].pos = float4(f, f * 2, f * 3, 1);
+#define SET_V3(n) verts[tid].v3_##n = float3(f + n, f - n, f * n);
+#define SET_V2(n) verts[tid].v2_##n = float2(f + n, f * n);
+#define SET_V1(n) verts[tid].v1_##n = f * n;
+#define SET_VU(n) verts[tid].vu_##n = tid ^ n;
+#define SET_VN(n) verts[tid].vn_##n = float2(f - n, f / (n + 1));
+  FIELDS_8(SET_V3)
+  FIELDS_16(SET_V2)
+  FIELDS_16(SET_V1)
+  FIELDS_16(SET_VU)
+  FIELDS_8(SET_VN)
+
+  tris[tid] = uint3(tid, (tid + 1) % 32, (tid + 2) % 32);
+#define SET_P1(n) prims[tid].p1_##n = f + n;
+#define SET_P2(n) prims[tid].p2_##n = float2(f, n);
+#define SET_PU(n) prims[tid].pu_##n = tid + n;
+  FIELDS_8(SET_P1)
+  FIELDS_8(SET_P2)
+  FIELDS_16(SET_PU)
+  prims[tid].layer = tid & 3;
+  prims[tid].culled = (tid & 7) == 7;
+}
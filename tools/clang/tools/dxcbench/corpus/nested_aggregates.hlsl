@@ -0,0 +1,97 @@
+// G-buffer packing with deeply nested structs of arrays, copied whole between
+// locals, helpers and outputs. This stresses scalar replacement of aggregates
+// and the splitting of the memcpys it leaves behind. LAYERS scales the number
+// of nested layers, and with it the number of helper copies, so the costs of
+// the two entries in the manifest should grow in proportion.
+
+#ifndef LAYERS
+#define LAYERS 4
+#endif
+
+struct Channel {
+  float4 value;
+  uint2 packed[2];
+};
+
+struct Surface {
+  Channel albedo;
+  Channel normal[2];
+  float roughness[4];
+};
+
+struct Layer {
+  Surface surfaces[3];
+  float2 uvScale[2];
+  uint materialIds[4];
+};
+
+struct GBuffer {
+  Layer layers[LAYERS];
+  float4 emissive;
+};
+
+cbuffer Params : register(b0) {
+  GBuffer Defaults;
+  uint LayerCount;
+  float Blend;
+};
+
+StructuredBuffer<Layer> InputLayers : register(t0);
+
+Channel MixChannel(Channel a, Channel b, float t) {
+  Channel r = a;
+  r.value = lerp(a.value, b.value, t);
+  r.packed[1] = b.packed[0] ^ a.packed[1];
+  return r;
+}
+
+Surface MixSurface(Surface a, Surface b, float t) {
+  Surface r = a;
+  r.albedo = MixChannel(a.albedo, b.albedo, t);
+  [unroll] for (uint i = 0; i < 2; ++i)
+    r.normal[i] = MixChannel(a.normal[i], b.normal[i], t);
+  [unroll] for (uint j = 0; j < 4; ++j)
+    r.roughness[j] = lerp(a.roughness[j], b.roughness[j], t);
+  return r;
+}
+
+Layer MixLayer(Layer a, Layer b, float t) {
+  Layer r = a;
+  [unroll] for (uint i = 0; i < 3; ++i)
+    r.surfaces[i] = MixSurface(a.surfaces[i], b.surfaces[i], t);
+  r.uvScale = b.uvScale;
+  return r;
+}
+
+GBuffer Blend2(GBuffer a, GBuffer b, float t) {
+  GBuffer r = a;
+  [unroll] for (uint i = 0; i < LAYERS; ++i)
+    r.layers[i] = MixLayer(a.layers[i], b.layers[i], t);
+  r.emissive = lerp(a.emissive, b.emissive, t);
+  return r;
+}
+
+float4 Resolve(GBuffer g) {
+  float4 sum = g.emissive;
+  [unroll] for (uint i = 0; i < LAYERS; ++i) {
+    Layer l = g.layers[i];
+    [unroll] for (uint s = 0; s < 3; ++s) {
+      Surface surf = l.surfaces[s];
+      sum += surf.albedo.value * surf.roughness[s];
+      sum += surf.normal[s & 1].value * l.uvScale[s & 1].x;
+      sum.x += (float)(surf.albedo.packed[0].x ^ l.materialIds[s]);
+    }
+  }
+  return sum;
+}
+
+float4 main(float4 pos : SV_Position) : SV_Target {
+  GBuffer input = Defaults;
+  [unroll] for (uint i = 0; i < LAYERS; ++i)
+    input.layers[i] = InputLayers[i];
+
+  GBuffer blended = Blend2(Defaults, input, Blend);
+  GBuffer twice = Blend2(blended, input, Blend * 0.5);
+  GBuffer copies[2] = { blended, twice };
+  return Resolve(copies[(uint)pos.x & 1]) + Resolve(twice);
+}
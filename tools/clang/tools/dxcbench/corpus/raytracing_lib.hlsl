@@ -0,0 +1,299 @@
+// Path tracing library in the style of a production DXR renderer: several
+// hit groups over a shared material model, a miss shader with sky sampling,
+// procedural intersection and a callable for light evaluation.
+
+#define MAX_BOUNCES 4
+#define NUM_LIGHTS 8
+#define PI 3.14159265f
+
+struct Material {
+  float3 baseColor;
+  float metallic;
+  float roughness;
+  float3 emissive;
+  uint textureIndex;
+  uint flags;
+};
+
+struct Light {
+  float3 position;
+  float radius;
+  float3 color;
+  float intensity;
+};
+
+struct RadiancePayload {
+  float3 radiance;
+  float3 throughput;
+  uint seed;
+  uint depth;
+};
+
+struct ShadowPayload {
+  uint visible;
+};
+
+struct LightCallData {
+  float3 position;
+  float3 normal;
+  float3 radiance;
+};
+
+struct SphereAttributes {
+  float3 normal;
+};
+
+RaytracingAccelerationStructure Scene : register(t0);
+StructuredBuffer<Material> Materials : register(t1);
+StructuredBuffer<Light> Lights : register(t2);
+ByteAddressBuffer Indices : register(t3);
+StructuredBuffer<float3> Normals : register(t4);
+StructuredBuffer<float2> UVs : register(t5);
+Texture2D<float4> Textures[64] : register(t6);
+TextureCube<float4> Sky : register(t70);
+SamplerState LinearSampler : register(s0);
+RWTexture2D<float4> Output : register(u0);
+RWTexture2D<float4> Accumulation : register(u1);
+
+cbuffer Frame : register(b0) {
+  float4x4 InvViewProj;
+  float3 CameraPosition;
+  uint FrameIndex;
+  uint SampleCount;
+  float Exposure;
+};
+
+uint WangHash(uint seed) {
+  seed = (seed ^ 61) ^ (seed >> 16);
+  seed *= 9;
+  seed = seed ^ (seed >> 4);
+  seed *= 0x27d4eb2d;
+  seed = seed ^ (seed >> 15);
+  return seed;
+}
+
+float NextRandom(inout uint seed) {
+  seed = WangHash(seed);
+  return float(seed & 0x00FFFFFF) / float(0x01000000);
+}
+
+float3 SampleHemisphereCosine(float3 n, inout uint seed) {
+  float u = NextRandom(seed);
+  float v = NextRandom(seed);
+  float r = sqrt(u);
+  float phi = 2.0f * PI * v;
+  float3 t = abs(n.x) > 0.1f ? float3(0, 1, 0) : float3(1, 0, 0);
+  float3 b = normalize(cross(n, t));
+  t = cross(b, n);
+  return normalize(r * cos(phi) * t + r * sin(phi) * b + sqrt(1.0f - u) * n);
+}
+
+float DistributionGGX(float NdotH, float roughness) {
+  float a = roughness * roughness;
+  float a2 = a * a;
+  float d = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+  return a2 / (PI * d * d);
+}
+
+float GeometrySmith(float NdotV, float NdotL, float roughness) {
+  float k = (roughness + 1.0f) * (roughness + 1.0f) / 8.0f;
+  float gv = NdotV / (NdotV * (1.0f - k) + k);
+  float gl = NdotL / (NdotL * (1.0f - k) + k);
+  return gv * gl;
+}
+
+float3 FresnelSchlick(float cosTheta, float3 f0) {
+  return f0 + (1.0f - f0) * pow(saturate(1.0f - cosTheta), 5.0f);
+}
+
+float3 EvaluateBRDF(Material m, float3 n, float3 v, float3 l) {
+  float3 h = normalize(v + l);
+  float NdotL = saturate(dot(n, l));
+  float NdotV = saturate(dot(n, v)) + 1e-4f;
+  float NdotH = saturate(dot(n, h));
+  float3 f0 = lerp(float3(0.04f, 0.04f, 0.04f), m.baseColor, m.metallic);
+  float3 f = FresnelSchlick(saturate(dot(h, v)), f0);
+  float d = DistributionGGX(NdotH, m.roughness);
+  float g = GeometrySmith(NdotV, NdotL, m.roughness);
+  float3 specular = d * g * f / (4.0f * NdotV * NdotL + 1e-4f);
+  float3 diffuse = (1.0f - f) * (1.0f - m.metallic) * m.baseColor / PI;
+  return (diffuse + specular) * NdotL;
+}
+
+uint3 LoadTriangle(uint primitiveIndex) {
+  return Indices.Load3(primitiveIndex * 12);
+}
+
+float3 InterpolateNormal(uint3 tri, float2 bary) {
+  float3 w = float3(1.0f - bary.x - bary.y, bary.x, bary.y);
+  return normalize(Normals[tri.x] * w.x + Normals[tri.y] * w.y + Normals[tri.z] * w.z);
+}
+
+float2 InterpolateUV(uint3 tri, float2 bary) {
+  float3 w = float3(1.0f - bary.x - bary.y, bary.x, bary.y);
+  return UVs[tri.x] * w.x + UVs[tri.y] * w.y + UVs[tri.z] * w.z;
+}
+
+bool TraceShadow(float3 origin, float3 direction, float tMax) {
+  RayDesc ray;
+  ray.Origin = origin;
+  ray.Direction = direction;
+  ray.TMin = 1e-3f;
+  ray.TMax = tMax;
+  ShadowPayload payload;
+  payload.visible = 0;
+  TraceRay(Scene, RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER,
+           0xFF, 1, 2, 1, ray, payload);
+  return payload.visible != 0;
+}
+
+float3 DirectLighting(Material m, float3 p, float3 n, float3 v) {
+  float3 result = 0;
+  [unroll]
+  for (uint i = 0; i < NUM_LIGHTS; ++i) {
+    Light light = Lights[i];
+    float3 toLight = light.position - p;
+    float dist = length(toLight);
+    float3 l = toLight / dist;
+    if (dot(n, l) <= 0)
+      continue;
+    if (!TraceShadow(p + n * 1e-3f, l, dist - light.radius))
+      continue;
+    float attenuation = light.intensity / max(dist * dist, 1e-2f);
+    result += EvaluateBRDF(m, n, v, l) * light.color * attenuation;
+  }
+  LightCallData call;
+  call.position = p;
+  call.normal = n;
+  call.radiance = 0;
+  CallShader(0, call);
+  return result + call.radiance * m.baseColor;
+}
+
+void ShadeSurface(inout RadiancePayload payload, Material m, float3 n, float2 uv) {
+  float3 p = WorldRayOrigin() + WorldRayDirection() * RayTCurrent();
+  float3 v = -WorldRayDirection();
+  if (m.flags & 1)
+    m.baseColor *= Textures[NonUniformResourceIndex(m.textureIndex)]
+                       .SampleLevel(LinearSampler, uv, 0).rgb;
+  payload.radiance += payload.throughput * (m.emissive + DirectLighting(m, p, n, v));
+
+  if (payload.depth + 1 >= MAX_BOUNCES)
+    return;
+
+  float3 dir = SampleHemisphereCosine(n, payload.seed);
+  payload.throughput *= m.baseColor;
+  float survive = max(payload.throughput.r, max(payload.throughput.g, payload.throughput.b));
+  if (NextRandom(payload.seed) > survive)
+    return;
+  payload.throughput /= survive;
+
+  RayDesc ray;
+  ray.Origin = p + n * 1e-3f;
+  ray.Direction = dir;
+  ray.TMin = 1e-3f;
+  ray.TMax = 1e5f;
+  payload.depth += 1;
+  TraceRay(Scene, RAY_FLAG_NONE, 0xFF, 0, 2, 0, ray, payload);
+}
+
+[shader("raygeneration")]
+void RayGen() {
+  uint2 pixel = DispatchRaysIndex().xy;
+  uint2 size = DispatchRaysDimensions().xy;
+  uint seed = WangHash(pixel.x + pixel.y * size.x + FrameIndex * size.x * size.y);
+  float3 color = 0;
+  for (uint s = 0; s < SampleCount; ++s) {
+    float2 jitter = float2(NextRandom(seed), NextRandom(seed));
+    float2 ndc = ((float2(pixel) + jitter) / float2(size)) * 2.0f - 1.0f;
+    float4 target = mul(InvViewProj, float4(ndc.x, -ndc.y, 1, 1));
+    RayDesc ray;
+    ray.Origin = CameraPosition;
+    ray.Direction = normalize(target.xyz / target.w - CameraPosition);
+    ray.TMin = 0;
+    ray.TMax = 1e5f;
+    RadiancePayload payload;
+    payload.radiance = 0;
+    payload.throughput = 1;
+    payload.seed = seed;
+    payload.depth = 0;
+    TraceRay(Scene, RAY_FLAG_NONE, 0xFF, 0, 2, 0, ray, payload);
+    seed = payload.seed;
+    color += payload.radiance;
+  }
+  color /= max(SampleCount, 1u);
+  float4 history = Accumulation[pixel];
+  float4 accumulated = float4(history.rgb * history.a + color, history.a + 1);
+  accumulated.rgb /= accumulated.a;
+  Accumulation[pixel] = accumulated;
+  Output[pixel] = float4(1.0f - exp(-accumulated.rgb * Exposure), 1);
+}
+
+[shader("closesthit")]
+void OpaqueHit(inout RadiancePayload payload, in BuiltInTriangleIntersectionAttributes attr) {
+  uint3 tri = LoadTriangle(PrimitiveIndex());
+  float3 n = normalize(mul(InterpolateNormal(tri, attr.barycentrics), (float3x3)WorldToObject4x3()));
+  ShadeSurface(payload, Materials[InstanceID()], n, InterpolateUV(tri, attr.barycentrics));
+}
+
+[shader("anyhit")]
+void AlphaTestHit(inout RadiancePayload payload, in BuiltInTriangleIntersectionAttributes attr) {
+  Material m = Materials[InstanceID()];
+  uint3 tri = LoadTriangle(PrimitiveIndex());
+  float alpha = Textures[NonUniformResourceIndex(m.textureIndex)]
+                    .SampleLevel(LinearSampler, InterpolateUV(tri, attr.barycentrics), 0).a;
+  if (alpha < 0.5f)
+    IgnoreHit();
+}
+
+[shader("anyhit")]
+void ShadowAnyHit(inout ShadowPayload payload, in BuiltInTriangleIntersectionAttributes attr) {
+  payload.visible = 0;
+  AcceptHitAndEndSearch();
+}
+
+[shader("closesthit")]
+void SphereHit(inout RadiancePayload payload, in SphereAttributes attr) {
+  ShadeSurface(payload, Materials[InstanceID()], attr.normal, float2(0, 0));
+}
+
+[shader("intersection")]
+void SphereIntersection() {
+  float3 center = float3(0, 0, 0);
+  float radius = 1.0f;
+  float3 o = ObjectRayOrigin() - center;
+  float3 d = ObjectRayDirection();
+  float b = dot(o, d);
+  float c = dot(o, o) - radius * radius;
+  float disc = b * b - c * dot(d, d);
+  if (disc < 0)
+    return;
+  float sq = sqrt(disc);
+  float t0 = (-b - sq) / dot(d, d);
+  float t1 = (-b + sq) / dot(d, d);
+  SphereAttributes attr;
+  if (t0 >= RayTMin() && t0 <= RayTCurrent()) {
+    attr.normal = normalize(o + t0 * d);
+    ReportHit(t0, 0, attr);
+  } else if (t1 >= RayTMin() && t1 <= RayTCurrent()) {
+    attr.normal = normalize(o + t1 * d);
+    ReportHit(t1, 0, attr);
+  }
+}
+
+[shader("miss")]
+void SkyMiss(inout RadiancePayload payload) {
+  payload.radiance += payload.throughput * Sky.SampleLevel(LinearSampler, WorldRayDirection(), 0).rgb;
+}
+
+[shader("miss")]
+void ShadowMiss(inout ShadowPayload payload) {
+  payload.visible = 1;
+}
+
+[shader("callable")]
+void AmbientLight(inout LightCallData data) {
+  float3 up = float3(0, 1, 0);
+  float sky = saturate(dot(data.normal, up) * 0.5f + 0.5f);
+  data.radiance = lerp(float3(0.1f, 0.08f, 0.05f), float3(0.3f, 0.4f, 0.6f), sky);
+}
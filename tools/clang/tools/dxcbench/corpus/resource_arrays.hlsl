@@ -0,0 +1,45 @@
+// Bindless-style library with large unbounded resource arrays indexed from
+// material records, plus a few handles picked by select and through local
+// resource variables. This stresses resource use legalization and handle
+// lowering. ACCESSES scales the number of indexed resource accesses, so the
+// costs of the two entries in the manifest should grow in proportion.
+
+#ifndef ACCESSES
+#define ACCESSES 64
+#endif
+
+struct Material {
+  uint albedo;
+  uint normal;
+  uint buffer;
+  uint sampler;
+};
+
+Texture2D<float4> Textures[] : register(t0, space1);
+StructuredBuffer<float4> Buffers[] : register(t0, space2);
+SamplerState Samplers[16] : register(s0);
+RWStructuredBuffer<float4> Output : register(u0);
+StructuredBuffer<Material> Materials : register(t0);
+
+float4 Fetch(Material m, float2 uv, uint i) {
+  SamplerState s = Samplers[m.sampler & 15];
+  float4 c = Textures[NonUniformResourceIndex(m.albedo + i)].SampleLevel(s, uv, 0);
+  c += Textures[m.normal].SampleLevel(s, uv * 0.5, 1);
+  c += Buffers[m.buffer][i];
+  return c;
+}
+
+[shader("compute")]
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID) {
+  float2 uv = id.xy / 64.0;
+  float4 sum = 0;
+  [unroll] for (uint i = 0; i < ACCESSES; ++i)
+    sum += Fetch(Materials[id.x + i], uv, i);
+
+  Texture2D<float4> picked = Textures[0];
+  if (id.y & 1)
+    picked = Textures[1];
+  sum += picked.Load(int3(id.xy, 0));
+  Output[id.x] = sum;
+}
@@ -0,0 +1,55 @@
+// Pixel shader binding ten thousand separate textures, as a material system
+// that does not use unbounded arrays would, and a constant buffer of
+// material records. Validation checks every binding and every constant for
+// overlap, so its cost should grow with the size of the tables and not with
+// their square. DIGITS sets the textures to 10^DIGITS; MATERIALS sets the
+// records, up to 1365.
+
+#ifndef DIGITS
+#define DIGITS 4
+#endif
+
+#ifndef MATERIALS
+#define MATERIALS 1024
+#endif
+
+struct MaterialConstants {
+  float4 albedo;
+  float3 emissive;
+  float roughness;
+  float2 uvScale;
+};
+
+cbuffer Materials : register(b0) {
+  MaterialConstants Mats[MATERIALS];
+  uint MaterialIndex;
+};
+
+#define D1(M, p) M(p##0) M(p##1) M(p##2) M(p##3) M(p##4)                      \
+                 M(p##5) M(p##6) M(p##7) M(p##8) M(p##9)
+#define D2(M, p) D1(M, p##0) D1(M, p##1) D1(M, p##2) D1(M, p##3) D1(M, p##4)  \
+                 D1(M, p##5) D1(M, p##6) D1(M, p##7) D1(M, p##8) D1(M, p##9)
+#define D3(M, p) D2(M, p##0) D2(M, p##1) D2(M, p##2) D2(M, p##3) D2(M, p##4)  \
+                 D2(M, p##5) D2(M, p##6) D2(M, p##7) D2(M, p##8) D2(M, p##9)
+#define D4(M, p) D3(M, p##0) D3(M, p##1) D3(M, p##2) D3(M, p##3) D3(M, p##4)  \
+                 D3(M, p##5) D3(M, p##6) D3(M, p##7) D3(M, p##8) D3(M, p##9)
+
+#if DIGITS == 4
+#define TABLE(M) D4(M, T)
+#elif DIGITS == 3
+#define TABLE(M) D3(M, T)
+#else
+#define TABLE(M) D2(M, T)
+#endif
+
+#define DECLARE(n) Texture2D<float4> n;
+#define FETCH(n) + n.Load(int3(MaterialIndex & 7, 0, 0))
+
+TABLE(DECLARE)
+
+float4 main(float2 uv : TEXCOORD0) : SV_Target {
+  MaterialConstants m = Mats[MaterialIndex];
+  float4 c = m.albedo * float4(uv * m.uvScale, m.roughness, 1);
+  c.rgb += m.emissive;
+  return c TABLE(FETCH);
+}
@@ -0,0 +1,1407 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcbench.cpp                                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxcbench compile-time benchmark.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/microcom.h"
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/dxcapi.use.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+#ifdef _WIN32
+#include <dia2.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dxc;
+using namespace llvm;
+
+static cl::opt<bool> Help("help", cl::desc("Print help"));
+static cl::alias Help_h("h", cl::aliasopt(Help));
+static cl::alias Help_q("?", cl::aliasopt(Help));
+
+static cl::opt<std::string>
+CorpusFilename(cl::Positional, cl::desc("<corpus manifest>"));
+
+static cl::opt<unsigned> Iterations("n", cl::init(5),
+                                    cl::desc("Timed compiles per benchmark"));
+
+static cl::opt<unsigned> Warmup("warmup", cl::init(1),
+                                cl::desc("Untimed compiles per benchmark"));
+
+static cl::opt<std::string> Filter("filter",
+                                   cl::desc("Only run benchmarks whose name contains this text"),
+                                   cl::value_desc("text"));
+
+static cl::opt<std::string> OutputFilename("o",
+                                           cl::desc("Write results to a file that can be used as a baseline"),
+                                           cl::value_desc("filename"));
+
+static cl::opt<std::string> BaselineFilename("baseline",
+                                             cl::desc("Compare results against a stored baseline"),
+                                             cl::value_desc("filename"));
+
+static cl::opt<double> Threshold("threshold", cl::init(10.0),
+                                 cl::desc("Percentage over the baseline reported as a regression"));
+
+static cl::opt<bool> Startup("startup",
+                             cl::desc("Time the first compiler creation and compile of the process instead"));
+
+static cl::opt<unsigned> ShowPasses("passes", cl::init(0),
+                                    cl::desc("Number of slowest passes to list per benchmark"));
+
+static cl::opt<bool> ValidateOnly("validate",
+                                  cl::desc("Time validation of each benchmark's compiled object instead of its compile"));
+
+static cl::opt<bool> PdbLoad("pdb",
+                             cl::desc("Time loading the PDB of each benchmark's compile instead of the compile"));
+
+static cl::opt<bool> DiaOpen("dia",
+                             cl::desc("Time opening a DIA session on the PDB of each benchmark's compile instead of the compile"));
+
+static cl::opt<bool> Reflect("reflect",
+                             cl::desc("Time reflecting each benchmark's compiled object instead of its compile"));
+
+static cl::opt<std::string> ReflectCache("reflect-cache",
+                                         cl::desc("Serve -reflect from a reflection cache in this directory, filled by the warmup runs"),
+                                         cl::value_desc("directory"));
+
+static cl::opt<bool> Engine("engine",
+                            cl::desc("Time an engine build of the whole corpus instead: a batch compile, then linking, validation and reflection, at 1 to -threads threads"));
+
+static cl::opt<unsigned> Threads("threads", cl::init(0),
+                                 cl::desc("Most threads -engine scales to; 0 picks the hardware concurrency"));
+
+static cl::opt<bool> NoSpirv("no-spirv",
+                             cl::desc("Leave the -spirv entries out of -engine, for builds without SPIR-V code generation"));
+
+namespace {
+
+// Forwards to the default allocator, counting allocations and tracking the
+// bytes in use so the peak heap use of a compile can be reported. Each block
+// carries its size in a header so frees can be accounted for.
+class CountingMalloc : public IMalloc {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IMalloc> m_pBacking;
+  std::atomic<uint64_t> m_AllocCount;
+  std::atomic<uint64_t> m_AllocBytes;
+  std::atomic<int64_t> m_InUse;
+  std::atomic<int64_t> m_Peak;
+
+  static const size_t HeaderSize = 16;
+  static size_t &SizeOf(void *p) {
+    return *(size_t *)((char *)p - HeaderSize);
+  }
+
+  void Account(int64_t Delta) {
+    int64_t InUse = m_InUse += Delta;
+    int64_t Peak = m_Peak;
+    while (InUse > Peak && !m_Peak.compare_exchange_weak(Peak, InUse)) {
+    }
+  }
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+
+  CountingMalloc(IMalloc *pBacking)
+      : m_pBacking(pBacking), m_AllocCount(0), m_AllocBytes(0), m_InUse(0),
+        m_Peak(0) {}
+
+  uint64_t GetAllocCount() const { return m_AllocCount; }
+  uint64_t GetAllocBytes() const { return m_AllocBytes; }
+  uint64_t GetPeakBytes() const { return (uint64_t)(int64_t)m_Peak; }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(_In_ SIZE_T cb) override {
+    char *P = (char *)m_pBacking->Alloc(cb + HeaderSize);
+    if (P == nullptr)
+      return nullptr;
+    P += HeaderSize;
+    SizeOf(P) = cb;
+    ++m_AllocCount;
+    m_AllocBytes += cb;
+    Account((int64_t)cb);
+    return P;
+  }
+
+  void *STDMETHODCALLTYPE Realloc(_In_opt_ void *pv, _In_ SIZE_T cb) override {
+    if (pv == nullptr)
+      return Alloc(cb);
+    size_t Prior = SizeOf(pv);
+    char *P = (char *)m_pBacking->Realloc((char *)pv - HeaderSize, cb + HeaderSize);
+    if (P == nullptr)
+      return nullptr;
+    P += HeaderSize;
+    SizeOf(P) = cb;
+    ++m_AllocCount;
+    m_AllocBytes += cb;
+    Account((int64_t)cb - (int64_t)Prior);
+    return P;
+  }
+
+  void STDMETHODCALLTYPE Free(_In_opt_ void *pv) override {
+    if (pv == nullptr)
+      return;
+    Account(-(int64_t)SizeOf(pv));
+    m_pBacking->Free((char *)pv - HeaderSize);
+  }
+
+#ifdef _WIN32
+  SIZE_T STDMETHODCALLTYPE GetSize(_In_opt_ _Post_writable_byte_size_(return) void *pv) override {
+    return pv == nullptr ? 0 : SizeOf(pv);
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(_In_opt_ void *pv) override {
+    return -1; // don't know
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize(void) override {}
+#endif
+};
+
+struct Benchmark {
+  std::string Name;
+  std::string FileName;
+  std::vector<std::string> Args;
+};
+
+struct PhaseTime {
+  std::string Name;
+  double WallMs;
+};
+
+struct Measurement {
+  double MedianMs = 0;
+  double MinMs = 0;
+  uint64_t AllocCount = 0;
+  uint64_t AllocBytes = 0;
+  uint64_t PeakHeapBytes = 0;
+  uint64_t PeakRssBytes = 0;
+  uint64_t Instructions = 0;
+  std::vector<PhaseTime> Phases;
+  std::vector<PhaseTime> Passes;
+};
+
+struct BaselineEntry {
+  double MedianMs;
+  uint64_t AllocCount;
+  uint64_t PeakHeapBytes;
+};
+
+// Peak resident set of the whole process; it only ever grows, so each
+// benchmark reports the high-water mark reached by the end of its runs.
+uint64_t GetPeakRss() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS Counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)))
+    return Counters.PeakWorkingSetSize;
+  return 0;
+#else
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  return (uint64_t)Usage.ru_maxrss;
+#else
+  return (uint64_t)Usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+std::string ReadFileToString(const std::string &FileName) {
+  std::ifstream In(FileName, std::ios::binary);
+  if (!In)
+    throw hlsl::Exception(E_FAIL, "unable to open " + FileName);
+  std::stringstream SS;
+  SS << In.rdbuf();
+  return SS.str();
+}
+
+std::vector<Benchmark> ReadCorpus(const std::string &FileName) {
+  std::vector<Benchmark> Corpus;
+  SmallString<128> Dir(FileName);
+  sys::path::remove_filename(Dir);
+
+  std::istringstream In(ReadFileToString(FileName));
+  std::string Line;
+  while (std::getline(In, Line)) {
+    std::replace(Line.begin(), Line.end(), '\t', ' ');
+    StringRef Text = StringRef(Line).trim();
+    if (Text.empty() || Text[0] == '#')
+      continue;
+    SmallVector<StringRef, 16> Fields;
+    Text.split(Fields, " ", -1, false);
+    std::vector<StringRef> Tokens;
+    for (StringRef Field : Fields) {
+      Field = Field.trim();
+      if (!Field.empty())
+        Tokens.push_back(Field);
+    }
+    if (Tokens.size() < 2)
+      throw hlsl::Exception(E_INVALIDARG, "malformed corpus line: " + Line);
+    Benchmark B;
+    B.Name = Tokens[0];
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Tokens[1]);
+    B.FileName = Path.str();
+    for (size_t i = 2; i < Tokens.size(); ++i)
+      B.Args.push_back(Tokens[i]);
+    Corpus.push_back(std::move(B));
+  }
+  return Corpus;
+}
+
+// Extracts the wall time of each entry from the time report, which the
+// compiler writes with one entry per line.
+void ReadTimeReport(StringRef Report, StringMap<double> &Phases,
+                    StringMap<double> &Passes) {
+  StringMap<double> *pSection = nullptr;
+  SmallVector<StringRef, 64> Lines;
+  Report.split(Lines, "\n");
+  for (StringRef Line : Lines) {
+    if (Line.find("\"phases\": [") != StringRef::npos)
+      pSection = &Phases;
+    else if (Line.find("\"passes\": [") != StringRef::npos)
+      pSection = &Passes;
+    size_t NamePos = Line.find("\"name\": \"");
+    size_t WallPos = Line.find("\"wall_ms\": ");
+    if (!pSection || NamePos == StringRef::npos || WallPos == StringRef::npos)
+      continue;
+    StringRef Name = Line.substr(NamePos + 9);
+    Name = Name.substr(0, Name.find('"'));
+    double Wall = strtod(Line.data() + WallPos + 11, nullptr);
+    (*pSection)[Name] += Wall;
+  }
+}
+
+std::vector<PhaseTime> Average(const StringMap<double> &Totals,
+                               unsigned Count) {
+  std::vector<PhaseTime> Result;
+  for (const auto &Entry : Totals)
+    Result.push_back({Entry.getKey().str(), Entry.getValue() / Count});
+  std::sort(Result.begin(), Result.end(),
+            [](const PhaseTime &A, const PhaseTime &B) {
+              return A.WallMs > B.WallMs;
+            });
+  return Result;
+}
+
+std::vector<std::wstring> GetWideArgs(const Benchmark &B) {
+  std::vector<std::wstring> WideArgs;
+  WideArgs.push_back(Unicode::UTF8ToUTF16StringOrThrow(B.FileName.c_str()));
+  for (const std::string &Arg : B.Args)
+    WideArgs.push_back(Unicode::UTF8ToUTF16StringOrThrow(Arg.c_str()));
+  return WideArgs;
+}
+
+void CheckStatus(const Benchmark &B, IDxcResult *pResult) {
+  HRESULT Status;
+  IFT(pResult->GetStatus(&Status));
+  if (FAILED(Status)) {
+    CComPtr<IDxcBlobUtf8> pErrors;
+    IFT(pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors), nullptr));
+    std::string Msg = B.Name + " failed to compile:\n";
+    if (pErrors)
+      Msg += pErrors->GetStringPointer();
+    throw hlsl::Exception(Status, Msg);
+  }
+}
+
+struct StartupMeasurement {
+  double CreateMs;
+  double CompileMs;
+};
+
+// Times the first use of the compiler in the process: from the first
+// DxcCreateInstance call, through creating the objects a compile needs, to
+// the end of the first compile. This is only meaningful in a fresh process.
+StartupMeasurement RunStartup(DxcDllSupport &dxcSupport, const Benchmark &B) {
+  std::string Source = ReadFileToString(B.FileName);
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = Source.data();
+  SourceBuf.Size = Source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  std::vector<std::wstring> WideArgs = GetWideArgs(B);
+  std::vector<LPCWSTR> Args;
+  for (const std::wstring &Arg : WideArgs)
+    Args.push_back(Arg.c_str());
+
+  auto Start = std::chrono::steady_clock::now();
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  CComPtr<IDxcCompiler3> pCompiler;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  IFT(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
+  IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  auto Created = std::chrono::steady_clock::now();
+  CComPtr<IDxcResult> pResult;
+  IFT(pCompiler->Compile(&SourceBuf, Args.data(), (UINT32)Args.size(),
+                         pIncludeHandler, IID_PPV_ARGS(&pResult)));
+  auto End = std::chrono::steady_clock::now();
+  CheckStatus(B, pResult);
+
+  StartupMeasurement M;
+  M.CreateMs = std::chrono::duration<double, std::milli>(Created - Start).count();
+  M.CompileMs = std::chrono::duration<double, std::milli>(End - Created).count();
+  return M;
+}
+
+// Counts the instructions between OpFunction and OpFunctionEnd of a SPIR-V
+// binary. Each instruction's first word has its word count in the high half.
+uint64_t CountSpirvInstructions(const uint32_t *pWords, size_t WordCount) {
+  const uint32_t OpFunction = 54, OpFunctionEnd = 56, HeaderWords = 5;
+  uint64_t Count = 0;
+  bool InFunction = false;
+  for (size_t i = HeaderWords; i < WordCount;) {
+    uint32_t Op = pWords[i] & 0xffff;
+    uint32_t Words = pWords[i] >> 16;
+    if (Words == 0)
+      break;
+    if (Op == OpFunction)
+      InFunction = true;
+    else if (Op == OpFunctionEnd)
+      InFunction = false;
+    else if (InFunction)
+      ++Count;
+    i += Words;
+  }
+  return Count;
+}
+
+// Counts the instructions in the function bodies of the disassembled DXIL,
+// or of the SPIR-V binary when compiling with -spirv. This is the static
+// stand-in for the runtime cost of the code: comparing it across
+// optimization levels shows what compile time buys.
+uint64_t CountInstructions(IDxcCompiler3 *pCompiler, IDxcResult *pResult) {
+  CComPtr<IDxcBlob> pObject;
+  if (FAILED(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pObject), nullptr)) ||
+      !pObject)
+    return 0;
+  const uint32_t SpirvMagic = 0x07230203;
+  if (pObject->GetBufferSize() >= 5 * sizeof(uint32_t) &&
+      *(const uint32_t *)pObject->GetBufferPointer() == SpirvMagic)
+    return CountSpirvInstructions((const uint32_t *)pObject->GetBufferPointer(),
+                                  pObject->GetBufferSize() / sizeof(uint32_t));
+  DxcBuffer ObjectBuf = {};
+  ObjectBuf.Ptr = pObject->GetBufferPointer();
+  ObjectBuf.Size = pObject->GetBufferSize();
+  CComPtr<IDxcResult> pDisassembly;
+  CComPtr<IDxcBlobUtf8> pText;
+  IFT(pCompiler->Disassemble(&ObjectBuf, IID_PPV_ARGS(&pDisassembly)));
+  IFT(pDisassembly->GetOutput(DXC_OUT_DISASSEMBLY, IID_PPV_ARGS(&pText), nullptr));
+
+  uint64_t Count = 0;
+  bool InFunction = false;
+  SmallVector<StringRef, 256> Lines;
+  StringRef(pText->GetStringPointer(), pText->GetStringLength()).split(Lines, "\n");
+  for (StringRef Line : Lines) {
+    if (Line.startswith("define "))
+      InFunction = true;
+    else if (Line.startswith("}"))
+      InFunction = false;
+    else if (InFunction && Line.startswith("  ") &&
+             !Line.ltrim().startswith(";"))
+      ++Count;
+  }
+  return Count;
+}
+
+Measurement Run(DxcDllSupport &dxcSupport, const Benchmark &B) {
+  std::string Source = ReadFileToString(B.FileName);
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = Source.data();
+  SourceBuf.Size = Source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  std::vector<std::wstring> WideArgs = GetWideArgs(B);
+  WideArgs.push_back(L"-ftime-report");
+  std::vector<LPCWSTR> Args;
+  for (const std::wstring &Arg : WideArgs)
+    Args.push_back(Arg.c_str());
+
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  IFT(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
+
+  Measurement M;
+  std::vector<double> Times;
+  std::vector<uint64_t> AllocCounts, AllocBytes, PeakBytes;
+  StringMap<double> Phases, Passes;
+  for (unsigned i = 0; i < Warmup + Iterations; ++i) {
+    CComPtr<CountingMalloc> pMalloc = new CountingMalloc(DxcGetThreadMallocNoRef());
+    auto Start = std::chrono::steady_clock::now();
+    CComPtr<IDxcCompiler3> pCompiler;
+    CComPtr<IDxcResult> pResult;
+    IFT(dxcSupport.CreateInstance2(pMalloc, CLSID_DxcCompiler, &pCompiler));
+    IFT(pCompiler->Compile(&SourceBuf, Args.data(), (UINT32)Args.size(),
+                           pIncludeHandler, IID_PPV_ARGS(&pResult)));
+    auto End = std::chrono::steady_clock::now();
+
+    CheckStatus(B, pResult);
+    if (i < Warmup)
+      continue;
+
+    Times.push_back(std::chrono::duration<double, std::milli>(End - Start).count());
+    AllocCounts.push_back(pMalloc->GetAllocCount());
+    AllocBytes.push_back(pMalloc->GetAllocBytes());
+    PeakBytes.push_back(pMalloc->GetPeakBytes());
+    CComPtr<IDxcBlobUtf8> pReport;
+    if (SUCCEEDED(pResult->GetOutput(DXC_OUT_TIME_REPORT, IID_PPV_ARGS(&pReport), nullptr)) && pReport)
+      ReadTimeReport(StringRef(pReport->GetStringPointer(), pReport->GetStringLength()),
+                     Phases, Passes);
+    // The output is the same on every run; count it once, after the
+    // allocation figures of the run have been taken.
+    if (Times.size() == 1)
+      M.Instructions = CountInstructions(pCompiler, pResult);
+  }
+
+  if (Times.empty())
+    return M;
+  // Allocation figures are taken from the run with the median time.
+  std::vector<size_t> Order(Times.size());
+  for (size_t i = 0; i < Order.size(); ++i)
+    Order[i] = i;
+  std::sort(Order.begin(), Order.end(),
+            [&](size_t A, size_t B) { return Times[A] < Times[B]; });
+  size_t Median = Order[Order.size() / 2];
+  M.MedianMs = Times[Median];
+  M.MinMs = Times[Order.front()];
+  M.AllocCount = AllocCounts[Median];
+  M.AllocBytes = AllocBytes[Median];
+  M.PeakHeapBytes = PeakBytes[Median];
+  M.PeakRssBytes = GetPeakRss();
+  M.Phases = Average(Phases, Times.size());
+  M.Passes = Average(Passes, Times.size());
+  return M;
+}
+
+// Times validation of the object a benchmark compiles to the way a server
+// keeping one validator would see it: the validator is created once, and a
+// run's allocations are those of its Validate call alone. Once warm, a clean
+// object should validate with about the same allocations every run.
+Measurement RunValidation(DxcDllSupport &dxcSupport, const Benchmark &B) {
+  std::string Source = ReadFileToString(B.FileName);
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = Source.data();
+  SourceBuf.Size = Source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  std::vector<std::wstring> WideArgs = GetWideArgs(B);
+  std::vector<LPCWSTR> Args;
+  for (const std::wstring &Arg : WideArgs)
+    Args.push_back(Arg.c_str());
+
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcResult> pResult;
+  CComPtr<IDxcBlob> pObject;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  IFT(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
+  IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  IFT(pCompiler->Compile(&SourceBuf, Args.data(), (UINT32)Args.size(),
+                         pIncludeHandler, IID_PPV_ARGS(&pResult)));
+  CheckStatus(B, pResult);
+  IFT(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pObject), nullptr));
+
+  CComPtr<CountingMalloc> pMalloc = new CountingMalloc(DxcGetThreadMallocNoRef());
+  CComPtr<IDxcValidator> pValidator;
+  IFT(dxcSupport.CreateInstance2(pMalloc, CLSID_DxcValidator, &pValidator));
+
+  auto Validate = [&](UINT32 Flags) {
+    CComPtr<IDxcOperationResult> pValResult;
+    IFT(pValidator->Validate(pObject, Flags, &pValResult));
+    HRESULT Status;
+    IFT(pValResult->GetStatus(&Status));
+    if (FAILED(Status))
+      throw hlsl::Exception(Status, B.Name + " failed to validate");
+    return pValResult;
+  };
+
+  Measurement M;
+  std::vector<double> Times;
+  std::vector<uint64_t> AllocCounts, AllocBytes;
+  for (unsigned i = 0; i < Warmup + Iterations; ++i) {
+    uint64_t PriorCount = pMalloc->GetAllocCount();
+    uint64_t PriorBytes = pMalloc->GetAllocBytes();
+    auto Start = std::chrono::steady_clock::now();
+    Validate(DxcValidatorFlags_Default);
+    auto End = std::chrono::steady_clock::now();
+    if (i < Warmup)
+      continue;
+    Times.push_back(std::chrono::duration<double, std::milli>(End - Start).count());
+    AllocCounts.push_back(pMalloc->GetAllocCount() - PriorCount);
+    AllocBytes.push_back(pMalloc->GetAllocBytes() - PriorBytes);
+  }
+
+  // The phases come from one more, untimed run, as the report allocates.
+  StringMap<double> Phases, Passes;
+  CComPtr<IDxcResult> pValResult;
+  CComPtr<IDxcBlobUtf8> pReport;
+  if (SUCCEEDED(Validate(DxcValidatorFlags_Report).QueryInterface(&pValResult)) &&
+      SUCCEEDED(pValResult->GetOutput(DXC_OUT_VALIDATION_REPORT, IID_PPV_ARGS(&pReport), nullptr)) &&
+      pReport)
+    ReadTimeReport(StringRef(pReport->GetStringPointer(), pReport->GetStringLength()),
+                   Phases, Passes);
+
+  std::vector<size_t> Order(Times.size());
+  for (size_t i = 0; i < Order.size(); ++i)
+    Order[i] = i;
+  std::sort(Order.begin(), Order.end(),
+            [&](size_t A, size_t B) { return Times[A] < Times[B]; });
+  size_t Median = Order[Order.size() / 2];
+  M.MedianMs = Times[Median];
+  M.MinMs = Times[Order.front()];
+  M.AllocCount = AllocCounts[Median];
+  M.AllocBytes = AllocBytes[Median];
+  M.PeakHeapBytes = pMalloc->GetPeakBytes();
+  M.PeakRssBytes = GetPeakRss();
+  M.Instructions = CountInstructions(pCompiler, pResult);
+  M.Phases = Average(Phases, 1);
+  return M;
+}
+
+// Times opening the PDB a benchmark compiles to the way a debugging tool
+// would: each run creates an IDxcPdbUtils and loads the PDB into it, which
+// reads the sources and arguments it records. -Zi is added to the arguments
+// if they do not have it. The load should cost what the queried metadata
+// costs, not what all the debug info in the PDB does.
+Measurement RunPdbLoad(DxcDllSupport &dxcSupport, const Benchmark &B) {
+  std::string Source = ReadFileToString(B.FileName);
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = Source.data();
+  SourceBuf.Size = Source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  std::vector<std::wstring> WideArgs = GetWideArgs(B);
+  if (std::find(B.Args.begin(), B.Args.end(), "-Zi") == B.Args.end())
+    WideArgs.push_back(L"-Zi");
+  std::vector<LPCWSTR> Args;
+  for (const std::wstring &Arg : WideArgs)
+    Args.push_back(Arg.c_str());
+
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcResult> pResult;
+  CComPtr<IDxcBlob> pPdb;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  IFT(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
+  IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  IFT(pCompiler->Compile(&SourceBuf, Args.data(), (UINT32)Args.size(),
+                         pIncludeHandler, IID_PPV_ARGS(&pResult)));
+  CheckStatus(B, pResult);
+  // With -Qembed_debug the debug info is in the object rather than a PDB.
+  if (FAILED(pResult->GetOutput(DXC_OUT_PDB, IID_PPV_ARGS(&pPdb), nullptr)) ||
+      !pPdb)
+    IFT(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pPdb), nullptr));
+
+  Measurement M;
+  std::vector<double> Times;
+  std::vector<uint64_t> AllocCounts, AllocBytes, PeakBytes;
+  for (unsigned i = 0; i < Warmup + Iterations; ++i) {
+    CComPtr<CountingMalloc> pMalloc = new CountingMalloc(DxcGetThreadMallocNoRef());
+    auto Start = std::chrono::steady_clock::now();
+    CComPtr<IDxcPdbUtils> pPdbUtils;
+    IFT(dxcSupport.CreateInstance2(pMalloc, CLSID_DxcPdbUtils, &pPdbUtils));
+    IFT(pPdbUtils->Load(pPdb));
+    auto End = std::chrono::steady_clock::now();
+    if (i < Warmup)
+      continue;
+    Times.push_back(std::chrono::duration<double, std::milli>(End - Start).count());
+    AllocCounts.push_back(pMalloc->GetAllocCount());
+    AllocBytes.push_back(pMalloc->GetAllocBytes());
+    PeakBytes.push_back(pMalloc->GetPeakBytes());
+  }
+
+  std::vector<size_t> Order(Times.size());
+  for (size_t i = 0; i < Order.size(); ++i)
+    Order[i] = i;
+  std::sort(Order.begin(), Order.end(),
+            [&](size_t A, size_t B) { return Times[A] < Times[B]; });
+  size_t Median = Order[Order.size() / 2];
+  M.MedianMs = Times[Median];
+  M.MinMs = Times[Order.front()];
+  M.AllocCount = AllocCounts[Median];
+  M.AllocBytes = AllocBytes[Median];
+  M.PeakHeapBytes = PeakBytes[Median];
+  M.PeakRssBytes = GetPeakRss();
+  M.Instructions = CountInstructions(pCompiler, pResult);
+  return M;
+}
+
+// Times opening a DIA session on the PDB a benchmark compiles to, the way a
+// shader debugger does before its first query: each run creates a DIA data
+// source, loads the PDB and opens a session. -Zi is added to the arguments if
+// they do not have it. Symbols are built on the first symbol query, so the
+// open should scale with the module rather than with its debug types.
+Measurement RunDiaOpen(DxcDllSupport &dxcSupport, const Benchmark &B) {
+#ifdef _WIN32
+  std::string Source = ReadFileToString(B.FileName);
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = Source.data();
+  SourceBuf.Size = Source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  std::vector<std::wstring> WideArgs = GetWideArgs(B);
+  if (std::find(B.Args.begin(), B.Args.end(), "-Zi") == B.Args.end())
+    WideArgs.push_back(L"-Zi");
+  std::vector<LPCWSTR> Args;
+  for (const std::wstring &Arg : WideArgs)
+    Args.push_back(Arg.c_str());
+
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcResult> pResult;
+  CComPtr<IDxcBlob> pPdb;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  IFT(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
+  IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  IFT(pCompiler->Compile(&SourceBuf, Args.data(), (UINT32)Args.size(),
+                         pIncludeHandler, IID_PPV_ARGS(&pResult)));
+  CheckStatus(B, pResult);
+  if (FAILED(pResult->GetOutput(DXC_OUT_PDB, IID_PPV_ARGS(&pPdb), nullptr)) ||
+      !pPdb)
+    throw hlsl::Exception(E_INVALIDARG,
+                          B.Name + " does not produce a separate PDB");
+
+  Measurement M;
+  std::vector<double> Times;
+  std::vector<uint64_t> AllocCounts, AllocBytes, PeakBytes;
+  for (unsigned i = 0; i < Warmup + Iterations; ++i) {
+    CComPtr<CountingMalloc> pMalloc = new CountingMalloc(DxcGetThreadMallocNoRef());
+    CComPtr<IStream> pStream;
+    IFT(pUtils->CreateReadOnlyStreamFromBlob(pPdb, &pStream));
+    auto Start = std::chrono::steady_clock::now();
+    CComPtr<IDiaDataSource> pDataSource;
+    CComPtr<IDiaSession> pSession;
+    IFT(dxcSupport.CreateInstance2(pMalloc, CLSID_DxcDiaDataSource, &pDataSource));
+    IFT(pDataSource->loadDataFromIStream(pStream));
+    IFT(pDataSource->openSession(&pSession));
+    auto End = std::chrono::steady_clock::now();
+    if (i < Warmup)
+      continue;
+    Times.push_back(std::chrono::duration<double, std::milli>(End - Start).count());
+    AllocCounts.push_back(pMalloc->GetAllocCount());
+    AllocBytes.push_back(pMalloc->GetAllocBytes());
+    PeakBytes.push_back(pMalloc->GetPeakBytes());
+  }
+
+  std::vector<size_t> Order(Times.size());
+  for (size_t i = 0; i < Order.size(); ++i)
+    Order[i] = i;
+  std::sort(Order.begin(), Order.end(),
+            [&](size_t A, size_t B) { return Times[A] < Times[B]; });
+  size_t Median = Order[Order.size() / 2];
+  M.MedianMs = Times[Median];
+  M.MinMs = Times[Order.front()];
+  M.AllocCount = AllocCounts[Median];
+  M.AllocBytes = AllocBytes[Median];
+  M.PeakHeapBytes = PeakBytes[Median];
+  M.PeakRssBytes = GetPeakRss();
+  M.Instructions = CountInstructions(pCompiler, pResult);
+  return M;
+#else
+  throw hlsl::Exception(E_NOTIMPL, "-dia is only supported on Windows");
+#endif
+}
+
+// Times getting the reflection of a benchmark's compiled object: each run
+// creates an IDxcContainerReflection, loads the object and reflects its DXIL
+// part. With -reflect-cache the runs share a cache directory, which is
+// emptied first, so only the first warmup run reflects the module and the
+// timed runs read the stored entry.
+Measurement RunReflection(DxcDllSupport &dxcSupport, const Benchmark &B) {
+  std::string Source = ReadFileToString(B.FileName);
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = Source.data();
+  SourceBuf.Size = Source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  std::vector<std::wstring> WideArgs = GetWideArgs(B);
+  std::vector<LPCWSTR> Args;
+  for (const std::wstring &Arg : WideArgs)
+    Args.push_back(Arg.c_str());
+
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcResult> pResult;
+  CComPtr<IDxcBlob> pObject;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  IFT(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
+  IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  IFT(pCompiler->Compile(&SourceBuf, Args.data(), (UINT32)Args.size(),
+                         pIncludeHandler, IID_PPV_ARGS(&pResult)));
+  CheckStatus(B, pResult);
+  IFT(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pObject), nullptr));
+
+  std::wstring CacheDir;
+  if (!ReflectCache.empty()) {
+    Unicode::UTF8ToUTF16String(ReflectCache.c_str(), &CacheDir);
+    CComPtr<IDxcContainerReflectionCache> pCache;
+    IFT(dxcSupport.CreateInstance(CLSID_DxcContainerReflection, &pCache));
+    IFT(pCache->SetCacheDirectory(CacheDir.c_str()));
+    IFT(pCache->Clear());
+  }
+
+  Measurement M;
+  std::vector<double> Times;
+  std::vector<uint64_t> AllocCounts, AllocBytes, PeakBytes;
+  for (unsigned i = 0; i < Warmup + Iterations; ++i) {
+    CComPtr<CountingMalloc> pMalloc = new CountingMalloc(DxcGetThreadMallocNoRef());
+    auto Start = std::chrono::steady_clock::now();
+    CComPtr<IDxcContainerReflection> pContainer;
+    CComPtr<IUnknown> pReflection;
+    UINT32 PartIdx;
+    IFT(dxcSupport.CreateInstance2(pMalloc, CLSID_DxcContainerReflection, &pContainer));
+    if (!CacheDir.empty()) {
+      CComPtr<IDxcContainerReflectionCache> pCache;
+      IFT(pContainer.QueryInterface(&pCache));
+      IFT(pCache->SetCacheDirectory(CacheDir.c_str()));
+    }
+    IFT(pContainer->Load(pObject));
+    IFT(pContainer->FindFirstPartKind(DXC_PART_DXIL, &PartIdx));
+    IFT(pContainer->GetPartReflection(PartIdx, IID_PPV_ARGS(&pReflection)));
+    auto End = std::chrono::steady_clock::now();
+    if (i < Warmup)
+      continue;
+    Times.push_back(std::chrono::duration<double, std::milli>(End - Start).count());
+    AllocCounts.push_back(pMalloc->GetAllocCount());
+    AllocBytes.push_back(pMalloc->GetAllocBytes());
+    PeakBytes.push_back(pMalloc->GetPeakBytes());
+  }
+
+  std::vector<size_t> Order(Times.size());
+  for (size_t i = 0; i < Order.size(); ++i)
+    Order[i] = i;
+  std::sort(Order.begin(), Order.end(),
+            [&](size_t A, size_t B) { return Times[A] < Times[B]; });
+  size_t Median = Order[Order.size() / 2];
+  M.MedianMs = Times[Median];
+  M.MinMs = Times[Order.front()];
+  M.AllocCount = AllocCounts[Median];
+  M.AllocBytes = AllocBytes[Median];
+  M.PeakHeapBytes = PeakBytes[Median];
+  M.PeakRssBytes = GetPeakRss();
+  M.Instructions = CountInstructions(pCompiler, pResult);
+  return M;
+}
+
+// One shader of an engine build: its compile request, and whether the build
+// links it as a DXR library or cross-compiles it to SPIR-V. SPIR-V objects
+// are neither validated nor reflected.
+struct EngineShader {
+  Benchmark B;
+  std::string Source;
+  DxcBuffer SourceBuf;
+  std::vector<std::wstring> WideArgs;
+  std::vector<LPCWSTR> Args;
+  std::wstring Profile;
+  bool IsLibrary = false;
+  bool IsSpirv = false;
+};
+
+std::vector<EngineShader> ReadEngineShaders(const std::vector<Benchmark> &Corpus) {
+  std::vector<EngineShader> Shaders;
+  for (const Benchmark &B : Corpus) {
+    if (!Filter.empty() && B.Name.find(Filter) == std::string::npos)
+      continue;
+    bool IsSpirv =
+        std::find(B.Args.begin(), B.Args.end(), "-spirv") != B.Args.end();
+    if (IsSpirv && NoSpirv)
+      continue;
+    EngineShader S;
+    S.B = B;
+    S.Source = ReadFileToString(B.FileName);
+    S.WideArgs = GetWideArgs(B);
+    // The time report gives each compile's own latency, which the batch
+    // callback cannot see.
+    S.WideArgs.push_back(L"-ftime-report");
+    auto It = std::find(B.Args.begin(), B.Args.end(), "-T");
+    if (It != B.Args.end() && ++It != B.Args.end())
+      S.Profile = Unicode::UTF8ToUTF16StringOrThrow(It->c_str());
+    S.IsSpirv = IsSpirv;
+    S.IsLibrary = !IsSpirv && S.Profile.compare(0, 4, L"lib_") == 0;
+    Shaders.push_back(std::move(S));
+  }
+  // The buffers and argument arrays point into the entries, so they are set
+  // once the vector no longer moves them.
+  for (EngineShader &S : Shaders) {
+    S.SourceBuf = {};
+    S.SourceBuf.Ptr = S.Source.data();
+    S.SourceBuf.Size = S.Source.size();
+    S.SourceBuf.Encoding = CP_UTF8;
+    for (const std::wstring &Arg : S.WideArgs)
+      S.Args.push_back(Arg.c_str());
+  }
+  return Shaders;
+}
+
+// Reads the wall time of the whole compile from a time report.
+double ReadTotalWallMs(StringRef Report) {
+  const StringRef Key = "\"total\": { \"wall_ms\": ";
+  size_t Pos = Report.find(Key);
+  if (Pos == StringRef::npos)
+    return 0;
+  return strtod(Report.data() + Pos + Key.size(), nullptr);
+}
+
+// Keeps the result of each request of an engine build's batch, and its
+// latency. The first failed compile stops the batch.
+class EngineBatchCallback : public IDxcCompileBatchCallback {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  const std::vector<EngineShader> &m_Shaders;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+
+  EngineBatchCallback(const std::vector<EngineShader> &Shaders)
+      : m_dwRef(0), m_Shaders(Shaders), Results(Shaders.size()),
+        LatencyMs(Shaders.size()) {}
+
+  std::vector<CComPtr<IDxcResult>> Results;
+  std::vector<double> LatencyMs;
+  std::string Error;
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcCompileBatchCallback>(this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE OnCompileComplete(UINT32 requestIndex,
+                                              IDxcResult *pResult) override {
+    try {
+      CheckStatus(m_Shaders[requestIndex].B, pResult);
+      Results[requestIndex] = pResult;
+      CComPtr<IDxcBlobUtf8> pReport;
+      if (SUCCEEDED(pResult->GetOutput(DXC_OUT_TIME_REPORT, IID_PPV_ARGS(&pReport), nullptr)) && pReport)
+        LatencyMs[requestIndex] = ReadTotalWallMs(
+            StringRef(pReport->GetStringPointer(), pReport->GetStringLength()));
+      return S_OK;
+    } catch (const hlsl::Exception &E) {
+      Error = E.msg;
+      return E.hr;
+    }
+  }
+};
+
+// Runs Task(i) for each i below Count on up to ThreadCount threads, the
+// calling one included, and rethrows the first exception a task threw once
+// all of them are done.
+template <typename TaskFn>
+void RunOnThreads(size_t Count, unsigned ThreadCount, TaskFn Task) {
+  std::atomic<size_t> Next(0);
+  std::mutex ErrorMutex;
+  std::exception_ptr Error;
+  auto Worker = [&]() {
+    DxcThreadMalloc TM(nullptr);
+    for (size_t i; (i = Next++) < Count;) {
+      try {
+        Task(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> Lock(ErrorMutex);
+        if (!Error)
+          Error = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> Workers;
+  for (size_t i = 1; i < ThreadCount && i < Count; ++i)
+    Workers.emplace_back(Worker);
+  Worker();
+  for (std::thread &W : Workers)
+    W.join();
+  if (Error)
+    std::rethrow_exception(Error);
+}
+
+void CheckOperationStatus(const Benchmark &B, IDxcOperationResult *pResult,
+                          const char *pWhat) {
+  HRESULT Status;
+  IFT(pResult->GetStatus(&Status));
+  if (FAILED(Status)) {
+    CComPtr<IDxcBlobEncoding> pErrors;
+    std::string Msg = B.Name + " failed to " + pWhat + ":\n";
+    if (SUCCEEDED(pResult->GetErrorBuffer(&pErrors)) && pErrors)
+      Msg.append((const char *)pErrors->GetBufferPointer(),
+                 pErrors->GetBufferSize());
+    throw hlsl::Exception(Status, Msg);
+  }
+}
+
+struct EngineRun {
+  double CompileMs = 0;
+  double LinkMs = 0;
+  double ValidateMs = 0;
+  double ReflectMs = 0;
+  std::vector<double> LatencyMs;
+
+  double TotalMs() const { return CompileMs + LinkMs + ValidateMs + ReflectMs; }
+};
+
+// Builds every shader the way an engine's content build does, each step on
+// up to ThreadCount threads: the whole set is compiled as one batch, each
+// DXR library is linked on its own into a library of its profile, and every
+// DXIL object, linked libraries included, is validated and then reflected.
+EngineRun RunEngineBuild(DxcDllSupport &dxcSupport,
+                         const std::vector<EngineShader> &Shaders,
+                         IDxcIncludeHandler *pIncludeHandler,
+                         unsigned ThreadCount) {
+  typedef std::chrono::steady_clock Clock;
+  auto ElapsedMs = [](Clock::time_point Start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+  };
+  EngineRun R;
+
+  std::vector<DxcCompileRequest> Requests;
+  for (const EngineShader &S : Shaders) {
+    DxcCompileRequest Request = {};
+    Request.pSource = &S.SourceBuf;
+    Request.pArguments = const_cast<LPCWSTR *>(S.Args.data());
+    Request.argCount = (UINT32)S.Args.size();
+    Request.pIncludeHandler = pIncludeHandler;
+    Requests.push_back(Request);
+  }
+  CComPtr<IDxcCompilerBatch> pBatch;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pBatch));
+  CComPtr<EngineBatchCallback> pCallback = new EngineBatchCallback(Shaders);
+  auto Start = Clock::now();
+  HRESULT hr = pBatch->CompileBatch(Requests.data(), (UINT32)Requests.size(),
+                                    ThreadCount, pCallback);
+  R.CompileMs = ElapsedMs(Start);
+  if (!pCallback->Error.empty())
+    throw hlsl::Exception(FAILED(hr) ? hr : E_FAIL, pCallback->Error);
+  IFT(hr);
+  R.LatencyMs = pCallback->LatencyMs;
+
+  std::vector<CComPtr<IDxcBlob>> Objects(Shaders.size());
+  std::vector<size_t> Libraries, Dxil;
+  for (size_t i = 0; i < Shaders.size(); ++i) {
+    if (Shaders[i].IsSpirv)
+      continue;
+    IFT(pCallback->Results[i]->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&Objects[i]), nullptr));
+    Dxil.push_back(i);
+    if (Shaders[i].IsLibrary)
+      Libraries.push_back(i);
+  }
+
+  Start = Clock::now();
+  RunOnThreads(Libraries.size(), ThreadCount, [&](size_t i) {
+    const EngineShader &S = Shaders[Libraries[i]];
+    LPCWSTR LibName = L"library";
+    CComPtr<IDxcLinker> pLinker;
+    CComPtr<IDxcOperationResult> pLinkResult;
+    IFT(dxcSupport.CreateInstance(CLSID_DxcLinker, &pLinker));
+    IFT(pLinker->RegisterLibrary(LibName, Objects[Libraries[i]]));
+    IFT(pLinker->Link(L"", S.Profile.c_str(), &LibName, 1, nullptr, 0,
+                      &pLinkResult));
+    CheckOperationStatus(S.B, pLinkResult, "link");
+    CComPtr<IDxcBlob> pLinked;
+    IFT(pLinkResult->GetResult(&pLinked));
+    Objects[Libraries[i]] = pLinked;
+  });
+  R.LinkMs = ElapsedMs(Start);
+
+  Start = Clock::now();
+  RunOnThreads(Dxil.size(), ThreadCount, [&](size_t i) {
+    CComPtr<IDxcValidator> pValidator;
+    CComPtr<IDxcOperationResult> pValResult;
+    IFT(dxcSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+    IFT(pValidator->Validate(Objects[Dxil[i]], DxcValidatorFlags_Default,
+                             &pValResult));
+    CheckOperationStatus(Shaders[Dxil[i]].B, pValResult, "validate");
+  });
+  R.ValidateMs = ElapsedMs(Start);
+
+  Start = Clock::now();
+  RunOnThreads(Dxil.size(), ThreadCount, [&](size_t i) {
+    CComPtr<IDxcContainerReflection> pContainer;
+    CComPtr<IUnknown> pReflection;
+    UINT32 PartIdx;
+    IFT(dxcSupport.CreateInstance(CLSID_DxcContainerReflection, &pContainer));
+    IFT(pContainer->Load(Objects[Dxil[i]]));
+    IFT(pContainer->FindFirstPartKind(DXC_PART_DXIL, &PartIdx));
+    IFT(pContainer->GetPartReflection(PartIdx, IID_PPV_ARGS(&pReflection)));
+  });
+  R.ReflectMs = ElapsedMs(Start);
+  return R;
+}
+
+struct EngineMeasurement {
+  unsigned ThreadCount = 0;
+  // Steps of the build with the median total time.
+  EngineRun Build;
+  double ShadersPerSec = 0;
+  double P50Ms = 0;
+  double P99Ms = 0;
+  uint64_t PeakRssBytes = 0;
+};
+
+// The nearest-rank percentile of Values, which must be sorted.
+double Percentile(const std::vector<double> &Values, double P) {
+  if (Values.empty())
+    return 0;
+  size_t Rank = (size_t)std::ceil(P / 100.0 * Values.size());
+  return Values[std::min(Values.size(), std::max<size_t>(Rank, 1)) - 1];
+}
+
+// Times the engine build at one thread count. Throughput and step times come
+// from the build with the median total; latencies are those of every
+// compile of every timed build.
+EngineMeasurement RunEngine(DxcDllSupport &dxcSupport,
+                            const std::vector<EngineShader> &Shaders,
+                            unsigned ThreadCount) {
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  IFT(pUtils->CreateDefaultIncludeHandler(&pIncludeHandler));
+
+  std::vector<EngineRun> Runs;
+  std::vector<double> Latencies;
+  for (unsigned i = 0; i < Warmup + Iterations; ++i) {
+    EngineRun R = RunEngineBuild(dxcSupport, Shaders, pIncludeHandler, ThreadCount);
+    if (i < Warmup)
+      continue;
+    Latencies.insert(Latencies.end(), R.LatencyMs.begin(), R.LatencyMs.end());
+    Runs.push_back(std::move(R));
+  }
+
+  std::sort(Runs.begin(), Runs.end(), [](const EngineRun &A, const EngineRun &B) {
+    return A.TotalMs() < B.TotalMs();
+  });
+  std::sort(Latencies.begin(), Latencies.end());
+  EngineMeasurement M;
+  M.ThreadCount = ThreadCount;
+  M.Build = Runs[Runs.size() / 2];
+  if (M.Build.TotalMs() > 0)
+    M.ShadersPerSec = Shaders.size() * 1000.0 / M.Build.TotalMs();
+  M.P50Ms = Percentile(Latencies, 50);
+  M.P99Ms = Percentile(Latencies, 99);
+  M.PeakRssBytes = GetPeakRss();
+  return M;
+}
+
+// 1, 2, 4 and so on up to the most threads, which is always included.
+std::vector<unsigned> GetEngineThreadCounts() {
+  unsigned Most = Threads ? (unsigned)Threads : std::thread::hardware_concurrency();
+  Most = std::max(Most, 1u);
+  std::vector<unsigned> Counts;
+  for (unsigned Count = 1; Count < Most; Count *= 2)
+    Counts.push_back(Count);
+  Counts.push_back(Most);
+  return Counts;
+}
+
+std::string GetEngineName(unsigned ThreadCount) {
+  return "engine_" + std::to_string(ThreadCount) + "t";
+}
+
+// Baseline files hold one benchmark per line:
+//   <name> <median ms> <allocation count> <peak heap bytes>
+StringMap<BaselineEntry> ReadBaseline(const std::string &FileName) {
+  StringMap<BaselineEntry> Baseline;
+  std::istringstream In(ReadFileToString(FileName));
+  std::string Line;
+  while (std::getline(In, Line)) {
+    if (Line.empty() || Line[0] == '#')
+      continue;
+    std::istringstream Fields(Line);
+    std::string Name;
+    BaselineEntry E;
+    if (Fields >> Name >> E.MedianMs >> E.AllocCount >> E.PeakHeapBytes)
+      Baseline[Name] = E;
+  }
+  return Baseline;
+}
+
+void WriteResults(const std::string &FileName,
+                  const std::vector<std::pair<Benchmark, Measurement>> &Results) {
+  std::ofstream Out(FileName);
+  if (!Out)
+    throw hlsl::Exception(E_FAIL, "unable to write " + FileName);
+  Out << "# name median_ms alloc_count peak_heap_bytes\n";
+  for (const auto &R : Results)
+    Out << R.first.Name << ' ' << R.second.MedianMs << ' '
+        << R.second.AllocCount << ' ' << R.second.PeakHeapBytes << '\n';
+}
+
+bool IsRegression(double Value, double Base) {
+  return Base > 0 && Value > Base * (1.0 + Threshold / 100.0);
+}
+
+double ToMB(uint64_t Bytes) { return Bytes / (1024.0 * 1024.0); }
+
+struct EngineBaselineEntry {
+  double ShadersPerSec;
+  double P50Ms;
+  double P99Ms;
+  uint64_t PeakRssBytes;
+};
+
+// Engine baseline files hold one thread count per line:
+//   engine_<threads>t <shaders per second> <p50 ms> <p99 ms> <peak RSS bytes>
+StringMap<EngineBaselineEntry> ReadEngineBaseline(const std::string &FileName) {
+  StringMap<EngineBaselineEntry> Baseline;
+  std::istringstream In(ReadFileToString(FileName));
+  std::string Line;
+  while (std::getline(In, Line)) {
+    if (Line.empty() || Line[0] == '#')
+      continue;
+    std::istringstream Fields(Line);
+    std::string Name;
+    EngineBaselineEntry E;
+    if (Fields >> Name >> E.ShadersPerSec >> E.P50Ms >> E.P99Ms >> E.PeakRssBytes)
+      Baseline[Name] = E;
+  }
+  return Baseline;
+}
+
+void WriteEngineResults(const std::string &FileName,
+                        const std::vector<EngineMeasurement> &Results) {
+  std::ofstream Out(FileName);
+  if (!Out)
+    throw hlsl::Exception(E_FAIL, "unable to write " + FileName);
+  Out << "# name shaders_per_sec p50_ms p99_ms peak_rss_bytes\n";
+  for (const EngineMeasurement &M : Results)
+    Out << GetEngineName(M.ThreadCount) << ' ' << M.ShadersPerSec << ' '
+        << M.P50Ms << ' ' << M.P99Ms << ' ' << M.PeakRssBytes << '\n';
+}
+
+// Throughput regresses when it falls as far below the baseline as a time
+// over it would have to rise.
+bool IsThroughputRegression(double Value, double Base) {
+  return Base > 0 && Value * (1.0 + Threshold / 100.0) < Base;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  const char *pStage = "Operation";
+  if (llvm::sys::fs::SetupPerThreadFileSystem())
+    return 1;
+  llvm::sys::fs::AutoCleanupPerThreadFileSystem auto_cleanup_fs;
+  if (FAILED(DxcInitThreadMalloc())) return 1;
+  DxcSetThreadMallocToDefault();
+  int retVal = 0;
+  try {
+    llvm::sys::fs::MSFileSystem *msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    pStage = "Argument processing";
+    cl::ParseCommandLineOptions(argc, argv, "dxc compile-time benchmark\n");
+
+    if (CorpusFilename == "" || Help || Iterations == 0) {
+      cl::PrintHelpMessage();
+      return 2;
+    }
+
+    DxcDllSupport dxcSupport;
+    dxc::EnsureEnabled(dxcSupport);
+
+    pStage = "Reading corpus";
+    std::vector<Benchmark> Corpus = ReadCorpus(CorpusFilename);
+
+    if (Engine) {
+      StringMap<EngineBaselineEntry> EngineBaseline;
+      if (!BaselineFilename.empty())
+        EngineBaseline = ReadEngineBaseline(BaselineFilename);
+      std::vector<EngineShader> Shaders = ReadEngineShaders(Corpus);
+      if (Shaders.empty())
+        throw hlsl::Exception(E_INVALIDARG, "no benchmark matches the filter");
+      unsigned Libraries = 0, Spirv = 0;
+      for (const EngineShader &S : Shaders) {
+        Libraries += S.IsLibrary;
+        Spirv += S.IsSpirv;
+      }
+      printf("engine build of %u shaders: %u DXR libraries linked, %u compiled to SPIR-V\n",
+             (unsigned)Shaders.size(), Libraries, Spirv);
+
+      pStage = "Benchmarking the engine build";
+      printf("%-24s %10s %10s %10s %10s %10s %10s %10s %12s %10s\n", "threads",
+             "build ms", "compile ms", "link ms", "valid ms", "reflect ms",
+             "shaders/s", "p50 ms", "p99 ms", "scaling");
+      std::vector<EngineMeasurement> Results;
+      unsigned Regressions = 0;
+      for (unsigned ThreadCount : GetEngineThreadCounts()) {
+        EngineMeasurement M = RunEngine(dxcSupport, Shaders, ThreadCount);
+        // Scaling is the throughput over that of one thread times the
+        // threads, so 100% is a perfect speedup.
+        double Scaling = Results.empty() || Results.front().ShadersPerSec == 0
+                             ? 100.0
+                             : 100.0 * M.ShadersPerSec /
+                                   (Results.front().ShadersPerSec * ThreadCount);
+        std::string Name = GetEngineName(ThreadCount);
+        printf("%-24s %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %12.2f %9.1f%%\n",
+               Name.c_str(), M.Build.TotalMs(), M.Build.CompileMs, M.Build.LinkMs,
+               M.Build.ValidateMs, M.Build.ReflectMs, M.ShadersPerSec, M.P50Ms,
+               M.P99Ms, Scaling);
+        printf("    peak RSS %.2f MB\n", ToMB(M.PeakRssBytes));
+
+        auto It = EngineBaseline.find(Name);
+        if (It != EngineBaseline.end()) {
+          const EngineBaselineEntry &E = It->getValue();
+          if (IsThroughputRegression(M.ShadersPerSec, E.ShadersPerSec)) {
+            printf("    REGRESSION: %.2f shaders/s vs baseline %.2f\n",
+                   M.ShadersPerSec, E.ShadersPerSec);
+            ++Regressions;
+          }
+          if (IsRegression(M.P50Ms, E.P50Ms)) {
+            printf("    REGRESSION: p50 latency %.2f ms vs baseline %.2f ms\n",
+                   M.P50Ms, E.P50Ms);
+            ++Regressions;
+          }
+          if (IsRegression(M.P99Ms, E.P99Ms)) {
+            printf("    REGRESSION: p99 latency %.2f ms vs baseline %.2f ms\n",
+                   M.P99Ms, E.P99Ms);
+            ++Regressions;
+          }
+          if (IsRegression((double)M.PeakRssBytes, (double)E.PeakRssBytes)) {
+            printf("    REGRESSION: peak RSS %.2f MB vs baseline %.2f MB\n",
+                   ToMB(M.PeakRssBytes), ToMB(E.PeakRssBytes));
+            ++Regressions;
+          }
+        }
+        Results.push_back(M);
+      }
+
+      if (!OutputFilename.empty())
+        WriteEngineResults(OutputFilename, Results);
+      if (!EngineBaseline.empty()) {
+        printf("%u regression(s) over %.1f%% of the baseline.\n", Regressions,
+               (double)Threshold);
+        if (Regressions)
+          retVal = 1;
+      }
+      return retVal;
+    }
+
+    StringMap<BaselineEntry> Baseline;
+    if (!BaselineFilename.empty())
+      Baseline = ReadBaseline(BaselineFilename);
+
+    if (Startup) {
+      pStage = "Benchmarking startup";
+      auto It = std::find_if(Corpus.begin(), Corpus.end(), [](const Benchmark &B) {
+        return Filter.empty() || B.Name.find(Filter) != std::string::npos;
+      });
+      if (It == Corpus.end())
+        throw hlsl::Exception(E_INVALIDARG, "no benchmark matches the filter");
+      StartupMeasurement M = RunStartup(dxcSupport, *It);
+      printf("%-24s %10s %10s %10s\n", "startup", "create ms", "compile ms",
+             "total ms");
+      printf("%-24s %10.2f %10.2f %10.2f\n", It->Name.c_str(), M.CreateMs,
+             M.CompileMs, M.CreateMs + M.CompileMs);
+      return 0;
+    }
+
+    pStage = "Benchmarking";
+    printf("%-24s %10s %10s %10s %10s %12s %12s %10s\n", "benchmark",
+           "median ms", "min ms", "allocs", "alloc MB", "peak heap MB",
+           "peak RSS MB", "insts");
+    std::vector<std::pair<Benchmark, Measurement>> Results;
+    unsigned Regressions = 0;
+    for (const Benchmark &B : Corpus) {
+      if (!Filter.empty() && B.Name.find(Filter) == std::string::npos)
+        continue;
+      Measurement M = PdbLoad        ? RunPdbLoad(dxcSupport, B)
+                      : DiaOpen      ? RunDiaOpen(dxcSupport, B)
+                      : ValidateOnly ? RunValidation(dxcSupport, B)
+                      : Reflect      ? RunReflection(dxcSupport, B)
+                                     : Run(dxcSupport, B);
+      printf("%-24s %10.2f %10.2f %10llu %10.2f %12.2f %12.2f %10llu\n",
+             B.Name.c_str(), M.MedianMs, M.MinMs,
+             (unsigned long long)M.AllocCount, ToMB(M.AllocBytes),
+             ToMB(M.PeakHeapBytes), ToMB(M.PeakRssBytes),
+             (unsigned long long)M.Instructions);
+      for (const PhaseTime &P : M.Phases)
+        printf("    %-32s %10.2f ms\n", P.Name.c_str(), P.WallMs);
+      for (size_t i = 0; i < M.Passes.size() && i < ShowPasses; ++i)
+        printf("      pass %-27s %10.2f ms\n", M.Passes[i].Name.c_str(),
+               M.Passes[i].WallMs);
+
+      auto It = Baseline.find(B.Name);
+      if (It != Baseline.end()) {
+        const BaselineEntry &E = It->getValue();
+        if (IsRegression(M.MedianMs, E.MedianMs)) {
+          printf("    REGRESSION: median time %.2f ms vs baseline %.2f ms\n",
+                 M.MedianMs, E.MedianMs);
+          ++Regressions;
+        }
+        if (IsRegression((double)M.AllocCount, (double)E.AllocCount)) {
+          printf("    REGRESSION: %llu allocations vs baseline %llu\n",
+                 (unsigned long long)M.AllocCount,
+                 (unsigned long long)E.AllocCount);
+          ++Regressions;
+        }
+        if (IsRegression((double)M.PeakHeapBytes, (double)E.PeakHeapBytes)) {
+          printf("    REGRESSION: peak heap %.2f MB vs baseline %.2f MB\n",
+                 ToMB(M.PeakHeapBytes), ToMB(E.PeakHeapBytes));
+          ++Regressions;
+        }
+      }
+      Results.push_back(std::make_pair(B, M));
+    }
+
+    if (!OutputFilename.empty())
+      WriteResults(OutputFilename, Results);
+    if (!Baseline.empty()) {
+      printf("%u regression(s) over %.1f%% of the baseline.\n", Regressions,
+             (double)Threshold);
+      if (Regressions)
+        retVal = 1;
+    }
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg == nullptr || *msg == '\0')
+      printf("%s failed - error code 0x%08x.\n", pStage, (unsigned)hlslException.hr);
+    else
+      printf("%s failed - %s\n", pStage, msg);
+    return 1;
+  } catch (std::bad_alloc &) {
+    printf("%s failed - out of memory.\n", pStage);
+    return 1;
+  } catch (...) {
+    printf("%s failed - unknown error.\n", pStage);
+    return 1;
+  }
+
+  return retVal;
+}
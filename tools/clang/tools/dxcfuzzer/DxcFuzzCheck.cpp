@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcFuzzCheck.cpp                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Compiles an input and reports when the compile costs too much for its     //
+// size.                                                                     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DxcFuzzCheck.h"
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+using namespace llvm;
+
+namespace dxcfuzz {
+
+namespace {
+
+template <typename T> void ReadLimit(const char *pName, T &Value) {
+  const char *pValue = std::getenv(pName);
+  if (pValue && *pValue)
+    Value = (T)std::strtod(pValue, nullptr);
+}
+
+struct Stage {
+  StringRef Name;
+  uint64_t Instructions;
+};
+
+// Reads the name and instructions of each stage from the DXC_OUT_STATS JSON,
+// which writes one stage per line with the name first.
+std::vector<Stage> ReadStages(StringRef Json) {
+  std::vector<Stage> Stages;
+  const StringRef NameKey = "\"name\": \"", InstKey = "\"instructions\": ";
+  size_t Pos = 0;
+  while ((Pos = Json.find(NameKey, Pos)) != StringRef::npos) {
+    Pos += NameKey.size();
+    size_t NameEnd = Json.find('"', Pos);
+    size_t Inst = Json.find(InstKey, Pos);
+    size_t LineEnd = Json.find('\n', Pos);
+    if (NameEnd == StringRef::npos || Inst == StringRef::npos ||
+        Inst > LineEnd) // an allocations entry
+      continue;
+    Stage S;
+    S.Name = Json.slice(Pos, NameEnd);
+    S.Instructions = std::strtoull(Json.data() + Inst + InstKey.size(),
+                                   nullptr, 10);
+    Stages.push_back(S);
+  }
+  return Stages;
+}
+
+struct Run {
+  HRESULT Status = S_OK;
+  double Ms = 0;
+  uint64_t PeakBytes = 0;
+  std::string StatsJson;
+};
+
+Run Compile(IDxcCompiler3 *pCompiler, const Limits &L, const uint8_t *pData,
+            size_t Size, uint64_t MemoryLimitMB) {
+  std::vector<std::wstring> WideArgs;
+  for (const std::string &Arg : L.Args)
+    WideArgs.push_back(Unicode::UTF8ToUTF16StringOrThrow(Arg.c_str()));
+  WideArgs.push_back(L"-fcompile-stats");
+  WideArgs.push_back(L"-memory-limit");
+  WideArgs.push_back(std::to_wstring(MemoryLimitMB));
+  std::vector<LPCWSTR> Args;
+  for (const std::wstring &Arg : WideArgs)
+    Args.push_back(Arg.c_str());
+
+  DxcBuffer Source = {};
+  Source.Ptr = pData;
+  Source.Size = Size;
+  Source.Encoding = CP_UTF8;
+
+  Run R;
+  CComPtr<IDxcResult> pResult;
+  auto Start = std::chrono::steady_clock::now();
+  IFT(pCompiler->Compile(&Source, Args.data(), (UINT32)Args.size(), nullptr,
+                         IID_PPV_ARGS(&pResult)));
+  R.Ms = std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - Start)
+             .count();
+  IFT(pResult->GetStatus(&R.Status));
+
+  CComPtr<IDxcBlob> pMemory;
+  if (SUCCEEDED(pResult->GetOutput(DXC_OUT_MEMORY_STATISTICS,
+                                   IID_PPV_ARGS(&pMemory), nullptr)) &&
+      pMemory && pMemory->GetBufferSize() >= sizeof(DxcMemoryStatistics))
+    R.PeakBytes =
+        ((const DxcMemoryStatistics *)pMemory->GetBufferPointer())->PeakBytes;
+  CComPtr<IDxcBlobUtf8> pStats;
+  if (SUCCEEDED(pResult->GetOutput(DXC_OUT_STATS, IID_PPV_ARGS(&pStats),
+                                   nullptr)) &&
+      pStats)
+    R.StatsJson.assign(pStats->GetStringPointer(), pStats->GetStringLength());
+  return R;
+}
+
+} // namespace
+
+void Limits::ReadFromEnvironment() {
+  ReadLimit("DXC_FUZZ_TIME_BASE_MS", TimeBaseMs);
+  ReadLimit("DXC_FUZZ_TIME_PER_BYTE_MS", TimePerByteMs);
+  ReadLimit("DXC_FUZZ_MEMORY_BASE_MB", MemoryBaseMB);
+  ReadLimit("DXC_FUZZ_MEMORY_PER_BYTE_KB", MemoryPerByteKB);
+  ReadLimit("DXC_FUZZ_IR_BASE", InstructionsBase);
+  ReadLimit("DXC_FUZZ_IR_PER_BYTE", InstructionsPerByte);
+  ReadLimit("DXC_FUZZ_IR_GROWTH", StageGrowth);
+  if (const char *pArgs = std::getenv("DXC_FUZZ_ARGS")) {
+    SmallVector<StringRef, 8> Split;
+    StringRef(pArgs).split(Split, " ", -1, /*KeepEmpty*/ false);
+    Args.assign(Split.begin(), Split.end());
+  }
+}
+
+const char *GetFindingKindName(FindingKind Kind) {
+  switch (Kind) {
+  case FindingKind::None: return "none";
+  case FindingKind::Time: return "time";
+  case FindingKind::Memory: return "memory";
+  case FindingKind::InstructionGrowth: return "instruction-growth";
+  }
+  return "unknown";
+}
+
+Finding CheckCompile(IDxcCompiler3 *pCompiler, const Limits &L,
+                     const uint8_t *pData, size_t Size) {
+  double TimeLimitMs = L.TimeBaseMs + L.TimePerByteMs * Size;
+  uint64_t MemoryLimitBytes =
+      (L.MemoryBaseMB << 20) + (L.MemoryPerByteKB << 10) * Size;
+  uint64_t InstructionLimit = L.InstructionsBase + L.InstructionsPerByte * Size;
+  // The compile fails once it needs twice its limit, so a blowup doesn't
+  // take the machine down before it is reported.
+  uint64_t HardLimitMB = (2 * MemoryLimitBytes >> 20) + 1;
+
+  Finding F;
+  std::string Description;
+  raw_string_ostream OS(Description);
+  Run R = Compile(pCompiler, L, pData, Size, HardLimitMB);
+
+  if (R.Status == E_OUTOFMEMORY || R.PeakBytes > MemoryLimitBytes) {
+    F.Kind = FindingKind::Memory;
+    OS << "compile of " << Size << " bytes "
+       << (R.Status == E_OUTOFMEMORY ? "ran out of memory past "
+                                     : "used ")
+       << (R.PeakBytes >> 20) << " MB, over the limit of "
+       << (MemoryLimitBytes >> 20) << " MB";
+  } else if (R.Ms > TimeLimitMs &&
+             Compile(pCompiler, L, pData, Size, HardLimitMB).Ms > TimeLimitMs) {
+    F.Kind = FindingKind::Time;
+    OS << "compile of " << Size << " bytes took " << (uint64_t)R.Ms
+       << " ms, over the limit of " << (uint64_t)TimeLimitMs << " ms";
+  } else {
+    std::vector<Stage> Stages = ReadStages(R.StatsJson);
+    uint64_t FirstInstructions =
+        Stages.empty() ? 1 : std::max<uint64_t>(Stages.front().Instructions, 1);
+    for (const Stage &S : Stages) {
+      bool OverSize = S.Instructions > InstructionLimit;
+      bool OverGrowth = S.Instructions > L.InstructionsBase &&
+                        S.Instructions > L.StageGrowth * FirstInstructions;
+      if (!OverSize && !OverGrowth)
+        continue;
+      F.Kind = FindingKind::InstructionGrowth;
+      OS << "stage " << S.Name << " has " << S.Instructions
+         << " instructions for " << Size << " bytes of input";
+      if (OverGrowth)
+        OS << ", " << S.Instructions / FirstInstructions << " times the "
+           << Stages.front().Instructions << " of stage "
+           << Stages.front().Name;
+      else
+        OS << ", over the limit of " << InstructionLimit;
+      break;
+    }
+  }
+  OS.flush();
+  F.Description = Description;
+  return F;
+}
+
+} // namespace dxcfuzz
@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcFuzzCheck.h                                                            //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Compiles an input and reports when the compile costs too much for its     //
+// size.                                                                     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/dxcapi.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace dxcfuzz {
+
+/// What a compile may cost before it is a finding. Each limit grows with the
+/// size of the input: Base + PerByte * size. Read from the environment by
+/// ReadFromEnvironment, since the fuzzer driver owns the command line.
+struct Limits {
+  double TimeBaseMs = 1000;        // DXC_FUZZ_TIME_BASE_MS
+  double TimePerByteMs = 10;       // DXC_FUZZ_TIME_PER_BYTE_MS
+  uint64_t MemoryBaseMB = 256;     // DXC_FUZZ_MEMORY_BASE_MB
+  uint64_t MemoryPerByteKB = 64;   // DXC_FUZZ_MEMORY_PER_BYTE_KB
+  uint64_t InstructionsBase = 20000;   // DXC_FUZZ_IR_BASE
+  uint64_t InstructionsPerByte = 64;   // DXC_FUZZ_IR_PER_BYTE
+  /// Most a later stage may grow the instructions of the first one, once
+  /// past InstructionsBase.
+  double StageGrowth = 16;         // DXC_FUZZ_IR_GROWTH
+  /// Arguments of each compile; DXC_FUZZ_ARGS, split on spaces.
+  std::vector<std::string> Args = {"-T", "ps_6_0", "-E", "main"};
+
+  void ReadFromEnvironment();
+};
+
+enum class FindingKind { None, Time, Memory, InstructionGrowth };
+
+struct Finding {
+  FindingKind Kind = FindingKind::None;
+  std::string Description;
+
+  explicit operator bool() const { return Kind != FindingKind::None; }
+};
+
+const char *GetFindingKindName(FindingKind Kind);
+
+/// Compiles the Size bytes at pData with pCompiler and returns what, if
+/// anything, cost more than L allows. A slow compile is timed a second time
+/// before it is reported, so a stall of the machine is not a finding.
+Finding CheckCompile(IDxcCompiler3 *pCompiler, const Limits &L,
+                     const uint8_t *pData, size_t Size);
+
+} // namespace dxcfuzz
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcFuzzer.cpp                                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the libFuzzer target that looks for inputs whose compile costs   //
+// far more time, memory or IR than their size warrants.                     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+// Each input is compiled as HLSL with the arguments in DXC_FUZZ_ARGS, by
+// default -T ps_6_0 -E main. A compile that goes over the limits described
+// in DxcFuzzCheck.h is a finding: the input is written to
+// <DXC_FUZZ_ARTIFACTS>/<kind>-<md5> and the process aborts, as for a crash.
+// Pass the file to dxcfuzzreduce to cut it down to a reproducer.
+//
+// Inputs big enough to hold a shader need -max_len, for example
+//   dxcfuzzer -max_len=4096 <corpus directory>
+
+#include "DxcFuzzCheck.h"
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/Support/dxcapi.use.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdlib>
+#include <memory>
+
+using namespace dxc;
+using namespace llvm;
+
+namespace {
+
+// The compiler and limits outlive the inputs, so each run only pays for a
+// compile.
+struct FuzzerState {
+  DxcDllSupport DxcSupport;
+  CComPtr<IDxcCompiler3> pCompiler;
+  dxcfuzz::Limits Limits;
+  std::unique_ptr<sys::fs::MSFileSystem> Msf;
+  std::unique_ptr<sys::fs::AutoPerThreadSystem> Pts;
+
+  FuzzerState() {
+    IFT(sys::fs::SetupPerThreadFileSystem() ? E_FAIL : S_OK);
+    IFT(DxcInitThreadMalloc());
+    DxcSetThreadMallocToDefault();
+    sys::fs::MSFileSystem *msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    Msf.reset(msfPtr);
+    Pts.reset(new sys::fs::AutoPerThreadSystem(Msf.get()));
+    IFTLLVM(Pts->error_code());
+    EnsureEnabled(DxcSupport);
+    IFT(DxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    Limits.ReadFromEnvironment();
+  }
+};
+
+void WriteArtifact(const dxcfuzz::Finding &F, const uint8_t *pData,
+                   size_t Size) {
+  MD5 Hash;
+  Hash.update(ArrayRef<uint8_t>(pData, Size));
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Hex;
+  MD5::stringifyResult(Result, Hex);
+
+  const char *pDir = std::getenv("DXC_FUZZ_ARTIFACTS");
+  SmallString<256> Path(pDir ? pDir : ".");
+  sys::path::append(Path, Twine(dxcfuzz::GetFindingKindName(F.Kind)) + "-" +
+                              Hex.str());
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  if (!EC)
+    OS.write((const char *)pData, Size);
+  errs() << "dxcfuzzer: " << F.Description << "\n"
+         << "dxcfuzzer: input written to " << Path << "\n";
+}
+
+} // namespace
+
+extern "C" void LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
+  static FuzzerState *pState = new FuzzerState();
+  dxcfuzz::Finding F =
+      dxcfuzz::CheckCompile(pState->pCompiler, pState->Limits, Data, Size);
+  if (!F)
+    return;
+  WriteArtifact(F, Data, Size);
+  std::abort();
+}
@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcfuzzreduce.cpp                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for dxcfuzzreduce, which cuts an input found by  //
+// dxcfuzzer down to a reproducer.                                           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+// The input is reduced by deleting ever smaller runs of lines, then of
+// bytes, for as long as the compile still has a finding of the same kind.
+// The limits and arguments come from the same environment variables as
+// dxcfuzzer's, and grow with the input, so a smaller input that keeps the
+// finding is a sharper reproducer.
+
+#include "DxcFuzzCheck.h"
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/Support/dxcapi.use.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace dxc;
+using namespace llvm;
+
+static cl::opt<bool> Help("help", cl::desc("Print help"));
+static cl::alias Help_h("h", cl::aliasopt(Help));
+static cl::alias Help_q("?", cl::aliasopt(Help));
+
+static cl::opt<std::string>
+InputFilename(cl::Positional, cl::desc("<input found by dxcfuzzer>"));
+
+static cl::opt<std::string> OutputFilename("o",
+                                           cl::desc("Write the reproducer to this file instead of <input>.min"),
+                                           cl::value_desc("filename"));
+
+namespace {
+
+class Reducer {
+  IDxcCompiler3 *m_pCompiler;
+  const dxcfuzz::Limits &m_Limits;
+  dxcfuzz::FindingKind m_Kind;
+  unsigned m_Compiles = 0;
+
+public:
+  Reducer(IDxcCompiler3 *pCompiler, const dxcfuzz::Limits &L,
+          dxcfuzz::FindingKind Kind)
+      : m_pCompiler(pCompiler), m_Limits(L), m_Kind(Kind) {}
+
+  unsigned GetCompiles() const { return m_Compiles; }
+
+  bool Reproduces(const std::string &Input) {
+    ++m_Compiles;
+    return dxcfuzz::CheckCompile(m_pCompiler, m_Limits,
+                                 (const uint8_t *)Input.data(), Input.size())
+               .Kind == m_Kind;
+  }
+
+  // Deletes runs of Units, from half of them down to one at a time, while
+  // the joined rest reproduces the finding.
+  std::vector<std::string> Reduce(std::vector<std::string> Units) {
+    for (size_t Chunk = Units.size() / 2; Chunk > 0; Chunk /= 2) {
+      for (size_t Start = 0; Start < Units.size();) {
+        std::vector<std::string> Candidate(Units.begin(),
+                                           Units.begin() + Start);
+        Candidate.insert(Candidate.end(),
+                         Units.begin() + std::min(Start + Chunk, Units.size()),
+                         Units.end());
+        if (!Candidate.empty() && Reproduces(Join(Candidate)))
+          Units.swap(Candidate);
+        else
+          Start += Chunk;
+      }
+    }
+    return Units;
+  }
+
+  static std::string Join(const std::vector<std::string> &Units) {
+    std::string Result;
+    for (const std::string &Unit : Units)
+      Result += Unit;
+    return Result;
+  }
+};
+
+std::vector<std::string> SplitLines(const std::string &Input) {
+  std::vector<std::string> Lines;
+  size_t Start = 0;
+  while (Start < Input.size()) {
+    size_t End = Input.find('\n', Start);
+    End = End == std::string::npos ? Input.size() : End + 1;
+    Lines.push_back(Input.substr(Start, End - Start));
+    Start = End;
+  }
+  return Lines;
+}
+
+std::vector<std::string> SplitBytes(const std::string &Input) {
+  std::vector<std::string> Bytes;
+  for (char C : Input)
+    Bytes.push_back(std::string(1, C));
+  return Bytes;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  const char *pStage = "Operation";
+  if (llvm::sys::fs::SetupPerThreadFileSystem())
+    return 1;
+  llvm::sys::fs::AutoCleanupPerThreadFileSystem auto_cleanup_fs;
+  if (FAILED(DxcInitThreadMalloc())) return 1;
+  DxcSetThreadMallocToDefault();
+  int retVal = 0;
+  try {
+    llvm::sys::fs::MSFileSystem *msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    pStage = "Argument processing";
+    cl::ParseCommandLineOptions(argc, argv, "dxcfuzzer input reducer\n");
+
+    if (InputFilename == "" || Help) {
+      cl::PrintHelpMessage();
+      return 2;
+    }
+
+    DxcDllSupport dxcSupport;
+    dxc::EnsureEnabled(dxcSupport);
+    CComPtr<IDxcCompiler3> pCompiler;
+    IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    dxcfuzz::Limits Limits;
+    Limits.ReadFromEnvironment();
+
+    pStage = "Reading input";
+    std::ifstream In(InputFilename, std::ios::binary);
+    if (!In)
+      throw hlsl::Exception(E_FAIL, "unable to open " + InputFilename);
+    std::stringstream SS;
+    SS << In.rdbuf();
+    std::string Input = SS.str();
+
+    pStage = "Compiling input";
+    dxcfuzz::Finding F = dxcfuzz::CheckCompile(
+        pCompiler, Limits, (const uint8_t *)Input.data(), Input.size());
+    if (!F) {
+      errs() << InputFilename << " has no finding under the current limits\n";
+      return 1;
+    }
+    outs() << InputFilename << ": " << F.Description << "\n";
+
+    pStage = "Reducing input";
+    Reducer R(pCompiler, Limits, F.Kind);
+    std::string Reduced = Reducer::Join(R.Reduce(SplitLines(Input)));
+    Reduced = Reducer::Join(R.Reduce(SplitBytes(Reduced)));
+    F = dxcfuzz::CheckCompile(pCompiler, Limits,
+                              (const uint8_t *)Reduced.data(), Reduced.size());
+
+    pStage = "Writing reproducer";
+    std::string OutName =
+        OutputFilename.empty() ? InputFilename + ".min" : OutputFilename;
+    std::ofstream Out(OutName, std::ios::binary);
+    Out.write(Reduced.data(), Reduced.size());
+    if (!Out)
+      throw hlsl::Exception(E_FAIL, "unable to write " + OutName);
+    outs() << OutName << ": " << Input.size() << " bytes reduced to "
+           << Reduced.size() << " in " << R.GetCompiles() << " compiles";
+    if (F)
+      outs() << "; " << F.Description;
+    outs() << "\n";
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg == nullptr || *msg == '\0')
+      printf("%s failed - error code 0x%08x.\n", pStage, (unsigned)hlslException.hr);
+    else
+      printf("%s failed - %s\n", pStage, msg);
+    retVal = 1;
+  } catch (std::bad_alloc &) {
+    printf("%s failed - out of memory.\n", pStage);
+    retVal = 1;
+  }
+  return retVal;
+}
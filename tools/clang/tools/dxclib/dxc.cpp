@@ -59,14 +59,27 @@
 #include "llvm/Option/OptTable.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/StringSaver.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/YAMLParser.h"
 #ifdef _WIN32
 #include <dia2.h>
 #include <comdef.h>
 #endif
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #ifdef _WIN32
 #pragma comment(lib, "version.lib")
@@ -141,7 +154,11 @@ private:
 
   HRESULT FindModuleBlob(hlsl::DxilFourCC fourCC, IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcBlob **ppTargetBlob);
   void ExtractRootSignature(IDxcBlob *pBlob, IDxcBlob **ppResult);
+  void AddDownstreamInputArgs(std::vector<std::wstring> &argStrings);
   int VerifyRootSignature();
+  int VerifyDeterminism(IDxcBlobEncoding *pSource, LPCWSTR pTargetProfile,
+                        const std::vector<LPCWSTR> &args,
+                        IDxcOperationResult *pReferenceResult);
 
   template <typename TInterface>
   HRESULT CreateInstance(REFCLSID clsid, _Outptr_ TInterface** pResult) {
@@ -206,6 +223,15 @@ static void WriteDxcOutputToFile(DXC_OUT_KIND kind, IDxcResult *pResult, UINT32
   }
 }
 
+// Shader sources may be large generated files; map them rather than reading a
+// copy, so the compiler can reference the mapped text directly.
+static void ReadSourceFileIntoBlob(_In_ LPCWSTR pFileName,
+                                   _COM_Outptr_ IDxcBlobEncoding **ppBlobEncoding) {
+  IFT_Data(hlsl::DxcCreateBlobFromFileMapping(nullptr, pFileName, nullptr,
+                                              ppBlobEncoding),
+           pFileName);
+}
+
 static bool StringBlobEqualUtf16(IDxcBlobUtf16 *pBlob, const WCHAR *pStr) {
   size_t uSize = wcslen(pStr);
   if (pBlob && pBlob->GetStringLength() == uSize) {
@@ -214,6 +240,23 @@ static bool StringBlobEqualUtf16(IDxcBlobUtf16 *pBlob, const WCHAR *pStr) {
   return false;
 }
 
+// Writes a report output, such as the time report, to its named file, or to
+// stdout when unnamed.
+static void WriteDxcReport(IDxcOperationResult *pOperationResult,
+                           DXC_OUT_KIND kind, UINT32 textCodePage) {
+  CComPtr<IDxcResult> pResult;
+  if (FAILED(pOperationResult->QueryInterface(&pResult)) ||
+      !pResult->HasOutput(kind))
+    return;
+  CComPtr<IDxcBlob> pReport;
+  CComPtr<IDxcBlobUtf16> pName;
+  IFT(pResult->GetOutput(kind, IID_PPV_ARGS(&pReport), &pName));
+  if (pName && pName->GetStringLength() > 0)
+    WriteBlobToFile(pReport, pName->GetStringPointer(), textCodePage);
+  else
+    WriteBlobToConsole(pReport, STD_OUTPUT_HANDLE);
+}
+
 static void WriteDxcExtraOuputs(IDxcResult *pResult) {
   DXC_OUT_KIND kind = DXC_OUT_EXTRA_OUTPUTS;
   if (!pResult->HasOutput(kind)) {
@@ -278,12 +321,36 @@ int DxcContext::ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugB
     return retVal;
   }
 
+  // A syntax check only reports diagnostics.
+  if (m_Opts.SyntaxOnly)
+    return retVal;
+
+  // Pretokenized headers are not containers; write them out unchanged.
+  if (m_Opts.EmitPTH) {
+    if (!m_Opts.OutputObject.empty())
+      WriteBlobToFile(pBlob, m_Opts.OutputObject, m_Opts.DefaultTextCodePage);
+    return retVal;
+  }
+
+  // Dependency rules go to -MF if given, else to the console.
+  if (m_Opts.EmitDependencies) {
+    if (!m_Opts.OutputDependenciesFile.empty())
+      WriteBlobToFile(pBlob, m_Opts.OutputDependenciesFile, m_Opts.DefaultTextCodePage);
+    else
+      WriteBlobToConsole(pBlob);
+    return retVal;
+  }
+
   // Write the output blob.
   if (!m_Opts.OutputObject.empty()) {
     // For backward compatability: fxc requires /Fo for /extractrootsignature
     if (!m_Opts.ExtractRootSignature) {
       CComPtr<IDxcBlob> pResult;
-      UpdatePart(pBlob, &pResult);
+      // A high-level module is bitcode, not a container with parts.
+      if (m_Opts.EmitHLModule)
+        pResult = pBlob;
+      else
+        UpdatePart(pBlob, &pResult);
       WriteBlobToFile(pResult, m_Opts.OutputObject, m_Opts.DefaultTextCodePage);
     }
   }
@@ -493,6 +560,42 @@ HRESULT DxcContext::ReadFileIntoPartContent(hlsl::DxilFourCC fourCC, LPCWSTR fil
   return S_OK;
 }
 
+// Used for downstream-shader option: pass the input signature semantics of
+// the next stage to the compiler as downstream-input options.
+void DxcContext::AddDownstreamInputArgs(std::vector<std::wstring> &argStrings) {
+  CComHeapPtr<BYTE> pData;
+  DWORD dataSize;
+  hlsl::ReadBinaryFile(StringRefUtf16(m_Opts.DownstreamShader), (void**)&pData, &dataSize);
+  const hlsl::DxilContainerHeader *pHeader = hlsl::IsDxilContainerLike(pData.m_pData, dataSize);
+  IFTBOOL(hlsl::IsValidDxilContainer(pHeader, dataSize), DXC_E_CONTAINER_INVALID);
+  const hlsl::DxilPartHeader *pPartHeader = hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_InputSignature);
+  IFTBOOL(pPartHeader != nullptr, DXC_E_MISSING_PART);
+
+  const char *pSigData = hlsl::GetDxilPartData(pPartHeader);
+  uint32_t sigSize = pPartHeader->PartSize;
+  IFTBOOL(sigSize >= sizeof(hlsl::DxilProgramSignature), DXC_E_CONTAINER_INVALID);
+  const hlsl::DxilProgramSignature *pSig = (const hlsl::DxilProgramSignature *)pSigData;
+  IFTBOOL(pSig->ParamOffset <= sigSize &&
+          pSig->ParamCount <= (sigSize - pSig->ParamOffset) / sizeof(hlsl::DxilProgramSignatureElement),
+          DXC_E_CONTAINER_INVALID);
+  const hlsl::DxilProgramSignatureElement *pElements =
+      (const hlsl::DxilProgramSignatureElement *)(pSigData + pSig->ParamOffset);
+
+  // An empty semantic still states that the next stage reads nothing.
+  if (pSig->ParamCount == 0) {
+    argStrings.emplace_back(L"-downstream-input");
+    argStrings.emplace_back(L"");
+  }
+  for (uint32_t i = 0; i < pSig->ParamCount; ++i) {
+    uint32_t nameOffset = pElements[i].SemanticName;
+    IFTBOOL(nameOffset < sigSize, DXC_E_CONTAINER_INVALID);
+    llvm::StringRef name(pSigData + nameOffset, strnlen(pSigData + nameOffset, sigSize - nameOffset));
+    std::string semantic = name.str() + std::to_string(pElements[i].SemanticIndex);
+    argStrings.emplace_back(L"-downstream-input");
+    argStrings.emplace_back(Unicode::UTF8ToUTF16StringOrThrow(semantic.c_str()));
+  }
+}
+
 // Constructs a dxil container builder with only root signature part.
 // Right now IDxcContainerBuilder assumes that we are building a full dxil container,
 // but we are building a container with only rootsignature part
@@ -729,16 +832,231 @@ void DxcContext::Recompile(IDxcBlob *pSource, IDxcLibrary *pLibrary,
 #endif // _WIN32
 }
 
+static void WriteJobMessage(const llvm::Twine &message) {
+  std::string text = message.str();
+  WriteUtf8ToConsoleSizeT(text.data(), text.size(), STD_ERROR_HANDLE);
+}
+
+static std::string FourCCToString(UINT32 fourCC) {
+  std::string name;
+  for (unsigned i = 0; i < 4; ++i)
+    name += (char)((fourCC >> (i * 8)) & 0xFF);
+  return name;
+}
+
+static size_t FirstDifference(const char *pLeft, const char *pRight,
+                              size_t size) {
+  return std::mismatch(pLeft, pLeft + size, pRight).first - pLeft;
+}
+
+// Describes how pOther differs from pReference, part by part when both are
+// containers, in differences.
+static void DiffOutputs(IDxcBlob *pReference, IDxcBlob *pOther,
+                        std::vector<std::string> &differences) {
+  const char *pRefData = (const char *)pReference->GetBufferPointer();
+  const char *pOtherData = (const char *)pOther->GetBufferPointer();
+  size_t refSize = pReference->GetBufferSize();
+  size_t otherSize = pOther->GetBufferSize();
+  if (refSize == otherSize && 0 == memcmp(pRefData, pOtherData, refSize))
+    return;
+
+  const hlsl::DxilContainerHeader *pRefContainer =
+      hlsl::IsDxilContainerLike(pRefData, refSize);
+  const hlsl::DxilContainerHeader *pOtherContainer =
+      hlsl::IsDxilContainerLike(pOtherData, otherSize);
+  if (!pRefContainer || !pOtherContainer) {
+    differences.emplace_back(
+        "output differs at byte " +
+        std::to_string(FirstDifference(pRefData, pOtherData,
+                                       std::min(refSize, otherSize))));
+    return;
+  }
+
+  size_t before = differences.size();
+  for (const hlsl::DxilPartHeader *pRefPart :
+       llvm::make_range(hlsl::begin(pRefContainer), hlsl::end(pRefContainer))) {
+    std::string name = FourCCToString(pRefPart->PartFourCC);
+    const hlsl::DxilPartHeader *pOtherPart =
+        hlsl::GetDxilPartByType(pOtherContainer,
+                                (hlsl::DxilFourCC)pRefPart->PartFourCC);
+    if (!pOtherPart) {
+      differences.emplace_back("part " + name + " is missing");
+      continue;
+    }
+    const char *pRefPartData = hlsl::GetDxilPartData(pRefPart);
+    const char *pOtherPartData = hlsl::GetDxilPartData(pOtherPart);
+    if (pRefPart->PartSize != pOtherPart->PartSize)
+      differences.emplace_back(
+          "part " + name + " has " + std::to_string(pOtherPart->PartSize) +
+          " bytes instead of " + std::to_string(pRefPart->PartSize) +
+          ", first differing at byte " +
+          std::to_string(FirstDifference(
+              pRefPartData, pOtherPartData,
+              std::min(pRefPart->PartSize, pOtherPart->PartSize))));
+    else if (memcmp(pRefPartData, pOtherPartData, pRefPart->PartSize))
+      differences.emplace_back(
+          "part " + name + " differs at byte " +
+          std::to_string(FirstDifference(pRefPartData, pOtherPartData,
+                                         pRefPart->PartSize)));
+  }
+  for (const hlsl::DxilPartHeader *pOtherPart : llvm::make_range(
+           hlsl::begin(pOtherContainer), hlsl::end(pOtherContainer))) {
+    if (!hlsl::GetDxilPartByType(pRefContainer,
+                                 (hlsl::DxilFourCC)pOtherPart->PartFourCC))
+      differences.emplace_back("part " +
+                               FourCCToString(pOtherPart->PartFourCC) +
+                               " is new");
+  }
+  if (differences.size() == before)
+    differences.emplace_back("parts are in a different order");
+}
+
+// Compiles pSource VerifyDeterminism more times and compares each output
+// with that of pReferenceResult. The compiles run in rounds of 1, 2, 4 and
+// so on at the same time, up to one per processor, and cycle through 1, 2, 4
+// and 8 function optimization threads, so that both the order of work and
+// the addresses of everything allocated change from one compile to the
+// next. Differences then point at output that depends on pointer values,
+// such as iteration over a DenseMap, SmallPtrSet or unordered container
+// keyed by pointer. The compile cache is not used, so every compile runs.
+int DxcContext::VerifyDeterminism(IDxcBlobEncoding *pSource,
+                                  LPCWSTR pTargetProfile,
+                                  const std::vector<LPCWSTR> &args,
+                                  IDxcOperationResult *pReferenceResult) {
+  HRESULT status;
+  CComPtr<IDxcBlob> pReference;
+  IFT(pReferenceResult->GetStatus(&status));
+  if (FAILED(status))
+    return 0;
+  IFT(pReferenceResult->GetResult(&pReference));
+  if (!pReference)
+    return 0;
+
+  std::vector<LPCWSTR> baseArgs;
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (0 == wcscmp(args[i], L"-compile-cache") ||
+        0 == wcscmp(args[i], L"/compile-cache")) {
+      ++i; // Skip the directory too.
+      continue;
+    }
+    baseArgs.push_back(args[i]);
+  }
+
+  const unsigned compileCount = m_Opts.VerifyDeterminism;
+  const unsigned maxConcurrency =
+      std::max(1u, std::thread::hardware_concurrency());
+  const LPCWSTR functionThreads[] = {L"1", L"2", L"4", L"8"};
+  struct Outcome {
+    unsigned Concurrency = 0;
+    HRESULT Status = S_OK;
+    CComPtr<IDxcBlob> pOutput;
+  };
+  std::vector<Outcome> outcomes(compileCount);
+
+  auto compile = [&](unsigned index) {
+    DxcThreadMalloc TM(nullptr);
+    Outcome &outcome = outcomes[index];
+    try {
+      std::vector<LPCWSTR> compileArgs(baseArgs);
+      compileArgs.push_back(L"-opt-parallel-functions");
+      compileArgs.push_back(functionThreads[index % _countof(functionThreads)]);
+
+      CComPtr<IDxcLibrary> pLibrary;
+      CComPtr<IDxcCompiler> pCompiler;
+      CComPtr<IDxcIncludeHandler> pIncludeHandler;
+      CComPtr<IDxcOperationResult> pResult;
+      IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
+      IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
+      IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+      if (!m_Opts.DebugFile.empty()) {
+        CComPtr<IDxcCompiler2> pCompiler2;
+        CComHeapPtr<WCHAR> pDebugName;
+        CComPtr<IDxcBlob> pDebugBlob;
+        IFT(pCompiler.QueryInterface(&pCompiler2));
+        IFT(pCompiler2->CompileWithDebug(
+            pSource, StringRefUtf16(m_Opts.InputFile),
+            StringRefUtf16(m_Opts.EntryPoint), pTargetProfile,
+            compileArgs.data(), compileArgs.size(), m_Opts.Defines.data(),
+            m_Opts.Defines.size(), pIncludeHandler, &pResult, &pDebugName,
+            &pDebugBlob));
+      } else {
+        IFT(pCompiler->Compile(
+            pSource, StringRefUtf16(m_Opts.InputFile),
+            StringRefUtf16(m_Opts.EntryPoint), pTargetProfile,
+            compileArgs.data(), compileArgs.size(), m_Opts.Defines.data(),
+            m_Opts.Defines.size(), pIncludeHandler, &pResult));
+      }
+      IFT(pResult->GetStatus(&outcome.Status));
+      if (SUCCEEDED(outcome.Status))
+        IFT(pResult->GetResult(&outcome.pOutput));
+    } catch (const hlsl::Exception &e) {
+      outcome.Status = e.hr;
+    } catch (const std::bad_alloc &) {
+      outcome.Status = E_OUTOFMEMORY;
+    }
+  };
+
+  for (unsigned first = 0, concurrency = 1; first < compileCount;
+       concurrency = std::min(concurrency * 2, maxConcurrency)) {
+    unsigned last = std::min(first + concurrency, compileCount);
+    std::vector<std::thread> threads;
+    for (unsigned i = first; i < last; ++i) {
+      outcomes[i].Concurrency = last - first;
+      threads.emplace_back(compile, i);
+    }
+    for (std::thread &thread : threads)
+      thread.join();
+    first = last;
+  }
+
+  unsigned differing = 0;
+  for (unsigned i = 0; i < compileCount; ++i) {
+    const Outcome &outcome = outcomes[i];
+    std::vector<std::string> differences;
+    if (FAILED(outcome.Status) || !outcome.pOutput) {
+      char hr[16];
+      sprintf_s(hr, _countof(hr), "0x%08x", (unsigned)outcome.Status);
+      differences.emplace_back(std::string("compile failed with ") + hr);
+    } else {
+      DiffOutputs(pReference, outcome.pOutput, differences);
+    }
+    if (differences.empty())
+      continue;
+    ++differing;
+    for (const std::string &difference : differences)
+      WriteJobMessage("verify-determinism: compile " + llvm::Twine(i + 1) +
+                      " (" + llvm::Twine(outcome.Concurrency) +
+                      " concurrent, " +
+                      llvm::Twine(1u << (i % _countof(functionThreads))) +
+                      " function threads): " + difference);
+  }
+
+  if (differing != 0) {
+    WriteJobMessage("verify-determinism: " + llvm::Twine(differing) + " of " +
+                    llvm::Twine(compileCount) +
+                    " compiles differ from the first; look for output that "
+                    "depends on pointer order in the passes that write the "
+                    "differing parts.");
+    return 1;
+  }
+  WriteJobMessage("verify-determinism: " + llvm::Twine(compileCount) +
+                  " compiles match the first.");
+  return 0;
+}
+
 int DxcContext::Compile() {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pCompileResult;
   CComPtr<IDxcBlob> pDebugBlob;
   std::wstring outputPDBPath;
+  int determinismStatus = 0;
   {
     CComPtr<IDxcBlobEncoding> pSource;
 
     std::vector<std::wstring> argStrings;
     CopyArgsToWStrings(m_Opts.Args, CoreOption, argStrings);
+    if (!m_Opts.DownstreamShader.empty())
+      AddDownstreamInputArgs(argStrings);
 
     std::vector<LPCWSTR> args;
     args.reserve(argStrings.size());
@@ -751,7 +1069,7 @@ int DxcContext::Compile() {
     CComPtr<IDxcLibrary> pLibrary;
     IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
     IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
-    ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(m_Opts.InputFile), &pSource);
+    ReadSourceFileIntoBlob(StringRefUtf16(m_Opts.InputFile), &pSource);
     IFTARG(pSource->GetBufferSize() >= 4);
 
     if (m_Opts.RecompileFromBinary) {
@@ -793,6 +1111,10 @@ int DxcContext::Compile() {
           args.size(), m_Opts.Defines.data(),
           m_Opts.Defines.size(), pIncludeHandler, &pCompileResult));
       }
+
+      if (m_Opts.VerifyDeterminism)
+        determinismStatus = VerifyDeterminism(
+            pSource, StringRefUtf16(TargetProfile), args, pCompileResult);
     }
 
     // When compiling we don't embed debug info if options don't ask for it.
@@ -812,6 +1134,16 @@ int DxcContext::Compile() {
     WriteOperationErrorsToConsole(pCompileResult, m_Opts.OutputWarnings);
   }
 
+  // Timings and statistics are reported for failed compiles too.
+  if (m_Opts.TimeReport)
+    WriteDxcReport(pCompileResult, DXC_OUT_TIME_REPORT,
+                   m_Opts.DefaultTextCodePage);
+  if (m_Opts.CompileStats)
+    WriteDxcReport(pCompileResult, DXC_OUT_STATS, m_Opts.DefaultTextCodePage);
+  if (m_Opts.LineStats)
+    WriteDxcReport(pCompileResult, DXC_OUT_LINE_STATS,
+                   m_Opts.DefaultTextCodePage);
+
   HRESULT status;
   IFT(pCompileResult->GetStatus(&status));
   if (SUCCEEDED(status) || m_Opts.AstDump || m_Opts.OptDump) {
@@ -826,10 +1158,14 @@ int DxcContext::Compile() {
         WriteDxcOutputToFile(DXC_OUT_ROOT_SIGNATURE, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcOutputToFile(DXC_OUT_SHADER_HASH, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcOutputToFile(DXC_OUT_REFLECTION, pResult, m_Opts.DefaultTextCodePage);
+        WriteDxcOutputToFile(DXC_OUT_FUNCTION_FINGERPRINTS, pResult, m_Opts.DefaultTextCodePage);
+        WriteDxcOutputToFile(DXC_OUT_DEPENDENCIES, pResult, m_Opts.DefaultTextCodePage);
         WriteDxcExtraOuputs(pResult);
       }
     }
   }
+  if (SUCCEEDED(status) && determinismStatus != 0)
+    return determinismStatus;
   return status;
 }
 
@@ -918,7 +1254,7 @@ void DxcContext::Preprocess() {
     args.emplace_back(directory.c_str()); // The strings are kept alive in the includePath vector
   }
 
-  ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(m_Opts.InputFile), &pSource);
+  ReadSourceFileIntoBlob(StringRefUtf16(m_Opts.InputFile), &pSource);
   IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
   IFT(pCompiler->Preprocess(pSource, StringRefUtf16(m_Opts.InputFile), args.data(), args.size(), m_Opts.Defines.data(), m_Opts.Defines.size(), pIncludeHandler, &pPreprocessResult));
   WriteOperationErrorsToConsole(pPreprocessResult, m_Opts.OutputWarnings);
@@ -939,7 +1275,6 @@ void DxcContext::WriteHeader(IDxcBlobEncoding *pDisassembly, IDxcBlob *pCode,
   IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
 
   std::string s;
-  llvm::raw_string_ostream OS(s);
 
   {
     // Not safe to assume pDisassembly is utf8, must GetBlobAsUtf8 first.
@@ -959,41 +1294,69 @@ void DxcContext::WriteHeader(IDxcBlobEncoding *pDisassembly, IDxcBlob *pCode,
     while (len && pBytes[len-1] == '\0')
       len -= 1;
 
-    // Note: with \r\n line endings, writing the disassembly could be a simple
-    // WriteBlobToHandle with a prior and following WriteString for #ifs
-    OS << "#if 0\r\n";
-    s.reserve(len + len * 0.1f); // rough estimate
-    for (size_t i = 0; i < len; ++i) {
-      if (pBytes[i] == '\n')
-        OS << '\r';
-      OS << pBytes[i];
+    // Copy the disassembly a line at a time, turning \n into \r\n.
+    const size_t codeLen = pCode->GetBufferSize();
+    s.reserve(len + len / 8 + 100 + codeLen * 6 + (codeLen / 12) * 3);
+    s += "#if 0\r\n";
+    const char *pCursor = pBytes;
+    const char *pEnd = pBytes + len;
+    while (pCursor < pEnd) {
+      const char *pNewline = (const char *)memchr(pCursor, '\n', pEnd - pCursor);
+      if (!pNewline) {
+        s.append(pCursor, pEnd);
+        break;
+      }
+      s.append(pCursor, pNewline);
+      s += "\r\n";
+      pCursor = pNewline + 1;
     }
-    OS << "\r\n#endif\r\n";
+    s += "\r\n#endif\r\n";
   }
 
   {
-    OS << "\r\nconst unsigned char " << pVariableName << "[] = {";
+    // Two hex digits for each byte value.
+    static const struct HexTable {
+      char Digits[256][2];
+      HexTable() {
+        const char *pHex = "0123456789abcdef";
+        for (unsigned i = 0; i < 256; ++i) {
+          Digits[i][0] = pHex[i >> 4];
+          Digits[i][1] = pHex[i & 0xf];
+        }
+      }
+    } Hex;
+
+    s += "\r\nconst unsigned char ";
+    s += pVariableName.str();
+    s += "[] = {";
     const uint8_t *pBytes = (const uint8_t *)pCode->GetBufferPointer();
     size_t len = pCode->GetBufferSize();
-    s.reserve(100 + len * 6 + (len / 12) * 3); // rough estimate
+    // Bytes are written as " 0xNN" separated by ',', twelve to a line.
+    size_t start = s.size();
+    s.resize(start + len * 6 + ((len + 11) / 12) * 3);
+    char *pOut = &s[start];
     for (size_t i = 0; i < len; ++i) {
       if (i != 0)
-        OS << ',';
-      if ((i % 12) == 0)
-        OS << "\r\n ";
-      OS << " 0x";
-      if (pBytes[i] < 0x10)
-        OS << '0';
-      OS.write_hex(pBytes[i]);
+        *pOut++ = ',';
+      if ((i % 12) == 0) {
+        memcpy(pOut, "\r\n ", 3);
+        pOut += 3;
+      }
+      memcpy(pOut, " 0x", 3);
+      memcpy(pOut + 3, Hex.Digits[pBytes[i]], 2);
+      pOut += 5;
     }
-    OS << "\r\n};\r\n";
+    s.resize(pOut - s.data());
+    s += "\r\n};\r\n";
   }
 
-  OS.flush();
-
-  // Respect user's -encoding option
+  // Respect user's -encoding option. For UTF-8, the pinned blob includes the
+  // string's terminator so it is written without a copy.
+  size_t pinnedLen = s.length();
+  if (m_Opts.DefaultTextCodePage == DXC_CP_UTF8)
+    pinnedLen += 1;
   CComPtr<IDxcBlobEncoding> pOutBlob;
-  pLibrary->CreateBlobWithEncodingFromPinned(s.data(), s.length(), DXC_CP_UTF8, &pOutBlob);
+  pLibrary->CreateBlobWithEncodingFromPinned(s.c_str(), pinnedLen, DXC_CP_UTF8, &pOutBlob);
   WriteBlobToFile(pOutBlob, pFileName, m_Opts.DefaultTextCodePage);
 }
 
@@ -1280,6 +1643,782 @@ static LONG CALLBACK ExceptionFilter(PEXCEPTION_POINTERS pExceptionInfo)
 #endif
 
 
+// Writes the message of an exception that ended an operation to stderr.
+static void WriteHlslExceptionToConsole(const ::hlsl::Exception &hlslException) {
+  const char *msg = hlslException.what();
+  Unicode::acp_char printBuffer[128]; // printBuffer is safe to treat as
+                                      // UTF-8 because we use ASCII only errors
+  if (msg == nullptr || *msg == '\0') {
+    switch (hlslException.hr) {
+    case DXC_E_DUPLICATE_PART:
+      sprintf_s(
+          printBuffer, _countof(printBuffer),
+          "dxc failed : DXIL container already contains the given part.");
+      break;
+    case DXC_E_MISSING_PART:
+      sprintf_s(
+          printBuffer, _countof(printBuffer),
+          "dxc failed : DXIL container does not contain the given part.");
+      break;
+    case DXC_E_CONTAINER_INVALID:
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "dxc failed : Invalid DXIL container.");
+      break;
+    case DXC_E_CONTAINER_MISSING_DXIL:
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "dxc failed : DXIL container is missing DXIL part.");
+      break;
+    case DXC_E_CONTAINER_MISSING_DEBUG:
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "dxc failed : DXIL container is missing Debug Info part.");
+      break;
+    case DXC_E_LLVM_FATAL_ERROR:
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "dxc failed : Internal Compiler Error - LLVM Fatal Error!");
+      break;
+    case DXC_E_LLVM_UNREACHABLE:
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "dxc failed : Internal Compiler Error - UNREACHABLE executed!");
+      break;
+    case DXC_E_LLVM_CAST_ERROR:
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "dxc failed : Internal Compiler Error - Cast of incompatible type!");
+      break;
+    case E_OUTOFMEMORY:
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "dxc failed : Out of Memory.");
+      break;
+    case E_INVALIDARG:
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "dxc failed : Invalid argument.");
+      break;
+    default:
+      sprintf_s(printBuffer, _countof(printBuffer),
+        "dxc failed : error code 0x%08x.\n", hlslException.hr);
+    }
+    msg = printBuffer;
+  }
+
+  WriteUtf8ToConsoleSizeT(msg, strlen(msg), STD_ERROR_HANDLE);
+}
+
+// Runs the action the options ask for, naming it in pStage for errors.
+static int RunAction(DxcContext &context, const DxcOpts &dxcOpts,
+                     const char *&pStage) {
+  // TODO: implement all other actions.
+  if (!dxcOpts.Preprocess.empty()) {
+    pStage = "Preprocessing";
+    context.Preprocess();
+    return 0;
+  }
+  else if (dxcOpts.DumpBin) {
+    pStage = "Dumping existing binary";
+    return context.DumpBinary();
+  }
+  else if (dxcOpts.Link) {
+    pStage = "Linking";
+    return context.Link();
+  }
+  else {
+    pStage = "Compilation";
+    return context.Compile();
+  }
+}
+
+// Runs one job of a -jobs file as its own dxc invocation would, returning
+// the exit code that invocation would have had.
+static int RunJob(const OptTable *optionTable, const MainArgs &jobArgs,
+                  DxcDllSupport &dxcSupport) {
+  const char *pStage = "Argument processing";
+  try {
+    DxcOpts dxcOpts;
+    {
+      std::string errorString;
+      llvm::raw_string_ostream errorStream(errorString);
+      int optResult =
+          ReadDxcOpts(optionTable, DxcFlags, jobArgs, dxcOpts, errorStream);
+      errorStream.flush();
+      if (errorString.size()) {
+        WriteJobMessage("dxc failed : " + errorString);
+      }
+      if (optResult != 0) {
+        return optResult;
+      }
+    }
+    if (!dxcOpts.JobsFile.empty() || !dxcOpts.ManifestFile.empty() ||
+        dxcOpts.Serve) {
+      WriteJobMessage("dxc failed : -jobs, -manifest and -serve cannot be used "
+                      "within a job.");
+      return 1;
+    }
+
+    if (dxcOpts.EntryPoint.empty() && !dxcOpts.RecompileFromBinary) {
+      dxcOpts.EntryPoint = "main";
+    }
+
+    DxcContext context(dxcOpts, dxcSupport);
+    return RunAction(context, dxcOpts, pStage);
+  } catch (const ::hlsl::Exception &hlslException) {
+    try {
+      WriteHlslExceptionToConsole(hlslException);
+    } catch (...) {
+      WriteJobMessage(llvm::Twine(pStage) +
+                      " failed - unable to retrieve error message.");
+    }
+    return 1;
+  } catch (std::bad_alloc &) {
+    WriteJobMessage(llvm::Twine(pStage) + " failed - out of memory.");
+    return 1;
+  } catch (...) {
+    WriteJobMessage(llvm::Twine(pStage) + " failed - unknown error.");
+    return 1;
+  }
+}
+
+// Returns the arguments dxc was started with but the ones naming the jobs,
+// which every job shares.
+static std::vector<std::string> GetSharedJobArgs(const OptTable *optionTable,
+                                                 const MainArgs &argStrings) {
+  std::vector<bool> skipArg(argStrings.Utf8StringVector.size(), false);
+  {
+    unsigned missingArgIndex = 0, missingArgCount = 0;
+    InputArgList args =
+        optionTable->ParseArgs(argStrings.getArrayRef(), missingArgIndex,
+                               missingArgCount, DxcFlags);
+    for (const Arg *arg :
+         args.filtered(OPT_jobs, OPT_jobs_threads, OPT_manifest)) {
+      for (unsigned i = 0; i < 2 && arg->getIndex() + i < skipArg.size(); ++i)
+        skipArg[arg->getIndex() + i] = true;
+    }
+  }
+  std::vector<std::string> sharedArgs;
+  for (size_t i = 0; i < skipArg.size(); ++i) {
+    if (!skipArg[i])
+      sharedArgs.push_back(argStrings.Utf8StringVector[i]);
+  }
+  return sharedArgs;
+}
+
+// Runs the compiles listed in a -jobs file on a pool of threads, sharing the
+// loaded compiler between them. Each line holds the arguments of one job,
+// which follow the arguments dxc was started with; blank lines and lines
+// starting with '#' are skipped. The output of each job is written together
+// once the job finishes, and the result is 1 if any job failed.
+static int RunJobs(const OptTable *optionTable, const MainArgs &argStrings,
+                   const DxcOpts &dxcOpts, DxcDllSupport &dxcSupport) {
+  std::vector<std::string> sharedArgs =
+      GetSharedJobArgs(optionTable, argStrings);
+
+  CComPtr<IDxcBlobEncoding> pJobsBlob;
+  CComPtr<IDxcBlobUtf8> pJobsText;
+  ReadFileIntoBlob(dxcSupport, StringRefUtf16(dxcOpts.JobsFile), &pJobsBlob);
+  IFT(hlsl::DxcGetBlobAsUtf8(pJobsBlob, nullptr, &pJobsText));
+
+  struct Job {
+    unsigned Line;
+    std::vector<std::string> Args;
+  };
+  std::vector<Job> jobs;
+  {
+    llvm::SmallVector<llvm::StringRef, 32> lines;
+    llvm::StringRef(pJobsText->GetStringPointer(), pJobsText->GetStringLength())
+        .split(lines, "\n");
+    for (unsigned i = 0; i < lines.size(); ++i) {
+      llvm::StringRef line = lines[i].trim();
+      if (line.empty() || line[0] == '#')
+        continue;
+      llvm::BumpPtrAllocator alloc;
+      llvm::BumpPtrStringSaver saver(alloc);
+      llvm::SmallVector<const char *, 16> lineArgs;
+#ifdef _WIN32
+      llvm::cl::TokenizeWindowsCommandLine(line, saver, lineArgs);
+#else
+      llvm::cl::TokenizeGNUCommandLine(line, saver, lineArgs);
+#endif
+      jobs.push_back(Job{i + 1, sharedArgs});
+      jobs.back().Args.insert(jobs.back().Args.end(), lineArgs.begin(),
+                              lineArgs.end());
+    }
+  }
+  if (jobs.empty())
+    return 0;
+
+  unsigned threadCount = dxcOpts.JobsThreads;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min<unsigned>(threadCount, jobs.size());
+
+  std::atomic<unsigned> nextJob(0);
+  std::atomic<unsigned> failedJobs(0);
+  auto worker = [&]() {
+    DxcThreadMalloc TM(nullptr);
+    for (unsigned i = nextJob++; i < jobs.size(); i = nextJob++) {
+      const Job &job = jobs[i];
+      std::vector<llvm::StringRef> jobArgRefs(job.Args.begin(), job.Args.end());
+      MainArgs jobArgs(jobArgRefs);
+      DxcConsoleCapture capture;
+      if (RunJob(optionTable, jobArgs, dxcSupport) != 0) {
+        ++failedJobs;
+        WriteJobMessage(dxcOpts.JobsFile + "(" + llvm::Twine(job.Line) +
+                        "): job failed.");
+      }
+    }
+  };
+
+  // The calling thread runs jobs too, so a single thread needs no others.
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &thread : threads)
+    thread.join();
+
+  if (failedJobs != 0) {
+    WriteJobMessage(llvm::Twine(failedJobs.load()) + " of " + llvm::Twine(jobs.size()) +
+                    " jobs failed.");
+    return 1;
+  }
+  return 0;
+}
+
+// A shader listed in a -manifest file.
+struct ManifestJob {
+  std::string Name;
+  std::string Source;
+  std::vector<std::string> Args;
+  std::vector<std::string> After;   // Names of the jobs to run first.
+  std::vector<size_t> Dependents;   // Jobs that run after this one.
+  unsigned Waiting = 0;             // Jobs in After that haven't succeeded.
+  bool Skipped = false;
+  double Milliseconds = 0;
+};
+
+static std::string GetManifestString(llvm::yaml::Node *pNode,
+                                     llvm::StringRef what) {
+  llvm::yaml::ScalarNode *pScalar =
+      llvm::dyn_cast_or_null<llvm::yaml::ScalarNode>(pNode);
+  if (!pScalar)
+    throw hlsl::Exception(E_INVALIDARG,
+                          ("manifest " + what + " must be a string").str());
+  llvm::SmallString<64> storage;
+  return pScalar->getValue(storage).str();
+}
+
+// Reads a string, or a list of strings.
+static void GetManifestStrings(llvm::yaml::Node *pNode, llvm::StringRef what,
+                               std::vector<std::string> &values) {
+  llvm::yaml::SequenceNode *pSequence =
+      llvm::dyn_cast_or_null<llvm::yaml::SequenceNode>(pNode);
+  if (!pSequence) {
+    values.push_back(GetManifestString(pNode, what));
+    return;
+  }
+  for (llvm::yaml::Node &value : *pSequence)
+    values.push_back(GetManifestString(&value, what));
+}
+
+// Reads a job, given as a mapping of
+//   name, source, entry, profile, defines, args, after
+// and outputs, a mapping from object, pdb, header, errors, reflection,
+// rootsig or hash to the file given to -Fo, -Fd, -Fh, -Fe, -Fre, -Frs or -Fsh.
+static void ReadManifestJob(llvm::yaml::Node *pNode,
+                            const std::vector<std::string> &sharedArgs,
+                            ManifestJob &job) {
+  static const char *const OutputOptions[][2] = {
+      {"object", "-Fo"}, {"pdb", "-Fd"},        {"header", "-Fh"},
+      {"errors", "-Fe"}, {"reflection", "-Fre"}, {"rootsig", "-Frs"},
+      {"hash", "-Fsh"}};
+  llvm::yaml::MappingNode *pMapping =
+      llvm::dyn_cast_or_null<llvm::yaml::MappingNode>(pNode);
+  if (!pMapping)
+    throw hlsl::Exception(E_INVALIDARG, "manifest shaders must be mappings");
+
+  job.Args = sharedArgs;
+  std::vector<std::string> extraArgs;
+  for (llvm::yaml::KeyValueNode &keyValue : *pMapping) {
+    std::string key = GetManifestString(keyValue.getKey(), "keys");
+    llvm::yaml::Node *pValue = keyValue.getValue();
+    if (key == "name") {
+      job.Name = GetManifestString(pValue, key);
+    } else if (key == "source") {
+      job.Source = GetManifestString(pValue, key);
+    } else if (key == "entry") {
+      job.Args.push_back("-E");
+      job.Args.push_back(GetManifestString(pValue, key));
+    } else if (key == "profile") {
+      job.Args.push_back("-T");
+      job.Args.push_back(GetManifestString(pValue, key));
+    } else if (key == "defines") {
+      std::vector<std::string> defines;
+      GetManifestStrings(pValue, key, defines);
+      for (const std::string &define : defines) {
+        job.Args.push_back("-D");
+        job.Args.push_back(define);
+      }
+    } else if (key == "args") {
+      GetManifestStrings(pValue, key, extraArgs);
+    } else if (key == "after") {
+      GetManifestStrings(pValue, key, job.After);
+    } else if (key == "outputs") {
+      llvm::yaml::MappingNode *pOutputs =
+          llvm::dyn_cast_or_null<llvm::yaml::MappingNode>(pValue);
+      if (!pOutputs)
+        throw hlsl::Exception(E_INVALIDARG, "manifest outputs must be a mapping");
+      for (llvm::yaml::KeyValueNode &output : *pOutputs) {
+        std::string kind = GetManifestString(output.getKey(), "output kinds");
+        auto it = std::find_if(std::begin(OutputOptions), std::end(OutputOptions),
+                               [&](const char *const *pEntry) {
+                                 return kind == pEntry[0];
+                               });
+        if (it == std::end(OutputOptions))
+          throw hlsl::Exception(E_INVALIDARG,
+                                "unknown manifest output '" + kind + "'");
+        job.Args.push_back((*it)[1]);
+        job.Args.push_back(GetManifestString(output.getValue(), kind));
+      }
+    } else {
+      throw hlsl::Exception(E_INVALIDARG, "unknown manifest key '" + key + "'");
+    }
+  }
+  if (job.Source.empty())
+    throw hlsl::Exception(E_INVALIDARG, "manifest shader without a source");
+  job.Args.push_back(job.Source);
+  job.Args.insert(job.Args.end(), extraArgs.begin(), extraArgs.end());
+  if (job.Name.empty())
+    job.Name = job.Source;
+}
+
+// Reads the jobs of a -manifest file, which is either a list of shaders or a
+// mapping with the list as 'shaders', and links each one to the jobs that
+// come after it.
+static void ReadManifest(DxcDllSupport &dxcSupport, llvm::StringRef fileName,
+                         const std::vector<std::string> &sharedArgs,
+                         std::vector<ManifestJob> &jobs) {
+  CComPtr<IDxcBlobEncoding> pManifestBlob;
+  CComPtr<IDxcBlobUtf8> pManifestText;
+  ReadFileIntoBlob(dxcSupport, StringRefUtf16(fileName), &pManifestBlob);
+  IFT(hlsl::DxcGetBlobAsUtf8(pManifestBlob, nullptr, &pManifestText));
+
+  std::string errorString;
+  llvm::raw_string_ostream errorStream(errorString);
+  llvm::SourceMgr sourceMgr;
+  sourceMgr.setDiagHandler(
+      [](const llvm::SMDiagnostic &diag, void *pContext) {
+        diag.print(nullptr, *(llvm::raw_ostream *)pContext, false);
+      },
+      &errorStream);
+  llvm::yaml::Stream stream(llvm::StringRef(pManifestText->GetStringPointer(),
+                                            pManifestText->GetStringLength()),
+                            sourceMgr);
+  // Nodes are parsed as they are visited, so shaders are read in place.
+  auto readShaders = [&](llvm::yaml::Node *pNode) {
+    llvm::yaml::SequenceNode *pShaders =
+        llvm::dyn_cast_or_null<llvm::yaml::SequenceNode>(pNode);
+    if (!pShaders)
+      throw hlsl::Exception(E_INVALIDARG, "manifest must list shaders");
+    for (llvm::yaml::Node &shader : *pShaders) {
+      jobs.emplace_back();
+      ReadManifestJob(&shader, sharedArgs, jobs.back());
+    }
+  };
+  for (llvm::yaml::Document &document : stream) {
+    llvm::yaml::Node *pRoot = document.getRoot();
+    if (llvm::yaml::MappingNode *pMapping =
+            llvm::dyn_cast_or_null<llvm::yaml::MappingNode>(pRoot)) {
+      for (llvm::yaml::KeyValueNode &keyValue : *pMapping) {
+        if (GetManifestString(keyValue.getKey(), "keys") != "shaders")
+          throw hlsl::Exception(E_INVALIDARG, "manifest must list 'shaders'");
+        readShaders(keyValue.getValue());
+      }
+    } else if (!stream.failed()) {
+      readShaders(pRoot);
+    }
+  }
+  if (stream.failed()) {
+    errorStream.flush();
+    throw hlsl::Exception(E_INVALIDARG,
+                          fileName.str() + ": invalid manifest\n" + errorString);
+  }
+
+  std::unordered_map<std::string, size_t> jobsByName;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (!jobsByName.insert(std::make_pair(jobs[i].Name, i)).second)
+      throw hlsl::Exception(E_INVALIDARG, "manifest shader '" + jobs[i].Name +
+                                              "' is listed twice");
+  }
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    for (const std::string &after : jobs[i].After) {
+      auto it = jobsByName.find(after);
+      if (it == jobsByName.end())
+        throw hlsl::Exception(E_INVALIDARG, "manifest shader '" + jobs[i].Name +
+                                                "' comes after unknown '" +
+                                                after + "'");
+      jobs[it->second].Dependents.push_back(i);
+      ++jobs[i].Waiting;
+    }
+  }
+
+  // Every job must be reachable from the ones that wait for nothing.
+  std::vector<unsigned> waiting;
+  std::vector<size_t> order;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    waiting.push_back(jobs[i].Waiting);
+    if (!jobs[i].Waiting)
+      order.push_back(i);
+  }
+  for (size_t n = 0; n < order.size(); ++n) {
+    for (size_t dependent : jobs[order[n]].Dependents)
+      if (--waiting[dependent] == 0)
+        order.push_back(dependent);
+  }
+  if (order.size() != jobs.size())
+    throw hlsl::Exception(E_INVALIDARG, "manifest shaders depend on each other "
+                                        "in a cycle");
+}
+
+// Compiles the shaders of a -manifest file on a pool of threads. A shader
+// starts once the shaders it comes after have compiled, and is skipped if one
+// of them fails. A thread picks a ready shader with the same source as its
+// last one when there is one, so permutations of a source run back to back
+// and reuse its preprocessed includes. A line reports each shader as it
+// finishes together with its time, and a summary ends the run.
+static int RunManifest(const OptTable *optionTable, const MainArgs &argStrings,
+                       const DxcOpts &dxcOpts, DxcDllSupport &dxcSupport) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  std::vector<ManifestJob> jobs;
+  ReadManifest(dxcSupport, dxcOpts.ManifestFile,
+               GetSharedJobArgs(optionTable, argStrings), jobs);
+  if (jobs.empty())
+    return 0;
+
+  std::mutex lock;
+  std::condition_variable changed;
+  std::vector<size_t> ready;
+  for (size_t i = 0; i < jobs.size(); ++i)
+    if (!jobs[i].Waiting)
+      ready.push_back(i);
+  size_t finished = 0;
+  unsigned failed = 0, skipped = 0;
+
+  auto report = [&](const ManifestJob &job, const char *pResult) {
+    WriteJobMessage("[" + llvm::Twine(finished) + "/" +
+                    llvm::Twine(jobs.size()) + "] " + job.Name + ": " +
+                    pResult + " (" + llvm::Twine((unsigned)job.Milliseconds) +
+                    " ms)\n");
+  };
+
+  auto worker = [&]() {
+    DxcThreadMalloc TM(nullptr);
+    std::string lastSource;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+      changed.wait(guard,
+                   [&]() { return !ready.empty() || finished == jobs.size(); });
+      if (ready.empty())
+        return;
+      auto next = std::find_if(ready.begin(), ready.end(), [&](size_t i) {
+        return jobs[i].Source == lastSource;
+      });
+      if (next == ready.end())
+        next = ready.begin();
+      ManifestJob &job = jobs[*next];
+      ready.erase(next);
+      lastSource = job.Source;
+      guard.unlock();
+
+      Clock::time_point jobStart = Clock::now();
+      int result;
+      {
+        std::vector<llvm::StringRef> jobArgRefs(job.Args.begin(),
+                                                job.Args.end());
+        MainArgs jobArgs(jobArgRefs);
+        DxcConsoleCapture capture;
+        result = RunJob(optionTable, jobArgs, dxcSupport);
+      }
+      job.Milliseconds = std::chrono::duration<double, std::milli>(
+                             Clock::now() - jobStart)
+                             .count();
+
+      guard.lock();
+      ++finished;
+      if (result == 0) {
+        report(job, "compiled");
+        for (size_t dependent : job.Dependents)
+          if (--jobs[dependent].Waiting == 0)
+            ready.push_back(dependent);
+      } else {
+        ++failed;
+        report(job, "failed");
+        // Skip everything that comes after the failed shader.
+        std::vector<size_t> toSkip(job.Dependents);
+        while (!toSkip.empty()) {
+          ManifestJob &dependent = jobs[toSkip.back()];
+          toSkip.pop_back();
+          if (dependent.Skipped)
+            continue;
+          dependent.Skipped = true;
+          ++finished;
+          ++skipped;
+          report(dependent, "skipped");
+          toSkip.insert(toSkip.end(), dependent.Dependents.begin(),
+                        dependent.Dependents.end());
+        }
+      }
+      changed.notify_all();
+    }
+  };
+
+  unsigned threadCount = dxcOpts.JobsThreads;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min<unsigned>(threadCount, jobs.size());
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &thread : threads)
+    thread.join();
+
+  std::vector<const ManifestJob *> slowest;
+  for (const ManifestJob &job : jobs)
+    if (!job.Skipped)
+      slowest.push_back(&job);
+  const size_t SlowestShown = 3;
+  size_t shown = std::min(SlowestShown, slowest.size());
+  std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(),
+                    [](const ManifestJob *a, const ManifestJob *b) {
+                      return a->Milliseconds > b->Milliseconds;
+                    });
+  std::string summary;
+  llvm::raw_string_ostream summaryStream(summary);
+  summaryStream << (unsigned)(jobs.size() - failed - skipped) << " of "
+                << (unsigned)jobs.size() << " shaders compiled, " << failed
+                << " failed, " << skipped << " skipped in "
+                << (unsigned)std::chrono::duration<double, std::milli>(
+                       Clock::now() - start)
+                       .count()
+                << " ms; slowest:";
+  for (size_t i = 0; i < shown; ++i)
+    summaryStream << (i ? ", " : " ") << slowest[i]->Name << " ("
+                  << (unsigned)slowest[i]->Milliseconds << " ms)";
+  summaryStream << "\n";
+  WriteJobMessage(summaryStream.str());
+  return failed ? 1 : 0;
+}
+
+// With -serve, dxc compiles the requests it reads from standard input with
+// one compiler instance and writes a response for each to standard output, so
+// the compiler only starts once. Every message is a little-endian UINT32 size
+// followed by that many bytes; strings and blobs inside are UINT32 sizes
+// followed by bytes. A request is
+//   UINT32 argCount, argCount UTF-8 arguments,
+//   UINT32 fileCount, fileCount pairs of file name and contents.
+// The arguments are those of dxc without the input file: the first file is
+// compiled, and includes are looked up among the other files before the file
+// system. A response is
+//   UINT32 status (HRESULT), UINT32 outputCount,
+//   outputCount pairs of UINT32 DXC_OUT_KIND and blob,
+// which include the object, PDB and errors, where produced. At the end of the
+// input or an empty message, dxc exits.
+class DxcServeReader {
+  const char *m_pCursor;
+  const char *m_pEnd;
+
+public:
+  explicit DxcServeReader(llvm::StringRef message)
+      : m_pCursor(message.begin()), m_pEnd(message.end()) {}
+
+  bool ReadUInt32(UINT32 &value) {
+    if (m_pEnd - m_pCursor < (ptrdiff_t)sizeof(value))
+      return false;
+    memcpy(&value, m_pCursor, sizeof(value));
+    m_pCursor += sizeof(value);
+    return true;
+  }
+
+  bool ReadBytes(llvm::StringRef &bytes) {
+    UINT32 size;
+    if (!ReadUInt32(size) || (UINT32)(m_pEnd - m_pCursor) < size)
+      return false;
+    bytes = llvm::StringRef(m_pCursor, size);
+    m_pCursor += size;
+    return true;
+  }
+};
+
+static void AppendServeUInt32(std::string &message, UINT32 value) {
+  message.append((const char *)&value, sizeof(value));
+}
+
+static void AppendServeBytes(std::string &message, const void *pData,
+                             size_t size) {
+  AppendServeUInt32(message, (UINT32)size);
+  message.append((const char *)pData, size);
+}
+
+// Serves the includes sent with a request, then those on disk.
+class DxcServeIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IDxcIncludeHandler> m_pFallback;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  DxcServeIncludeHandler(IDxcIncludeHandler *pFallback)
+      : m_dwRef(0), m_pFallback(pFallback) {}
+  std::unordered_map<std::wstring, CComPtr<IDxcBlob>> includeFiles;
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  static std::wstring Normalize(llvm::StringRef fileName) {
+    llvm::SmallString<128> normalizedPath;
+    llvm::sys::path::native(fileName, normalizedPath);
+    // Includes next to the main file are asked for as "./name".
+    llvm::StringRef path = normalizedPath;
+    while (path.size() > 2 && path[0] == '.' &&
+           llvm::sys::path::is_separator(path[1]))
+      path = path.drop_front(2);
+    return Unicode::UTF8ToUTF16StringOrThrow(path.str().c_str());
+  }
+
+  HRESULT STDMETHODCALLTYPE LoadSource(
+    _In_ LPCWSTR pFilename,
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource
+  ) override {
+    try {
+      auto it = includeFiles.find(
+          Normalize(Unicode::UTF16ToUTF8StringOrThrow(pFilename)));
+      if (it == includeFiles.end())
+        return m_pFallback->LoadSource(pFilename, ppIncludeSource);
+      *ppIncludeSource = it->second;
+      (*ppIncludeSource)->AddRef();
+    }
+    CATCH_CPP_RETURN_HRESULT()
+    return S_OK;
+  }
+};
+
+// Compiles one -serve request into its response.
+static void ServeCompile(IDxcCompiler3 *pCompiler, IDxcUtils *pUtils,
+                         IDxcIncludeHandler *pDefaultIncludeHandler,
+                         llvm::StringRef request, std::string &response) {
+  DxcServeReader reader(request);
+  std::vector<std::wstring> args;
+  UINT32 argCount, fileCount;
+  HRESULT status = E_INVALIDARG;
+  CComPtr<IDxcResult> pResult;
+  CComPtr<DxcServeIncludeHandler> pIncludeHandler =
+      new DxcServeIncludeHandler(pDefaultIncludeHandler);
+  llvm::StringRef mainName, mainSource;
+
+  bool valid = reader.ReadUInt32(argCount);
+  for (UINT32 i = 0; valid && i < argCount; ++i) {
+    llvm::StringRef arg;
+    valid = reader.ReadBytes(arg);
+    if (valid)
+      args.push_back(Unicode::UTF8ToUTF16StringOrThrow(arg.str().c_str()));
+  }
+  valid = valid && reader.ReadUInt32(fileCount) && fileCount > 0;
+  for (UINT32 i = 0; valid && i < fileCount; ++i) {
+    llvm::StringRef name, contents;
+    valid = reader.ReadBytes(name) && reader.ReadBytes(contents);
+    if (!valid)
+      break;
+    if (i == 0) {
+      mainName = name;
+      mainSource = contents;
+      continue;
+    }
+    CComPtr<IDxcBlobEncoding> pInclude;
+    IFT(pUtils->CreateBlob(contents.data(), (UINT32)contents.size(), CP_ACP,
+                           &pInclude));
+    pIncludeHandler->includeFiles[DxcServeIncludeHandler::Normalize(name)] =
+        pInclude;
+  }
+
+  if (valid) {
+    args.push_back(Unicode::UTF8ToUTF16StringOrThrow(mainName.str().c_str()));
+    std::vector<LPCWSTR> argPointers;
+    for (const std::wstring &arg : args)
+      argPointers.push_back(arg.c_str());
+    DxcBuffer source = {mainSource.data(), mainSource.size(), CP_ACP};
+    status = pCompiler->Compile(&source, argPointers.data(),
+                                (UINT32)argPointers.size(), pIncludeHandler,
+                                IID_PPV_ARGS(&pResult));
+    if (SUCCEEDED(status))
+      IFT(pResult->GetStatus(&status));
+  }
+
+  std::string outputs;
+  UINT32 outputCount = 0;
+  for (UINT32 i = 0; pResult && i < pResult->GetNumOutputs(); ++i) {
+    DXC_OUT_KIND kind = pResult->GetOutputByIndex(i);
+    CComPtr<IDxcBlob> pOutput;
+    CComPtr<IDxcBlobUtf16> pOutputName;
+    if (FAILED(pResult->GetOutput(kind, IID_PPV_ARGS(&pOutput), &pOutputName)) ||
+        !pOutput)
+      continue;
+    // Text is sent without its terminator.
+    size_t size = pOutput->GetBufferSize();
+    CComPtr<IDxcBlobUtf8> pText;
+    if (SUCCEEDED(pOutput.QueryInterface(&pText)))
+      size = pText->GetStringLength();
+    AppendServeUInt32(outputs, (UINT32)kind);
+    AppendServeBytes(outputs, pOutput->GetBufferPointer(), size);
+    ++outputCount;
+  }
+
+  response.clear();
+  AppendServeUInt32(response, (UINT32)status);
+  AppendServeUInt32(response, outputCount);
+  response += outputs;
+}
+
+static int RunServer(DxcDllSupport &dxcSupport) {
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcUtils> pUtils;
+  CComPtr<IDxcIncludeHandler> pDefaultIncludeHandler;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  IFT(dxcSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+  IFT(pUtils->CreateDefaultIncludeHandler(&pDefaultIncludeHandler));
+
+  std::string request, response;
+  while (true) {
+    UINT32 size;
+    if (fread(&size, sizeof(size), 1, stdin) != 1 || size == 0)
+      return 0;
+    request.resize(size);
+    if (fread(&request[0], 1, size, stdin) != size)
+      return 1;
+
+    try {
+      ServeCompile(pCompiler, pUtils, pDefaultIncludeHandler, request,
+                   response);
+    } catch (const ::hlsl::Exception &hlslException) {
+      response.clear();
+      AppendServeUInt32(response, (UINT32)hlslException.hr);
+      AppendServeUInt32(response, 0);
+    } catch (std::bad_alloc &) {
+      response.clear();
+      AppendServeUInt32(response, (UINT32)E_OUTOFMEMORY);
+      AppendServeUInt32(response, 0);
+    }
+
+    UINT32 responseSize = (UINT32)response.size();
+    if (fwrite(&responseSize, sizeof(responseSize), 1, stdout) != 1 ||
+        fwrite(response.data(), 1, response.size(), stdout) != response.size() ||
+        fflush(stdout) != 0)
+      return 1;
+  }
+}
+
 #ifdef _WIN32
 int dxc::main(int argc, const wchar_t **argv_) {
 #else
@@ -1355,80 +2494,24 @@ int dxc::main(int argc, const char **argv_) {
       return 0;
     }
 
-    // TODO: implement all other actions.
-    if (!dxcOpts.Preprocess.empty()) {
-      pStage = "Preprocessing";
-      context.Preprocess();
+    if (dxcOpts.Serve) {
+      pStage = "Serving compile requests";
+      retVal = RunServer(dxcSupport);
     }
-    else if (dxcOpts.DumpBin) {
-      pStage = "Dumping existing binary";
-      retVal = context.DumpBinary();
+    else if (!dxcOpts.ManifestFile.empty()) {
+      pStage = "Compiling manifest";
+      retVal = RunManifest(optionTable, argStrings, dxcOpts, dxcSupport);
     }
-    else if (dxcOpts.Link) {
-      pStage = "Linking";
-      retVal = context.Link();
+    else if (!dxcOpts.JobsFile.empty()) {
+      pStage = "Running jobs";
+      retVal = RunJobs(optionTable, argStrings, dxcOpts, dxcSupport);
     }
     else {
-      pStage = "Compilation";
-      retVal = context.Compile();
+      retVal = RunAction(context, dxcOpts, pStage);
     }
   } catch (const ::hlsl::Exception &hlslException) {
     try {
-      const char *msg = hlslException.what();
-      Unicode::acp_char printBuffer[128]; // printBuffer is safe to treat as
-                                          // UTF-8 because we use ASCII only errors
-      if (msg == nullptr || *msg == '\0') {
-        switch (hlslException.hr) {
-        case DXC_E_DUPLICATE_PART:
-          sprintf_s(
-              printBuffer, _countof(printBuffer),
-              "dxc failed : DXIL container already contains the given part.");
-          break;
-        case DXC_E_MISSING_PART:
-          sprintf_s(
-              printBuffer, _countof(printBuffer),
-              "dxc failed : DXIL container does not contain the given part.");
-          break;
-        case DXC_E_CONTAINER_INVALID:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Invalid DXIL container.");
-          break;
-        case DXC_E_CONTAINER_MISSING_DXIL:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : DXIL container is missing DXIL part.");
-          break;
-        case DXC_E_CONTAINER_MISSING_DEBUG:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : DXIL container is missing Debug Info part.");
-          break;
-        case DXC_E_LLVM_FATAL_ERROR:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Internal Compiler Error - LLVM Fatal Error!");
-          break;
-        case DXC_E_LLVM_UNREACHABLE:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Internal Compiler Error - UNREACHABLE executed!");
-          break;
-        case DXC_E_LLVM_CAST_ERROR:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Internal Compiler Error - Cast of incompatible type!");
-          break;
-        case E_OUTOFMEMORY:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Out of Memory.");
-          break;
-        case E_INVALIDARG:
-          sprintf_s(printBuffer, _countof(printBuffer),
-                    "dxc failed : Invalid argument.");
-          break;
-        default:
-          sprintf_s(printBuffer, _countof(printBuffer),
-            "dxc failed : error code 0x%08x.\n", hlslException.hr);
-        }
-        msg = printBuffer;
-      }
-
-      WriteUtf8ToConsoleSizeT(msg, strlen(msg), STD_ERROR_HANDLE);
+      WriteHlslExceptionToConsole(hlslException);
       printf("\n");
     } catch (...) {
       printf("%s failed - unable to retrieve error message.\n", pStage);
@@ -19,11 +19,6 @@
 #endif
 #include "dxillib.h"
 
-namespace hlsl {
-HRESULT SetupRegistryPassForHLSL();
-HRESULT SetupRegistryPassForPIX();
-} // namespace hlsl
-
 // C++ exception specification ignored except to indicate a function is not __declspec(nothrow)
 #pragma warning( disable : 4290 )
 
@@ -40,10 +35,10 @@ void * __CRTDECL operator new(std::size_t size,
   return DxcGetThreadMallocNoRef()->Alloc(size);
 }
 void  __CRTDECL operator delete (void* ptr) throw() {
-  DxcGetThreadMallocNoRef()->Free(ptr);
+  DxcThreadFree(ptr);
 }
 void  __CRTDECL operator delete (void* ptr, const std::nothrow_t& nothrow_constant) throw() {
-  DxcGetThreadMallocNoRef()->Free(ptr);
+  DxcThreadFree(ptr);
 }
 #endif
 
@@ -58,8 +53,8 @@ static HRESULT InitMaybeFail() throw() {
     goto Cleanup;
   }
   fsSetup = true;
-  IFC(hlsl::SetupRegistryPassForHLSL());
-  IFC(hlsl::SetupRegistryPassForPIX());
+  // Passes are registered when the first object that runs them is created;
+  // see EnsurePassesRegistered in dxcapi.cpp.
   IFC(DxilLibInitialize());
   if (hlsl::options::initHlslOptTable()) {
     hr = E_FAIL;
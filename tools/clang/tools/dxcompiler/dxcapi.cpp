@@ -26,6 +26,7 @@
 #include "dxillib.h"
 #include "dxc/DxilContainer/DxcContainerBuilder.h"
 #include <memory>
+#include <mutex>
 
 HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcDiaDataSource(_In_ REFIID riid, _Out_ LPVOID *ppv);
@@ -39,10 +40,30 @@ HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcContainerBuilder(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcPdbUtils(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcIncludeCache(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
 namespace hlsl {
 void CreateDxcContainerReflection(IDxcContainerReflection **ppResult);
 void CreateDxcLinker(IDxcContainerReflection **ppResult);
+HRESULT SetupRegistryPassForHLSL();
+HRESULT SetupRegistryPassForPIX();
+}
+
+// Registers the passes the first time an object that runs them is created,
+// rather than when the library loads, so that processes using only the
+// other objects never pay for it. Only the optimizer looks up PIX passes.
+// The registry outlives any one allocator, so it uses the default one.
+static HRESULT EnsurePassesRegistered(bool includePIX) {
+  static std::once_flag hlslOnce, pixOnce;
+  static HRESULT hlslResult = S_OK, pixResult = S_OK;
+  DxcThreadMalloc TM(nullptr);
+  std::call_once(hlslOnce,
+                 []() { hlslResult = hlsl::SetupRegistryPassForHLSL(); });
+  if (FAILED(hlslResult) || !includePIX)
+    return hlslResult;
+  std::call_once(pixOnce,
+                 []() { pixResult = hlsl::SetupRegistryPassForPIX(); });
+  return pixResult;
 }
 
 HRESULT CreateDxcContainerReflection(_In_ REFIID riid, _Out_ LPVOID *ppv) {
@@ -81,7 +102,9 @@ static HRESULT ThreadMallocDxcCreateInstance(
   HRESULT hr = S_OK;
   *ppv = nullptr;
   if (IsEqualCLSID(rclsid, CLSID_DxcCompiler)) {
-    hr = CreateDxcCompiler(riid, ppv);
+    hr = EnsurePassesRegistered(false);
+    if (SUCCEEDED(hr))
+      hr = CreateDxcCompiler(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcCompilerArgs)) {
     hr = CreateDxcCompilerArgs(riid, ppv);
@@ -100,11 +123,16 @@ static HRESULT ThreadMallocDxcCreateInstance(
     hr = CreateDxcAssembler(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcOptimizer)) {
-    hr = CreateDxcOptimizer(riid, ppv);
+    hr = EnsurePassesRegistered(true);
+    if (SUCCEEDED(hr))
+      hr = CreateDxcOptimizer(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcIntelliSense)) {
     hr = CreateDxcIntelliSense(riid, ppv);
   }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcIncludeCache)) {
+    hr = CreateDxcIncludeCache(riid, ppv);
+  }
 // Note: The following targets are not yet enabled for non-Windows platforms.
 #ifdef _WIN32
   else if (IsEqualCLSID(rclsid, CLSID_DxcRewriter)) {
@@ -117,7 +145,9 @@ static HRESULT ThreadMallocDxcCreateInstance(
     hr = CreateDxcContainerReflection(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcLinker)) {
-    hr = CreateDxcLinker(riid, ppv);
+    hr = EnsurePassesRegistered(false);
+    if (SUCCEEDED(hr))
+      hr = CreateDxcLinker(riid, ppv);
   }
   else if (IsEqualCLSID(rclsid, CLSID_DxcContainerBuilder)) {
     hr = CreateDxcContainerBuilder(riid, ppv);
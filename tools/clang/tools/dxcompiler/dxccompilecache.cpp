@@ -0,0 +1,368 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a persistent, content-addressed cache of compile results.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/dxcfilesystem.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "dxccompilecache.h"
+#include "dxcutil.h"
+
+#include <algorithm>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Entry layout, all integers little-endian uint32:
+//   magic, version, include count, output count, primary output kind
+//   includes: name (UTF-8), MD5 digest of UTF-8 contents
+//   outputs:  kind, code page (0 for binary), name (UTF-8), data
+// Variable-length fields are prefixed with their size.
+const uint32_t kEntryMagic = DXC_FOURCC('D', 'X', 'C', 'C');
+const uint32_t kEntryVersion = 1;
+const char kEntryExtension[] = ".dxcc";
+
+void WriteU32(std::string &Out, uint32_t Value) {
+  Out.append((const char *)&Value, sizeof(Value));
+}
+
+void WriteBytes(std::string &Out, StringRef Bytes) {
+  WriteU32(Out, Bytes.size());
+  Out.append(Bytes.data(), Bytes.size());
+}
+
+class EntryReader {
+  const char *m_pCur;
+  const char *m_pEnd;
+public:
+  EntryReader(StringRef Data) : m_pCur(Data.begin()), m_pEnd(Data.end()) {}
+  bool ReadU32(uint32_t &Value) {
+    if ((size_t)(m_pEnd - m_pCur) < sizeof(Value))
+      return false;
+    memcpy(&Value, m_pCur, sizeof(Value));
+    m_pCur += sizeof(Value);
+    return true;
+  }
+  bool ReadBytes(StringRef &Bytes) {
+    uint32_t Size;
+    if (!ReadU32(Size) || (size_t)(m_pEnd - m_pCur) < Size)
+      return false;
+    Bytes = StringRef(m_pCur, Size);
+    m_pCur += Size;
+    return true;
+  }
+  bool AtEnd() const { return m_pCur == m_pEnd; }
+};
+
+struct CachedOutput {
+  uint32_t Kind;
+  uint32_t CodePage;
+  StringRef Name;
+  StringRef Data;
+};
+
+void HashContents(IDxcBlobUtf8 *pBlob, MD5::MD5Result &Result) {
+  MD5 Hash;
+  Hash.update(StringRef(pBlob->GetStringPointer(), pBlob->GetStringLength()));
+  Hash.final(Result);
+}
+
+std::string GetEntryPath(StringRef Directory, const MD5::MD5Result &Key) {
+  SmallString<32> Hex;
+  MD5::stringifyResult(const_cast<MD5::MD5Result &>(Key), Hex);
+  SmallString<256> Path(Directory);
+  sys::path::append(Path, Twine(Hex) + kEntryExtension);
+  return Path.str();
+}
+
+struct EntryInfo {
+  std::string Path;
+  uint64_t Size;
+  sys::TimeValue ModTime;
+};
+
+std::error_code EnumerateEntries(StringRef Directory,
+                                 std::vector<EntryInfo> &Entries) {
+  std::error_code EC;
+  for (sys::fs::directory_iterator It(Directory, EC), End; !EC && It != End;
+       It.increment(EC)) {
+    if (sys::path::extension(It->path()) != kEntryExtension)
+      continue;
+    sys::fs::file_status Status;
+    if (It->status(Status))
+      continue;
+    Entries.push_back({It->path(), Status.getSize(),
+                       Status.getLastModificationTime()});
+  }
+  return EC;
+}
+
+} // namespace
+
+namespace dxcutil {
+
+void DxcCompileCacheKey::Update(StringRef Str) {
+  Update((uint32_t)Str.size());
+  m_Hash.update(Str);
+}
+
+void DxcCompileCacheKey::Update(uint32_t Value) {
+  m_Hash.update(ArrayRef<uint8_t>((const uint8_t *)&Value, sizeof(Value)));
+}
+
+void DxcCompileCacheKey::Final(MD5::MD5Result &Result) {
+  m_Hash.final(Result);
+}
+
+HRESULT DxcCompileCache::SetDirectory(_In_opt_z_ LPCWSTR pDirectory) {
+  std::string Directory;
+  if (pDirectory && *pDirectory &&
+      !Unicode::UTF16ToUTF8String(pDirectory, &Directory))
+    return E_INVALIDARG;
+  m_Directory = std::move(Directory);
+  return S_OK;
+}
+
+HRESULT DxcCompileCache::Clear() {
+  m_Hits = 0;
+  m_Misses = 0;
+  if (m_Directory.empty())
+    return S_OK;
+  DiskFileSystemScope DiskScope;
+  if (!DiskScope.Init())
+    return E_FAIL;
+  std::vector<EntryInfo> Entries;
+  std::error_code EC = EnumerateEntries(m_Directory, Entries);
+  if (EC && EC != std::errc::no_such_file_or_directory)
+    return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+  for (const EntryInfo &Entry : Entries)
+    sys::fs::remove(Entry.Path);
+  return S_OK;
+}
+
+bool DxcCompileCache::Lookup(StringRef Directory, const MD5::MD5Result &Key,
+                             _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                             _In_ DxcResult *pResult) {
+  std::unique_ptr<MemoryBuffer> pEntry;
+  {
+    DiskFileSystemScope DiskScope;
+    if (DiskScope.Init()) {
+      ErrorOr<std::unique_ptr<MemoryBuffer>> EntryOrErr =
+          MemoryBuffer::getFile(GetEntryPath(Directory, Key), -1, false);
+      if (EntryOrErr)
+        pEntry = std::move(EntryOrErr.get());
+    }
+  }
+  if (!pEntry) {
+    ++m_Misses;
+    return false;
+  }
+
+  EntryReader Reader(pEntry->getBuffer());
+  uint32_t Magic, Version, IncludeCount, OutputCount, PrimaryKind;
+  if (!Reader.ReadU32(Magic) || Magic != kEntryMagic ||
+      !Reader.ReadU32(Version) || Version != kEntryVersion ||
+      !Reader.ReadU32(IncludeCount) || !Reader.ReadU32(OutputCount) ||
+      !Reader.ReadU32(PrimaryKind) || PrimaryKind > kNumDxcOutputTypes) {
+    ++m_Misses;
+    return false;
+  }
+
+  // Every file pulled in by the original compile must still load with the
+  // same contents; anything else could have changed the outputs.
+  for (uint32_t i = 0; i < IncludeCount; ++i) {
+    StringRef Name, Digest;
+    if (!Reader.ReadBytes(Name) || !Reader.ReadBytes(Digest) ||
+        Digest.size() != sizeof(MD5::MD5Result) || !pIncludeHandler) {
+      ++m_Misses;
+      return false;
+    }
+    std::wstring NameW;
+    CComPtr<IDxcBlob> pBlob;
+    CComPtr<IDxcBlobUtf8> pBlobUtf8;
+    MD5::MD5Result Actual;
+    if (!Unicode::UTF8ToUTF16String(Name.str().c_str(), &NameW) ||
+        FAILED(pIncludeHandler->LoadSource(NameW.c_str(), &pBlob)) ||
+        !pBlob ||
+        FAILED(DxcGetBlobAsUtf8(pBlob, DxcGetThreadMallocNoRef(),
+                                &pBlobUtf8))) {
+      ++m_Misses;
+      return false;
+    }
+    HashContents(pBlobUtf8, Actual);
+    if (memcmp(Actual, Digest.data(), sizeof(Actual)) != 0) {
+      ++m_Misses;
+      return false;
+    }
+  }
+
+  std::vector<CachedOutput> Outputs(OutputCount);
+  for (CachedOutput &Output : Outputs) {
+    if (!Reader.ReadU32(Output.Kind) || Output.Kind == DXC_OUT_NONE ||
+        Output.Kind > kNumDxcOutputTypes || !Reader.ReadU32(Output.CodePage) ||
+        !Reader.ReadBytes(Output.Name) || !Reader.ReadBytes(Output.Data)) {
+      ++m_Misses;
+      return false;
+    }
+  }
+  if (!Reader.AtEnd()) {
+    ++m_Misses;
+    return false;
+  }
+
+  for (const CachedOutput &Output : Outputs) {
+    DXC_OUT_KIND Kind = (DXC_OUT_KIND)Output.Kind;
+    CComPtr<IDxcBlob> pBlob;
+    if (Output.CodePage) {
+      CComPtr<IDxcBlobEncoding> pText;
+      IFT(DxcCreateBlobWithEncodingOnHeapCopy(Output.Data.data(),
+                                              Output.Data.size(),
+                                              Output.CodePage, &pText));
+      pBlob = pText;
+    } else {
+      IFT(DxcCreateBlobOnHeapCopy(Output.Data.data(), Output.Data.size(),
+                                  &pBlob));
+    }
+    IFT(pResult->SetOutputObject(Kind, pBlob));
+    if (!Output.Name.empty())
+      IFT(pResult->SetOutputName(Kind, Output.Name));
+  }
+  IFT(pResult->SetStatusAndPrimaryResult(S_OK, (DXC_OUT_KIND)PrimaryKind));
+  ++m_Hits;
+  return true;
+}
+
+void DxcCompileCache::Store(StringRef Directory, const MD5::MD5Result &Key,
+                            _In_ DxcArgsFileSystem *pFileSystem,
+                            _In_ IDxcResult *pResult) {
+  std::string Includes;
+  unsigned IncludeCount = pFileSystem->GetIncludedFileCount();
+  for (unsigned i = 0; i < IncludeCount; ++i) {
+    LPCWSTR pName;
+    CComPtr<IDxcBlobUtf8> pBlob;
+    pFileSystem->GetIncludedFile(i, &pName, &pBlob);
+    std::string Name;
+    if (!Unicode::UTF16ToUTF8String(pName, &Name))
+      return;
+    MD5::MD5Result Digest;
+    HashContents(pBlob, Digest);
+    WriteBytes(Includes, Name);
+    WriteBytes(Includes, StringRef((const char *)Digest, sizeof(Digest)));
+  }
+
+  std::string Outputs;
+  unsigned OutputCount = 0;
+  for (unsigned i = DXC_OUT_NONE + 1; i <= kNumDxcOutputTypes; ++i) {
+    DXC_OUT_KIND Kind = (DXC_OUT_KIND)i;
+    if (!pResult->HasOutput(Kind))
+      continue;
+    // Outputs that are not plain blobs cannot be persisted, so neither can
+    // the result as a whole.
+    CComPtr<IDxcBlob> pBlob;
+    CComPtr<IDxcBlobUtf16> pName;
+    if (FAILED(pResult->GetOutput(Kind, IID_PPV_ARGS(&pBlob), &pName)))
+      return;
+    UINT32 CodePage = 0;
+    if (DxcGetOutputType(Kind) == DxcOutputType_Text) {
+      CComPtr<IDxcBlobEncoding> pText;
+      BOOL Known = FALSE;
+      if (FAILED(pBlob.QueryInterface(&pText)) ||
+          FAILED(pText->GetEncoding(&Known, &CodePage)) || !Known)
+        return;
+    }
+    std::string Name;
+    if (pName && !Unicode::UTF16ToUTF8String(pName->GetStringPointer(),
+                                             pName->GetStringLength(), &Name))
+      return;
+    WriteU32(Outputs, Kind);
+    WriteU32(Outputs, CodePage);
+    WriteBytes(Outputs, Name);
+    WriteBytes(Outputs, StringRef((const char *)pBlob->GetBufferPointer(),
+                                  pBlob->GetBufferSize()));
+    ++OutputCount;
+  }
+
+  std::string Entry;
+  WriteU32(Entry, kEntryMagic);
+  WriteU32(Entry, kEntryVersion);
+  WriteU32(Entry, IncludeCount);
+  WriteU32(Entry, OutputCount);
+  WriteU32(Entry, pResult->PrimaryOutput());
+  Entry += Includes;
+  Entry += Outputs;
+
+  DiskFileSystemScope DiskScope;
+  if (!DiskScope.Init() || sys::fs::create_directories(Directory))
+    return;
+
+  // Write under a unique name and rename into place, so concurrent compiles
+  // never observe a partially written entry.
+  int FD;
+  SmallString<256> TempPath;
+  SmallString<256> Model(Directory);
+  sys::path::append(Model, "%%%%%%%%%%%%.tmp");
+  if (sys::fs::createUniqueFile(Model, FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose*/ true);
+    OS << Entry;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, GetEntryPath(Directory, Key))) {
+    sys::fs::remove(TempPath);
+    return;
+  }
+
+  EvictIfNeeded(Directory);
+}
+
+void DxcCompileCache::EvictIfNeeded(StringRef Directory) {
+  if (m_MaxEntries == 0 && m_MaxSizeInBytes == 0)
+    return;
+  std::vector<EntryInfo> Entries;
+  if (EnumerateEntries(Directory, Entries))
+    return;
+  uint64_t TotalSize = 0;
+  for (const EntryInfo &Entry : Entries)
+    TotalSize += Entry.Size;
+
+  std::sort(Entries.begin(), Entries.end(),
+            [](const EntryInfo &A, const EntryInfo &B) {
+              return A.ModTime < B.ModTime;
+            });
+  size_t Count = Entries.size();
+  for (const EntryInfo &Entry : Entries) {
+    bool OverCount = m_MaxEntries != 0 && Count > m_MaxEntries;
+    bool OverSize = m_MaxSizeInBytes != 0 && TotalSize > m_MaxSizeInBytes;
+    if (!OverCount && !OverSize)
+      break;
+    if (sys::fs::remove(Entry.Path))
+      continue;
+    --Count;
+    TotalSize -= Entry.Size;
+  }
+}
+
+} // namespace dxcutil
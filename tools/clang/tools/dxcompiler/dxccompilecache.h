@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a persistent, content-addressed cache of compile results.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+class DxcResult;
+
+namespace dxcutil {
+
+class DxcArgsFileSystem;
+
+// Computes the lookup key for a compile request. Anything that can change
+// the outputs of a compile, other than the contents of included files,
+// must be fed into the key.
+class DxcCompileCacheKey {
+  llvm::MD5 m_Hash;
+public:
+  void Update(llvm::StringRef Str);
+  void Update(uint32_t Value);
+  void Final(llvm::MD5::MD5Result &Result);
+};
+
+// A directory of cache entries, each named after the hex digest of its key.
+// An entry records the digests of the files that were included while
+// compiling, so a hit is only reported when the include handler still
+// produces the same contents for each of them.
+//
+// Lookups and stores never fail the compile; I/O errors degrade to misses.
+class DxcCompileCache {
+private:
+  std::string m_Directory; // UTF-8; empty when disabled
+  UINT32 m_MaxEntries = 0;
+  UINT64 m_MaxSizeInBytes = 0;
+  std::atomic<UINT32> m_Hits;
+  std::atomic<UINT32> m_Misses;
+
+  void EvictIfNeeded(llvm::StringRef Directory);
+
+public:
+  DxcCompileCache() : m_Hits(0), m_Misses(0) {}
+
+  HRESULT SetDirectory(_In_opt_z_ LPCWSTR pDirectory);
+  void SetEvictionPolicy(UINT32 MaxEntries, UINT64 MaxSizeInBytes) {
+    m_MaxEntries = MaxEntries;
+    m_MaxSizeInBytes = MaxSizeInBytes;
+  }
+  llvm::StringRef GetDirectory() const { return m_Directory; }
+  HRESULT Clear();
+  void GetStatistics(UINT32 *pHits, UINT32 *pMisses) const {
+    *pHits = m_Hits;
+    *pMisses = m_Misses;
+  }
+
+  // Returns true and fills pResult if a matching entry was found in
+  // Directory. pResult should be freshly allocated.
+  bool Lookup(llvm::StringRef Directory, const llvm::MD5::MD5Result &Key,
+              _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+              _In_ DxcResult *pResult);
+
+  // Records the outputs of a successful compile, along with the files that
+  // were loaded through pFileSystem.
+  void Store(llvm::StringRef Directory, const llvm::MD5::MD5Result &Key,
+             _In_ DxcArgsFileSystem *pFileSystem, _In_ IDxcResult *pResult);
+};
+
+} // namespace dxcutil
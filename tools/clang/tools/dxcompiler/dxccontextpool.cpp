@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccontextpool.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Keeps LLVM contexts of finished compiles for reuse.                       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "llvm/IR/LLVMContext.h"
+#include "dxccontextpool.h"
+
+using namespace dxcutil;
+
+namespace {
+// Compiles a context serves before it is retired.
+const unsigned kMaxUsesPerContext = 64;
+// Idle contexts kept; more than this were only needed for a burst of
+// concurrent compiles.
+const size_t kMaxIdleContexts = 16;
+} // namespace
+
+DxcContextPool::Lease::Lease(DxcContextPool *pPool, IMalloc *pMalloc)
+    : m_pPool(pPool) {
+  if (m_pPool != nullptr && DxcGetThreadMallocNoRef() != pMalloc)
+    m_pPool = nullptr;
+  if (m_pPool != nullptr) {
+    std::lock_guard<std::mutex> lock(m_pPool->m_Mutex);
+    if (!m_pPool->m_Idle.empty()) {
+      m_Entry = std::move(m_pPool->m_Idle.back());
+      m_pPool->m_Idle.pop_back();
+    }
+  }
+  if (!m_Entry.Context)
+    m_Entry.Context.reset(new llvm::LLVMContext());
+  ++m_Entry.Uses;
+}
+
+DxcContextPool::Lease::~Lease() {
+  if (m_pPool == nullptr || !m_bReusable ||
+      m_Entry.Uses >= kMaxUsesPerContext ||
+      !m_Entry.Context->resetForReuse())
+    return;
+  std::lock_guard<std::mutex> lock(m_pPool->m_Mutex);
+  if (m_pPool->m_Idle.size() < kMaxIdleContexts)
+    m_pPool->m_Idle.emplace_back(std::move(m_Entry));
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccontextpool.h                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Keeps LLVM contexts of finished compiles for reuse.                       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/WinIncludes.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+class LLVMContext;
+}
+
+namespace dxcutil {
+
+// Idle LLVM contexts of a compiler object, so small compiles don't each pay
+// for setting one up. A context is only ever used by one compile at a time,
+// whichever thread it runs on, and goes back to the pool when that compile
+// succeeded and left no module behind.
+//
+// Constants and metadata stay uniqued in a context after their module is
+// gone, so a context is retired after a number of compiles to bound its
+// growth. Contexts are only pooled for compiles that allocate from the
+// compiler's own allocator, not from an arena or a budget, since their
+// memory outlives the compile.
+class DxcContextPool {
+public:
+  DxcContextPool() {}
+
+  class Lease;
+
+private:
+  struct Entry {
+    std::unique_ptr<llvm::LLVMContext> Context;
+    unsigned Uses = 0;
+  };
+  std::mutex m_Mutex;
+  std::vector<Entry> m_Idle;
+
+  DxcContextPool(const DxcContextPool &) = delete;
+  void operator=(const DxcContextPool &) = delete;
+};
+
+// The context of one compile. Taken from the pool when pPool is given and
+// the current thread allocator is pMalloc; otherwise a new context used only
+// by this compile.
+class DxcContextPool::Lease {
+public:
+  Lease(DxcContextPool *pPool, IMalloc *pMalloc);
+  ~Lease();
+
+  llvm::LLVMContext &get() { return *m_Entry.Context; }
+
+  // Lets the context go back to the pool once the compile is done with it.
+  void SetReusable() { m_bReusable = true; }
+
+private:
+  DxcContextPool *m_pPool;
+  Entry m_Entry;
+  bool m_bReusable = false;
+
+  Lease(const Lease &) = delete;
+  void operator=(const Lease &) = delete;
+};
+
+} // namespace dxcutil
@@ -26,6 +26,8 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
 #include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Format.h"
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
@@ -33,6 +35,7 @@
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
 #include "dxc/HLSL/ComputeViewIdState.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/DXIL/DxilUtil.h"
 #include "dxcutil.h"
@@ -55,7 +58,7 @@ bool SigElementHasStream(const DxilProgramSignatureElement &pSignature) {
 }
 
 void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
-                           bool bIsInput, raw_string_ostream &OS,
+                           bool bIsInput, raw_ostream &OS,
                            StringRef comment) {
   OS << comment << "\n"
      << comment << " " << pName << " signature:\n"
@@ -269,7 +272,7 @@ void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
   OS << comment << "\n";
 }
 
-void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
+void PintCompMaskNameCompact(raw_ostream &OS, unsigned CompMask) {
   char Mask[5];
   memset(Mask, '\0', sizeof(Mask));
   unsigned idx = 0;
@@ -285,7 +288,7 @@ void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
 }
 
 void PrintDxilSignature(LPCSTR pName, const DxilSignature &Signature,
-                               raw_string_ostream &OS, StringRef comment) {
+                               raw_ostream &OS, StringRef comment) {
   const std::vector<std::unique_ptr<DxilSignatureElement>> &sigElts =
       Signature.GetElements();
   if (sigElts.size() == 0)
@@ -351,7 +354,7 @@ PCSTR g_pFeatureInfoNames[] = {
 static_assert(_countof(g_pFeatureInfoNames) == ShaderFeatureInfoCount, "g_pFeatureInfoNames needs to be updated");
 
 void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
-                             raw_string_ostream &OS, StringRef comment) {
+                             raw_ostream &OS, StringRef comment) {
   uint64_t featureFlags = pFeatureInfo->FeatureFlags;
   if (!featureFlags)
     return;
@@ -365,7 +368,7 @@ void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
 }
 
 void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
-                                raw_string_ostream &OS) {
+                                raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -394,7 +397,7 @@ void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
 }
 
 void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
-                             raw_string_ostream &OS) {
+                             raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -436,7 +439,7 @@ void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
   }
 }
 
-void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
+void PrintResourceBinding(DxilResourceBase &res, raw_ostream &OS,
                                  StringRef comment) {
   OS << comment << " " << left_justify(res.GetGlobalName(), 31);
 
@@ -462,7 +465,7 @@ void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
     OS << right_justify("unbounded", 6) << "\n";
 }
 
-void PrintResourceBindings(DxilModule &M, raw_string_ostream &OS,
+void PrintResourceBindings(DxilModule &M, raw_ostream &OS,
                                   StringRef comment) {
   OS << comment << "\n"
      << comment << " Resource Bindings:\n"
@@ -529,7 +532,7 @@ void PrintInputsContributingToOutputs(
   }
 }
 
-void PrintViewIdState(DxilModule &M, raw_string_ostream &OS,
+void PrintViewIdState(DxilModule &M, raw_ostream &OS,
                              StringRef comment) {
   if (!M.GetModule()->getNamedMetadata("dx.viewIdState"))
     return;
@@ -657,7 +660,7 @@ static const char *HitGroupTypeToString(DXIL::HitGroupType type) {
 }
 
 template <typename _T>
-void PrintFlags(raw_string_ostream &OS, uint32_t Flags) {
+void PrintFlags(raw_ostream &OS, uint32_t Flags) {
   if (!Flags) {
     OS << "0";
     return;
@@ -673,7 +676,7 @@ void PrintFlags(raw_string_ostream &OS, uint32_t Flags) {
 }
 
 void PrintSubobjects(const DxilSubobjects &subobjects,
-                     raw_string_ostream &OS,
+                     raw_ostream &OS,
                      StringRef comment) {
   if (subobjects.GetSubobjects().empty())
     return;
@@ -790,7 +793,7 @@ void PrintSubobjects(const DxilSubobjects &subobjects,
 }
 
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout *DL,
-                       raw_string_ostream &OS, StringRef comment,
+                       raw_ostream &OS, StringRef comment,
                        StringRef varName, unsigned offset,
                        unsigned indent, unsigned arraySize,
                        unsigned sizeOfStruct = 0);
@@ -830,7 +833,7 @@ void PrintTypeAndName(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 
 void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
                       DxilTypeSystem &typeSys, const DataLayout* DL,
-                      raw_string_ostream &OS,
+                      raw_ostream &OS,
                       StringRef comment, unsigned offset,
                       unsigned indent, unsigned offsetIndent,
                       unsigned sizeToPrint = 0) {
@@ -900,7 +903,7 @@ void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 
 // null DataLayout => assume constant buffer layout
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout *DL,
-                       raw_string_ostream &OS, StringRef comment,
+                       raw_ostream &OS, StringRef comment,
                        StringRef varName, unsigned offset,
                        unsigned indent, unsigned offsetIndent,
                        unsigned sizeOfStruct) {
@@ -948,7 +951,7 @@ void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys, const DataLayout
 void PrintStructBufferDefinition(DxilResource *buf,
                                         DxilTypeSystem &typeSys,
                                         const DataLayout &DL,
-                                        raw_string_ostream &OS,
+                                        raw_ostream &OS,
                                         StringRef comment) {
   const unsigned offsetIndent = 50;
 
@@ -995,7 +998,7 @@ void PrintStructBufferDefinition(DxilResource *buf,
 }
 
 void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
-                                   raw_string_ostream &OS, StringRef comment) {
+                                   raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   llvm::Type *Ty = buf->GetHLSLType()->getPointerElementType();
   // For TextureBuffer<> buf[2], the array size is in Resource binding count
@@ -1021,7 +1024,7 @@ void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
 }
 
 void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
-                                   raw_string_ostream &OS, StringRef comment) {
+                                   raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   llvm::Type *Ty = buf->GetHLSLType()->getPointerElementType();
   // For ConstantBuffer<> buf[2], the array size is in Resource binding count
@@ -1047,7 +1050,7 @@ void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
   OS << comment << "\n";
 }
 
-void PrintBufferDefinitions(DxilModule &M, raw_string_ostream &OS,
+void PrintBufferDefinitions(DxilModule &M, raw_ostream &OS,
                                    StringRef comment) {
   OS << comment << "\n"
      << comment << " Buffer Definitions:\n"
@@ -1426,9 +1429,59 @@ void PrintResourceProperties(DxilResourceProperties &RP,
   }
 }
 
+// Returns the index operand of a handle creation with a dynamic index.
+Value *GetDynamicHandleIndex(const CallInst *CI) {
+  if (!CI || !hlsl::OP::IsDxilOpFuncCallInst(CI))
+    return nullptr;
+  Value *Index = nullptr;
+  switch (hlsl::OP::GetDxilOpFuncCallInst(CI)) {
+  case DXIL::OpCode::CreateHandle:
+    Index = CI->getArgOperand(DxilInst_CreateHandle::arg_index);
+    break;
+  case DXIL::OpCode::CreateHandleFromBinding:
+    Index = CI->getArgOperand(DxilInst_CreateHandleFromBinding::arg_index);
+    break;
+  case DXIL::OpCode::CreateHandleFromHeap:
+    Index = CI->getArgOperand(DxilInst_CreateHandleFromHeap::arg_index);
+    break;
+  default:
+    break;
+  }
+  return Index && !isa<Constant>(Index) ? Index : nullptr;
+}
+
 class DxcAssemblyAnnotationWriter : public llvm::AssemblyAnnotationWriter {
+  // Uniformity of dynamic resource indices in the function being printed.
+  std::unique_ptr<DominatorTree> m_pDT;
+  std::unique_ptr<PostDominatorTree> m_pPDT;
+  std::unique_ptr<DxilUniformityAnalysis> m_pUniformity;
+
 public:
   ~DxcAssemblyAnnotationWriter() {}
+  void emitFunctionAnnot(const Function *F,
+                         formatted_raw_ostream &OS) override {
+    m_pUniformity.reset();
+    if (F->isDeclaration())
+      return;
+    bool HasDynamicIndex = false;
+    for (const BasicBlock &BB : *F) {
+      for (const Instruction &I : BB) {
+        if (GetDynamicHandleIndex(dyn_cast<CallInst>(&I))) {
+          HasDynamicIndex = true;
+          break;
+        }
+      }
+    }
+    if (!HasDynamicIndex)
+      return;
+    Function &MF = const_cast<Function &>(*F);
+    m_pDT.reset(new DominatorTree());
+    m_pDT->recalculate(MF);
+    m_pPDT.reset(new PostDominatorTree());
+    m_pPDT->runOnFunction(MF);
+    m_pUniformity.reset(DxilUniformityAnalysis::create(*m_pDT, *m_pPDT));
+    m_pUniformity->Analyze(&MF);
+  }
   void printInfoComment(const Value &V, formatted_raw_ostream &OS) override {
     if (const Instruction *I = dyn_cast<Instruction>(&V)) {
       if (isa<DbgInfoIntrinsic>(I)) {
@@ -1491,6 +1544,15 @@ public:
         PrintResourceProperties(RP, OS);
       }
     } break;
+    case DXIL::OpCode::CreateHandle:
+    case DXIL::OpCode::CreateHandleFromBinding:
+    case DXIL::OpCode::CreateHandleFromHeap: {
+      // Show whether a dynamic index is uniform across the wave.
+      Value *Index = GetDynamicHandleIndex(CI);
+      if (Index && m_pUniformity)
+        OS << (m_pUniformity->IsUniform(Index) ? " ; uniform index"
+                                                : " ; divergent index");
+    } break;
     default:
       break;
     }
@@ -1499,7 +1561,7 @@ public:
 
 void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
                                                     DXIL::ShaderKind shaderKind,
-                                                    raw_string_ostream &OS,
+                                                    raw_ostream &OS,
                                                     StringRef comment) {
   OS << comment << "\n"
      << comment << " Pipeline Runtime Information: \n"
@@ -1738,7 +1800,12 @@ void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
 
 namespace dxcutil {
 
-HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
+HRESULT Disassemble(IDxcBlob *pProgram, raw_ostream &OutStream,
+                    unsigned Threads, StringRef FunctionName) {
+  // A single function is printed without the comment sections before it.
+  raw_null_ostream NullStream;
+  raw_ostream &Stream = FunctionName.empty() ? OutStream : NullStream;
+
   CComPtr<IDxcBlob> pPdbContainerBlob;
   {
     CComPtr<IStream> pStream;
@@ -1753,6 +1820,8 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
   const char *pReflectionIL = nullptr;
   uint32_t pReflectionILLength = 0;
   const DxilPartHeader *pRDATPart = nullptr;
+  // The program part, if the container holds its bitcode compressed.
+  std::vector<uint32_t> ExpandedProgram;
   if (const DxilContainerHeader *pContainer =
           IsDxilContainerLike(pIL, pILLength)) {
     if (!IsValidDxilContainer(pContainer, pILLength)) {
@@ -1830,9 +1899,10 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
       return DXC_E_CONTAINER_MISSING_DXIL;
     }
 
-    const DxilProgramHeader *pProgramHeader =
-        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(*it));
-    if (!IsValidDxilProgramHeader(pProgramHeader, (*it)->PartSize)) {
+    const DxilProgramHeader *pProgramHeader = GetValidDxilProgramHeader(
+        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(*it)),
+        (*it)->PartSize, ExpandedProgram);
+    if (!pProgramHeader) {
       return DXC_E_CONTAINER_INVALID;
     }
 
@@ -1890,7 +1960,7 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
     }
   }
 
-  if (pModule->getNamedMetadata("dx.version")) {
+  if (FunctionName.empty() && pModule->getNamedMetadata("dx.version")) {
     DxilModule &dxilModule = pModule->GetOrCreateDxilModule();
     DxilModule &dxilReflectionModule = pReflectionModule.get()
       ? pReflectionModule->GetOrCreateDxilModule()
@@ -1933,12 +2003,20 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
     }
   }
   DxcAssemblyAnnotationWriter w;
-  pModule->print(Stream, &w);
+  if (!FunctionName.empty()) {
+    Function *F = pModule->getFunction(FunctionName);
+    if (F == nullptr)
+      return E_INVALIDARG;
+    F->printAsInModule(OutStream, &w);
+    OutStream.flush();
+    return S_OK;
+  }
+  pModule->print(OutStream, &w, /*ShouldPreserveUseListOrder*/ false, Threads);
   //if (pReflectionModule) {
   //  Stream << "\n========== Reflection Module from STAT part ==========\n";
   //  pReflectionModule->print(Stream, &w);
   //}
-  Stream.flush();
+  OutStream.flush();
   return S_OK;
 }
 }
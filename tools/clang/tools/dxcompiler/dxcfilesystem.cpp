@@ -14,6 +14,8 @@
 #include "dxc/Support/Global.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/dxcapi.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Support/raw_ostream.h"
 #include "dxcutil.h"
 
@@ -25,6 +27,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #endif
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
 using namespace llvm;
 using namespace hlsl;
@@ -81,9 +86,11 @@ enum class SpecialValue {
   Source = 3,
   Output = 4
 };
+// Offset holds up to MaxIncludedFiles indices and must not wrap: clang
+// identifies a file by its handle, so two files sharing one would be merged.
 struct HandleBits {
-  unsigned Offset : 8;
-  unsigned Length : 8;
+  unsigned Offset : 16;
+  unsigned Length : 12;
   unsigned Kind : 4;
 };
 struct DxcArgsHandle {
@@ -180,6 +187,217 @@ bool IsAbsoluteOrCurDirRelativeW(LPCWSTR Path) {
   return FALSE;
 }
 
+static bool IsPathSeparatorW(wchar_t C) { return C == L'/' || C == L'\\'; }
+
+/// Returns the key that identifies an included file: separators become '/',
+/// and empty and '.' components are dropped, as are '..' components together
+/// with the component before them. Different spellings of one path then open
+/// the same file, whose handle clang uses as its identity, so include guards
+/// and #pragma once recorded for it apply to every spelling.
+std::wstring NormalizeIncludePathW(LPCWSTR Path) {
+  std::wstring Result;
+  const wchar_t *P = Path;
+  if (IsPathSeparatorW(P[0]) && IsPathSeparatorW(P[1])) {
+    Result = L"//"; // UNC name
+    P += 2;
+  } else if (P[0] && P[1] == L':') {
+    Result.assign(P, 2); // Disk designator
+    P += 2;
+  }
+  bool Rooted = !Result.empty() || IsPathSeparatorW(P[0]);
+  if (IsPathSeparatorW(P[0]))
+    Result += L'/';
+  size_t RootLength = Result.size();
+
+  // Each kept component is written out followed by a separator; the last
+  // separator is dropped at the end.
+  SmallVector<size_t, 16> ComponentStarts;
+  while (*P) {
+    const wchar_t *Start = P;
+    while (*P && !IsPathSeparatorW(*P))
+      ++P;
+    size_t Length = P - Start;
+    if (*P)
+      ++P;
+    if (Length == 0 || (Length == 1 && Start[0] == L'.'))
+      continue;
+    if (Length == 2 && Start[0] == L'.' && Start[1] == L'.') {
+      if (!ComponentStarts.empty() &&
+          Result.compare(ComponentStarts.back(), 3, L"../") != 0) {
+        Result.resize(ComponentStarts.pop_back_val());
+        continue;
+      }
+      if (Rooted)
+        continue; // The root is its own parent.
+    }
+    ComponentStarts.push_back(Result.size());
+    Result.append(Start, Length);
+    Result += L'/';
+  }
+  if (Result.size() > RootLength)
+    Result.pop_back();
+  return Result;
+}
+
+}
+
+/// Process-wide cache of decoded include files, shared by concurrent
+/// compilations. Entries are keyed by the path handed to the include handler
+/// and hold an xxHash64 of the bytes it returned, so validating lookups can
+/// skip decoding unchanged files. Cached blobs are never modified.
+class DxcSharedIncludeCache {
+private:
+  struct Entry {
+    CComPtr<IDxcBlobUtf8> Blob;
+    uint64_t Digest;
+  };
+  std::mutex m_mutex;
+  std::unordered_map<std::wstring, Entry> m_entries;
+  std::atomic<UINT32> m_mode;
+  std::atomic<UINT32> m_hits;
+  std::atomic<UINT32> m_misses;
+
+  // Only compared within the process, and every include is rehashed on each
+  // validating lookup, so a fast non-cryptographic hash is enough.
+  static uint64_t HashBlob(IDxcBlob *pBlob) {
+    return xxHash64(StringRef((const char *)pBlob->GetBufferPointer(),
+                              pBlob->GetBufferSize()));
+  }
+
+public:
+  DxcSharedIncludeCache()
+      : m_mode(DxcIncludeCacheMode_Disabled), m_hits(0), m_misses(0) {}
+
+  UINT32 GetMode() const { return m_mode; }
+  void SetMode(UINT32 mode) {
+    m_mode = mode;
+    if (mode == DxcIncludeCacheMode_Disabled)
+      Invalidate(nullptr);
+  }
+  void GetStatistics(UINT32 *pHits, UINT32 *pMisses) const {
+    *pHits = m_hits;
+    *pMisses = m_misses;
+  }
+
+  void Invalidate(_In_opt_z_ LPCWSTR pFileName) {
+    // Entries are allocated with the default allocator; see Load.
+    DxcThreadMalloc TM(nullptr);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (pFileName)
+      m_entries.erase(pFileName);
+    else
+      m_entries.clear();
+  }
+
+  HRESULT Load(_In_ IDxcIncludeHandler *pHandler, _In_z_ LPCWSTR pFileName,
+               _COM_Outptr_result_maybenull_ IDxcBlobUtf8 **ppBlob) {
+    *ppBlob = nullptr;
+    UINT32 mode = m_mode;
+    // Entries outlive the compile that created them, so keep them off any
+    // caller-provided allocator.
+    DxcThreadMalloc TM(nullptr);
+    if (mode == DxcIncludeCacheMode_Trust) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_entries.find(pFileName);
+      if (it != m_entries.end()) {
+        ++m_hits;
+        it->second.Blob.CopyTo(ppBlob);
+        return S_OK;
+      }
+    }
+
+    CComPtr<IDxcBlob> pFileBlob;
+    IFR(pHandler->LoadSource(pFileName, &pFileBlob));
+    if (pFileBlob == nullptr)
+      return S_OK;
+    uint64_t Digest = HashBlob(pFileBlob);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_entries.find(pFileName);
+      if (it != m_entries.end() && it->second.Digest == Digest) {
+        ++m_hits;
+        it->second.Blob.CopyTo(ppBlob);
+        return S_OK;
+      }
+    }
+
+    ++m_misses;
+    CComPtr<IDxcBlobUtf8> pFileBlobUtf8;
+    IFR(hlsl::DxcGetBlobAsUtf8(pFileBlob, DxcGetThreadMallocNoRef(),
+                               &pFileBlobUtf8));
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      Entry &entry = m_entries[pFileName];
+      entry.Blob = pFileBlobUtf8;
+      entry.Digest = Digest;
+    }
+    *ppBlob = pFileBlobUtf8.Detach();
+    return S_OK;
+  }
+};
+
+// Released by llvm_shutdown, while the default allocator is installed.
+static ManagedStatic<DxcSharedIncludeCache> g_SharedIncludeCache;
+
+/// Controls the process-wide include cache; every instance shares it.
+class DxcIncludeCache : public IDxcIncludeCache {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcIncludeCache)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeCache>(this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE SetMode(_In_ UINT32 mode) override {
+    if (mode > DxcIncludeCacheMode_Trust)
+      return E_INVALIDARG;
+    try {
+      g_SharedIncludeCache->SetMode(mode);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE Invalidate(_In_z_ LPCWSTR pFileName) override {
+    if (pFileName == nullptr)
+      return E_INVALIDARG;
+    try {
+      // Match the names the argument file system hands to include handlers.
+      std::wstring FileNameStore;
+      dxcutil::MakeAbsoluteOrCurDirRelativeW(pFileName, FileNameStore);
+      g_SharedIncludeCache->Invalidate(pFileName);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE InvalidateAll() override {
+    try {
+      g_SharedIncludeCache->Invalidate(nullptr);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ UINT32 *pHits, _Out_ UINT32 *pMisses) override {
+    if (pHits == nullptr || pMisses == nullptr)
+      return E_INVALIDARG;
+    g_SharedIncludeCache->GetStatistics(pHits, pMisses);
+    return S_OK;
+  }
+};
+
+HRESULT CreateDxcIncludeCache(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  CComPtr<DxcIncludeCache> result = DxcIncludeCache::Alloc(DxcGetThreadMallocNoRef());
+  if (result == nullptr) {
+    *ppv = nullptr;
+    return E_OUTOFMEMORY;
+  }
+  return result.p->QueryInterface(riid, ppv);
 }
 
 namespace dxcutil {
@@ -241,6 +459,9 @@ private:
       : Blob(pBlob), BlobStream(pStream), Name(name) { }
   };
   llvm::SmallVector<IncludedFile, 4> m_includedFiles;
+  // Index in m_includedFiles of each file, by NormalizeIncludePathW of its
+  // name, so the include handler is asked once for each file.
+  std::unordered_map<std::wstring, size_t> m_includedFileIndex;
 
   static bool IsDirOf(LPCWSTR lpDir, size_t dirLen, const std::wstring &fileName) {
     if (fileName.size() <= dirLen) return false;
@@ -277,11 +498,11 @@ private:
     return INVALID_HANDLE_VALUE;
   }
   DWORD TryFindOrOpen(LPCWSTR lpFileName, size_t &index) {
-    for (size_t i = 0; i < m_includedFiles.size(); ++i) {
-      if (0 == wcscmp(lpFileName, m_includedFiles[i].Name.data())) {
-        index = i;
-        return ERROR_SUCCESS;
-      }
+    std::wstring key = NormalizeIncludePathW(lpFileName);
+    auto found = m_includedFileIndex.find(key);
+    if (found != m_includedFileIndex.end()) {
+      index = found->second;
+      return ERROR_SUCCESS;
     }
 
     if (m_includeLoader.p != nullptr) {
@@ -289,22 +510,30 @@ private:
         return ERROR_OUT_OF_STRUCTURES;
       }
 
-      CComPtr<::IDxcBlob> fileBlob;
-      HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
-      if (FAILED(hr)) {
-        return ERROR_UNHANDLED_EXCEPTION;
-      }
-      if (fileBlob.p != nullptr) {
-        CComPtr<IDxcBlobUtf8> fileBlobUtf8;
-        if (FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, DxcGetThreadMallocNoRef(), &fileBlobUtf8))) {
+      CComPtr<IDxcBlobUtf8> fileBlobUtf8;
+      if (g_SharedIncludeCache->GetMode() != DxcIncludeCacheMode_Disabled) {
+        if (FAILED(g_SharedIncludeCache->Load(m_includeLoader, lpFileName, &fileBlobUtf8))) {
+          return ERROR_UNHANDLED_EXCEPTION;
+        }
+      } else {
+        CComPtr<::IDxcBlob> fileBlob;
+        HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
+        if (FAILED(hr)) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
+        if (fileBlob.p != nullptr &&
+            FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, DxcGetThreadMallocNoRef(), &fileBlobUtf8))) {
+          return ERROR_UNHANDLED_EXCEPTION;
+        }
+      }
+      if (fileBlobUtf8.p != nullptr) {
         CComPtr<IStream> fileStream;
         if (FAILED(hlsl::CreateReadOnlyBlobStream(fileBlobUtf8, &fileStream))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
         m_includedFiles.emplace_back(std::wstring(lpFileName), fileBlobUtf8, fileStream);
         index = m_includedFiles.size() - 1;
+        m_includedFileIndex.emplace(std::move(key), index);
 
         if (m_bDisplayIncludeProcess) {
           std::string openFileStr;
@@ -341,6 +570,7 @@ public:
     MakeAbsoluteOrCurDirRelativeW(m_pSourceName, m_pAbsSourceName);
     IFT(CreateReadOnlyBlobStream(m_pSource, &m_pSourceStream));
     m_includedFiles.push_back(IncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream));
+    m_includedFileIndex.emplace(NormalizeIncludePathW(m_pSourceName), 0);
   }
   void EnableDisplayIncludeProcess() override {
     m_bDisplayIncludeProcess = true;
@@ -414,6 +644,19 @@ public:
     return S_OK;
   }
 
+  unsigned GetIncludedFileCount() override {
+    return m_includedFiles.size() - 1;
+  }
+
+  void GetIncludedFile(unsigned index, LPCWSTR *ppName,
+                       IDxcBlobUtf8 **ppBlob) override {
+    DXASSERT_NOMSG(index + 1 < m_includedFiles.size());
+    const IncludedFile &file = m_includedFiles[index + 1];
+    *ppName = file.Name.c_str();
+    file.Blob.p->AddRef();
+    *ppBlob = file.Blob.p;
+  }
+
   ~DxcArgsFileSystemImpl() override { };
   BOOL FindNextFileW(
     _In_   HANDLE hFindFile,
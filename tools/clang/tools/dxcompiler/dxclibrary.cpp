@@ -53,7 +53,7 @@ public:
     ) override {
     try {
       CComPtr<IDxcBlobEncoding> pEncoding;
-      HRESULT hr = ::hlsl::DxcCreateBlobFromFile(m_pMalloc, pFilename, nullptr, &pEncoding);
+      HRESULT hr = ::hlsl::DxcCreateBlobFromFileMapping(m_pMalloc, pFilename, nullptr, &pEncoding);
       if (SUCCEEDED(hr)) {
         *ppIncludeSource = pEncoding.Detach();
       }
@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxclinestats.cpp                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Attributes the generated code of a compile to the source that produced it.//
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include "dxclinestats.h"
+#include "dxcutil.h"
+
+#include <map>
+#include <string>
+#include <tuple>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+struct Cost {
+  unsigned Instructions = 0;
+  std::map<std::string, unsigned> DxilOpClasses;
+
+  void Add(const char *pOpClass) {
+    ++Instructions;
+    if (pOpClass)
+      ++DxilOpClasses[pOpClass];
+  }
+};
+
+// File and line.
+typedef std::pair<std::string, unsigned> LineKey;
+// File, line and column of the call, and the function called.
+typedef std::tuple<std::string, unsigned, unsigned, std::string> CallSiteKey;
+
+struct LineStats {
+  std::map<LineKey, Cost> Lines;
+  std::map<std::string, Cost> Functions;
+  std::map<CallSiteKey, Cost> CallSites;
+  Cost Unknown;
+
+  void Add(const Instruction &I, const char *pOpClass);
+};
+
+StringRef GetScopeFunctionName(const DILocation *DL) {
+  if (DISubprogram *SP = DL->getScope()->getSubprogram())
+    return SP->getName();
+  return StringRef();
+}
+
+void LineStats::Add(const Instruction &I, const char *pOpClass) {
+  const DILocation *DL = I.getDebugLoc().get();
+  if (!DL) {
+    Unknown.Add(pOpClass);
+    StringRef Name = I.getParent()->getParent()->getName();
+    Functions[dxilutil::DemangleFunctionName(Name).str()].Add(pOpClass);
+    return;
+  }
+  Lines[LineKey(DL->getFilename().str(), DL->getLine())].Add(pOpClass);
+  Functions[GetScopeFunctionName(DL).str()].Add(pOpClass);
+  // Each call the instruction was inlined through, innermost first.
+  const DILocation *Callee = DL;
+  while (const DILocation *Call = Callee->getInlinedAt()) {
+    CallSites[CallSiteKey(Call->getFilename().str(), Call->getLine(),
+                          Call->getColumn(),
+                          GetScopeFunctionName(Callee).str())]
+        .Add(pOpClass);
+    Callee = Call;
+  }
+}
+
+void WriteCost(raw_ostream &OS, const Cost &C) {
+  OS << "\"instructions\": " << C.Instructions << ", \"dxil_op_classes\": {";
+  bool First = true;
+  for (const auto &Class : C.DxilOpClasses) {
+    OS << (First ? " \"" : ", \"") << Class.first << "\": " << Class.second;
+    First = false;
+  }
+  OS << (First ? "}" : " }");
+}
+
+} // namespace
+
+namespace dxcutil {
+
+void WriteLineStatsJson(raw_ostream &OS, const Module &M) {
+  LineStats Stats;
+  for (const Function &F : M.functions()) {
+    if (F.isDeclaration())
+      continue;
+    for (const BasicBlock &BB : F) {
+      for (const Instruction &I : BB) {
+        if (isa<DbgInfoIntrinsic>(&I))
+          continue;
+        const char *pOpClass = nullptr;
+        const CallInst *CI = dyn_cast<CallInst>(&I);
+        if (CI && OP::IsDxilOpFuncCallInst(CI))
+          pOpClass = OP::GetOpCodeClassName(OP::GetDxilOpFuncCallInst(CI));
+        Stats.Add(I, pOpClass);
+      }
+    }
+  }
+
+  OS << "{\n  \"lines\": [";
+  bool First = true;
+  for (const auto &Line : Stats.Lines) {
+    OS << (First ? "\n" : ",\n") << "    { \"file\": ";
+    WriteJsonString(OS, Line.first.first);
+    OS << ", \"line\": " << Line.first.second << ", ";
+    WriteCost(OS, Line.second);
+    OS << " }";
+    First = false;
+  }
+  OS << (First ? "]" : "\n  ]") << ",\n  \"functions\": [";
+  First = true;
+  for (const auto &Function : Stats.Functions) {
+    OS << (First ? "\n" : ",\n") << "    { \"name\": ";
+    WriteJsonString(OS, Function.first);
+    OS << ", ";
+    WriteCost(OS, Function.second);
+    OS << " }";
+    First = false;
+  }
+  OS << (First ? "]" : "\n  ]") << ",\n  \"inlined_calls\": [";
+  First = true;
+  for (const auto &Call : Stats.CallSites) {
+    OS << (First ? "\n" : ",\n") << "    { \"file\": ";
+    WriteJsonString(OS, std::get<0>(Call.first));
+    OS << ", \"line\": " << std::get<1>(Call.first)
+       << ", \"column\": " << std::get<2>(Call.first) << ", \"callee\": ";
+    WriteJsonString(OS, std::get<3>(Call.first));
+    OS << ", ";
+    WriteCost(OS, Call.second);
+    OS << " }";
+    First = false;
+  }
+  OS << (First ? "]" : "\n  ]") << ",\n  \"unknown\": { ";
+  WriteCost(OS, Stats.Unknown);
+  OS << " }\n}\n";
+}
+
+} // namespace dxcutil
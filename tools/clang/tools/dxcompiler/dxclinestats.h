@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxclinestats.h                                                            //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Attributes the generated code of a compile to the source that produced it.//
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+namespace llvm {
+class Module;
+class raw_ostream;
+} // namespace llvm
+
+namespace dxcutil {
+
+// Writes, as a JSON object, the instructions of the function bodies in M
+// counted by the source line, the source function and every inlined call
+// site they come from, each with the calls to DXIL operations among them by
+// operation class. Where the code comes from is read from the debug
+// locations of the instructions, which every compile tracks; -Zi, with or
+// without -Qdebug_lines, keeps more of them through the optimizer.
+// Instructions without one are counted in "unknown".
+void WriteLineStatsJson(llvm::raw_ostream &OS, const llvm::Module &M);
+
+} // namespace dxcutil
@@ -19,8 +19,12 @@
 #include "dxc/dxcapi.h"
 #include "dxillib.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include "dxc/HLSL/DxilLinker.h"
 #include "dxc/HLSL/DxilValidation.h"
@@ -28,6 +32,8 @@
 #include "dxc/Support/microcom.h"
 #include "dxc/dxcapi.internal.h"
 #include "dxcutil.h"
+#include "dxccompilecache.h"
+#include "dxcversion.inc"
 #include "clang/Basic/Diagnostic.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/DiagnosticPrinter.h"
@@ -37,13 +43,135 @@
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "dxc/Support/HLSLOptions.h"
 
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+#include "clang/Basic/Version.h"
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+
 using namespace hlsl;
 using namespace llvm;
 
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
-class DxcLinker : public IDxcLinker, public IDxcContainerEvent {
+// A library container checked once, with the usage of its functions found
+// from a full load that is then discarded. Registering it loads the module
+// lazily into the registering linker's context, as RegisterLibrary does.
+class DxcLinkerLibrary : public IDxcLinkerLibrary {
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcLinkerLibrary)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcLinkerLibrary>(this, riid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE GetContainer(IDxcBlob **ppResult) override {
+    if (!ppResult)
+      return E_INVALIDARG;
+    *ppResult = m_pContainer;
+    m_pContainer.p->AddRef();
+    return S_OK;
+  }
+
+  HRESULT Initialize(IDxcBlob *pContainer);
+  HRESULT Register(DxilLinker &linker, LLVMContext &Ctx,
+                   llvm::StringRef name) const;
+
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcBlob> m_pContainer;
+  // The module the linker uses: the debug module if there is one.
+  const char *m_pBitcode = nullptr;
+  uint32_t m_BitcodeLength = 0;
+  // The program part expanded, if the container holds its bitcode compressed.
+  std::vector<uint32_t> m_ExpandedProgram;
+  // Null if a function or global without a name is used.
+  std::unique_ptr<DxilLibraryUsage> m_pUsage;
+};
+
+HRESULT DxcLinkerLibrary::Initialize(IDxcBlob *pContainer) {
+  const DxilContainerHeader *pHeader = IsDxilContainerLike(
+      pContainer->GetBufferPointer(), pContainer->GetBufferSize());
+  if (!pHeader || !IsValidDxilContainer(pHeader, pContainer->GetBufferSize()))
+    return DXC_E_CONTAINER_INVALID;
+  const DxilPartHeader *pPart =
+      GetDxilPartByType(pHeader, DFCC_ShaderDebugInfoDXIL);
+  if (!pPart)
+    pPart = GetDxilPartByType(pHeader, DFCC_DXIL);
+  if (!pPart)
+    return DXC_E_CONTAINER_MISSING_DXIL;
+
+  try {
+    const DxilProgramHeader *pProgramHeader = GetValidDxilProgramHeader(
+        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart)),
+        pPart->PartSize, m_ExpandedProgram);
+    if (!pProgramHeader)
+      return DXC_E_CONTAINER_INVALID;
+    GetDxilProgramBitcode(pProgramHeader, &m_pBitcode, &m_BitcodeLength);
+    m_pContainer = pContainer;
+
+    CComPtr<IMalloc> pMalloc;
+    CComPtr<AbstractMemoryStream> pDiagStream;
+    IFT(CoGetMalloc(1, &pMalloc));
+    IFT(CreateMemoryStream(pMalloc, &pDiagStream));
+    raw_stream_ostream DiagStream(pDiagStream);
+
+    LLVMContext Ctx;
+    std::unique_ptr<llvm::Module> pModule;
+    IFR(ValidateLoadModule(m_pBitcode, m_BitcodeLength, pModule, Ctx,
+                           DiagStream, /*bLazyLoad*/ false));
+    m_pUsage = llvm::make_unique<DxilLibraryUsage>();
+    if (!m_pUsage->Build(*pModule))
+      m_pUsage.reset();
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+HRESULT DxcLinkerLibrary::Register(DxilLinker &linker, LLVMContext &Ctx,
+                                   llvm::StringRef name) const {
+  try {
+    CComPtr<IMalloc> pMalloc;
+    CComPtr<AbstractMemoryStream> pDiagStream;
+    IFT(CoGetMalloc(1, &pMalloc));
+    IFT(CreateMemoryStream(pMalloc, &pDiagStream));
+    raw_stream_ostream DiagStream(pDiagStream);
+
+    std::unique_ptr<llvm::Module> pModule;
+    IFR(ValidateLoadModule(m_pBitcode, m_BitcodeLength, pModule, Ctx,
+                           DiagStream, /*bLazyLoad*/ true));
+    bool bRegistered =
+        m_pUsage ? linker.RegisterLib(name, std::move(pModule), *m_pUsage)
+                 : linker.RegisterLib(name, std::move(pModule), nullptr);
+    return bRegistered ? S_OK : E_INVALIDARG;
+  } catch (hlsl::Exception &) {
+    return E_INVALIDARG;
+  }
+}
+
+// Digest identifying the contents of a library container. The shader hash
+// part covers the program but not its debug info, so it only stands for the
+// container when there is no debug module to link.
+static void HashLibraryContents(IDxcBlob *pBlob, MD5::MD5Result &result) {
+  MD5 hash;
+  const DxilContainerHeader *pContainer =
+      IsDxilContainerLike(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  const DxilPartHeader *pHashPart =
+      pContainer ? GetDxilPartByType(pContainer, DFCC_ShaderHash) : nullptr;
+  if (pHashPart &&
+      !GetDxilPartByType(pContainer, DFCC_ShaderDebugInfoDXIL)) {
+    hash.update(ArrayRef<uint8_t>((const uint8_t *)GetDxilPartData(pHashPart),
+                                  pHashPart->PartSize));
+  } else {
+    hash.update(ArrayRef<uint8_t>((const uint8_t *)pBlob->GetBufferPointer(),
+                                  pBlob->GetBufferSize()));
+  }
+  hash.final(result);
+}
+
+class DxcLinker : public IDxcLinker2,
+                  public IDxcLinkerCache,
+                  public IDxcContainerEvent {
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcLinker)
@@ -69,6 +197,35 @@ public:
           *ppResult // Linker output status, buffer, and errors
   ) override;
 
+  // IDxcLinker2
+  HRESULT STDMETHODCALLTYPE LinkMany(
+      _In_count_(requestCount) const DxcLinkRequest *pRequests,
+      _In_ UINT32 requestCount,
+      _In_count_(libCount) const LPCWSTR *pLibNames, UINT32 libCount,
+      _In_count_(argCount) const LPCWSTR *pArguments, _In_ UINT32 argCount,
+      _In_ UINT32 threadCount,
+      _Out_writes_(requestCount) IDxcOperationResult **ppResults) override;
+  HRESULT STDMETHODCALLTYPE PrepareLibrary(
+      _In_ IDxcBlob *pLib, _COM_Outptr_ IDxcLinkerLibrary **ppResult) override;
+  HRESULT STDMETHODCALLTYPE RegisterPreparedLibrary(
+      _In_ LPCWSTR pLibName, _In_ IDxcLinkerLibrary *pLib) override;
+
+  // IDxcLinkerCache
+  HRESULT STDMETHODCALLTYPE
+  SetCacheStorage(_In_opt_ IDxcLinkCacheStorage *pStorage) override {
+    std::lock_guard<std::mutex> lock(m_CacheMutex);
+    m_pCacheStorage = pStorage;
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ UINT32 *pHits,
+                                          _Out_ UINT32 *pMisses) override {
+    if (!pHits || !pMisses)
+      return E_INVALIDARG;
+    *pHits = m_CacheHits;
+    *pMisses = m_CacheMisses;
+    return S_OK;
+  }
+
   HRESULT STDMETHODCALLTYPE RegisterDxilContainerEventHandler(
       IDxcContainerEventsHandler *pHandler, UINT64 *pCookie) override {
     DxcThreadMalloc TM(m_pMalloc);
@@ -88,7 +245,8 @@ public:
   }
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcLinker>(this, riid, ppvObject);
+    return DoBasicQueryInterface<IDxcLinker, IDxcLinker2, IDxcLinkerCache>(
+        this, riid, ppvObject);
   }
 
   void Initialize() {
@@ -103,27 +261,55 @@ public:
   }
 
 private:
+  // A linker on a context of its own, so that it can link beside others.
+  // The linker is declared last so that it is destroyed before the context.
+  struct LinkWorker {
+    LLVMContext Ctx;
+    std::unique_ptr<DxilLinker> pLinker;
+  };
+
+  struct RegisteredLib {
+    std::string name;
+    CComPtr<IDxcBlob> pBlob;
+    CComPtr<DxcLinkerLibrary> pPrepared; // Null unless registered prepared.
+    MD5::MD5Result contentHash;          // See HashLibraryContents.
+  };
+
+  // Loads a library container into Ctx and registers it with pLinker.
+  static HRESULT LoadLib(DxilLinker &linker, LLVMContext &Ctx,
+                         llvm::StringRef name, IDxcBlob *pBlob);
+  // Does the work of Link with the given linker, whose libraries live in Ctx.
+  HRESULT LinkEntry(DxilLinker &linker, LLVMContext &Ctx, LPCWSTR pEntryName,
+                    LPCWSTR pTargetProfile, const LPCWSTR *pLibNames,
+                    UINT32 libCount, const LPCWSTR *pArguments,
+                    UINT32 argCount, IDxcOperationResult **ppResult);
+  // Returns false if the link cannot be cached, because a library is not
+  // registered or an events handler may rewrite the output.
+  bool ComputeLinkCacheKey(const hlsl::options::DxcOpts &opts,
+                           const LPCWSTR *pLibNames, UINT32 libCount,
+                           MD5::MD5Result &key);
+
   DXC_MICROCOM_TM_REF_FIELDS()
   LLVMContext m_Ctx;
   std::unique_ptr<DxilLinker> m_pLinker;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
-  std::vector<CComPtr<IDxcBlob>> m_blobs; // Keep blobs live for lazy load.
+  // Serializes calls into the events handler from LinkMany's threads.
+  std::mutex m_EventsMutex;
+  // Registered libraries, in registration order. The blobs are kept live for
+  // lazy load, and are loaded again into the contexts of LinkMany's threads.
+  std::vector<RegisteredLib> m_libs;
+  // Library functions of earlier links that passed validation, so linking
+  // them again into further libraries does not check them again.
+  DxilValidationCache m_ValidationCache;
+  // Storage for link results, or null; guarded by m_CacheMutex.
+  CComPtr<IDxcLinkCacheStorage> m_pCacheStorage;
+  std::mutex m_CacheMutex;
+  std::atomic<UINT32> m_CacheHits{0};
+  std::atomic<UINT32> m_CacheMisses{0};
 };
 
-HRESULT
-DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
-                           _In_ IDxcBlob *pBlob       // Library to add.
-) {
-  if (!pLibName || !pBlob)
-    return E_INVALIDARG;
-  DXASSERT(m_pLinker.get(), "else Initialize() not called or failed silently");
-  DxcThreadMalloc TM(m_pMalloc);
-  // Prepare UTF8-encoded versions of API values.
-  CW2A pUtf8LibName(pLibName, CP_UTF8);
-  // Already exist lib with same name.
-  if (m_pLinker->HasLibNameRegistered(pUtf8LibName.m_psz))
-    return E_INVALIDARG;
-
+HRESULT DxcLinker::LoadLib(DxilLinker &linker, LLVMContext &Ctx,
+                           llvm::StringRef name, IDxcBlob *pBlob) {
   try {
     std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
@@ -137,20 +323,80 @@ DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
 
     IFR(ValidateLoadModuleFromContainerLazy(
         pBlob->GetBufferPointer(), pBlob->GetBufferSize(), pModule,
-        pDebugModule, m_Ctx, m_Ctx, DiagStream));
+        pDebugModule, Ctx, Ctx, DiagStream));
 
-    if (m_pLinker->RegisterLib(pUtf8LibName.m_psz, std::move(pModule),
-                               std::move(pDebugModule))) {
-      m_blobs.emplace_back(pBlob);
+    if (linker.RegisterLib(name, std::move(pModule), std::move(pDebugModule)))
       return S_OK;
-    } else {
+    else
       return E_INVALIDARG;
-    }
   } catch (hlsl::Exception &) {
     return E_INVALIDARG;
   }
 }
 
+HRESULT
+DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
+                           _In_ IDxcBlob *pBlob       // Library to add.
+) {
+  if (!pLibName || !pBlob)
+    return E_INVALIDARG;
+  DXASSERT(m_pLinker.get(), "else Initialize() not called or failed silently");
+  DxcThreadMalloc TM(m_pMalloc);
+  // Prepare UTF8-encoded versions of API values.
+  CW2A pUtf8LibName(pLibName, CP_UTF8);
+  // Already exist lib with same name.
+  if (m_pLinker->HasLibNameRegistered(pUtf8LibName.m_psz))
+    return E_INVALIDARG;
+
+  IFR(LoadLib(*m_pLinker, m_Ctx, pUtf8LibName.m_psz, pBlob));
+  try {
+    m_libs.push_back({pUtf8LibName.m_psz, pBlob, nullptr});
+    HashLibraryContents(pBlob, m_libs.back().contentHash);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcLinker::PrepareLibrary(
+    _In_ IDxcBlob *pLib, _COM_Outptr_ IDxcLinkerLibrary **ppResult) {
+  if (!pLib || !ppResult)
+    return E_INVALIDARG;
+  *ppResult = nullptr;
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    CComPtr<DxcLinkerLibrary> pPrepared = DxcLinkerLibrary::Alloc(m_pMalloc);
+    IFROOM(pPrepared.p);
+    IFR(pPrepared->Initialize(pLib));
+    *ppResult = pPrepared.Detach();
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcLinker::RegisterPreparedLibrary(
+    _In_ LPCWSTR pLibName, _In_ IDxcLinkerLibrary *pLib) {
+  if (!pLibName || !pLib)
+    return E_INVALIDARG;
+  DXASSERT(m_pLinker.get(), "else Initialize() not called or failed silently");
+  DxcThreadMalloc TM(m_pMalloc);
+  CW2A pUtf8LibName(pLibName, CP_UTF8);
+  if (m_pLinker->HasLibNameRegistered(pUtf8LibName.m_psz))
+    return E_INVALIDARG;
+
+  // IDxcLinkerLibrary is only implemented by the objects PrepareLibrary
+  // returns.
+  DxcLinkerLibrary *pPrepared = static_cast<DxcLinkerLibrary *>(pLib);
+  IFR(pPrepared->Register(*m_pLinker, m_Ctx, pUtf8LibName.m_psz));
+  try {
+    CComPtr<IDxcBlob> pBlob;
+    IFT(pPrepared->GetContainer(&pBlob));
+    m_libs.push_back({pUtf8LibName.m_psz, pBlob, pPrepared});
+    HashLibraryContents(pBlob, m_libs.back().contentHash);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
 // Links the shader and produces a shader blob that the Direct3D runtime can
 // use.
 HRESULT STDMETHODCALLTYPE DxcLinker::Link(
@@ -168,6 +414,15 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
   if (!pTargetProfile || !pLibNames || libCount == 0 || !ppResult)
     return E_INVALIDARG;
   DxcThreadMalloc TM(m_pMalloc);
+  return LinkEntry(*m_pLinker, m_Ctx, pEntryName, pTargetProfile, pLibNames,
+                   libCount, pArguments, argCount, ppResult);
+}
+
+HRESULT DxcLinker::LinkEntry(DxilLinker &linker, LLVMContext &Ctx,
+                             LPCWSTR pEntryName, LPCWSTR pTargetProfile,
+                             const LPCWSTR *pLibNames, UINT32 libCount,
+                             const LPCWSTR *pArguments, UINT32 argCount,
+                             IDxcOperationResult **ppResult) {
   // Prepare UTF8-encoded versions of API values.
   CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
   CW2A pUtf8EntryPoint(pEntryName, CP_UTF8);
@@ -175,7 +430,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
   CComPtr<AbstractMemoryStream> pOutputStream;
 
   // Detach previous libraries.
-  m_pLinker->DetachAll();
+  linker.DetachAll();
 
   HRESULT hr = S_OK;
   try {
@@ -207,15 +462,38 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
     std::string warnings;
     //llvm::raw_string_ostream w(warnings);
     IFT(CreateMemoryStream(pMalloc, &pDiagStream));
+
+    // A cached container is returned before any library is loaded.
+    CComPtr<IDxcLinkCacheStorage> pCacheStorage;
+    {
+      std::lock_guard<std::mutex> lock(m_CacheMutex);
+      pCacheStorage = m_pCacheStorage;
+    }
+    MD5::MD5Result cacheKey;
+    bool useCache = pCacheStorage != nullptr &&
+                    ComputeLinkCacheKey(opts, pLibNames, libCount, cacheKey);
+    if (useCache) {
+      CComPtr<IDxcBlob> pCached;
+      if (SUCCEEDED(pCacheStorage->Lookup(cacheKey, &pCached)) && pCached) {
+        ++m_CacheHits;
+        CComPtr<IStream> pStream = pDiagStream;
+        dxcutil::CreateOperationResultFromOutputs(pCached, pStream, warnings,
+                                                  false, ppResult);
+        return S_OK;
+      }
+      ++m_CacheMisses;
+    }
+
     raw_stream_ostream DiagStream(pDiagStream);
     llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
     PrintDiagnosticContext DiagContext(DiagPrinter);
-    m_Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+    Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
                                &DiagContext, true);
 
     if (opts.ValVerMajor != UINT32_MAX) {
-      m_pLinker->SetValidatorVersion(opts.ValVerMajor, opts.ValVerMinor);
+      linker.SetValidatorVersion(opts.ValVerMajor, opts.ValVerMinor);
     }
+    linker.SetLinkTimeOptLevel(opts.LinkTimeOptimization ? opts.OptLevel : 0);
 
     bool needsValidation = !opts.DisableValidation;
     // Disable validation if ValVerMajor is 0 (offline target, never validate),
@@ -230,7 +508,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
     bool bSuccess = true;
     for (unsigned i = 0; i < libCount; i++) {
       CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
-      bSuccess &= m_pLinker->AttachLib(pUtf8LibName.m_psz);
+      bSuccess &= linker.AttachLib(pUtf8LibName.m_psz);
     }
 
     dxilutil::ExportMap exportMap;
@@ -241,7 +519,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
 
     bool hasErrorOccurred = !bSuccess;
     if (bSuccess) {
-      std::unique_ptr<Module> pM = m_pLinker->Link(
+      std::unique_ptr<Module> pM = linker.Link(
           opts.EntryPoint, pUtf8TargetProfile.m_psz, exportMap);
       if (pM) {
         const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
@@ -269,12 +547,16 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         if (opts.DebugNameForSource) {
           SerializeFlags |= SerializeDxilFlags::DebugNameDependOnSource;
         }
+        if (opts.CompressLibraryBitcode) {
+          SerializeFlags |= SerializeDxilFlags::CompressLibraryBitcode;
+        }
         // Validation.
         HRESULT valHR = S_OK;
         dxcutil::AssembleInputs inputs(
           std::move(pM), pOutputBlob, pMalloc, SerializeFlags,
           pOutputStream,
           opts.DebugFile, &Diag);
+        inputs.pValidationCache = &m_ValidationCache;
         if (needsValidation) {
           valHR = dxcutil::ValidateAndAssembleToContainer(inputs);
         } else {
@@ -283,6 +565,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         // Callback after valid DXIL is produced
         if (SUCCEEDED(valHR)) {
           CComPtr<IDxcBlob> pTargetBlob;
+          std::lock_guard<std::mutex> lock(m_EventsMutex);
           if (m_pDxcContainerEventsHandler != nullptr) {
             HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
                 pOutputBlob, &pTargetBlob);
@@ -294,6 +577,8 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         }
 
         hasErrorOccurred = Diag.hasErrorOccurred();
+        if (useCache && !hasErrorOccurred && SUCCEEDED(valHR))
+          pCacheStorage->Store(cacheKey, pOutputBlob);
 
       } else {
         hasErrorOccurred = true;
@@ -308,6 +593,147 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
   return hr;
 }
 
+bool DxcLinker::ComputeLinkCacheKey(const hlsl::options::DxcOpts &opts,
+                                    const LPCWSTR *pLibNames, UINT32 libCount,
+                                    MD5::MD5Result &key) {
+  {
+    std::lock_guard<std::mutex> lock(m_EventsMutex);
+    if (m_pDxcContainerEventsHandler != nullptr)
+      return false;
+  }
+
+  dxcutil::DxcCompileCacheKey keyHash;
+  keyHash.Update(RC_FILE_VERSION);
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+  keyHash.Update(clang::getGitCommitHash());
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+  unsigned valMajor, valMinor;
+  dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+  keyHash.Update(valMajor);
+  keyHash.Update(valMinor);
+  keyHash.Update(opts.EntryPoint);
+  keyHash.Update(opts.TargetProfile);
+  for (const llvm::opt::Arg *A : opts.Args)
+    keyHash.Update(A->getAsString(opts.Args));
+
+  keyHash.Update(libCount);
+  for (UINT32 i = 0; i < libCount; i++) {
+    CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
+    StringRef name = pUtf8LibName.m_psz;
+    auto it = std::find_if(
+        m_libs.begin(), m_libs.end(),
+        [name](const RegisteredLib &lib) { return lib.name == name; });
+    if (it == m_libs.end())
+      return false;
+    keyHash.Update(name);
+    keyHash.Update(StringRef((const char *)it->contentHash,
+                             sizeof(it->contentHash)));
+  }
+  keyHash.Final(key);
+  return true;
+}
+
+HRESULT STDMETHODCALLTYPE DxcLinker::LinkMany(
+    _In_count_(requestCount) const DxcLinkRequest *pRequests,
+    _In_ UINT32 requestCount,
+    _In_count_(libCount) const LPCWSTR *pLibNames, UINT32 libCount,
+    _In_count_(argCount) const LPCWSTR *pArguments, _In_ UINT32 argCount,
+    _In_ UINT32 threadCount,
+    _Out_writes_(requestCount) IDxcOperationResult **ppResults) {
+  if ((requestCount > 0 && (!pRequests || !ppResults)) || !pLibNames ||
+      libCount == 0)
+    return E_INVALIDARG;
+  for (UINT32 i = 0; i < requestCount; ++i) {
+    if (!pRequests[i].pTargetProfile)
+      return E_INVALIDARG;
+    ppResults[i] = nullptr;
+  }
+  if (requestCount == 0)
+    return S_OK;
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try {
+    // Libraries each extra thread loads into its context. Names that are not
+    // registered are left for each link to report.
+    std::vector<const RegisteredLib *> libs;
+    for (UINT32 i = 0; i < libCount; ++i) {
+      CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
+      for (const RegisteredLib &lib : m_libs)
+        if (lib.name == pUtf8LibName.m_psz)
+          libs.push_back(&lib);
+    }
+
+    if (threadCount == 0)
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, requestCount);
+
+    std::atomic<UINT32> nextIndex(0);
+    std::atomic<bool> stopped(false);
+    std::mutex resultMutex;
+    HRESULT result = S_OK;
+    auto fail = [&](HRESULT hr) {
+      std::lock_guard<std::mutex> lock(resultMutex);
+      if (SUCCEEDED(result))
+        result = hr;
+      stopped = true;
+    };
+    auto linkAll = [&](DxilLinker &linker, LLVMContext &Ctx) {
+      for (;;) {
+        UINT32 i = nextIndex++;
+        if (i >= requestCount || stopped)
+          return;
+        HRESULT hr = LinkEntry(linker, Ctx, pRequests[i].pEntryName,
+                               pRequests[i].pTargetProfile, pLibNames,
+                               libCount, pArguments, argCount, &ppResults[i]);
+        if (FAILED(hr))
+          fail(hr);
+      }
+    };
+    auto worker = [&]() {
+      DxcThreadMalloc TM(m_pMalloc);
+      HRESULT hr = S_OK;
+      try {
+        UINT32 valMajor, valMinor;
+        dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+        LinkWorker W;
+        W.pLinker.reset(DxilLinker::CreateLinker(W.Ctx, valMajor, valMinor));
+        for (const RegisteredLib *lib : libs) {
+          hr = lib->pPrepared
+                   ? lib->pPrepared->Register(*W.pLinker, W.Ctx, lib->name)
+                   : LoadLib(*W.pLinker, W.Ctx, lib->name, lib->pBlob);
+          if (FAILED(hr))
+            break;
+        }
+        if (SUCCEEDED(hr))
+          linkAll(*W.pLinker, W.Ctx);
+      }
+      CATCH_CPP_ASSIGN_HRESULT();
+      if (FAILED(hr))
+        fail(hr);
+    };
+
+    // The calling thread links on this object's own linker, whose libraries
+    // are already loaded.
+    std::vector<std::thread> threads;
+    for (UINT32 i = 1; i < threadCount; ++i)
+      threads.emplace_back(worker);
+    linkAll(*m_pLinker, m_Ctx);
+    for (std::thread &thread : threads)
+      thread.join();
+
+    if (FAILED(result)) {
+      for (UINT32 i = 0; i < requestCount; ++i) {
+        if (ppResults[i]) {
+          ppResults[i]->Release();
+          ppResults[i] = nullptr;
+        }
+      }
+    }
+    return result;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv) {
   *ppv = nullptr;
   try {
@@ -19,14 +19,20 @@
 #include "clang/Lex/HLSLMacroExpander.h"
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "clang/Frontend/Utils.h"
+#include "clang/Lex/LexDiagnostic.h"
 #include "clang/Sema/SemaHLSL.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/CodeGen/CodeGenAction.h"
+#include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
+#include "dxc/HLSL/DxilCompileStats.h"
+#include "dxc/HLSL/DxilFunctionFingerprint.h"
+#include "dxc/HLSL/DxilValidation.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
 #include "dxcutil.h"
 #include "dxc/Support/dxcfilesystem.h"
@@ -51,9 +57,21 @@
 #include "dxillib.h"
 #include "dxcshadersourceinfo.h"
 #include "dxcompileradapter.h"
+#include "dxccompilecache.h"
+#include "dxccontextpool.h"
+#include "dxctimereport.h"
+#include "dxctrace.h"
+#include "dxclinestats.h"
+#include "dxcpermutations.h"
 #include "dxcversion.inc"
 #include <algorithm>
+#include <atomic>
 #include <cfloat>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
@@ -83,7 +101,9 @@ HRESULT RunInternalValidator(_In_ IDxcValidator *pValidator,
                              _In_ llvm::Module *pModule,
                              _In_ llvm::Module *pDebugModule,
                              _In_ IDxcBlob *pShader, UINT32 Flags,
-                             _In_ IDxcOperationResult **ppResult);
+                             _In_ IDxcOperationResult **ppResult,
+                             unsigned ThreadCount = 1,
+                             hlsl::DxilValidationCache *pCache = nullptr);
 
 static bool ShouldBeCopiedIntoPDB(UINT32 FourCC) {
   switch (FourCC) {
@@ -414,9 +434,6 @@ private:
     auto &optToggles = m_CI.getCodeGenOpts().HLSLOptimizationToggles;
     auto &optSelects = m_CI.getCodeGenOpts().HLSLOptimizationSelects;
 
-    const llvm::SmallVector<std::string, 2> &semDefPrefixes =
-                             m_langExtensionsHelper.GetSemanticDefines();
-
     // Add semantic defines to mdNodes and also to codeGenOpts
     for (const ParsedSemanticDefine &define : defines) {
       MDString *name  = MDString::get(M->getContext(), define.Name);
@@ -425,12 +442,10 @@ private:
 
       // Find index for end of matching semantic define prefix
       size_t prefixPos = 0;
-      for (auto prefix : semDefPrefixes) {
-        if (IsMacroMatch(define.Name, prefix)) {
-          prefixPos = prefix.length() - 1;
-          break;
-        }
-      }
+      StarPatternTrie::MatchResult match =
+          m_langExtensionsHelper.GetSemanticDefinePatterns().Match(define.Name);
+      if (match.Count)
+        prefixPos = match.FirstPatternLength - 1;
 
       // Add semantic defines to option flag equivalents
       // Convert define-style '_' into option-style '-' and lowercase everything
@@ -546,7 +561,258 @@ static void CreateDefineStrings(
   }
 }
 
+// Runs Write on a memory stream and hands the UTF-8 text it wrote over to
+// a blob, so that large reports are not copied once written.
+template <typename WriteFn>
+static HRESULT WriteTextOutput(WriteFn Write, IDxcBlobEncoding **ppText) {
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  CComPtr<AbstractMemoryStream> pStream;
+  IFR(CreateMemoryStream(pMalloc, &pStream));
+  {
+    raw_stream_ostream OS(pStream.p);
+    Write(OS);
+  }
+  return hlsl::DxcCreateBlobFromMemoryStream(pStream, pMalloc, true, CP_UTF8,
+                                             ppText);
+}
+
+// Attaches the time and memory report collected so far to the result.
+static HRESULT SetTimeReportOutput(DxcResult *pResult,
+                                   dxcutil::DxcTimeReport &report,
+                                   llvm::StringRef outputName) {
+  std::string json;
+  report.WriteJson(json);
+  IFR(pResult->SetOutputString(DXC_OUT_TIME_REPORT, json.c_str(), json.size()));
+  return pResult->SetOutputName(DXC_OUT_TIME_REPORT, outputName);
+}
+
+// Attaches the sizes of the module at each stage, and the peak memory of the
+// compile when a budget tracked it, to the result.
+static HRESULT SetCompileStatsOutput(DxcResult *pResult,
+                                     const DxilCompileStats &stats,
+                                     const DxcThreadMemoryBudget &budget,
+                                     llvm::StringRef outputName) {
+  CComPtr<IDxcBlobEncoding> pJson;
+  IFR(WriteTextOutput(
+      [&](llvm::raw_ostream &OS) {
+        stats.WriteJson(OS, budget.GetBudget() ? budget.GetPeakBytes() : 0);
+      },
+      &pJson));
+  IFR(pResult->SetOutputObject(DXC_OUT_STATS, pJson));
+  return pResult->SetOutputName(DXC_OUT_STATS, outputName);
+}
+
+// Attaches the generated code of the final module M per source line to the
+// result.
+static HRESULT SetLineStatsOutput(DxcResult *pResult, const llvm::Module &M,
+                                  llvm::StringRef outputName) {
+  CComPtr<IDxcBlobEncoding> pJson;
+  IFR(WriteTextOutput(
+      [&](llvm::raw_ostream &OS) { dxcutil::WriteLineStatsJson(OS, M); },
+      &pJson));
+  IFR(pResult->SetOutputObject(DXC_OUT_LINE_STATS, pJson));
+  return pResult->SetOutputName(DXC_OUT_LINE_STATS, outputName);
+}
+
+// Attaches the peak memory the budget has seen so far to the result.
+static HRESULT SetMemoryStatisticsOutput(DxcResult *pResult,
+                                         const DxcThreadMemoryBudget &budget) {
+  DxcMemoryStatistics stats = {};
+  stats.PeakBytes = budget.GetPeakBytes();
+  stats.LimitBytes = budget.GetLimitBytes();
+  CComPtr<IDxcBlob> pStatsBlob;
+  IFR(hlsl::DxcCreateBlobOnHeapCopy(&stats, sizeof(stats), &pStatsBlob));
+  return pResult->SetOutputObject(DXC_OUT_MEMORY_STATISTICS, pStatsBlob);
+}
+
+// Appends a make rule naming target and the files the compile read: the
+// main source, then every file loaded through the include handler.
+static void WriteDependencies(llvm::raw_ostream &OS, llvm::StringRef target,
+                              llvm::StringRef mainFile,
+                              dxcutil::DxcArgsFileSystem *pFileSystem) {
+  auto writePath = [&OS](llvm::StringRef path) {
+    for (char ch : path) {
+      if (ch == ' ' || ch == '#')
+        OS << '\\';
+      else if (ch == '$')
+        OS << '$';
+      OS << ch;
+    }
+  };
+  writePath(target);
+  OS << ": ";
+  writePath(mainFile);
+  unsigned includeCount = pFileSystem->GetIncludedFileCount();
+  for (unsigned i = 0; i < includeCount; ++i) {
+    LPCWSTR pName;
+    CComPtr<IDxcBlobUtf8> pBlob;
+    pFileSystem->GetIncludedFile(i, &pName, &pBlob);
+    CW2A utf8Name(pName, CP_UTF8);
+    OS << " \\\n  ";
+    writePath(utf8Name.m_psz);
+  }
+  OS << "\n";
+}
+
+// Prints every diagnostic for the error output and, with a sink, also reports
+// it to the sink as it is produced. When the sink fails, a fatal error stops
+// the compile: clang reports nothing after it, and parsing stops at the next
+// top-level declaration.
+class DxcDiagnosticSinkConsumer : public DiagnosticConsumer {
+private:
+  TextDiagnosticPrinter &m_printer;
+  IDxcDiagnosticSink *m_pSink;
+  DiagnosticsEngine *m_pDiags = nullptr;
+  HRESULT m_abortStatus = S_OK;
+
+  static UINT32 GetSeverity(DiagnosticsEngine::Level level) {
+    switch (level) {
+    case DiagnosticsEngine::Remark:  return DxcDiagnosticSeverity_Remark;
+    case DiagnosticsEngine::Warning: return DxcDiagnosticSeverity_Warning;
+    case DiagnosticsEngine::Error:   return DxcDiagnosticSeverity_Error;
+    case DiagnosticsEngine::Fatal:   return DxcDiagnosticSeverity_Fatal;
+    default:                         return DxcDiagnosticSeverity_Note;
+    }
+  }
+
+public:
+  DxcDiagnosticSinkConsumer(TextDiagnosticPrinter &printer, IDxcDiagnosticSink *pSink)
+      : m_printer(printer), m_pSink(pSink) {}
+
+  // The engine the consumer is installed in, which stops the compile.
+  void SetDiagnostics(DiagnosticsEngine *pDiags) { m_pDiags = pDiags; }
+  // The failure returned by the sink, or S_OK if it let the compile run.
+  HRESULT GetAbortStatus() const { return m_abortStatus; }
+
+  void BeginSourceFile(const LangOptions &LangOpts,
+                       const Preprocessor *PP) override {
+    m_printer.BeginSourceFile(LangOpts, PP);
+  }
+  void EndSourceFile() override { m_printer.EndSourceFile(); }
+  void finish() override { m_printer.finish(); }
+
+  void HandleDiagnostic(DiagnosticsEngine::Level level,
+                        const Diagnostic &info) override {
+    DiagnosticConsumer::HandleDiagnostic(level, info);
+    m_printer.HandleDiagnostic(level, info);
+    if (m_pSink == nullptr || FAILED(m_abortStatus))
+      return;
+
+    SmallString<256> message;
+    info.FormatDiagnostic(message);
+    DxcDiagnosticInfo diagnostic = {};
+    diagnostic.severity = GetSeverity(level);
+    diagnostic.pMessage = message.c_str();
+    if (info.getLocation().isValid() && info.hasSourceManager()) {
+      PresumedLoc loc =
+          info.getSourceManager().getPresumedLoc(info.getLocation());
+      if (loc.isValid()) {
+        diagnostic.pFileName = loc.getFilename();
+        diagnostic.line = loc.getLine();
+        diagnostic.column = loc.getColumn();
+      }
+    }
+    std::string option = DiagnosticIDs::getWarningOptionForDiag(info.getID());
+    if (!option.empty())
+      diagnostic.pOption = option.c_str();
+
+    HRESULT hr = m_pSink->OnDiagnostic(&diagnostic);
+    if (FAILED(hr) && m_pDiags != nullptr) {
+      m_abortStatus = hr;
+      // Reported as soon as the current diagnostic is finished.
+      m_pDiags->SetDelayedDiagnostic(m_pDiags->getCustomDiagID(
+          DiagnosticsEngine::Fatal, "compilation stopped by the diagnostic sink"));
+    }
+  }
+};
+
+// Installs a cancellation token and deadline for the compile on this thread,
+// restoring whatever check was current before.
+class DxcCompileCancellation : public llvm::CancellationCheck {
+private:
+  IDxcCancellationToken *m_pToken;
+  bool m_hasDeadline;
+  std::chrono::steady_clock::time_point m_deadline;
+  llvm::CancellationCheck *m_pPrior;
+
+public:
+  DxcCompileCancellation(IDxcCancellationToken *pToken, UINT32 timeoutMs)
+      : m_pToken(pToken), m_hasDeadline(timeoutMs != 0) {
+    if (m_hasDeadline)
+      m_deadline = std::chrono::steady_clock::now() +
+                   std::chrono::milliseconds(timeoutMs);
+    m_pPrior = llvm::CancellationCheck::setCurrent(this);
+  }
+  ~DxcCompileCancellation() { llvm::CancellationCheck::setCurrent(m_pPrior); }
+
+  bool isCancelled() override {
+    if (m_pToken != nullptr && m_pToken->IsCancellationRequested())
+      return true;
+    return m_hasDeadline && std::chrono::steady_clock::now() >= m_deadline;
+  }
+};
+
+// Wraps an include handler shared by several requests of a batch, so each
+// file is loaded once and the underlying handler is never called concurrently.
+class DxcBatchIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcIncludeHandler> m_pInner;
+  std::mutex m_mutex;
+  std::unordered_map<std::wstring, std::pair<HRESULT, CComPtr<IDxcBlob>>> m_loaded;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcBatchIncludeHandler)
+
+  void Init(IDxcIncludeHandler *pInner) { m_pInner = pInner; }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE LoadSource(
+    _In_z_ LPCWSTR pFilename,
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) override {
+    if (ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    *ppIncludeSource = nullptr;
+    try {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_loaded.find(pFilename);
+      if (it == m_loaded.end()) {
+        CComPtr<IDxcBlob> pBlob;
+        HRESULT hr = m_pInner->LoadSource(pFilename, &pBlob);
+        it = m_loaded.emplace(pFilename, std::make_pair(hr, pBlob)).first;
+      }
+      if (SUCCEEDED(it->second.first) && it->second.second)
+        it->second.second.CopyTo(ppIncludeSource);
+      return it->second.first;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+// Lexes the main file and its includes, writing the resulting token cache to
+// a buffer rather than to the default output file.
+class GeneratePTHToBufferAction : public PreprocessorFrontendAction {
+  SmallVectorImpl<char> &m_Buffer;
+protected:
+  void ExecuteAction() override {
+    raw_svector_ostream OS(m_Buffer);
+    CacheTokens(getCompilerInstance().getPreprocessor(), &OS);
+  }
+public:
+  GeneratePTHToBufferAction(SmallVectorImpl<char> &Buffer) : m_Buffer(Buffer) {}
+};
+
 class DxcCompiler : public IDxcCompiler3,
+                    public IDxcCompilerCache,
+                    public IDxcCompilerBatch,
+                    public IDxcCompilerPermutations,
+                    public IDxcCompilerDiagnostics,
+                    public IDxcCompilerCancellation,
+                    public IDxcCompilerStreamingDisassembly,
                     public IDxcLangExtensions3,
                     public IDxcContainerEvent,
                     public IDxcVersionInfo3,
@@ -559,6 +825,69 @@ private:
   DxcLangExtensionsHelper m_langExtensionsHelper;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
   DxcCompilerAdapter m_DxcCompilerAdapter;
+  dxcutil::DxcCompileCache m_CompileCache;
+  dxcutil::DxcContextPool m_ContextPool;
+
+  // Returns false if this compile cannot be cached, either because no cache
+  // directory is configured or because the outputs depend on callbacks
+  // whose behavior cannot be captured in the key.
+  bool ComputeCacheKey(const hlsl::options::DxcOpts &opts,
+                       IDxcBlobUtf8 *pSource, llvm::StringRef &directory,
+                       llvm::MD5::MD5Result &key) {
+    directory = opts.CompileCacheDir.empty() ? m_CompileCache.GetDirectory()
+                                             : opts.CompileCacheDir;
+    if (directory.empty())
+      return false;
+    if (m_pDxcContainerEventsHandler != nullptr ||
+        !m_langExtensionsHelper.GetIntrinsicTables().empty())
+      return false;
+    // The token cache is loaded outside of the argument file system, so its
+    // contents would not be validated on lookup.
+    if (!opts.IncludePTH.empty())
+      return false;
+    // Likewise the library and fingerprints of an incremental compile, and
+    // the fingerprints are not kept in the cache.
+    if (!opts.OutputFingerprintsFile.empty() || !opts.ReuseLibFile.empty())
+      return false;
+    // Dependencies are read off the file system of a compile that runs, and
+    // scanning them is cheaper than a cache lookup anyway.
+    if (opts.EmitDependencies || !opts.OutputDependenciesFile.empty())
+      return false;
+
+    dxcutil::DxcCompileCacheKey keyHash;
+    keyHash.Update(RC_FILE_VERSION);
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+    keyHash.Update(getGitCommitHash());
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+    unsigned valMajor, valMinor;
+    dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+    keyHash.Update(valMajor);
+    keyHash.Update(valMinor);
+    keyHash.Update(DxilLibIsEnabled() ? 1u : 0u);
+    for (const llvm::opt::Arg *A : opts.Args) {
+      if (A->getOption().matches(options::OPT_compile_cache) ||
+          A->getOption().matches(options::OPT_compile_arena) ||
+          A->getOption().matches(options::OPT_reuse_context) ||
+          A->getOption().matches(options::OPT_memory_limit) ||
+          A->getOption().matches(options::OPT_ftime_report) ||
+          A->getOption().matches(options::OPT_Ftr))
+        continue;
+      keyHash.Update(A->getAsString(opts.Args));
+    }
+    for (const std::string &define : m_langExtensionsHelper.GetDefines())
+      keyHash.Update(define);
+    for (const std::string &define : m_langExtensionsHelper.GetSemanticDefines())
+      keyHash.Update(define);
+    for (const std::string &define : m_langExtensionsHelper.GetSemanticDefineExclusions())
+      keyHash.Update(define);
+    for (const std::string &define : m_langExtensionsHelper.GetNonOptSemanticDefines())
+      keyHash.Update(define);
+    keyHash.Update(m_langExtensionsHelper.GetTargetTriple());
+    keyHash.Update(llvm::StringRef(pSource->GetStringPointer(),
+                                   pSource->GetStringLength()));
+    keyHash.Final(key);
+    return true;
+  }
 
 public:
   DxcCompiler(IMalloc *pMalloc) : m_dwRef(0), m_pMalloc(pMalloc), m_DxcCompilerAdapter(this, pMalloc) {}
@@ -578,9 +907,236 @@ public:
     return S_OK;
   }
 
+  // Runs work for every index below count on up to threadCount threads (0
+  // picks the hardware concurrency), the calling thread included. The first
+  // failure stops indices that have not started yet and is returned.
+  HRESULT RunOnThreads(UINT32 count, UINT32 threadCount,
+                       const std::function<HRESULT(UINT32)> &work) {
+    if (threadCount == 0)
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, count);
+
+    std::atomic<UINT32> nextIndex(0);
+    std::atomic<bool> stopped(false);
+    std::mutex resultMutex;
+    HRESULT result = S_OK;
+    auto worker = [&]() {
+      DxcThreadMalloc TM(m_pMalloc);
+      for (;;) {
+        UINT32 i = nextIndex++;
+        if (i >= count || stopped)
+          return;
+        HRESULT hr = work(i);
+        if (FAILED(hr)) {
+          std::lock_guard<std::mutex> lock(resultMutex);
+          if (SUCCEEDED(result))
+            result = hr;
+          stopped = true;
+        }
+      }
+    };
+
+    // The calling thread works too, so a single thread needs no others.
+    std::vector<std::thread> threads;
+    for (UINT32 i = 1; i < threadCount; ++i)
+      threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+      thread.join();
+    return result;
+  }
+
+  // Wraps an include handler so that requests sharing it load each file once.
+  CComPtr<IDxcIncludeHandler> CreateBatchIncludeHandler(IDxcIncludeHandler *pHandler) {
+    CComPtr<DxcBatchIncludeHandler> pBatchHandler =
+        DxcBatchIncludeHandler::Alloc(m_pMalloc);
+    IFTOOM(pBatchHandler.p);
+    pBatchHandler->Init(pHandler);
+    return CComPtr<IDxcIncludeHandler>(pBatchHandler.p);
+  }
+
+  // IDxcCompilerBatch
+  // Compile holds no per-call state on this object, so workers share it.
+  HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_count_(requestCount) const DxcCompileRequest *pRequests,
+    _In_ UINT32 requestCount,
+    _In_ UINT32 threadCount,
+    _In_ IDxcCompileBatchCallback *pCallback) override {
+    if ((requestCount > 0 && pRequests == nullptr) || pCallback == nullptr)
+      return E_INVALIDARG;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      // Share one caching wrapper between all requests using a handler.
+      std::unordered_map<IDxcIncludeHandler *, CComPtr<IDxcIncludeHandler>> sharedHandlers;
+      std::vector<IDxcIncludeHandler *> handlers(requestCount);
+      for (UINT32 i = 0; i < requestCount; ++i) {
+        IDxcIncludeHandler *pHandler = pRequests[i].pIncludeHandler;
+        if (pHandler == nullptr)
+          continue;
+        CComPtr<IDxcIncludeHandler> &pShared = sharedHandlers[pHandler];
+        if (pShared == nullptr)
+          pShared = CreateBatchIncludeHandler(pHandler);
+        handlers[i] = pShared;
+      }
+
+      std::mutex callbackMutex;
+      return RunOnThreads(requestCount, threadCount, [&](UINT32 i) {
+        const DxcCompileRequest &request = pRequests[i];
+        CComPtr<IDxcResult> pResult;
+        HRESULT hr = Compile(request.pSource, request.pArguments,
+                             request.argCount, handlers[i],
+                             IID_PPV_ARGS(&pResult));
+        if (SUCCEEDED(hr)) {
+          std::lock_guard<std::mutex> lock(callbackMutex);
+          hr = pCallback->OnCompileComplete(i, pResult);
+        }
+        return hr;
+      });
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // IDxcCompilerPermutations
+  HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ const DxcBuffer *pSource,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_count_(defineSetCount) const DxcDefineSet *pDefineSets,
+    _In_ UINT32 defineSetCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ UINT32 threadCount,
+    _In_ IDxcCompileBatchCallback *pCallback,
+    _Out_opt_ UINT32 *pCompileCount) override {
+    if (pSource == nullptr || (argCount > 0 && pArguments == nullptr) ||
+        (defineSetCount > 0 && pDefineSets == nullptr) || pCallback == nullptr)
+      return E_INVALIDARG;
+    if (pCompileCount != nullptr)
+      *pCompileCount = 0;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      CComPtr<IDxcIncludeHandler> pSharedHandler;
+      if (pIncludeHandler != nullptr)
+        pSharedHandler = CreateBatchIncludeHandler(pIncludeHandler);
+
+      // Each permutation compiles with the shared arguments followed by its
+      // defines. A define set naming a macro twice is left unshared, since
+      // the redefinition warns whether or not the source uses the macro.
+      std::vector<std::vector<std::wstring>> defineArgs(defineSetCount);
+      std::vector<dxcutil::DxcPermutationClassifier::DefineMap> defineMaps(defineSetCount);
+      std::vector<bool> repeatsDefine(defineSetCount);
+      for (UINT32 i = 0; i < defineSetCount; ++i) {
+        const DxcDefineSet &defineSet = pDefineSets[i];
+        if (defineSet.defineCount > 0 && defineSet.pDefines == nullptr)
+          return E_INVALIDARG;
+        for (UINT32 j = 0; j < defineSet.defineCount; ++j) {
+          const DxcDefine &define = defineSet.pDefines[j];
+          if (define.Name == nullptr)
+            return E_INVALIDARG;
+          std::wstring arg = L"-D";
+          arg += define.Name;
+          if (define.Value != nullptr) {
+            arg += L"=";
+            arg += define.Value;
+          }
+          defineArgs[i].push_back(std::move(arg));
+          CW2A utf8Name(define.Name, CP_UTF8);
+          CW2A utf8Value(define.Value, CP_UTF8);
+          std::string value = define.Value ? utf8Value.m_psz : "1";
+          if (!defineMaps[i].insert(std::make_pair(std::string(utf8Name.m_psz), value)).second)
+            repeatsDefine[i] = true;
+        }
+      }
+      auto getArgs = [&](UINT32 i, std::vector<LPCWSTR> &args) {
+        args.assign(pArguments, pArguments + argCount);
+        for (const std::wstring &arg : defineArgs[i])
+          args.push_back(arg.c_str());
+      };
+
+      bool share = CanSharePermutations(pArguments, argCount);
+      dxcutil::DxcPermutationClassifier classifier;
+      std::vector<unsigned> classes(defineSetCount);
+      for (UINT32 i = 0; i < defineSetCount; ++i) {
+        if (!share || repeatsDefine[i]) {
+          classes[i] = classifier.AddUnshared();
+          continue;
+        }
+        int found = classifier.FindClass(defineMaps[i]);
+        if (found >= 0) {
+          classes[i] = found;
+          continue;
+        }
+        // A permutation that cannot be scanned gets compiled on its own,
+        // which reports whatever went wrong.
+        std::vector<LPCWSTR> args;
+        getArgs(i, args);
+        dxcutil::DxcPermutationScan scan;
+        bool hasDiagnostics = false;
+        bool scanned = false;
+        try {
+          scanned = ScanPermutation(pSource, args.data(), args.size(),
+                                    pSharedHandler, scan, hasDiagnostics);
+        } catch (...) {
+          scanned = false;
+        }
+        classes[i] = scanned
+                         ? classifier.AddScan(defineMaps[i], scan, hasDiagnostics)
+                         : classifier.AddUnshared();
+      }
+
+      unsigned classCount = classifier.GetClassCount();
+      std::vector<std::vector<UINT32>> members(classCount);
+      for (UINT32 i = 0; i < defineSetCount; ++i)
+        members[classes[i]].push_back(i);
+
+      std::mutex callbackMutex;
+      HRESULT hr = RunOnThreads(classCount, threadCount, [&](UINT32 c) {
+        std::vector<LPCWSTR> args;
+        getArgs(members[c].front(), args);
+        CComPtr<IDxcResult> pResult;
+        IFR(Compile(pSource, args.data(), args.size(), pSharedHandler,
+                    IID_PPV_ARGS(&pResult)));
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        for (UINT32 i : members[c])
+          IFR(pCallback->OnCompileComplete(i, pResult));
+        return S_OK;
+      });
+      if (pCompileCount != nullptr)
+        *pCompileCount = classCount;
+      return hr;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // IDxcCompilerCache
+  HRESULT STDMETHODCALLTYPE SetCacheDirectory(_In_opt_z_ LPCWSTR pDirectory) override {
+    return m_CompileCache.SetDirectory(pDirectory);
+  }
+  HRESULT STDMETHODCALLTYPE SetEvictionPolicy(_In_ UINT32 MaxEntries, _In_ UINT64 MaxSizeInBytes) override {
+    m_CompileCache.SetEvictionPolicy(MaxEntries, MaxSizeInBytes);
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE Clear() override {
+    DxcThreadMalloc TM(m_pMalloc);
+    return m_CompileCache.Clear();
+  }
+  HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ UINT32 *pHits, _Out_ UINT32 *pMisses) override {
+    if (pHits == nullptr || pMisses == nullptr)
+      return E_INVALIDARG;
+    m_CompileCache.GetStatistics(pHits, pMisses);
+    return S_OK;
+  }
+
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
     HRESULT hr = DoBasicQueryInterface<
       IDxcCompiler3,
+      IDxcCompilerCache,
+      IDxcCompilerBatch,
+      IDxcCompilerPermutations,
+      IDxcCompilerDiagnostics,
+      IDxcCompilerCancellation,
+      IDxcCompilerStreamingDisassembly,
       IDxcLangExtensions,
       IDxcLangExtensions2,
       IDxcLangExtensions3,
@@ -606,6 +1162,48 @@ public:
     _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
     _In_ REFIID riid, _Out_ LPVOID *ppResult      // IDxcResult: status, buffer, and errors
   ) override {
+    return CompileImpl(pSource, pArguments, argCount, pIncludeHandler, nullptr,
+                       nullptr, 0, riid, ppResult);
+  }
+
+  // IDxcCompilerDiagnostics
+  HRESULT STDMETHODCALLTYPE CompileWithDiagnostics(
+    _In_ const DxcBuffer *pSource,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ IDxcDiagnosticSink *pSink,
+    _In_ REFIID riid, _Out_ LPVOID *ppResult
+  ) override {
+    if (pSink == nullptr)
+      return E_INVALIDARG;
+    return CompileImpl(pSource, pArguments, argCount, pIncludeHandler, pSink,
+                       nullptr, 0, riid, ppResult);
+  }
+
+  // IDxcCompilerCancellation
+  HRESULT STDMETHODCALLTYPE CompileWithCancellation(
+    _In_ const DxcBuffer *pSource,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_opt_ IDxcCancellationToken *pToken,
+    _In_ UINT32 timeoutMs,
+    _In_ REFIID riid, _Out_ LPVOID *ppResult
+  ) override {
+    return CompileImpl(pSource, pArguments, argCount, pIncludeHandler, nullptr,
+                       pToken, timeoutMs, riid, ppResult);
+  }
+
+  HRESULT CompileImpl(
+    _In_ const DxcBuffer *pSource,
+    _In_opt_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_opt_ IDxcDiagnosticSink *pSink,
+    _In_opt_ IDxcCancellationToken *pToken,
+    _In_ UINT32 timeoutMs,
+    _In_ REFIID riid, _Out_ LPVOID *ppResult) {
     if (pSource == nullptr || ppResult == nullptr ||
         (argCount > 0 && pArguments == nullptr))
       return E_INVALIDARG;
@@ -623,9 +1221,15 @@ public:
     bool bPreprocessStarted = false;
     DxilShaderHash ShaderHashContent;
     DxcThreadMalloc TM(m_pMalloc);
+    DxcThreadMemoryBudget budget;
 
     try {
       DefaultFPEnvScope fpEnvScope;
+      // Checks throw E_ABORT out of the pass managers, the parser and long
+      // loops such as unrolling; caught below like any other hlsl::Exception.
+      Optional<DxcCompileCancellation> cancellation;
+      if (pToken != nullptr || timeoutMs != 0)
+        cancellation.emplace(pToken, timeoutMs);
 
       IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
 
@@ -651,8 +1255,38 @@ public:
         }
       }
 
+      // Going over the limit fails allocations, which unwinds the compile as
+      // out of memory. The arena, when enabled, carves its chunks out of the
+      // budget.
+      if (opts.MemoryStatistics || opts.CompileStats)
+        budget.Install((uint64_t)opts.MemoryLimitMB << 20);
+
+      // Everything allocated from here on dies with the compile, except the
+      // outputs, which are copied off the arena before returning.
+      DxcThreadArena arena(opts.CompileArena);
+
+      // Count allocations by phase and pass for the compile statistics. The
+      // profile goes over the arena so that it sees every allocation.
+      DxcThreadAllocProfile allocProfile;
+      if (opts.CompileStats)
+        allocProfile.Install();
+
+      // Record the phases and passes run on this thread from here on.
+      std::unique_ptr<dxcutil::DxcTimeReport> timeReport;
+      if (opts.TimeReport)
+        timeReport.reset(new dxcutil::DxcTimeReport());
+      std::unique_ptr<dxcutil::DxcAllocReport> allocReport;
+      if (allocProfile.GetProfile())
+        allocReport.reset(new dxcutil::DxcAllocReport(allocProfile));
+      std::unique_ptr<dxcutil::DxcTraceListener> trace;
+      std::shared_ptr<DxilCompileStats> compileStats;
+      if (opts.CompileStats)
+        compileStats = std::make_shared<DxilCompileStats>();
+
       bool isPreprocessing = !opts.Preprocess.empty();
-      if (isPreprocessing) {
+      // Preprocessor-only requests that run no code generation.
+      bool isPreprocessorOnly = isPreprocessing || opts.EmitPTH || opts.EmitDependencies;
+      if (isPreprocessing || opts.EmitDependencies) {
         DxcEtw_DXCompilerPreprocess_Start();
         bPreprocessStarted = true;
       } else {
@@ -677,13 +1311,25 @@ public:
                             CP_UTF8);
       LPCWSTR pObjectName = (!isPreprocessing && opts.OutputObject.empty()) ?
                             nullptr : pUtf16OutputName.m_psz;
-      IFT(primaryOutput.SetName(pObjectName));
+      if (opts.EmitDependencies) {
+        IFT(primaryOutput.SetName(opts.OutputDependenciesFile));
+      } else {
+        IFT(primaryOutput.SetName(pObjectName));
+      }
 
       // Wrap source in blob
       CComPtr<IDxcBlobEncoding> pSourceEncoding;
-      IFT(hlsl::DxcCreateBlob(pSource->Ptr, pSource->Size,
-        true, false, pSource->Encoding != 0, pSource->Encoding,
-        nullptr, &pSourceEncoding));
+      if (opts.FromHLModule) {
+        // A high-level module is bitcode. Copy it whole, past any trailing
+        // zero padding, and terminate it the way the text paths expect.
+        std::string module((const char *)pSource->Ptr, pSource->Size);
+        IFT(hlsl::DxcCreateBlob(module.c_str(), module.size() + 1,
+          false, true, true, CP_UTF8, m_pMalloc, &pSourceEncoding));
+      } else {
+        IFT(hlsl::DxcCreateBlob(pSource->Ptr, pSource->Size,
+          true, false, pSource->Encoding != 0, pSource->Encoding,
+          nullptr, &pSourceEncoding));
+      }
 
  #ifdef ENABLE_SPIRV_CODEGEN
       // We want to embed the preprocessed source code in the final SPIR-V if
@@ -691,7 +1337,7 @@ public:
       // first for such case. Then we invoke the compilation process over the
       // preprocessed source code, so that line numbers are consistent with the
       // embedded source code.
-      if (!isPreprocessing && opts.GenSPIRV && opts.DebugInfo) {
+      if (!isPreprocessorOnly && opts.GenSPIRV && opts.DebugInfo) {
         CComPtr<IDxcResult> pSrcCodeResult;
         std::vector<LPCWSTR> PreprocessArgs;
         PreprocessArgs.reserve(argCount + 1);
@@ -711,6 +1357,32 @@ public:
       // Convert source code encoding
       IFC(hlsl::DxcGetBlobAsUtf8(pSourceEncoding, m_pMalloc, &utf8Source));
 
+      // Trace events of the phases and passes run from here on.
+      if (dxcutil::DxcTraceListener::IsEnabled())
+        trace.reset(new dxcutil::DxcTraceListener(
+            pUtf8SourceName, pUtf8EntryPoint,
+            llvm::StringRef(utf8Source->GetStringPointer(),
+                            utf8Source->GetStringLength()),
+            opts.Args));
+
+      llvm::StringRef cacheDirectory;
+      llvm::MD5::MD5Result cacheKey;
+      // A cached result would not report its diagnostics to the sink.
+      bool useCache = pSink == nullptr &&
+                      ComputeCacheKey(opts, utf8Source, cacheDirectory, cacheKey);
+      if (useCache && m_CompileCache.Lookup(cacheDirectory, cacheKey,
+                                            pIncludeHandler, pResult)) {
+        if (timeReport)
+          IFT(SetTimeReportOutput(pResult, *timeReport, opts.OutputTimeReportFile));
+        if (opts.MemoryStatistics)
+          IFT(SetMemoryStatisticsOutput(pResult, budget));
+        if (arena.GetArena())
+          IFT(pResult->CopyOutputsOffArena(arena, m_pMalloc));
+        IFT(pResult->QueryInterface(riid, ppResult));
+        hr = S_OK;
+        goto Cleanup;
+      }
+
       CComPtr<IDxcBlob> pOutputBlob;
       dxcutil::DxcArgsFileSystem *msfPtr =
         dxcutil::CreateDxcArgsFileSystem(utf8Source, pUtf16SourceName.m_psz, pIncludeHandler);
@@ -726,11 +1398,17 @@ public:
         primaryOutput.kind = DXC_OUT_TEXT;
       else if (isPreprocessing)
         primaryOutput.kind = DXC_OUT_HLSL;
+      else if (opts.EmitDependencies)
+        primaryOutput.kind = DXC_OUT_DEPENDENCIES;
 
       IFT(pResult->SetOutputName(DXC_OUT_REFLECTION, opts.OutputReflectionFile));
       IFT(pResult->SetOutputName(DXC_OUT_SHADER_HASH, opts.OutputShaderHashFile));
       IFT(pResult->SetOutputName(DXC_OUT_ERRORS, opts.OutputWarningsFile));
       IFT(pResult->SetOutputName(DXC_OUT_ROOT_SIGNATURE, opts.OutputRootSigFile));
+      IFT(pResult->SetOutputName(DXC_OUT_FUNCTION_FINGERPRINTS, opts.OutputFingerprintsFile));
+      if (!opts.EmitDependencies) {
+        IFT(pResult->SetOutputName(DXC_OUT_DEPENDENCIES, opts.OutputDependenciesFile));
+      }
 
       if (opts.DisplayIncludeProcess)
         msfPtr->EnableDisplayIncludeProcess();
@@ -747,14 +1425,27 @@ public:
 
       // Setup a compiler instance.
       raw_stream_ostream outStream(pOutputStream.p);
-      llvm::LLVMContext llvmContext; // LLVMContext should outlive CompilerInstance
+      // LLVMContext should outlive CompilerInstance
+      dxcutil::DxcContextPool::Lease contextLease(
+          opts.ReuseContext ? &m_ContextPool : nullptr, m_pMalloc);
+      llvm::LLVMContext &llvmContext = contextLease.get();
       std::unique_ptr<llvm::Module> debugModule;
       CComPtr<AbstractMemoryStream> pReflectionStream;
+      CComPtr<IDxcBlob> pTokenCache; // must outlive the compiler instance
       CompilerInstance compiler;
       std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
           llvm::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
-      SetupCompilerForCompile(compiler, &m_langExtensionsHelper, pUtf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
+      DxcDiagnosticSinkConsumer diagConsumer(*diagPrinter, pSink);
+      SetupCompilerForCompile(compiler, &m_langExtensionsHelper, pUtf8SourceName, &diagConsumer, defines, opts, pArguments, argCount);
+      diagConsumer.SetDiagnostics(&compiler.getDiagnostics());
       msfPtr->SetupForCompilerInstance(compiler);
+      // Hand the source to clang in place; reading it back through the file
+      // system would copy it. utf8Source outlives the compiler instance.
+      compiler.getPreprocessorOpts().addRemappedFile(
+          pUtf8SourceName,
+          llvm::MemoryBuffer::getMemBuffer(Data, pUtf8SourceName).release());
+      if (!opts.IncludePTH.empty())
+        SetupTokenCache(compiler, opts.IncludePTH, pIncludeHandler, &pTokenCache);
 
       // The clang entry point (cc1_main) would now create a compiler invocation
       // from arguments, but depending on the Preprocess option, we either compile
@@ -791,10 +1482,34 @@ public:
 
         FrontendInputFile file(pUtf8SourceName, IK_HLSL);
         clang::PrintPreprocessedAction action;
+        llvm::PhaseTimingRegion preprocessPhase("Preprocess");
+        if (action.BeginSourceFile(compiler, file)) {
+          action.Execute();
+          action.EndSourceFile();
+        }
+        outStream.flush();
+      } else if (opts.EmitPTH) {
+        FrontendInputFile file(pUtf8SourceName, IK_HLSL);
+        SmallString<4096> tokenCache;
+        GeneratePTHToBufferAction action(tokenCache);
+        if (action.BeginSourceFile(compiler, file)) {
+          action.Execute();
+          action.EndSourceFile();
+        }
+        outStream << tokenCache;
+        outStream.flush();
+      } else if (opts.EmitDependencies) {
+        // Run the preprocessor over the source for the files it includes,
+        // without parsing or printing the tokens.
+        FrontendInputFile file(pUtf8SourceName, IK_HLSL);
+        clang::PreprocessOnlyAction action;
+        llvm::PhaseTimingRegion preprocessPhase("Preprocess");
         if (action.BeginSourceFile(compiler, file)) {
           action.Execute();
           action.EndSourceFile();
         }
+        WriteDependencies(outStream, opts.OutputObject.empty() ? pUtf8SourceName : opts.OutputObject,
+                          pUtf8SourceName, msfPtr);
         outStream.flush();
       } else {
         compiler.getLangOpts().HLSLEntryFunction =
@@ -818,8 +1533,11 @@ public:
 
         // NOTE: this calls the validation component from dxil.dll; the built-in
         // validator can be used as a fallback.
-        produceFullContainer = !opts.CodeGenHighLevel && !opts.AstDump && !opts.OptDump && rootSigMajor == 0;
-        needsValidation = produceFullContainer && !opts.DisableValidation;
+        produceFullContainer = !opts.CodeGenHighLevel && !opts.SyntaxOnly && !opts.EmitHLModule && !opts.AstDump && !opts.OptDump && rootSigMajor == 0;
+        // Specialization constant placeholders are not valid DXIL until the
+        // module is specialized.
+        needsValidation = produceFullContainer && !opts.DisableValidation &&
+                          !opts.SpecConstants;
 
         if (compiler.getCodeGenOpts().HLSLProfile == "lib_6_x") {
           // Currently do not support stripping reflection from offline linking target.
@@ -892,7 +1610,7 @@ public:
       }
       // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
-      else if (!isPreprocessing && opts.GenSPIRV) {
+      else if (!isPreprocessorOnly && opts.GenSPIRV) {
         // Since SpirvOptions is passed to the SPIR-V CodeGen as a whole
         // structure, we need to copy a few non-spirv-specific options into the
         // structure.
@@ -915,9 +1633,20 @@ public:
       }
 #endif
       // SPIRV change ends
-      else if (!isPreprocessing) {
+      else if (!isPreprocessorOnly) {
+        std::shared_ptr<DxilIncrementalLib> incrementalLib;
+        CComPtr<IDxcBlob> pReuseLib;
+        if (!opts.CodeGenHighLevel && !opts.SyntaxOnly &&
+            (!opts.OutputFingerprintsFile.empty() ||
+             !opts.ReuseLibFile.empty())) {
+          incrementalLib = SetupIncrementalLib(compiler, opts, pIncludeHandler,
+                                               &pReuseLib);
+          compiler.getCodeGenOpts().HLSLIncrementalLib = incrementalLib;
+        }
+        compiler.getCodeGenOpts().HLSLCompileStats = compileStats;
         EmitBCAction action(&llvmContext);
-        FrontendInputFile file(pUtf8SourceName, IK_HLSL);
+        FrontendInputFile file(pUtf8SourceName,
+                               opts.FromHLModule ? IK_LLVM_IR : IK_HLSL);
         bool compileOK;
         if (action.BeginSourceFile(compiler, file)) {
           action.Execute();
@@ -929,6 +1658,30 @@ public:
         }
         outStream.flush();
 
+        // Only the diagnostics are wanted from a syntax check.
+        if (opts.SyntaxOnly) {
+          pOutputStream.Release();
+          IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+          pOutputBlob.Release();
+          IFT(pOutputStream.QueryInterface(&pOutputBlob));
+        }
+
+        // Bring back the functions the backend dropped for reuse, and replace
+        // the bitcode written for the partial library with the linked one.
+        std::unique_ptr<llvm::Module> linkedModule;
+        if (compileOK && incrementalLib && !incrementalLib->Reused.empty()) {
+          linkedModule = LinkReusedLibrary(compiler, opts, action.takeModule(),
+                                           pReuseLib, *incrementalLib);
+          compileOK = linkedModule != nullptr;
+          if (compileOK) {
+            pOutputStream.Release();
+            IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+            raw_stream_ostream linkedStream(pOutputStream.p);
+            WriteBitcodeToFile(linkedModule.get(), linkedStream);
+            linkedStream.flush();
+          }
+        }
+
         SerializeDxilFlags SerializeFlags = SerializeDxilFlags::None;
         if (opts.EmbedPDBName()) {
           SerializeFlags |= SerializeDxilFlags::IncludeDebugNamePart;
@@ -956,16 +1709,28 @@ public:
         if (opts.StripRootSignature) {
           SerializeFlags |= SerializeDxilFlags::StripRootSignature;
         }
+        if (opts.CompressLibraryBitcode) {
+          SerializeFlags |= SerializeDxilFlags::CompressLibraryBitcode;
+        }
 
         // Don't do work to put in a container if an error has occurred
         // Do not create a container when there is only a a high-level representation in the module.
-        if (compileOK && !opts.CodeGenHighLevel) {
+        if (compileOK && !opts.CodeGenHighLevel && !opts.SyntaxOnly &&
+            !opts.EmitHLModule) {
           HRESULT valHR = S_OK;
           CComPtr<AbstractMemoryStream> pRootSigStream;
-          IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pReflectionStream));
-          IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pRootSigStream));
+          // Outputs are allocated where the result is returned, so they
+          // aren't copied off the arena.
+          IFT(CreateMemoryStream(m_pMalloc, &pReflectionStream));
+          IFT(CreateMemoryStream(m_pMalloc, &pRootSigStream));
+
+          std::unique_ptr<llvm::Module> serializeModule(
+              linkedModule ? std::move(linkedModule) : action.takeModule());
 
-          std::unique_ptr<llvm::Module> serializeModule( action.takeModule() );
+          // Read before serialization strips the debug locations.
+          if (opts.LineStats)
+            IFT(SetLineStatsOutput(pResult, *serializeModule,
+                                   opts.OutputLineStatsFile));
 
           // Clone and save the copy.
           if (opts.GenerateFullDebugInfo()) {
@@ -977,6 +1742,9 @@ public:
                 pOutputStream,
                 opts.GetPDBName(), &compiler.getDiagnostics(),
                 &ShaderHashContent, pReflectionStream, pRootSigStream);
+          inputs.ValidationThreads = opts.ParallelFunctionThreads;
+          inputs.SerializationThreads = opts.ParallelFunctionThreads;
+          inputs.pDebugModule = debugModule.get();
 
           if (needsValidation) {
             valHR = dxcutil::ValidateAndAssembleToContainer(inputs);
@@ -1024,8 +1792,27 @@ public:
             CComPtr<IDxcBlob> pHashBlob;
             IFT(hlsl::DxcCreateBlobOnHeapCopy(&ShaderHashContent, (UINT32)sizeof(ShaderHashContent), &pHashBlob));
             IFT(pResult->SetOutputObject(DXC_OUT_SHADER_HASH, pHashBlob));
+            if (incrementalLib) {
+              CComPtr<AbstractMemoryStream> pFingerprintsStream;
+              IFT(CreateMemoryStream(m_pMalloc, &pFingerprintsStream));
+              raw_stream_ostream fingerprintsStream(pFingerprintsStream.p);
+              incrementalLib->Current.Save(fingerprintsStream);
+              fingerprintsStream.flush();
+              CComPtr<IDxcBlob> pFingerprints;
+              IFT(pFingerprintsStream->QueryInterface(&pFingerprints));
+              IFT(pResult->SetOutputObject(DXC_OUT_FUNCTION_FINGERPRINTS, pFingerprints));
+            }
           } // SUCCEEDED(valHR)
-        } // compileOK && !opts.CodeGenHighLevel
+        } // compileOK && !opts.CodeGenHighLevel && !opts.EmitHLModule
+      }
+
+      if (!opts.EmitDependencies && !opts.OutputDependenciesFile.empty()) {
+        std::string dependencies;
+        raw_string_ostream dependenciesStream(dependencies);
+        WriteDependencies(dependenciesStream, opts.OutputObject.empty() ? pUtf8SourceName : opts.OutputObject,
+                          pUtf8SourceName, msfPtr);
+        dependenciesStream.flush();
+        IFT(pResult->SetOutputString(DXC_OUT_DEPENDENCIES, dependencies.c_str(), dependencies.size()));
       }
 
       // Add std err to warnings.
@@ -1115,19 +1902,61 @@ public:
         } // PDB in private
       } // Write PDB
 
+      if (!hasErrorOccurred)
+        contextLease.SetReusable();
       IFT(primaryOutput.SetObject(pOutputBlob, opts.DefaultTextCodePage));
       IFT(pResult->SetOutput(primaryOutput));
-      IFT(pResult->SetStatusAndPrimaryResult(hasErrorOccurred ? E_FAIL : S_OK, primaryOutput.kind));
+      HRESULT status = hasErrorOccurred ? E_FAIL : S_OK;
+      if (FAILED(diagConsumer.GetAbortStatus()))
+        status = diagConsumer.GetAbortStatus();
+      IFT(pResult->SetStatusAndPrimaryResult(status, primaryOutput.kind));
+      // Kept in the cache with the other outputs, so a hit reports the
+      // compile that stored it.
+      if (compileStats && allocReport)
+        allocReport->AddToStats(*compileStats);
+      if (compileStats)
+        IFT(SetCompileStatsOutput(pResult, *compileStats, budget,
+                                  opts.OutputCompileStatsFile));
+      if (useCache && !hasErrorOccurred)
+        m_CompileCache.Store(cacheDirectory, cacheKey, msfPtr, pResult);
+      // Added after storing, so a cached result never carries stale timings.
+      if (timeReport)
+        IFT(SetTimeReportOutput(pResult, *timeReport, opts.OutputTimeReportFile));
+      if (opts.MemoryStatistics)
+        IFT(SetMemoryStatisticsOutput(pResult, budget));
+      if (arena.GetArena())
+        IFT(pResult->CopyOutputsOffArena(arena, m_pMalloc));
       IFT(pResult->QueryInterface(riid, ppResult));
 
       hr = S_OK;
     } catch (std::bad_alloc &) {
       hr = E_OUTOFMEMORY;
+      if (budget.Exceeded()) {
+        // The compile went over its limit rather than running the process
+        // out of memory; with the budget released there is room to report it.
+        budget.Release();
+        DxcMemoryStatistics stats = {};
+        stats.PeakBytes = budget.GetPeakBytes();
+        stats.LimitBytes = budget.GetLimitBytes();
+        std::string msg("error: compilation exceeded the memory limit of ");
+        msg += std::to_string(stats.LimitBytes >> 20);
+        msg += " MB\n";
+        CComPtr<IDxcResult> pResult;
+        if (SUCCEEDED(DxcResult::Create(E_OUTOFMEMORY, DXC_OUT_NONE, {
+                DxcOutputObject::ErrorOutput(CP_UTF8, msg.c_str(), msg.size()),
+                DxcOutputObject::DataOutput(DXC_OUT_MEMORY_STATISTICS,
+                                            &stats, sizeof(stats), DxcOutNoName)
+              }, &pResult)) &&
+            SUCCEEDED(pResult->QueryInterface(riid, ppResult))) {
+          hr = S_OK;
+        }
+      }
     } catch (hlsl::Exception &e) {
       _Analysis_assume_(DXC_FAILED(e.hr));
       CComPtr<IDxcResult> pResult;
       hr = e.hr;
-      std::string msg("Internal Compiler error: ");
+      // A cancelled compile is not a compiler error.
+      std::string msg(e.hr == E_ABORT ? "" : "Internal Compiler error: ");
       msg += e.msg;
       if (SUCCEEDED(DxcResult::Create(e.hr, DXC_OUT_NONE, {
               DxcOutputObject::ErrorOutput(CP_UTF8,
@@ -1176,16 +2005,22 @@ public:
       ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
       IFTLLVM(pts.error_code());
 
-      std::string StreamStr;
-      raw_string_ostream Stream(StreamStr);
+      // Written straight into the memory of the result.
+      CComPtr<AbstractMemoryStream> pDisassemblyStream;
+      IFT(CreateMemoryStream(m_pMalloc, &pDisassemblyStream));
+      raw_stream_ostream Stream(pDisassemblyStream.p);
 
       CComPtr<IDxcBlobEncoding> pProgram;
       IFT(hlsl::DxcCreateBlob(pObject->Ptr, pObject->Size, true, false, false, 0, nullptr, &pProgram))
       IFC(dxcutil::Disassemble(pProgram, Stream));
+      Stream.flush();
 
+      CComPtr<IDxcBlobEncoding> pDisassembly;
+      IFT(hlsl::DxcCreateBlobFromMemoryStream(pDisassemblyStream, m_pMalloc,
+                                              true, CP_UTF8, &pDisassembly));
       IFT(DxcResult::Create(S_OK, DXC_OUT_DISASSEMBLY, {
-          DxcOutputObject::StringOutput(DXC_OUT_DISASSEMBLY,
-            CP_UTF8, StreamStr.c_str(), StreamStr.size(), DxcOutNoName)
+          DxcOutputObject::DataOutput(DXC_OUT_DISASSEMBLY, CP_UTF8,
+                                      pDisassembly)
         }, &pResult));
       IFT(pResult->QueryInterface(riid, ppResult));
 
@@ -1210,9 +2045,325 @@ public:
     return hr;
   }
 
+  // IDxcCompilerStreamingDisassembly
+  HRESULT STDMETHODCALLTYPE DisassembleToStream(
+    _In_ const DxcBuffer *pObject,
+    _In_opt_z_ LPCWSTR pFunctionName,
+    _In_ UINT32 threadCount,
+    _In_ IStream *pOutput,
+    _In_ REFIID riid, _Out_ LPVOID *ppResult
+  ) override {
+    if (pObject == nullptr || pOutput == nullptr || ppResult == nullptr)
+      return E_INVALIDARG;
+    if (!(IsEqualIID(riid, __uuidof(IDxcResult)) ||
+          IsEqualIID(riid, __uuidof(IDxcOperationResult))))
+      return E_INVALIDARG;
+
+    *ppResult = nullptr;
+    CComPtr<IDxcResult> pResult;
+
+    HRESULT hr = S_OK;
+    DxcEtw_DXCompilerDisassemble_Start();
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      DefaultFPEnvScope fpEnvScope;
+
+      ::llvm::sys::fs::MSFileSystem *msfPtr;
+      IFT(CreateMSFileSystemForDisk(&msfPtr));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+      std::string functionName;
+      if (pFunctionName) {
+        CW2A utf8FunctionName(pFunctionName, CP_UTF8);
+        functionName = utf8FunctionName.m_psz;
+      }
+
+      CComPtr<IDxcBlobEncoding> pProgram;
+      IFT(hlsl::DxcCreateBlob(pObject->Ptr, pObject->Size, true, false, false, 0, nullptr, &pProgram))
+      raw_istream_ostream Stream(pOutput);
+      HRESULT disassembleHR =
+          dxcutil::Disassemble(pProgram, Stream, threadCount, functionName);
+      IFTBOOLMSG(disassembleHR != E_INVALIDARG || functionName.empty(),
+                 E_INVALIDARG,
+                 "function '" + functionName + "' not found in program");
+      IFC(disassembleHR);
+      Stream.flush();
+
+      IFT(DxcResult::Create(S_OK, DXC_OUT_NONE, {}, &pResult));
+      IFT(pResult->QueryInterface(riid, ppResult));
+
+      return S_OK;
+    } catch (std::bad_alloc &) {
+      hr = E_OUTOFMEMORY;
+    } catch (hlsl::Exception &e) {
+      _Analysis_assume_(DXC_FAILED(e.hr));
+      hr = e.hr;
+      if (SUCCEEDED(DxcResult::Create(e.hr, DXC_OUT_NONE, {
+              DxcOutputObject::ErrorOutput(CP_UTF8,
+                e.msg.c_str(), e.msg.size())
+            }, &pResult)) &&
+          SUCCEEDED(pResult->QueryInterface(riid, ppResult))) {
+        hr = S_OK;
+      }
+    } catch (...) {
+      hr = E_FAIL;
+    }
+  Cleanup:
+    DxcEtw_DXCompilerDisassemble_Stop(hr);
+    return hr;
+  }
+
+  // Returns false if the outputs requested by arguments record more of a
+  // permutation than the tokens it preprocesses to: debug information and
+  // source hashes include the defines, and dependencies include files that
+  // contribute no tokens. Invalid arguments are reported by the compiles.
+  bool CanSharePermutations(_In_opt_count_(argCount) LPCWSTR *pArguments,
+                            UINT32 argCount) {
+    int argCountInt;
+    IFT(UIntToInt(argCount, &argCountInt));
+    hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+    hlsl::options::DxcOpts opts;
+    CComPtr<AbstractMemoryStream> pOptionErrorStream;
+    IFT(CreateMemoryStream(m_pMalloc, &pOptionErrorStream));
+    CComPtr<IDxcOperationResult> pOptionsResult;
+    bool finished = false;
+    dxcutil::ReadOptsAndValidate(mainArgs, opts, pOptionErrorStream,
+                                 &pOptionsResult, finished);
+    if (finished)
+      return false;
+    return !opts.GeneratePDB() && !opts.DebugNameForSource &&
+           !opts.EmitDependencies && opts.OutputDependenciesFile.empty();
+  }
+
+  // Runs the preprocessor alone over a permutation, as Compile would set it
+  // up. Returns false if the arguments are invalid.
+  bool ScanPermutation(_In_ const DxcBuffer *pSource,
+                       _In_count_(argCount) LPCWSTR *pArguments,
+                       UINT32 argCount,
+                       _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                       dxcutil::DxcPermutationScan &scan, bool &hasDiagnostics) {
+    int argCountInt;
+    IFT(UIntToInt(argCount, &argCountInt));
+    hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+    hlsl::options::DxcOpts opts;
+    {
+      CComPtr<AbstractMemoryStream> pOptionErrorStream;
+      IFT(CreateMemoryStream(m_pMalloc, &pOptionErrorStream));
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      bool finished = false;
+      dxcutil::ReadOptsAndValidate(mainArgs, opts, pOptionErrorStream,
+                                   &pOptionsResult, finished);
+      if (finished)
+        return false;
+    }
+
+    CComPtr<IDxcBlobEncoding> pSourceEncoding;
+    IFT(hlsl::DxcCreateBlob(pSource->Ptr, pSource->Size,
+      true, false, pSource->Encoding != 0, pSource->Encoding,
+      nullptr, &pSourceEncoding));
+    CComPtr<IDxcBlobUtf8> utf8Source;
+    IFT(hlsl::DxcGetBlobAsUtf8(pSourceEncoding, m_pMalloc, &utf8Source));
+
+    const char *pUtf8SourceName = opts.InputFile.empty() ? "hlsl.hlsl" : opts.InputFile.data();
+    CA2W pUtf16SourceName(pUtf8SourceName, CP_UTF8);
+    dxcutil::DxcArgsFileSystem *msfPtr =
+      dxcutil::CreateDxcArgsFileSystem(utf8Source, pUtf16SourceName.m_psz, pIncludeHandler);
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+    IFT(msfPtr->CreateStdStreams(m_pMalloc));
+
+    std::vector<std::string> defines;
+    CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
+
+    std::string warnings;
+    raw_string_ostream w(warnings);
+    CompilerInstance compiler;
+    std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
+        llvm::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
+    SetupCompilerForCompile(compiler, &m_langExtensionsHelper, pUtf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
+    msfPtr->SetupForCompilerInstance(compiler);
+    StringRef Data(utf8Source->GetStringPointer(),
+                   utf8Source->GetStringLength());
+    compiler.getPreprocessorOpts().addRemappedFile(
+        pUtf8SourceName,
+        llvm::MemoryBuffer::getMemBuffer(Data, pUtf8SourceName).release());
+
+    FrontendInputFile file(pUtf8SourceName, IK_HLSL);
+    dxcutil::DxcPermutationScanAction action(scan);
+    if (!action.BeginSourceFile(compiler, file))
+      return false;
+    action.Execute();
+    action.EndSourceFile();
+    DiagnosticsEngine &diags = compiler.getDiagnostics();
+    hasDiagnostics = diags.hasErrorOccurred() || diags.getNumWarnings() > 0;
+    return true;
+  }
+
+  // Loads the token cache named by -include-pth through the include handler.
+  // The blob is handed to the preprocessor as-is, since the usual source text
+  // conversion would corrupt it.
+  void SetupTokenCache(CompilerInstance &compiler, StringRef name,
+                       _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                       _Outptr_result_maybenull_ IDxcBlob **ppTokenCache) {
+    CA2W pUtf16Name(name.data(), CP_UTF8);
+    CComPtr<IDxcBlob> pTokenCache;
+    if (pIncludeHandler == nullptr ||
+        FAILED(pIncludeHandler->LoadSource(pUtf16Name, &pTokenCache)) ||
+        pTokenCache == nullptr) {
+      compiler.getDiagnostics().Report(diag::err_invalid_pth_file) << name;
+      return;
+    }
+    clang::PreprocessorOptions &PPOpts(compiler.getPreprocessorOpts());
+    PPOpts.TokenCache = PPOpts.ImplicitPTHInclude = name;
+    PPOpts.addRemappedFile(
+        name, llvm::MemoryBuffer::getMemBuffer(
+                  StringRef((const char *)pTokenCache->GetBufferPointer(),
+                            pTokenCache->GetBufferSize()),
+                  name, /*RequiresNullTerminator*/ false).release());
+    *ppTokenCache = pTokenCache.Detach();
+  }
+
+  // Prepares the fingerprinting of library functions for -Ffp, and loads
+  // the -reuse-lib library and its fingerprints through the include handler.
+  // Reuse is skipped with a warning when the libraries could not be linked
+  // back together as compiled.
+  std::shared_ptr<DxilIncrementalLib>
+  SetupIncrementalLib(CompilerInstance &compiler,
+                      const hlsl::options::DxcOpts &opts,
+                      _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                      _Outptr_result_maybenull_ IDxcBlob **ppReuseLib) {
+    *ppReuseLib = nullptr;
+    std::shared_ptr<DxilIncrementalLib> incrementalLib =
+        std::make_shared<DxilIncrementalLib>();
+
+    // Everything besides the module that decides the generated code: the
+    // compiler, and the options other than inputs, outputs and ones that
+    // only change how the compiler runs.
+    raw_string_ostream context(incrementalLib->Context);
+    context << RC_FILE_VERSION;
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+    context << ' ' << getGitCommitHash();
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+    unsigned valMajor, valMinor;
+    dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+    context << ' ' << valMajor << '.' << valMinor << ' '
+            << (DxilLibIsEnabled() ? 1u : 0u);
+    for (const llvm::opt::Arg *A : opts.Args) {
+      const llvm::opt::Option &O = A->getOption();
+      if (O.matches(options::OPT_INPUT) || O.matches(options::OPT_Fo) ||
+          O.matches(options::OPT_Fc) || O.matches(options::OPT_Fh) ||
+          O.matches(options::OPT_Fe) || O.matches(options::OPT_Fre) ||
+          O.matches(options::OPT_Frs) || O.matches(options::OPT_Fsh) ||
+          O.matches(options::OPT_Ftr) || O.matches(options::OPT_Ffp) ||
+          O.matches(options::OPT_Fst) || O.matches(options::OPT_Fls) ||
+          O.matches(options::OPT_reuse_lib) ||
+          O.matches(options::OPT_reuse_lib_fingerprints) ||
+          O.matches(options::OPT_compile_cache) ||
+          O.matches(options::OPT_compile_arena) ||
+          O.matches(options::OPT_reuse_context) ||
+          O.matches(options::OPT_memory_limit) ||
+          O.matches(options::OPT_ftime_report) ||
+          O.matches(options::OPT_fcompile_stats) ||
+          O.matches(options::OPT_fline_stats) ||
+          O.matches(options::OPT_opt_parallel_functions))
+        continue;
+      context << ' ' << A->getAsString(opts.Args);
+    }
+    for (const std::string &define : m_langExtensionsHelper.GetDefines())
+      context << ' ' << define;
+    context << ' ' << m_langExtensionsHelper.GetTargetTriple();
+    context.flush();
+
+    if (opts.ReuseLibFile.empty())
+      return incrementalLib;
+
+    DiagnosticsEngine &diags = compiler.getDiagnostics();
+    if (opts.DebugInfo || !opts.Exports.empty() ||
+        !m_langExtensionsHelper.GetIntrinsicTables().empty()) {
+      diags.Report(diags.getCustomDiagID(
+          DiagnosticsEngine::Warning,
+          "-reuse-lib is ignored with debug information, -exports or "
+          "intrinsic extensions; all functions are compiled"));
+      return incrementalLib;
+    }
+
+    auto loadBlob = [&](StringRef name, IDxcBlob **ppBlob) {
+      CA2W pUtf16Name(name.data(), CP_UTF8);
+      return pIncludeHandler != nullptr &&
+             SUCCEEDED(pIncludeHandler->LoadSource(pUtf16Name, ppBlob)) &&
+             *ppBlob != nullptr;
+    };
+    CComPtr<IDxcBlob> pReuseLib;
+    CComPtr<IDxcBlob> pFingerprints;
+    std::unique_ptr<DxilFunctionFingerprints> previous =
+        llvm::make_unique<DxilFunctionFingerprints>();
+    if (!loadBlob(opts.ReuseLibFile, &pReuseLib) ||
+        !loadBlob(opts.ReuseLibFingerprintsFile, &pFingerprints) ||
+        !previous->Load(
+            StringRef((const char *)pFingerprints->GetBufferPointer(),
+                      pFingerprints->GetBufferSize()))) {
+      diags.Report(diags.getCustomDiagID(
+          DiagnosticsEngine::Error,
+          "cannot load library '%0' with function fingerprints '%1'"))
+          << opts.ReuseLibFile << opts.ReuseLibFingerprintsFile;
+      return incrementalLib;
+    }
+    incrementalLib->Previous = std::move(previous);
+    *ppReuseLib = pReuseLib.Detach();
+    return incrementalLib;
+  }
+
+  // Links the recompiled part of an incremental library with the functions
+  // reused from the -reuse-lib library. Returns null after reporting errors.
+  std::unique_ptr<llvm::Module>
+  LinkReusedLibrary(CompilerInstance &compiler,
+                    const hlsl::options::DxcOpts &opts,
+                    std::unique_ptr<llvm::Module> pRecompiled,
+                    IDxcBlob *pReuseLib,
+                    const DxilIncrementalLib &incrementalLib) {
+    llvm::LLVMContext &Ctx = pRecompiled->getContext();
+    std::string diagText;
+    raw_string_ostream diagStream(diagText);
+    llvm::DiagnosticPrinterRawOStream diagPrinter(diagStream);
+    PrintDiagnosticContext diagContext(diagPrinter);
+    llvm::LLVMContext::DiagnosticHandlerTy origHandler =
+        Ctx.getDiagnosticHandler();
+    void *origDiagContext = Ctx.getDiagnosticContext();
+    Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                             &diagContext, true);
+
+    std::unique_ptr<llvm::Module> pLinked;
+    std::unique_ptr<llvm::Module> pPrevious, pPreviousDebug;
+    llvm::LLVMContext debugContext;
+    if (SUCCEEDED(ValidateLoadModuleFromContainer(
+            pReuseLib->GetBufferPointer(), pReuseLib->GetBufferSize(),
+            pPrevious, pPreviousDebug, Ctx, debugContext, diagStream)))
+      pLinked = LinkReusedFunctions(std::move(pRecompiled),
+                                    std::move(pPrevious), incrementalLib.Reused,
+                                    opts.TargetProfile.str());
+    Ctx.setDiagnosticHandler(origHandler, origDiagContext);
+    diagStream.flush();
+
+    if (!pLinked || diagContext.HasErrors()) {
+      DiagnosticsEngine &diags = compiler.getDiagnostics();
+      diags.Report(diags.getCustomDiagID(
+          DiagnosticsEngine::Error,
+          "cannot reuse functions from library '%0': %1"))
+          << opts.ReuseLibFile << diagText;
+      return nullptr;
+    }
+    return pLinked;
+  }
+
   void SetupCompilerForCompile(CompilerInstance &compiler,
                                _In_ DxcLangExtensionsHelper *helper,
-                               _In_ LPCSTR pMainFile, _In_ TextDiagnosticPrinter *diagPrinter,
+                               _In_ LPCSTR pMainFile, _In_ DiagnosticConsumer *diagPrinter,
                                _In_ std::vector<std::string>& defines,
                                _In_ hlsl::options::DxcOpts &Opts,
                                _In_count_(argCount) LPCWSTR *pArguments,
@@ -1229,6 +2380,7 @@ public:
     compiler.HlslLangExtensions = helper;
     compiler.getDiagnosticOpts().ShowOptionNames = Opts.ShowOptionNames ? 1 : 0;
     compiler.getDiagnosticOpts().Warnings = std::move(Opts.Warnings);
+    compiler.getDiagnosticOpts().ErrorLimit = Opts.ErrorLimit;
     compiler.createDiagnostics(diagPrinter, false);
     // don't output warning to stderr/file if "/no-warnings" is present.
     compiler.getDiagnostics().setIgnoreAllWarnings(!Opts.OutputWarnings);
@@ -1246,7 +2398,12 @@ public:
     if (Opts.GenerateFullDebugInfo()) {
       CodeGenOptions &CGOpts = compiler.getCodeGenOpts();
       // HLSL Change - begin
-      CGOpts.setDebugInfo(CodeGenOptions::FullDebugInfo);
+      // /Qdebug_lines keeps the locations and scopes but emits no variables
+      // or types, so no dbg.declare/dbg.value has to be carried through the
+      // pipeline.
+      CGOpts.setDebugInfo(Opts.DebugLinesOnly
+                              ? CodeGenOptions::DebugLineTablesOnly
+                              : CodeGenOptions::FullDebugInfo);
       CGOpts.HLSLEmbedSourcesInModule = true;
       // HLSL Change - end
       // CGOpts.setDebugInfo(CodeGenOptions::FullDebugInfo); // HLSL change
@@ -1306,6 +2463,7 @@ public:
     compiler.getLangOpts().UseMinPrecision = !Opts.Enable16BitTypes;
 
     compiler.getLangOpts().EnablePayloadAccessQualifiers = Opts.EnablePayloadQualifiers;
+    compiler.getLangOpts().HLSLSpecConstants = Opts.SpecConstants;
 
 // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
@@ -1340,11 +2498,18 @@ public:
     if (Opts.OptLevel >= 3)
       compiler.getCodeGenOpts().UnrollLoops = true;
 
-    compiler.getCodeGenOpts().HLSLHighLevel = Opts.CodeGenHighLevel;
+    // A syntax check stops after the checks run on the high-level module.
+    compiler.getCodeGenOpts().HLSLHighLevel =
+        Opts.CodeGenHighLevel || Opts.SyntaxOnly;
+    compiler.getCodeGenOpts().HLSLStopBeforeDxilGeneration = Opts.EmitHLModule;
+    compiler.getCodeGenOpts().HLSLStartAtDxilGeneration = Opts.FromHLModule;
     compiler.getCodeGenOpts().HLSLAllowPreserveValues = Opts.AllowPreserveValues;
     compiler.getCodeGenOpts().HLSLOnlyWarnOnUnrollFail = Opts.EnableFXCCompatMode;
     compiler.getCodeGenOpts().HLSLResMayAlias = Opts.ResMayAlias;
     compiler.getCodeGenOpts().ScanLimit = Opts.ScanLimit;
+    compiler.getCodeGenOpts().HLSLParallelFunctionThreads =
+        Opts.ParallelFunctionThreads;
+    compiler.getCodeGenOpts().HLSLUnrollBudget = Opts.UnrollBudget;
     compiler.getCodeGenOpts().HLSLOptimizationToggles = Opts.DxcOptimizationToggles;
     compiler.getCodeGenOpts().HLSLOptimizationSelects = Opts.DxcOptimizationSelects;
     compiler.getCodeGenOpts().HLSLAllResourcesBound = Opts.AllResourcesBound;
@@ -1358,6 +2523,7 @@ public:
     compiler.getCodeGenOpts().HLSLLegacyResourceReservation = Opts.LegacyResourceReservation;
     compiler.getCodeGenOpts().HLSLDefines = defines;
     compiler.getCodeGenOpts().HLSLPreciseOutputs = Opts.PreciseOutputs;
+    compiler.getCodeGenOpts().HLSLDownstreamInputs = Opts.DownstreamInputs;
     compiler.getCodeGenOpts().MainFileName = pMainFile;
     compiler.getCodeGenOpts().HLSLPrintAfterAll = Opts.PrintAfterAll;
     compiler.getCodeGenOpts().HLSLForceZeroStoreLifetimes = Opts.ForceZeroStoreLifetimes;
@@ -1402,6 +2568,9 @@ public:
     // only export shader functions for library
     compiler.getCodeGenOpts().ExportShadersOnly = Opts.ExportShadersOnly;
 
+    // keep large, shared library helpers out of line
+    compiler.getCodeGenOpts().HLSLLibInlineThreshold = Opts.LibInlineThreshold;
+
     if (Opts.DefaultLinkage.empty()) {
       compiler.getCodeGenOpts().DefaultLinkage = DXIL::DefaultLinkage::Default;
     } else if (Opts.DefaultLinkage.equals_lower("internal")) {
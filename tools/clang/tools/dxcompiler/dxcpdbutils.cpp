@@ -242,6 +242,9 @@ private:
 
   struct Source_File {
     std::wstring Name;
+    // Sources read from the source info part are views into it; the blob is
+    // made when the source is first asked for.
+    llvm::StringRef ContentView;
     CComPtr<IDxcBlob> Content;
   };
 
@@ -261,6 +264,13 @@ private:
   std::string m_VersionString;
   CComPtr<IDxcResult> m_pCachedRecompileResult;
 
+  // Load only reads the parts that are cheap to read: hash, name and version.
+  // The source info part is decoded, or the debug module parsed, the first
+  // time a query needs the sources or the arguments.
+  const hlsl::DxilPartHeader *m_pSourceInfoPart = nullptr;
+  hlsl::SourceInfoReader m_SourceInfoReader;
+  bool m_DebugInfoLoaded = false;
+
   // NOTE: This is not set to null by Reset() since it doesn't
   // necessarily change across different PDBs.
   CComPtr<IDxcCompiler3> m_pCompiler;
@@ -296,6 +306,9 @@ private:
     m_VersionCommitSha.clear();
     m_VersionString.clear();
     m_pCachedRecompileResult = nullptr;
+    m_pSourceInfoPart = nullptr;
+    m_SourceInfoReader = hlsl::SourceInfoReader();
+    m_DebugInfoLoaded = false;
     ResetAllArgs();
   }
 
@@ -423,6 +436,15 @@ private:
     }
   }
 
+  // Copies a program part whose bitcode is compressed to one that holds it
+  // as is, which is what the rest of the PDB utils read.
+  HRESULT CreateExpandedProgramBlob(const hlsl::DxilProgramHeader *pProgramHeader, uint32_t length, IDxcBlob **ppResult) {
+    std::vector<uint32_t> expanded;
+    if (!hlsl::GetValidDxilProgramHeader(pProgramHeader, length, expanded))
+      return E_INVALIDARG;
+    return hlsl::DxcCreateBlobOnHeapCopy(expanded.data(), expanded.size() * sizeof(uint32_t), ppResult);
+  }
+
   HRESULT HandleDxilContainer(IDxcBlob *pContainer, IDxcBlob **ppDebugProgramBlob) {
     const hlsl::DxilContainerHeader *header = (const hlsl::DxilContainerHeader *)m_ContainerBlob->GetBufferPointer();
     for (auto it = hlsl::begin(header); it != hlsl::end(header); it++) {
@@ -470,48 +492,8 @@ private:
 
       case hlsl::DFCC_ShaderSourceInfo:
       {
-        const hlsl::DxilSourceInfo *header = (const hlsl::DxilSourceInfo *)(part+1);
-        hlsl::SourceInfoReader reader;
-        if (!reader.Init(header, part->PartSize)) {
-          Reset();
-          return E_FAIL;
-        }
-
-        // Args
-        for (unsigned i = 0; i < reader.GetArgPairCount(); i++) {
-          ArgPair newPair;
-          {
-            const hlsl::SourceInfoReader::ArgPair &pair = reader.GetArgPair(i);
-            newPair.Name = ToWstring(pair.Name);
-            newPair.Value = ToWstring(pair.Value);
-          }
-          AddArgPair(std::move(newPair));
-        }
-
-        // Entry point might have been omitted. Set it to main by default.
-        if (m_EntryPoint.empty()) {
-          m_EntryPoint = L"main";
-        }
-
-        // Sources
-        for (unsigned i = 0; i < reader.GetSourcesCount(); i++) {
-          hlsl::SourceInfoReader::Source source_data = reader.GetSource(i);
-
-          Source_File source;
-          source.Name = ToWstring(source_data.Name);
-          IFR(hlsl::DxcCreateBlobOnHeapCopy(
-            source_data.Content.data(),
-            source_data.Content.size(),
-            &source.Content));
-
-          // First file is the main file
-          if (i == 0) {
-            m_MainFileName = source.Name;
-          }
-
-          m_SourceFiles.push_back(std::move(source));
-        }
-
+        // Decoded by LoadDebugInfo when first needed.
+        m_pSourceInfoPart = part;
       } break;
 
       case hlsl::DFCC_ShaderHash:
@@ -532,7 +514,11 @@ private:
         const hlsl::DxilProgramHeader *program_header = (const hlsl::DxilProgramHeader *)(part+1);
 
         CComPtr<IDxcBlob> pProgramHeaderBlob;
-        IFR(hlsl::DxcCreateBlobFromPinned(program_header, program_header->SizeInUint32*sizeof(UINT32), &pProgramHeaderBlob));
+        if (hlsl::IsValidCompressedDxilProgramHeader(program_header, part->PartSize)) {
+          IFR(CreateExpandedProgramBlob(program_header, part->PartSize, &pProgramHeaderBlob));
+        } else {
+          IFR(hlsl::DxcCreateBlobFromPinned(program_header, program_header->SizeInUint32*sizeof(UINT32), &pProgramHeaderBlob));
+        }
         IFR(pProgramHeaderBlob.QueryInterface(ppDebugProgramBlob));
 
       } break; // hlsl::DFCC_ShaderDebugInfoDXIL
@@ -542,6 +528,104 @@ private:
     return S_OK;
   }
 
+  HRESULT LoadSourceInfo() {
+    const hlsl::DxilSourceInfo *header = (const hlsl::DxilSourceInfo *)(m_pSourceInfoPart+1);
+    if (!m_SourceInfoReader.Init(header, m_pSourceInfoPart->PartSize)) {
+      return E_FAIL;
+    }
+    const hlsl::SourceInfoReader &reader = m_SourceInfoReader;
+
+    // Args
+    for (unsigned i = 0; i < reader.GetArgPairCount(); i++) {
+      ArgPair newPair;
+      {
+        const hlsl::SourceInfoReader::ArgPair &pair = reader.GetArgPair(i);
+        newPair.Name = ToWstring(pair.Name);
+        newPair.Value = ToWstring(pair.Value);
+      }
+      AddArgPair(std::move(newPair));
+    }
+
+    // Entry point might have been omitted. Set it to main by default.
+    if (m_EntryPoint.empty()) {
+      m_EntryPoint = L"main";
+    }
+
+    // Sources. The reader (or the container it points into) outlives them.
+    for (unsigned i = 0; i < reader.GetSourcesCount(); i++) {
+      hlsl::SourceInfoReader::Source source_data = reader.GetSource(i);
+
+      Source_File source;
+      source.Name = ToWstring(source_data.Name);
+      source.ContentView = source_data.Content;
+
+      // First file is the main file
+      if (i == 0) {
+        m_MainFileName = source.Name;
+      }
+
+      m_SourceFiles.push_back(std::move(source));
+    }
+
+    return S_OK;
+  }
+
+  HRESULT LoadDebugInfo() {
+    if (m_pSourceInfoPart) {
+      IFR(LoadSourceInfo());
+    }
+    if (!HasSources() && m_pDebugProgramBlob) {
+      IFR(PopulateSourcesFromProgramHeaderOrBitcode(m_pDebugProgramBlob));
+    }
+    return S_OK;
+  }
+
+  // Decodes the sources and arguments on first use. On failure the sources
+  // and arguments stay empty and the next query tries again.
+  HRESULT EnsureDebugInfo() {
+    if (m_DebugInfoLoaded || !m_InputBlob)
+      return S_OK;
+
+    HRESULT hr = S_OK;
+    try {
+      DxcThreadMalloc TM(m_pMalloc);
+
+      ::llvm::sys::fs::MSFileSystem *msfPtr = nullptr;
+      IFT(CreateMSFileSystemForDisk(&msfPtr));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      hr = LoadDebugInfo();
+    }
+    CATCH_CPP_ASSIGN_HRESULT()
+
+    if (FAILED(hr)) {
+      m_SourceFiles.clear();
+      m_MainFileName.clear();
+      m_SourceInfoReader = hlsl::SourceInfoReader();
+      ResetAllArgs();
+      return hr;
+    }
+
+    m_DebugInfoLoaded = true;
+    return S_OK;
+  }
+
+  HRESULT GetSourceContent(UINT32 uIndex, IDxcBlob **ppContent) {
+    Source_File &file = m_SourceFiles[uIndex];
+    if (!file.Content) {
+      DxcThreadMalloc TM(m_pMalloc);
+      IFR(hlsl::DxcCreateBlobOnHeapCopy(
+        file.ContentView.data(),
+        file.ContentView.size(),
+        &file.Content));
+    }
+    *ppContent = file.Content;
+    return S_OK;
+  }
+
   void AddArgPair(ArgPair &&newPair) {
     const llvm::opt::OptTable *optTable = hlsl::options::getHlslOptTable();
 
@@ -635,33 +719,34 @@ public:
       // PDB
       if (SUCCEEDED(hlsl::pdb::LoadDataFromStream(m_pMalloc, pStream, &m_ContainerBlob))) {
         IFR(HandleDxilContainer(m_ContainerBlob, &m_pDebugProgramBlob));
-        if (!HasSources()) {
-          if (m_pDebugProgramBlob) {
-            IFR(PopulateSourcesFromProgramHeaderOrBitcode(m_pDebugProgramBlob));
-          }
-          else {
-            return E_FAIL;
-          }
+        if (!m_pSourceInfoPart && !m_pDebugProgramBlob) {
+          return E_FAIL;
         }
       }
       // DXIL Container
       else if (hlsl::IsValidDxilContainer((const hlsl::DxilContainerHeader *)pPdbOrDxil->GetBufferPointer(), pPdbOrDxil->GetBufferSize())) {
         m_ContainerBlob = pPdbOrDxil;
         IFR(HandleDxilContainer(m_ContainerBlob, &m_pDebugProgramBlob));
-        // If we have a Debug DXIL, populate the debug info.
-        if (m_pDebugProgramBlob && !HasSources()) {
-          IFR(PopulateSourcesFromProgramHeaderOrBitcode(m_pDebugProgramBlob));
-        }
       }
       // DXIL program header or bitcode
       else {
         CComPtr<IDxcBlob> pProgramHeaderBlob;
-        IFR(hlsl::DxcCreateBlobFromPinned(
-          (hlsl::DxilProgramHeader *)pPdbOrDxil->GetBufferPointer(),
-          pPdbOrDxil->GetBufferSize(), &pProgramHeaderBlob));
+        if (hlsl::IsValidCompressedDxilProgramHeader((hlsl::DxilProgramHeader *)pPdbOrDxil->GetBufferPointer(), pPdbOrDxil->GetBufferSize())) {
+          IFR(CreateExpandedProgramBlob(
+            (hlsl::DxilProgramHeader *)pPdbOrDxil->GetBufferPointer(),
+            pPdbOrDxil->GetBufferSize(), &pProgramHeaderBlob));
+        } else {
+          IFR(hlsl::DxcCreateBlobFromPinned(
+            (hlsl::DxilProgramHeader *)pPdbOrDxil->GetBufferPointer(),
+            pPdbOrDxil->GetBufferSize(), &pProgramHeaderBlob));
+
+          if (!hlsl::IsValidDxilProgramHeader((hlsl::DxilProgramHeader *)pPdbOrDxil->GetBufferPointer(), pPdbOrDxil->GetBufferSize()) &&
+              !IsBitcode(pPdbOrDxil->GetBufferPointer(), pPdbOrDxil->GetBufferSize())) {
+            return E_INVALIDARG;
+          }
+        }
 
         IFR(pProgramHeaderBlob.QueryInterface(&m_pDebugProgramBlob));
-        IFR(PopulateSourcesFromProgramHeaderOrBitcode(m_pDebugProgramBlob));
       }
     }
     catch (std::bad_alloc) {
@@ -674,29 +759,36 @@ public:
 
   virtual HRESULT STDMETHODCALLTYPE GetSourceCount(_Out_ UINT32 *pCount) override {
     if (!pCount) return E_POINTER;
+    IFR(EnsureDebugInfo());
     *pCount = (UINT32)m_SourceFiles.size();
     return S_OK;
   }
 
   virtual HRESULT STDMETHODCALLTYPE GetSource(_In_ UINT32 uIndex, _COM_Outptr_ IDxcBlobEncoding **ppResult) override {
+    IFR(EnsureDebugInfo());
     if (uIndex >= m_SourceFiles.size()) return E_INVALIDARG;
     if (!ppResult) return E_POINTER;
     *ppResult = nullptr;
-    return m_SourceFiles[uIndex].Content.QueryInterface(ppResult);
+    IDxcBlob *pContent = nullptr;
+    IFR(GetSourceContent(uIndex, &pContent));
+    return pContent->QueryInterface(ppResult);
   }
 
   virtual HRESULT STDMETHODCALLTYPE GetSourceName(_In_ UINT32 uIndex, _Outptr_result_z_ BSTR *pResult) override {
+    IFR(EnsureDebugInfo());
     if (uIndex >= m_SourceFiles.size()) return E_INVALIDARG;
     return CopyWstringToBSTR(m_SourceFiles[uIndex].Name, pResult);
   }
 
-  static inline HRESULT GetStringCount(const std::vector<std::wstring> &list, _Out_ UINT32 *pCount) {
+  HRESULT GetStringCount(const std::vector<std::wstring> &list, _Out_ UINT32 *pCount) {
     if (!pCount) return E_POINTER;
+    IFR(EnsureDebugInfo());
     *pCount = (UINT32)list.size();
     return S_OK;
   }
 
-  static inline HRESULT GetStringOption(const std::vector<std::wstring> &list, _In_ UINT32 uIndex, _Outptr_result_z_ BSTR *pResult) {
+  HRESULT GetStringOption(const std::vector<std::wstring> &list, _In_ UINT32 uIndex, _Outptr_result_z_ BSTR *pResult) {
+    IFR(EnsureDebugInfo());
     if (uIndex >= list.size()) return E_INVALIDARG;
     return CopyWstringToBSTR(list[uIndex], pResult);
   }
@@ -710,12 +802,14 @@ public:
 
   virtual HRESULT STDMETHODCALLTYPE GetArgPairCount(_Out_ UINT32 *pCount) override {
     if (!pCount) return E_POINTER;
+    IFR(EnsureDebugInfo());
     *pCount = (UINT32)m_ArgPairs.size();
     return S_OK;
   }
 
   virtual HRESULT STDMETHODCALLTYPE GetArgPair(_In_ UINT32 uIndex, _Outptr_result_z_ BSTR *pName, _Outptr_result_z_ BSTR *pValue) override {
     if (!pName || !pValue) return E_POINTER;
+    IFR(EnsureDebugInfo());
     const ArgPair &pair = m_ArgPairs[uIndex];
 
     *pName = nullptr;
@@ -731,12 +825,15 @@ public:
   }
 
   virtual HRESULT STDMETHODCALLTYPE GetTargetProfile(_Outptr_result_z_ BSTR *pResult) override {
+    IFR(EnsureDebugInfo());
     return CopyWstringToBSTR(m_TargetProfile, pResult);
   }
   virtual HRESULT STDMETHODCALLTYPE GetEntryPoint(_Outptr_result_z_ BSTR *pResult) override {
+    IFR(EnsureDebugInfo());
     return CopyWstringToBSTR(m_EntryPoint, pResult);
   }
   virtual HRESULT STDMETHODCALLTYPE GetMainFileName(_Outptr_result_z_ BSTR *pResult) {
+    IFR(EnsureDebugInfo());
     return CopyWstringToBSTR(m_MainFileName, pResult);
   }
 
@@ -745,6 +842,9 @@ public:
   }
 
   virtual HRESULT STDMETHODCALLTYPE OverrideArgs(_In_ DxcArgPair *pArgPairs, UINT32 uNumArgPairs) override {
+    // Load the recorded arguments first so they cannot be added on top of
+    // the overrides later.
+    IFR(EnsureDebugInfo());
     try {
       DxcThreadMalloc TM(m_pMalloc);
 
@@ -766,6 +866,7 @@ public:
   }
 
   virtual HRESULT STDMETHODCALLTYPE OverrideRootSignature(_In_ const WCHAR *pRootSignature) override {
+    IFR(EnsureDebugInfo());
     try {
       DxcThreadMalloc TM(m_pMalloc);
 
@@ -811,6 +912,8 @@ public:
     if (m_pCachedRecompileResult)
       return m_pCachedRecompileResult.QueryInterface(ppResult);
 
+    IFR(EnsureDebugInfo());
+
     DxcThreadMalloc TM(m_pMalloc);
 
     // Fail early if there are no source files.
@@ -857,7 +960,8 @@ public:
       pIncludeHandler->m_FileMap.insert(std::pair<std::wstring, unsigned>(NormalizedName, i));
     }
 
-    IDxcBlob *main_file = m_SourceFiles[0].Content;
+    IDxcBlob *main_file = nullptr;
+    IFR(GetSourceContent(0, &main_file));
 
     DxcBuffer source_buf = {};
     source_buf.Ptr = main_file->GetBufferPointer();
@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcpermutations.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Groups the define sets of a source into permutations that preprocess to   //
+// the same tokens, so each group is compiled once.                          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/MacroInfo.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Pragma.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/StringSet.h"
+#include "dxcpermutations.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+using namespace clang;
+using namespace dxcutil;
+
+namespace {
+
+// Everything the scan accumulates while the preprocessor runs.
+struct ScanState {
+  MD5 Hash;
+  StringSet<> Consulted;
+};
+
+// Records the names the preprocessor looks up as macros outside of the
+// tokens it returns: expansions, defined/#ifdef/#ifndef checks, the
+// identifiers of evaluated #if and #elif conditions, which are 0 when not
+// defined, and macros redefined or undefined by the source.
+class ScanCallbacks : public PPCallbacks {
+public:
+  ScanCallbacks(ScanState &State, Preprocessor &PP)
+      : m_State(State), m_PP(PP), m_SM(PP.getSourceManager()),
+        m_LangOpts(PP.getLangOpts()) {}
+
+  void MacroExpands(const Token &MacroNameTok, const MacroDefinition &MD,
+                    SourceRange Range, const MacroArgs *Args) override {
+    AddName(MacroNameTok);
+  }
+  void MacroDefined(const Token &MacroNameTok,
+                    const MacroDirective *MD) override {
+    // The defines of the permutation itself are compared anyway; only a
+    // redefinition, which warns, makes one matter to the scan.
+    if (MD->getPrevious() == nullptr &&
+        m_SM.getFileID(m_SM.getSpellingLoc(MacroNameTok.getLocation())) ==
+            m_PP.getPredefinesFileID())
+      return;
+    AddName(MacroNameTok);
+  }
+  void MacroUndefined(const Token &MacroNameTok,
+                      const MacroDefinition &MD) override {
+    AddName(MacroNameTok);
+  }
+  void Defined(const Token &MacroNameTok, const MacroDefinition &MD,
+               SourceRange Range) override {
+    AddName(MacroNameTok);
+  }
+  void Ifdef(SourceLocation Loc, const Token &MacroNameTok,
+             const MacroDefinition &MD) override {
+    AddName(MacroNameTok);
+  }
+  void Ifndef(SourceLocation Loc, const Token &MacroNameTok,
+              const MacroDefinition &MD) override {
+    AddName(MacroNameTok);
+  }
+  void If(SourceLocation Loc, SourceRange ConditionRange,
+          ConditionValueKind ConditionValue) override {
+    AddConditionNames(ConditionRange, ConditionValue);
+  }
+  void Elif(SourceLocation Loc, SourceRange ConditionRange,
+            ConditionValueKind ConditionValue, SourceLocation IfLoc) override {
+    AddConditionNames(ConditionRange, ConditionValue);
+  }
+
+private:
+  void AddName(const Token &Tok) {
+    if (const IdentifierInfo *II = Tok.getIdentifierInfo())
+      m_State.Consulted.insert(II->getName());
+  }
+
+  void AddConditionNames(SourceRange Range, ConditionValueKind Value) {
+    if (Value == CVK_NotEvaluated || Range.isInvalid())
+      return;
+    bool Invalid = false;
+    StringRef Text = Lexer::getSourceText(CharSourceRange::getCharRange(Range),
+                                          m_SM, m_LangOpts, &Invalid);
+    if (Invalid)
+      return;
+    // The raw lexer needs a null-terminated buffer.
+    std::string Buffer = Text;
+    Lexer RawLexer(SourceLocation(), m_LangOpts, Buffer.c_str(),
+                   Buffer.c_str(), Buffer.c_str() + Buffer.size());
+    Token Tok;
+    while (!RawLexer.LexFromRawLexer(Tok)) {
+      if (Tok.is(tok::raw_identifier))
+        m_State.Consulted.insert(Tok.getRawIdentifier());
+    }
+    if (Tok.is(tok::raw_identifier))
+      m_State.Consulted.insert(Tok.getRawIdentifier());
+  }
+
+  ScanState &m_State;
+  Preprocessor &m_PP;
+  const SourceManager &m_SM;
+  const LangOptions &m_LangOpts;
+};
+
+void HashString(MD5 &Hash, StringRef Str) {
+  uint32_t Size = Str.size();
+  Hash.update(ArrayRef<uint8_t>((const uint8_t *)&Size, sizeof(Size)));
+  Hash.update(Str);
+}
+
+void HashToken(ScanState &State, Preprocessor &PP, const Token &Tok) {
+  uint32_t Kind = Tok.getKind();
+  State.Hash.update(ArrayRef<uint8_t>((const uint8_t *)&Kind, sizeof(Kind)));
+  SmallString<64> Spelling;
+  bool Invalid = false;
+  HashString(State.Hash, PP.getSpelling(Tok, Spelling, &Invalid));
+  // Every identifier and keyword that reaches the parser was checked for a
+  // macro definition on the way.
+  if (const IdentifierInfo *II = Tok.getIdentifierInfo())
+    State.Consulted.insert(II->getName());
+}
+
+// Takes the pragmas the preprocessor does not handle itself, which are left
+// for the parser, such as pack_matrix, into the hash.
+class ScanPragmaHandler : public PragmaHandler {
+public:
+  ScanPragmaHandler(ScanState &State) : m_State(State) {}
+
+  void HandlePragma(Preprocessor &PP, PragmaIntroducerKind Introducer,
+                    Token &FirstToken) override {
+    HashString(m_State.Hash, "#pragma");
+    HashToken(m_State, PP, FirstToken);
+    Token Tok;
+    PP.Lex(Tok);
+    while (Tok.isNot(tok::eod) && Tok.isNot(tok::eof)) {
+      HashToken(m_State, PP, Tok);
+      PP.Lex(Tok);
+    }
+  }
+
+private:
+  ScanState &m_State;
+};
+
+} // namespace
+
+void DxcPermutationScanAction::ExecuteAction() {
+  CompilerInstance &CI = getCompilerInstance();
+  Preprocessor &PP = CI.getPreprocessor();
+  const SourceManager &SM = CI.getSourceManager();
+  ScanState State;
+  PP.addPPCallbacks(llvm::make_unique<ScanCallbacks>(State, PP));
+  ScanPragmaHandler *PragmaHandler = new ScanPragmaHandler(State);
+  PP.AddPragmaHandler(PragmaHandler);
+
+  // Lines matter too: they end up in diagnostics and debug information.
+  const char *LastFile = nullptr;
+  unsigned LastLine = 0;
+  Token Tok;
+  PP.EnterMainSourceFile();
+  for (PP.Lex(Tok); Tok.isNot(tok::eof); PP.Lex(Tok)) {
+    PresumedLoc Loc = SM.getPresumedLoc(SM.getExpansionLoc(Tok.getLocation()));
+    if (Loc.isValid() &&
+        (Loc.getLine() != LastLine || Loc.getFilename() != LastFile)) {
+      LastFile = Loc.getFilename();
+      LastLine = Loc.getLine();
+      HashString(State.Hash, LastFile);
+      State.Hash.update(
+          ArrayRef<uint8_t>((const uint8_t *)&LastLine, sizeof(LastLine)));
+    }
+    HashToken(State, PP, Tok);
+  }
+
+  PP.RemovePragmaHandler(PragmaHandler);
+  delete PragmaHandler;
+
+  State.Hash.final(m_Scan.TokenHash);
+  m_Scan.ConsultedNames.clear();
+  for (const auto &Name : State.Consulted)
+    m_Scan.ConsultedNames.push_back(Name.getKey());
+  std::sort(m_Scan.ConsultedNames.begin(), m_Scan.ConsultedNames.end());
+}
+
+int DxcPermutationClassifier::FindClass(const DefineMap &Defines) const {
+  for (const Signature &Sig : m_Signatures) {
+    bool Matches = true;
+    for (const auto &Value : Sig.Values) {
+      auto It = Defines.find(Value.first);
+      bool Defined = It != Defines.end();
+      if (Defined != Value.second.hasValue() ||
+          (Defined && It->second != *Value.second)) {
+        Matches = false;
+        break;
+      }
+    }
+    if (Matches)
+      return Sig.Class;
+  }
+  return -1;
+}
+
+unsigned DxcPermutationClassifier::AddScan(const DefineMap &Defines,
+                                           const DxcPermutationScan &Scan,
+                                           bool HasDiagnostics) {
+  unsigned Class = m_ClassCount;
+  if (!HasDiagnostics) {
+    for (const SharedClass &Shared : m_SharedClasses) {
+      if (memcmp(Shared.TokenHash, Scan.TokenHash, sizeof(Scan.TokenHash)) == 0) {
+        Class = Shared.Class;
+        break;
+      }
+    }
+  }
+  if (Class == m_ClassCount) {
+    ++m_ClassCount;
+    if (!HasDiagnostics) {
+      m_SharedClasses.emplace_back();
+      memcpy(m_SharedClasses.back().TokenHash, Scan.TokenHash,
+             sizeof(Scan.TokenHash));
+      m_SharedClasses.back().Class = Class;
+    }
+  }
+
+  // The scan is deterministic, so later define sets that agree on the names
+  // it consulted land in the same class, diagnostics included.
+  Signature Sig;
+  Sig.Class = Class;
+  Sig.Values.reserve(Scan.ConsultedNames.size());
+  for (const std::string &Name : Scan.ConsultedNames) {
+    auto It = Defines.find(Name);
+    if (It == Defines.end())
+      Sig.Values.emplace_back(Name, None);
+    else
+      Sig.Values.emplace_back(Name, It->second);
+  }
+  m_Signatures.push_back(std::move(Sig));
+  return Class;
+}
+
+unsigned DxcPermutationClassifier::AddUnshared() { return m_ClassCount++; }
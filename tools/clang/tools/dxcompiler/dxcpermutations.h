@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcpermutations.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Groups the define sets of a source into permutations that preprocess to   //
+// the same tokens, so each group is compiled once.                          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "clang/Frontend/FrontendActions.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/MD5.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace dxcutil {
+
+// What preprocessing one permutation of a source produced.
+struct DxcPermutationScan {
+  // Hash of the token stream the parser would see, with the lines tokens
+  // came from and the pragmas left for the parser.
+  llvm::MD5::MD5Result TokenHash;
+  // Every name the preprocessor checked for a macro definition, sorted.
+  // Define sets that agree on all of these preprocess identically.
+  std::vector<std::string> ConsultedNames;
+};
+
+// Runs the preprocessor over the main file without parsing, filling in a
+// DxcPermutationScan.
+class DxcPermutationScanAction : public clang::PreprocessorFrontendAction {
+public:
+  DxcPermutationScanAction(DxcPermutationScan &Scan) : m_Scan(Scan) {}
+
+protected:
+  void ExecuteAction() override;
+
+private:
+  DxcPermutationScan &m_Scan;
+};
+
+// Partitions the define sets of one source and set of arguments into
+// classes that compile to the same result.
+class DxcPermutationClassifier {
+public:
+  // Macro name to value, for the defines that vary between permutations.
+  typedef std::map<std::string, std::string> DefineMap;
+
+  // Returns the class of an earlier permutation that consulted only names
+  // Defines agrees with, so Defines need not be scanned, or -1.
+  int FindClass(const DefineMap &Defines) const;
+
+  // Records the scan of a permutation with Defines and returns its class.
+  // Permutations whose scans match share a class unless either reported
+  // diagnostics, which can depend on macro values the tokens do not show.
+  unsigned AddScan(const DefineMap &Defines, const DxcPermutationScan &Scan,
+                   bool HasDiagnostics);
+
+  // Starts a class for a permutation that is not shared with any other.
+  unsigned AddUnshared();
+
+  unsigned GetClassCount() const { return m_ClassCount; }
+
+private:
+  struct Signature {
+    // Value of each consulted name, or None where it was not defined.
+    std::vector<std::pair<std::string, llvm::Optional<std::string>>> Values;
+    unsigned Class;
+  };
+  struct SharedClass {
+    llvm::MD5::MD5Result TokenHash;
+    unsigned Class;
+  };
+
+  std::vector<Signature> m_Signatures;
+  std::vector<SharedClass> m_SharedClasses;
+  unsigned m_ClassCount = 0;
+};
+
+} // namespace dxcutil
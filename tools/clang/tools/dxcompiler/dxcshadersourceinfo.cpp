@@ -14,6 +14,7 @@
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/CodeGenOptions.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Path.h"
 #include "miniz/miniz.h"
 
@@ -179,7 +180,19 @@ bool SourceInfoReader::Init(const hlsl::DxilSourceInfo *SourceInfo, unsigned sou
           return false;
 
         const void *ptr = entry+1;
-        if (entry->ContentSizeInBytes > 0) {
+        if (entry->Flags & hlsl::DxilSourceInfo_SourceContentsEntryFlag_Alias) {
+          // Same content as an earlier file.
+          if (PointerByteOffset(entry+1, firstEntry) + sizeof(uint32_t) > header->UncompressedEntriesSizeInBytes)
+            return false;
+          if (sizeof(*entry) + sizeof(uint32_t) > entry->AlignedSizeInBytes)
+            return false;
+          uint32_t aliasedIndex = 0;
+          memcpy(&aliasedIndex, ptr, sizeof(aliasedIndex));
+          if (aliasedIndex >= i)
+            return false;
+          m_Sources[i].Content = m_Sources[aliasedIndex].Content;
+        }
+        else if (entry->ContentSizeInBytes > 0) {
           // Fail if not null terminated
           if (((const char *)ptr)[entry->ContentSizeInBytes-1] != '\0')
             return false;
@@ -242,6 +255,16 @@ static void AppendFileContentEntry(Buffer *buf, llvm::StringRef content) {
   assert(paddedOffset == header.AlignedSizeInBytes);
 }
 
+static void AppendFileContentAliasEntry(Buffer *buf, uint32_t aliasedIndex) {
+  hlsl::DxilSourceInfo_SourceContentsEntry header = {};
+  header.AlignedSizeInBytes = sizeof(header) + sizeof(aliasedIndex);
+  header.Flags = hlsl::DxilSourceInfo_SourceContentsEntryFlag_Alias;
+  header.ContentSizeInBytes = 0;
+
+  Append(buf, &header, sizeof(header));
+  Append(buf, &aliasedIndex, sizeof(aliasedIndex));
+}
+
 static size_t BeginSection(Buffer *buf) {
   const size_t sectionOffset = buf->size();
 
@@ -362,11 +385,17 @@ void SourceInfoWriter::Write(llvm::StringRef targetProfile, llvm::StringRef entr
   {
     const size_t sectionOffset = BeginSection(&m_Buffer);
 
-    // Put all the contents in a buffer
+    // Put all the contents in a buffer. The same header reached through
+    // different paths is written once, and later copies refer back to it.
     Buffer uncompressedBuffer;
+    llvm::DenseMap<llvm::StringRef, uint32_t> contentToIndex;
     for (unsigned i = 0; i < sourceFileList.size(); i++) {
       SourceFile &file = sourceFileList[i];
-      AppendFileContentEntry(&uncompressedBuffer, file.Content);
+      auto insertResult = contentToIndex.insert(std::make_pair(file.Content, i));
+      if (insertResult.second)
+        AppendFileContentEntry(&uncompressedBuffer, file.Content);
+      else
+        AppendFileContentAliasEntry(&uncompressedBuffer, insertResult.first->second);
     }
 
     const size_t headerOffset = m_Buffer.size();
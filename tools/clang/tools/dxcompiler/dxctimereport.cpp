@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxctimereport.cpp                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Collects the time, memory and allocations of each phase and pass of a     //
+// compile.                                                                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/HLSL/DxilCompileStats.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "dxctimereport.h"
+#include "dxcutil.h"
+
+#ifdef _WIN32
+#include <psapi.h>
+#endif
+
+#include <algorithm>
+
+using namespace llvm;
+using namespace dxcutil;
+
+namespace {
+
+// Memory in use by the process. On Windows the heap walk behind
+// GetMallocUsage is far too slow to run at every pass boundary, so the
+// private commit charge is used instead.
+uint64_t GetMemoryInUse() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS_EX Counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(),
+                           (PROCESS_MEMORY_COUNTERS *)&Counters,
+                           sizeof(Counters)))
+    return Counters.PrivateUsage;
+  return 0;
+#else
+  return sys::Process::GetMallocUsage();
+#endif
+}
+
+void WriteMilliseconds(raw_ostream &OS, const char *Key, double Seconds) {
+  OS << '"' << Key << "\": " << format("%.3f", Seconds * 1000.0);
+}
+
+} // namespace
+
+DxcTimeReport::DxcTimeReport()
+    : m_Start(TimeRecord::getCurrentTime(true)), m_StartMem(GetMemoryInUse()),
+      m_MemPeak(m_StartMem), m_pPrior(PhaseTimingListener::setCurrent(this)) {}
+
+DxcTimeReport::~DxcTimeReport() {
+  PhaseTimingListener::setCurrent(m_pPrior);
+}
+
+void DxcTimeReport::startPhase(StringRef Name, bool IsPass) {
+  StringMap<unsigned> &Index = IsPass ? m_PassIndex : m_PhaseIndex;
+  auto Inserted = Index.insert(std::make_pair(Name, (unsigned)m_Entries.size()));
+  if (Inserted.second) {
+    m_Entries.emplace_back();
+    m_Entries.back().Name = Name;
+    m_Entries.back().IsPass = IsPass;
+  }
+
+  OpenPhase Open;
+  Open.EntryIndex = Inserted.first->second;
+  Open.ChildWallTime = Open.ChildUserTime = Open.ChildSystemTime = 0;
+  Open.StartMem = GetMemoryInUse();
+  m_MemPeak = std::max(m_MemPeak, Open.StartMem);
+  if (!m_Open.empty()) {
+    Entry &Parent = m_Entries[m_Open.back().EntryIndex];
+    Parent.MemPeak = std::max(Parent.MemPeak, Open.StartMem);
+  }
+  Open.Start = TimeRecord::getCurrentTime(true);
+  m_Open.push_back(Open);
+}
+
+void DxcTimeReport::stopPhase() {
+  TimeRecord End = TimeRecord::getCurrentTime(false);
+  uint64_t EndMem = GetMemoryInUse();
+  if (m_Open.empty())
+    return;
+
+  OpenPhase Open = m_Open.back();
+  m_Open.pop_back();
+  double Wall = End.getWallTime() - Open.Start.getWallTime();
+  double User = End.getUserTime() - Open.Start.getUserTime();
+  double System = End.getSystemTime() - Open.Start.getSystemTime();
+
+  Entry &E = m_Entries[Open.EntryIndex];
+  ++E.Runs;
+  E.WallTime += Wall - Open.ChildWallTime;
+  E.UserTime += User - Open.ChildUserTime;
+  E.SystemTime += System - Open.ChildSystemTime;
+  E.MemDelta += (int64_t)EndMem - (int64_t)Open.StartMem;
+  E.MemPeak = std::max(E.MemPeak, std::max(Open.StartMem, EndMem));
+  m_MemPeak = std::max(m_MemPeak, EndMem);
+
+  if (!m_Open.empty()) {
+    OpenPhase &Parent = m_Open.back();
+    Parent.ChildWallTime += Wall;
+    Parent.ChildUserTime += User;
+    Parent.ChildSystemTime += System;
+    Entry &ParentEntry = m_Entries[Parent.EntryIndex];
+    ParentEntry.MemPeak = std::max(ParentEntry.MemPeak, E.MemPeak);
+  }
+}
+
+void DxcTimeReport::WriteJson(std::string &Json) {
+  TimeRecord End = TimeRecord::getCurrentTime(false);
+  uint64_t EndMem = GetMemoryInUse();
+  m_MemPeak = std::max(m_MemPeak, EndMem);
+
+  raw_string_ostream OS(Json);
+  OS << "{\n  \"total\": { ";
+  WriteMilliseconds(OS, "wall_ms", End.getWallTime() - m_Start.getWallTime());
+  OS << ", ";
+  WriteMilliseconds(OS, "user_ms", End.getUserTime() - m_Start.getUserTime());
+  OS << ", ";
+  WriteMilliseconds(OS, "sys_ms", End.getSystemTime() - m_Start.getSystemTime());
+  OS << ", \"mem_delta_bytes\": " << ((int64_t)EndMem - (int64_t)m_StartMem)
+     << ", \"mem_peak_bytes\": " << m_MemPeak << " }";
+
+  // Phases first, then passes, each in the order they first ran.
+  for (int Passes = 0; Passes < 2; ++Passes) {
+    OS << ",\n  \"" << (Passes ? "passes" : "phases") << "\": [";
+    bool First = true;
+    for (const Entry &E : m_Entries) {
+      if (E.IsPass != (Passes != 0) || E.Runs == 0)
+        continue;
+      OS << (First ? "\n" : ",\n") << "    { \"name\": ";
+      First = false;
+      WriteJsonString(OS, E.Name);
+      OS << ", \"runs\": " << E.Runs << ", ";
+      WriteMilliseconds(OS, "wall_ms", E.WallTime);
+      OS << ", ";
+      WriteMilliseconds(OS, "user_ms", E.UserTime);
+      OS << ", ";
+      WriteMilliseconds(OS, "sys_ms", E.SystemTime);
+      OS << ", \"mem_delta_bytes\": " << E.MemDelta
+         << ", \"mem_peak_bytes\": " << E.MemPeak << " }";
+    }
+    OS << (First ? "]" : "\n  ]");
+  }
+  OS << "\n}\n";
+  OS.flush();
+}
+
+DxcAllocReport::DxcAllocReport(DxcThreadAllocProfile &Profile)
+    : m_Profile(Profile), m_pPrior(PhaseTimingListener::setCurrent(this)) {}
+
+DxcAllocReport::~DxcAllocReport() {
+  PhaseTimingListener::setCurrent(m_pPrior);
+}
+
+void DxcAllocReport::startPhase(StringRef Name, bool IsPass) {
+  if (m_pPrior)
+    m_pPrior->startPhase(Name, IsPass);
+  StringMap<unsigned> &Index = IsPass ? m_PassIndex : m_PhaseIndex;
+  auto Inserted = Index.insert(std::make_pair(Name, (unsigned)m_Entries.size()));
+  if (Inserted.second)
+    m_Entries.push_back({Name.str(), IsPass});
+  // Entries past the last tag count as other.
+  unsigned Tag = Inserted.first->second + 1;
+  if (Tag >= DxcThreadAllocProfile::kMaxTags)
+    Tag = 0;
+  m_PriorTags.push_back(m_Profile.SetTag(Tag));
+}
+
+void DxcAllocReport::stopPhase() {
+  if (m_pPrior)
+    m_pPrior->stopPhase();
+  if (m_PriorTags.empty())
+    return;
+  m_Profile.SetTag(m_PriorTags.back());
+  m_PriorTags.pop_back();
+}
+
+void DxcAllocReport::AddToStats(hlsl::DxilCompileStats &Stats) {
+  for (unsigned Tag = 0; Tag < DxcThreadAllocProfile::kMaxTags; ++Tag) {
+    if (Tag > m_Entries.size())
+      break;
+    DxcThreadAllocProfile::Counters Counters = m_Profile.GetCounters(Tag);
+    if (Counters.Allocations == 0)
+      continue;
+    hlsl::DxilCompileStats::Allocations A;
+    if (Tag == 0) {
+      A.Name = "other";
+    } else {
+      A.Name = m_Entries[Tag - 1].Name;
+      A.IsPass = m_Entries[Tag - 1].IsPass;
+    }
+    A.Count = Counters.Allocations;
+    A.Bytes = Counters.Bytes;
+    A.LivePeakBytes = Counters.LivePeakBytes;
+    Stats.AddAllocations(A);
+  }
+}
@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxctimereport.h                                                           //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Collects the time, memory and allocations of each phase and pass of a     //
+// compile.                                                                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/Global.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Timer.h"
+#include <string>
+#include <vector>
+
+namespace hlsl {
+class DxilCompileStats;
+}
+
+namespace dxcutil {
+
+// Listens for the phases and passes run on the constructing thread until it
+// is destroyed, and renders what it saw as a JSON report.
+//
+// Times are exclusive: a phase does not include the time of the phases and
+// passes nested inside it, so entries add up to the time of the compile.
+// Memory is sampled only at phase boundaries, so the peak of an entry is the
+// highest usage seen when it or something nested in it started or stopped.
+class DxcTimeReport : public llvm::PhaseTimingListener {
+public:
+  DxcTimeReport();
+  ~DxcTimeReport();
+
+  void startPhase(llvm::StringRef Name, bool IsPass) override;
+  void stopPhase() override;
+
+  // Renders the report; phases still running are not included.
+  void WriteJson(std::string &Json);
+
+private:
+  struct Entry {
+    std::string Name;
+    bool IsPass;
+    unsigned Runs = 0;
+    double WallTime = 0, UserTime = 0, SystemTime = 0;
+    int64_t MemDelta = 0;
+    uint64_t MemPeak = 0;
+  };
+  struct OpenPhase {
+    unsigned EntryIndex;
+    llvm::TimeRecord Start;
+    double ChildWallTime, ChildUserTime, ChildSystemTime;
+    uint64_t StartMem;
+  };
+
+  std::vector<Entry> m_Entries;
+  llvm::StringMap<unsigned> m_PhaseIndex;
+  llvm::StringMap<unsigned> m_PassIndex;
+  std::vector<OpenPhase> m_Open;
+  llvm::TimeRecord m_Start;
+  uint64_t m_StartMem;
+  uint64_t m_MemPeak;
+  llvm::PhaseTimingListener *m_pPrior;
+
+  DxcTimeReport(const DxcTimeReport &) = delete;
+  void operator=(const DxcTimeReport &) = delete;
+};
+
+// Counts the allocations a DxcThreadAllocProfile sees against the phase or
+// pass running on the constructing thread, until it is destroyed. Like times,
+// counts are exclusive, so phases and passes add up to the compile, with
+// what ran outside any of them under "other". Phases and passes are passed on
+// to the listener that was installed before.
+class DxcAllocReport : public llvm::PhaseTimingListener {
+public:
+  explicit DxcAllocReport(DxcThreadAllocProfile &Profile);
+  ~DxcAllocReport();
+
+  void startPhase(llvm::StringRef Name, bool IsPass) override;
+  void stopPhase() override;
+
+  // Adds the counts so far, for entries with any, to Stats.
+  void AddToStats(hlsl::DxilCompileStats &Stats);
+
+private:
+  struct Entry {
+    std::string Name;
+    bool IsPass;
+  };
+
+  DxcThreadAllocProfile &m_Profile;
+  std::vector<Entry> m_Entries; // tag - 1
+  llvm::StringMap<unsigned> m_PhaseIndex;
+  llvm::StringMap<unsigned> m_PassIndex;
+  std::vector<unsigned> m_PriorTags;
+  llvm::PhaseTimingListener *m_pPrior;
+
+  DxcAllocReport(const DxcAllocReport &) = delete;
+  void operator=(const DxcAllocReport &) = delete;
+};
+
+} // namespace dxcutil
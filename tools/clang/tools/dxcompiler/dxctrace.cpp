@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxctrace.cpp                                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Reports the phases and passes of a compile as trace events.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Option/Arg.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+#include "dxctrace.h"
+#include "dxcutil.h"
+
+#ifdef _WIN32
+#include "dxcetw.h"
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <cstdlib>
+
+using namespace llvm;
+using namespace dxcutil;
+
+namespace {
+
+// The file named by DXC_TRACE_FILE, read once per process.
+const std::string &GetTraceFilePath() {
+  static const std::string Path = [] {
+    const char *pPath = std::getenv("DXC_TRACE_FILE");
+    return std::string(pPath ? pPath : "");
+  }();
+  return Path;
+}
+
+// Steady clock time, which is the same clock in every process, so events
+// from concurrent compiles line up.
+uint64_t GetMicroseconds() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t GetProcessId() {
+#ifdef _WIN32
+  return GetCurrentProcessId();
+#else
+  return getpid();
+#endif
+}
+
+uint64_t GetThreadId() {
+#ifdef _WIN32
+  return GetCurrentThreadId();
+#else
+  return syscall(SYS_gettid);
+#endif
+}
+
+// Appends Events to the trace file at Path. Whoever creates the file starts
+// the JSON array; the trace importers accept it left open, with a trailing
+// comma. Events are written with a single append so those of concurrent
+// compiles don't interleave. Errors just drop the events.
+void AppendToTraceFile(StringRef Path, StringRef Events) {
+  DiskFileSystemScope DiskScope;
+  if (!DiskScope.Init())
+    return;
+  int FD;
+  if (!sys::fs::openFileForWrite(Path, FD, sys::fs::F_Excl)) {
+    raw_fd_ostream OS(FD, /*shouldClose*/ true);
+    OS << "[\n";
+    OS.close();
+    if (OS.has_error())
+      OS.clear_error();
+  }
+  if (sys::fs::openFileForWrite(Path, FD, sys::fs::F_Append))
+    return;
+  raw_fd_ostream OS(FD, /*shouldClose*/ true, /*unbuffered*/ true);
+  OS << Events;
+  OS.close();
+  if (OS.has_error())
+    OS.clear_error();
+}
+
+} // namespace
+
+DxcTraceListener::DxcTraceListener(StringRef SourceName, StringRef EntryPoint,
+                                   StringRef Source,
+                                   const opt::InputArgList &Args)
+    : m_SourceName(SourceName), m_EntryPoint(EntryPoint),
+      m_bWriteJson(!GetTraceFilePath().empty()),
+      m_StartMicros(GetMicroseconds()),
+      m_pPrior(PhaseTimingListener::setCurrent(this)) {
+  MD5 Hash;
+  for (const opt::Arg *A : Args) {
+    Hash.update(A->getAsString(Args));
+    Hash.update(StringRef("", 1));
+  }
+  Hash.update(Source);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Hex;
+  MD5::stringifyResult(Result, Hex);
+  m_RequestHash = Hex.str();
+}
+
+DxcTraceListener::~DxcTraceListener() {
+  PhaseTimingListener::setCurrent(m_pPrior);
+  if (!m_bWriteJson)
+    return;
+  AppendJsonEvent("Compile", "compile", m_StartMicros, GetMicroseconds());
+  AppendToTraceFile(GetTraceFilePath(), m_JsonEvents);
+}
+
+bool DxcTraceListener::IsEnabled() {
+#ifdef _WIN32
+  return true;
+#else
+  return !GetTraceFilePath().empty();
+#endif
+}
+
+void DxcTraceListener::startPhase(StringRef Name, bool IsPass) {
+  if (m_pPrior)
+    m_pPrior->startPhase(Name, IsPass);
+  m_Open.push_back({Name.str(), IsPass, GetMicroseconds()});
+  const char *pName = m_Open.back().Name.c_str();
+  if (IsPass)
+    DxcEtw_DXCompilerPass_Start(pName, m_EntryPoint.c_str(),
+                                m_RequestHash.c_str());
+  else
+    DxcEtw_DXCompilerPhase_Start(pName, m_EntryPoint.c_str(),
+                                 m_RequestHash.c_str());
+}
+
+void DxcTraceListener::stopPhase() {
+  uint64_t EndMicros = GetMicroseconds();
+  if (m_pPrior)
+    m_pPrior->stopPhase();
+  if (m_Open.empty())
+    return;
+
+  const OpenPhase &Open = m_Open.back();
+  const char *pName = Open.Name.c_str();
+  if (Open.IsPass)
+    DxcEtw_DXCompilerPass_Stop(pName, m_EntryPoint.c_str(),
+                               m_RequestHash.c_str());
+  else
+    DxcEtw_DXCompilerPhase_Stop(pName, m_EntryPoint.c_str(),
+                                m_RequestHash.c_str());
+  if (m_bWriteJson)
+    AppendJsonEvent(Open.Name, Open.IsPass ? "pass" : "phase",
+                    Open.StartMicros, EndMicros);
+  m_Open.pop_back();
+}
+
+// Appends a complete ("X") event, which viewers nest by time on each thread.
+void DxcTraceListener::AppendJsonEvent(StringRef Name, const char *Category,
+                                       uint64_t StartMicros,
+                                       uint64_t EndMicros) {
+  raw_string_ostream OS(m_JsonEvents);
+  OS << "{\"name\": ";
+  WriteJsonString(OS, Name);
+  OS << ", \"cat\": \"" << Category << "\", \"ph\": \"X\", \"ts\": "
+     << StartMicros << ", \"dur\": " << (EndMicros - StartMicros)
+     << ", \"pid\": " << GetProcessId() << ", \"tid\": " << GetThreadId()
+     << ", \"args\": {\"source\": ";
+  WriteJsonString(OS, m_SourceName);
+  OS << ", \"entry\": ";
+  WriteJsonString(OS, m_EntryPoint);
+  OS << ", \"hash\": \"" << m_RequestHash << "\"}},\n";
+  OS.flush();
+}
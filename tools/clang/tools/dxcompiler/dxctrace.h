@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxctrace.h                                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Reports the phases and passes of a compile as trace events.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Timer.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+namespace opt {
+class InputArgList;
+} // namespace opt
+} // namespace llvm
+
+namespace dxcutil {
+
+// Listens for the phases and passes run on the constructing thread until it
+// is destroyed, and reports each of them as an event carrying the entry
+// point and a hash of the request. The shader hash is only known once the
+// compile is done, so the request hash, over the source and arguments,
+// stands in for it. Phases and passes are passed on to the listener that
+// was installed before, so a time report can be collected at the same time.
+//
+// On Windows, the events are ETW DXCompilerPhase and DXCompilerPass events.
+// When the DXC_TRACE_FILE environment variable names a file, the events are
+// also appended to it in the Chrome trace event format, which
+// chrome://tracing and Perfetto load. Each compile appends its events with a
+// single write when it is done, so many processes can share the same file.
+class DxcTraceListener : public llvm::PhaseTimingListener {
+public:
+  DxcTraceListener(llvm::StringRef SourceName, llvm::StringRef EntryPoint,
+                   llvm::StringRef Source, const llvm::opt::InputArgList &Args);
+  ~DxcTraceListener();
+
+  // Returns whether events would be sent anywhere.
+  static bool IsEnabled();
+
+  void startPhase(llvm::StringRef Name, bool IsPass) override;
+  void stopPhase() override;
+
+private:
+  struct OpenPhase {
+    std::string Name;
+    bool IsPass;
+    uint64_t StartMicros;
+  };
+
+  void AppendJsonEvent(llvm::StringRef Name, const char *Category,
+                       uint64_t StartMicros, uint64_t EndMicros);
+
+  std::string m_SourceName;
+  std::string m_EntryPoint;
+  std::string m_RequestHash;
+  std::vector<OpenPhase> m_Open;
+  std::string m_JsonEvents;
+  bool m_bWriteJson;
+  uint64_t m_StartMicros;
+  llvm::PhaseTimingListener *m_pPrior;
+
+  DxcTraceListener(const DxcTraceListener &) = delete;
+  void operator=(const DxcTraceListener &) = delete;
+};
+
+} // namespace dxcutil
@@ -23,7 +23,11 @@
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "dxc/Support/dxcapi.impl.h"
@@ -32,6 +36,8 @@
 
 #include "llvm/Support/Path.h"
 
+#include <mutex>
+
 using namespace llvm;
 using namespace hlsl;
 
@@ -45,14 +51,19 @@ HRESULT RunInternalValidator(_In_ IDxcValidator *pValidator,
                              _In_ llvm::Module *pModule,
                              _In_ llvm::Module *pDebugModule,
                              _In_ IDxcBlob *pShader, UINT32 Flags,
-                             _In_ IDxcOperationResult **ppResult);
+                             _In_ IDxcOperationResult **ppResult,
+                             unsigned ThreadCount = 1,
+                             hlsl::DxilValidationCache *pCache = nullptr);
 
 namespace {
 // AssembleToContainer helper functions.
 
+// The validator from dxil.dll is kept for the thread's later compiles. The
+// internal one is created for each use, since it allocates from the thread
+// allocator installed when it is created, which may be a compile's arena.
 bool CreateValidator(CComPtr<IDxcValidator> &pValidator) {
   if (DxilLibIsEnabled()) {
-    DxilLibCreateInstance(CLSID_DxcValidator, &pValidator);
+    DxilLibGetValidator(&pValidator);
   }
   bool bInternalValidator = false;
   if (pValidator == nullptr) {
@@ -92,25 +103,35 @@ void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor) {
   if (pMajor == nullptr || pMinor == nullptr)
     return;
 
-  CComPtr<IDxcValidator> pValidator;
-  CreateValidator(pValidator);
-
-  CComPtr<IDxcVersionInfo> pVersionInfo;
-  if (SUCCEEDED(pValidator.QueryInterface(&pVersionInfo))) {
-    IFT(pVersionInfo->GetVersion(pMajor, pMinor));
-  } else {
-    // Default to 1.0
-    *pMajor = 1;
-    *pMinor = 0;
-  }
+  // Which validator is used, and so its version, doesn't change once
+  // dxil.dll is loaded or known to be missing, so it is only asked once.
+  static std::once_flag versionOnce;
+  static unsigned valMajor = 1, valMinor = 0;
+  std::call_once(versionOnce, [] {
+    CComPtr<IDxcValidator> pValidator;
+    CreateValidator(pValidator);
+
+    CComPtr<IDxcVersionInfo> pVersionInfo;
+    if (SUCCEEDED(pValidator.QueryInterface(&pVersionInfo))) {
+      IFT(pVersionInfo->GetVersion(&valMajor, &valMinor));
+    } else {
+      // Default to 1.0
+      valMajor = 1;
+      valMinor = 0;
+    }
+  });
+  *pMajor = valMajor;
+  *pMinor = valMinor;
 }
 
 void AssembleToContainer(AssembleInputs &inputs) {
+  llvm::PhaseTimingRegion SerializePhase("Container Serialization");
   CComPtr<AbstractMemoryStream> pContainerStream;
   IFT(CreateMemoryStream(inputs.pMalloc, &pContainerStream));
   SerializeDxilContainerForModule(&inputs.pM->GetOrCreateDxilModule(),
                                   inputs.pModuleBitcode, pContainerStream, inputs.DebugName, inputs.SerializeFlags,
-                                  inputs.pShaderHashOut, inputs.pReflectionOut, inputs.pRootSigOut);
+                                  inputs.pShaderHashOut, inputs.pReflectionOut, inputs.pRootSigOut,
+                                  inputs.SerializationThreads);
   inputs.pOutputContainerBlob.Release();
   IFT(pContainerStream.QueryInterface(&inputs.pOutputContainerBlob));
 }
@@ -145,6 +166,7 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
   // If we have debug info, this will be a clone of the module before debug info is stripped.
   // This is used with internal validator to provide more useful error messages.
   std::unique_ptr<llvm::Module> llvmModuleWithDebugInfo;
+  llvm::Module *pModuleWithDebugInfo = inputs.pDebugModule;
 
   CComPtr<IDxcValidator> pValidator;
   bool bInternalValidator = CreateValidator(pValidator);
@@ -165,14 +187,22 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
     }
   }
 
+  // An external validator loads the program part itself, and may predate
+  // compressed bitcode.
+  if (!bInternalValidator)
+    inputs.SerializeFlags &= ~SerializeDxilFlags::CompressLibraryBitcode;
+
   if (bInternalValidator || pValidator2) {
     // If using the internal validator or external validator supports
     // IDxcValidator2, we'll use the modules directly. In this case, we'll want
     // to make a clone to avoid SerializeDxilContainerForModule stripping all
     // the debug info. The debug info will be stripped from the orginal module,
-    // but preserved in the cloned module.
-    if (llvm::getDebugMetadataVersionFromModule(*inputs.pM) != 0) {
+    // but preserved in the cloned module. Reuse the caller's clone if it has
+    // one.
+    if (!pModuleWithDebugInfo &&
+        llvm::getDebugMetadataVersionFromModule(*inputs.pM) != 0) {
       llvmModuleWithDebugInfo.reset(llvm::CloneModule(inputs.pM.get()));
+      pModuleWithDebugInfo = llvmModuleWithDebugInfo.get();
     }
   }
 
@@ -198,21 +228,24 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
 
   AssembleToContainer(inputs);
 
+  llvm::PhaseTimingRegion ValidationPhase("Validation");
   CComPtr<IDxcOperationResult> pValResult;
   // Important: in-place edit is required so the blob is reused and thus
   // dxil.dll can be released.
   if (bInternalValidator) {
     IFT(RunInternalValidator(pValidator, inputs.pM.get(),
-                             llvmModuleWithDebugInfo.get(), inputs.pOutputContainerBlob,
-                             DxcValidatorFlags_InPlaceEdit, &pValResult));
+                             pModuleWithDebugInfo, inputs.pOutputContainerBlob,
+                             DxcValidatorFlags_InPlaceEdit, &pValResult,
+                             inputs.ValidationThreads,
+                             inputs.pValidationCache));
   } else {
-    if (pValidator2 && llvmModuleWithDebugInfo) {
+    if (pValidator2 && pModuleWithDebugInfo) {
 
       // If metadata was stripped, re-serialize the input module.
       CComPtr<AbstractMemoryStream> pDebugModuleStream;
       IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pDebugModuleStream));
       raw_stream_ostream outStream(pDebugModuleStream.p);
-      WriteBitcodeToFile(llvmModuleWithDebugInfo.get(), outStream, true);
+      WriteBitcodeToFile(pModuleWithDebugInfo, outStream, true);
       outStream.flush();
 
       DxcBuffer debugModule = {};
@@ -319,4 +352,34 @@ bool IsAbsoluteOrCurDirRelative(const llvm::Twine &T) {
   return false;
 }
 
+DiskFileSystemScope::DiskFileSystemScope() {}
+DiskFileSystemScope::~DiskFileSystemScope() {}
+
+bool DiskFileSystemScope::Init() {
+  sys::fs::MSFileSystem *pFileSystem;
+  if (FAILED(CreateMSFileSystemForDisk(&pFileSystem)))
+    return false;
+  m_pFileSystem.reset(pFileSystem);
+  m_pScope.reset(new sys::fs::AutoPerThreadSystem(pFileSystem));
+  return !m_pScope->error_code();
+}
+
+void WriteJsonString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (char C : Str) {
+    switch (C) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if ((unsigned char)C < 0x20)
+        OS << format("\\u%04x", (unsigned)C);
+      else
+        OS << C;
+    }
+  }
+  OS << '"';
+}
+
 } // namespace dxcutil
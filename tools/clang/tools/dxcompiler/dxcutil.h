@@ -24,13 +24,20 @@ namespace llvm {
 class LLVMContext;
 class MemoryBuffer;
 class Module;
-class raw_string_ostream;
+class raw_ostream;
 class Twine;
+namespace sys {
+namespace fs {
+class AutoPerThreadSystem;
+class MSFileSystem;
+} // namespace fs
+} // namespace sys
 } // namespace llvm
 
 namespace hlsl {
 enum class SerializeDxilFlags : uint32_t;
 struct DxilShaderHash;
+class DxilValidationCache;
 class AbstractMemoryStream;
 namespace options {
 class MainArgs;
@@ -60,13 +67,26 @@ struct AssembleInputs {
   hlsl::DxilShaderHash *pShaderHashOut = nullptr;
   hlsl::AbstractMemoryStream *pReflectionOut = nullptr;
   hlsl::AbstractMemoryStream *pRootSigOut = nullptr;
+  // Threads the internal validator may validate library functions on.
+  unsigned ValidationThreads = 1;
+  // Threads the container serializer may write function bodies on.
+  unsigned SerializationThreads = 1;
+  // A clone of pM made before its debug info is stripped, if the caller
+  // already has one; validation uses it rather than cloning pM again.
+  llvm::Module *pDebugModule = nullptr;
+  // Library functions the internal validator has seen pass, if the caller
+  // validates the same functions repeatedly.
+  hlsl::DxilValidationCache *pValidationCache = nullptr;
 };
 HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs);
 HRESULT ValidateRootSignatureInContainer(
     IDxcBlob *pRootSigContainer, clang::DiagnosticsEngine *pDiag = nullptr);
 void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor);
 void AssembleToContainer(AssembleInputs &inputs);
-HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
+// Writes the disassembly of pProgram to Stream. With FunctionName, only that
+// function's definition is written; Threads is passed to Module::print.
+HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_ostream &Stream,
+                    unsigned Threads = 1, llvm::StringRef FunctionName = {});
 void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
                          hlsl::options::DxcOpts &opts,
                          hlsl::AbstractMemoryStream *pOutputStream,
@@ -84,4 +104,18 @@ void CreateOperationResultFromOutputs(
 
 bool IsAbsoluteOrCurDirRelative(const llvm::Twine &T);
 
+// Routes file system calls on this thread to the disk while in scope,
+// bypassing whatever file system the compile has installed.
+class DiskFileSystemScope {
+  std::unique_ptr<llvm::sys::fs::MSFileSystem> m_pFileSystem;
+  std::unique_ptr<llvm::sys::fs::AutoPerThreadSystem> m_pScope;
+public:
+  DiskFileSystemScope();
+  ~DiskFileSystemScope();
+  bool Init();
+};
+
+// Writes Str as a quoted JSON string.
+void WriteJsonString(llvm::raw_ostream &OS, llvm::StringRef Str);
+
 } // namespace dxcutil
\ No newline at end of file
@@ -69,7 +69,10 @@ private:
     _In_ UINT32 Flags,                            // Validation flags.
     _In_opt_ llvm::Module *pModule,               // Module to validate, if available.
     _In_opt_ llvm::Module *pDebugModule,          // Debug module to validate, if available
-    _In_ AbstractMemoryStream *pDiagStream);
+    _In_ AbstractMemoryStream *pDiagStream,
+    unsigned ThreadCount = 1,                     // Threads library functions may be validated on.
+    DxilValidationCache *pCache = nullptr,        // Library functions known to pass.
+    DxilValidationReport *pReport = nullptr);     // Rules broken and time per phase.
 
   HRESULT RunRootSignatureValidation(
     _In_ IDxcBlob *pShader,                       // Shader to validate.
@@ -89,7 +92,9 @@ public:
     _In_ UINT32 Flags,                            // Validation flags.
     _In_opt_ llvm::Module *pModule,               // Module to validate, if available.
     _In_opt_ llvm::Module *pDebugModule,          // Debug module to validate, if available
-    _COM_Outptr_ IDxcOperationResult **ppResult   // Validation output status, buffer, and errors
+    _COM_Outptr_ IDxcOperationResult **ppResult,  // Validation output status, buffer, and errors
+    unsigned ThreadCount = 1,                     // Threads library functions may be validated on.
+    DxilValidationCache *pCache = nullptr         // Library functions known to pass.
   );
 
   // IDxcValidator
@@ -131,6 +136,8 @@ HRESULT STDMETHODCALLTYPE DxcValidator::Validate(
     return E_INVALIDARG;
   if ((Flags & DxcValidatorFlags_ModuleOnly) && (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly)))
     return E_INVALIDARG;
+  if ((Flags & DxcValidatorFlags_MetadataOnly) && (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly | DxcValidatorFlags_ModuleOnly)))
+    return E_INVALIDARG;
   return ValidateWithOptModules(pShader, Flags, nullptr, nullptr, ppResult);
 }
 
@@ -148,6 +155,8 @@ HRESULT STDMETHODCALLTYPE DxcValidator::ValidateWithDebug(
     return E_INVALIDARG;
   if ((Flags & DxcValidatorFlags_ModuleOnly) && (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly)))
     return E_INVALIDARG;
+  if ((Flags & DxcValidatorFlags_MetadataOnly) && (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly | DxcValidatorFlags_ModuleOnly)))
+    return E_INVALIDARG;
   if (pOptDebugBitcode && (pOptDebugBitcode->Ptr == nullptr || pOptDebugBitcode->Size == 0 ||
                            pOptDebugBitcode->Size >= UINT32_MAX))
     return E_INVALIDARG;
@@ -180,7 +189,9 @@ HRESULT DxcValidator::ValidateWithOptModules(
   _In_ UINT32 Flags,                            // Validation flags.
   _In_opt_ llvm::Module *pModule,               // Module to validate, if available.
   _In_opt_ llvm::Module *pDebugModule,          // Debug module to validate, if available
-  _COM_Outptr_ IDxcOperationResult **ppResult   // Validation output status, buffer, and errors
+  _COM_Outptr_ IDxcOperationResult **ppResult,  // Validation output status, buffer, and errors
+  unsigned ThreadCount,                         // Threads library functions may be validated on.
+  DxilValidationCache *pCache                   // Library functions known to pass.
 ) {
   *ppResult = nullptr;
   HRESULT hr = S_OK;
@@ -190,13 +201,15 @@ HRESULT DxcValidator::ValidateWithOptModules(
   try {
     CComPtr<AbstractMemoryStream> pDiagStream;
     IFT(CreateMemoryStream(m_pMalloc, &pDiagStream));
+    DxilValidationReport Report;
 
     // Run validation may throw, but that indicates an inability to validate,
     // not that the validation failed (eg out of memory).
     if (Flags & DxcValidatorFlags_RootSignatureOnly) {
       validationStatus = RunRootSignatureValidation(pShader, pDiagStream);
     } else {
-      validationStatus = RunValidation(pShader, Flags, pModule, pDebugModule, pDiagStream);
+      validationStatus = RunValidation(pShader, Flags, pModule, pDebugModule, pDiagStream, ThreadCount, pCache,
+                                       (Flags & DxcValidatorFlags_Report) ? &Report : nullptr);
     }
     if (FAILED(validationStatus)) {
       std::string msg("Validation failed.\n");
@@ -207,9 +220,17 @@ HRESULT DxcValidator::ValidateWithOptModules(
     CComPtr<IDxcBlob> pDiagBlob;
     hr = pDiagStream.QueryInterface(&pDiagBlob);
     DXASSERT_NOMSG(SUCCEEDED(hr));
+    DxcOutputObject ReportOutput;
+    if (Flags & DxcValidatorFlags_Report) {
+      std::string ReportJson;
+      Report.WriteJson(ReportJson);
+      ReportOutput = DxcOutputObject::StringOutput(DXC_OUT_VALIDATION_REPORT,
+        CP_UTF8, ReportJson.c_str(), ReportJson.size(), DxcOutNoName);
+    }
     IFT(DxcResult::Create(validationStatus, DXC_OUT_NONE, {
         DxcOutputObject::ErrorOutput(CP_UTF8, // TODO Support DefaultTextCodePage
-          (LPCSTR)pDiagBlob->GetBufferPointer(), pDiagBlob->GetBufferSize())
+          (LPCSTR)pDiagBlob->GetBufferPointer(), pDiagBlob->GetBufferSize()),
+        ReportOutput
       }, ppResult));
   }
   CATCH_CPP_ASSIGN_HRESULT();
@@ -259,7 +280,10 @@ HRESULT DxcValidator::RunValidation(
   _In_ UINT32 Flags,                            // Validation flags.
   _In_opt_ llvm::Module *pModule,               // Module to validate, if available.
   _In_opt_ llvm::Module *pDebugModule,          // Debug module to validate, if available
-  _In_ AbstractMemoryStream *pDiagStream) {
+  _In_ AbstractMemoryStream *pDiagStream,
+  unsigned ThreadCount,
+  DxilValidationCache *pCache,
+  DxilValidationReport *pReport) {
 
   // Run validation may throw, but that indicates an inability to validate,
   // not that the validation failed (eg out of memory). That is indicated
@@ -277,8 +301,10 @@ HRESULT DxcValidator::RunValidation(
     DXASSERT_NOMSG(pDebugModule == nullptr);
     if (Flags & DxcValidatorFlags_ModuleOnly) {
       return ValidateDxilBitcode((const char*)pShader->GetBufferPointer(), (uint32_t)pShader->GetBufferSize(), DiagStream);
+    } else if (Flags & DxcValidatorFlags_MetadataOnly) {
+      return ValidateDxilContainerMetadata(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream, pReport);
     } else {
-      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream);
+      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream, pReport);
     }
   }
 
@@ -286,11 +312,15 @@ HRESULT DxcValidator::RunValidation(
   PrintDiagnosticContext DiagContext(DiagPrinter);
   DiagRestore DR(pModule->getContext(), &DiagContext);
 
-  IFR(hlsl::ValidateDxilModule(pModule, pDebugModule));
+  if (Flags & DxcValidatorFlags_MetadataOnly) {
+    IFR(hlsl::ValidateDxilModuleMetadata(pModule, pReport));
+  } else {
+    IFR(hlsl::ValidateDxilModule(pModule, pDebugModule, ThreadCount, pCache, pReport));
+  }
   if (!(Flags & DxcValidatorFlags_ModuleOnly)) {
     IFR(ValidateDxilContainerParts(pModule, pDebugModule,
                       IsDxilContainerLike(pShader->GetBufferPointer(), pShader->GetBufferSize()),
-                      (uint32_t)pShader->GetBufferSize()));
+                      (uint32_t)pShader->GetBufferSize(), pReport));
   }
 
   if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
@@ -319,19 +349,16 @@ HRESULT DxcValidator::RunRootSignatureValidation(
     IFRBOOL(pPSVPart, DXC_E_MISSING_PART);
   }
   try {
-    RootSignatureHandle RSH;
-    RSH.LoadSerialized((const uint8_t*)GetDxilPartData(pRSPart), pRSPart->PartSize);
-    RSH.Deserialize();
     raw_stream_ostream DiagStream(pDiagStream);
     if (pProgramHeader) {
-      IFRBOOL(VerifyRootSignatureWithShaderPSV(RSH.GetDesc(),
-                                               GetVersionShaderType(pProgramHeader->ProgramVersion),
-                                               GetDxilPartData(pPSVPart),
-                                               pPSVPart->PartSize,
-                                               DiagStream),
+      IFRBOOL(VerifySerializedRootSignatureWithShaderPSV(
+                  GetDxilPartData(pRSPart), pRSPart->PartSize,
+                  GetVersionShaderType(pProgramHeader->ProgramVersion),
+                  GetDxilPartData(pPSVPart), pPSVPart->PartSize, DiagStream),
               DXC_E_INCORRECT_ROOT_SIGNATURE);
     } else {
-      IFRBOOL(VerifyRootSignature(RSH.GetDesc(), DiagStream, false),
+      IFRBOOL(VerifySerializedRootSignature(GetDxilPartData(pRSPart),
+                                            pRSPart->PartSize, DiagStream),
               DXC_E_INCORRECT_ROOT_SIGNATURE);
     }
   } catch(...) {
@@ -347,7 +374,9 @@ HRESULT RunInternalValidator(_In_ IDxcValidator *pValidator,
                              _In_ llvm::Module *pModule,
                              _In_ llvm::Module *pDebugModule,
                              _In_ IDxcBlob *pShader, UINT32 Flags,
-                             _COM_Outptr_ IDxcOperationResult **ppResult) {
+                             _COM_Outptr_ IDxcOperationResult **ppResult,
+                             unsigned ThreadCount,
+                             DxilValidationCache *pCache) {
   DXASSERT_NOMSG(pValidator != nullptr);
   DXASSERT_NOMSG(pModule != nullptr);
   DXASSERT_NOMSG(pShader != nullptr);
@@ -355,7 +384,8 @@ HRESULT RunInternalValidator(_In_ IDxcValidator *pValidator,
 
   DxcValidator *pInternalValidator = (DxcValidator *)pValidator;
   return pInternalValidator->ValidateWithOptModules(pShader, Flags, pModule,
-                                                    pDebugModule, ppResult);
+                                                    pDebugModule, ppResult,
+                                                    ThreadCount, pCache);
 }
 
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID* ppv) {
@@ -13,6 +13,10 @@
 #include "dxc/Support/Global.h" // For DXASSERT
 #include "dxc/Support/dxcapi.use.h"
 #include "llvm/Support/Mutex.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 using namespace dxc;
 
@@ -20,6 +24,31 @@ static DxcDllSupport g_DllSupport;
 static HRESULT g_DllLibResult = S_OK;
 
 static llvm::sys::Mutex *cs = nullptr;
+// 1 once dxil.dll is loaded, -1 once it failed to load, 0 before.
+static std::atomic<int> g_DllLibSettled(0);
+
+// Validators created from dxil.dll, one for each thread that asked for one;
+// the validator isn't known to be safe to share between threads. Each holds
+// a reference, and they are allocated from the default allocator since they
+// outlive the compile that created them.
+typedef std::unordered_map<std::thread::id, IDxcValidator *> ValidatorMap;
+static std::mutex g_ValidatorsMutex;
+static ValidatorMap *g_pValidators = nullptr;
+
+// Drops the cached validators. At process termination dxil.dll may already
+// be gone, so their references are leaked rather than released.
+static void ClearValidators(bool bRelease) {
+  DxcThreadMalloc TM(nullptr);
+  std::lock_guard<std::mutex> lock(g_ValidatorsMutex);
+  if (g_pValidators == nullptr)
+    return;
+  if (bRelease) {
+    for (auto &Entry : *g_pValidators)
+      Entry.second->Release();
+  }
+  delete g_pValidators;
+  g_pValidators = nullptr;
+}
 
 // Check if we can successfully get IDxcValidator from dxil.dll
 // This function is to prevent multiple attempts to load dxil.dll 
@@ -35,6 +64,7 @@ HRESULT DxilLibInitialize() {
 
 HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
   HRESULT hr = S_OK;
+  ClearValidators(type == DxilLibCleanUpType::UnloadLibrary);
   if (type == DxilLibCleanUpType::ProcessTermination) {
     g_DllSupport.Detach();
   }
@@ -44,6 +74,7 @@ HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
   else {
     hr = E_INVALIDARG;
   }
+  g_DllLibSettled.store(0);
   delete cs;
   cs = nullptr;
   return hr;
@@ -54,14 +85,22 @@ HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
 // have multiple attempts to load dxil.dll
 bool DxilLibIsEnabled() {
 #if LLVM_ON_WIN32
+  // Once dxil.dll is loaded, or failed to load, the answer doesn't change,
+  // so concurrent compiles don't need to take the lock for it.
+  int settled = g_DllLibSettled.load(std::memory_order_acquire);
+  if (settled != 0)
+    return settled > 0;
   cs->lock();
   if (SUCCEEDED(g_DllLibResult)) {
     if (!g_DllSupport.IsEnabled()) {
       g_DllLibResult = g_DllSupport.InitializeForDll(L"dxil.dll", "DxcCreateInstance");
     }
   }
+  bool enabled = SUCCEEDED(g_DllLibResult);
+  if (!enabled || g_DllSupport.IsEnabled())
+    g_DllLibSettled.store(enabled ? 1 : -1, std::memory_order_release);
   cs->unlock();
-  return SUCCEEDED(g_DllLibResult);
+  return enabled;
 #else
   g_DllLibResult = (HRESULT)-1;
   return false;
@@ -72,10 +111,47 @@ bool DxilLibIsEnabled() {
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ REFIID riid, _In_ IUnknown **ppInterface) {
   DXASSERT_NOMSG(ppInterface != nullptr);
   HRESULT hr = E_FAIL;
+  // The library is only unloaded at shutdown, so creating instances from it
+  // needs no lock.
   if (DxilLibIsEnabled()) {
-    cs->lock();
     hr = g_DllSupport.CreateInstance(rclsid, riid, ppInterface);
-    cs->unlock();
   }
   return hr;
 }
+
+HRESULT DxilLibGetValidator(_COM_Outptr_ IDxcValidator **ppValidator) {
+  DXASSERT_NOMSG(ppValidator != nullptr);
+  *ppValidator = nullptr;
+  if (!DxilLibIsEnabled())
+    return E_FAIL;
+
+  std::thread::id thread = std::this_thread::get_id();
+  {
+    std::lock_guard<std::mutex> lock(g_ValidatorsMutex);
+    if (g_pValidators != nullptr) {
+      auto it = g_pValidators->find(thread);
+      if (it != g_pValidators->end()) {
+        it->second->AddRef();
+        *ppValidator = it->second;
+        return S_OK;
+      }
+    }
+  }
+
+  CComPtr<IDxcValidator> pValidator;
+  IFR(g_DllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+  try {
+    DxcThreadMalloc TM(nullptr);
+    std::lock_guard<std::mutex> lock(g_ValidatorsMutex);
+    if (g_pValidators == nullptr)
+      g_pValidators = new ValidatorMap();
+    IDxcValidator *&pCached = (*g_pValidators)[thread];
+    if (pCached == nullptr) {
+      pCached = pValidator;
+      pCached->AddRef();
+    }
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  *ppValidator = pValidator.Detach();
+  return S_OK;
+}
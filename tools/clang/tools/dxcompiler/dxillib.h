@@ -34,6 +34,13 @@ bool DxilLibIsEnabled();
 
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ REFIID riid, _In_ IUnknown **ppInterface);
 
+struct IDxcValidator;
+
+// Gets the validator from dxil.dll for the calling thread. It is created the
+// first time the thread asks for one and kept until the library is cleaned
+// up, so compiles don't create an instance each.
+HRESULT DxilLibGetValidator(_COM_Outptr_ IDxcValidator **ppValidator);
+
 template <class TInterface>
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ TInterface **ppInterface) {
   return DxilLibCreateInstance(rclsid, __uuidof(TInterface), (IUnknown**) ppInterface);
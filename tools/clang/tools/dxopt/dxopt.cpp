@@ -24,8 +24,10 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/microcom.h"
 #include <comdef.h>
+#include <algorithm>
 #include <iostream>
 #include <limits>
+#include <random>
 
 #include "llvm/Support/FileSystem.h"
 
@@ -47,6 +49,8 @@ enum class ProgramAction {
   PrintPasses,
   PrintPassesWithDetails,
   RunOptimizer,
+  RunPipelines,
+  Autotune,
 };
 
 const wchar_t *STDIN_FILE_NAME = L"-";
@@ -193,15 +197,398 @@ static void ReadFileOpts(LPCWSTR pPassFileName, IDxcBlobEncoding **ppPassOpts, s
   pPassOpts->QueryInterface(ppPassOpts);
 }
 
+// Reads one pipeline per line of pPipelineFileName, with its options
+// separated by spaces or tabs. The options point into *ppPipelineText.
+static void ReadPipelines(LPCWSTR pPipelineFileName, IDxcBlobUtf16 **ppPipelineText,
+                          std::vector<std::wstring> &lines,
+                          std::vector<LPCWSTR> &options,
+                          std::vector<UINT32> &optionCounts) {
+  CComPtr<IDxcBlob> pPipelineBlob;
+  CComPtr<IDxcBlobUtf16> pPipelineText;
+  BlobFromFile(pPipelineFileName, &pPipelineBlob);
+  IFT(hlsl::DxcGetBlobAsUtf16(pPipelineBlob, hlsl::GetGlobalHeapMalloc(), &pPipelineText));
+  LPWSTR pCursor = const_cast<LPWSTR>(pPipelineText->GetStringPointer());
+  while (*pCursor) {
+    LPWSTR pLine = pCursor;
+    while (*pCursor && *pCursor != L'\n' && *pCursor != L'\r') {
+      ++pCursor;
+    }
+    std::wstring line(pLine, pCursor);
+    while (*pCursor && (*pCursor == L'\n' || *pCursor == L'\r')) {
+      *pCursor = L'\0';
+      ++pCursor;
+    }
+
+    // Skip empty entries and comments.
+    UINT32 count = 0;
+    for (LPWSTR pOption = pLine; *pOption && *pOption != L'#';) {
+      if (*pOption == L' ' || *pOption == L'\t') {
+        *pOption++ = L'\0';
+        continue;
+      }
+      options.push_back(pOption);
+      ++count;
+      while (*pOption && *pOption != L' ' && *pOption != L'\t') {
+        ++pOption;
+      }
+    }
+    if (count) {
+      lines.push_back(line);
+      optionCounts.push_back(count);
+    }
+  }
+  *ppPipelineText = pPipelineText.Detach();
+}
+
+// RunOptimizerPipelines leaves the stats of a failed pipeline zeroed.
+static bool PipelineSucceeded(const DxcOptimizerPipelineStats &stats) {
+  return stats.InstructionCount != 0 || stats.RunMicroseconds != 0;
+}
+
+static void RunPipelines(IDxcOptimizer *pOptimizer, IDxcBlob *pBlob, LPCWSTR pPipelineFileName) {
+  CComPtr<IDxcOptimizer3> pOptimizer3;
+  CComPtr<IDxcBlobUtf16> pPipelineText;
+  std::vector<std::wstring> lines;
+  std::vector<LPCWSTR> options;
+  std::vector<UINT32> optionCounts;
+  IFT(pOptimizer->QueryInterface(&pOptimizer3));
+  ReadPipelines(pPipelineFileName, &pPipelineText, lines, options, optionCounts);
+
+  std::vector<DxcOptimizerPipelineStats> stats(lines.size());
+  HRESULT hr = pOptimizer3->RunOptimizerPipelines(
+      pBlob, options.data(), optionCounts.data(), (UINT32)lines.size(),
+      stats.data(), nullptr, nullptr);
+
+  // A pipeline that fails is reported without stopping the others.
+  wprintf(L"%s", L"# pipeline\tinstructions\tmicroseconds\thash\tpasses\n");
+  for (size_t i = 0; i < lines.size(); ++i) {
+    wchar_t hash[33] = L"failed";
+    if (PipelineSucceeded(stats[i])) {
+      for (unsigned b = 0; b < _countof(stats[i].OutputHash); ++b)
+        swprintf_s(hash + b * 2, 3, L"%02x", stats[i].OutputHash[b]);
+    }
+    wprintf(L"%u\t%u\t%llu\t%s\t%s\n", (unsigned)i, stats[i].InstructionCount,
+            (unsigned long long)stats[i].RunMicroseconds, hash, lines[i].c_str());
+  }
+  IFT(hr);
+}
+
+// Weights of instructions by LLVM opcode or callee name prefix, read from a
+// cost file with one NAME WEIGHT pair per line. Longer names come first so
+// the most specific one matches; unlisted instructions weigh 1.
+typedef std::vector<std::pair<std::string, double>> CostTable;
+
+static void ReadCostTable(LPCWSTR pCostFileName, CostTable &costs) {
+  CComPtr<IDxcBlobUtf16> pCostText;
+  std::vector<std::wstring> lines;
+  std::vector<LPCWSTR> tokens;
+  std::vector<UINT32> tokenCounts;
+  ReadPipelines(pCostFileName, &pCostText, lines, tokens, tokenCounts);
+  size_t first = 0;
+  for (UINT32 count : tokenCounts) {
+    if (count != 2) {
+      throw hlsl::Exception(E_INVALIDARG,
+                            "cost file lines must have a name and a weight");
+    }
+    CW2A name(tokens[first], CP_UTF8);
+    costs.emplace_back(name.m_psz, _wtof(tokens[first + 1]));
+    first += count;
+  }
+  std::stable_sort(costs.begin(), costs.end(),
+                   [](const CostTable::value_type &a,
+                      const CostTable::value_type &b) {
+                     return a.first.size() > b.first.size();
+                   });
+}
+
+// Sums the weights of the instructions in the function bodies of the module
+// printed in pText.
+static double GetModuleCost(IDxcBlobEncoding *pText, const CostTable &costs) {
+  std::string text((const char *)pText->GetBufferPointer(),
+                   pText->GetBufferSize());
+  double total = 0;
+  bool inFunction = false;
+  size_t lineStart = 0;
+  while (lineStart < text.size()) {
+    size_t lineEnd = text.find('\n', lineStart);
+    if (lineEnd == std::string::npos)
+      lineEnd = text.size();
+    std::string line = text.substr(lineStart, lineEnd - lineStart);
+    lineStart = lineEnd + 1;
+
+    if (line.compare(0, 7, "define ") == 0) {
+      inFunction = true;
+      continue;
+    }
+    if (line == "}") {
+      inFunction = false;
+      continue;
+    }
+    // Instructions are indented, labels and comments are not.
+    size_t pos = line.find_first_not_of(' ');
+    if (!inFunction || pos == 0 || pos == std::string::npos || line[pos] == ';')
+      continue;
+    if (line[pos] == '%') {
+      size_t assign = line.find(" = ", pos);
+      if (assign == std::string::npos)
+        continue;
+      pos = assign + 3;
+    }
+    std::string name = line.substr(pos, line.find(' ', pos) - pos);
+    if (name == "tail" || name == "musttail") {
+      pos += name.size() + 1;
+      name = line.substr(pos, line.find(' ', pos) - pos);
+    }
+    if (name == "call") {
+      size_t callee = line.find('@', pos);
+      if (callee != std::string::npos)
+        name = line.substr(callee + 1, line.find('(', callee) - callee - 1);
+    }
+
+    double weight = 1;
+    for (const auto &cost : costs) {
+      if (name.compare(0, cost.first.size(), cost.first) == 0) {
+        weight = cost.second;
+        break;
+      }
+    }
+    total += weight;
+  }
+  return total;
+}
+
+struct TuneCandidate {
+  std::vector<std::wstring> Steps;
+  double Cost;
+};
+
+// Flags and pass-manager switches keep their place in the pipeline.
+static bool IsTunableStep(const std::wstring &step) {
+  return !wcsistarts(step.c_str(), L"-opt-") &&
+         !wcsistarts(step.c_str(), L"-print-module") &&
+         !wcsistarts(step.c_str(), L"-hlsl-passes-") && step != L"-S" &&
+         step != L"-analyze";
+}
+
+// Scores each candidate by its total cost over the corpus: the instruction
+// count, or the weighted cost when a cost table is given. A candidate that
+// fails on any input gets an infinite cost.
+static void ScoreCandidates(IDxcOptimizer3 *pOptimizer,
+                            const std::vector<CComPtr<IDxcBlob>> &corpus,
+                            const CostTable *pCosts,
+                            std::vector<TuneCandidate> &candidates) {
+  std::vector<LPCWSTR> options;
+  std::vector<UINT32> optionCounts;
+  for (TuneCandidate &candidate : candidates) {
+    for (const std::wstring &step : candidate.Steps)
+      options.push_back(step.c_str());
+    if (pCosts)
+      options.push_back(L"-S");
+    optionCounts.push_back((UINT32)(candidate.Steps.size() + (pCosts ? 1 : 0)));
+    candidate.Cost = 0;
+  }
+
+  UINT32 count = (UINT32)candidates.size();
+  std::vector<DxcOptimizerPipelineStats> stats(count);
+  std::vector<IDxcBlobEncoding *> texts(count);
+  for (IDxcBlob *pBlob : corpus) {
+    std::fill(texts.begin(), texts.end(), nullptr);
+    // Failures are found from the stats of each pipeline.
+    pOptimizer->RunOptimizerPipelines(pBlob, options.data(),
+                                      optionCounts.data(), count, stats.data(),
+                                      nullptr, pCosts ? texts.data() : nullptr);
+    for (UINT32 i = 0; i < count; ++i) {
+      CComPtr<IDxcBlobEncoding> pText;
+      pText.Attach(texts[i]);
+      if (!PipelineSucceeded(stats[i]) || (pCosts && !pText))
+        candidates[i].Cost = std::numeric_limits<double>::infinity();
+      else if (pCosts)
+        candidates[i].Cost += GetModuleCost(pText, *pCosts);
+      else
+        candidates[i].Cost += stats[i].InstructionCount;
+    }
+  }
+}
+
+// Changes one integer or boolean argument of step, as in
+// -loop-unroll,Threshold=150. Returns false if step has none.
+static bool MutateStepArgument(std::wstring &step, std::mt19937 &rng) {
+  std::vector<size_t> values;
+  for (size_t pos = step.find(L'='); pos != std::wstring::npos;
+       pos = step.find(L'=', pos + 1))
+    values.push_back(pos + 1);
+  if (values.empty())
+    return false;
+
+  size_t valueStart = values[rng() % values.size()];
+  size_t valueEnd = step.find(L',', valueStart);
+  if (valueEnd == std::wstring::npos)
+    valueEnd = step.size();
+  std::wstring value = step.substr(valueStart, valueEnd - valueStart);
+  std::wstring newValue;
+  if (wcsieq(value.c_str(), L"true")) {
+    newValue = L"false";
+  } else if (wcsieq(value.c_str(), L"false")) {
+    newValue = L"true";
+  } else {
+    wchar_t *pEnd = nullptr;
+    long number = wcstol(value.c_str(), &pEnd, 10);
+    if (value.empty() || *pEnd)
+      return false;
+    number = (rng() % 2) ? number * 2 : number / 2;
+    if (number == 0 && !(rng() % 2))
+      number = 1;
+    newValue = std::to_wstring(number);
+  }
+  step.replace(valueStart, valueEnd - valueStart, newValue);
+  return true;
+}
+
+// Applies one random change to steps: drops a pass, swaps two neighbouring
+// passes, inserts a pass from pool or changes a pass argument.
+static bool MutateSteps(std::vector<std::wstring> &steps,
+                        const std::vector<std::wstring> &pool,
+                        std::mt19937 &rng) {
+  size_t size = steps.size();
+  switch (rng() % 4) {
+  case 0: {
+    if (size == 0)
+      return false;
+    size_t i = rng() % size;
+    if (!IsTunableStep(steps[i]))
+      return false;
+    steps.erase(steps.begin() + i);
+    return true;
+  }
+  case 1: {
+    if (size < 2)
+      return false;
+    size_t i = rng() % (size - 1);
+    if (!IsTunableStep(steps[i]) || !IsTunableStep(steps[i + 1]) ||
+        steps[i] == steps[i + 1])
+      return false;
+    std::swap(steps[i], steps[i + 1]);
+    return true;
+  }
+  case 2:
+    if (pool.empty())
+      return false;
+    steps.insert(steps.begin() + rng() % (size + 1), pool[rng() % pool.size()]);
+    return true;
+  default: {
+    if (size == 0)
+      return false;
+    size_t i = rng() % size;
+    return IsTunableStep(steps[i]) && MutateStepArgument(steps[i], rng);
+  }
+  }
+}
+
+// Searches for a pipeline cheaper than the one in pSeedFileName over the
+// corpus by hill climbing: each round scores a few random variations of the
+// best pipeline so far and keeps the cheapest. Writes the result as a pass
+// file for -pf.
+static void Autotune(IDxcOptimizer *pOptimizer,
+                     const std::vector<CComPtr<IDxcBlob>> &corpus,
+                     LPCWSTR pSeedFileName, LPCWSTR pCostFileName,
+                     UINT32 rounds, UINT32 randomSeed, LPCWSTR pOutFileName) {
+  const UINT32 CandidatesPerRound = 8;
+  CComPtr<IDxcOptimizer3> pOptimizer3;
+  IFT(pOptimizer->QueryInterface(&pOptimizer3));
+
+  CComPtr<IDxcBlobEncoding> pSeedText;
+  std::vector<LPCWSTR> seedPasses;
+  LPCWSTR *pSeedArgs = nullptr;
+  UINT32 seedArgCount = 0;
+  ReadFileOpts(pSeedFileName, &pSeedText, seedPasses, &pSeedArgs, &seedArgCount);
+  CostTable costs;
+  if (pCostFileName)
+    ReadCostTable(pCostFileName, costs);
+  const CostTable *pCosts = pCostFileName ? &costs : nullptr;
+
+  std::vector<TuneCandidate> best(1);
+  std::vector<std::wstring> pool;
+  for (UINT32 i = 0; i < seedArgCount; ++i) {
+    best[0].Steps.push_back(pSeedArgs[i]);
+    if (IsTunableStep(pSeedArgs[i]) &&
+        std::find(pool.begin(), pool.end(), pSeedArgs[i]) == pool.end())
+      pool.push_back(pSeedArgs[i]);
+  }
+  ScoreCandidates(pOptimizer3, corpus, pCosts, best);
+  const double seedCost = best[0].Cost;
+  if (seedCost == std::numeric_limits<double>::infinity()) {
+    throw hlsl::Exception(E_FAIL, "seed pipeline fails on the input corpus");
+  }
+  wprintf(L"# seed cost %g\n", seedCost);
+
+  std::mt19937 rng(randomSeed);
+  for (UINT32 round = 0; round < rounds; ++round) {
+    std::vector<TuneCandidate> candidates(CandidatesPerRound);
+    for (TuneCandidate &candidate : candidates) {
+      candidate.Steps = best[0].Steps;
+      // Retry until something changes, without looping forever.
+      for (unsigned attempt = 0; attempt < 16; ++attempt)
+        if (MutateSteps(candidate.Steps, pool, rng))
+          break;
+    }
+    ScoreCandidates(pOptimizer3, corpus, pCosts, candidates);
+
+    bool improved = false;
+    for (TuneCandidate &candidate : candidates) {
+      if (candidate.Cost < best[0].Cost ||
+          (candidate.Cost == best[0].Cost &&
+           candidate.Steps.size() < best[0].Steps.size())) {
+        best[0] = std::move(candidate);
+        improved = true;
+      }
+    }
+    if (improved) {
+      wprintf(L"# round %u: cost %g with %u passes\n", round, best[0].Cost,
+              (unsigned)best[0].Steps.size());
+    }
+  }
+
+  std::wstring preset = L"# dxopt -autotune: cost " +
+                        std::to_wstring(best[0].Cost) + L", seed cost " +
+                        std::to_wstring(seedCost) + L"\n";
+  for (const std::wstring &step : best[0].Steps)
+    preset += step + L"\n";
+  if (pOutFileName && *pOutFileName) {
+    CComPtr<IDxcLibrary> pLibrary;
+    CComPtr<IDxcBlobEncoding> pPreset;
+    CW2A preset8(preset.c_str(), CP_UTF8);
+    IFT(g_DxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+    IFT(pLibrary->CreateBlobWithEncodingOnHeapCopy(
+        preset8.m_psz, (UINT32)strlen(preset8.m_psz), CP_UTF8, &pPreset));
+    dxc::WriteBlobToFile(pPreset, pOutFileName, DXC_CP_UTF8);
+  } else {
+    wprintf(L"%s", preset.c_str());
+  }
+}
+
 static void PrintHelp() {
   wprintf(L"%s",
     L"Performs optimizations on a bitcode file by running a sequence of passes.\n\n"
-    L"dxopt [-? | -passes | -pass-details | -pf [PASS-FILE] | [-o=OUT-FILE] | IN-FILE OPT-ARGUMENTS ...]\n\n"
+    L"dxopt [-? | -passes | -pass-details | -pf [PASS-FILE] | -pipelines PIPELINE-FILE | -autotune SEED-PASS-FILE | [-o=OUT-FILE] | IN-FILE OPT-ARGUMENTS ...]\n\n"
     L"Arguments:\n"
     L"  -?  Displays this help message\n"
     L"  -passes        Displays a list of pass names\n"
     L"  -pass-details  Displays a list of passes with detailed information\n"
     L"  -pf PASS-FILE  Loads passes from the specified file\n"
+    L"  -pipelines PIPELINE-FILE\n"
+    L"                 Runs each line of the file as a separate pipeline on a copy\n"
+    L"                 of the module, and reports its instruction count, time and\n"
+    L"                 output hash\n"
+    L"  -autotune SEED-PASS-FILE\n"
+    L"                 Searches for reorderings, removals, repetitions and argument\n"
+    L"                 changes of the passes in the file that lower the cost of\n"
+    L"                 every IN-FILE given, and writes the best one as a pass file\n"
+    L"  -tune-costs COST-FILE\n"
+    L"                 Scores -autotune candidates with the NAME WEIGHT pairs in the\n"
+    L"                 file, by LLVM opcode or callee prefix, instead of counting\n"
+    L"                 instructions\n"
+    L"  -tune-rounds N Number of -autotune search rounds (default 50)\n"
+    L"  -tune-seed N   Random seed for -autotune (default 1)\n"
     L"  -o=OUT-FILE    Output file for processed module\n"
     L"  IN-FILE        File with with bitcode to optimize\n"
     L"  OPT-ARGUMENTS  One or more passes to run in sequence\n"
@@ -226,6 +613,11 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
     LPCWSTR externalLib = nullptr;
     LPCWSTR externalFn = nullptr;
     LPCWSTR passFileName = nullptr;
+    LPCWSTR pipelinesFileName = nullptr;
+    LPCWSTR seedFileName = nullptr;
+    LPCWSTR costFileName = nullptr;
+    UINT32 tuneRounds = 50;
+    UINT32 tuneSeed = 1;
     const wchar_t **optArgs = nullptr;
     UINT32 optArgCount = 0;
 
@@ -265,6 +657,42 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
         }
         passFileName = argv_[argIdx];
       }
+      else if (wcsieqopt(arg, L"pipelines")) {
+        ++argIdx;
+        if (argIdx == argc) {
+          PrintHelp();
+          return 1;
+        }
+        pipelinesFileName = argv_[argIdx];
+      }
+      else if (wcsieqopt(arg, L"autotune")) {
+        ++argIdx;
+        if (argIdx == argc) {
+          PrintHelp();
+          return 1;
+        }
+        seedFileName = argv_[argIdx];
+      }
+      else if (wcsieqopt(arg, L"tune-costs")) {
+        ++argIdx;
+        if (argIdx == argc) {
+          PrintHelp();
+          return 1;
+        }
+        costFileName = argv_[argIdx];
+      }
+      else if (wcsieqopt(arg, L"tune-rounds") || wcsieqopt(arg, L"tune-seed")) {
+        ++argIdx;
+        if (argIdx == argc) {
+          PrintHelp();
+          return 1;
+        }
+        UINT32 value = wcstoul(argv_[argIdx], nullptr, 10);
+        if (wcsieqopt(arg, L"tune-rounds"))
+          tuneRounds = value;
+        else
+          tuneSeed = value;
+      }
       else if (wcsistarts(arg, L"-o=")) {
         outFileName = argv_[argIdx] + 3;
       }
@@ -298,6 +726,25 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
       return 1;
     }
 
+    if (pipelinesFileName) {
+      if (passFileName || optArgCount || outFileName) {
+        wprintf(L"%s", L"Cannot specify passes or an output file with a pipeline file.\n");
+        return 1;
+      }
+      if (action == ProgramAction::RunOptimizer)
+        action = ProgramAction::RunPipelines;
+    }
+
+    if (seedFileName) {
+      if (passFileName || pipelinesFileName) {
+        wprintf(L"%s", L"Cannot specify a pass or pipeline file with -autotune.\n");
+        return 1;
+      }
+      // The remaining arguments are more corpus files.
+      if (action == ProgramAction::RunOptimizer)
+        action = ProgramAction::Autotune;
+    }
+
     if (externalLib) {
       CW2A externalFnA(externalFn, CP_UTF8);
       IFT(g_DxcSupport.InitializeForDll(externalLib, externalFnA));
@@ -329,6 +776,21 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
       IFT(pOptimizer->RunOptimizer(pBlob, optArgs, optArgCount, &pOutputModule, &pOutputText));
       PrintOptOutput(outFileName, pOutputModule, pOutputText);
       break;
+    case ProgramAction::RunPipelines:
+      pStage = "Pipeline processing";
+      BlobFromFile(inFileName, &pBlob);
+      RunPipelines(pOptimizer, pBlob, pipelinesFileName);
+      break;
+    case ProgramAction::Autotune: {
+      pStage = "Autotuning";
+      std::vector<CComPtr<IDxcBlob>> corpus(1 + optArgCount);
+      BlobFromFile(inFileName, &corpus[0]);
+      for (UINT32 i = 0; i < optArgCount; ++i)
+        BlobFromFile(optArgs[i], &corpus[i + 1]);
+      Autotune(pOptimizer, corpus, seedFileName, costFileName, tuneRounds,
+               tuneSeed, outFileName);
+      break;
+    }
     }
   } catch (const ::hlsl::Exception &hlslException) {
     try {
@@ -126,12 +126,13 @@ static void saveModuleToAsmFile(const llvm::Module* mod, const std::string& file
   }
 }
 
-class DxcDxrFallbackCompiler : public IDxcDxrFallbackCompiler
+class DxcDxrFallbackCompiler : public IDxcDxrFallbackCompiler2
 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
     bool m_findCalledShaders = false;
   int m_debugOutput = 0;
+  bool m_binnedDispatch = false;
 
   // Only used for test purposes when exports aren't explicitly listed
   std::unique_ptr<DxrFallbackCompiler::IntToFuncNameMap> m_pCachedMap;
@@ -141,7 +142,7 @@ public:
 
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject)
   {
-    return DoBasicQueryInterface<IDxcDxrFallbackCompiler>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcDxrFallbackCompiler, IDxcDxrFallbackCompiler2>(this, iid, ppvObject);
   }
 
   __override HRESULT STDMETHODCALLTYPE SetFindCalledShaders(bool val)
@@ -156,6 +157,12 @@ public:
     return S_OK;
   }
 
+  __override HRESULT STDMETHODCALLTYPE SetBinnedDispatch(bool val)
+  {
+    m_binnedDispatch = val;
+    return S_OK;
+  }
+
   __override HRESULT STDMETHODCALLTYPE PatchShaderBindingTables(
       _In_ const LPCWSTR pEntryName,
       _In_ DxcShaderBytecode *pShaderBytecode,
@@ -499,6 +506,7 @@ HRESULT STDMETHODCALLTYPE DxcDxrFallbackCompiler::Link(
 
         DxrFallbackCompiler compiler(M.get(), shaderNames, maxAttributeSize, stackSizeInBytes, m_findCalledShaders);
         compiler.setDebugOutputLevel(m_debugOutput);
+        compiler.setBinnedDispatch(m_binnedDispatch);
         shaderEntryStateIds.resize(shaderCount);
         shaderStackSizes.resize(shaderCount);
         for (UINT i = 0; i < shaderCount; i++)
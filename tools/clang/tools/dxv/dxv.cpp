@@ -17,12 +17,24 @@
 #include "dxc/dxcapi.internal.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/HLSLOptions.h"
+#include "dxc/Support/FileIOHelper.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support//MSFileSystem.h"
 #include "llvm/Support/FileSystem.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 using namespace dxc;
 using namespace llvm;
 using namespace llvm::opt;
@@ -39,6 +51,19 @@ static cl::opt<std::string> OutputFilename("o",
                                            cl::desc("Override output filename for signed container"),
                                            cl::value_desc("filename"));
 
+static cl::opt<bool> Server(
+    "server",
+    cl::desc("Validate a stream of length-prefixed containers read from the "
+             "input file or pipe (standard input if none) until end of file, "
+             "writing one result per container to -o (standard output if "
+             "none)"));
+
+static cl::opt<unsigned> ServerThreads(
+    "server-threads",
+    cl::desc("Number of validation threads for -server (default: one per "
+             "hardware thread)"),
+    cl::init(0));
+
 class DxvContext {
 private:
   DxcDllSupport &m_dxcSupport;
@@ -125,6 +150,246 @@ void DxvContext::Validate() {
   }
 }
 
+// In server mode every request and response field is a little-endian uint32.
+// A request is the container size followed by the container bytes. A response
+// is the zero-based index of the request it answers, the validation HRESULT,
+// the size and bytes of the diagnostic text, and the size and bytes of the
+// signed container (empty when validation failed). Requests are validated
+// concurrently, so responses are written as they complete and may arrive out
+// of order.
+namespace {
+struct DxvServerRequest {
+  uint32_t Index = 0;
+  std::vector<char> Container;
+};
+
+class DxvServer {
+private:
+  DxcDllSupport &m_dxcSupport;
+  FILE *m_pIn;
+  FILE *m_pOut;
+  size_t m_maxQueued;
+
+  std::mutex m_queueLock;
+  std::condition_variable m_queueChanged;
+  std::deque<DxvServerRequest> m_queue;
+  bool m_endOfInput = false;
+
+  std::mutex m_outputLock;
+
+  bool ReadUInt32(uint32_t &value, bool &truncated);
+  bool ReadRequest(DxvServerRequest &request, bool &truncated);
+  bool Dequeue(DxvServerRequest &request);
+  HRESULT ValidateRequest(IDxcValidator *pValidator, DxvServerRequest &request,
+                          std::string &message, IDxcBlob **ppSigned);
+  void WriteUInt32(uint32_t value);
+  void WriteResponse(uint32_t index, HRESULT status, const std::string &message,
+                     IDxcBlob *pSigned);
+  void Worker();
+
+public:
+  DxvServer(DxcDllSupport &dxcSupport, FILE *pIn, FILE *pOut,
+            unsigned threadCount)
+      : m_dxcSupport(dxcSupport), m_pIn(pIn), m_pOut(pOut),
+        m_maxQueued(2 * threadCount) {}
+
+  void Run(unsigned threadCount);
+};
+} // namespace
+
+bool DxvServer::ReadUInt32(uint32_t &value, bool &truncated) {
+  uint8_t bytes[4];
+  size_t read = fread(bytes, 1, sizeof(bytes), m_pIn);
+  if (read != sizeof(bytes)) {
+    truncated = read != 0;
+    return false;
+  }
+  value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+          ((uint32_t)bytes[3] << 24);
+  return true;
+}
+
+bool DxvServer::ReadRequest(DxvServerRequest &request, bool &truncated) {
+  uint32_t size;
+  if (!ReadUInt32(size, truncated))
+    return false;
+  request.Container.resize(size);
+  if (size != 0 &&
+      fread(request.Container.data(), 1, size, m_pIn) != size) {
+    truncated = true;
+    return false;
+  }
+  return true;
+}
+
+bool DxvServer::Dequeue(DxvServerRequest &request) {
+  std::unique_lock<std::mutex> lock(m_queueLock);
+  m_queueChanged.wait(lock,
+                      [&]() { return !m_queue.empty() || m_endOfInput; });
+  if (m_queue.empty())
+    return false;
+  request = std::move(m_queue.front());
+  m_queue.pop_front();
+  lock.unlock();
+  m_queueChanged.notify_all();
+  return true;
+}
+
+HRESULT DxvServer::ValidateRequest(IDxcValidator *pValidator,
+                                   DxvServerRequest &request,
+                                   std::string &message,
+                                   IDxcBlob **ppSigned) {
+  // The heap copy is what the validator signs in place.
+  CComPtr<IDxcBlob> pContainer;
+  CComPtr<IDxcOperationResult> pResult;
+  IFT(hlsl::DxcCreateBlobOnHeapCopy(request.Container.data(),
+                                    (UINT32)request.Container.size(),
+                                    &pContainer));
+  IFT(pValidator->Validate(pContainer, DxcValidatorFlags_InPlaceEdit,
+                           &pResult));
+
+  HRESULT status;
+  CComPtr<IDxcBlobEncoding> pText;
+  IFT(pResult->GetStatus(&status));
+  IFT(pResult->GetErrorBuffer(&pText));
+  if (pText && pText->GetBufferSize() != 0) {
+    const char *pStart = (const char *)pText->GetBufferPointer();
+    message.assign(pStart, strnlen(pStart, pText->GetBufferSize()));
+  }
+  if (SUCCEEDED(status))
+    *ppSigned = pContainer.Detach();
+  return status;
+}
+
+void DxvServer::WriteUInt32(uint32_t value) {
+  uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8),
+                      (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+  fwrite(bytes, 1, sizeof(bytes), m_pOut);
+}
+
+void DxvServer::WriteResponse(uint32_t index, HRESULT status,
+                              const std::string &message, IDxcBlob *pSigned) {
+  std::lock_guard<std::mutex> lock(m_outputLock);
+  WriteUInt32(index);
+  WriteUInt32((uint32_t)status);
+  WriteUInt32((uint32_t)message.size());
+  fwrite(message.data(), 1, message.size(), m_pOut);
+  if (pSigned) {
+    WriteUInt32((uint32_t)pSigned->GetBufferSize());
+    fwrite(pSigned->GetBufferPointer(), 1, pSigned->GetBufferSize(), m_pOut);
+  } else {
+    WriteUInt32(0);
+  }
+  fflush(m_pOut);
+}
+
+void DxvServer::Worker() {
+  DxcThreadMalloc TM(nullptr);
+  // Each thread keeps its own validator for the life of the server.
+  CComPtr<IDxcValidator> pValidator;
+  HRESULT createStatus =
+      m_dxcSupport.CreateInstance(CLSID_DxcValidator, &pValidator);
+
+  DxvServerRequest request;
+  while (Dequeue(request)) {
+    HRESULT status = createStatus;
+    std::string message;
+    CComPtr<IDxcBlob> pSigned;
+    if (FAILED(status)) {
+      message = "Unable to create validator.";
+    } else {
+      try {
+        status = ValidateRequest(pValidator, request, message, &pSigned);
+      } catch (const ::hlsl::Exception &hlslException) {
+        status = hlslException.hr;
+        message = hlslException.msg;
+      } catch (std::bad_alloc &) {
+        status = E_OUTOFMEMORY;
+        message = "Validation failed - out of memory.";
+      }
+    }
+    WriteResponse(request.Index, status, message, pSigned);
+  }
+}
+
+void DxvServer::Run(unsigned threadCount) {
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < threadCount; ++i)
+    threads.emplace_back(&DxvServer::Worker, this);
+
+  // Reading stays on this thread; the bounded queue keeps it from reading
+  // far ahead of the validators.
+  bool truncated = false;
+  for (uint32_t index = 0;; ++index) {
+    DxvServerRequest request;
+    request.Index = index;
+    if (!ReadRequest(request, truncated))
+      break;
+    {
+      std::unique_lock<std::mutex> lock(m_queueLock);
+      m_queueChanged.wait(lock,
+                          [&]() { return m_queue.size() < m_maxQueued; });
+      m_queue.push_back(std::move(request));
+    }
+    m_queueChanged.notify_all();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueLock);
+    m_endOfInput = true;
+  }
+  m_queueChanged.notify_all();
+  for (std::thread &thread : threads)
+    thread.join();
+
+  if (truncated)
+    IFTMSG(E_FAIL, "Server input ended in the middle of a request.");
+}
+
+static void RunServer(DxcDllSupport &dxcSupport) {
+  FILE *pIn = stdin;
+  FILE *pOut = stdout;
+  if (!InputFilename.empty()) {
+    pIn = fopen(InputFilename.c_str(), "rb");
+    if (pIn == nullptr)
+      IFTMSG(E_FAIL, "Unable to open server input \"" + InputFilename + "\".");
+  }
+  if (!OutputFilename.empty()) {
+    pOut = fopen(OutputFilename.c_str(), "wb");
+    if (pOut == nullptr) {
+      if (pIn != stdin)
+        fclose(pIn);
+      IFTMSG(E_FAIL,
+             "Unable to open server output \"" + OutputFilename + "\".");
+    }
+  }
+#ifdef _WIN32
+  if (pIn == stdin)
+    _setmode(_fileno(stdin), _O_BINARY);
+  if (pOut == stdout)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  unsigned threadCount = ServerThreads;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  DxvServer server(dxcSupport, pIn, pOut, threadCount);
+  try {
+    server.Run(threadCount);
+  } catch (...) {
+    if (pIn != stdin)
+      fclose(pIn);
+    if (pOut != stdout)
+      fclose(pOut);
+    throw;
+  }
+  if (pIn != stdin)
+    fclose(pIn);
+  if (pOut != stdout)
+    fclose(pOut);
+}
+
 int __cdecl main(int argc,  _In_reads_z_(argc) const char **argv) {
   const char *pStage = "Operation";
   if (llvm::sys::fs::SetupPerThreadFileSystem())
@@ -145,7 +410,7 @@ int __cdecl main(int argc,  _In_reads_z_(argc) const char **argv) {
     // Parse command line options.
     cl::ParseCommandLineOptions(argc, argv, "dxil validator\n");
 
-    if (InputFilename == "" || Help) {
+    if ((InputFilename == "" && !Server) || Help) {
       cl::PrintHelpMessage();
       return 2;
     }
@@ -153,6 +418,12 @@ int __cdecl main(int argc,  _In_reads_z_(argc) const char **argv) {
     DxcDllSupport dxcSupport;
     dxc::EnsureEnabled(dxcSupport);
 
+    if (Server) {
+      pStage = "Validation server";
+      RunServer(dxcSupport);
+      return 0;
+    }
+
     DxvContext context(dxcSupport);
     pStage = "Validation";
     context.Validate();
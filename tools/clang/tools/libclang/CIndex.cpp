@@ -3056,6 +3056,8 @@ static void clang_parseTranslationUnit_Impl(void *UserData) {
   bool IncludeBriefCommentsInCodeCompletion
     = options & CXTranslationUnit_IncludeBriefCommentsInCodeCompletion;
   bool SkipFunctionBodies = options & CXTranslationUnit_SkipFunctionBodies;
+  bool SkipIncludedFunctionBodies =
+      options & CXTranslationUnit_SkipIncludedFunctionBodies; // HLSL Change
   bool ForSerialization = options & CXTranslationUnit_ForSerialization;
 
   // Configure the diagnostics.
@@ -3131,7 +3133,8 @@ static void clang_parseTranslationUnit_Impl(void *UserData) {
       CacheCodeCompletionResults, IncludeBriefCommentsInCodeCompletion,
       /*AllowPCHWithCompilerErrors=*/true, SkipFunctionBodies,
       /*UserFilesAreVolatile=*/true, ForSerialization, &ErrUnit,
-      CXXIdx->HlslLangExtensions)); // HLSL Change - add language extensions
+      CXXIdx->HlslLangExtensions, // HLSL Change - add language extensions
+      SkipIncludedFunctionBodies)); // HLSL Change
 
   // Early failures in LoadFromCommandLine may return with ErrUnit unset.
   if (!Unit && !ErrUnit) {
@@ -32,6 +32,18 @@
 #include "dxcisenseimpl.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MSFileSystem.h"
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -1076,6 +1088,254 @@ HRESULT DxcInclusion::GetStackItem(unsigned index, _Outptr_result_nullonfailure_
 
 ///////////////////////////////////////////////////////////////////////////////
 
+struct DxcParseJob {
+  UINT64 Cookie;
+  int Priority;
+  std::string FileName;
+  std::vector<std::string> Args;
+  std::vector<CComPtr<IDxcUnsavedFile>> UnsavedFiles;
+  DxcTranslationUnitFlags Options;
+  CComPtr<IDxcParseCallback> Callback;
+  bool Cancelled = false; // Set when cancelled while running.
+};
+
+struct DxcParseQueue {
+  CComPtr<IMalloc> Malloc;
+  std::mutex Mutex;
+  std::condition_variable Changed;
+  std::list<DxcParseJob> Queued;
+  std::list<DxcParseJob> Running;
+  std::vector<std::thread> Workers;
+  UINT64 NextCookie = 1;
+  unsigned Pending = 0; // Queued or running parses not reported yet.
+  bool Stopping = false;
+};
+
+static void AbortParseJobs(std::list<DxcParseJob> &jobs) {
+  for (DxcParseJob &job : jobs)
+    job.Callback->OnParsed(job.Cookie, E_ABORT, nullptr);
+}
+
+// Removes the queued jobs matching pred into removed, and marks the running
+// ones as cancelled. Returns true if any job matched.
+template <typename TPred>
+static bool CancelParseJobs(DxcParseQueue &queue, TPred pred,
+                            std::list<DxcParseJob> &removed) {
+  bool found = false;
+  for (auto it = queue.Queued.begin(); it != queue.Queued.end();) {
+    auto next = std::next(it);
+    if (pred(*it)) {
+      removed.splice(removed.end(), queue.Queued, it);
+      --queue.Pending;
+      found = true;
+    }
+    it = next;
+  }
+  for (DxcParseJob &job : queue.Running) {
+    if (!job.Cancelled && pred(job)) {
+      job.Cancelled = true;
+      found = true;
+    }
+  }
+  if (!removed.empty())
+    queue.Changed.notify_all();
+  return found;
+}
+
+// The worker holds a reference to the queue, not the index: a callback may
+// release the index, in which case this thread is detached and only returns.
+static void RunParseWorker(std::shared_ptr<DxcParseQueue> queue,
+                           DxcIndex *index) {
+  DxcThreadMalloc TM(queue->Malloc);
+  std::unique_lock<std::mutex> lock(queue->Mutex);
+  for (;;) {
+    queue->Changed.wait(
+        lock, [&] { return queue->Stopping || !queue->Queued.empty(); });
+    if (queue->Stopping)
+      return;
+
+    // Highest priority first, in queuing order among equals.
+    auto jobIt = queue->Queued.begin();
+    for (auto it = jobIt; it != queue->Queued.end(); ++it)
+      if (it->Priority > jobIt->Priority)
+        jobIt = it;
+    queue->Running.splice(queue->Running.end(), queue->Queued, jobIt);
+    DxcParseJob &job = *jobIt;
+    lock.unlock();
+
+    CComPtr<IDxcTranslationUnit> pTU;
+    HRESULT hr;
+    try {
+      std::vector<const char *> args;
+      for (const std::string &arg : job.Args)
+        args.emplace_back(arg.c_str());
+      std::vector<IDxcUnsavedFile *> unsaved;
+      for (const CComPtr<IDxcUnsavedFile> &file : job.UnsavedFiles)
+        unsaved.emplace_back(file.p);
+      hr = index->ParseTranslationUnit(
+          job.FileName.c_str(), args.data(), (int)args.size(), unsaved.data(),
+          (unsigned)unsaved.size(), job.Options, &pTU);
+    } catch (...) {
+      hr = E_FAIL;
+    }
+
+    lock.lock();
+    bool cancelled = job.Cancelled;
+    UINT64 cookie = job.Cookie;
+    CComPtr<IDxcParseCallback> pCallback = job.Callback;
+    queue->Running.erase(jobIt);
+    lock.unlock();
+
+    if (cancelled) {
+      pTU.Release();
+      hr = E_ABORT;
+    }
+    pCallback->OnParsed(cookie, hr, pTU);
+    pCallback.Release();
+    pTU.Release();
+
+    lock.lock();
+    --queue->Pending;
+    queue->Changed.notify_all();
+  }
+}
+
+struct DxcSymbolEntry {
+  std::string USR;
+  std::string Name;
+  std::string FileName;
+  unsigned Line;
+  unsigned Column;
+  DxcSymbolRole Role;
+};
+
+static bool operator<(const DxcSymbolEntry &a, const DxcSymbolEntry &b) {
+  return std::tie(a.FileName, a.Line, a.Column, a.Role, a.USR) <
+         std::tie(b.FileName, b.Line, b.Column, b.Role, b.USR);
+}
+
+struct DxcSymbolIndexData {
+  std::mutex Mutex;
+  std::string Path;
+  // Occurrences found parsing each main file, including those in headers.
+  std::map<std::string, std::vector<DxcSymbolEntry>> Files;
+  // Main files with occurrences of each USR.
+  std::unordered_map<std::string, std::set<std::string>> FilesByUSR;
+
+  void SetFile(const std::string &fileName,
+               std::vector<DxcSymbolEntry> &&entries) {
+    RemoveFile(fileName);
+    if (entries.empty())
+      return;
+    for (const DxcSymbolEntry &entry : entries)
+      FilesByUSR[entry.USR].insert(fileName);
+    Files[fileName] = std::move(entries);
+  }
+
+  bool RemoveFile(const std::string &fileName) {
+    auto it = Files.find(fileName);
+    if (it == Files.end())
+      return false;
+    for (const DxcSymbolEntry &entry : it->second) {
+      auto usrIt = FilesByUSR.find(entry.USR);
+      if (usrIt != FilesByUSR.end()) {
+        usrIt->second.erase(fileName);
+        if (usrIt->second.empty())
+          FilesByUSR.erase(usrIt);
+      }
+    }
+    Files.erase(it);
+    return true;
+  }
+};
+
+// The index file has a version line, then for each main file one line
+// naming it followed by one line per occurrence, with tab separated fields.
+static const char kSymbolIndexHeader[] = "dxc-symbol-index 1";
+
+static CXChildVisitResult LIBCLANG_CC SymbolIndexVisit(CXCursor cursor, CXCursor parent, CXClientData client_data)
+{
+  std::vector<DxcSymbolEntry> *entries = (std::vector<DxcSymbolEntry> *)client_data;
+  CXCursorKind kind = clang_getCursorKind(cursor);
+  CXCursor symbol;
+  DxcSymbolRole role;
+  if (clang_isDeclaration(kind))
+  {
+    symbol = cursor;
+    role = clang_isCursorDefinition(cursor) ? DxcSymbolRole_Definition
+                                            : DxcSymbolRole_Declaration;
+  }
+  else if (clang_isReference(kind) || kind == CXCursor_DeclRefExpr ||
+           kind == CXCursor_MemberRefExpr)
+  {
+    symbol = clang_getCursorReferenced(cursor);
+    role = DxcSymbolRole_Reference;
+    if (clang_Cursor_isNull(symbol))
+      return CXChildVisit_Recurse;
+  }
+  else
+  {
+    return CXChildVisit_Recurse;
+  }
+
+  CXFile file;
+  unsigned line, column;
+  clang_getSpellingLocation(clang_getCursorLocation(cursor), &file, &line, &column, nullptr);
+  if (file == nullptr)
+    return CXChildVisit_Recurse;
+
+  CXString usr = clang_getCursorUSR(symbol);
+  const char *usrText = clang_getCString(usr);
+  if (usrText != nullptr && *usrText != '\0')
+  {
+    CXString name = clang_getCursorSpelling(symbol);
+    CXString fileName = clang_getFileName(file);
+    entries->push_back(DxcSymbolEntry{ usrText, clang_getCString(name),
+                                       clang_getCString(fileName), line, column, role });
+    clang_disposeString(fileName);
+    clang_disposeString(name);
+  }
+  clang_disposeString(usr);
+  return CXChildVisit_Recurse;
+}
+
+// Copies the distinct entries into a single CoTaskMemAlloc allocation, the
+// strings following the occurrences.
+static HRESULT PackSymbolOccurrences(std::set<DxcSymbolEntry> &entries,
+                                     unsigned *pResultLength,
+                                     DxcSymbolOccurrence **pResult)
+{
+  if (entries.empty())
+    return S_OK;
+  size_t size = entries.size() * sizeof(DxcSymbolOccurrence);
+  for (const DxcSymbolEntry &entry : entries)
+    size += entry.USR.size() + entry.Name.size() + entry.FileName.size() + 3;
+
+  DxcSymbolOccurrence *occurrences = (DxcSymbolOccurrence *)CoTaskMemAlloc(size);
+  if (occurrences == nullptr) return E_OUTOFMEMORY;
+  char *text = (char *)(occurrences + entries.size());
+  auto copyText = [&](const std::string &value) {
+    char *start = text;
+    memcpy(text, value.c_str(), value.size() + 1);
+    text += value.size() + 1;
+    return start;
+  };
+  DxcSymbolOccurrence *occurrence = occurrences;
+  for (const DxcSymbolEntry &entry : entries)
+  {
+    occurrence->USR = copyText(entry.USR);
+    occurrence->Name = copyText(entry.Name);
+    occurrence->FileName = copyText(entry.FileName);
+    occurrence->Line = entry.Line;
+    occurrence->Column = entry.Column;
+    occurrence->Role = entry.Role;
+    ++occurrence;
+  }
+  *pResultLength = (unsigned)entries.size();
+  *pResult = occurrences;
+  return S_OK;
+}
+
 DxcIndex::DxcIndex(IMalloc *pMalloc)
     : m_dwRef(0), m_pMalloc(pMalloc)
     , m_index(0), m_options(DxcGlobalOpt_None)
@@ -1084,6 +1344,28 @@ DxcIndex::DxcIndex(IMalloc *pMalloc)
 
 DxcIndex::~DxcIndex()
 {
+    if (m_parseQueue)
+    {
+        std::list<DxcParseJob> removed;
+        std::vector<std::thread> workers;
+        {
+            std::lock_guard<std::mutex> lock(m_parseQueue->Mutex);
+            m_parseQueue->Stopping = true;
+            m_parseQueue->Pending -= m_parseQueue->Queued.size();
+            removed.splice(removed.end(), m_parseQueue->Queued);
+            workers.swap(m_parseQueue->Workers);
+            m_parseQueue->Changed.notify_all();
+        }
+        AbortParseJobs(removed);
+        // Running parses use m_index, so wait for them to complete.
+        for (std::thread &worker : workers)
+        {
+            if (worker.get_id() == std::this_thread::get_id())
+                worker.detach();
+            else
+                worker.join();
+        }
+    }
     if (m_index)
     {
         clang_disposeIndex(m_index);
@@ -1101,6 +1383,10 @@ HRESULT DxcIndex::Initialize(hlsl::DxcLangExtensionsHelper &langHelper) {
 
     hlsl::DxcLangExtensionsHelperApply* apply = &m_langHelper;
     clang_index_setLangHelper(m_index, apply);
+
+    m_parseQueue = std::make_shared<DxcParseQueue>();
+    m_parseQueue->Malloc = m_pMalloc;
+    m_symbols.reset(new DxcSymbolIndexData());
   }
   CATCH_CPP_RETURN_HRESULT();
   return S_OK;
@@ -1189,6 +1475,280 @@ HRESULT DxcIndex::ParseTranslationUnit(
   CATCH_CPP_RETURN_HRESULT();
 }
 
+_Use_decl_annotations_
+HRESULT DxcIndex::ParseTranslationUnitAsync(
+  const char *source_filename,
+  const char * const *command_line_args,
+  int num_command_line_args,
+  IDxcUnsavedFile** unsaved_files,
+  unsigned num_unsaved_files,
+  DxcTranslationUnitFlags options,
+  int priority,
+  IDxcParseCallback* pCallback,
+  UINT64* pCookie)
+{
+  if (pCookie != nullptr) *pCookie = 0;
+  if (source_filename == nullptr || pCallback == nullptr) return E_INVALIDARG;
+  if (num_command_line_args < 0 ||
+      (num_command_line_args > 0 && command_line_args == nullptr) ||
+      (num_unsaved_files > 0 && unsaved_files == nullptr))
+    return E_INVALIDARG;
+  if (m_index == 0) return E_FAIL;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  std::list<DxcParseJob> superseded;
+  try
+  {
+    // Copy everything the parse needs, as it runs after this call returns.
+    std::list<DxcParseJob> jobs(1);
+    DxcParseJob &job = jobs.front();
+    job.Priority = priority;
+    job.FileName = source_filename;
+    job.Args.assign(command_line_args, command_line_args + num_command_line_args);
+    for (unsigned i = 0; i < num_unsaved_files; ++i)
+    {
+      if (unsaved_files[i] == nullptr) return E_INVALIDARG;
+      job.UnsavedFiles.emplace_back(unsaved_files[i]);
+    }
+    job.Options = options;
+    job.Callback = pCallback;
+
+    DxcParseQueue &queue = *m_parseQueue;
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    CancelParseJobs(queue, [&](const DxcParseJob &other) {
+      return other.FileName == job.FileName;
+    }, superseded);
+    job.Cookie = queue.NextCookie++;
+    if (pCookie != nullptr) *pCookie = job.Cookie;
+    queue.Queued.splice(queue.Queued.end(), jobs);
+    ++queue.Pending;
+
+    // Start workers as parses queue up.
+    unsigned maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+    if (queue.Workers.size() < std::min(maxWorkers, queue.Pending))
+      queue.Workers.emplace_back(RunParseWorker, m_parseQueue, this);
+    queue.Changed.notify_all();
+  }
+  catch (...)
+  {
+    AbortParseJobs(superseded);
+    return E_OUTOFMEMORY;
+  }
+  AbortParseJobs(superseded);
+  return S_OK;
+}
+
+HRESULT DxcIndex::CancelParse(UINT64 cookie)
+{
+  if (!m_parseQueue) return S_FALSE;
+  std::list<DxcParseJob> removed;
+  bool found;
+  {
+    std::lock_guard<std::mutex> lock(m_parseQueue->Mutex);
+    found = CancelParseJobs(*m_parseQueue, [&](const DxcParseJob &job) {
+      return job.Cookie == cookie;
+    }, removed);
+  }
+  AbortParseJobs(removed);
+  return found ? S_OK : S_FALSE;
+}
+
+HRESULT DxcIndex::SetParsePriority(UINT64 cookie, int priority)
+{
+  if (!m_parseQueue) return S_FALSE;
+  std::lock_guard<std::mutex> lock(m_parseQueue->Mutex);
+  for (DxcParseJob &job : m_parseQueue->Queued)
+  {
+    if (job.Cookie == cookie)
+    {
+      job.Priority = priority;
+      return S_OK;
+    }
+  }
+  return S_FALSE;
+}
+
+HRESULT DxcIndex::WaitForParses()
+{
+  if (!m_parseQueue) return S_OK;
+  std::unique_lock<std::mutex> lock(m_parseQueue->Mutex);
+  m_parseQueue->Changed.wait(lock, [&] { return m_parseQueue->Pending == 0; });
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::Open(LPCSTR path)
+{
+  if (path == nullptr) return E_POINTER;
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    std::lock_guard<std::mutex> lock(m_symbols->Mutex);
+    m_symbols->Path = path;
+    m_symbols->Files.clear();
+    m_symbols->FilesByUSR.clear();
+    std::ifstream stream(path);
+    if (!stream) return S_FALSE;
+
+    std::string line;
+    if (!std::getline(stream, line) || line != kSymbolIndexHeader)
+      return E_INVALIDARG;
+    std::string fileName;
+    std::vector<DxcSymbolEntry> entries;
+    while (std::getline(stream, line))
+    {
+      if (line.compare(0, 2, "F\t") == 0)
+      {
+        m_symbols->SetFile(fileName, std::move(entries));
+        entries.clear();
+        fileName = line.substr(2);
+        continue;
+      }
+      // The file name is last, so it may contain tabs.
+      llvm::SmallVector<llvm::StringRef, 6> fields;
+      llvm::StringRef(line).split(fields, "\t", 5);
+      DxcSymbolEntry entry;
+      unsigned role;
+      if (fields.size() != 6 || fields[0].getAsInteger(10, role) ||
+          fields[1].getAsInteger(10, entry.Line) ||
+          fields[2].getAsInteger(10, entry.Column) || fileName.empty())
+        return E_INVALIDARG;
+      entry.Role = (DxcSymbolRole)role;
+      entry.USR = fields[3];
+      entry.Name = fields[4];
+      entry.FileName = fields[5];
+      entries.push_back(std::move(entry));
+    }
+    m_symbols->SetFile(fileName, std::move(entries));
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+HRESULT DxcIndex::Save()
+{
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    std::lock_guard<std::mutex> lock(m_symbols->Mutex);
+    if (m_symbols->Path.empty()) return E_FAIL;
+    std::ofstream stream(m_symbols->Path, std::ios::trunc);
+    stream << kSymbolIndexHeader << '\n';
+    for (const auto &file : m_symbols->Files)
+    {
+      stream << "F\t" << file.first << '\n';
+      for (const DxcSymbolEntry &entry : file.second)
+        stream << (unsigned)entry.Role << '\t' << entry.Line << '\t'
+               << entry.Column << '\t' << entry.USR << '\t' << entry.Name
+               << '\t' << entry.FileName << '\n';
+    }
+    stream.flush();
+    if (!stream) return E_FAIL;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::UpdateFile(IDxcTranslationUnit* pTranslationUnit)
+{
+  if (pTranslationUnit == nullptr) return E_POINTER;
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    CXTranslationUnit tu = reinterpret_cast<DxcTranslationUnit*>(pTranslationUnit)->GetTU();
+    std::vector<DxcSymbolEntry> entries;
+    clang_visitChildren(clang_getTranslationUnitCursor(tu), SymbolIndexVisit, &entries);
+    CXString fileName = clang_getTranslationUnitSpelling(tu);
+    std::string mainFile = clang_getCString(fileName);
+    clang_disposeString(fileName);
+
+    std::lock_guard<std::mutex> lock(m_symbols->Mutex);
+    m_symbols->SetFile(mainFile, std::move(entries));
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::RemoveFile(LPCSTR fileName)
+{
+  if (fileName == nullptr) return E_POINTER;
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    std::lock_guard<std::mutex> lock(m_symbols->Mutex);
+    return m_symbols->RemoveFile(fileName) ? S_OK : S_FALSE;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::GetCursorUSR(IDxcCursor* cursor, LPSTR* pResult)
+{
+  if (cursor == nullptr) return E_POINTER;
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = nullptr;
+  CXCursor symbol = reinterpret_cast<DxcCursor*>(cursor)->GetCursor();
+  if (!clang_isDeclaration(clang_getCursorKind(symbol)))
+    symbol = clang_getCursorReferenced(symbol);
+  if (clang_Cursor_isNull(symbol)) return S_OK;
+  return CXStringToAnsiAndDispose(clang_getCursorUSR(symbol), pResult);
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::FindOccurrences(
+  LPCSTR usr, DxcSymbolRole roles,
+  unsigned* pResultLength, DxcSymbolOccurrence** pResult)
+{
+  if (usr == nullptr) return E_POINTER;
+  if (pResultLength == nullptr) return E_POINTER;
+  if (pResult == nullptr) return E_POINTER;
+  *pResultLength = 0;
+  *pResult = nullptr;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    // Headers included by several main files are recorded once for each.
+    std::set<DxcSymbolEntry> found;
+    std::lock_guard<std::mutex> lock(m_symbols->Mutex);
+    auto it = m_symbols->FilesByUSR.find(usr);
+    if (it == m_symbols->FilesByUSR.end()) return S_OK;
+    for (const std::string &fileName : it->second)
+      for (const DxcSymbolEntry &entry : m_symbols->Files[fileName])
+        if ((entry.Role & roles) && entry.USR == usr)
+          found.insert(entry);
+    return PackSymbolOccurrences(found, pResultLength, pResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::FindOccurrencesByName(
+  LPCSTR name, DxcSymbolRole roles,
+  unsigned* pResultLength, DxcSymbolOccurrence** pResult)
+{
+  if (name == nullptr) return E_POINTER;
+  if (pResultLength == nullptr) return E_POINTER;
+  if (pResult == nullptr) return E_POINTER;
+  *pResultLength = 0;
+  *pResult = nullptr;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    std::set<DxcSymbolEntry> found;
+    std::lock_guard<std::mutex> lock(m_symbols->Mutex);
+    for (const auto &file : m_symbols->Files)
+      for (const DxcSymbolEntry &entry : file.second)
+        if ((entry.Role & roles) && entry.Name == name)
+          found.insert(entry);
+    return PackSymbolOccurrences(found, pResultLength, pResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 _Use_decl_annotations_
@@ -2164,6 +2724,7 @@ C_ASSERT((int)DxcCursor_FirstExtraDecl == (int)CXCursor_FirstExtraDecl);
 C_ASSERT((int)DxcCursor_LastExtraDecl == (int)CXCursor_LastExtraDecl);
 
 C_ASSERT((int)DxcTranslationUnitFlags_UseCallerThread == (int)CXTranslationUnit_UseCallerThread);
+C_ASSERT((int)DxcTranslationUnitFlags_SkipIncludedFunctionBodies == (int)CXTranslationUnit_SkipIncludedFunctionBodies);
 
 C_ASSERT((int)DxcCodeCompleteFlags_IncludeMacros == (int)CXCodeComplete_IncludeMacros);
 C_ASSERT((int)DxcCodeCompleteFlags_IncludeCodePatterns == (int)CXCodeComplete_IncludeCodePatterns);
@@ -17,6 +17,7 @@
 #include "dxc/dxcapi.internal.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
+#include <memory>
 
 // Forward declarations.
 class DxcCursor;
@@ -45,6 +46,7 @@ public:
 
   void Initialize(const CXCursor& cursor);
   static HRESULT Create(const CXCursor& cursor, _Outptr_result_nullonfailure_ IDxcCursor** pObject);
+  const CXCursor& GetCursor() const { return m_cursor; }
 
   HRESULT STDMETHODCALLTYPE GetExtent(_Outptr_result_nullonfailure_ IDxcSourceRange** pRange) override;
   HRESULT STDMETHODCALLTYPE GetLocation(_Outptr_result_nullonfailure_ IDxcSourceLocation** pResult) override;
@@ -157,19 +159,25 @@ public:
   HRESULT STDMETHODCALLTYPE GetStackItem(unsigned index, _Outptr_result_nullonfailure_ IDxcSourceLocation **pResult) override;
 };
 
-class DxcIndex : public IDxcIndex
+struct DxcParseQueue;
+struct DxcSymbolIndexData;
+
+class DxcIndex : public IDxcIndex, public IDxcIndexAsync, public IDxcSymbolIndex
 {
 private:
     DXC_MICROCOM_TM_REF_FIELDS()
     CXIndex m_index;
     DxcGlobalOptions m_options;
     hlsl::DxcLangExtensionsHelper m_langHelper;
+    // Shared with the worker threads, which may outlive the index.
+    std::shared_ptr<DxcParseQueue> m_parseQueue;
+    std::unique_ptr<DxcSymbolIndexData> m_symbols;
 public:
     DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     DXC_MICROCOM_TM_ALLOC(DxcIndex)
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override
     {
-      return DoBasicQueryInterface<IDxcIndex>(this, iid, ppvObject);
+      return DoBasicQueryInterface<IDxcIndex, IDxcIndexAsync, IDxcSymbolIndex>(this, iid, ppvObject);
     }
 
     DxcIndex(IMalloc *pMalloc);
@@ -187,6 +195,32 @@ public:
       unsigned num_unsaved_files,
       DxcTranslationUnitFlags options,
       _Outptr_result_nullonfailure_ IDxcTranslationUnit** pTranslationUnit) override;
+
+    HRESULT STDMETHODCALLTYPE ParseTranslationUnitAsync(
+      _In_z_ const char *source_filename,
+      _In_count_(num_command_line_args) const char * const *command_line_args,
+      int num_command_line_args,
+      _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+      unsigned num_unsaved_files,
+      DxcTranslationUnitFlags options,
+      int priority,
+      _In_ IDxcParseCallback* pCallback,
+      _Out_opt_ UINT64* pCookie) override;
+    HRESULT STDMETHODCALLTYPE CancelParse(UINT64 cookie) override;
+    HRESULT STDMETHODCALLTYPE SetParsePriority(UINT64 cookie, int priority) override;
+    HRESULT STDMETHODCALLTYPE WaitForParses() override;
+
+    HRESULT STDMETHODCALLTYPE Open(_In_z_ LPCSTR path) override;
+    HRESULT STDMETHODCALLTYPE Save() override;
+    HRESULT STDMETHODCALLTYPE UpdateFile(_In_ IDxcTranslationUnit* pTranslationUnit) override;
+    HRESULT STDMETHODCALLTYPE RemoveFile(_In_z_ LPCSTR fileName) override;
+    HRESULT STDMETHODCALLTYPE GetCursorUSR(_In_ IDxcCursor* cursor, _Outptr_result_maybenull_ LPSTR* pResult) override;
+    HRESULT STDMETHODCALLTYPE FindOccurrences(
+      _In_z_ LPCSTR usr, DxcSymbolRole roles,
+      _Out_ unsigned* pResultLength, _Outptr_result_buffer_maybenull_(*pResultLength) DxcSymbolOccurrence** pResult) override;
+    HRESULT STDMETHODCALLTYPE FindOccurrencesByName(
+      _In_z_ LPCSTR name, DxcSymbolRole roles,
+      _Out_ unsigned* pResultLength, _Outptr_result_buffer_maybenull_(*pResultLength) DxcSymbolOccurrence** pResult) override;
 };
 
 class DxcIntelliSense : public IDxcIntelliSense, public IDxcLangExtensions3 {
@@ -312,6 +346,7 @@ public:
     DxcTranslationUnit(IMalloc *pMalloc);
     ~DxcTranslationUnit();
     void Initialize(CXTranslationUnit tu);
+    CXTranslationUnit GetTU() const { return m_tu; }
 
     HRESULT STDMETHODCALLTYPE GetCursor(_Outptr_ IDxcCursor** pCursor) override;
     HRESULT STDMETHODCALLTYPE Tokenize(
@@ -127,7 +127,7 @@ static void SaveTypeDecl(TagDecl *tagDecl,
 
 class VarReferenceVisitor : public RecursiveASTVisitor<VarReferenceVisitor> {
 private:
-  SmallPtrSetImpl<VarDecl*>& m_unusedGlobals;
+  SmallPtrSetImpl<VarDecl*>& m_usedGlobals;
   SmallPtrSetImpl<FunctionDecl*>& m_visitedFunctions;
   SmallVectorImpl<FunctionDecl*>& m_pendingFunctions;
   SmallPtrSetImpl<TypeDecl *> &m_visitedTypes;
@@ -138,11 +138,11 @@ private:
 
 public:
   VarReferenceVisitor(
-    SmallPtrSetImpl<VarDecl*>& unusedGlobals,
+    SmallPtrSetImpl<VarDecl*>& usedGlobals,
     SmallPtrSetImpl<FunctionDecl*>& visitedFunctions,
     SmallVectorImpl<FunctionDecl*>& pendingFunctions,
     SmallPtrSetImpl<TypeDecl *> &types)  :
-    m_unusedGlobals(unusedGlobals),
+    m_usedGlobals(usedGlobals),
     m_visitedFunctions(visitedFunctions),
     m_pendingFunctions(pendingFunctions),
     m_visitedTypes(types) {
@@ -165,7 +165,7 @@ public:
       }
     }
     else if (VarDecl* varDecl = dyn_cast_or_null<VarDecl>(valueDecl)) {
-      m_unusedGlobals.erase(varDecl);
+      m_usedGlobals.insert(varDecl);
       if (TagDecl *tagDecl = varDecl->getType()->getAsTagDecl()) {
         AddRecordType(tagDecl);
       }
@@ -226,6 +226,33 @@ public:
   }
 };
 
+// Declarations referenced by each function, found once and shared by the
+// reachability walks from every entry point.
+class ReferenceGraph {
+public:
+  struct References {
+    SmallPtrSet<VarDecl *, 8> globals;
+    SmallVector<FunctionDecl *, 8> callees;
+    // Declarations without a body of functions called through them.
+    SmallPtrSet<FunctionDecl *, 4> predecls;
+    SmallPtrSet<TypeDecl *, 8> types;
+  };
+
+  const References &get(FunctionDecl *FD) {
+    std::unique_ptr<References> &refs = m_references[FD];
+    if (!refs) {
+      refs.reset(new References());
+      VarReferenceVisitor visitor(refs->globals, refs->predecls, refs->callees,
+                                  refs->types);
+      visitor.TraverseDecl(FD);
+    }
+    return *refs;
+  }
+
+private:
+  DenseMap<FunctionDecl *, std::unique_ptr<References>> m_references;
+};
+
 // Macro related.
 namespace {
 
@@ -337,21 +364,24 @@ ParsedSemanticDefineList hlsl::CollectSemanticDefinesParsedByCompiler(
     return parsedDefines;
   }
 
-  const llvm::SmallVector<std::string, 2> &defineExclusions =
-      helper->GetSemanticDefineExclusions();
-
   const llvm::SetVector<std::string> &nonOptDefines =
     helper->GetNonOptSemanticDefines();
 
   std::set<std::string> overridenMacroSemDef;
 
-  // This is very inefficient in general, but in practice we either have
-  // no semantic defines, or we have a star define for a some reserved prefix.
-  // These will be sorted so rewrites are stable.
+  // Each macro name is looked up once in the pattern tries the helper builds
+  // as semantic defines and exclusions are registered, so the cost of the
+  // scan does not grow with the number of patterns. Exclusions take
+  // precedence over inclusions. These will be sorted so rewrites are stable.
   std::vector<std::pair<const IdentifierInfo *, MacroInfo *>> macros;
   Preprocessor &pp = compiler.getPreprocessor();
   Preprocessor::macro_iterator end = pp.macro_end();
   for (Preprocessor::macro_iterator i = pp.macro_begin(); i != end; ++i) {
+    const IdentifierInfo *ii = i->first;
+    unsigned matchCount = helper->MatchSemanticDefine(ii->getName()).Count;
+    if (matchCount == 0) {
+      continue;
+    }
     if (!i->second.getLatest()->isDefined()) {
       continue;
     }
@@ -360,25 +390,9 @@ ParsedSemanticDefineList hlsl::CollectSemanticDefinesParsedByCompiler(
       continue;
     }
 
-    const IdentifierInfo *ii = i->first;
-
-    // Exclusions take precedence over inclusions.
-    bool excluded = false;
-    for (const auto &exclusion : defineExclusions) {
-      if (IsMacroMatch(ii->getName(), exclusion)) {
-        excluded = true;
-        break;
-      }
-    }
-    if (excluded) {
-      continue;
-    }
-
-    for (const auto &define : defines) {
-      if (!IsMacroMatch(ii->getName(), define)) {
-        continue;
-      }
-
+    // Each matching pattern contributes the define, as when the patterns
+    // were matched one by one.
+    for (unsigned match = 0; match < matchCount; ++match) {
       // overriding a semantic define takes the first precedence
       if (compiler.getCodeGenOpts().HLSLOverrideSemDefs.size() > 0 &&
         compiler.getCodeGenOpts().HLSLOverrideSemDefs.find(ii->getName().str()) !=
@@ -616,7 +630,8 @@ HRESULT GenerateAST(DxcLangExtensionsHelper *pExtHelper, LPCSTR pFileName,
 
 HRESULT CollectRewriteHelper(TranslationUnitDecl *tu, LPCSTR pEntryPoint,
                              RewriteHelper &helper, bool bRemoveGlobals,
-                             bool bRemoveFunctions, raw_ostream &w) {
+                             bool bRemoveFunctions, ReferenceGraph &graph,
+                             raw_ostream &w) {
   ASTContext &C = tu->getASTContext();
 
   // Gather all global variables that are not in cbuffers and all functions.
@@ -704,18 +719,31 @@ HRESULT CollectRewriteHelper(TranslationUnitDecl *tu, LPCSTR pEntryPoint,
   SmallPtrSet<FunctionDecl *, 128> visitedFunctions;
   SmallVector<FunctionDecl *, 32> pendingFunctions;
   SmallPtrSet<TypeDecl *, 32> visitedTypes;
-  VarReferenceVisitor visitor(unusedGlobals, visitedFunctions, pendingFunctions,
-                              visitedTypes);
   pendingFunctions.push_back(entryFnDecl);
   while (!pendingFunctions.empty()) {
     FunctionDecl *pendingDecl = pendingFunctions.pop_back_val();
-    visitedFunctions.insert(pendingDecl);
-    visitor.TraverseDecl(pendingDecl);
+    if (!visitedFunctions.insert(pendingDecl).second)
+      continue;
+    const ReferenceGraph::References &refs = graph.get(pendingDecl);
+    for (VarDecl *varDecl : refs.globals)
+      unusedGlobals.erase(varDecl);
+    for (FunctionDecl *fnDecl : refs.predecls)
+      visitedFunctions.insert(fnDecl);
+    for (TypeDecl *typeDecl : refs.types)
+      visitedTypes.insert(typeDecl);
+    for (FunctionDecl *fnDecl : refs.callees)
+      if (!visitedFunctions.count(fnDecl))
+        pendingFunctions.push_back(fnDecl);
   }
   // Traverse cbuffers to save types for cbuffer constant.
+  SmallPtrSet<VarDecl *, 8> cbufferGlobals;
+  VarReferenceVisitor visitor(cbufferGlobals, visitedFunctions,
+                              pendingFunctions, visitedTypes);
   for (auto *CBDecl : cbufferDecls) {
     visitor.TraverseDecl(CBDecl);
   }
+  for (VarDecl *varDecl : cbufferGlobals)
+    unusedGlobals.erase(varDecl);
 
   // Don't bother doing work if there are no globals to remove.
   if (unusedGlobals.empty() && unusedFunctions.empty() && unusedTypes.empty()) {
@@ -832,8 +860,9 @@ static HRESULT DoRewriteUnused( TranslationUnitDecl *tu,
                                 bool bRemoveFunctions,
                                 raw_ostream &w) {
   RewriteHelper helper;
+  ReferenceGraph graph;
   HRESULT hr = CollectRewriteHelper(tu, pEntryPoint, helper, bRemoveGlobals,
-                                    bRemoveFunctions, w);
+                                    bRemoveFunctions, graph, w);
   if (hr != S_OK)
     return hr;
 
@@ -883,6 +912,104 @@ static HRESULT DoRewriteUnused( TranslationUnitDecl *tu,
   return S_OK;
 }
 
+// Prints tu as DoRewriteUnused leaves it, but hides the unused declarations
+// while printing instead of removing them, so that tu can be printed again
+// for another entry point.
+static void PrintWithoutUnused(TranslationUnitDecl *tu, RewriteHelper &helper,
+                               raw_ostream &o, PrintingPolicy &p) {
+  SmallVector<Decl *, 64> hiddenDecls;
+  auto hide = [&](Decl *D) {
+    if (!D->isImplicit()) {
+      D->setImplicit(true);
+      hiddenDecls.push_back(D);
+    }
+  };
+
+  for (VarDecl *unusedGlobal : helper.unusedGlobals) {
+    if (const RecordType *recordTy = unusedGlobal->getType()->getAs<RecordType>()) {
+      RecordDecl *recordDecl = recordTy->getDecl();
+      // Hide anonymous structs along with the last variable they declare.
+      if (recordDecl && recordDecl->getName().empty() &&
+          --helper.anonymousRecordRefCounts[recordDecl] == 0)
+        hide(recordDecl);
+    }
+    hide(unusedGlobal);
+  }
+  for (FunctionDecl *unusedFn : helper.unusedFunctions)
+    hide(unusedFn);
+  for (TypeDecl *unusedTy : helper.unusedTypes)
+    hide(unusedTy);
+
+  tu->print(o, p);
+
+  for (Decl *D : hiddenDecls)
+    D->setImplicit(false);
+}
+
+struct EntryPointRewrite {
+  std::string entryPoint;
+  HRESULT status;
+  std::string warnings;
+  std::string result;
+};
+
+// Parses the source once, then removes the globals unused by each entry point
+// as DoRewriteUnused does, sharing the references found in each function.
+static void
+DoRewriteUnusedForEntryPoints(_In_ DxcLangExtensionsHelper *pHelper,
+                              _In_ LPCSTR pFileName,
+                              _In_ ASTUnit::RemappedFile *pRemap,
+                              _In_ DxcDefine *pDefines, _In_ UINT32 defineCount,
+                              std::vector<EntryPointRewrite> &rewrites,
+                              _In_opt_ dxcutil::DxcArgsFileSystem *msfPtr) {
+  std::string parseWarnings;
+  raw_string_ostream pw(parseWarnings);
+
+  ASTHelper astHelper;
+  hlsl::options::DxcOpts opts;
+  opts.HLSLVersion = 2015;
+
+  GenerateAST(pHelper, pFileName, pRemap, pDefines, defineCount, astHelper,
+              opts, msfPtr, pw);
+  pw.flush();
+
+  for (EntryPointRewrite &rewrite : rewrites) {
+    rewrite.warnings = parseWarnings;
+    rewrite.status = E_FAIL;
+  }
+  if (astHelper.bHasErrors)
+    return;
+
+  TranslationUnitDecl *tu = astHelper.tu;
+  ASTContext &C = tu->getASTContext();
+  StringRef contents = C.getSourceManager().getBufferData(
+      C.getSourceManager().getMainFileID());
+  PrintingPolicy p = PrintingPolicy(C.getPrintingPolicy());
+  p.Indentation = 1;
+
+  ReferenceGraph graph;
+  for (EntryPointRewrite &rewrite : rewrites) {
+    raw_string_ostream o(rewrite.result);
+    raw_string_ostream w(rewrite.warnings);
+
+    RewriteHelper helper;
+    HRESULT hr = CollectRewriteHelper(tu, rewrite.entryPoint.c_str(), helper,
+                                      true /*removeGlobals*/,
+                                      false /*removeFunctions*/, graph, w);
+    if (FAILED(hr))
+      continue;
+
+    if (hr == S_FALSE) {
+      w << "//no unused globals found - no work to be done\n";
+      o << contents;
+    } else {
+      PrintWithoutUnused(tu, helper, o, p);
+    }
+    WriteMacroDefines(astHelper.semanticMacros, o);
+    rewrite.status = S_OK;
+  }
+}
+
 static HRESULT
 DoRewriteUnused(_In_ DxcLangExtensionsHelper *pHelper, _In_ LPCSTR pFileName,
                 _In_ ASTUnit::RemappedFile *pRemap, _In_ LPCSTR pEntryPoint,
@@ -1170,9 +1297,10 @@ HRESULT DoReWriteWithLineDirective(
     ASTContext &C = tu->getASTContext();
     rewriter.setSourceMgr(C.getSourceManager(), C.getLangOpts());
     if (opts.RWOpt.RemoveUnusedGlobals || opts.RWOpt.RemoveUnusedFunctions) {
+      ReferenceGraph graph;
       HRESULT hr = CollectRewriteHelper(tu, opts.EntryPoint.data(), rwHelper,
                            opts.RWOpt.RemoveUnusedGlobals,
-                           opts.RWOpt.RemoveUnusedFunctions, w);
+                           opts.RWOpt.RemoveUnusedFunctions, graph, w);
       if (hr == E_FAIL)
         return hr;
       RewriteVisitor visitor(rewriter, tu, rwHelper);
@@ -1266,7 +1394,7 @@ HRESULT DoReWriteWithLineDirective(
 }
 } // namespace
 
-class DxcRewriter : public IDxcRewriter2, public IDxcLangExtensions3 {
+class DxcRewriter : public IDxcRewriter3, public IDxcLangExtensions3 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   DxcLangExtensionsHelper m_langExtensionsHelper;
@@ -1277,7 +1405,7 @@ public:
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
                                            void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcRewriter2, IDxcRewriter,
+    return DoBasicQueryInterface<IDxcRewriter3, IDxcRewriter2, IDxcRewriter,
                                  IDxcLangExtensions, IDxcLangExtensions2, IDxcLangExtensions3>(
         this, iid, ppvObject);
   }
@@ -1506,6 +1634,77 @@ public:
     CATCH_CPP_RETURN_HRESULT();
   }
 
+  HRESULT STDMETHODCALLTYPE RemoveUnusedGlobalsForEntryPoints(
+      _In_ IDxcBlobEncoding *pSource,
+      // Optional file name for pSource. Used in errors and include handlers.
+      _In_opt_ LPCWSTR pSourceName,
+      _In_count_(entryPointCount) LPCWSTR *pEntryPoints,
+      _In_ UINT32 entryPointCount,
+      _In_count_(defineCount) DxcDefine *pDefines, _In_ UINT32 defineCount,
+      // user-provided interface to handle #include directives (optional)
+      _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+      _Out_writes_(entryPointCount) IDxcOperationResult **ppResults) override {
+    if (pSource == nullptr || ppResults == nullptr ||
+        (entryPointCount > 0 && pEntryPoints == nullptr) ||
+        (defineCount > 0 && pDefines == nullptr))
+      return E_INVALIDARG;
+
+    for (UINT32 i = 0; i < entryPointCount; ++i)
+      ppResults[i] = nullptr;
+
+    DxcThreadMalloc TM(m_pMalloc);
+
+    CComPtr<IDxcBlobUtf8> utf8Source;
+    IFR(hlsl::DxcGetBlobAsUtf8(pSource, m_pMalloc, &utf8Source));
+
+    if (pSourceName == nullptr)
+      pSourceName = L"input.hlsl";
+    CW2A utf8SourceName(pSourceName, CP_UTF8);
+    LPCSTR fName = utf8SourceName.m_psz;
+
+    try {
+      dxcutil::DxcArgsFileSystem *msfPtr = dxcutil::CreateDxcArgsFileSystem(
+          utf8Source, pSourceName, pIncludeHandler);
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      StringRef Data(utf8Source->GetStringPointer(),
+                     utf8Source->GetStringLength());
+      std::unique_ptr<llvm::MemoryBuffer> pBuffer(
+          llvm::MemoryBuffer::getMemBufferCopy(Data, fName));
+      std::unique_ptr<ASTUnit::RemappedFile> pRemap(
+          new ASTUnit::RemappedFile(fName, pBuffer.release()));
+
+      std::vector<EntryPointRewrite> rewrites(entryPointCount);
+      for (UINT32 i = 0; i < entryPointCount; ++i) {
+        if (pEntryPoints[i] == nullptr)
+          return E_INVALIDARG;
+        rewrites[i].entryPoint = CW2A(pEntryPoints[i], CP_UTF8);
+      }
+
+      DoRewriteUnusedForEntryPoints(&m_langExtensionsHelper, fName,
+                                    pRemap.get(), pDefines, defineCount,
+                                    rewrites, msfPtr);
+
+      for (UINT32 i = 0; i < entryPointCount; ++i) {
+        HRESULT hr = DxcResult::Create(rewrites[i].status, DXC_OUT_HLSL, {
+            DxcOutputObject::StringOutput(DXC_OUT_HLSL, CP_UTF8,
+              rewrites[i].result.c_str(), DxcOutNoName),
+            DxcOutputObject::ErrorOutput(CP_UTF8, rewrites[i].warnings.c_str())
+          }, &ppResults[i]);
+        if (FAILED(hr)) {
+          for (UINT32 j = 0; j < i; ++j) {
+            ppResults[j]->Release();
+            ppResults[j] = nullptr;
+          }
+          return hr;
+        }
+      }
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
 };
 
 HRESULT CreateDxcRewriter(_In_ REFIID riid, _Out_ LPVOID* ppv) {
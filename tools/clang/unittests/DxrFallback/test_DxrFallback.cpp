@@ -29,6 +29,7 @@ using namespace llvm;
 using namespace hlsl;
 
 const int DEBUG_OUTPUT_LEVEL = 1;
+bool g_binnedDispatch = false;
 
 std::string ws2s(const std::wstring& wide)
 {
@@ -117,6 +118,12 @@ bool DxrCompile(
 
   IFT(pCompiler->SetFindCalledShaders(findCalledShaders));
   IFT(pCompiler->SetDebugOutput(DEBUG_OUTPUT_LEVEL));
+  if (g_binnedDispatch)
+  {
+    CComPtr<IDxcDxrFallbackCompiler2> pCompiler2;
+    IFT(pCompiler.QueryInterface(&pCompiler2));
+    IFT(pCompiler2->SetBinnedDispatch(true));
+  }
   IFT(pCompiler->Compile(
     bytecode.data(), libs.size(),
     shaderNamePtrs.data(), shaderIds.data(), shaderNamePtrs.size(), maxAttributeSize,
@@ -808,6 +815,7 @@ void printUsageAndExit()
     << "  -h | --help                     Print this message\n"
     << "  -d | --device <name>            Name of device to use. Can be a prefix, e.g. WARP, AMD, etc.\n"
     << "  -p | --path <directory>         Base path for test input files.\n"
+    << "  -b | --binned-dispatch          Compile with binned state dispatch.\n"
     << std::endl;
 
   exit(1);
@@ -837,6 +845,10 @@ int main(int argc, const char* argv[])
     {
       basePath = args[++i];
     }
+    else if (args[i] == "-b" || args[i] == "--binned-dispatch")
+    {
+      g_binnedDispatch = true;
+    }
     else
     {
       std::cerr << "Bad arg:" << args[i] << std::endl;
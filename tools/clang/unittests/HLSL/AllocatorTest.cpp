@@ -547,6 +547,7 @@ public:
   TEST_METHOD(Intersections)
   TEST_METHOD(GapFilling)
   TEST_METHOD(Allocate)
+  TEST_METHOD(ManySpans)
 
   void InitScenarios() {
     struct P {
@@ -766,3 +767,40 @@ TEST_F(AllocatorTest, Allocate) {
     TestSizesFn();
   }
 }
+
+TEST_F(AllocatorTest, ManySpans) {
+  // Bindless-style shaders can bind on the order of 100k resources in a space.
+  // Every allocation below has to skip past all the holes that are too small,
+  // which used to rescan every span each time.
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  const unsigned count = 100000;
+  ElementVector elements;
+  elements.reserve(3 * count);
+  Allocator alloc(0, UINT_MAX);
+
+  // Reserve every even register, leaving single register holes.
+  for (unsigned i = 0; i < count; ++i) {
+    elements.emplace_back(i, 2 * i, 2 * i);
+    VERIFY_IS_NULL(alloc.Insert(&elements.back(), 2 * i, 2 * i));
+  }
+
+  // Ranges of two only fit from the last hole onward, found the way
+  // DxilCondenseResources does it: Find, then Insert.
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned pos = 0;
+    VERIFY_IS_TRUE(alloc.Find(2, pos));
+    VERIFY_ARE_EQUAL(2 * count - 1 + 2 * i, pos);
+    elements.emplace_back(count + i, pos, pos + 1);
+    VERIFY_IS_NULL(alloc.Insert(&elements.back(), pos, pos + 1));
+  }
+
+  // Single registers fill the remaining holes in order, then go past the end.
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned pos = 0xFEFEFEFE;
+    elements.emplace_back(2 * count + i, 0, 0);
+    VERIFY_IS_TRUE(alloc.Allocate(&elements.back(), 1, pos));
+    VERIFY_ARE_EQUAL(i + 1 < count ? 2 * i + 1 : 4 * count - 1, pos);
+  }
+  VERIFY_ARE_EQUAL(4 * count, alloc.GetFirstFree());
+  VERIFY_ARE_EQUAL(3 * count, (unsigned)alloc.GetSpans().size());
+}
@@ -22,6 +22,9 @@
 #include <sstream>
 #include <algorithm>
 #include <cfloat>
+#include <atomic>
+#include <thread>
+#include <chrono>
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
@@ -42,6 +45,7 @@
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/Support/Unicode.h"
+#include "dxc/Support/FileIOHelper.h"
 
 #include <fstream>
 #include "llvm/Support/FileSystem.h"
@@ -106,6 +110,75 @@ public:
   }
 };
 
+class TestCompileBatchCallback : public IDxcCompileBatchCallback {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestCompileBatchCallback(UINT32 requestCount) : m_dwRef(0), Results(requestCount) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcCompileBatchCallback>(this, iid, ppvObject);
+  }
+
+  std::vector<CComPtr<IDxcResult>> Results;
+  UINT32 CallCount = 0;
+
+  HRESULT STDMETHODCALLTYPE OnCompileComplete(
+    _In_ UINT32 requestIndex, _In_ IDxcResult *pResult) override {
+    ++CallCount;
+    if (requestIndex >= Results.size() || Results[requestIndex] != nullptr)
+      return E_FAIL;
+    Results[requestIndex] = pResult;
+    return S_OK;
+  }
+};
+
+class TestDiagnosticSink : public IDxcDiagnosticSink {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestDiagnosticSink() : m_dwRef(0) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcDiagnosticSink>(this, iid, ppvObject);
+  }
+
+  struct Received {
+    UINT32 Severity;
+    std::string Message;
+    std::string FileName;
+    UINT32 Line;
+    UINT32 Column;
+  };
+  std::vector<Received> Diagnostics;
+  HRESULT ErrorResult = S_OK; // Returned for errors
+
+  HRESULT STDMETHODCALLTYPE OnDiagnostic(
+    _In_ const DxcDiagnosticInfo *pDiagnostic) override {
+    Received received = { pDiagnostic->severity, pDiagnostic->pMessage,
+                          pDiagnostic->pFileName ? pDiagnostic->pFileName : "",
+                          pDiagnostic->line, pDiagnostic->column };
+    Diagnostics.push_back(received);
+    return pDiagnostic->severity == DxcDiagnosticSeverity_Error ? ErrorResult : S_OK;
+  }
+};
+
+class TestCancellationToken : public IDxcCancellationToken {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestCancellationToken() : m_dwRef(0) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcCancellationToken>(this, iid, ppvObject);
+  }
+
+  std::atomic<bool> Cancelled{ false };
+  std::atomic<unsigned> CallCount{ 0 };
+
+  BOOL STDMETHODCALLTYPE IsCancellationRequested() override {
+    ++CallCount;
+    return Cancelled ? TRUE : FALSE;
+  }
+};
+
 #ifdef _WIN32
 class CompilerTest {
 #else
@@ -133,13 +206,40 @@ public:
   TEST_METHOD(CompileThenTestPdbUtilsStripped)
   TEST_METHOD(CompileThenTestPdbUtilsEmptyEntry)
   TEST_METHOD(CompileThenTestPdbUtilsRelativePath)
+  TEST_METHOD(CompileThenTestPdbUtilsOverrideArgsBeforeQuery)
+  TEST_METHOD(CompileThenTestPdbUtilsDuplicateSources)
   TEST_METHOD(CompileWithRootSignatureThenStripRootSignature)
+  TEST_METHOD(CompileWhenRootSignatureSwappedThenCheckedAgainstPSV)
+  TEST_METHOD(CompileWhenRootSignatureRepeatedThenSameResult)
 
   TEST_METHOD(CompileWhenIncludeThenLoadInvoked)
   TEST_METHOD(CompileWhenIncludeThenLoadUsed)
+  TEST_METHOD(CompileWhenCacheEnabledThenSecondCompileHits)
+  TEST_METHOD(CompileWhenIncludePTHThenHeaderUsed)
+  TEST_METHOD(CompileBatchWhenPermutationsThenAllComplete)
+  TEST_METHOD(CompilePermutationsWhenDefinesUnusedThenCompileShared)
+  TEST_METHOD(CompileWhenIncludeCacheTrustedThenHandlerSkipped)
+  TEST_METHOD(CompileWithDiagnosticsWhenErrorThenSinkGetsLocation)
+  TEST_METHOD(CompileWithDiagnosticsWhenSinkFailsThenCompileStops)
+  TEST_METHOD(CompileWithCancellationWhenCancelledThenAborts)
+  TEST_METHOD(LoadSourceWhenLargeAsciiFileThenUtf8InPlace)
+  TEST_METHOD(CompileWhenArenaEnabledThenOutputsOutliveCompiler)
+  TEST_METHOD(CompileWhenContextReusedThenOutputsMatchAcrossThreads)
+  TEST_METHOD(CompileWhenTimeReportThenPhasesAndPassesReported)
+  TEST_METHOD(CompileWhenCompileStatsThenStagesReported)
+  TEST_METHOD(CompileWhenLineStatsThenLinesAndInlinedCallsReported)
+  TEST_METHOD(CompileWhenMemoryLimitThenPeakReportedOrOutOfMemory)
+  TEST_METHOD(CompileWhenParallelFunctionsThenMatchesSerial)
+  TEST_METHOD(CompileWhenParallelFunctionsThenProgramPartMatchesSerial)
+  TEST_METHOD(DisassembleToStreamWhenThreadsThenMatchesDisassemble)
+  TEST_METHOD(CreateBlobFromMemoryStreamThenContentsNotCopied)
+  TEST_METHOD(CompileWhenReuseLibThenUnchangedFunctionsLinked)
+  TEST_METHOD(CompileWhenStagedThenHLModuleFinishedPerVariant)
+  TEST_METHOD(CompileWhenDependenciesThenIncludesListedWithoutParsing)
   TEST_METHOD(CompileWhenIncludeAbsoluteThenLoadAbsolute)
   TEST_METHOD(CompileWhenIncludeLocalThenLoadRelative)
   TEST_METHOD(CompileWhenIncludeSystemThenLoadNotRelative)
+  TEST_METHOD(CompileWhenIncludeSpelledTwiceThenLoadOnce)
   TEST_METHOD(CompileWhenIncludeSystemMissingThenLoadAttempt)
   TEST_METHOD(CompileWhenIncludeFlagsThenIncludeUsed)
   TEST_METHOD(CompileWhenIncludeMissingThenFail)
@@ -214,6 +314,9 @@ public:
   BEGIN_TEST_METHOD(CodeGenHashStability)
       TEST_METHOD_PROPERTY(L"Priority", L"2")
   END_TEST_METHOD()
+  BEGIN_TEST_METHOD(CompileThroughputWhenThreadsAddedThenScales)
+      TEST_METHOD_PROPERTY(L"Priority", L"2")
+  END_TEST_METHOD()
 
   dxc::DxcDllSupport m_dllSupport;
   VersionSupportInfo m_ver;
@@ -430,6 +533,11 @@ public:
     CodeGenTestCheckFullPath(path.c_str(), dumpPath);
   }
 
+  // Runs the FileCheck tests found under suitePath on FileCheckThreads
+  // threads, one per core by default, each with its own file system and
+  // compiler. FileCheckShardCount and FileCheckShardIndex run every Nth file
+  // of the sorted list instead, so a suite splits evenly across machines.
+  // Results are logged in file order once every thread is done.
   void CodeGenTestCheckBatchDir(std::wstring suitePath, bool implicitDir = true) {
     using namespace llvm;
     using namespace WEX::TestExecution;
@@ -451,8 +559,7 @@ public:
 
     CW2A utf8SuitePath(suitePath.c_str());
 
-    unsigned numTestsRun = 0;
-
+    std::vector<std::string> testPaths;
     std::error_code EC;
     llvm::SmallString<128> DirNative;
     llvm::sys::path::native(utf8SuitePath.m_psz, DirNative);
@@ -463,32 +570,77 @@ public:
       if (!llvm::StringSwitch<bool>(llvm::sys::path::extension(Dir->path()))
           .Cases(".hlsl", ".ll", true).Default(false))
         continue;
-      StringRef filename = Dir->path();
-      CA2W wRelPath(filename.data());
+      testPaths.push_back(Dir->path());
+    }
+    VERIFY_IS_GREATER_THAN(testPaths.size(), (size_t)0, L"No test files found in batch directory.");
+    std::sort(testPaths.begin(), testPaths.end());
+
+    unsigned shardCount = std::max(1u, hlsl_test::GetTestParamUnsigned(L"FileCheckShardCount", 1));
+    unsigned shardIndex = hlsl_test::GetTestParamUnsigned(L"FileCheckShardIndex", 0);
+    VERIFY_IS_LESS_THAN(shardIndex, shardCount);
+    std::vector<std::wstring> shardPaths, shardDumpPaths;
+    for (size_t i = shardIndex; i < testPaths.size(); i += shardCount) {
+      CA2W wRelPath(testPaths[i].c_str());
       std::wstring dumpStr;
       if (!dumpPath.empty() && suitePath.compare(0, suitePath.size(), wRelPath.m_psz, suitePath.size()) == 0) {
         dumpStr = dumpPath + (wRelPath.m_psz + suitePath.size());
       }
-
-      class ScopedLogGroup
-      {
-        LPWSTR m_path;
-
-      public:
-          ScopedLogGroup(LPWSTR path)
-          : m_path(path)
-          { WEX::Logging::Log::StartGroup(m_path); }
-          ~ScopedLogGroup() { WEX::Logging::Log::EndGroup(m_path); }
-      };
-
-      ScopedLogGroup cleanup(wRelPath);
-      CodeGenTestCheck(wRelPath, /*implicitDir*/ false,
-        dumpStr.empty() ? nullptr : dumpStr.c_str());
-
-      numTestsRun++;
+      shardPaths.push_back(wRelPath.m_psz);
+      shardDumpPaths.push_back(dumpStr);
     }
 
-    VERIFY_IS_GREATER_THAN(numTestsRun, (unsigned)0, L"No test files found in batch directory.");
+    unsigned threadCount = hlsl_test::GetTestParamUnsigned(
+        L"FileCheckThreads", std::thread::hardware_concurrency());
+    threadCount = std::max(1u, std::min(threadCount, (unsigned)shardPaths.size()));
+    std::vector<FileRunTestResult> results(shardPaths.size());
+    std::atomic<size_t> nextTest(0);
+    auto runTests = [&]() {
+      ::llvm::sys::fs::MSFileSystem *threadMsfPtr;
+      CComPtr<IDxcCompiler> pCompiler;
+      HRESULT hr = CreateMSFileSystemForDisk(&threadMsfPtr);
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> threadMsf(
+          SUCCEEDED(hr) ? threadMsfPtr : nullptr);
+      ::llvm::sys::fs::AutoPerThreadSystem threadPts(threadMsf.get());
+      if (SUCCEEDED(hr) && threadPts.error_code())
+        hr = E_FAIL;
+      if (SUCCEEDED(hr))
+        hr = m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler);
+
+      for (size_t i; (i = nextTest++) < shardPaths.size();) {
+        FileRunTestResult &result = results[i];
+        result.RunResult = 1;
+        if (FAILED(hr)) {
+          result.ErrorMessage = "unable to set up test thread";
+          continue;
+        }
+        try {
+          result = FileRunTestResult::RunFromFileCommands(
+              shardPaths[i].c_str(), m_dllSupport, /*pPluginToolsPaths*/ nullptr,
+              shardDumpPaths[i].empty() ? nullptr : shardDumpPaths[i].c_str(),
+              pCompiler);
+        } catch (const hlsl::Exception &e) {
+          std::ostringstream OS;
+          OS << "exception 0x" << std::hex << (unsigned)e.hr << ": " << e.msg;
+          result.ErrorMessage = OS.str();
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threadCount; ++t)
+      threads.emplace_back(runTests);
+    runTests();
+    for (std::thread &thread : threads)
+      thread.join();
+
+    for (size_t i = 0; i < shardPaths.size(); ++i) {
+      WEX::Logging::Log::StartGroup(shardPaths[i].c_str());
+      if (results[i].RunResult != 0) {
+        CA2W commentWide(results[i].ErrorMessage.c_str(), CP_UTF8);
+        WEX::Logging::Log::Comment(commentWide);
+        WEX::Logging::Log::Error(L"Run result is not zero");
+      }
+      WEX::Logging::Log::EndGroup(shardPaths[i].c_str());
+    }
   }
 
   std::string VerifyCompileFailed(LPCSTR pText, LPCWSTR pTargetProfile, LPCSTR pErrorMsg) {
@@ -1792,6 +1944,97 @@ TEST_F(CompilerTest, CompileThenTestPdbInPrivate) {
   VERIFY_ARE_EQUAL(0, memcmp(pPdbBlob->GetBufferPointer(), pPrivatePdbBlob->GetBufferPointer(), pPdbBlob->GetBufferSize()));
 }
 
+TEST_F(CompilerTest, CompileThenTestPdbUtilsOverrideArgsBeforeQuery) {
+  if (m_ver.SkipDxilVersion(1, 5)) return;
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pOperationResult;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 PSMain() : SV_Target { return 0; }", &pSource);
+
+  const WCHAR *pArgs[] = { L"/Zi", L"/Od", L"-Qembed_debug", L"/DTHIS_IS_A_DEFINE=HELLO" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"PSMain",
+    L"ps_6_0", pArgs, _countof(pArgs), nullptr, 0, nullptr, &pOperationResult));
+
+  CComPtr<IDxcBlob> pCompiledBlob;
+  VERIFY_SUCCEEDED(pOperationResult->GetResult(&pCompiledBlob));
+
+  CComPtr<IDxcPdbUtils> pPdbUtils;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcPdbUtils, &pPdbUtils));
+  VERIFY_SUCCEEDED(pPdbUtils->Load(pCompiledBlob));
+
+  // The recorded arguments are read on first use; overriding them before any
+  // query must still replace them rather than be added to.
+  DxcArgPair Override[] = { { L"E", L"PSMain" }, { L"T", L"ps_6_0" } };
+  VERIFY_SUCCEEDED(pPdbUtils->OverrideArgs(Override, _countof(Override)));
+
+  UINT32 uArgPairCount = 0;
+  VERIFY_SUCCEEDED(pPdbUtils->GetArgPairCount(&uArgPairCount));
+  VERIFY_ARE_EQUAL(uArgPairCount, (UINT32)_countof(Override));
+
+  UINT32 uDefineCount = 0;
+  VERIFY_SUCCEEDED(pPdbUtils->GetDefineCount(&uDefineCount));
+  VERIFY_ARE_EQUAL(uDefineCount, 0u);
+
+  UINT32 uSourceCount = 0;
+  VERIFY_SUCCEEDED(pPdbUtils->GetSourceCount(&uSourceCount));
+  VERIFY_ARE_EQUAL(uSourceCount, 1u);
+
+  CComBSTR pEntryPoint;
+  VERIFY_SUCCEEDED(pPdbUtils->GetEntryPoint(&pEntryPoint));
+  VERIFY_ARE_EQUAL_WSTR(L"PSMain", pEntryPoint.m_str);
+}
+
+TEST_F(CompilerTest, CompileThenTestPdbUtilsDuplicateSources) {
+  if (m_ver.SkipDxilVersion(1, 5)) return;
+  CComPtr<TestIncludeHandler> pInclude;
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pOperationResult;
+
+  // Two headers with the same content are stored once in the source info
+  // part; both must still read back with their own names.
+  std::string main_source = "#include \"a.h\"\r\n"
+    "#include \"b.h\"\r\n"
+    "float4 PSMain() : SV_Target { return ZERO; }";
+  std::string included_File = "#ifndef ZERO\r\n#define ZERO 0\r\n#endif";
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(main_source.c_str(), &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(included_File.c_str());
+  pInclude->CallResults.emplace_back(included_File.c_str());
+
+  const WCHAR *pArgs[] = { L"/Zi", L"/Od", L"-Qembed_debug" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"PSMain",
+    L"ps_6_0", pArgs, _countof(pArgs), nullptr, 0, pInclude, &pOperationResult));
+
+  CComPtr<IDxcBlob> pCompiledBlob;
+  VERIFY_SUCCEEDED(pOperationResult->GetResult(&pCompiledBlob));
+
+  CComPtr<IDxcPdbUtils> pPdbUtils;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcPdbUtils, &pPdbUtils));
+  VERIFY_SUCCEEDED(pPdbUtils->Load(pCompiledBlob));
+
+  UINT32 uSourceCount = 0;
+  VERIFY_SUCCEEDED(pPdbUtils->GetSourceCount(&uSourceCount));
+  VERIFY_ARE_EQUAL(uSourceCount, 3u);
+
+  std::set<std::wstring> names;
+  for (UINT32 i = 1; i < uSourceCount; i++) {
+    CComBSTR pName;
+    VERIFY_SUCCEEDED(pPdbUtils->GetSourceName(i, &pName));
+    names.insert(std::wstring(pName.m_str));
+
+    CComPtr<IDxcBlobEncoding> pContent;
+    VERIFY_SUCCEEDED(pPdbUtils->GetSource(i, &pContent));
+    VERIFY_ARE_EQUAL(included_File, BlobToUtf8(pContent));
+  }
+  VERIFY_ARE_EQUAL(names.size(), 2u);
+}
+
 TEST_F(CompilerTest, CompileThenTestPdbUtilsRelativePath) {
   std::string main_source = R"x(
       #include "helper.h"
@@ -1887,6 +2130,56 @@ TEST_F(CompilerTest, CompileThenTestPdbUtilsEmptyEntry) {
 
 #endif
 
+TEST_F(CompilerTest, CompileWhenRootSignatureRepeatedThenSameResult) {
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+
+  // Root signatures serialized by an earlier compile are reused: the part
+  // must come out the same, and a rejected one must be reported again.
+  std::string parts[2];
+  for (std::string &part : parts) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    CreateBlobFromText("[RootSignature(\"CBV(b0), DescriptorTable(SRV(t0, numDescriptors=4))\")]\r\n"
+                       "float4 main(float a : A) : SV_Target {\r\n"
+                       "  return a;\r\n"
+                       "}",
+                       &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    hlsl::DxilContainerHeader *pContainerHeader = hlsl::IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_SUCCEEDED(
+        hlsl::IsValidDxilContainer(pContainerHeader, pProgram->GetBufferSize()));
+    hlsl::DxilPartHeader *pPartHeader = hlsl::GetDxilPartByType(
+        pContainerHeader, hlsl::DxilFourCC::DFCC_RootSignature);
+    VERIFY_IS_NOT_NULL(pPartHeader);
+    part.assign(hlsl::GetDxilPartData(pPartHeader), pPartHeader->PartSize);
+  }
+  VERIFY_IS_TRUE(parts[0] == parts[1]);
+
+  for (unsigned i = 0; i < 2; ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CreateBlobFromText("[RootSignature(\"CBV(b0), CBV(b0)\")]\r\n"
+                       "float4 main(float a : A) : SV_Target {\r\n"
+                       "  return a;\r\n"
+                       "}",
+                       &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    std::string errors = VerifyOperationFailed(pResult);
+    VERIFY_IS_TRUE(errors.find("overlaps with another") != std::string::npos);
+  }
+}
+
 TEST_F(CompilerTest, CompileWithRootSignatureThenStripRootSignature) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -1948,6 +2241,76 @@ TEST_F(CompilerTest, CompileWithRootSignatureThenStripRootSignature) {
                                         hlsl::DxilFourCC::DFCC_RootSignature);
   VERIFY_IS_NOT_NULL(pPartHeader);
 }
+
+TEST_F(CompilerTest, CompileWhenRootSignatureSwappedThenCheckedAgainstPSV) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcLibrary> pLibrary;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+
+  // Compiles Text and returns the program and its root signature part.
+  auto CompileWithRootSignature = [&](const char *Text, IDxcBlob **ppProgram,
+                                      IDxcBlob **ppRootSignature) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CreateBlobFromText(Text, &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(ppProgram));
+    hlsl::DxilContainerHeader *pContainerHeader = hlsl::IsDxilContainerLike(
+        (*ppProgram)->GetBufferPointer(), (*ppProgram)->GetBufferSize());
+    hlsl::DxilPartHeader *pPartHeader = hlsl::GetDxilPartByType(
+        pContainerHeader, hlsl::DxilFourCC::DFCC_RootSignature);
+    VERIFY_IS_NOT_NULL(pPartHeader);
+    CComPtr<IDxcBlobEncoding> pRootSignature;
+    VERIFY_SUCCEEDED(pLibrary->CreateBlobWithEncodingFromPinned(
+        hlsl::GetDxilPartData(pPartHeader), pPartHeader->PartSize, 0,
+        &pRootSignature));
+    *ppRootSignature = pRootSignature.Detach();
+  };
+
+  CComPtr<IDxcBlob> pProgram, pRootSignature;
+  CompileWithRootSignature("cbuffer C : register(b0) { float4 f; };\r\n"
+                           "[RootSignature(\"CBV(b0)\")]\r\n"
+                           "float4 main() : SV_Target { return f; }",
+                           &pProgram, &pRootSignature);
+  CComPtr<IDxcBlob> pOtherProgram, pEmptyRootSignature;
+  CompileWithRootSignature("[RootSignature(\"\")]\r\n"
+                           "float4 main() : SV_Target { return 0; }",
+                           &pOtherProgram, &pEmptyRootSignature);
+
+  // A root signature that does not bind the shader's constant buffer is
+  // rejected, and stays rejected as other parts are added.
+  CComPtr<IDxcContainerBuilder> pBuilder;
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(CreateContainerBuilder(&pBuilder));
+  VERIFY_SUCCEEDED(pBuilder->Load(pProgram));
+  VERIFY_SUCCEEDED(pBuilder->RemovePart(hlsl::DxilFourCC::DFCC_RootSignature));
+  VERIFY_SUCCEEDED(pBuilder->AddPart(hlsl::DxilFourCC::DFCC_RootSignature,
+                                     pEmptyRootSignature));
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pResult));
+  std::string errors = VerifyOperationFailed(pResult);
+  VERIFY_IS_TRUE(errors.find("Validation failed.") != std::string::npos);
+  pResult.Release();
+  VERIFY_SUCCEEDED(pBuilder->AddPart(hlsl::DxilFourCC::DFCC_PrivateData,
+                                     pRootSignature));
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pResult));
+  VerifyOperationFailed(pResult);
+  pResult.Release();
+
+  // Putting back the matching root signature passes, and keeps passing.
+  VERIFY_SUCCEEDED(pBuilder->RemovePart(hlsl::DxilFourCC::DFCC_RootSignature));
+  VERIFY_SUCCEEDED(pBuilder->AddPart(hlsl::DxilFourCC::DFCC_RootSignature,
+                                     pRootSignature));
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pResult));
+  VerifyOperationSucceeded(pResult);
+  pResult.Release();
+  VERIFY_SUCCEEDED(pBuilder->RemovePart(hlsl::DxilFourCC::DFCC_PrivateData));
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pResult));
+  VerifyOperationSucceeded(pResult);
+}
 #endif // Container builder unsupported
 
 TEST_F(CompilerTest, CompileWhenIncludeThenLoadInvoked) {
@@ -1990,6 +2353,1033 @@ TEST_F(CompilerTest, CompileWhenIncludeThenLoadUsed) {
   VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
 }
 
+TEST_F(CompilerTest, CompileWhenCacheEnabledThenSecondCompileHits) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcCompilerCache> pCache;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCache));
+
+  wchar_t TempPath[MAX_PATH];
+  VERIFY_WIN32_BOOL_SUCCEEDED(GetTempPathW(MAX_PATH, TempPath) != 0);
+  std::wstring CacheDir(TempPath);
+  CacheDir += L"dxc_compile_cache_test";
+  VERIFY_SUCCEEDED(pCache->SetCacheDirectory(CacheDir.c_str()));
+  VERIFY_SUCCEEDED(pCache->Clear());
+
+  std::string main_source =
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  LPCWSTR args[] = { L"-T", L"ps_6_0" };
+
+  auto compile = [&](const char *pHelper, IDxcResult **ppResult) {
+    CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+    // Once for the compile (or cache validation) and once for a compile
+    // after a miss.
+    pInclude->CallResults.emplace_back(pHelper);
+    pInclude->CallResults.emplace_back(pHelper);
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                        pInclude, IID_PPV_ARGS(ppResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED((*ppResult)->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  };
+
+  CComPtr<IDxcResult> pFirst, pSecond, pThird;
+  compile("#define ZERO 0", &pFirst);
+  compile("#define ZERO 0", &pSecond);
+  UINT32 hits, misses;
+  VERIFY_SUCCEEDED(pCache->GetStatistics(&hits, &misses));
+  VERIFY_ARE_EQUAL(1u, hits);
+  VERIFY_ARE_EQUAL(1u, misses);
+
+  CComPtr<IDxcBlob> pFirstObject, pSecondObject;
+  VERIFY_SUCCEEDED(pFirst->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pFirstObject), nullptr));
+  VERIFY_SUCCEEDED(pSecond->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pSecondObject), nullptr));
+  VERIFY_ARE_EQUAL(pFirstObject->GetBufferSize(), pSecondObject->GetBufferSize());
+  VERIFY_ARE_EQUAL(0, memcmp(pFirstObject->GetBufferPointer(),
+                             pSecondObject->GetBufferPointer(),
+                             pFirstObject->GetBufferSize()));
+
+  // A changed include must not be served from the cache.
+  compile("#define ZERO 1", &pThird);
+  VERIFY_SUCCEEDED(pCache->GetStatistics(&hits, &misses));
+  VERIFY_ARE_EQUAL(1u, hits);
+  VERIFY_ARE_EQUAL(2u, misses);
+
+  VERIFY_SUCCEEDED(pCache->Clear());
+  VERIFY_SUCCEEDED(pCache->SetCacheDirectory(nullptr));
+}
+
+TEST_F(CompilerTest, CompileWhenIncludePTHThenHeaderUsed) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string header = "#define ZERO 0\nfloat4 Zero() { return ZERO; }\n";
+  DxcBuffer HeaderBuf = {};
+  HeaderBuf.Ptr = header.c_str();
+  HeaderBuf.Size = header.size();
+  HeaderBuf.Encoding = CP_UTF8;
+  LPCWSTR emitArgs[] = { L"common.hlsli", L"-emit-pth" };
+  CComPtr<IDxcResult> pEmitResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&HeaderBuf, emitArgs, _countof(emitArgs),
+                                      nullptr, IID_PPV_ARGS(&pEmitResult)));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pEmitResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  CComPtr<IDxcBlob> pTokenCache;
+  VERIFY_SUCCEEDED(pEmitResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pTokenCache), nullptr));
+  VERIFY_IS_TRUE(pTokenCache->GetBufferSize() > 0);
+
+  // The token cache is requested first, then the header it was built from.
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  TestIncludeHandler::LoadSourceCallResult tokenCacheResult;
+  tokenCacheResult.hr = S_OK;
+  tokenCacheResult.codePage = CP_UTF8;
+  tokenCacheResult.source.assign((const char *)pTokenCache->GetBufferPointer(),
+                                 pTokenCache->GetBufferSize());
+  pInclude->CallResults.push_back(tokenCacheResult);
+  pInclude->CallResults.emplace_back(header.c_str());
+
+  std::string main_source = "float4 main() : SV_Target { return Zero(); }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  LPCWSTR args[] = { L"main.hlsl", L"-T", L"ps_6_0", L"-include-pth", L"common.pth" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      pInclude, IID_PPV_ARGS(&pResult)));
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  VERIFY_ARE_EQUAL_WSTR(L"common.pth", pInclude->CallInfos[0].Filename.c_str());
+}
+
+TEST_F(CompilerTest, CompileBatchWhenPermutationsThenAllComplete) {
+  CComPtr<IDxcCompilerBatch> pBatch;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pBatch));
+
+  std::string main_source =
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return VALUE + ZERO; }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  // The include is shared by every request, so it is only loaded once.
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+
+  std::vector<std::wstring> defines = { L"-DVALUE=1", L"-DVALUE=2", L"-DVALUE=3", L"-DVALUE=4" };
+  std::vector<std::vector<LPCWSTR>> args;
+  std::vector<DxcCompileRequest> requests;
+  for (const std::wstring &define : defines)
+    args.push_back({ L"source.hlsl", L"-T", L"ps_6_0", define.c_str() });
+  for (std::vector<LPCWSTR> &requestArgs : args) {
+    DxcCompileRequest request = {};
+    request.pSource = &SourceBuf;
+    request.pArguments = requestArgs.data();
+    request.argCount = requestArgs.size();
+    request.pIncludeHandler = pInclude;
+    requests.push_back(request);
+  }
+
+  CComPtr<TestCompileBatchCallback> pCallback = new TestCompileBatchCallback(requests.size());
+  VERIFY_SUCCEEDED(pBatch->CompileBatch(requests.data(), requests.size(), 0, pCallback));
+  VERIFY_ARE_EQUAL(requests.size(), pCallback->CallCount);
+  for (IDxcResult *pResult : pCallback->Results) {
+    VERIFY_IS_NOT_NULL(pResult);
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  }
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, CompilePermutationsWhenDefinesUnusedThenCompileShared) {
+  CComPtr<IDxcCompilerPermutations> pPermutations;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pPermutations));
+
+  std::string main_source =
+    "#ifdef USE_RED\r\n"
+    "float4 main() : SV_Target { return float4(1, 0, 0, 1); }\r\n"
+    "#else\r\n"
+    "float4 main() : SV_Target { return 0; }\r\n"
+    "#endif\r\n";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  DxcDefine red[] = { { L"USE_RED", nullptr } };
+  DxcDefine redUnused[] = { { L"USE_RED", nullptr }, { L"UNUSED", L"1" } };
+  DxcDefine unused[] = { { L"UNUSED", L"2" } };
+  DxcDefine redTwo[] = { { L"USE_RED", L"2" } };
+  DxcDefineSet defineSets[] = {
+    { red, _countof(red) },             // scanned
+    { redUnused, _countof(redUnused) }, // agrees on USE_RED, not scanned
+    { unused, _countof(unused) },       // scanned, other branch
+    { nullptr, 0 },                     // agrees with the previous one
+    { redTwo, _countof(redTwo) },       // scanned, same tokens as the first
+  };
+  LPCWSTR args[] = { L"main.hlsl", L"-T", L"ps_6_0" };
+  CComPtr<TestCompileBatchCallback> pCallback =
+      new TestCompileBatchCallback(_countof(defineSets));
+  UINT32 compileCount = 0;
+  VERIFY_SUCCEEDED(pPermutations->CompilePermutations(
+      &SourceBuf, args, _countof(args), defineSets, _countof(defineSets),
+      nullptr, 2, pCallback, &compileCount));
+  VERIFY_ARE_EQUAL(2u, compileCount);
+  VERIFY_ARE_EQUAL(_countof(defineSets), pCallback->CallCount);
+  for (CComPtr<IDxcResult> &pResult : pCallback->Results) {
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  }
+  VERIFY_ARE_EQUAL(pCallback->Results[0].p, pCallback->Results[1].p);
+  VERIFY_ARE_EQUAL(pCallback->Results[0].p, pCallback->Results[4].p);
+  VERIFY_ARE_EQUAL(pCallback->Results[2].p, pCallback->Results[3].p);
+  VERIFY_ARE_NOT_EQUAL(pCallback->Results[0].p, pCallback->Results[2].p);
+}
+
+TEST_F(CompilerTest, CompileWithDiagnosticsWhenErrorThenSinkGetsLocation) {
+  CComPtr<IDxcCompilerDiagnostics> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string main_source =
+    "float4 main() : SV_Target {\r\n"
+    "  return undeclared;\r\n"
+    "}";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  LPCWSTR args[] = { L"main.hlsl", L"-T", L"ps_6_0" };
+
+  CComPtr<TestDiagnosticSink> pSink = new TestDiagnosticSink();
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->CompileWithDiagnostics(
+      &SourceBuf, args, _countof(args), nullptr, pSink, IID_PPV_ARGS(&pResult)));
+  std::string errors = VerifyOperationFailed(pResult);
+  VERIFY_ARE_EQUAL(1u, pSink->Diagnostics.size());
+  const TestDiagnosticSink::Received &diagnostic = pSink->Diagnostics[0];
+  VERIFY_ARE_EQUAL(DxcDiagnosticSeverity_Error, diagnostic.Severity);
+  VERIFY_ARE_EQUAL_STR("use of undeclared identifier 'undeclared'",
+                       diagnostic.Message.c_str());
+  VERIFY_IS_TRUE(diagnostic.FileName.find("main.hlsl") != std::string::npos);
+  VERIFY_ARE_EQUAL(2u, diagnostic.Line);
+  VERIFY_ARE_EQUAL(10u, diagnostic.Column);
+  // The error output still has the full text.
+  VERIFY_IS_TRUE(errors.find(diagnostic.Message) != std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWithDiagnosticsWhenSinkFailsThenCompileStops) {
+  CComPtr<IDxcCompilerDiagnostics> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string main_source =
+    "float f1() { return undeclared1; }\r\n"
+    "float f2() { return undeclared2; }\r\n"
+    "float f3() { return undeclared3; }\r\n"
+    "float4 main() : SV_Target { return f1() + f2() + f3(); }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  // The sink gives up on the first error.
+  {
+    LPCWSTR args[] = { L"main.hlsl", L"-T", L"ps_6_0" };
+    CComPtr<TestDiagnosticSink> pSink = new TestDiagnosticSink();
+    pSink->ErrorResult = E_ABORT;
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->CompileWithDiagnostics(
+        &SourceBuf, args, _countof(args), nullptr, pSink, IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_ARE_EQUAL(E_ABORT, status);
+    VERIFY_ARE_EQUAL(1u, pSink->Diagnostics.size());
+    VERIFY_ARE_EQUAL(1u, pSink->Diagnostics[0].Line);
+  }
+
+  // The error limit stops the compile after the limit is exceeded.
+  {
+    LPCWSTR args[] = { L"main.hlsl", L"-T", L"ps_6_0", L"-ferror-limit=1" };
+    CComPtr<TestDiagnosticSink> pSink = new TestDiagnosticSink();
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->CompileWithDiagnostics(
+        &SourceBuf, args, _countof(args), nullptr, pSink, IID_PPV_ARGS(&pResult)));
+    VerifyOperationFailed(pResult);
+    VERIFY_ARE_EQUAL(2u, pSink->Diagnostics.size());
+    VERIFY_ARE_EQUAL(DxcDiagnosticSeverity_Error, pSink->Diagnostics[0].Severity);
+    VERIFY_ARE_EQUAL(DxcDiagnosticSeverity_Fatal, pSink->Diagnostics[1].Severity);
+  }
+}
+
+TEST_F(CompilerTest, CompileWithCancellationWhenCancelledThenAborts) {
+  CComPtr<IDxcCompilerCancellation> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  std::string main_source =
+    "float4 main(float4 a : A) : SV_Target { return a * 2; }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  LPCWSTR args[] = { L"main.hlsl", L"-T", L"ps_6_0" };
+
+  // A token that is never cancelled is polled without stopping the compile.
+  {
+    CComPtr<TestCancellationToken> pToken = new TestCancellationToken();
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->CompileWithCancellation(
+        &SourceBuf, args, _countof(args), nullptr, pToken, 0,
+        IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    VERIFY_IS_TRUE(pToken->CallCount > 0);
+  }
+
+  // A cancelled token stops the compile at the first check.
+  {
+    CComPtr<TestCancellationToken> pToken = new TestCancellationToken();
+    pToken->Cancelled = true;
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->CompileWithCancellation(
+        &SourceBuf, args, _countof(args), nullptr, pToken, 0,
+        IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_ARE_EQUAL(E_ABORT, status);
+    VERIFY_ARE_EQUAL(1u, (unsigned)pToken->CallCount);
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeCacheTrustedThenHandlerSkipped) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  CComPtr<IDxcIncludeCache> pIncludeCache;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcIncludeCache, &pIncludeCache));
+  VERIFY_SUCCEEDED(pIncludeCache->SetMode(DxcIncludeCacheMode_Trust));
+
+  std::string main_source =
+    "#include \"cached.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  LPCWSTR args[] = { L"-T", L"ps_6_0" };
+
+  auto compile = [&](TestIncludeHandler *pInclude) {
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                        pInclude, IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  };
+
+  CComPtr<TestIncludeHandler> pFirst = new TestIncludeHandler(m_dllSupport);
+  pFirst->CallResults.emplace_back("#define ZERO 0");
+  compile(pFirst);
+  VERIFY_ARE_EQUAL(1u, pFirst->CallInfos.size());
+
+  // Trusted entries are served without asking the handler again.
+  CComPtr<TestIncludeHandler> pSecond = new TestIncludeHandler(m_dllSupport);
+  compile(pSecond);
+  VERIFY_ARE_EQUAL(0u, pSecond->CallInfos.size());
+
+  CComPtr<TestIncludeHandler> pThird = new TestIncludeHandler(m_dllSupport);
+  pThird->CallResults.emplace_back("#define ZERO 1");
+  VERIFY_SUCCEEDED(pIncludeCache->Invalidate(L"cached.h"));
+  compile(pThird);
+  VERIFY_ARE_EQUAL(1u, pThird->CallInfos.size());
+
+  UINT32 hits, misses;
+  VERIFY_SUCCEEDED(pIncludeCache->GetStatistics(&hits, &misses));
+  VERIFY_IS_TRUE(hits >= 1u);
+  VERIFY_IS_TRUE(misses >= 2u);
+
+  VERIFY_SUCCEEDED(pIncludeCache->SetMode(DxcIncludeCacheMode_Disabled));
+}
+
+TEST_F(CompilerTest, LoadSourceWhenLargeAsciiFileThenUtf8InPlace) {
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcIncludeHandler> pInclude;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  VERIFY_SUCCEEDED(pLibrary->CreateIncludeHandler(&pInclude));
+
+  // Large enough to be mapped rather than read, and not a multiple of the
+  // page size.
+  std::string text;
+  while (text.size() < 64 * 1024)
+    text += "static const float kValue = 1.0f;\n";
+  text += "// end";
+
+  wchar_t TempPath[MAX_PATH];
+  VERIFY_WIN32_BOOL_SUCCEEDED(GetTempPathW(MAX_PATH, TempPath) != 0);
+  std::wstring FileName(TempPath);
+  FileName += L"dxc_mapped_source_test.hlsli";
+  {
+    std::ofstream out(FileName, std::ios::binary);
+    out << text;
+  }
+
+  {
+    CComPtr<IDxcBlob> pBlob;
+    VERIFY_SUCCEEDED(pInclude->LoadSource(FileName.c_str(), &pBlob));
+    CComPtr<IDxcBlobUtf8> pUtf8;
+    VERIFY_SUCCEEDED(pBlob.QueryInterface(&pUtf8));
+    VERIFY_ARE_EQUAL(text.size(), pUtf8->GetStringLength());
+    VERIFY_ARE_EQUAL(0, memcmp(text.data(), pUtf8->GetStringPointer(), text.size()));
+
+    // Conversion to UTF-8 must reference the mapped text rather than copy it.
+    CComPtr<IDxcUtils> pUtils;
+    CComPtr<IDxcBlobUtf8> pConverted;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcUtils, &pUtils));
+    VERIFY_SUCCEEDED(pUtils->GetBlobAsUtf8(pBlob, &pConverted));
+    VERIFY_ARE_EQUAL(pUtf8->GetStringPointer(), pConverted->GetStringPointer());
+  }
+
+  DeleteFileW(FileName.c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenArenaEnabledThenOutputsOutliveCompiler) {
+  CComPtr<IDxcResult> pResult;
+  {
+    CComPtr<IDxcCompiler3> pCompiler;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    std::string main_source =
+      "float4 main() : SV_Target { return 1; }\r\n"
+      "float unused() { return 0 }";
+    DxcBuffer SourceBuf = {};
+    SourceBuf.Ptr = main_source.c_str();
+    SourceBuf.Size = main_source.size();
+    SourceBuf.Encoding = CP_UTF8;
+    LPCWSTR args[] = { L"-T", L"ps_6_0", L"-compile-arena" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                        nullptr, IID_PPV_ARGS(&pResult)));
+  }
+
+  // The syntax error must be reported from memory that was not released
+  // with the arena.
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_FAILED(status);
+  CComPtr<IDxcBlobUtf8> pErrors;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors), nullptr));
+  VERIFY_IS_NOT_NULL(strstr(pErrors->GetStringPointer(), "expected ';'"));
+}
+
+TEST_F(CompilerTest, CompileWhenContextReusedThenOutputsMatchAcrossThreads) {
+  // Every shader declares the same struct, so a reused context that kept
+  // the names of earlier types would rename it in the program.
+  auto makeSource = [](unsigned seed) {
+    unsigned count = seed % 4 + 1;
+    std::ostringstream OS;
+    OS << "struct S { float4 v; float k; };\n"
+          "cbuffer C { S s[" << count << "]; };\n"
+          "float4 main(uint i : I) : SV_Target {\n"
+          "  return s[i % " << count << "].v * " << (seed % 7 + 1)
+       << " + s[(i + " << (seed % 5) << ") % " << count << "].k;\n"
+          "}\n";
+    return OS.str();
+  };
+  auto compile = [](IDxcCompiler3 *pCompiler, const std::string &source,
+                    bool reuse, std::string &program) {
+    DxcBuffer SourceBuf = {};
+    SourceBuf.Ptr = source.c_str();
+    SourceBuf.Size = source.size();
+    SourceBuf.Encoding = CP_UTF8;
+    std::vector<LPCWSTR> args = { L"-T", L"ps_6_0" };
+    if (reuse)
+      args.push_back(L"-reuse-context");
+    CComPtr<IDxcResult> pResult;
+    HRESULT status;
+    CComPtr<IDxcBlob> pObject;
+    if (FAILED(pCompiler->Compile(&SourceBuf, args.data(), args.size(),
+                                  nullptr, IID_PPV_ARGS(&pResult))) ||
+        FAILED(pResult->GetStatus(&status)) || FAILED(status) ||
+        FAILED(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pObject),
+                                  nullptr)))
+      return false;
+    const hlsl::DxilContainerHeader *pHeader = hlsl::IsDxilContainerLike(
+        pObject->GetBufferPointer(), pObject->GetBufferSize());
+    const hlsl::DxilPartHeader *pPart =
+        pHeader ? hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_DXIL) : nullptr;
+    if (pPart == nullptr)
+      return false;
+    program.assign((const char *)(pPart + 1), pPart->PartSize);
+    return true;
+  };
+
+  const unsigned kSources = 12;
+  std::vector<std::string> sources, expected(kSources);
+  for (unsigned i = 0; i < kSources; ++i) {
+    sources.push_back(makeSource(i * 2654435761u >> 16));
+    CComPtr<IDxcCompiler3> pCompiler;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    VERIFY_IS_TRUE(compile(pCompiler, sources[i], false, expected[i]));
+  }
+
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  std::atomic<unsigned> failures(0);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t]() {
+      unsigned seed = t + 1;
+      for (unsigned n = 0; n < 24; ++n) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned i = (seed >> 16) % kSources;
+        std::string program;
+        if (!compile(pCompiler, sources[i], true, program) ||
+            program != expected[i])
+          ++failures;
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+  VERIFY_ARE_EQUAL(0u, failures.load());
+}
+
+TEST_F(CompilerTest, CompileWhenTimeReportThenPhasesAndPassesReported) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  std::string main_source = "float4 main(float4 a : A) : SV_Target { return a * 2; }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  auto compile = [&](bool timeReport) {
+    std::vector<LPCWSTR> args = { L"-T", L"ps_6_0" };
+    if (timeReport)
+      args.push_back(L"-ftime-report");
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args.data(), args.size(),
+                                        nullptr, IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    return pResult;
+  };
+
+  VERIFY_IS_FALSE(compile(false)->HasOutput(DXC_OUT_TIME_REPORT));
+
+  CComPtr<IDxcResult> pResult = compile(true);
+  CComPtr<IDxcBlobUtf8> pReport;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_TIME_REPORT, IID_PPV_ARGS(&pReport), nullptr));
+  std::string report(pReport->GetStringPointer(), pReport->GetStringLength());
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("\"total\""));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("\"Parse and Sema\""));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("\"CodeGen\""));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("\"Validation\""));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("\"Container Serialization\""));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("\"HLSL CodeGen Finalization\""));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, report.find("\"passes\": [\n"));
+}
+
+TEST_F(CompilerTest, CompileWhenCompileStatsThenStagesReported) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  std::string main_source =
+      "Texture2D<float4> t; SamplerState s;\n"
+      "float4 main(float2 uv : UV) : SV_Target { return t.Sample(s, uv); }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  LPCWSTR args[] = { L"-T", L"ps_6_0", L"-fcompile-stats" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+
+  CComPtr<IDxcBlobUtf8> pStats;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_STATS, IID_PPV_ARGS(&pStats), nullptr));
+  std::string stats(pStats->GetStringPointer(), pStats->GetStringLength());
+  size_t codegen = stats.find("\"after_codegen\"");
+  size_t beforeDxilGen = stats.find("\"before_dxil_gen\"");
+  size_t optimized = stats.find("\"after_optimization\"");
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, codegen);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, beforeDxilGen);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, optimized);
+  VERIFY_IS_TRUE(codegen < beforeDxilGen && beforeDxilGen < optimized);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, stats.find("\"sample\": 1", optimized));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, stats.find("\"peak_memory_bytes\""));
+  size_t allocations = stats.find("\"allocations\"");
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, allocations);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                       stats.find("\"name\": \"Parse and Sema\", \"kind\": \"phase\"",
+                                  allocations));
+}
+
+TEST_F(CompilerTest, CompileWhenLineStatsThenLinesAndInlinedCallsReported) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  std::string main_source =
+      "Texture2D<float4> t; SamplerState s;\n"
+      "float4 fetch(float2 uv) { return t.Sample(s, uv); }\n"
+      "float4 main(float2 uv : UV) : SV_Target {\n"
+      "  return fetch(uv);\n"
+      "}";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  LPCWSTR args[] = { L"-T", L"ps_6_0", L"-Zi", L"-Qdebug_lines",
+                     L"-fline-stats" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+
+  CComPtr<IDxcBlobUtf8> pStats;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_LINE_STATS, IID_PPV_ARGS(&pStats), nullptr));
+  std::string stats(pStats->GetStringPointer(), pStats->GetStringLength());
+  size_t functions = stats.find("\"functions\"");
+  size_t calls = stats.find("\"inlined_calls\"");
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, functions);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, calls);
+  // The sample is on line 2, in fetch, inlined by the call on line 4.
+  size_t line = stats.find("\"line\": 2,");
+  VERIFY_IS_TRUE(line < functions);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, stats.find("\"sample\": 1", line));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                       stats.find("{ \"name\": \"fetch\"", functions));
+  size_t call = stats.find("\"line\": 4,", calls);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, call);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                       stats.find("\"callee\": \"fetch\"", call));
+}
+
+TEST_F(CompilerTest, CompileWhenMemoryLimitThenPeakReportedOrOutOfMemory) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  std::string main_source = "float4 main(float4 a : A) : SV_Target { return a * 2; }";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  auto compile = [&](LPCWSTR limit) {
+    LPCWSTR args[] = { L"-T", L"ps_6_0", L"-memory-limit", limit };
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                        nullptr, IID_PPV_ARGS(&pResult)));
+    return pResult;
+  };
+  auto getStatistics = [](IDxcResult *pResult) {
+    CComPtr<IDxcBlob> pStats;
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_MEMORY_STATISTICS, IID_PPV_ARGS(&pStats), nullptr));
+    VERIFY_ARE_EQUAL(sizeof(DxcMemoryStatistics), pStats->GetBufferSize());
+    return *(const DxcMemoryStatistics *)pStats->GetBufferPointer();
+  };
+
+  // No limit: the compile succeeds and reports its peak.
+  {
+    CComPtr<IDxcResult> pResult = compile(L"0");
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    DxcMemoryStatistics stats = getStatistics(pResult);
+    VERIFY_ARE_EQUAL(0u, stats.LimitBytes);
+#ifdef _WIN32
+    VERIFY_IS_TRUE(stats.PeakBytes > 0);
+#endif
+  }
+
+#ifdef _WIN32
+  // Only Windows builds route operator new through the thread allocator.
+  {
+    CComPtr<IDxcResult> pResult = compile(L"1");
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_ARE_EQUAL(E_OUTOFMEMORY, status);
+    CComPtr<IDxcBlobUtf8> pErrors;
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors), nullptr));
+    VERIFY_IS_NOT_NULL(strstr(pErrors->GetStringPointer(), "memory limit of 1 MB"));
+    DxcMemoryStatistics stats = getStatistics(pResult);
+    VERIFY_ARE_EQUAL(1024u * 1024u, stats.LimitBytes);
+    VERIFY_IS_TRUE(stats.PeakBytes <= stats.LimitBytes);
+  }
+#endif
+}
+
+TEST_F(CompilerTest, CompileWhenParallelFunctionsThenMatchesSerial) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  std::string main_source =
+      "RWByteAddressBuffer Out : register(u0);\n"
+      "struct Payload { float4 color; uint depth; };\n"
+      "struct Attribs { float2 bary; };\n"
+      "static const float Weights[4] = { 0.1, 0.2, 0.3, 0.4 };\n"
+      "export float Shade(float3 n, float3 l, uint count) {\n"
+      "  float sum = 0;\n"
+      "  for (uint i = 0; i < count; ++i) sum += dot(n, l) * Weights[i & 3];\n"
+      "  return sum;\n"
+      "}\n"
+      "export uint Hash(uint v) {\n"
+      "  v ^= v >> 16; v *= 0x7feb352d; v ^= v >> 15;\n"
+      "  return v;\n"
+      "}\n"
+      "[shader(\"miss\")]\n"
+      "void Miss(inout Payload p) { p.color = float4(0, 0, 0, 1); }\n"
+      "[shader(\"closesthit\")]\n"
+      "void Hit(inout Payload p, in Attribs a) {\n"
+      "  p.color = float4(Shade(float3(a.bary, 1), float3(1, 0, 0), p.depth), 0, 0, 1);\n"
+      "  Out.Store(Hash(p.depth) & 0xfc, p.depth);\n"
+      "}\n"
+      "[shader(\"raygeneration\")]\n"
+      "void RayGen() {\n"
+      "  uint2 id = DispatchRaysIndex().xy;\n"
+      "  Out.Store((id.x * 4) & 0xfc, Hash(id.x ^ id.y));\n"
+      "}\n";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  auto compile = [&](LPCWSTR threads) {
+    LPCWSTR args[] = { L"-T", L"lib_6_3", L"-opt-parallel-functions", threads };
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                        nullptr, IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pProgram), nullptr));
+    return DisassembleProgram(m_dllSupport, pProgram);
+  };
+
+  std::string serial = compile(L"1");
+  VERIFY_ARE_EQUAL(serial, compile(L"4"));
+  VERIFY_ARE_EQUAL(serial, compile(L"0"));
+}
+
+TEST_F(CompilerTest, CompileWhenParallelFunctionsThenProgramPartMatchesSerial) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  // Enough exported functions that each writer thread gets several function
+  // blocks; the bitcode must be the same bytes however they are split.
+  std::string main_source = "RWByteAddressBuffer Out : register(u0);\n";
+  for (int i = 0; i < 24; ++i) {
+    std::string n = std::to_string(i);
+    main_source += "export uint Mix" + n + "(uint v) {\n"
+                   "  v ^= v >> " + std::to_string(i % 13 + 3) + ";\n"
+                   "  Out.Store((v * 4) & 0xfc, v + " + n + ");\n"
+                   "  return v * 0x9e3779b1;\n"
+                   "}\n";
+  }
+  main_source += "[shader(\"raygeneration\")]\n"
+                 "void RayGen() {\n"
+                 "  uint2 id = DispatchRaysIndex().xy;\n"
+                 "  Out.Store((id.x * 4) & 0xfc, Mix0(id.x) ^ Mix23(id.y));\n"
+                 "}\n";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+
+  auto compile = [&](LPCWSTR threads) {
+    LPCWSTR args[] = { L"-T", L"lib_6_3", L"-opt-parallel-functions", threads };
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                        nullptr, IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pProgram), nullptr));
+    hlsl::DxilContainerHeader *pContainerHeader = hlsl::IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pContainerHeader);
+    hlsl::DxilPartHeader *pPartHeader = hlsl::GetDxilPartByType(
+        pContainerHeader, hlsl::DxilFourCC::DFCC_DXIL);
+    VERIFY_IS_NOT_NULL(pPartHeader);
+    return std::string(hlsl::GetDxilPartData(pPartHeader),
+                       pPartHeader->PartSize);
+  };
+
+  std::string serial = compile(L"1");
+  VERIFY_IS_TRUE(serial == compile(L"4"));
+  VERIFY_IS_TRUE(serial == compile(L"0"));
+}
+
+TEST_F(CompilerTest, DisassembleToStreamWhenThreadsThenMatchesDisassemble) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  CComPtr<IDxcCompilerStreamingDisassembly> pStreaming;
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pStreaming));
+  // Debug info gives each function metadata of its own, which must get the
+  // same numbers however the functions are shared out.
+  std::string main_source = "RWByteAddressBuffer Out : register(u0);\n";
+  for (int i = 0; i < 16; ++i) {
+    std::string n = std::to_string(i);
+    main_source += "export uint Mix" + n + "(uint v) {\n"
+                   "  Out.Store((v * 4) & 0xfc, v + " + n + ");\n"
+                   "  return v * 0x9e3779b1;\n"
+                   "}\n";
+  }
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  LPCWSTR args[] = { L"-T", L"lib_6_3", L"-Zi", L"-Qembed_debug" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      nullptr, IID_PPV_ARGS(&pResult)));
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pProgram), nullptr));
+  DxcBuffer ProgramBuf = {};
+  ProgramBuf.Ptr = pProgram->GetBufferPointer();
+  ProgramBuf.Size = pProgram->GetBufferSize();
+
+  CComPtr<IDxcResult> pDisassembly;
+  CComPtr<IDxcBlobUtf8> pText;
+  VERIFY_SUCCEEDED(pCompiler->Disassemble(&ProgramBuf, IID_PPV_ARGS(&pDisassembly)));
+  VERIFY_SUCCEEDED(pDisassembly->GetOutput(DXC_OUT_DISASSEMBLY, IID_PPV_ARGS(&pText), nullptr));
+  std::string expected(pText->GetStringPointer(), pText->GetStringLength());
+
+  auto disassemble = [&](LPCWSTR pFunctionName, UINT32 threads,
+                         HRESULT *pStatus) {
+    CComPtr<IMalloc> pMalloc;
+    VERIFY_SUCCEEDED(CoGetMalloc(1, &pMalloc));
+    CComPtr<hlsl::AbstractMemoryStream> pStream;
+    VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pStream));
+    CComPtr<IDxcResult> pStreamResult;
+    VERIFY_SUCCEEDED(pStreaming->DisassembleToStream(
+        &ProgramBuf, pFunctionName, threads, pStream,
+        IID_PPV_ARGS(&pStreamResult)));
+    VERIFY_SUCCEEDED(pStreamResult->GetStatus(pStatus));
+    return std::string((const char *)pStream->GetPtr(), pStream->GetPtrSize());
+  };
+
+  HRESULT status;
+  VERIFY_IS_TRUE(expected == disassemble(nullptr, 1, &status));
+  VERIFY_SUCCEEDED(status);
+  VERIFY_IS_TRUE(expected == disassemble(nullptr, 4, &status));
+  VERIFY_IS_TRUE(expected == disassemble(nullptr, 0, &status));
+
+  // A single function prints exactly as it does in the whole listing.
+  std::string function = disassemble(L"\01?Mix9@@YAII@Z", 1, &status);
+  VERIFY_SUCCEEDED(status);
+  VERIFY_IS_TRUE(function.find("define ") != std::string::npos);
+  VERIFY_IS_TRUE(expected.find(function) != std::string::npos);
+
+  disassemble(L"NotAFunction", 1, &status);
+  VERIFY_ARE_EQUAL(E_INVALIDARG, status);
+}
+
+TEST_F(CompilerTest, CreateBlobFromMemoryStreamThenContentsNotCopied) {
+  CComPtr<IMalloc> pMalloc;
+  VERIFY_SUCCEEDED(CoGetMalloc(1, &pMalloc));
+
+  // Text is null-terminated in place and handed over.
+  CComPtr<hlsl::AbstractMemoryStream> pStream;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pStream));
+  VERIFY_SUCCEEDED(pStream->Reserve(16));
+  ULONG cbWritten;
+  VERIFY_SUCCEEDED(pStream->Write("text", 4, &cbWritten));
+  LPBYTE pContents = pStream->GetPtr();
+  CComPtr<IDxcBlobEncoding> pBlob;
+  VERIFY_SUCCEEDED(hlsl::DxcCreateBlobFromMemoryStream(pStream, pMalloc, true,
+                                                       CP_UTF8, &pBlob));
+  CComPtr<IDxcBlobUtf8> pText;
+  VERIFY_SUCCEEDED(pBlob.QueryInterface(&pText));
+  VERIFY_ARE_EQUAL((LPCVOID)pContents, (LPCVOID)pText->GetStringPointer());
+  VERIFY_ARE_EQUAL(4u, (unsigned)pText->GetStringLength());
+  VERIFY_ARE_EQUAL(0u, (unsigned)pStream->GetPtrSize());
+
+  // Binary contents are taken as they are, and an empty stream gives an
+  // empty blob.
+  pBlob.Release();
+  VERIFY_SUCCEEDED(pStream->Write("\1\2\3", 3, &cbWritten));
+  pContents = pStream->GetPtr();
+  VERIFY_SUCCEEDED(hlsl::DxcCreateBlobFromMemoryStream(pStream, pMalloc, false,
+                                                       0, &pBlob));
+  VERIFY_ARE_EQUAL((LPCVOID)pContents, pBlob->GetBufferPointer());
+  VERIFY_ARE_EQUAL(3u, (unsigned)pBlob->GetBufferSize());
+  pBlob.Release();
+  VERIFY_SUCCEEDED(hlsl::DxcCreateBlobFromMemoryStream(pStream, pMalloc, false,
+                                                       0, &pBlob));
+  VERIFY_ARE_EQUAL(0u, (unsigned)pBlob->GetBufferSize());
+}
+
+TEST_F(CompilerTest, CompileWhenReuseLibThenUnchangedFunctionsLinked) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  auto makeSource = [](const char *hashConstant) {
+    return std::string(
+        "RWByteAddressBuffer Out : register(u0);\n"
+        "struct Payload { float4 color; uint depth; };\n"
+        "export uint Hash(uint v) {\n"
+        "  v ^= v >> 16; v *= ") + hashConstant + "; v ^= v >> 15;\n"
+        "  return v;\n"
+        "}\n"
+        "[shader(\"miss\")]\n"
+        "void Miss(inout Payload p) { p.color = float4(0, 0, 0, 1); }\n"
+        "[shader(\"raygeneration\")]\n"
+        "void RayGen() {\n"
+        "  uint2 id = DispatchRaysIndex().xy;\n"
+        "  Out.Store((id.x * 4) & 0xfc, Hash(id.x ^ id.y));\n"
+        "}\n";
+  };
+  auto compile = [&](const std::string &source, LPCWSTR *args, UINT32 argCount,
+                     IDxcIncludeHandler *pInclude) {
+    DxcBuffer SourceBuf = {};
+    SourceBuf.Ptr = source.c_str();
+    SourceBuf.Size = source.size();
+    SourceBuf.Encoding = CP_UTF8;
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, argCount, pInclude,
+                                        IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    return pResult;
+  };
+  auto toCallResult = [](IDxcBlob *pBlob) {
+    TestIncludeHandler::LoadSourceCallResult result;
+    result.hr = S_OK;
+    result.codePage = CP_UTF8;
+    result.source.assign((const char *)pBlob->GetBufferPointer(),
+                         pBlob->GetBufferSize());
+    return result;
+  };
+
+  LPCWSTR firstArgs[] = { L"lib.hlsl", L"-T", L"lib_6_3", L"-Ffp", L"lib.fp" };
+  CComPtr<IDxcResult> pFirst =
+      compile(makeSource("0x7feb352d"), firstArgs, _countof(firstArgs), nullptr);
+  CComPtr<IDxcBlob> pLib, pFingerprints;
+  VERIFY_SUCCEEDED(pFirst->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pLib), nullptr));
+  VERIFY_SUCCEEDED(pFirst->GetOutput(DXC_OUT_FUNCTION_FINGERPRINTS, IID_PPV_ARGS(&pFingerprints), nullptr));
+  VERIFY_IS_TRUE(pFingerprints->GetBufferSize() > 0);
+
+  // Editing Hash recompiles it and RayGen, which calls it; Miss comes from
+  // the first library.
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.push_back(toCallResult(pLib));
+  pInclude->CallResults.push_back(toCallResult(pFingerprints));
+  LPCWSTR secondArgs[] = { L"lib.hlsl", L"-T", L"lib_6_3", L"-Ffp", L"lib.fp",
+                           L"-reuse-lib", L"lib.dxil",
+                           L"-reuse-lib-fingerprints", L"lib.fp" };
+  CComPtr<IDxcResult> pSecond =
+      compile(makeSource("0x846ca68b"), secondArgs, _countof(secondArgs), pInclude);
+  VERIFY_ARE_EQUAL(2U, pInclude->CallInfos.size());
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pSecond->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pProgram), nullptr));
+  std::string disassembly = DisassembleProgram(m_dllSupport, pProgram);
+  VERIFY_IS_TRUE(disassembly.find("Miss@@") != std::string::npos);
+  VERIFY_IS_TRUE(disassembly.find("RayGen@@") != std::string::npos);
+  VERIFY_IS_TRUE(disassembly.find("Hash@@") != std::string::npos);
+  VERIFY_IS_TRUE(pSecond->HasOutput(DXC_OUT_FUNCTION_FINGERPRINTS));
+}
+
+TEST_F(CompilerTest, CompileWhenStagedThenHLModuleFinishedPerVariant) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  auto compile = [&](const void *pData, size_t size, LPCWSTR *args,
+                     UINT32 argCount) {
+    DxcBuffer SourceBuf = {};
+    SourceBuf.Ptr = pData;
+    SourceBuf.Size = size;
+    CComPtr<IDxcResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, argCount, nullptr,
+                                        IID_PPV_ARGS(&pResult)));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    CComPtr<IDxcBlob> pObject;
+    VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&pObject), nullptr));
+    return pObject;
+  };
+
+  std::string source =
+      "cbuffer Params : register(b0) { float3 LightDir; float Scale; };\n"
+      "float4 main(float3 n : NORMAL, float4 c : COLOR) : SV_Target {\n"
+      "  return c * dot(n, LightDir) * Scale;\n"
+      "}\n";
+  LPCWSTR hlArgs[] = { L"main.hlsl", L"-E", L"main", L"-T", L"ps_6_0",
+                       L"-emit-hl-module" };
+  CComPtr<IDxcBlob> pHLModule =
+      compile(source.c_str(), source.size(), hlArgs, _countof(hlArgs));
+  VERIFY_IS_FALSE(hlsl::IsValidDxilContainer(
+      (const hlsl::DxilContainerHeader *)pHLModule->GetBufferPointer(),
+      pHLModule->GetBufferSize()));
+
+  // The one high-level module finishes into each variant.
+  auto finish = [&](LPCWSTR *args, UINT32 argCount) {
+    CComPtr<IDxcBlob> pProgram =
+        compile(pHLModule->GetBufferPointer(), pHLModule->GetBufferSize(),
+                args, argCount);
+    VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(
+        (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer(),
+        pProgram->GetBufferSize()));
+    std::string disassembly = DisassembleProgram(m_dllSupport, pProgram);
+    VERIFY_IS_TRUE(disassembly.find("@dx.op.dot3.f32") != std::string::npos);
+    VERIFY_IS_TRUE(disassembly.find("@dx.op.storeOutput.f32") != std::string::npos);
+  };
+  LPCWSTR validatedArgs[] = { L"main.hlsl", L"-E", L"main", L"-T", L"ps_6_0",
+                              L"-from-hl-module" };
+  finish(validatedArgs, _countof(validatedArgs));
+  LPCWSTR unvalidatedArgs[] = { L"main.hlsl", L"-E", L"main", L"-T", L"ps_6_0",
+                                L"-from-hl-module", L"-Vd" };
+  finish(unvalidatedArgs, _countof(unvalidatedArgs));
+}
+
+TEST_F(CompilerTest, CompileWhenDependenciesThenIncludesListedWithoutParsing) {
+  CComPtr<IDxcCompiler3> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+
+  // Nothing here parses; only the includes are followed.
+  std::string main_source = "#include \"first.h\"\r\nnot a shader;";
+  DxcBuffer SourceBuf = {};
+  SourceBuf.Ptr = main_source.c_str();
+  SourceBuf.Size = main_source.size();
+  SourceBuf.Encoding = CP_UTF8;
+  CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#include \"second.h\"\r\nstill not a shader;");
+  pInclude->CallResults.emplace_back("#define SECOND 2");
+
+  LPCWSTR args[] = { L"main.hlsl", L"-M", L"-Fo", L"main.dxil" };
+  CComPtr<IDxcResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(&SourceBuf, args, _countof(args),
+                                      pInclude, IID_PPV_ARGS(&pResult)));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  VERIFY_ARE_EQUAL(DXC_OUT_DEPENDENCIES, pResult->PrimaryOutput());
+  VERIFY_IS_FALSE(pResult->HasOutput(DXC_OUT_OBJECT));
+
+  CComPtr<IDxcBlobUtf8> pDependencies;
+  VERIFY_SUCCEEDED(pResult->GetOutput(DXC_OUT_DEPENDENCIES, IID_PPV_ARGS(&pDependencies), nullptr));
+  std::string dependencies(pDependencies->GetStringPointer(),
+                           pDependencies->GetStringLength());
+  VERIFY_ARE_EQUAL(0u, dependencies.find("main.dxil: main.hlsl"));
+  size_t first = dependencies.find("first.h");
+  size_t second = dependencies.find("second.h");
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, first);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, second);
+  VERIFY_IS_TRUE(first < second);
+  VERIFY_ARE_EQUAL(2u, pInclude->CallInfos.size());
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeAbsoluteThenLoadAbsolute) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2073,6 +3463,28 @@ TEST_F(CompilerTest, CompileWhenIncludeSystemThenLoadNotRelative) {
 #endif
 }
 
+TEST_F(CompilerTest, CompileWhenIncludeSpelledTwiceThenLoadOnce) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"subdir/../helper.h\"\r\n"
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  // Lexing the header a second time would redefine ZERO.
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#pragma once\r\nstatic const float ZERO = 0;");
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL_WSTR(L"./subdir/../helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeSystemMissingThenLoadAttempt) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -3189,6 +4601,73 @@ TEST_F(CompilerTest, SubobjectCodeGenErrors) {
   }
 }
 
+// Compiles a fixed corpus on 1, 2, 4... threads up to the number of cores,
+// each thread with its own compiler, and logs the throughput at each count.
+// Every thread compiles the whole corpus, so with no contention between
+// compiles the time stays flat as threads are added.
+#ifdef _WIN32
+TEST_F(CompilerTest, CompileThroughputWhenThreadsAddedThenScales) {
+#else
+TEST_F(CompilerTest, DISABLED_CompileThroughputWhenThreadsAddedThenScales) {
+#endif
+  std::vector<std::string> corpus;
+  for (unsigned i = 0; i < 16; ++i) {
+    std::ostringstream OS;
+    OS << "Texture2D<float4> t; SamplerState s;\n"
+          "cbuffer C { float4 k[" << (i % 4 + 1) << "]; };\n"
+          "float4 main(float2 uv : UV, uint n : N) : SV_Target {\n"
+          "  float4 r = 0;\n"
+          "  [unroll] for (uint j = 0; j < " << (i + 4) << "; ++j)\n"
+          "    r += t.Sample(s, uv * (j + 1)) * k[j % " << (i % 4 + 1) << "];\n"
+          "  return n ? r : -r;\n"
+          "}\n";
+    corpus.push_back(OS.str());
+  }
+
+  unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  double singleThreadSeconds = 0;
+  for (unsigned threadCount = 1;; threadCount *= 2) {
+    threadCount = std::min(threadCount, maxThreads);
+    std::vector<CComPtr<IDxcCompiler3>> compilers(threadCount);
+    for (auto &pCompiler : compilers)
+      VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    std::atomic<unsigned> failures(0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threadCount; ++t) {
+      threads.emplace_back([&, t]() {
+        for (const std::string &source : corpus) {
+          DxcBuffer SourceBuf = {};
+          SourceBuf.Ptr = source.c_str();
+          SourceBuf.Size = source.size();
+          SourceBuf.Encoding = CP_UTF8;
+          LPCWSTR args[] = { L"-T", L"ps_6_0" };
+          CComPtr<IDxcResult> pResult;
+          HRESULT status;
+          if (FAILED(compilers[t]->Compile(&SourceBuf, args, _countof(args),
+                                           nullptr, IID_PPV_ARGS(&pResult))) ||
+              FAILED(pResult->GetStatus(&status)) || FAILED(status))
+            ++failures;
+        }
+      });
+    }
+    for (std::thread &thread : threads)
+      thread.join();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+    VERIFY_ARE_EQUAL(0u, failures.load());
+
+    if (threadCount == 1)
+      singleThreadSeconds = seconds;
+    double compilesPerSecond = threadCount * corpus.size() / seconds;
+    LogCommentFmt(L"%u threads: %.1f compiles/s, %.0f%% scaling efficiency",
+                  threadCount, compilesPerSecond,
+                  100.0 * singleThreadSeconds / seconds);
+    if (threadCount == maxThreads)
+      break;
+  }
+}
+
 #ifdef _WIN32
 TEST_F(CompilerTest, ManualFileCheckTest) {
 #else
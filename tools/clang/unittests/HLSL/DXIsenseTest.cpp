@@ -18,6 +18,34 @@
 #endif
 #include "dxc/Test/HlslTestUtils.h"
 #include "dxc/Support/microcom.h"
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+// Records the status of every parse reported to it.
+class TestParseCallback : public IDxcParseCallback {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestParseCallback() : m_dwRef(0) {}
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcParseCallback>(this, iid, ppvObject);
+  }
+
+  std::mutex Mutex;
+  std::map<UINT64, HRESULT> Statuses;
+  std::map<UINT64, unsigned> DiagCounts;
+  HRESULT STDMETHODCALLTYPE OnParsed(UINT64 cookie, HRESULT status,
+                                     IDxcTranslationUnit *pTU) override {
+    unsigned diagCount = 0;
+    if (pTU != nullptr)
+      pTU->GetNumDiagnostics(&diagCount);
+    std::lock_guard<std::mutex> lock(Mutex);
+    Statuses[cookie] = status;
+    DiagCounts[cookie] = diagCount;
+    return S_OK;
+  }
+};
 
 
 #ifdef _WIN32
@@ -108,6 +136,11 @@ protected:
 
   TEST_METHOD(InclusionWhenMissingThenError)
   TEST_METHOD(InclusionWhenValidThenAvailable)
+  TEST_METHOD(InclusionWhenSkipBodiesThenHeaderBodiesSkipped)
+
+  TEST_METHOD(IndexWhenParsedAsyncThenTUsReported)
+  TEST_METHOD(IndexWhenSameFileQueuedThenEarlierParseAborted)
+  TEST_METHOD(IndexWhenSymbolsUpdatedThenFoundAcrossFiles)
 
   TEST_METHOD(TUWhenGetFileMissingThenFail)
   TEST_METHOD(TUWhenGetFilePresentThenOK)
@@ -270,6 +303,142 @@ TEST_F(DXIntellisenseTest, InclusionWhenValidThenAvailable) {
   }
 }
 
+TEST_F(DXIntellisenseTest, InclusionWhenSkipBodiesThenHeaderBodiesSkipped) {
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> index;
+  CComPtr<IDxcUnsavedFile> unsaved[2];
+  CComPtr<IDxcTranslationUnit> TU;
+  // Only the error in the main file is reported; the header body is skipped.
+  const char main_text[] = "#include \"inc.h\"\r\nfloat4 main() : SV_Target { return foo() + undeclared_main; }";
+  const char unsaved_text[] = "float4 foo() { return undeclared_inc; }";
+  unsigned diagCount;
+  VERIFY_SUCCEEDED(CompilationResult::DefaultHlslSupport->CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&index));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("./inc.h", unsaved_text, strlen(unsaved_text), &unsaved[0]));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("file.hlsl", main_text, strlen(main_text), &unsaved[1]));
+  VERIFY_SUCCEEDED(index->ParseTranslationUnit("file.hlsl", nullptr, 0, &unsaved[0].p, 2,
+    (DxcTranslationUnitFlags)(DxcTranslationUnitFlags_UseCallerThread |
+                              DxcTranslationUnitFlags_SkipIncludedFunctionBodies), &TU));
+  VERIFY_SUCCEEDED(TU->GetNumDiagnostics(&diagCount));
+  VERIFY_ARE_EQUAL(1U, diagCount);
+
+  // Reparses keep skipping them.
+  VERIFY_SUCCEEDED(TU->Reparse(&unsaved[0].p, 2));
+  VERIFY_SUCCEEDED(TU->GetNumDiagnostics(&diagCount));
+  VERIFY_ARE_EQUAL(1U, diagCount);
+}
+
+TEST_F(DXIntellisenseTest, IndexWhenParsedAsyncThenTUsReported) {
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> index;
+  CComPtr<IDxcIndexAsync> asyncIndex;
+  CComPtr<IDxcUnsavedFile> unsaved[2];
+  CComPtr<TestParseCallback> callback = new TestParseCallback();
+  const char good_text[] = "float4 main() : SV_Target { return 1; }";
+  const char bad_text[] = "float4 main() : SV_Target { return undeclared; }";
+  UINT64 goodCookie, badCookie;
+  VERIFY_SUCCEEDED(CompilationResult::DefaultHlslSupport->CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&index));
+  VERIFY_SUCCEEDED(index.QueryInterface(&asyncIndex));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("good.hlsl", good_text, strlen(good_text), &unsaved[0]));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("bad.hlsl", bad_text, strlen(bad_text), &unsaved[1]));
+  VERIFY_SUCCEEDED(asyncIndex->ParseTranslationUnitAsync("good.hlsl", nullptr, 0, &unsaved[0].p, 1,
+    DxcTranslationUnitFlags_UseCallerThread, 0, callback, &goodCookie));
+  // Focused files go first.
+  VERIFY_SUCCEEDED(asyncIndex->ParseTranslationUnitAsync("bad.hlsl", nullptr, 0, &unsaved[1].p, 1,
+    DxcTranslationUnitFlags_UseCallerThread, 1, callback, &badCookie));
+  VERIFY_SUCCEEDED(asyncIndex->WaitForParses());
+  VERIFY_ARE_NOT_EQUAL(goodCookie, badCookie);
+  VERIFY_ARE_EQUAL(2U, callback->Statuses.size());
+  VERIFY_SUCCEEDED(callback->Statuses[goodCookie]);
+  VERIFY_SUCCEEDED(callback->Statuses[badCookie]);
+  VERIFY_ARE_EQUAL(0U, callback->DiagCounts[goodCookie]);
+  VERIFY_ARE_EQUAL(1U, callback->DiagCounts[badCookie]);
+  VERIFY_ARE_EQUAL(S_FALSE, asyncIndex->CancelParse(goodCookie));
+}
+
+TEST_F(DXIntellisenseTest, IndexWhenSameFileQueuedThenEarlierParseAborted) {
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> index;
+  CComPtr<IDxcIndexAsync> asyncIndex;
+  CComPtr<IDxcUnsavedFile> unsaved[2];
+  CComPtr<TestParseCallback> callback = new TestParseCallback();
+  const char old_text[] = "float4 main() : SV_Target { return undeclared; }";
+  const char new_text[] = "float4 main() : SV_Target { return 1; }";
+  UINT64 oldCookie, newCookie;
+  VERIFY_SUCCEEDED(CompilationResult::DefaultHlslSupport->CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&index));
+  VERIFY_SUCCEEDED(index.QueryInterface(&asyncIndex));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("file.hlsl", old_text, strlen(old_text), &unsaved[0]));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("file.hlsl", new_text, strlen(new_text), &unsaved[1]));
+  VERIFY_SUCCEEDED(asyncIndex->ParseTranslationUnitAsync("file.hlsl", nullptr, 0, &unsaved[0].p, 1,
+    DxcTranslationUnitFlags_UseCallerThread, 0, callback, &oldCookie));
+  // Whether the first parse started or not, only the second is reported.
+  VERIFY_SUCCEEDED(asyncIndex->ParseTranslationUnitAsync("file.hlsl", nullptr, 0, &unsaved[1].p, 1,
+    DxcTranslationUnitFlags_UseCallerThread, 0, callback, &newCookie));
+  VERIFY_SUCCEEDED(asyncIndex->WaitForParses());
+  VERIFY_ARE_EQUAL(E_ABORT, callback->Statuses[oldCookie]);
+  VERIFY_SUCCEEDED(callback->Statuses[newCookie]);
+  VERIFY_ARE_EQUAL(0U, callback->DiagCounts[newCookie]);
+}
+
+TEST_F(DXIntellisenseTest, IndexWhenSymbolsUpdatedThenFoundAcrossFiles) {
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> index;
+  CComPtr<IDxcSymbolIndex> symbols;
+  CComPtr<IDxcUnsavedFile> unsaved[3];
+  CComPtr<IDxcTranslationUnit> TUs[2];
+  const char inc_text[] = "float foo() { return 1; }";
+  const char a_text[] = "#include \"inc.h\"\r\nfloat4 main() : SV_Target { return foo(); }";
+  const char b_text[] = "#include \"inc.h\"\r\nfloat bar() { return foo() + foo(); }";
+  const char indexPath[] = "DXIsenseTest_symbols.idx";
+  VERIFY_SUCCEEDED(CompilationResult::DefaultHlslSupport->CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&index));
+  VERIFY_SUCCEEDED(index.QueryInterface(&symbols));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("./inc.h", inc_text, strlen(inc_text), &unsaved[0]));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("a.hlsl", a_text, strlen(a_text), &unsaved[1]));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("b.hlsl", b_text, strlen(b_text), &unsaved[2]));
+  CComPtr<IDxcUnsavedFile> aFiles[2] = { unsaved[0], unsaved[1] };
+  CComPtr<IDxcUnsavedFile> bFiles[2] = { unsaved[0], unsaved[2] };
+  VERIFY_SUCCEEDED(index->ParseTranslationUnit("a.hlsl", nullptr, 0, &aFiles[0].p, 2,
+    DxcTranslationUnitFlags_UseCallerThread, &TUs[0]));
+  VERIFY_SUCCEEDED(index->ParseTranslationUnit("b.hlsl", nullptr, 0, &bFiles[0].p, 2,
+    DxcTranslationUnitFlags_UseCallerThread, &TUs[1]));
+  std::remove(indexPath);
+  VERIFY_ARE_EQUAL(S_FALSE, symbols->Open(indexPath));
+  VERIFY_SUCCEEDED(symbols->UpdateFile(TUs[0]));
+  VERIFY_SUCCEEDED(symbols->UpdateFile(TUs[1]));
+
+  // The header is recorded for both main files, but reported once.
+  unsigned count;
+  DxcSymbolOccurrence *occurrences;
+  VERIFY_SUCCEEDED(symbols->FindOccurrencesByName("foo", DxcSymbolRole_Definition, &count, &occurrences));
+  VERIFY_ARE_EQUAL(1U, count);
+  VERIFY_ARE_EQUAL(1U, occurrences[0].Line);
+  std::string usr = occurrences[0].USR;
+  CoTaskMemFree(occurrences);
+  VERIFY_SUCCEEDED(symbols->FindOccurrences(usr.c_str(), DxcSymbolRole_Reference, &count, &occurrences));
+  VERIFY_ARE_EQUAL(3U, count);
+  CoTaskMemFree(occurrences);
+
+  // Another index finds them on disk without parsing.
+  VERIFY_SUCCEEDED(symbols->Save());
+  CComPtr<IDxcIndex> otherIndex;
+  CComPtr<IDxcSymbolIndex> otherSymbols;
+  VERIFY_SUCCEEDED(isense->CreateIndex(&otherIndex));
+  VERIFY_SUCCEEDED(otherIndex.QueryInterface(&otherSymbols));
+  VERIFY_ARE_EQUAL(S_OK, otherSymbols->Open(indexPath));
+  VERIFY_SUCCEEDED(otherSymbols->FindOccurrences(usr.c_str(), DxcSymbolRole_Reference, &count, &occurrences));
+  VERIFY_ARE_EQUAL(3U, count);
+  CoTaskMemFree(occurrences);
+
+  // Updates are per file.
+  VERIFY_ARE_EQUAL(S_OK, otherSymbols->RemoveFile("b.hlsl"));
+  VERIFY_SUCCEEDED(otherSymbols->FindOccurrences(usr.c_str(), DxcSymbolRole_Reference, &count, &occurrences));
+  VERIFY_ARE_EQUAL(1U, count);
+  CoTaskMemFree(occurrences);
+  std::remove(indexPath);
+}
 
 TEST_F(DXIntellisenseTest, TUWhenGetFileMissingThenFail) {
   const char program[] = "int i;";
@@ -41,6 +41,7 @@
 #endif
 
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "dxc/Test/HLSLTestData.h"
@@ -52,6 +53,8 @@
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
+#include "dxc/DxilContainer/DxilShaderArchive.h"
+#include "dxc/Support/FileIOHelper.h"
 #include <assert.h> // Needed for DxilPipelineStateValidation.h
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
 #include "dxc/DXIL/DxilShaderFlags.h"
@@ -95,9 +98,13 @@ public:
   TEST_CLASS_SETUP(InitSupport);
 
   TEST_METHOD(CompileWhenDebugSourceThenSourceMatters)
+  TEST_METHOD(CompileWhenStrippedThenHashMatchesProgram)
+  TEST_METHOD(ArchiveWhenPartsSharedThenStoredOnce)
+  TEST_METHOD(MemoryStreamWhenLargeThenContentsKeptInOrder)
   TEST_METHOD(CompileAS_CheckPSV0)
   TEST_METHOD(CompileWhenOkThenCheckRDAT)
   TEST_METHOD(CompileWhenOkThenCheckRDAT2)
+  TEST_METHOD(CompileWhenUnvalidatedThenRDATNameIndexFindsExports)
   TEST_METHOD(CompileWhenOkThenCheckReflection1)
   TEST_METHOD(DxcUtils_CreateReflection)
   TEST_METHOD(CompileWhenOKThenIncludesFeatureInfo)
@@ -114,6 +121,7 @@ public:
   BEGIN_TEST_METHOD(ReflectionMatchesDXBC_Full)
     TEST_METHOD_PROPERTY(L"Priority", L"1")
   END_TEST_METHOD()
+  TEST_METHOD(ReflectionWhenCacheEnabledThenSecondLoadHits)
 
   dxc::DxcDllSupport m_dllSupport;
   VersionSupportInfo m_ver;
@@ -661,6 +669,161 @@ TEST_F(DxilContainerTest, CompileWhenDebugSourceThenSourceMatters) {
 }
 #endif // _WIN32
 
+// When debug info and the root signature are stripped, the program part is
+// serialized directly into the container and the hash and debug name parts
+// are filled in afterwards; they must still describe the program part.
+TEST_F(DxilContainerTest, CompileWhenStrippedThenHashMatchesProgram) {
+  if (!DoesValidatorSupportShaderHash() || !DoesValidatorSupportDebugName())
+    return;
+
+  char program[] =
+    "[RootSignature(\"CBV(b0)\")]\n"
+    "cbuffer C : register(b0) { float4 c; };\n"
+    "float4 main() : SV_Target { return c; }";
+  LPCWSTR ZiZsb[] = { L"/Zi", L"/Qembed_debug", L"/Zsb" };
+
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcContainerReflection> pContainer;
+  CompileToProgram(program, L"main", L"ps_6_0", ZiZsb, _countof(ZiZsb),
+                   &pProgram);
+  VERIFY_SUCCEEDED(
+      m_dllSupport.CreateInstance(CLSID_DxcContainerReflection, &pContainer));
+  VERIFY_SUCCEEDED(pContainer->Load(pProgram));
+
+  UINT32 index;
+  CComPtr<IDxcBlob> pDxilPart;
+  VERIFY_SUCCEEDED(pContainer->FindFirstPartKind(hlsl::DFCC_DXIL, &index));
+  VERIFY_SUCCEEDED(pContainer->GetPartContent(index, &pDxilPart));
+  const hlsl::DxilProgramHeader *pHeader =
+      (const hlsl::DxilProgramHeader *)pDxilPart->GetBufferPointer();
+  VERIFY_ARE_EQUAL(pHeader->SizeInUint32 * 4, pDxilPart->GetBufferSize());
+
+  llvm::MD5 md5;
+  llvm::MD5::MD5Result digest;
+  md5.update(llvm::ArrayRef<uint8_t>(
+      (const uint8_t *)hlsl::GetDxilBitcodeData(pHeader),
+      pHeader->BitcodeHeader.BitcodeSize));
+  md5.final(digest);
+  llvm::SmallString<32> digestStr;
+  llvm::MD5::stringifyResult(digest, digestStr);
+
+  CComPtr<IDxcBlob> pHashPart;
+  VERIFY_SUCCEEDED(
+      pContainer->FindFirstPartKind(hlsl::DFCC_ShaderHash, &index));
+  VERIFY_SUCCEEDED(pContainer->GetPartContent(index, &pHashPart));
+  std::string hash = RetrieveHashFromBlob(pHashPart);
+  VERIFY_ARE_EQUAL_STR(digestStr.c_str(), hash.c_str());
+
+  std::string name = CompileToDebugName(program, L"main", L"ps_6_0", ZiZsb,
+                                        _countof(ZiZsb));
+  VERIFY_ARE_EQUAL_STR((hash + ".pdb").c_str(), name.c_str());
+}
+
+TEST_F(DxilContainerTest, ArchiveWhenPartsSharedThenStoredOnce) {
+  char programA[] =
+    "[RootSignature(\"CBV(b0)\")]\n"
+    "cbuffer C : register(b0) { float4 c; };\n"
+    "float4 main() : SV_Target { return c; }";
+  char programB[] =
+    "[RootSignature(\"CBV(b0)\")]\n"
+    "cbuffer C : register(b0) { float4 c; };\n"
+    "float4 main() : SV_Target { return c * 2; }";
+
+  CComPtr<IDxcBlob> pProgramA, pProgramB;
+  CompileToProgram(programA, L"main", L"ps_6_0", nullptr, 0, &pProgramA);
+  CompileToProgram(programB, L"main", L"ps_6_0", nullptr, 0, &pProgramB);
+  const hlsl::DxilContainerHeader *pHeaderA =
+      hlsl::IsDxilContainerLike(pProgramA->GetBufferPointer(),
+                                pProgramA->GetBufferSize());
+  VERIFY_IS_NOT_NULL(pHeaderA);
+
+  hlsl::DxilShaderArchiveWriter writer;
+  VERIFY_SUCCEEDED(writer.AddContainer("a", pProgramA->GetBufferPointer(),
+                                       pProgramA->GetBufferSize()));
+  VERIFY_SUCCEEDED(writer.AddContainer("b", pProgramB->GetBufferPointer(),
+                                       pProgramB->GetBufferSize()));
+  VERIFY_SUCCEEDED(writer.AddContainer("a2", pProgramA->GetBufferPointer(),
+                                       pProgramA->GetBufferSize()));
+  VERIFY_FAILED(writer.AddContainer("a", pProgramA->GetBufferPointer(),
+                                    pProgramA->GetBufferSize()));
+  // The second copy of A adds nothing; B shares at least the root signature.
+  VERIFY_IS_TRUE(writer.GetUniquePartCount() < 2 * pHeaderA->PartCount);
+
+  CComPtr<IMalloc> pMalloc;
+  VERIFY_SUCCEEDED(CoGetMalloc(1, &pMalloc));
+  CComPtr<hlsl::AbstractMemoryStream> pArchiveStream;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pArchiveStream));
+  VERIFY_SUCCEEDED(writer.Write(pArchiveStream));
+  CComPtr<IDxcBlob> pArchive;
+  VERIFY_SUCCEEDED(pArchiveStream.QueryInterface(&pArchive));
+
+  hlsl::DxilShaderArchiveReader reader;
+  VERIFY_SUCCEEDED(reader.Load(pArchive));
+  VERIFY_ARE_EQUAL(3u, reader.GetContainerCount());
+  VERIFY_ARE_EQUAL(DXIL_SHADER_ARCHIVE_NOT_FOUND, reader.FindContainer("c"));
+
+  uint32_t a = reader.FindContainer("a");
+  uint32_t a2 = reader.FindContainer("a2");
+  VERIFY_ARE_NOT_EQUAL(DXIL_SHADER_ARCHIVE_NOT_FOUND, a);
+  VERIFY_ARE_NOT_EQUAL(DXIL_SHADER_ARCHIVE_NOT_FOUND, a2);
+  VERIFY_ARE_EQUAL(pHeaderA->PartCount, reader.GetPartCount(a2));
+
+  // Parts of both names for A are views of the same archive bytes.
+  CComPtr<IDxcBlob> pPart, pPart2;
+  VERIFY_SUCCEEDED(reader.GetPartBlob(a, 0, &pPart));
+  VERIFY_SUCCEEDED(reader.GetPartBlob(a2, 0, &pPart2));
+  VERIFY_ARE_EQUAL(pPart->GetBufferPointer(), pPart2->GetBufferPointer());
+
+  CComPtr<hlsl::AbstractMemoryStream> pContainerStream;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pContainerStream));
+  VERIFY_SUCCEEDED(reader.WriteContainer(a2, pContainerStream));
+  VERIFY_ARE_EQUAL(pProgramA->GetBufferSize(), pContainerStream->GetPtrSize());
+  VERIFY_ARE_EQUAL(0, memcmp(pProgramA->GetBufferPointer(),
+                             pContainerStream->GetPtr(),
+                             pProgramA->GetBufferSize()));
+}
+
+TEST_F(DxilContainerTest, MemoryStreamWhenLargeThenContentsKeptInOrder) {
+  CComPtr<IMalloc> pMalloc;
+  VERIFY_SUCCEEDED(CoGetMalloc(1, &pMalloc));
+  CComPtr<hlsl::AbstractMemoryStream> pStream;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pStream));
+
+  // Write well past the size where appends stop growing the buffer.
+  std::vector<uint32_t> values(3 * 1024 * 1024 / sizeof(uint32_t) + 7);
+  for (size_t i = 0; i < values.size(); ++i)
+    values[i] = (uint32_t)i;
+  ULONG cbWritten;
+  for (size_t i = 0; i < values.size(); i += 1000) {
+    ULONG count = (ULONG)std::min<size_t>(1000, values.size() - i);
+    VERIFY_SUCCEEDED(pStream->Write(&values[i], count * sizeof(uint32_t),
+                                    &cbWritten));
+  }
+  const ULONG size = (ULONG)(values.size() * sizeof(uint32_t));
+  VERIFY_ARE_EQUAL(size, pStream->GetPtrSize());
+  VERIFY_ARE_EQUAL((UINT64)size, pStream->GetPosition());
+
+  // Copying out doesn't need the contents in one piece.
+  CComPtr<hlsl::AbstractMemoryStream> pCopy;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pCopy));
+  VERIFY_SUCCEEDED(hlsl::CopyMemoryStreamTo(pStream, pCopy));
+  VERIFY_ARE_EQUAL((UINT64)size, pStream->GetPosition());
+  VERIFY_ARE_EQUAL(size, pCopy->GetPtrSize());
+
+  VERIFY_ARE_EQUAL(0, memcmp(values.data(), pStream->GetPtr(), size));
+  VERIFY_ARE_EQUAL(0, memcmp(values.data(), pCopy->GetPtr(), size));
+
+  // Appending after the contents were joined adds to the end.
+  uint32_t last = 0xFFFFFFFF;
+  VERIFY_SUCCEEDED(pStream->Write(&last, sizeof(last), &cbWritten));
+  CComPtr<IDxcBlob> pBlob;
+  VERIFY_SUCCEEDED(pStream.QueryInterface(&pBlob));
+  VERIFY_ARE_EQUAL(size + sizeof(last), pBlob->GetBufferSize());
+  const uint32_t *pValues = (const uint32_t *)pBlob->GetBufferPointer();
+  VERIFY_ARE_EQUAL(0, memcmp(values.data(), pValues, size));
+  VERIFY_ARE_EQUAL(last, pValues[values.size()]);
+}
+
 TEST_F(DxilContainerTest, CompileWhenOKThenIncludesSignatures) {
   char program[] =
     "struct PSInput {\r\n"
@@ -844,6 +1007,63 @@ TEST_F(DxilContainerTest, CompileAS_CheckPSV0) {
   VERIFY_IS_TRUE(blobFound);
 }
 
+TEST_F(DxilContainerTest, CompileWhenUnvalidatedThenRDATNameIndexFindsExports) {
+  if (m_ver.SkipDxilVersion(1, 3)) return;
+  const char *shader =
+    "RWByteAddressBuffer b_buf;"
+    "Texture1D<float4> tex : register(t0);"
+    "GlobalRootSignature grs = { \"CBV(b0)\" };"
+    "export float function0(float x) { return x + tex[0].x; }"
+    "export void function1(int i) { b_buf.Store(i, i); }"
+    "export float function2(float x) { return x * 2; }";
+
+  // Validated and unvalidated RDAT must answer lookups the same way; only
+  // the unvalidated one carries the name index.
+  LPCWSTR unvalidated[] = { L"-Vd", L"-validator-version", L"0.0" };
+  struct { LPCWSTR *pArgs; UINT32 argCount; } configs[] = {
+    { nullptr, 0 },
+    { unvalidated, _countof(unvalidated) },
+  };
+  for (auto &config : configs) {
+    CComPtr<IDxcBlob> pProgram;
+    CompileToProgram(shader, L"", L"lib_6_3", config.pArgs, config.argCount,
+                     &pProgram);
+    CComPtr<IDxcContainerReflection> containerReflection;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection,
+                                                 &containerReflection));
+    VERIFY_SUCCEEDED(containerReflection->Load(pProgram));
+    UINT32 index;
+    VERIFY_SUCCEEDED(containerReflection->FindFirstPartKind(
+        hlsl::DFCC_RuntimeData, &index));
+    CComPtr<IDxcBlob> pBlob;
+    VERIFY_SUCCEEDED(containerReflection->GetPartContent(index, &pBlob));
+
+    using namespace hlsl::RDAT;
+    DxilRuntimeData context;
+    VERIFY_IS_TRUE(context.InitFromRDAT(pBlob->GetBufferPointer(),
+                                        pBlob->GetBufferSize()));
+    FunctionTableReader *funcTableReader = context.GetFunctionTableReader();
+    for (uint32_t j = 0; j < funcTableReader->GetNumFunctions(); ++j) {
+      const char *name = funcTableReader->GetItem(j).GetName();
+      VERIFY_ARE_EQUAL(j, funcTableReader->FindFunction(name));
+    }
+    VERIFY_ARE_EQUAL(RDAT_NAME_INDEX_EMPTY,
+                     funcTableReader->FindFunction("function3"));
+
+    ResourceTableReader *resTableReader = context.GetResourceTableReader();
+    uint32_t res = resTableReader->FindResource("b_buf");
+    VERIFY_ARE_NOT_EQUAL(RDAT_NAME_INDEX_EMPTY, res);
+    VERIFY_ARE_EQUAL_STR("b_buf", resTableReader->GetItem(res).GetName());
+
+    SubobjectTableReader *subobjectTableReader =
+        context.GetSubobjectTableReader();
+    uint32_t subobject = subobjectTableReader->FindSubobject("grs");
+    VERIFY_ARE_NOT_EQUAL(RDAT_NAME_INDEX_EMPTY, subobject);
+    VERIFY_ARE_EQUAL_STR("grs",
+                         subobjectTableReader->GetItem(subobject).GetName());
+  }
+}
+
 TEST_F(DxilContainerTest, CompileWhenOkThenCheckRDAT) {
   if (m_ver.SkipDxilVersion(1, 3)) return;
   const char *shader = "float c_buf;"
@@ -969,6 +1189,15 @@ TEST_F(DxilContainerTest, CompileWhenOkThenCheckRDAT) {
       VERIFY_IS_TRUE(pReflection->InitFromRDAT(pBlob->GetBufferPointer(), pBlob->GetBufferSize()));
       DxilLibraryDesc lib_reflection = pReflection->GetLibraryReflection();
       VERIFY_ARE_EQUAL(lib_reflection.NumFunctions, 4);
+      // Names read through the tables convert to the strings the
+      // descriptions point to.
+      FunctionTableReader *pViewFunctions =
+          pReflection->GetRuntimeData()->GetFunctionTableReader();
+      VERIFY_ARE_EQUAL(pViewFunctions->GetNumFunctions(), lib_reflection.NumFunctions);
+      for (uint32_t j = 0; j < lib_reflection.NumFunctions; ++j) {
+        LPCWSTR viewName = pReflection->GetWideString(pViewFunctions->GetItem(j).GetName());
+        VERIFY_ARE_EQUAL(viewName, lib_reflection.pFunction[j].Name);
+      }
       for (uint32_t j = 0; j < 3; ++j) {
         DxilFunctionDesc function = lib_reflection.pFunction[j];
         std::string cur_str = str;
@@ -1867,6 +2096,103 @@ TEST_F(DxilContainerTest, ReflectionMatchesDXBC_Full) {
     }
   }
 }
+
+TEST_F(DxilContainerTest, ReflectionWhenCacheEnabledThenSecondLoadHits) {
+  // The cache is keyed by the shader hash part.
+  if (!DoesValidatorSupportShaderHash()) return;
+
+  const char *shader =
+    "struct Light { float3 dir; float intensity; };"
+    "cbuffer Frame : register(b0) { float4x4 viewProj; Light lights[2]; };"
+    "StructuredBuffer<Light> extraLights : register(t1);"
+    "Texture2D<float4> tex : register(t0);"
+    "SamplerState samp : register(s0);"
+    "float4 main(float4 pos : POSITION, float2 uv : TEXCOORD0) : SV_Target {"
+    "  return mul(pos, viewProj) * lights[1].intensity +"
+    "         extraLights[0].intensity * tex.Sample(samp, uv);"
+    "}";
+  CComPtr<IDxcBlob> pProgram, pLibrary;
+  CompileToProgram(shader, L"main", L"ps_6_0", nullptr, 0, &pProgram);
+  CompileToProgram(Ref1_Shader, L"", L"lib_6_3", nullptr, 0, &pLibrary);
+
+  CComPtr<IDxcContainerReflection> pContainer;
+  CComPtr<IDxcContainerReflectionCache> pCache;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection, &pContainer));
+  VERIFY_SUCCEEDED(pContainer.QueryInterface(&pCache));
+  wchar_t TempPath[MAX_PATH];
+  VERIFY_WIN32_BOOL_SUCCEEDED(GetTempPathW(MAX_PATH, TempPath) != 0);
+  std::wstring CacheDir(TempPath);
+  CacheDir += L"dxc_reflection_cache_test";
+  VERIFY_SUCCEEDED(pCache->SetCacheDirectory(CacheDir.c_str()));
+  VERIFY_SUCCEEDED(pCache->Clear());
+
+  auto reflect = [&](IDxcBlob *pBlob, REFIID iid, void **ppReflection) {
+    UINT32 partIdx;
+    VERIFY_SUCCEEDED(pContainer->Load(pBlob));
+    VERIFY_SUCCEEDED(pContainer->FindFirstPartKind(hlsl::DFCC_DXIL, &partIdx));
+    VERIFY_SUCCEEDED(pContainer->GetPartReflection(partIdx, iid, ppReflection));
+  };
+  UINT32 hits, misses;
+
+  CComPtr<ID3D12ShaderReflection> pBase, pStored, pCached;
+  CreateReflectionFromBlob(pProgram, &pBase);
+  reflect(pProgram, IID_PPV_ARGS(&pStored));
+  reflect(pProgram, IID_PPV_ARGS(&pCached));
+  VERIFY_SUCCEEDED(pCache->GetStatistics(&hits, &misses));
+  VERIFY_ARE_EQUAL(1u, hits);
+  VERIFY_ARE_EQUAL(1u, misses);
+  CompareReflection(pCached, pBase);
+  D3D12_SHADER_DESC cachedDesc, baseDesc;
+  VERIFY_SUCCEEDED(pCached->GetDesc(&cachedDesc));
+  VERIFY_SUCCEEDED(pBase->GetDesc(&baseDesc));
+  VERIFY_ARE_EQUAL(cachedDesc.Version, baseDesc.Version);
+  VERIFY_ARE_EQUAL_STR(cachedDesc.Creator, baseDesc.Creator);
+  VERIFY_ARE_EQUAL(cachedDesc.InstructionCount, baseDesc.InstructionCount);
+  VERIFY_ARE_EQUAL(pCached->GetRequiresFlags(), pBase->GetRequiresFlags());
+  VERIFY_ARE_EQUAL(pCached->GetGSInputPrimitive(), pBase->GetGSInputPrimitive());
+
+  CComPtr<ID3D12LibraryReflection> pBaseLib, pStoredLib, pCachedLib;
+  VERIFY_SUCCEEDED(pCache->SetCacheDirectory(nullptr));
+  reflect(pLibrary, IID_PPV_ARGS(&pBaseLib));
+  VERIFY_SUCCEEDED(pCache->SetCacheDirectory(CacheDir.c_str()));
+  reflect(pLibrary, IID_PPV_ARGS(&pStoredLib));
+  reflect(pLibrary, IID_PPV_ARGS(&pCachedLib));
+  VERIFY_SUCCEEDED(pCache->GetStatistics(&hits, &misses));
+  VERIFY_ARE_EQUAL(2u, hits);
+  VERIFY_ARE_EQUAL(2u, misses);
+  D3D12_LIBRARY_DESC cachedLibDesc, baseLibDesc;
+  VERIFY_SUCCEEDED(pCachedLib->GetDesc(&cachedLibDesc));
+  VERIFY_SUCCEEDED(pBaseLib->GetDesc(&baseLibDesc));
+  VERIFY_ARE_EQUAL(cachedLibDesc.FunctionCount, baseLibDesc.FunctionCount);
+  for (INT iFn = 0; iFn < (INT)baseLibDesc.FunctionCount; ++iFn) {
+    ID3D12FunctionReflection *pCachedFn = pCachedLib->GetFunctionByIndex(iFn);
+    ID3D12FunctionReflection *pBaseFn = pBaseLib->GetFunctionByIndex(iFn);
+    D3D12_FUNCTION_DESC cachedFnDesc, baseFnDesc;
+    VERIFY_SUCCEEDED(pCachedFn->GetDesc(&cachedFnDesc));
+    VERIFY_SUCCEEDED(pBaseFn->GetDesc(&baseFnDesc));
+    VERIFY_ARE_EQUAL_STR(cachedFnDesc.Name, baseFnDesc.Name);
+    VERIFY_ARE_EQUAL(cachedFnDesc.Version, baseFnDesc.Version);
+    VERIFY_ARE_EQUAL(cachedFnDesc.ConstantBuffers, baseFnDesc.ConstantBuffers);
+    VERIFY_ARE_EQUAL(cachedFnDesc.BoundResources, baseFnDesc.BoundResources);
+    for (UINT iRes = 0; iRes < baseFnDesc.BoundResources; ++iRes) {
+      D3D12_SHADER_INPUT_BIND_DESC cachedRes, baseRes;
+      VERIFY_SUCCEEDED(pCachedFn->GetResourceBindingDesc(iRes, &cachedRes));
+      VERIFY_SUCCEEDED(pBaseFn->GetResourceBindingDesc(iRes, &baseRes));
+      CompareShaderInputBindDesc(&cachedRes, &baseRes);
+    }
+    for (UINT iCB = 0; iCB < baseFnDesc.ConstantBuffers; ++iCB) {
+      D3D12_SHADER_BUFFER_DESC cachedCB, baseCB;
+      VERIFY_SUCCEEDED(pCachedFn->GetConstantBufferByIndex(iCB)->GetDesc(&cachedCB));
+      VERIFY_SUCCEEDED(pBaseFn->GetConstantBufferByIndex(iCB)->GetDesc(&baseCB));
+      VERIFY_ARE_EQUAL_STR(cachedCB.Name, baseCB.Name);
+      VERIFY_ARE_EQUAL(cachedCB.Variables, baseCB.Variables);
+      VERIFY_ARE_EQUAL(cachedCB.Size, baseCB.Size);
+    }
+  }
+
+  VERIFY_SUCCEEDED(pCache->Clear());
+  VERIFY_SUCCEEDED(pCache->SetCacheDirectory(nullptr));
+}
 #endif // _WIN32 - Reflection unsupported
 
 TEST_F(DxilContainerTest, ValidateFromLL_Abs2) {
@@ -18,6 +18,8 @@
 #include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilEntryProps.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/FileSystem.h"
@@ -26,6 +28,9 @@
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+
+#include <chrono>
 
 using namespace hlsl;
 using namespace llvm;
@@ -71,6 +76,10 @@ public:
 
   TEST_METHOD(PayloadQualifier)
 
+  TEST_METHOD(OpFuncCacheLookup)
+  TEST_METHOD(EntryPropsLookup)
+  TEST_METHOD(FieldAnnotationPath)
+
   void VerifyValidatorVersionFails(
     LPCWSTR shaderModel, const std::vector<LPCWSTR> &arguments,
     const std::vector<LPCSTR> &expectedErrors);
@@ -620,4 +629,155 @@ TEST_F(DxilModuleTest, PayloadQualifier) {
                            DXIL::PayloadAccessShaderStage::Anyhit));
     }
   }
-}
\ No newline at end of file
+}
+
+// Stresses the DXIL operation function cache the way lowering, validation
+// and linking do: the same few overloads are looked up over and over.
+TEST_F(DxilModuleTest, OpFuncCacheLookup) {
+  LLVMContext Ctx;
+  Module M("OpFuncCacheLookup", Ctx);
+  OP hlslOP(Ctx, &M);
+
+  Type *OverloadTypes[] = {
+    Type::getVoidTy(Ctx),   Type::getHalfTy(Ctx),  Type::getFloatTy(Ctx),
+    Type::getDoubleTy(Ctx), Type::getInt1Ty(Ctx),  Type::getInt8Ty(Ctx),
+    Type::getInt16Ty(Ctx),  Type::getInt32Ty(Ctx), Type::getInt64Ty(Ctx)
+  };
+
+  // Create every legal scalar overload once.
+  std::vector<std::pair<OP::OpCode, Type *>> Overloads;
+  std::vector<Function *> Funcs;
+  for (unsigned i = 0; i < (unsigned)OP::OpCode::NumOpCodes; ++i) {
+    OP::OpCode Opcode = (OP::OpCode)i;
+    for (Type *Ty : OverloadTypes) {
+      if (!OP::IsOverloadLegal(Opcode, Ty))
+        continue;
+      Overloads.emplace_back(Opcode, Ty);
+      Funcs.emplace_back(hlslOP.GetOpFunc(Opcode, Ty));
+    }
+  }
+  VERIFY_IS_FALSE(Overloads.empty());
+
+  const unsigned Iterations = 2000;
+  auto Start = std::chrono::steady_clock::now();
+  for (unsigned Iter = 0; Iter < Iterations; ++Iter) {
+    for (size_t i = 0; i < Overloads.size(); ++i) {
+      Function *F = hlslOP.GetOpFunc(Overloads[i].first, Overloads[i].second);
+      if (F != Funcs[i])
+        VERIFY_ARE_EQUAL(Funcs[i], F);
+    }
+  }
+  auto Dur = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - Start);
+  hlsl_test::LogCommentFmt(L"%u lookups of %u overloads took %u us",
+                           (unsigned)(Iterations * Overloads.size()),
+                           (unsigned)Overloads.size(), (unsigned)Dur.count());
+
+  // Removing a function drops it from the cache, so it is created again.
+  OP::OpCode Opcode = Overloads.front().first;
+  Type *Ty = Overloads.front().second;
+  Function *F = hlslOP.GetOpFunc(Opcode, Ty);
+  hlslOP.RemoveFunction(F);
+  F->eraseFromParent();
+  F = hlslOP.GetOpFunc(Opcode, Ty);
+  VERIFY_ARE_EQUAL(F, M.getFunction(F->getName()));
+  VERIFY_ARE_EQUAL(F, hlslOP.GetOpFunc(Opcode, Ty));
+}
+
+TEST_F(DxilModuleTest, EntryPropsLookup) {
+  LLVMContext Ctx;
+  Module M("EntryPropsLookup", Ctx);
+  DxilModule &DM = M.GetOrCreateDxilModule();
+  DM.SetShaderModel(ShaderModel::Get(ShaderModel::Kind::Library, 6, 3));
+
+  // A library with many functions, one in four of them a compute entry.
+  const unsigned NumFuncs = 4096;
+  FunctionType *FT = FunctionType::get(Type::getVoidTy(Ctx), false);
+  std::vector<Function *> Funcs;
+  DxilEntryPropsMap PropsMap;
+  for (unsigned i = 0; i < NumFuncs; ++i) {
+    Function *F = Function::Create(FT, GlobalValue::ExternalLinkage,
+                                   "f" + Twine(i), &M);
+    Funcs.emplace_back(F);
+    if (i % 4)
+      continue;
+    DxilFunctionProps Props;
+    Props.shaderKind = DXIL::ShaderKind::Compute;
+    Props.ShaderProps.CS.numThreads[0] = 1;
+    Props.ShaderProps.CS.numThreads[1] = 1;
+    Props.ShaderProps.CS.numThreads[2] = 1;
+    PropsMap[F] = llvm::make_unique<DxilEntryProps>(Props, true);
+  }
+  DM.ResetEntryPropsMap(std::move(PropsMap));
+
+  const unsigned Iterations = 200;
+  unsigned Entries = 0;
+  auto Start = std::chrono::steady_clock::now();
+  for (unsigned Iter = 0; Iter < Iterations; ++Iter) {
+    for (Function *F : Funcs) {
+      if (DM.IsEntry(F) && DM.IsComputeShader(F) &&
+          DM.GetDxilEntryProps(F).props.ShaderProps.CS.numThreads[0] == 1)
+        ++Entries;
+    }
+  }
+  auto Dur = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - Start);
+  hlsl_test::LogCommentFmt(L"%u entry prop lookups over %u functions took %u us",
+                           Iterations * NumFuncs, NumFuncs,
+                           (unsigned)Dur.count());
+  VERIFY_ARE_EQUAL(Iterations * NumFuncs / 4, Entries);
+
+  // Moving and removing entries keeps the other lookups intact.
+  Function *NewF = Function::Create(FT, GlobalValue::ExternalLinkage, "g", &M);
+  DM.ReplaceDxilEntryProps(Funcs[0], NewF);
+  VERIFY_IS_FALSE(DM.HasDxilEntryProps(Funcs[0]));
+  VERIFY_IS_TRUE(DM.IsComputeShader(NewF));
+  DM.RemoveFunction(Funcs[4]);
+  VERIFY_IS_FALSE(DM.HasDxilEntryProps(Funcs[4]));
+  VERIFY_IS_TRUE(DM.HasDxilEntryProps(Funcs[8]));
+  VERIFY_IS_FALSE(DM.IsEntry(Funcs[1]));
+}
+
+TEST_F(DxilModuleTest, FieldAnnotationPath) {
+  LLVMContext Ctx;
+  Module M("FieldAnnotationPath", Ctx);
+  DxilTypeSystem TypeSys(&M);
+
+  // struct Inner { float4 v; float f[4]; };
+  // struct Outer { Inner in[2]; int i; };
+  Type *F32 = Type::getFloatTy(Ctx);
+  StructType *Inner = StructType::create(
+      {VectorType::get(F32, 4), ArrayType::get(F32, 4)}, "Inner");
+  StructType *Outer = StructType::create(
+      {ArrayType::get(Inner, 2), Type::getInt32Ty(Ctx)}, "Outer");
+
+  DxilStructAnnotation *OuterSA = TypeSys.AddStructAnnotation(Outer);
+  OuterSA->GetFieldAnnotation(0).SetFieldName("in");
+  OuterSA->GetFieldAnnotation(1).SetFieldName("i");
+  unsigned InnerV[] = {0, 1, 0};
+  // Inner has no annotation yet, so the path stops at Outer.in.
+  VERIFY_ARE_EQUAL(&OuterSA->GetFieldAnnotation(0),
+                   TypeSys.GetFieldAnnotation(Outer, InnerV));
+
+  DxilStructAnnotation *InnerSA = TypeSys.AddStructAnnotation(Inner);
+  InnerSA->GetFieldAnnotation(0).SetFieldName("v");
+  InnerSA->GetFieldAnnotation(1).SetFieldName("f");
+  VERIFY_ARE_EQUAL(&InnerSA->GetFieldAnnotation(0),
+                   TypeSys.GetFieldAnnotation(Outer, InnerV));
+
+  // Array and vector indices step into the field holding them.
+  unsigned InnerF[] = {0, 1, 1, 3};
+  unsigned OuterI[] = {1};
+  for (unsigned Iter = 0; Iter < 2; ++Iter) {
+    VERIFY_ARE_EQUAL(&InnerSA->GetFieldAnnotation(1),
+                     TypeSys.GetFieldAnnotation(Outer, InnerF));
+    VERIFY_ARE_EQUAL(&OuterSA->GetFieldAnnotation(1),
+                     TypeSys.GetFieldAnnotation(Outer, OuterI));
+  }
+  VERIFY_IS_NULL(TypeSys.GetFieldAnnotation(Outer, {}));
+
+  // Erasing an annotation drops the paths resolved through it.
+  TypeSys.EraseStructAnnotation(Inner);
+  VERIFY_ARE_EQUAL(&OuterSA->GetFieldAnnotation(0),
+                   TypeSys.GetFieldAnnotation(Outer, InnerF));
+}
@@ -21,6 +21,7 @@
 #include <map>
 #include <unordered_set>
 #include <strstream>
+#include <sstream>
 #include <iomanip>
 #include "dxc/Test/CompilationResult.h"
 #include "dxc/Test/HLSLTestData.h"
@@ -300,6 +301,10 @@ public:
   TEST_METHOD(BasicShaderModel61);
   TEST_METHOD(BasicShaderModel63);
 
+  BEGIN_TEST_METHOD(ExecutionPerfTest)
+    TEST_METHOD_PROPERTY(L"Priority", L"2")
+  END_TEST_METHOD()
+
   BEGIN_TEST_METHOD(WaveIntrinsicsActiveIntTest)
     TEST_METHOD_PROPERTY(L"DataSource", L"Table:ShaderOpArithTable.xml#WaveIntrinsicsActiveIntTable")
   END_TEST_METHOD()
@@ -2867,6 +2872,68 @@ struct SPrimitives {
   float f_float2_o;
 };
 
+// Counts the DXIL operations, branches and 16-bit values in the disassembly
+// of the shaders of pResult, as the patterns that unrolling, load coalescing
+// and 16-bit packing change, and logs them with the GPU time of the run.
+// Shaders that aren't DXIL, as with DXBC=true, only get the time logged.
+static void LogShaderOpPerf(dxc::DxcDllSupport &support,
+                            ShaderOpTestResult *pResult) {
+  st::ShaderOp *pShaderOp = pResult->ShaderOp;
+  double micros;
+  if (pResult->Test->GetShaderTime(&micros))
+    LogCommentFmt(L"perf: %S gpu_us=%.3f", pShaderOp->Name, micros);
+  else
+    LogCommentFmt(L"perf: %S gpu_us=n/a", pShaderOp->Name);
+
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcLibrary> pLibrary;
+  if (FAILED(support.CreateInstance(CLSID_DxcCompiler, &pCompiler)) ||
+      FAILED(support.CreateInstance(CLSID_DxcLibrary, &pLibrary)))
+    return;
+  LPCSTR shaderNames[] = {pShaderOp->CS, pShaderOp->AS, pShaderOp->MS,
+                          pShaderOp->VS, pShaderOp->HS, pShaderOp->DS,
+                          pShaderOp->GS, pShaderOp->PS};
+  for (LPCSTR pShaderName : shaderNames) {
+    ID3D10Blob *pShader = pResult->Test->GetShaderBlob(pShaderName);
+    if (pShader == nullptr)
+      continue;
+    CComPtr<IDxcBlobEncoding> pShaderBlob;
+    CComPtr<IDxcBlobEncoding> pDisassembly;
+    if (FAILED(pLibrary->CreateBlobWithEncodingFromPinned(
+            pShader->GetBufferPointer(), (UINT32)pShader->GetBufferSize(),
+            CP_ACP, &pShaderBlob)) ||
+        FAILED(pCompiler->Disassemble(pShaderBlob, &pDisassembly)))
+      continue;
+
+    std::string text((const char *)pDisassembly->GetBufferPointer(),
+                     pDisassembly->GetBufferSize());
+    std::map<std::string, unsigned> opCounts;
+    unsigned branches = 0, values16 = 0;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+      if (line.find(" br ") != std::string::npos)
+        ++branches;
+      if (line.find(" = ") != std::string::npos &&
+          (line.find(" half") != std::string::npos ||
+           line.find(" i16") != std::string::npos))
+        ++values16;
+      size_t op = line.find("@dx.op.");
+      if (op == std::string::npos || line.find("call ") == std::string::npos)
+        continue;
+      op += strlen("@dx.op.");
+      ++opCounts[line.substr(op, line.find_first_of(".(", op) - op)];
+    }
+
+    std::wstringstream report;
+    report << L"perf: " << pShaderOp->Name << L" " << pShaderName
+           << L" branches=" << branches << L" values16=" << values16;
+    for (auto &opCount : opCounts)
+      report << L" " << opCount.first.c_str() << L"=" << opCount.second;
+    LogCommentFmt(L"%s", report.str().c_str());
+  }
+}
+
 std::shared_ptr<ShaderOpTestResult>
 RunShaderOpTestAfterParse(ID3D12Device *pDevice, dxc::DxcDllSupport &support,
                           LPCSTR pName,
@@ -2910,6 +2977,9 @@ RunShaderOpTestAfterParse(ID3D12Device *pDevice, dxc::DxcDllSupport &support,
   result->ShaderOpSet = ShaderOpSet;
   result->Test = test;
   result->ShaderOp = pShaderOp;
+  // ExecPerf=true reports the GPU time and code patterns of every test.
+  if (GetTestParamBool(L"ExecPerf"))
+    LogShaderOpPerf(support, result.get());
   return result;
 }
 
@@ -2924,6 +2994,37 @@ RunShaderOpTest(ID3D12Device *pDevice, dxc::DxcDllSupport &support,
   return RunShaderOpTestAfterParse(pDevice, support, pName, pInitCallback, ShaderOpSet);
 }
 
+// Runs the shader ops named by the ExecPerfShaderOps parameter, separated by
+// semicolons, and reports the GPU time and code patterns of each, so that
+// builds of the compiler can be compared on real hardware.
+TEST_F(ExecutionTest, ExecutionPerfTest) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  CComPtr<ID3D12Device> pDevice;
+  if (!CreateDevice(&pDevice))
+    return;
+
+  WEX::Common::String shaderOpsParam;
+  std::string shaderOps = "ExecPerfLoop;WriteFloat4";
+  if (SUCCEEDED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"ExecPerfShaderOps", shaderOpsParam)) &&
+      !shaderOpsParam.IsEmpty())
+    shaderOps = CW2A((LPCWSTR)shaderOpsParam);
+
+  std::istringstream names(shaderOps);
+  std::string name;
+  while (std::getline(names, name, ';')) {
+    if (name.empty())
+      continue;
+    CComPtr<IStream> pStream;
+    ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
+    std::shared_ptr<ShaderOpTestResult> test =
+        RunShaderOpTest(pDevice, m_support, pStream, name.c_str(), nullptr);
+    // Already logged by RunShaderOpTestAfterParse.
+    if (!GetTestParamBool(L"ExecPerf"))
+      LogShaderOpPerf(m_support, test.get());
+  }
+}
+
 TEST_F(ExecutionTest, OutOfBoundsTest) {
   WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
   CComPtr<IStream> pStream;
@@ -518,6 +518,7 @@ public:
   dxc::DxcDllSupport m_dllSupport;
 
   TEST_METHOD(DefineWhenRegisteredThenPreserved)
+  TEST_METHOD(DefineWhenSeveralPatternsRegisteredThenMatched)
   TEST_METHOD(DefineValidationError)
   TEST_METHOD(DefineValidationWarning)
   TEST_METHOD(DefineNoValidatorOk)
@@ -594,6 +595,46 @@ TEST_F(ExtensionTest, DefineWhenRegisteredThenPreserved) {
     disassembly.find("!{!\"FOOBAR\""));
 }
 
+TEST_F(ExtensionTest, DefineWhenSeveralPatternsRegisteredThenMatched) {
+  Compiler c(m_dllSupport);
+  c.RegisterSemanticDefine(L"FOO_*");
+  c.RegisterSemanticDefine(L"BAR");
+  c.RegisterSemanticDefineExclusion(L"FOO_SKIP*");
+  c.SetSemanticDefineMetaDataName("test.defs");
+  c.Compile(
+    "#define FOO_X 1\n"
+    "#define FOO_SKIPME 2\n"
+    "#define BAR 3\n"
+    "#define BARN 4\n"
+    "#define FOO 5\n"
+    "float4 main() : SV_Target {\n"
+    "  return 0;\n"
+    "}\n",
+    {L"/Vd"},
+    {}
+  );
+  std::string disassembly = c.Disassemble();
+  // Prefix and exact patterns match.
+  VERIFY_IS_TRUE(
+    disassembly.npos !=
+    disassembly.find("!{!\"FOO_X\", !\"1\"}"));
+  VERIFY_IS_TRUE(
+    disassembly.npos !=
+    disassembly.find("!{!\"BAR\", !\"3\"}"));
+  // Exclusions win over a matching pattern.
+  VERIFY_IS_TRUE(
+    disassembly.npos ==
+    disassembly.find("!{!\"FOO_SKIPME\""));
+  // An exact pattern does not match longer names, and a prefix pattern does
+  // not match names shorter than its prefix.
+  VERIFY_IS_TRUE(
+    disassembly.npos ==
+    disassembly.find("!{!\"BARN\""));
+  VERIFY_IS_TRUE(
+    disassembly.npos ==
+    disassembly.find("!{!\"FOO\""));
+}
+
 TEST_F(ExtensionTest, DefineValidationError) {
   Compiler c(m_dllSupport);
   c.RegisterSemanticDefine(L"FOO*");
@@ -37,7 +37,10 @@ namespace testOptions {
     ARGOP(ExperimentalShaders)\
     ARGOP(DebugLayer)\
     ARGOP(SuitePath)\
-    ARGOP(InputFile)
+    ARGOP(InputFile)\
+    ARGOP(FileCheckThreads)\
+    ARGOP(FileCheckShardIndex)\
+    ARGOP(FileCheckShardCount)
 
 ARG_LIST(ARG_DECLARE)
 
@@ -8,6 +8,7 @@
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
@@ -23,11 +24,42 @@
 #include "dxc/Test/DxcTestUtils.h"
 #include "dxc/dxcapi.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/Support/microcom.h"
 
 using namespace std;
 using namespace hlsl;
 using namespace llvm;
 
+// Link cache storage that keeps containers in memory.
+class TestLinkCacheStorage : public IDxcLinkCacheStorage {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestLinkCacheStorage() : m_dwRef(0) {}
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcLinkCacheStorage>(this, iid, ppvObject);
+  }
+
+  std::map<std::string, CComPtr<IDxcBlob>> Entries;
+  UINT32 StoreCount = 0;
+
+  HRESULT STDMETHODCALLTYPE Lookup(const BYTE *pKey,
+                                   IDxcBlob **ppContainer) override {
+    auto it = Entries.find(std::string((const char *)pKey, DxcLinkCacheKeySize));
+    if (it == Entries.end()) {
+      *ppContainer = nullptr;
+      return S_FALSE;
+    }
+    return it->second.CopyTo(ppContainer);
+  }
+  HRESULT STDMETHODCALLTYPE Store(const BYTE *pKey,
+                                  IDxcBlob *pContainer) override {
+    ++StoreCount;
+    Entries[std::string((const char *)pKey, DxcLinkCacheKeySize)] = pContainer;
+    return S_OK;
+  }
+};
+
 // The test fixture.
 class LinkerTest
 {
@@ -42,6 +74,8 @@ public:
   TEST_METHOD(RunLinkResource);
   TEST_METHOD(RunLinkResourceWithBinding);
   TEST_METHOD(RunLinkAllProfiles);
+  TEST_METHOD(RunLinkManyMatchesLink);
+  TEST_METHOD(RunLinkManyIsDeterministic);
   TEST_METHOD(RunLinkFailNoDefine);
   TEST_METHOD(RunLinkFailReDefine);
   TEST_METHOD(RunLinkGlobalInit);
@@ -53,6 +87,7 @@ public:
   TEST_METHOD(RunLinkToLib);
   TEST_METHOD(RunLinkToLibExport);
   TEST_METHOD(RunLinkToLibExportShadersOnly);
+  TEST_METHOD(RunLinkToLibRepeated);
   TEST_METHOD(RunLinkFailReDefineGlobal);
   TEST_METHOD(RunLinkFailProfileMismatch);
   TEST_METHOD(RunLinkFailEntryNoProps);
@@ -67,6 +102,11 @@ public:
   TEST_METHOD(RunLinkWithValidatorVersion);
   TEST_METHOD(RunLinkWithTempReg);
   TEST_METHOD(RunLinkToLibWithGlobalCtor);
+  TEST_METHOD(RunLinkPreparedLibraries);
+  TEST_METHOD(RunLinkCompressedLibraries);
+  TEST_METHOD(RunLinkToLibMergesIdenticalFunctions);
+  TEST_METHOD(RunLinkWithLinkTimeOptimization);
+  TEST_METHOD(RunLinkWithCacheStorage);
   TEST_METHOD(LinkSm63ToSm66);
   TEST_METHOD(RunLinkWithRootSig);
 
@@ -272,6 +312,120 @@ TEST_F(LinkerTest, RunLinkAllProfiles) {
   Link(L"cs_main", L"cs_6_0", pLinker, {libName, libResName}, {},{});
 }
 
+TEST_F(LinkerTest, RunLinkManyMatchesLink) {
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  CComPtr<IDxcLinker2> pLinker2;
+  VERIFY_SUCCEEDED(pLinker.QueryInterface(&pLinker2));
+
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib);
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib);
+  LPCWSTR libNames[] = { L"entry", L"res" };
+  RegisterDxcModule(libNames[0], pEntryLib, pLinker);
+  RegisterDxcModule(libNames[1], pResLib, pLinker);
+
+  // Requests outnumber the threads, so some threads link several. The
+  // missing entry fails in its own result only.
+  DxcLinkRequest requests[] = {
+    { L"vs_main", L"vs_6_0" }, { L"hs_main", L"hs_6_0" },
+    { L"ds_main", L"ds_6_0" }, { L"gs_main", L"gs_6_0" },
+    { L"ps_main", L"ps_6_0" }, { L"cs_main", L"cs_6_0" },
+    { L"no_such_entry", L"ps_6_0" },
+  };
+  const UINT32 requestCount = _countof(requests);
+  IDxcOperationResult *pResults[_countof(requests)];
+  VERIFY_SUCCEEDED(pLinker2->LinkMany(requests, requestCount, libNames,
+                                      _countof(libNames), nullptr, 0, 3,
+                                      pResults));
+  std::vector<CComPtr<IDxcOperationResult>> results(requestCount);
+  for (UINT32 i = 0; i < requestCount; ++i)
+    results[i].Attach(pResults[i]);
+
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  auto disassemble = [&](IDxcOperationResult *pResult) {
+    CComPtr<IDxcBlob> pProgram;
+    CheckOperationSucceeded(pResult, &pProgram);
+    CComPtr<IDxcBlobEncoding> pDisassembly;
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pDisassembly));
+    return BlobToUtf8(pDisassembly);
+  };
+  for (UINT32 i = 0; i + 1 < requestCount; ++i) {
+    CComPtr<IDxcOperationResult> pSingle;
+    VERIFY_SUCCEEDED(pLinker->Link(requests[i].pEntryName,
+                                   requests[i].pTargetProfile, libNames,
+                                   _countof(libNames), nullptr, 0, &pSingle));
+    VERIFY_ARE_EQUAL_STR(disassemble(pSingle).c_str(),
+                         disassemble(results[i]).c_str());
+  }
+  HRESULT status;
+  VERIFY_SUCCEEDED(results[requestCount - 1]->GetStatus(&status));
+  VERIFY_FAILED(status);
+}
+
+TEST_F(LinkerTest, RunLinkManyIsDeterministic) {
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  CComPtr<IDxcLinker2> pLinker2;
+  VERIFY_SUCCEEDED(pLinker.QueryInterface(&pLinker2));
+
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib);
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib);
+  LPCWSTR libNames[] = { L"entry", L"res" };
+  RegisterDxcModule(libNames[0], pEntryLib, pLinker);
+  RegisterDxcModule(libNames[1], pResLib, pLinker);
+
+  // Each request appears several times, so which linker gets a copy, and
+  // what that linker linked before, changes with the thread count and with
+  // scheduling. Every copy must still come out byte for byte the same.
+  const DxcLinkRequest uniqueRequests[] = {
+    { L"ps_main", L"ps_6_0" }, { L"", L"lib_6_3" },
+    { L"cs_main", L"cs_6_0" }, { L"hs_main", L"hs_6_0" },
+  };
+  const UINT32 uniqueCount = _countof(uniqueRequests);
+  const UINT32 repeatCount = 4;
+  std::vector<DxcLinkRequest> requests;
+  for (UINT32 i = 0; i < repeatCount; ++i)
+    requests.insert(requests.end(), uniqueRequests,
+                    uniqueRequests + uniqueCount);
+  const UINT32 requestCount = (UINT32)requests.size();
+
+  std::vector<std::string> expected(uniqueCount);
+  for (UINT32 threadCount : { 1, 2, 4, 8 }) {
+    std::vector<IDxcOperationResult *> pResults(requestCount);
+    VERIFY_SUCCEEDED(pLinker2->LinkMany(requests.data(), requestCount,
+                                        libNames, _countof(libNames), nullptr,
+                                        0, threadCount, pResults.data()));
+    for (UINT32 i = 0; i < requestCount; ++i) {
+      CComPtr<IDxcOperationResult> pResult;
+      pResult.Attach(pResults[i]);
+      CComPtr<IDxcBlob> pProgram;
+      CheckOperationSucceeded(pResult, &pProgram);
+      const hlsl::DxilContainerHeader *pHeader =
+          hlsl::IsDxilContainerLike(pProgram->GetBufferPointer(),
+                                    pProgram->GetBufferSize());
+      VERIFY_IS_NOT_NULL(pHeader);
+      std::string bytes((const char *)pProgram->GetBufferPointer(),
+                        pProgram->GetBufferSize());
+      std::string &first = expected[i % uniqueCount];
+      if (first.empty()) {
+        first = bytes;
+        continue;
+      }
+      const hlsl::DxilContainerHeader *pFirstHeader =
+          (const hlsl::DxilContainerHeader *)first.data();
+      VERIFY_IS_TRUE(0 == memcmp(pFirstHeader->Hash.Digest,
+                                 pHeader->Hash.Digest,
+                                 sizeof(pHeader->Hash.Digest)));
+      VERIFY_IS_TRUE(first == bytes);
+    }
+  }
+}
+
 TEST_F(LinkerTest, RunLinkFailNoDefine) {
   CComPtr<IDxcBlob> pEntryLib;
   CompileLib(L"..\\CodeGenHLSL\\lib_cs_entry.hlsl", &pEntryLib);
@@ -527,6 +681,35 @@ TEST_F(LinkerTest, RunLinkToLibExportShadersOnly) {
     {L"-export-shaders-only"});
 }
 
+TEST_F(LinkerTest, RunLinkToLibRepeated) {
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_mat_entry2.hlsl",
+             &pEntryLib);
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_mat_cast2.hlsl",
+             &pLib);
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"ps_main";
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  LPCWSTR libName2 = L"test";
+  RegisterDxcModule(libName2, pLib, pLinker);
+
+  // Links after the first find mat_test already validated; they must link
+  // just the same.
+  Link(L"", L"lib_6_3", pLinker, {libName, libName2},
+    { "@main", "@\"\\01?mat_test" }, {});
+  Link(L"", L"lib_6_3", pLinker, {libName, libName2},
+    { "@main", "@\"\\01?mat_test" }, {});
+  Link(L"", L"lib_6_3", pLinker, {libName, libName2},
+    { "@main" },
+    { "@\"\\01?mat_test" },
+    {L"-export-shaders-only"});
+}
+
 TEST_F(LinkerTest, RunLinkFailSelectRes) {
   if (m_ver.SkipDxilVersion(1, 3)) return;
   CComPtr<IDxcBlob> pEntryLib;
@@ -823,6 +1006,92 @@ TEST_F(LinkerTest, RunLinkToLibWithGlobalCtor) {
        {});
 }
 
+TEST_F(LinkerTest, RunLinkPreparedLibraries) {
+  CComPtr<IDxcBlob> pLib0;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_static_cb_init.hlsl", &pLib0, {});
+  CComPtr<IDxcBlob> pLib1;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_use_static_cb_init.hlsl", &pLib1,
+             {});
+
+  // Libraries prepared by one linker register with others, each of which
+  // links as if it had registered the containers itself.
+  CComPtr<IDxcLinker> pPreparer;
+  CreateLinker(&pPreparer);
+  CComPtr<IDxcLinker2> pPreparer2;
+  VERIFY_SUCCEEDED(pPreparer.QueryInterface(&pPreparer2));
+  CComPtr<IDxcLinkerLibrary> pPrepared0, pPrepared1;
+  VERIFY_SUCCEEDED(pPreparer2->PrepareLibrary(pLib0, &pPrepared0));
+  VERIFY_SUCCEEDED(pPreparer2->PrepareLibrary(pLib1, &pPrepared1));
+  CComPtr<IDxcBlob> pContainer;
+  VERIFY_SUCCEEDED(pPrepared0->GetContainer(&pContainer));
+  VERIFY_ARE_EQUAL(pLib0.p, pContainer.p);
+
+  LPCWSTR libName = L"foo";
+  LPCWSTR libName2 = L"bar";
+  for (unsigned i = 0; i < 2; ++i) {
+    CComPtr<IDxcLinker> pLinker;
+    CreateLinker(&pLinker);
+    CComPtr<IDxcLinker2> pLinker2;
+    VERIFY_SUCCEEDED(pLinker.QueryInterface(&pLinker2));
+    VERIFY_SUCCEEDED(pLinker2->RegisterPreparedLibrary(libName, pPrepared0));
+    VERIFY_SUCCEEDED(pLinker2->RegisterPreparedLibrary(libName2, pPrepared1));
+    VERIFY_FAILED(pLinker2->RegisterPreparedLibrary(libName, pPrepared1));
+    // Link twice, as usage given at registration is only built once.
+    for (unsigned j = 0; j < 2; ++j)
+      Link(L"", L"lib_6_3", pLinker, {libName, libName2},
+           {"@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ "
+            "i32, void ()*, i8* } { i32 65535, void ()* "
+            "@foo._GLOBAL__sub_I_lib_static_cb_init.hlsl, i8* null }]"},
+           {},
+           {});
+  }
+}
+
+TEST_F(LinkerTest, RunLinkCompressedLibraries) {
+  // Without -Vd, an external validator would have the bitcode left as is.
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib,
+             {L"-Qcompress_bitcode", L"-Vd"});
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_cs_entry.hlsl", &pEntryLib,
+             {L"-Qcompress_bitcode", L"-Vd", L"-Zi", L"-Qembed_debug"});
+
+  auto GetMagic = [](IDxcBlob *pBlob, hlsl::DxilFourCC fourCC) {
+    const hlsl::DxilPartHeader *pPart = hlsl::GetDxilPartByType(
+        (const hlsl::DxilContainerHeader *)pBlob->GetBufferPointer(), fourCC);
+    VERIFY_IS_NOT_NULL(pPart);
+    return ((const hlsl::DxilProgramHeader *)hlsl::GetDxilPartData(pPart))
+        ->BitcodeHeader.DxilMagic;
+  };
+  VERIFY_ARE_EQUAL(hlsl::DxilCompressedMagicValue,
+                   GetMagic(pResLib, hlsl::DFCC_DXIL));
+  VERIFY_ARE_EQUAL(hlsl::DxilCompressedMagicValue,
+                   GetMagic(pEntryLib, hlsl::DFCC_DXIL));
+  VERIFY_ARE_EQUAL(hlsl::DxilCompressedMagicValue,
+                   GetMagic(pEntryLib, hlsl::DFCC_ShaderDebugInfoDXIL));
+
+  // One library is registered and the other prepared, as each reads the
+  // program parts its own way.
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  CComPtr<IDxcLinker2> pLinker2;
+  VERIFY_SUCCEEDED(pLinker.QueryInterface(&pLinker2));
+  RegisterDxcModule(L"res", pResLib, pLinker);
+  CComPtr<IDxcLinkerLibrary> pPrepared;
+  VERIFY_SUCCEEDED(pLinker2->PrepareLibrary(pEntryLib, &pPrepared));
+  VERIFY_SUCCEEDED(pLinker2->RegisterPreparedLibrary(L"entry", pPrepared));
+
+  // The flag has no effect on a shader the runtime loads.
+  CComPtr<IDxcOperationResult> pResult;
+  LPCWSTR libNames[] = {L"res", L"entry"};
+  LPCWSTR args[] = {L"-Qcompress_bitcode"};
+  VERIFY_SUCCEEDED(pLinker->Link(L"entry", L"cs_6_0", libNames, 2, args, 1,
+                                 &pResult));
+  CComPtr<IDxcBlob> pShader;
+  CheckOperationSucceeded(pResult, &pShader);
+  VERIFY_ARE_EQUAL(hlsl::DxilMagicValue, GetMagic(pShader, hlsl::DFCC_DXIL));
+}
+
 TEST_F(LinkerTest, LinkSm63ToSm66) {
   if (m_ver.SkipDxilVersion(1, 6)) return;
   CComPtr<IDxcBlob> pLib0;
@@ -891,3 +1160,87 @@ TEST_F(LinkerTest, RunLinkWithRootSig) {
     VERIFY_IS_TRUE(pRS[i] == pLinkedRS[i]);
   }
 }
+
+TEST_F(LinkerTest, RunLinkToLibMergesIdenticalFunctions) {
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_merge_identical.hlsl", &pLib,
+             {}, L"lib_6_3");
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"lib";
+  RegisterDxcModule(libName, pLib, pLinker);
+
+  // Both exports stay, and both call the one helper left.
+  Link(L"", L"lib_6_3", pLinker, {libName},
+       {"@\"\\01?use_a@@YAMM@Z\"", "@\"\\01?use_b@@YAMM@Z\"",
+        "@\"\\01?scale_a@@YAMM@Z\""},
+       {"scale_b"});
+}
+
+TEST_F(LinkerTest, RunLinkWithLinkTimeOptimization) {
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_lto_entry.hlsl", &pEntryLib,
+             {}, L"lib_6_3");
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_lto_helper.hlsl", &pLib,
+             {}, L"lib_6_3");
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"entry";
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+  LPCWSTR libName2 = L"helper";
+  RegisterDxcModule(libName2, pLib, pLinker);
+
+  // Without -flto the helper's loop survives the link.
+  Link(L"main", L"ps_6_0", pLinker, {libName, libName2}, {"phi float"}, {});
+  // With it, the constant trip count from the entry library unrolls the loop.
+  Link(L"main", L"ps_6_0", pLinker, {libName, libName2}, {"fmul"},
+       {"phi float"}, {L"-flto", L"-O3"});
+}
+
+TEST_F(LinkerTest, RunLinkWithCacheStorage) {
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib);
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_cs_entry.hlsl", &pEntryLib);
+
+  CComPtr<TestLinkCacheStorage> pStorage = new TestLinkCacheStorage();
+  auto linkWithCache = [&](LPCWSTR pArg, IDxcBlob **ppProgram) {
+    // A fresh linker each time, so only the storage carries results over.
+    CComPtr<IDxcLinker> pLinker;
+    CreateLinker(&pLinker);
+    CComPtr<IDxcLinkerCache> pCache;
+    VERIFY_SUCCEEDED(pLinker.QueryInterface(&pCache));
+    VERIFY_SUCCEEDED(pCache->SetCacheStorage(pStorage));
+    RegisterDxcModule(L"entry", pEntryLib, pLinker);
+    RegisterDxcModule(L"res", pResLib, pLinker);
+
+    LPCWSTR libNames[] = { L"res", L"entry" };
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pLinker->Link(L"entry", L"cs_6_0", libNames,
+                                   _countof(libNames), pArg ? &pArg : nullptr,
+                                   pArg ? 1 : 0, &pResult));
+    CheckOperationSucceeded(pResult, ppProgram);
+    UINT32 hits, misses;
+    VERIFY_SUCCEEDED(pCache->GetStatistics(&hits, &misses));
+    return hits;
+  };
+
+  CComPtr<IDxcBlob> pFirst, pSecond, pOther;
+  VERIFY_ARE_EQUAL(0u, linkWithCache(nullptr, &pFirst));
+  VERIFY_ARE_EQUAL(1u, pStorage->StoreCount);
+  VERIFY_ARE_EQUAL(1u, linkWithCache(nullptr, &pSecond));
+  VERIFY_ARE_EQUAL(1u, pStorage->StoreCount);
+  VERIFY_ARE_EQUAL(pFirst->GetBufferSize(), pSecond->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pFirst->GetBufferPointer(),
+                             pSecond->GetBufferPointer(),
+                             pFirst->GetBufferSize()));
+
+  // Different arguments make a different key.
+  VERIFY_ARE_EQUAL(0u, linkWithCache(L"-Qstrip_debug", &pOther));
+  VERIFY_ARE_EQUAL(2u, pStorage->StoreCount);
+}
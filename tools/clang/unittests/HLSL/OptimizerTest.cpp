@@ -66,6 +66,7 @@ public:
   TEST_METHOD(OptimizerWhenSlice2ThenOK)
   TEST_METHOD(OptimizerWhenSlice3ThenOK)
   TEST_METHOD(OptimizerWhenSliceWithIntermediateOptionsThenOK)
+  TEST_METHOD(OptimizerWhenBatchThenMatchesSingleRuns)
 
   void OptimizerWhenSliceNThenOK(int optLevel);
   void OptimizerWhenSliceNThenOK(int optLevel, LPCSTR pText, LPCWSTR pTarget, llvm::ArrayRef<LPCWSTR> args = {});
@@ -120,6 +121,57 @@ TEST_F(OptimizerTest, OptimizerWhenSliceWithIntermediateOptionsThenOK) {
   OptimizerWhenSliceNThenOK(1, SampleProgram, L"ps_6_0", { L"-flegacy-resource-reservation" });
 }
 
+TEST_F(OptimizerTest, OptimizerWhenBatchThenMatchesSingleRuns) {
+  LPCSTR SampleProgram =
+    "float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+    "  return pos * (A + 2);\r\n"
+    "}";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer2> pOptimizer;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  Utf8ToBlob(m_dllSupport, SampleProgram, &pSource);
+
+  // High-level modules for a few permutations of the program.
+  LPCWSTR Defines[] = { L"-DA=0", L"-DA=1", L"-DA=2", L"-DA=3", L"-DA=4" };
+  const UINT32 ModuleCount = _countof(Defines);
+  std::vector<CComPtr<IDxcBlob>> Modules(ModuleCount);
+  for (UINT32 i = 0; i < ModuleCount; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    LPCWSTR Args[] = { L"/fcgl", Defines[i] };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&Modules[i]));
+  }
+
+  LPCWSTR Passes[] = { L"-hlsl-hlensure", L"-hlsl-hlemit", L"-S" };
+  std::vector<IDxcBlob *> Inputs;
+  for (auto &M : Modules)
+    Inputs.push_back(M);
+  std::vector<IDxcBlob *> Outputs(ModuleCount);
+  std::vector<IDxcBlobEncoding *> Texts(ModuleCount);
+  VERIFY_SUCCEEDED(pOptimizer->RunOptimizerBatch(Inputs.data(), ModuleCount,
+    Passes, _countof(Passes), 3, Outputs.data(), Texts.data()));
+
+  for (UINT32 i = 0; i < ModuleCount; ++i) {
+    CComPtr<IDxcBlob> pBatchModule;
+    CComPtr<IDxcBlobEncoding> pBatchText;
+    pBatchModule.Attach(Outputs[i]);
+    pBatchText.Attach(Texts[i]);
+
+    CComPtr<IDxcBlob> pModule;
+    CComPtr<IDxcBlobEncoding> pText;
+    VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(Modules[i], Passes,
+      _countof(Passes), &pModule, &pText));
+    VERIFY_ARE_EQUAL(BlobToUtf8(pText), BlobToUtf8(pBatchText));
+    VERIFY_ARE_EQUAL(pModule->GetBufferSize(), pBatchModule->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pModule->GetBufferPointer(),
+      pBatchModule->GetBufferPointer(), pModule->GetBufferSize()));
+  }
+}
+
 void OptimizerTest::OptimizerWhenSliceNThenOK(int optLevel) {
   LPCSTR SampleProgram =
     "Texture2D g_Tex;\r\n"
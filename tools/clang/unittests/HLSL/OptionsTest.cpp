@@ -72,6 +72,10 @@ public:
 
   TEST_METHOD(ReadOptionsForDxcWhenApiArgMissingThenFail)
   TEST_METHOD(ReadOptionsForApiWhenApiArgMissingThenOK)
+  TEST_METHOD(ReadOptionsForDxcWhenJobsThenInputNotRequired)
+  TEST_METHOD(ReadOptionsForDxcWhenServeThenInputNotRequired)
+  TEST_METHOD(ReadOptionsForDxcWhenManifestThenInputNotRequired)
+  TEST_METHOD(ReadOptionsForDxcWhenVerifyDeterminismThenCountRead)
 
   TEST_METHOD(ConvertWhenFailThenThrow)
 
@@ -266,6 +270,57 @@ TEST_F(OptionsTest, ReadOptionsForApiWhenApiArgMissingThenOK) {
 }
 
 
+TEST_F(OptionsTest, ReadOptionsForDxcWhenJobsThenInputNotRequired) {
+  // The jobs listed in the file supply the input and target of each compile.
+  const wchar_t *Args[] = {L"exe.exe", L"-jobs", L"jobs.txt", L"-jobs-threads",
+                           L"4"};
+  const wchar_t *ArgsBadThreads[] = {L"exe.exe", L"-jobs", L"jobs.txt",
+                                     L"-jobs-threads", L"many"};
+
+  MainArgsArr mainArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(mainArgsArr, DxcFlags);
+  VERIFY_ARE_EQUAL_STR("jobs.txt", o->JobsFile.data());
+  VERIFY_ARE_EQUAL(4U, o->JobsThreads);
+
+  MainArgsArr badThreadsArr(ArgsBadThreads);
+  ReadOptsTest(badThreadsArr, DxcFlags,
+               "Invalid thread count for -jobs-threads: many");
+}
+
+TEST_F(OptionsTest, ReadOptionsForDxcWhenServeThenInputNotRequired) {
+  // Each request sent to the server supplies its own input and target.
+  const wchar_t *Args[] = {L"exe.exe", L"-serve"};
+
+  MainArgsArr mainArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(mainArgsArr, DxcFlags);
+  VERIFY_IS_TRUE(o->Serve);
+}
+
+TEST_F(OptionsTest, ReadOptionsForDxcWhenManifestThenInputNotRequired) {
+  // The manifest lists the source and profile of each shader.
+  const wchar_t *Args[] = {L"exe.exe", L"-manifest", L"shaders.yaml",
+                           L"-jobs-threads", L"2"};
+
+  MainArgsArr mainArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(mainArgsArr, DxcFlags);
+  VERIFY_ARE_EQUAL_STR("shaders.yaml", o->ManifestFile.data());
+  VERIFY_ARE_EQUAL(2U, o->JobsThreads);
+}
+
+TEST_F(OptionsTest, ReadOptionsForDxcWhenVerifyDeterminismThenCountRead) {
+  const wchar_t *Args[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                           L"hlsl.hlsl", L"-verify-determinism", L"8"};
+  MainArgsArr mainArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(mainArgsArr, DxcFlags);
+  VERIFY_ARE_EQUAL(8U, o->VerifyDeterminism);
+
+  const wchar_t *BadArgs[] = {L"exe.exe", L"/E", L"main", L"/T", L"ps_6_0",
+                              L"hlsl.hlsl", L"-verify-determinism", L"many"};
+  MainArgsArr badArgsArr(BadArgs);
+  ReadOptsTest(badArgsArr, DxcFlags,
+               "Invalid compile count for -verify-determinism: many");
+}
+
 TEST_F(OptionsTest, ConvertWhenFailThenThrow) {
   std::wstring utf16;
 
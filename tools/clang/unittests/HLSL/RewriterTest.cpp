@@ -89,6 +89,7 @@ public:
   TEST_METHOD(RunExtractUniforms);
   TEST_METHOD(RunGlobalsUsedInMethod);
   TEST_METHOD(RunRewriterFails)
+  TEST_METHOD(RunRemoveUnusedGlobalsForEntryPoints)
 
   dxc::DxcDllSupport m_dllSupport;
   CComPtr<IDxcIncludeHandler> m_pIncludeHandler;
@@ -745,4 +746,46 @@ TEST_F(RewriterTest, RunRewriterFails) {
   ::WEX::Logging::Log::Comment(errorStr.data());
 
   VERIFY_IS_TRUE(errorStr.find(L"Length is only allowed for HLSL 2016 and lower.") >= 0);
-}
\ No newline at end of file
+}
+
+TEST_F(RewriterTest, RunRemoveUnusedGlobalsForEntryPoints) {
+  CComPtr<IDxcRewriter> pRewriter;
+  CComPtr<IDxcRewriter3> pRewriter3;
+  VERIFY_SUCCEEDED(CreateRewriter(&pRewriter));
+  VERIFY_SUCCEEDED(pRewriter->QueryInterface(&pRewriter3));
+
+  const char source[] =
+      "static float a = 1;\n"
+      "static float b = 2;\n"
+      "float useA() { return a; }\n"
+      "float useB() { return b; }\n"
+      "float4 mainA() : SV_Target { return useA(); }\n"
+      "float4 mainB() : SV_Target { return useB(); }\n";
+  CComPtr<IDxcBlobEncoding> pSource;
+  CreateBlobPinned(source, sizeof(source) - 1, CP_UTF8, &pSource);
+
+  LPCWSTR entryPoints[] = {L"mainA", L"mainB", L"missing"};
+  CComPtr<IDxcOperationResult> pResults[_countof(entryPoints)];
+  VERIFY_SUCCEEDED(pRewriter3->RemoveUnusedGlobalsForEntryPoints(
+      pSource, L"entries.hlsl", entryPoints, _countof(entryPoints), nullptr, 0,
+      nullptr, &pResults[0].p));
+
+  std::string rewrites[2];
+  for (unsigned i = 0; i < 2; ++i) {
+    HRESULT hrStatus;
+    VERIFY_SUCCEEDED(pResults[i]->GetStatus(&hrStatus));
+    VERIFY_SUCCEEDED(hrStatus);
+    CComPtr<IDxcBlob> result;
+    VERIFY_SUCCEEDED(pResults[i]->GetResult(&result));
+    rewrites[i] = BlobToUtf8(result);
+  }
+  // Each result only keeps what its entry point uses.
+  VERIFY_IS_TRUE(rewrites[0].find("float a") != std::string::npos);
+  VERIFY_IS_TRUE(rewrites[0].find("float b") == std::string::npos);
+  VERIFY_IS_TRUE(rewrites[1].find("float a") == std::string::npos);
+  VERIFY_IS_TRUE(rewrites[1].find("float b") != std::string::npos);
+
+  HRESULT hrStatus;
+  VERIFY_SUCCEEDED(pResults[2]->GetStatus(&hrStatus));
+  VERIFY_FAILED(hrStatus);
+}
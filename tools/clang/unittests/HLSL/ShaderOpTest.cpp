@@ -357,6 +357,11 @@ void ShaderOpTest::CreateDescriptorHeaps() {
   queryHeapDesc.Count = 1;
   queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
   CHECK_HR(m_pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_pQueryHeap)));
+
+  // Create the timestamp query heap, for the start and end of the work.
+  queryHeapDesc.Count = 2;
+  queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+  CHECK_HR(m_pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_pTimestampHeap)));
 }
 
 void ShaderOpTest::CreateDevice() {
@@ -681,6 +686,13 @@ void ShaderOpTest::CreateResources() {
       D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
       IID_PPV_ARGS(&m_pQueryBuffer)));
     SetObjectName(m_pQueryBuffer, "Query Pipeline Readback Buffer");
+
+    CD3DX12_RESOURCE_DESC timestampDesc(CD3DX12_RESOURCE_DESC::Buffer(2 * sizeof(UINT64)));
+    CHECK_HR(m_pDevice->CreateCommittedResource(
+      &readback, D3D12_HEAP_FLAG_NONE, &timestampDesc,
+      D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+      IID_PPV_ARGS(&m_pTimestampBuffer)));
+    SetObjectName(m_pTimestampBuffer, "Query Timestamp Readback Buffer");
   }
 
   CHECK_HR(pList->Close());
@@ -822,6 +834,29 @@ void ShaderOpTest::GetPipelineStats(D3D12_QUERY_DATA_PIPELINE_STATISTICS *pStats
   memcpy(pStats, M.data(), sizeof(*pStats));
 }
 
+bool ShaderOpTest::GetShaderTime(double *pMicroseconds) {
+  UINT64 frequency;
+  if (m_pTimestampBuffer == nullptr ||
+      FAILED(m_CommandList.Queue->GetTimestampFrequency(&frequency)) ||
+      frequency == 0)
+    return false;
+  MappedData M;
+  M.reset(m_pTimestampBuffer, 2 * sizeof(UINT64));
+  const UINT64 *pTimestamps = (const UINT64 *)M.data();
+  if (pTimestamps[1] < pTimestamps[0])
+    return false;
+  *pMicroseconds = (double)(pTimestamps[1] - pTimestamps[0]) * 1000000.0 /
+                   (double)frequency;
+  return true;
+}
+
+ID3D10Blob *ShaderOpTest::GetShaderBlob(LPCSTR pShaderName) {
+  if (pShaderName == nullptr)
+    return nullptr;
+  pShaderName = m_pShaderOp->Strings.insert(pShaderName); // Unique
+  return map_get_or_null(m_Shaders, pShaderName);
+}
+
 void ShaderOpTest::GetReadBackData(LPCSTR pResourceName, MappedData *pData) {
   pResourceName = m_pShaderOp->Strings.insert(pResourceName); // Unique
   ShaderOpResourceData &D = m_ResourceData.at(pResourceName);
@@ -844,6 +879,16 @@ static void SetDescriptorHeaps(ID3D12GraphicsCommandList *pList,
     pList->SetDescriptorHeaps((UINT)localHeaps.size(), localHeaps.data());
 }
 
+void ShaderOpTest::StartTiming(ID3D12GraphicsCommandList *pList) {
+  pList->EndQuery(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0);
+}
+
+void ShaderOpTest::StopTiming(ID3D12GraphicsCommandList *pList) {
+  pList->EndQuery(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, 1);
+  pList->ResolveQueryData(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0, 2,
+                          m_pTimestampBuffer, 0);
+}
+
 void ShaderOpTest::RunCommandList() {
   ID3D12GraphicsCommandList *pList = m_CommandList.List.p;
   if (m_pShaderOp->IsCompute()) {
@@ -851,8 +896,10 @@ void ShaderOpTest::RunCommandList() {
     pList->SetComputeRootSignature(m_pRootSignature);
     SetDescriptorHeaps(pList, m_DescriptorHeaps);
     SetRootValues(pList, m_pShaderOp->IsCompute());
+    StartTiming(pList);
     pList->Dispatch(m_pShaderOp->DispatchX, m_pShaderOp->DispatchY,
                     m_pShaderOp->DispatchZ);
+    StopTiming(pList);
   } else {
     pList->SetPipelineState(m_pPSO);
     pList->SetGraphicsRootSignature(m_pRootSignature);
@@ -909,7 +956,9 @@ void ShaderOpTest::RunCommandList() {
       CComPtr<ID3D12GraphicsCommandList6> pList6;
       CHECK_HR(m_CommandList.List.p->QueryInterface(&pList6));
       pList6->BeginQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
+      StartTiming(pList6);
       pList6->DispatchMesh(1, 1, 1);
+      StopTiming(pList6);
       pList6->EndQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
       pList6->ResolveQueryData(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS,
                               0, 1, m_pQueryBuffer, 0);
@@ -944,7 +993,9 @@ void ShaderOpTest::RunCommandList() {
       UINT vertexCountPerInstance = vertexCount / instanceCount;
 
       pList->BeginQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
+      StartTiming(pList);
       pList->DrawInstanced(vertexCountPerInstance, instanceCount, 0, 0);
+      StopTiming(pList);
       pList->EndQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
       pList->ResolveQueryData(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS,
                               0, 1, m_pQueryBuffer, 0);
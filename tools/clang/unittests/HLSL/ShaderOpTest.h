@@ -252,6 +252,11 @@ public:
   typedef std::function<void(LPCSTR Name, std::vector<BYTE> &Data, ShaderOp *pShaderOp)> TInitCallbackFn;
   void GetPipelineStats(D3D12_QUERY_DATA_PIPELINE_STATISTICS *pStats);
   void GetReadBackData(LPCSTR pResourceName, MappedData *pData);
+  // Gets the GPU time taken by the Dispatch or Draw call; returns false if
+  // the queue can't report it.
+  bool GetShaderTime(double *pMicroseconds);
+  // Gets the compiled shader with the given name, or null.
+  ID3D10Blob *GetShaderBlob(LPCSTR pShaderName);
   void RunShaderOp(ShaderOp *pShaderOp);
   void RunShaderOp(std::shared_ptr<ShaderOp> pShaderOp);
   void SetDevice(ID3D12Device* pDevice);
@@ -282,6 +287,8 @@ private:
   CComPtr<ID3D12RootSignature> m_pRootSignature;
   CComPtr<ID3D12QueryHeap> m_pQueryHeap;
   CComPtr<ID3D12Resource> m_pQueryBuffer;
+  CComPtr<ID3D12QueryHeap> m_pTimestampHeap;
+  CComPtr<ID3D12Resource> m_pTimestampBuffer;
   dxc::DxcDllSupport *m_pDxcSupport = nullptr;
   CommandListRefs m_CommandList;
   HANDLE m_hFence;
@@ -304,6 +311,8 @@ private:
   void CreateShaders();
   void RunCommandList();
   void SetRootValues(ID3D12GraphicsCommandList *pList, bool isCompute);
+  void StartTiming(ID3D12GraphicsCommandList *pList);
+  void StopTiming(ID3D12GraphicsCommandList *pList);
 };
 
 // Deserialize a ShaderOpSet from a stream.
@@ -234,6 +234,7 @@ public:
   TEST_METHOD(WhenRootSigMatchShaderFail_Unbounded1)
   TEST_METHOD(WhenRootSigMatchShaderFail_Unbounded2)
   TEST_METHOD(WhenRootSigMatchShaderFail_Unbounded3)
+  TEST_METHOD(WhenRootSigSharedThenEachShaderChecked)
   TEST_METHOD(WhenProgramOutSigMissingThenFail)
   TEST_METHOD(WhenProgramOutSigUnexpectedThenFail)
   TEST_METHOD(WhenProgramSigMismatchThenFail)
@@ -295,6 +296,8 @@ public:
   TEST_METHOD(WaveSizeValid)
 
   TEST_METHOD(ValidateRootSigContainer)
+  TEST_METHOD(ValidateMetadataOnly)
+  TEST_METHOD(ValidateWithReport)
   TEST_METHOD(ValidatePrintfNotAllowed)
 
   TEST_METHOD(ValidateVersionNotAllowed)
@@ -2393,6 +2396,32 @@ TEST_F(ValidationTest, WhenRootSigCompatThenSucceed) {
   );
 }
 
+// Verified root signatures are memoized by their bytes; shaders that share
+// one must still be checked against it individually.
+TEST_F(ValidationTest, WhenRootSigSharedThenEachShaderChecked) {
+  LPCSTR pRootSigSource =
+    "[RootSignature ( \"CBV(b2, space = 5)\" )]"
+    "  float4 main() : semantic { return 0; }";
+  LPCSTR pBoundSource =
+    "struct Foo { float a; int4 b; }; "
+    "ConstantBuffer<Foo> cb1 : register(b2, space5); "
+    "float4 main() : semantic { return cb1.b.x; }";
+  LPCSTR pUnboundSource =
+    "struct Foo { float a; int4 b; }; "
+    "ConstantBuffer<Foo> cb1 : register(b3, space5); "
+    "float4 main() : semantic { return cb1.b.x; }";
+  for (unsigned i = 0; i < 2; ++i) {
+    ReplaceContainerPartsCheckMsgs(pBoundSource, pRootSigSource, "vs_6_0",
+                                   {DFCC_RootSignature}, {});
+    ReplaceContainerPartsCheckMsgs(
+      pUnboundSource, pRootSigSource, "vs_6_0", {DFCC_RootSignature},
+      {
+        "Root Signature in DXIL container is not compatible with shader.",
+        "Validation failed."
+      });
+  }
+}
+
 TEST_F(ValidationTest, WhenRootSigMatchShaderSucceed_RootConstVis) {
   ReplaceContainerPartsCheckMsgs(
     "float c; float4 main() : semantic { return c; }",
@@ -3855,6 +3884,76 @@ TEST_F(ValidationTest, ValidateRootSigContainer) {
     DxcValidatorFlags_RootSignatureOnly | DxcValidatorFlags_InPlaceEdit);
 }
 
+TEST_F(ValidationTest, ValidateMetadataOnly) {
+  // DXIL.dll validators do not know the flag.
+  if (!m_ver.m_InternalValidator) return;
+
+  CComPtr<IDxcBlob> pObject;
+  if (!CompileSource("float4 main(float4 p : POSITION) : SV_Position { return p; }",
+                     "vs_6_0", &pObject))
+    return;
+  CheckValidationMsgs(pObject, {}, false, DxcValidatorFlags_MetadataOnly);
+
+  // The container is not checked in full, so it may not be signed.
+  CComPtr<IDxcValidator> pValidator;
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+  VERIFY_ARE_EQUAL(E_INVALIDARG,
+                   pValidator->Validate(pObject,
+                                        DxcValidatorFlags_MetadataOnly |
+                                            DxcValidatorFlags_InPlaceEdit,
+                                        &pResult));
+
+  pObject.Release();
+  if (!CompileSource("[shader(\"raygeneration\")] void RayGen() {}",
+                     "lib_6_3", &pObject))
+    return;
+  CheckValidationMsgs(pObject, {}, false, DxcValidatorFlags_MetadataOnly);
+}
+
+TEST_F(ValidationTest, ValidateWithReport) {
+  // DXIL.dll validators do not know the flag.
+  if (!m_ver.m_InternalValidator) return;
+
+  auto ValidateToReport = [&](IDxcBlob *pObject, std::string &Report) {
+    CComPtr<IDxcValidator> pValidator;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcResult> pResult2;
+    CComPtr<IDxcBlobUtf8> pReport;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+    VERIFY_SUCCEEDED(pValidator->Validate(pObject, DxcValidatorFlags_Report, &pResult));
+    VERIFY_SUCCEEDED(pResult.QueryInterface(&pResult2));
+    VERIFY_SUCCEEDED(pResult2->GetOutput(DXC_OUT_VALIDATION_REPORT, IID_PPV_ARGS(&pReport), nullptr));
+    Report.assign(pReport->GetStringPointer(), pReport->GetStringLength());
+  };
+
+  CComPtr<IDxcBlob> pObject;
+  if (!CompileSource("float4 main() : SV_Target { return 1; }", "ps_6_0", &pObject))
+    return;
+  std::string Report;
+  ValidateToReport(pObject, Report);
+  VERIFY_IS_TRUE(Report.find("\"name\": \"Validate Functions\"") != std::string::npos);
+  VERIFY_IS_TRUE(Report.find("\"name\": \"Validate Container Parts\"") != std::string::npos);
+  VERIFY_IS_TRUE(Report.find("\"rules\": []") != std::string::npos);
+
+  // Without the store, the output is reported as never written.
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pText;
+  Utf8ToBlob(m_dllSupport, "float4 main() : SV_Target { return 1; }", &pSource);
+  VERIFY_IS_TRUE(RewriteAssemblyToText(pSource, "ps_6_0", nullptr, 0, nullptr, 0,
+      {"call void @dx.op.storeOutput.f32\\(i32 5, i32 0, i32 0, i8 3, [^)]*\\)"},
+      {""}, &pText, /*bRegex*/ true));
+  CComPtr<IDxcAssembler> pAssembler;
+  CComPtr<IDxcOperationResult> pAssembleResult;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+  VERIFY_SUCCEEDED(pAssembler->AssembleToContainer(pText, &pAssembleResult));
+  pObject.Release();
+  VERIFY_SUCCEEDED(pAssembleResult->GetResult(&pObject));
+  ValidateToReport(pObject, Report);
+  VERIFY_IS_TRUE(Report.find("\"rules\": []") == std::string::npos);
+  VERIFY_IS_TRUE(Report.find("\"count\": ") != std::string::npos);
+}
+
 TEST_F(ValidationTest, ValidatePrintfNotAllowed) {
   TestCheck(L"..\\CodeGenHLSL\\printf.hlsl");
 }
@@ -498,6 +498,15 @@ static FileRunCommandResult CheckDxilVer(dxc::DxcDllSupport& DllSupport,
   return FileRunCommandResult::Success();
 }
 
+void FileRunCommandPart::GetCompiler(dxc::DxcDllSupport &DllSupport, IDxcCompiler **ppCompiler) {
+  if (pCachedCompiler) {
+    pCachedCompiler->AddRef();
+    *ppCompiler = pCachedCompiler;
+    return;
+  }
+  IFT(DllSupport.CreateInstance(CLSID_DxcCompiler, ppCompiler));
+}
+
 FileRunCommandResult FileRunCommandPart::RunDxc(dxc::DxcDllSupport &DllSupport, const FileRunCommandResult *Prior) {
   // Support piping stdin from prior if needed.
   UNREFERENCED_PARAMETER(Prior);
@@ -557,7 +566,7 @@ FileRunCommandResult FileRunCommandPart::RunDxc(dxc::DxcDllSupport &DllSupport,
   IFT(DllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
   IFT(pLibrary->CreateBlobFromFile(CommandFileName, nullptr, &pSource));
   CComPtr<IDxcIncludeHandler> pIncludeHandler = AllocVFSIncludeHandler(pLibrary, pVFS);
-  IFT(DllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  GetCompiler(DllSupport, &pCompiler);
   IFT(pCompiler->Compile(pSource, CommandFileName, entry.c_str(), profile.c_str(),
                           flags.data(), flags.size(), nullptr, 0, pIncludeHandler, &pResult));
   IFT(pResult->GetStatus(&resultStatus));
@@ -873,7 +882,7 @@ FileRunCommandResult FileRunCommandPart::RunLink(dxc::DxcDllSupport &DllSupport,
   IFT(DllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
   CComPtr<IDxcIncludeHandler> pIncludeHandler = AllocVFSIncludeHandler(pLibrary, pVFS);
   IFT(DllSupport.CreateInstance(CLSID_DxcLinker, &pLinker));
-  IFT(DllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  GetCompiler(DllSupport, &pCompiler);
 
   for (auto name : libNames) {
     CComPtr<IDxcBlob> pLibBlob;
@@ -1122,6 +1131,7 @@ class FileRunTestResultImpl : public FileRunTestResult {
   dxc::DxcDllSupport &m_support;
   PluginToolsPaths *m_pPluginToolsPaths;
   LPCWSTR m_dumpName = nullptr;
+  IDxcCompiler *m_pCompiler = nullptr;
   // keep track of virtual files for duration of this test (for all RUN lines)
   FileMap Files;
 
@@ -1159,6 +1169,7 @@ class FileRunTestResultImpl : public FileRunTestResult {
     for (FileRunCommandPart & part : parts) {
       int priorExitCode = result.ExitCode;
       part.pVFS = &Files;
+      part.pCachedCompiler = m_pCompiler;
       result = part.Run(m_support, previousResult, m_pPluginToolsPaths, dumpName);
 
       // If there is IDxcResult, save named output blobs to Files.
@@ -1193,8 +1204,9 @@ class FileRunTestResultImpl : public FileRunTestResult {
 
 public:
   FileRunTestResultImpl(dxc::DxcDllSupport &support, PluginToolsPaths *pPluginToolsPaths = nullptr,
-                        LPCWSTR dumpName = nullptr)
-    : m_support(support), m_pPluginToolsPaths(pPluginToolsPaths), m_dumpName(dumpName) {}
+                        LPCWSTR dumpName = nullptr, IDxcCompiler *pCompiler = nullptr)
+    : m_support(support), m_pPluginToolsPaths(pPluginToolsPaths), m_dumpName(dumpName),
+      m_pCompiler(pCompiler) {}
   void RunFileCheckFromFileCommands(LPCWSTR fileName) {
     // Assume UTF-8 files.
     auto cmds = GetRunLines(fileName);
@@ -1247,8 +1259,9 @@ FileRunTestResult FileRunTestResult::RunFromFileCommands(LPCWSTR fileName,
 
 FileRunTestResult FileRunTestResult::RunFromFileCommands(LPCWSTR fileName, dxc::DxcDllSupport &dllSupport,
                                                          PluginToolsPaths *pPluginToolsPaths /*=nullptr*/,
-                                                         LPCWSTR dumpName /*=nullptr*/) {
-  FileRunTestResultImpl result(dllSupport, pPluginToolsPaths, dumpName);
+                                                         LPCWSTR dumpName /*=nullptr*/,
+                                                         IDxcCompiler *pCompiler /*=nullptr*/) {
+  FileRunTestResultImpl result(dllSupport, pPluginToolsPaths, dumpName, pCompiler);
   result.RunFileCheckFromFileCommands(fileName);
   return result;
 }
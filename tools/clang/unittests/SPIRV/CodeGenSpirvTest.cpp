@@ -1564,6 +1564,7 @@ TEST_F(FileTest, SpirvOptOconfigInvalidFlag) {
   runFileTest("spirv.opt.invalid-flag.cl.oconfig.hlsl", Expect::Failure);
 }
 TEST_F(FileTest, SpirvOptOconfig) { runFileTest("spirv.opt.cl.oconfig.hlsl"); }
+TEST_F(FileTest, SpirvOptFastO1) { runFileTest("spirv.opt.fast.O1.hlsl"); }
 
 // For shader stage input/output interface
 // For semantic SV_Position, SV_ClipDistance, SV_CullDistance
@@ -1835,6 +1836,11 @@ TEST_F(FileTest, VulkanRegisterBindingShiftAllSets) {
   // command line option
   runFileTest("vk.binding.cl.shift.all-sets.hlsl");
 }
+TEST_F(FileTest, VulkanRegisterBindingShiftReuseLegalization) {
+  // Resource binding from :register() with shift specified via command line
+  // option, legalized through the reuse cache
+  runFileTest("vk.binding.cl.reuse-legalization.hlsl");
+}
 TEST_F(FileTest, VulkanRegisterBinding1to1Mapping) {
   runFileTest("vk.binding.cl.register.hlsl");
 }
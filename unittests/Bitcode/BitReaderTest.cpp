@@ -13,6 +13,7 @@
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h" // HLSL Change
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -273,4 +274,74 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// HLSL Change Begin - on-demand metadata loading.
+static const char DebugInfoAssembly[] =
+    "define void @f() {\n"
+    "  ret void, !dbg !10\n"
+    "}\n"
+    "define void @g() {\n"
+    "  ret void, !dbg !11\n"
+    "}\n"
+    "!llvm.dbg.cu = !{!0}\n"
+    "!llvm.module.flags = !{!12}\n"
+    "!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, "
+    "producer: \"test\", isOptimized: false, runtimeVersion: 0, "
+    "emissionKind: 1, subprograms: !2)\n"
+    "!1 = !DIFile(filename: \"test.c\", directory: \"/\")\n"
+    "!2 = !{!3, !4}\n"
+    "!3 = !DISubprogram(name: \"f\", scope: !1, file: !1, line: 1, type: !5, "
+    "isLocal: false, isDefinition: true, function: void ()* @f)\n"
+    "!4 = !DISubprogram(name: \"g\", scope: !1, file: !1, line: 2, type: !5, "
+    "isLocal: false, isDefinition: true, function: void ()* @g)\n"
+    "!5 = !DISubroutineType(types: !6)\n"
+    "!6 = !{null}\n"
+    "!10 = !DILocation(line: 1, scope: !3)\n"
+    "!11 = !DILocation(line: 2, scope: !4)\n"
+    "!12 = !{i32 2, !\"Debug Info Version\", i32 3}\n";
+
+static std::string printModule(const Module &M) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  M.print(OS, nullptr);
+  return OS.str();
+}
+
+TEST(BitReaderTest, MaterializeMetadataOnDemand) {
+  SmallString<1024> Mem;
+  writeModuleToBuffer(parseAssembly(DebugInfoAssembly), Mem);
+
+  LLVMContext Context;
+  ErrorOr<std::unique_ptr<Module>> ModuleOrErr = getLazyBitcodeModule(
+      MemoryBuffer::getMemBuffer(Mem.str(), "test", false), Context, nullptr,
+      /*ShouldLazyLoadMetadata*/ true, /*ShouldTrackBitstreamUsage*/ false,
+      /*ShouldLoadMetadataOnDemand*/ true);
+  std::unique_ptr<Module> M = std::move(ModuleOrErr.get());
+
+  // Materializing a function loads the metadata it refers to, and no named
+  // metadata.
+  EXPECT_FALSE(M->getFunction("g")->materialize());
+  DILocation *DL = M->getFunction("g")->front().getTerminator()->getDebugLoc();
+  ASSERT_TRUE(DL != nullptr);
+  EXPECT_EQ(2u, DL->getLine());
+  EXPECT_EQ("g", cast<DISubprogram>(DL->getScope())->getName());
+  EXPECT_TRUE(M->getFunction("f")->empty());
+  EXPECT_EQ(nullptr, M->getNamedMetadata("llvm.dbg.cu"));
+
+  // Selecting a named node loads it alone.
+  StringRef Flags[] = { "llvm.module.flags" };
+  EXPECT_FALSE(M->materializeSelectNamedMetadata(Flags));
+  ASSERT_TRUE(M->getNamedMetadata("llvm.module.flags") != nullptr);
+  EXPECT_EQ(1u, M->getNamedMetadata("llvm.module.flags")->getNumOperands());
+  EXPECT_EQ(nullptr, M->getNamedMetadata("llvm.dbg.cu"));
+
+  // Materializing the rest gives the module a full read would.
+  EXPECT_FALSE(M->materializeAll());
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+  LLVMContext FullContext;
+  ErrorOr<std::unique_ptr<Module>> FullOrErr =
+      parseBitcodeFile(MemoryBufferRef(Mem.str(), "test"), FullContext);
+  EXPECT_EQ(printModule(*FullOrErr.get()), printModule(*M));
+}
+// HLSL Change End
+
 } // end namespace
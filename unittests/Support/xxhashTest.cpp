@@ -0,0 +1,39 @@
+//===- llvm/unittest/Support/xxhashTest.cpp - xxHash tests ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// HLSL Change - new file.
+
+#include "llvm/Support/xxhash.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(xxhashTest, Basic) {
+  EXPECT_EQ(0xef46db3751d8e999U, xxHash64(""));
+  EXPECT_EQ(0x33bf00a859c4ba3fU, xxHash64("foo"));
+  EXPECT_EQ(0x48a37c90ad27a659U, xxHash64("bar"));
+  EXPECT_EQ(0x69196c1b3af0bff9U,
+            xxHash64("0123456789abcdefghijklmnopqrstuvwxyz"));
+}
+
+TEST(xxhashTest, Incremental) {
+  StringRef Data = "0123456789abcdefghijklmnopqrstuvwxyz"
+                   "0123456789abcdefghijklmnopqrstuvwxyz0123";
+  uint64_t Expected = xxHash64(Data);
+  for (size_t Split = 0; Split <= Data.size(); ++Split) {
+    xxHash64Builder Builder;
+    Builder.update(Data.substr(0, Split));
+    Builder.update(Data.substr(Split));
+    EXPECT_EQ(Expected, Builder.final());
+  }
+}
+
+} // end anonymous namespace
@@ -2019,6 +2019,7 @@ class db_dxil(object):
             {'n':'sroa-strict-inbounds', 'i':'SROAStrictInbounds', 't':'bool', 'd':'Experiment with completely strict handling of inbounds GEPs.'}])
         add_pass("dxil-cond-mem2reg", "DxilConditionalMem2Reg", "Dxil Conditional Mem2Reg", [
                 {'n':'NoOpt', 't':'bool', 'c':1},
+                {'n':'IndexableArrayLimit', 't':'unsigned', 'c':1, 'd':'Keep dynamically indexed arrays of at least this many scalars in memory (0 = off)'},
             ])
         add_pass('scalarrepl', 'SROA_DT', 'Scalar Replacement of Aggregates (DT)', [
             {'n':'Threshold', 't':'int', 'c':1},
@@ -2055,7 +2056,8 @@ class db_dxil(object):
             {'n':'add-pixel-cost','t':'int','c':1},
             {'n':'rt-width','t':'int','c':1},
             {'n':'sv-position-index','t':'int','c':1},
-            {'n':'num-pixels','t':'int','c':1}])
+            {'n':'num-pixels','t':'int','c':1},
+            {'n':'wave-coalesce','t':'bool','c':1}])
         add_pass('hlsl-dxil-constantColor', 'DxilOutputColorBecomesConstant', 'DXIL Constant Color Mod', [
             {'n':'mod-mode','t':'int','c':1},
             {'n':'constant-red','t':'float','c':1},
@@ -2065,15 +2067,21 @@ class db_dxil(object):
         add_pass('hlsl-dxil-remove-discards', 'DxilRemoveDiscards', 'HLSL DXIL Remove all discard instructions', [])
         add_pass('hlsl-dxil-force-early-z', 'DxilForceEarlyZ', 'HLSL DXIL Force the early Z global flag, if shader has no discard calls', [])
         add_pass('hlsl-dxil-pix-meshshader-output-instrumentation', 'DxilPIXMeshShaderOutputInstrumentation', 'DXIL mesh shader output instrumentation for PIX', [
-            {'n':'UAVSize','t':'int','c':1}])
+            {'n':'UAVSize','t':'int','c':1},
+            {'n':'waveCoalesce','t':'bool','c':1}])
         add_pass('hlsl-dxil-pix-shader-access-instrumentation', 'DxilShaderAccessTracking', 'HLSL DXIL shader access tracking for PIX', [
             {'n':'config','t':'int','c':1},
-            {'n':'checkForDynamicIndexing','t':'bool','c':1}])
+            {'n':'checkForDynamicIndexing','t':'bool','c':1},
+            {'n':'waveCoalesce','t':'bool','c':1}])
         add_pass('hlsl-dxil-debug-instrumentation', 'DxilDebugInstrumentation', 'HLSL DXIL debug instrumentation for PIX', [
             {'n':'UAVSize','t':'int','c':1},
             {'n':'parameter0','t':'int','c':1},
             {'n':'parameter1','t':'int','c':1},
-            {'n':'parameter2','t':'int','c':1}])
+            {'n':'parameter2','t':'int','c':1},
+            {'n':'parameter0Range','t':'int','c':1},
+            {'n':'parameter1Range','t':'int','c':1},
+            {'n':'parameter2Range','t':'int','c':1},
+            {'n':'BlockGranularity','t':'bool','c':1}])
         add_pass('dxil-annotate-with-virtual-regs', 'DxilAnnotateWithVirtualRegister', 'Annotates each instruction in the DXIL module with a virtual register number', [])
         add_pass('dxil-dbg-value-to-dbg-declare', 'DxilDbgValueToDbgDeclare', 'Converts llvm.dbg.value uses to llvm.dbg.declare.', [])
         add_pass('hlsl-dxil-reduce-msaa-to-single', 'DxilReduceMSAAToSingleSample', 'HLSL DXIL Reduce all MSAA reads to single-sample reads', [])
@@ -2085,7 +2093,9 @@ class db_dxil(object):
         add_pass("hl-legalize-parameter", "HLLegalizeParameter", "Legalize parameter", [])
         add_pass('scalarrepl-param-hlsl', 'SROA_Parameter_HLSL', 'Scalar Replacement of Aggregates HLSL (parameters)', [])
         add_pass('static-global-to-alloca', 'LowerStaticGlobalIntoAlloca', 'Lower static global into Alloca', [])
-        add_pass('hlmatrixlower', 'HLMatrixLowerPass', 'HLSL High-Level Matrix Lower', [])
+        add_pass('hlmatrixlower', 'HLMatrixLowerPass', 'HLSL High-Level Matrix Lower', [
+                {'n':'dot-products', 'i':'UseDotProducts', 't':'bool', 'c':1, 'd':'Lower float matrix multiplies to dot products'},
+            ])
         add_pass('matrixbitcastlower', 'MatrixBitcastLowerPass', 'Matrix Bitcast lower', [])
         add_pass("reg2mem_hlsl", "RegToMemHlsl", "Demote values with phi-node usage to stack slots", [])
         add_pass('dynamic-vector-to-array', 'DynamicIndexingVectorToArray', 'Replace dynamic indexing vector with array', [
@@ -2093,6 +2103,7 @@ class db_dxil(object):
         add_pass('hlsl-dxil-promote-local-resources', 'DxilPromoteLocalResources', 'DXIL promote local resource use', [])
         add_pass('hlsl-dxil-promote-static-resources', 'DxilPromoteStaticResources', 'DXIL promote static resource use', [])
         add_pass('hlsl-dxil-legalize-resources', 'DxilLegalizeResources', 'DXIL legalize resource use', [])
+        add_pass('hlsl-dxil-resource-use-analysis', 'ResourceUseAnalysis', 'DXIL resource use analysis', [])
         add_pass('hlsl-dxil-legalize-eval-operations', 'DxilLegalizeEvalOperations', 'DXIL legalize eval operations', [])
         add_pass('dxilgen', 'DxilGenerationPass', 'HLSL DXIL Generation', [
             {'n':'NotOptimized','t':'bool','c':1}])
@@ -2101,6 +2112,7 @@ class db_dxil(object):
         add_pass('hlsl-dxil-precise', 'DxilPrecisePropagatePass', 'DXIL precise attribute propagate', [])
         add_pass('dxil-legalize-sample-offset', 'DxilLegalizeSampleOffsetPass', 'DXIL legalize sample offset', [])
         add_pass('dxil-gvn-hoist', 'DxilSimpleGVNHoist', 'DXIL simple gvn hoist', [])
+        add_pass('dxil-cbuffer-load-cse', 'DxilCBufferLoadCSE', 'DXIL cbuffer load CSE', [])
         add_pass('hlsl-hlensure', 'HLEnsureMetadata', 'HLSL High-Level Metadata Ensure', [])
         add_pass('multi-dim-one-dim', 'MultiDimArrayToOneDimArray', 'Flatten multi-dim array into one-dim array', [])
         add_pass('resource-handle', 'ResourceToHandle', 'Lower resource into handle', [])
@@ -2118,12 +2130,25 @@ class db_dxil(object):
         add_pass('dxil-dfe', 'DxilDeadFunctionElimination', 'Remove all unused function except entry from DxilModule', [])
         add_pass('hl-dfe', 'HLDeadFunctionElimination', 'Remove all unused function except entry from HLModule', [])
         add_pass('hl-preprocess', 'HLPreprocess', 'Preprocess HLModule after inline', [])
-        add_pass('hlsl-dxil-expand-trig', 'DxilExpandTrigIntrinsics', 'DXIL expand trig intrinsics', [])
+        add_pass('hlsl-dxil-expand-trig-intrinsics', 'DxilExpandTrigIntrinsics', 'DXIL expand trig intrinsics', [
+                {'n':'fast', 'i':'Fast', 't':'bool', 'c':1, 'd':'Use cheaper approximations and leave precise calls and tan alone'},
+            ])
         add_pass('hlsl-hca', 'HoistConstantArray', 'HLSL constant array hoisting', [])
         add_pass('hlsl-dxil-preserve-all-outputs', 'DxilPreserveAllOutputs', 'DXIL write to all outputs in signature', [])
         add_pass('red', 'ReducibilityAnalysis', 'Reducibility Analysis', [])
         add_pass('viewid-state', 'ComputeViewIdState', 'Compute information related to ViewID', [])
         add_pass('hlsl-translate-dxil-opcode-version', 'DxilTranslateRawBuffer', 'Translates one version of dxil to another', [])
+        add_pass('hlsl-dxil-coalesce-raw-buffer', 'DxilCoalesceRawBuffer', 'DXIL coalesce raw buffer access', [])
+        add_pass('hlsl-dxil-specialize-constants', 'DxilSpecializeConstants', 'DXIL specialize constants', [
+                {'n':'values', 'i':'Values', 't':'string', 'd':'Specialization constant values as id=value;id=value'},
+                {'n':'validate', 'i':'Validate', 't':'bool', 'c':1, 'd':'Validate the specialized module'},
+            ])
+        add_pass('hlsl-dxil-cluster-samples', 'DxilClusterSamples', 'DXIL cluster samples', [])
+        add_pass('hlsl-dxil-hoist-handles', 'DxilHoistHandles', 'DXIL hoist handles', [])
+        add_pass('hlsl-dxil-groupshared-layout', 'DxilGroupSharedLayout', 'DXIL groupshared layout', [])
+        add_pass('hlsl-dxil-matrix-layout', 'DxilMatrixLayout', 'DXIL matrix layout', [])
+        add_pass('hlsl-dxil-pair-16bit-ops', 'DxilPair16BitOps', 'DXIL pair 16-bit operations', [])
+        add_pass('hlsl-dxil-remove-redundant-nonuniform', 'DxilRemoveRedundantNonUniform', 'DXIL remove redundant NonUniformResourceIndex', [])
         add_pass('hlsl-dxil-cleanup-addrspacecast', 'DxilCleanupAddrSpaceCast', 'HLSL DXIL Cleanup Address Space Cast (part of hlsl-dxilfinalize)', [])
         add_pass('dxil-fix-array-init', 'DxilFixConstArrayInitializer', 'Dxil Fix Array Initializer', [])
         add_pass('hlsl-validate-wave-sensitivity', 'DxilValidateWaveSensitivity', 'HLSL DXIL wave sensitiveity validation', [])
@@ -2175,6 +2200,7 @@ class db_dxil(object):
         add_pass('dxil-loop-unroll', 'DxilLoopUnroll', 'DxilLoopUnroll', [
             {'n':'MaxIterationAttempt', 't':'unsigned', 'c':1, 'd':'Maximum number of iterations to attempt when iteratively unrolling.'},
             {'n':'OnlyWarnOnFail', 't':'bool', 'c':1, 'd':'Whether to just warn when unrolling fails.'},
+            {'n':'GrowthBudget', 't':'unsigned', 'c':1, 'd':'Instructions full unrolling may add before a loop that does not need it is only unrolled partially (0 means no limit).'},
         ])
         add_pass('dxil-erase-dead-region', 'DxilEraseDeadRegion', 'DxilEraseDeadRegion', [])
         add_pass('dxil-remove-dead-blocks', 'DxilRemoveDeadBlocks', 'DxilRemoveDeadBlocks', [])
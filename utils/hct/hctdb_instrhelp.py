@@ -749,6 +749,73 @@ def get_hlsl_intrinsics():
     result += "\n#endif // ENABLE_SPIRV_CODEGEN\n" if is_vk_table else ""  # SPIRV Change
     return result
 
+def hash_hlsl_intrinsic_name(name):
+    # 32-bit FNV-1a; must match HashIntrinsicName in SemaHLSL.cpp.
+    h = 0x811c9dc5
+    for c in name.encode("utf-8"):
+        h = ((h ^ c) * 0x01000193) & 0xffffffff
+    return h
+
+def get_hlsl_intrinsic_name_index():
+    # For each intrinsic table, an open-addressed hash table mapping a name to
+    # the run of entries with that name, so Sema need not scan the table.
+    db = get_db_hlsl()
+    tables = {}
+    for i in sorted(db.intrinsics, key=lambda x: x.key):
+        name = i.name
+        if i.hidden:
+            name = "$hidden$" + name
+        entries = tables.setdefault(i.ns, [])
+        if entries and entries[-1][0] == name:
+            entries[-1][2] += 1
+        else:
+            assert not [e for e in entries if e[0] == name], "overloads of %s must be adjacent" % name
+            first = sum(e[2] for e in entries)
+            entries.append([name, first, 1])
+    vk_namespaces = set(i.ns for i in db.intrinsics if i.vulkanSpecific)
+    # The global intrinsics are looked up most often; list them first.
+    namespaces = sorted(tables.keys(), key=lambda ns: (ns != "Intrinsics", ns))
+    result = "struct HLSL_INTRINSIC_NAME_INDEX {\n"
+    result += "  UINT uHash;   // Hash of the name, as computed by HashIntrinsicName\n"
+    result += "  UINT uFirst;  // Index of the first entry with the name\n"
+    result += "  UINT uCount;  // Number of entries with the name; 0 for an empty slot\n"
+    result += "};\n\n"
+    result += "struct HLSL_INTRINSIC_NAME_INDEX_TABLE {\n"
+    result += "  const HLSL_INTRINSIC *pIntrinsics;\n"
+    result += "  const HLSL_INTRINSIC_NAME_INDEX *pIndex;\n"
+    result += "  UINT uIndexSize; // Power of two\n"
+    result += "};\n"
+    for ns in namespaces:
+        entries = tables[ns]
+        size = 4
+        while size < 2 * len(entries):
+            size *= 2
+        slots = [None] * size
+        for e in entries:
+            h = hash_hlsl_intrinsic_name(e[0])
+            slot = h & (size - 1)
+            while slots[slot] is not None:
+                slot = (slot + 1) & (size - 1)
+            slots[slot] = (h, e)
+        text = "\nstatic const HLSL_INTRINSIC_NAME_INDEX g_%sNameIndex[] =\n{\n" % ns
+        for slot in slots:
+            if slot is None:
+                text += "    {0, 0, 0},\n"
+            else:
+                text += "    {0x%08x, %d, %d}, // %s\n" % (slot[0], slot[1][1], slot[1][2], slot[1][0])
+        text += "};\n"
+        if ns in vk_namespaces:
+            text = "\n#ifdef ENABLE_SPIRV_CODEGEN\n" + text + "\n#endif // ENABLE_SPIRV_CODEGEN\n"
+        result += text
+    result += "\nstatic const HLSL_INTRINSIC_NAME_INDEX_TABLE g_IntrinsicNameIndexTables[] =\n{\n"
+    for ns in namespaces:
+        line = "    {g_%s, g_%sNameIndex, _countof(g_%sNameIndex)},\n" % (ns, ns, ns)
+        if ns in vk_namespaces:
+            line = "#ifdef ENABLE_SPIRV_CODEGEN\n" + line + "#endif // ENABLE_SPIRV_CODEGEN\n"
+        result += line
+    result += "};\n"
+    return result
+
 # SPIRV Change Starts
 def wrap_with_ifdef_if_vulkan_specific(intrinsic, text):
     if intrinsic.vulkanSpecific:
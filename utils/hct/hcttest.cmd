@@ -164,6 +164,13 @@ if "%1"=="-clean" (
 ) else if "%1"=="-file-check-dump" (
   set ADDITIONAL_OPTS=%ADDITIONAL_OPTS% /p:"FileCheckDumpDir=%~2\HLSL"
   shift /1
+) else if "%1"=="-filecheck-threads" (
+  set ADDITIONAL_OPTS=%ADDITIONAL_OPTS% /p:"FileCheckThreads=%~2"
+  shift /1
+) else if "%1"=="-filecheck-shard" (
+  set ADDITIONAL_OPTS=%ADDITIONAL_OPTS% /p:"FileCheckShardIndex=%~2" /p:"FileCheckShardCount=%~3"
+  shift /1
+  shift /1
 ) else if "%1"=="-dxil-loc" (
   set DXIL_DLL_LOC=%~2
   shift /1
@@ -393,6 +400,8 @@ echo   -custom-bin-set "file [file]..." - custom set of binaries to copy into te
 echo   -dxilconv-loc "dxilconv.dll location" - fetch dxilconv.dll from custom location
 echo   -dxil-loc "dxil.dll location" - fetch dxil.dll from provided location
 echo   -file-check-dump "dump-path" - dump file-check inputs to files under dump-path
+echo   -filecheck-threads N - run each batch of file-check tests on N threads (default: one per core)
+echo   -filecheck-shard I N - run only every Nth file-check test, starting at the Ith (0-based)
 echo.
 echo current BUILD_ARCH=%BUILD_ARCH%.  Override with:
 echo   -x86 targets an x86 build (aka. Win32)